@@ -29,7 +29,7 @@
 #include <iostream>
 #include <sstream>
 
-static radv_compiler_statistic_info statistic_infos[] = {
+static const radv_compiler_statistic_info statistic_infos[] = {
    [aco::statistic_hash] = {"Hash", "CRC32 hash of code and constant data"},
    [aco::statistic_instructions] = {"Instructions", "Instruction count"},
    [aco::statistic_copies] = {"Copies", "Copy instructions created for pseudo-instructions"},
@@ -133,6 +133,9 @@ void aco_compile_shader(unsigned shader_count,
    aco::ssa_elimination(program.get());
    aco::lower_to_hw_instr(program.get());
 
+   if (!(aco::debug_flags & aco::DEBUG_NO_SCHED_POST_RA))
+      aco::schedule_program_post_ra(program.get());
+
    /* Insert Waitcnt */
    aco::insert_wait_states(program.get());
    aco::insert_NOPs(program.get());
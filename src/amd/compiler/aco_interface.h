@@ -32,6 +32,14 @@ extern "C" {
 
 struct ac_shader_config;
 
+/* Compiles the given NIR shaders into one binary.
+ *
+ * This may be called from several threads at once. All state of a
+ * compilation is owned by its aco::Program and freed when it returns. The
+ * only global state is constant tables and the ACO_DEBUG flags, which are
+ * parsed once. When the disassembly is requested (dump_shader or
+ * record_ir), the caller must have initialized LLVM with ac_init_llvm_once().
+ */
 void aco_compile_shader(unsigned shader_count,
                         struct nir_shader *const *shaders,
                         struct radv_shader_binary** binary,
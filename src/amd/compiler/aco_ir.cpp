@@ -34,6 +34,7 @@ static const struct debug_control aco_debug_options[] = {
    {"validateir", DEBUG_VALIDATE},
    {"validatera", DEBUG_VALIDATE_RA},
    {"perfwarn", DEBUG_PERFWARN},
+   {"noschedpostra", DEBUG_NO_SCHED_POST_RA},
    {NULL, 0}
 };
 
@@ -49,6 +49,7 @@ enum {
    DEBUG_VALIDATE = 0x1,
    DEBUG_VALIDATE_RA = 0x2,
    DEBUG_PERFWARN = 0x4,
+   DEBUG_NO_SCHED_POST_RA = 0x8,
 };
 
 /**
@@ -1659,6 +1660,7 @@ void register_allocation(Program *program, std::vector<TempSet>& live_out_per_bl
 void ssa_elimination(Program* program);
 void lower_to_hw_instr(Program* program);
 void schedule_program(Program* program, live& live_vars);
+void schedule_program_post_ra(Program* program);
 void spill(Program* program, live& live_vars, const struct radv_nir_compiler_options *options);
 void insert_wait_states(Program* program);
 void insert_NOPs(Program* program);
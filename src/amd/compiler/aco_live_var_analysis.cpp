@@ -84,7 +84,7 @@ RegisterDemand get_demand_before(RegisterDemand demand, aco_ptr<Instruction>& in
 
 namespace {
 void process_live_temps_per_block(Program *program, live& lives, Block* block,
-                                  std::set<unsigned>& worklist, std::vector<uint16_t>& phi_sgpr_ops)
+                                  block_worklist& worklist, std::vector<uint16_t>& phi_sgpr_ops)
 {
    std::vector<RegisterDemand>& register_demand = lives.register_demand[block->index];
    RegisterDemand new_demand;
@@ -382,19 +382,15 @@ live live_var_analysis(Program* program,
    live result;
    result.live_out.resize(program->blocks.size());
    result.register_demand.resize(program->blocks.size());
-   std::set<unsigned> worklist;
+   block_worklist worklist(program->blocks.size());
    std::vector<uint16_t> phi_sgpr_ops(program->blocks.size());
    RegisterDemand new_demand;
 
    program->needs_vcc = false;
 
    /* this implementation assumes that the block idx corresponds to the block's position in program->blocks vector */
-   for (Block& block : program->blocks)
-      worklist.insert(block.index);
-   while (!worklist.empty()) {
-      std::set<unsigned>::reverse_iterator b_it = worklist.rbegin();
-      unsigned block_idx = *b_it;
-      worklist.erase(block_idx);
+   unsigned block_idx;
+   while (worklist.pop(block_idx)) {
       process_live_temps_per_block(program, result, &program->blocks[block_idx], worklist, phi_sgpr_ops);
       new_demand.update(program->blocks[block_idx].register_demand);
    }
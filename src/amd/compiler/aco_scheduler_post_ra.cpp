@@ -0,0 +1,271 @@
+/*
+ * Copyright © 2020 Valve Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include "aco_ir.h"
+#include <algorithm>
+
+/*
+ * Post-RA list scheduler
+ *
+ * Runs after lowering to hardware instructions and before waitcnt insertion.
+ * Blocks are split into regions at instructions which can't be moved
+ * (branches, exec writes, pseudo instructions, exports, ...). Within a
+ * region, instructions are ordered by their register dependencies and
+ * memory instructions keep their relative order. The scheduler then issues
+ * the instruction which is ready first, preferring the one with the longest
+ * latency path to the end of the region. This starts memory loads early, so
+ * that independent ALU work ends up between a load and the waitcnt for its
+ * result, and puts loads next to each other so that they form clauses.
+ */
+
+/* Bounds the quadratic instruction selection. */
+#define POST_RA_MAX_REGION_SIZE 128
+
+namespace aco {
+
+namespace {
+
+struct post_ra_node {
+   std::vector<uint16_t> succs;
+   std::vector<uint16_t> succ_latencies;
+   unsigned num_preds = 0;
+   unsigned latency = 0;
+   /* the longest latency path from this instruction to the end of the region */
+   unsigned height = 0;
+   unsigned ready_cycle = 0;
+};
+
+struct post_ra_ctx {
+   Program *program;
+   std::vector<post_ra_node> nodes;
+   /* last instruction of the region writing each register, or -1 */
+   int last_write[512];
+   std::vector<uint16_t> reads[512];
+};
+
+bool is_memory_instr(const Instruction *instr)
+{
+   return instr->isVMEM() || instr->isFlatOrGlobal() ||
+          instr->format == Format::SCRATCH ||
+          instr->format == Format::SMEM ||
+          instr->format == Format::DS;
+}
+
+bool can_move_instr(const Instruction *instr)
+{
+   if (!instr->isVALU() && instr->format != Format::VINTRP &&
+       instr->format != Format::SOP1 && instr->format != Format::SOP2 &&
+       instr->format != Format::SOPC && !is_memory_instr(instr))
+      return false;
+
+   switch (instr->opcode) {
+   case aco_opcode::s_setpc_b64:
+   case aco_opcode::s_swappc_b64:
+   case aco_opcode::s_getpc_b64:
+   case aco_opcode::s_memtime:
+   case aco_opcode::s_memrealtime:
+      return false;
+   default:
+      break;
+   }
+
+   if (instr->format == Format::DS && static_cast<const DS_instruction*>(instr)->gds)
+      return false;
+
+   for (const Definition& def : instr->definitions) {
+      if (def.physReg() == exec || def.physReg() == exec_hi)
+         return false;
+   }
+   return true;
+}
+
+/* Rough number of cycles until the results of an instruction can be used. */
+unsigned get_latency(Program *program, const Instruction *instr)
+{
+   if (instr->isVMEM() || instr->isFlatOrGlobal() || instr->format == Format::SCRATCH)
+      return 320;
+   if (instr->format == Format::SMEM)
+      return 40;
+   if (instr->format == Format::DS)
+      return 64;
+   if (instr->isVALU() || instr->format == Format::VINTRP)
+      return program->wave_size == 64 && program->chip_class >= GFX10 ? 8 : 4;
+   return 2;
+}
+
+void add_edge(post_ra_ctx& ctx, int pred, unsigned succ, unsigned latency)
+{
+   if (pred < 0 || (unsigned)pred == succ)
+      return;
+
+   post_ra_node& node = ctx.nodes[pred];
+   for (unsigned i = 0; i < node.succs.size(); i++) {
+      if (node.succs[i] == succ) {
+         node.succ_latencies[i] = std::max(node.succ_latencies[i], (uint16_t)latency);
+         return;
+      }
+   }
+   node.succs.push_back(succ);
+   node.succ_latencies.push_back(latency);
+   ctx.nodes[succ].num_preds++;
+}
+
+template <typename T, typename F>
+void for_each_reg(const T& reg_op, F fn)
+{
+   unsigned first = reg_op.physReg().reg();
+   unsigned num = DIV_ROUND_UP(reg_op.physReg().byte() + reg_op.bytes(), 4);
+   for (unsigned r = first; r < std::min(first + num, 512u); r++)
+      fn(r);
+}
+
+void build_dependencies(post_ra_ctx& ctx, std::vector<aco_ptr<Instruction>>& instrs,
+                        unsigned begin, unsigned end)
+{
+   unsigned count = end - begin;
+   int last_memory = -1;
+
+   ctx.nodes.clear();
+   ctx.nodes.resize(count);
+   std::fill(std::begin(ctx.last_write), std::end(ctx.last_write), -1);
+   for (std::vector<uint16_t>& r : ctx.reads)
+      r.clear();
+
+   for (unsigned i = 0; i < count; i++) {
+      Instruction *instr = instrs[begin + i].get();
+      ctx.nodes[i].latency = get_latency(ctx.program, instr);
+
+      for (const Operand& op : instr->operands) {
+         if (op.isConstant() || op.isUndefined())
+            continue;
+         for_each_reg(op, [&](unsigned r) {
+            int writer = ctx.last_write[r];
+            if (writer >= 0)
+               add_edge(ctx, writer, i, ctx.nodes[writer].latency);
+            ctx.reads[r].push_back(i);
+         });
+      }
+
+      for (const Definition& def : instr->definitions) {
+         for_each_reg(def, [&](unsigned r) {
+            add_edge(ctx, ctx.last_write[r], i, 1);
+            for (uint16_t reader : ctx.reads[r])
+               add_edge(ctx, reader, i, 1);
+            ctx.reads[r].clear();
+            ctx.last_write[r] = i;
+         });
+      }
+
+      if (is_memory_instr(instr)) {
+         add_edge(ctx, last_memory, i, 1);
+         last_memory = i;
+      }
+   }
+
+   for (int i = count - 1; i >= 0; i--) {
+      post_ra_node& node = ctx.nodes[i];
+      for (unsigned j = 0; j < node.succs.size(); j++)
+         node.height = std::max(node.height, node.succ_latencies[j] + ctx.nodes[node.succs[j]].height);
+      node.height = std::max(node.height, node.latency);
+   }
+}
+
+void schedule_region(post_ra_ctx& ctx, std::vector<aco_ptr<Instruction>>& instrs,
+                     unsigned begin, unsigned end)
+{
+   unsigned count = end - begin;
+   if (count < 2)
+      return;
+
+   build_dependencies(ctx, instrs, begin, end);
+
+   std::vector<aco_ptr<Instruction>> old_instrs(count);
+   std::move(instrs.begin() + begin, instrs.begin() + end, old_instrs.begin());
+
+   std::vector<uint16_t> ready;
+   for (unsigned i = 0; i < count; i++) {
+      if (ctx.nodes[i].num_preds == 0)
+         ready.push_back(i);
+   }
+
+   unsigned cycle = 0;
+   for (unsigned n = 0; n < count; n++) {
+      assert(!ready.empty());
+
+      unsigned best = 0;
+      for (unsigned i = 1; i < ready.size(); i++) {
+         const post_ra_node& a = ctx.nodes[ready[i]];
+         const post_ra_node& b = ctx.nodes[ready[best]];
+         unsigned a_cycle = std::max(a.ready_cycle, cycle);
+         unsigned b_cycle = std::max(b.ready_cycle, cycle);
+         if (a_cycle != b_cycle) {
+            if (a_cycle < b_cycle)
+               best = i;
+         } else if (a.height != b.height) {
+            if (a.height > b.height)
+               best = i;
+         } else if (ready[i] < ready[best]) {
+            best = i;
+         }
+      }
+
+      unsigned idx = ready[best];
+      ready.erase(ready.begin() + best);
+
+      post_ra_node& node = ctx.nodes[idx];
+      cycle = std::max(cycle, node.ready_cycle) + 1;
+      for (unsigned j = 0; j < node.succs.size(); j++) {
+         post_ra_node& succ = ctx.nodes[node.succs[j]];
+         succ.ready_cycle = std::max(succ.ready_cycle, cycle - 1 + node.succ_latencies[j]);
+         if (--succ.num_preds == 0)
+            ready.push_back(node.succs[j]);
+      }
+
+      instrs[begin + n] = std::move(old_instrs[idx]);
+   }
+}
+
+} /* end namespace */
+
+void schedule_program_post_ra(Program *program)
+{
+   post_ra_ctx ctx;
+   ctx.program = program;
+
+   for (Block& block : program->blocks) {
+      std::vector<aco_ptr<Instruction>>& instrs = block.instructions;
+      unsigned begin = 0;
+
+      for (unsigned i = 0; i <= instrs.size(); i++) {
+         bool split = i == instrs.size() || !can_move_instr(instrs[i].get());
+         if (!split && i - begin < POST_RA_MAX_REGION_SIZE)
+            continue;
+
+         schedule_region(ctx, instrs, begin, i);
+         begin = split ? i + 1 : i;
+      }
+   }
+}
+
+}
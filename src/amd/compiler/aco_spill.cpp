@@ -144,7 +144,7 @@ int32_t get_dominator(int idx_a, int idx_b, Program* program, bool is_linear)
    return idx_a;
 }
 
-void next_uses_per_block(spill_ctx& ctx, unsigned block_idx, std::set<uint32_t>& worklist)
+void next_uses_per_block(spill_ctx& ctx, unsigned block_idx, block_worklist& worklist)
 {
    Block* block = &ctx.program->blocks[block_idx];
    std::map<Temp, std::pair<uint32_t, uint32_t>> next_uses = ctx.next_use_distances_end[block_idx];
@@ -228,14 +228,10 @@ void compute_global_next_uses(spill_ctx& ctx)
 {
    ctx.next_use_distances_start.resize(ctx.program->blocks.size());
    ctx.next_use_distances_end.resize(ctx.program->blocks.size());
-   std::set<uint32_t> worklist;
-   for (Block& block : ctx.program->blocks)
-      worklist.insert(block.index);
-
-   while (!worklist.empty()) {
-      std::set<unsigned>::reverse_iterator b_it = worklist.rbegin();
-      unsigned block_idx = *b_it;
-      worklist.erase(block_idx);
+   block_worklist worklist(ctx.program->blocks.size());
+   unsigned block_idx;
+
+   while (worklist.pop(block_idx)) {
       next_uses_per_block(ctx, block_idx, worklist);
    }
 }
@@ -27,6 +27,7 @@
 
 #include <cassert>
 #include <iterator>
+#include <vector>
 
 namespace aco {
 
@@ -228,6 +229,49 @@ private:
    size_type length{ 0 };     //!> Size of the span
 };
 
+/*! \brief      Worklist of block indices, popped from the highest index
+*
+*   \details    Backwards dataflow passes visit blocks in reverse order and
+*               re-add predecessors whose state changed. This replaces a
+*               std::set<unsigned> with a bit per block and an upper bound,
+*               which avoids a node allocation per insertion.
+*/
+class block_worklist {
+public:
+   /*! \brief                 Constructs a worklist holding all blocks
+   *   \param[in]   num_blocks The number of blocks of the program
+   */
+   explicit block_worklist(unsigned num_blocks)
+       : pending(num_blocks, true), end{ num_blocks } {}
+
+   /*! \brief                 Adds a block if it isn't already pending
+   */
+   void insert(unsigned block_idx) {
+      pending[block_idx] = true;
+      if (block_idx >= end)
+         end = block_idx + 1;
+   }
+
+   /*! \brief                 Removes the highest pending block
+   *   \param[out]  block_idx The removed block
+   *   \return                false if the worklist was empty
+   */
+   bool pop(unsigned& block_idx) {
+      while (end) {
+         if (pending[--end]) {
+            pending[end] = false;
+            block_idx = end;
+            return true;
+         }
+      }
+      return false;
+   }
+
+private:
+   std::vector<bool> pending; //!> Whether each block is in the worklist
+   unsigned end;              //!> No block at or above this index is pending
+};
+
 } // namespace aco
 
 #endif // ACO_UTIL_H
@@ -90,5 +90,10 @@
 /* Number of invocations in each subgroup. */
 #define RADV_SUBGROUP_SIZE 64
 
+/* Shaders are placed in slabs at this alignment. */
+#define RADV_SHADER_ALLOC_ALIGNMENT 256
+#define RADV_SHADER_ALLOC_MIN_SLAB_SIZE (256 * 1024)
+#define RADV_SHADER_ALLOC_NUM_FREE_LISTS 32
+
 #endif /* RADV_CONSTANTS_H */
 
@@ -56,6 +56,7 @@ enum {
 	RADV_DEBUG_NO_MEMORY_CACHE   = 1 << 25,
 	RADV_DEBUG_DISCARD_TO_DEMOTE = 1 << 26,
 	RADV_DEBUG_LLVM              = 1 << 27,
+	RADV_DEBUG_NO_PIPELINE_THREADS = 1 << 28,
 };
 
 enum {
@@ -67,6 +68,7 @@ enum {
 	RADV_PERFTEST_PS_WAVE_32      = 1 << 5,
 	RADV_PERFTEST_GE_WAVE_32      = 1 << 6,
 	RADV_PERFTEST_DFSM            = 1 << 7,
+	RADV_PERFTEST_RESIDENT_BOS    = 1 << 8,
 };
 
 bool
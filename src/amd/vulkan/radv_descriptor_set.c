@@ -1229,8 +1229,6 @@ VkResult radv_CreateDescriptorUpdateTemplate(VkDevice _device,
 	vk_object_base_init(&device->vk, &templ->base,
 			    VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE);
 
-	templ->entry_count = entry_count;
-
 	if (pCreateInfo->templateType == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR) {
 		RADV_FROM_HANDLE(radv_pipeline_layout, pipeline_layout, pCreateInfo->pipelineLayout);
 
@@ -1243,15 +1241,21 @@ VkResult radv_CreateDescriptorUpdateTemplate(VkDevice _device,
 		templ->bind_point = pCreateInfo->pipelineBindPoint;
 	}
 
+	templ->entry_count = 0;
 	for (i = 0; i < entry_count; i++) {
 		const VkDescriptorUpdateTemplateEntry *entry = &pCreateInfo->pDescriptorUpdateEntries[i];
 		const struct radv_descriptor_set_binding_layout *binding_layout =
 			set_layout->binding + entry->dstBinding;
 		const uint32_t buffer_offset = binding_layout->buffer_offset + entry->dstArrayElement;
 		const uint32_t *immutable_samplers = NULL;
+		const bool has_sampler = !binding_layout->immutable_samplers_offset;
+		enum radv_descriptor_update_op op;
 		uint32_t dst_offset;
 		uint32_t dst_stride;
 
+		if (!entry->descriptorCount)
+			continue;
+
 		/* dst_offset is an offset into dynamic_descriptors when the descriptor
 		   is dynamic, and an offset into mapped_ptr otherwise */
 		switch (entry->descriptorType) {
@@ -1284,15 +1288,52 @@ VkResult radv_CreateDescriptorUpdateTemplate(VkDevice _device,
 			break;
 		}
 
-		templ->entry[i] = (struct radv_descriptor_update_template_entry) {
+		switch (entry->descriptorType) {
+		case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT:
+			op = RADV_DESCRIPTOR_UPDATE_OP_INLINE_BLOCK;
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			op = RADV_DESCRIPTOR_UPDATE_OP_DYNAMIC_BUFFER;
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			op = RADV_DESCRIPTOR_UPDATE_OP_BUFFER;
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			op = RADV_DESCRIPTOR_UPDATE_OP_TEXEL_BUFFER;
+			break;
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+			op = RADV_DESCRIPTOR_UPDATE_OP_IMAGE;
+			break;
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			op = RADV_DESCRIPTOR_UPDATE_OP_COMBINED_IMAGE_SAMPLER;
+			break;
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+			if (has_sampler)
+				op = RADV_DESCRIPTOR_UPDATE_OP_SAMPLER;
+			else if (immutable_samplers)
+				op = RADV_DESCRIPTOR_UPDATE_OP_IMMUTABLE_SAMPLER;
+			else
+				continue; /* Immutable samplers are already in the set. */
+			break;
+		default:
+			continue;
+		}
+
+		templ->entry[templ->entry_count++] = (struct radv_descriptor_update_template_entry) {
 			.descriptor_type = entry->descriptorType,
+			.op = op,
 			.descriptor_count = entry->descriptorCount,
 			.src_offset = entry->offset,
 			.src_stride = entry->stride,
 			.dst_offset = dst_offset,
 			.dst_stride = dst_stride,
 			.buffer_offset = buffer_offset,
-			.has_sampler = !binding_layout->immutable_samplers_offset,
+			.has_sampler = has_sampler,
 			.sampler_offset = radv_combined_image_descriptor_sampler_offset(binding_layout),
 			.immutable_samplers = immutable_samplers
 		};
@@ -1323,68 +1364,80 @@ void radv_update_descriptor_set_with_template(struct radv_device *device,
                                               const void *pData)
 {
 	RADV_FROM_HANDLE(radv_descriptor_update_template, templ, descriptorUpdateTemplate);
-	uint32_t i;
 
-	for (i = 0; i < templ->entry_count; ++i) {
-		struct radeon_winsys_bo **buffer_list = set->descriptors + templ->entry[i].buffer_offset;
-		uint32_t *pDst = set->mapped_ptr + templ->entry[i].dst_offset;
-		const uint8_t *pSrc = ((const uint8_t *) pData) + templ->entry[i].src_offset;
+	/* The descriptor type was resolved into an op when the template was
+	 * created, so only the entries need a switch, not every descriptor.
+	 */
+	for (uint32_t i = 0; i < templ->entry_count; ++i) {
+		const struct radv_descriptor_update_template_entry *entry = &templ->entry[i];
+		struct radeon_winsys_bo **buffer_list = set->descriptors + entry->buffer_offset;
+		uint32_t *pDst = set->mapped_ptr + entry->dst_offset;
+		const uint8_t *pSrc = ((const uint8_t *) pData) + entry->src_offset;
+		const uint32_t count = entry->descriptor_count;
 		uint32_t j;
 
-		if (templ->entry[i].descriptor_type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT) {
-			memcpy((uint8_t*)pDst, pSrc, templ->entry[i].descriptor_count);
-			continue;
-		}
+		switch (entry->op) {
+		case RADV_DESCRIPTOR_UPDATE_OP_INLINE_BLOCK:
+			memcpy((uint8_t*)pDst, pSrc, count);
+			break;
+		case RADV_DESCRIPTOR_UPDATE_OP_DYNAMIC_BUFFER: {
+			struct radv_descriptor_range *range = set->dynamic_descriptors + entry->dst_offset;
 
-		for (j = 0; j < templ->entry[i].descriptor_count; ++j) {
-			switch (templ->entry[i].descriptor_type) {
-			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
-			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC: {
-				const unsigned idx = templ->entry[i].dst_offset + j;
-				assert(!(set->layout->flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR));
-				write_dynamic_buffer_descriptor(device, set->dynamic_descriptors + idx,
-								buffer_list, (struct VkDescriptorBufferInfo *) pSrc);
-				break;
+			assert(!(set->layout->flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR));
+			for (j = 0; j < count; ++j, pSrc += entry->src_stride) {
+				write_dynamic_buffer_descriptor(device, range + j, buffer_list + j,
+								(const VkDescriptorBufferInfo *) pSrc);
 			}
-			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-				write_buffer_descriptor(device, cmd_buffer, pDst, buffer_list,
-				                        (struct VkDescriptorBufferInfo *) pSrc);
-				break;
-			case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
-			case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-				write_texel_buffer_descriptor(device, cmd_buffer, pDst, buffer_list,
-						              *(VkBufferView *) pSrc);
-				break;
-			case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-			case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-				write_image_descriptor(device, cmd_buffer, 64, pDst, buffer_list,
-						       templ->entry[i].descriptor_type,
-					               (struct VkDescriptorImageInfo *) pSrc);
-				break;
-			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-				write_combined_image_sampler_descriptor(device, cmd_buffer, templ->entry[i].sampler_offset,
-									pDst, buffer_list, templ->entry[i].descriptor_type,
-									(struct VkDescriptorImageInfo *) pSrc,
-									templ->entry[i].has_sampler);
-				if (templ->entry[i].immutable_samplers) {
-					memcpy((char*)pDst + templ->entry[i].sampler_offset, templ->entry[i].immutable_samplers + 4 * j, 16);
+			break;
+		}
+		case RADV_DESCRIPTOR_UPDATE_OP_BUFFER:
+			for (j = 0; j < count; ++j, pSrc += entry->src_stride, pDst += entry->dst_stride) {
+				write_buffer_descriptor(device, cmd_buffer, pDst, buffer_list + j,
+				                        (const VkDescriptorBufferInfo *) pSrc);
+			}
+			break;
+		case RADV_DESCRIPTOR_UPDATE_OP_TEXEL_BUFFER:
+			for (j = 0; j < count; ++j, pSrc += entry->src_stride, pDst += entry->dst_stride) {
+				write_texel_buffer_descriptor(device, cmd_buffer, pDst, buffer_list + j,
+				                              *(const VkBufferView *) pSrc);
+			}
+			break;
+		case RADV_DESCRIPTOR_UPDATE_OP_IMAGE:
+			for (j = 0; j < count; ++j, pSrc += entry->src_stride, pDst += entry->dst_stride) {
+				write_image_descriptor(device, cmd_buffer, 64, pDst, buffer_list + j,
+				                       entry->descriptor_type,
+				                       (const VkDescriptorImageInfo *) pSrc);
+			}
+			break;
+		case RADV_DESCRIPTOR_UPDATE_OP_COMBINED_IMAGE_SAMPLER:
+			for (j = 0; j < count; ++j, pSrc += entry->src_stride, pDst += entry->dst_stride) {
+				write_combined_image_sampler_descriptor(device, cmd_buffer, entry->sampler_offset,
+									pDst, buffer_list + j, entry->descriptor_type,
+									(const VkDescriptorImageInfo *) pSrc,
+									entry->has_sampler);
+				if (entry->immutable_samplers) {
+					memcpy((char*)pDst + entry->sampler_offset, entry->immutable_samplers + 4 * j, 16);
 				}
-				break;
-			case VK_DESCRIPTOR_TYPE_SAMPLER:
-				if (templ->entry[i].has_sampler)
-					write_sampler_descriptor(device, pDst,
-					                         (struct VkDescriptorImageInfo *) pSrc);
-				else if (templ->entry[i].immutable_samplers)
-					memcpy(pDst, templ->entry[i].immutable_samplers + 4 * j, 16);
-				break;
-			default:
-				break;
 			}
-		        pSrc += templ->entry[i].src_stride;
-			pDst += templ->entry[i].dst_stride;
-			++buffer_list;
+			break;
+		case RADV_DESCRIPTOR_UPDATE_OP_SAMPLER:
+			for (j = 0; j < count; ++j, pSrc += entry->src_stride, pDst += entry->dst_stride) {
+				write_sampler_descriptor(device, pDst,
+				                         (const VkDescriptorImageInfo *) pSrc);
+			}
+			break;
+		case RADV_DESCRIPTOR_UPDATE_OP_IMMUTABLE_SAMPLER:
+			/* Pushed immutable samplers are consecutive in both the
+			 * layout and the push set, so copy them all at once when
+			 * the binding holds nothing but the sampler.
+			 */
+			if (entry->dst_stride == 4) {
+				memcpy(pDst, entry->immutable_samplers, 16 * count);
+			} else {
+				for (j = 0; j < count; ++j, pDst += entry->dst_stride)
+					memcpy(pDst, entry->immutable_samplers + 4 * j, 16);
+			}
+			break;
 		}
 	}
 }
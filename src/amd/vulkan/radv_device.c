@@ -53,6 +53,7 @@
 #include "util/mesa-sha1.h"
 #include "util/timespec.h"
 #include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "compiler/glsl_types.h"
 #include "util/driconf.h"
 
@@ -513,6 +514,7 @@ static const struct debug_control radv_debug_options[] = {
 	{"metashaders", RADV_DEBUG_DUMP_META_SHADERS},
 	{"nomemorycache", RADV_DEBUG_NO_MEMORY_CACHE},
 	{"llvm", RADV_DEBUG_LLVM},
+	{"nopipelinethreads", RADV_DEBUG_NO_PIPELINE_THREADS},
 	{NULL, 0}
 };
 
@@ -532,6 +534,7 @@ static const struct debug_control radv_perftest_options[] = {
 	{"pswave32", RADV_PERFTEST_PS_WAVE_32},
 	{"gewave32", RADV_PERFTEST_GE_WAVE_32},
 	{"dfsm", RADV_PERFTEST_DFSM},
+	{"residentbos", RADV_PERFTEST_RESIDENT_BOS},
 	{NULL, 0}
 };
 
@@ -601,6 +604,8 @@ DRI_CONF_BEGIN
 		DRI_CONF_VK_X11_OVERRIDE_MIN_IMAGE_COUNT(0)
 		DRI_CONF_VK_X11_STRICT_IMAGE_COUNT("false")
 		DRI_CONF_VK_X11_ENSURE_MIN_IMAGE_COUNT("false")
+		DRI_CONF_VK_X11_MAX_FRAME_LATENCY(0)
+		DRI_CONF_VK_X11_PRIME_DIRECT("false")
 		DRI_CONF_RADV_REPORT_LLVM9_VERSION_STRING("false")
 		DRI_CONF_RADV_ENABLE_MRT_OUTPUT_NAN_FIXUP("false")
 		DRI_CONF_RADV_NO_DYNAMIC_BOUNDS("false")
@@ -2674,8 +2679,7 @@ VkResult radv_CreateDevice(
 
 	device->robust_buffer_access = robust_buffer_access;
 
-	mtx_init(&device->shader_slab_mutex, mtx_plain);
-	list_inithead(&device->shader_slabs);
+	radv_init_shader_slabs(device);
 
 	device->overallocation_disallowed = overallocation_disallowed;
 	mtx_init(&device->overallocation_mutex, mtx_plain);
@@ -2844,6 +2848,17 @@ VkResult radv_CreateDevice(
 	if (result != VK_SUCCESS)
 		goto fail_mem_cache;
 
+	util_cpu_detect();
+	if (util_cpu_caps.nr_cpus > 1 &&
+	    !(device->instance->debug_flags & RADV_DEBUG_NO_PIPELINE_THREADS)) {
+		/* The pipeline queue is only an optimization, so failing to
+		 * create it isn't fatal.
+		 */
+		util_queue_init(&device->pipeline_compile_queue, "radv_pipe", 64,
+				MIN2(util_cpu_caps.nr_cpus, 16) - 1,
+				UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+	}
+
 	device->force_aniso =
 		MIN2(16, radv_get_int_debug_option("RADV_TEX_ANISO", -1));
 	if (device->force_aniso >= 0) {
@@ -2912,8 +2927,13 @@ void radv_DestroyDevice(
 	VkPipelineCache pc = radv_pipeline_cache_to_handle(device->mem_cache);
 	radv_DestroyPipelineCache(radv_device_to_handle(device), pc, NULL);
 
+	if (device->instance->debug_flags & RADV_DEBUG_DUMP_SHADER_STATS)
+		radv_dump_shader_slab_stats(device, stderr);
 	radv_destroy_shader_slabs(device);
 
+	if (util_queue_is_initialized(&device->pipeline_compile_queue))
+		util_queue_destroy(&device->pipeline_compile_queue);
+
 	pthread_cond_destroy(&device->timeline_cond);
 	radv_bo_list_finish(&device->bo_list);
 
@@ -7292,14 +7312,11 @@ VkResult radv_CreateSampler(
 
 	assert(pCreateInfo->sType == VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO);
 
-	sampler = vk_alloc2(&device->vk.alloc, pAllocator, sizeof(*sampler), 8,
-			      VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+	sampler = vk_object_alloc(&device->vk, pAllocator, sizeof(*sampler),
+				  VK_OBJECT_TYPE_SAMPLER);
 	if (!sampler)
 		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
 
-	vk_object_base_init(&device->vk, &sampler->base,
-			    VK_OBJECT_TYPE_SAMPLER);
-
 	radv_init_sampler(device, sampler, pCreateInfo);
 
 	sampler->ycbcr_sampler = ycbcr_conversion ? radv_sampler_ycbcr_conversion_from_handle(ycbcr_conversion->conversion): NULL;
@@ -7322,8 +7339,7 @@ void radv_DestroySampler(
 	if (sampler->border_color_slot != RADV_BORDER_COLOR_COUNT)
 		radv_unregister_border_color(device, sampler->border_color_slot);
 
-	vk_object_base_finish(&sampler->base);
-	vk_free2(&device->vk.alloc, pAllocator, sampler);
+	vk_object_free(&device->vk, pAllocator, sampler);
 }
 
 /* vk_icd.h does not declare this function, so we declare it here to
@@ -1878,14 +1878,11 @@ radv_CreateImageView(VkDevice _device,
 	RADV_FROM_HANDLE(radv_device, device, _device);
 	struct radv_image_view *view;
 
-	view = vk_alloc2(&device->vk.alloc, pAllocator, sizeof(*view), 8,
-			   VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+	view = vk_object_alloc(&device->vk, pAllocator, sizeof(*view),
+			       VK_OBJECT_TYPE_IMAGE_VIEW);
 	if (view == NULL)
 		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
 
-	vk_object_base_init(&device->vk, &view->base,
-			    VK_OBJECT_TYPE_IMAGE_VIEW);
-
 	radv_image_view_init(view, device, pCreateInfo, NULL);
 
 	*pView = radv_image_view_to_handle(view);
@@ -1903,8 +1900,7 @@ radv_DestroyImageView(VkDevice _device, VkImageView _iview,
 	if (!iview)
 		return;
 
-	vk_object_base_finish(&iview->base);
-	vk_free2(&device->vk.alloc, pAllocator, iview);
+	vk_object_free(&device->vk, pAllocator, iview);
 }
 
 void radv_buffer_view_init(struct radv_buffer_view *view,
@@ -1931,14 +1927,11 @@ radv_CreateBufferView(VkDevice _device,
 	RADV_FROM_HANDLE(radv_device, device, _device);
 	struct radv_buffer_view *view;
 
-	view = vk_alloc2(&device->vk.alloc, pAllocator, sizeof(*view), 8,
-			   VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+	view = vk_object_alloc(&device->vk, pAllocator, sizeof(*view),
+			       VK_OBJECT_TYPE_BUFFER_VIEW);
 	if (!view)
 		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
 
-	vk_object_base_init(&device->vk, &view->base,
-			    VK_OBJECT_TYPE_BUFFER_VIEW);
-
 	radv_buffer_view_init(view, device, pCreateInfo);
 
 	*pView = radv_buffer_view_to_handle(view);
@@ -1956,6 +1949,5 @@ radv_DestroyBufferView(VkDevice _device, VkBufferView bufferView,
 	if (!view)
 		return;
 
-	vk_object_base_finish(&view->base);
-	vk_free2(&device->vk.alloc, pAllocator, view);
+	vk_object_free(&device->vk, pAllocator, view);
 }
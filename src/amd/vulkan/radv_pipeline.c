@@ -4997,6 +4997,107 @@ radv_graphics_pipeline_create(
 	return VK_SUCCESS;
 }
 
+struct radv_pipeline_create_job {
+	VkDevice device;
+	VkPipelineCache cache;
+	const VkGraphicsPipelineCreateInfo *graphics_info;
+	const VkComputePipelineCreateInfo *compute_info;
+	const VkAllocationCallbacks *alloc;
+	VkPipeline *pipeline;
+	VkResult result;
+	struct util_queue_fence fence;
+};
+
+static VkResult
+radv_compute_pipeline_create(VkDevice _device,
+			     VkPipelineCache _cache,
+			     const VkComputePipelineCreateInfo* pCreateInfo,
+			     const VkAllocationCallbacks* pAllocator,
+			     VkPipeline* pPipeline);
+
+static void
+radv_pipeline_create_job_execute(void *data, int thread_index)
+{
+	struct radv_pipeline_create_job *job = data;
+
+	if (job->graphics_info) {
+		job->result = radv_graphics_pipeline_create(job->device, job->cache,
+							    job->graphics_info, NULL,
+							    job->alloc, job->pipeline);
+	} else {
+		job->result = radv_compute_pipeline_create(job->device, job->cache,
+							   job->compute_info,
+							   job->alloc, job->pipeline);
+	}
+}
+
+/* Whether the pipelines of one vkCreate*Pipelines call can be created in
+ * parallel. Pipelines that ask for an early return on failure are created
+ * in order so that the ones after the failing pipeline are never built.
+ */
+static bool
+radv_use_pipeline_threads(struct radv_device *device, uint32_t count,
+			  bool early_return)
+{
+	return count > 1 && !early_return &&
+	       util_queue_is_initialized(&device->pipeline_compile_queue);
+}
+
+/* Create all pipelines on the device's pipeline queue. The calling thread
+ * builds the first one while the queue threads build the others. Returns
+ * false if the jobs couldn't be allocated.
+ */
+static bool
+radv_create_pipelines_threaded(struct radv_device *device,
+			       VkPipelineCache cache, uint32_t count,
+			       const VkGraphicsPipelineCreateInfo *graphics_infos,
+			       const VkComputePipelineCreateInfo *compute_infos,
+			       const VkAllocationCallbacks *pAllocator,
+			       VkPipeline *pPipelines,
+			       VkResult *result)
+{
+	struct radv_pipeline_create_job *jobs;
+
+	jobs = vk_zalloc(&device->vk.alloc, sizeof(*jobs) * count, 8,
+			 VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+	if (!jobs)
+		return false;
+
+	for (unsigned i = 0; i < count; i++) {
+		struct radv_pipeline_create_job *job = &jobs[i];
+
+		job->device = radv_device_to_handle(device);
+		job->cache = cache;
+		job->graphics_info = graphics_infos ? &graphics_infos[i] : NULL;
+		job->compute_info = compute_infos ? &compute_infos[i] : NULL;
+		job->alloc = pAllocator;
+		job->pipeline = &pPipelines[i];
+		util_queue_fence_init(&job->fence);
+
+		if (i > 0) {
+			util_queue_add_job(&device->pipeline_compile_queue, job,
+					   &job->fence,
+					   radv_pipeline_create_job_execute,
+					   NULL, 0);
+		}
+	}
+
+	radv_pipeline_create_job_execute(&jobs[0], 0);
+
+	for (unsigned i = 0; i < count; i++) {
+		util_queue_fence_wait(&jobs[i].fence);
+		util_queue_fence_destroy(&jobs[i].fence);
+
+		if (jobs[i].result != VK_SUCCESS) {
+			*result = jobs[i].result;
+			pPipelines[i] = VK_NULL_HANDLE;
+		}
+	}
+
+	vk_free(&device->vk.alloc, jobs);
+	return true;
+}
+
 VkResult radv_CreateGraphicsPipelines(
 	VkDevice                                    _device,
 	VkPipelineCache                             pipelineCache,
@@ -5005,9 +5106,20 @@ VkResult radv_CreateGraphicsPipelines(
 	const VkAllocationCallbacks*                pAllocator,
 	VkPipeline*                                 pPipelines)
 {
+	RADV_FROM_HANDLE(radv_device, device, _device);
 	VkResult result = VK_SUCCESS;
+	bool early_return = false;
 	unsigned i = 0;
 
+	for (unsigned j = 0; j < count; j++)
+		early_return |= !!(pCreateInfos[j].flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT);
+
+	if (radv_use_pipeline_threads(device, count, early_return) &&
+	    radv_create_pipelines_threaded(device, pipelineCache, count,
+					   pCreateInfos, NULL, pAllocator,
+					   pPipelines, &result))
+		return result;
+
 	for (; i < count; i++) {
 		VkResult r;
 		r = radv_graphics_pipeline_create(_device,
@@ -5188,7 +5300,18 @@ VkResult radv_CreateComputePipelines(
 	const VkAllocationCallbacks*                pAllocator,
 	VkPipeline*                                 pPipelines)
 {
+	RADV_FROM_HANDLE(radv_device, device, _device);
 	VkResult result = VK_SUCCESS;
+	bool early_return = false;
+
+	for (unsigned j = 0; j < count; j++)
+		early_return |= !!(pCreateInfos[j].flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT);
+
+	if (radv_use_pipeline_threads(device, count, early_return) &&
+	    radv_create_pipelines_threaded(device, pipelineCache, count,
+					   NULL, pCreateInfos, pAllocator,
+					   pPipelines, &result))
+		return result;
 
 	unsigned i = 0;
 	for (; i < count; i++) {
@@ -5450,7 +5573,7 @@ VkResult radv_GetPipelineExecutableStatisticsKHR(
 
 	if (shader->statistics) {
 		for (unsigned i = 0; i < shader->statistics->count; i++) {
-			struct radv_compiler_statistic_info *info = &shader->statistics->infos[i];
+			const struct radv_compiler_statistic_info *info = &shader->statistics->infos[i];
 			uint32_t value = shader->statistics->values[i];
 			if (s < end) {
 				desc_copy(s->name, info->name);
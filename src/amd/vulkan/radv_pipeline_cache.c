@@ -69,6 +69,8 @@ radv_pipeline_cache_init(struct radv_pipeline_cache *cache,
 	cache->flags = 0;
 
 	cache->modified = false;
+	cache->data = NULL;
+	cache->data_size = 0;
 	cache->kernel_count = 0;
 	cache->total_size = 0;
 	cache->table_size = 1024;
@@ -85,6 +87,23 @@ radv_pipeline_cache_init(struct radv_pipeline_cache *cache,
 		memset(cache->hash_table, 0, byte_size);
 }
 
+static bool
+radv_pipeline_cache_owns_entry(const struct radv_pipeline_cache *cache,
+			       const struct cache_entry *entry)
+{
+	return (const char *)entry >= cache->data &&
+	       (const char *)entry < cache->data + cache->data_size;
+}
+
+static void
+radv_pipeline_cache_free_entry(struct radv_pipeline_cache *cache,
+			       struct cache_entry *entry)
+{
+	/* Loaded entries are freed all at once with the cache. */
+	if (!radv_pipeline_cache_owns_entry(cache, entry))
+		vk_free(&cache->alloc, entry);
+}
+
 void
 radv_pipeline_cache_finish(struct radv_pipeline_cache *cache)
 {
@@ -95,14 +114,15 @@ radv_pipeline_cache_finish(struct radv_pipeline_cache *cache)
 					radv_shader_variant_destroy(cache->device,
 								    cache->hash_table[i]->variants[j]);
 			}
-			vk_free(&cache->alloc, cache->hash_table[i]);
+			radv_pipeline_cache_free_entry(cache, cache->hash_table[i]);
 		}
 	pthread_mutex_destroy(&cache->mutex);
 	free(cache->hash_table);
+	vk_free(&cache->alloc, cache->data);
 }
 
 static uint32_t
-entry_size(struct cache_entry *entry)
+entry_size(const struct cache_entry *entry)
 {
 	size_t ret = sizeof(*entry);
 	for (int i = 0; i < MESA_SHADER_STAGES; ++i)
@@ -209,9 +229,9 @@ radv_pipeline_cache_set_entry(struct radv_pipeline_cache *cache,
 
 
 static VkResult
-radv_pipeline_cache_grow(struct radv_pipeline_cache *cache)
+radv_pipeline_cache_resize(struct radv_pipeline_cache *cache,
+			   uint32_t table_size)
 {
-	const uint32_t table_size = cache->table_size * 2;
 	const uint32_t old_table_size = cache->table_size;
 	const size_t byte_size = table_size * sizeof(cache->hash_table[0]);
 	struct cache_entry **table;
@@ -240,6 +260,12 @@ radv_pipeline_cache_grow(struct radv_pipeline_cache *cache)
 	return VK_SUCCESS;
 }
 
+static VkResult
+radv_pipeline_cache_grow(struct radv_pipeline_cache *cache)
+{
+	return radv_pipeline_cache_resize(cache, cache->table_size * 2);
+}
+
 static void
 radv_pipeline_cache_add_entry(struct radv_pipeline_cache *cache,
 			      struct cache_entry *entry)
@@ -296,24 +322,34 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 		disk_cache_compute_key(device->physical_device->disk_cache,
 				       sha1, 20, disk_sha1);
 
-		entry = (struct cache_entry *)
-			disk_cache_get(device->physical_device->disk_cache,
-				       disk_sha1, NULL);
-		if (!entry) {
+		/* Entries are stored uncompressed, so this reads them
+		 * straight from the page cache.
+		 */
+		struct disk_cache_entry disk_entry;
+		if (!disk_cache_get_entry(device->physical_device->disk_cache,
+					  disk_sha1, &disk_entry)) {
 			radv_pipeline_cache_unlock(cache);
 			return false;
 		} else {
-			size_t size = entry_size(entry);
+			const struct cache_entry *disk_cache_entry = disk_entry.data;
+			if (disk_entry.size < sizeof(*disk_cache_entry) ||
+			    disk_entry.size != entry_size(disk_cache_entry)) {
+				disk_cache_entry_release(&disk_entry);
+				radv_pipeline_cache_unlock(cache);
+				return false;
+			}
+
+			size_t size = disk_entry.size;
 			struct cache_entry *new_entry = vk_alloc(&cache->alloc, size, 8,
 								 VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
 			if (!new_entry) {
-				free(entry);
+				disk_cache_entry_release(&disk_entry);
 				radv_pipeline_cache_unlock(cache);
 				return false;
 			}
 
-			memcpy(new_entry, entry, entry_size(entry));
-			free(entry);
+			memcpy(new_entry, disk_cache_entry, size);
+			disk_cache_entry_release(&disk_entry);
 			entry = new_entry;
 
 			if (!(device->instance->debug_flags & RADV_DEBUG_NO_MEMORY_CACHE) ||
@@ -424,8 +460,9 @@ radv_pipeline_cache_insert_shaders(struct radv_device *device,
 		disk_cache_compute_key(device->physical_device->disk_cache, sha1, 20,
 			       disk_sha1);
 
-		disk_cache_put(device->physical_device->disk_cache, disk_sha1,
-			       entry, entry_size(entry), NULL);
+		disk_cache_put_uncompressed(device->physical_device->disk_cache,
+					    disk_sha1, entry, entry_size(entry),
+					    NULL);
 	}
 
 	if (device->instance->debug_flags & RADV_DEBUG_NO_MEMORY_CACHE &&
@@ -458,40 +495,65 @@ radv_pipeline_cache_load(struct radv_pipeline_cache *cache,
 			 const void *data, size_t size)
 {
 	struct radv_device *device = cache->device;
-	struct vk_pipeline_cache_header header;
 
-	if (size < sizeof(header))
-		return false;
-	memcpy(&header, data, sizeof(header));
-	if (header.header_size < sizeof(header))
+	size_t header_size =
+		vk_pipeline_cache_header_check(data, size, ATI_VENDOR_ID,
+					       device->physical_device->rad_info.pci_id,
+					       device->physical_device->cache_uuid);
+	if (header_size == 0)
 		return false;
-	if (header.header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
-		return false;
-	if (header.vendor_id != ATI_VENDOR_ID)
+
+	/* Loading happens once, before the cache has any other entry. */
+	if (cache->data || cache->kernel_count || !cache->table_size)
 		return false;
-	if (header.device_id != device->physical_device->rad_info.pci_id)
+
+	const char *end = (const char *) data + size;
+	const char *start = (const char *) data + header_size;
+	const char *p;
+	uint32_t num_entries = 0;
+	size_t data_size = 0;
+
+	/* Count the entries first, so that they can all be stored in one
+	 * allocation and the hash table only needs to be resized once.
+	 */
+	for (p = start; end - p >= sizeof(struct cache_entry); ) {
+		size_t size = entry_size((const struct cache_entry *)p);
+		if (end - p < size)
+			break;
+
+		data_size += align_u64(size, 8);
+		num_entries++;
+		p += size;
+	}
+
+	if (!num_entries)
+		return true;
+
+	uint32_t table_size = cache->table_size;
+	while (num_entries >= table_size / 2)
+		table_size *= 2;
+
+	if (table_size != cache->table_size &&
+	    radv_pipeline_cache_resize(cache, table_size) != VK_SUCCESS)
 		return false;
-	if (memcmp(header.uuid, device->physical_device->cache_uuid, VK_UUID_SIZE) != 0)
+
+	cache->data = vk_alloc(&cache->alloc, data_size, 8,
+			       VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
+	if (!cache->data)
 		return false;
+	cache->data_size = data_size;
 
-	char *end = (void *) data + size;
-	char *p = (void *) data + header.header_size;
+	char *dst = cache->data;
+	for (p = start; num_entries--; ) {
+		struct cache_entry *entry = (struct cache_entry *)dst;
+		size_t size = entry_size((const struct cache_entry *)p);
 
-	while (end - p >= sizeof(struct cache_entry)) {
-		struct cache_entry *entry = (struct cache_entry*)p;
-		struct cache_entry *dest_entry;
-		size_t size = entry_size(entry);
-		if(end - p < size)
-			break;
+		memcpy(entry, p, size);
+		for (int i = 0; i < MESA_SHADER_STAGES; ++i)
+			entry->variants[i] = NULL;
+		radv_pipeline_cache_set_entry(cache, entry);
 
-		dest_entry = vk_alloc(&cache->alloc, size,
-					8, VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
-		if (dest_entry) {
-			memcpy(dest_entry, entry, size);
-			for (int i = 0; i < MESA_SHADER_STAGES; ++i)
-				dest_entry->variants[i] = NULL;
-			radv_pipeline_cache_add_entry(cache, dest_entry);
-		}
+		dst += align_u64(size, 8);
 		p += size;
 	}
 
@@ -580,11 +642,9 @@ VkResult radv_GetPipelineCacheData(
 	}
 	void *p = pData, *end = pData + *pDataSize;
 	header = p;
-	header->header_size = sizeof(*header);
-	header->header_version = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
-	header->vendor_id = ATI_VENDOR_ID;
-	header->device_id = device->physical_device->rad_info.pci_id;
-	memcpy(header->uuid, device->physical_device->cache_uuid, VK_UUID_SIZE);
+	vk_pipeline_cache_header_init(header, ATI_VENDOR_ID,
+				      device->physical_device->rad_info.pci_id,
+				      device->physical_device->cache_uuid);
 	p += header->header_size;
 
 	struct cache_entry *entry;
@@ -618,7 +678,22 @@ radv_pipeline_cache_merge(struct radv_pipeline_cache *dst,
 		if (!entry || radv_pipeline_cache_search(dst, entry->sha1))
 			continue;
 
-		radv_pipeline_cache_add_entry(dst, entry);
+		/* Entries loaded into src go away with it, so dst needs its
+		 * own copy.
+		 */
+		if (radv_pipeline_cache_owns_entry(src, entry)) {
+			size_t size = entry_size(entry);
+			struct cache_entry *copy =
+				vk_alloc(&dst->alloc, size, 8,
+					 VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
+			if (!copy)
+				continue;
+
+			memcpy(copy, entry, size);
+			radv_pipeline_cache_add_entry(dst, copy);
+		} else {
+			radv_pipeline_cache_add_entry(dst, entry);
+		}
 
 		src->hash_table[i] = NULL;
 	}
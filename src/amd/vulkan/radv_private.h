@@ -48,6 +48,7 @@
 #include "compiler/shader_enums.h"
 #include "util/macros.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "util/xmlconfig.h"
 #include "vk_alloc.h"
 #include "vk_debug_report.h"
@@ -369,6 +370,10 @@ struct radv_pipeline_cache {
 	struct cache_entry **                        hash_table;
 	bool                                         modified;
 
+	/* Entries loaded from the initial data live in one allocation. */
+	char *                                       data;
+	size_t                                       data_size;
+
 	VkAllocationCallbacks                        alloc;
 };
 
@@ -802,6 +807,12 @@ struct radv_device {
 	struct list_head shader_slabs;
 	mtx_t shader_slab_mutex;
 
+	/* Free blocks of the shader slabs, by log2 of their size in
+	 * RADV_SHADER_ALLOC_ALIGNMENT units, and the mask of non-empty lists.
+	 */
+	struct list_head shader_free_lists[RADV_SHADER_ALLOC_NUM_FREE_LISTS];
+	uint32_t shader_free_list_mask;
+
 	/* For detecting VM faults reported by dmesg. */
 	uint64_t dmesg_timestamp;
 
@@ -825,6 +836,11 @@ struct radv_device {
 	 * new point gets submitted. */
 	pthread_cond_t timeline_cond;
 
+	/* Threads to create the pipelines of one vkCreate*Pipelines call in
+	 * parallel. Not initialized on single-core CPUs.
+	 */
+	struct util_queue pipeline_compile_queue;
+
 	/* Thread trace. */
 	struct radeon_cmdbuf *thread_trace_start_cs[2];
 	struct radeon_cmdbuf *thread_trace_stop_cs[2];
@@ -903,8 +919,23 @@ struct radv_descriptor_pool {
 	struct radv_descriptor_pool_entry entries[0];
 };
 
+/* What radv_update_descriptor_set_with_template() does for each descriptor
+ * of a template entry, decided once when the template is created.
+ */
+enum radv_descriptor_update_op {
+	RADV_DESCRIPTOR_UPDATE_OP_INLINE_BLOCK,
+	RADV_DESCRIPTOR_UPDATE_OP_DYNAMIC_BUFFER,
+	RADV_DESCRIPTOR_UPDATE_OP_BUFFER,
+	RADV_DESCRIPTOR_UPDATE_OP_TEXEL_BUFFER,
+	RADV_DESCRIPTOR_UPDATE_OP_IMAGE,
+	RADV_DESCRIPTOR_UPDATE_OP_COMBINED_IMAGE_SAMPLER,
+	RADV_DESCRIPTOR_UPDATE_OP_SAMPLER,
+	RADV_DESCRIPTOR_UPDATE_OP_IMMUTABLE_SAMPLER,
+};
+
 struct radv_descriptor_update_template_entry {
 	VkDescriptorType descriptor_type;
+	enum radv_descriptor_update_op op;
 
 	/* The number of descriptors to update */
 	uint32_t descriptor_count;
@@ -661,76 +661,264 @@ radv_lower_fs_io(nir_shader *nir)
 }
 
 
-static void *
-radv_alloc_shader_memory(struct radv_device *device,
-			 struct radv_shader_variant *shader)
+static unsigned
+radv_shader_size_class(uint64_t size, bool round_up)
 {
-	mtx_lock(&device->shader_slab_mutex);
-	list_for_each_entry(struct radv_shader_slab, slab, &device->shader_slabs, slabs) {
-		uint64_t offset = 0;
-		list_for_each_entry(struct radv_shader_variant, s, &slab->shaders, slab_list) {
-			if (s->bo_offset - offset >= shader->code_size) {
-				shader->bo = slab->bo;
-				shader->bo_offset = offset;
-				list_addtail(&shader->slab_list, &s->slab_list);
-				mtx_unlock(&device->shader_slab_mutex);
-				return slab->ptr + offset;
-			}
-			offset = align_u64(s->bo_offset + s->code_size, 256);
-		}
-		if (offset <= slab->size && slab->size - offset >= shader->code_size) {
-			shader->bo = slab->bo;
-			shader->bo_offset = offset;
-			list_addtail(&shader->slab_list, &slab->shaders);
-			mtx_unlock(&device->shader_slab_mutex);
-			return slab->ptr + offset;
-		}
+	uint64_t units = size / RADV_SHADER_ALLOC_ALIGNMENT;
+	unsigned size_class = util_logbase2_64(units);
+
+	if (round_up && !util_is_power_of_two_or_zero64(units))
+		size_class++;
+
+	return MIN2(size_class, RADV_SHADER_ALLOC_NUM_FREE_LISTS - 1);
+}
+
+static void
+radv_add_shader_hole(struct radv_device *device,
+		     struct radv_shader_block *hole)
+{
+	unsigned size_class = radv_shader_size_class(hole->size, false);
+
+	hole->is_free = true;
+	list_addtail(&hole->free_list, &device->shader_free_lists[size_class]);
+	device->shader_free_list_mask |= 1u << size_class;
+}
+
+static void
+radv_remove_shader_hole(struct radv_device *device,
+			struct radv_shader_block *hole)
+{
+	unsigned size_class = radv_shader_size_class(hole->size, false);
+
+	hole->is_free = false;
+	list_del(&hole->free_list);
+	if (list_is_empty(&device->shader_free_lists[size_class]))
+		device->shader_free_list_mask &= ~(1u << size_class);
+}
+
+/* Take the first \p size bytes of a hole and put the rest back in the free
+ * lists.
+ */
+static void
+radv_split_shader_hole(struct radv_device *device,
+		       struct radv_shader_block *hole, uint64_t size)
+{
+	radv_remove_shader_hole(device, hole);
+
+	if (hole->size == size)
+		return;
+
+	struct radv_shader_block *rest = calloc(1, sizeof(*rest));
+	if (!rest)
+		return; /* Keep the whole hole, at the cost of some memory. */
+
+	rest->slab = hole->slab;
+	rest->offset = hole->offset + size;
+	rest->size = hole->size - size;
+	list_add(&rest->list, &hole->list);
+	radv_add_shader_hole(device, rest);
+
+	hole->size = size;
+}
+
+/* Find a hole for \p size bytes. Any hole in a size class above the one of
+ * \p size fits, so this only needs to search a list when the only candidates
+ * are in the size class of \p size itself.
+ */
+static struct radv_shader_block *
+radv_find_shader_hole(struct radv_device *device, uint64_t size)
+{
+	unsigned size_class = radv_shader_size_class(size, true);
+	uint32_t mask = device->shader_free_list_mask &
+			u_bit_consecutive(size_class,
+					  RADV_SHADER_ALLOC_NUM_FREE_LISTS - size_class);
+
+	if (mask) {
+		return list_first_entry(&device->shader_free_lists[ffs(mask) - 1],
+					struct radv_shader_block, free_list);
 	}
 
-	mtx_unlock(&device->shader_slab_mutex);
+	size_class = radv_shader_size_class(size, false);
+	list_for_each_entry(struct radv_shader_block, hole,
+			    &device->shader_free_lists[size_class], free_list) {
+		if (hole->size >= size)
+			return hole;
+	}
+
+	return NULL;
+}
+
+static struct radv_shader_slab *
+radv_create_shader_slab(struct radv_device *device, uint64_t size)
+{
 	struct radv_shader_slab *slab = calloc(1, sizeof(struct radv_shader_slab));
+	struct radv_shader_block *block = calloc(1, sizeof(struct radv_shader_block));
+	if (!slab || !block)
+		goto fail;
 
-	slab->size = MAX2(256 * 1024, shader->code_size);
-	slab->bo = device->ws->buffer_create(device->ws, slab->size, 256,
+	slab->size = MAX2(RADV_SHADER_ALLOC_MIN_SLAB_SIZE, size);
+	slab->bo = device->ws->buffer_create(device->ws, slab->size,
+					     RADV_SHADER_ALLOC_ALIGNMENT,
 	                                     RADEON_DOMAIN_VRAM,
 					     RADEON_FLAG_NO_INTERPROCESS_SHARING |
 					     (device->physical_device->rad_info.cpdma_prefetch_writes_memory ?
 					             0 : RADEON_FLAG_READ_ONLY),
 					     RADV_BO_PRIORITY_SHADER);
-	if (!slab->bo) {
-		free(slab);
-		return NULL;
-	}
+	if (!slab->bo)
+		goto fail;
 
 	slab->ptr = (char*)device->ws->buffer_map(slab->bo);
 	if (!slab->ptr) {
 		device->ws->buffer_destroy(slab->bo);
-		free(slab);
-		return NULL;
+		goto fail;
 	}
 
-	list_inithead(&slab->shaders);
+	list_inithead(&slab->blocks);
+
+	block->slab = slab;
+	block->offset = 0;
+	block->size = slab->size;
+	list_add(&block->list, &slab->blocks);
+	return slab;
+
+fail:
+	free(block);
+	free(slab);
+	return NULL;
+}
+
+/* Shader memory is suballocated from slabs with a segregated free list
+ * allocator: free blocks are kept in one list per power-of-two size class,
+ * so that allocation is a bitmask lookup and freeing merges the block with
+ * its free neighbours in constant time.
+ */
+static void *
+radv_alloc_shader_memory(struct radv_device *device,
+			 struct radv_shader_variant *shader)
+{
+	uint64_t size = align_u64(shader->code_size, RADV_SHADER_ALLOC_ALIGNMENT);
+	struct radv_shader_block *block;
+
+	mtx_lock(&device->shader_slab_mutex);
+	block = radv_find_shader_hole(device, size);
+	if (!block) {
+		/* Create the slab without holding the lock, the BO allocation
+		 * can be slow.
+		 */
+		mtx_unlock(&device->shader_slab_mutex);
+		struct radv_shader_slab *slab = radv_create_shader_slab(device, size);
+		if (!slab)
+			return NULL;
+
+		mtx_lock(&device->shader_slab_mutex);
+		list_add(&slab->slabs, &device->shader_slabs);
+		block = list_first_entry(&slab->blocks, struct radv_shader_block, list);
+		radv_add_shader_hole(device, block);
+	}
+
+	radv_split_shader_hole(device, block, size);
+	mtx_unlock(&device->shader_slab_mutex);
+
+	shader->block = block;
+	shader->bo = block->slab->bo;
+	shader->bo_offset = block->offset;
+	return block->slab->ptr + block->offset;
+}
+
+static void
+radv_free_shader_memory(struct radv_device *device,
+			struct radv_shader_block *block)
+{
+	struct list_head *blocks = &block->slab->blocks;
 
 	mtx_lock(&device->shader_slab_mutex);
-	list_add(&slab->slabs, &device->shader_slabs);
 
-	shader->bo = slab->bo;
-	shader->bo_offset = 0;
-	list_add(&shader->slab_list, &slab->shaders);
+	if (block->list.next != blocks) {
+		struct radv_shader_block *next =
+			LIST_ENTRY(struct radv_shader_block, block->list.next, list);
+		if (next->is_free) {
+			radv_remove_shader_hole(device, next);
+			block->size += next->size;
+			list_del(&next->list);
+			free(next);
+		}
+	}
+
+	if (block->list.prev != blocks) {
+		struct radv_shader_block *prev =
+			LIST_ENTRY(struct radv_shader_block, block->list.prev, list);
+		if (prev->is_free) {
+			radv_remove_shader_hole(device, prev);
+			prev->size += block->size;
+			list_del(&block->list);
+			free(block);
+			block = prev;
+		}
+	}
+
+	radv_add_shader_hole(device, block);
+
 	mtx_unlock(&device->shader_slab_mutex);
-	return slab->ptr;
+}
+
+void
+radv_init_shader_slabs(struct radv_device *device)
+{
+	mtx_init(&device->shader_slab_mutex, mtx_plain);
+	list_inithead(&device->shader_slabs);
+
+	for (unsigned i = 0; i < RADV_SHADER_ALLOC_NUM_FREE_LISTS; i++)
+		list_inithead(&device->shader_free_lists[i]);
+	device->shader_free_list_mask = 0;
 }
 
 void
 radv_destroy_shader_slabs(struct radv_device *device)
 {
 	list_for_each_entry_safe(struct radv_shader_slab, slab, &device->shader_slabs, slabs) {
+		list_for_each_entry_safe(struct radv_shader_block, block, &slab->blocks, list)
+			free(block);
 		device->ws->buffer_destroy(slab->bo);
 		free(slab);
 	}
 	mtx_destroy(&device->shader_slab_mutex);
 }
 
+void
+radv_dump_shader_slab_stats(struct radv_device *device, FILE *f)
+{
+	uint64_t total = 0, used = 0, largest_hole = 0;
+	unsigned num_slabs = 0, num_shaders = 0, num_holes = 0;
+
+	mtx_lock(&device->shader_slab_mutex);
+	list_for_each_entry(struct radv_shader_slab, slab, &device->shader_slabs, slabs) {
+		num_slabs++;
+		total += slab->size;
+
+		list_for_each_entry(struct radv_shader_block, block, &slab->blocks, list) {
+			if (block->is_free) {
+				num_holes++;
+				largest_hole = MAX2(largest_hole, block->size);
+			} else {
+				num_shaders++;
+				used += block->size;
+			}
+		}
+	}
+	mtx_unlock(&device->shader_slab_mutex);
+
+	/* Fragmentation is the part of the free memory that isn't in the
+	 * largest hole.
+	 */
+	uint64_t free_size = total - used;
+	fprintf(f, "radv: shader slabs: %u slabs, %"PRIu64" KB, %u shaders using "
+		"%"PRIu64" KB, %u holes, largest hole %"PRIu64" KB, "
+		"fragmentation %u%%\n",
+		num_slabs, total / 1024, num_shaders, used / 1024, num_holes,
+		largest_hole / 1024,
+		free_size ? (unsigned)((free_size - largest_hole) * 100 / free_size) : 0);
+}
+
 /* For the UMR disassembler. */
 #define DEBUGGER_END_OF_CODE_MARKER    0xbf9f0000 /* invalid instruction */
 #define DEBUGGER_NUM_MARKERS           5
@@ -1269,9 +1457,8 @@ radv_shader_variant_destroy(struct radv_device *device,
 	if (!p_atomic_dec_zero(&variant->ref_count))
 		return;
 
-	mtx_lock(&device->shader_slab_mutex);
-	list_del(&variant->slab_list);
-	mtx_unlock(&device->shader_slab_mutex);
+	if (variant->block)
+		radv_free_shader_memory(device, variant->block);
 
 	free(variant->spirv);
 	free(variant->nir_string);
@@ -1417,7 +1604,7 @@ generate_shader_stats(struct radv_device *device,
 	if (variant->statistics) {
 		_mesa_string_buffer_printf(buf, "*** COMPILER STATS ***\n");
 		for (unsigned i = 0; i < variant->statistics->count; i++) {
-			struct radv_compiler_statistic_info *info = &variant->statistics->infos[i];
+			const struct radv_compiler_statistic_info *info = &variant->statistics->infos[i];
 			uint32_t value = variant->statistics->values[i];
 			_mesa_string_buffer_printf(buf, "%s: %lu\n", info->name, value);
 		}
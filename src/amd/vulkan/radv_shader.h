@@ -391,7 +391,7 @@ struct radv_compiler_statistic_info {
 
 struct radv_compiler_statistics {
 	unsigned count;
-	struct radv_compiler_statistic_info *infos;
+	const struct radv_compiler_statistic_info *infos;
 	uint32_t values[];
 };
 
@@ -413,12 +413,24 @@ struct radv_shader_variant {
 	char *ir_string;
 	struct radv_compiler_statistics *statistics;
 
-	struct list_head slab_list;
+	struct radv_shader_block *block;
+};
+
+/* A range of a shader slab that is either used by a shader or free. */
+struct radv_shader_block {
+	/* Link in the slab's list of blocks, in address order. */
+	struct list_head list;
+	/* Link in the device's free list for the block's size class. */
+	struct list_head free_list;
+	struct radv_shader_slab *slab;
+	uint64_t offset;
+	uint64_t size;
+	bool is_free;
 };
 
 struct radv_shader_slab {
 	struct list_head slabs;
-	struct list_head shaders;
+	struct list_head blocks;
 	struct radeon_winsys_bo *bo;
 	uint64_t size;
 	char *ptr;
@@ -441,9 +453,15 @@ radv_shader_compile_to_nir(struct radv_device *device,
 			   const struct radv_pipeline_layout *layout,
 			   unsigned subgroup_size, unsigned ballot_bit_size);
 
+void
+radv_init_shader_slabs(struct radv_device *device);
+
 void
 radv_destroy_shader_slabs(struct radv_device *device);
 
+void
+radv_dump_shader_slab_stats(struct radv_device *device, FILE *f);
+
 VkResult
 radv_create_shaders(struct radv_pipeline *pipeline,
 		    struct radv_device *device,
@@ -296,10 +296,11 @@ static void radv_amdgpu_winsys_bo_destroy(struct radeon_winsys_bo *_bo)
 		free(bo->bos);
 		free(bo->ranges);
 	} else {
-		if (bo->ws->debug_all_bos) {
+		if (bo->ws->debug_all_bos || bo->ws->use_resident_bo_list) {
 			pthread_mutex_lock(&bo->ws->global_bo_list_lock);
 			list_del(&bo->global_list_item);
 			bo->ws->num_buffers--;
+			bo->ws->resident_bo_list_dirty = true;
 			pthread_mutex_unlock(&bo->ws->global_bo_list_lock);
 		}
 		radv_amdgpu_bo_va_op(bo->ws, bo->bo, 0, bo->size, bo->base.va,
@@ -329,10 +330,11 @@ static void radv_amdgpu_add_buffer_to_global_list(struct radv_amdgpu_winsys_bo *
 {
 	struct radv_amdgpu_winsys *ws = bo->ws;
 
-	if (bo->ws->debug_all_bos) {
+	if (bo->ws->debug_all_bos || bo->ws->use_resident_bo_list) {
 		pthread_mutex_lock(&ws->global_bo_list_lock);
 		list_addtail(&bo->global_list_item, &ws->global_bo_list);
 		ws->num_buffers++;
+		ws->resident_bo_list_dirty = true;
 		pthread_mutex_unlock(&ws->global_bo_list_lock);
 	}
 }
@@ -29,6 +29,7 @@
 #include <pthread.h>
 #include <errno.h>
 
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 #include "ac_debug.h"
 #include "radv_radeon_winsys.h"
@@ -71,6 +72,35 @@ struct radv_amdgpu_cs {
 	/* For chips that don't support chaining. */
 	struct radeon_cmdbuf     *old_cs_buffers;
 	unsigned                    num_old_cs_buffers;
+
+	/* IB buffers of the previous recording, reused in the same order so
+	 * that re-recording the same commands gives the same BO list.
+	 */
+	struct radeon_winsys_bo     **free_ib_buffers;
+	unsigned                    num_free_ib_buffers;
+	unsigned                    max_num_free_ib_buffers;
+
+	/* BO list of the previous recording, and whether the current one
+	 * differs from it so far.
+	 */
+	struct drm_amdgpu_bo_list_entry *prev_handles;
+	unsigned                    num_prev_handles;
+	unsigned                    max_num_prev_handles;
+	bool                        handles_changed;
+
+	/* Unique per BO list: only changes when a recording ends with a
+	 * different list than the previous one.
+	 */
+	uint64_t                    bo_list_version;
+
+	/* BO list of the last submission starting with this CS, and the
+	 * versions of the CSes it was built from (protected by
+	 * bo_list_cache_lock).
+	 */
+	struct drm_amdgpu_bo_list_entry *cached_bo_list;
+	unsigned                    num_cached_bo_list;
+	uint64_t                    *cached_bo_list_versions;
+	unsigned                    num_cached_bo_list_versions;
 };
 
 static inline struct radv_amdgpu_cs *
@@ -287,6 +317,9 @@ static void radv_amdgpu_cs_destroy(struct radeon_cmdbuf *rcs)
 	for (unsigned i = 0; i < cs->num_old_ib_buffers; ++i)
 		cs->ws->base.buffer_destroy(cs->old_ib_buffers[i]);
 
+	for (unsigned i = 0; i < cs->num_free_ib_buffers; ++i)
+		cs->ws->base.buffer_destroy(cs->free_ib_buffers[i]);
+
 	for (unsigned i = 0; i < cs->num_old_cs_buffers; ++i) {
 		struct radeon_cmdbuf *rcs = &cs->old_cs_buffers[i];
 		free(rcs->buf);
@@ -294,6 +327,10 @@ static void radv_amdgpu_cs_destroy(struct radeon_cmdbuf *rcs)
 
 	free(cs->old_cs_buffers);
 	free(cs->old_ib_buffers);
+	free(cs->free_ib_buffers);
+	free(cs->prev_handles);
+	free(cs->cached_bo_list);
+	free(cs->cached_bo_list_versions);
 	free(cs->virtual_buffers);
 	free(cs->virtual_buffer_hash_table);
 	free(cs->handles);
@@ -321,6 +358,7 @@ radv_amdgpu_cs_create(struct radeon_winsys *ws,
 
 	cs->ws = radv_amdgpu_winsys(ws);
 	radv_amdgpu_init_cs(cs, ring_type);
+	cs->bo_list_version = p_atomic_inc_return(&cs->ws->bo_list_version);
 
 	if (cs->ws->use_ib_bos) {
 		cs->ib_buffer = ws->buffer_create(ws, ib_size, 0,
@@ -362,6 +400,32 @@ radv_amdgpu_cs_create(struct radeon_winsys *ws,
 	return &cs->base;
 }
 
+/* Get an IB buffer of at least ib_size bytes, preferring the first
+ * large enough buffer of the previous recording.
+ */
+static struct radeon_winsys_bo *
+radv_amdgpu_cs_get_ib_buffer(struct radv_amdgpu_cs *cs, uint64_t ib_size)
+{
+	for (unsigned i = 0; i < cs->num_free_ib_buffers; ++i) {
+		struct radeon_winsys_bo *bo = cs->free_ib_buffers[i];
+
+		if (radv_amdgpu_winsys_bo(bo)->size >= ib_size) {
+			memmove(&cs->free_ib_buffers[i], &cs->free_ib_buffers[i + 1],
+				(cs->num_free_ib_buffers - i - 1) * sizeof(bo));
+			cs->num_free_ib_buffers--;
+			return bo;
+		}
+	}
+
+	return cs->ws->base.buffer_create(&cs->ws->base, ib_size, 0,
+					  RADEON_DOMAIN_GTT,
+					  RADEON_FLAG_CPU_ACCESS |
+					  RADEON_FLAG_NO_INTERPROCESS_SHARING |
+					  RADEON_FLAG_READ_ONLY |
+					  RADEON_FLAG_GTT_WC,
+					  RADV_BO_PRIORITY_CS);
+}
+
 static void radv_amdgpu_cs_grow(struct radeon_cmdbuf *_cs, size_t min_size)
 {
 	struct radv_amdgpu_cs *cs = radv_amdgpu_cs(_cs);
@@ -450,13 +514,7 @@ static void radv_amdgpu_cs_grow(struct radeon_cmdbuf *_cs, size_t min_size)
 
 	cs->old_ib_buffers[cs->num_old_ib_buffers++] = cs->ib_buffer;
 
-	cs->ib_buffer = cs->ws->base.buffer_create(&cs->ws->base, ib_size, 0,
-						   RADEON_DOMAIN_GTT,
-						   RADEON_FLAG_CPU_ACCESS |
-						   RADEON_FLAG_NO_INTERPROCESS_SHARING |
-						   RADEON_FLAG_READ_ONLY |
-						   RADEON_FLAG_GTT_WC,
-						   RADV_BO_PRIORITY_CS);
+	cs->ib_buffer = radv_amdgpu_cs_get_ib_buffer(cs, ib_size);
 
 	if (!cs->ib_buffer) {
 		cs->base.cdw = 0;
@@ -502,9 +560,51 @@ static VkResult radv_amdgpu_cs_finalize(struct radeon_cmdbuf *_cs)
 		cs->is_chained = false;
 	}
 
+	if (cs->handles_changed || cs->num_buffers != cs->num_prev_handles)
+		cs->bo_list_version = p_atomic_inc_return(&cs->ws->bo_list_version);
+
 	return cs->status;
 }
 
+/* Make the first IB buffer of the last recording the current one again and
+ * queue the others, in order, for reuse by radv_amdgpu_cs_grow.
+ */
+static bool
+radv_amdgpu_cs_recycle_ib_buffers(struct radv_amdgpu_cs *cs)
+{
+	unsigned num_recycled = cs->num_old_ib_buffers;
+	unsigned num_free = cs->num_free_ib_buffers + num_recycled;
+
+	if (num_free > cs->max_num_free_ib_buffers) {
+		struct radeon_winsys_bo **free_ib_buffers =
+			realloc(cs->free_ib_buffers, num_free * sizeof(void*));
+		if (!free_ib_buffers)
+			return false;
+		cs->free_ib_buffers = free_ib_buffers;
+		cs->max_num_free_ib_buffers = num_free;
+	}
+
+	struct radeon_winsys_bo *first = cs->old_ib_buffers[0];
+	void *mapped = cs->ws->base.buffer_map(first);
+	if (!mapped)
+		return false;
+
+	/* Buffers left over from older recordings go last. */
+	memmove(&cs->free_ib_buffers[num_recycled], cs->free_ib_buffers,
+		cs->num_free_ib_buffers * sizeof(void*));
+	memcpy(cs->free_ib_buffers, &cs->old_ib_buffers[1],
+	       (num_recycled - 1) * sizeof(void*));
+	cs->free_ib_buffers[num_recycled - 1] = cs->ib_buffer;
+	cs->num_free_ib_buffers = num_free;
+	cs->num_old_ib_buffers = 0;
+
+	cs->ib_buffer = first;
+	cs->ib_mapped = mapped;
+	cs->base.buf = (uint32_t *)cs->ib_mapped;
+	cs->base.max_dw = radv_amdgpu_winsys_bo(first)->size / 4 - 4;
+	return true;
+}
+
 static void radv_amdgpu_cs_reset(struct radeon_cmdbuf *_cs)
 {
 	struct radv_amdgpu_cs *cs = radv_amdgpu_cs(_cs);
@@ -522,14 +622,27 @@ static void radv_amdgpu_cs_reset(struct radeon_cmdbuf *_cs)
 		cs->virtual_buffer_hash_table[hash] = -1;
 	}
 
+	/* Keep the BO list to compare the next recording against it. */
+	struct drm_amdgpu_bo_list_entry *prev_handles = cs->prev_handles;
+	unsigned max_num_prev_handles = cs->max_num_prev_handles;
+	cs->prev_handles = cs->handles;
+	cs->num_prev_handles = cs->num_buffers;
+	cs->max_num_prev_handles = cs->max_num_buffers;
+	cs->handles = prev_handles;
+	cs->max_num_buffers = max_num_prev_handles;
+	cs->handles_changed = false;
+
 	cs->num_buffers = 0;
 	cs->num_virtual_buffers = 0;
 
 	if (cs->ws->use_ib_bos) {
-		cs->ws->base.cs_add_buffer(&cs->base, cs->ib_buffer);
+		if (cs->num_old_ib_buffers &&
+		    !radv_amdgpu_cs_recycle_ib_buffers(cs)) {
+			for (unsigned i = 0; i < cs->num_old_ib_buffers; ++i)
+				cs->ws->base.buffer_destroy(cs->old_ib_buffers[i]);
+		}
 
-		for (unsigned i = 0; i < cs->num_old_ib_buffers; ++i)
-			cs->ws->base.buffer_destroy(cs->old_ib_buffers[i]);
+		cs->ws->base.cs_add_buffer(&cs->base, cs->ib_buffer);
 
 		cs->num_old_ib_buffers = 0;
 		cs->ib.ib_mc_address = radv_amdgpu_winsys_bo(cs->ib_buffer)->base.va;
@@ -594,6 +707,11 @@ static void radv_amdgpu_cs_add_buffer_internal(struct radv_amdgpu_cs *cs,
 	cs->handles[cs->num_buffers].bo_handle = bo;
 	cs->handles[cs->num_buffers].bo_priority = priority;
 
+	if (cs->num_buffers >= cs->num_prev_handles ||
+	    cs->prev_handles[cs->num_buffers].bo_handle != bo ||
+	    cs->prev_handles[cs->num_buffers].bo_priority != priority)
+		cs->handles_changed = true;
+
 	hash = bo & (ARRAY_SIZE(cs->buffer_hash_table) - 1);
 	cs->buffer_hash_table[hash] = cs->num_buffers;
 
@@ -710,6 +828,89 @@ static void radv_amdgpu_cs_execute_secondary(struct radeon_cmdbuf *_parent,
 	}
 }
 
+static struct radv_amdgpu_cs *
+radv_amdgpu_bo_list_cs(struct radeon_cmdbuf **cs_array, unsigned count,
+		       struct radeon_cmdbuf *extra_cs, unsigned i)
+{
+	return radv_amdgpu_cs(i == count ? extra_cs : cs_array[i]);
+}
+
+/* Return a copy of the BO list cached in the first CS, if it was built from
+ * the same CSes with the same BO lists.
+ */
+static bool
+radv_amdgpu_get_cached_bo_list(struct radv_amdgpu_winsys *ws,
+			       struct radeon_cmdbuf **cs_array,
+			       unsigned count,
+			       struct radeon_cmdbuf *extra_cs,
+			       unsigned *rnum_handles,
+			       struct drm_amdgpu_bo_list_entry **rhandles)
+{
+	struct radv_amdgpu_cs *cs0 = radv_amdgpu_cs(cs_array[0]);
+	unsigned num_cs = count + !!extra_cs;
+	bool hit = false;
+
+	pthread_mutex_lock(&ws->bo_list_cache_lock);
+
+	if (cs0->cached_bo_list && cs0->num_cached_bo_list_versions == num_cs) {
+		hit = true;
+		for (unsigned i = 0; i < num_cs && hit; ++i) {
+			struct radv_amdgpu_cs *cs =
+				radv_amdgpu_bo_list_cs(cs_array, count, extra_cs, i);
+			hit = cs->bo_list_version == cs0->cached_bo_list_versions[i];
+		}
+	}
+
+	if (hit) {
+		size_t size = cs0->num_cached_bo_list * sizeof(**rhandles);
+
+		*rhandles = malloc(size);
+		if (*rhandles) {
+			memcpy(*rhandles, cs0->cached_bo_list, size);
+			*rnum_handles = cs0->num_cached_bo_list;
+		} else {
+			hit = false;
+		}
+	}
+
+	pthread_mutex_unlock(&ws->bo_list_cache_lock);
+	return hit;
+}
+
+static void
+radv_amdgpu_cache_bo_list(struct radv_amdgpu_winsys *ws,
+			  struct radeon_cmdbuf **cs_array,
+			  unsigned count,
+			  struct radeon_cmdbuf *extra_cs,
+			  unsigned num_handles,
+			  const struct drm_amdgpu_bo_list_entry *handles)
+{
+	struct radv_amdgpu_cs *cs0 = radv_amdgpu_cs(cs_array[0]);
+	unsigned num_cs = count + !!extra_cs;
+	size_t size = num_handles * sizeof(*handles);
+	struct drm_amdgpu_bo_list_entry *cached_bo_list = malloc(size);
+	uint64_t *versions = malloc(num_cs * sizeof(*versions));
+
+	if (!cached_bo_list || !versions) {
+		free(cached_bo_list);
+		free(versions);
+		return;
+	}
+
+	memcpy(cached_bo_list, handles, size);
+	for (unsigned i = 0; i < num_cs; ++i)
+		versions[i] = radv_amdgpu_bo_list_cs(cs_array, count, extra_cs, i)->bo_list_version;
+
+	pthread_mutex_lock(&ws->bo_list_cache_lock);
+	free(cs0->cached_bo_list);
+	free(cs0->cached_bo_list_versions);
+	cs0->cached_bo_list = cached_bo_list;
+	cs0->num_cached_bo_list = num_handles;
+	cs0->cached_bo_list_versions = versions;
+	cs0->num_cached_bo_list_versions = num_cs;
+	pthread_mutex_unlock(&ws->bo_list_cache_lock);
+}
+
 static VkResult
 radv_amdgpu_get_bo_list(struct radv_amdgpu_winsys *ws,
 			struct radeon_cmdbuf **cs_array,
@@ -724,6 +925,13 @@ radv_amdgpu_get_bo_list(struct radv_amdgpu_winsys *ws,
 	struct drm_amdgpu_bo_list_entry *handles = NULL;
 	unsigned num_handles = 0;
 
+	/* The submission uses the resident BO list instead. */
+	if (ws->use_resident_bo_list) {
+		*rhandles = NULL;
+		*rnum_handles = 0;
+		return VK_SUCCESS;
+	}
+
 	if (ws->debug_all_bos) {
 		struct radv_amdgpu_winsys_bo *bo;
 
@@ -757,6 +965,22 @@ radv_amdgpu_get_bo_list(struct radv_amdgpu_winsys *ws,
 		       sizeof(handles[0]) * cs->num_buffers);
 		num_handles = cs->num_buffers;
 	} else {
+		/* Merging the lists is quadratic, so reuse the result when
+		 * the same CSes are submitted again with the same BOs. Virtual
+		 * buffers can change their backing BOs at any time.
+		 */
+		bool cacheable = !num_extra_bo && !radv_bo_list;
+		for (unsigned i = 0; i < count + !!extra_cs && cacheable; ++i) {
+			struct radv_amdgpu_cs *cs =
+				radv_amdgpu_bo_list_cs(cs_array, count, extra_cs, i);
+			cacheable = !cs->num_virtual_buffers;
+		}
+
+		if (cacheable &&
+		    radv_amdgpu_get_cached_bo_list(ws, cs_array, count, extra_cs,
+						   rnum_handles, rhandles))
+			return VK_SUCCESS;
+
 		unsigned total_buffer_count = num_extra_bo;
 		num_handles = num_extra_bo;
 		for (unsigned i = 0; i < count; ++i) {
@@ -854,6 +1078,11 @@ radv_amdgpu_get_bo_list(struct radv_amdgpu_winsys *ws,
 				}
 			}
 		}
+
+		if (cacheable) {
+			radv_amdgpu_cache_bo_list(ws, cs_array, count, extra_cs,
+						  num_handles, handles);
+		}
 	}
 
 	*rhandles = handles;
@@ -1597,6 +1826,59 @@ fail:
 	return r;
 }
 
+/* Rebuild the kernel BO list of all buffers if buffers were created or
+ * destroyed since the last build. Must be called with
+ * resident_bo_list_lock held for writing.
+ */
+static VkResult
+radv_amdgpu_update_resident_bo_list(struct radv_amdgpu_winsys *ws)
+{
+	struct drm_amdgpu_bo_list_entry *handles;
+	struct radv_amdgpu_winsys_bo *bo;
+	unsigned num_handles = 0;
+	uint32_t bo_list;
+	int r;
+
+	pthread_mutex_lock(&ws->global_bo_list_lock);
+
+	if (!ws->resident_bo_list_dirty) {
+		pthread_mutex_unlock(&ws->global_bo_list_lock);
+		return VK_SUCCESS;
+	}
+
+	handles = malloc(sizeof(handles[0]) * MAX2(ws->num_buffers, 1));
+	if (!handles) {
+		pthread_mutex_unlock(&ws->global_bo_list_lock);
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	LIST_FOR_EACH_ENTRY(bo, &ws->global_bo_list, global_list_item) {
+		assert(num_handles < ws->num_buffers);
+		handles[num_handles].bo_handle = bo->bo_handle;
+		handles[num_handles].bo_priority = bo->priority;
+		num_handles++;
+	}
+
+	ws->resident_bo_list_dirty = false;
+	pthread_mutex_unlock(&ws->global_bo_list_lock);
+
+	r = amdgpu_bo_list_create_raw(ws->dev, num_handles, handles, &bo_list);
+	free(handles);
+	if (r) {
+		pthread_mutex_lock(&ws->global_bo_list_lock);
+		ws->resident_bo_list_dirty = true;
+		pthread_mutex_unlock(&ws->global_bo_list_lock);
+
+		fprintf(stderr, "amdgpu: resident buffer list creation failed (%d).\n", r);
+		return r == -ENOMEM ? VK_ERROR_OUT_OF_HOST_MEMORY : VK_ERROR_UNKNOWN;
+	}
+
+	if (ws->resident_bo_list)
+		amdgpu_bo_list_destroy_raw(ws->dev, ws->resident_bo_list);
+	ws->resident_bo_list = bo_list;
+	return VK_SUCCESS;
+}
+
 static VkResult
 radv_amdgpu_cs_submit(struct radv_amdgpu_ctx *ctx,
 		      struct radv_amdgpu_cs_request *request,
@@ -1610,6 +1892,7 @@ radv_amdgpu_cs_submit(struct radv_amdgpu_ctx *ctx,
 	struct drm_amdgpu_cs_chunk_data *chunk_data;
 	struct drm_amdgpu_cs_chunk_dep *sem_dependencies = NULL;
 	bool use_bo_list_create = ctx->ws->info.drm_minor < 27;
+	bool use_resident_bo_list = ctx->ws->use_resident_bo_list;
 	struct drm_amdgpu_bo_list_in bo_list_in;
 	void *wait_syncobj = NULL, *signal_syncobj = NULL;
 	uint32_t *in_syncobjs = NULL;
@@ -1737,7 +2020,23 @@ radv_amdgpu_cs_submit(struct radv_amdgpu_ctx *ctx,
 		num_chunks++;
 	}
 
-	if (use_bo_list_create) {
+	if (use_resident_bo_list) {
+		/* Take the write lock only when the list has to be rebuilt,
+		 * and keep the read lock until the ioctl is done so that the
+		 * handle isn't destroyed under us.
+		 */
+		pthread_rwlock_rdlock(&ctx->ws->resident_bo_list_lock);
+		while (ctx->ws->resident_bo_list_dirty) {
+			pthread_rwlock_unlock(&ctx->ws->resident_bo_list_lock);
+			pthread_rwlock_wrlock(&ctx->ws->resident_bo_list_lock);
+			result = radv_amdgpu_update_resident_bo_list(ctx->ws);
+			pthread_rwlock_unlock(&ctx->ws->resident_bo_list_lock);
+			if (result != VK_SUCCESS)
+				goto error_out;
+			pthread_rwlock_rdlock(&ctx->ws->resident_bo_list_lock);
+		}
+		bo_list = ctx->ws->resident_bo_list;
+	} else if (use_bo_list_create) {
 		/* Legacy path creating the buffer list handle and passing it
 		 * to the CS ioctl.
 		 */
@@ -1774,7 +2073,9 @@ radv_amdgpu_cs_submit(struct radv_amdgpu_ctx *ctx,
 				 chunks,
 				 &request->seq_no);
 
-	if (bo_list)
+	if (use_resident_bo_list)
+		pthread_rwlock_unlock(&ctx->ws->resident_bo_list_lock);
+	else if (bo_list)
 		amdgpu_bo_list_destroy_raw(ctx->ws->dev, bo_list);
 
 	if (r) {
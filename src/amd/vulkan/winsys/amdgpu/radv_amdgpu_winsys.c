@@ -166,6 +166,10 @@ static void radv_amdgpu_winsys_destroy(struct radeon_winsys *rws)
 		amdgpu_cs_destroy_syncobj(ws->dev, ws->syncobj[i]);
 	free(ws->syncobj);
 
+	if (ws->resident_bo_list)
+		amdgpu_bo_list_destroy_raw(ws->dev, ws->resident_bo_list);
+	pthread_rwlock_destroy(&ws->resident_bo_list_lock);
+
 	ac_addrlib_destroy(ws->addrlib);
 	amdgpu_device_deinitialize(ws->dev);
 	FREE(rws);
@@ -197,11 +201,14 @@ radv_amdgpu_winsys_create(int fd, uint64_t debug_flags, uint64_t perftest_flags)
 		ws->use_ib_bos = false;
 
 	ws->use_local_bos = perftest_flags & RADV_PERFTEST_LOCAL_BOS;
+	ws->use_resident_bo_list = perftest_flags & RADV_PERFTEST_RESIDENT_BOS;
 	ws->zero_all_vram_allocs = debug_flags & RADV_DEBUG_ZERO_VRAM;
 	ws->use_llvm = debug_flags & RADV_DEBUG_LLVM;
 	list_inithead(&ws->global_bo_list);
 	pthread_mutex_init(&ws->global_bo_list_lock, NULL);
 	pthread_mutex_init(&ws->syncobj_lock, NULL);
+	pthread_mutex_init(&ws->bo_list_cache_lock, NULL);
+	pthread_rwlock_init(&ws->resident_bo_list_lock, NULL);
 	ws->base.query_info = radv_amdgpu_winsys_query_info;
 	ws->base.query_value = radv_amdgpu_winsys_query_value;
 	ws->base.read_registers = radv_amdgpu_winsys_read_registers;
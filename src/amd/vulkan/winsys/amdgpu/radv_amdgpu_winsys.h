@@ -52,6 +52,16 @@ struct radv_amdgpu_winsys {
 	pthread_mutex_t global_bo_list_lock;
 	struct list_head global_bo_list;
 
+	/* With RADV_PERFTEST=residentbos, every submission uses one kernel
+	 * BO list of all buffers. It is rebuilt when global_bo_list changed,
+	 * and submissions hold resident_bo_list_lock for reading while they
+	 * use it.
+	 */
+	bool use_resident_bo_list;
+	bool resident_bo_list_dirty;
+	uint32_t resident_bo_list;
+	pthread_rwlock_t resident_bo_list_lock;
+
 	uint64_t allocated_vram;
 	uint64_t allocated_vram_vis;
 	uint64_t allocated_gtt;
@@ -60,6 +70,10 @@ struct radv_amdgpu_winsys {
 	pthread_mutex_t syncobj_lock;
 	uint32_t *syncobj;
 	uint32_t syncobj_count, syncobj_capacity;
+
+	/* BO list cache of the CSes, and source of their BO list versions. */
+	pthread_mutex_t bo_list_cache_lock;
+	uint64_t bo_list_version;
 };
 
 static inline struct radv_amdgpu_winsys *
@@ -0,0 +1,157 @@
+# encoding=utf-8
+# Copyright © 2020 Intel Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# Runs a corpus of GLSL and SPIR-V shaders through glsl_compiler and
+# spirv2nir and reports how long each compiler phase took in total, along
+# with the peak memory use of the worst shader.
+#
+# GLSL shaders are recognized by their extension (.vert, .frag, ...).  SPIR-V
+# binaries have to end in .spv and may carry their stage as the preceding
+# extension (foo.vert.spv); they are treated as fragment shaders otherwise.
+
+import argparse
+import collections
+import os
+import re
+import subprocess
+import sys
+
+GLSL_EXTENSIONS = ('.vert', '.tesc', '.tese', '.geom', '.frag', '.comp')
+
+SPIRV_STAGES = {
+    '.vert': 'vertex',
+    '.tesc': 'tess-ctrl',
+    '.tese': 'tess-eval',
+    '.geom': 'geometry',
+    '.frag': 'fragment',
+    '.comp': 'compute',
+    '.cl': 'kernel',
+}
+
+TIME_RE = re.compile(r'^(\w+): ([0-9.]+) us$', re.MULTILINE)
+VERSION_RE = re.compile(rb'^\s*#\s*version\s+(\d+)', re.MULTILINE)
+
+
+def find_shaders(paths):
+    for path in paths:
+        if os.path.isfile(path):
+            yield path
+            continue
+        for root, dirs, files in os.walk(path):
+            dirs.sort()
+            for name in sorted(files):
+                yield os.path.join(root, name)
+
+
+def shader_command(args, path):
+    base, ext = os.path.splitext(path)
+    if ext in GLSL_EXTENSIONS and args.glsl_compiler:
+        with open(path, 'rb') as f:
+            match = VERSION_RE.search(f.read())
+        version = match.group(1).decode() if match else '110'
+        return [args.glsl_compiler, '--time', '--just-log',
+                '--version', version, path]
+    if ext == '.spv' and args.spirv2nir:
+        stage = SPIRV_STAGES.get(os.path.splitext(base)[1], 'fragment')
+        return [args.spirv2nir, path, '--stage', stage, '--optimize',
+                '--time']
+    return None
+
+
+def run(command):
+    """Runs the command and returns its status, output and peak RSS in kB."""
+    proc = subprocess.Popen(command, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL)
+    output = proc.stdout.read().decode(errors='replace')
+    proc.stdout.close()
+    _, status, usage = os.wait4(proc.pid, 0)
+    proc.returncode = status
+    return status, output, usage.ru_maxrss
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Measure the compile time of a shader corpus.')
+    parser.add_argument('--glsl-compiler',
+                        help='path to the glsl_compiler executable')
+    parser.add_argument('--spirv2nir',
+                        help='path to the spirv2nir executable')
+    parser.add_argument('--repeat', type=int, default=1,
+                        help='compile each shader this many times and '
+                             'keep the fastest run')
+    parser.add_argument('--verbose', action='store_true',
+                        help='print the timings of every shader')
+    parser.add_argument('corpus', nargs='+',
+                        help='shader files or directories to search')
+    args = parser.parse_args()
+
+    totals = collections.OrderedDict()
+    peak_rss, peak_rss_shader = 0, None
+    compiled, failed, crashed = 0, 0, 0
+
+    for path in find_shaders(args.corpus):
+        command = shader_command(args, path)
+        if command is None:
+            continue
+
+        best = None
+        for _ in range(args.repeat):
+            status, output, rss = run(command)
+            if rss > peak_rss:
+                peak_rss, peak_rss_shader = rss, path
+            times = {m.group(1): float(m.group(2))
+                     for m in TIME_RE.finditer(output)}
+            if best is None:
+                best = times
+            else:
+                for phase, t in times.items():
+                    best[phase] = min(best.get(phase, t), t)
+
+        if os.WIFSIGNALED(status):
+            print('{}: crashed with signal {}'.format(
+                path, os.WTERMSIG(status)))
+            crashed += 1
+            continue
+        if os.WEXITSTATUS(status) != 0:
+            failed += 1
+            continue
+        compiled += 1
+
+        for phase, t in best.items():
+            totals[phase] = totals.get(phase, 0.0) + t
+        if args.verbose:
+            print('{}: {}'.format(path, ', '.join(
+                '{} {:.1f} us'.format(p, t) for p, t in best.items())))
+
+    print('shaders: {} compiled, {} failed, {} crashed'.format(
+        compiled, failed, crashed))
+    for phase, t in totals.items():
+        print('{:<16} {:12.3f} ms'.format(phase + ':', t / 1000.0))
+    if peak_rss_shader:
+        print('{:<16} {:12} kB ({})'.format('peak_rss:', peak_rss,
+                                            peak_rss_shader))
+
+    return 1 if crashed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1316,6 +1316,9 @@ builtin_builder::initialize()
 void
 builtin_builder::release()
 {
+   if (mem_ctx == NULL)
+      return;
+
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
 
@@ -7647,9 +7650,12 @@ static uint32_t builtin_users = 0;
 extern "C" void
 _mesa_glsl_builtin_functions_init_or_ref()
 {
+   /* Building the built-in library is expensive and not needed at all when
+    * every shader comes out of the shader cache, so it's deferred until
+    * something actually looks up a built-in.
+    */
    mtx_lock(&builtins_lock);
-   if (builtin_users++ == 0)
-      builtins.initialize();
+   builtin_users++;
    mtx_unlock(&builtins_lock);
 }
 
@@ -7669,6 +7675,8 @@ _mesa_glsl_find_builtin_function(_mesa_glsl_parse_state *state,
 {
    ir_function_signature *s;
    mtx_lock(&builtins_lock);
+   assert(builtin_users != 0);
+   builtins.initialize();
    s = builtins.find(state, name, actual_parameters);
    mtx_unlock(&builtins_lock);
 
@@ -7681,6 +7689,8 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    ir_function *f;
    bool ret = false;
    mtx_lock(&builtins_lock);
+   assert(builtin_users != 0);
+   builtins.initialize();
    f = builtins.shader->symbols->get_function(name);
    if (f != NULL) {
       foreach_in_list(ir_function_signature, sig, &f->signatures) {
@@ -7698,6 +7708,11 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
 gl_shader *
 _mesa_glsl_get_builtin_function_shader()
 {
+   mtx_lock(&builtins_lock);
+   assert(builtin_users != 0);
+   builtins.initialize();
+   mtx_unlock(&builtins_lock);
+
    return builtins.shader;
 }
 
@@ -350,6 +350,8 @@ control_line_success:
 		}
 	}
 |	HASH_TOKEN INCLUDE NEWLINE {
+		parser->has_include = true;
+
 		size_t include_cursor = _mesa_get_shader_include_cursor(parser->gl_ctx->Shared);
 
 		/* Remove leading and trailing "" or <> */
@@ -1455,6 +1457,11 @@ add_builtin_define(glcpp_parser_t *parser, const char *name, int value)
    token_t *tok;
    token_list_t *list;
 
+   _mesa_sha1_update(&parser->builtins_sha1, name, strlen(name) + 1);
+   _mesa_sha1_update(&parser->builtins_sha1, &value, sizeof(value));
+   if (parser->hash_builtins_only)
+      return;
+
    tok = _token_create_ival (parser, INTEGER, value);
 
    list = _token_list_create(parser);
@@ -1518,6 +1525,11 @@ glcpp_parser_create(struct gl_context *gl_ctx,
 
    parser->is_gles = false;
 
+   parser->version_identifier = NULL;
+   _mesa_sha1_init(&parser->builtins_sha1);
+   parser->hash_builtins_only = false;
+   parser->has_include = false;
+
    return parser;
 }
 
@@ -2454,6 +2466,8 @@ _glcpp_parser_handle_version_declaration(glcpp_parser_t *parser, intmax_t versio
 
    parser->version = version;
    parser->version_set = true;
+   parser->version_identifier =
+      identifier ? ralloc_strdup(parser, identifier) : NULL;
 
    add_builtin_define (parser, "__VERSION__", version);
 
@@ -2522,6 +2536,23 @@ glcpp_parser_resolve_implicit_version(glcpp_parser_t *parser)
                                             NULL, false);
 }
 
+/* Computes the builtins_sha1 a parse of a shader with the given #version
+ * would end up with, without defining anything.
+ */
+void
+glcpp_parser_hash_builtins(glcpp_parser_t *parser, unsigned version,
+                           const char *identifier, unsigned char sha1[20])
+{
+   assert(!parser->version_set);
+
+   parser->hash_builtins_only = true;
+   _glcpp_parser_handle_version_declaration(parser, version, identifier,
+                                            false);
+   parser->hash_builtins_only = false;
+
+   _mesa_sha1_final(&parser->builtins_sha1, sha1);
+}
+
 static void
 glcpp_parser_copy_defines(const void *key, void *data, void *closure)
 {
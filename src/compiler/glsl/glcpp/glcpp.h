@@ -28,6 +28,7 @@
 #include <stdbool.h>
 
 #include "main/menums.h"
+#include "util/mesa-sha1.h"
 
 #include "util/ralloc.h"
 
@@ -227,6 +228,21 @@ struct glcpp_parser {
 	bool has_new_source_number;
 	int new_source_number;
 	bool is_gles;
+
+	/** The identifier after the version number, if any ("es", ...) */
+	const char *version_identifier;
+
+	/**
+	 * Hash of every built-in macro defined for the #version.  Together
+	 * with the source, this determines the output.
+	 */
+	struct mesa_sha1 builtins_sha1;
+
+	/** Only hash the built-in macros into builtins_sha1, don't define them */
+	bool hash_builtins_only;
+
+	/** Set if the output depends on an #include'd named string */
+	bool has_include;
 };
 
 glcpp_parser_t *
@@ -242,6 +258,10 @@ glcpp_parser_destroy (glcpp_parser_t *parser);
 void
 glcpp_parser_resolve_implicit_version(glcpp_parser_t *parser);
 
+void
+glcpp_parser_hash_builtins(glcpp_parser_t *parser, unsigned version,
+                           const char *identifier, unsigned char sha1[20]);
+
 int
 glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 		 glcpp_extension_iterator extensions, void *state,
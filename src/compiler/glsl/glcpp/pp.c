@@ -25,7 +25,10 @@
 #include <string.h>
 #include <ctype.h>
 #include "glcpp.h"
+#include "c11/threads.h"
 #include "main/mtypes.h"
+#include "util/hash_table.h"
+#include "util/list.h"
 
 void
 glcpp_error (YYLTYPE *locp, glcpp_parser_t *parser, const char *fmt, ...)
@@ -221,12 +224,196 @@ remove_line_continuations(glcpp_parser_t *ctx, const char *shader)
 	return sb->buf;
 }
 
+/* Engines tend to feed the same sources to the compiler many times, e.g.
+ * one vertex shader for every material, or with a warm shader cache but
+ * different contexts.  The output of the preprocessor only depends on the
+ * source, a few context flags, and the built-in macros defined for the
+ * #version, so remember the most recent results and reuse them when all of
+ * these match.  Shaders which #include named strings aren't cached since
+ * those can change at any time.
+ */
+#define PP_CACHE_MAX_SIZE (8 * 1024 * 1024)
+
+struct pp_cache_entry {
+	struct list_head link;
+
+	/* Hash of the source and the context flags */
+	unsigned char key[20];
+
+	/* builtins_sha1 of the parser which produced this */
+	unsigned char builtins[20];
+	unsigned version;
+	char *version_identifier;
+
+	char *output;
+	char *info_log;
+	int errors;
+	size_t size;
+};
+
+static struct {
+	mtx_t mutex;
+	struct hash_table *table;
+
+	/* Least recently used first */
+	struct list_head entries;
+	size_t size;
+} pp_cache = { _MTX_INITIALIZER_NP };
+
+static uint32_t
+sha1_hash(const void *key)
+{
+	return _mesa_hash_data(key, 20);
+}
+
+static bool
+sha1_equal(const void *a, const void *b)
+{
+	return memcmp(a, b, 20) == 0;
+}
+
+static void
+pp_cache_key(const char *shader, struct gl_context *gl_ctx,
+	     unsigned char key[20])
+{
+	struct mesa_sha1 ctx;
+
+	_mesa_sha1_init(&ctx);
+	_mesa_sha1_update(&ctx, shader, strlen(shader));
+	_mesa_sha1_update(&ctx, &gl_ctx->API, sizeof(gl_ctx->API));
+	_mesa_sha1_update(&ctx, &gl_ctx->Const.DisableGLSLLineContinuations,
+			  sizeof(gl_ctx->Const.DisableGLSLLineContinuations));
+	_mesa_sha1_update(&ctx, &gl_ctx->Const.AllowExtraPPTokens,
+			  sizeof(gl_ctx->Const.AllowExtraPPTokens));
+	_mesa_sha1_final(&ctx, key);
+}
+
+/* Returns true if a cached result was copied to output and info_log. */
+static bool
+pp_cache_search(const unsigned char key[20], void *ralloc_ctx,
+		char **output, char **info_log, int *errors,
+		glcpp_extension_iterator extensions, void *state,
+		struct gl_context *gl_ctx)
+{
+	unsigned char builtins[20];
+	unsigned version;
+	char *version_identifier = NULL;
+	char *log = NULL;
+	bool found = false;
+
+	mtx_lock(&pp_cache.mutex);
+	struct hash_entry *he = pp_cache.table ?
+		_mesa_hash_table_search(pp_cache.table, key) : NULL;
+	if (he) {
+		struct pp_cache_entry *entry = he->data;
+
+		list_del(&entry->link);
+		list_addtail(&entry->link, &pp_cache.entries);
+
+		memcpy(builtins, entry->builtins, sizeof(builtins));
+		version = entry->version;
+		if (entry->version_identifier)
+			version_identifier = strdup(entry->version_identifier);
+		*output = ralloc_strdup(ralloc_ctx, entry->output);
+		log = ralloc_strdup(NULL, entry->info_log);
+		*errors = entry->errors;
+		found = true;
+	}
+	mtx_unlock(&pp_cache.mutex);
+
+	if (!found)
+		return false;
+
+	/* The macros of this context have to match as well. */
+	unsigned char current_builtins[20];
+	glcpp_parser_t *parser =
+		glcpp_parser_create(gl_ctx, extensions, state);
+	glcpp_parser_hash_builtins(parser, version, version_identifier,
+				   current_builtins);
+	glcpp_parser_destroy(parser);
+	free(version_identifier);
+
+	if (memcmp(builtins, current_builtins, sizeof(builtins)) != 0) {
+		ralloc_free(*output);
+		*output = NULL;
+		ralloc_free(log);
+		return false;
+	}
+
+	ralloc_strcat(info_log, log);
+	ralloc_free(log);
+	return true;
+}
+
+static void
+pp_cache_insert(const unsigned char key[20], glcpp_parser_t *parser,
+		const char *output, const char *info_log)
+{
+	struct pp_cache_entry *entry;
+
+	mtx_lock(&pp_cache.mutex);
+
+	if (pp_cache.table == NULL) {
+		pp_cache.table = _mesa_hash_table_create(NULL, sha1_hash,
+							 sha1_equal);
+		list_inithead(&pp_cache.entries);
+	}
+
+	/* A context with different macros may have gotten here first. */
+	struct hash_entry *he = _mesa_hash_table_search(pp_cache.table, key);
+	if (he) {
+		entry = he->data;
+		_mesa_hash_table_remove(pp_cache.table, he);
+		list_del(&entry->link);
+		pp_cache.size -= entry->size;
+		ralloc_free(entry);
+	}
+
+	entry = ralloc(pp_cache.table, struct pp_cache_entry);
+	memcpy(entry->key, key, sizeof(entry->key));
+	_mesa_sha1_final(&parser->builtins_sha1, entry->builtins);
+	entry->version = parser->version;
+	entry->version_identifier =
+		ralloc_strdup(entry, parser->version_identifier);
+	entry->output = ralloc_strdup(entry, output);
+	entry->info_log = ralloc_strdup(entry, info_log);
+	entry->errors = parser->error;
+	entry->size = strlen(output) + strlen(info_log) + sizeof(*entry);
+
+	_mesa_hash_table_insert(pp_cache.table, entry->key, entry);
+	list_addtail(&entry->link, &pp_cache.entries);
+	pp_cache.size += entry->size;
+
+	while (pp_cache.size > PP_CACHE_MAX_SIZE) {
+		struct pp_cache_entry *old =
+			list_first_entry(&pp_cache.entries,
+					 struct pp_cache_entry, link);
+
+		_mesa_hash_table_remove_key(pp_cache.table, old->key);
+		list_del(&old->link);
+		pp_cache.size -= old->size;
+		ralloc_free(old);
+	}
+
+	mtx_unlock(&pp_cache.mutex);
+}
+
 int
 glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
                  glcpp_extension_iterator extensions, void *state,
                  struct gl_context *gl_ctx)
 {
 	int errors;
+	unsigned char key[20];
+	char *output;
+
+	pp_cache_key(*shader, gl_ctx, key);
+	if (pp_cache_search(key, ralloc_ctx, &output, info_log, &errors,
+			    extensions, state, gl_ctx)) {
+		*shader = output;
+		return errors;
+	}
+
 	glcpp_parser_t *parser =
 		glcpp_parser_create(gl_ctx, extensions, state);
 
@@ -247,6 +434,10 @@ glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 	/* Crimp the buffer first, to conserve memory */
 	_mesa_string_buffer_crimp_to_fit(parser->output);
 
+	if (!parser->has_include)
+		pp_cache_insert(key, parser, parser->output->buf,
+				parser->info_log->buf);
+
 	ralloc_steal(ralloc_ctx, parser->output->buf);
 	*shader = parser->output->buf;
 
@@ -2073,9 +2073,13 @@ opt_shader_and_create_symbol_table(struct gl_context *ctx,
     * and reduce later work if the same shader is linked multiple times
     */
    if (ctx->Const.GLSLOptimizeConservatively) {
-      /* Run it just once. */
-      do_common_optimization(shader->ir, false, false, options,
-                             ctx->Const.NativeIntegers);
+      /* Run it just once.  NIR drivers get that one run at link time and
+       * do the real optimization in NIR afterwards, so skip it here.
+       */
+      if (!options->NirOptions) {
+         do_common_optimization(shader->ir, false, false, options,
+                                ctx->Const.NativeIntegers);
+      }
    } else {
       /* Repeat it until it stops making changes. */
       while (do_common_optimization(shader->ir, false, false, options,
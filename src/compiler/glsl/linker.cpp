@@ -85,6 +85,9 @@
 #include "shader_cache.h"
 #include "util/u_string.h"
 #include "util/u_math.h"
+#include "util/u_queue.h"
+#include "util/debug.h"
+#include "c11/threads.h"
 
 
 #include "main/shaderobj.h"
@@ -4550,6 +4553,98 @@ linker_optimisation_loop(struct gl_context *ctx, exec_list *ir,
       }
 }
 
+static void
+optimize_linked_stage(struct gl_context *ctx, exec_list *ir, unsigned stage)
+{
+   /* Call opts before lowering const arrays to uniforms so we can const
+    * propagate any elements accessed directly.
+    */
+   linker_optimisation_loop(ctx, ir, stage);
+
+   /* Call opts after lowering const arrays to copy propagate things. */
+   if (ctx->Const.GLSLLowerConstArrays &&
+       lower_const_arrays_to_uniforms(ir, stage,
+                                      ctx->Const.Program[stage].MaxUniformComponents))
+      linker_optimisation_loop(ctx, ir, stage);
+}
+
+/* Optimizing a stage only touches the IR of that stage, which is allocated
+ * out of its own gl_linked_shader, so the stages of a program can be
+ * optimized on separate threads.  This is opt-in through
+ * MESA_GLSL_PARALLEL_LINK.
+ */
+struct stage_opt_job {
+   struct gl_context *ctx;
+   exec_list *ir;
+   unsigned stage;
+   struct util_queue_fence fence;
+};
+
+static struct {
+   bool ok;
+   struct util_queue queue;
+} link_queue;
+
+static void
+link_queue_init_once(void)
+{
+   if (!env_var_as_boolean("MESA_GLSL_PARALLEL_LINK", false))
+      return;
+
+   /* The calling thread optimizes one of the stages itself. */
+   link_queue.ok = util_queue_init(&link_queue.queue, "glsl_link",
+                                   MESA_SHADER_STAGES, MESA_SHADER_STAGES - 1,
+                                   UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+}
+
+static void
+run_stage_opt_job(void *data, UNUSED int thread_index)
+{
+   struct stage_opt_job *job = (struct stage_opt_job *) data;
+
+   optimize_linked_stage(job->ctx, job->ir, job->stage);
+}
+
+static void
+optimize_linked_stages(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   static once_flag once = ONCE_FLAG_INIT;
+   struct stage_opt_job jobs[MESA_SHADER_STAGES];
+   unsigned num_jobs = 0;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] == NULL)
+         continue;
+
+      jobs[num_jobs].ctx = ctx;
+      jobs[num_jobs].ir = prog->_LinkedShaders[i]->ir;
+      jobs[num_jobs].stage = i;
+      num_jobs++;
+   }
+
+   if (num_jobs > 1)
+      call_once(&once, link_queue_init_once);
+
+   if (num_jobs < 2 || !link_queue.ok) {
+      for (unsigned i = 0; i < num_jobs; i++)
+         run_stage_opt_job(&jobs[i], 0);
+      return;
+   }
+
+   for (unsigned i = 1; i < num_jobs; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      util_queue_add_job(&link_queue.queue, &jobs[i], &jobs[i].fence,
+                         run_stage_opt_job, NULL, 0);
+   }
+
+   run_stage_opt_job(&jobs[0], 0);
+
+   for (unsigned i = 1; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
 void
 link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 {
@@ -4885,20 +4980,10 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
             goto done;
          }
       }
-
-      /* Call opts before lowering const arrays to uniforms so we can const
-       * propagate any elements accessed directly.
-       */
-      linker_optimisation_loop(ctx, prog->_LinkedShaders[i]->ir, i);
-
-      /* Call opts after lowering const arrays to copy propagate things. */
-      if (ctx->Const.GLSLLowerConstArrays &&
-          lower_const_arrays_to_uniforms(prog->_LinkedShaders[i]->ir, i,
-                                         ctx->Const.Program[i].MaxUniformComponents))
-         linker_optimisation_loop(ctx, prog->_LinkedShaders[i]->ir, i);
-
    }
 
+   optimize_linked_stages(ctx, prog);
+
    /* Validation for special cases where we allow sampler array indexing
     * with loop induction variable. This check emits a warning or error
     * depending if backend can handle dynamic indexing.
@@ -37,6 +37,7 @@
 #include "standalone_scaffolding.h"
 #include "standalone.h"
 #include "string_to_uint_map.h"
+#include "util/os_time.h"
 #include "util/set.h"
 #include "linker.h"
 #include "glsl_parser_extras.h"
@@ -400,6 +401,7 @@ standalone_compile_shader(const struct standalone_options *_options,
 {
    int status = EXIT_SUCCESS;
    bool glsl_es = false;
+   int64_t compile_ns = 0, link_ns = 0;
 
    options = _options;
 
@@ -497,7 +499,9 @@ standalone_compile_shader(const struct standalone_options *_options,
          exit(EXIT_FAILURE);
       }
 
+      int64_t start = os_time_get_nano();
       compile_shader(ctx, shader);
+      compile_ns += os_time_get_nano() - start;
 
       if (strlen(shader->InfoLog) > 0) {
          if (!options->just_log)
@@ -517,6 +521,7 @@ standalone_compile_shader(const struct standalone_options *_options,
    if (status == EXIT_SUCCESS) {
       _mesa_clear_shader_program_data(ctx, whole_program);
 
+      int64_t start = os_time_get_nano();
       if (options->do_link)  {
          link_shaders(ctx, whole_program);
       } else {
@@ -556,6 +561,7 @@ standalone_compile_shader(const struct standalone_options *_options,
             } while(progress);
          }
       }
+      link_ns = os_time_get_nano() - start;
 
       status = (whole_program->data->LinkStatus) ? EXIT_SUCCESS : EXIT_FAILURE;
 
@@ -592,6 +598,11 @@ standalone_compile_shader(const struct standalone_options *_options,
             _mesa_print_builder_for_ir(stdout, shader->ir);
          }
       }
+
+      if (options->time) {
+         printf("glsl_compile: %.1f us\n", compile_ns / 1000.0);
+         printf("glsl_link: %.1f us\n", link_ns / 1000.0);
+      }
    }
 
    return whole_program;
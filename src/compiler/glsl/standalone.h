@@ -37,6 +37,7 @@ struct standalone_options {
    int do_link;
    int just_log;
    int lower_precision;
+   int time;
 };
 
 struct gl_shader_program;
@@ -35,6 +35,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "util/macros.h"
 #include "util/mesa-sha1.h"
 #include "util/disk_cache.h"
 
@@ -474,6 +475,273 @@ test_put_key_and_get_key(void)
 
    disk_cache_destroy(cache);
 }
+
+static void
+test_get_entry(enum disk_cache_type type)
+{
+   struct disk_cache *cache;
+   struct disk_cache_entry entry;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   char string[] = "While this string has thirty-four";
+   uint8_t blob_key[20], string_key[20];
+   bool found;
+
+   cache = disk_cache_type_create("test", "make_check", 0, type);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_compute_key(cache, string, sizeof(string), string_key);
+
+   found = disk_cache_get_entry(cache, blob_key, &entry);
+   expect_true(!found, "disk_cache_get_entry with non-existent item");
+
+   disk_cache_put_uncompressed(cache, blob_key, blob, sizeof(blob), NULL);
+   disk_cache_put(cache, string_key, string, sizeof(string), NULL);
+   disk_cache_wait_for_idle(cache);
+
+   found = disk_cache_get_entry(cache, blob_key, &entry);
+   expect_true(found, "disk_cache_get_entry of uncompressed item");
+   if (found) {
+      expect_equal(entry.size, sizeof(blob),
+                   "disk_cache_get_entry of uncompressed item (size)");
+      expect_equal_str(entry.data, blob,
+                       "disk_cache_get_entry of uncompressed item (data)");
+      disk_cache_entry_release(&entry);
+   }
+
+   found = disk_cache_get_entry(cache, string_key, &entry);
+   expect_true(found, "disk_cache_get_entry of compressed item");
+   if (found) {
+      expect_equal(entry.size, sizeof(string),
+                   "disk_cache_get_entry of compressed item (size)");
+      expect_equal_str(entry.data, string,
+                       "disk_cache_get_entry of compressed item (data)");
+      disk_cache_entry_release(&entry);
+   }
+
+   disk_cache_destroy(cache);
+}
+
+static void
+test_codecs(void)
+{
+   static const char *codecs[] = {
+      "zstd", "zstd-fast", "zlib", "zlib-fast", "lz4", "none",
+   };
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_keys[ARRAY_SIZE(codecs)][20];
+   char *result;
+   size_t size;
+
+   /* Codecs missing from this build fall back to the default one. */
+   for (unsigned i = 0; i < ARRAY_SIZE(codecs); i++) {
+      setenv("MESA_DISK_CACHE_CODEC", codecs[i], 1);
+      cache = disk_cache_create("test", "make_check", 0);
+
+      disk_cache_compute_key(cache, codecs[i], strlen(codecs[i]),
+                             blob_keys[i]);
+      disk_cache_put(cache, blob_keys[i], blob, sizeof(blob), NULL);
+      disk_cache_wait_for_idle(cache);
+
+      result = disk_cache_get(cache, blob_keys[i], &size);
+      expect_equal_str(blob, result, "disk_cache_get with codec (pointer)");
+      expect_equal(size, sizeof(blob), "disk_cache_get with codec (size)");
+      free(result);
+
+      disk_cache_destroy(cache);
+   }
+
+   /* Entries must be readable whatever the current codec is. */
+   unsetenv("MESA_DISK_CACHE_CODEC");
+   cache = disk_cache_create("test", "make_check", 0);
+   for (unsigned i = 0; i < ARRAY_SIZE(codecs); i++) {
+      expect_true(does_cache_contain(cache, blob_keys[i]),
+                  "disk_cache_get of entry written with another codec");
+   }
+   disk_cache_destroy(cache);
+}
+
+static void
+test_memory_tier(void)
+{
+   struct disk_cache *cache;
+   struct disk_cache_stats stats;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_key[20];
+   char *result;
+   size_t size;
+
+   setenv("MESA_DISK_CACHE_MEMORY_SIZE", "1K", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_remove(cache, blob_key);
+
+   /* Stored items are served from memory, even before they hit the disk. */
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_str(blob, result, "memory tier get (pointer)");
+   expect_equal(size, sizeof(blob), "memory tier get (size)");
+   free(result);
+
+   disk_cache_get_stats(cache, &stats);
+   expect_equal(stats.mem_hits, 1, "memory tier hits");
+   expect_equal(stats.mem_size, sizeof(blob), "memory tier size");
+
+   disk_cache_wait_for_idle(cache);
+   disk_cache_destroy(cache);
+
+   /* A new cache starts empty and is populated by the first get. */
+   cache = disk_cache_create("test", "make_check", 0);
+
+   expect_true(does_cache_contain(cache, blob_key), "memory tier miss");
+   expect_true(does_cache_contain(cache, blob_key), "memory tier hit");
+
+   disk_cache_get_stats(cache, &stats);
+   expect_equal(stats.mem_hits, 1, "memory tier hits after get");
+   expect_equal(stats.mem_misses, 1, "memory tier misses after get");
+
+   disk_cache_remove(cache, blob_key);
+   disk_cache_destroy(cache);
+   unsetenv("MESA_DISK_CACHE_MEMORY_SIZE");
+}
+
+struct batch_result {
+   void *data;
+   size_t size;
+   bool called;
+};
+
+static void
+batch_callback(void *callback_data, unsigned index, void *value, size_t size)
+{
+   struct batch_result *results = callback_data;
+
+   results[index].data = value;
+   results[index].size = size;
+   results[index].called = true;
+}
+
+static void
+test_get_batch(void)
+{
+   static const char *items[] = { "first", "second", "third", "fourth" };
+   struct batch_result results[ARRAY_SIZE(items) + 1];
+   cache_key keys[ARRAY_SIZE(items) + 1];
+   struct disk_cache *cache;
+
+   cache = disk_cache_create("test", "make_check", 0);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(items); i++) {
+      disk_cache_compute_key(cache, items[i], strlen(items[i]) + 1, keys[i]);
+      disk_cache_put(cache, keys[i], items[i], strlen(items[i]) + 1, NULL);
+   }
+   disk_cache_wait_for_idle(cache);
+
+   /* One more key which was never stored. */
+   disk_cache_compute_key(cache, "fifth", 6, keys[ARRAY_SIZE(items)]);
+
+   memset(results, 0, sizeof(results));
+   disk_cache_get_batch(cache, (const cache_key *)keys, ARRAY_SIZE(keys),
+                        batch_callback, results);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(items); i++) {
+      expect_true(results[i].called, "disk_cache_get_batch callback");
+      expect_equal_str(results[i].data ? results[i].data : "", items[i],
+                       "disk_cache_get_batch value");
+      expect_equal(results[i].size, strlen(items[i]) + 1,
+                   "disk_cache_get_batch size");
+      free(results[i].data);
+   }
+
+   expect_true(results[ARRAY_SIZE(items)].called,
+               "disk_cache_get_batch callback for a missing item");
+   expect_null(results[ARRAY_SIZE(items)].data,
+               "disk_cache_get_batch of a missing item");
+
+   disk_cache_destroy(cache);
+}
+
+/* Fill \p data with something zstd and zlib can't compress. */
+static void
+fill_incompressible(uint8_t *data, size_t size, uint32_t seed)
+{
+   for (size_t i = 0; i < size; i++) {
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      data[i] = seed;
+   }
+}
+
+static void
+test_single_file_put_and_get(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_key[20];
+   uint8_t big_keys[8][20];
+   uint8_t *big;
+   char *result;
+   size_t size;
+   int count;
+
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "64K", 1);
+   cache = disk_cache_type_create("test", "make_check", 0,
+                                  DISK_CACHE_SINGLE_FILE);
+   expect_non_null(cache, "disk_cache_type_create with single file");
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_null(result, "single file get with non-existent item (pointer)");
+   expect_equal(size, 0, "single file get with non-existent item (size)");
+
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   disk_cache_wait_for_idle(cache);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_str(blob, result, "single file get of existing item (pointer)");
+   expect_equal(size, sizeof(blob), "single file get of existing item (size)");
+   free(result);
+
+   /* Entries must survive reopening the cache. */
+   disk_cache_destroy(cache);
+   cache = disk_cache_type_create("test", "make_check", 0,
+                                  DISK_CACHE_SINGLE_FILE);
+
+   expect_true(does_cache_contain(cache, blob_key),
+               "single file item persists after reopening the cache");
+
+   disk_cache_remove(cache, blob_key);
+   expect_true(!does_cache_contain(cache, blob_key),
+               "single file item is gone after disk_cache_remove");
+
+   /* Add 8 * 16K of incompressible items to a 64K cache, the compaction must
+    * keep the most recent ones.
+    */
+   big = malloc(16 * 1024);
+   for (int i = 0; i < 8; i++) {
+      fill_incompressible(big, 16 * 1024, i + 1);
+      disk_cache_compute_key(cache, big, 16 * 1024, big_keys[i]);
+      disk_cache_put(cache, big_keys[i], big, 16 * 1024, NULL);
+      disk_cache_wait_for_idle(cache);
+   }
+   free(big);
+
+   count = 0;
+   for (int i = 0; i < 8; i++) {
+      if (does_cache_contain(cache, big_keys[i]))
+         count++;
+   }
+
+   expect_true(count > 0 && count < 4,
+               "single file compaction with MAX_SIZE=64K");
+   expect_true(does_cache_contain(cache, big_keys[7]),
+               "single file compaction keeps the last item");
+
+   disk_cache_destroy(cache);
+}
 #endif /* ENABLE_SHADER_CACHE */
 
 int
@@ -488,6 +756,18 @@ main(void)
 
    test_put_key_and_get_key();
 
+   test_single_file_put_and_get();
+
+   test_codecs();
+
+   test_memory_tier();
+
+   test_get_batch();
+
+   test_get_entry(DISK_CACHE_MULTI_FILE);
+
+   test_get_entry(DISK_CACHE_SINGLE_FILE);
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
@@ -22,6 +22,7 @@
  */
 
 #include <stdio.h>
+#include <atomic>
 #include "main/macros.h"
 #include "compiler/glsl/glsl_parser_extras.h"
 #include "glsl_types.h"
@@ -506,6 +507,163 @@ hash_free_type_function(struct hash_entry *entry)
    delete type;
 }
 
+/**
+ * Lock-free lookup cache in front of the type hash tables
+ *
+ * Every get_*_instance call used to take hash_mutex just to find a type
+ * that, after the first few shaders, almost always exists already.  Types
+ * are only ever added until the last user goes away, so lookups can instead
+ * probe an open-addressed array whose slots are published atomically and
+ * only fall back to the mutex when the type isn't there.  Insertions still
+ * happen with hash_mutex held, right after the type is added to its hash
+ * table.
+ *
+ * When the array gets half full it's replaced by one twice the size.  Other
+ * threads may still be probing the old one, so it's kept around until the
+ * types are destroyed.
+ */
+struct type_cache_entry {
+   std::atomic<uint32_t> hash;
+   std::atomic<const glsl_type *> type;
+};
+
+struct type_cache_array {
+   uint32_t size;
+   uint32_t count;
+   type_cache_array *prev;
+   type_cache_entry *entries;
+};
+
+struct type_cache {
+   std::atomic<type_cache_array *> array;
+};
+
+static type_cache explicit_matrix_cache;
+static type_cache array_cache;
+static type_cache struct_cache;
+static type_cache interface_cache;
+static type_cache function_cache;
+static type_cache subroutine_cache;
+
+/**
+ * Look up a type without taking hash_mutex
+ *
+ * \c compare is called with \c key and a candidate type with the same hash,
+ * and returns true if they match.
+ */
+static const glsl_type *
+type_cache_search(const type_cache *cache, uint32_t hash,
+                  bool (*compare)(const void *key, const void *type),
+                  const void *key)
+{
+   const type_cache_array *array =
+      cache->array.load(std::memory_order_acquire);
+   if (array == NULL)
+      return NULL;
+
+   const uint32_t mask = array->size - 1;
+   for (uint32_t i = 0; i < array->size; i++) {
+      const type_cache_entry *entry = &array->entries[(hash + i) & mask];
+      const glsl_type *t = entry->type.load(std::memory_order_acquire);
+
+      if (t == NULL)
+         return NULL;
+
+      if (entry->hash.load(std::memory_order_relaxed) == hash &&
+          compare(key, t))
+         return t;
+   }
+
+   return NULL;
+}
+
+static void
+type_cache_array_add(type_cache_array *array, uint32_t hash,
+                     const glsl_type *t)
+{
+   const uint32_t mask = array->size - 1;
+   for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+      type_cache_entry *entry = &array->entries[i];
+
+      if (entry->type.load(std::memory_order_relaxed) == NULL) {
+         /* The hash has to be visible before the type is. */
+         entry->hash.store(hash, std::memory_order_relaxed);
+         entry->type.store(t, std::memory_order_release);
+         array->count++;
+         return;
+      }
+   }
+}
+
+static type_cache_array *
+type_cache_array_create(uint32_t size)
+{
+   type_cache_array *array = new type_cache_array;
+
+   array->size = size;
+   array->count = 0;
+   array->prev = NULL;
+   array->entries = new type_cache_entry[size];
+   for (uint32_t i = 0; i < size; i++) {
+      array->entries[i].hash.store(0, std::memory_order_relaxed);
+      array->entries[i].type.store(NULL, std::memory_order_relaxed);
+   }
+
+   return array;
+}
+
+/**
+ * Add a type which was just created; hash_mutex must be held.
+ */
+static void
+type_cache_insert(type_cache *cache, uint32_t hash, const glsl_type *t)
+{
+   type_cache_array *array = cache->array.load(std::memory_order_relaxed);
+
+   if (array == NULL || (array->count + 1) * 2 > array->size) {
+      type_cache_array *new_array =
+         type_cache_array_create(array ? array->size * 2 : 64);
+
+      if (array != NULL) {
+         for (uint32_t i = 0; i < array->size; i++) {
+            const type_cache_entry *entry = &array->entries[i];
+            const glsl_type *old = entry->type.load(std::memory_order_relaxed);
+
+            if (old != NULL) {
+               type_cache_array_add(new_array,
+                                    entry->hash.load(std::memory_order_relaxed),
+                                    old);
+            }
+         }
+      }
+
+      new_array->prev = array;
+      array = new_array;
+   }
+
+   type_cache_array_add(array, hash, t);
+   cache->array.store(array, std::memory_order_release);
+}
+
+/**
+ * Free a cache and all of the arrays it has replaced; hash_mutex must be
+ * held and there must be no users left.
+ */
+static void
+type_cache_destroy(type_cache *cache)
+{
+   type_cache_array *array = cache->array.load(std::memory_order_relaxed);
+
+   while (array != NULL) {
+      type_cache_array *prev = array->prev;
+      delete[] array->entries;
+      delete array;
+      array = prev;
+   }
+
+   cache->array.store(NULL, std::memory_order_relaxed);
+}
+
 void
 glsl_type_singleton_init_or_ref()
 {
@@ -531,31 +689,37 @@ glsl_type_singleton_decref()
                                hash_free_type_function);
       glsl_type::explicit_matrix_types = NULL;
    }
+   type_cache_destroy(&explicit_matrix_cache);
 
    if (glsl_type::array_types != NULL) {
       _mesa_hash_table_destroy(glsl_type::array_types, hash_free_type_function);
       glsl_type::array_types = NULL;
    }
+   type_cache_destroy(&array_cache);
 
    if (glsl_type::struct_types != NULL) {
       _mesa_hash_table_destroy(glsl_type::struct_types, hash_free_type_function);
       glsl_type::struct_types = NULL;
    }
+   type_cache_destroy(&struct_cache);
 
    if (glsl_type::interface_types != NULL) {
       _mesa_hash_table_destroy(glsl_type::interface_types, hash_free_type_function);
       glsl_type::interface_types = NULL;
    }
+   type_cache_destroy(&interface_cache);
 
    if (glsl_type::function_types != NULL) {
       _mesa_hash_table_destroy(glsl_type::function_types, hash_free_type_function);
       glsl_type::function_types = NULL;
    }
+   type_cache_destroy(&function_cache);
 
    if (glsl_type::subroutine_types != NULL) {
       _mesa_hash_table_destroy(glsl_type::subroutine_types, hash_free_type_function);
       glsl_type::subroutine_types = NULL;
    }
+   type_cache_destroy(&subroutine_cache);
 
    mtx_unlock(&glsl_type::hash_mutex);
 }
@@ -648,6 +812,12 @@ VECN(components, uint16_t, u16vec)
 VECN(components, int8_t, i8vec)
 VECN(components, uint8_t, u8vec)
 
+static bool
+explicit_matrix_key_compare(const void *key, const void *type)
+{
+   return strcmp((const char *) key, ((const glsl_type *) type)->name) == 0;
+}
+
 const glsl_type *
 glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns,
                         unsigned explicit_stride, bool row_major)
@@ -669,6 +839,13 @@ glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns,
       snprintf(name, sizeof(name), "%sx%uB%s", bare_type->name,
                explicit_stride, row_major ? "RM" : "");
 
+      const uint32_t hash = _mesa_hash_string(name);
+      const glsl_type *cached =
+         type_cache_search(&explicit_matrix_cache, hash,
+                           explicit_matrix_key_compare, name);
+      if (cached != NULL)
+         return cached;
+
       mtx_lock(&glsl_type::hash_mutex);
       assert(glsl_type_users > 0);
 
@@ -688,6 +865,7 @@ glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns,
 
          entry = _mesa_hash_table_insert(explicit_matrix_types,
                                          t->name, (void *)t);
+         type_cache_insert(&explicit_matrix_cache, hash, t);
       }
 
       assert(((glsl_type *) entry->data)->base_type == base_type);
@@ -1023,11 +1201,35 @@ glsl_type::get_image_instance(enum glsl_sampler_dim dim,
    unreachable("switch statement above should be complete");
 }
 
+struct array_key {
+   const glsl_type *base;
+   unsigned array_size;
+   unsigned explicit_stride;
+};
+
+static bool
+array_key_compare(const void *key, const void *type)
+{
+   const array_key *const k = (const array_key *) key;
+   const glsl_type *const t = (const glsl_type *) type;
+
+   return t->fields.array == k->base &&
+          t->length == k->array_size &&
+          t->explicit_stride == k->explicit_stride;
+}
+
 const glsl_type *
 glsl_type::get_array_instance(const glsl_type *base,
                               unsigned array_size,
                               unsigned explicit_stride)
 {
+   const array_key akey = { base, array_size, explicit_stride };
+   const uint32_t hash = _mesa_hash_data(&akey, sizeof(akey));
+   const glsl_type *cached =
+      type_cache_search(&array_cache, hash, array_key_compare, &akey);
+   if (cached != NULL)
+      return cached;
+
    /* Generate a name using the base type pointer in the key.  This is
     * done because the name of the base type may not be unique across
     * shaders.  For example, two shaders may have different record types
@@ -1052,6 +1254,7 @@ glsl_type::get_array_instance(const glsl_type *base,
       entry = _mesa_hash_table_insert(array_types,
                                       strdup(key),
                                       (void *) t);
+      type_cache_insert(&array_cache, hash, t);
    }
 
    assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_ARRAY);
@@ -1243,6 +1446,11 @@ glsl_type::get_struct_instance(const glsl_struct_field *fields,
                                bool packed)
 {
    const glsl_type key(fields, num_fields, name, packed);
+   const uint32_t hash = record_key_hash(&key);
+   const glsl_type *cached =
+      type_cache_search(&struct_cache, hash, record_key_compare, &key);
+   if (cached != NULL)
+      return cached;
 
    mtx_lock(&glsl_type::hash_mutex);
    assert(glsl_type_users > 0);
@@ -1258,6 +1466,7 @@ glsl_type::get_struct_instance(const glsl_struct_field *fields,
       const glsl_type *t = new glsl_type(fields, num_fields, name, packed);
 
       entry = _mesa_hash_table_insert(struct_types, t, (void *) t);
+      type_cache_insert(&struct_cache, hash, t);
    }
 
    assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_STRUCT);
@@ -1281,6 +1490,11 @@ glsl_type::get_interface_instance(const glsl_struct_field *fields,
                                   const char *block_name)
 {
    const glsl_type key(fields, num_fields, packing, row_major, block_name);
+   const uint32_t hash = record_key_hash(&key);
+   const glsl_type *cached =
+      type_cache_search(&interface_cache, hash, record_key_compare, &key);
+   if (cached != NULL)
+      return cached;
 
    mtx_lock(&glsl_type::hash_mutex);
    assert(glsl_type_users > 0);
@@ -1297,6 +1511,7 @@ glsl_type::get_interface_instance(const glsl_struct_field *fields,
                                          packing, row_major, block_name);
 
       entry = _mesa_hash_table_insert(interface_types, t, (void *) t);
+      type_cache_insert(&interface_cache, hash, t);
    }
 
    assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_INTERFACE);
@@ -1314,6 +1529,11 @@ const glsl_type *
 glsl_type::get_subroutine_instance(const char *subroutine_name)
 {
    const glsl_type key(subroutine_name);
+   const uint32_t hash = record_key_hash(&key);
+   const glsl_type *cached =
+      type_cache_search(&subroutine_cache, hash, record_key_compare, &key);
+   if (cached != NULL)
+      return cached;
 
    mtx_lock(&glsl_type::hash_mutex);
    assert(glsl_type_users > 0);
@@ -1329,6 +1549,7 @@ glsl_type::get_subroutine_instance(const char *subroutine_name)
       const glsl_type *t = new glsl_type(subroutine_name);
 
       entry = _mesa_hash_table_insert(subroutine_types, t, (void *) t);
+      type_cache_insert(&subroutine_cache, hash, t);
    }
 
    assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_SUBROUTINE);
@@ -1370,6 +1591,11 @@ glsl_type::get_function_instance(const glsl_type *return_type,
                                  unsigned num_params)
 {
    const glsl_type key(return_type, params, num_params);
+   const uint32_t hash = function_key_hash(&key);
+   const glsl_type *cached =
+      type_cache_search(&function_cache, hash, function_key_compare, &key);
+   if (cached != NULL)
+      return cached;
 
    mtx_lock(&glsl_type::hash_mutex);
    assert(glsl_type_users > 0);
@@ -1384,6 +1610,7 @@ glsl_type::get_function_instance(const glsl_type *return_type,
       const glsl_type *t = new glsl_type(return_type, params, num_params);
 
       entry = _mesa_hash_table_insert(function_types, t, (void *) t);
+      type_cache_insert(&function_cache, hash, t);
    }
 
    const glsl_type *t = (const glsl_type *)entry->data;
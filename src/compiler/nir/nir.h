@@ -2778,6 +2778,9 @@ typedef struct {
    unsigned num_blocks;
 
    nir_metadata valid_metadata;
+
+   /** State kept between runs of algebraic passes, see algebraic_worklist */
+   struct nir_algebraic_cache *algebraic_cache;
 } nir_function_impl;
 
 #define nir_foreach_function_temp_variable(var, impl) \
@@ -3221,8 +3224,38 @@ typedef struct nir_shader_compiler_options {
    /** Whether 16-bit ALU is supported. */
    bool support_16bit_alu;
 
+   /**
+    * Should algebraic passes only re-match the instructions whose sources or
+    * uses changed since the previous run of the same pass?
+    *
+    * This remembers a signature of each instruction's expression tree, so it
+    * costs some memory per function, but saves most of the matching work
+    * when the pass runs in an optimization loop.
+    */
+   bool algebraic_worklist;
+
    unsigned max_unroll_iterations;
 
+   /**
+    * Optional cost model for nir_opt_loop_unroll.
+    *
+    * Called with a loop whose nir_loop_info is filled out, its known or
+    * guessed trip count (0 if there's none) and what nir_opt_loop_unroll
+    * would do by default.  Returns how many copies of the loop body to make:
+    * the trip count or more unrolls the loop completely, and a smaller
+    * factor N > 1 partially unrolls it into N copies of the body per
+    * iteration, keeping every exit check.  0 leaves the loop alone.
+    *
+    * The default is the trip count for loops small enough to unroll
+    * completely according to max_unroll_iterations, and 0 otherwise, so
+    * loops are never partially unrolled by a factor without a callback.
+    * Loop control pragmas take precedence over the callback, and it may be
+    * called more than once per loop.
+    */
+   unsigned (*loop_unroll_factor)(const struct nir_shader *shader,
+                                  const nir_loop *loop, unsigned trip_count,
+                                  unsigned default_factor);
+
    nir_lower_int64_options lower_int64_options;
    nir_lower_doubles_options lower_doubles_options;
 } nir_shader_compiler_options;
@@ -3296,6 +3329,28 @@ nir_shader *nir_shader_create(void *mem_ctx,
                               const nir_shader_compiler_options *options,
                               shader_info *si);
 
+/** Returns the ralloc context to allocate new IR of the shader from.
+ *
+ * This is the shader itself, except in passes run by
+ * nir_shader_impls_parallel().  Code which allocates IR on the shader
+ * directly, rather than through the nir_*_create() helpers, should use it.
+ */
+void *nir_shader_mem_ctx(void *shader);
+
+typedef bool (*nir_impl_pass_func)(nir_function_impl *impl, void *data);
+
+/** Runs a function-local pass on all impls of the shader in parallel
+ *
+ * The pass may only look at and change its own impl (and things only it
+ * uses, like its locals and registers): it must not add shader variables or
+ * functions, change the shader info or free anything allocated on the
+ * shader.  It also has to preserve the impl's metadata itself.  The number
+ * of threads is set with NIR_PARALLEL_THREADS, which defaults to the number
+ * of CPUs; 1 runs the impls one after the other.
+ */
+bool nir_shader_impls_parallel(nir_shader *shader, nir_impl_pass_func pass,
+                               void *data);
+
 nir_register *nir_local_reg_create(nir_function_impl *impl);
 
 void nir_reg_remove(nir_register *reg);
@@ -3824,6 +3879,40 @@ static inline bool should_serialize_deserialize_nir(void) { return false; }
 static inline bool should_print_nir(void) { return false; }
 #endif /* NDEBUG */
 
+/** NIR pass profiling
+ *
+ * Setting NIR_PASS_PROFILE=<file> records the wall time, the change in
+ * instruction count and the progress of every NIR_PASS and NIR_PASS_V run in
+ * the process, and writes a JSON summary per pass to the file at exit.
+ * NIR_PASS_TRACE=<file> writes every pass run as a Chrome trace event, to be
+ * loaded in chrome://tracing or Perfetto.  A file name of "-" means stderr.
+ *
+ * Unlike the other debug options this is also available in release builds.
+ */
+typedef struct {
+   int64_t start_ns;
+   unsigned num_instrs;
+} nir_pass_profile_sample;
+
+bool nir_pass_profile_init(void);
+void nir_pass_profile_begin(nir_shader *shader,
+                            nir_pass_profile_sample *sample);
+/* progress is -1 if unknown. */
+void nir_pass_profile_end(nir_shader *shader, const char *pass,
+                          const nir_pass_profile_sample *sample, int progress);
+void nir_pass_profile_dump(FILE *fp);
+void nir_pass_profile_reset(void);
+
+static inline bool
+should_profile_nir(void)
+{
+   static int should_profile = -1;
+   if (should_profile < 0)
+      should_profile = nir_pass_profile_init();
+
+   return should_profile;
+}
+
 #define _PASS(pass, nir, do_pass) do {                               \
    if (should_skip_nir(#pass)) {                                     \
       printf("skipping %s\n", #pass);                                \
@@ -3844,7 +3933,14 @@ static inline bool should_print_nir(void) { return false; }
    nir_metadata_set_validation_flag(nir);                            \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
-   if (pass(nir, ##__VA_ARGS__)) {                                   \
+   nir_pass_profile_sample _nir_pass_sample = { 0 };                 \
+   if (should_profile_nir())                                         \
+      nir_pass_profile_begin(nir, &_nir_pass_sample);                \
+   bool _nir_pass_progress = pass(nir, ##__VA_ARGS__);               \
+   if (should_profile_nir())                                         \
+      nir_pass_profile_end(nir, #pass, &_nir_pass_sample,            \
+                           _nir_pass_progress);                      \
+   if (_nir_pass_progress) {                                         \
       progress = true;                                               \
       if (should_print_nir())                                        \
          nir_print_shader(nir, stdout);                              \
@@ -3855,7 +3951,12 @@ static inline bool should_print_nir(void) { return false; }
 #define NIR_PASS_V(nir, pass, ...) _PASS(pass, nir,                  \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
+   nir_pass_profile_sample _nir_pass_sample = { 0 };                 \
+   if (should_profile_nir())                                         \
+      nir_pass_profile_begin(nir, &_nir_pass_sample);                \
    pass(nir, ##__VA_ARGS__);                                         \
+   if (should_profile_nir())                                         \
+      nir_pass_profile_end(nir, #pass, &_nir_pass_sample, -1);       \
    if (should_print_nir())                                           \
       nir_print_shader(nir, stdout);                                 \
 )
@@ -3921,6 +4022,10 @@ nir_block *nir_dominance_lca(nir_block *b1, nir_block *b2);
 bool nir_block_dominates(nir_block *parent, nir_block *child);
 bool nir_block_is_unreachable(nir_block *block);
 
+void nir_dominance_update_cf_insert(nir_cf_node *node);
+void nir_dominance_update_successors(nir_block *block,
+                                     nir_block *const old_succs[2]);
+
 void nir_dump_dom_tree_impl(nir_function_impl *impl, FILE *fp);
 void nir_dump_dom_tree(nir_shader *shader, FILE *fp);
 
@@ -4526,6 +4631,8 @@ bool nir_lower_memory_model(nir_shader *shader);
 bool nir_normalize_cubemap_coords(nir_shader *shader);
 
 void nir_live_ssa_defs_impl(nir_function_impl *impl);
+void nir_live_ssa_defs_update_cf_insert(nir_cf_node *node);
+void nir_live_ssa_defs_update_successors(nir_block *block);
 
 void nir_loop_analyze_impl(nir_function_impl *impl,
                            nir_variable_mode indirect_mask);
@@ -4577,12 +4684,14 @@ bool nir_opt_combine_memory_barriers(nir_shader *shader,
 
 bool nir_opt_combine_stores(nir_shader *shader, nir_variable_mode modes);
 
+bool nir_copy_prop_impl(nir_function_impl *impl);
 bool nir_copy_prop(nir_shader *shader);
 
 bool nir_opt_copy_prop_vars(nir_shader *shader);
 
 bool nir_opt_cse(nir_shader *shader);
 
+bool nir_opt_dce_impl(nir_function_impl *impl);
 bool nir_opt_dce(nir_shader *shader);
 
 bool nir_opt_dead_cf(nir_shader *shader);
@@ -4596,6 +4705,8 @@ bool nir_opt_find_array_copies(nir_shader *shader);
 
 bool nir_opt_gcm(nir_shader *shader, bool value_number);
 
+bool nir_opt_gvn_pre(nir_shader *shader);
+
 bool nir_opt_idiv_const(nir_shader *shader, unsigned min_bit_size);
 
 bool nir_opt_if(nir_shader *shader, bool aggressive_last_continue);
@@ -4636,6 +4747,9 @@ bool nir_opt_trivial_continues(nir_shader *shader);
 
 bool nir_opt_undef(nir_shader *shader);
 
+bool nir_opt_uniform_subgroup(nir_shader *shader,
+                              nir_divergence_options options);
+
 bool nir_opt_vectorize(nir_shader *shader);
 
 bool nir_opt_conditional_discard(nir_shader *shader);
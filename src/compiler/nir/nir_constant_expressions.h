@@ -35,4 +35,33 @@ void nir_eval_const_opcode(nir_op op, nir_const_value *dest,
                            nir_const_value **src,
                            unsigned float_controls_execution_mode);
 
+/* Returns true if every component of the result only depends on the same
+ * component of the sources, so nir_eval_const_opcode_batch can be used.
+ */
+static inline bool
+nir_op_is_per_component(nir_op op)
+{
+   const nir_op_info *info = &nir_op_infos[op];
+
+   if (info->output_size != 0)
+      return false;
+
+   for (unsigned i = 0; i < info->num_inputs; i++) {
+      if (info->input_sizes[i] != 0)
+         return false;
+   }
+
+   return true;
+}
+
+/* Evaluates a per-component opcode on count lanes at once.  Each of the src
+ * arrays and dest have to hold count values, which may be more than
+ * NIR_MAX_VEC_COMPONENTS.  This only dispatches on the opcode and bit size
+ * once, instead of once per call of nir_eval_const_opcode.
+ */
+void nir_eval_const_opcode_batch(nir_op op, nir_const_value *dest,
+                                 unsigned count, unsigned bit_size,
+                                 nir_const_value **src,
+                                 unsigned float_controls_execution_mode);
+
 #endif /* NIR_CONSTANT_EXPRESSIONS_H */
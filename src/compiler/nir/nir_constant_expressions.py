@@ -499,6 +499,28 @@ nir_eval_const_opcode(nir_op op, nir_const_value *dest,
    default:
       unreachable("shouldn't get here");
    }
+}
+
+void
+nir_eval_const_opcode_batch(nir_op op, nir_const_value *dest,
+                            unsigned count, unsigned bit_width,
+                            nir_const_value **src,
+                            unsigned float_controls_execution_mode)
+{
+   /* Per-component opcodes evaluate lane _i from lane _i of every source, so
+    * any number of lanes can go through a single call.
+    */
+   switch (op) {
+% for name, op in sorted(opcodes.items()):
+   % if op.output_size == 0 and all(size == 0 for size in op.input_sizes):
+   case nir_op_${name}:
+      evaluate_${name}(dest, count, bit_width, src, float_controls_execution_mode);
+      return;
+   % endif
+% endfor
+   default:
+      unreachable("opcode is not per-component");
+   }
 }"""
 
 from mako.template import Template
@@ -605,7 +605,7 @@ static bool
 replace_ssa_def_uses(nir_ssa_def *def, void *void_impl)
 {
    nir_function_impl *impl = void_impl;
-   void *mem_ctx = ralloc_parent(impl);
+   void *mem_ctx = nir_shader_mem_ctx(ralloc_parent(impl));
 
    nir_ssa_undef_instr *undef =
       nir_ssa_undef_instr_create(mem_ctx, def->num_components,
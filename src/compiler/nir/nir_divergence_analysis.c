@@ -450,13 +450,11 @@ visit_intrinsic(nir_intrinsic_instr *instr, struct divergence_state *state)
       break;
 
    default:
-#ifdef NDEBUG
+      /* Driver-specific intrinsics are mostly unknown here, so be
+       * conservative about them.
+       */
       is_divergent = true;
       break;
-#else
-      nir_print_instr(&instr->instr, stderr);
-      unreachable("\nNIR divergence analysis: Unhandled intrinsic.");
-#endif
    }
 
    instr->dest.ssa.divergent = is_divergent;
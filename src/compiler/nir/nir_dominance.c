@@ -33,13 +33,9 @@
  * Harvey, and Kennedy.
  */
 
-static bool
-init_block(nir_block *block, nir_function_impl *impl)
+static void
+clear_dom_tree(nir_block *block)
 {
-   if (block == nir_start_block(impl))
-      block->imm_dom = block;
-   else
-      block->imm_dom = NULL;
    block->num_dom_children = 0;
 
    /* See nir_block_dominates */
@@ -49,6 +45,17 @@ init_block(nir_block *block, nir_function_impl *impl)
    set_foreach(block->dom_frontier, entry) {
       _mesa_set_remove(block->dom_frontier, entry);
    }
+}
+
+static bool
+init_block(nir_block *block, nir_function_impl *impl)
+{
+   if (block == nir_start_block(impl))
+      block->imm_dom = block;
+   else
+      block->imm_dom = NULL;
+
+   clear_dom_tree(block);
 
    return true;
 }
@@ -129,7 +136,7 @@ calc_dom_frontier(nir_block *block)
 static void
 calc_dom_children(nir_function_impl* impl)
 {
-   void *mem_ctx = ralloc_parent(impl);
+   void *mem_ctx = nir_shader_mem_ctx(ralloc_parent(impl));
 
    nir_foreach_block(block, impl) {
       if (block->imm_dom)
@@ -161,6 +168,27 @@ calc_dfs_indicies(nir_block *block, unsigned *index)
    block->dom_post_index = (*index)++;
 }
 
+/*
+ * Computes everything else from the immediate dominators.  The start block
+ * has to be its own immediate dominator on entry, so that it isn't mistaken
+ * for an unreachable predecessor.
+ */
+static void
+calc_dom_tree(nir_function_impl *impl)
+{
+   nir_foreach_block(block, impl) {
+      calc_dom_frontier(block);
+   }
+
+   nir_block *start_block = nir_start_block(impl);
+   start_block->imm_dom = NULL;
+
+   calc_dom_children(impl);
+
+   unsigned dfs_index = 0;
+   calc_dfs_indicies(start_block, &dfs_index);
+}
+
 void
 nir_calc_dominance_impl(nir_function_impl *impl)
 {
@@ -183,26 +211,166 @@ nir_calc_dominance_impl(nir_function_impl *impl)
       }
    }
 
-   nir_foreach_block(block, impl) {
-      calc_dom_frontier(block);
+   calc_dom_tree(impl);
+}
+
+void
+nir_calc_dominance(nir_shader *shader)
+{
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         nir_calc_dominance_impl(function->impl);
    }
+}
+
+static void
+mark_dom_subtree(nir_block *block, BITSET_WORD *region)
+{
+   BITSET_SET(region, block->index);
+
+   for (unsigned i = 0; i < block->num_dom_children; i++)
+      mark_dom_subtree(block->dom_children[i], region);
+}
+
+/*
+ * Recomputes the immediate dominators of the blocks in the old dominance
+ * subtree of root, plus any blocks which were added or were unreachable.
+ * The caller guarantees that the CFG edits didn't change the immediate
+ * dominator of any other block, including root.
+ */
+static void
+update_dominance_region(nir_function_impl *impl, nir_block *root)
+{
+   /* Blocks may have been added, so re-index.  This keeps the reverse
+    * post-order which intersect() relies on.
+    */
+   impl->valid_metadata &= ~nir_metadata_block_index;
+   nir_metadata_require(impl, nir_metadata_block_index);
+
+   BITSET_WORD *region = rzalloc_array(NULL, BITSET_WORD,
+                                       BITSET_WORDS(impl->num_blocks));
+   mark_dom_subtree(root, region);
 
    nir_block *start_block = nir_start_block(impl);
-   start_block->imm_dom = NULL;
+   nir_foreach_block(block, impl) {
+      if (block != start_block && block->imm_dom == NULL)
+         BITSET_SET(region, block->index);
+   }
+   BITSET_CLEAR(region, root->index);
 
-   calc_dom_children(impl);
+   nir_foreach_block(block, impl) {
+      if (BITSET_TEST(region, block->index))
+         block->imm_dom = NULL;
+      clear_dom_tree(block);
+   }
+   start_block->imm_dom = start_block;
 
-   unsigned dfs_index = 0;
-   calc_dfs_indicies(start_block, &dfs_index);
+   bool progress = true;
+   while (progress) {
+      progress = false;
+      nir_foreach_block(block, impl) {
+         if (BITSET_TEST(region, block->index))
+            progress |= calc_dominance(block);
+      }
+   }
+
+   ralloc_free(region);
+
+   calc_dom_tree(impl);
+
+   impl->valid_metadata |= nir_metadata_dominance;
 }
 
+static void
+recalc_dominance(nir_function_impl *impl)
+{
+   impl->valid_metadata &= ~(nir_metadata_block_index |
+                             nir_metadata_dominance);
+   nir_metadata_require(impl, nir_metadata_block_index |
+                              nir_metadata_dominance);
+}
+
+/**
+ * Updates the dominance information after a control flow node was inserted
+ * into the middle of a block, splitting it in two.  The node must not
+ * contain any jumps; if it does, everything is recomputed.
+ *
+ * The dominance information must have been valid before the edit, and is
+ * valid again afterwards along with the block indices, even though the
+ * control flow code marked it invalid.
+ */
 void
-nir_calc_dominance(nir_shader *shader)
+nir_dominance_update_cf_insert(nir_cf_node *node)
 {
-   nir_foreach_function(function, shader) {
-      if (function->impl)
-         nir_calc_dominance_impl(function->impl);
+   nir_function_impl *impl = nir_cf_node_get_function(node);
+
+   nir_foreach_block_in_cf_node(block, node) {
+      if (nir_block_ends_in_jump(block)) {
+         recalc_dominance(impl);
+         return;
+      }
+   }
+
+   /* One of the two halves is the original block and the other one is new,
+    * with no dominance information yet.  If the original block is the top
+    * half it still has the same immediate dominator, otherwise the original
+    * block's immediate dominator does.
+    */
+   nir_block *before = nir_cf_node_as_block(nir_cf_node_prev(node));
+   nir_block *after = nir_cf_node_as_block(nir_cf_node_next(node));
+   nir_block *root;
+   if (before == nir_start_block(impl) || before->imm_dom)
+      root = before;
+   else if (after->imm_dom)
+      root = after->imm_dom;
+   else {
+      /* The split block was unreachable. */
+      recalc_dominance(impl);
+      return;
    }
+
+   update_dominance_region(impl, root);
+}
+
+/**
+ * Updates the dominance information after the successors of block changed,
+ * e.g. because a jump was added or removed.  old_succs are the successors
+ * it had before.  No blocks may have been added or removed, and the
+ * dominance information and block indices must have been valid before.
+ *
+ * Every block whose immediate dominator changes is dominated by the nearest
+ * common dominator of the endpoints of the changed edges, so only that part
+ * of the tree is recomputed.
+ */
+void
+nir_dominance_update_successors(nir_block *block,
+                                nir_block *const old_succs[2])
+{
+   nir_function_impl *impl = nir_cf_node_get_function(&block->cf_node);
+   nir_block *start_block = nir_start_block(impl);
+
+   nir_block *const blocks[] = {
+      block, block->successors[0], block->successors[1],
+      old_succs[0], old_succs[1],
+   };
+
+   nir_block *root = NULL;
+   for (unsigned i = 0; i < ARRAY_SIZE(blocks); i++) {
+      if (blocks[i] == NULL || blocks[i] == impl->end_block ||
+          (blocks[i] != start_block && blocks[i]->imm_dom == NULL))
+         continue;
+
+      root = root ? intersect(root, blocks[i]) : blocks[i];
+   }
+
+   /* Only unreachable blocks were involved, nothing changed. */
+   if (root == NULL) {
+      impl->valid_metadata |= nir_metadata_block_index |
+                              nir_metadata_dominance;
+      return;
+   }
+
+   update_dominance_region(impl, root);
 }
 
 static nir_block *
@@ -27,6 +27,8 @@
 #include "nir.h"
 #include "nir_worklist.h"
 #include "nir_vla.h"
+#include "util/set.h"
+#include "util/u_dynarray.h"
 
 /*
  * Basic liveness analysis.  This works only in SSA form.
@@ -233,6 +235,258 @@ nir_live_ssa_defs_impl(nir_function_impl *impl)
    nir_block_worklist_fini(&state.worklist);
 }
 
+/*
+ * Incremental updates.
+ *
+ * Rather than rerunning the data-flow analysis over the whole function, the
+ * liveness of each SSA def which may be affected by an edit is recomputed
+ * on its own by walking backwards from its uses to its definition.  That
+ * gives exactly the same sets nir_live_ssa_defs_impl() does.  The existing
+ * live indices are reused, so the edits must not add SSA defs.
+ */
+
+struct live_mark {
+   nir_block *block;
+   bool live_out;
+};
+
+static void
+push_live_mark(struct util_dynarray *stack, nir_block *block, bool live_out)
+{
+   struct live_mark mark = { block, live_out };
+   util_dynarray_append(stack, struct live_mark, mark);
+}
+
+static void
+update_def_liveness(nir_function_impl *impl, nir_ssa_def *def,
+                    struct util_dynarray *stack)
+{
+   const unsigned idx = def->live_index;
+   nir_block *def_block = def->parent_instr->block;
+
+   /* Phi destinations live between blocks, so they are in the live-in of
+    * the block they're in.  Anything else is killed by its definition.
+    */
+   const bool is_phi = def->parent_instr->type == nir_instr_type_phi;
+
+   nir_foreach_block(block, impl) {
+      BITSET_CLEAR(block->live_in, idx);
+      BITSET_CLEAR(block->live_out, idx);
+   }
+
+   nir_foreach_use(use, def) {
+      if (use->parent_instr->type == nir_instr_type_phi) {
+         nir_phi_src *phi_src = exec_node_data(nir_phi_src, use, src);
+         push_live_mark(stack, phi_src->pred, true);
+      } else if (use->parent_instr->block != def_block || is_phi) {
+         push_live_mark(stack, use->parent_instr->block, false);
+      }
+   }
+
+   nir_foreach_if_use(use, def) {
+      nir_block *block =
+         nir_cf_node_as_block(nir_cf_node_prev(&use->parent_if->cf_node));
+      if (block != def_block || is_phi)
+         push_live_mark(stack, block, false);
+   }
+
+   while (util_dynarray_num_elements(stack, struct live_mark) > 0) {
+      struct live_mark mark = util_dynarray_pop(stack, struct live_mark);
+      nir_block *block = mark.block;
+
+      if (mark.live_out) {
+         if (BITSET_TEST(block->live_out, idx))
+            continue;
+
+         BITSET_SET(block->live_out, idx);
+         if (block != def_block || is_phi)
+            push_live_mark(stack, block, false);
+      } else {
+         if (BITSET_TEST(block->live_in, idx))
+            continue;
+
+         BITSET_SET(block->live_in, idx);
+         if (block == def_block)
+            continue;
+
+         set_foreach(block->predecessors, entry)
+            push_live_mark(stack, (nir_block *)entry->key, true);
+      }
+   }
+}
+
+static bool
+max_live_index(nir_ssa_def *def, void *_max)
+{
+   unsigned *max = _max;
+   *max = MAX2(*max, def->live_index);
+   return true;
+}
+
+static unsigned
+live_ssa_defs_words(nir_function_impl *impl)
+{
+   unsigned max = 0;
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, max_live_index, &max);
+   }
+
+   return BITSET_WORDS(max + 1);
+}
+
+static bool
+use_in_blocks(nir_ssa_def *def, struct set *blocks)
+{
+   nir_foreach_use(use, def) {
+      nir_block *block = use->parent_instr->block;
+      if (use->parent_instr->type == nir_instr_type_phi)
+         block = exec_node_data(nir_phi_src, use, src)->pred;
+
+      if (_mesa_set_search(blocks, block))
+         return true;
+   }
+
+   nir_foreach_if_use(use, def) {
+      nir_block *block =
+         nir_cf_node_as_block(nir_cf_node_prev(&use->parent_if->cf_node));
+      if (_mesa_set_search(blocks, block))
+         return true;
+   }
+
+   return false;
+}
+
+struct update_liveness_state {
+   nir_function_impl *impl;
+
+   /* SSA defs which were live around the edit */
+   const BITSET_WORD *live;
+
+   /* Blocks touched by the edit */
+   struct set *blocks;
+
+   struct util_dynarray stack;
+};
+
+static bool
+update_ssa_def_liveness(nir_ssa_def *def, void *void_state)
+{
+   struct update_liveness_state *state = void_state;
+
+   if (def->live_index == 0)
+      return true;
+
+   if (BITSET_TEST(state->live, def->live_index) ||
+       _mesa_set_search(state->blocks, def->parent_instr->block) ||
+       use_in_blocks(def, state->blocks))
+      update_def_liveness(state->impl, def, &state->stack);
+
+   return true;
+}
+
+static void
+update_liveness(nir_function_impl *impl, const BITSET_WORD *live,
+                struct set *blocks)
+{
+   struct update_liveness_state state = {
+      .impl = impl,
+      .live = live,
+      .blocks = blocks,
+   };
+   util_dynarray_init(&state.stack, NULL);
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, update_ssa_def_liveness, &state);
+   }
+
+   util_dynarray_fini(&state.stack);
+
+   impl->valid_metadata |= nir_metadata_live_ssa_defs;
+}
+
+/**
+ * Updates the liveness information after a control flow node was inserted
+ * into the middle of a block, splitting it in two.  The node may contain
+ * instructions moved out of the split block, as long as they stay in the
+ * same order, but no new SSA defs.
+ *
+ * The liveness information must have been valid before the edit, and is
+ * valid again afterwards.
+ */
+void
+nir_live_ssa_defs_update_cf_insert(nir_cf_node *node)
+{
+   nir_function_impl *impl = nir_cf_node_get_function(node);
+   const unsigned words = live_ssa_defs_words(impl);
+
+   nir_block *before = nir_cf_node_as_block(nir_cf_node_prev(node));
+   nir_block *after = nir_cf_node_as_block(nir_cf_node_next(node));
+   nir_block *orig = before->live_in ? before : after;
+   assert(orig->live_in);
+
+   BITSET_WORD *live = ralloc_array(NULL, BITSET_WORD, words);
+   for (unsigned i = 0; i < words; i++)
+      live[i] = orig->live_in[i] | orig->live_out[i];
+
+   struct set *blocks = _mesa_pointer_set_create(NULL);
+   _mesa_set_add(blocks, before);
+   _mesa_set_add(blocks, after);
+   nir_foreach_block_in_cf_node(block, node) {
+      _mesa_set_add(blocks, block);
+   }
+
+   set_foreach(blocks, entry) {
+      nir_block *block = (nir_block *)entry->key;
+      if (block->live_in == NULL) {
+         block->live_in = rzalloc_array(block, BITSET_WORD, words);
+         block->live_out = rzalloc_array(block, BITSET_WORD, words);
+      }
+   }
+
+   update_liveness(impl, live, blocks);
+
+   _mesa_set_destroy(blocks, NULL);
+   ralloc_free(live);
+}
+
+/**
+ * Updates the liveness information after the successors of block changed,
+ * e.g. because a jump was added or removed.  No blocks may have been added,
+ * and the liveness information must have been valid before.
+ */
+void
+nir_live_ssa_defs_update_successors(nir_block *block)
+{
+   nir_function_impl *impl = nir_cf_node_get_function(&block->cf_node);
+   const unsigned words = live_ssa_defs_words(impl);
+
+   /* Whatever was live out of the block might not be anymore, and whatever
+    * is live into the new successors might now be live out of it.
+    */
+   BITSET_WORD *live = ralloc_array(NULL, BITSET_WORD, words);
+   memcpy(live, block->live_out, words * sizeof(BITSET_WORD));
+
+   struct set *blocks = _mesa_pointer_set_create(NULL);
+   _mesa_set_add(blocks, block);
+
+   for (unsigned i = 0; i < 2; i++) {
+      nir_block *succ = block->successors[i];
+      if (succ == NULL || succ == impl->end_block)
+         continue;
+
+      for (unsigned w = 0; w < words; w++)
+         live[w] |= succ->live_in[w];
+      _mesa_set_add(blocks, succ);
+   }
+
+   update_liveness(impl, live, blocks);
+
+   _mesa_set_destroy(blocks, NULL);
+   ralloc_free(live);
+}
+
 static bool
 src_does_not_use_def(nir_src *src, void *def)
 {
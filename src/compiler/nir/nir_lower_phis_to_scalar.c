@@ -281,7 +281,7 @@ lower_phis_to_scalar_impl(nir_function_impl *impl)
    struct lower_phis_to_scalar_state state;
    bool progress = false;
 
-   state.mem_ctx = ralloc_parent(impl);
+   state.mem_ctx = nir_shader_mem_ctx(ralloc_parent(impl));
    state.dead_ctx = ralloc_context(NULL);
    state.phi_table = _mesa_pointer_hash_table_create(state.dead_ctx);
 
@@ -32,21 +32,137 @@
  * Implements SSA-based constant folding.
  */
 
+#define FOLD_BATCH_LANES 64
+
+/* A run of instructions with the same per-component opcode and bit size.
+ * Their sources are gathered into flat arrays so that they can be evaluated
+ * with a single call to nir_eval_const_opcode_batch.
+ */
+struct fold_batch {
+   nir_op op;
+   unsigned bit_size;
+   unsigned num_instrs;
+   unsigned num_lanes;
+   nir_alu_instr *instrs[FOLD_BATCH_LANES];
+   nir_const_value src[NIR_MAX_VEC_COMPONENTS][FOLD_BATCH_LANES];
+   nir_const_value dest[FOLD_BATCH_LANES];
+};
+
 struct constant_fold_state {
    nir_shader *shader;
    unsigned execution_mode;
    bool has_load_constant;
    bool has_indirect_load_const;
+   struct fold_batch batch;
 };
 
+static void
+replace_alu_with_constant(struct constant_fold_state *state,
+                          nir_alu_instr *instr, const nir_const_value *dest)
+{
+   nir_load_const_instr *new_instr =
+      nir_load_const_instr_create(state->shader,
+                                  instr->dest.dest.ssa.num_components,
+                                  instr->dest.dest.ssa.bit_size);
+
+   memcpy(new_instr->value, dest, sizeof(*new_instr->value) * new_instr->def.num_components);
+
+   nir_instr_insert_before(&instr->instr, &new_instr->instr);
+
+   nir_ssa_def_rewrite_uses(&instr->dest.dest.ssa,
+                            nir_src_for_ssa(&new_instr->def));
+
+   nir_instr_remove(&instr->instr);
+   ralloc_free(instr);
+}
+
+static void
+flush_batch(struct constant_fold_state *state)
+{
+   struct fold_batch *batch = &state->batch;
+
+   if (batch->num_instrs == 0)
+      return;
+
+   nir_const_value *srcs[NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < nir_op_infos[batch->op].num_inputs; ++i)
+      srcs[i] = batch->src[i];
+
+   memset(batch->dest, 0, sizeof(*batch->dest) * batch->num_lanes);
+   nir_eval_const_opcode_batch(batch->op, batch->dest, batch->num_lanes,
+                               batch->bit_size, srcs, state->execution_mode);
+
+   unsigned lane = 0;
+   for (unsigned i = 0; i < batch->num_instrs; i++) {
+      nir_alu_instr *instr = batch->instrs[i];
+      const unsigned num_components = instr->dest.dest.ssa.num_components;
+
+      replace_alu_with_constant(state, instr, &batch->dest[lane]);
+      lane += num_components;
+   }
+
+   batch->num_instrs = 0;
+   batch->num_lanes = 0;
+}
+
+/* Returns true if one of the sources is computed by an instruction which is
+ * waiting in the batch.
+ */
 static bool
-constant_fold_alu_instr(struct constant_fold_state *state, nir_alu_instr *instr)
+uses_batch(const nir_alu_instr *instr)
 {
-   nir_const_value src[NIR_MAX_VEC_COMPONENTS][NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++) {
+      if (!instr->src[i].src.is_ssa)
+         continue;
+
+      const nir_instr *src_instr = instr->src[i].src.ssa->parent_instr;
+      if (src_instr->type == nir_instr_type_alu && src_instr->pass_flags)
+         return true;
+   }
+
+   return false;
+}
+
+static void
+add_to_batch(struct constant_fold_state *state, nir_alu_instr *instr,
+             unsigned bit_size)
+{
+   struct fold_batch *batch = &state->batch;
+   const unsigned num_components = instr->dest.dest.ssa.num_components;
+
+   if (batch->num_instrs > 0 &&
+       (batch->op != instr->op || batch->bit_size != bit_size ||
+        batch->num_lanes + num_components > FOLD_BATCH_LANES))
+      flush_batch(state);
 
+   batch->op = instr->op;
+   batch->bit_size = bit_size;
+
+   for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++) {
+      nir_load_const_instr *load_const =
+         nir_instr_as_load_const(instr->src[i].src.ssa->parent_instr);
+
+      for (unsigned j = 0; j < num_components; j++) {
+         batch->src[i][batch->num_lanes + j] =
+            load_const->value[instr->src[i].swizzle[j]];
+      }
+   }
+
+   instr->instr.pass_flags = 1;
+   batch->instrs[batch->num_instrs++] = instr;
+   batch->num_lanes += num_components;
+}
+
+static bool
+constant_fold_alu_instr(struct constant_fold_state *state, nir_alu_instr *instr)
+{
    if (!instr->dest.dest.is_ssa)
       return false;
 
+   /* Sources folded by the batch only become constant once it is flushed. */
+   if (uses_batch(instr))
+      flush_batch(state);
+
    /* In the case that any outputs/inputs have unsized types, then we need to
     * guess the bit-size. In this case, the validator ensures that all
     * bit-sizes match so we can just take the bit-size from first
@@ -72,12 +188,6 @@ constant_fold_alu_instr(struct constant_fold_state *state, nir_alu_instr *instr)
 
       if (src_instr->type != nir_instr_type_load_const)
          return false;
-      nir_load_const_instr* load_const = nir_instr_as_load_const(src_instr);
-
-      for (unsigned j = 0; j < nir_ssa_alu_instr_src_components(instr, i);
-           j++) {
-         src[i][j] = load_const->value[instr->src[i].swizzle[j]];
-      }
 
       /* We shouldn't have any source modifiers in the optimization loop. */
       assert(!instr->src[i].abs && !instr->src[i].negate);
@@ -89,6 +199,22 @@ constant_fold_alu_instr(struct constant_fold_state *state, nir_alu_instr *instr)
    /* We shouldn't have any saturate modifiers in the optimization loop. */
    assert(!instr->dest.saturate);
 
+   if (nir_op_is_per_component(instr->op)) {
+      add_to_batch(state, instr, bit_size);
+      return true;
+   }
+
+   nir_const_value src[NIR_MAX_VEC_COMPONENTS][NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++) {
+      nir_load_const_instr *load_const =
+         nir_instr_as_load_const(instr->src[i].src.ssa->parent_instr);
+
+      for (unsigned j = 0; j < nir_ssa_alu_instr_src_components(instr, i);
+           j++) {
+         src[i][j] = load_const->value[instr->src[i].swizzle[j]];
+      }
+   }
+
    nir_const_value dest[NIR_MAX_VEC_COMPONENTS];
    nir_const_value *srcs[NIR_MAX_VEC_COMPONENTS];
    memset(dest, 0, sizeof(dest));
@@ -97,20 +223,7 @@ constant_fold_alu_instr(struct constant_fold_state *state, nir_alu_instr *instr)
    nir_eval_const_opcode(instr->op, dest, instr->dest.dest.ssa.num_components,
                          bit_size, srcs, state->execution_mode);
 
-   nir_load_const_instr *new_instr =
-      nir_load_const_instr_create(state->shader,
-                                  instr->dest.dest.ssa.num_components,
-                                  instr->dest.dest.ssa.bit_size);
-
-   memcpy(new_instr->value, dest, sizeof(*new_instr->value) * new_instr->def.num_components);
-
-   nir_instr_insert_before(&instr->instr, &new_instr->instr);
-
-   nir_ssa_def_rewrite_uses(&instr->dest.dest.ssa,
-                            nir_src_for_ssa(&new_instr->def));
-
-   nir_instr_remove(&instr->instr);
-   ralloc_free(instr);
+   replace_alu_with_constant(state, instr, dest);
 
    return true;
 }
@@ -193,9 +306,11 @@ constant_fold_block(struct constant_fold_state *state, nir_block *block)
    nir_foreach_instr_safe(instr, block) {
       switch (instr->type) {
       case nir_instr_type_alu:
+         instr->pass_flags = 0;
          progress |= constant_fold_alu_instr(state, nir_instr_as_alu(instr));
          break;
       case nir_instr_type_intrinsic:
+         flush_batch(state);
          progress |=
             constant_fold_intrinsic_instr(state, nir_instr_as_intrinsic(instr));
          break;
@@ -205,6 +320,8 @@ constant_fold_block(struct constant_fold_state *state, nir_block *block)
       }
    }
 
+   flush_batch(state);
+
    return progress;
 }
 
@@ -236,6 +353,8 @@ nir_opt_constant_folding(nir_shader *shader)
    state.execution_mode = shader->info.float_controls_execution_mode;
    state.has_load_constant = false;
    state.has_indirect_load_const = false;
+   state.batch.num_instrs = 0;
+   state.batch.num_lanes = 0;
 
    nir_foreach_function(function, shader) {
       if (function->impl)
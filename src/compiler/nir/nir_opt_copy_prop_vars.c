@@ -1171,7 +1171,7 @@ copy_prop_vars_cf_node(struct copy_prop_var_state *state,
 static bool
 nir_copy_prop_vars_impl(nir_function_impl *impl)
 {
-   void *mem_ctx = ralloc_context(NULL);
+   void *mem_ctx = ralloc_arena_context(NULL);
 
    if (debug) {
       nir_metadata_require(impl, nir_metadata_block_index);
@@ -253,7 +253,7 @@ remove_dead_write_vars_impl(void *mem_ctx, nir_function_impl *impl)
 bool
 nir_opt_dead_write_vars(nir_shader *shader)
 {
-   void *mem_ctx = ralloc_context(NULL);
+   void *mem_ctx = ralloc_arena_context(NULL);
    bool progress = false;
 
    nir_foreach_function(function, shader) {
@@ -0,0 +1,283 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_instr_set.h"
+
+/*
+ * Partial redundancy elimination across if-statements.
+ *
+ * nir_opt_cse only removes an expression if an identical one dominates it.
+ * That misses the common case of an expression which is computed in one or
+ * both arms of an if and again after it:
+ *
+ *    if (c) {
+ *       a = x * y;
+ *       ...
+ *    } else {
+ *       ...
+ *    }
+ *    b = x * y;
+ *
+ * Here "b" is partially redundant: it's only recomputed on the then path.
+ * We make it fully redundant by computing it at the end of the else arm as
+ * well, and replace it with a phi of the two, so no path executes more
+ * instructions than before and the then path executes one fewer.  If both
+ * arms already compute it, only the phi is needed.
+ *
+ * Sources which are phis of the merge block are translated to the phi's
+ * source for each arm, so chains of expressions are handled in one go: once
+ * "b" has become a phi, "b + z" can find "a + z" in the then arm.
+ *
+ * Only ALU instructions in the block following the if are considered, and
+ * only arms which fall through to it.  Only expressions computed in the
+ * top-level blocks of an arm are found, since those dominate its end.
+ */
+
+struct arm_state {
+   nir_block *last_block;
+
+   /* ALU instructions in the top-level blocks of the arm */
+   struct set *instrs;
+};
+
+static bool
+alu_is_ssa(const nir_alu_instr *alu)
+{
+   if (!alu->dest.dest.is_ssa)
+      return false;
+
+   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+      if (!alu->src[i].src.is_ssa)
+         return false;
+   }
+
+   return true;
+}
+
+static bool
+alu_can_move(const nir_alu_instr *alu)
+{
+   switch (alu->op) {
+   /* Derivatives can't be moved into non-uniform control flow. */
+   case nir_op_fddx:
+   case nir_op_fddy:
+   case nir_op_fddx_fine:
+   case nir_op_fddy_fine:
+   case nir_op_fddx_coarse:
+   case nir_op_fddy_coarse:
+      return false;
+   default:
+      return nir_op_infos[alu->op].num_inputs > 0 && alu_is_ssa(alu);
+   }
+}
+
+static void
+init_arm(struct arm_state *arm, struct exec_list *cf_list, void *mem_ctx)
+{
+   arm->last_block = nir_cf_node_as_block(
+      exec_node_data(nir_cf_node, exec_list_get_tail(cf_list), node));
+   arm->instrs = nir_instr_set_create(mem_ctx);
+
+   foreach_list_typed(nir_cf_node, node, node, cf_list) {
+      if (node->type != nir_cf_node_block)
+         continue;
+
+      nir_foreach_instr(instr, nir_cf_node_as_block(node)) {
+         if (instr->type == nir_instr_type_alu &&
+             alu_is_ssa(nir_instr_as_alu(instr)))
+            _mesa_set_add(arm->instrs, instr);
+      }
+   }
+}
+
+/* Returns the value of def at the end of the arm ending in pred, or NULL if
+ * it's not available there.
+ */
+static nir_ssa_def *
+translate_def(nir_ssa_def *def, nir_block *block, nir_block *pred,
+              nir_block *if_block)
+{
+   nir_instr *parent = def->parent_instr;
+
+   if (parent->block == block) {
+      if (parent->type != nir_instr_type_phi)
+         return NULL;
+
+      nir_foreach_phi_src(src, nir_instr_as_phi(parent)) {
+         if (src->pred == pred)
+            return src->src.is_ssa ? src->src.ssa : NULL;
+      }
+
+      return NULL;
+   }
+
+   return nir_block_dominates(parent->block, if_block) ? def : NULL;
+}
+
+/* Creates a copy of alu with its sources translated to the end of the arm,
+ * without inserting it.
+ */
+static nir_alu_instr *
+translate_alu(nir_shader *shader, nir_alu_instr *alu, nir_block *pred,
+              nir_block *if_block)
+{
+   nir_alu_instr *copy = nir_alu_instr_create(shader, alu->op);
+   copy->exact = alu->exact;
+   copy->no_signed_wrap = alu->no_signed_wrap;
+   copy->no_unsigned_wrap = alu->no_unsigned_wrap;
+   copy->dest.write_mask = alu->dest.write_mask;
+   copy->dest.saturate = alu->dest.saturate;
+   nir_ssa_dest_init(&copy->instr, &copy->dest.dest,
+                     alu->dest.dest.ssa.num_components,
+                     alu->dest.dest.ssa.bit_size, NULL);
+
+   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+      nir_ssa_def *def = translate_def(alu->src[i].src.ssa, alu->instr.block,
+                                       pred, if_block);
+      if (def == NULL) {
+         ralloc_free(copy);
+         return NULL;
+      }
+
+      copy->src[i] = alu->src[i];
+      copy->src[i].src = nir_src_for_ssa(def);
+   }
+
+   return copy;
+}
+
+static nir_alu_instr *
+find_in_arm(struct arm_state *arm, nir_alu_instr *copy)
+{
+   struct set_entry *entry = _mesa_set_search(arm->instrs, &copy->instr);
+   return entry ? nir_instr_as_alu((nir_instr *)entry->key) : NULL;
+}
+
+static bool
+opt_gvn_pre_if(nir_builder *b, nir_if *nif)
+{
+   nir_block *if_block = nir_cf_node_as_block(nir_cf_node_prev(&nif->cf_node));
+   nir_block *block = nir_cf_node_as_block(nir_cf_node_next(&nif->cf_node));
+
+   if (nir_block_ends_in_jump(nir_if_last_then_block(nif)) ||
+       nir_block_ends_in_jump(nir_if_last_else_block(nif)))
+      return false;
+
+   void *mem_ctx = ralloc_context(NULL);
+   struct arm_state arms[2];
+   init_arm(&arms[0], &nif->then_list, mem_ctx);
+   init_arm(&arms[1], &nif->else_list, mem_ctx);
+
+   bool progress = false;
+
+   nir_foreach_instr_safe(instr, block) {
+      if (instr->type != nir_instr_type_alu)
+         continue;
+
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      if (!alu_can_move(alu))
+         continue;
+
+      nir_alu_instr *copies[2], *found[2];
+      for (unsigned i = 0; i < 2; i++) {
+         copies[i] = translate_alu(b->shader, alu, arms[i].last_block,
+                                   if_block);
+         found[i] = copies[i] ? find_in_arm(&arms[i], copies[i]) : NULL;
+      }
+
+      if (copies[0] == NULL || copies[1] == NULL ||
+          (found[0] == NULL && found[1] == NULL)) {
+         for (unsigned i = 0; i < 2; i++)
+            ralloc_free(copies[i]);
+         continue;
+      }
+
+      nir_ssa_def *defs[2];
+      for (unsigned i = 0; i < 2; i++) {
+         if (found[i]) {
+            /* Same as in nir_instr_set_add_or_rewrite() */
+            if (alu->exact)
+               found[i]->exact = true;
+            defs[i] = &found[i]->dest.dest.ssa;
+            ralloc_free(copies[i]);
+         } else {
+            b->cursor = nir_after_block(arms[i].last_block);
+            nir_builder_instr_insert(b, &copies[i]->instr);
+            _mesa_set_add(arms[i].instrs, &copies[i]->instr);
+            defs[i] = &copies[i]->dest.dest.ssa;
+         }
+      }
+
+      b->cursor = nir_before_block(block);
+      nir_ssa_def *phi = nir_if_phi(b, defs[0], defs[1]);
+      nir_ssa_def_rewrite_uses(&alu->dest.dest.ssa, nir_src_for_ssa(phi));
+      nir_instr_remove(instr);
+      progress = true;
+   }
+
+   ralloc_free(mem_ctx);
+
+   return progress;
+}
+
+static bool
+nir_opt_gvn_pre_impl(nir_function_impl *impl)
+{
+   bool progress = false;
+
+   nir_metadata_require(impl, nir_metadata_block_index |
+                              nir_metadata_dominance);
+
+   nir_builder b;
+   nir_builder_init(&b, impl);
+
+   nir_foreach_block(block, impl) {
+      nir_if *nif = nir_block_get_following_if(block);
+      if (nif)
+         progress |= opt_gvn_pre_if(&b, nif);
+   }
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   } else {
+      nir_metadata_preserve(impl, nir_metadata_all);
+   }
+
+   return progress;
+}
+
+bool
+nir_opt_gvn_pre(nir_shader *shader)
+{
+   bool progress = false;
+
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         progress |= nir_opt_gvn_pre_impl(function->impl);
+   }
+
+   return progress;
+}
@@ -34,9 +34,14 @@
  * and nir_lower_pack(). Also this creates cast instructions taking derefs as a
  * source and some parts of NIR may not be able to handle that well.
  *
+ * Loads are also combined across if-statements which contain nothing but
+ * loads and ALU instructions, e.g. a load before such an if-statement with one
+ * after it.  Since the block after the if-statement always runs when the one
+ * before it does, the combined load can be placed before the if-statement.
+ *
  * There are a few situations where this doesn't vectorize as well as it could:
  * - It won't turn four consecutive vec3 loads into 3 vec4 loads.
- * - It doesn't do global vectorization.
+ * - It doesn't do global vectorization beyond the case above.
  * Handling these cases probably wouldn't provide much benefit though.
  *
  * This probably doesn't handle big-endian GPUs correctly.
@@ -191,6 +196,9 @@ struct vectorize_ctx {
    struct list_head entries[nir_num_variable_modes];
    struct hash_table *loads[nir_num_variable_modes];
    struct hash_table *stores[nir_num_variable_modes];
+
+   /* Blocks which were processed together with a previous block. */
+   struct set *continuation_blocks;
 };
 
 static uint32_t hash_entry_key(const void *key_)
@@ -1096,6 +1104,11 @@ try_vectorize(nir_function_impl *impl, struct vectorize_ctx *ctx,
    if (check_for_robustness(ctx, low))
       return false;
 
+   /* a store can't be moved past the if-statement between two blocks of a
+    * region, since the if-statement may read the memory */
+   if (first->is_store && first->instr->block != second->instr->block)
+      return false;
+
    /* we can only vectorize non-volatile loads/stores of the same type and with
     * the same access */
    if (first->info != second->info || first->access != second->access ||
@@ -1277,8 +1290,52 @@ handle_barrier(struct vectorize_ctx *ctx, bool *progress, nir_function_impl *imp
    return true;
 }
 
+/* Returns true if the if-statement can't write memory, leave the enclosing
+ * control flow or end the invocation, so the block after it always runs after
+ * the block before it with nothing but loads in between.
+ */
+static bool
+if_is_transparent(nir_if *nif)
+{
+   nir_foreach_block_in_cf_node(block, &nif->cf_node) {
+      nir_foreach_instr(instr, block) {
+         switch (instr->type) {
+         case nir_instr_type_jump:
+         case nir_instr_type_call:
+            return false;
+
+         case nir_instr_type_intrinsic: {
+            nir_intrinsic_op op = nir_instr_as_intrinsic(instr)->intrinsic;
+            if (!(nir_intrinsic_infos[op].flags & NIR_INTRINSIC_CAN_ELIMINATE))
+               return false;
+            break;
+         }
+
+         default:
+            break;
+         }
+      }
+   }
+
+   return true;
+}
+
+/* Returns the block after the if-statement following the block, if the two
+ * can be processed as one region.
+ */
+static nir_block *
+next_region_block(nir_block *block)
+{
+   nir_cf_node *next = nir_cf_node_next(&block->cf_node);
+   if (!next || next->type != nir_cf_node_if ||
+       !if_is_transparent(nir_cf_node_as_if(next)))
+      return NULL;
+
+   return nir_cf_node_as_block(nir_cf_node_next(next));
+}
+
 static bool
-process_block(nir_function_impl *impl, struct vectorize_ctx *ctx, nir_block *block)
+process_block(nir_function_impl *impl, struct vectorize_ctx *ctx, nir_block *start)
 {
    bool progress = false;
 
@@ -1293,56 +1350,61 @@ process_block(nir_function_impl *impl, struct vectorize_ctx *ctx, nir_block *blo
    /* create entries */
    unsigned next_index = 0;
 
-   nir_foreach_instr_safe(instr, block) {
-      if (handle_barrier(ctx, &progress, impl, instr))
-         continue;
+   for (nir_block *block = start; block; block = next_region_block(block)) {
+      if (block != start)
+         _mesa_set_add(ctx->continuation_blocks, block);
 
-      /* gather information */
-      if (instr->type != nir_instr_type_intrinsic)
-         continue;
-      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      nir_foreach_instr_safe(instr, block) {
+         if (handle_barrier(ctx, &progress, impl, instr))
+            continue;
 
-      const struct intrinsic_info *info = get_info(intrin->intrinsic); 
-      if (!info)
-         continue;
+         /* gather information */
+         if (instr->type != nir_instr_type_intrinsic)
+            continue;
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
 
-      nir_variable_mode mode = info->mode;
-      if (!mode)
-         mode = nir_src_as_deref(intrin->src[info->deref_src])->mode;
-      if (!(mode & aliasing_modes(ctx->modes)))
-         continue;
-      unsigned mode_index = mode_to_index(mode);
+         const struct intrinsic_info *info = get_info(intrin->intrinsic); 
+         if (!info)
+            continue;
 
-      /* create entry */
-      struct entry *entry = create_entry(ctx, info, intrin);
-      entry->index = next_index++;
+         nir_variable_mode mode = info->mode;
+         if (!mode)
+            mode = nir_src_as_deref(intrin->src[info->deref_src])->mode;
+         if (!(mode & aliasing_modes(ctx->modes)))
+            continue;
+         unsigned mode_index = mode_to_index(mode);
 
-      list_addtail(&entry->head, &ctx->entries[mode_index]);
+         /* create entry */
+         struct entry *entry = create_entry(ctx, info, intrin);
+         entry->index = next_index++;
 
-      /* add the entry to a hash table */
+         list_addtail(&entry->head, &ctx->entries[mode_index]);
 
-      struct hash_table *adj_ht = NULL;
-      if (entry->is_store) {
-         if (!ctx->stores[mode_index])
-            ctx->stores[mode_index] = _mesa_hash_table_create(ctx, &hash_entry_key, &entry_key_equals);
-         adj_ht = ctx->stores[mode_index];
-      } else {
-         if (!ctx->loads[mode_index])
-            ctx->loads[mode_index] = _mesa_hash_table_create(ctx, &hash_entry_key, &entry_key_equals);
-         adj_ht = ctx->loads[mode_index];
-      }
+         /* add the entry to a hash table */
 
-      uint32_t key_hash = hash_entry_key(entry->key);
-      struct hash_entry *adj_entry = _mesa_hash_table_search_pre_hashed(adj_ht, key_hash, entry->key);
-      struct util_dynarray *arr;
-      if (adj_entry && adj_entry->data) {
-         arr = (struct util_dynarray *)adj_entry->data;
-      } else {
-         arr = ralloc(ctx, struct util_dynarray);
-         util_dynarray_init(arr, arr);
-         _mesa_hash_table_insert_pre_hashed(adj_ht, key_hash, entry->key, arr);
+         struct hash_table *adj_ht = NULL;
+         if (entry->is_store) {
+            if (!ctx->stores[mode_index])
+               ctx->stores[mode_index] = _mesa_hash_table_create(ctx, &hash_entry_key, &entry_key_equals);
+            adj_ht = ctx->stores[mode_index];
+         } else {
+            if (!ctx->loads[mode_index])
+               ctx->loads[mode_index] = _mesa_hash_table_create(ctx, &hash_entry_key, &entry_key_equals);
+            adj_ht = ctx->loads[mode_index];
+         }
+
+         uint32_t key_hash = hash_entry_key(entry->key);
+         struct hash_entry *adj_entry = _mesa_hash_table_search_pre_hashed(adj_ht, key_hash, entry->key);
+         struct util_dynarray *arr;
+         if (adj_entry && adj_entry->data) {
+            arr = (struct util_dynarray *)adj_entry->data;
+         } else {
+            arr = ralloc(ctx, struct util_dynarray);
+            util_dynarray_init(arr, arr);
+            _mesa_hash_table_insert_pre_hashed(adj_ht, key_hash, entry->key, arr);
+         }
+         util_dynarray_append(arr, struct entry *, entry);
       }
-      util_dynarray_append(arr, struct entry *, entry);
    }
 
    /* sort and combine entries */
@@ -1365,6 +1427,7 @@ nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
    ctx->modes = modes;
    ctx->callback = callback;
    ctx->robust_modes = robust_modes;
+   ctx->continuation_blocks = _mesa_pointer_set_create(ctx);
 
    nir_shader_index_vars(shader, modes);
 
@@ -1373,8 +1436,10 @@ nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
          if (modes & nir_var_function_temp)
             nir_function_impl_index_vars(function->impl);
 
-         nir_foreach_block(block, function->impl)
-            progress |= process_block(function->impl, ctx, block);
+         nir_foreach_block(block, function->impl) {
+            if (!_mesa_set_search(ctx->continuation_blocks, block))
+               progress |= process_block(function->impl, ctx, block);
+         }
 
          nir_metadata_preserve(function->impl,
                                nir_metadata_block_index |
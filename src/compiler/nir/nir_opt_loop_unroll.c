@@ -763,16 +763,87 @@ check_unrolling_restrictions(nir_shader *shader, nir_loop *loop)
    unsigned trip_count =
       li->max_trip_count ? li->max_trip_count : li->guessed_trip_count;
 
+   bool unroll;
    if (trip_count > max_iter)
-      return false;
+      unroll = false;
+   else if (li->force_unroll && !li->guessed_trip_count)
+      unroll = true;
+   else
+      unroll = li->instr_cost * trip_count <= max_iter * LOOP_UNROLL_LIMIT;
+
+   /* Unrolling a loop which exits right away never costs anything. */
+   if (shader->options->loop_unroll_factor && trip_count > 0) {
+      unsigned factor =
+         shader->options->loop_unroll_factor(shader, loop, trip_count,
+                                             unroll ? trip_count : 0);
+      return factor >= trip_count;
+   }
 
-   if (li->force_unroll && !li->guessed_trip_count)
-      return true;
+   return unroll;
+}
 
-   bool loop_not_too_large =
-      li->instr_cost * trip_count <= max_iter * LOOP_UNROLL_LIMIT;
+/* Replicates the body of a loop factor times, so every iteration of the new
+ * loop runs factor iterations of the old one.  All of the exits stay where
+ * they are and a continue just starts the next iteration early, so this
+ * works for any loop, whatever we know about its trip count.
+ *
+ *     loop {
+ *         ...instrs...
+ *     }
+ *
+ * with a factor of 2 becomes
+ *
+ *     loop {
+ *         ...instrs... ...instrs...
+ *     }
+ */
+static void
+unroll_by_factor(nir_loop *loop, unsigned factor)
+{
+   loop_prepare_for_unroll(loop);
 
-   return loop_not_too_large;
+   nir_cf_list loop_body;
+   nir_cf_extract(&loop_body, nir_before_block(nir_loop_first_block(loop)),
+                  nir_after_block(nir_loop_last_block(loop)));
+
+   struct hash_table *remap_table = _mesa_pointer_hash_table_create(NULL);
+
+   for (unsigned i = 0; i < factor; i++) {
+      nir_cf_list_clone_and_reinsert(&loop_body, &loop->cf_node,
+                                     nir_after_cf_list(&loop->body),
+                                     remap_table);
+   }
+
+   nir_cf_delete(&loop_body);
+
+   _mesa_hash_table_destroy(remap_table, NULL);
+
+   /* Don't keep growing it every time the pass runs. */
+   loop->partially_unrolled = true;
+}
+
+static bool
+try_unroll_by_factor(nir_shader *shader, nir_loop *loop)
+{
+   if (shader->options->loop_unroll_factor == NULL ||
+       loop->control != nir_loop_control_none ||
+       loop->partially_unrolled)
+      return false;
+
+   nir_loop_info *li = loop->info;
+   unsigned trip_count = 0;
+   if (li->limiting_terminator)
+      trip_count = li->max_trip_count;
+   else if (li->guessed_trip_count)
+      trip_count = li->guessed_trip_count;
+
+   unsigned factor =
+      shader->options->loop_unroll_factor(shader, loop, trip_count, 0);
+   if (factor <= 1 || (trip_count > 0 && factor >= trip_count))
+      return false;
+
+   unroll_by_factor(loop, factor);
+   return true;
 }
 
 static bool
@@ -944,6 +1015,12 @@ process_loops(nir_shader *sh, nir_cf_node *cf_node, bool *has_nested_loop_out,
    }
 
 exit:
+   /* Loops the other strategies didn't take may still be worth unrolling by
+    * a factor.
+    */
+   if (!progress && !has_nested_loop)
+      progress = try_unroll_by_factor(sh, loop);
+
    *has_nested_loop_out = true;
    if (progress && !unrolled_child_block)
       *unrolled_this_block = true;
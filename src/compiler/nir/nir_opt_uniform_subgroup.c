@@ -0,0 +1,157 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+
+/** @file nir_opt_uniform_subgroup.c
+ *
+ * Uses divergence analysis to remove subgroup operations whose source is
+ * already uniform across the subgroup.  Reading another invocation's copy of
+ * a uniform value, voting on a uniform condition or reducing a uniform value
+ * with an idempotent operation all give back the source, so the cross-lane
+ * work (and on some hardware the implicit uniformization) can be dropped.
+ */
+
+static bool
+is_idempotent_reduction(nir_op op)
+{
+   switch (op) {
+   case nir_op_imin:
+   case nir_op_umin:
+   case nir_op_fmin:
+   case nir_op_imax:
+   case nir_op_umax:
+   case nir_op_fmax:
+   case nir_op_iand:
+   case nir_op_ior:
+      return true;
+   default:
+      return false;
+   }
+}
+
+static bool
+is_candidate(const nir_intrinsic_instr *intrin)
+{
+   switch (intrin->intrinsic) {
+   case nir_intrinsic_read_invocation:
+   case nir_intrinsic_read_first_invocation:
+   case nir_intrinsic_shuffle:
+   case nir_intrinsic_shuffle_xor:
+   case nir_intrinsic_shuffle_up:
+   case nir_intrinsic_shuffle_down:
+   case nir_intrinsic_quad_broadcast:
+   case nir_intrinsic_quad_swap_horizontal:
+   case nir_intrinsic_quad_swap_vertical:
+   case nir_intrinsic_quad_swap_diagonal:
+   case nir_intrinsic_vote_any:
+   case nir_intrinsic_vote_all:
+   case nir_intrinsic_vote_ieq:
+      return true;
+
+   case nir_intrinsic_reduce:
+   case nir_intrinsic_inclusive_scan:
+      return is_idempotent_reduction(nir_intrinsic_reduction_op(intrin));
+
+   default:
+      return false;
+   }
+}
+
+static bool
+opt_uniform_subgroup_impl(nir_function_impl *impl)
+{
+   bool progress = false;
+
+   nir_builder b;
+   nir_builder_init(&b, impl);
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr_safe(instr, block) {
+         if (instr->type != nir_instr_type_intrinsic)
+            continue;
+
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+         if (!is_candidate(intrin) || !intrin->src[0].is_ssa ||
+             nir_src_is_divergent(intrin->src[0]))
+            continue;
+
+         nir_ssa_def *replacement;
+         if (intrin->intrinsic == nir_intrinsic_vote_ieq) {
+            b.cursor = nir_before_instr(instr);
+            replacement = nir_imm_true(&b);
+         } else {
+            replacement = intrin->src[0].ssa;
+         }
+
+         nir_ssa_def_rewrite_uses(&intrin->dest.ssa,
+                                  nir_src_for_ssa(replacement));
+         nir_instr_remove(instr);
+         progress = true;
+      }
+   }
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   } else {
+      nir_metadata_preserve(impl, nir_metadata_all);
+   }
+
+   return progress;
+}
+
+static bool
+has_candidates(nir_function_impl *impl)
+{
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_intrinsic &&
+             is_candidate(nir_instr_as_intrinsic(instr)))
+            return true;
+      }
+   }
+
+   return false;
+}
+
+/**
+ * Divergence analysis only handles the entrypoint, so this expects all other
+ * functions to have been inlined.  The analysis is only run if the shader
+ * contains one of the subgroup operations this pass can remove.
+ */
+bool
+nir_opt_uniform_subgroup(nir_shader *shader, nir_divergence_options options)
+{
+   nir_function_impl *impl = nir_shader_get_entrypoint(shader);
+
+   if (!has_candidates(impl)) {
+      nir_metadata_preserve(impl, nir_metadata_all);
+      return false;
+   }
+
+   nir_divergence_analysis(shader, options);
+
+   return opt_uniform_subgroup_impl(impl);
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Running function-local passes on the impls of a shader in parallel.
+ *
+ * All the IR of a shader is allocated from the shader's ralloc context,
+ * and ralloc isn't thread-safe: allocating from the same parent on two
+ * threads corrupts its list of children.  So while a pass runs on a worker
+ * thread, nir_shader_mem_ctx() redirects the allocations for the shader to
+ * a context private to that job, which is reparented to the shader once
+ * all jobs are done.  Allocations whose parent is some other IR object
+ * (an instruction, a block) are safe as is, because every such object
+ * belongs to a single impl.
+ */
+
+#include "nir.h"
+
+#include "c11/threads.h"
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_queue.h"
+
+struct impl_job {
+   nir_shader *shader;
+   nir_function_impl *impl;
+   nir_impl_pass_func pass;
+   void *data;
+
+   /* Where the pass allocates the shader's IR from. */
+   void *mem_ctx;
+
+   bool progress;
+   struct util_queue_fence fence;
+};
+
+static struct {
+   bool ok;
+   unsigned num_threads;
+
+   /* The impl_job the current thread is running, if any. */
+   tss_t job_key;
+
+   struct util_queue queue;
+
+   /* Number of nir_shader_impls_parallel() calls with jobs in flight. */
+   int active;
+} parallel;
+
+static void
+parallel_init_once(void)
+{
+   util_cpu_detect();
+   parallel.num_threads =
+      MAX2(debug_get_num_option("NIR_PARALLEL_THREADS",
+                                util_cpu_caps.nr_cpus), 1);
+   if (parallel.num_threads < 2)
+      return;
+
+   if (tss_create(&parallel.job_key, NULL) != thrd_success)
+      return;
+
+   /* Not UTIL_QUEUE_INIT_SHARED_EXECUTOR: the callers are often jobs on the
+    * shared executor themselves, and waiting on jobs of the same pool could
+    * deadlock.
+    */
+   if (!util_queue_init(&parallel.queue, "nir", 64, parallel.num_threads,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+      tss_delete(parallel.job_key);
+      return;
+   }
+
+   parallel.ok = true;
+}
+
+static bool
+parallel_init(void)
+{
+   static once_flag once = ONCE_FLAG_INIT;
+   call_once(&once, parallel_init_once);
+
+   return parallel.ok;
+}
+
+void *
+nir_shader_mem_ctx(void *shader)
+{
+   if (likely(p_atomic_read(&parallel.active) == 0))
+      return shader;
+
+   struct impl_job *job = tss_get(parallel.job_key);
+   if (job && job->shader == shader)
+      return job->mem_ctx;
+
+   return shader;
+}
+
+static void
+run_impl_job(void *data, UNUSED int thread_index)
+{
+   struct impl_job *job = data;
+
+   tss_set(parallel.job_key, job);
+   job->progress = job->pass(job->impl, job->data);
+   tss_set(parallel.job_key, NULL);
+}
+
+bool
+nir_shader_impls_parallel(nir_shader *shader, nir_impl_pass_func pass,
+                          void *data)
+{
+   bool progress = false;
+   unsigned num_impls = 0;
+
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         num_impls++;
+   }
+
+   struct impl_job *jobs = NULL;
+   if (num_impls > 1 && parallel_init())
+      jobs = calloc(num_impls, sizeof(*jobs));
+
+   if (!jobs) {
+      nir_foreach_function(function, shader) {
+         if (function->impl)
+            progress |= pass(function->impl, data);
+      }
+      return progress;
+   }
+
+   unsigned i = 0;
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      jobs[i].shader = shader;
+      jobs[i].impl = function->impl;
+      jobs[i].pass = pass;
+      jobs[i].data = data;
+      jobs[i].mem_ctx = ralloc_context(NULL);
+      i++;
+   }
+
+   p_atomic_inc(&parallel.active);
+
+   /* The calling thread takes the first impl itself. */
+   for (i = 1; i < num_impls; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      util_queue_add_job(&parallel.queue, &jobs[i], &jobs[i].fence,
+                         run_impl_job, NULL, 0);
+   }
+
+   struct impl_job *prev_job = tss_get(parallel.job_key);
+   run_impl_job(&jobs[0], 0);
+   tss_set(parallel.job_key, prev_job);
+
+   for (i = 1; i < num_impls; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+
+   p_atomic_dec(&parallel.active);
+
+   for (i = 0; i < num_impls; i++) {
+      ralloc_adopt(shader, jobs[i].mem_ctx);
+      ralloc_free(jobs[i].mem_ctx);
+      progress |= jobs[i].progress;
+   }
+
+   free(jobs);
+
+   return progress;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir_pass_manager.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "util/debug.h"
+#include "util/os_time.h"
+
+void
+nir_pass_manager_init(nir_pass_manager *pm, nir_shader *shader,
+                      const char *name)
+{
+   static int skip = -1, timing = -1;
+   if (skip < 0)
+      skip = !env_var_as_boolean("NIR_PASS_NO_SKIP", false);
+   if (timing < 0)
+      timing = env_var_as_boolean("NIR_PASS_TIMING", false);
+
+   pm->shader = shader;
+   pm->name = name;
+   pm->generation = 1;
+   pm->cf_generation = 1;
+   pm->track_cf = false;
+   pm->skip = skip;
+   pm->timing = timing;
+   pm->next = 0;
+   util_dynarray_init(&pm->passes, NULL);
+}
+
+static void
+print_timing(const nir_pass_manager *pm)
+{
+   uint64_t total_ns = 0;
+   unsigned total_runs = 0, total_skips = 0;
+
+   fprintf(stderr, "NIR pass timing for %s (%s shader):\n",
+           pm->name, _mesa_shader_stage_to_string(pm->shader->info.stage));
+   fprintf(stderr, "   %-32s %6s %6s %8s %10s\n",
+           "pass", "runs", "skips", "progress", "time (us)");
+
+   util_dynarray_foreach(&pm->passes, nir_pass_manager_pass, pass) {
+      fprintf(stderr, "   %-32s %6u %6u %8u %10.1f\n",
+              pass->name, pass->runs, pass->skips, pass->progress,
+              pass->time_ns / 1000.0);
+      total_ns += pass->time_ns;
+      total_runs += pass->runs;
+      total_skips += pass->skips;
+   }
+
+   fprintf(stderr, "   %-32s %6u %6u %8s %10.1f\n",
+           "total", total_runs, total_skips, "", total_ns / 1000.0);
+}
+
+void
+nir_pass_manager_finish(nir_pass_manager *pm)
+{
+   if (pm->timing)
+      print_timing(pm);
+
+   util_dynarray_fini(&pm->passes);
+}
+
+static nir_pass_manager_pass *
+lookup_pass(nir_pass_manager *pm, const void *site, const char *name,
+            bool cf_only)
+{
+   const unsigned num_passes =
+      util_dynarray_num_elements(&pm->passes, nir_pass_manager_pass);
+   nir_pass_manager_pass *passes =
+      util_dynarray_begin(&pm->passes);
+
+   /* Loops run their passes in the same order every iteration, so this
+    * almost always hits on the first try.
+    */
+   for (unsigned i = 0; i < num_passes; i++) {
+      const unsigned idx = (pm->next + i) % num_passes;
+      if (passes[idx].site == site) {
+         pm->next = idx + 1;
+         return &passes[idx];
+      }
+   }
+
+   nir_pass_manager_pass *pass =
+      util_dynarray_grow(&pm->passes, nir_pass_manager_pass, 1);
+   memset(pass, 0, sizeof(*pass));
+   pass->site = site;
+   pass->name = name;
+   pass->cf_only = cf_only;
+   pm->next = num_passes + 1;
+
+   if (cf_only)
+      pm->track_cf = true;
+
+   return pass;
+}
+
+static bool
+can_skip(const nir_pass_manager *pm, const nir_pass_manager_pass *pass)
+{
+   if (!pm->skip || pass->noop_generation == 0)
+      return false;
+
+   /* Nothing changed since the pass last ran without making progress. */
+   if (pass->noop_generation == pm->generation)
+      return true;
+
+   /* Nothing the pass looks at changed. */
+   return pass->cf_only && pass->noop_cf_generation == pm->cf_generation;
+}
+
+nir_pass_manager_pass *
+nir_pass_manager_begin_pass(nir_pass_manager *pm, const void *site,
+                            const char *name, bool cf_only)
+{
+   nir_pass_manager_pass *pass = lookup_pass(pm, site, name, cf_only);
+
+   if (can_skip(pm, pass)) {
+      pass->skips++;
+      return NULL;
+   }
+
+   /* A pass which changes the control flow graph has to invalidate the block
+    * indices, so make sure they are valid going in.
+    */
+   if (pm->track_cf) {
+      nir_foreach_function(function, pm->shader) {
+         if (function->impl)
+            nir_metadata_require(function->impl, nir_metadata_block_index);
+      }
+   }
+
+   if (pm->timing)
+      pass->start_ns = os_time_get_nano();
+
+   return pass;
+}
+
+static bool
+cf_changed(const nir_shader *shader)
+{
+   nir_foreach_function(function, shader) {
+      if (function->impl &&
+          !(function->impl->valid_metadata & nir_metadata_block_index))
+         return true;
+   }
+
+   return false;
+}
+
+void
+nir_pass_manager_end_pass(nir_pass_manager *pm, nir_pass_manager_pass *pass,
+                          bool progress)
+{
+   if (pm->timing)
+      pass->time_ns += os_time_get_nano() - pass->start_ns;
+
+   pass->runs++;
+
+   if (progress) {
+      pass->progress++;
+      pm->generation++;
+      if (pm->track_cf && cf_changed(pm->shader))
+         pm->cf_generation++;
+   } else {
+      pass->noop_generation = pm->generation;
+      pass->noop_cf_generation = pm->cf_generation;
+   }
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NIR_PASS_MANAGER_H
+#define NIR_PASS_MANAGER_H
+
+#include "nir.h"
+#include "util/u_dynarray.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A pass manager for fixed-point optimization loops
+ *
+ * Drivers run their optimizations in loops like
+ *
+ *    do {
+ *       progress = false;
+ *       NIR_PASS(progress, nir, nir_copy_prop);
+ *       NIR_PASS(progress, nir, nir_opt_dce);
+ *       ...
+ *    } while (progress);
+ *
+ * which reruns every pass until none of them make progress.  Most of those
+ * reruns are wasted: a pass which made no progress will make no progress
+ * again until some other pass has changed the shader.  Replacing NIR_PASS
+ * with NIR_PM_PASS in such a loop,
+ *
+ *    nir_pass_manager pm;
+ *    nir_pass_manager_init(&pm, nir, "my_optimize_loop");
+ *    do {
+ *       progress = false;
+ *       NIR_PM_PASS(progress, &pm, nir_copy_prop);
+ *       NIR_PM_PASS(progress, &pm, nir_opt_dce);
+ *       ...
+ *    } while (progress);
+ *    nir_pass_manager_finish(&pm);
+ *
+ * skips exactly those reruns.  Passes are identified by their call site, so
+ * the same pass may appear several times (with different arguments) and
+ * passes may be run conditionally.  For the skipping to be correct every
+ * pass which may change the shader inside the loop has to go through
+ * NIR_PM_PASS, and the arguments at a given call site must not change from
+ * one iteration to the next.
+ *
+ * Passes whose opportunities only depend on the control flow graph can be
+ * added with NIR_PM_PASS_CF instead; they are also skipped if the passes
+ * which ran since made progress but kept nir_metadata_block_index valid,
+ * i.e. only rewrote instructions.
+ *
+ * Setting NIR_PASS_TIMING=1 prints how often each pass ran, was skipped and
+ * made progress, and how long it took, when the pass manager is finished.
+ * NIR_PASS_NO_SKIP=1 runs every pass, for debugging.
+ */
+typedef struct {
+   nir_shader *shader;
+   const char *name;
+
+   /* Bumped every time a pass makes progress. */
+   unsigned generation;
+
+   /* Bumped every time a pass makes progress and changes control flow.  Only
+    * tracked once a NIR_PM_PASS_CF pass has been seen.
+    */
+   unsigned cf_generation;
+   bool track_cf;
+
+   bool skip;
+   bool timing;
+
+   /* Index of the pass after the last one run, as a lookup hint. */
+   unsigned next;
+
+   /* Array of nir_pass_manager_pass */
+   struct util_dynarray passes;
+} nir_pass_manager;
+
+typedef struct {
+   /* Unique per NIR_PM_PASS call site. */
+   const void *site;
+   const char *name;
+   bool cf_only;
+
+   /* The generations after the last run which made no progress, or 0. */
+   unsigned noop_generation;
+   unsigned noop_cf_generation;
+
+   unsigned runs;
+   unsigned skips;
+   unsigned progress;
+   uint64_t time_ns;
+   uint64_t start_ns;
+} nir_pass_manager_pass;
+
+void nir_pass_manager_init(nir_pass_manager *pm, nir_shader *shader,
+                           const char *name);
+void nir_pass_manager_finish(nir_pass_manager *pm);
+
+/* Returns the pass to run, or NULL if it should be skipped. */
+nir_pass_manager_pass *
+nir_pass_manager_begin_pass(nir_pass_manager *pm, const void *site,
+                            const char *name, bool cf_only);
+void nir_pass_manager_end_pass(nir_pass_manager *pm,
+                               nir_pass_manager_pass *pass, bool progress);
+
+#define _NIR_PM_PASS(progress, pm, cf_only, pass, ...) do {            \
+   static char _nir_pm_site;                                           \
+   nir_pass_manager_pass *_nir_pm_pass =                               \
+      nir_pass_manager_begin_pass(pm, &_nir_pm_site, #pass, cf_only);  \
+   if (_nir_pm_pass) {                                                 \
+      bool _nir_pm_progress = false;                                   \
+      NIR_PASS(_nir_pm_progress, (pm)->shader, pass, ##__VA_ARGS__);   \
+      nir_pass_manager_end_pass(pm, _nir_pm_pass, _nir_pm_progress);   \
+      if (_nir_pm_progress)                                            \
+         progress = true;                                              \
+   }                                                                   \
+} while (0)
+
+#define NIR_PM_PASS(progress, pm, pass, ...) \
+   _NIR_PM_PASS(progress, pm, false, pass, ##__VA_ARGS__)
+
+#define NIR_PM_PASS_CF(progress, pm, pass, ...) \
+   _NIR_PM_PASS(progress, pm, true, pass, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NIR_PASS_MANAGER_H */
@@ -0,0 +1,364 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Process-wide profiling of NIR_PASS and NIR_PASS_V, see nir.h.
+ *
+ * Nothing in here runs unless NIR_PASS_PROFILE or NIR_PASS_TRACE is set;
+ * everything is serialized on a single mutex, which is fine as long as the
+ * cost of a NIR pass dominates the cost of taking it.
+ */
+
+#include "nir.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "c11/threads.h"
+#include "util/hash_table.h"
+#include "util/os_time.h"
+#include "util/simple_mtx.h"
+
+struct pass_stats {
+   const char *name;
+
+   unsigned calls;
+   unsigned progress;
+   uint64_t time_ns;
+   uint64_t max_ns;
+   int64_t instr_delta;
+
+   unsigned stage_calls[MESA_ALL_SHADER_STAGES];
+   uint64_t stage_time_ns[MESA_ALL_SHADER_STAGES];
+};
+
+static struct {
+   simple_mtx_t mtx;
+   bool enabled;
+   int64_t start_ns;
+
+   /* Pass name -> struct pass_stats */
+   struct hash_table *passes;
+
+   const char *summary_path;
+   FILE *trace;
+   bool trace_has_events;
+} prof = {
+   .mtx = _SIMPLE_MTX_INITIALIZER_NP,
+};
+
+static FILE *
+open_output(const char *path)
+{
+   if (strcmp(path, "-") == 0)
+      return stderr;
+
+   FILE *fp = fopen(path, "w");
+   if (!fp)
+      fprintf(stderr, "NIR: failed to open %s for pass profiling\n", path);
+
+   return fp;
+}
+
+static void
+print_json_string(FILE *fp, const char *str)
+{
+   fputc('"', fp);
+   for (const char *c = str; *c; c++) {
+      if (*c == '"' || *c == '\\')
+         fprintf(fp, "\\%c", *c);
+      else if ((unsigned char)*c < 0x20)
+         fprintf(fp, "\\u%04x", *c);
+      else
+         fputc(*c, fp);
+   }
+   fputc('"', fp);
+}
+
+static void
+write_summary(void)
+{
+   if (!prof.summary_path)
+      return;
+
+   FILE *fp = open_output(prof.summary_path);
+   if (!fp)
+      return;
+
+   nir_pass_profile_dump(fp);
+
+   if (fp != stderr)
+      fclose(fp);
+}
+
+static void
+profile_atexit(void)
+{
+   write_summary();
+
+   simple_mtx_lock(&prof.mtx);
+   if (prof.trace) {
+      fprintf(prof.trace, "\n]\n");
+      if (prof.trace != stderr)
+         fclose(prof.trace);
+      prof.trace = NULL;
+   }
+   simple_mtx_unlock(&prof.mtx);
+}
+
+static void
+profile_init_once(void)
+{
+   const char *summary = getenv("NIR_PASS_PROFILE");
+   const char *trace = getenv("NIR_PASS_TRACE");
+
+   if (summary && summary[0])
+      prof.summary_path = summary;
+
+   if (trace && trace[0]) {
+      prof.trace = open_output(trace);
+      if (prof.trace)
+         fprintf(prof.trace, "[\n");
+   }
+
+   if (!prof.summary_path && !prof.trace)
+      return;
+
+   prof.passes = _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                         _mesa_key_string_equal);
+   prof.start_ns = os_time_get_nano();
+   prof.enabled = true;
+
+   atexit(profile_atexit);
+}
+
+bool
+nir_pass_profile_init(void)
+{
+   static once_flag once = ONCE_FLAG_INIT;
+   call_once(&once, profile_init_once);
+
+   return prof.enabled;
+}
+
+static unsigned
+count_instrs(nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         nir_foreach_instr(instr, block)
+            count++;
+      }
+   }
+
+   return count;
+}
+
+void
+nir_pass_profile_begin(nir_shader *shader, nir_pass_profile_sample *sample)
+{
+   sample->num_instrs = count_instrs(shader);
+
+   /* Count the instructions first so that it doesn't show up as the pass'
+    * time.
+    */
+   sample->start_ns = os_time_get_nano();
+}
+
+static struct pass_stats *
+get_pass_stats(const char *pass)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(prof.passes, pass);
+   if (entry)
+      return entry->data;
+
+   struct pass_stats *stats = rzalloc(prof.passes, struct pass_stats);
+   stats->name = ralloc_strdup(stats, pass);
+   _mesa_hash_table_insert(prof.passes, stats->name, stats);
+
+   return stats;
+}
+
+static uint64_t
+current_thread_id(void)
+{
+#ifdef HAVE_PTHREAD
+   return (uintptr_t)pthread_self();
+#else
+   return 0;
+#endif
+}
+
+static void
+write_trace_event(nir_shader *shader, const char *pass,
+                  const nir_pass_profile_sample *sample, int64_t end_ns,
+                  unsigned num_instrs, int progress)
+{
+   FILE *fp = prof.trace;
+
+   fprintf(fp, "%s{\"name\":", prof.trace_has_events ? ",\n" : "");
+   print_json_string(fp, pass);
+   fprintf(fp, ",\"cat\":\"nir\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+           "\"pid\":1,\"tid\":%" PRIu64 ",\"args\":{\"stage\":\"%s\"",
+           (sample->start_ns - prof.start_ns) / 1000.0,
+           (end_ns - sample->start_ns) / 1000.0, current_thread_id(),
+           _mesa_shader_stage_to_abbrev(shader->info.stage));
+
+   if (shader->info.name) {
+      fprintf(fp, ",\"shader\":");
+      print_json_string(fp, shader->info.name);
+   }
+   if (shader->info.label) {
+      fprintf(fp, ",\"label\":");
+      print_json_string(fp, shader->info.label);
+   }
+   if (progress >= 0)
+      fprintf(fp, ",\"progress\":%s", progress ? "true" : "false");
+
+   fprintf(fp, ",\"instrs_before\":%u,\"instrs_after\":%u}}",
+           sample->num_instrs, num_instrs);
+
+   prof.trace_has_events = true;
+}
+
+void
+nir_pass_profile_end(nir_shader *shader, const char *pass,
+                     const nir_pass_profile_sample *sample, int progress)
+{
+   const int64_t end_ns = os_time_get_nano();
+   const uint64_t time_ns = end_ns - sample->start_ns;
+   const unsigned num_instrs = count_instrs(shader);
+   const gl_shader_stage stage = shader->info.stage;
+
+   simple_mtx_lock(&prof.mtx);
+
+   struct pass_stats *stats = get_pass_stats(pass);
+   stats->calls++;
+   if (progress > 0)
+      stats->progress++;
+   stats->time_ns += time_ns;
+   stats->max_ns = MAX2(stats->max_ns, time_ns);
+   stats->instr_delta += (int64_t)num_instrs - (int64_t)sample->num_instrs;
+
+   if (stage >= 0 && stage < MESA_ALL_SHADER_STAGES) {
+      stats->stage_calls[stage]++;
+      stats->stage_time_ns[stage] += time_ns;
+   }
+
+   if (prof.trace)
+      write_trace_event(shader, pass, sample, end_ns, num_instrs, progress);
+
+   simple_mtx_unlock(&prof.mtx);
+}
+
+static int
+compare_time(const void *a, const void *b)
+{
+   const struct pass_stats *sa = *(const struct pass_stats **)a;
+   const struct pass_stats *sb = *(const struct pass_stats **)b;
+
+   if (sa->time_ns != sb->time_ns)
+      return sa->time_ns < sb->time_ns ? 1 : -1;
+
+   return strcmp(sa->name, sb->name);
+}
+
+void
+nir_pass_profile_dump(FILE *fp)
+{
+   if (!prof.enabled)
+      return;
+
+   simple_mtx_lock(&prof.mtx);
+
+   const unsigned num_passes = prof.passes->entries;
+   struct pass_stats **sorted = malloc(MAX2(num_passes, 1) * sizeof(*sorted));
+   if (!sorted) {
+      simple_mtx_unlock(&prof.mtx);
+      return;
+   }
+
+   unsigned i = 0;
+   uint64_t total_ns = 0;
+   hash_table_foreach(prof.passes, entry) {
+      sorted[i++] = entry->data;
+      total_ns += ((struct pass_stats *)entry->data)->time_ns;
+   }
+   qsort(sorted, num_passes, sizeof(*sorted), compare_time);
+
+   /* Passes called from other passes are counted in both. */
+   fprintf(fp, "{\n  \"total_time_ns\": %" PRIu64 ",\n  \"passes\": [", total_ns);
+
+   for (i = 0; i < num_passes; i++) {
+      const struct pass_stats *stats = sorted[i];
+
+      fprintf(fp, "%s\n    {\"name\": ", i ? "," : "");
+      print_json_string(fp, stats->name);
+      fprintf(fp, ", \"calls\": %u, \"progress\": %u, \"time_ns\": %" PRIu64
+              ", \"max_ns\": %" PRIu64 ", \"instr_delta\": %" PRId64 ", "
+              "\"stages\": {",
+              stats->calls, stats->progress, stats->time_ns, stats->max_ns,
+              stats->instr_delta);
+
+      bool first = true;
+      for (unsigned s = 0; s < MESA_ALL_SHADER_STAGES; s++) {
+         if (!stats->stage_calls[s])
+            continue;
+
+         fprintf(fp, "%s\"%s\": {\"calls\": %u, \"time_ns\": %" PRIu64 "}",
+                 first ? "" : ", ", _mesa_shader_stage_to_abbrev(s),
+                 stats->stage_calls[s], stats->stage_time_ns[s]);
+         first = false;
+      }
+
+      fprintf(fp, "}}");
+   }
+
+   fprintf(fp, "\n  ]\n}\n");
+
+   simple_mtx_unlock(&prof.mtx);
+
+   free(sorted);
+}
+
+void
+nir_pass_profile_reset(void)
+{
+   if (!prof.enabled)
+      return;
+
+   simple_mtx_lock(&prof.mtx);
+   ralloc_free(prof.passes);
+   prof.passes = _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                         _mesa_key_string_equal);
+   simple_mtx_unlock(&prof.mtx);
+}
@@ -983,8 +983,17 @@ nir_schedule_instructions(nir_schedule_scoreboard *scoreboard, nir_block *block)
 }
 
 static uint32_t
-nir_schedule_get_delay(nir_instr *instr)
+nir_schedule_get_delay(nir_schedule_scoreboard *scoreboard, nir_instr *instr)
 {
+   const nir_schedule_options *options = scoreboard->options;
+
+   if (options->instr_delay_cb) {
+      uint32_t delay = options->instr_delay_cb(instr,
+                                               options->instr_delay_cb_data);
+      if (delay)
+         return delay;
+   }
+
    switch (instr->type) {
    case nir_instr_type_ssa_undef:
    case nir_instr_type_load_const:
@@ -1037,7 +1046,7 @@ nir_schedule_block(nir_schedule_scoreboard *scoreboard, nir_block *block)
          rzalloc(mem_ctx, nir_schedule_node);
 
       n->instr = instr;
-      n->delay = nir_schedule_get_delay(instr);
+      n->delay = nir_schedule_get_delay(scoreboard, instr);
       dag_init_node(scoreboard->dag, &n->dag);
 
       _mesa_hash_table_insert(scoreboard->instr_map, instr, n);
@@ -73,6 +73,14 @@ typedef struct nir_schedule_options {
                          void *user_data);
    /* Data to pass to the callback */
    void *intrinsic_cb_data;
+   /* Callback used to estimate the delay between starting an instruction and
+    * its result being available, in the same abstract units as the built-in
+    * estimates (1 for ALU, 100 for texturing).  Returning 0 falls back to the
+    * built-in estimate.
+    */
+   unsigned (* instr_delay_cb)(nir_instr *instr, void *user_data);
+   /* Data to pass to the callback */
+   void *instr_delay_cb_data;
 } nir_schedule_options;
 
 void nir_schedule(nir_shader *shader, const nir_schedule_options *options);
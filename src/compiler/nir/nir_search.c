@@ -896,6 +896,218 @@ nir_algebraic_instr(nir_builder *build, nir_instr *instr,
    return false;
 }
 
+/*
+ * Worklist mode
+ *
+ * Whether a transform matches an instruction only depends on the expression
+ * tree feeding it: the opcodes, swizzles and modifiers, which SSA values are
+ * used, constant values, the types of the leaves and the uses of the ALU
+ * instructions in the tree.  We hash all of that into a signature per SSA
+ * value and remember, for each value that no transform matched, the
+ * signature it had.  The next run of the same pass only puts instructions
+ * whose signature changed on the worklist.
+ *
+ * A hash collision can only make us miss an optimization, never apply a
+ * wrong one.
+ */
+
+struct nir_algebraic_cache {
+   const struct transform **transforms;
+
+   /* Signature of each SSA value which no transform matched in the previous
+    * run, or 0.
+    */
+   struct util_dynarray sigs;
+
+   struct nir_algebraic_cache *next;
+};
+
+static inline uint64_t
+sig_mix(uint64_t sig, uint64_t value)
+{
+   sig = (sig ^ value) * 0x100000001b3ull;
+   return sig ^ (sig >> 29);
+}
+
+static uint64_t
+def_sig(const nir_ssa_def *def, const uint64_t *sigs)
+{
+   const nir_instr *instr = def->parent_instr;
+
+   if (instr->type == nir_instr_type_alu ||
+       instr->type == nir_instr_type_load_const)
+      return sigs[def->index];
+
+   /* Anything else is a leaf of the expression tree. */
+   uint64_t sig = sig_mix(instr->type, def->bit_size | def->num_components << 8);
+   if (instr->type == nir_instr_type_intrinsic)
+      sig = sig_mix(sig, nir_instr_as_intrinsic(instr)->intrinsic);
+
+   return sig;
+}
+
+static uint64_t
+uses_sig(const nir_ssa_def *def)
+{
+   uint64_t sig = 0;
+
+   /* Summed so that the order of the uses doesn't matter. */
+   nir_foreach_use(use_src, def) {
+      const nir_instr *user = use_src->parent_instr;
+      uint64_t use_sig = user->type;
+
+      if (user->type == nir_instr_type_alu) {
+         const nir_alu_instr *alu = nir_instr_as_alu(user);
+         const nir_alu_src *alu_src =
+            exec_node_data(nir_alu_src, use_src, src);
+         use_sig = sig_mix(sig_mix(use_sig, alu->op), alu_src - alu->src);
+      }
+
+      sig += sig_mix(0xcbf29ce484222325ull, use_sig);
+   }
+
+   nir_foreach_if_use(use_src, def)
+      sig += 0x9e3779b97f4a7c15ull;
+
+   return sig;
+}
+
+static uint64_t
+alu_sig(const nir_alu_instr *alu, const uint64_t *sigs)
+{
+   if (!alu->dest.dest.is_ssa)
+      return 0;
+
+   const nir_ssa_def *def = &alu->dest.dest.ssa;
+   uint64_t sig = sig_mix(nir_instr_type_alu, alu->op);
+   sig = sig_mix(sig, def->bit_size | def->num_components << 8 |
+                      alu->exact << 16 | alu->dest.saturate << 17);
+
+   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+      const nir_alu_src *src = &alu->src[i];
+      if (!src->src.is_ssa)
+         return 0;
+
+      uint64_t swizzle = 0;
+      for (unsigned c = 0; c < nir_ssa_alu_instr_src_components(alu, i); c++)
+         swizzle |= (uint64_t)src->swizzle[c] << (c * 4);
+
+      sig = sig_mix(sig, def_sig(src->src.ssa, sigs));
+      sig = sig_mix(sig, src->src.ssa->index);
+      sig = sig_mix(sig, swizzle);
+      sig = sig_mix(sig, src->abs | src->negate << 1);
+   }
+
+   return sig_mix(sig, uses_sig(def));
+}
+
+static uint64_t
+load_const_sig(const nir_load_const_instr *load)
+{
+   uint64_t sig = sig_mix(nir_instr_type_load_const,
+                          load->def.bit_size | load->def.num_components << 8);
+
+   for (unsigned i = 0; i < load->def.num_components; i++)
+      sig = sig_mix(sig, nir_const_value_as_uint(load->value[i],
+                                                 load->def.bit_size));
+
+   return sig;
+}
+
+/* Computes the signatures of all ALU and load_const values, which have to
+ * be computed before their uses.
+ */
+static void
+compute_sigs(nir_function_impl *impl, uint64_t *sigs)
+{
+   memset(sigs, 0, impl->ssa_alloc * sizeof(*sigs));
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block) {
+         uint64_t sig;
+
+         if (instr->type == nir_instr_type_alu) {
+            nir_alu_instr *alu = nir_instr_as_alu(instr);
+            sig = alu_sig(alu, sigs);
+            if (alu->dest.dest.is_ssa)
+               sigs[alu->dest.dest.ssa.index] = sig ? sig : 1;
+         } else if (instr->type == nir_instr_type_load_const) {
+            nir_load_const_instr *load = nir_instr_as_load_const(instr);
+            sig = load_const_sig(load);
+            sigs[load->def.index] = sig ? sig : 1;
+         }
+      }
+   }
+}
+
+static struct nir_algebraic_cache *
+get_algebraic_cache(nir_function_impl *impl,
+                    const struct transform **transforms)
+{
+   struct nir_algebraic_cache *cache;
+
+   for (cache = impl->algebraic_cache; cache; cache = cache->next) {
+      if (cache->transforms == transforms)
+         return cache;
+   }
+
+   cache = ralloc(impl, struct nir_algebraic_cache);
+   cache->transforms = transforms;
+   util_dynarray_init(&cache->sigs, cache);
+   cache->next = impl->algebraic_cache;
+   impl->algebraic_cache = cache;
+
+   return cache;
+}
+
+static bool
+is_clean(const nir_instr *instr, const uint64_t *sigs,
+         const struct nir_algebraic_cache *cache)
+{
+   if (instr->type != nir_instr_type_alu)
+      return false;
+
+   const nir_alu_instr *alu = nir_instr_as_alu(instr);
+   if (!alu->dest.dest.is_ssa)
+      return false;
+
+   const unsigned index = alu->dest.dest.ssa.index;
+   return index < util_dynarray_num_elements(&cache->sigs, uint64_t) &&
+          sigs[index] != 0 &&
+          sigs[index] == *util_dynarray_element(&cache->sigs, uint64_t, index);
+}
+
+/* Remembers the values no transform matched in this run, and which haven't
+ * changed since.
+ */
+static void
+update_algebraic_cache(nir_function_impl *impl,
+                       struct nir_algebraic_cache *cache,
+                       const uint64_t *start_sigs, unsigned start_ssa_alloc,
+                       const BITSET_WORD *matched)
+{
+   uint64_t *sigs = malloc(impl->ssa_alloc * sizeof(*sigs));
+   if (!sigs ||
+       !util_dynarray_resize(&cache->sigs, uint64_t, impl->ssa_alloc)) {
+      free(sigs);
+      util_dynarray_clear(&cache->sigs);
+      return;
+   }
+
+   compute_sigs(impl, sigs);
+
+   uint64_t *cached = util_dynarray_begin(&cache->sigs);
+   for (unsigned i = 0; i < impl->ssa_alloc; i++) {
+      if (i < start_ssa_alloc && sigs[i] != 0 && sigs[i] == start_sigs[i] &&
+          (BITSET_TEST(matched, i) || cached[i] == sigs[i]))
+         cached[i] = sigs[i];
+      else
+         cached[i] = 0;
+   }
+
+   free(sigs);
+}
+
 bool
 nir_algebraic_impl(nir_function_impl *impl,
                    const bool *condition_flags,
@@ -919,6 +1131,24 @@ nir_algebraic_impl(nir_function_impl *impl,
    }
    memset(states.data, 0, states.size);
 
+   struct nir_algebraic_cache *cache = NULL;
+   uint64_t *sigs = NULL;
+   BITSET_WORD *matched = NULL;
+   const unsigned start_ssa_alloc = impl->ssa_alloc;
+
+   if (build.shader->options->algebraic_worklist) {
+      cache = get_algebraic_cache(impl, transforms);
+      sigs = malloc(MAX2(start_ssa_alloc, 1) * sizeof(*sigs));
+      matched = calloc(BITSET_WORDS(start_ssa_alloc) + 1, sizeof(BITSET_WORD));
+      if (!sigs || !matched) {
+         free(sigs);
+         free(matched);
+         cache = NULL;
+      } else {
+         compute_sigs(impl, sigs);
+      }
+   }
+
    struct hash_table *range_ht = _mesa_pointer_hash_table_create(NULL);
 
    nir_instr_worklist *worklist = nir_instr_worklist_create();
@@ -936,6 +1166,9 @@ nir_algebraic_impl(nir_function_impl *impl,
     */
    nir_foreach_block_reverse(block, impl) {
       nir_foreach_instr_reverse(instr, block) {
+         if (cache && is_clean(instr, sigs, cache))
+            continue;
+
          nir_instr_worklist_push_tail(worklist, instr);
       }
    }
@@ -949,16 +1182,29 @@ nir_algebraic_impl(nir_function_impl *impl,
       if (exec_node_is_tail_sentinel(&instr->node))
          continue;
 
-      progress |= nir_algebraic_instr(&build, instr,
-                                      range_ht, condition_flags,
-                                      transforms, transform_counts, &states,
-                                      pass_op_table, worklist);
+      if (nir_algebraic_instr(&build, instr,
+                              range_ht, condition_flags,
+                              transforms, transform_counts, &states,
+                              pass_op_table, worklist)) {
+         progress = true;
+      } else if (cache && instr->type == nir_instr_type_alu) {
+         const nir_alu_instr *alu = nir_instr_as_alu(instr);
+         if (alu->dest.dest.is_ssa &&
+             alu->dest.dest.ssa.index < start_ssa_alloc)
+            BITSET_SET(matched, alu->dest.dest.ssa.index);
+      }
    }
 
    nir_instr_worklist_destroy(worklist);
    ralloc_free(range_ht);
    util_dynarray_fini(&states);
 
+   if (cache) {
+      update_algebraic_cache(impl, cache, sigs, start_ssa_alloc, matched);
+      free(sigs);
+      free(matched);
+   }
+
    if (progress) {
       nir_metadata_preserve(impl, nir_metadata_block_index |
                                   nir_metadata_dominance);
@@ -56,6 +56,12 @@ typedef struct {
    const struct glsl_type *last_interface_type;
    struct nir_variable_data last_var_data;
 
+   /* Maps strings and types to their index in the string and type tables,
+    * see write_string() and write_type().
+    */
+   struct hash_table *string_table;
+   struct hash_table *type_table;
+
    /* For skipping equal ALU headers (typical after scalarization). */
    nir_instr_type last_instr_type;
    uintptr_t last_alu_header_offset;
@@ -85,6 +91,12 @@ typedef struct {
    const struct glsl_type *last_type;
    const struct glsl_type *last_interface_type;
    struct nir_variable_data last_var_data;
+
+   /* The string and type tables, filled in as they're read. */
+   uint32_t num_strings, strings_len;
+   const char **strings;
+   uint32_t num_types, types_len;
+   const struct glsl_type **types;
 } read_ctx;
 
 static void
@@ -123,6 +135,67 @@ read_object(read_ctx *ctx)
    return read_lookup_object(ctx, blob_read_uint32(ctx->blob));
 }
 
+/* Strings and types are written as an index into a table, followed by the
+ * string or type itself the first time it's used.  The reader knows the
+ * final size of both tables from the header.
+ */
+static void
+write_string(write_ctx *ctx, const char *str)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(ctx->string_table, str);
+   if (entry) {
+      blob_write_uint32(ctx->blob, (uintptr_t)entry->data);
+      return;
+   }
+
+   uint32_t index = ctx->string_table->entries;
+   _mesa_hash_table_insert(ctx->string_table, str, (void *)(uintptr_t)index);
+   blob_write_uint32(ctx->blob, index);
+   blob_write_string(ctx->blob, str);
+}
+
+static const char *
+read_string(read_ctx *ctx)
+{
+   uint32_t index = blob_read_uint32(ctx->blob);
+   if (index == ctx->num_strings) {
+      assert(ctx->num_strings < ctx->strings_len);
+      ctx->strings[ctx->num_strings++] = blob_read_string(ctx->blob);
+   }
+
+   assert(index < ctx->num_strings);
+   return ctx->strings[index];
+}
+
+static void
+write_type(write_ctx *ctx, const struct glsl_type *type)
+{
+   /* Types are interned, so the pointer identifies the type. */
+   struct hash_entry *entry = _mesa_hash_table_search(ctx->type_table, type);
+   if (entry) {
+      blob_write_uint32(ctx->blob, (uintptr_t)entry->data);
+      return;
+   }
+
+   uint32_t index = ctx->type_table->entries;
+   _mesa_hash_table_insert(ctx->type_table, type, (void *)(uintptr_t)index);
+   blob_write_uint32(ctx->blob, index);
+   encode_type_to_blob(ctx->blob, type);
+}
+
+static const struct glsl_type *
+read_type(read_ctx *ctx)
+{
+   uint32_t index = blob_read_uint32(ctx->blob);
+   if (index == ctx->num_types) {
+      assert(ctx->num_types < ctx->types_len);
+      ctx->types[ctx->num_types++] = decode_type_from_blob(ctx->blob);
+   }
+
+   assert(index < ctx->num_types);
+   return ctx->types[index];
+}
+
 static uint32_t
 encode_bit_size_3bits(uint8_t bit_size)
 {
@@ -285,17 +358,17 @@ write_variable(write_ctx *ctx, const nir_variable *var)
    blob_write_uint32(ctx->blob, flags.u32);
 
    if (!flags.u.type_same_as_last) {
-      encode_type_to_blob(ctx->blob, var->type);
+      write_type(ctx, var->type);
       ctx->last_type = var->type;
    }
 
    if (var->interface_type && !flags.u.interface_type_same_as_last) {
-      encode_type_to_blob(ctx->blob, var->interface_type);
+      write_type(ctx, var->interface_type);
       ctx->last_interface_type = var->interface_type;
    }
 
    if (flags.u.has_name)
-      blob_write_string(ctx->blob, var->name);
+      write_string(ctx, var->name);
 
    if (flags.u.data_encoding == var_encode_full ||
        flags.u.data_encoding == var_encode_location_diff) {
@@ -344,7 +417,7 @@ read_variable(read_ctx *ctx)
    if (flags.u.type_same_as_last) {
       var->type = ctx->last_type;
    } else {
-      var->type = decode_type_from_blob(ctx->blob);
+      var->type = read_type(ctx);
       ctx->last_type = var->type;
    }
 
@@ -352,13 +425,13 @@ read_variable(read_ctx *ctx)
       if (flags.u.interface_type_same_as_last) {
          var->interface_type = ctx->last_interface_type;
       } else {
-         var->interface_type = decode_type_from_blob(ctx->blob);
+         var->interface_type = read_type(ctx);
          ctx->last_interface_type = var->interface_type;
       }
    }
 
    if (flags.u.has_name) {
-      const char *name = blob_read_string(ctx->blob);
+      const char *name = read_string(ctx);
       var->name = ralloc_strdup(var, name);
    } else {
       var->name = NULL;
@@ -443,7 +516,7 @@ write_register(write_ctx *ctx, const nir_register *reg)
    blob_write_uint32(ctx->blob, reg->index);
    blob_write_uint32(ctx->blob, !ctx->strip && reg->name);
    if (!ctx->strip && reg->name)
-      blob_write_string(ctx->blob, reg->name);
+      write_string(ctx, reg->name);
 }
 
 static nir_register *
@@ -457,7 +530,7 @@ read_register(read_ctx *ctx)
    reg->index = blob_read_uint32(ctx->blob);
    bool has_name = blob_read_uint32(ctx->blob);
    if (has_name) {
-      const char *name = blob_read_string(ctx->blob);
+      const char *name = read_string(ctx);
       reg->name = ralloc_strdup(reg, name);
    } else {
       reg->name = NULL;
@@ -750,7 +823,7 @@ write_dest(write_ctx *ctx, const nir_dest *dst, union packed_instr header,
    if (dst->is_ssa) {
       write_add_object(ctx, &dst->ssa);
       if (dest.ssa.has_name)
-         blob_write_string(ctx->blob, dst->ssa.name);
+         write_string(ctx, dst->ssa.name);
    } else {
       blob_write_uint32(ctx->blob, write_lookup_object(ctx, dst->reg.reg));
       blob_write_uint32(ctx->blob, dst->reg.base_offset);
@@ -773,7 +846,7 @@ read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr,
          num_components = blob_read_uint32(ctx->blob);
       else
          num_components = decode_num_components_in_3bits(dest.ssa.num_components);
-      char *name = dest.ssa.has_name ? blob_read_string(ctx->blob) : NULL;
+      const char *name = dest.ssa.has_name ? read_string(ctx) : NULL;
       nir_ssa_dest_init(instr, dst, num_components, bit_size, name);
       read_add_object(ctx, &dst->ssa);
    } else {
@@ -1037,7 +1110,7 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
       write_src(ctx, &deref->parent);
       blob_write_uint32(ctx->blob, deref->cast.ptr_stride);
       if (!header.deref.cast_type_same_as_last) {
-         encode_type_to_blob(ctx->blob, deref->type);
+         write_type(ctx, deref->type);
          ctx->last_type = deref->type;
       }
       break;
@@ -1103,7 +1176,7 @@ read_deref(read_ctx *ctx, union packed_instr header)
       if (header.deref.cast_type_same_as_last) {
          deref->type = ctx->last_type;
       } else {
-         deref->type = decode_type_from_blob(ctx->blob);
+         deref->type = read_type(ctx);
          ctx->last_type = deref->type;
       }
       break;
@@ -1937,7 +2010,7 @@ write_function(write_ctx *ctx, const nir_function *fxn)
       flags |= 0x4;
    blob_write_uint32(ctx->blob, flags);
    if (fxn->name)
-      blob_write_string(ctx->blob, fxn->name);
+      write_string(ctx, fxn->name);
 
    write_add_object(ctx, fxn);
 
@@ -1961,7 +2034,7 @@ read_function(read_ctx *ctx)
 {
    uint32_t flags = blob_read_uint32(ctx->blob);
    bool has_name = flags & 0x2;
-   char *name = has_name ? blob_read_string(ctx->blob) : NULL;
+   const char *name = has_name ? read_string(ctx) : NULL;
 
    nir_function *fxn = nir_function_create(ctx->nir, name);
 
@@ -1995,9 +2068,14 @@ nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
    ctx.blob = blob;
    ctx.nir = nir;
    ctx.strip = strip;
+   ctx.string_table = _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                              _mesa_key_string_equal);
+   ctx.type_table = _mesa_pointer_hash_table_create(NULL);
    util_dynarray_init(&ctx.phi_fixups, NULL);
 
    size_t idx_size_offset = blob_reserve_uint32(blob);
+   size_t num_strings_offset = blob_reserve_uint32(blob);
+   size_t num_types_offset = blob_reserve_uint32(blob);
 
    struct shader_info info = nir->info;
    uint32_t strings = 0;
@@ -2007,9 +2085,9 @@ nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
       strings |= 0x2;
    blob_write_uint32(blob, strings);
    if (!strip && info.name)
-      blob_write_string(blob, info.name);
+      write_string(&ctx, info.name);
    if (!strip && info.label)
-      blob_write_string(blob, info.label);
+      write_string(&ctx, info.label);
    info.name = info.label = NULL;
    blob_write_bytes(blob, (uint8_t *) &info, sizeof(info));
 
@@ -2036,8 +2114,12 @@ nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
       blob_write_bytes(blob, nir->constant_data, nir->constant_data_size);
 
    *(uint32_t *)(blob->data + idx_size_offset) = ctx.next_idx;
+   *(uint32_t *)(blob->data + num_strings_offset) = ctx.string_table->entries;
+   *(uint32_t *)(blob->data + num_types_offset) = ctx.type_table->entries;
 
    _mesa_hash_table_destroy(ctx.remap_table, NULL);
+   _mesa_hash_table_destroy(ctx.string_table, NULL);
+   _mesa_hash_table_destroy(ctx.type_table, NULL);
    util_dynarray_fini(&ctx.phi_fixups);
 }
 
@@ -2051,10 +2133,14 @@ nir_deserialize(void *mem_ctx,
    list_inithead(&ctx.phi_srcs);
    ctx.idx_table_len = blob_read_uint32(blob);
    ctx.idx_table = calloc(ctx.idx_table_len, sizeof(uintptr_t));
+   ctx.strings_len = blob_read_uint32(blob);
+   ctx.strings = calloc(ctx.strings_len, sizeof(*ctx.strings));
+   ctx.types_len = blob_read_uint32(blob);
+   ctx.types = calloc(ctx.types_len, sizeof(*ctx.types));
 
    uint32_t strings = blob_read_uint32(blob);
-   char *name = (strings & 0x1) ? blob_read_string(blob) : NULL;
-   char *label = (strings & 0x2) ? blob_read_string(blob) : NULL;
+   const char *name = (strings & 0x1) ? read_string(&ctx) : NULL;
+   const char *label = (strings & 0x2) ? read_string(&ctx) : NULL;
 
    struct shader_info info;
    blob_copy_bytes(blob, (uint8_t *) &info, sizeof(info));
@@ -2092,6 +2178,8 @@ nir_deserialize(void *mem_ctx,
    }
 
    free(ctx.idx_table);
+   free(ctx.strings);
+   free(ctx.types);
 
    return ctx.nir;
 }
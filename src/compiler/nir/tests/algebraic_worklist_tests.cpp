@@ -0,0 +1,122 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+class nir_algebraic_worklist_test : public ::testing::Test {
+protected:
+   nir_algebraic_worklist_test();
+   ~nir_algebraic_worklist_test();
+
+   nir_builder bld;
+
+   nir_ssa_def *in_def;
+   nir_variable *out_var;
+};
+
+nir_algebraic_worklist_test::nir_algebraic_worklist_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   static nir_shader_compiler_options options = { };
+   options.algebraic_worklist = true;
+   nir_builder_init_simple_shader(&bld, NULL, MESA_SHADER_VERTEX, &options);
+
+   nir_variable *var = nir_variable_create(bld.shader, nir_var_shader_in, glsl_float_type(), "in");
+   in_def = nir_load_var(&bld, var);
+
+   out_var = nir_variable_create(bld.shader, nir_var_shader_out, glsl_float_type(), "out");
+}
+
+nir_algebraic_worklist_test::~nir_algebraic_worklist_test()
+{
+   ralloc_free(bld.shader);
+   glsl_type_singleton_decref();
+}
+
+TEST_F(nir_algebraic_worklist_test, no_change)
+{
+   nir_ssa_def *neg = nir_fneg(&bld, in_def);
+   nir_store_var(&bld, out_var, neg, 1);
+
+   ASSERT_FALSE(nir_opt_algebraic(bld.shader));
+   EXPECT_FALSE(nir_opt_algebraic(bld.shader));
+   EXPECT_NE(bld.impl->algebraic_cache, nullptr);
+}
+
+TEST_F(nir_algebraic_worklist_test, source_changed)
+{
+   /* After the first run, rewrite the source of an instruction which
+    * didn't match anything:
+    *
+    * vec1 32 ssa_1 = fneg ssa_0     vec1 32 ssa_1 = fneg ssa_0
+    * vec1 32 ssa_2 = fmul ssa_0 ... vec1 32 ssa_2 = fneg ssa_0
+    * vec1 32 ssa_3 = fneg ssa_2     vec1 32 ssa_3 = fneg ssa_2
+    *
+    * The fneg(fneg(a)) pattern only matches ssa_3 in the second run.
+    */
+   nir_ssa_def *mul = nir_fmul(&bld, in_def, nir_imm_float(&bld, 2.0f));
+   nir_alu_instr *neg = nir_instr_as_alu(nir_fneg(&bld, mul)->parent_instr);
+   nir_store_var(&bld, out_var, &neg->dest.dest.ssa, 1);
+
+   ASSERT_FALSE(nir_opt_algebraic(bld.shader));
+
+   bld.cursor = nir_before_instr(&neg->instr);
+   nir_ssa_def *inner = nir_fneg(&bld, in_def);
+   nir_instr_rewrite_src(&neg->instr, &neg->src[0].src, nir_src_for_ssa(inner));
+
+   ASSERT_TRUE(nir_opt_algebraic(bld.shader));
+
+   nir_intrinsic_instr *store = NULL;
+   nir_foreach_block(block, bld.impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_intrinsic &&
+             nir_instr_as_intrinsic(instr)->intrinsic == nir_intrinsic_store_deref)
+            store = nir_instr_as_intrinsic(instr);
+      }
+   }
+   ASSERT_NE(store, nullptr);
+
+   /* The replacement may be a mov of the original value. */
+   nir_ssa_def *val = store->src[1].ssa;
+   if (val->parent_instr->type == nir_instr_type_alu &&
+       nir_instr_as_alu(val->parent_instr)->op == nir_op_mov)
+      val = nir_instr_as_alu(val->parent_instr)->src[0].src.ssa;
+   EXPECT_EQ(val, in_def);
+}
+
+TEST_F(nir_algebraic_worklist_test, instr_added)
+{
+   /* Instructions added after a run are always visited. */
+   nir_ssa_def *neg = nir_fneg(&bld, in_def);
+   nir_store_var(&bld, out_var, neg, 1);
+
+   ASSERT_FALSE(nir_opt_algebraic(bld.shader));
+
+   nir_ssa_def *neg2 = nir_fneg(&bld, neg);
+   nir_store_var(&bld, out_var, neg2, 1);
+
+   EXPECT_TRUE(nir_opt_algebraic(bld.shader));
+   EXPECT_FALSE(nir_opt_algebraic(bld.shader));
+}
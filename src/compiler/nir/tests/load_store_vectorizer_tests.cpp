@@ -366,6 +366,65 @@ TEST_F(nir_load_store_vectorize_test, ubo_load_adjacent)
    ASSERT_EQ(loads[0x2]->swizzle[0], 1);
 }
 
+TEST_F(nir_load_store_vectorize_test, ubo_load_adjacent_across_if)
+{
+   create_load(nir_var_mem_ubo, 0, 0, 0x1);
+   nir_push_if(b, nir_ieq(b, nir_load_local_invocation_index(b),
+                          nir_imm_int(b, 0)));
+   create_load(nir_var_mem_ubo, 0, 8, 0x2);
+   nir_pop_if(b, NULL);
+   create_load(nir_var_mem_ubo, 0, 4, 0x3);
+
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 3);
+
+   EXPECT_TRUE(run_vectorizer(nir_var_mem_ubo));
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 2);
+
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ubo, 0);
+   ASSERT_EQ(load->dest.ssa.num_components, 2);
+   ASSERT_EQ(nir_src_as_uint(load->src[1]), 0);
+   ASSERT_EQ(loads[0x1]->src.ssa, &load->dest.ssa);
+   ASSERT_EQ(loads[0x3]->src.ssa, &load->dest.ssa);
+   ASSERT_EQ(loads[0x1]->swizzle[0], 0);
+   ASSERT_EQ(loads[0x3]->swizzle[0], 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_adjacent_across_if_store)
+{
+   create_load(nir_var_mem_ssbo, 0, 0, 0x1);
+   nir_push_if(b, nir_ieq(b, nir_load_local_invocation_index(b),
+                          nir_imm_int(b, 0)));
+   create_store(nir_var_mem_ssbo, 0, 4, 0x2);
+   nir_pop_if(b, NULL);
+   create_load(nir_var_mem_ssbo, 0, 4, 0x3);
+
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_adjacent_across_if)
+{
+   create_store(nir_var_mem_ssbo, 0, 0, 0x1);
+   nir_push_if(b, nir_ieq(b, nir_load_local_invocation_index(b),
+                          nir_imm_int(b, 0)));
+   create_load(nir_var_mem_ssbo, 0, 0, 0x2);
+   nir_pop_if(b, NULL);
+   create_store(nir_var_mem_ssbo, 0, 4, 0x3);
+
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 2);
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 2);
+}
+
 TEST_F(nir_load_store_vectorize_test, ubo_load_intersecting)
 {
    create_load(nir_var_mem_ubo, 0, 0, 0x1, 32, 2);
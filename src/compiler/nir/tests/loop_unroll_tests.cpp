@@ -0,0 +1,172 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+unsigned requested_factor;
+
+unsigned
+test_unroll_factor(const nir_shader *shader, const nir_loop *loop,
+                   unsigned trip_count, unsigned default_factor)
+{
+   return requested_factor;
+}
+
+class nir_loop_unroll_test : public ::testing::Test {
+protected:
+   nir_loop_unroll_test();
+   ~nir_loop_unroll_test();
+
+   void build_loop(nir_ssa_def *count);
+   unsigned count_loops();
+   unsigned count_ifs();
+
+   nir_shader_compiler_options options;
+   nir_builder bld;
+};
+
+nir_loop_unroll_test::nir_loop_unroll_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   memset(&options, 0, sizeof(options));
+   options.max_unroll_iterations = 32;
+   options.loop_unroll_factor = test_unroll_factor;
+   nir_builder_init_simple_shader(&bld, NULL, MESA_SHADER_COMPUTE, &options);
+}
+
+nir_loop_unroll_test::~nir_loop_unroll_test()
+{
+   ralloc_free(bld.shader);
+   glsl_type_singleton_decref();
+}
+
+/* for (int i = 0; i < count; i++) sum += i; */
+void
+nir_loop_unroll_test::build_loop(nir_ssa_def *count)
+{
+   nir_variable *i = nir_local_variable_create(bld.impl, glsl_int_type(), "i");
+   nir_variable *sum =
+      nir_local_variable_create(bld.impl, glsl_int_type(), "sum");
+   nir_store_var(&bld, i, nir_imm_int(&bld, 0), 1);
+   nir_store_var(&bld, sum, nir_imm_int(&bld, 0), 1);
+
+   nir_loop *loop = nir_push_loop(&bld);
+   nir_ssa_def *iv = nir_load_var(&bld, i);
+   nir_push_if(&bld, nir_ige(&bld, iv, count));
+   nir_jump(&bld, nir_jump_break);
+   nir_pop_if(&bld, NULL);
+   nir_store_var(&bld, sum, nir_iadd(&bld, nir_load_var(&bld, sum), iv), 1);
+   nir_store_var(&bld, i, nir_iadd_imm(&bld, iv, 1), 1);
+   nir_pop_loop(&bld, loop);
+
+   nir_variable *out = nir_variable_create(bld.shader, nir_var_shader_out,
+                                           glsl_int_type(), "out");
+   nir_store_var(&bld, out, nir_load_var(&bld, sum), 1);
+
+   nir_lower_vars_to_ssa(bld.shader);
+   nir_copy_prop(bld.shader);
+   nir_opt_dce(bld.shader);
+   nir_validate_shader(bld.shader, NULL);
+}
+
+static unsigned
+count_cf_nodes(struct exec_list *list, nir_cf_node_type type)
+{
+   unsigned count = 0;
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      if (node->type == type)
+         count++;
+
+      if (node->type == nir_cf_node_if) {
+         nir_if *nif = nir_cf_node_as_if(node);
+         count += count_cf_nodes(&nif->then_list, type);
+         count += count_cf_nodes(&nif->else_list, type);
+      } else if (node->type == nir_cf_node_loop) {
+         count += count_cf_nodes(&nir_cf_node_as_loop(node)->body, type);
+      }
+   }
+   return count;
+}
+
+unsigned
+nir_loop_unroll_test::count_loops()
+{
+   return count_cf_nodes(&bld.impl->body, nir_cf_node_loop);
+}
+
+unsigned
+nir_loop_unroll_test::count_ifs()
+{
+   return count_cf_nodes(&bld.impl->body, nir_cf_node_if);
+}
+
+} /* namespace */
+
+TEST_F(nir_loop_unroll_test, partial_unroll_unknown_trip_count)
+{
+   build_loop(nir_channel(&bld, nir_load_local_invocation_id(&bld), 0));
+
+   requested_factor = 3;
+   ASSERT_TRUE(nir_opt_loop_unroll(bld.shader, nir_var_all));
+   nir_validate_shader(bld.shader, NULL);
+
+   /* The loop stays, with the exit check copied along with the body. */
+   EXPECT_EQ(count_loops(), 1u);
+   EXPECT_EQ(count_ifs(), 3u);
+
+   /* It's only done once. */
+   EXPECT_FALSE(nir_opt_loop_unroll(bld.shader, nir_var_all));
+}
+
+TEST_F(nir_loop_unroll_test, callback_declines)
+{
+   build_loop(nir_channel(&bld, nir_load_local_invocation_id(&bld), 0));
+
+   requested_factor = 0;
+   EXPECT_FALSE(nir_opt_loop_unroll(bld.shader, nir_var_all));
+   EXPECT_EQ(count_loops(), 1u);
+   EXPECT_EQ(count_ifs(), 1u);
+}
+
+TEST_F(nir_loop_unroll_test, callback_vetoes_complete_unroll)
+{
+   build_loop(nir_imm_int(&bld, 4));
+
+   requested_factor = 0;
+   EXPECT_FALSE(nir_opt_loop_unroll(bld.shader, nir_var_all));
+   EXPECT_EQ(count_loops(), 1u);
+}
+
+TEST_F(nir_loop_unroll_test, callback_allows_complete_unroll)
+{
+   build_loop(nir_imm_int(&bld, 4));
+
+   requested_factor = 4;
+   ASSERT_TRUE(nir_opt_loop_unroll(bld.shader, nir_var_all));
+   nir_validate_shader(bld.shader, NULL);
+   EXPECT_EQ(count_loops(), 0u);
+}
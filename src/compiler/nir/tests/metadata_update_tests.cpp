@@ -0,0 +1,258 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+struct block_info {
+   nir_block *imm_dom;
+   std::set<nir_block *> dom_frontier;
+   std::set<nir_block *> dom_children;
+   int16_t dom_pre_index;
+   int16_t dom_post_index;
+   std::set<nir_ssa_def *> live_in;
+   std::set<nir_ssa_def *> live_out;
+};
+
+class nir_metadata_update_test : public ::testing::Test {
+protected:
+   nir_metadata_update_test();
+   ~nir_metadata_update_test();
+
+   std::vector<block_info> snapshot();
+   void expect_same_as_recomputed();
+
+   nir_builder bld;
+   nir_function_impl *impl;
+};
+
+nir_metadata_update_test::nir_metadata_update_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   static const nir_shader_compiler_options options = { };
+   nir_builder_init_simple_shader(&bld, NULL, MESA_SHADER_COMPUTE, &options);
+   impl = bld.impl;
+}
+
+nir_metadata_update_test::~nir_metadata_update_test()
+{
+   ralloc_free(bld.shader);
+   glsl_type_singleton_decref();
+}
+
+static bool
+add_def(nir_ssa_def *def, void *defs)
+{
+   ((std::vector<nir_ssa_def *> *)defs)->push_back(def);
+   return true;
+}
+
+std::vector<block_info>
+nir_metadata_update_test::snapshot()
+{
+   std::vector<nir_ssa_def *> defs;
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, add_def, &defs);
+   }
+
+   std::vector<block_info> info;
+   nir_foreach_block(block, impl) {
+      block_info bi;
+      bi.imm_dom = block->imm_dom;
+      set_foreach(block->dom_frontier, entry)
+         bi.dom_frontier.insert((nir_block *)entry->key);
+      for (unsigned i = 0; i < block->num_dom_children; i++)
+         bi.dom_children.insert(block->dom_children[i]);
+      bi.dom_pre_index = block->dom_pre_index;
+      bi.dom_post_index = block->dom_post_index;
+      for (nir_ssa_def *def : defs) {
+         if (def->live_index == 0)
+            continue;
+         if (BITSET_TEST(block->live_in, def->live_index))
+            bi.live_in.insert(def);
+         if (BITSET_TEST(block->live_out, def->live_index))
+            bi.live_out.insert(def);
+      }
+      info.push_back(bi);
+   }
+
+   return info;
+}
+
+void
+nir_metadata_update_test::expect_same_as_recomputed()
+{
+   std::vector<block_info> updated = snapshot();
+
+   nir_metadata_preserve(impl, nir_metadata_none);
+   nir_metadata_require(impl, (nir_metadata)(nir_metadata_block_index |
+                                             nir_metadata_dominance |
+                                             nir_metadata_live_ssa_defs));
+   std::vector<block_info> expected = snapshot();
+
+   ASSERT_EQ(updated.size(), expected.size());
+   for (unsigned i = 0; i < updated.size(); i++) {
+      EXPECT_EQ(updated[i].imm_dom, expected[i].imm_dom) << "block " << i;
+      EXPECT_EQ(updated[i].dom_frontier, expected[i].dom_frontier) << "block " << i;
+      EXPECT_EQ(updated[i].dom_children, expected[i].dom_children) << "block " << i;
+      EXPECT_EQ(updated[i].dom_pre_index, expected[i].dom_pre_index) << "block " << i;
+      EXPECT_EQ(updated[i].dom_post_index, expected[i].dom_post_index) << "block " << i;
+      EXPECT_EQ(updated[i].live_in, expected[i].live_in) << "block " << i;
+      EXPECT_EQ(updated[i].live_out, expected[i].live_out) << "block " << i;
+   }
+}
+
+} /* namespace */
+
+TEST_F(nir_metadata_update_test, split_block_in_loop)
+{
+   nir_ssa_def *a = nir_load_local_invocation_index(&bld);
+   nir_ssa_def *one = nir_imm_int(&bld, 1);
+
+   nir_loop *loop = nir_push_loop(&bld);
+   nir_ssa_def *c = nir_ieq(&bld, a, one);
+   nir_push_if(&bld, c);
+   nir_jump(&bld, nir_jump_break);
+   nir_pop_if(&bld, NULL);
+   nir_ssa_def *d = nir_iadd(&bld, a, one);
+   nir_ssa_def *e = nir_imul(&bld, d, a);
+   nir_pop_loop(&bld, loop);
+   nir_iadd(&bld, a, one);
+
+   nir_metadata_require(impl, (nir_metadata)(nir_metadata_block_index |
+                                             nir_metadata_dominance |
+                                             nir_metadata_live_ssa_defs));
+
+   /* Wrap e in an if. */
+   bld.cursor = nir_after_instr(d->parent_instr);
+   nir_if *nif = nir_push_if(&bld, d);
+   nir_instr_remove(e->parent_instr);
+   nir_instr_insert(nir_before_cf_list(&nif->then_list), e->parent_instr);
+   nir_pop_if(&bld, nif);
+
+   nir_dominance_update_cf_insert(&nif->cf_node);
+   nir_live_ssa_defs_update_cf_insert(&nif->cf_node);
+
+   expect_same_as_recomputed();
+}
+
+TEST_F(nir_metadata_update_test, split_block_beginning)
+{
+   nir_ssa_def *a = nir_load_local_invocation_index(&bld);
+   nir_ssa_def *one = nir_imm_int(&bld, 1);
+   nir_ssa_def *c = nir_ieq(&bld, a, one);
+
+   nir_push_if(&bld, c);
+   nir_ssa_def *then_def = nir_iadd(&bld, a, one);
+   nir_push_else(&bld, NULL);
+   nir_ssa_def *else_def = nir_isub(&bld, a, one);
+   nir_pop_if(&bld, NULL);
+   nir_ssa_def *phi = nir_if_phi(&bld, then_def, else_def);
+   nir_ssa_def *f = nir_iadd(&bld, phi, a);
+
+   nir_metadata_require(impl, (nir_metadata)(nir_metadata_block_index |
+                                             nir_metadata_dominance |
+                                             nir_metadata_live_ssa_defs));
+
+   /* Insert an if right after the phi, so the top half is the new block. */
+   bld.cursor = nir_before_instr(f->parent_instr);
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_pop_if(&bld, nif);
+
+   nir_dominance_update_cf_insert(&nif->cf_node);
+   nir_live_ssa_defs_update_cf_insert(&nif->cf_node);
+
+   expect_same_as_recomputed();
+}
+
+TEST_F(nir_metadata_update_test, remove_break)
+{
+   nir_ssa_def *a = nir_load_local_invocation_index(&bld);
+   nir_ssa_def *one = nir_imm_int(&bld, 1);
+
+   nir_loop *loop = nir_push_loop(&bld);
+   nir_ssa_def *c = nir_ieq(&bld, a, one);
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_jump(&bld, nir_jump_break);
+   nir_pop_if(&bld, nif);
+   nir_iadd(&bld, a, one);
+   nir_jump(&bld, nir_jump_break);
+   nir_pop_loop(&bld, loop);
+   nir_iadd(&bld, a, one);
+
+   nir_metadata_require(impl, (nir_metadata)(nir_metadata_block_index |
+                                             nir_metadata_dominance |
+                                             nir_metadata_live_ssa_defs));
+
+   nir_block *then_block = nir_if_first_then_block(nif);
+   nir_block *old_succs[2] = {
+      then_block->successors[0], then_block->successors[1],
+   };
+   nir_instr_remove(nir_block_last_instr(then_block));
+
+   nir_dominance_update_successors(then_block, old_succs);
+   nir_live_ssa_defs_update_successors(then_block);
+
+   expect_same_as_recomputed();
+}
+
+TEST_F(nir_metadata_update_test, add_break)
+{
+   nir_ssa_def *a = nir_load_local_invocation_index(&bld);
+   nir_ssa_def *one = nir_imm_int(&bld, 1);
+
+   nir_loop *loop = nir_push_loop(&bld);
+   nir_ssa_def *c = nir_ieq(&bld, a, one);
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_jump(&bld, nir_jump_break);
+   nir_pop_if(&bld, nif);
+   nir_ssa_def *d = nir_iadd(&bld, a, one);
+   nir_bcsel(&bld, c, d, a);
+   nir_pop_loop(&bld, loop);
+   nir_iadd(&bld, a, one);
+
+   nir_metadata_require(impl, (nir_metadata)(nir_metadata_block_index |
+                                             nir_metadata_dominance |
+                                             nir_metadata_live_ssa_defs));
+
+   /* Breaking from the else as well makes the rest of the loop body
+    * unreachable.
+    */
+   nir_block *else_block = nir_if_first_else_block(nif);
+   nir_block *old_succs[2] = {
+      else_block->successors[0], else_block->successors[1],
+   };
+   nir_jump_instr *jump = nir_jump_instr_create(bld.shader, nir_jump_break);
+   nir_instr_insert(nir_after_block(else_block), &jump->instr);
+
+   nir_dominance_update_successors(else_block, old_succs);
+   nir_live_ssa_defs_update_successors(else_block);
+
+   expect_same_as_recomputed();
+}
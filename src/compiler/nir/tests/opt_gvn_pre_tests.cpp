@@ -0,0 +1,157 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_opt_gvn_pre_test : public ::testing::Test {
+protected:
+   nir_opt_gvn_pre_test();
+   ~nir_opt_gvn_pre_test();
+
+   unsigned count_alu(nir_block *block, nir_op op);
+
+   nir_builder bld;
+   nir_ssa_def *x, *y, *c;
+};
+
+nir_opt_gvn_pre_test::nir_opt_gvn_pre_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   static const nir_shader_compiler_options options = { };
+   nir_builder_init_simple_shader(&bld, NULL, MESA_SHADER_FRAGMENT, &options);
+
+   x = nir_load_frag_coord(&bld);
+   y = nir_channel(&bld, x, 1);
+   x = nir_channel(&bld, x, 0);
+   c = nir_flt(&bld, x, y);
+}
+
+nir_opt_gvn_pre_test::~nir_opt_gvn_pre_test()
+{
+   ralloc_free(bld.shader);
+   glsl_type_singleton_decref();
+}
+
+unsigned
+nir_opt_gvn_pre_test::count_alu(nir_block *block, nir_op op)
+{
+   unsigned count = 0;
+   nir_foreach_instr(instr, block) {
+      if (instr->type == nir_instr_type_alu &&
+          nir_instr_as_alu(instr)->op == op)
+         count++;
+   }
+   return count;
+}
+
+} /* namespace */
+
+TEST_F(nir_opt_gvn_pre_test, one_arm)
+{
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_fmul(&bld, x, y);
+   nir_pop_if(&bld, nif);
+   nir_ssa_def *after = nir_fmul(&bld, x, y);
+   nir_fadd(&bld, after, x);
+
+   ASSERT_TRUE(nir_opt_gvn_pre(bld.shader));
+   nir_validate_shader(bld.shader, NULL);
+
+   nir_block *merge = nir_cf_node_as_block(nir_cf_node_next(&nif->cf_node));
+   EXPECT_EQ(count_alu(nir_if_last_then_block(nif), nir_op_fmul), 1u);
+   EXPECT_EQ(count_alu(nir_if_last_else_block(nif), nir_op_fmul), 1u);
+   EXPECT_EQ(count_alu(merge, nir_op_fmul), 0u);
+   EXPECT_EQ(nir_block_first_instr(merge)->type, nir_instr_type_phi);
+
+   EXPECT_FALSE(nir_opt_gvn_pre(bld.shader));
+}
+
+TEST_F(nir_opt_gvn_pre_test, both_arms)
+{
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_fmul(&bld, x, y);
+   nir_push_else(&bld, nif);
+   nir_fmul(&bld, y, x);
+   nir_pop_if(&bld, nif);
+   nir_fmul(&bld, x, y);
+
+   ASSERT_TRUE(nir_opt_gvn_pre(bld.shader));
+   nir_validate_shader(bld.shader, NULL);
+
+   nir_block *merge = nir_cf_node_as_block(nir_cf_node_next(&nif->cf_node));
+   EXPECT_EQ(count_alu(nir_if_last_then_block(nif), nir_op_fmul), 1u);
+   EXPECT_EQ(count_alu(nir_if_last_else_block(nif), nir_op_fmul), 1u);
+   EXPECT_EQ(count_alu(merge, nir_op_fmul), 0u);
+}
+
+TEST_F(nir_opt_gvn_pre_test, chain)
+{
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_fadd(&bld, nir_fmul(&bld, x, y), x);
+   nir_pop_if(&bld, nif);
+   nir_fadd(&bld, nir_fmul(&bld, x, y), x);
+
+   ASSERT_TRUE(nir_opt_gvn_pre(bld.shader));
+   nir_validate_shader(bld.shader, NULL);
+
+   nir_block *merge = nir_cf_node_as_block(nir_cf_node_next(&nif->cf_node));
+   EXPECT_EQ(count_alu(merge, nir_op_fmul), 0u);
+   EXPECT_EQ(count_alu(merge, nir_op_fadd), 0u);
+   EXPECT_EQ(count_alu(nir_if_last_else_block(nif), nir_op_fadd), 1u);
+}
+
+TEST_F(nir_opt_gvn_pre_test, not_in_arm)
+{
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_fadd(&bld, x, y);
+   nir_pop_if(&bld, nif);
+   nir_fmul(&bld, x, y);
+
+   EXPECT_FALSE(nir_opt_gvn_pre(bld.shader));
+}
+
+TEST_F(nir_opt_gvn_pre_test, derivative)
+{
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_fddx(&bld, x);
+   nir_pop_if(&bld, nif);
+   nir_fddx(&bld, x);
+
+   EXPECT_FALSE(nir_opt_gvn_pre(bld.shader));
+}
+
+TEST_F(nir_opt_gvn_pre_test, arm_source_not_available)
+{
+   nir_if *nif = nir_push_if(&bld, c);
+   nir_ssa_def *z = nir_fadd(&bld, x, y);
+   nir_fmul(&bld, z, y);
+   nir_pop_if(&bld, nif);
+   nir_ssa_def *w = nir_fadd(&bld, y, y);
+   nir_fmul(&bld, w, y);
+
+   EXPECT_FALSE(nir_opt_gvn_pre(bld.shader));
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_opt_uniform_subgroup_test : public ::testing::Test {
+protected:
+   nir_opt_uniform_subgroup_test();
+   ~nir_opt_uniform_subgroup_test();
+
+   nir_intrinsic_instr *subgroup_op(nir_intrinsic_op op, nir_ssa_def *src,
+                                    nir_op reduction_op = nir_op_iadd);
+   unsigned count_intrinsics(nir_intrinsic_op op);
+
+   nir_builder b;
+   nir_ssa_def *uniform;
+   nir_ssa_def *divergent;
+   nir_variable *out;
+};
+
+nir_opt_uniform_subgroup_test::nir_opt_uniform_subgroup_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   static const nir_shader_compiler_options options = { };
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_COMPUTE, &options);
+
+   uniform = nir_channel(&b, nir_load_num_work_groups(&b), 0);
+   divergent = nir_load_local_invocation_index(&b);
+
+   out = nir_variable_create(b.shader, nir_var_mem_shared,
+                             glsl_uint_type(), "out");
+}
+
+nir_opt_uniform_subgroup_test::~nir_opt_uniform_subgroup_test()
+{
+   ralloc_free(b.shader);
+   glsl_type_singleton_decref();
+}
+
+nir_intrinsic_instr *
+nir_opt_uniform_subgroup_test::subgroup_op(nir_intrinsic_op op,
+                                           nir_ssa_def *src,
+                                           nir_op reduction_op)
+{
+   nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(b.shader, op);
+   if (nir_intrinsic_infos[op].dest_components == 0)
+      intrin->num_components = 1;
+   intrin->src[0] = nir_src_for_ssa(src);
+   if (op == nir_intrinsic_reduce || op == nir_intrinsic_inclusive_scan)
+      nir_intrinsic_set_reduction_op(intrin, reduction_op);
+
+   const unsigned bit_size =
+      op == nir_intrinsic_vote_ieq ? 1 : src->bit_size;
+   nir_ssa_dest_init(&intrin->instr, &intrin->dest, 1, bit_size, NULL);
+   nir_builder_instr_insert(&b, &intrin->instr);
+
+   nir_ssa_def *value = &intrin->dest.ssa;
+   if (bit_size == 1)
+      value = nir_b2i32(&b, value);
+   nir_store_var(&b, out, value, 1);
+
+   return intrin;
+}
+
+unsigned
+nir_opt_uniform_subgroup_test::count_intrinsics(nir_intrinsic_op op)
+{
+   unsigned count = 0;
+   nir_foreach_block(block, nir_shader_get_entrypoint(b.shader)) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_intrinsic &&
+             nir_instr_as_intrinsic(instr)->intrinsic == op)
+            count++;
+      }
+   }
+   return count;
+}
+
+} /* namespace */
+
+TEST_F(nir_opt_uniform_subgroup_test, read_first_invocation)
+{
+   subgroup_op(nir_intrinsic_read_first_invocation, uniform);
+   subgroup_op(nir_intrinsic_read_first_invocation, divergent);
+
+   ASSERT_TRUE(nir_opt_uniform_subgroup(b.shader, (nir_divergence_options)0));
+   nir_validate_shader(b.shader, NULL);
+
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_read_first_invocation), 1u);
+}
+
+TEST_F(nir_opt_uniform_subgroup_test, vote)
+{
+   nir_ssa_def *uniform_cond = nir_ieq(&b, uniform, nir_imm_int(&b, 1));
+   nir_ssa_def *divergent_cond = nir_ieq(&b, divergent, nir_imm_int(&b, 1));
+
+   subgroup_op(nir_intrinsic_vote_any, uniform_cond);
+   subgroup_op(nir_intrinsic_vote_all, uniform_cond);
+   subgroup_op(nir_intrinsic_vote_ieq, uniform);
+   subgroup_op(nir_intrinsic_vote_any, divergent_cond);
+
+   ASSERT_TRUE(nir_opt_uniform_subgroup(b.shader, (nir_divergence_options)0));
+   nir_validate_shader(b.shader, NULL);
+
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_vote_any), 1u);
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_vote_all), 0u);
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_vote_ieq), 0u);
+}
+
+TEST_F(nir_opt_uniform_subgroup_test, reduce)
+{
+   /* Adding up a uniform value is not the same as the value itself. */
+   subgroup_op(nir_intrinsic_reduce, uniform, nir_op_iadd);
+   subgroup_op(nir_intrinsic_reduce, uniform, nir_op_umax);
+   subgroup_op(nir_intrinsic_inclusive_scan, uniform, nir_op_iand);
+   subgroup_op(nir_intrinsic_reduce, divergent, nir_op_umax);
+
+   ASSERT_TRUE(nir_opt_uniform_subgroup(b.shader, (nir_divergence_options)0));
+   nir_validate_shader(b.shader, NULL);
+
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_reduce), 2u);
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_inclusive_scan), 0u);
+}
+
+TEST_F(nir_opt_uniform_subgroup_test, no_progress)
+{
+   subgroup_op(nir_intrinsic_read_first_invocation, divergent);
+   subgroup_op(nir_intrinsic_reduce, uniform, nir_op_iadd);
+
+   EXPECT_FALSE(nir_opt_uniform_subgroup(b.shader, (nir_divergence_options)0));
+}
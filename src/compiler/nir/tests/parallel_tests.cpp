@@ -0,0 +1,154 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+const unsigned num_functions = 16;
+const unsigned num_instrs = 1000;
+
+/* Builds a loop full of ALU instructions, using a local register. */
+bool
+fill_impl(nir_function_impl *impl, void *data)
+{
+   nir_builder b;
+   nir_builder_init(&b, impl);
+   b.cursor = nir_after_cf_list(&impl->body);
+
+   nir_register *reg = nir_local_reg_create(impl);
+   reg->num_components = 1;
+   reg->bit_size = 32;
+
+   nir_loop *loop = nir_push_loop(&b);
+
+   nir_ssa_def *def = nir_imm_int(&b, 1);
+   for (unsigned i = 0; i < num_instrs; i++)
+      def = nir_iadd(&b, def, nir_imm_int(&b, i));
+   nir_store_reg(&b, reg, def, 0x1);
+
+   nir_jump(&b, nir_jump_break);
+   nir_pop_loop(&b, loop);
+
+   nir_metadata_preserve(impl, nir_metadata_none);
+   return true;
+}
+
+class nir_parallel_test : public ::testing::Test {
+protected:
+   nir_parallel_test();
+   ~nir_parallel_test();
+
+   nir_shader *shader;
+};
+
+nir_parallel_test::nir_parallel_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   static const nir_shader_compiler_options options = { };
+   shader = nir_shader_create(NULL, MESA_SHADER_KERNEL, &options, NULL);
+
+   for (unsigned i = 0; i < num_functions; i++) {
+      nir_function *func = nir_function_create(shader, "func");
+      nir_function_impl_create(func);
+   }
+}
+
+nir_parallel_test::~nir_parallel_test()
+{
+   ralloc_free(shader);
+   glsl_type_singleton_decref();
+}
+
+} /* namespace */
+
+TEST_F(nir_parallel_test, build)
+{
+   ASSERT_TRUE(nir_shader_impls_parallel(shader, fill_impl, NULL));
+
+   nir_validate_shader(shader, "after nir_shader_impls_parallel");
+
+   /* Everything ends up owned by the shader. */
+   nir_foreach_function(func, shader) {
+      unsigned count = 0;
+
+      nir_foreach_block(block, func->impl) {
+         EXPECT_EQ(ralloc_parent(block), shader);
+
+         nir_foreach_instr(instr, block) {
+            EXPECT_EQ(ralloc_parent(instr), shader);
+            count++;
+         }
+      }
+
+      nir_foreach_register(reg, &func->impl->registers)
+         EXPECT_EQ(ralloc_parent(reg), shader);
+
+      /* Two instructions per iteration, plus the first immediate, the
+       * store and the break.
+       */
+      EXPECT_EQ(count, num_instrs * 2 + 3);
+   }
+}
+
+static bool
+add_dead_instrs(nir_function_impl *impl, void *data)
+{
+   nir_builder b;
+   nir_builder_init(&b, impl);
+   b.cursor = nir_before_cf_list(&impl->body);
+
+   for (unsigned i = 0; i < num_instrs; i++)
+      nir_imm_int(&b, i);
+
+   nir_metadata_preserve(impl, (nir_metadata)(nir_metadata_block_index |
+                                              nir_metadata_dominance));
+   return true;
+}
+
+static bool
+dce_impl(nir_function_impl *impl, void *data)
+{
+   return nir_opt_dce_impl(impl);
+}
+
+TEST_F(nir_parallel_test, optimize)
+{
+   nir_shader_impls_parallel(shader, fill_impl, NULL);
+   nir_shader_impls_parallel(shader, add_dead_instrs, NULL);
+
+   EXPECT_TRUE(nir_shader_impls_parallel(shader, dce_impl, NULL));
+   EXPECT_FALSE(nir_shader_impls_parallel(shader, dce_impl, NULL));
+
+   nir_validate_shader(shader, "after parallel nir_opt_dce_impl");
+}
+
+TEST_F(nir_parallel_test, no_impls)
+{
+   nir_shader *empty = nir_shader_create(NULL, MESA_SHADER_KERNEL,
+                                         shader->options, NULL);
+   EXPECT_FALSE(nir_shader_impls_parallel(empty, fill_impl, NULL));
+   ralloc_free(empty);
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_pass_manager.h"
+
+namespace {
+
+/* A fake pass which makes progress the first "progress" times it runs. */
+struct fake_pass {
+   unsigned runs;
+   unsigned progress;
+   nir_metadata preserved;
+};
+
+bool
+run_fake_pass(nir_shader *shader, fake_pass *pass)
+{
+   pass->runs++;
+
+   if (pass->progress == 0)
+      return false;
+
+   pass->progress--;
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         nir_metadata_preserve(function->impl, pass->preserved);
+   }
+   return true;
+}
+
+class nir_pass_manager_test : public ::testing::Test {
+protected:
+   nir_pass_manager_test();
+   ~nir_pass_manager_test();
+
+   nir_builder bld;
+   nir_pass_manager pm;
+};
+
+nir_pass_manager_test::nir_pass_manager_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   static const nir_shader_compiler_options options = { };
+   nir_builder_init_simple_shader(&bld, NULL, MESA_SHADER_COMPUTE, &options);
+
+   nir_pass_manager_init(&pm, bld.shader, "test");
+   pm.skip = true;
+}
+
+nir_pass_manager_test::~nir_pass_manager_test()
+{
+   nir_pass_manager_finish(&pm);
+   ralloc_free(bld.shader);
+   glsl_type_singleton_decref();
+}
+
+} /* namespace */
+
+TEST_F(nir_pass_manager_test, skip_unchanged)
+{
+   fake_pass a = { 0, 2, nir_metadata_none };
+   fake_pass b = { 0, 0, nir_metadata_none };
+   bool progress;
+
+   do {
+      progress = false;
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &a);
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &b);
+   } while (progress);
+
+   /* b has seen every change a made by the time a first fails to make
+    * progress, so it doesn't need to run again.
+    */
+   EXPECT_EQ(a.runs, 3u);
+   EXPECT_EQ(b.runs, 2u);
+}
+
+TEST_F(nir_pass_manager_test, rerun_after_change)
+{
+   fake_pass a = { 0, 0, nir_metadata_none };
+   fake_pass b = { 0, 2, nir_metadata_none };
+   bool progress;
+
+   do {
+      progress = false;
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &a);
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &b);
+   } while (progress);
+
+   EXPECT_EQ(a.runs, 3u);
+   EXPECT_EQ(b.runs, 3u);
+}
+
+TEST_F(nir_pass_manager_test, call_sites)
+{
+   fake_pass a = { 0, 1, nir_metadata_none };
+   fake_pass b = { 0, 0, nir_metadata_none };
+   bool progress;
+
+   /* The same pass at two call sites is tracked separately. */
+   do {
+      progress = false;
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &b);
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &a);
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &b);
+   } while (progress);
+
+   EXPECT_EQ(a.runs, 2u);
+   EXPECT_EQ(b.runs, 3u);
+}
+
+TEST_F(nir_pass_manager_test, cf_only)
+{
+   fake_pass instrs = {
+      0, 3, (nir_metadata)(nir_metadata_block_index | nir_metadata_dominance)
+   };
+   fake_pass cf = { 0, 0, nir_metadata_none };
+   fake_pass other = { 0, 0, nir_metadata_none };
+   bool progress;
+
+   do {
+      progress = false;
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &instrs);
+      NIR_PM_PASS_CF(progress, &pm, run_fake_pass, &cf);
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &other);
+   } while (progress);
+
+   /* Only instructions changed after the first run of cf. */
+   EXPECT_EQ(instrs.runs, 4u);
+   EXPECT_EQ(cf.runs, 1u);
+   EXPECT_EQ(other.runs, 3u);
+}
+
+TEST_F(nir_pass_manager_test, cf_only_rerun_after_cf_change)
+{
+   fake_pass cf_changes = { 0, 2, nir_metadata_none };
+   fake_pass cf = { 0, 0, nir_metadata_none };
+   bool progress;
+
+   do {
+      progress = false;
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &cf_changes);
+      NIR_PM_PASS_CF(progress, &pm, run_fake_pass, &cf);
+   } while (progress);
+
+   EXPECT_EQ(cf_changes.runs, 3u);
+   EXPECT_EQ(cf.runs, 2u);
+}
+
+TEST_F(nir_pass_manager_test, no_skip)
+{
+   fake_pass a = { 0, 2, nir_metadata_none };
+   fake_pass b = { 0, 0, nir_metadata_none };
+   bool progress;
+
+   pm.skip = false;
+
+   do {
+      progress = false;
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &a);
+      NIR_PM_PASS(progress, &pm, run_fake_pass, &b);
+   } while (progress);
+
+   EXPECT_EQ(a.runs, 3u);
+   EXPECT_EQ(b.runs, 3u);
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+bool
+add_instr(nir_shader *shader, nir_builder *b)
+{
+   nir_imm_int(b, 1);
+   nir_metadata_preserve(b->impl, nir_metadata_none);
+   return true;
+}
+
+bool
+noop(nir_shader *shader)
+{
+   return false;
+}
+
+class nir_pass_profile_test : public ::testing::Test {
+protected:
+   nir_pass_profile_test();
+   ~nir_pass_profile_test();
+
+   std::string dump();
+
+   nir_builder bld;
+};
+
+nir_pass_profile_test::nir_pass_profile_test()
+{
+   /* Read once, before the first pass runs. */
+   setenv("NIR_PASS_PROFILE", "/dev/null", 0);
+
+   glsl_type_singleton_init_or_ref();
+
+   static const nir_shader_compiler_options options = { };
+   nir_builder_init_simple_shader(&bld, NULL, MESA_SHADER_FRAGMENT, &options);
+
+   nir_pass_profile_reset();
+}
+
+nir_pass_profile_test::~nir_pass_profile_test()
+{
+   ralloc_free(bld.shader);
+   glsl_type_singleton_decref();
+}
+
+std::string
+nir_pass_profile_test::dump()
+{
+   FILE *fp = tmpfile();
+   nir_pass_profile_dump(fp);
+
+   std::string str;
+   rewind(fp);
+   for (int c; (c = fgetc(fp)) != EOF;)
+      str += (char)c;
+   fclose(fp);
+
+   return str;
+}
+
+} /* namespace */
+
+TEST_F(nir_pass_profile_test, enabled)
+{
+   EXPECT_TRUE(should_profile_nir());
+}
+
+TEST_F(nir_pass_profile_test, counts)
+{
+   bool progress = false;
+
+   NIR_PASS(progress, bld.shader, add_instr, &bld);
+   NIR_PASS(progress, bld.shader, add_instr, &bld);
+   NIR_PASS(progress, bld.shader, noop);
+   NIR_PASS_V(bld.shader, noop);
+
+   std::string json = dump();
+   EXPECT_NE(json.find("{\"name\": \"add_instr\", \"calls\": 2, "
+                       "\"progress\": 2,"), std::string::npos) << json;
+   EXPECT_NE(json.find("\"instr_delta\": 2, \"stages\": {\"FS\": "
+                       "{\"calls\": 2,"), std::string::npos) << json;
+   EXPECT_NE(json.find("{\"name\": \"noop\", \"calls\": 2, "
+                       "\"progress\": 0,"), std::string::npos) << json;
+}
+
+TEST_F(nir_pass_profile_test, reset)
+{
+   bool progress = false;
+
+   NIR_PASS(progress, bld.shader, noop);
+   nir_pass_profile_reset();
+
+   EXPECT_EQ(dump().find("noop"), std::string::npos);
+}
@@ -103,6 +103,48 @@ nir_serialize_test::ASSERT_SWIZZLE_EQ(nir_alu_instr *a, nir_alu_instr *b, unsign
 
 class nir_serialize_all_test : public nir_serialize_test {};
 class nir_serialize_all_but_one_test : public nir_serialize_test {};
+class nir_serialize_tables_test : public nir_serialize_test {
+protected:
+   size_t serialized_size();
+   void add_vars(unsigned count);
+};
+
+size_t
+nir_serialize_tables_test::serialized_size()
+{
+   struct blob blob;
+   blob_init(&blob);
+   nir_serialize(&blob, b->shader, false);
+   size_t size = blob.size;
+   blob_finish(&blob);
+
+   return size;
+}
+
+/* Adds variables alternating between two struct types and two names, so
+ * that neither is the same as for the previous variable.
+ */
+void
+nir_serialize_tables_test::add_vars(unsigned count)
+{
+   const glsl_struct_field fields_a[] = {
+      glsl_struct_field(glsl_vec4_type(), "position"),
+      glsl_struct_field(glsl_float_type(), "radius"),
+   };
+   const glsl_struct_field fields_b[] = {
+      glsl_struct_field(glsl_uint_type(), "count"),
+      glsl_struct_field(glsl_vec_type(3), "normal"),
+   };
+   const struct glsl_type *types[2] = {
+      glsl_struct_type(fields_a, ARRAY_SIZE(fields_a), "type_a", false),
+      glsl_struct_type(fields_b, ARRAY_SIZE(fields_b), "type_b", false),
+   };
+   const char *names[2] = { "some_long_variable_name", "another_one" };
+
+   for (unsigned i = 0; i < count; i++)
+      nir_variable_create(b->shader, nir_var_shader_temp, types[i % 2],
+                          names[i % 2]);
+}
 
 } // namespace
 
@@ -282,3 +324,45 @@ TEST_P(nir_serialize_all_but_one_test, single_channel)
 
    ASSERT_SWIZZLE_EQ(vec_alu, vec_alu_dup, 1, 0);
 }
+
+TEST_F(nir_serialize_tables_test, vars)
+{
+   add_vars(4);
+
+   serialize();
+
+   struct exec_node *dup_node = exec_list_get_head(&dup->variables);
+   nir_foreach_variable_in_shader(var, b->shader) {
+      nir_variable *dup_var = exec_node_data(nir_variable, dup_node, node);
+      EXPECT_EQ(var->type, dup_var->type);
+      EXPECT_STREQ(var->name, dup_var->name);
+      dup_node = dup_node->next;
+   }
+}
+
+TEST_F(nir_serialize_tables_test, dedup)
+{
+   add_vars(2);
+   size_t size_2 = serialized_size();
+   add_vars(2);
+   size_t size_4 = serialized_size();
+
+   /* The second pair only refers to the types and names written for the
+    * first: each variable is its flags, a type index and a name index.
+    */
+   EXPECT_EQ(size_4 - size_2, 2 * 3 * sizeof(uint32_t));
+}
+
+TEST_F(nir_serialize_tables_test, ssa_names)
+{
+   nir_ssa_def *def = nir_imm_int(b, 1);
+   for (unsigned i = 0; i < 8; i++) {
+      def = nir_iadd(b, def, def);
+      def->name = ralloc_strdup(def->parent_instr, "sum");
+   }
+
+   serialize();
+
+   nir_alu_instr *alu = get_last_alu(dup);
+   EXPECT_STREQ(alu->dest.dest.ssa.name, "sum");
+}
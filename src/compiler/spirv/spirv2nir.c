@@ -29,9 +29,15 @@
  * A simple executable that opens a SPIR-V shader, converts it to NIR, and
  * dumps out the result.  This should be useful for testing the
  * spirv_to_nir code.
+ *
+ * With --optimize, a generic NIR optimization loop is run on the result and
+ * with --time, the time taken by each phase is printed instead of the
+ * shader; see src/compiler/compile_bench.py.
  */
 
 #include "spirv/nir_spirv.h"
+#include "nir/nir_pass_manager.h"
+#include "util/os_time.h"
 
 #include <sys/mman.h>
 #include <sys/types.h>
@@ -65,20 +71,62 @@ stage_to_enum(char *stage)
       return MESA_SHADER_NONE;
 }
 
+static void
+optimize(nir_shader *nir)
+{
+   bool progress;
+
+   NIR_PASS_V(nir, nir_lower_variable_initializers, nir_var_function_temp);
+   NIR_PASS_V(nir, nir_lower_returns);
+   NIR_PASS_V(nir, nir_inline_functions);
+   NIR_PASS_V(nir, nir_opt_deref);
+
+   foreach_list_typed_safe(nir_function, func, node, &nir->functions) {
+      if (!func->is_entrypoint)
+         exec_node_remove(&func->node);
+   }
+
+   NIR_PASS_V(nir, nir_lower_variable_initializers, ~nir_var_function_temp);
+   NIR_PASS_V(nir, nir_split_var_copies);
+   NIR_PASS_V(nir, nir_split_per_member_structs);
+   NIR_PASS_V(nir, nir_lower_vars_to_ssa);
+
+   nir_pass_manager pm;
+   nir_pass_manager_init(&pm, nir, "spirv2nir");
+   do {
+      progress = false;
+
+      NIR_PM_PASS(progress, &pm, nir_lower_vars_to_ssa);
+      NIR_PM_PASS(progress, &pm, nir_copy_prop);
+      NIR_PM_PASS(progress, &pm, nir_opt_remove_phis);
+      NIR_PM_PASS(progress, &pm, nir_opt_dce);
+      NIR_PM_PASS(progress, &pm, nir_opt_dead_cf);
+      NIR_PM_PASS(progress, &pm, nir_opt_cse);
+      NIR_PM_PASS(progress, &pm, nir_opt_peephole_select, 8, true, true);
+      NIR_PM_PASS(progress, &pm, nir_opt_algebraic);
+      NIR_PM_PASS(progress, &pm, nir_opt_constant_folding);
+      NIR_PM_PASS(progress, &pm, nir_opt_undef);
+   } while (progress);
+   nir_pass_manager_finish(&pm);
+}
+
 int main(int argc, char **argv)
 {
    gl_shader_stage shader_stage = MESA_SHADER_FRAGMENT;
    char *entry_point = "main";
+   bool do_optimize = false, do_time = false;
    int ch;
 
    static struct option long_options[] =
      {
-       {"stage",  required_argument, 0, 's'},
-       {"entry",  required_argument, 0, 'e'},
+       {"stage",    required_argument, 0, 's'},
+       {"entry",    required_argument, 0, 'e'},
+       {"optimize", no_argument,       0, 'O'},
+       {"time",     no_argument,       0, 't'},
        {0, 0, 0, 0}
      };
 
-   while ((ch = getopt_long(argc - 1, argv + 1, "s:e:", long_options, NULL)) != -1)
+   while ((ch = getopt_long(argc - 1, argv + 1, "s:e:Ot", long_options, NULL)) != -1)
    {
       switch (ch)
       {
@@ -93,6 +141,12 @@ int main(int argc, char **argv)
          case 'e':
             entry_point = optarg;
             break;
+         case 'O':
+            do_optimize = true;
+            break;
+         case 't':
+            do_time = true;
+            break;
          default:
             fprintf(stderr, "Unrecognized option.\n");
             return 1;
@@ -140,15 +194,38 @@ int main(int argc, char **argv)
       spirv_opts.constant_as_global = true;
    }
 
+   /* The optimization passes need some options to look at. */
+   static const nir_shader_compiler_options nir_opts = { 0 };
+
+   int64_t start = os_time_get_nano();
    nir_shader *nir = spirv_to_nir(map, word_count, NULL, 0,
                                   shader_stage, entry_point,
-                                  &spirv_opts, NULL);
+                                  &spirv_opts,
+                                  do_optimize ? &nir_opts : NULL);
+   int64_t spirv_to_nir_ns = os_time_get_nano() - start;
 
-   if (nir)
-      nir_print_shader(nir, stderr);
-   else
+   if (!nir) {
       fprintf(stderr, "SPIRV to NIR compilation failed\n");
+      glsl_type_singleton_decref();
+      return 1;
+   }
+
+   int64_t optimize_ns = 0;
+   if (do_optimize) {
+      start = os_time_get_nano();
+      optimize(nir);
+      optimize_ns = os_time_get_nano() - start;
+   }
+
+   if (do_time) {
+      printf("spirv_to_nir: %.1f us\n", spirv_to_nir_ns / 1000.0);
+      if (do_optimize)
+         printf("nir_optimize: %.1f us\n", optimize_ns / 1000.0);
+   } else {
+      nir_print_shader(nir, stderr);
+   }
 
+   ralloc_free(nir);
    glsl_type_singleton_decref();
 
    return 0;
@@ -5607,7 +5607,7 @@ spirv_to_nir(const uint32_t *words, size_t word_count,
    vtn_build_cfg(b, words, word_end);
 
    assert(b->entry_point->value_type == vtn_value_type_function);
-   b->entry_point->func->referenced = true;
+   assert(b->entry_point->func->referenced);
 
    bool progress;
    do {
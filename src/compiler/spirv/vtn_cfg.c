@@ -158,6 +158,7 @@ vtn_cfg_handle_prepass_instruction(struct vtn_builder *b, SpvOp opcode,
       b->func->node.type = vtn_cf_node_type_function;
       b->func->node.parent = NULL;
       list_inithead(&b->func->body);
+      util_dynarray_init(&b->func->callees, b->func);
       b->func->control = w[3];
 
       UNUSED const struct glsl_type *result_type = vtn_get_type(b, w[1])->type;
@@ -243,6 +244,11 @@ vtn_cfg_handle_prepass_instruction(struct vtn_builder *b, SpvOp opcode,
       break;
    }
 
+   case SpvOpFunctionCall:
+      vtn_assert(b->func);
+      util_dynarray_append(&b->func->callees, uint32_t, w[3]);
+      break;
+
    case SpvOpSelectionMerge:
    case SpvOpLoopMerge:
       vtn_assert(b->block && b->block->merge == NULL);
@@ -812,15 +818,41 @@ vtn_process_block(struct vtn_builder *b,
    }
 }
 
+static void
+vtn_mark_function_referenced(struct vtn_builder *b, struct vtn_function *func)
+{
+   if (func->referenced)
+      return;
+
+   func->referenced = true;
+
+   util_dynarray_foreach(&func->callees, uint32_t, callee_id) {
+      vtn_mark_function_referenced(b,
+         vtn_value(b, *callee_id, vtn_value_type_function)->func);
+   }
+}
+
 void
 vtn_build_cfg(struct vtn_builder *b, const uint32_t *words, const uint32_t *end)
 {
    vtn_foreach_instruction(b, words, end,
                            vtn_cfg_handle_prepass_instruction);
 
+   /* Modules often contain many entry points or whole libraries of which we
+    * only need a small part.  Only functions reachable from the entry point
+    * are ever emitted, so don't bother building a CFG for the rest.
+    * Recursion isn't allowed in SPIR-V so the call graph is a DAG.
+    */
+   vtn_fail_if(b->entry_point->value_type != vtn_value_type_function,
+               "Entry point is not a function");
+   vtn_mark_function_referenced(b, b->entry_point->func);
+
    vtn_foreach_cf_node(func_node, &b->functions) {
       struct vtn_function *func = vtn_cf_node_as_function(func_node);
 
+      if (!func->referenced)
+         continue;
+
       /* We build the CFG for each function by doing a breadth-first search on
        * the control-flow graph.  We keep track of our state using a worklist.
        * Doing a BFS ensures that we visit each structured control-flow
@@ -260,6 +260,9 @@ struct vtn_function {
 
    const uint32_t *end;
 
+   /* SPIR-V IDs of the functions called from this one */
+   struct util_dynarray callees;
+
    SpvFunctionControlMask control;
 };
 
@@ -0,0 +1,481 @@
+/*
+ * Copyright © 2020 Google LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * OpenGL ES 3.0 workloads, rendering to a small FBO on a surfaceless EGL
+ * display.  Each workload ends with glFinish(), so the flushes the driver
+ * does are part of its cost.
+ */
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EGL_EGL_PROTOTYPES 0
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define GL_GLES_PROTOTYPES 0
+#include <GLES3/gl3.h>
+
+#include "util/macros.h"
+
+#include "drm_shim_bench.h"
+
+#define EGL_FUNCS(X) \
+   X(PFNEGLGETPROCADDRESSPROC, eglGetProcAddress) \
+   X(PFNEGLQUERYSTRINGPROC, eglQueryString) \
+   X(PFNEGLGETDISPLAYPROC, eglGetDisplay) \
+   X(PFNEGLINITIALIZEPROC, eglInitialize) \
+   X(PFNEGLTERMINATEPROC, eglTerminate) \
+   X(PFNEGLBINDAPIPROC, eglBindAPI) \
+   X(PFNEGLCHOOSECONFIGPROC, eglChooseConfig) \
+   X(PFNEGLCREATECONTEXTPROC, eglCreateContext) \
+   X(PFNEGLDESTROYCONTEXTPROC, eglDestroyContext) \
+   X(PFNEGLMAKECURRENTPROC, eglMakeCurrent)
+
+#define GL_FUNCS(X) \
+   X(PFNGLACTIVETEXTUREPROC, glActiveTexture) \
+   X(PFNGLATTACHSHADERPROC, glAttachShader) \
+   X(PFNGLBINDBUFFERPROC, glBindBuffer) \
+   X(PFNGLBINDBUFFERRANGEPROC, glBindBufferRange) \
+   X(PFNGLBINDFRAMEBUFFERPROC, glBindFramebuffer) \
+   X(PFNGLBINDTEXTUREPROC, glBindTexture) \
+   X(PFNGLBINDVERTEXARRAYPROC, glBindVertexArray) \
+   X(PFNGLBLENDFUNCPROC, glBlendFunc) \
+   X(PFNGLBUFFERDATAPROC, glBufferData) \
+   X(PFNGLBUFFERSUBDATAPROC, glBufferSubData) \
+   X(PFNGLCHECKFRAMEBUFFERSTATUSPROC, glCheckFramebufferStatus) \
+   X(PFNGLCOMPILESHADERPROC, glCompileShader) \
+   X(PFNGLCREATEPROGRAMPROC, glCreateProgram) \
+   X(PFNGLCREATESHADERPROC, glCreateShader) \
+   X(PFNGLDELETEBUFFERSPROC, glDeleteBuffers) \
+   X(PFNGLDELETEFRAMEBUFFERSPROC, glDeleteFramebuffers) \
+   X(PFNGLDELETEPROGRAMPROC, glDeleteProgram) \
+   X(PFNGLDELETESHADERPROC, glDeleteShader) \
+   X(PFNGLDELETETEXTURESPROC, glDeleteTextures) \
+   X(PFNGLDELETEVERTEXARRAYSPROC, glDeleteVertexArrays) \
+   X(PFNGLDEPTHFUNCPROC, glDepthFunc) \
+   X(PFNGLDISABLEPROC, glDisable) \
+   X(PFNGLDRAWARRAYSPROC, glDrawArrays) \
+   X(PFNGLENABLEPROC, glEnable) \
+   X(PFNGLENABLEVERTEXATTRIBARRAYPROC, glEnableVertexAttribArray) \
+   X(PFNGLFINISHPROC, glFinish) \
+   X(PFNGLFRAMEBUFFERTEXTURE2DPROC, glFramebufferTexture2D) \
+   X(PFNGLGENBUFFERSPROC, glGenBuffers) \
+   X(PFNGLGENFRAMEBUFFERSPROC, glGenFramebuffers) \
+   X(PFNGLGENTEXTURESPROC, glGenTextures) \
+   X(PFNGLGENVERTEXARRAYSPROC, glGenVertexArrays) \
+   X(PFNGLGETPROGRAMIVPROC, glGetProgramiv) \
+   X(PFNGLGETSTRINGPROC, glGetString) \
+   X(PFNGLGETUNIFORMBLOCKINDEXPROC, glGetUniformBlockIndex) \
+   X(PFNGLGETUNIFORMLOCATIONPROC, glGetUniformLocation) \
+   X(PFNGLLINKPROGRAMPROC, glLinkProgram) \
+   X(PFNGLSHADERSOURCEPROC, glShaderSource) \
+   X(PFNGLTEXIMAGE2DPROC, glTexImage2D) \
+   X(PFNGLTEXPARAMETERIPROC, glTexParameteri) \
+   X(PFNGLUNIFORM1IPROC, glUniform1i) \
+   X(PFNGLUNIFORM4FPROC, glUniform4f) \
+   X(PFNGLUNIFORMBLOCKBINDINGPROC, glUniformBlockBinding) \
+   X(PFNGLUSEPROGRAMPROC, glUseProgram) \
+   X(PFNGLVERTEXATTRIBPOINTERPROC, glVertexAttribPointer) \
+   X(PFNGLVIEWPORTPROC, glViewport)
+
+#define DECLARE_FUNC(type, name) static type name;
+EGL_FUNCS(DECLARE_FUNC)
+GL_FUNCS(DECLARE_FUNC)
+#undef DECLARE_FUNC
+
+#define FB_SIZE 64
+#define NUM_TEXTURES 4
+#define UBO_STRIDE 256
+
+static const char vs_source[] =
+   "#version 300 es\n"
+   "layout(location = 0) in vec4 pos;\n"
+   "void main() { gl_Position = pos; }\n";
+
+static const char fs_color_source[] =
+   "#version 300 es\n"
+   "precision mediump float;\n"
+   "uniform vec4 color;\n"
+   "out vec4 frag;\n"
+   "void main() { frag = color; }\n";
+
+static const char fs_texture_source[] =
+   "#version 300 es\n"
+   "precision mediump float;\n"
+   "uniform sampler2D tex;\n"
+   "out vec4 frag;\n"
+   "void main() { frag = texture(tex, gl_FragCoord.xy / 64.0); }\n";
+
+static const char fs_ubo_source[] =
+   "#version 300 es\n"
+   "precision mediump float;\n"
+   "layout(std140) uniform block { vec4 color; };\n"
+   "out vec4 frag;\n"
+   "void main() { frag = color; }\n";
+
+/* A new shader for each program, so that no cache can hit. */
+static const char fs_unique_source[] =
+   "#version 300 es\n"
+   "precision mediump float;\n"
+   "out vec4 frag;\n"
+   "void main() { frag = vec4(%u.0, 0.25, 0.5, 1.0) * gl_FragCoord.x; }\n";
+
+struct gl_bench {
+   GLuint fbo, fb_tex;
+   GLuint vao, vbo, ubo;
+   GLuint textures[NUM_TEXTURES];
+   GLuint prog_color, prog_texture, prog_ubo;
+   GLint color_loc;
+};
+
+static bool
+load_egl(const char *egl_path)
+{
+   void *egl = dlopen(egl_path, RTLD_NOW | RTLD_GLOBAL);
+
+   if (!egl) {
+      fprintf(stderr, "failed to open %s: %s\n", egl_path, dlerror());
+      return false;
+   }
+
+#define LOAD_EGL(type, name) \
+   if (!(name = (type)dlsym(egl, #name))) { \
+      fprintf(stderr, "%s missing from %s\n", #name, egl_path); \
+      return false; \
+   }
+   EGL_FUNCS(LOAD_EGL)
+#undef LOAD_EGL
+
+   return true;
+}
+
+static bool
+load_gl(void)
+{
+#define LOAD_GL(type, name) \
+   if (!(name = (type)eglGetProcAddress(#name))) { \
+      fprintf(stderr, "%s not found\n", #name); \
+      return false; \
+   }
+   GL_FUNCS(LOAD_GL)
+#undef LOAD_GL
+
+   return true;
+}
+
+static EGLDisplay
+get_display(void)
+{
+   const char *exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+   PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+      eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+   if (!exts || !strstr(exts, "EGL_MESA_platform_surfaceless") ||
+       !get_platform_display) {
+      fprintf(stderr, "EGL_MESA_platform_surfaceless is needed\n");
+      return EGL_NO_DISPLAY;
+   }
+
+   return get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                               EGL_DEFAULT_DISPLAY, NULL);
+}
+
+static GLuint
+create_program(const char *fs_source)
+{
+   GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+   GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+   GLuint prog = glCreateProgram();
+   const char *vs_src = vs_source;
+   GLint linked;
+
+   glShaderSource(vs, 1, &vs_src, NULL);
+   glShaderSource(fs, 1, &fs_source, NULL);
+   glCompileShader(vs);
+   glCompileShader(fs);
+   glAttachShader(prog, vs);
+   glAttachShader(prog, fs);
+   glLinkProgram(prog);
+   glDeleteShader(vs);
+   glDeleteShader(fs);
+
+   glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+   if (!linked) {
+      fprintf(stderr, "failed to link:\n%s", fs_source);
+      glDeleteProgram(prog);
+      return 0;
+   }
+   return prog;
+}
+
+static bool
+setup(struct gl_bench *b)
+{
+   static const float verts[] = {
+      -1.0f, -1.0f, 0.0f, 1.0f,
+       3.0f, -1.0f, 0.0f, 1.0f,
+      -1.0f,  3.0f, 0.0f, 1.0f,
+   };
+   uint8_t ubo_data[UBO_STRIDE * 4] = { 0 };
+   uint32_t texel = 0xff8040ff;
+
+   glGenTextures(1, &b->fb_tex);
+   glBindTexture(GL_TEXTURE_2D, b->fb_tex);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, FB_SIZE, FB_SIZE, 0, GL_RGBA,
+                GL_UNSIGNED_BYTE, NULL);
+   glGenFramebuffers(1, &b->fbo);
+   glBindFramebuffer(GL_FRAMEBUFFER, b->fbo);
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                          GL_TEXTURE_2D, b->fb_tex, 0);
+   if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      fprintf(stderr, "incomplete framebuffer\n");
+      return false;
+   }
+   glViewport(0, 0, FB_SIZE, FB_SIZE);
+
+   glGenTextures(NUM_TEXTURES, b->textures);
+   for (unsigned i = 0; i < NUM_TEXTURES; i++) {
+      glBindTexture(GL_TEXTURE_2D, b->textures[i]);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,
+                   GL_UNSIGNED_BYTE, &texel);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   }
+
+   glGenVertexArrays(1, &b->vao);
+   glBindVertexArray(b->vao);
+   glGenBuffers(1, &b->vbo);
+   glBindBuffer(GL_ARRAY_BUFFER, b->vbo);
+   glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+   glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL);
+   glEnableVertexAttribArray(0);
+
+   glGenBuffers(1, &b->ubo);
+   glBindBuffer(GL_UNIFORM_BUFFER, b->ubo);
+   glBufferData(GL_UNIFORM_BUFFER, sizeof(ubo_data), ubo_data,
+                GL_DYNAMIC_DRAW);
+
+   b->prog_color = create_program(fs_color_source);
+   b->prog_texture = create_program(fs_texture_source);
+   b->prog_ubo = create_program(fs_ubo_source);
+   if (!b->prog_color || !b->prog_texture || !b->prog_ubo)
+      return false;
+
+   b->color_loc = glGetUniformLocation(b->prog_color, "color");
+   glUseProgram(b->prog_texture);
+   glUniform1i(glGetUniformLocation(b->prog_texture, "tex"), 0);
+   glUniformBlockBinding(b->prog_ubo,
+                         glGetUniformBlockIndex(b->prog_ubo, "block"), 0);
+
+   /* Compile the variants for the state used below up front. */
+   glUseProgram(b->prog_color);
+   glDrawArrays(GL_TRIANGLES, 0, 3);
+   glFinish();
+
+   return true;
+}
+
+static void
+teardown(struct gl_bench *b)
+{
+   glUseProgram(0);
+   glDeleteProgram(b->prog_color);
+   glDeleteProgram(b->prog_texture);
+   glDeleteProgram(b->prog_ubo);
+   glDeleteBuffers(1, &b->ubo);
+   glDeleteBuffers(1, &b->vbo);
+   glDeleteVertexArrays(1, &b->vao);
+   glDeleteTextures(NUM_TEXTURES, b->textures);
+   glDeleteFramebuffers(1, &b->fbo);
+   glDeleteTextures(1, &b->fb_tex);
+}
+
+/* Draws with only a uniform changing in between. */
+static void
+draw_storm(struct gl_bench *b, unsigned count)
+{
+   glUseProgram(b->prog_color);
+   for (unsigned i = 0; i < count; i++) {
+      glUniform4f(b->color_loc, (i & 255) / 255.0f, 0.0f, 0.0f, 1.0f);
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+   }
+}
+
+/* Draws with the program, blending, depth test, viewport and texture
+ * changing in between.
+ */
+static void
+state_churn(struct gl_bench *b, unsigned count)
+{
+   glActiveTexture(GL_TEXTURE0);
+   for (unsigned i = 0; i < count; i++) {
+      glUseProgram(i & 1 ? b->prog_texture : b->prog_color);
+      if (i & 2) {
+         glEnable(GL_BLEND);
+         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      } else {
+         glDisable(GL_BLEND);
+      }
+      if (i & 4) {
+         glEnable(GL_DEPTH_TEST);
+         glDepthFunc(i & 8 ? GL_LESS : GL_GEQUAL);
+      } else {
+         glDisable(GL_DEPTH_TEST);
+      }
+      glViewport(0, 0, FB_SIZE - (i & 3), FB_SIZE);
+      glBindTexture(GL_TEXTURE_2D, b->textures[i % NUM_TEXTURES]);
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+   }
+   glDisable(GL_BLEND);
+   glDisable(GL_DEPTH_TEST);
+   glViewport(0, 0, FB_SIZE, FB_SIZE);
+}
+
+/* Draws with a uniform buffer update and rebinding in between, the GL
+ * counterpart of updating descriptors.
+ */
+static void
+uniform_buffer_updates(struct gl_bench *b, unsigned count)
+{
+   glUseProgram(b->prog_ubo);
+   glBindBuffer(GL_UNIFORM_BUFFER, b->ubo);
+   for (unsigned i = 0; i < count; i++) {
+      float color[4] = { (i & 255) / 255.0f, 0.0f, 0.0f, 1.0f };
+      GLintptr offset = (i % 4) * UBO_STRIDE;
+
+      glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(color), color);
+      glBindBufferRange(GL_UNIFORM_BUFFER, 0, b->ubo, offset, sizeof(color));
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+   }
+}
+
+/* Compile, link and draw with new programs, drivers compile the variant
+ * on the first draw.
+ */
+static void
+program_creation(struct gl_bench *b, unsigned count)
+{
+   static unsigned serial;
+
+   for (unsigned i = 0; i < count; i++) {
+      char source[sizeof(fs_unique_source) + 32];
+      GLuint prog;
+
+      snprintf(source, sizeof(source), fs_unique_source, serial++);
+      prog = create_program(source);
+      glUseProgram(prog);
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+      glUseProgram(0);
+      glDeleteProgram(prog);
+   }
+}
+
+static const struct {
+   const char *name;
+   void (*run)(struct gl_bench *b, unsigned count);
+   unsigned calls_per_iteration;
+} workloads[] = {
+   { "draw_storm",             draw_storm,             100 },
+   { "state_churn",            state_churn,            100 },
+   { "uniform_buffer_updates", uniform_buffer_updates, 100 },
+   { "program_creation",       program_creation,       1 },
+};
+
+bool
+bench_gl_run(const char *egl_path, const struct bench_options *opts)
+{
+   static const EGLint config_attribs[] = {
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+      EGL_SURFACE_TYPE, 0,
+      EGL_NONE
+   };
+   static const EGLint context_attribs[] = {
+      EGL_CONTEXT_CLIENT_VERSION, 3,
+      EGL_NONE
+   };
+   struct gl_bench b = { 0 };
+   EGLDisplay dpy;
+   EGLConfig config;
+   EGLContext ctx;
+   EGLint num_configs;
+   bool ok = false;
+
+   /* Measure the compiler, not the shader cache. */
+   setenv("MESA_GLSL_CACHE_DISABLE", "true", 0);
+
+   if (!load_egl(egl_path))
+      return false;
+
+   dpy = get_display();
+   if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, NULL, NULL)) {
+      fprintf(stderr, "eglInitialize failed\n");
+      return false;
+   }
+
+   if (!eglBindAPI(EGL_OPENGL_ES_API) ||
+       !eglChooseConfig(dpy, config_attribs, &config, 1, &num_configs) ||
+       num_configs == 0) {
+      fprintf(stderr, "no ES3 config\n");
+      goto out_terminate;
+   }
+
+   ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, context_attribs);
+   if (ctx == EGL_NO_CONTEXT ||
+       !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+      fprintf(stderr, "failed to create an ES3 context\n");
+      goto out_context;
+   }
+
+   if (!load_gl() || !setup(&b))
+      goto out_context;
+
+   fprintf(stderr, "GL_RENDERER: %s\n", glGetString(GL_RENDERER));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(workloads); i++) {
+      unsigned count = opts->iterations * workloads[i].calls_per_iteration;
+      int64_t start;
+
+      if (!bench_selected(opts, workloads[i].name))
+         continue;
+
+      start = bench_cpu_time_ns();
+      workloads[i].run(&b, count);
+      glFinish();
+      bench_report("gl", workloads[i].name, count,
+                   bench_cpu_time_ns() - start);
+   }
+   ok = true;
+
+   teardown(&b);
+out_context:
+   eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+   if (ctx != EGL_NO_CONTEXT)
+      eglDestroyContext(dpy, ctx);
+out_terminate:
+   eglTerminate(dpy);
+   return ok;
+}
@@ -0,0 +1,605 @@
+/*
+ * Copyright © 2020 Google LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Vulkan workloads.  The ICD is loaded directly, without the Vulkan loader,
+ * so that the driver under test is the one given and no layers get in the
+ * way.  Only compute is used, which needs no window system or render pass.
+ */
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+
+#include "util/macros.h"
+
+#include "drm_shim_bench.h"
+
+#define NUM_SETS 16
+#define BUFFER_SIZE 4096
+#define UBO_RANGE 256
+
+#define INSTANCE_FUNCS(X) \
+   X(vkDestroyInstance) \
+   X(vkEnumeratePhysicalDevices) \
+   X(vkGetPhysicalDeviceProperties) \
+   X(vkGetPhysicalDeviceQueueFamilyProperties) \
+   X(vkGetPhysicalDeviceMemoryProperties) \
+   X(vkCreateDevice) \
+   X(vkGetDeviceProcAddr)
+
+#define DEVICE_FUNCS(X) \
+   X(vkDestroyDevice) \
+   X(vkGetDeviceQueue) \
+   X(vkDeviceWaitIdle) \
+   X(vkCreateBuffer) \
+   X(vkDestroyBuffer) \
+   X(vkGetBufferMemoryRequirements) \
+   X(vkAllocateMemory) \
+   X(vkFreeMemory) \
+   X(vkBindBufferMemory) \
+   X(vkCreateDescriptorSetLayout) \
+   X(vkDestroyDescriptorSetLayout) \
+   X(vkCreateDescriptorPool) \
+   X(vkDestroyDescriptorPool) \
+   X(vkResetDescriptorPool) \
+   X(vkAllocateDescriptorSets) \
+   X(vkUpdateDescriptorSets) \
+   X(vkCreatePipelineLayout) \
+   X(vkDestroyPipelineLayout) \
+   X(vkCreateShaderModule) \
+   X(vkDestroyShaderModule) \
+   X(vkCreateComputePipelines) \
+   X(vkDestroyPipeline) \
+   X(vkCreateCommandPool) \
+   X(vkDestroyCommandPool) \
+   X(vkResetCommandPool) \
+   X(vkAllocateCommandBuffers) \
+   X(vkBeginCommandBuffer) \
+   X(vkEndCommandBuffer) \
+   X(vkCmdBindPipeline) \
+   X(vkCmdBindDescriptorSets) \
+   X(vkCmdPushConstants) \
+   X(vkCmdDispatch) \
+   X(vkCreateFence) \
+   X(vkDestroyFence) \
+   X(vkResetFences) \
+   X(vkWaitForFences) \
+   X(vkQueueSubmit)
+
+#define DECLARE_FUNC(name) static PFN_##name name;
+INSTANCE_FUNCS(DECLARE_FUNC)
+DEVICE_FUNCS(DECLARE_FUNC)
+#undef DECLARE_FUNC
+
+/* An empty compute shader with a specialization constant (SpecId 0), which
+ * makes each pipeline different for the drivers' pipeline caches:
+ *
+ *    #version 450
+ *    layout(local_size_x = 1) in;
+ *    layout(constant_id = 0) const uint c = 0;
+ *    void main() {}
+ */
+static const uint32_t empty_cs_spirv[] = {
+   0x07230203, 0x00010000, 0x00000000, 0x00000007, 0x00000000, 0x00020011,
+   0x00000001, 0x0003000e, 0x00000000, 0x00000001, 0x0005000f, 0x00000005,
+   0x00000001, 0x6e69616d, 0x00000000, 0x00060010, 0x00000001, 0x00000011,
+   0x00000001, 0x00000001, 0x00000001, 0x00040047, 0x00000005, 0x00000001,
+   0x00000000, 0x00020013, 0x00000002, 0x00030021, 0x00000003, 0x00000002,
+   0x00040015, 0x00000004, 0x00000020, 0x00000000, 0x00040032, 0x00000004,
+   0x00000005, 0x00000000, 0x00050036, 0x00000002, 0x00000001, 0x00000000,
+   0x00000003, 0x000200f8, 0x00000006, 0x000100fd, 0x00010038,
+};
+
+struct vk_bench {
+   VkInstance instance;
+   VkPhysicalDevice physical_device;
+   VkDevice device;
+   VkQueue queue;
+   uint32_t queue_family;
+
+   VkBuffer buffer;
+   VkDeviceMemory memory;
+   VkDescriptorSetLayout set_layout;
+   VkDescriptorPool pool;
+   VkDescriptorSet sets[NUM_SETS];
+   VkPipelineLayout pipeline_layout;
+   VkShaderModule shader;
+   VkPipeline pipeline;
+   VkCommandPool cmd_pool;
+   VkCommandBuffer cmd;
+   VkFence fence;
+
+   uint32_t pipeline_serial;
+};
+
+static VkResult
+create_pipeline(struct vk_bench *b, uint32_t spec_value, VkPipeline *pipeline)
+{
+   const VkSpecializationMapEntry entry = {
+      .constantID = 0,
+      .offset = 0,
+      .size = sizeof(uint32_t),
+   };
+   const VkSpecializationInfo spec = {
+      .mapEntryCount = 1,
+      .pMapEntries = &entry,
+      .dataSize = sizeof(spec_value),
+      .pData = &spec_value,
+   };
+   const VkComputePipelineCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .stage = {
+         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+         .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+         .module = b->shader,
+         .pName = "main",
+         .pSpecializationInfo = &spec,
+      },
+      .layout = b->pipeline_layout,
+   };
+
+   return vkCreateComputePipelines(b->device, VK_NULL_HANDLE, 1, &info, NULL,
+                                   pipeline);
+}
+
+static bool
+create_device(struct vk_bench *b, PFN_vkGetInstanceProcAddr get_proc_addr)
+{
+   PFN_vkCreateInstance create_instance = (PFN_vkCreateInstance)
+      get_proc_addr(VK_NULL_HANDLE, "vkCreateInstance");
+   const VkApplicationInfo app = {
+      .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+      .pApplicationName = "drm_shim_bench",
+      .apiVersion = VK_API_VERSION_1_0,
+   };
+   const VkInstanceCreateInfo instance_info = {
+      .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+      .pApplicationInfo = &app,
+   };
+   VkQueueFamilyProperties families[8];
+   VkPhysicalDeviceProperties props;
+   uint32_t count = 1;
+   VkResult result;
+
+   if (!create_instance ||
+       create_instance(&instance_info, NULL, &b->instance) != VK_SUCCESS) {
+      fprintf(stderr, "vkCreateInstance failed\n");
+      return false;
+   }
+
+#define LOAD_INSTANCE(name) \
+   if (!(name = (PFN_##name)get_proc_addr(b->instance, #name))) { \
+      fprintf(stderr, "%s not found\n", #name); \
+      return false; \
+   }
+   INSTANCE_FUNCS(LOAD_INSTANCE)
+#undef LOAD_INSTANCE
+
+   result = vkEnumeratePhysicalDevices(b->instance, &count,
+                                       &b->physical_device);
+   if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || count == 0) {
+      fprintf(stderr, "no Vulkan device\n");
+      return false;
+   }
+   vkGetPhysicalDeviceProperties(b->physical_device, &props);
+   fprintf(stderr, "Vulkan device: %s\n", props.deviceName);
+
+   count = ARRAY_SIZE(families);
+   vkGetPhysicalDeviceQueueFamilyProperties(b->physical_device, &count,
+                                            families);
+   for (b->queue_family = 0; b->queue_family < count; b->queue_family++) {
+      if (families[b->queue_family].queueFlags & VK_QUEUE_COMPUTE_BIT)
+         break;
+   }
+   if (b->queue_family == count) {
+      fprintf(stderr, "no compute queue\n");
+      return false;
+   }
+
+   const float priority = 1.0f;
+   const VkDeviceQueueCreateInfo queue_info = {
+      .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+      .queueFamilyIndex = b->queue_family,
+      .queueCount = 1,
+      .pQueuePriorities = &priority,
+   };
+   const VkDeviceCreateInfo device_info = {
+      .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+      .queueCreateInfoCount = 1,
+      .pQueueCreateInfos = &queue_info,
+   };
+   if (vkCreateDevice(b->physical_device, &device_info, NULL,
+                      &b->device) != VK_SUCCESS) {
+      fprintf(stderr, "vkCreateDevice failed\n");
+      return false;
+   }
+
+#define LOAD_DEVICE(name) \
+   if (!(name = (PFN_##name)vkGetDeviceProcAddr(b->device, #name))) { \
+      fprintf(stderr, "%s not found\n", #name); \
+      return false; \
+   }
+   DEVICE_FUNCS(LOAD_DEVICE)
+#undef LOAD_DEVICE
+
+   vkGetDeviceQueue(b->device, b->queue_family, 0, &b->queue);
+   return true;
+}
+
+static bool
+create_buffer(struct vk_bench *b)
+{
+   const VkBufferCreateInfo buffer_info = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .size = BUFFER_SIZE,
+      .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+   };
+   VkPhysicalDeviceMemoryProperties mem_props;
+   VkMemoryRequirements reqs;
+   uint32_t type;
+
+   if (vkCreateBuffer(b->device, &buffer_info, NULL, &b->buffer) != VK_SUCCESS)
+      return false;
+
+   vkGetBufferMemoryRequirements(b->device, b->buffer, &reqs);
+   vkGetPhysicalDeviceMemoryProperties(b->physical_device, &mem_props);
+   for (type = 0; type < mem_props.memoryTypeCount; type++) {
+      if (reqs.memoryTypeBits & (1u << type))
+         break;
+   }
+
+   const VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = reqs.size,
+      .memoryTypeIndex = type,
+   };
+   if (type == mem_props.memoryTypeCount ||
+       vkAllocateMemory(b->device, &alloc_info, NULL,
+                        &b->memory) != VK_SUCCESS)
+      return false;
+
+   return vkBindBufferMemory(b->device, b->buffer, b->memory, 0) ==
+          VK_SUCCESS;
+}
+
+static void
+write_set(struct vk_bench *b, VkDescriptorSet set, unsigned i)
+{
+   const VkDescriptorBufferInfo ssbo = {
+      .buffer = b->buffer,
+      .offset = 0,
+      .range = VK_WHOLE_SIZE,
+   };
+   const VkDescriptorBufferInfo ubo = {
+      .buffer = b->buffer,
+      .offset = (i % (BUFFER_SIZE / UBO_RANGE)) * UBO_RANGE,
+      .range = UBO_RANGE,
+   };
+   const VkWriteDescriptorSet writes[] = {
+      {
+         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+         .dstSet = set,
+         .dstBinding = 0,
+         .descriptorCount = 1,
+         .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+         .pBufferInfo = &ssbo,
+      },
+      {
+         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+         .dstSet = set,
+         .dstBinding = 1,
+         .descriptorCount = 1,
+         .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+         .pBufferInfo = &ubo,
+      },
+   };
+
+   vkUpdateDescriptorSets(b->device, ARRAY_SIZE(writes), writes, 0, NULL);
+}
+
+static bool
+setup(struct vk_bench *b)
+{
+   const VkDescriptorSetLayoutBinding bindings[] = {
+      {
+         .binding = 0,
+         .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+         .descriptorCount = 1,
+         .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      },
+      {
+         .binding = 1,
+         .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+         .descriptorCount = 1,
+         .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      },
+   };
+   const VkDescriptorSetLayoutCreateInfo set_layout_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = ARRAY_SIZE(bindings),
+      .pBindings = bindings,
+   };
+   const VkDescriptorPoolSize pool_sizes[] = {
+      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NUM_SETS },
+      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NUM_SETS },
+   };
+   const VkDescriptorPoolCreateInfo pool_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .maxSets = NUM_SETS,
+      .poolSizeCount = ARRAY_SIZE(pool_sizes),
+      .pPoolSizes = pool_sizes,
+   };
+   const VkPushConstantRange push_range = {
+      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      .size = 16,
+   };
+   const VkPipelineLayoutCreateInfo pipeline_layout_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = 1,
+      .pSetLayouts = &b->set_layout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &push_range,
+   };
+   const VkShaderModuleCreateInfo shader_info = {
+      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+      .codeSize = sizeof(empty_cs_spirv),
+      .pCode = empty_cs_spirv,
+   };
+   const VkCommandPoolCreateInfo cmd_pool_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      .queueFamilyIndex = b->queue_family,
+   };
+   const VkFenceCreateInfo fence_info = {
+      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+   };
+   VkDescriptorSetLayout set_layouts[NUM_SETS];
+
+   if (!create_buffer(b) ||
+       vkCreateDescriptorSetLayout(b->device, &set_layout_info, NULL,
+                                   &b->set_layout) != VK_SUCCESS ||
+       vkCreateDescriptorPool(b->device, &pool_info, NULL,
+                              &b->pool) != VK_SUCCESS ||
+       vkCreatePipelineLayout(b->device, &pipeline_layout_info, NULL,
+                              &b->pipeline_layout) != VK_SUCCESS ||
+       vkCreateShaderModule(b->device, &shader_info, NULL,
+                            &b->shader) != VK_SUCCESS ||
+       create_pipeline(b, b->pipeline_serial++, &b->pipeline) != VK_SUCCESS ||
+       vkCreateCommandPool(b->device, &cmd_pool_info, NULL,
+                           &b->cmd_pool) != VK_SUCCESS ||
+       vkCreateFence(b->device, &fence_info, NULL, &b->fence) != VK_SUCCESS) {
+      fprintf(stderr, "failed to create the Vulkan objects\n");
+      return false;
+   }
+
+   for (unsigned i = 0; i < NUM_SETS; i++)
+      set_layouts[i] = b->set_layout;
+
+   const VkDescriptorSetAllocateInfo set_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = b->pool,
+      .descriptorSetCount = NUM_SETS,
+      .pSetLayouts = set_layouts,
+   };
+   const VkCommandBufferAllocateInfo cmd_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool = b->cmd_pool,
+      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = 1,
+   };
+   if (vkAllocateDescriptorSets(b->device, &set_info, b->sets) != VK_SUCCESS ||
+       vkAllocateCommandBuffers(b->device, &cmd_info, &b->cmd) != VK_SUCCESS) {
+      fprintf(stderr, "failed to allocate descriptor sets or commands\n");
+      return false;
+   }
+
+   for (unsigned i = 0; i < NUM_SETS; i++)
+      write_set(b, b->sets[i], i);
+
+   return true;
+}
+
+static void
+teardown(struct vk_bench *b)
+{
+   /* The last device entrypoint is only set once all of them are. */
+   if (b->device && vkQueueSubmit) {
+      vkDeviceWaitIdle(b->device);
+      vkDestroyFence(b->device, b->fence, NULL);
+      vkDestroyCommandPool(b->device, b->cmd_pool, NULL);
+      vkDestroyPipeline(b->device, b->pipeline, NULL);
+      vkDestroyShaderModule(b->device, b->shader, NULL);
+      vkDestroyPipelineLayout(b->device, b->pipeline_layout, NULL);
+      vkDestroyDescriptorPool(b->device, b->pool, NULL);
+      vkDestroyDescriptorSetLayout(b->device, b->set_layout, NULL);
+      vkDestroyBuffer(b->device, b->buffer, NULL);
+      vkFreeMemory(b->device, b->memory, NULL);
+      vkDestroyDevice(b->device, NULL);
+   }
+   if (b->instance && vkDestroyInstance)
+      vkDestroyInstance(b->instance, NULL);
+}
+
+/* vkUpdateDescriptorSets with a storage and a uniform buffer. */
+static bool
+descriptor_updates(struct vk_bench *b, unsigned count)
+{
+   for (unsigned i = 0; i < count; i++)
+      write_set(b, b->sets[i % NUM_SETS], i);
+   return true;
+}
+
+/* Allocating all the sets of the pool, then resetting it. */
+static bool
+descriptor_set_allocation(struct vk_bench *b, unsigned count)
+{
+   VkDescriptorSetAllocateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = b->pool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &b->set_layout,
+   };
+   bool ok = true;
+
+   vkResetDescriptorPool(b->device, b->pool, 0);
+   for (unsigned i = 0; i < count && ok; i++) {
+      if (i % NUM_SETS == 0 && i)
+         vkResetDescriptorPool(b->device, b->pool, 0);
+      ok = vkAllocateDescriptorSets(b->device, &info,
+                                    &b->sets[i % NUM_SETS]) == VK_SUCCESS;
+   }
+
+   /* Leave a full pool of written sets for the other workloads. */
+   vkResetDescriptorPool(b->device, b->pool, 0);
+   for (unsigned i = 0; i < NUM_SETS && ok; i++) {
+      ok = vkAllocateDescriptorSets(b->device, &info,
+                                    &b->sets[i]) == VK_SUCCESS;
+      if (ok)
+         write_set(b, b->sets[i], i);
+   }
+   return ok;
+}
+
+/* Creating and destroying compute pipelines, each one different. */
+static bool
+compute_pipeline_creation(struct vk_bench *b, unsigned count)
+{
+   for (unsigned i = 0; i < count; i++) {
+      VkPipeline pipeline;
+
+      if (create_pipeline(b, b->pipeline_serial++, &pipeline) != VK_SUCCESS)
+         return false;
+      vkDestroyPipeline(b->device, pipeline, NULL);
+   }
+   return true;
+}
+
+/* Recording dispatches with the descriptor set and push constants changing
+ * in between, then submitting them.
+ */
+static bool
+dispatch_storm(struct vk_bench *b, unsigned count)
+{
+   const VkCommandBufferBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+   };
+   const VkSubmitInfo submit_info = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &b->cmd,
+   };
+
+   vkResetCommandPool(b->device, b->cmd_pool, 0);
+   vkBeginCommandBuffer(b->cmd, &begin_info);
+   vkCmdBindPipeline(b->cmd, VK_PIPELINE_BIND_POINT_COMPUTE, b->pipeline);
+   for (unsigned i = 0; i < count; i++) {
+      uint32_t push[4] = { i, 0, 0, 0 };
+
+      vkCmdBindDescriptorSets(b->cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                              b->pipeline_layout, 0, 1,
+                              &b->sets[i % NUM_SETS], 0, NULL);
+      vkCmdPushConstants(b->cmd, b->pipeline_layout,
+                         VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), push);
+      vkCmdDispatch(b->cmd, 1, 1, 1);
+   }
+   if (vkEndCommandBuffer(b->cmd) != VK_SUCCESS)
+      return false;
+
+   vkResetFences(b->device, 1, &b->fence);
+   return vkQueueSubmit(b->queue, 1, &submit_info, b->fence) == VK_SUCCESS &&
+          vkWaitForFences(b->device, 1, &b->fence, VK_TRUE,
+                          UINT64_MAX) == VK_SUCCESS;
+}
+
+static const struct {
+   const char *name;
+   bool (*run)(struct vk_bench *b, unsigned count);
+   unsigned calls_per_iteration;
+} workloads[] = {
+   { "descriptor_updates",        descriptor_updates,        100 },
+   { "descriptor_set_allocation", descriptor_set_allocation, 100 },
+   { "compute_pipeline_creation", compute_pipeline_creation, 1 },
+   { "dispatch_storm",            dispatch_storm,            100 },
+};
+
+bool
+bench_vk_run(const char *icd_path, const struct bench_options *opts)
+{
+   PFN_vkGetInstanceProcAddr get_proc_addr;
+   VkResult (*negotiate)(uint32_t *version);
+   struct vk_bench b = { 0 };
+   void *icd;
+   bool ok = false;
+
+   icd = dlopen(icd_path, RTLD_NOW | RTLD_LOCAL);
+   if (!icd) {
+      fprintf(stderr, "failed to open %s: %s\n", icd_path, dlerror());
+      return false;
+   }
+
+   /* Talk to the ICD like the loader does. */
+   negotiate = dlsym(icd, "vk_icdNegotiateLoaderICDInterfaceVersion");
+   if (negotiate) {
+      uint32_t version = 4;
+      negotiate(&version);
+   }
+   get_proc_addr = (PFN_vkGetInstanceProcAddr)
+      dlsym(icd, "vk_icdGetInstanceProcAddr");
+   if (!get_proc_addr) {
+      fprintf(stderr, "%s is not a Vulkan ICD\n", icd_path);
+      goto out;
+   }
+
+   if (!create_device(&b, get_proc_addr) || !setup(&b))
+      goto out;
+
+   ok = true;
+   for (unsigned i = 0; i < ARRAY_SIZE(workloads) && ok; i++) {
+      unsigned count = opts->iterations * workloads[i].calls_per_iteration;
+      int64_t start;
+
+      if (!bench_selected(opts, workloads[i].name))
+         continue;
+
+      start = bench_cpu_time_ns();
+      ok = workloads[i].run(&b, count);
+      if (ok) {
+         bench_report("vk", workloads[i].name, count,
+                      bench_cpu_time_ns() - start);
+      } else {
+         fprintf(stderr, "%s failed\n", workloads[i].name);
+      }
+   }
+
+out:
+   teardown(&b);
+   dlclose(icd);
+   return ok;
+}
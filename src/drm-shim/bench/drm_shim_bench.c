@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2020 Google LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Measures the CPU cost of API calls in a driver running on a drm-shim
+ * backend, so that driver overhead can be tracked on machines without the
+ * GPU.  The submit ioctls of the noop shims do nothing, so all of the time
+ * is spent in the driver (and the shim's ioctl dispatch).
+ *
+ *    LD_PRELOAD=libintel_noop_drm_shim.so MESA_LOADER_DRIVER_OVERRIDE=iris \
+ *       drm_shim_bench --gl
+ *    LD_PRELOAD=libintel_noop_drm_shim.so \
+ *       drm_shim_bench --vk libvulkan_intel.so
+ *
+ * The results are CSV: api, workload, calls, total ms, ns per call.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "util/macros.h"
+
+#include "drm_shim_bench.h"
+
+bool
+bench_selected(const struct bench_options *opts, const char *name)
+{
+   return !opts->filter || strstr(name, opts->filter);
+}
+
+void
+bench_report(const char *api, const char *name, uint64_t calls, int64_t ns)
+{
+   printf("%s,%s,%llu,%.3f,%.1f\n", api, name, (unsigned long long)calls,
+          ns / 1e6, calls ? (double)ns / calls : 0.0);
+   fflush(stdout);
+}
+
+/* Process CPU time, so that the shim's fake submissions and a busy machine
+ * don't show up as driver overhead.  This includes the driver's threads.
+ */
+int64_t
+bench_cpu_time_ns(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+   return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr,
+           "Usage: %s [options]\n"
+           "  --gl              run the OpenGL ES workloads\n"
+           "  --egl <path>      libEGL to use (default: libEGL.so.1)\n"
+           "  --vk <icd path>   run the Vulkan workloads on this ICD\n"
+           "  --iterations <n>  workload scale (default: 1000)\n"
+           "  --filter <name>   only run workloads containing name\n",
+           name);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const struct option long_options[] = {
+      { "gl",         no_argument,       NULL, 'g' },
+      { "egl",        required_argument, NULL, 'e' },
+      { "vk",         required_argument, NULL, 'v' },
+      { "iterations", required_argument, NULL, 'i' },
+      { "filter",     required_argument, NULL, 'f' },
+      { "help",       no_argument,       NULL, 'h' },
+      { NULL, 0, NULL, 0 },
+   };
+   struct bench_options opts = {
+      .iterations = 1000,
+   };
+   const char *egl_path = "libEGL.so.1";
+   const char *icd_path = NULL;
+   bool run_gl = false;
+   bool ok = true;
+   int c;
+
+   while ((c = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+      switch (c) {
+      case 'g':
+         run_gl = true;
+         break;
+      case 'e':
+         egl_path = optarg;
+         run_gl = true;
+         break;
+      case 'v':
+         icd_path = optarg;
+         break;
+      case 'i':
+         opts.iterations = MAX2(atoi(optarg), 1);
+         break;
+      case 'f':
+         opts.filter = optarg;
+         break;
+      default:
+         usage(argv[0]);
+         return c == 'h' ? 0 : 1;
+      }
+   }
+
+   if (!run_gl && !icd_path) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   printf("api,workload,calls,total_ms,ns_per_call\n");
+
+   if (run_gl)
+      ok &= bench_gl_run(egl_path, &opts);
+   if (icd_path)
+      ok &= bench_vk_run(icd_path, &opts);
+
+   return ok ? 0 : 1;
+}
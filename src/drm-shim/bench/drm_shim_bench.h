@@ -1,5 +1,5 @@
 /*
- * Copyright © 2014 Timothy Arceri
+ * Copyright © 2020 Google LLC
  *
  * Permission is hereby granted, free of charge, to any person obtaining a
  * copy of this software and associated documentation files (the "Software"),
@@ -19,17 +19,34 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
  * IN THE SOFTWARE.
- *
- * Author:
- *    Timothy Arceri <t_arceri@yahoo.com.au>
- *
  */
 
-#ifndef SSE_MINMAX_H
-#define SSE_MINMAX_H
+#ifndef DRM_SHIM_BENCH_H
+#define DRM_SHIM_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct bench_options {
+   /** Scale of each workload, the number of calls is a multiple of it. */
+   unsigned iterations;
+
+   /** If set, only run the workloads whose name contains it. */
+   const char *filter;
+};
+
+bool bench_selected(const struct bench_options *opts, const char *name);
+
+/**
+ * Print the result of a workload: calls API calls of the measured kind
+ * took ns nanoseconds of CPU time in total.
+ */
+void bench_report(const char *api, const char *name, uint64_t calls,
+                  int64_t ns);
+
+int64_t bench_cpu_time_ns(void);
 
-void
-_mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
-                         unsigned *max_index, const unsigned count);
+bool bench_gl_run(const char *egl_path, const struct bench_options *opts);
+bool bench_vk_run(const char *icd_path, const struct bench_options *opts);
 
-#endif /* SSE_MINMAX_H */
+#endif /* DRM_SHIM_BENCH_H */
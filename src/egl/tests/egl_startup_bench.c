@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2020 Google LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Times EGL startup: eglInitialize, context creation and the first
+ * eglMakeCurrent, on the surfaceless platform when available.
+ *
+ * Each iteration runs in a new process, which is what short-lived GL
+ * programs see; each process then initializes a second time, to show what
+ * is left once the per-process caches are warm.
+ *
+ *    egl_startup_bench [iterations]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "util/macros.h"
+#include "util/os_time.h"
+
+enum phase {
+   PHASE_INITIALIZE,
+   PHASE_CREATE_CONTEXT,
+   PHASE_MAKE_CURRENT,
+   PHASE_TOTAL,
+   NUM_PHASES,
+};
+
+static const char *phase_names[NUM_PHASES] = {
+   "eglInitialize", "eglCreateContext", "eglMakeCurrent", "total",
+};
+
+struct run_times {
+   bool ok;
+   int64_t ns[2][NUM_PHASES]; /* first and second initialization */
+};
+
+static EGLDisplay
+get_display(void)
+{
+   const char *exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+   PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+      eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+   if (exts && strstr(exts, "EGL_MESA_platform_surfaceless") &&
+       get_platform_display)
+      return get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                  EGL_DEFAULT_DISPLAY, NULL);
+
+   return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+static bool
+time_startup(int64_t *ns)
+{
+   static const EGLint config_attribs[] = {
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+      EGL_SURFACE_TYPE, 0,
+      EGL_NONE
+   };
+   static const EGLint context_attribs[] = {
+      EGL_CONTEXT_CLIENT_VERSION, 2,
+      EGL_NONE
+   };
+   EGLDisplay dpy;
+   EGLConfig config;
+   EGLContext ctx;
+   EGLint num_configs;
+   int64_t start, t;
+   bool ok = false;
+
+   start = os_time_get_nano();
+
+   dpy = get_display();
+   if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, NULL, NULL)) {
+      fprintf(stderr, "eglInitialize failed\n");
+      return false;
+   }
+   t = os_time_get_nano();
+   ns[PHASE_INITIALIZE] = t - start;
+
+   if (!eglBindAPI(EGL_OPENGL_ES_API) ||
+       !eglChooseConfig(dpy, config_attribs, &config, 1, &num_configs) ||
+       num_configs == 0) {
+      fprintf(stderr, "no ES2 config\n");
+      goto out;
+   }
+
+   ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, context_attribs);
+   if (ctx == EGL_NO_CONTEXT) {
+      fprintf(stderr, "eglCreateContext failed\n");
+      goto out;
+   }
+   ns[PHASE_CREATE_CONTEXT] = os_time_get_nano() - t;
+   t = os_time_get_nano();
+
+   if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+      fprintf(stderr, "eglMakeCurrent failed\n");
+      eglDestroyContext(dpy, ctx);
+      goto out;
+   }
+   ns[PHASE_MAKE_CURRENT] = os_time_get_nano() - t;
+   ns[PHASE_TOTAL] = os_time_get_nano() - start;
+   ok = true;
+
+   eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+   eglDestroyContext(dpy, ctx);
+out:
+   eglTerminate(dpy);
+   return ok;
+}
+
+static bool
+run_child(struct run_times *times)
+{
+   int fds[2];
+   pid_t pid;
+   int status;
+
+   if (pipe(fds) != 0)
+      return false;
+
+   pid = fork();
+   if (pid < 0) {
+      close(fds[0]);
+      close(fds[1]);
+      return false;
+   }
+
+   if (pid == 0) {
+      struct run_times child = { 0 };
+
+      close(fds[0]);
+      child.ok = time_startup(child.ns[0]) && time_startup(child.ns[1]);
+      if (write(fds[1], &child, sizeof(child)) != sizeof(child))
+         _exit(1);
+      _exit(0);
+   }
+
+   close(fds[1]);
+   times->ok = read(fds[0], times, sizeof(*times)) == sizeof(*times) &&
+               times->ok;
+   close(fds[0]);
+   waitpid(pid, &status, 0);
+
+   return times->ok;
+}
+
+static int
+compare_int64(const void *a, const void *b)
+{
+   int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+   return x < y ? -1 : x > y;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned iterations = argc > 1 ? atoi(argv[1]) : 20;
+   struct run_times *runs;
+   int64_t *samples;
+
+   iterations = MAX2(iterations, 1);
+   runs = calloc(iterations, sizeof(*runs));
+   samples = calloc(iterations, sizeof(*samples));
+   if (!runs || !samples)
+      return 1;
+
+   for (unsigned i = 0; i < iterations; i++) {
+      if (!run_child(&runs[i])) {
+         fprintf(stderr, "iteration %u failed\n", i);
+         return 1;
+      }
+   }
+
+   printf("%-20s %12s %12s %12s\n", "phase (us)", "min", "median", "max");
+   for (unsigned init = 0; init < 2; init++) {
+      printf("%s initialization in the process:\n",
+             init ? "second" : "first");
+      for (unsigned p = 0; p < NUM_PHASES; p++) {
+         for (unsigned i = 0; i < iterations; i++)
+            samples[i] = runs[i].ns[init][p];
+         qsort(samples, iterations, sizeof(*samples), compare_int64);
+         printf("  %-18s %12.1f %12.1f %12.1f\n", phase_names[p],
+                samples[0] / 1000.0, samples[iterations / 2] / 1000.0,
+                samples[iterations - 1] / 1000.0);
+      }
+   }
+
+   free(samples);
+   free(runs);
+   return 0;
+}
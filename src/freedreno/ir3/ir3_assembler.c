@@ -38,6 +38,7 @@ ir3_parse_asm(struct ir3_compiler *c, struct ir3_kernel_info *info, FILE *in)
 	shader->compiler = c;
 	shader->type = MESA_SHADER_COMPUTE;
 	mtx_init(&shader->variants_lock, mtx_plain);
+	util_queue_fence_init(&shader->ready);
 
 	struct ir3_shader_variant *v = rzalloc_size(shader, sizeof(*v));
 	v->type = MESA_SHADER_COMPUTE;
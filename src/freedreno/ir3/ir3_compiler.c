@@ -41,6 +41,7 @@ static const struct debug_named_value shader_debug_options[] = {
 	{"nouboopt",   IR3_DBG_NOUBOOPT,   "Disable lowering UBO to uniform"},
 	{"nofp16",     IR3_DBG_NOFP16,     "Don't lower mediump to fp16"},
 	{"nocache",    IR3_DBG_NOCACHE,    "Disable shader cache"},
+	{"nirsched",   IR3_DBG_NIRSCHED,   "Schedule NIR for register pressure before translating it"},
 #ifdef DEBUG
 	/* DEBUG-only options: */
 	{"schedmsgs",  IR3_DBG_SCHEDMSGS,  "Enable scheduler debug messages"},
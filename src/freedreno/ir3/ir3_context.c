@@ -30,6 +30,33 @@
 #include "ir3_shader.h"
 #include "ir3_nir.h"
 
+#include "compiler/nir/nir_schedule.h"
+
+static unsigned
+ir3_nir_instr_delay(nir_instr *instr, void *data)
+{
+	if (instr->type != nir_instr_type_intrinsic)
+		return 0;
+
+	/* Memory loads go out to the same long-latency path as texture fetches,
+	 * so try to issue them early too.
+	 */
+	switch (nir_instr_as_intrinsic(instr)->intrinsic) {
+	case nir_intrinsic_load_ssbo:
+	case nir_intrinsic_load_ssbo_ir3:
+	case nir_intrinsic_load_global:
+	case nir_intrinsic_load_global_ir3:
+	case nir_intrinsic_image_load:
+	case nir_intrinsic_bindless_image_load:
+		return 100;
+	case nir_intrinsic_load_ubo:
+	case nir_intrinsic_load_shared:
+		return 20;
+	default:
+		return 0;
+	}
+}
+
 struct ir3_context *
 ir3_context_init(struct ir3_compiler *compiler,
 		struct ir3_shader_variant *so)
@@ -113,6 +140,20 @@ ir3_context_init(struct ir3_compiler *compiler,
 
 	NIR_PASS_V(ctx->s, nir_convert_from_ssa, true);
 
+	/* Reorder instructions to keep register pressure low enough for good
+	 * occupancy before the block-local ir3 schedulers see them.
+	 */
+	if (ir3_shader_debug & IR3_DBG_NIRSCHED) {
+		struct nir_schedule_options schedule_options = {
+			/* In scalar channels: a quarter of the register file, so
+			 * that the shader still runs with plenty of waves.
+			 */
+			.threshold = 48,
+			.instr_delay_cb = ir3_nir_instr_delay,
+		};
+		NIR_PASS_V(ctx->s, nir_schedule, &schedule_options);
+	}
+
 	/* Super crude heuristic to limit # of tex prefetch in small
 	 * shaders.  This completely ignores loops.. but that's really
 	 * not the worst of it's problems.  (A frag shader that has
@@ -60,6 +60,13 @@
  * number of live values, it will try to pick the one with the earliest
  * consumer (based on pre-sched program order).
  *
+ * The number of values live within the block is tracked as we go.  While
+ * it is below SCHED_MAX_LIVE, texture fetches are issued as soon as they
+ * are ready, so that there is more independent work to hide their latency
+ * behind.  Past that point, only the register pressure heuristics apply,
+ * since using more registers reduces the number of waves that fit in the
+ * register file.
+ *
  * There are a few special cases that need to be handled, since sched
  * is currently independent of register allocation.  Usages of address
  * register (a0.x) or predicate register (p0.x) must be serialized.  Ie.
@@ -95,6 +102,9 @@ struct ir3_sched_ctx {
 	int remaining_kills;
 	int remaining_tex;
 
+	/* estimated # of (scalar) values live in the block: */
+	int live_values;
+
 	bool error;
 
 	int sfu_delay;
@@ -145,8 +155,16 @@ struct ir3_sched_node {
 #define foreach_sched_node(__n, __list) \
 	list_for_each_entry(struct ir3_sched_node, __n, __list, dag.link)
 
+/* Budget of live scalar values below which we favor hiding texture fetch
+ * latency over minimizing register pressure.  This is a quarter of the
+ * registers RA can allocate, and keeps the footprint small enough to not
+ * limit the # of waves on a6xx.
+ */
+#define SCHED_MAX_LIVE (4 * 12)
+
 static void sched_node_init(struct ir3_sched_ctx *ctx, struct ir3_instruction *instr);
 static void sched_node_add_dep(struct ir3_instruction *instr, struct ir3_instruction *src, int i);
+static int live_effect(struct ir3_instruction *instr);
 
 static bool is_scheduled(struct ir3_instruction *instr)
 {
@@ -162,6 +180,11 @@ schedule(struct ir3_sched_ctx *ctx, struct ir3_instruction *instr)
 	 */
 	list_delinit(&instr->node);
 
+	/* this needs to happen before the instruction is marked as scheduled,
+	 * since that changes the use counts live_effect() depends on:
+	 */
+	ctx->live_values = MAX2(0, ctx->live_values + live_effect(instr));
+
 	if (writes_addr0(instr)) {
 		debug_assert(ctx->addr0 == NULL);
 		ctx->addr0 = instr;
@@ -652,6 +675,46 @@ choose_instr_inc(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes,
 	return NULL;
 }
 
+/**
+ * While we are below SCHED_MAX_LIVE, pick a texture fetch as soon as one
+ * is ready, even if it increases register pressure, so that the
+ * instructions that follow it can cover its latency.
+ */
+static struct ir3_sched_node *
+choose_instr_tex(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes)
+{
+	struct ir3_sched_node *chosen = NULL;
+
+	foreach_sched_node (n, &ctx->dag->heads) {
+		if (!is_tex(n->instr))
+			continue;
+
+		if (would_sync(ctx, n->instr))
+			continue;
+
+		if (ctx->live_values + live_effect(n->instr) > SCHED_MAX_LIVE)
+			continue;
+
+		unsigned d = ir3_delay_calc(ctx->block, n->instr, false, false);
+
+		if (d > 0)
+			continue;
+
+		if (!check_instr(ctx, notes, n->instr))
+			continue;
+
+		if (!chosen || chosen->max_delay < n->max_delay)
+			chosen = n;
+	}
+
+	if (chosen) {
+		di(chosen->instr, "tex: chose (live=%d)", ctx->live_values);
+		return chosen;
+	}
+
+	return NULL;
+}
+
 /* Handles instruction selections for instructions we want to prioritize
  * even if csp/csr would not pick them.
  */
@@ -682,6 +745,8 @@ dump_state(struct ir3_sched_ctx *ctx)
 	if (!SCHED_DEBUG)
 		return;
 
+	d("live=%d", ctx->live_values);
+
 	foreach_sched_node (n, &ctx->dag->heads) {
 		di(n->instr, "maxdel=%3d le=%d del=%u ",
 				n->max_delay, live_effect(n->instr),
@@ -707,6 +772,10 @@ choose_instr(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes)
 	if (chosen)
 		return chosen->instr;
 
+	chosen = choose_instr_tex(ctx, notes);
+	if (chosen)
+		return chosen->instr;
+
 	chosen = choose_instr_dec(ctx, notes, true);
 	if (chosen)
 		return chosen->instr;
@@ -981,6 +1050,7 @@ sched_block(struct ir3_sched_ctx *ctx, struct ir3_block *block)
 	ctx->pred = NULL;
 	ctx->tex_delay = 0;
 	ctx->sfu_delay = 0;
+	ctx->live_values = 0;
 
 	/* move all instructions to the unscheduled list, and
 	 * empty the block's instruction list (to which we will
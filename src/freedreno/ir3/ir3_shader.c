@@ -316,6 +316,7 @@ ir3_shader_destroy(struct ir3_shader *shader)
 {
 	ralloc_free(shader->nir);
 	mtx_destroy(&shader->variants_lock);
+	util_queue_fence_destroy(&shader->ready);
 	ralloc_free(shader);
 }
 
@@ -459,6 +460,7 @@ ir3_shader_from_nir(struct ir3_compiler *compiler, nir_shader *nir,
 	struct ir3_shader *shader = rzalloc_size(NULL, sizeof(*shader));
 
 	mtx_init(&shader->variants_lock, mtx_plain);
+	util_queue_fence_init(&shader->ready);
 	shader->compiler = compiler;
 	shader->id = p_atomic_inc_return(&shader->compiler->shader_count);
 	shader->type = nir->info.stage;
@@ -34,6 +34,7 @@
 #include "compiler/nir/nir.h"
 #include "util/bitscan.h"
 #include "util/disk_cache.h"
+#include "util/u_queue.h"
 
 #include "ir3_compiler.h"
 
@@ -701,6 +702,11 @@ struct ir3_shader {
 	 */
 	bool initial_variants_done;
 
+	/* Signalled once freedreno's initial variants, which may be compiled
+	 * asynchronously, are done:
+	 */
+	struct util_queue_fence ready;
+
 	struct ir3_compiler *compiler;
 
 	unsigned num_reserved_user_consts;
@@ -2113,7 +2113,8 @@ tu_CmdBindPipeline(VkCommandBuffer commandBuffer,
    assert(pipelineBindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS);
 
    cmd->state.pipeline = pipeline;
-   cmd->state.dirty |= TU_CMD_DIRTY_DESC_SETS_LOAD | TU_CMD_DIRTY_SHADER_CONSTS;
+   cmd->state.dirty |= TU_CMD_DIRTY_DESC_SETS_LOAD | TU_CMD_DIRTY_SHADER_CONSTS |
+                       TU_CMD_DIRTY_VS_PARAMS;
 
    struct tu_cs *cs = &cmd->draw_cs;
    uint32_t mask = ~pipeline->dynamic_state_mask & BITFIELD_MASK(TU_DYNAMIC_STATE_COUNT);
@@ -3158,8 +3159,9 @@ tu6_draw_common(struct tu_cmd_buffer *cmd,
          ((cmd->state.dirty & TU_CMD_DIRTY_SHADER_CONSTS) ? 5 : 0) +
          ((cmd->state.dirty & TU_CMD_DIRTY_DESC_SETS_LOAD) ? 1 : 0) +
          ((cmd->state.dirty & TU_CMD_DIRTY_VERTEX_BUFFERS) ? 1 : 0) +
-         1; /* vs_params */
+         ((cmd->state.dirty & TU_CMD_DIRTY_VS_PARAMS) ? 1 : 0);
 
+      if (draw_state_count > 0)
          tu_cs_emit_pkt7(cs, CP_SET_DRAW_STATE, 3 * draw_state_count);
 
          /* We may need to re-emit tess consts if the current draw call is
@@ -3177,7 +3179,8 @@ tu6_draw_common(struct tu_cmd_buffer *cmd,
             tu_cs_emit_draw_state(cs, TU_DRAW_STATE_DESC_SETS_LOAD, pipeline->load_state);
          if (cmd->state.dirty & TU_CMD_DIRTY_VERTEX_BUFFERS)
             tu_cs_emit_draw_state(cs, TU_DRAW_STATE_VB, cmd->state.vertex_buffers);
-         tu_cs_emit_draw_state(cs, TU_DRAW_STATE_VS_PARAMS, cmd->state.vs_params);
+         if (cmd->state.dirty & TU_CMD_DIRTY_VS_PARAMS)
+            tu_cs_emit_draw_state(cs, TU_DRAW_STATE_VS_PARAMS, cmd->state.vs_params);
    }
 
    tu_cs_sanity_check(cs);
@@ -3245,22 +3248,33 @@ vs_params_offset(struct tu_cmd_buffer *cmd)
    return const_state->offsets.driver_param;
 }
 
-static struct tu_draw_state
+static void
 tu6_emit_vs_params(struct tu_cmd_buffer *cmd,
                    uint32_t vertex_offset,
                    uint32_t first_instance)
 {
+   /* consecutive draws with the same params can keep using the previous
+    * draw state (which is empty after an indirect draw, and the dirty bit
+    * is set when the pipeline, and so the const offset, changes):
+    */
+   if (cmd->state.vs_params.size &&
+       !(cmd->state.dirty & TU_CMD_DIRTY_VS_PARAMS) &&
+       cmd->state.vs_params_vertex_offset == vertex_offset &&
+       cmd->state.vs_params_first_instance == first_instance)
+      return;
+
    uint32_t offset = vs_params_offset(cmd);
 
+   cmd->state.dirty |= TU_CMD_DIRTY_VS_PARAMS;
+
    struct tu_cs cs;
    VkResult result = tu_cs_begin_sub_stream(&cmd->sub_cs, 3 + (offset ? 8 : 0), &cs);
    if (result != VK_SUCCESS) {
       cmd->record_result = result;
-      return (struct tu_draw_state) {};
+      cmd->state.vs_params = (struct tu_draw_state) {};
+      return;
    }
 
-   /* TODO: don't make a new draw state when it doesn't change */
-
    tu_cs_emit_regs(&cs,
                    A6XX_VFD_INDEX_OFFSET(vertex_offset),
                    A6XX_VFD_INSTANCE_START_OFFSET(first_instance));
@@ -3282,7 +3296,9 @@ tu6_emit_vs_params(struct tu_cmd_buffer *cmd,
    }
 
    struct tu_cs_entry entry = tu_cs_end_sub_stream(&cmd->sub_cs, &cs);
-   return (struct tu_draw_state) {entry.bo->iova + entry.offset, entry.size / 4};
+   cmd->state.vs_params = (struct tu_draw_state) {entry.bo->iova + entry.offset, entry.size / 4};
+   cmd->state.vs_params_vertex_offset = vertex_offset;
+   cmd->state.vs_params_first_instance = first_instance;
 }
 
 void
@@ -3295,7 +3311,7 @@ tu_CmdDraw(VkCommandBuffer commandBuffer,
    TU_FROM_HANDLE(tu_cmd_buffer, cmd, commandBuffer);
    struct tu_cs *cs = &cmd->draw_cs;
 
-   cmd->state.vs_params = tu6_emit_vs_params(cmd, firstVertex, firstInstance);
+   tu6_emit_vs_params(cmd, firstVertex, firstInstance);
 
    tu6_draw_common(cmd, cs, false, vertexCount);
 
@@ -3316,7 +3332,7 @@ tu_CmdDrawIndexed(VkCommandBuffer commandBuffer,
    TU_FROM_HANDLE(tu_cmd_buffer, cmd, commandBuffer);
    struct tu_cs *cs = &cmd->draw_cs;
 
-   cmd->state.vs_params = tu6_emit_vs_params(cmd, vertexOffset, firstInstance);
+   tu6_emit_vs_params(cmd, vertexOffset, firstInstance);
 
    tu6_draw_common(cmd, cs, true, indexCount);
 
@@ -3355,6 +3371,7 @@ tu_CmdDrawIndirect(VkCommandBuffer commandBuffer,
    struct tu_cs *cs = &cmd->draw_cs;
 
    cmd->state.vs_params = (struct tu_draw_state) {};
+   cmd->state.dirty |= TU_CMD_DIRTY_VS_PARAMS;
 
    /* The latest known a630_sqe.fw fails to wait for WFI before reading the
     * indirect buffer when using CP_DRAW_INDIRECT_MULTI, so we have to fall
@@ -3391,6 +3408,7 @@ tu_CmdDrawIndexedIndirect(VkCommandBuffer commandBuffer,
    struct tu_cs *cs = &cmd->draw_cs;
 
    cmd->state.vs_params = (struct tu_draw_state) {};
+   cmd->state.dirty |= TU_CMD_DIRTY_VS_PARAMS;
 
    if (cmd->device->physical_device->gpu_id != 650)
       draw_wfm(cmd);
@@ -3425,6 +3443,7 @@ tu_CmdDrawIndirectCount(VkCommandBuffer commandBuffer,
    struct tu_cs *cs = &cmd->draw_cs;
 
    cmd->state.vs_params = (struct tu_draw_state) {};
+   cmd->state.dirty |= TU_CMD_DIRTY_VS_PARAMS;
 
    /* It turns out that the firmware we have for a650 only partially fixed the
     * problem with CP_DRAW_INDIRECT_MULTI not waiting for WFI's to complete
@@ -3463,6 +3482,7 @@ tu_CmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer,
    struct tu_cs *cs = &cmd->draw_cs;
 
    cmd->state.vs_params = (struct tu_draw_state) {};
+   cmd->state.dirty |= TU_CMD_DIRTY_VS_PARAMS;
 
    draw_wfm(cmd);
 
@@ -3502,7 +3522,7 @@ void tu_CmdDrawIndirectByteCountEXT(VkCommandBuffer commandBuffer,
     */
    draw_wfm(cmd);
 
-   cmd->state.vs_params = tu6_emit_vs_params(cmd, 0, firstInstance);
+   tu6_emit_vs_params(cmd, 0, firstInstance);
 
    tu6_draw_common(cmd, cs, false, 0);
 
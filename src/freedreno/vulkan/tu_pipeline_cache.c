@@ -203,25 +203,15 @@ tu_pipeline_cache_load(struct tu_pipeline_cache *cache,
                        size_t size)
 {
    struct tu_device *device = cache->device;
-   struct vk_pipeline_cache_header header;
 
-   if (size < sizeof(header))
-      return;
-   memcpy(&header, data, sizeof(header));
-   if (header.header_size < sizeof(header))
-      return;
-   if (header.header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
-      return;
-   if (header.vendor_id != 0 /* TODO */)
-      return;
-   if (header.device_id != 0 /* TODO */)
-      return;
-   if (memcmp(header.uuid, device->physical_device->cache_uuid,
-              VK_UUID_SIZE) != 0)
+   size_t header_size =
+      vk_pipeline_cache_header_check(data, size, 0 /* TODO */, 0 /* TODO */,
+                                     device->physical_device->cache_uuid);
+   if (header_size == 0)
       return;
 
    char *end = (void *) data + size;
-   char *p = (void *) data + header.header_size;
+   char *p = (void *) data + header_size;
 
    while (end - p >= sizeof(struct cache_entry)) {
       struct cache_entry *entry = (struct cache_entry *) p;
@@ -317,11 +307,8 @@ tu_GetPipelineCacheData(VkDevice _device,
    }
    void *p = pData, *end = pData + *pDataSize;
    header = p;
-   header->header_size = sizeof(*header);
-   header->header_version = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
-   header->vendor_id = 0 /* TODO */;
-   header->device_id = 0 /* TODO */;
-   memcpy(header->uuid, device->physical_device->cache_uuid, VK_UUID_SIZE);
+   vk_pipeline_cache_header_init(header, 0 /* TODO */, 0 /* TODO */,
+                                 device->physical_device->cache_uuid);
    p += header->header_size;
 
    struct cache_entry *entry;
@@ -713,6 +713,7 @@ enum tu_cmd_dirty_bits
    TU_CMD_DIRTY_SHADER_CONSTS = 1 << 5,
    /* all draw states were disabled and need to be re-enabled: */
    TU_CMD_DIRTY_DRAW_STATE = 1 << 7,
+   TU_CMD_DIRTY_VS_PARAMS = 1 << 8,
 };
 
 /* There are only three cache domains we have to care about: the CCU, or
@@ -891,6 +892,8 @@ struct tu_cmd_state
    struct tu_draw_state desc_sets;
 
    struct tu_draw_state vs_params;
+   /* values vs_params was emitted with, to skip re-emitting it: */
+   uint32_t vs_params_vertex_offset, vs_params_first_instance;
 
    /* Index buffer */
    uint64_t index_va;
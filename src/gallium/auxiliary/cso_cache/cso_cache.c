@@ -30,6 +30,8 @@
 
 #include "util/u_debug.h"
 
+#include "util/hash_table.h"
+#include "util/simple_mtx.h"
 #include "util/u_memory.h"
 
 #include "cso_cache.h"
@@ -318,3 +320,190 @@ void cso_cache_set_sanitize_callback(struct cso_cache *sc,
    sc->sanitize_data = user_data;
 }
 
+
+
+/* Once a type has this many shared states, new ones are left to the
+ * per-context caches, which can evict them.
+ */
+#define CSO_SHARED_CACHE_MAX_SIZE 4096
+
+struct cso_shared_state {
+   /* Must be first, for cso_hash_find_data_from_template(). */
+   union {
+      struct pipe_blend_state blend;
+      struct pipe_depth_stencil_alpha_state dsa;
+      struct pipe_rasterizer_state rasterizer;
+      struct pipe_sampler_state sampler;
+   } state;
+   void *data;
+};
+
+struct cso_shared_cache {
+   struct pipe_screen *screen;
+   unsigned refcount;
+
+   struct {
+      simple_mtx_t lock;
+      struct cso_hash hash;
+   } types[CSO_CACHE_MAX];
+};
+
+/* Shared caches by screen, protected by shared_caches_lock. */
+static struct hash_table *shared_caches;
+static simple_mtx_t shared_caches_lock = _SIMPLE_MTX_INITIALIZER_NP;
+
+struct cso_shared_cache *cso_shared_cache_get(struct pipe_screen *screen)
+{
+   struct cso_shared_cache *sc = NULL;
+
+   simple_mtx_lock(&shared_caches_lock);
+
+   if (!shared_caches) {
+      shared_caches = _mesa_pointer_hash_table_create(NULL);
+      if (!shared_caches)
+         goto out;
+   }
+
+   struct hash_entry *entry = _mesa_hash_table_search(shared_caches, screen);
+   if (entry) {
+      sc = entry->data;
+   } else {
+      sc = CALLOC_STRUCT(cso_shared_cache);
+      if (!sc)
+         goto out;
+
+      sc->screen = screen;
+      for (unsigned i = 0; i < CSO_CACHE_MAX; i++) {
+         simple_mtx_init(&sc->types[i].lock, mtx_plain);
+         cso_hash_init(&sc->types[i].hash);
+      }
+      _mesa_hash_table_insert(shared_caches, screen, sc);
+   }
+   sc->refcount++;
+
+out:
+   simple_mtx_unlock(&shared_caches_lock);
+   return sc;
+}
+
+static void delete_shared_state(struct pipe_context *pipe,
+                                enum cso_cache_type type, void *data)
+{
+   switch (type) {
+   case CSO_BLEND:
+      pipe->delete_blend_state(pipe, data);
+      break;
+   case CSO_DEPTH_STENCIL_ALPHA:
+      pipe->delete_depth_stencil_alpha_state(pipe, data);
+      break;
+   case CSO_RASTERIZER:
+      pipe->delete_rasterizer_state(pipe, data);
+      break;
+   case CSO_SAMPLER:
+      pipe->delete_sampler_state(pipe, data);
+      break;
+   default:
+      unreachable("state type isn't shared");
+   }
+}
+
+/**
+ * Drop a context's reference to the shared cache.  \p pipe must be able to
+ * delete the shared states if this is the last reference.
+ */
+void cso_shared_cache_release(struct cso_shared_cache *sc,
+                              struct pipe_context *pipe)
+{
+   simple_mtx_lock(&shared_caches_lock);
+
+   if (--sc->refcount == 0) {
+      _mesa_hash_table_remove_key(shared_caches, sc->screen);
+
+      for (unsigned i = 0; i < CSO_CACHE_MAX; i++) {
+         struct cso_hash *hash = &sc->types[i].hash;
+         struct cso_hash_iter iter = cso_hash_first_node(hash);
+
+         while (!cso_hash_iter_is_null(iter)) {
+            struct cso_shared_state *state = cso_hash_iter_data(iter);
+
+            if (state->data)
+               delete_shared_state(pipe, i, state->data);
+            FREE(state);
+            iter = cso_hash_iter_next(iter);
+         }
+
+         cso_hash_deinit(hash);
+         simple_mtx_destroy(&sc->types[i].lock);
+      }
+      FREE(sc);
+   }
+
+   simple_mtx_unlock(&shared_caches_lock);
+}
+
+static void *create_shared_state(struct pipe_context *pipe,
+                                 enum cso_cache_type type, const void *templ)
+{
+   switch (type) {
+   case CSO_BLEND:
+      return pipe->create_blend_state(pipe, templ);
+   case CSO_DEPTH_STENCIL_ALPHA:
+      return pipe->create_depth_stencil_alpha_state(pipe, templ);
+   case CSO_RASTERIZER:
+      return pipe->create_rasterizer_state(pipe, templ);
+   case CSO_SAMPLER:
+      return pipe->create_sampler_state(pipe, templ);
+   default:
+      unreachable("state type isn't shared");
+   }
+}
+
+/**
+ * Look up the driver object for the first \p size bytes of \p templ, which
+ * must be a whole state struct of the given type, creating it with \p pipe
+ * if it isn't in the cache yet.
+ *
+ * Returns false if the state should be created privately instead because
+ * the cache is full.
+ */
+bool cso_shared_cache_find_or_create(struct cso_shared_cache *sc,
+                                     enum cso_cache_type type,
+                                     unsigned hash_key,
+                                     const void *templ, unsigned size,
+                                     struct pipe_context *pipe,
+                                     void **data)
+{
+   struct cso_hash *hash = &sc->types[type].hash;
+   struct cso_shared_state *state;
+
+   simple_mtx_lock(&sc->types[type].lock);
+
+   state = cso_hash_find_data_from_template(hash, hash_key, (void *)templ,
+                                            size);
+   if (!state) {
+      if (cso_hash_size(hash) >= CSO_SHARED_CACHE_MAX_SIZE)
+         goto fail;
+
+      state = CALLOC_STRUCT(cso_shared_state);
+      if (!state)
+         goto fail;
+
+      memcpy(&state->state, templ, size);
+      state->data = create_shared_state(pipe, type, templ);
+
+      if (cso_hash_iter_is_null(cso_hash_insert(hash, hash_key, state))) {
+         if (state->data)
+            delete_shared_state(pipe, type, state->data);
+         FREE(state);
+         goto fail;
+      }
+   }
+
+   *data = state->data;
+   simple_mtx_unlock(&sc->types[type].lock);
+   return true;
+
+fail:
+   simple_mtx_unlock(&sc->types[type].lock);
+   return false;
+}
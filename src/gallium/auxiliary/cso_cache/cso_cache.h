@@ -169,6 +169,26 @@ void * cso_take_state(struct cso_cache *sc, unsigned hash_key,
 void cso_set_maximum_cache_size(struct cso_cache *sc, int number);
 int cso_maximum_cache_size(const struct cso_cache *sc);
 
+/**
+ * Screen-wide cache of blend, depth-stencil-alpha, rasterizer and sampler
+ * driver objects, shared by all CSO contexts on a screen that supports
+ * PIPE_CAP_SHAREABLE_CSOS.  Each state type has its own lock.
+ *
+ * Shared objects live until the last CSO context on the screen releases the
+ * cache, and are then deleted through that context.
+ */
+struct cso_shared_cache;
+
+struct cso_shared_cache *cso_shared_cache_get(struct pipe_screen *screen);
+void cso_shared_cache_release(struct cso_shared_cache *sc,
+                              struct pipe_context *pipe);
+bool cso_shared_cache_find_or_create(struct cso_shared_cache *sc,
+                                     enum cso_cache_type type,
+                                     unsigned hash_key,
+                                     const void *templ, unsigned size,
+                                     struct pipe_context *pipe,
+                                     void **data);
+
 #ifdef	__cplusplus
 }
 #endif
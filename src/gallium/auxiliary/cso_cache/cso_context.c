@@ -64,6 +64,7 @@ struct sampler_info
 struct cso_context {
    struct pipe_context *pipe;
    struct cso_cache *cache;
+   struct cso_shared_cache *shared_cache;
 
    struct u_vbuf *vbuf;
    struct u_vbuf *vbuf_current;
@@ -322,6 +323,9 @@ cso_create_context(struct pipe_context *pipe, unsigned flags)
    ctx->pipe = pipe;
    ctx->sample_mask = ~0;
 
+   if (pipe->screen->get_param(pipe->screen, PIPE_CAP_SHAREABLE_CSOS))
+      ctx->shared_cache = cso_shared_cache_get(pipe->screen);
+
    cso_init_vbuf(ctx, flags);
 
    /* Enable for testing: */
@@ -446,6 +450,9 @@ void cso_destroy_context( struct cso_context *ctx )
       ctx->cache = NULL;
    }
 
+   if (ctx->shared_cache)
+      cso_shared_cache_release(ctx->shared_cache, ctx->pipe);
+
    if (ctx->vbuf)
       u_vbuf_destroy(ctx->vbuf);
    FREE( ctx );
@@ -462,6 +469,25 @@ void cso_destroy_context( struct cso_context *ctx )
  * the data member of the cso to be the template itself.
  */
 
+/**
+ * Get the driver object for a new cache entry from the screen-wide shared
+ * cache, if the context uses one.  Shared objects are owned by the shared
+ * cache, so the entry mustn't delete them.
+ */
+static inline bool
+cso_find_shared_state(struct cso_context *ctx, enum cso_cache_type type,
+                      unsigned hash_key, const void *templ, unsigned size,
+                      void **data, cso_state_callback *delete_state)
+{
+   if (!ctx->shared_cache ||
+       !cso_shared_cache_find_or_create(ctx->shared_cache, type, hash_key,
+                                        templ, size, ctx->pipe, data))
+      return false;
+
+   *delete_state = NULL;
+   return true;
+}
+
 enum pipe_error cso_set_blend(struct cso_context *ctx,
                               const struct pipe_blend_state *templ)
 {
@@ -483,8 +509,12 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
 
       memset(&cso->state, 0, sizeof cso->state);
       memcpy(&cso->state, templ, key_size);
-      cso->data = ctx->pipe->create_blend_state(ctx->pipe, &cso->state);
-      cso->delete_state = (cso_state_callback)ctx->pipe->delete_blend_state;
+      if (!cso_find_shared_state(ctx, CSO_BLEND, hash_key, &cso->state,
+                                 key_size, &cso->data, &cso->delete_state)) {
+         cso->data = ctx->pipe->create_blend_state(ctx->pipe, &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_blend_state;
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso);
@@ -544,10 +574,14 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
          return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy(&cso->state, templ, sizeof(*templ));
-      cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
-                                                              &cso->state);
-      cso->delete_state =
-         (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
+      if (!cso_find_shared_state(ctx, CSO_DEPTH_STENCIL_ALPHA, hash_key,
+                                 &cso->state, key_size, &cso->data,
+                                 &cso->delete_state)) {
+         cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
+                                                                 &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key,
@@ -613,9 +647,13 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
          return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy(&cso->state, templ, sizeof(*templ));
-      cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe, &cso->state);
-      cso->delete_state =
-         (cso_state_callback)ctx->pipe->delete_rasterizer_state;
+      if (!cso_find_shared_state(ctx, CSO_RASTERIZER, hash_key, &cso->state,
+                                 key_size, &cso->data, &cso->delete_state)) {
+         cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe,
+                                                        &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_rasterizer_state;
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso);
@@ -1249,9 +1287,14 @@ cso_single_sampler(struct cso_context *ctx, enum pipe_shader_type shader_stage,
             return;
 
          memcpy(&cso->state, templ, sizeof(*templ));
-         cso->data = ctx->pipe->create_sampler_state(ctx->pipe, &cso->state);
-         cso->delete_state =
-            (cso_state_callback) ctx->pipe->delete_sampler_state;
+         if (!cso_find_shared_state(ctx, CSO_SAMPLER, hash_key, &cso->state,
+                                    key_size, &cso->data,
+                                    &cso->delete_state)) {
+            cso->data = ctx->pipe->create_sampler_state(ctx->pipe,
+                                                        &cso->state);
+            cso->delete_state =
+               (cso_state_callback) ctx->pipe->delete_sampler_state;
+         }
          cso->context = ctx->pipe;
          cso->hash_key = hash_key;
 
@@ -38,6 +38,7 @@
 #include "util/u_inlines.h"
 #include "util/u_helpers.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
 #include "util/format/u_format.h"
 #include "draw_context.h"
 #include "draw_pipe.h"
@@ -236,6 +237,11 @@ void draw_destroy( struct draw_context *draw )
       draw_llvm_destroy( draw->llvm );
 #endif
 
+   if (draw->tes.queue) {
+      util_queue_destroy(draw->tes.queue);
+      FREE(draw->tes.queue);
+   }
+
    FREE( draw );
 }
 
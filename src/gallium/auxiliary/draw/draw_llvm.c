@@ -54,10 +54,12 @@
 #include "gallivm/lp_bld_misc.h"
 #include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 
 #include "util/u_math.h"
 #include "util/u_pointer.h"
 #include "util/u_string.h"
+#include "util/u_cpu_detect.h"
 #include "util/simple_list.h"
 #include "nir_serialize.h"
 #include "util/mesa-sha1.h"
@@ -801,6 +803,14 @@ draw_llvm_create(struct draw_context *draw, LLVMContextRef context)
    llvm->nr_tes_variants = 0;
    make_empty_list(&llvm->tes_variants_list);
 
+   llvm->num_vs_threads =
+      debug_get_num_option("DRAW_VS_THREADS",
+                           MIN2(util_cpu_caps.nr_cpus - 1,
+                                DRAW_LLVM_MAX_VS_THREADS));
+   llvm->num_vs_threads = MIN2(llvm->num_vs_threads, DRAW_LLVM_MAX_VS_THREADS);
+   for (unsigned i = 0; i < ARRAY_SIZE(llvm->vs_jobs); i++)
+      util_queue_fence_init(&llvm->vs_jobs[i].fence);
+
    return llvm;
 
 fail:
@@ -815,6 +825,11 @@ fail:
 void
 draw_llvm_destroy(struct draw_llvm *llvm)
 {
+   if (util_queue_is_initialized(&llvm->vs_queue))
+      util_queue_destroy(&llvm->vs_queue);
+   for (unsigned i = 0; i < ARRAY_SIZE(llvm->vs_jobs); i++)
+      util_queue_fence_destroy(&llvm->vs_jobs[i].fence);
+
    if (llvm->context_owned)
       LLVMContextDispose(llvm->context);
    llvm->context = NULL;
@@ -824,7 +839,110 @@ draw_llvm_destroy(struct draw_llvm *llvm)
 }
 
 static void
-draw_get_ir_cache_key(struct nir_shader *nir,
+draw_llvm_vs_job_execute(void *data, int thread_index)
+{
+   struct draw_llvm_vs_job *job = data;
+
+   job->clipped = job->jit_func(job->context, job->io, job->vbuffers,
+                                job->count, job->start_or_maxelt, job->stride,
+                                job->vertex_buffers, job->instance_id,
+                                job->vertex_id_offset, job->start_instance,
+                                job->fetch_elts, job->draw_id);
+}
+
+
+/**
+ * Run a vertex shader variant over count vertices, returning whether any
+ * of them needs clipping.
+ *
+ * Large runs are split in slices shaded on the vs worker threads, with the
+ * calling thread taking the first slice.  The shader function writes whole
+ * SIMD vectors of vertices, so all but the last slice are a multiple of the
+ * vector length to not step on each other's outputs.  Outputs end up in
+ * the same place either way, so everything downstream stays in order.
+ */
+boolean
+draw_llvm_run_vs(struct draw_llvm *llvm,
+                 struct draw_llvm_variant *variant,
+                 struct vertex_header *io,
+                 const struct draw_vertex_buffer vbuffers[PIPE_MAX_ATTRIBS],
+                 unsigned count,
+                 unsigned start_or_maxelt,
+                 unsigned stride,
+                 struct pipe_vertex_buffer *vertex_buffers,
+                 unsigned instance_id,
+                 unsigned vertex_id_offset,
+                 unsigned start_instance,
+                 const unsigned *fetch_elts,
+                 unsigned draw_id)
+{
+   const unsigned vector_length = lp_native_vector_width / 32;
+   unsigned num_jobs = MIN2(llvm->num_vs_threads + 1,
+                            count / DRAW_LLVM_VS_MIN_CHUNK);
+   unsigned chunk, first = 0;
+   boolean clipped = FALSE;
+
+   /* Only start the threads once there's a draw big enough to use them. */
+   if (num_jobs > 1 &&
+       !util_queue_is_initialized(&llvm->vs_queue) &&
+       !util_queue_init(&llvm->vs_queue, "drawvs", DRAW_LLVM_MAX_VS_THREADS,
+                        llvm->num_vs_threads, 0)) {
+      llvm->num_vs_threads = 0;
+      num_jobs = 1;
+   }
+
+   if (num_jobs <= 1)
+      return variant->jit_func(&llvm->jit_context, io, vbuffers, count,
+                               start_or_maxelt, stride, vertex_buffers,
+                               instance_id, vertex_id_offset, start_instance,
+                               fetch_elts, draw_id);
+
+   chunk = align(DIV_ROUND_UP(count, num_jobs), vector_length);
+
+   /* Slices are at least DRAW_LLVM_VS_MIN_CHUNK, much more than the
+    * alignment adds up to, so none of them ends up empty.
+    */
+   for (unsigned i = 0; i < num_jobs; i++) {
+      struct draw_llvm_vs_job *job = &llvm->vs_jobs[i];
+
+      assert(first < count);
+
+      job->jit_func = variant->jit_func;
+      job->context = &llvm->jit_context;
+      job->io = (struct vertex_header *)((char *)io + first * stride);
+      job->vbuffers = vbuffers;
+      job->count = MIN2(chunk, count - first);
+      job->start_or_maxelt = fetch_elts ? start_or_maxelt :
+                                          start_or_maxelt + first;
+      job->stride = stride;
+      job->vertex_buffers = vertex_buffers;
+      job->instance_id = instance_id;
+      job->vertex_id_offset = vertex_id_offset;
+      job->start_instance = start_instance;
+      job->fetch_elts = fetch_elts ? fetch_elts + first : NULL;
+      job->draw_id = draw_id;
+      job->clipped = FALSE;
+
+      if (i)
+         util_queue_add_job(&llvm->vs_queue, job, &job->fence,
+                            draw_llvm_vs_job_execute, NULL, 0);
+      first += job->count;
+   }
+
+   draw_llvm_vs_job_execute(&llvm->vs_jobs[0], 0);
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      if (i)
+         util_queue_fence_wait(&llvm->vs_jobs[i].fence);
+      clipped |= llvm->vs_jobs[i].clipped;
+   }
+
+   return clipped;
+}
+
+
+static void
+draw_get_ir_cache_key(const struct pipe_shader_state *state,
                       const void *key, size_t key_size,
                       uint32_t val_32bit,
                       unsigned char ir_sha1_cache_key[20])
@@ -834,12 +952,18 @@ draw_get_ir_cache_key(struct nir_shader *nir,
    void *ir_binary;
 
    blob_init(&blob);
-   nir_serialize(&blob, nir, true);
+   if (state->type == PIPE_SHADER_IR_NIR)
+      nir_serialize(&blob, state->ir.nir, true);
+   else
+      blob_write_bytes(&blob, state->tokens,
+                       tgsi_num_tokens(state->tokens) *
+                       sizeof(struct tgsi_token));
    ir_binary = blob.data;
    ir_size = blob.size;
 
    struct mesa_sha1 ctx;
    _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &state->type, sizeof(state->type));
    _mesa_sha1_update(&ctx, key, key_size);
    _mesa_sha1_update(&ctx, ir_binary, ir_size);
    _mesa_sha1_update(&ctx, &val_32bit, 4);
@@ -877,8 +1001,8 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    snprintf(module_name, sizeof(module_name), "draw_llvm_vs_variant%u",
             variant->shader->variants_cached);
 
-   if (shader->base.state.ir.nir && llvm->draw->disk_cache_cookie) {
-      draw_get_ir_cache_key(shader->base.state.ir.nir,
+   if (llvm->draw->disk_cache_cookie) {
+      draw_get_ir_cache_key(&shader->base.state,
                             key,
                             shader->variant_key_size,
                             num_inputs,
@@ -2911,8 +3035,8 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
 
    memcpy(&variant->key, key, shader->variant_key_size);
 
-   if (shader->base.state.ir.nir && llvm->draw->disk_cache_cookie) {
-      draw_get_ir_cache_key(shader->base.state.ir.nir,
+   if (llvm->draw->disk_cache_cookie) {
+      draw_get_ir_cache_key(&shader->base.state,
                             key,
                             shader->variant_key_size,
                             num_outputs,
@@ -3539,8 +3663,8 @@ draw_tcs_llvm_create_variant(struct draw_llvm *llvm,
 
    memcpy(&variant->key, key, shader->variant_key_size);
 
-   if (shader->base.state.ir.nir && llvm->draw->disk_cache_cookie) {
-      draw_get_ir_cache_key(shader->base.state.ir.nir,
+   if (llvm->draw->disk_cache_cookie) {
+      draw_get_ir_cache_key(&shader->base.state,
                             key,
                             shader->variant_key_size,
                             num_outputs,
@@ -4037,8 +4161,8 @@ draw_tes_llvm_create_variant(struct draw_llvm *llvm,
             variant->shader->variants_cached);
 
    memcpy(&variant->key, key, shader->variant_key_size);
-   if (shader->base.state.ir.nir && llvm->draw->disk_cache_cookie) {
-      draw_get_ir_cache_key(shader->base.state.ir.nir,
+   if (llvm->draw->disk_cache_cookie) {
+      draw_get_ir_cache_key(&shader->base.state,
                             key,
                             shader->variant_key_size,
                             num_outputs,
@@ -39,6 +39,7 @@
 
 #include "pipe/p_context.h"
 #include "util/simple_list.h"
+#include "util/u_queue.h"
 
 
 struct draw_llvm;
@@ -777,6 +778,32 @@ struct llvm_tess_eval_shader {
    unsigned variants_cached;
 };
 
+/** Max worker threads for splitting vertex shader runs, DRAW_VS_THREADS */
+#define DRAW_LLVM_MAX_VS_THREADS 8
+
+/** Smallest number of vertices worth handing to another thread */
+#define DRAW_LLVM_VS_MIN_CHUNK 256
+
+/** A slice of a vertex shader run, see draw_llvm_run_vs() */
+struct draw_llvm_vs_job {
+   draw_jit_vert_func jit_func;
+   struct draw_jit_context *context;
+   struct vertex_header *io;
+   const struct draw_vertex_buffer *vbuffers;
+   unsigned count;
+   unsigned start_or_maxelt;
+   unsigned stride;
+   struct pipe_vertex_buffer *vertex_buffers;
+   unsigned instance_id;
+   unsigned vertex_id_offset;
+   unsigned start_instance;
+   const unsigned *fetch_elts;
+   unsigned draw_id;
+
+   boolean clipped;
+   struct util_queue_fence fence;
+};
+
 struct draw_llvm {
    struct draw_context *draw;
 
@@ -799,6 +826,11 @@ struct draw_llvm {
 
    struct draw_tes_llvm_variant_list_item tes_variants_list;
    int nr_tes_variants;
+
+   /** Worker threads sharing large vertex shader runs with the caller */
+   unsigned num_vs_threads;
+   struct util_queue vs_queue;
+   struct draw_llvm_vs_job vs_jobs[DRAW_LLVM_MAX_VS_THREADS + 1];
 };
 
 
@@ -832,6 +864,21 @@ draw_llvm_create(struct draw_context *draw, LLVMContextRef llvm_context);
 void
 draw_llvm_destroy(struct draw_llvm *llvm);
 
+boolean
+draw_llvm_run_vs(struct draw_llvm *llvm,
+                 struct draw_llvm_variant *variant,
+                 struct vertex_header *io,
+                 const struct draw_vertex_buffer vbuffers[PIPE_MAX_ATTRIBS],
+                 unsigned count,
+                 unsigned start_or_maxelt,
+                 unsigned stride,
+                 struct pipe_vertex_buffer *vertex_buffers,
+                 unsigned instance_id,
+                 unsigned vertex_id_offset,
+                 unsigned start_instance,
+                 const unsigned *fetch_elts,
+                 unsigned draw_id);
+
 struct draw_llvm_variant *
 draw_llvm_create_variant(struct draw_llvm *llvm,
                          unsigned num_vertex_header_attribs,
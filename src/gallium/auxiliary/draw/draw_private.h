@@ -68,6 +68,7 @@ struct tgsi_exec_machine;
 struct tgsi_sampler;
 struct tgsi_image;
 struct tgsi_buffer;
+struct util_queue;
 struct draw_pt_front_end;
 struct draw_assembler;
 struct draw_llvm;
@@ -330,6 +331,9 @@ struct draw_context
       struct draw_tess_eval_shader *tess_eval_shader;
       uint position_output;
 
+      /** Tessellator threads, created on first use */
+      struct util_queue *queue;
+
       /** Fields for TGSI interpreter / execution */
       struct {
          struct tgsi_exec_machine *machine;
@@ -621,17 +621,17 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       vid_base = draw->pt.user.eltBias;
       elts = fetch_info->elts;
    }
-   clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
-                                             llvm_vert_info.verts,
-                                             draw->pt.user.vbuffer,
-                                             fetch_info->count,
-                                             start_or_maxelt,
-                                             fpme->vertex_size,
-                                             draw->pt.vertex_buffer,
-                                             draw->instance_id,
-                                             vid_base,
-                                             draw->start_instance,
-                                             elts, draw->pt.user.drawid);
+   clipped = draw_llvm_run_vs(fpme->llvm, fpme->current_variant,
+                              llvm_vert_info.verts,
+                              draw->pt.user.vbuffer,
+                              fetch_info->count,
+                              start_or_maxelt,
+                              fpme->vertex_size,
+                              draw->pt.vertex_buffer,
+                              draw->instance_id,
+                              vid_base,
+                              draw->start_instance,
+                              elts, draw->pt.user.drawid);
 
    /* Finished with fetch and vs:
     */
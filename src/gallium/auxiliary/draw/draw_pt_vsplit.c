@@ -29,9 +29,16 @@
 #include "draw/draw_context.h"
 #include "draw/draw_private.h"
 #include "draw/draw_pt.h"
+#include "draw/draw_vbuf.h"
 
-#define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+#define SEGMENT_SIZE 4096
+
+/* The vertex cache is CACHE_WAYS-way set associative, with FIFO
+ * replacement within a set.  Its size is set with DRAW_VSPLIT_CACHE_SIZE.
+ */
+#define CACHE_WAYS         4
+#define DEFAULT_CACHE_SIZE SEGMENT_SIZE
+#define MAX_CACHE_SIZE     (2 * SEGMENT_SIZE)
 
 /* The largest possible index within an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -53,10 +60,14 @@ struct vsplit_frontend {
    ushort identity_draw_elts[SEGMENT_SIZE];
 
    struct {
-      /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      /* map a fetch element to a draw element, entries are only valid
+       * when tagged with the current segment */
+      unsigned fetches[MAX_CACHE_SIZE];
+      ushort draws[MAX_CACHE_SIZE];
+      unsigned segments[MAX_CACHE_SIZE];
+      ubyte next_way[MAX_CACHE_SIZE / CACHE_WAYS];
+      unsigned set_mask;
+      unsigned segment;
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
@@ -67,8 +78,12 @@ struct vsplit_frontend {
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   /* Invalidate all entries by moving on to a new segment tag. */
+   if (++vsplit->cache.segment == 0) {
+      memset(vsplit->cache.segments, 0, sizeof(vsplit->cache.segments));
+      vsplit->cache.segment = 1;
+   }
+   memset(vsplit->cache.next_way, 0, vsplit->cache.set_mask + 1);
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -87,23 +102,40 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 static inline void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch)
 {
-   unsigned hash;
+   const unsigned set = fetch & vsplit->cache.set_mask;
+   const unsigned first = set * CACHE_WAYS;
+   unsigned slot = ~0u;
+   unsigned i;
+
+   for (i = first; i < first + CACHE_WAYS; i++) {
+      if (vsplit->cache.segments[i] != vsplit->cache.segment) {
+         if (slot == ~0u)
+            slot = i;
+      }
+      else if (vsplit->cache.fetches[i] == fetch) {
+         vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+            vsplit->cache.draws[i];
+         return;
+      }
+   }
 
-   hash = fetch % MAP_SIZE;
+   /* The set is full, replace its oldest entry. */
+   if (slot == ~0u) {
+      slot = first + vsplit->cache.next_way[set];
+      vsplit->cache.next_way[set] = (vsplit->cache.next_way[set] + 1) %
+                                    CACHE_WAYS;
+   }
 
-   /* If the value isn't in the cache or it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch) {
-      /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+   /* update cache */
+   vsplit->cache.fetches[slot] = fetch;
+   vsplit->cache.draws[slot] = vsplit->cache.num_fetch_elts;
+   vsplit->cache.segments[slot] = vsplit->cache.segment;
 
-      /* add fetch */
-      assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
-      vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
-   }
+   /* add fetch */
+   assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
+   vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
 
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[slot];
 }
 
 /**
@@ -125,12 +157,6 @@ vsplit_add_cache_ubyte(struct vsplit_frontend *vsplit, const ubyte *elts,
    unsigned elt_idx;
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* unlike the uint case this can only happen with elt_bias */
-   if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -142,12 +168,6 @@ vsplit_add_cache_ushort(struct vsplit_frontend *vsplit, const ushort *elts,
    unsigned elt_idx;
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* unlike the uint case this can only happen with elt_bias */
-   if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -167,13 +187,6 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
     */
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* Take care for DRAW_MAX_FETCH_IDX (since cache is initialized to -1). */
-   if (elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      /* force update - any value will do except DRAW_MAX_FETCH_IDX */
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -229,6 +242,13 @@ static void vsplit_prepare(struct draw_pt_front_end *frontend,
    middle->prepare(middle, vsplit->prim, opt, &vsplit->max_vertices);
 
    vsplit->segment_size = MIN2(SEGMENT_SIZE, vsplit->max_vertices);
+
+   /* Without the pipeline, the draw elements of a segment go straight to
+    * the render, which has its own limit.
+    */
+   if (!(opt & PT_PIPELINE) && vsplit->draw->render)
+      vsplit->segment_size = MIN2(vsplit->segment_size,
+                                  vsplit->draw->render->max_indices);
 }
 
 
@@ -252,6 +272,7 @@ static void vsplit_destroy(struct draw_pt_front_end *frontend)
 struct draw_pt_front_end *draw_pt_vsplit(struct draw_context *draw)
 {
    struct vsplit_frontend *vsplit = CALLOC_STRUCT(vsplit_frontend);
+   unsigned cache_size;
    ushort i;
 
    if (!vsplit)
@@ -266,5 +287,11 @@ struct draw_pt_front_end *draw_pt_vsplit(struct draw_context *draw)
    for (i = 0; i < SEGMENT_SIZE; i++)
       vsplit->identity_draw_elts[i] = i;
 
+   cache_size = debug_get_num_option("DRAW_VSPLIT_CACHE_SIZE",
+                                     DEFAULT_CACHE_SIZE);
+   cache_size = CLAMP(cache_size, CACHE_WAYS, MAX_CACHE_SIZE);
+   cache_size = 1 << util_logbase2(cache_size);
+   vsplit->cache.set_mask = cache_size / CACHE_WAYS - 1;
+
    return &vsplit->base;
 }
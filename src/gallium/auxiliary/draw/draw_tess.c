@@ -29,9 +29,12 @@
 
 #include "tessellator/p_tessellator.h"
 #include "nir/nir_to_tgsi_info.h"
+#include "util/hash_table.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_prim.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_queue.h"
 #include "util/ralloc.h"
 static inline int
 draw_tes_get_input_index(int semantic, int index,
@@ -313,6 +316,243 @@ llvm_tes_run(struct draw_tess_eval_shader *shader,
 }
 #endif
 
+#ifdef LLVM_AVAILABLE
+/* Tessellation results are cached per TES, since most patches of a draw
+ * (and of the following draws) usually have the same tess factors.
+ */
+#define TESS_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+/* Patches that miss the cache are tessellated on worker threads, in jobs of
+ * at least this many patches.
+ */
+#define TESS_MIN_PATCHES_PER_JOB 8
+#define TESS_MAX_THREADS 8
+
+struct draw_tess_result {
+   /* Only the factors the domain uses, the rest is zeroed. */
+   struct pipe_tessellation_factors key;
+   /* The arrays share one allocation, starting at indices. */
+   struct pipe_tessellator_data data;
+};
+
+struct tess_job {
+   struct draw_tess_eval_shader *shader;
+   struct draw_tess_result **results;
+   unsigned num_results;
+   struct util_queue_fence fence;
+};
+
+static uint32_t
+tess_key_hash(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(struct pipe_tessellation_factors));
+}
+
+static bool
+tess_key_equals(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct pipe_tessellation_factors)) == 0;
+}
+
+static void
+tess_result_destroy(struct hash_entry *entry)
+{
+   struct draw_tess_result *result = entry->data;
+
+   FREE(result->data.indices);
+   FREE(result);
+}
+
+static void
+tess_make_key(const struct draw_tess_eval_shader *shader,
+              const struct pipe_tessellation_factors *factors,
+              struct pipe_tessellation_factors *key)
+{
+   unsigned num_outer, num_inner;
+
+   switch (shader->prim_mode) {
+   case PIPE_PRIM_QUADS:
+      num_outer = 4;
+      num_inner = 2;
+      break;
+   case PIPE_PRIM_TRIANGLES:
+      num_outer = 3;
+      num_inner = 1;
+      break;
+   default:
+      num_outer = 2;
+      num_inner = 0;
+      break;
+   }
+
+   memset(key, 0, sizeof(*key));
+   memcpy(key->outer_tf, factors->outer_tf, num_outer * sizeof(float));
+   memcpy(key->inner_tf, factors->inner_tf, num_inner * sizeof(float));
+}
+
+static void
+tess_result_compute(struct pipe_tessellator *ptess,
+                    struct draw_tess_result *result)
+{
+   struct pipe_tessellator_data data = { 0 };
+   uint32_t *buf;
+
+   p_tessellate(ptess, &result->key, &data);
+
+   buf = MALLOC((data.num_indices + 2 * data.num_domain_points) *
+                sizeof(uint32_t));
+   if (!buf)
+      return;
+
+   result->data.num_indices = data.num_indices;
+   result->data.num_domain_points = data.num_domain_points;
+   result->data.indices = buf;
+   result->data.domain_points_u = (float *)(buf + data.num_indices);
+   result->data.domain_points_v =
+      result->data.domain_points_u + data.num_domain_points;
+
+   memcpy(result->data.indices, data.indices,
+          data.num_indices * sizeof(uint32_t));
+   memcpy(result->data.domain_points_u, data.domain_points_u,
+          data.num_domain_points * sizeof(float));
+   memcpy(result->data.domain_points_v, data.domain_points_v,
+          data.num_domain_points * sizeof(float));
+}
+
+static void
+tess_job_execute(void *data, int thread_index)
+{
+   struct tess_job *job = data;
+   struct draw_tess_eval_shader *shader = job->shader;
+   struct pipe_tessellator *ptess = p_tess_init(shader->prim_mode,
+                                                shader->spacing,
+                                                !shader->vertex_order_cw,
+                                                shader->point_mode);
+
+   for (unsigned i = 0; i < job->num_results; i++)
+      tess_result_compute(ptess, job->results[i]);
+
+   p_tess_destroy(ptess);
+}
+
+static struct util_queue *
+tess_get_queue(struct draw_context *draw)
+{
+   unsigned num_threads = MIN2(util_cpu_caps.nr_cpus, TESS_MAX_THREADS);
+
+   /* The drawing thread takes a share of the work too. */
+   if (num_threads < 2)
+      return NULL;
+
+   if (!draw->tes.queue) {
+      draw->tes.queue = CALLOC_STRUCT(util_queue);
+      if (!draw->tes.queue)
+         return NULL;
+
+      if (!util_queue_init(draw->tes.queue, "drawtess", TESS_MAX_THREADS,
+                           num_threads - 1, 0)) {
+         FREE(draw->tes.queue);
+         draw->tes.queue = NULL;
+      }
+   }
+   return draw->tes.queue;
+}
+
+/**
+ * Get the tessellation of each patch from the cache, computing the ones
+ * that are missing.  A NULL result means the patch is dropped.
+ */
+static void
+tess_patches(struct draw_tess_eval_shader *shader,
+             const struct pipe_tessellation_factors *factors,
+             unsigned num_patches,
+             struct draw_tess_result **results)
+{
+   struct draw_tess_result **misses;
+   struct tess_job jobs[TESS_MAX_THREADS];
+   struct util_queue *queue = NULL;
+   unsigned num_misses = 0, num_jobs;
+
+   if (!shader->tess_cache) {
+      shader->tess_cache = _mesa_hash_table_create(NULL, tess_key_hash,
+                                                   tess_key_equals);
+   } else if (shader->tess_cache_size > TESS_CACHE_MAX_SIZE) {
+      _mesa_hash_table_clear(shader->tess_cache, tess_result_destroy);
+      shader->tess_cache_size = 0;
+   }
+
+   misses = MALLOC(num_patches * sizeof(*misses));
+   if (!shader->tess_cache || !misses) {
+      FREE(misses);
+      memset(results, 0, num_patches * sizeof(*results));
+      return;
+   }
+
+   for (unsigned i = 0; i < num_patches; i++) {
+      struct pipe_tessellation_factors key;
+      struct hash_entry *entry;
+
+      tess_make_key(shader, &factors[i], &key);
+      entry = _mesa_hash_table_search(shader->tess_cache, &key);
+      if (entry) {
+         results[i] = entry->data;
+         continue;
+      }
+
+      results[i] = CALLOC_STRUCT(draw_tess_result);
+      if (!results[i])
+         continue;
+
+      results[i]->key = key;
+      _mesa_hash_table_insert(shader->tess_cache, &results[i]->key, results[i]);
+      misses[num_misses++] = results[i];
+   }
+
+   if (num_misses == 0) {
+      FREE(misses);
+      return;
+   }
+
+   num_jobs = MIN2(num_misses / TESS_MIN_PATCHES_PER_JOB, TESS_MAX_THREADS);
+   if (num_jobs > 1)
+      queue = tess_get_queue(shader->draw);
+   if (queue)
+      num_jobs = MIN2(num_jobs, queue->num_threads + 1);
+   else
+      num_jobs = 1;
+
+   for (unsigned j = 0; j < num_jobs; j++) {
+      unsigned start = num_misses * j / num_jobs;
+      unsigned end = num_misses * (j + 1) / num_jobs;
+
+      jobs[j].shader = shader;
+      jobs[j].results = misses + start;
+      jobs[j].num_results = end - start;
+
+      if (j > 0) {
+         util_queue_fence_init(&jobs[j].fence);
+         util_queue_add_job(queue, &jobs[j], &jobs[j].fence,
+                            tess_job_execute, NULL, 0);
+      }
+   }
+
+   tess_job_execute(&jobs[0], 0);
+
+   for (unsigned j = 1; j < num_jobs; j++) {
+      util_queue_fence_wait(&jobs[j].fence);
+      util_queue_fence_destroy(&jobs[j].fence);
+   }
+
+   for (unsigned i = 0; i < num_misses; i++) {
+      shader->tess_cache_size += sizeof(struct draw_tess_result) +
+         (misses[i]->data.num_indices +
+          2 * misses[i]->data.num_domain_points) * sizeof(uint32_t);
+   }
+
+   FREE(misses);
+}
+#endif
+
 /**
  * Execute tess eval shader.
  */
@@ -351,25 +591,33 @@ int draw_tess_eval_shader_run(struct draw_tess_eval_shader *shader,
    shader->input_info = input_info;
 
 #ifdef LLVM_AVAILABLE
-   struct pipe_tessellation_factors factors;
-   struct pipe_tessellator_data data = { 0 };
-   struct pipe_tessellator *ptess = p_tess_init(shader->prim_mode,
-                                                shader->spacing,
-                                                !shader->vertex_order_cw,
-                                                shader->point_mode);
-   for (unsigned i = 0; i < input_prim->primitive_count; i++) {
+   unsigned num_patches = input_prim->primitive_count;
+   struct pipe_tessellation_factors *factors =
+      MALLOC(num_patches * sizeof(*factors));
+   struct draw_tess_result **results = MALLOC(num_patches * sizeof(*results));
+
+   if (!factors || !results)
+      num_patches = 0;
+
+   /* Tessellate all the patches up front, so that it can be spread over
+    * several threads; the TES still runs here.
+    */
+   for (unsigned i = 0; i < num_patches; i++)
+      llvm_fetch_tess_factors(shader, i, num_input_vertices_per_patch, &factors[i]);
+
+   if (num_patches)
+      tess_patches(shader, factors, num_patches, results);
+
+   for (unsigned i = 0; i < num_patches; i++) {
       uint32_t vert_start = output_verts->count;
       uint32_t prim_start = output_prims->primitive_count;
       uint32_t elt_start = output_prims->count;
 
-      llvm_fetch_tess_factors(shader, i, num_input_vertices_per_patch, &factors);
-
-      /* tessellate with the factors for this primitive */
-      p_tessellate(ptess, &factors, &data);
-
-      if (data.num_domain_points == 0)
+      if (!results[i] || results[i]->data.num_domain_points == 0)
          continue;
 
+      struct pipe_tessellator_data data = results[i]->data;
+
       uint32_t old_verts = vert_start;
       uint32_t new_verts = vert_start + util_align_npot(data.num_domain_points, 4);
       uint32_t old_size = output_verts->vertex_size * old_verts;
@@ -389,7 +637,7 @@ int draw_tess_eval_shader_run(struct draw_tess_eval_shader *shader,
       /* run once per primitive? */
       char *output = (char *)output_verts->verts;
       output += vert_start * vertex_size;
-      llvm_tes_run(shader, i, num_input_vertices_per_patch, &data, &factors, (struct vertex_header *)output);
+      llvm_tes_run(shader, i, num_input_vertices_per_patch, &data, &factors[i], (struct vertex_header *)output);
 
       if (shader->draw->collect_statistics) {
          shader->draw->statistics.ds_invocations += data.num_domain_points;
@@ -403,7 +651,8 @@ int draw_tess_eval_shader_run(struct draw_tess_eval_shader *shader,
          output_prims->primitive_lengths[i] = prim_len;
       }
    }
-   p_tess_destroy(ptess);
+   FREE(factors);
+   FREE(results);
 #endif
 
    *elts_out = elts;
@@ -620,6 +869,9 @@ void draw_delete_tess_eval_shader(struct draw_context *draw,
       assert(shader->variants_cached == 0);
       align_free(dtes->tes_input);
    }
+
+   if (dtes->tess_cache)
+      _mesa_hash_table_destroy(dtes->tess_cache, tess_result_destroy);
 #endif
    if (dtes->state.ir.nir)
       ralloc_free(dtes->state.ir.nir);
@@ -30,6 +30,7 @@
 #include "draw_private.h"
 
 struct draw_context;
+struct hash_table;
 #ifdef LLVM_AVAILABLE
 
 #define NUM_PATCH_INPUTS 32
@@ -95,6 +96,10 @@ struct draw_tess_eval_shader {
    struct draw_tes_inputs *tes_input;
    struct draw_tes_jit_context *jit_context;
    struct draw_tes_llvm_variant *current_variant;
+
+   /* Tessellations by tess factors, see tess_patches() */
+   struct hash_table *tess_cache;
+   unsigned tess_cache_size;
 #endif
 };
 
@@ -30,10 +30,20 @@
  * @file
  * Trace dumping functions.
  *
- * For now we just use standard XML for dumping the trace calls, as this is
- * simple to write, parse, and visually inspect, but the actual representation
- * is abstracted out of this file, so that we can switch to a binary
- * representation if/when it becomes justified.
+ * By default we use standard XML for dumping the trace calls, as this is
+ * simple to write, parse, and visually inspect.
+ *
+ * With GALLIUM_TRACE_BINARY=true the same calls are encoded as a compact
+ * binary token stream instead, which is written out from a background
+ * thread, and large blobs are only hashed.  This keeps the overhead low
+ * enough to trace performance problems.  The binary format is:
+ *
+ *    header:  "GTRB" u32 version
+ *    token:   u8 opcode, followed by the payload of enum trace_bin_op
+ *
+ * with all integers in host byte order and strings as u32 length + bytes.
+ * src/gallium/tools/trace/tracebin2xml.py turns it back into the XML
+ * format, for trace.xsl and the other trace tools.
  *
  * @author Jose Fonseca <jfonseca@vmware.com>
  */
@@ -51,6 +61,8 @@
 #include "util/u_string.h"
 #include "util/u_math.h"
 #include "util/format/u_format.h"
+#include "util/u_queue.h"
+#include "util/xxhash.h"
 
 #include "tr_dump.h"
 #include "tr_screen.h"
@@ -63,6 +75,133 @@ static mtx_t call_mutex = _MTX_INITIALIZER_NP;
 static long unsigned call_no = 0;
 static bool dumping = false;
 
+#define TRACE_BIN_VERSION 1
+
+/* Binary blobs larger than this are written as size + hash only. */
+#define TRACE_BIN_MAX_INLINE_BYTES 256
+
+/* Size of the chunks handed over to the writer thread. */
+#define TRACE_BIN_CHUNK_SIZE (1024 * 1024)
+
+enum trace_bin_op {
+   TRACE_BIN_CALL_BEGIN = 1,  /* u32 no, string class, string method */
+   TRACE_BIN_CALL_END,        /* s64 time */
+   TRACE_BIN_ARG_BEGIN,       /* string name */
+   TRACE_BIN_ARG_END,
+   TRACE_BIN_RET_BEGIN,
+   TRACE_BIN_RET_END,
+   TRACE_BIN_BOOL,            /* u8 */
+   TRACE_BIN_INT,             /* s64 */
+   TRACE_BIN_UINT,            /* u64 */
+   TRACE_BIN_FLOAT,           /* f64 */
+   TRACE_BIN_BYTES,           /* u32 size, data */
+   TRACE_BIN_BYTES_HASH,      /* u64 size, u64 XXH64 of the data */
+   TRACE_BIN_STRING,          /* string */
+   TRACE_BIN_ENUM,            /* string */
+   TRACE_BIN_ARRAY_BEGIN,
+   TRACE_BIN_ARRAY_END,
+   TRACE_BIN_ELEM_BEGIN,
+   TRACE_BIN_ELEM_END,
+   TRACE_BIN_STRUCT_BEGIN,    /* string name */
+   TRACE_BIN_STRUCT_END,
+   TRACE_BIN_MEMBER_BEGIN,    /* string name */
+   TRACE_BIN_MEMBER_END,
+   TRACE_BIN_NULL,
+   TRACE_BIN_PTR,             /* u64 */
+};
+
+struct trace_bin_chunk {
+   struct util_queue_fence fence;
+   size_t size;
+   char data[TRACE_BIN_CHUNK_SIZE];
+};
+
+static bool binary = false;
+static struct util_queue write_queue;
+static struct trace_bin_chunk *chunk = NULL;
+
+
+static void
+trace_bin_chunk_write(void *job, int thread_index)
+{
+   struct trace_bin_chunk *c = job;
+
+   fwrite(c->data, c->size, 1, stream);
+}
+
+
+static void
+trace_bin_chunk_free(void *job, int thread_index)
+{
+   struct trace_bin_chunk *c = job;
+
+   util_queue_fence_destroy(&c->fence);
+   FREE(c);
+}
+
+
+static void
+trace_bin_submit(void)
+{
+   if (chunk->size) {
+      util_queue_fence_init(&chunk->fence);
+      util_queue_add_job(&write_queue, chunk, &chunk->fence,
+                         trace_bin_chunk_write, trace_bin_chunk_free, 0);
+      chunk = MALLOC_STRUCT(trace_bin_chunk);
+      chunk->size = 0;
+   }
+}
+
+
+static void
+trace_bin_write(const void *data, size_t size)
+{
+   const char *p = data;
+
+   while (size) {
+      size_t n = MIN2(size, sizeof(chunk->data) - chunk->size);
+
+      memcpy(chunk->data + chunk->size, p, n);
+      chunk->size += n;
+      p += n;
+      size -= n;
+
+      if (chunk->size == sizeof(chunk->data))
+         trace_bin_submit();
+   }
+}
+
+
+static inline void
+trace_bin_op(enum trace_bin_op op)
+{
+   uint8_t v = op;
+   trace_bin_write(&v, sizeof(v));
+}
+
+
+static inline void
+trace_bin_u32(uint32_t v)
+{
+   trace_bin_write(&v, sizeof(v));
+}
+
+
+static inline void
+trace_bin_u64(uint64_t v)
+{
+   trace_bin_write(&v, sizeof(v));
+}
+
+
+static inline void
+trace_bin_string(const char *str)
+{
+   uint32_t len = strlen(str);
+   trace_bin_u32(len);
+   trace_bin_write(str, len);
+}
+
 
 static inline void
 trace_dump_write(const char *buf, size_t size)
@@ -166,7 +305,10 @@ trace_dump_tag_end(const char *name)
 void
 trace_dump_trace_flush(void)
 {
-   if (stream) {
+   /* In binary mode, the trace is only written out once a chunk is full
+    * (or at exit), so that tracing doesn't block on the file.
+    */
+   if (stream && !binary) {
       fflush(stream);
    }
 }
@@ -175,7 +317,16 @@ static void
 trace_dump_trace_close(void)
 {
    if (stream) {
-      trace_dump_writes("</trace>\n");
+      if (binary) {
+         trace_bin_submit();
+         util_queue_finish(&write_queue);
+         util_queue_destroy(&write_queue);
+         FREE(chunk);
+         chunk = NULL;
+         binary = false;
+      } else {
+         trace_dump_writes("</trace>\n");
+      }
       if (close_stream) {
          fclose(stream);
          close_stream = false;
@@ -189,7 +340,10 @@ trace_dump_trace_close(void)
 static void
 trace_dump_call_time(int64_t time)
 {
-   if (stream) {
+   if (binary) {
+      trace_bin_op(TRACE_BIN_CALL_END);
+      trace_bin_u64(time);
+   } else if (stream) {
       trace_dump_indent(2);
       trace_dump_tag_begin("time");
       trace_dump_int(time);
@@ -209,6 +363,7 @@ trace_dump_trace_begin(void)
       return false;
 
    if (!stream) {
+      bool want_binary = debug_get_bool_option("GALLIUM_TRACE_BINARY", false);
 
       if (strcmp(filename, "stderr") == 0) {
          close_stream = false;
@@ -220,14 +375,33 @@ trace_dump_trace_begin(void)
       }
       else {
          close_stream = true;
-         stream = fopen(filename, "wt");
+         stream = fopen(filename, want_binary ? "wb" : "wt");
          if (!stream)
             return false;
       }
 
-      trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
-      trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
-      trace_dump_writes("<trace version='0.1'>\n");
+      if (want_binary) {
+         chunk = MALLOC_STRUCT(trace_bin_chunk);
+         if (chunk &&
+             util_queue_init(&write_queue, "gtrace", 64, 1, 0)) {
+            binary = true;
+            chunk->size = 0;
+         } else {
+            FREE(chunk);
+            chunk = NULL;
+         }
+      }
+
+      if (binary) {
+         static const uint32_t version = TRACE_BIN_VERSION;
+
+         trace_bin_write("GTRB", 4);
+         trace_bin_write(&version, sizeof(version));
+      } else {
+         trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
+         trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
+         trace_dump_writes("<trace version='0.1'>\n");
+      }
 
       /* Many applications don't exit cleanly, others may create and destroy a
        * screen multiple times, so we only write </trace> tag and close at exit
@@ -312,6 +486,16 @@ void trace_dump_call_begin_locked(const char *klass, const char *method)
       return;
 
    ++call_no;
+
+   if (binary) {
+      trace_bin_op(TRACE_BIN_CALL_BEGIN);
+      trace_bin_u32(call_no);
+      trace_bin_string(klass);
+      trace_bin_string(method);
+      call_start_time = os_time_get();
+      return;
+   }
+
    trace_dump_indent(1);
    trace_dump_writes("<call no=\'");
    trace_dump_writef("%lu", call_no);
@@ -335,6 +519,9 @@ void trace_dump_call_end_locked(void)
    call_end_time = os_time_get();
 
    trace_dump_call_time(call_end_time - call_start_time);
+   if (binary)
+      return;
+
    trace_dump_indent(1);
    trace_dump_tag_end("call");
    trace_dump_newline();
@@ -358,6 +545,12 @@ void trace_dump_arg_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_ARG_BEGIN);
+      trace_bin_string(name);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin1("arg", "name", name);
 }
@@ -367,6 +560,11 @@ void trace_dump_arg_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_ARG_END);
+      return;
+   }
+
    trace_dump_tag_end("arg");
    trace_dump_newline();
 }
@@ -376,6 +574,11 @@ void trace_dump_ret_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_RET_BEGIN);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin("ret");
 }
@@ -385,6 +588,11 @@ void trace_dump_ret_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_RET_END);
+      return;
+   }
+
    trace_dump_tag_end("ret");
    trace_dump_newline();
 }
@@ -394,6 +602,13 @@ void trace_dump_bool(int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_BOOL);
+      uint8_t v = !!value;
+      trace_bin_write(&v, sizeof(v));
+      return;
+   }
+
    trace_dump_writef("<bool>%c</bool>", value ? '1' : '0');
 }
 
@@ -402,6 +617,12 @@ void trace_dump_int(long long int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_INT);
+      trace_bin_u64(value);
+      return;
+   }
+
    trace_dump_writef("<int>%lli</int>", value);
 }
 
@@ -410,6 +631,12 @@ void trace_dump_uint(long long unsigned value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_UINT);
+      trace_bin_u64(value);
+      return;
+   }
+
    trace_dump_writef("<uint>%llu</uint>", value);
 }
 
@@ -418,6 +645,12 @@ void trace_dump_float(double value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_FLOAT);
+      trace_bin_write(&value, sizeof(value));
+      return;
+   }
+
    trace_dump_writef("<float>%g</float>", value);
 }
 
@@ -431,6 +664,19 @@ void trace_dump_bytes(const void *data,
    if (!dumping)
       return;
 
+   if (binary) {
+      if (size <= TRACE_BIN_MAX_INLINE_BYTES) {
+         trace_bin_op(TRACE_BIN_BYTES);
+         trace_bin_u32(size);
+         trace_bin_write(data, size);
+      } else {
+         trace_bin_op(TRACE_BIN_BYTES_HASH);
+         trace_bin_u64(size);
+         trace_bin_u64(XXH64(data, size, 0));
+      }
+      return;
+   }
+
    trace_dump_writes("<bytes>");
    for(i = 0; i < size; ++i) {
       uint8_t byte = *p++;
@@ -459,10 +705,11 @@ void trace_dump_box_bytes(const void *data,
         +                                  (box->depth   - 1) * slice_stride;
 
    /*
-    * Only dump buffer transfers to avoid huge files.
+    * Only dump buffer transfers to avoid huge files.  The binary format
+    * only stores a hash of large blobs, so it can afford textures too.
     * TODO: Make this run-time configurable
     */
-   if (resource->target != PIPE_BUFFER) {
+   if (resource->target != PIPE_BUFFER && !binary) {
       size = 0;
    }
 
@@ -474,6 +721,12 @@ void trace_dump_string(const char *str)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_STRING);
+      trace_bin_string(str);
+      return;
+   }
+
    trace_dump_writes("<string>");
    trace_dump_escape(str);
    trace_dump_writes("</string>");
@@ -484,6 +737,12 @@ void trace_dump_enum(const char *value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_ENUM);
+      trace_bin_string(value);
+      return;
+   }
+
    trace_dump_writes("<enum>");
    trace_dump_escape(value);
    trace_dump_writes("</enum>");
@@ -494,6 +753,11 @@ void trace_dump_array_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_ARRAY_BEGIN);
+      return;
+   }
+
    trace_dump_writes("<array>");
 }
 
@@ -502,6 +766,11 @@ void trace_dump_array_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_ARRAY_END);
+      return;
+   }
+
    trace_dump_writes("</array>");
 }
 
@@ -510,6 +779,11 @@ void trace_dump_elem_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_ELEM_BEGIN);
+      return;
+   }
+
    trace_dump_writes("<elem>");
 }
 
@@ -518,6 +792,11 @@ void trace_dump_elem_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_ELEM_END);
+      return;
+   }
+
    trace_dump_writes("</elem>");
 }
 
@@ -526,6 +805,12 @@ void trace_dump_struct_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_STRUCT_BEGIN);
+      trace_bin_string(name);
+      return;
+   }
+
    trace_dump_writef("<struct name='%s'>", name);
 }
 
@@ -534,6 +819,11 @@ void trace_dump_struct_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_STRUCT_END);
+      return;
+   }
+
    trace_dump_writes("</struct>");
 }
 
@@ -542,6 +832,12 @@ void trace_dump_member_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_MEMBER_BEGIN);
+      trace_bin_string(name);
+      return;
+   }
+
    trace_dump_writef("<member name='%s'>", name);
 }
 
@@ -550,6 +846,11 @@ void trace_dump_member_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_MEMBER_END);
+      return;
+   }
+
    trace_dump_writes("</member>");
 }
 
@@ -558,6 +859,11 @@ void trace_dump_null(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_NULL);
+      return;
+   }
+
    trace_dump_writes("<null/>");
 }
 
@@ -566,6 +872,16 @@ void trace_dump_ptr(const void *value)
    if (!dumping)
       return;
 
+   if (binary) {
+      if (value) {
+         trace_bin_op(TRACE_BIN_PTR);
+         trace_bin_u64((uintptr_t)value);
+      } else {
+         trace_bin_op(TRACE_BIN_NULL);
+      }
+      return;
+   }
+
    if(value)
       trace_dump_writef("<ptr>0x%08lx</ptr>", (unsigned long)(uintptr_t)value);
    else
@@ -87,4 +87,9 @@
 #define GALLIVM_HAVE_CORO 0
 #endif
 
+/* Set by the build when gallivm should JIT through ORC instead of MCJIT */
+#ifndef GALLIVM_USE_ORCJIT
+#define GALLIVM_USE_ORCJIT 0
+#endif
+
 #endif /* LP_BLD_H */
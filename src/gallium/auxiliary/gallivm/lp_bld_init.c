@@ -146,7 +146,7 @@ create_pass_manager(struct gallivm_state *gallivm)
    LLVMAddCoroElidePass(gallivm->cgpassmgr);
 #endif
 
-   if ((gallivm_perf & GALLIVM_PERF_NO_OPT) == 0) {
+   if ((gallivm_perf & GALLIVM_PERF_NO_OPT) == 0 && !gallivm->no_opt) {
       /*
        * TODO: Evaluate passes some more - keeping in mind
        * both quality of generated code and compile times.
@@ -263,13 +263,20 @@ init_gallivm_engine(struct gallivm_state *gallivm)
       char *error = NULL;
       int ret;
 
-      if (gallivm_perf & GALLIVM_PERF_NO_OPT) {
+      if ((gallivm_perf & GALLIVM_PERF_NO_OPT) || gallivm->no_opt) {
          optlevel = None;
       }
       else {
          optlevel = Default;
       }
 
+#if GALLIVM_USE_ORCJIT
+      ret = lp_build_orc_compile_module(&gallivm->code,
+                                        gallivm->cache,
+                                        gallivm->module,
+                                        (unsigned) optlevel,
+                                        &error);
+#else
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     &gallivm->code,
                                                     gallivm->cache,
@@ -277,6 +284,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
                                                     gallivm->memorymgr,
                                                     (unsigned) optlevel,
                                                     &error);
+#endif
       if (ret) {
          _debug_printf("%s\n", error);
          LLVMDisposeMessage(error);
@@ -284,7 +292,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
       }
    }
 
-   if (0) {
+   if (0 && gallivm->engine) {
        /*
         * Dump the data layout strings.
         */
@@ -349,9 +357,11 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
    if (!gallivm->builder)
       goto fail;
 
+#if !GALLIVM_USE_ORCJIT
    gallivm->memorymgr = lp_get_default_memory_manager();
    if (!gallivm->memorymgr)
       goto fail;
+#endif
 
    /* FIXME: MC-JIT only allows compiling one module at a time, and it must be
     * complete when MC-JIT is created. So defer the MC-JIT engine creation for
@@ -452,6 +462,10 @@ lp_build_init(void)
       lp_native_vector_width = 128;
    }
 
+   /*
+    * 512 bits is opt-in even with AVX-512, since the wider units downclock
+    * many parts; llvmpipe then shades 16 pixels per fragment shader loop.
+    */
    lp_native_vector_width = debug_get_num_option("LP_NATIVE_VECTOR_WIDTH",
                                                  lp_native_vector_width);
 
@@ -522,6 +536,33 @@ gallivm_create(const char *name, LLVMContextRef context,
 }
 
 
+/**
+ * Compile this module without optimization passes and with the lowest
+ * codegen optimization level, like GALLIVM_PERF=nopt does globally.  Must be
+ * called before any IR is generated.
+ */
+boolean
+gallivm_disable_optimizations(struct gallivm_state *gallivm)
+{
+   assert(!gallivm->compiled);
+
+   if (gallivm->passmgr) {
+      LLVMDisposePassManager(gallivm->passmgr);
+      gallivm->passmgr = NULL;
+   }
+#if GALLIVM_HAVE_CORO
+   if (gallivm->cgpassmgr) {
+      LLVMDisposePassManager(gallivm->cgpassmgr);
+      gallivm->cgpassmgr = NULL;
+   }
+#endif
+
+   gallivm->no_opt = TRUE;
+
+   return create_pass_manager(gallivm);
+}
+
+
 /**
  * Destroy a gallivm_state object.
  */
@@ -559,6 +600,35 @@ gallivm_verify_function(struct gallivm_state *gallivm,
 }
 
 
+static void *
+get_function_address(struct gallivm_state *gallivm, LLVMValueRef func)
+{
+#if GALLIVM_USE_ORCJIT
+   return lp_build_orc_get_function(gallivm->code, LLVMGetValueName(func));
+#else
+   return LLVMGetPointerToGlobal(gallivm->engine, func);
+#endif
+}
+
+
+/**
+ * Resolve references to a global (typically a function declared in the
+ * module) of a compiled module to the given address.  Must be done before
+ * any function of the module is jitted.
+ */
+void
+gallivm_add_global_mapping(struct gallivm_state *gallivm, LLVMValueRef global,
+                           void *addr)
+{
+   assert(gallivm->compiled);
+#if GALLIVM_USE_ORCJIT
+   lp_build_orc_add_symbol(gallivm->code, LLVMGetValueName(global), addr);
+#else
+   LLVMAddGlobalMapping(gallivm->engine, global, addr);
+#endif
+}
+
+
 /**
  * Compile a module.
  * This does IR optimization on all functions in the module.
@@ -653,12 +723,13 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    if (!init_gallivm_engine(gallivm)) {
       assert(0);
    }
-   assert(gallivm->engine);
+   assert(gallivm->code);
 
    ++gallivm->compiled;
 
    if (gallivm->debug_printf_hook)
-      LLVMAddGlobalMapping(gallivm->engine, gallivm->debug_printf_hook, debug_printf);
+      gallivm_add_global_mapping(gallivm, gallivm->debug_printf_hook,
+                                 (void *)debug_printf);
 
    if (gallivm_debug & GALLIVM_DEBUG_ASM) {
       LLVMValueRef llvm_func = LLVMGetFirstFunction(gallivm->module);
@@ -670,7 +741,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
           * LLVMGetPointerToGlobal() will abort otherwise.
           */
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
+            void *func_code = get_function_address(gallivm, llvm_func);
             lp_disassemble(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
@@ -683,7 +754,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 
       while (llvm_func) {
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
+            void *func_code = get_function_address(gallivm, llvm_func);
             lp_profile(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
@@ -703,12 +774,12 @@ gallivm_jit_function(struct gallivm_state *gallivm,
    int64_t time_begin = 0;
 
    assert(gallivm->compiled);
-   assert(gallivm->engine);
+   assert(gallivm->code);
 
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
-   code = LLVMGetPointerToGlobal(gallivm->engine, func);
+   code = get_function_address(gallivm, func);
    assert(code);
    jit_func = pointer_to_func(code);
 
@@ -54,6 +54,7 @@ struct gallivm_state
    struct lp_generated_code *code;
    struct lp_cached_code *cache;
    unsigned compiled;
+   boolean no_opt;
    LLVMValueRef coro_malloc_hook;
    LLVMValueRef coro_free_hook;
    LLVMValueRef debug_printf_hook;
@@ -68,6 +69,9 @@ struct gallivm_state *
 gallivm_create(const char *name, LLVMContextRef context,
                struct lp_cached_code *cache);
 
+boolean
+gallivm_disable_optimizations(struct gallivm_state *gallivm);
+
 void
 gallivm_destroy(struct gallivm_state *gallivm);
 
@@ -81,6 +85,10 @@ gallivm_verify_function(struct gallivm_state *gallivm,
 void
 gallivm_compile_module(struct gallivm_state *gallivm);
 
+void
+gallivm_add_global_mapping(struct gallivm_state *gallivm, LLVMValueRef global,
+                           void *addr);
+
 func_pointer
 gallivm_jit_function(struct gallivm_state *gallivm,
                      LLVMValueRef func);
@@ -41,6 +41,8 @@
 
 
 #include <stddef.h>
+#include <string.h>
+#include <atomic>
 
 #include <llvm/Config/llvm-config.h>
 
@@ -72,6 +74,14 @@
 #include <llvm/IR/Module.h>
 #include <llvm/Support/CBindingWrapping.h>
 
+#if GALLIVM_USE_ORCJIT
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/Target/TargetMachine.h>
+#endif
+
 #include <llvm/Config/llvm-config.h>
 #if LLVM_USE_INTEL_JITEVENTS
 #include <llvm/ExecutionEngine/JITEventListener.h>
@@ -321,61 +331,13 @@ public:
 };
 
 /**
- * Same as LLVMCreateJITCompilerForModule, but:
- * - allows using MCJIT and enabling AVX feature where available.
- * - set target options
- *
- * See also:
- * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
- * - llvm/tools/lli/lli.cpp
- * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ * Pick the -mcpu and -mattr options generated code is built with.
  */
-extern "C"
-LLVMBool
-lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
-                                        lp_generated_code **OutCode,
-                                        struct lp_cached_code *cache_out,
-                                        LLVMModuleRef M,
-                                        LLVMMCJITMemoryManagerRef CMM,
-                                        unsigned OptLevel,
-                                        char **OutError)
+static void
+get_host_target(std::string &MCPU, llvm::SmallVector<std::string, 16> &MAttrs)
 {
    using namespace llvm;
 
-   std::string Error;
-   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
-
-   /**
-    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
-    * friends for configuring code generation options, like stack alignment.
-    */
-   TargetOptions options;
-#if defined(PIPE_ARCH_X86)
-   options.StackAlignmentOverride = 4;
-#endif
-
-   builder.setEngineKind(EngineKind::JIT)
-          .setErrorStr(&Error)
-          .setTargetOptions(options)
-          .setOptLevel((CodeGenOpt::Level)OptLevel);
-
-#ifdef _WIN32
-    /*
-     * MCJIT works on Windows, but currently only through ELF object format.
-     *
-     * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
-     * different strings for MinGW/MSVC, so better play it safe and be
-     * explicit.
-     */
-#  ifdef _WIN64
-    LLVMSetTarget(M, "x86_64-pc-win32-elf");
-#  else
-    LLVMSetTarget(M, "i686-pc-win32-elf");
-#  endif
-#endif
-
-   llvm::SmallVector<std::string, 16> MAttrs;
-
 #if LLVM_VERSION_MAJOR >= 4 && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64) || defined(PIPE_ARCH_ARM))
    /* llvm-3.3+ implements sys::getHostCPUFeatures for Arm
     * and llvm-3.7+ for x86, which allows us to enable/disable
@@ -464,8 +426,6 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 #endif
 #endif
 
-   builder.setMAttrs(MAttrs);
-
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
       int n = MAttrs.size();
       if (n > 0) {
@@ -476,7 +436,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       }
    }
 
-   StringRef MCPU = llvm::sys::getHostCPUName();
+   MCPU = llvm::sys::getHostCPUName().str();
    /*
     * The cpu bits are no longer set automatically, so need to set mcpu manually.
     * Note that the MAttrs set above will be sort of ignored (since we should
@@ -490,19 +450,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
     * can't handle. Not entirely sure if we really need to do anything yet.
     */
 
-#ifdef PIPE_ARCH_PPC_64
-   /*
-    * Large programs, e.g. gnome-shell and firefox, may tax the addressability
-    * of the Medium code model once dynamically generated JIT-compiled shader
-    * programs are linked in and relocated.  Yet the default code model as of
-    * LLVM 8 is Medium or even Small.
-    * The cost of changing from Medium to Large is negligible:
-    * - an additional 8-byte pointer stored immediately before the shader entrypoint;
-    * - change an add-immediate (addis) instruction to a load (ld).
-    */
-   builder.setCodeModel(CodeModel::Large);
-
-#if UTIL_ARCH_LITTLE_ENDIAN
+#if defined(PIPE_ARCH_PPC_64) && UTIL_ARCH_LITTLE_ENDIAN
    /*
     * Versions of LLVM prior to 4.0 lacked a table entry for "POWER8NVL",
     * resulting in (big-endian) "generic" being returned on
@@ -515,11 +463,84 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    if (MCPU == "generic")
       MCPU = "pwr8";
 #endif
-#endif
-   builder.setMCPU(MCPU);
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
-      debug_printf("llc -mcpu option: %s\n", MCPU.str().c_str());
+      debug_printf("llc -mcpu option: %s\n", MCPU.c_str());
    }
+}
+
+
+/**
+ * Same as LLVMCreateJITCompilerForModule, but:
+ * - allows using MCJIT and enabling AVX feature where available.
+ * - set target options
+ *
+ * See also:
+ * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
+ * - llvm/tools/lli/lli.cpp
+ * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ */
+extern "C"
+LLVMBool
+lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
+                                        lp_generated_code **OutCode,
+                                        struct lp_cached_code *cache_out,
+                                        LLVMModuleRef M,
+                                        LLVMMCJITMemoryManagerRef CMM,
+                                        unsigned OptLevel,
+                                        char **OutError)
+{
+   using namespace llvm;
+
+   std::string Error;
+   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
+
+   /**
+    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
+    * friends for configuring code generation options, like stack alignment.
+    */
+   TargetOptions options;
+#if defined(PIPE_ARCH_X86)
+   options.StackAlignmentOverride = 4;
+#endif
+
+   builder.setEngineKind(EngineKind::JIT)
+          .setErrorStr(&Error)
+          .setTargetOptions(options)
+          .setOptLevel((CodeGenOpt::Level)OptLevel);
+
+#ifdef _WIN32
+    /*
+     * MCJIT works on Windows, but currently only through ELF object format.
+     *
+     * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
+     * different strings for MinGW/MSVC, so better play it safe and be
+     * explicit.
+     */
+#  ifdef _WIN64
+    LLVMSetTarget(M, "x86_64-pc-win32-elf");
+#  else
+    LLVMSetTarget(M, "i686-pc-win32-elf");
+#  endif
+#endif
+
+   std::string MCPU;
+   llvm::SmallVector<std::string, 16> MAttrs;
+   get_host_target(MCPU, MAttrs);
+   builder.setMAttrs(MAttrs);
+   builder.setMCPU(MCPU);
+
+#ifdef PIPE_ARCH_PPC_64
+   /*
+    * Large programs, e.g. gnome-shell and firefox, may tax the addressability
+    * of the Medium code model once dynamically generated JIT-compiled shader
+    * programs are linked in and relocated.  Yet the default code model as of
+    * LLVM 8 is Medium or even Small.
+    * The cost of changing from Medium to Large is negligible:
+    * - an additional 8-byte pointer stored immediately before the shader entrypoint;
+    * - change an add-immediate (addis) instruction to a load (ld).
+    */
+   builder.setCodeModel(CodeModel::Large);
+#endif
 
    ShaderMemoryManager *MM = NULL;
    BaseMemoryManager* JMM = reinterpret_cast<BaseMemoryManager*>(CMM);
@@ -547,7 +568,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       *OutJIT = wrap(JIT);
       return 0;
    }
-   lp_free_generated_code(*OutCode);
+   ShaderMemoryManager::freeGeneratedCode(*OutCode);
    *OutCode = 0;
    delete MM;
    *OutError = strdup(Error.c_str());
@@ -555,11 +576,207 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 }
 
 
+
+#if GALLIVM_USE_ORCJIT
+
+/*
+ * ORC backend.  A single LLJIT session is shared by every gallivm module in
+ * the process.  Modules are compiled to object files on the calling thread,
+ * each with a TargetMachine of its own, so several threads can compile at
+ * once.  Every module is then linked into its own JITDylib, which is removed
+ * again, together with the code and data memory, when the generated code is
+ * freed.
+ */
+
+struct OrcGeneratedCode {
+   llvm::orc::JITDylib *JD;
+};
+
+static once_flag orc_jit_once_flag = ONCE_FLAG_INIT;
+static llvm::orc::LLJIT *orc_jit;
+static llvm::orc::JITTargetMachineBuilder *orc_jtmb;
+static std::atomic<unsigned> orc_dylib_count;
+
+
+static LLVMBool
+orc_error(llvm::Error Err, char **OutError)
+{
+   *OutError = strdup(llvm::toString(std::move(Err)).c_str());
+   return 1;
+}
+
+
+static void
+create_orc_jit()
+{
+   using namespace llvm;
+   using namespace llvm::orc;
+
+#ifdef _WIN32
+   /* See lp_build_create_jit_compiler_for_module() */
+#  ifdef _WIN64
+   Triple T("x86_64-pc-win32-elf");
+#  else
+   Triple T("i686-pc-win32-elf");
+#  endif
+#else
+   Triple T(sys::getProcessTriple());
+#endif
+   orc_jtmb = new JITTargetMachineBuilder(T);
+
+   std::string MCPU;
+   SmallVector<std::string, 16> MAttrs;
+   get_host_target(MCPU, MAttrs);
+   orc_jtmb->setCPU(MCPU);
+   orc_jtmb->addFeatures(std::vector<std::string>(MAttrs.begin(), MAttrs.end()));
+
+#if defined(PIPE_ARCH_X86)
+   orc_jtmb->getOptions().StackAlignmentOverride = 4;
+#endif
+#ifdef PIPE_ARCH_PPC_64
+   orc_jtmb->setCodeModel(CodeModel::Large);
+#endif
+
+   auto J = LLJITBuilder().setJITTargetMachineBuilder(*orc_jtmb).create();
+   if (!J) {
+      _debug_printf("gallivm: failed to create the JIT: %s\n",
+                    toString(J.takeError()).c_str());
+      return;
+   }
+   orc_jit = J->release();
+
+   /* Resolve libm/libc calls emitted by the backend */
+   auto Generator = DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      orc_jit->getDataLayout().getGlobalPrefix());
+   if (Generator)
+      orc_jit->getMainJITDylib().addGenerator(std::move(*Generator));
+   else
+      consumeError(Generator.takeError());
+}
+
+
+/**
+ * Compile a module and link the result into the shared JIT session.
+ * The module is not consumed; the caller still owns and has to free it.
+ * If cache_out already holds an object file it is linked in instead of
+ * compiling the module, otherwise the new object file is stored there.
+ */
+extern "C"
+LLVMBool
+lp_build_orc_compile_module(struct lp_generated_code **OutCode,
+                            struct lp_cached_code *cache_out,
+                            LLVMModuleRef M,
+                            unsigned OptLevel,
+                            char **OutError)
+{
+   using namespace llvm;
+   using namespace llvm::orc;
+
+   call_once(&orc_jit_once_flag, create_orc_jit);
+   if (!orc_jit) {
+      *OutError = strdup("no JIT session");
+      return 1;
+   }
+
+   std::unique_ptr<MemoryBuffer> Obj;
+   if (cache_out && cache_out->data_size) {
+      Obj = MemoryBuffer::getMemBufferCopy(
+         StringRef((const char *)cache_out->data, cache_out->data_size));
+   } else {
+      JITTargetMachineBuilder JTMB(*orc_jtmb);
+      JTMB.setCodeGenOptLevel((CodeGenOpt::Level)OptLevel);
+      auto TM = JTMB.createTargetMachine();
+      if (!TM)
+         return orc_error(TM.takeError(), OutError);
+
+      Module *Mod = unwrap(M);
+      Mod->setDataLayout((*TM)->createDataLayout());
+      Mod->setTargetTriple((*TM)->getTargetTriple().str());
+
+      auto Compiled = SimpleCompiler(**TM)(*Mod);
+      if (!Compiled)
+         return orc_error(Compiled.takeError(), OutError);
+      Obj = std::move(*Compiled);
+
+      if (cache_out) {
+         cache_out->data_size = Obj->getBufferSize();
+         cache_out->data = malloc(cache_out->data_size);
+         memcpy(cache_out->data, Obj->getBufferStart(), cache_out->data_size);
+      }
+   }
+
+   ExecutionSession &ES = orc_jit->getExecutionSession();
+   std::string Name = "gallivm" + std::to_string(orc_dylib_count++);
+   JITDylib &JD = ES.createBareJITDylib(Name);
+   JD.addToLinkOrder(orc_jit->getMainJITDylib());
+
+   if (Error Err = orc_jit->addObjectFile(JD, std::move(Obj))) {
+      cantFail(ES.removeJITDylib(JD));
+      return orc_error(std::move(Err), OutError);
+   }
+
+   OrcGeneratedCode *code = new OrcGeneratedCode;
+   code->JD = &JD;
+   *OutCode = (struct lp_generated_code *)code;
+   return 0;
+}
+
+
+/**
+ * Make a symbol referenced by the module resolve to the given address.
+ * Must be called before any function of the module is looked up.
+ */
+extern "C"
+void
+lp_build_orc_add_symbol(struct lp_generated_code *code, const char *name,
+                        void *addr)
+{
+   using namespace llvm;
+   using namespace llvm::orc;
+
+   OrcGeneratedCode *orc_code = (OrcGeneratedCode *)code;
+   SymbolMap Symbols;
+   Symbols[orc_jit->mangleAndIntern(name)] =
+      JITEvaluatedSymbol(pointerToJITTargetAddress(addr),
+                         JITSymbolFlags::Exported);
+   cantFail(orc_code->JD->define(absoluteSymbols(std::move(Symbols))));
+}
+
+
+extern "C"
+void *
+lp_build_orc_get_function(struct lp_generated_code *code, const char *name)
+{
+   OrcGeneratedCode *orc_code = (OrcGeneratedCode *)code;
+
+   auto Sym = orc_jit->lookup(*orc_code->JD, name);
+   if (!Sym) {
+      _debug_printf("gallivm: %s\n", llvm::toString(Sym.takeError()).c_str());
+      return NULL;
+   }
+#if LLVM_VERSION_MAJOR >= 15
+   return Sym->toPtr<void *>();
+#else
+   return llvm::jitTargetAddressToPointer<void *>(Sym->getAddress());
+#endif
+}
+
+#endif /* GALLIVM_USE_ORCJIT */
+
+
 extern "C"
 void
 lp_free_generated_code(struct lp_generated_code *code)
 {
+#if GALLIVM_USE_ORCJIT
+   OrcGeneratedCode *orc_code = (OrcGeneratedCode *)code;
+   if (!orc_code)
+      return;
+   cantFail(orc_jit->getExecutionSession().removeJITDylib(*orc_code->JD));
+   delete orc_code;
+#else
    ShaderMemoryManager::freeGeneratedCode(code);
+#endif
 }
 
 extern "C"
@@ -585,6 +802,16 @@ lp_free_objcache(void *objcache_ptr)
    delete objcache;
 }
 
+/**
+ * Name of the CPU generated code is tuned for, as passed to -mcpu.
+ * The caller has to free() the returned string.
+ */
+extern "C" char *
+lp_build_host_cpu_name(void)
+{
+   return strdup(llvm::sys::getHostCPUName().str().c_str());
+}
+
 extern "C" LLVMValueRef
 lp_get_called_value(LLVMValueRef call)
 {
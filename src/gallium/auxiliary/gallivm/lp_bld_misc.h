@@ -74,6 +74,22 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         unsigned OptLevel,
                                         char **OutError);
 
+#if GALLIVM_USE_ORCJIT
+extern int
+lp_build_orc_compile_module(struct lp_generated_code **OutCode,
+                            struct lp_cached_code *cache_out,
+                            LLVMModuleRef M,
+                            unsigned OptLevel,
+                            char **OutError);
+
+extern void
+lp_build_orc_add_symbol(struct lp_generated_code *code, const char *name,
+                        void *addr);
+
+extern void *
+lp_build_orc_get_function(struct lp_generated_code *code, const char *name);
+#endif
+
 extern void
 lp_free_generated_code(struct lp_generated_code *code);
 
@@ -91,6 +107,9 @@ lp_is_function(LLVMValueRef v);
 
 void
 lp_free_objcache(void *objcache);
+
+char *
+lp_build_host_cpu_name(void);
 #ifdef __cplusplus
 }
 #endif
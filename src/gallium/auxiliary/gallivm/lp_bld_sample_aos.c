@@ -1104,6 +1104,172 @@ lp_build_sample_mipmap(struct lp_build_sample_context *bld,
 
 
 
+/**
+ * Whether the state is single level 2D bilinear rgba8 sampling with
+ * clamp-to-edge wrapping, the bulk of the texturing done by compositors,
+ * which lp_build_sample_2d_linear_clamp() emits specially.
+ */
+static boolean
+lp_build_sample_is_2d_linear_clamp(const struct lp_build_sample_context *bld,
+                                   const LLVMValueRef *offsets)
+{
+   const struct lp_static_texture_state *texture = bld->static_texture_state;
+   const struct lp_static_sampler_state *sampler = bld->static_sampler_state;
+
+   return (texture->target == PIPE_TEXTURE_2D ||
+           texture->target == PIPE_TEXTURE_RECT) &&
+          util_format_is_rgba8_variant(bld->format_desc) &&
+          sampler->min_img_filter == PIPE_TEX_FILTER_LINEAR &&
+          sampler->mag_img_filter == PIPE_TEX_FILTER_LINEAR &&
+          sampler->min_mip_filter == PIPE_TEX_MIPFILTER_NONE &&
+          sampler->wrap_s == PIPE_TEX_WRAP_CLAMP_TO_EDGE &&
+          sampler->wrap_t == PIPE_TEX_WRAP_CLAMP_TO_EDGE &&
+          !sampler->force_nearest_s &&
+          !sampler->force_nearest_t &&
+          bld->num_mips == 1 &&
+          !offsets[0];
+}
+
+
+/**
+ * Bilinear sampling of a single 2D rgba8 level with clamp-to-edge wrapping.
+ * Same results as lp_build_sample_mipmap() for this state, but the texel
+ * coords are clamped with plain min/max and the four texel offsets are
+ * formed from one column and one row offset each, skipping the wrap mode
+ * and format dispatch of the general path.
+ * Return filtered color as a vector of 8-bit unorm values.
+ */
+static LLVMValueRef
+lp_build_sample_2d_linear_clamp(struct lp_build_sample_context *bld,
+                                LLVMValueRef s,
+                                LLVMValueRef t,
+                                LLVMValueRef ilevel)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *int_coord_bld = &bld->int_coord_bld;
+   struct lp_build_context u8n;
+   LLVMTypeRef u8n_vec_type;
+   LLVMTypeRef elem_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMValueRef shuffles[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef shuffle;
+   LLVMValueRef size, row_stride_vec, img_stride_vec, data_ptr;
+   LLVMValueRef width_vec, height_vec, depth_vec;
+   LLVMValueRef i32_c128, i32_c255, x_max, y_max;
+   LLVMValueRef s_fpart, t_fpart;
+   LLVMValueRef x[2], y[2];
+   LLVMValueRef neighbors[2][2]; /* [y][x] */
+   struct lp_type fetch_type;
+   unsigned i, j;
+
+   lp_build_mipmap_level_sizes(bld, ilevel,
+                               &size,
+                               &row_stride_vec, &img_stride_vec);
+   data_ptr = lp_build_get_mipmap_level(bld, ilevel);
+
+   lp_build_extract_image_sizes(bld,
+                                &bld->int_size_bld,
+                                bld->int_coord_type,
+                                size,
+                                &width_vec,
+                                &height_vec,
+                                &depth_vec);
+
+   /* texel coords in 8.8 fixed point */
+   if (bld->static_sampler_state->normalized_coords) {
+      LLVMValueRef scaled_size;
+      LLVMValueRef flt_size;
+
+      scaled_size = lp_build_shl_imm(&bld->int_size_bld, size, 8);
+      flt_size = lp_build_int_to_float(&bld->float_size_bld, scaled_size);
+      lp_build_unnormalized_coords(bld, flt_size, &s, &t, NULL);
+   }
+   else {
+      s = lp_build_mul_imm(&bld->coord_bld, s, 256);
+      t = lp_build_mul_imm(&bld->coord_bld, t, 256);
+   }
+
+   /* subtract 0.5, then split into integer and fractional parts */
+   i32_c128 = lp_build_const_int_vec(gallivm, int_coord_bld->type, -128);
+   s = LLVMBuildAdd(builder, lp_build_iround(&bld->coord_bld, s), i32_c128, "");
+   t = LLVMBuildAdd(builder, lp_build_iround(&bld->coord_bld, t), i32_c128, "");
+
+   i32_c255 = lp_build_const_int_vec(gallivm, int_coord_bld->type, 255);
+   s_fpart = LLVMBuildAnd(builder, s, i32_c255, "");
+   t_fpart = LLVMBuildAnd(builder, t, i32_c255, "");
+
+   x[0] = lp_build_shr_imm(int_coord_bld, s, 8);
+   y[0] = lp_build_shr_imm(int_coord_bld, t, 8);
+   x[1] = lp_build_add(int_coord_bld, x[0], int_coord_bld->one);
+   y[1] = lp_build_add(int_coord_bld, y[0], int_coord_bld->one);
+
+   /* clamp to edge, and turn into byte offsets */
+   x_max = lp_build_sub(int_coord_bld, width_vec, int_coord_bld->one);
+   y_max = lp_build_sub(int_coord_bld, height_vec, int_coord_bld->one);
+   for (i = 0; i < 2; i++) {
+      x[i] = lp_build_clamp(int_coord_bld, x[i], int_coord_bld->zero, x_max);
+      x[i] = lp_build_shl_imm(int_coord_bld, x[i], 2);
+      y[i] = lp_build_clamp(int_coord_bld, y[i], int_coord_bld->zero, y_max);
+      y[i] = lp_build_mul(int_coord_bld, y[i], row_stride_vec);
+   }
+
+   /*
+    * Fetch the four neighbors as is, swizzling is done by the caller.
+    */
+   lp_build_context_init(&u8n, gallivm, lp_type_unorm(8, bld->vector_width));
+   u8n_vec_type = lp_build_vec_type(gallivm, u8n.type);
+   fetch_type = lp_type_uint(bld->texel_type.width);
+
+   for (j = 0; j < 2; j++) {
+      for (i = 0; i < 2; i++) {
+         LLVMValueRef offset = lp_build_add(int_coord_bld, y[j], x[i]);
+         LLVMValueRef rgba8;
+
+         rgba8 = lp_build_gather(gallivm,
+                                 bld->texel_type.length,
+                                 bld->format_desc->block.bits,
+                                 fetch_type,
+                                 TRUE,
+                                 data_ptr, offset, TRUE);
+         neighbors[j][i] = LLVMBuildBitCast(builder, rgba8, u8n_vec_type, "");
+      }
+   }
+
+   /*
+    * Replicate each 8-bit weight to the four channels of its texel, as in
+    * lp_build_sample_fetch_image_linear().
+    */
+   s_fpart = LLVMBuildBitCast(builder, s_fpart, u8n_vec_type, "");
+   t_fpart = LLVMBuildBitCast(builder, t_fpart, u8n_vec_type, "");
+
+   for (j = 0; j < u8n.type.length; j += 4) {
+#if UTIL_ARCH_LITTLE_ENDIAN
+      unsigned subindex = 0;
+#else
+      unsigned subindex = 3;
+#endif
+      LLVMValueRef index;
+
+      index = LLVMConstInt(elem_type, j + subindex, 0);
+      for (i = 0; i < 4; ++i)
+         shuffles[j + i] = index;
+   }
+
+   shuffle = LLVMConstVector(shuffles, u8n.type.length);
+
+   s_fpart = LLVMBuildShuffleVector(builder, s_fpart, u8n.undef, shuffle, "");
+   t_fpart = LLVMBuildShuffleVector(builder, t_fpart, u8n.undef, shuffle, "");
+
+   return lp_build_lerp_2d(&u8n,
+                           s_fpart, t_fpart,
+                           neighbors[0][0],
+                           neighbors[0][1],
+                           neighbors[1][0],
+                           neighbors[1][1],
+                           LP_BLD_LERP_PRESCALED_WEIGHTS);
+}
+
+
 /**
  * Texture sampling in AoS format.  Used when sampling common 32-bit/texel
  * formats.  1D/2D/3D/cube texture supported.  All mipmap sampling modes
@@ -1148,7 +1314,12 @@ lp_build_sample_aos(struct lp_build_sample_context *bld,
 
    packed_var = lp_build_alloca(bld->gallivm, u8n_bld.vec_type, "packed_var");
 
-   if (min_filter == mag_filter) {
+   if (lp_build_sample_is_2d_linear_clamp(bld, offsets)) {
+      LLVMBuildStore(builder,
+                     lp_build_sample_2d_linear_clamp(bld, s, t, ilevel0),
+                     packed_var);
+   }
+   else if (min_filter == mag_filter) {
       /* no need to distinguish between minification and magnification */
       lp_build_sample_mipmap(bld,
                              min_filter, mip_filter,
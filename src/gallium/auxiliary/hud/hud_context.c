@@ -46,6 +46,7 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
+#include "util/os_time.h"
 #include "util/u_sampler.h"
 #include "util/u_simple_shaders.h"
 #include "util/u_string.h"
@@ -638,6 +639,18 @@ hud_stop_queries(struct hud_context *hud, struct pipe_context *pipe)
    struct hud_pane *pane;
    struct hud_graph *gr, *next;
 
+   /* Nothing is drawn, only sample the values for the dump files. */
+   if (!huds_visible) {
+      hud_batch_query_update(hud->batch_query, pipe);
+
+      LIST_FOR_EACH_ENTRY(pane, &hud->pane_list, head) {
+         LIST_FOR_EACH_ENTRY(gr, &pane->graph_list, head) {
+            gr->query_new_value(gr, pipe);
+         }
+      }
+      return;
+   }
+
    /* prepare vertex buffers */
    hud_prepare_vertices(hud, &hud->bg, 16 * 256, 2 * sizeof(float));
    hud_prepare_vertices(hud, &hud->whitelines, 4 * 256, 2 * sizeof(float));
@@ -942,19 +955,31 @@ hud_pane_add_graph(struct hud_pane *pane, struct hud_graph *gr)
    pane->next_color++;
 }
 
+static void
+hud_dump_value(FILE *fd, double value)
+{
+   if (fabs(value - lround(value)) > FLT_EPSILON) {
+      fprintf(fd, "%f\n", value);
+   }
+   else {
+      fprintf(fd, "%" PRIu64 "\n", (uint64_t) lround(value));
+   }
+}
+
 void
 hud_graph_add_value(struct hud_graph *gr, double value)
 {
+   FILE *dump_file = gr->pane->hud->dump_file;
+
    gr->current_value = value;
    value = value > gr->pane->ceiling ? gr->pane->ceiling : value;
 
-   if (gr->fd) {
-      if (fabs(value - lround(value)) > FLT_EPSILON) {
-         fprintf(gr->fd, "%f\n", value);
-      }
-      else {
-         fprintf(gr->fd, "%" PRIu64 "\n", (uint64_t) lround(value));
-      }
+   if (gr->fd)
+      hud_dump_value(gr->fd, value);
+
+   if (dump_file) {
+      fprintf(dump_file, "%" PRId64 " %s ", os_time_get(), gr->name);
+      hud_dump_value(dump_file, value);
    }
 
    if (gr->index == gr->pane->max_num_vertices) {
@@ -1261,6 +1286,18 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
       else if (strcmp(name, "API-thread-num-syncs") == 0) {
          hud_thread_counter_install(pane, name, HUD_COUNTER_SYNCS);
       }
+      else if (strcmp(name, "API-thread-queue-latency") == 0) {
+         hud_queue_stat_install(pane, name, HUD_QUEUE_STAT_LATENCY);
+      }
+      else if (strcmp(name, "API-thread-job-time") == 0) {
+         hud_queue_stat_install(pane, name, HUD_QUEUE_STAT_EXECUTE_TIME);
+      }
+      else if (strcmp(name, "API-thread-queue-depth") == 0) {
+         hud_queue_stat_install(pane, name, HUD_QUEUE_STAT_DEPTH);
+      }
+      else if (strcmp(name, "API-thread-queue-full") == 0) {
+         hud_queue_stat_install(pane, name, HUD_QUEUE_STAT_BLOCKED);
+      }
       else if (strcmp(name, "main-thread-busy") == 0) {
          hud_thread_busy_install(pane, name, true);
       }
@@ -1499,6 +1536,18 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
          hud_graph_set_dump_file(gr);
       }
    }
+
+   /* GALLIUM_HUD_DUMP_FILE collects the values of all graphs into a single
+    * stream of "<microseconds> <name> <value>" lines, which can be a pipe
+    * read by a monitoring agent.  Combined with GALLIUM_HUD_VISIBLE=false,
+    * nothing is drawn.
+    */
+   const char *dump_file = getenv("GALLIUM_HUD_DUMP_FILE");
+   if (dump_file) {
+      hud->dump_file = fopen(dump_file, "a");
+      if (hud->dump_file)
+         setvbuf(hud->dump_file, NULL, _IOLBF, 0);
+   }
 }
 
 static void
@@ -1752,6 +1801,11 @@ hud_unset_record_context(struct hud_context *hud)
 
    hud_batch_query_cleanup(&hud->batch_query, pipe);
    hud->record_pipe = NULL;
+
+   if (hud->dump_file) {
+      fclose(hud->dump_file);
+      hud->dump_file = NULL;
+   }
 }
 
 static void
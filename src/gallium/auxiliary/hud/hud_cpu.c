@@ -466,3 +466,89 @@ void hud_thread_counter_install(struct hud_pane *pane, const char *name,
    hud_pane_add_graph(pane, gr);
    hud_pane_set_max_value(pane, 100);
 }
+
+struct queue_stat_info {
+   enum hud_queue_stat stat;
+   struct util_queue_stats last;
+   int64_t last_time;
+};
+
+static void
+query_queue_stat(struct hud_graph *gr, struct pipe_context *pipe)
+{
+   struct queue_stat_info *info = gr->query_data;
+   struct util_queue_monitoring *mon = gr->pane->hud->monitored_queue;
+   int64_t now = os_time_get_nano();
+   struct util_queue_stats stats;
+
+   if (!mon || !mon->queue)
+      return;
+
+   if (!info->last_time) {
+      /* initialize */
+      util_queue_enable_stats(mon->queue);
+      util_queue_get_stats(mon->queue, &info->last);
+      info->last_time = now;
+      return;
+   }
+
+   if (info->last_time + gr->pane->period*1000 > now)
+      return;
+
+   util_queue_get_stats(mon->queue, &stats);
+
+   uint64_t num_jobs = stats.num_jobs - info->last.num_jobs;
+   double value = 0;
+
+   switch (info->stat) {
+   case HUD_QUEUE_STAT_LATENCY:
+      /* average microseconds */
+      if (num_jobs)
+         value = (stats.total_latency_ns - info->last.total_latency_ns) /
+                 (num_jobs * 1000.0);
+      break;
+   case HUD_QUEUE_STAT_EXECUTE_TIME:
+      if (num_jobs)
+         value = (stats.total_execute_ns - info->last.total_execute_ns) /
+                 (num_jobs * 1000.0);
+      break;
+   case HUD_QUEUE_STAT_DEPTH:
+      value = stats.depth;
+      break;
+   case HUD_QUEUE_STAT_BLOCKED:
+      value = stats.num_blocked - info->last.num_blocked;
+      break;
+   }
+
+   hud_graph_add_value(gr, value);
+   info->last = stats;
+   info->last_time = now;
+}
+
+void
+hud_queue_stat_install(struct hud_pane *pane, const char *name,
+                       enum hud_queue_stat stat)
+{
+   struct hud_graph *gr = CALLOC_STRUCT(hud_graph);
+   if (!gr)
+      return;
+
+   strcpy(gr->name, name);
+
+   gr->query_data = CALLOC_STRUCT(queue_stat_info);
+   if (!gr->query_data) {
+      FREE(gr);
+      return;
+   }
+
+   ((struct queue_stat_info*)gr->query_data)->stat = stat;
+   gr->query_new_value = query_queue_stat;
+
+   /* Don't use free() as our callback as that messes up Gallium's
+    * memory debugger.  Use simple free_query_data() wrapper.
+    */
+   gr->free_query_data = free_query_data;
+
+   hud_pane_add_graph(pane, gr);
+   hud_pane_set_max_value(pane, 100);
+}
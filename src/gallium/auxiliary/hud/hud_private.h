@@ -40,6 +40,13 @@ enum hud_counter {
    HUD_COUNTER_SYNCS,
 };
 
+enum hud_queue_stat {
+   HUD_QUEUE_STAT_LATENCY,
+   HUD_QUEUE_STAT_EXECUTE_TIME,
+   HUD_QUEUE_STAT_DEPTH,
+   HUD_QUEUE_STAT_BLOCKED,
+};
+
 struct hud_context {
    int refcount;
    bool simple;
@@ -56,6 +63,9 @@ struct hud_context {
 
    struct util_queue_monitoring *monitored_queue;
 
+   /* GALLIUM_HUD_DUMP_FILE, all the sampled values with timestamps. */
+   FILE *dump_file;
+
    /* states */
    struct pipe_blend_state no_blend, alpha_blend;
    struct pipe_depth_stencil_alpha_state dsa;
@@ -163,6 +173,8 @@ void hud_cpu_graph_install(struct hud_pane *pane, unsigned cpu_index);
 void hud_thread_busy_install(struct hud_pane *pane, const char *name, bool main);
 void hud_thread_counter_install(struct hud_pane *pane, const char *name,
                                 enum hud_counter counter);
+void hud_queue_stat_install(struct hud_pane *pane, const char *name,
+                            enum hud_queue_stat stat);
 void hud_pipe_query_install(struct hud_batch_query_context **pbq,
                             struct hud_pane *pane,
                             const char *name,
@@ -152,22 +152,27 @@ def do_line( intype, outtype, ptr, v0, v1, inpv, outpv ):
     else:
         line( intype, outtype, ptr, v1, v0 )
 
-def do_tri( intype, outtype, ptr, v0, v1, v2, inpv, outpv ):
+def tri_verts( v0, v1, v2, inpv, outpv ):
     if inpv == outpv:
-        tri( intype, outtype, ptr, v0, v1, v2 )
-    else: 
-        if inpv == FIRST:
-            tri( intype, outtype, ptr, v1, v2, v0 )
-        else:
-            tri( intype, outtype, ptr, v2, v0, v1 )
+        return (v0, v1, v2)
+    elif inpv == FIRST:
+        return (v1, v2, v0)
+    else:
+        return (v2, v0, v1)
 
-def do_quad( intype, outtype, ptr, v0, v1, v2, v3, inpv, outpv ):
+def quad_tris( v0, v1, v2, v3, inpv ):
     if inpv == LAST:
-        do_tri( intype, outtype, ptr+'+0',  v0, v1, v3, inpv, outpv );
-        do_tri( intype, outtype, ptr+'+3',  v1, v2, v3, inpv, outpv );
+        return ((v0, v1, v3), (v1, v2, v3))
     else:
-        do_tri( intype, outtype, ptr+'+0',  v0, v1, v2, inpv, outpv );
-        do_tri( intype, outtype, ptr+'+3',  v0, v2, v3, inpv, outpv );
+        return ((v0, v1, v2), (v0, v2, v3))
+
+def do_tri( intype, outtype, ptr, v0, v1, v2, inpv, outpv ):
+    tri( intype, outtype, ptr, *tri_verts( v0, v1, v2, inpv, outpv ) )
+
+def do_quad( intype, outtype, ptr, v0, v1, v2, v3, inpv, outpv ):
+    t0, t1 = quad_tris( v0, v1, v2, v3, inpv )
+    do_tri( intype, outtype, ptr+'+0', t0[0], t0[1], t0[2], inpv, outpv );
+    do_tri( intype, outtype, ptr+'+3', t1[0], t1[1], t1[2], inpv, outpv );
 
 def do_lineadj( intype, outtype, ptr, v0, v1, v2, v3, inpv, outpv ):
     if inpv == outpv:
@@ -209,6 +214,94 @@ def postamble():
     print('}')
 
 
+# Primitives with a SIMD path, for the prdisable translators that keep the
+# index size and for the generators: the number of input indices per
+# primitive and the number of primitives in a block of 12 output indices.
+SIMD_PRIMS = dict(quads=(4, 2), quadstrip=(2, 2), tristrip=(1, 4))
+
+def tristrip_verts(inpv):
+    if inpv == FIRST:
+        return ('i', 'i+1+(i&1)', 'i+2-(i&1)')
+    else:
+        return ('i+(i&1)', 'i+1-(i&1)', 'i+2')
+
+def quadstrip_verts(inpv):
+    if inpv == LAST:
+        return ('i+2', 'i+0', 'i+1', 'i+3')
+    else:
+        return ('i+0', 'i+1', 'i+3', 'i+2')
+
+def simd_supported(intype, outtype, pr, prim):
+    return (prim in SIMD_PRIMS and pr == PRDISABLE and
+            (intype == GENERATE or intype == outtype))
+
+def simd_block(inpv, outpv, prim):
+    """Input offsets, relative to the first index of a block, of the 12
+    output indices of the block.  The block must start at an even index
+    for tristrip."""
+    step, nr = SIMD_PRIMS[prim]
+    offsets = []
+    for p in range(nr):
+        i = p * step
+        if prim == 'quads':
+            tris = quad_tris('i+0', 'i+1', 'i+2', 'i+3', inpv)
+        elif prim == 'quadstrip':
+            tris = quad_tris(*quadstrip_verts(inpv), inpv=inpv)
+        else:
+            tris = (tristrip_verts(inpv),)
+        for t in tris:
+            offsets += [eval(v, dict(i=i)) for v in tri_verts(*t, inpv=inpv, outpv=outpv)]
+    assert len(offsets) == 12
+    return offsets
+
+def simd_window(offsets, last, windows):
+    """Start of a 4-index window of the block holding both offsets,
+    preferring windows already loaded, then aligned ones."""
+    lo, hi = min(offsets), max(offsets)
+    first = max(0, hi - 3)
+    assert first <= lo and hi <= last
+    for w in windows:
+        if first <= w <= lo and w + 3 <= last:
+            return w
+    for w in range(first, lo + 1):
+        if w % 4 == 0 and w + 3 <= last:
+            return w
+    return first
+
+def simd_loop(intype, outtype, inpv, outpv, prim):
+    """Emit a loop doing whole blocks with SIMD, leaving i and j for the
+    scalar loop to finish."""
+    step, nr = SIMD_PRIMS[prim]
+    offsets = simd_block(inpv, outpv, prim)
+    print('#if U_INDICES_SIMD')
+    print('  for (; j + 12 <= out_nr; j += 12, i += ' + str(step * nr) + ') {')
+    args = []
+    if intype == GENERATE:
+        print('      const u_simd4 base = U_SIMD_SPLAT(i);')
+        for v in range(3):
+            args.append('U_SIMD_ADD(base, ' +
+                        ', '.join(str(o) for o in offsets[4*v:4*v+4]) + ')')
+    else:
+        last = max(offsets)
+        windows = []
+        for v in range(3):
+            a = simd_window(offsets[4*v:4*v+2], last, windows)
+            windows.append(a)
+            b = simd_window(offsets[4*v+2:4*v+4], last, windows)
+            windows.append(b)
+            args.append('U_SIMD_GATHER(w%d, w%d, %d, %d, %d, %d)' %
+                        (a, b, offsets[4*v] - a, offsets[4*v+1] - a,
+                         offsets[4*v+2] - b, offsets[4*v+3] - b))
+        for w in sorted(set(windows)):
+            print('      const u_simd4 w%d = U_SIMD_LOAD_%s(in + i + %d);' %
+                  (w, intype, w))
+    print('      U_SIMD_STORE12_' + outtype + '(out + j,')
+    for a in args:
+        print('         ' + a + (');' if a is args[-1] else ','))
+    print('   }')
+    print('#endif')
+
+
 def points(intype, outtype, inpv, outpv, pr):
     preamble(intype, outtype, inpv, outpv, pr, prim='points')
     print('  for (i = start, j = 0; j < out_nr; j++, i++) { ')
@@ -248,11 +341,20 @@ def tris(intype, outtype, inpv, outpv, pr):
 
 def tristrip(intype, outtype, inpv, outpv, pr):
     preamble(intype, outtype, inpv, outpv, pr, prim='tristrip')
-    print('  for (i = start, j = 0; j < out_nr; j+=3, i++) { ')
-    if inpv == FIRST:
-        do_tri( intype, outtype, 'out+j',  'i', 'i+1+(i&1)', 'i+2-(i&1)', inpv, outpv );
+    verts = tristrip_verts(inpv)
+    if simd_supported(intype, outtype, pr, 'tristrip'):
+        print('  i = start;')
+        print('  j = 0;')
+        print('  if ((i & 1) && j < out_nr) {')
+        do_tri( intype, outtype, 'out+j', verts[0], verts[1], verts[2], inpv, outpv );
+        print('      j += 3;')
+        print('      i++;')
+        print('  }')
+        simd_loop(intype, outtype, inpv, outpv, 'tristrip')
+        print('  for (; j < out_nr; j+=3, i++) { ')
     else:
-        do_tri( intype, outtype, 'out+j',  'i+(i&1)', 'i+1-(i&1)', 'i+2', inpv, outpv );
+        print('  for (i = start, j = 0; j < out_nr; j+=3, i++) { ')
+    do_tri( intype, outtype, 'out+j', verts[0], verts[1], verts[2], inpv, outpv );
     print('   }')
     postamble()
 
@@ -303,7 +405,13 @@ def polygon(intype, outtype, inpv, outpv, pr):
 
 def quads(intype, outtype, inpv, outpv, pr):
     preamble(intype, outtype, inpv, outpv, pr, prim='quads')
-    print('  for (i = start, j = 0; j < out_nr; j+=6, i+=4) { ')
+    if simd_supported(intype, outtype, pr, 'quads'):
+        print('  i = start;')
+        print('  j = 0;')
+        simd_loop(intype, outtype, inpv, outpv, 'quads')
+        print('  for (; j < out_nr; j+=6, i+=4) { ')
+    else:
+        print('  for (i = start, j = 0; j < out_nr; j+=6, i+=4) { ')
     if pr == PRENABLE:
         print('restart:')
         print('      if (i + 4 > in_nr) {')
@@ -339,7 +447,13 @@ def quads(intype, outtype, inpv, outpv, pr):
 
 def quadstrip(intype, outtype, inpv, outpv, pr):
     preamble(intype, outtype, inpv, outpv, pr, prim='quadstrip')
-    print('  for (i = start, j = 0; j < out_nr; j+=6, i+=2) { ')
+    if simd_supported(intype, outtype, pr, 'quadstrip'):
+        print('  i = start;')
+        print('  j = 0;')
+        simd_loop(intype, outtype, inpv, outpv, 'quadstrip')
+        print('  for (; j < out_nr; j+=6, i+=2) { ')
+    else:
+        print('  for (i = start, j = 0; j < out_nr; j+=6, i+=2) { ')
     if pr == PRENABLE:
         print('restart:')
         print('      if (i + 4 > in_nr) {')
@@ -367,10 +481,8 @@ def quadstrip(intype, outtype, inpv, outpv, pr):
         print('         i += 4;')
         print('         goto restart;')
         print('      }')
-    if inpv == LAST:
-        do_quad( intype, outtype, 'out+j', 'i+2', 'i+0', 'i+1', 'i+3', inpv, outpv );
-    else:
-        do_quad( intype, outtype, 'out+j', 'i+0', 'i+1', 'i+3', 'i+2', inpv, outpv );
+    v = quadstrip_verts(inpv)
+    do_quad( intype, outtype, 'out+j', v[0], v[1], v[2], v[3], inpv, outpv );
     print('   }')
     postamble()
 
@@ -40,4 +40,85 @@
 
 #define PRIM_COUNT   (PIPE_PRIM_TRIANGLE_STRIP_ADJACENCY + 1)
 
+
+/* Helpers for the SIMD paths of u_indices_gen.py.  Indices are handled as
+ * four 32-bit lanes whatever the index size; ushort indices are widened on
+ * load and narrowed (truncated) on store.
+ *
+ * U_SIMD_GATHER(a, b, x, y, z, w) returns { a[x], a[y], b[z], b[w] }.
+ */
+#if defined(PIPE_ARCH_SSE)
+
+#include <emmintrin.h>
+
+#define U_INDICES_SIMD 1
+
+typedef __m128i u_simd4;
+
+#define U_SIMD_LOAD_uint(p)   _mm_loadu_si128((const __m128i *)(p))
+#define U_SIMD_LOAD_ushort(p) \
+   _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(p)), \
+                      _mm_setzero_si128())
+
+#define U_SIMD_GATHER(a, b, x, y, z, w) \
+   _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), \
+                                   _mm_castsi128_ps(b), \
+                                   _MM_SHUFFLE(w, z, y, x)))
+
+#define U_SIMD_SPLAT(v) _mm_set1_epi32(v)
+#define U_SIMD_ADD(base, x, y, z, w) \
+   _mm_add_epi32(base, _mm_setr_epi32(x, y, z, w))
+
+#define U_SIMD_STORE12_uint(out, v0, v1, v2) do { \
+   _mm_storeu_si128((__m128i *)(out), v0); \
+   _mm_storeu_si128((__m128i *)((out) + 4), v1); \
+   _mm_storeu_si128((__m128i *)((out) + 8), v2); \
+} while (0)
+
+/* SSE2 only has a signed saturating pack, so sign-extend the low 16 bits
+ * first to make it exact.
+ */
+#define U_SIMD_NARROW(v) _mm_srai_epi32(_mm_slli_epi32(v, 16), 16)
+
+#define U_SIMD_STORE12_ushort(out, v0, v1, v2) do { \
+   __m128i _v2 = U_SIMD_NARROW(v2); \
+   _mm_storeu_si128((__m128i *)(out), \
+                    _mm_packs_epi32(U_SIMD_NARROW(v0), U_SIMD_NARROW(v1))); \
+   _mm_storel_epi64((__m128i *)((out) + 8), _mm_packs_epi32(_v2, _v2)); \
+} while (0)
+
+#elif defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+#define U_INDICES_SIMD 1
+
+typedef uint32x4_t u_simd4;
+
+#define U_SIMD_LOAD_uint(p)   vld1q_u32(p)
+#define U_SIMD_LOAD_ushort(p) vmovl_u16(vld1_u16(p))
+
+#define U_SIMD_GATHER(a, b, x, y, z, w) \
+   vsetq_lane_u32(vgetq_lane_u32(b, w), \
+   vsetq_lane_u32(vgetq_lane_u32(b, z), \
+   vsetq_lane_u32(vgetq_lane_u32(a, y), \
+                  vdupq_n_u32(vgetq_lane_u32(a, x)), 1), 2), 3)
+
+#define U_SIMD_SPLAT(v) vdupq_n_u32(v)
+#define U_SIMD_ADD(base, x, y, z, w) \
+   vaddq_u32(base, vld1q_u32((const uint32_t[]) { x, y, z, w }))
+
+#define U_SIMD_STORE12_uint(out, v0, v1, v2) do { \
+   vst1q_u32(out, v0); \
+   vst1q_u32((out) + 4, v1); \
+   vst1q_u32((out) + 8, v2); \
+} while (0)
+
+#define U_SIMD_STORE12_ushort(out, v0, v1, v2) do { \
+   vst1q_u16(out, vcombine_u16(vmovn_u32(v0), vmovn_u32(v1))); \
+   vst1_u16((out) + 8, vmovn_u32(v2)); \
+} while (0)
+
+#endif
+
 #endif
@@ -45,18 +45,136 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_upload_mgr.h"
+#include "util/hash_table.h"
+#include "util/xxhash.h"
 
 #include "indices/u_indices.h"
 #include "indices/u_primconvert.h"
 
+/* Translated index buffers are kept in a cache, so that static draws don't
+ * translate and upload the same indices again each time.  The cache is
+ * keyed by a hash of the source indices (or by the vertex range for
+ * generated indices), and a buffer is only created the second time a key
+ * is seen, so that streamed indices still go through the uploader.
+ */
+#define PRIMCONVERT_CACHE_MIN_SIZE    1024
+#define PRIMCONVERT_CACHE_MAX_SIZE    (16 * 1024 * 1024)
+#define PRIMCONVERT_CACHE_MAX_ENTRIES 1024
+
+struct primconvert_cache_key
+{
+   uint64_t hash;          /* of the source indices, 0 if generated */
+   unsigned start;         /* only for generated indices */
+   unsigned count;
+   unsigned restart_index;
+   uint8_t mode;
+   uint8_t index_size;
+   uint8_t api_pv;
+   uint8_t primitive_restart;
+};
+
+struct primconvert_cache_entry
+{
+   struct primconvert_cache_key key;
+   struct pipe_resource *buffer;   /* NULL until the key is seen again */
+};
+
 struct primconvert_context
 {
    struct pipe_context *pipe;
    uint32_t primtypes_mask;
    unsigned api_pv;
+
+   struct hash_table *cache;
+   unsigned cache_size;
 };
 
 
+static uint32_t
+cache_key_hash(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(struct primconvert_cache_key));
+}
+
+static bool
+cache_key_equals(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct primconvert_cache_key)) == 0;
+}
+
+static void
+cache_entry_destroy(struct hash_entry *he)
+{
+   struct primconvert_cache_entry *entry = he->data;
+
+   pipe_resource_reference(&entry->buffer, NULL);
+   FREE(entry);
+}
+
+static void
+cache_clear(struct primconvert_context *pc)
+{
+   _mesa_hash_table_clear(pc->cache, cache_entry_destroy);
+   pc->cache_size = 0;
+}
+
+/**
+ * Look up the translation of a draw of \p size bytes of output indices.
+ *
+ * Returns the entry if the draw was seen before, with a NULL buffer if the
+ * caller should create it, and NULL if the indices should just be uploaded.
+ */
+static struct primconvert_cache_entry *
+cache_lookup(struct primconvert_context *pc,
+             const struct pipe_draw_info *info,
+             const void *src, unsigned size)
+{
+   struct primconvert_cache_key key;
+   struct primconvert_cache_entry *entry;
+   struct hash_entry *he;
+
+   if (size < PRIMCONVERT_CACHE_MIN_SIZE ||
+       size > PRIMCONVERT_CACHE_MAX_SIZE / 4)
+      return NULL;
+
+   memset(&key, 0, sizeof(key));
+   if (info->index_size) {
+      key.hash = XXH64((const uint8_t *)src +
+                       info->start * info->index_size,
+                       info->count * info->index_size, 0);
+   } else {
+      key.start = info->start;
+   }
+   key.count = info->count;
+   key.restart_index = info->primitive_restart ? info->restart_index : 0;
+   key.mode = info->mode;
+   key.index_size = info->index_size;
+   key.api_pv = pc->api_pv;
+   key.primitive_restart = info->primitive_restart;
+
+   he = _mesa_hash_table_search(pc->cache, &key);
+   if (he) {
+      entry = he->data;
+      if (entry->buffer || pc->cache_size + size <= PRIMCONVERT_CACHE_MAX_SIZE)
+         return entry;
+
+      /* Full: start over rather than tracking usage. */
+      cache_clear(pc);
+      return NULL;
+   }
+
+   if (_mesa_hash_table_num_entries(pc->cache) >= PRIMCONVERT_CACHE_MAX_ENTRIES)
+      cache_clear(pc);
+
+   entry = CALLOC_STRUCT(primconvert_cache_entry);
+   if (entry) {
+      entry->key = key;
+      _mesa_hash_table_insert(pc->cache, &entry->key, entry);
+   }
+   return NULL;
+}
+
+
 struct primconvert_context *
 util_primconvert_create(struct pipe_context *pipe, uint32_t primtypes_mask)
 {
@@ -65,12 +183,18 @@ util_primconvert_create(struct pipe_context *pipe, uint32_t primtypes_mask)
       return NULL;
    pc->pipe = pipe;
    pc->primtypes_mask = primtypes_mask;
+   pc->cache = _mesa_hash_table_create(NULL, cache_key_hash, cache_key_equals);
+   if (!pc->cache) {
+      FREE(pc);
+      return NULL;
+   }
    return pc;
 }
 
 void
 util_primconvert_destroy(struct primconvert_context *pc)
 {
+   _mesa_hash_table_destroy(pc->cache, cache_entry_destroy);
    FREE(pc);
 }
 
@@ -91,12 +215,14 @@ util_primconvert_draw_vbo(struct primconvert_context *pc,
                           const struct pipe_draw_info *info)
 {
    struct pipe_draw_info new_info;
-   struct pipe_transfer *src_transfer = NULL;
+   struct pipe_transfer *src_transfer = NULL, *dst_transfer = NULL;
+   struct primconvert_cache_entry *entry;
    u_translate_func trans_func;
    u_generate_func gen_func;
    const void *src = NULL;
-   void *dst;
-   unsigned ib_offset;
+   void *dst = NULL;
+   unsigned ib_offset, size;
+   bool uploaded = false;
 
    util_draw_init_info(&new_info);
    new_info.min_index = info->min_index;
@@ -138,21 +264,53 @@ util_primconvert_draw_vbo(struct primconvert_context *pc,
       new_info.index_size = index_size;
    }
 
-   u_upload_alloc(pc->pipe->stream_uploader, 0, new_info.index_size * new_info.count, 4,
-                  &ib_offset, &new_info.index.resource, &dst);
-   new_info.start = ib_offset / new_info.index_size;
+   size = new_info.index_size * new_info.count;
+   entry = cache_lookup(pc, info, src, size);
 
-   if (info->index_size) {
-      trans_func(src, info->start, info->count, new_info.count, info->restart_index, dst);
+   if (entry && entry->buffer) {
+      pipe_resource_reference(&new_info.index.resource, entry->buffer);
+      new_info.start = 0;
+   } else if (entry) {
+      entry->buffer = pipe_buffer_create(pc->pipe->screen,
+                                         PIPE_BIND_INDEX_BUFFER,
+                                         PIPE_USAGE_IMMUTABLE, size);
+      dst = entry->buffer ?
+            pipe_buffer_map(pc->pipe, entry->buffer,
+                            PIPE_TRANSFER_WRITE |
+                            PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                            &dst_transfer) : NULL;
+      if (!dst) {
+         pipe_resource_reference(&entry->buffer, NULL);
+      } else {
+         pc->cache_size += size;
+         pipe_resource_reference(&new_info.index.resource, entry->buffer);
+         new_info.start = 0;
+      }
    }
-   else {
-      gen_func(info->start, new_info.count, dst);
+
+   if (!new_info.index.resource) {
+      u_upload_alloc(pc->pipe->stream_uploader, 0, size, 4,
+                     &ib_offset, &new_info.index.resource, &dst);
+      new_info.start = ib_offset / new_info.index_size;
+      uploaded = true;
+   }
+
+   if (dst) {
+      if (info->index_size) {
+         trans_func(src, info->start, info->count, new_info.count, info->restart_index, dst);
+      }
+      else {
+         gen_func(info->start, new_info.count, dst);
+      }
    }
 
    if (src_transfer)
       pipe_buffer_unmap(pc->pipe, src_transfer);
 
-   u_upload_unmap(pc->pipe->stream_uploader);
+   if (dst_transfer)
+      pipe_buffer_unmap(pc->pipe, dst_transfer);
+   if (uploaded)
+      u_upload_unmap(pc->pipe->stream_uploader);
 
    /* to the translated draw: */
    pc->pipe->draw_vbo(pc->pipe, &new_info);
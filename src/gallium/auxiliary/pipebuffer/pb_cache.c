@@ -27,10 +27,17 @@
  **************************************************************************/
 
 #include "pb_cache.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/os_time.h"
 
 
+static unsigned
+get_size_class(uint64_t size)
+{
+   return size ? util_logbase2_64(size) : 0;
+}
+
 /**
  * Actually destroy the buffer.
  */
@@ -43,9 +50,12 @@ destroy_buffer_locked(struct pb_cache_entry *entry)
    assert(!pipe_is_referenced(&buf->reference));
    if (entry->head.next) {
       list_del(&entry->head);
+      list_del(&entry->size_head);
       assert(mgr->num_buffers);
       --mgr->num_buffers;
       mgr->cache_size -= buf->size;
+      mgr->buckets[entry->bucket_index].cache_size -= buf->size;
+      mgr->num_evictions++;
    }
    mgr->destroy_buffer(buf);
 }
@@ -83,7 +93,7 @@ void
 pb_cache_add_buffer(struct pb_cache_entry *entry)
 {
    struct pb_cache *mgr = entry->mgr;
-   struct list_head *cache = &mgr->buckets[entry->bucket_index];
+   struct pb_cache_heap *heap = &mgr->buckets[entry->bucket_index];
    struct pb_buffer *buf = entry->buffer;
    unsigned i;
 
@@ -93,10 +103,20 @@ pb_cache_add_buffer(struct pb_cache_entry *entry)
    int64_t current_time = os_time_get();
 
    for (i = 0; i < mgr->num_heaps; i++)
-      release_expired_buffers_locked(&mgr->buckets[i], current_time);
+      release_expired_buffers_locked(&mgr->buckets[i].buffers, current_time);
+
+   /* Make room in the heap by releasing its oldest buffers. */
+   if (buf->size <= heap->max_cache_size) {
+      while (heap->cache_size + buf->size > heap->max_cache_size) {
+         destroy_buffer_locked(LIST_ENTRY(struct pb_cache_entry,
+                                          heap->buffers.next, head));
+      }
+   }
 
    /* Directly release any buffer that exceeds the limit. */
-   if (mgr->cache_size + buf->size > mgr->max_cache_size) {
+   if (buf->size > heap->max_cache_size ||
+       mgr->cache_size + buf->size > mgr->max_cache_size) {
+      mgr->num_evictions++;
       mgr->destroy_buffer(buf);
       mtx_unlock(&mgr->mutex);
       return;
@@ -104,9 +124,12 @@ pb_cache_add_buffer(struct pb_cache_entry *entry)
 
    entry->start = os_time_get();
    entry->end = entry->start + mgr->usecs;
-   list_addtail(&entry->head, cache);
+   list_addtail(&entry->head, &heap->buffers);
+   list_addtail(&entry->size_head,
+                &heap->size_classes[get_size_class(buf->size)]);
    ++mgr->num_buffers;
    mgr->cache_size += buf->size;
+   heap->cache_size += buf->size;
    mtx_unlock(&mgr->mutex);
 }
 
@@ -142,64 +165,39 @@ pb_cache_is_buffer_compat(struct pb_cache_entry *entry,
 /**
  * Find a compatible buffer in the cache, return it, and remove it
  * from the cache.
+ *
+ * Only the size classes that can hold compatible buffers are searched,
+ * smallest first.
  */
 struct pb_buffer *
 pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
                         unsigned alignment, unsigned usage,
                         unsigned bucket_index)
 {
-   struct pb_cache_entry *entry;
-   struct pb_cache_entry *cur_entry;
-   struct list_head *cur, *next;
-   int64_t now;
-   int ret = 0;
+   struct pb_cache_entry *entry = NULL;
+   unsigned first_class, last_class;
 
    assert(bucket_index < mgr->num_heaps);
-   struct list_head *cache = &mgr->buckets[bucket_index];
+   struct pb_cache_heap *heap = &mgr->buckets[bucket_index];
 
    mtx_lock(&mgr->mutex);
 
-   entry = NULL;
-   cur = cache->next;
-   next = cur->next;
-
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while (cur != cache) {
-      cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-
-      if (!entry && (ret = pb_cache_is_buffer_compat(cur_entry, size,
-                                                     alignment, usage)) > 0)
-         entry = cur_entry;
-      else if (os_time_timeout(cur_entry->start, cur_entry->end, now))
-         destroy_buffer_locked(cur_entry);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
-
-      /* the buffer is busy (and probably all remaining ones too) */
-      if (ret == -1)
-         break;
-
-      cur = next;
-      next = cur->next;
-   }
+   first_class = get_size_class(size);
+   last_class = MIN2(get_size_class((uint64_t)(mgr->size_factor * size)),
+                     PB_CACHE_NUM_SIZE_CLASSES - 1);
 
-   /* keep searching in the hot buffers */
-   if (!entry && ret != -1) {
-      while (cur != cache) {
-         cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-         ret = pb_cache_is_buffer_compat(cur_entry, size, alignment, usage);
+   for (unsigned i = first_class; i <= last_class && !entry; i++) {
+      list_for_each_entry(struct pb_cache_entry, cur, &heap->size_classes[i],
+                          size_head) {
+         int ret = pb_cache_is_buffer_compat(cur, size, alignment, usage);
 
          if (ret > 0) {
-            entry = cur_entry;
+            entry = cur;
             break;
          }
+         /* the buffer is busy (and probably all later ones too) */
          if (ret == -1)
             break;
-         /* no need to check the timeout here */
-         cur = next;
-         next = cur->next;
       }
    }
 
@@ -208,14 +206,20 @@ pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
       struct pb_buffer *buf = entry->buffer;
 
       mgr->cache_size -= buf->size;
+      heap->cache_size -= buf->size;
       list_del(&entry->head);
+      list_del(&entry->size_head);
       --mgr->num_buffers;
+      mgr->num_hits++;
+      release_expired_buffers_locked(&heap->buffers, os_time_get());
       mtx_unlock(&mgr->mutex);
       /* Increase refcount */
       pipe_reference_init(&buf->reference, 1);
       return buf;
    }
 
+   mgr->num_misses++;
+   release_expired_buffers_locked(&heap->buffers, os_time_get());
    mtx_unlock(&mgr->mutex);
    return NULL;
 }
@@ -232,7 +236,7 @@ pb_cache_release_all_buffers(struct pb_cache *mgr)
 
    mtx_lock(&mgr->mutex);
    for (i = 0; i < mgr->num_heaps; i++) {
-      struct list_head *cache = &mgr->buckets[i];
+      struct list_head *cache = &mgr->buckets[i].buffers;
 
       curr = cache->next;
       next = curr->next;
@@ -285,12 +289,18 @@ pb_cache_init(struct pb_cache *mgr, uint num_heaps,
 {
    unsigned i;
 
-   mgr->buckets = CALLOC(num_heaps, sizeof(struct list_head));
+   mgr->buckets = CALLOC(num_heaps, sizeof(struct pb_cache_heap));
    if (!mgr->buckets)
       return;
 
-   for (i = 0; i < num_heaps; i++)
-      list_inithead(&mgr->buckets[i]);
+   for (i = 0; i < num_heaps; i++) {
+      struct pb_cache_heap *heap = &mgr->buckets[i];
+
+      list_inithead(&heap->buffers);
+      for (unsigned j = 0; j < PB_CACHE_NUM_SIZE_CLASSES; j++)
+         list_inithead(&heap->size_classes[j]);
+      heap->max_cache_size = maximum_cache_size;
+   }
 
    (void) mtx_init(&mgr->mutex, mtx_plain);
    mgr->cache_size = 0;
@@ -302,6 +312,25 @@ pb_cache_init(struct pb_cache *mgr, uint num_heaps,
    mgr->size_factor = size_factor;
    mgr->destroy_buffer = destroy_buffer;
    mgr->can_reclaim = can_reclaim;
+   mgr->num_hits = 0;
+   mgr->num_misses = 0;
+   mgr->num_evictions = 0;
+}
+
+/**
+ * Limit the total size of the unused buffers of one bucket. The oldest
+ * buffers of the bucket are released to make room for new ones. By default,
+ * only maximum_cache_size passed to pb_cache_init applies.
+ */
+void
+pb_cache_set_heap_max_size(struct pb_cache *mgr, unsigned bucket_index,
+                           uint64_t max_cache_size)
+{
+   assert(bucket_index < mgr->num_heaps);
+
+   mtx_lock(&mgr->mutex);
+   mgr->buckets[bucket_index].max_cache_size = max_cache_size;
+   mtx_unlock(&mgr->mutex);
 }
 
 /**
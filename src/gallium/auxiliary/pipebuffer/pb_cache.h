@@ -38,19 +38,36 @@
  */
 struct pb_cache_entry
 {
-   struct list_head head;
+   struct list_head head; /**< In pb_cache_heap::buffers */
+   struct list_head size_head; /**< In pb_cache_heap::size_classes */
    struct pb_buffer *buffer; /**< Pointer to the structure this is part of. */
    struct pb_cache *mgr;
    int64_t start, end; /**< Caching time interval */
    unsigned bucket_index;
 };
 
+/* Buffers are also sorted by util_logbase2(size), so that a lookup only has
+ * to visit the few lists whose sizes can match.
+ */
+#define PB_CACHE_NUM_SIZE_CLASSES 64
+
+struct pb_cache_heap
+{
+   /* All buffers of the heap. This and the size class lists are ordered
+    * from the oldest to the most recently added buffer.
+    */
+   struct list_head buffers;
+   struct list_head size_classes[PB_CACHE_NUM_SIZE_CLASSES];
+   uint64_t cache_size;
+   uint64_t max_cache_size;
+};
+
 struct pb_cache
 {
    /* The cache is divided into buckets for minimizing cache misses.
     * The driver controls which buffer goes into which bucket.
     */
-   struct list_head *buckets;
+   struct pb_cache_heap *buckets;
 
    mtx_t mutex;
    uint64_t cache_size;
@@ -61,6 +78,11 @@ struct pb_cache
    unsigned bypass_usage;
    float size_factor;
 
+   /* Statistics for performance monitoring. */
+   uint64_t num_hits;
+   uint64_t num_misses;
+   uint64_t num_evictions; /* buffers released due to expiration or size */
+
    void (*destroy_buffer)(struct pb_buffer *buf);
    bool (*can_reclaim)(struct pb_buffer *buf);
 };
@@ -77,6 +99,8 @@ void pb_cache_init(struct pb_cache *mgr, uint num_heaps,
                    unsigned bypass_usage, uint64_t maximum_cache_size,
                    void (*destroy_buffer)(struct pb_buffer *buf),
                    bool (*can_reclaim)(struct pb_buffer *buf));
+void pb_cache_set_heap_max_size(struct pb_cache *mgr, unsigned bucket_index,
+                                uint64_t max_cache_size);
 void pb_cache_deinit(struct pb_cache *mgr);
 
 #endif
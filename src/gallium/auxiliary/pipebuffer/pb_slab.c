@@ -47,6 +47,8 @@ struct pb_slab_group
     * can be fully allocated as well.
     */
    struct list_head slabs;
+
+   struct pb_slab_stats stats;
 };
 
 
@@ -54,18 +56,20 @@ static void
 pb_slab_reclaim(struct pb_slabs *slabs, struct pb_slab_entry *entry)
 {
    struct pb_slab *slab = entry->slab;
+   struct pb_slab_group *group = &slabs->groups[entry->group_index];
 
    list_del(&entry->head); /* remove from reclaim list */
    list_add(&entry->head, &slab->free);
    slab->num_free++;
+   group->stats.num_allocated--;
 
    /* Add slab to the group's list if it isn't already linked. */
-   if (!slab->head.next) {
-      struct pb_slab_group *group = &slabs->groups[entry->group_index];
+   if (!slab->head.next)
       list_addtail(&slab->head, &group->slabs);
-   }
 
    if (slab->num_free >= slab->num_entries) {
+      group->stats.num_slabs--;
+      group->stats.num_entries -= slab->num_entries;
       list_del(&slab->head);
       slabs->slab_free(slabs->priv, slab);
    }
@@ -78,6 +82,7 @@ pb_slabs_reclaim_locked(struct pb_slabs *slabs)
       struct pb_slab_entry *entry =
          LIST_ENTRY(struct pb_slab_entry, slabs->reclaim.next, head);
 
+      slabs->num_reclaim_checks++;
       if (!slabs->can_reclaim(slabs->priv, entry))
          break;
 
@@ -142,11 +147,15 @@ pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned heap)
       mtx_lock(&slabs->mutex);
 
       list_add(&slab->head, &group->slabs);
+      group->stats.num_slabs++;
+      group->stats.num_entries += slab->num_entries;
    }
 
    entry = LIST_ENTRY(struct pb_slab_entry, slab->free.next, head);
    list_del(&entry->head);
    slab->num_free--;
+   group->stats.num_allocated++;
+   group->stats.num_allocs++;
 
    mtx_unlock(&slabs->mutex);
 
@@ -181,6 +190,45 @@ pb_slabs_reclaim(struct pb_slabs *slabs)
    mtx_unlock(&slabs->mutex);
 }
 
+/* Return the statistics of the size class with entries of 2^order bytes in
+ * the given heap.
+ */
+void
+pb_slabs_get_stats(struct pb_slabs *slabs, unsigned heap, unsigned order,
+                   struct pb_slab_stats *stats)
+{
+   assert(order >= slabs->min_order &&
+          order < slabs->min_order + slabs->num_orders);
+   assert(heap < slabs->num_heaps);
+
+   unsigned group_index = heap * slabs->num_orders + (order - slabs->min_order);
+
+   mtx_lock(&slabs->mutex);
+   *stats = slabs->groups[group_index].stats;
+   mtx_unlock(&slabs->mutex);
+}
+
+/* Return the total size of the entries of all slabs which are not handed out,
+ * i.e. memory which is allocated but not used by anything.
+ */
+uint64_t
+pb_slabs_get_unused_size(struct pb_slabs *slabs)
+{
+   unsigned num_groups = slabs->num_orders * slabs->num_heaps;
+   uint64_t size = 0;
+
+   mtx_lock(&slabs->mutex);
+   for (unsigned i = 0; i < num_groups; ++i) {
+      struct pb_slab_stats *stats = &slabs->groups[i].stats;
+      unsigned order = slabs->min_order + i % slabs->num_orders;
+
+      size += (uint64_t)(stats->num_entries - stats->num_allocated) << order;
+   }
+   mtx_unlock(&slabs->mutex);
+
+   return size;
+}
+
 /* Initialize the slabs manager.
  *
  * The minimum and maximum size of slab entries are 2^min_order and
@@ -213,6 +261,7 @@ pb_slabs_init(struct pb_slabs *slabs,
    slabs->slab_free = slab_free;
 
    list_inithead(&slabs->reclaim);
+   slabs->num_reclaim_checks = 0;
 
    num_groups = slabs->num_orders * slabs->num_heaps;
    slabs->groups = CALLOC(num_groups, sizeof(*slabs->groups));
@@ -78,6 +78,17 @@ struct pb_slab
    unsigned num_entries; /* total number of entries */
 };
 
+/* Statistics of one size class, i.e. of all slabs with the same heap and
+ * entry size.
+ */
+struct pb_slab_stats
+{
+   unsigned num_slabs; /* number of slabs currently allocated */
+   unsigned num_entries; /* total number of entries in those slabs */
+   unsigned num_allocated; /* entries handed out and not reclaimed yet */
+   uint64_t num_allocs; /* total number of pb_slab_alloc calls */
+};
+
 /* Callback function that is called when a new slab needs to be allocated
  * for fulfilling allocation requests of the given size from the given heap.
  *
@@ -125,6 +136,9 @@ struct pb_slabs
     */
    struct list_head reclaim;
 
+   /* Number of can_reclaim calls, for performance monitoring. */
+   uint64_t num_reclaim_checks;
+
    void *priv;
    slab_can_reclaim_fn *can_reclaim;
    slab_alloc_fn *slab_alloc;
@@ -140,6 +154,13 @@ pb_slab_free(struct pb_slabs* slabs, struct pb_slab_entry *entry);
 void
 pb_slabs_reclaim(struct pb_slabs *slabs);
 
+void
+pb_slabs_get_stats(struct pb_slabs *slabs, unsigned heap, unsigned order,
+                   struct pb_slab_stats *stats);
+
+uint64_t
+pb_slabs_get_unused_size(struct pb_slabs *slabs);
+
 bool
 pb_slabs_init(struct pb_slabs *slabs,
               unsigned min_order, unsigned max_order,
@@ -86,14 +86,121 @@ struct tgsi_double_vector {
    union tgsi_double_channel zw;
 };
 
+/*
+ * A channel holds the values of the 4 pixels/vertices of the quad, which
+ * maps directly onto an SSE2 or NEON register.  The compilers don't
+ * reliably vectorize the unrolled micro ops, so the common ALU ops and the
+ * stores are written with these helpers.  They must give bit-identical
+ * results to the scalar code, including for NaNs and negative zero, which
+ * is why min/max/saturate are built from compares on NEON.
+ */
+#if defined(PIPE_ARCH_SSE)
+
+#include <emmintrin.h>
+
+#define TGSI_EXEC_SIMD
+
+typedef __m128 simd_float;
+
+#define simd_load(chan)          _mm_loadu_ps((chan)->f)
+#define simd_store(chan, v)      _mm_storeu_ps((chan)->f, v)
+#define simd_splat(f)            _mm_set1_ps(f)
+#define simd_splat_u(u)          _mm_castsi128_ps(_mm_set1_epi32(u))
+#define simd_add(a, b)           _mm_add_ps(a, b)
+#define simd_sub(a, b)           _mm_sub_ps(a, b)
+#define simd_mul(a, b)           _mm_mul_ps(a, b)
+#define simd_and(a, b)           _mm_and_ps(a, b)
+#define simd_or(a, b)            _mm_or_ps(a, b)
+#define simd_xor(a, b)           _mm_xor_ps(a, b)
+#define simd_cmpeq(a, b)         _mm_cmpeq_ps(a, b)
+#define simd_cmpne(a, b)         _mm_cmpneq_ps(a, b)
+#define simd_cmpge(a, b)         _mm_cmpge_ps(a, b)
+#define simd_cmplt(a, b)         _mm_cmplt_ps(a, b)
+#define simd_cmpgt(a, b)         _mm_cmpgt_ps(a, b)
+/* a > b ? a : b, and a < b ? a : b, like the scalar code */
+#define simd_max(a, b)           _mm_max_ps(a, b)
+#define simd_min(a, b)           _mm_min_ps(a, b)
+
+static inline simd_float
+simd_select(simd_float mask, simd_float a, simd_float b)
+{
+   return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+#elif defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+#define TGSI_EXEC_SIMD
+
+typedef float32x4_t simd_float;
+
+#define simd_load(chan)          vld1q_f32((chan)->f)
+#define simd_store(chan, v)      vst1q_f32((chan)->f, v)
+#define simd_splat(f)            vdupq_n_f32(f)
+#define simd_splat_u(u)          vreinterpretq_f32_u32(vdupq_n_u32(u))
+#define simd_add(a, b)           vaddq_f32(a, b)
+#define simd_sub(a, b)           vsubq_f32(a, b)
+#define simd_mul(a, b)           vmulq_f32(a, b)
+#define simd_bitop(op, a, b) \
+   vreinterpretq_f32_u32(op(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)))
+#define simd_and(a, b)           simd_bitop(vandq_u32, a, b)
+#define simd_or(a, b)            simd_bitop(vorrq_u32, a, b)
+#define simd_xor(a, b)           simd_bitop(veorq_u32, a, b)
+#define simd_cmpeq(a, b)         vreinterpretq_f32_u32(vceqq_f32(a, b))
+#define simd_cmpne(a, b)         vreinterpretq_f32_u32(vmvnq_u32(vceqq_f32(a, b)))
+#define simd_cmpge(a, b)         vreinterpretq_f32_u32(vcgeq_f32(a, b))
+#define simd_cmplt(a, b)         vreinterpretq_f32_u32(vcltq_f32(a, b))
+#define simd_cmpgt(a, b)         vreinterpretq_f32_u32(vcgtq_f32(a, b))
+
+static inline simd_float
+simd_select(simd_float mask, simd_float a, simd_float b)
+{
+   return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+
+/* vmaxq/vminq return NaN if either input is NaN, the scalar code doesn't. */
+#define simd_max(a, b)           simd_select(simd_cmpgt(a, b), a, b)
+#define simd_min(a, b)           simd_select(simd_cmplt(a, b), a, b)
+
+#endif
+
+#ifdef TGSI_EXEC_SIMD
+/* Lane masks for each ExecMask value. */
+static const uint32_t simd_exec_masks[16][4] = {
+#define M(i) (((i) & 1) ? ~0u : 0), (((i) & 2) ? ~0u : 0), \
+             (((i) & 4) ? ~0u : 0), (((i) & 8) ? ~0u : 0)
+   { M(0) },  { M(1) },  { M(2) },  { M(3) },
+   { M(4) },  { M(5) },  { M(6) },  { M(7) },
+   { M(8) },  { M(9) },  { M(10) }, { M(11) },
+   { M(12) }, { M(13) }, { M(14) }, { M(15) },
+#undef M
+};
+
+static inline simd_float
+simd_exec_mask(uint execmask)
+{
+   const union tgsi_exec_channel *mask =
+      (const union tgsi_exec_channel *)simd_exec_masks[execmask & 0xf];
+   return simd_load(mask);
+}
+
+/* Compare result to 1.0f/0.0f. */
+#define simd_bool_to_float(mask) simd_and(mask, simd_splat(1.0f))
+#endif
+
 static void
 micro_abs(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_and(simd_load(src), simd_splat_u(0x7fffffff)));
+#else
    dst->f[0] = fabsf(src->f[0]);
    dst->f[1] = fabsf(src->f[1]);
    dst->f[2] = fabsf(src->f[2]);
    dst->f[3] = fabsf(src->f[3]);
+#endif
 }
 
 static void
@@ -529,10 +636,15 @@ micro_mad(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_add(simd_mul(simd_load(src0), simd_load(src1)),
+                            simd_load(src2)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0] + src2->f[0];
    dst->f[1] = src0->f[1] * src1->f[1] + src2->f[1];
    dst->f[2] = src0->f[2] * src1->f[2] + src2->f[2];
    dst->f[3] = src0->f[3] * src1->f[3] + src2->f[3];
+#endif
 }
 
 static void
@@ -602,10 +714,15 @@ micro_seq(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool_to_float(simd_cmpeq(simd_load(src0),
+                                                 simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] == src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] == src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] == src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] == src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -613,10 +730,15 @@ micro_sge(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool_to_float(simd_cmpge(simd_load(src0),
+                                                 simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] >= src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] >= src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] >= src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] >= src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -676,10 +798,15 @@ micro_slt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool_to_float(simd_cmplt(simd_load(src0),
+                                                 simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] < src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] < src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] < src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -687,10 +814,15 @@ micro_sne(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool_to_float(simd_cmpne(simd_load(src0),
+                                                 simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] != src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] != src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] != src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] != src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -1329,10 +1461,14 @@ micro_add(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_add(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] + src1->f[0];
    dst->f[1] = src0->f[1] + src1->f[1];
    dst->f[2] = src0->f[2] + src1->f[2];
    dst->f[3] = src0->f[3] + src1->f[3];
+#endif
 }
 
 static void
@@ -1374,10 +1510,14 @@ micro_max(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_max(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] > src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] > src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] > src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -1385,10 +1525,14 @@ micro_min(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_min(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] < src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] < src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] < src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -1396,10 +1540,14 @@ micro_mul(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_mul(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0];
    dst->f[1] = src0->f[1] * src1->f[1];
    dst->f[2] = src0->f[2] * src1->f[2];
    dst->f[3] = src0->f[3] * src1->f[3];
+#endif
 }
 
 static void
@@ -1407,10 +1555,14 @@ micro_neg(
    union tgsi_exec_channel *dst,
    const union tgsi_exec_channel *src )
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_xor(simd_load(src), simd_splat_u(0x80000000)));
+#else
    dst->f[0] = -src->f[0];
    dst->f[1] = -src->f[1];
    dst->f[2] = -src->f[2];
    dst->f[3] = -src->f[3];
+#endif
 }
 
 static void
@@ -1448,10 +1600,14 @@ micro_sub(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_sub(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] - src1->f[0];
    dst->f[1] = src0->f[1] - src1->f[1];
    dst->f[2] = src0->f[2] - src1->f[2];
    dst->f[3] = src0->f[3] - src1->f[3];
+#endif
 }
 
 static void
@@ -1945,12 +2101,28 @@ store_dest(struct tgsi_exec_machine *mach,
 {
    union tgsi_exec_channel *dst;
    const uint execmask = mach->ExecMask;
-   int i;
 
    dst = store_dest_dstret(mach, chan, reg, chan_index, dst_datatype);
    if (!dst)
       return;
 
+#ifdef TGSI_EXEC_SIMD
+   simd_float value = simd_load(chan);
+
+   if (inst->Instruction.Saturate) {
+      simd_float zero = simd_splat(0.0f), one = simd_splat(1.0f);
+
+      value = simd_select(simd_cmplt(value, zero), zero,
+                          simd_select(simd_cmpgt(value, one), one, value));
+   }
+
+   if ((execmask & 0xf) != 0xf)
+      value = simd_select(simd_exec_mask(execmask), value, simd_load(dst));
+
+   simd_store(dst, value);
+#else
+   int i;
+
    if (!inst->Instruction.Saturate) {
       for (i = 0; i < TGSI_QUAD_SIZE; i++)
          if (execmask & (1 << i))
@@ -1967,6 +2139,7 @@ store_dest(struct tgsi_exec_machine *mach,
                dst->i[i] = chan->i[i];
          }
    }
+#endif
 }
 
 #define FETCH(VAL,INDEX,CHAN)\
@@ -4626,10 +4799,14 @@ micro_and(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_and(simd_load(src0), simd_load(src1)));
+#else
    dst->u[0] = src0->u[0] & src1->u[0];
    dst->u[1] = src0->u[1] & src1->u[1];
    dst->u[2] = src0->u[2] & src1->u[2];
    dst->u[3] = src0->u[3] & src1->u[3];
+#endif
 }
 
 static void
@@ -4637,10 +4814,14 @@ micro_or(union tgsi_exec_channel *dst,
          const union tgsi_exec_channel *src0,
          const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_or(simd_load(src0), simd_load(src1)));
+#else
    dst->u[0] = src0->u[0] | src1->u[0];
    dst->u[1] = src0->u[1] | src1->u[1];
    dst->u[2] = src0->u[2] | src1->u[2];
    dst->u[3] = src0->u[3] | src1->u[3];
+#endif
 }
 
 static void
@@ -4648,10 +4829,14 @@ micro_xor(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#ifdef TGSI_EXEC_SIMD
+   simd_store(dst, simd_xor(simd_load(src0), simd_load(src1)));
+#else
    dst->u[0] = src0->u[0] ^ src1->u[0];
    dst->u[1] = src0->u[1] ^ src1->u[1];
    dst->u[2] = src0->u[2] ^ src1->u[2];
    dst->u[3] = src0->u[3] ^ src1->u[3];
+#endif
 }
 
 static void
@@ -39,6 +39,10 @@ struct translate *translate_create( const struct translate_key *key )
    struct translate *translate = NULL;
 
 #if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
+   translate = translate_avx2_create( key );
+   if (translate)
+      return translate;
+
    translate = translate_sse2_create( key );
    if (translate)
       return translate;
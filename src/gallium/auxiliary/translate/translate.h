@@ -159,6 +159,8 @@ static inline void translate_key_sanitize( struct translate_key *a )
 /*******************************************************************************
  *  Private:
  */
+struct translate *translate_avx2_create( const struct translate_key *key );
+
 struct translate *translate_sse2_create( const struct translate_key *key );
 
 struct translate *translate_generic_create( const struct translate_key *key );
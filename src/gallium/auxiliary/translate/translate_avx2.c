@@ -0,0 +1,699 @@
+/**************************************************************************
+ *
+ * Copyright 2021 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * AVX2 vertex translation.
+ *
+ * Eight vertices are processed at a time: the input dwords of each element
+ * are fetched with 32-bit gathers, unpacked to float SoA, and transposed
+ * back to AoS for the stores.  Any plain RGB format whose channels fit in a
+ * dword is handled this way (so 8/16/32-bit unorm/snorm/scaled, half, float
+ * and the 10_10_10_2 family), converting to 32-bit float or 8-bit unorm
+ * RGBA/BGRA.
+ *
+ * Everything else -- instanced elements, instance ids, pure integers,
+ * doubles, the remaining output formats and same-format copies, which
+ * translate_sse2 already does faster with plain moves -- is handed over to a
+ * translate_sse2 (or translate_generic) object built for just those
+ * elements, so every key is accepted as long as one element is vectorized.
+ *
+ * The functions are compiled with target attributes and only selected when
+ * util_cpu_caps reports AVX2, so no special compiler flags are needed.
+ */
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/u_cpu_detect.h"
+#include "util/format/u_format.h"
+
+#include "translate.h"
+
+
+#if defined(PIPE_ARCH_X86_64) && defined(USE_SSE41)
+
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2,f16c")))
+
+
+enum avx2_emit {
+   AVX2_EMIT_FLOAT,
+   AVX2_EMIT_RGBA8,
+   AVX2_EMIT_BGRA8
+};
+
+struct translate_avx2_channel {
+   enum util_format_type type;
+   unsigned dword;
+   unsigned shift;
+   unsigned size;
+   float scale;
+};
+
+struct translate_avx2_element {
+   unsigned buffer;
+   unsigned input_offset;
+   unsigned output_offset;
+
+   /* dwords covering one input vertex, and how many bytes of the last one
+    * lie past the end of the vertex
+    */
+   unsigned nr_dwords;
+   unsigned overread;
+
+   unsigned nr_channels;
+   struct translate_avx2_channel channel[4];
+   unsigned char swizzle[4];
+
+   enum avx2_emit emit;
+   /* float components written per vertex */
+   unsigned nr_outputs;
+
+   const uint8_t *input_ptr;
+   unsigned input_stride;
+   unsigned max_index;
+
+   /* Indices up to gather_max can be fetched with gathers without reading
+    * past the end of the buffer.  Only valid if gather is set.
+    */
+   boolean gather;
+   unsigned gather_max;
+};
+
+struct translate_avx2 {
+   struct translate translate;
+
+   struct translate_avx2_element element[TRANSLATE_MAX_ATTRIBS];
+   unsigned nr_elements;
+
+   /* Elements that can't be vectorized, or NULL. */
+   struct translate *fallback;
+};
+
+
+static struct translate_avx2 *
+translate_avx2(struct translate *translate)
+{
+   return (struct translate_avx2 *)translate;
+}
+
+
+/**
+ * Load the input dwords of eight vertices, dword[k] holding dword k of each.
+ */
+static inline AVX2 void
+avx2_fetch(const struct translate_avx2_element *e, __m256i idx,
+           __m256i dword[4])
+{
+   unsigned k;
+
+   if (e->gather) {
+      const __m256i max = _mm256_set1_epi32(e->gather_max);
+      const __m256i safe = _mm256_cmpeq_epi32(_mm256_max_epu32(idx, max), max);
+
+      if (_mm256_movemask_ps(_mm256_castsi256_ps(safe)) == 0xff) {
+         const __m256i offset =
+            _mm256_mullo_epi32(idx, _mm256_set1_epi32(e->input_stride));
+
+         for (k = 0; k < e->nr_dwords; k++)
+            dword[k] = _mm256_i32gather_epi32((const int *)(e->input_ptr + k * 4),
+                                              offset, 1);
+         return;
+      }
+   }
+
+   {
+      uint32_t index[8];
+      uint32_t column[4][8];
+      unsigned i;
+
+      _mm256_storeu_si256((__m256i *)index, idx);
+
+      for (i = 0; i < 8; i++) {
+         uint32_t data[4] = {0};
+
+         memcpy(data,
+                e->input_ptr + (ptrdiff_t)e->input_stride * index[i],
+                e->nr_dwords * 4 - e->overread);
+
+         for (k = 0; k < e->nr_dwords; k++)
+            column[k][i] = data[k];
+      }
+
+      for (k = 0; k < e->nr_dwords; k++)
+         dword[k] = _mm256_loadu_si256((const __m256i *)column[k]);
+   }
+}
+
+
+static inline AVX2 __m256
+avx2_unpack_channel(const struct translate_avx2_channel *c,
+                    const __m256i dword[4])
+{
+   __m256i value = dword[c->dword];
+   __m256 f;
+
+   switch (c->type) {
+   case UTIL_FORMAT_TYPE_FLOAT:
+      if (c->size == 32)
+         return _mm256_castsi256_ps(value);
+
+      value = _mm256_and_si256(_mm256_srli_epi32(value, c->shift),
+                               _mm256_set1_epi32(0xffff));
+      value = _mm256_permute4x64_epi64(_mm256_packus_epi32(value, value), 0x08);
+      return _mm256_cvtph_ps(_mm256_castsi256_si128(value));
+
+   case UTIL_FORMAT_TYPE_SIGNED:
+      if (c->size < 32) {
+         value = _mm256_slli_epi32(value, 32 - c->shift - c->size);
+         value = _mm256_srai_epi32(value, 32 - c->size);
+      }
+      f = _mm256_cvtepi32_ps(value);
+      break;
+
+   default:
+      assert(c->type == UTIL_FORMAT_TYPE_UNSIGNED);
+      if (c->size < 32) {
+         value = _mm256_and_si256(_mm256_srli_epi32(value, c->shift),
+                                  _mm256_set1_epi32((1u << c->size) - 1));
+         f = _mm256_cvtepi32_ps(value);
+      } else {
+         /* No unsigned conversion before AVX-512, so convert the halves;
+          * the sum is exact before the final rounding.
+          */
+         __m256 hi = _mm256_cvtepi32_ps(_mm256_srli_epi32(value, 16));
+         __m256 lo = _mm256_cvtepi32_ps(_mm256_and_si256(value,
+                                        _mm256_set1_epi32(0xffff)));
+         f = _mm256_add_ps(_mm256_mul_ps(hi, _mm256_set1_ps(65536.0f)), lo);
+      }
+      break;
+   }
+
+   if (c->scale != 1.0f)
+      f = _mm256_mul_ps(f, _mm256_set1_ps(c->scale));
+
+   return f;
+}
+
+
+/**
+ * Transpose four SoA vectors into eight AoS vertices.
+ */
+static inline AVX2 void
+avx2_transpose(const __m256 soa[4], __m128 aos[8])
+{
+   __m256 t0 = _mm256_unpacklo_ps(soa[0], soa[1]);
+   __m256 t1 = _mm256_unpackhi_ps(soa[0], soa[1]);
+   __m256 t2 = _mm256_unpacklo_ps(soa[2], soa[3]);
+   __m256 t3 = _mm256_unpackhi_ps(soa[2], soa[3]);
+   __m256 v0 = _mm256_shuffle_ps(t0, t2, 0x44);
+   __m256 v1 = _mm256_shuffle_ps(t0, t2, 0xee);
+   __m256 v2 = _mm256_shuffle_ps(t1, t3, 0x44);
+   __m256 v3 = _mm256_shuffle_ps(t1, t3, 0xee);
+
+   aos[0] = _mm256_castps256_ps128(v0);
+   aos[1] = _mm256_castps256_ps128(v1);
+   aos[2] = _mm256_castps256_ps128(v2);
+   aos[3] = _mm256_castps256_ps128(v3);
+   aos[4] = _mm256_extractf128_ps(v0, 1);
+   aos[5] = _mm256_extractf128_ps(v1, 1);
+   aos[6] = _mm256_extractf128_ps(v2, 1);
+   aos[7] = _mm256_extractf128_ps(v3, 1);
+}
+
+
+static inline AVX2 void
+avx2_store_aos(const struct translate_avx2_element *e, const __m256 soa[4],
+               unsigned count, uint8_t *vert, unsigned stride)
+{
+   __m128 aos[8];
+   unsigned i;
+
+   avx2_transpose(soa, aos);
+
+   if (e->nr_outputs == 4) {
+      for (i = 0; i < count; i++)
+         _mm_storeu_ps((float *)(vert + i * stride), aos[i]);
+   } else {
+      const __m128i mask = _mm_cmpgt_epi32(_mm_set1_epi32(e->nr_outputs),
+                                           _mm_setr_epi32(0, 1, 2, 3));
+
+      for (i = 0; i < count; i++)
+         _mm_maskstore_ps((float *)(vert + i * stride), mask, aos[i]);
+   }
+}
+
+
+static inline AVX2 void
+avx2_run_element(const struct translate_avx2_element *e, __m256i elts,
+                 unsigned count, uint8_t *vert, unsigned stride)
+{
+   __m256i idx = _mm256_min_epu32(elts, _mm256_set1_epi32(e->max_index));
+   __m256i dword[4];
+   __m256 channel[4];
+   __m256 rgba[4];
+   unsigned i;
+
+   avx2_fetch(e, idx, dword);
+
+   vert += e->output_offset;
+
+   for (i = 0; i < e->nr_channels; i++) {
+      if (e->channel[i].type != UTIL_FORMAT_TYPE_VOID)
+         channel[i] = avx2_unpack_channel(&e->channel[i], dword);
+      else
+         channel[i] = _mm256_setzero_ps();
+   }
+
+   for (i = 0; i < 4; i++) {
+      switch (e->swizzle[i]) {
+      case PIPE_SWIZZLE_X:
+      case PIPE_SWIZZLE_Y:
+      case PIPE_SWIZZLE_Z:
+      case PIPE_SWIZZLE_W:
+         rgba[i] = channel[e->swizzle[i]];
+         break;
+      case PIPE_SWIZZLE_1:
+         rgba[i] = _mm256_set1_ps(1.0f);
+         break;
+      default:
+         rgba[i] = _mm256_setzero_ps();
+         break;
+      }
+   }
+
+   if (e->emit == AVX2_EMIT_FLOAT) {
+      avx2_store_aos(e, rgba, count, vert, stride);
+   } else {
+      /* Like translate_generic's TO_8_UNORM, but clamped. */
+      const __m256 scale = _mm256_set1_ps(255.0f);
+      __m256i packed = _mm256_setzero_si256();
+      uint32_t out[8];
+
+      for (i = 0; i < 4; i++) {
+         unsigned c = (e->emit == AVX2_EMIT_BGRA8 && i != 3) ? 2 - i : i;
+         __m256 f = _mm256_min_ps(_mm256_max_ps(rgba[c], _mm256_setzero_ps()),
+                                  _mm256_set1_ps(1.0f));
+         __m256i b = _mm256_cvttps_epi32(_mm256_mul_ps(f, scale));
+
+         packed = _mm256_or_si256(packed, _mm256_slli_epi32(b, i * 8));
+      }
+
+      _mm256_storeu_si256((__m256i *)out, packed);
+      for (i = 0; i < count; i++)
+         memcpy(vert + i * stride, &out[i], 4);
+   }
+}
+
+
+static inline AVX2 void
+avx2_run_block(const struct translate_avx2 *ta, __m256i elts,
+               unsigned count, uint8_t *vert)
+{
+   const unsigned stride = ta->translate.key.output_stride;
+   unsigned i;
+
+   for (i = 0; i < ta->nr_elements; i++)
+      avx2_run_element(&ta->element[i], elts, count, vert, stride);
+}
+
+
+/**
+ * Pad a partial block of indices with its first one, so that every lane
+ * fetches a valid vertex.
+ */
+static inline AVX2 __m256i
+avx2_partial_elts(const unsigned *elts, unsigned count)
+{
+   unsigned padded[8];
+   unsigned i;
+
+   for (i = 0; i < 8; i++)
+      padded[i] = elts[i < count ? i : 0];
+
+   return _mm256_loadu_si256((const __m256i *)padded);
+}
+
+
+static AVX2 void PIPE_CDECL
+avx2_run_elts(struct translate *translate,
+              const unsigned *elts,
+              unsigned count,
+              unsigned start_instance,
+              unsigned instance_id,
+              void *output_buffer)
+{
+   struct translate_avx2 *ta = translate_avx2(translate);
+   const unsigned stride = translate->key.output_stride;
+   uint8_t *vert = output_buffer;
+   unsigned i;
+
+   for (i = 0; i + 8 <= count; i += 8) {
+      avx2_run_block(ta, _mm256_loadu_si256((const __m256i *)(elts + i)),
+                     8, vert + i * stride);
+   }
+
+   if (i < count) {
+      avx2_run_block(ta, avx2_partial_elts(elts + i, count - i),
+                     count - i, vert + i * stride);
+   }
+
+   if (ta->fallback) {
+      ta->fallback->run_elts(ta->fallback, elts, count,
+                             start_instance, instance_id, output_buffer);
+   }
+}
+
+
+static AVX2 void PIPE_CDECL
+avx2_run_elts16(struct translate *translate,
+                const uint16_t *elts,
+                unsigned count,
+                unsigned start_instance,
+                unsigned instance_id,
+                void *output_buffer)
+{
+   struct translate_avx2 *ta = translate_avx2(translate);
+   const unsigned stride = translate->key.output_stride;
+   uint8_t *vert = output_buffer;
+   unsigned i, j;
+
+   for (i = 0; i + 8 <= count; i += 8) {
+      __m128i e16 = _mm_loadu_si128((const __m128i *)(elts + i));
+      avx2_run_block(ta, _mm256_cvtepu16_epi32(e16), 8, vert + i * stride);
+   }
+
+   if (i < count) {
+      unsigned e32[8];
+      for (j = 0; j < count - i; j++)
+         e32[j] = elts[i + j];
+      avx2_run_block(ta, avx2_partial_elts(e32, count - i),
+                     count - i, vert + i * stride);
+   }
+
+   if (ta->fallback) {
+      ta->fallback->run_elts16(ta->fallback, elts, count,
+                               start_instance, instance_id, output_buffer);
+   }
+}
+
+
+static AVX2 void PIPE_CDECL
+avx2_run_elts8(struct translate *translate,
+               const uint8_t *elts,
+               unsigned count,
+               unsigned start_instance,
+               unsigned instance_id,
+               void *output_buffer)
+{
+   struct translate_avx2 *ta = translate_avx2(translate);
+   const unsigned stride = translate->key.output_stride;
+   uint8_t *vert = output_buffer;
+   unsigned i, j;
+
+   for (i = 0; i + 8 <= count; i += 8) {
+      __m128i e8 = _mm_loadl_epi64((const __m128i *)(elts + i));
+      avx2_run_block(ta, _mm256_cvtepu8_epi32(e8), 8, vert + i * stride);
+   }
+
+   if (i < count) {
+      unsigned e32[8];
+      for (j = 0; j < count - i; j++)
+         e32[j] = elts[i + j];
+      avx2_run_block(ta, avx2_partial_elts(e32, count - i),
+                     count - i, vert + i * stride);
+   }
+
+   if (ta->fallback) {
+      ta->fallback->run_elts8(ta->fallback, elts, count,
+                              start_instance, instance_id, output_buffer);
+   }
+}
+
+
+static AVX2 void PIPE_CDECL
+avx2_run(struct translate *translate,
+         unsigned start,
+         unsigned count,
+         unsigned start_instance,
+         unsigned instance_id,
+         void *output_buffer)
+{
+   struct translate_avx2 *ta = translate_avx2(translate);
+   const unsigned stride = translate->key.output_stride;
+   const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+   uint8_t *vert = output_buffer;
+   unsigned i;
+
+   for (i = 0; i < count; i += 8) {
+      __m256i elts = _mm256_add_epi32(_mm256_set1_epi32(start + i), lanes);
+      avx2_run_block(ta, elts, MIN2(count - i, 8), vert + i * stride);
+   }
+
+   if (ta->fallback) {
+      ta->fallback->run(ta->fallback, start, count,
+                        start_instance, instance_id, output_buffer);
+   }
+}
+
+
+static void
+avx2_set_buffer(struct translate *translate,
+                unsigned buf,
+                const void *ptr,
+                unsigned stride,
+                unsigned max_index)
+{
+   struct translate_avx2 *ta = translate_avx2(translate);
+   unsigned i;
+
+   for (i = 0; i < ta->nr_elements; i++) {
+      struct translate_avx2_element *e = &ta->element[i];
+
+      if (e->buffer != buf)
+         continue;
+
+      e->input_ptr = (const uint8_t *)ptr + e->input_offset;
+      e->input_stride = stride;
+      e->max_index = max_index;
+
+      /* The last dword of a vertex may extend past the end of the buffer,
+       * and gather offsets are signed 32-bit.  Blocks with vertices beyond
+       * gather_max are read with memcpy instead.
+       */
+      e->gather = TRUE;
+      e->gather_max = max_index;
+      if (e->overread) {
+         if (stride < e->overread || max_index == 0)
+            e->gather = FALSE;
+         else
+            e->gather_max = max_index - 1;
+      }
+      if (stride)
+         e->gather_max = MIN2(e->gather_max, (INT32_MAX - 16) / stride);
+   }
+
+   if (ta->fallback)
+      ta->fallback->set_buffer(ta->fallback, buf, ptr, stride, max_index);
+}
+
+
+static void
+avx2_release(struct translate *translate)
+{
+   struct translate_avx2 *ta = translate_avx2(translate);
+
+   if (ta->fallback)
+      ta->fallback->release(ta->fallback);
+
+   FREE(ta);
+}
+
+
+static boolean
+avx2_init_element(struct translate_avx2_element *e,
+                  const struct translate_element *elem)
+{
+   const struct util_format_description *desc =
+      util_format_description(elem->input_format);
+   unsigned i;
+
+   if (elem->type != TRANSLATE_ELEMENT_NORMAL || elem->instance_divisor ||
+       elem->input_format == elem->output_format)
+      return FALSE;
+
+   if (!desc ||
+       desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       (desc->block.bits & 7) || desc->block.bits > 128)
+      return FALSE;
+
+   e->buffer = elem->input_buffer;
+   e->input_offset = elem->input_offset;
+   e->output_offset = elem->output_offset;
+   e->nr_dwords = DIV_ROUND_UP(desc->block.bits, 32);
+   e->overread = e->nr_dwords * 4 - desc->block.bits / 8;
+
+   switch (elem->output_format) {
+   case PIPE_FORMAT_R32_FLOAT:
+   case PIPE_FORMAT_R32G32_FLOAT:
+   case PIPE_FORMAT_R32G32B32_FLOAT:
+   case PIPE_FORMAT_R32G32B32A32_FLOAT:
+      e->emit = AVX2_EMIT_FLOAT;
+      e->nr_outputs =
+         util_format_description(elem->output_format)->nr_channels;
+      break;
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+      e->emit = AVX2_EMIT_RGBA8;
+      break;
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+      e->emit = AVX2_EMIT_BGRA8;
+      break;
+   default:
+      return FALSE;
+   }
+
+   e->nr_channels = desc->nr_channels;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      const struct util_format_channel_description *chan = &desc->channel[i];
+      struct translate_avx2_channel *c = &e->channel[i];
+
+      c->type = chan->type;
+      c->dword = chan->shift / 32;
+      c->shift = chan->shift % 32;
+      c->size = chan->size;
+      c->scale = 1.0f;
+
+      if (chan->type == UTIL_FORMAT_TYPE_VOID)
+         continue;
+
+      if (chan->pure_integer || c->shift + c->size > 32)
+         return FALSE;
+
+      switch (chan->type) {
+      case UTIL_FORMAT_TYPE_UNSIGNED:
+         /* Wider normalized channels are converted in double precision by
+          * u_format.
+          */
+         if (chan->normalized) {
+            if (c->size > 23)
+               return FALSE;
+            c->scale = 1.0f / (float)((1u << c->size) - 1);
+         }
+         break;
+      case UTIL_FORMAT_TYPE_SIGNED:
+         if (chan->normalized) {
+            if (c->size > 23)
+               return FALSE;
+            c->scale = 1.0f / (float)((1u << (c->size - 1)) - 1);
+         }
+         break;
+      case UTIL_FORMAT_TYPE_FLOAT:
+         if (c->size == 16 && !util_cpu_caps.has_f16c)
+            return FALSE;
+         if (c->size != 16 && c->size != 32)
+            return FALSE;
+         break;
+      default:
+         return FALSE;
+      }
+   }
+
+   for (i = 0; i < 4; i++)
+      e->swizzle[i] = desc->swizzle[i];
+
+   return TRUE;
+}
+
+
+struct translate *
+translate_avx2_create(const struct translate_key *key)
+{
+   struct translate_avx2 *ta;
+   struct translate_key fallback_key;
+   unsigned i;
+
+   if (!util_cpu_caps.has_avx2)
+      return NULL;
+
+   ta = CALLOC_STRUCT(translate_avx2);
+   if (!ta)
+      return NULL;
+
+   ta->translate.key = *key;
+   ta->translate.release = avx2_release;
+   ta->translate.set_buffer = avx2_set_buffer;
+   ta->translate.run_elts = avx2_run_elts;
+   ta->translate.run_elts16 = avx2_run_elts16;
+   ta->translate.run_elts8 = avx2_run_elts8;
+   ta->translate.run = avx2_run;
+
+   fallback_key.output_stride = key->output_stride;
+   fallback_key.nr_elements = 0;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      if (avx2_init_element(&ta->element[ta->nr_elements], &key->element[i])) {
+         ta->nr_elements++;
+      } else {
+         memset(&ta->element[ta->nr_elements], 0, sizeof ta->element[0]);
+         fallback_key.element[fallback_key.nr_elements++] = key->element[i];
+      }
+   }
+
+   /* Nothing to vectorize; let the other backends have the whole key. */
+   if (!ta->nr_elements)
+      goto fail;
+
+   if (fallback_key.nr_elements) {
+      ta->fallback = translate_sse2_create(&fallback_key);
+      if (!ta->fallback)
+         ta->fallback = translate_generic_create(&fallback_key);
+      if (!ta->fallback)
+         goto fail;
+   }
+
+   return &ta->translate;
+
+ fail:
+   FREE(ta);
+   return NULL;
+}
+
+
+#else
+
+struct translate *
+translate_avx2_create(const struct translate_key *key)
+{
+   return NULL;
+}
+
+#endif
@@ -148,6 +148,16 @@ struct blitter_context_priv
    bool cube_as_2darray;
    bool cached_all_shaders;
 
+   /* State set by the blitter since the last restore.  Draws of the same
+    * operation and the restore skip setting it again when it's unchanged,
+    * so drivers don't re-validate it.
+    */
+   struct pipe_viewport_state viewport;
+   unsigned sample_mask;
+   bool viewport_dirty;
+   bool sample_mask_dirty;
+   bool so_targets_dirty;
+
    /* The Draw module overrides these functions.
     * Always create the blitter before Draw. */
    void   (*bind_fs_state)(struct pipe_context *, void *);
@@ -582,12 +592,21 @@ void util_blitter_set_texture_multisample(struct blitter_context *blitter,
 
 void util_blitter_set_running_flag(struct blitter_context *blitter)
 {
+   struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
+
    if (blitter->running) {
       _debug_printf("u_blitter:%i: Caught recursion. This is a driver bug.\n",
                     __LINE__);
    }
    blitter->running = true;
 
+   /* The application may have changed any of these since the last
+    * operation.
+    */
+   ctx->viewport_dirty = false;
+   ctx->sample_mask_dirty = false;
+   ctx->so_targets_dirty = false;
+
    blitter->pipe->set_active_query_state(blitter->pipe, false);
 }
 
@@ -635,15 +654,18 @@ void util_blitter_restore_vertex_states(struct blitter_context *blitter)
    pipe->bind_vs_state(pipe, ctx->base.saved_vs);
    ctx->base.saved_vs = INVALID_PTR;
 
-   /* Geometry shader. */
+   /* Geometry shader.  It was left alone if none was bound. */
    if (ctx->has_geometry_shader) {
-      pipe->bind_gs_state(pipe, ctx->base.saved_gs);
+      if (ctx->base.saved_gs)
+         pipe->bind_gs_state(pipe, ctx->base.saved_gs);
       ctx->base.saved_gs = INVALID_PTR;
    }
 
    if (ctx->has_tessellation) {
-      pipe->bind_tcs_state(pipe, ctx->base.saved_tcs);
-      pipe->bind_tes_state(pipe, ctx->base.saved_tes);
+      if (ctx->base.saved_tcs)
+         pipe->bind_tcs_state(pipe, ctx->base.saved_tcs);
+      if (ctx->base.saved_tes)
+         pipe->bind_tes_state(pipe, ctx->base.saved_tes);
       ctx->base.saved_tcs = INVALID_PTR;
       ctx->base.saved_tes = INVALID_PTR;
    }
@@ -653,9 +675,12 @@ void util_blitter_restore_vertex_states(struct blitter_context *blitter)
       unsigned offsets[PIPE_MAX_SO_BUFFERS];
       for (i = 0; i < ctx->base.saved_num_so_targets; i++)
          offsets[i] = (unsigned)-1;
-      pipe->set_stream_output_targets(pipe,
-                                      ctx->base.saved_num_so_targets,
-                                      ctx->base.saved_so_targets, offsets);
+      if (ctx->base.saved_num_so_targets || ctx->so_targets_dirty) {
+         pipe->set_stream_output_targets(pipe,
+                                         ctx->base.saved_num_so_targets,
+                                         ctx->base.saved_so_targets, offsets);
+      }
+      ctx->so_targets_dirty = false;
 
       for (i = 0; i < ctx->base.saved_num_so_targets; i++)
          pipe_so_target_reference(&ctx->base.saved_so_targets[i], NULL);
@@ -694,9 +719,12 @@ void util_blitter_restore_fragment_states(struct blitter_context *blitter)
 
    /* Sample mask. */
    if (ctx->base.is_sample_mask_saved) {
-      pipe->set_sample_mask(pipe, ctx->base.saved_sample_mask);
+      if (ctx->sample_mask_dirty &&
+          ctx->sample_mask != ctx->base.saved_sample_mask)
+         pipe->set_sample_mask(pipe, ctx->base.saved_sample_mask);
       ctx->base.is_sample_mask_saved = false;
    }
+   ctx->sample_mask_dirty = false;
 
    /* Miscellaneous states. */
    /* XXX check whether these are saved and whether they need to be restored
@@ -705,6 +733,7 @@ void util_blitter_restore_fragment_states(struct blitter_context *blitter)
 
    if (!blitter->skip_viewport_restore)
       pipe->set_viewport_states(pipe, 0, 1, &ctx->base.saved_viewport);
+   ctx->viewport_dirty = false;
 
    if (blitter->saved_num_window_rectangles) {
       pipe->set_window_rectangles(pipe,
@@ -808,13 +837,52 @@ static void blitter_set_rectangle(struct blitter_context_priv *ctx,
 
    /* viewport */
    struct pipe_viewport_state viewport;
+   memset(&viewport, 0, sizeof(viewport));
    viewport.scale[0] = 0.5f * ctx->dst_width;
    viewport.scale[1] = 0.5f * ctx->dst_height;
    viewport.scale[2] = 0.0f;
    viewport.translate[0] = 0.5f * ctx->dst_width;
    viewport.translate[1] = 0.5f * ctx->dst_height;
    viewport.translate[2] = depth;
+
+   if (ctx->viewport_dirty &&
+       !memcmp(&viewport, &ctx->viewport, sizeof(viewport)))
+      return;
+
    ctx->base.pipe->set_viewport_states(ctx->base.pipe, 0, 1, &viewport);
+   ctx->viewport = viewport;
+   ctx->viewport_dirty = true;
+}
+
+static void blitter_set_sample_mask(struct blitter_context_priv *ctx,
+                                    unsigned sample_mask)
+{
+   /* Compare against what was set last, either by the blitter or by the
+    * application if the blitter hasn't changed it yet.
+    */
+   if (ctx->sample_mask_dirty ? ctx->sample_mask == sample_mask :
+       ctx->base.is_sample_mask_saved &&
+       ctx->base.saved_sample_mask == sample_mask)
+      return;
+
+   ctx->base.pipe->set_sample_mask(ctx->base.pipe, sample_mask);
+   ctx->sample_mask = sample_mask;
+   ctx->sample_mask_dirty = true;
+}
+
+/* Unbind the geometry and tessellation shaders unless they already are. */
+static void blitter_unbind_gs_tess(struct blitter_context_priv *ctx)
+{
+   struct pipe_context *pipe = ctx->base.pipe;
+
+   if (ctx->has_geometry_shader && ctx->base.saved_gs)
+      pipe->bind_gs_state(pipe, NULL);
+   if (ctx->has_tessellation) {
+      if (ctx->base.saved_tcs)
+         pipe->bind_tcs_state(pipe, NULL);
+      if (ctx->base.saved_tes)
+         pipe->bind_tes_state(pipe, NULL);
+   }
 }
 
 static void blitter_set_clear_color(struct blitter_context_priv *ctx,
@@ -1310,14 +1378,11 @@ static void blitter_set_common_draw_rect_state(struct blitter_context_priv *ctx,
 
    pipe->bind_rasterizer_state(pipe, ctx->rs_state[scissor][msaa]);
 
-   if (ctx->has_geometry_shader)
-      pipe->bind_gs_state(pipe, NULL);
-   if (ctx->has_tessellation) {
-      pipe->bind_tcs_state(pipe, NULL);
-      pipe->bind_tes_state(pipe, NULL);
-   }
-   if (ctx->has_stream_out)
+   blitter_unbind_gs_tess(ctx);
+   if (ctx->has_stream_out && ctx->base.saved_num_so_targets) {
       pipe->set_stream_output_targets(pipe, 0, NULL, NULL);
+      ctx->so_targets_dirty = true;
+   }
 }
 
 static void blitter_draw(struct blitter_context_priv *ctx,
@@ -1460,7 +1525,7 @@ void util_blitter_common_clear_setup(struct blitter_context *blitter,
       pipe->bind_depth_stencil_alpha_state(pipe, ctx->dsa_keep_depth_stencil);
    }
 
-   pipe->set_sample_mask(pipe, ~0);
+   blitter_set_sample_mask(ctx, ~0);
    blitter_set_dst_dimensions(ctx, width, height);
 }
 
@@ -1794,7 +1859,7 @@ static void do_blits(struct blitter_context_priv *ctx,
       pipe->set_framebuffer_state(pipe, &fb_state);
 
       /* Draw. */
-      pipe->set_sample_mask(pipe, ~0);
+      blitter_set_sample_mask(ctx, ~0);
       blitter_draw_tex(ctx, dstbox->x, dstbox->y,
                        dstbox->x + dstbox->width,
                        dstbox->y + dstbox->height,
@@ -1843,7 +1908,7 @@ static void do_blits(struct blitter_context_priv *ctx,
             unsigned i, max_sample = dst_samples - 1;
 
             for (i = 0; i <= max_sample; i++) {
-               pipe->set_sample_mask(pipe, 1 << i);
+               blitter_set_sample_mask(ctx, 1 << i);
                blitter_draw_tex(ctx, dstbox->x, dstbox->y,
                                 dstbox->x + dstbox->width,
                                 dstbox->y + dstbox->height,
@@ -1856,7 +1921,7 @@ static void do_blits(struct blitter_context_priv *ctx,
             }
          } else {
             /* Normal copy, MSAA upsampling, or MSAA resolve. */
-            pipe->set_sample_mask(pipe, ~0);
+            blitter_set_sample_mask(ctx, ~0);
             blitter_draw_tex(ctx, dstbox->x, dstbox->y,
                              dstbox->x + dstbox->width,
                              dstbox->y + dstbox->height,
@@ -2282,7 +2347,7 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
    fb_state.cbufs[0] = dstsurf;
    fb_state.zsbuf = 0;
    pipe->set_framebuffer_state(pipe, &fb_state);
-   pipe->set_sample_mask(pipe, ~0);
+   blitter_set_sample_mask(ctx, ~0);
    msaa = util_framebuffer_get_num_samples(&fb_state) > 1;
 
    blitter_set_dst_dimensions(ctx, dstsurf->width, dstsurf->height);
@@ -2365,7 +2430,7 @@ void util_blitter_clear_depth_stencil(struct blitter_context *blitter,
    fb_state.cbufs[0] = 0;
    fb_state.zsbuf = dstsurf;
    pipe->set_framebuffer_state(pipe, &fb_state);
-   pipe->set_sample_mask(pipe, ~0);
+   blitter_set_sample_mask(ctx, ~0);
 
    blitter_set_dst_dimensions(ctx, dstsurf->width, dstsurf->height);
 
@@ -2434,7 +2499,7 @@ void util_blitter_custom_depth_stencil(struct blitter_context *blitter,
    }
    fb_state.zsbuf = zsurf;
    pipe->set_framebuffer_state(pipe, &fb_state);
-   pipe->set_sample_mask(pipe, sample_mask);
+   blitter_set_sample_mask(ctx, sample_mask);
 
    blitter_set_common_draw_rect_state(ctx, false,
       util_framebuffer_get_num_samples(&fb_state) > 1);
@@ -2499,16 +2564,12 @@ void util_blitter_copy_buffer(struct blitter_context *blitter,
    pipe->set_vertex_buffers(pipe, ctx->base.vb_slot, 1, &vb);
    pipe->bind_vertex_elements_state(pipe, ctx->velem_state_readbuf[0]);
    bind_vs_pos_only(ctx, 1);
-   if (ctx->has_geometry_shader)
-      pipe->bind_gs_state(pipe, NULL);
-   if (ctx->has_tessellation) {
-      pipe->bind_tcs_state(pipe, NULL);
-      pipe->bind_tes_state(pipe, NULL);
-   }
+   blitter_unbind_gs_tess(ctx);
    pipe->bind_rasterizer_state(pipe, ctx->rs_discard_state);
 
    so_target = pipe->create_stream_output_target(pipe, dst, dstx, size);
    pipe->set_stream_output_targets(pipe, 1, &so_target, offsets);
+   ctx->so_targets_dirty = true;
 
    util_draw_arrays(pipe, PIPE_PRIM_POINTS, 0, size / 4);
 
@@ -2566,16 +2627,12 @@ void util_blitter_clear_buffer(struct blitter_context *blitter,
    pipe->bind_vertex_elements_state(pipe,
                                     ctx->velem_state_readbuf[num_channels-1]);
    bind_vs_pos_only(ctx, num_channels);
-   if (ctx->has_geometry_shader)
-      pipe->bind_gs_state(pipe, NULL);
-   if (ctx->has_tessellation) {
-      pipe->bind_tcs_state(pipe, NULL);
-      pipe->bind_tes_state(pipe, NULL);
-   }
+   blitter_unbind_gs_tess(ctx);
    pipe->bind_rasterizer_state(pipe, ctx->rs_discard_state);
 
    so_target = pipe->create_stream_output_target(pipe, dst, offset, size);
    pipe->set_stream_output_targets(pipe, 1, &so_target, offsets);
+   ctx->so_targets_dirty = true;
 
    util_draw_arrays(pipe, PIPE_PRIM_POINTS, 0, size / 4);
 
@@ -2612,7 +2669,7 @@ void util_blitter_custom_resolve_color(struct blitter_context *blitter,
    pipe->bind_blend_state(pipe, custom_blend);
    pipe->bind_depth_stencil_alpha_state(pipe, ctx->dsa_keep_depth_stencil);
    bind_fs_write_one_cbuf(ctx);
-   pipe->set_sample_mask(pipe, sample_mask);
+   blitter_set_sample_mask(ctx, sample_mask);
 
    memset(&surf_tmpl, 0, sizeof(surf_tmpl));
    surf_tmpl.format = format;
@@ -2677,7 +2734,7 @@ void util_blitter_custom_color(struct blitter_context *blitter,
                                              : ctx->blend[PIPE_MASK_RGBA][0]);
    pipe->bind_depth_stencil_alpha_state(pipe, ctx->dsa_keep_depth_stencil);
    bind_fs_write_one_cbuf(ctx);
-   pipe->set_sample_mask(pipe, (1ull << MAX2(1, dstsurf->texture->nr_samples)) - 1);
+   blitter_set_sample_mask(ctx, (1ull << MAX2(1, dstsurf->texture->nr_samples)) - 1);
 
    /* set a framebuffer state */
    fb_state.width = dstsurf->width;
@@ -2686,7 +2743,7 @@ void util_blitter_custom_color(struct blitter_context *blitter,
    fb_state.cbufs[0] = dstsurf;
    fb_state.zsbuf = 0;
    pipe->set_framebuffer_state(pipe, &fb_state);
-   pipe->set_sample_mask(pipe, ~0);
+   blitter_set_sample_mask(ctx, ~0);
 
    blitter_set_common_draw_rect_state(ctx, false,
       util_framebuffer_get_num_samples(&fb_state) > 1);
@@ -2740,7 +2797,7 @@ void util_blitter_custom_shader(struct blitter_context *blitter,
    pipe->bind_blend_state(pipe, ctx->blend[PIPE_MASK_RGBA][0]);
    pipe->bind_depth_stencil_alpha_state(pipe, ctx->dsa_keep_depth_stencil);
    pipe->bind_fs_state(pipe, custom_fs);
-   pipe->set_sample_mask(pipe, (1ull << MAX2(1, dstsurf->texture->nr_samples)) - 1);
+   blitter_set_sample_mask(ctx, (1ull << MAX2(1, dstsurf->texture->nr_samples)) - 1);
 
    /* set a framebuffer state */
    fb_state.width = dstsurf->width;
@@ -2748,7 +2805,7 @@ void util_blitter_custom_shader(struct blitter_context *blitter,
    fb_state.nr_cbufs = 1;
    fb_state.cbufs[0] = dstsurf;
    pipe->set_framebuffer_state(pipe, &fb_state);
-   pipe->set_sample_mask(pipe, ~0);
+   blitter_set_sample_mask(ctx, ~0);
 
    blitter_set_common_draw_rect_state(ctx, false,
       util_framebuffer_get_num_samples(&fb_state) > 1);
@@ -164,3 +164,206 @@ void util_compute_blit(struct pipe_context *ctx, struct pipe_blit_info *blit_inf
    ctx->delete_sampler_state(ctx, sampler_state_p);
    ctx->bind_compute_state(ctx, NULL);
 }
+
+/* Each 8x8 thread block writes an 8x8 tile of level N+1 with a bilinear
+ * sample of level N.  If CONST[0][1].z is set, the block also keeps its tile
+ * in shared memory and averages it down to a 4x4 tile of level N+2, which is
+ * exact because the caller only does that when level N+1 has even
+ * dimensions.
+ */
+static void *gen_mipmap_compute_shader(struct pipe_context *ctx)
+{
+   static const char text[] =
+      "COMP\n"
+      "PROPERTY CS_FIXED_BLOCK_WIDTH 8\n"
+      "PROPERTY CS_FIXED_BLOCK_HEIGHT 8\n"
+      "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+      "DCL SV[0], THREAD_ID\n"
+      "DCL SV[1], BLOCK_ID\n"
+      "DCL IMAGE[0], 2D_ARRAY, PIPE_FORMAT_R32G32B32A32_FLOAT, WR\n"
+      "DCL IMAGE[1], 2D_ARRAY, PIPE_FORMAT_R32G32B32A32_FLOAT, WR\n"
+      "DCL SAMP[0]\n"
+      "DCL SVIEW[0], 2D_ARRAY, FLOAT\n"
+      "DCL MEMORY[0], SHARED\n"
+      "DCL CONST[0][0..2]\n" // 0: 1/N+1 size, 1: N+1 size + flag, 2: N+2 size
+      "DCL TEMP[0..8], LOCAL\n"
+      "IMM[0] UINT32 {8, 1, 0, 16}\n"
+      "IMM[1] FLT32 {0.5, 0.25, 0.0, 0.0}\n"
+      "IMM[2] UINT32 {0, 16, 128, 144}\n"
+
+      /* Level N+1 texel and layer. */
+      "UMAD TEMP[0].xy, SV[1].xyyy, IMM[0].xxxx, SV[0].xyyy\n"
+      "MOV TEMP[0].z, SV[1].zzzz\n"
+      "U2F TEMP[1].xyz, TEMP[0]\n"
+      "ADD TEMP[1].xy, TEMP[1].xyyy, IMM[1].xxxx\n"
+      "MUL TEMP[1].xy, TEMP[1].xyyy, CONST[0][0].xyyy\n"
+      "TEX_LZ TEMP[2], TEMP[1], SAMP[0], 2D_ARRAY\n"
+      "USLT TEMP[3].xy, TEMP[0].xyyy, CONST[0][1].xyyy\n"
+      "AND TEMP[3].x, TEMP[3].xxxx, TEMP[3].yyyy\n"
+      "UIF TEMP[3].xxxx\n"
+      "  STORE IMAGE[0], TEMP[0].xyzz, TEMP[2], 2D_ARRAY, PIPE_FORMAT_R32G32B32A32_FLOAT\n"
+      "ENDIF\n"
+
+      "UIF CONST[0][1].zzzz\n"
+      "  UMAD TEMP[4].x, SV[0].yyyy, IMM[0].xxxx, SV[0].xxxx\n"
+      "  UMUL TEMP[4].x, TEMP[4].xxxx, IMM[0].wwww\n"
+      "  STORE MEMORY[0].xyzw, TEMP[4].xxxx, TEMP[2]\n"
+      "  BARRIER\n"
+      /* Only the top-left thread of each 2x2 quad writes level N+2. */
+      "  OR TEMP[5].x, SV[0].xxxx, SV[0].yyyy\n"
+      "  AND TEMP[5].x, TEMP[5].xxxx, IMM[0].yyyy\n"
+      "  USEQ TEMP[5].x, TEMP[5].xxxx, IMM[0].zzzz\n"
+      "  USHR TEMP[6].xy, TEMP[0].xyyy, IMM[0].yyyy\n"
+      "  MOV TEMP[6].z, TEMP[0].zzzz\n"
+      "  USLT TEMP[3].xy, TEMP[6].xyyy, CONST[0][2].xyyy\n"
+      "  AND TEMP[3].x, TEMP[3].xxxx, TEMP[3].yyyy\n"
+      "  AND TEMP[3].x, TEMP[3].xxxx, TEMP[5].xxxx\n"
+      "  UIF TEMP[3].xxxx\n"
+      "    UADD TEMP[4].yzw, TEMP[4].xxxx, IMM[2]\n"
+      "    LOAD TEMP[7], MEMORY[0], TEMP[4].xxxx\n"
+      "    LOAD TEMP[8], MEMORY[0], TEMP[4].yyyy\n"
+      "    ADD TEMP[7], TEMP[7], TEMP[8]\n"
+      "    LOAD TEMP[8], MEMORY[0], TEMP[4].zzzz\n"
+      "    ADD TEMP[7], TEMP[7], TEMP[8]\n"
+      "    LOAD TEMP[8], MEMORY[0], TEMP[4].wwww\n"
+      "    ADD TEMP[7], TEMP[7], TEMP[8]\n"
+      "    MUL TEMP[7], TEMP[7], IMM[1].yyyy\n"
+      "    STORE IMAGE[1], TEMP[6].xyzz, TEMP[7], 2D_ARRAY, PIPE_FORMAT_R32G32B32A32_FLOAT\n"
+      "  ENDIF\n"
+      "ENDIF\n"
+      "END\n";
+
+   struct tgsi_token tokens[1024];
+   struct pipe_compute_state state = {0};
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      assert(false);
+      return NULL;
+   }
+
+   state.ir_type = PIPE_SHADER_IR_TGSI;
+   state.prog = tokens;
+   state.req_local_mem = 8 * 8 * 4 * sizeof(float);
+
+   return ctx->create_compute_state(ctx, &state);
+}
+
+/**
+ * Generate mipmap levels base_level+1..last_level of a 2D, 2D array or cube
+ * texture with compute dispatches, two levels per dispatch where possible.
+ *
+ * Returns false without touching the context if the texture or format can't
+ * be handled, in which case the caller should fall back to util_gen_mipmap.
+ * The compute shader, sampler views, images and constant buffer 0 are left
+ * unbound.
+ */
+bool util_compute_gen_mipmap(struct pipe_context *ctx, struct pipe_resource *pt,
+                             enum pipe_format format, unsigned base_level,
+                             unsigned last_level, unsigned first_layer,
+                             unsigned last_layer, void **compute_state)
+{
+   struct pipe_screen *screen = ctx->screen;
+
+   if (pt->target != PIPE_TEXTURE_2D &&
+       pt->target != PIPE_TEXTURE_2D_ARRAY &&
+       pt->target != PIPE_TEXTURE_CUBE &&
+       pt->target != PIPE_TEXTURE_CUBE_ARRAY)
+      return false;
+
+   if (pt->nr_samples > 1 ||
+       util_format_is_depth_or_stencil(format) ||
+       util_format_is_pure_integer(format) ||
+       util_format_is_srgb(format) ||
+       !screen->is_format_supported(screen, format, pt->target, 0, 0,
+                                    PIPE_BIND_SAMPLER_VIEW |
+                                    PIPE_BIND_SHADER_IMAGE))
+      return false;
+
+   if (!*compute_state)
+     *compute_state = gen_mipmap_compute_shader(ctx);
+   if (!*compute_state)
+      return false;
+
+   struct pipe_sampler_state sampler_state = {0};
+   sampler_state.wrap_s = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler_state.wrap_t = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler_state.wrap_r = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler_state.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler_state.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler_state.normalized_coords = 1;
+
+   void *sampler_state_p = ctx->create_sampler_state(ctx, &sampler_state);
+   ctx->bind_sampler_states(ctx, PIPE_SHADER_COMPUTE, 0, 1, &sampler_state_p);
+   ctx->bind_compute_state(ctx, *compute_state);
+
+   for (unsigned level = base_level; level < last_level;) {
+      unsigned width = u_minify(pt->width0, level + 1);
+      unsigned height = u_minify(pt->height0, level + 1);
+      bool two_levels = level + 2 <= last_level &&
+                        width % 2 == 0 && height % 2 == 0;
+
+      unsigned data[] = {u_bitcast_f2u(1.0f / width),
+                         u_bitcast_f2u(1.0f / height),
+                         0,
+                         0,
+                         width,
+                         height,
+                         two_levels ? ~0u : 0,
+                         0,
+                         width / 2,
+                         height / 2,
+                         0,
+                         0};
+
+      struct pipe_constant_buffer cb = {0};
+      cb.buffer_size = sizeof(data);
+      cb.user_buffer = data;
+      ctx->set_constant_buffer(ctx, PIPE_SHADER_COMPUTE, 0, &cb);
+
+      struct pipe_sampler_view src_templ = {0}, *src_view;
+      u_sampler_view_default_template(&src_templ, pt, format);
+      src_templ.target = PIPE_TEXTURE_2D_ARRAY;
+      src_templ.u.tex.first_level = src_templ.u.tex.last_level = level;
+      src_templ.u.tex.first_layer = first_layer;
+      src_templ.u.tex.last_layer = last_layer;
+      src_view = ctx->create_sampler_view(ctx, pt, &src_templ);
+      ctx->set_sampler_views(ctx, PIPE_SHADER_COMPUTE, 0, 1, &src_view);
+
+      /* IMAGE[1] is unused for single-level dispatches. */
+      struct pipe_image_view images[2];
+      for (unsigned i = 0; i < 2; i++) {
+         memset(&images[i], 0, sizeof(images[i]));
+         images[i].resource = pt;
+         images[i].shader_access = images[i].access = PIPE_IMAGE_ACCESS_WRITE;
+         images[i].format = format;
+         images[i].u.tex.level = level + 1 + (two_levels ? i : 0);
+         images[i].u.tex.first_layer = first_layer;
+         images[i].u.tex.last_layer = last_layer;
+      }
+      ctx->set_shader_images(ctx, PIPE_SHADER_COMPUTE, 0, 2, images);
+
+      struct pipe_grid_info grid_info = {0};
+      grid_info.block[0] = 8;
+      grid_info.block[1] = 8;
+      grid_info.block[2] = 1;
+      grid_info.grid[0] = DIV_ROUND_UP(width, 8);
+      grid_info.grid[1] = DIV_ROUND_UP(height, 8);
+      grid_info.grid[2] = last_layer - first_layer + 1;
+
+      ctx->launch_grid(ctx, &grid_info);
+
+      /* The next dispatch samples what this one stored. */
+      ctx->memory_barrier(ctx, PIPE_BARRIER_ALL);
+
+      ctx->set_sampler_views(ctx, PIPE_SHADER_COMPUTE, 0, 1, NULL);
+      pipe_sampler_view_reference(&src_view, NULL);
+
+      level += two_levels ? 2 : 1;
+   }
+
+   ctx->set_shader_images(ctx, PIPE_SHADER_COMPUTE, 0, 2, NULL);
+   ctx->set_constant_buffer(ctx, PIPE_SHADER_COMPUTE, 0, NULL);
+   ctx->delete_sampler_state(ctx, sampler_state_p);
+   ctx->bind_compute_state(ctx, NULL);
+   return true;
+}
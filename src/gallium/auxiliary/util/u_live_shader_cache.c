@@ -96,19 +96,22 @@ util_live_shader_cache_get(struct pipe_context *ctx,
       return NULL;
    }
 
-   /* Compute SHA1 of pipe_shader_state. */
-   struct mesa_sha1 sha1_ctx;
+   /* Compute the key of pipe_shader_state.  The cache is only kept in
+    * memory, so it doesn't need a cryptographic hash.
+    */
    unsigned char sha1[20];
-   _mesa_sha1_init(&sha1_ctx);
-   _mesa_sha1_update(&sha1_ctx, ir_binary, ir_size);
+   _mesa_fast_key_compute(ir_binary, ir_size, sha1);
    if ((stage == PIPE_SHADER_VERTEX ||
         stage == PIPE_SHADER_TESS_EVAL ||
         stage == PIPE_SHADER_GEOMETRY) &&
        state->stream_output.num_outputs) {
-      _mesa_sha1_update(&sha1_ctx, &state->stream_output,
-                        sizeof(state->stream_output));
+      uint8_t key[sizeof(sha1) + sizeof(state->stream_output)];
+
+      memcpy(key, sha1, sizeof(sha1));
+      memcpy(key + sizeof(sha1), &state->stream_output,
+             sizeof(state->stream_output));
+      _mesa_fast_key_compute(key, sizeof(key), sha1);
    }
-   _mesa_sha1_final(&sha1_ctx, sha1);
 
    if (ir_binary == blob.data)
       blob_finish(&blob);
@@ -438,6 +438,8 @@ u_pipe_screen_get_param_defaults(struct pipe_screen *pscreen,
       return 0;
 
    case PIPE_CAP_NO_CLIP_ON_COPY_TEX:
+   case PIPE_CAP_CONSTBUF_PARTIAL_UPDATES:
+   case PIPE_CAP_SHAREABLE_CSOS:
       return 0;
 
    default:
@@ -30,6 +30,11 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_upload_mgr.h"
+#include "util/os_time.h"
+
+#if defined(PIPE_ARCH_SSE)
+#include <xmmintrin.h>
+#endif
 
 /* 0 = disabled, 1 = assertions, 2 = printfs */
 #define TC_DEBUG 0
@@ -80,9 +85,8 @@ tc_debug_check(struct threaded_context *tc)
 }
 
 static void
-tc_batch_execute(void *job, UNUSED int thread_index)
+tc_batch_execute(struct tc_batch *batch)
 {
-   struct tc_batch *batch = job;
    struct pipe_context *pipe = batch->pipe;
    struct tc_call *last = &batch->call[batch->num_total_call_slots];
 
@@ -100,6 +104,76 @@ tc_batch_execute(void *job, UNUSED int thread_index)
    batch->num_total_call_slots = 0;
 }
 
+/* Wait until the application thread has submitted more than "executed"
+ * batches. Return false if the thread should exit instead.
+ */
+static bool
+tc_thread_wait(struct threaded_context *tc, unsigned executed)
+{
+   int64_t start = os_time_get_nano();
+
+   /* Poll for a while first, which is much cheaper than sleeping if the
+    * next batch arrives soon.
+    */
+   do {
+      for (unsigned i = 0; i < 64; i++) {
+         if (p_atomic_read(&tc->num_submitted) != executed)
+            return true;
+#if defined(PIPE_ARCH_SSE)
+         _mm_pause();
+#endif
+      }
+   } while (os_time_get_nano() - start < TC_SPIN_NS);
+
+   /* Go to sleep. The application thread only takes the lock if it sees
+    * thread_sleeping set after incrementing num_submitted, and we only check
+    * num_submitted after setting thread_sleeping, so one of us always sees
+    * the other. (p_atomic_xchg and p_atomic_inc are full barriers)
+    */
+   mtx_lock(&tc->thread_lock);
+   p_atomic_xchg(&tc->thread_sleeping, 1);
+
+   while (p_atomic_read(&tc->num_submitted) == executed && !tc->thread_quit)
+      cnd_wait(&tc->thread_cond, &tc->thread_lock);
+
+   p_atomic_xchg(&tc->thread_sleeping, 0);
+   mtx_unlock(&tc->thread_lock);
+
+   return p_atomic_read(&tc->num_submitted) != executed;
+}
+
+static int
+tc_thread_func(void *input)
+{
+   struct threaded_context *tc = input;
+   unsigned executed = 0;
+   unsigned slot = 0;
+
+   u_thread_setname("gdrv0");
+
+   while (tc_thread_wait(tc, executed)) {
+      struct tc_batch *batch = &tc->batch_slots[slot];
+
+      tc_batch_execute(batch);
+      util_queue_fence_signal(&batch->fence);
+
+      executed++;
+      slot = (slot + 1) % TC_MAX_BATCHES;
+   }
+   return 0;
+}
+
+/* Wake up the driver thread if it's sleeping. */
+static void
+tc_thread_wake(struct threaded_context *tc)
+{
+   if (p_atomic_read(&tc->thread_sleeping)) {
+      mtx_lock(&tc->thread_lock);
+      cnd_signal(&tc->thread_cond);
+      mtx_unlock(&tc->thread_lock);
+   }
+}
+
 static void
 tc_batch_flush(struct threaded_context *tc)
 {
@@ -109,6 +183,7 @@ tc_batch_flush(struct threaded_context *tc)
    tc_batch_check(next);
    tc_debug_check(tc);
    tc->bytes_mapped_estimate = 0;
+   tc->last_multi_draw = NULL;
    p_atomic_add(&tc->num_offloaded_slots, next->num_total_call_slots);
 
    if (next->token) {
@@ -116,10 +191,20 @@ tc_batch_flush(struct threaded_context *tc)
       tc_unflushed_batch_token_reference(&next->token, NULL);
    }
 
-   util_queue_add_job(&tc->queue, next, &next->fence, tc_batch_execute,
-                      NULL, 0);
+   /* Publish the batch. The fence is signalled by the driver thread after
+    * the batch is executed.
+    */
+   util_queue_fence_reset(&next->fence);
+   p_atomic_inc(&tc->num_submitted);
+   tc_thread_wake(tc);
+
    tc->last = tc->next;
    tc->next = (tc->next + 1) % TC_MAX_BATCHES;
+
+   /* Wait until the driver thread is done with the slot we are going to
+    * record into. This is what bounds the number of waiting batches.
+    */
+   util_queue_fence_wait(&tc->batch_slots[tc->next].fence);
 }
 
 /* This is the function that adds variable-sized calls into the current
@@ -206,7 +291,8 @@ _tc_sync(struct threaded_context *tc, UNUSED const char *info, UNUSED const char
    if (next->num_total_call_slots) {
       p_atomic_add(&tc->num_direct_slots, next->num_total_call_slots);
       tc->bytes_mapped_estimate = 0;
-      tc_batch_execute(next, 0);
+      tc->last_multi_draw = NULL;
+      tc_batch_execute(next);
       synced = true;
    }
 
@@ -252,11 +338,63 @@ threaded_context_flush(struct pipe_context *_pipe,
    }
 }
 
+/* Remember that a buffer may be used by the calls recorded since the last
+ * flush, see tc_is_buffer_busy.
+ */
 static void
-tc_set_resource_reference(struct pipe_resource **dst, struct pipe_resource *src)
+tc_touch_buffer(struct threaded_context *tc, struct pipe_resource *res)
+{
+   struct threaded_resource *tres = threaded_resource(res);
+
+   if (res->target != PIPE_BUFFER)
+      return;
+
+   if (tres->last_tc != tc) {
+      if (tres->last_tc)
+         tres->multi_context = true;
+      tres->last_tc = tc;
+   }
+   tres->last_seqno = tc->seqno;
+}
+
+static void
+tc_set_resource_reference(struct threaded_context *tc,
+                          struct pipe_resource **dst, struct pipe_resource *src)
 {
    *dst = NULL;
    pipe_resource_reference(dst, src);
+   if (src)
+      tc_touch_buffer(tc, src);
+}
+
+/* Update one of the binding slots of threaded_context, which only track
+ * buffers.
+ */
+static void
+tc_bind_buffer(struct threaded_context *tc, struct pipe_resource **slot,
+               struct pipe_resource *res)
+{
+   if (res && res->target != PIPE_BUFFER)
+      res = NULL;
+
+   if (*slot == res)
+      return;
+
+   if (*slot)
+      p_atomic_dec(&threaded_resource(*slot)->bind_count);
+   if (res) {
+      p_atomic_inc(&threaded_resource(res)->bind_count);
+      tc_touch_buffer(tc, res);
+   }
+   *slot = res;
+}
+
+static void
+tc_unbind_buffers(struct threaded_context *tc, struct pipe_resource **slots,
+                  unsigned count)
+{
+   for (unsigned i = 0; i < count; i++)
+      tc_bind_buffer(tc, &slots[i], NULL);
 }
 
 void
@@ -269,6 +407,10 @@ threaded_resource_init(struct pipe_resource *res)
    tres->base_valid_buffer_range = &tres->valid_buffer_range;
    tres->is_shared = false;
    tres->is_user_ptr = false;
+   tres->last_tc = NULL;
+   tres->last_seqno = 0;
+   tres->multi_context = false;
+   tres->bind_count = 0;
 }
 
 void
@@ -475,7 +617,7 @@ tc_get_query_result_resource(struct pipe_context *_pipe,
    p->wait = wait;
    p->result_type = result_type;
    p->index = index;
-   tc_set_resource_reference(&p->resource, resource);
+   tc_set_resource_reference(tc, &p->resource, resource);
    p->offset = offset;
 }
 
@@ -687,6 +829,9 @@ tc_set_constant_buffer(struct pipe_context *_pipe,
    p->shader = shader;
    p->index = index;
 
+   tc_bind_buffer(tc, &tc->const_buffers[shader][index],
+                  cb && !cb->user_buffer ? cb->buffer : NULL);
+
    if (cb) {
       if (cb->user_buffer) {
          p->cb.buffer_size = cb->buffer_size;
@@ -694,7 +839,7 @@ tc_set_constant_buffer(struct pipe_context *_pipe,
          p->cb.buffer_offset = offset;
          p->cb.buffer = buffer;
       } else {
-         tc_set_resource_reference(&p->cb.buffer,
+         tc_set_resource_reference(tc, &p->cb.buffer,
                                    cb->buffer);
          memcpy(&p->cb, cb, sizeof(*cb));
       }
@@ -823,9 +968,12 @@ tc_set_sampler_views(struct pipe_context *_pipe,
       for (unsigned i = 0; i < count; i++) {
          p->slot[i] = NULL;
          pipe_sampler_view_reference(&p->slot[i], views[i]);
+         tc_bind_buffer(tc, &tc->sampler_buffers[shader][start + i],
+                        views[i] ? views[i]->texture : NULL);
       }
    } else {
       memset(p->slot, 0, count * sizeof(views[0]));
+      tc_unbind_buffers(tc, &tc->sampler_buffers[shader][start], count);
    }
 }
 
@@ -873,7 +1021,9 @@ tc_set_shader_images(struct pipe_context *_pipe,
 
    if (images) {
       for (unsigned i = 0; i < count; i++) {
-         tc_set_resource_reference(&p->slot[i].resource, images[i].resource);
+         tc_set_resource_reference(tc, &p->slot[i].resource, images[i].resource);
+         tc_bind_buffer(tc, &tc->image_buffers[shader][start + i],
+                        images[i].resource);
 
          if (images[i].access & PIPE_IMAGE_ACCESS_WRITE &&
              images[i].resource &&
@@ -887,6 +1037,8 @@ tc_set_shader_images(struct pipe_context *_pipe,
          }
       }
       memcpy(p->slot, images, count * sizeof(images[0]));
+   } else {
+      tc_unbind_buffers(tc, &tc->image_buffers[shader][start], count);
    }
 }
 
@@ -941,7 +1093,9 @@ tc_set_shader_buffers(struct pipe_context *_pipe,
          struct pipe_shader_buffer *dst = &p->slot[i];
          const struct pipe_shader_buffer *src = buffers + i;
 
-         tc_set_resource_reference(&dst->buffer, src->buffer);
+         tc_set_resource_reference(tc, &dst->buffer, src->buffer);
+         tc_bind_buffer(tc, &tc->shader_buffers[shader][start + i],
+                        src->buffer);
          dst->buffer_offset = src->buffer_offset;
          dst->buffer_size = src->buffer_size;
 
@@ -953,6 +1107,8 @@ tc_set_shader_buffers(struct pipe_context *_pipe,
                            src->buffer_offset + src->buffer_size);
          }
       }
+   } else {
+      tc_unbind_buffers(tc, &tc->shader_buffers[shader][start], count);
    }
 }
 
@@ -1005,8 +1161,10 @@ tc_set_vertex_buffers(struct pipe_context *_pipe,
          tc_assert(!src->is_user_buffer);
          dst->stride = src->stride;
          dst->is_user_buffer = false;
-         tc_set_resource_reference(&dst->buffer.resource,
+         tc_set_resource_reference(tc, &dst->buffer.resource,
                                    src->buffer.resource);
+         tc_bind_buffer(tc, &tc->vertex_buffers[start + i],
+                        src->buffer.resource);
          dst->buffer_offset = src->buffer_offset;
       }
    } else {
@@ -1015,6 +1173,8 @@ tc_set_vertex_buffers(struct pipe_context *_pipe,
       p->start = start;
       p->count = count;
       p->unbind = true;
+
+      tc_unbind_buffers(tc, &tc->vertex_buffers[start], count);
    }
 }
 
@@ -1051,6 +1211,11 @@ tc_set_stream_output_targets(struct pipe_context *_pipe,
       pipe_so_target_reference(&p->targets[i], tgs[i]);
    }
    p->count = count;
+
+   for (unsigned i = 0; i < PIPE_MAX_SO_BUFFERS; i++) {
+      tc_bind_buffer(tc, &tc->streamout_buffers[i],
+                     i < count && tgs[i] ? tgs[i]->buffer : NULL);
+   }
    memcpy(p->offsets, offsets, count * sizeof(unsigned));
 }
 
@@ -1340,11 +1505,42 @@ tc_invalidate_buffer(struct threaded_context *tc,
                                tc_replace_buffer_storage);
 
    p->func = tc->replace_buffer_storage;
-   tc_set_resource_reference(&p->dst, &tbuf->b);
-   tc_set_resource_reference(&p->src, new_buf);
+   tc_set_resource_reference(tc, &p->dst, &tbuf->b);
+   tc_set_resource_reference(tc, &p->src, new_buf);
    return true;
 }
 
+/* Whether the buffer can be in use by the GPU or by calls that haven't been
+ * flushed by the driver yet. Only the latter are tracked here, the former is
+ * up to the driver.
+ */
+static bool
+tc_is_buffer_busy(struct threaded_context *tc, struct threaded_resource *tres,
+                  unsigned usage)
+{
+   unsigned flushed_seqno = p_atomic_read(&tc->flushed_seqno);
+
+   if (!tc->is_resource_busy || tres->is_shared || tres->multi_context)
+      return true;
+
+   if (tres->last_tc) {
+      /* We don't know anything about the calls of other contexts. */
+      if (tres->last_tc != tc)
+         return true;
+
+      /* Referenced by an unflushed call. */
+      if ((int)(tres->last_seqno - flushed_seqno) > 0)
+         return true;
+   }
+
+   /* Bound and used by an unflushed draw or dispatch. */
+   if (p_atomic_read(&tres->bind_count) &&
+       (int)(tc->draw_seqno - flushed_seqno) > 0)
+      return true;
+
+   return tc->is_resource_busy(tc->base.screen, tres->latest, usage);
+}
+
 static unsigned
 tc_improve_map_buffer_flags(struct threaded_context *tc,
                             struct threaded_resource *tres, unsigned usage,
@@ -1409,6 +1605,13 @@ tc_improve_map_buffer_flags(struct threaded_context *tc,
        !util_ranges_intersect(&tres->valid_buffer_range, offset, offset + size))
       usage |= PIPE_TRANSFER_UNSYNCHRONIZED;
 
+   /* The same if the buffer is idle. This is cheaper than invalidating it,
+    * and it doesn't need a staging buffer or a thread sync.
+    */
+   if (!(usage & PIPE_TRANSFER_UNSYNCHRONIZED) &&
+       !tc_is_buffer_busy(tc, tres, usage))
+      usage |= PIPE_TRANSFER_UNSYNCHRONIZED;
+
    if (!(usage & PIPE_TRANSFER_UNSYNCHRONIZED)) {
       /* If discarding the entire range, discard the whole resource instead. */
       if (usage & PIPE_TRANSFER_DISCARD_RANGE &&
@@ -1474,7 +1677,7 @@ tc_transfer_map(struct pipe_context *_pipe,
             return NULL;
          }
 
-         tc_set_resource_reference(&ttrans->b.resource, resource);
+         tc_set_resource_reference(tc, &ttrans->b.resource, resource);
          ttrans->b.level = 0;
          ttrans->b.usage = usage;
          ttrans->b.box = *box;
@@ -1703,7 +1906,7 @@ tc_buffer_subdata(struct pipe_context *_pipe,
    struct tc_buffer_subdata *p =
       tc_add_slot_based_call(tc, TC_CALL_buffer_subdata, tc_buffer_subdata, size);
 
-   tc_set_resource_reference(&p->resource, resource);
+   tc_set_resource_reference(tc, &p->resource, resource);
    p->usage = usage;
    p->offset = offset;
    p->size = size;
@@ -1752,7 +1955,7 @@ tc_texture_subdata(struct pipe_context *_pipe,
       struct tc_texture_subdata *p =
          tc_add_slot_based_call(tc, TC_CALL_texture_subdata, tc_texture_subdata, size);
 
-      tc_set_resource_reference(&p->resource, resource);
+      tc_set_resource_reference(tc, &p->resource, resource);
       p->level = level;
       p->usage = usage;
       p->box = *box;
@@ -1971,7 +2174,7 @@ tc_set_context_param(struct pipe_context *_pipe,
 
    if (param == PIPE_CONTEXT_PARAM_PIN_THREADS_TO_L3_CACHE) {
       /* Pin the gallium thread as requested. */
-      util_pin_thread_to_L3(tc->queue.threads[0], value,
+      util_pin_thread_to_L3(tc->thread, value,
                             util_cpu_caps.cores_per_L3);
 
       /* Execute this immediately (without enqueuing).
@@ -2002,6 +2205,7 @@ struct tc_flush_payload {
    struct threaded_context *tc;
    struct pipe_fence_handle *fence;
    unsigned flags;
+   unsigned seqno;
 };
 
 static void
@@ -2028,8 +2232,10 @@ tc_call_flush(struct pipe_context *pipe, union tc_payload *payload)
    pipe->flush(pipe, p->fence ? &p->fence : NULL, p->flags);
    screen->fence_reference(screen, &p->fence, NULL);
 
-   if (!(p->flags & PIPE_FLUSH_DEFERRED))
+   if (!(p->flags & PIPE_FLUSH_DEFERRED)) {
       tc_flush_queries(p->tc);
+      p_atomic_set(&p->tc->flushed_seqno, p->seqno);
+   }
 }
 
 static void
@@ -2076,9 +2282,12 @@ tc_flush(struct pipe_context *_pipe, struct pipe_fence_handle **fence,
       p->tc = tc;
       p->fence = fence ? *fence : NULL;
       p->flags = flags | TC_FLUSH_ASYNC;
+      p->seqno = tc->seqno;
 
-      if (!(flags & PIPE_FLUSH_DEFERRED))
+      if (!(flags & PIPE_FLUSH_DEFERRED)) {
+         tc->seqno++;
          tc_batch_flush(tc);
+      }
       return;
    }
 
@@ -2089,6 +2298,9 @@ out_of_memory:
    if (!(flags & PIPE_FLUSH_DEFERRED))
       tc_flush_queries(tc);
    pipe->flush(pipe, fence, flags);
+
+   if (!(flags & PIPE_FLUSH_DEFERRED))
+      p_atomic_set(&tc->flushed_seqno, tc->seqno++);
 }
 
 /* This is actually variable-sized, because indirect isn't allocated if it's
@@ -2122,6 +2334,88 @@ tc_add_draw_vbo(struct pipe_context *_pipe, bool indirect)
                                        sizeof(struct pipe_draw_info));
 }
 
+struct tc_multi_draw {
+   struct pipe_draw_info info;
+   unsigned num_draws;
+   struct pipe_draw_start_count slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_multi_draw(struct pipe_context *pipe, union tc_payload *payload)
+{
+   struct tc_multi_draw *p = (struct tc_multi_draw *)payload;
+
+   pipe->multi_draw(pipe, &p->info, p->slot, p->num_draws);
+   if (p->info.index_size)
+      pipe_resource_reference(&p->info.index.resource, NULL);
+}
+
+/* Whether two direct draws only differ in the vertex or index range. */
+static bool
+tc_is_draw_mergeable(const struct pipe_draw_info *a,
+                     const struct pipe_draw_info *b)
+{
+   return a->index_size == b->index_size &&
+          a->mode == b->mode &&
+          a->primitive_restart == b->primitive_restart &&
+          a->vertices_per_patch == b->vertices_per_patch &&
+          a->start_instance == b->start_instance &&
+          a->instance_count == b->instance_count &&
+          a->drawid == b->drawid &&
+          a->index_bias == b->index_bias &&
+          (!a->primitive_restart || a->restart_index == b->restart_index) &&
+          (!a->index_size || a->index.resource == b->index.resource);
+}
+
+/* Add a direct draw with a real index buffer or without indices. If the
+ * last call of the batch is a compatible multi_draw, append the range to
+ * it instead of adding a new call.
+ */
+static void
+tc_add_multi_draw(struct threaded_context *tc,
+                  const struct pipe_draw_info *info)
+{
+   struct tc_batch *next = &tc->batch_slots[tc->next];
+   struct tc_call *call = tc->last_multi_draw;
+   struct tc_multi_draw *p;
+
+   if (call &&
+       call + call->num_call_slots == &next->call[next->num_total_call_slots]) {
+      p = (struct tc_multi_draw *)&call->payload;
+
+      unsigned size = offsetof(struct tc_call, payload) + sizeof(*p) +
+                      sizeof(p->slot[0]) * (p->num_draws + 1);
+      unsigned num_call_slots = DIV_ROUND_UP(size, sizeof(struct tc_call));
+      unsigned num_new_slots = num_call_slots - call->num_call_slots;
+
+      if (tc_is_draw_mergeable(&p->info, info) &&
+          next->num_total_call_slots + num_new_slots <= TC_CALLS_PER_BATCH) {
+         call->num_call_slots = num_call_slots;
+         next->num_total_call_slots += num_new_slots;
+
+         p->slot[p->num_draws].start = info->start;
+         p->slot[p->num_draws].count = info->count;
+         p->num_draws++;
+         p->info.min_index = MIN2(p->info.min_index, info->min_index);
+         p->info.max_index = MAX2(p->info.max_index, info->max_index);
+         return;
+      }
+   }
+
+   p = tc_add_slot_based_call(tc, TC_CALL_multi_draw, tc_multi_draw, 1);
+   if (info->index_size) {
+      tc_set_resource_reference(tc, &p->info.index.resource,
+                                info->index.resource);
+   }
+   memcpy(&p->info, info, sizeof(*info));
+   p->num_draws = 1;
+   p->slot[0].start = info->start;
+   p->slot[0].count = info->count;
+
+   tc->last_multi_draw = (struct tc_call *)
+      ((char *)p - offsetof(struct tc_call, payload));
+}
+
 static void
 tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
 {
@@ -2130,6 +2424,14 @@ tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
    unsigned index_size = info->index_size;
    bool has_user_indices = info->has_user_indices;
 
+   tc->draw_seqno = tc->seqno;
+
+   if (tc->pipe->multi_draw && !indirect && !info->count_from_stream_output &&
+       !(index_size && has_user_indices)) {
+      tc_add_multi_draw(tc, info);
+      return;
+   }
+
    if (index_size && has_user_indices) {
       unsigned size = info->count * index_size;
       struct pipe_resource *buffer = NULL;
@@ -2162,14 +2464,14 @@ tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
       pipe_so_target_reference(&p->draw.count_from_stream_output,
                                info->count_from_stream_output);
       if (index_size) {
-         tc_set_resource_reference(&p->draw.index.resource,
+         tc_set_resource_reference(tc, &p->draw.index.resource,
                                    info->index.resource);
       }
       memcpy(&p->draw, info, sizeof(*info));
 
       if (indirect) {
-         tc_set_resource_reference(&p->draw.indirect->buffer, indirect->buffer);
-         tc_set_resource_reference(&p->indirect.indirect_draw_count,
+         tc_set_resource_reference(tc, &p->draw.indirect->buffer, indirect->buffer);
+         tc_set_resource_reference(tc, &p->indirect.indirect_draw_count,
                                    indirect->indirect_draw_count);
          memcpy(&p->indirect, indirect, sizeof(*indirect));
          p->draw.indirect = &p->indirect;
@@ -2195,7 +2497,8 @@ tc_launch_grid(struct pipe_context *_pipe,
                                                        pipe_grid_info);
    assert(info->input == NULL);
 
-   tc_set_resource_reference(&p->indirect, info->indirect);
+   tc->draw_seqno = tc->seqno;
+   tc_set_resource_reference(tc, &p->indirect, info->indirect);
    memcpy(p, info, sizeof(*info));
 }
 
@@ -2223,12 +2526,12 @@ tc_resource_copy_region(struct pipe_context *_pipe,
       tc_add_struct_typed_call(tc, TC_CALL_resource_copy_region,
                                tc_resource_copy_region);
 
-   tc_set_resource_reference(&p->dst, dst);
+   tc_set_resource_reference(tc, &p->dst, dst);
    p->dst_level = dst_level;
    p->dstx = dstx;
    p->dsty = dsty;
    p->dstz = dstz;
-   tc_set_resource_reference(&p->src, src);
+   tc_set_resource_reference(tc, &p->src, src);
    p->src_level = src_level;
    p->src_box = *src_box;
 
@@ -2254,8 +2557,8 @@ tc_blit(struct pipe_context *_pipe, const struct pipe_blit_info *info)
    struct pipe_blit_info *blit =
       tc_add_struct_typed_call(tc, TC_CALL_blit, pipe_blit_info);
 
-   tc_set_resource_reference(&blit->dst.resource, info->dst.resource);
-   tc_set_resource_reference(&blit->src.resource, info->src.resource);
+   tc_set_resource_reference(tc, &blit->dst.resource, info->dst.resource);
+   tc_set_resource_reference(tc, &blit->src.resource, info->src.resource);
    memcpy(blit, info, sizeof(*info));
 }
 
@@ -2308,7 +2611,7 @@ tc_generate_mipmap(struct pipe_context *_pipe,
    struct tc_generate_mipmap *p =
       tc_add_struct_typed_call(tc, TC_CALL_generate_mipmap, tc_generate_mipmap);
 
-   tc_set_resource_reference(&p->res, res);
+   tc_set_resource_reference(tc, &p->res, res);
    p->format = format;
    p->base_level = base_level;
    p->last_level = last_level;
@@ -2331,7 +2634,7 @@ tc_flush_resource(struct pipe_context *_pipe,
    struct threaded_context *tc = threaded_context(_pipe);
    union tc_payload *payload = tc_add_small_call(tc, TC_CALL_flush_resource);
 
-   tc_set_resource_reference(&payload->resource, resource);
+   tc_set_resource_reference(tc, &payload->resource, resource);
 }
 
 static void
@@ -2353,7 +2656,7 @@ tc_invalidate_resource(struct pipe_context *_pipe,
    }
 
    union tc_payload *payload = tc_add_small_call(tc, TC_CALL_invalidate_resource);
-   tc_set_resource_reference(&payload->resource, resource);
+   tc_set_resource_reference(tc, &payload->resource, resource);
 }
 
 struct tc_clear {
@@ -2449,7 +2752,7 @@ tc_clear_buffer(struct pipe_context *_pipe, struct pipe_resource *res,
    struct tc_clear_buffer *p =
       tc_add_struct_typed_call(tc, TC_CALL_clear_buffer, tc_clear_buffer);
 
-   tc_set_resource_reference(&p->res, res);
+   tc_set_resource_reference(tc, &p->res, res);
    p->offset = offset;
    p->size = size;
    memcpy(p->clear_value, clear_value, clear_value_size);
@@ -2482,7 +2785,7 @@ tc_clear_texture(struct pipe_context *_pipe, struct pipe_resource *res,
    struct tc_clear_texture *p =
       tc_add_struct_typed_call(tc, TC_CALL_clear_texture, tc_clear_texture);
 
-   tc_set_resource_reference(&p->res, res);
+   tc_set_resource_reference(tc, &p->res, res);
    p->level = level;
    p->box = *box;
    memcpy(p->data, data,
@@ -2513,7 +2816,7 @@ tc_resource_commit(struct pipe_context *_pipe, struct pipe_resource *res,
    struct tc_resource_commit *p =
       tc_add_struct_typed_call(tc, TC_CALL_resource_commit, tc_resource_commit);
 
-   tc_set_resource_reference(&p->res, res);
+   tc_set_resource_reference(tc, &p->res, res);
    p->level = level;
    p->box = *box;
    p->commit = commit;
@@ -2575,15 +2878,32 @@ tc_destroy(struct pipe_context *_pipe)
 
    tc_sync(tc);
 
-   if (util_queue_is_initialized(&tc->queue)) {
-      util_queue_destroy(&tc->queue);
+   if (tc->thread_running) {
+      mtx_lock(&tc->thread_lock);
+      tc->thread_quit = true;
+      cnd_signal(&tc->thread_cond);
+      mtx_unlock(&tc->thread_lock);
+      thrd_join(tc->thread, NULL);
 
       for (unsigned i = 0; i < TC_MAX_BATCHES; i++) {
          util_queue_fence_destroy(&tc->batch_slots[i].fence);
          assert(!tc->batch_slots[i].token);
       }
+      cnd_destroy(&tc->thread_cond);
+      mtx_destroy(&tc->thread_lock);
    }
 
+   tc_unbind_buffers(tc, tc->vertex_buffers, ARRAY_SIZE(tc->vertex_buffers));
+   tc_unbind_buffers(tc, &tc->const_buffers[0][0],
+                     sizeof(tc->const_buffers) / sizeof(tc->const_buffers[0][0]));
+   tc_unbind_buffers(tc, &tc->shader_buffers[0][0],
+                     sizeof(tc->shader_buffers) / sizeof(tc->shader_buffers[0][0]));
+   tc_unbind_buffers(tc, &tc->image_buffers[0][0],
+                     sizeof(tc->image_buffers) / sizeof(tc->image_buffers[0][0]));
+   tc_unbind_buffers(tc, &tc->sampler_buffers[0][0],
+                     sizeof(tc->sampler_buffers) / sizeof(tc->sampler_buffers[0][0]));
+   tc_unbind_buffers(tc, tc->streamout_buffers, ARRAY_SIZE(tc->streamout_buffers));
+
    slab_destroy_child(&tc->pool_transfers);
    assert(tc->batch_slots[tc->next].num_total_call_slots == 0);
    pipe->destroy(pipe);
@@ -2605,6 +2925,9 @@ static const tc_execute execute_func[TC_NUM_CALLS] = {
  *                             in pipe_screen.
  * \param replace_buffer  callback for replacing a pipe_resource's storage
  *                        with another pipe_resource's storage.
+ * \param is_resource_busy  optional callback that returns whether the GPU
+ *                          is using a resource, for unsynchronized mappings
+ *                          of idle buffers
  * \param out  if successful, the threaded_context will be returned here in
  *             addition to the return value if "out" != NULL
  */
@@ -2613,6 +2936,7 @@ threaded_context_create(struct pipe_context *pipe,
                         struct slab_parent_pool *parent_transfer_pool,
                         tc_replace_buffer_storage_func replace_buffer,
                         tc_create_fence_func create_fence,
+                        tc_is_resource_busy_func is_resource_busy,
                         struct threaded_context **out)
 {
    struct threaded_context *tc;
@@ -2648,6 +2972,8 @@ threaded_context_create(struct pipe_context *pipe,
    tc->pipe = pipe;
    tc->replace_buffer_storage = replace_buffer;
    tc->create_fence = create_fence;
+   tc->is_resource_busy = is_resource_busy;
+   tc->seqno = 1;
    tc->map_buffer_alignment =
       pipe->screen->get_param(pipe->screen, PIPE_CAP_MIN_MAP_BUFFER_ALIGNMENT);
    tc->base.priv = pipe; /* priv points to the wrapped driver context */
@@ -2664,19 +2990,25 @@ threaded_context_create(struct pipe_context *pipe,
    if (!tc->base.stream_uploader || !tc->base.const_uploader)
       goto fail;
 
-   /* The queue size is the number of batches "waiting". Batches are removed
-    * from the queue before being executed, so keep one tc_batch slot for that
-    * execution. Also, keep one unused slot for an unflushed batch.
-    */
-   if (!util_queue_init(&tc->queue, "gdrv", TC_MAX_BATCHES - 2, 1, 0))
-      goto fail;
-
    for (unsigned i = 0; i < TC_MAX_BATCHES; i++) {
       tc->batch_slots[i].sentinel = TC_SENTINEL;
       tc->batch_slots[i].pipe = pipe;
       util_queue_fence_init(&tc->batch_slots[i].fence);
    }
 
+   mtx_init(&tc->thread_lock, mtx_plain);
+   cnd_init(&tc->thread_cond);
+
+   tc->thread = u_thread_create(tc_thread_func, tc);
+   if (!tc->thread) {
+      for (unsigned i = 0; i < TC_MAX_BATCHES; i++)
+         util_queue_fence_destroy(&tc->batch_slots[i].fence);
+      cnd_destroy(&tc->thread_cond);
+      mtx_destroy(&tc->thread_lock);
+      goto fail;
+   }
+   tc->thread_running = true;
+
    list_inithead(&tc->unflushed_queries);
 
    slab_create_child(&tc->pool_transfers, parent_transfer_pool);
@@ -57,6 +57,14 @@
  *    - resource_commit always returns true; failures are ignored.
  *    - set_debug_callback is skipped if the callback is synchronous.
  *
+ * 5) Drivers can pass an is_resource_busy callback, which allows mapping
+ *    idle buffers unsynchronized without syncing the driver thread. It's
+ *    called from the application thread and must be thread-safe. The
+ *    threaded context only calls it when the buffer isn't referenced by
+ *    any calls that haven't been flushed by the driver yet, so it only has
+ *    to check submitted GPU work. Drivers must keep references to bound
+ *    buffers, as required by Gallium.
+ *
  *
  * Thread-safety requirements on context functions
  * -----------------------------------------------
@@ -203,22 +211,28 @@ struct tc_unflushed_batch_token;
 /* fence is pre-populated with a fence created by the create_fence callback */
 #define TC_FLUSH_ASYNC        (1u << 31)
 
-/* Size of the queue = number of batch slots in memory.
+/* Size of the ring = number of batch slots in memory.
  * - 1 batch is always idle and records new commands
  * - 1 batch is being executed
- * so the queue size is TC_MAX_BATCHES - 2 = number of waiting batches.
+ * so TC_MAX_BATCHES - 2 batches can be waiting.
  *
  * Use a size as small as possible for low CPU L2 cache usage but large enough
- * so that the queue isn't stalled too often for not having enough idle batch
+ * so that the ring isn't stalled too often for not having enough idle batch
  * slots.
  */
 #define TC_MAX_BATCHES        10
 
+/* How long the driver thread polls the ring for a new batch before it goes
+ * to sleep. Waking it up costs more than a batch handoff, so this should
+ * cover the usual gap between two flushes in a draw-call-bound app.
+ */
+#define TC_SPIN_NS            (20 * 1000)
+
 /* The size of one batch. Non-trivial calls (i.e. not setting a CSO pointer)
  * can occupy multiple call slots.
  *
  * The idea is to have batches as small as possible but large enough so that
- * the queuing and mutex overhead is negligible.
+ * the handoff overhead is negligible.
  */
 #define TC_CALLS_PER_BATCH    768
 
@@ -237,6 +251,9 @@ typedef void (*tc_replace_buffer_storage_func)(struct pipe_context *ctx,
                                                struct pipe_resource *src);
 typedef struct pipe_fence_handle *(*tc_create_fence_func)(struct pipe_context *ctx,
                                                           struct tc_unflushed_batch_token *token);
+typedef bool (*tc_is_resource_busy_func)(struct pipe_screen *screen,
+                                         struct pipe_resource *resource,
+                                         unsigned usage);
 
 struct threaded_resource {
    struct pipe_resource b;
@@ -280,6 +297,19 @@ struct threaded_resource {
     * are too large for the visible VRAM window.
     */
    int max_forced_staging_uploads;
+
+   /* The last threaded context that referenced or bound this buffer and
+    * its flush sequence number at that time. If more than one context did,
+    * the buffer is always considered busy.
+    */
+   struct threaded_context *last_tc;
+   unsigned last_seqno;
+   bool multi_context;
+
+   /* The number of binding slots of all threaded contexts that contain
+    * this buffer.
+    */
+   int bind_count;
 };
 
 struct threaded_transfer {
@@ -352,6 +382,7 @@ struct threaded_context {
    struct slab_child_pool pool_transfers;
    tc_replace_buffer_storage_func replace_buffer_storage;
    tc_create_fence_func create_fence;
+   tc_is_resource_busy_func is_resource_busy;
    unsigned map_buffer_alignment;
 
    struct list_head unflushed_queries;
@@ -367,8 +398,43 @@ struct threaded_context {
    uint64_t bytes_mapped_estimate;
    uint64_t bytes_mapped_limit;
 
-   struct util_queue queue;
-   struct util_queue_fence *fence;
+   /* The driver thread. Batches are handed to it through a single-producer,
+    * single-consumer ring of batch slots: the application thread only bumps
+    * num_submitted, and the driver thread signals each batch fence when it's
+    * done. The lock and condvar are only used when the driver thread sleeps.
+    */
+   thrd_t thread;
+   bool thread_running;
+   bool thread_quit;
+   unsigned num_submitted;
+   int thread_sleeping;
+   mtx_t thread_lock;
+   cnd_t thread_cond;
+
+   /* The last multi_draw call recorded into the current batch. The next
+    * draw is merged into it if it's still the last call and the draw state
+    * is compatible.
+    */
+   struct tc_call *last_multi_draw;
+
+   /* Flush sequence numbers. Calls recorded after "seqno" was last
+    * incremented are flushed by the driver once "flushed_seqno" reaches it.
+    * "seqno" is incremented by every recorded non-deferred flush and
+    * "flushed_seqno" is set by the driver thread when it executes one.
+    */
+   unsigned seqno;
+   unsigned flushed_seqno;
+   unsigned draw_seqno; /* seqno of the last draw or compute dispatch */
+
+   /* Buffers bound through this context, only used to maintain
+    * threaded_resource::bind_count. These don't hold references.
+    */
+   struct pipe_resource *vertex_buffers[PIPE_MAX_ATTRIBS];
+   struct pipe_resource *const_buffers[PIPE_SHADER_TYPES][PIPE_MAX_CONSTANT_BUFFERS];
+   struct pipe_resource *shader_buffers[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_BUFFERS];
+   struct pipe_resource *image_buffers[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_IMAGES];
+   struct pipe_resource *sampler_buffers[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct pipe_resource *streamout_buffers[PIPE_MAX_SO_BUFFERS];
 
    unsigned last, next;
    struct tc_batch batch_slots[TC_MAX_BATCHES];
@@ -383,6 +449,7 @@ threaded_context_create(struct pipe_context *pipe,
                         struct slab_parent_pool *parent_transfer_pool,
                         tc_replace_buffer_storage_func replace_buffer,
                         tc_create_fence_func create_fence,
+                        tc_is_resource_busy_func is_resource_busy,
                         struct threaded_context **out);
 
 void
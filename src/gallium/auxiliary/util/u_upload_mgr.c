@@ -55,6 +55,16 @@ struct u_upload_mgr {
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
    unsigned flushed_size; /* Size we have flushed by transfer_flush_region. */
+
+   /* Ring mode: full buffers waiting to be reused, oldest first. */
+   u_upload_buffer_idle_func ring_is_idle;
+   unsigned ring_max_buffers;
+   unsigned num_ring_buffers;
+   struct {
+      struct pipe_resource *buffer;
+      struct pipe_transfer *transfer; /* Only kept for persistent mappings. */
+      uint8_t *map;
+   } ring[U_UPLOAD_MAX_RING_BUFFERS];
 };
 
 
@@ -132,6 +142,15 @@ u_upload_disable_persistent(struct u_upload_mgr *upload)
    upload->map_flags |= PIPE_TRANSFER_FLUSH_EXPLICIT;
 }
 
+void
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned max_buffers,
+                     u_upload_buffer_idle_func is_idle)
+{
+   assert(max_buffers > 0 && max_buffers <= U_UPLOAD_MAX_RING_BUFFERS);
+   upload->ring_max_buffers = max_buffers;
+   upload->ring_is_idle = is_idle;
+}
+
 static void
 upload_unmap_internal(struct u_upload_mgr *upload, boolean destroying)
 {
@@ -176,10 +195,80 @@ u_upload_release_buffer(struct u_upload_mgr *upload)
 }
 
 
+static void
+u_upload_ring_release(struct u_upload_mgr *upload, unsigned i)
+{
+   if (upload->ring[i].transfer)
+      pipe_transfer_unmap(upload->pipe, upload->ring[i].transfer);
+   pipe_resource_reference(&upload->ring[i].buffer, NULL);
+
+   upload->num_ring_buffers--;
+   memmove(&upload->ring[i], &upload->ring[i + 1],
+           (upload->num_ring_buffers - i) * sizeof(upload->ring[0]));
+}
+
+
+/* Put the full upload buffer into the ring, keeping a persistent mapping. */
+static void
+u_upload_ring_retire(struct u_upload_mgr *upload)
+{
+   unsigned n;
+
+   upload_unmap_internal(upload, FALSE);
+
+   if (upload->num_ring_buffers == upload->ring_max_buffers)
+      u_upload_ring_release(upload, 0);
+
+   n = upload->num_ring_buffers++;
+   upload->ring[n].buffer = upload->buffer;
+   upload->ring[n].transfer = upload->transfer;
+   upload->ring[n].map = upload->map;
+
+   upload->buffer = NULL;
+   upload->transfer = NULL;
+   upload->map = NULL;
+   upload->buffer_size = 0;
+   upload->flushed_size = 0;
+}
+
+
+/* Make the oldest reusable ring buffer current.  Return its size, or 0. */
+static unsigned
+u_upload_ring_reuse(struct u_upload_mgr *upload, unsigned min_size)
+{
+   for (unsigned i = 0; i < upload->num_ring_buffers; i++) {
+      struct pipe_resource *buffer = upload->ring[i].buffer;
+
+      /* Anyone else holding a reference may still read the old contents,
+       * e.g. a bound vertex buffer or a cached upload.
+       */
+      if (buffer->width0 < min_size ||
+          p_atomic_read(&buffer->reference.count) != 1 ||
+          !upload->ring_is_idle(upload->pipe, buffer))
+         continue;
+
+      upload->buffer = buffer;
+      upload->transfer = upload->ring[i].transfer;
+      upload->map = upload->ring[i].map;
+      upload->buffer_size = buffer->width0;
+      upload->offset = 0;
+
+      upload->num_ring_buffers--;
+      memmove(&upload->ring[i], &upload->ring[i + 1],
+              (upload->num_ring_buffers - i) * sizeof(upload->ring[0]));
+      return upload->buffer_size;
+   }
+
+   return 0;
+}
+
+
 void
 u_upload_destroy(struct u_upload_mgr *upload)
 {
    u_upload_release_buffer(upload);
+   while (upload->num_ring_buffers)
+      u_upload_ring_release(upload, upload->num_ring_buffers - 1);
    FREE(upload);
 }
 
@@ -191,9 +280,17 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
    struct pipe_resource buffer;
    unsigned size;
 
-   /* Release the old buffer, if present:
+   /* Release the old buffer, if present, or keep it for later in ring mode.
     */
-   u_upload_release_buffer(upload);
+   if (upload->ring_max_buffers && upload->buffer) {
+      u_upload_ring_retire(upload);
+
+      size = u_upload_ring_reuse(upload, min_size);
+      if (size)
+         return size;
+   } else {
+      u_upload_release_buffer(upload);
+   }
 
    /* Allocate a new one:
     */
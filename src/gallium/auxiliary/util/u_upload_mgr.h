@@ -77,6 +77,28 @@ u_upload_enable_flush_explicit(struct u_upload_mgr *upload);
 void
 u_upload_disable_persistent(struct u_upload_mgr *upload);
 
+/** Maximum number of full buffers kept around in ring mode. */
+#define U_UPLOAD_MAX_RING_BUFFERS 8
+
+/**
+ * Return whether the GPU is done with a buffer, i.e. whether the batches
+ * that used it have been submitted and their fences have signalled.  This
+ * must not flush or wait.
+ */
+typedef bool (*u_upload_buffer_idle_func)(struct pipe_context *pipe,
+                                          struct pipe_resource *buffer);
+
+/**
+ * Enable ring mode: when the upload buffer is full, keep it (and its
+ * persistent mapping) instead of releasing it, and start over in the oldest
+ * kept buffer that is idle and no longer referenced by anyone else.  Up to
+ * \p max_buffers buffers are kept; a new one is only allocated when none of
+ * them can be reused.
+ */
+void
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned max_buffers,
+                     u_upload_buffer_idle_func is_idle);
+
 /**
  * Destroy the upload manager.
  */
@@ -73,6 +73,11 @@
  * operations where the [min_index, max_index] range is not being way bigger
  * than the vertex count.
  *
+ * Uploads of at least U_VBUF_UPLOAD_CACHE_MIN_SIZE bytes are hashed, and if
+ * the same user pointer, size and contents were uploaded recently, the
+ * previous upload is bound again instead.  This helps apps which submit the
+ * same client arrays every frame.
+ *
  * If the range is too big (e.g. one triangle with indices {0, 1, 10000}),
  * the per-vertex attribs are uploaded via the translate module, all packed
  * into one vertex buffer, and the indexed draw call is turned into
@@ -89,6 +94,7 @@
 
 #include "util/u_dump.h"
 #include "util/format/u_format.h"
+#include "util/u_index_minmax.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_screen.h"
@@ -98,6 +104,9 @@
 #include "cso_cache/cso_cache.h"
 #include "cso_cache/cso_hash.h"
 
+#define XXH_INLINE_ALL
+#include "util/xxhash.h"
+
 struct u_vbuf_elements {
    unsigned count;
    struct pipe_vertex_element ve[PIPE_MAX_ATTRIBS];
@@ -137,6 +146,20 @@ struct u_vbuf_elements {
    void *driver_cso;
 };
 
+/* Number of recent user buffer uploads remembered for reuse, and the
+ * smallest upload worth hashing.
+ */
+#define U_VBUF_UPLOAD_CACHE_SIZE 16
+#define U_VBUF_UPLOAD_CACHE_MIN_SIZE 1024
+
+struct u_vbuf_upload_cache_entry {
+   const void *ptr;
+   unsigned size;
+   uint64_t hash;
+   struct pipe_resource *buffer;
+   unsigned offset;
+};
+
 enum {
    VB_VERTEX = 0,
    VB_INSTANCE = 1,
@@ -187,6 +210,10 @@ struct u_vbuf {
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffers are allowed (supported by hardware). */
    uint32_t allowed_vb_mask;
+
+   /* Recent user buffer uploads, replaced round-robin. */
+   struct u_vbuf_upload_cache_entry upload_cache[U_VBUF_UPLOAD_CACHE_SIZE];
+   unsigned upload_cache_next;
 };
 
 static void *
@@ -401,6 +428,9 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
 
    pipe_vertex_buffer_unreference(&mgr->vertex_buffer0_saved);
 
+   for (i = 0; i < U_VBUF_UPLOAD_CACHE_SIZE; i++)
+      pipe_resource_reference(&mgr->upload_cache[i].buffer, NULL);
+
    translate_cache_destroy(mgr->translate_cache);
    cso_cache_delete(mgr->cso_cache);
    FREE(mgr);
@@ -1004,6 +1034,54 @@ get_upload_offset_size(struct u_vbuf *mgr,
 }
 
 
+/**
+ * Upload user vertex data, or reuse an earlier upload of the same data.
+ * The upload manager never writes to a range twice, so a previous upload
+ * stays valid for as long as we hold a reference to its buffer.
+ */
+static void
+u_vbuf_upload_user_data(struct u_vbuf *mgr, unsigned min_out_offset,
+                        unsigned size, const uint8_t *ptr,
+                        unsigned *out_offset, struct pipe_resource **outbuf)
+{
+   struct u_vbuf_upload_cache_entry *entry;
+   uint64_t hash;
+
+   if (size < U_VBUF_UPLOAD_CACHE_MIN_SIZE) {
+      u_upload_data(mgr->pipe->stream_uploader, min_out_offset, size, 4,
+                    ptr, out_offset, outbuf);
+      return;
+   }
+
+   hash = XXH64(ptr, size, 0);
+
+   for (unsigned i = 0; i < U_VBUF_UPLOAD_CACHE_SIZE; i++) {
+      entry = &mgr->upload_cache[i];
+
+      if (entry->buffer && entry->ptr == ptr && entry->size == size &&
+          entry->hash == hash && entry->offset >= min_out_offset) {
+         pipe_resource_reference(outbuf, entry->buffer);
+         *out_offset = entry->offset;
+         return;
+      }
+   }
+
+   u_upload_data(mgr->pipe->stream_uploader, min_out_offset, size, 4,
+                 ptr, out_offset, outbuf);
+   if (!*outbuf)
+      return;
+
+   entry = &mgr->upload_cache[mgr->upload_cache_next];
+   mgr->upload_cache_next =
+      (mgr->upload_cache_next + 1) % U_VBUF_UPLOAD_CACHE_SIZE;
+
+   entry->ptr = ptr;
+   entry->size = size;
+   entry->hash = hash;
+   entry->offset = *out_offset;
+   pipe_resource_reference(&entry->buffer, *outbuf);
+}
+
 static enum pipe_error
 u_vbuf_upload_buffers(struct u_vbuf *mgr,
                       int start_vertex, unsigned num_vertices,
@@ -1031,10 +1109,9 @@ u_vbuf_upload_buffers(struct u_vbuf *mgr,
          struct pipe_vertex_buffer *real_vb = &mgr->real_vertex_buffer[index];
          const uint8_t *ptr = mgr->vertex_buffer[index].buffer.user;
 
-         u_upload_data(mgr->pipe->stream_uploader,
-                       mgr->has_signed_vb_offset ? 0 : offset,
-                       size, 4, ptr + offset, &real_vb->buffer_offset,
-                       &real_vb->buffer.resource);
+         u_vbuf_upload_user_data(mgr, mgr->has_signed_vb_offset ? 0 : offset,
+                                 size, ptr + offset, &real_vb->buffer_offset,
+                                 &real_vb->buffer.resource);
          if (!real_vb->buffer.resource)
             return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -1091,10 +1168,10 @@ u_vbuf_upload_buffers(struct u_vbuf *mgr,
       real_vb = &mgr->real_vertex_buffer[i];
       ptr = mgr->vertex_buffer[i].buffer.user;
 
-      u_upload_data(mgr->pipe->stream_uploader,
-                    mgr->has_signed_vb_offset ? 0 : start,
-                    end - start, 4,
-                    ptr + start, &real_vb->buffer_offset, &real_vb->buffer.resource);
+      u_vbuf_upload_user_data(mgr, mgr->has_signed_vb_offset ? 0 : start,
+                              end - start, ptr + start,
+                              &real_vb->buffer_offset,
+                              &real_vb->buffer.resource);
       if (!real_vb->buffer.resource)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -1142,76 +1219,9 @@ u_vbuf_get_minmax_index_mapped(const struct pipe_draw_info *info,
       return;
    }
 
-   switch (info->index_size) {
-   case 4: {
-      const unsigned *ui_indices = (const unsigned*)indices;
-      unsigned max = 0;
-      unsigned min = ~0u;
-      if (info->primitive_restart) {
-         for (unsigned i = 0; i < info->count; i++) {
-            if (ui_indices[i] != info->restart_index) {
-               if (ui_indices[i] > max) max = ui_indices[i];
-               if (ui_indices[i] < min) min = ui_indices[i];
-            }
-         }
-      }
-      else {
-         for (unsigned i = 0; i < info->count; i++) {
-            if (ui_indices[i] > max) max = ui_indices[i];
-            if (ui_indices[i] < min) min = ui_indices[i];
-         }
-      }
-      *out_min_index = min;
-      *out_max_index = max;
-      break;
-   }
-   case 2: {
-      const unsigned short *us_indices = (const unsigned short*)indices;
-      unsigned short max = 0;
-      unsigned short min = ~((unsigned short)0);
-      if (info->primitive_restart) {
-         for (unsigned i = 0; i < info->count; i++) {
-            if (us_indices[i] != info->restart_index) {
-               if (us_indices[i] > max) max = us_indices[i];
-               if (us_indices[i] < min) min = us_indices[i];
-            }
-         }
-      }
-      else {
-         for (unsigned i = 0; i < info->count; i++) {
-            if (us_indices[i] > max) max = us_indices[i];
-            if (us_indices[i] < min) min = us_indices[i];
-         }
-      }
-      *out_min_index = min;
-      *out_max_index = max;
-      break;
-   }
-   case 1: {
-      const unsigned char *ub_indices = (const unsigned char*)indices;
-      unsigned char max = 0;
-      unsigned char min = ~((unsigned char)0);
-      if (info->primitive_restart) {
-         for (unsigned i = 0; i < info->count; i++) {
-            if (ub_indices[i] != info->restart_index) {
-               if (ub_indices[i] > max) max = ub_indices[i];
-               if (ub_indices[i] < min) min = ub_indices[i];
-            }
-         }
-      }
-      else {
-         for (unsigned i = 0; i < info->count; i++) {
-            if (ub_indices[i] > max) max = ub_indices[i];
-            if (ub_indices[i] < min) min = ub_indices[i];
-         }
-      }
-      *out_min_index = min;
-      *out_max_index = max;
-      break;
-   }
-   default:
-      unreachable("bad index size");
-   }
+   util_index_minmax(indices, info->index_size, info->count,
+                     info->primitive_restart, info->restart_index,
+                     out_min_index, out_max_index);
 }
 
 void u_vbuf_get_minmax_index(struct pipe_context *pipe,
@@ -38,8 +38,12 @@ init_shaders(struct vl_compositor *c)
    if (c->pipe_cs_composit_supported) {
       if (!vl_compositor_cs_init_shaders(c))
          return false;
+   }
 
-   } else if (c->pipe_gfx_supported) {
+   /* Layer types without a compute shader, and layers that need blending,
+    * are drawn with the graphics path, which needs every fragment shader.
+    */
+   if (c->pipe_gfx_supported) {
       c->fs_video_buffer = create_frag_shader_video_buffer(c);
       if (!c->fs_video_buffer) {
          debug_printf("Unable to create YCbCr-to-RGB fragment shader.\n");
@@ -103,9 +107,10 @@ static void cleanup_shaders(struct vl_compositor *c)
 {
    assert(c);
 
-   if (c->pipe_cs_composit_supported) {
+   if (c->pipe_cs_composit_supported)
       vl_compositor_cs_cleanup_shaders(c);
-   } else if (c->pipe_gfx_supported) {
+
+   if (c->pipe_gfx_supported) {
       c->pipe->delete_fs_state(c->pipe, c->fs_video_buffer);
       c->pipe->delete_fs_state(c->pipe, c->fs_weave_rgb);
       c->pipe->delete_fs_state(c->pipe, c->fs_yuv.weave.y);
@@ -386,6 +391,7 @@ set_rgb_to_yuv_layer(struct vl_compositor_state *s, struct vl_compositor *c,
    s->used_layers |= 1 << layer;
 
    s->layers[layer].fs = y? c->fs_rgb_yuv.y : c->fs_rgb_yuv.uv;
+   s->layers[layer].cs = NULL;
 
    vl_csc_get_matrix(VL_CSC_COLOR_STANDARD_BT_709_REV, NULL, false, &csc_matrix);
    vl_compositor_set_csc_matrix(s, (const vl_csc_matrix *)&csc_matrix, 1.0f, 0.0f);
@@ -570,7 +576,7 @@ vl_compositor_set_buffer_layer(struct vl_compositor_state *s,
       case VL_COMPOSITOR_WEAVE:
          if (c->pipe_cs_composit_supported)
             s->layers[layer].cs = c->cs_weave_rgb;
-         else if (c->pipe_gfx_supported)
+         if (c->pipe_gfx_supported)
             s->layers[layer].fs = c->fs_weave_rgb;
          break;
 
@@ -580,7 +586,7 @@ vl_compositor_set_buffer_layer(struct vl_compositor_state *s,
          s->layers[layer].src.br.y += half_a_line;
          if (c->pipe_cs_composit_supported)
             s->layers[layer].cs = c->cs_video_buffer;
-         else if (c->pipe_gfx_supported)
+         if (c->pipe_gfx_supported)
             s->layers[layer].fs = c->fs_video_buffer;
          break;
 
@@ -590,7 +596,7 @@ vl_compositor_set_buffer_layer(struct vl_compositor_state *s,
          s->layers[layer].src.br.y -= half_a_line;
          if (c->pipe_cs_composit_supported)
             s->layers[layer].cs = c->cs_video_buffer;
-         else if (c->pipe_gfx_supported)
+         if (c->pipe_gfx_supported)
             s->layers[layer].fs = c->fs_video_buffer;
          break;
       }
@@ -598,7 +604,7 @@ vl_compositor_set_buffer_layer(struct vl_compositor_state *s,
    } else {
       if (c->pipe_cs_composit_supported)
          s->layers[layer].cs = c->cs_video_buffer;
-      else if (c->pipe_gfx_supported)
+      if (c->pipe_gfx_supported)
          s->layers[layer].fs = c->fs_video_buffer;
    }
 }
@@ -621,6 +627,7 @@ vl_compositor_set_palette_layer(struct vl_compositor_state *s,
 
    s->layers[layer].fs = include_color_conversion ?
       c->fs_palette.yuv : c->fs_palette.rgb;
+   s->layers[layer].cs = NULL;
 
    s->layers[layer].samplers[0] = c->sampler_linear;
    s->layers[layer].samplers[1] = c->sampler_nearest;
@@ -660,6 +667,17 @@ vl_compositor_set_rgba_layer(struct vl_compositor_state *s,
                     src_rect ? *src_rect : default_rect(&s->layers[layer]),
                     dst_rect ? *dst_rect : default_rect(&s->layers[layer]));
 
+   /* The compute path samples the whole source and overwrites the
+    * destination, which only matches the graphics path for an uncropped
+    * first layer.  It doesn't apply vertex colors either.
+    */
+   if (c->pipe_cs_composit_supported && layer == 0 && !colors &&
+       s->layers[layer].src.tl.x == 0.0f && s->layers[layer].src.tl.y == 0.0f &&
+       s->layers[layer].src.br.x == 1.0f && s->layers[layer].src.br.y == 1.0f)
+      s->layers[layer].cs = c->cs_rgba;
+   else
+      s->layers[layer].cs = NULL;
+
    if (colors)
       for (i = 0; i < 4; ++i)
          s->layers[layer].colors[i] = colors[i];
@@ -742,6 +760,23 @@ vl_compositor_convert_rgb_to_yuv(struct vl_compositor_state *s,
    s->pipe->flush(s->pipe, NULL, 0);
 }
 
+static bool
+use_compute(struct vl_compositor_state *s)
+{
+   unsigned i;
+
+   for (i = 0; i < VL_COMPOSITOR_MAX_LAYERS; ++i) {
+      if (!(s->used_layers & (1 << i)))
+         continue;
+
+      /* Compute shaders don't blend. */
+      if (!s->layers[i].cs || s->layers[i].blend)
+         return false;
+   }
+
+   return true;
+}
+
 void
 vl_compositor_render(struct vl_compositor_state *s,
                      struct vl_compositor       *c,
@@ -751,9 +786,9 @@ vl_compositor_render(struct vl_compositor_state *s,
 {
    assert(s);
 
-   if (s->layers->cs)
+   if (c->pipe_cs_composit_supported && use_compute(s))
       vl_compositor_cs_render(s, c, dst_surface, dirty_area, clear_dirty);
-   else if (s->layers->fs)
+   else if (c->pipe_gfx_supported)
       vl_compositor_gfx_render(s, c, dst_surface, dirty_area, clear_dirty);
    else
       debug_warning("Hardware don't support.\n");;
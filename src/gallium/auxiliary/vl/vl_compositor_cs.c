@@ -820,6 +820,12 @@ bool vl_compositor_cs_init_shaders(struct vl_compositor *c)
                 return false;
         }
 
+        c->cs_rgba = vl_compositor_cs_create_shader(c, compute_shader_rgba);
+        if (!c->cs_rgba) {
+                debug_printf("Unable to create RGB-to-RGB compute shader.\n");
+                return false;
+        }
+
         c->cs_yuv.weave.y = vl_compositor_cs_create_shader(c, compute_shader_yuv_weave_y);
         c->cs_yuv.weave.uv = vl_compositor_cs_create_shader(c, compute_shader_yuv_weave_uv);
         c->cs_yuv.bob.y = vl_compositor_cs_create_shader(c, compute_shader_yuv_bob_y);
@@ -841,6 +847,8 @@ void vl_compositor_cs_cleanup_shaders(struct vl_compositor *c)
                 c->pipe->delete_compute_state(c->pipe, c->cs_video_buffer);
         if (c->cs_weave_rgb)
                 c->pipe->delete_compute_state(c->pipe, c->cs_weave_rgb);
+        if (c->cs_rgba)
+                c->pipe->delete_compute_state(c->pipe, c->cs_rgba);
         if (c->cs_yuv.weave.y)
                 c->pipe->delete_compute_state(c->pipe, c->cs_yuv.weave.y);
         if (c->cs_yuv.weave.uv)
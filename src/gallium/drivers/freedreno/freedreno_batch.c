@@ -422,7 +422,7 @@ fd_batch_add_resource(struct fd_batch *batch, struct fd_resource *rsc)
 }
 
 void
-fd_batch_resource_write(struct fd_batch *batch, struct fd_resource *rsc)
+fd_batch_resource_write_slowpath(struct fd_batch *batch, struct fd_resource *rsc)
 {
 	fd_screen_assert_locked(batch->ctx->screen);
 
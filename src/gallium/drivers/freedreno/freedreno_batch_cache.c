@@ -76,18 +76,23 @@
  *   not have been destroyed.
  */
 
+struct key_surf {
+	struct pipe_resource *texture;
+	union pipe_surface_desc u;
+	uint8_t pos, samples;
+	uint16_t format;
+};
+
 struct key {
 	uint32_t width, height, layers;
 	uint16_t samples, num_surfs;
 	struct fd_context *ctx;
-	struct {
-		struct pipe_resource *texture;
-		union pipe_surface_desc u;
-		uint8_t pos, samples;
-		uint16_t format;
-	} surf[0];
+	struct key_surf surf[0];
 };
 
+#define KEY_SIZE(num_surfs) \
+	(sizeof(struct key) + sizeof(struct key_surf) * (num_surfs))
+
 static struct key *
 key_alloc(unsigned num_surfs)
 {
@@ -291,6 +296,13 @@ fd_bc_invalidate_resource(struct fd_resource *rsc, bool destroy)
 	struct fd_screen *screen = fd_screen(rsc->base.screen);
 	struct fd_batch *batch;
 
+	/* Most resources are destroyed without ever having been referenced
+	 * by a batch.  Nothing can start referencing a resource that is being
+	 * destroyed, so in that case we can skip taking the lock:
+	 */
+	if (destroy && !rsc->batch_mask && !rsc->bc_batch_mask)
+		return;
+
 	fd_screen_lock(screen);
 
 	if (destroy) {
@@ -389,20 +401,25 @@ out:
 }
 
 static struct fd_batch *
-batch_from_key(struct fd_batch_cache *cache, struct key *key,
+batch_from_key(struct fd_batch_cache *cache, const struct key *lookup_key,
 		struct fd_context *ctx)
 {
 	struct fd_batch *batch = NULL;
-	uint32_t hash = key_hash(key);
+	uint32_t hash = key_hash(lookup_key);
 	struct hash_entry *entry =
-		_mesa_hash_table_search_pre_hashed(cache->ht, hash, key);
+		_mesa_hash_table_search_pre_hashed(cache->ht, hash, lookup_key);
 
 	if (entry) {
-		free(key);
 		fd_batch_reference(&batch, (struct fd_batch *)entry->data);
 		return batch;
 	}
 
+	/* Only keys which end up in the hashtable need to be on the heap: */
+	struct key *key = key_alloc(lookup_key->num_surfs);
+	if (!key)
+		return NULL;
+	memcpy(key, lookup_key, KEY_SIZE(lookup_key->num_surfs));
+
 	batch = fd_bc_alloc_batch(cache, ctx, false);
 #ifdef DEBUG
 	DBG("%p: hash=0x%08x, %ux%u, %u layers, %u samples", batch, hash,
@@ -415,8 +432,10 @@ batch_from_key(struct fd_batch_cache *cache, struct key *key,
 			key->surf[idx].u.tex.level);
 	}
 #endif
-	if (!batch)
+	if (!batch) {
+		free(key);
 		return NULL;
+	}
 
 	/* reset max_scissor, which will be adjusted on draws
 	 * according to the actual scissor.
@@ -457,7 +476,16 @@ fd_batch_from_fb(struct fd_batch_cache *cache, struct fd_context *ctx,
 		const struct pipe_framebuffer_state *pfb)
 {
 	unsigned idx = 0, n = pfb->nr_cbufs + (pfb->zsbuf ? 1 : 0);
-	struct key *key = key_alloc(n);
+	union {
+		struct key key;
+		uint8_t data[KEY_SIZE(PIPE_MAX_COLOR_BUFS + 1)];
+	} tmp;
+	struct key *key = &tmp.key;
+
+	/* The key is hashed and compared as raw memory, so padding must be
+	 * zero:
+	 */
+	memset(key, 0, KEY_SIZE(n));
 
 	key->width = pfb->width;
 	key->height = pfb->height;
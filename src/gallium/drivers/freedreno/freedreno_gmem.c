@@ -24,6 +24,8 @@
  *    Rob Clark <robclark@freedesktop.org>
  */
 
+#include <inttypes.h>
+
 #include "pipe/p_state.h"
 #include "util/hash_table.h"
 #include "util/u_dump.h"
@@ -651,6 +653,59 @@ flush_ring(struct fd_batch *batch)
 	fd_log_flush(batch);
 }
 
+/* Rough cost of the GMEM and sysmem paths for a batch, in bytes of memory
+ * traffic.  GMEM pays for restoring and resolving the buffers once, plus a
+ * fixed overhead per bin (state re-emitted for each bin, binning pass).
+ * Sysmem pays for every draw, which we assume reads and writes about
+ * 1/SYSMEM_DRAW_COVERAGE_DIV of the render targets, and for writing out
+ * full-surface clears.
+ */
+#define GMEM_BIN_OVERHEAD_BYTES   (16 * 1024)
+#define SYSMEM_DRAW_COVERAGE_DIV  4
+
+static bool
+gmem_is_cheaper(struct fd_batch *batch)
+{
+	struct fd_screen *screen = batch->ctx->screen;
+	struct pipe_framebuffer_state *pfb = &batch->framebuffer;
+	uint64_t area = (uint64_t)pfb->width * pfb->height;
+	uint64_t color_bytes = 0, zs_bytes = 0;
+
+	for (unsigned i = 0; i < pfb->nr_cbufs; i++) {
+		if (pfb->cbufs[i])
+			color_bytes += util_format_get_blocksize(pfb->cbufs[i]->format) * area;
+	}
+
+	if (pfb->zsbuf && (batch->gmem_reason & (FD_GMEM_DEPTH_ENABLED |
+			FD_GMEM_STENCIL_ENABLED | FD_GMEM_CLEARS_DEPTH_STENCIL)))
+		zs_bytes = util_format_get_blocksize(pfb->zsbuf->format) * area;
+
+	uint64_t gmem_cost = 0;
+	if (batch->restore & FD_BUFFER_COLOR)
+		gmem_cost += color_bytes;
+	if (batch->restore & (FD_BUFFER_DEPTH | FD_BUFFER_STENCIL))
+		gmem_cost += zs_bytes;
+	if (batch->resolve & FD_BUFFER_COLOR)
+		gmem_cost += color_bytes;
+	if (batch->resolve & (FD_BUFFER_DEPTH | FD_BUFFER_STENCIL))
+		gmem_cost += zs_bytes;
+
+	uint64_t nbins = DIV_ROUND_UP(color_bytes + zs_bytes, screen->gmemsize_bytes);
+	gmem_cost += MAX2(nbins, 1) * GMEM_BIN_OVERHEAD_BYTES;
+
+	uint64_t sysmem_cost = (uint64_t)batch->num_draws * 2 *
+			(color_bytes + zs_bytes) / SYSMEM_DRAW_COVERAGE_DIV;
+	if (batch->cleared & FD_BUFFER_COLOR)
+		sysmem_cost += color_bytes;
+	if (batch->cleared & (FD_BUFFER_DEPTH | FD_BUFFER_STENCIL))
+		sysmem_cost += zs_bytes;
+
+	fd_log(batch, "GMEM cost: gmem=%"PRIu64", sysmem=%"PRIu64,
+			gmem_cost, sysmem_cost);
+
+	return gmem_cost < sysmem_cost;
+}
+
 void
 fd_gmem_render_tiles(struct fd_batch *batch)
 {
@@ -659,14 +714,25 @@ fd_gmem_render_tiles(struct fd_batch *batch)
 	bool sysmem = false;
 
 	if (ctx->emit_sysmem_prep && !batch->nondraw) {
-		if (batch->cleared || batch->gmem_reason ||
-				((batch->num_draws > 5) && !batch->blit) ||
+		/* a6xx supports depth/stencil, blending and fast clears in
+		 * sysmem, so those are left to the cost model there:
+		 */
+		unsigned gmem_reason = batch->gmem_reason;
+		unsigned cleared = batch->cleared;
+		if (is_a6xx(ctx->screen)) {
+			gmem_reason &= FD_GMEM_LOGICOP_ENABLED | FD_GMEM_FB_READ;
+			cleared &= ~batch->fast_cleared;
+		}
+
+		if (cleared || gmem_reason ||
+				(!batch->blit && gmem_is_cheaper(batch)) ||
 				(pfb->samples > 1)) {
 			fd_log(batch, "GMEM: cleared=%x, gmem_reason=%x, num_draws=%u, samples=%u",
 				batch->cleared, batch->gmem_reason, batch->num_draws,
 				pfb->samples);
 		} else if (!(fd_mesa_debug & FD_DBG_NOBYPASS)) {
 			sysmem = true;
+			ctx->stats.batch_sysmem_auto++;
 		}
 
 		/* For ARB_framebuffer_no_attachments: */
@@ -124,6 +124,7 @@ static const struct pipe_driver_query_info sw_query_list[] = {
 	FQ("batches", BATCH_TOTAL, UINT64, AVERAGE),
 	FQ("batches-sysmem", BATCH_SYSMEM, UINT64, AVERAGE),
 	FQ("batches-gmem", BATCH_GMEM, UINT64, AVERAGE),
+	FQ("batches-sysmem-auto", BATCH_SYSMEM_AUTO, UINT64, AVERAGE),
 	FQ("batches-nondraw", BATCH_NONDRAW, UINT64, AVERAGE),
 	FQ("restores", BATCH_RESTORE, UINT64, AVERAGE),
 	PQ("prims-emitted", PRIMITIVES_EMITTED, UINT64, AVERAGE),
@@ -67,6 +67,8 @@ read_counter(struct fd_context *ctx, int type)
 		return ctx->stats.batch_nondraw;
 	case FD_QUERY_BATCH_RESTORE:
 		return ctx->stats.batch_restore;
+	case FD_QUERY_BATCH_SYSMEM_AUTO:
+		return ctx->stats.batch_sysmem_auto;
 	case FD_QUERY_STAGING_UPLOADS:
 		return ctx->stats.staging_uploads;
 	case FD_QUERY_SHADOW_UPLOADS:
@@ -88,6 +90,7 @@ is_time_rate_query(struct fd_query *q)
 	case FD_QUERY_BATCH_GMEM:
 	case FD_QUERY_BATCH_NONDRAW:
 	case FD_QUERY_BATCH_RESTORE:
+	case FD_QUERY_BATCH_SYSMEM_AUTO:
 	case FD_QUERY_STAGING_UPLOADS:
 	case FD_QUERY_SHADOW_UPLOADS:
 		return true;
@@ -175,6 +178,7 @@ fd_sw_create_query(struct fd_context *ctx, unsigned query_type, unsigned index)
 	case FD_QUERY_BATCH_GMEM:
 	case FD_QUERY_BATCH_NONDRAW:
 	case FD_QUERY_BATCH_RESTORE:
+	case FD_QUERY_BATCH_SYSMEM_AUTO:
 	case FD_QUERY_STAGING_UPLOADS:
 	case FD_QUERY_SHADOW_UPLOADS:
 	case FD_QUERY_VS_REGS:
@@ -282,4 +282,22 @@ fd_batch_resource_read(struct fd_batch *batch,
 		fd_batch_resource_read_slowpath(batch, rsc);
 }
 
+static inline void
+fd_batch_resource_write(struct fd_batch *batch,
+		struct fd_resource *rsc)
+{
+	/* Fast path: if we are already the write batch, any other batch
+	 * touching the resource would have flushed us, so there are no new
+	 * dependencies to track (including for stencil, which we recursed
+	 * into the first time).
+	 */
+	if (likely(rsc->write_batch == batch) &&
+			(!rsc->stencil || rsc->stencil->write_batch == batch)) {
+		rsc->valid = true;
+		return;
+	}
+
+	fd_batch_resource_write_slowpath(batch, rsc);
+}
+
 #endif /* FREEDRENO_RESOURCE_H_ */
@@ -92,6 +92,7 @@ static const struct debug_named_value debug_options[] = {
 		{"layout",    FD_DBG_LAYOUT, "Dump resource layouts"},
 		{"nofp16",    FD_DBG_NOFP16, "Disable mediump precision lowering"},
 		{"nohw",      FD_DBG_NOHW,   "Disable submitting commands to the HW"},
+		{"serialc",   FD_DBG_SERIALC,"Disable asynchronous shader compile"},
 		DEBUG_NAMED_VALUE_END
 };
 
@@ -144,6 +145,10 @@ fd_screen_destroy(struct pipe_screen *pscreen)
 {
 	struct fd_screen *screen = fd_screen(pscreen);
 
+	/* Background compiles may still be uploading to the device: */
+	if (util_queue_is_initialized(&screen->compile_queue))
+		util_queue_destroy(&screen->compile_queue);
+
 	if (screen->pipe)
 		fd_pipe_del(screen->pipe);
 
@@ -35,6 +35,7 @@
 #include "util/u_memory.h"
 #include "util/slab.h"
 #include "util/simple_mtx.h"
+#include "util/u_queue.h"
 #include "renderonly/renderonly.h"
 
 #include "freedreno_batch_cache.h"
@@ -85,6 +86,7 @@ struct fd_screen {
 	struct pipe_driver_query_info *perfcntr_queries;
 
 	void *compiler;          /* currently unused for a2xx */
+	struct util_queue compile_queue; /* currently unused for a2xx */
 
 	struct fd_device *dev;
 
@@ -24,6 +24,8 @@
  *    Rob Clark <robclark@freedesktop.org>
  */
 
+#include <unistd.h>
+
 #include "pipe/p_state.h"
 #include "pipe/p_screen.h"
 #include "util/u_string.h"
@@ -90,8 +92,8 @@ upload_shader_variant(struct ir3_shader_variant *v)
 	memcpy(fd_bo_map(v->bo), v->bin, sz);
 }
 
-struct ir3_shader_variant *
-ir3_shader_variant(struct ir3_shader *shader, struct ir3_shader_key key,
+static struct ir3_shader_variant *
+shader_variant(struct ir3_shader *shader, struct ir3_shader_key key,
 		bool binning_pass, struct pipe_debug_callback *debug)
 {
 	struct ir3_shader_variant *v;
@@ -130,6 +132,18 @@ ir3_shader_variant(struct ir3_shader *shader, struct ir3_shader_key key,
 	return v;
 }
 
+struct ir3_shader_variant *
+ir3_shader_variant(struct ir3_shader *shader, struct ir3_shader_key key,
+		bool binning_pass, struct pipe_debug_callback *debug)
+{
+	/* The initial variants may still be compiling on the screen's
+	 * compile_queue:
+	 */
+	util_queue_fence_wait(&shader->ready);
+
+	return shader_variant(shader, key, binning_pass, debug);
+}
+
 static void
 copy_stream_out(struct ir3_stream_output_info *i,
 		const struct pipe_stream_output_info *p)
@@ -151,32 +165,12 @@ copy_stream_out(struct ir3_stream_output_info *i,
 	}
 }
 
-struct ir3_shader *
-ir3_shader_create(struct ir3_compiler *compiler,
-		const struct pipe_shader_state *cso,
-		struct pipe_debug_callback *debug,
-		struct pipe_screen *screen)
+static void
+create_initial_variants(struct ir3_shader *shader,
+		struct pipe_debug_callback *debug)
 {
-	nir_shader *nir;
-	if (cso->type == PIPE_SHADER_IR_NIR) {
-		/* we take ownership of the reference: */
-		nir = cso->ir.nir;
-	} else {
-		debug_assert(cso->type == PIPE_SHADER_IR_TGSI);
-		if (ir3_shader_debug & IR3_DBG_DISASM) {
-			tgsi_dump(cso->tokens, 0);
-		}
-		nir = tgsi_to_nir(cso->tokens, screen, false);
-	}
-
-	struct ir3_stream_output_info stream_output;
-	copy_stream_out(&stream_output, &cso->stream_output);
-
-	struct ir3_shader *shader = ir3_shader_from_nir(compiler, nir, 0, &stream_output);
-
-	/* Compile standard variants immediately to try to avoid draw-time stalls
-	 * to run the compiler.
-	 */
+	struct ir3_compiler *compiler = shader->compiler;
+	nir_shader *nir = shader->nir;
 	struct ir3_shader_key key = {
 		.tessellation = IR3_TESS_NONE,
 		.msaa = true,
@@ -208,28 +202,77 @@ ir3_shader_create(struct ir3_compiler *compiler,
 	}
 
 	key.safe_constlen = false;
-	struct ir3_shader_variant *v = ir3_shader_variant(shader, key, false, debug);
+	struct ir3_shader_variant *v = shader_variant(shader, key, false, debug);
 	if (!v)
-		return NULL;
+		goto out;
 
 	if (v->constlen > compiler->max_const_safe) {
 		key.safe_constlen = true;
-		ir3_shader_variant(shader, key, false, debug);
+		shader_variant(shader, key, false, debug);
 	}
 
+	/* The binning pass variant is needed by the first draw as well: */
 	if (nir->info.stage == MESA_SHADER_VERTEX) {
 		key.safe_constlen = false;
-		v = ir3_shader_variant(shader, key, true, debug);
+		v = shader_variant(shader, key, true, debug);
 		if (!v)
-			return NULL;
+			goto out;
 
 		if (v->constlen > compiler->max_const_safe) {
 			key.safe_constlen = true;
-			ir3_shader_variant(shader, key, true, debug);
+			shader_variant(shader, key, true, debug);
 		}
 	}
 
+out:
+	/* If compiling failed here, it is retried (and reported) at draw
+	 * time.
+	 */
 	shader->initial_variants_done = true;
+}
+
+static void
+create_initial_variants_async(void *job, int thread_index)
+{
+	create_initial_variants(job, NULL);
+}
+
+struct ir3_shader *
+ir3_shader_create(struct ir3_compiler *compiler,
+		const struct pipe_shader_state *cso,
+		struct pipe_debug_callback *debug,
+		struct pipe_screen *screen)
+{
+	nir_shader *nir;
+	if (cso->type == PIPE_SHADER_IR_NIR) {
+		/* we take ownership of the reference: */
+		nir = cso->ir.nir;
+	} else {
+		debug_assert(cso->type == PIPE_SHADER_IR_TGSI);
+		if (ir3_shader_debug & IR3_DBG_DISASM) {
+			tgsi_dump(cso->tokens, 0);
+		}
+		nir = tgsi_to_nir(cso->tokens, screen, false);
+	}
+
+	struct ir3_stream_output_info stream_output;
+	copy_stream_out(&stream_output, &cso->stream_output);
+
+	struct ir3_shader *shader = ir3_shader_from_nir(compiler, nir, 0, &stream_output);
+
+	/* Compile standard variants up front to try to avoid draw-time stalls
+	 * to run the compiler.  If nobody is listening for debug messages
+	 * (which have to be emitted from the app's thread), do it in the
+	 * background, and the first draw waits for it in ir3_shader_variant():
+	 */
+	struct util_queue *queue = &fd_screen(screen)->compile_queue;
+	if (util_queue_is_initialized(queue) &&
+			!(debug && debug->debug_message)) {
+		util_queue_add_job(queue, shader, &shader->ready,
+				create_initial_variants_async, NULL, 0);
+	} else {
+		create_initial_variants(shader, debug);
+	}
 
 	return shader;
 }
@@ -262,7 +305,7 @@ ir3_shader_create_compute(struct ir3_compiler *compiler,
 	 * is also how we get data from shader-db's ./run)
 	 */
 	static struct ir3_shader_key key; /* static is implicitly zeroed */
-	ir3_shader_variant(shader, key, false, debug);
+	shader_variant(shader, key, false, debug);
 
 	shader->initial_variants_done = true;
 
@@ -280,8 +323,15 @@ ir3_shader_state_create(struct pipe_context *pctx, const struct pipe_shader_stat
 void
 ir3_shader_state_delete(struct pipe_context *pctx, void *hwcso)
 {
+	struct fd_context *ctx = fd_context(pctx);
 	struct ir3_shader *so = hwcso;
 
+	/* If the initial variants haven't started compiling yet, there is no
+	 * need to, otherwise wait for them to finish:
+	 */
+	if (util_queue_is_initialized(&ctx->screen->compile_queue))
+		util_queue_drop_job(&ctx->screen->compile_queue, &so->ready);
+
 	/* free the uploaded shaders, since this is handled outside of the
 	 * shared ir3 code (ie. not used by turnip):
 	 */
@@ -328,5 +378,18 @@ ir3_prog_init(struct pipe_context *pctx)
 void
 ir3_screen_init(struct pipe_screen *pscreen)
 {
+	struct fd_screen *screen = fd_screen(pscreen);
+
 	pscreen->finalize_nir = ir3_screen_finalize_nir;
+
+	if (!(fd_mesa_debug & FD_DBG_SERIALC)) {
+		/* Leave a core for the app's thread, which also runs the
+		 * compiler for draw-time variants.
+		 */
+		unsigned num_threads = MAX2(1, sysconf(_SC_NPROCESSORS_ONLN) - 1);
+
+		/* If this fails, shaders are just compiled synchronously: */
+		util_queue_init(&screen->compile_queue, "ir3q", 64, num_threads,
+				UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+	}
 }
@@ -64,6 +64,9 @@
 
 #define FILE_DEBUG_FLAG DEBUG_BUFMGR
 
+/* Makes the upper half of each batch's exec_tag unique */
+static uint32_t next_batch_id;
+
 static void
 iris_batch_reset(struct iris_batch *batch);
 
@@ -194,6 +197,8 @@ iris_init_batch(struct iris_context *ice,
    util_dynarray_init(&batch->exec_fences, ralloc_context(NULL));
    util_dynarray_init(&batch->syncobjs, ralloc_context(NULL));
 
+   STATIC_ASSERT(IRIS_BATCH_COUNT <= IRIS_BO_EXEC_SLOTS);
+   batch->exec_tag = (uint64_t) p_atomic_inc_return(&next_batch_id) << 32;
    batch->exec_count = 0;
    batch->exec_array_size = 100;
    batch->exec_bos =
@@ -232,12 +237,19 @@ iris_init_batch(struct iris_context *ice,
 static struct drm_i915_gem_exec_object2 *
 find_validation_entry(struct iris_batch *batch, struct iris_bo *bo)
 {
-   unsigned index = READ_ONCE(bo->index);
+   unsigned index;
+
+   if (READ_ONCE(bo->exec_slots[batch->name].tag) == batch->exec_tag) {
+      index = READ_ONCE(bo->exec_slots[batch->name].index);
 
-   if (index < batch->exec_count && batch->exec_bos[index] == bo)
-      return &batch->validation_list[index];
+      if (index < batch->exec_count && batch->exec_bos[index] == bo)
+         return &batch->validation_list[index];
+   } else if (!READ_ONCE(bo->exec_slot_stolen)) {
+      /* Nobody else has used our slot, so it's really not in the list. */
+      return NULL;
+   }
 
-   /* May have been shared between multiple active batches */
+   /* Another context's batch took over the slot */
    for (index = 0; index < batch->exec_count; index++) {
       if (batch->exec_bos[index] == bo)
          return &batch->validation_list[index];
@@ -246,6 +258,25 @@ find_validation_entry(struct iris_batch *batch, struct iris_bo *bo)
    return NULL;
 }
 
+/**
+ * Record that the BO is at @index in the batch's validation list.
+ */
+static void
+set_validation_index(struct iris_batch *batch, struct iris_bo *bo,
+                     unsigned index)
+{
+   uint64_t old_tag = READ_ONCE(bo->exec_slots[batch->name].tag);
+
+   /* Tags of earlier resets of our own batch are stale, but another
+    * batch's tag may still be in use.
+    */
+   if (old_tag != 0 && (old_tag >> 32) != (batch->exec_tag >> 32))
+      WRITE_ONCE(bo->exec_slot_stolen, true);
+
+   WRITE_ONCE(bo->exec_slots[batch->name].index, index);
+   WRITE_ONCE(bo->exec_slots[batch->name].tag, batch->exec_tag);
+}
+
 static void
 ensure_exec_obj_space(struct iris_batch *batch, uint32_t count)
 {
@@ -341,7 +372,7 @@ iris_use_pinned_bo(struct iris_batch *batch,
          .flags = bo->kflags | (writable ? EXEC_OBJECT_WRITE : 0),
       };
 
-   bo->index = batch->exec_count;
+   set_validation_index(batch, bo, batch->exec_count);
    batch->exec_bos[batch->exec_count] = bo;
    batch->aperture_space += bo->size;
 
@@ -387,13 +418,14 @@ iris_batch_reset(struct iris_batch *batch)
    struct iris_screen *screen = batch->screen;
 
    iris_bo_unreference(batch->bo);
+   batch->exec_tag++;
    batch->primary_batch_size = 0;
    batch->total_chained_batch_size = 0;
    batch->contains_draw = false;
    batch->decoder.surface_base = batch->last_surface_base_address;
 
    create_batch(batch);
-   assert(batch->bo->index == 0);
+   assert(batch->exec_bos[0] == batch->bo);
 
    struct iris_syncobj *syncobj = iris_create_syncobj(screen);
    iris_batch_add_syncobj(batch, syncobj, I915_EXEC_FENCE_SIGNAL);
@@ -511,6 +543,7 @@ add_aux_map_bos_to_batch(struct iris_batch *batch)
             .offset = bo->gtt_offset,
             .flags = bo->kflags,
          };
+      set_validation_index(batch, bo, batch->exec_count);
       batch->aperture_space += bo->size;
       batch->exec_count++;
    }
@@ -652,7 +685,6 @@ submit_batch(struct iris_batch *batch)
       struct iris_bo *bo = batch->exec_bos[i];
 
       bo->idle = false;
-      bo->index = -1;
 
       iris_bo_unreference(bo);
    }
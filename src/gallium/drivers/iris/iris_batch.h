@@ -87,6 +87,12 @@ struct iris_batch {
    int exec_count;
    int exec_array_size;
 
+   /**
+    * Identifies the current validation list in iris_bo::exec_slots.  The
+    * upper 32 bits are unique to this batch, the lower ones count resets.
+    */
+   uint64_t exec_tag;
+
    /** Whether INTEL_BLACKHOLE_RENDER is enabled in the batch (aka first
     * instruction is a MI_BATCH_BUFFER_END).
     */
@@ -60,6 +60,7 @@
 #include "util/hash_table.h"
 #include "util/list.h"
 #include "util/os_file.h"
+#include "util/os_misc.h"
 #include "util/u_dynarray.h"
 #include "util/vma.h"
 #include "iris_bufmgr.h"
@@ -161,6 +162,20 @@ struct iris_bufmgr {
    int num_buckets;
    time_t time;
 
+   /** Total size of the BOs in the cache buckets, and the limit for it */
+   uint64_t cache_bytes;
+   uint64_t cache_budget;
+
+   /** Empty the cache when less system memory than this is available */
+   uint64_t low_memory_threshold;
+
+   struct {
+      uint64_t hits;      /**< allocations served from the cache */
+      uint64_t fresh;     /**< allocations that created a new GEM object */
+      uint64_t purged;    /**< cached BOs the kernel had purged */
+      uint64_t evicted;   /**< cached BOs freed to stay within the budget */
+   } cache_stats;
+
    struct hash_table *name_table;
    struct hash_table *handle_table;
 
@@ -190,6 +205,7 @@ static int bo_set_tiling_internal(struct iris_bo *bo, uint32_t tiling_mode,
                                   uint32_t stride);
 
 static void bo_free(struct iris_bo *bo);
+static void free_purged_cached_bos(struct iris_bufmgr *bufmgr);
 
 static struct iris_bo *
 find_and_ref_external_bo(struct hash_table *ht, unsigned int key)
@@ -392,6 +408,7 @@ alloc_bo_from_cache(struct iris_bufmgr *bufmgr,
       return NULL;
 
    struct iris_bo *bo = NULL;
+   bool purged = false;
 
    list_for_each_entry_safe(struct iris_bo, cur, &bucket->head, head) {
       /* Try a little harder to find one that's already in the right memzone */
@@ -406,6 +423,7 @@ alloc_bo_from_cache(struct iris_bufmgr *bufmgr,
          return NULL;
 
       list_del(&cur->head);
+      bufmgr->cache_bytes -= cur->size;
 
       /* Tell the kernel we need this BO.  If it still exists, we're done! */
       if (iris_bo_madvise(cur, I915_MADV_WILLNEED)) {
@@ -414,9 +432,17 @@ alloc_bo_from_cache(struct iris_bufmgr *bufmgr,
       }
 
       /* This BO was purged, throw it out and keep looking. */
+      bufmgr->cache_stats.purged++;
       bo_free(cur);
+      purged = true;
    }
 
+   /* The kernel only purges under memory pressure, and has likely taken
+    * more of our cached BOs.  Get rid of those as well.
+    */
+   if (purged)
+      free_purged_cached_bos(bufmgr);
+
    if (!bo)
       return NULL;
 
@@ -534,6 +560,11 @@ bo_alloc_internal(struct iris_bufmgr *bufmgr,
                                false);
    }
 
+   if (bo)
+      bufmgr->cache_stats.hits++;
+   else
+      bufmgr->cache_stats.fresh++;
+
    mtx_unlock(&bufmgr->lock);
 
    if (!bo) {
@@ -558,7 +589,6 @@ bo_alloc_internal(struct iris_bufmgr *bufmgr,
    p_atomic_set(&bo->refcount, 1);
    bo->reusable = bucket && bufmgr->bo_reuse;
    bo->cache_coherent = bufmgr->has_llc;
-   bo->index = -1;
    bo->kflags = EXEC_OBJECT_SUPPORTS_48B_ADDRESS | EXEC_OBJECT_PINNED;
 
    /* By default, capture all driver-internal buffers like shader kernels,
@@ -653,7 +683,6 @@ iris_bo_create_userptr(struct iris_bufmgr *bufmgr, const char *name,
    p_atomic_set(&bo->refcount, 1);
    bo->userptr = true;
    bo->cache_coherent = true;
-   bo->index = -1;
    bo->idle = true;
 
    return bo;
@@ -818,6 +847,66 @@ bo_free(struct iris_bo *bo)
    }
 }
 
+/**
+ * Frees cached buffers until the cache holds at most @target bytes,
+ * starting with the ones that have been sitting there the longest.
+ */
+static void
+trim_bo_cache(struct iris_bufmgr *bufmgr, uint64_t target)
+{
+   while (bufmgr->cache_bytes > target) {
+      struct iris_bo *oldest = NULL;
+
+      /* Each bucket is sorted by free_time, so only look at the heads. */
+      for (int i = 0; i < bufmgr->num_buckets; i++) {
+         struct bo_cache_bucket *bucket = &bufmgr->cache_bucket[i];
+
+         if (list_is_empty(&bucket->head))
+            continue;
+
+         struct iris_bo *bo =
+            list_first_entry(&bucket->head, struct iris_bo, head);
+
+         if (!oldest || bo->free_time < oldest->free_time ||
+             (bo->free_time == oldest->free_time && bo->size > oldest->size))
+            oldest = bo;
+      }
+
+      assert(oldest);
+      list_del(&oldest->head);
+      bufmgr->cache_bytes -= oldest->size;
+      bufmgr->cache_stats.evicted++;
+
+      bo_free(oldest);
+   }
+}
+
+/**
+ * Frees the cached buffers whose backing pages the kernel has reclaimed.
+ *
+ * They would need a new allocation on reuse anyway, and until then they
+ * only hold on to a GEM handle and some VMA.
+ */
+static void
+free_purged_cached_bos(struct iris_bufmgr *bufmgr)
+{
+   for (int i = 0; i < bufmgr->num_buckets; i++) {
+      struct bo_cache_bucket *bucket = &bufmgr->cache_bucket[i];
+
+      list_for_each_entry_safe(struct iris_bo, bo, &bucket->head, head) {
+         /* Cached BOs are already DONTNEED, this just queries retained. */
+         if (iris_bo_madvise(bo, I915_MADV_DONTNEED))
+            continue;
+
+         list_del(&bo->head);
+         bufmgr->cache_bytes -= bo->size;
+         bufmgr->cache_stats.purged++;
+
+         bo_free(bo);
+      }
+   }
+}
+
 /** Frees all cached buffers significantly older than @time. */
 static void
 cleanup_bo_cache(struct iris_bufmgr *bufmgr, time_t time)
@@ -835,11 +924,21 @@ cleanup_bo_cache(struct iris_bufmgr *bufmgr, time_t time)
             break;
 
          list_del(&bo->head);
+         bufmgr->cache_bytes -= bo->size;
 
          bo_free(bo);
       }
    }
 
+   /* If the system is running out of memory, don't keep anything around.
+    * This is checked at most once a second, like the rest of the cleanup.
+    */
+   uint64_t available;
+   if (bufmgr->cache_bytes > 0 && bufmgr->low_memory_threshold &&
+       os_get_available_system_memory(&available) &&
+       available < bufmgr->low_memory_threshold)
+      trim_bo_cache(bufmgr, 0);
+
    list_for_each_entry_safe(struct iris_bo, bo, &bufmgr->zombie_list, head) {
       /* Stop once we reach a busy BO - all others past this point were
        * freed more recently so are likely also busy.
@@ -871,6 +970,10 @@ bo_unreference_final(struct iris_bo *bo, time_t time)
       bo->name = NULL;
 
       list_addtail(&bo->head, &bucket->head);
+      bufmgr->cache_bytes += bo->size;
+
+      if (bufmgr->cache_bytes > bufmgr->cache_budget)
+         trim_bo_cache(bufmgr, bufmgr->cache_budget);
    } else {
       bo_free(bo);
    }
@@ -1308,6 +1411,13 @@ iris_bufmgr_destroy(struct iris_bufmgr *bufmgr)
 
    mtx_destroy(&bufmgr->lock);
 
+   DBG("BO cache: %llu hits, %llu fresh allocations, %llu purged, "
+       "%llu evicted\n",
+       (unsigned long long) bufmgr->cache_stats.hits,
+       (unsigned long long) bufmgr->cache_stats.fresh,
+       (unsigned long long) bufmgr->cache_stats.purged,
+       (unsigned long long) bufmgr->cache_stats.evicted);
+
    /* Free any cached buffer objects we were going to reuse */
    for (int i = 0; i < bufmgr->num_buckets; i++) {
       struct bo_cache_bucket *bucket = &bufmgr->cache_bucket[i];
@@ -1879,6 +1989,17 @@ iris_bufmgr_create(struct gen_device_info *devinfo, int fd, bool bo_reuse)
 
    init_cache_buckets(bufmgr);
 
+   /* Cached BOs are unused memory, which hurts on small-memory systems.
+    * Keep them to a fraction of RAM unless told otherwise.
+    */
+   uint64_t total_ram = 0;
+   os_get_total_physical_memory(&total_ram);
+   bufmgr->cache_budget =
+      (uint64_t)env_var_as_unsigned("INTEL_BO_CACHE_MB", 0) << 20;
+   if (bufmgr->cache_budget == 0)
+      bufmgr->cache_budget = total_ram ? total_ram / 16 : UINT64_MAX;
+   bufmgr->low_memory_threshold = total_ram / 32;
+
    bufmgr->name_table =
       _mesa_hash_table_create(NULL, _mesa_hash_uint, _mesa_key_uint_equal);
    bufmgr->handle_table =
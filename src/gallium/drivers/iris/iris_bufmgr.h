@@ -38,6 +38,9 @@ struct iris_batch;
 struct gen_device_info;
 struct pipe_debug_callback;
 
+/** Number of batch types a BO tracks its validation list index for */
+#define IRIS_BO_EXEC_SLOTS 2
+
 /**
  * Memory zones.  When allocating a buffer, you can request that it is
  * placed into a specific region of the virtual address space (PPGTT).
@@ -151,18 +154,19 @@ struct iris_bo {
    uint64_t aux_map_address;
 
    /**
-    * The validation list index for this buffer, or -1 when not in a batch.
-    * Note that a single buffer may be in multiple batches (contexts), and
-    * this is a global field, which refers to the last batch using the BO.
-    * It should not be considered authoritative, but can be used to avoid a
-    * linear walk of the validation list in the common case by guessing that
-    * exec_bos[bo->index] == bo and confirming whether that's the case.
+    * Where this buffer is in the validation list of the batches using it,
+    * one slot per batch type (render, compute).  A slot is only valid while
+    * its tag matches the batch's exec_tag, which changes every time the
+    * batch is reset, so slots never need to be cleared.
     *
-    * XXX: this is not ideal now that we have more than one batch per context,
-    * XXX: as the index will flop back and forth between the render index and
-    * XXX: compute index...
+    * Batches of different contexts share the slots.  Once one of them
+    * takes a slot over from another batch, exec_slot_stolen is set, and
+    * lookups which miss fall back to searching the validation list.
     */
-   unsigned index;
+   struct {
+      uint64_t tag;
+      unsigned index;
+   } exec_slots[IRIS_BO_EXEC_SLOTS];
 
    int refcount;
    const char *name;
@@ -237,6 +241,9 @@ struct iris_bo {
     * Boolean of whether this buffer points into user memory
     */
    bool userptr;
+
+   /** See exec_slots */
+   bool exec_slot_stolen;
 };
 
 #define BO_ALLOC_ZEROED     (1<<0)
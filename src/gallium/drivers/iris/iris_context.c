@@ -279,6 +279,24 @@ iris_destroy_context(struct pipe_context *ctx)
       unreachable("Unknown hardware generation"); \
    }
 
+/**
+ * Whether a full stream upload buffer can be reused by the ring.
+ */
+static bool
+iris_upload_buffer_is_idle(struct pipe_context *ctx,
+                           struct pipe_resource *buffer)
+{
+   struct iris_context *ice = (struct iris_context *)ctx;
+   struct iris_bo *bo = iris_resource_bo(buffer);
+
+   for (int i = 0; i < IRIS_BATCH_COUNT; i++) {
+      if (iris_batch_references(&ice->batches[i], bo))
+         return false;
+   }
+
+   return !iris_bo_busy(bo);
+}
+
 /**
  * Create a context.
  *
@@ -305,6 +323,7 @@ iris_create_context(struct pipe_screen *pscreen, void *priv, unsigned flags)
       return NULL;
    }
    ctx->const_uploader = ctx->stream_uploader;
+   u_upload_enable_ring(ctx->stream_uploader, 4, iris_upload_buffer_is_idle);
 
    if (!create_dirty_dmabuf_set(ice)) {
       ralloc_free(ice);
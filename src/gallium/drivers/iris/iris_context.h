@@ -383,6 +383,15 @@ struct iris_uncompiled_shader {
 
    /** Surface state for const_data */
    struct iris_state_ref const_data_state;
+
+   /** Signalled once the precompile job (if any) has finished. */
+   struct util_queue_fence ready;
+
+   /** Set while the precompile job compiles this shader. */
+   bool compiling_async;
+
+   /** Variant compiled by the precompile job, waiting to be uploaded. */
+   struct iris_precompiled_shader *precompiled;
 };
 
 enum iris_surface_group {
@@ -811,6 +820,9 @@ void iris_copy_region(struct blorp_context *blorp,
 /* iris_draw.c */
 
 void iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info);
+void iris_multi_draw(struct pipe_context *ctx, const struct pipe_draw_info *info,
+                     const struct pipe_draw_start_count *draws,
+                     unsigned num_draws);
 void iris_launch_grid(struct pipe_context *, const struct pipe_grid_info *);
 
 /* iris_pipe_control.c */
@@ -871,6 +883,14 @@ iris_disk_cache_retrieve(struct iris_context *ice,
                          const struct iris_uncompiled_shader *ish,
                          const void *prog_key,
                          uint32_t prog_key_size);
+void iris_disk_cache_store_blorp(struct disk_cache *cache,
+                                 const void *key, uint32_t key_size,
+                                 const void *kernel, uint32_t kernel_size,
+                                 const struct brw_stage_prog_data *prog_data,
+                                 uint32_t prog_data_size);
+struct iris_compiled_shader *
+iris_disk_cache_retrieve_blorp(struct iris_context *ice,
+                               const void *key, uint32_t key_size);
 
 /* iris_program_cache.c */
 
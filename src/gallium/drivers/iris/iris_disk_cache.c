@@ -228,6 +228,132 @@ iris_disk_cache_retrieve(struct iris_context *ice,
 #endif
 }
 
+/**
+ * Compute a disk cache key for a BLORP shader key.
+ *
+ * BLORP keys are hashed with a prefix so they can never collide with the
+ * keys of API shaders, which start with a NIR SHA-1.
+ */
+static void
+iris_disk_cache_compute_blorp_key(struct disk_cache *cache,
+                                  const void *key, uint32_t key_size,
+                                  cache_key cache_key)
+{
+   struct blob data;
+   blob_init(&data);
+   blob_write_string(&data, "iris_blorp");
+   blob_write_bytes(&data, key, key_size);
+
+   disk_cache_compute_key(cache, data.data, data.size, cache_key);
+   blob_finish(&data);
+}
+
+/**
+ * Store a newly compiled BLORP shader in the disk cache.
+ */
+void
+iris_disk_cache_store_blorp(struct disk_cache *cache,
+                            const void *key, uint32_t key_size,
+                            const void *kernel, uint32_t kernel_size,
+                            const struct brw_stage_prog_data *prog_data,
+                            uint32_t prog_data_size)
+{
+#ifdef ENABLE_SHADER_CACHE
+   if (!cache)
+      return;
+
+   cache_key cache_key;
+   iris_disk_cache_compute_blorp_key(cache, key, key_size, cache_key);
+
+   if (debug) {
+      char sha1[41];
+      _mesa_sha1_format(sha1, cache_key);
+      fprintf(stderr, "[mesa disk cache] storing blorp %s\n", sha1);
+   }
+
+   /* BLORP shaders have no params, system values or binding table, so we
+    * only need the prog data (with its size, as it depends on the stage)
+    * and the assembly.
+    */
+   struct blob blob;
+   blob_init(&blob);
+
+   blob_write_uint32(&blob, prog_data_size);
+   blob_write_bytes(&blob, prog_data, prog_data_size);
+   blob_write_uint32(&blob, kernel_size);
+   blob_write_bytes(&blob, kernel, kernel_size);
+
+   disk_cache_put(cache, cache_key, blob.data, blob.size, NULL);
+   blob_finish(&blob);
+#endif
+}
+
+/**
+ * Search for a BLORP shader in the disk cache.  If found, upload it to the
+ * in-memory program cache so we can use it.
+ */
+struct iris_compiled_shader *
+iris_disk_cache_retrieve_blorp(struct iris_context *ice,
+                               const void *key, uint32_t key_size)
+{
+#ifdef ENABLE_SHADER_CACHE
+   struct iris_screen *screen = (void *) ice->ctx.screen;
+   struct disk_cache *cache = screen->disk_cache;
+
+   if (!cache)
+      return NULL;
+
+   cache_key cache_key;
+   iris_disk_cache_compute_blorp_key(cache, key, key_size, cache_key);
+
+   if (debug) {
+      char sha1[41];
+      _mesa_sha1_format(sha1, cache_key);
+      fprintf(stderr, "[mesa disk cache] retrieving blorp %s: ", sha1);
+   }
+
+   size_t size;
+   void *buffer = disk_cache_get(cache, cache_key, &size);
+
+   if (debug)
+      fprintf(stderr, "%s\n", buffer ? "found" : "missing");
+
+   if (!buffer)
+      return NULL;
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, buffer, size);
+
+   const uint32_t prog_data_size = blob_read_uint32(&blob);
+   const void *prog_data_templ = blob_read_bytes(&blob, prog_data_size);
+   const uint32_t kernel_size = blob_read_uint32(&blob);
+   const void *assembly = blob_read_bytes(&blob, kernel_size);
+
+   if (blob.overrun || prog_data_size > sizeof(union brw_any_prog_data)) {
+      free(buffer);
+      return NULL;
+   }
+
+   struct brw_stage_prog_data *prog_data = ralloc_size(NULL, prog_data_size);
+   memcpy(prog_data, prog_data_templ, prog_data_size);
+   prog_data->param = NULL;
+   prog_data->pull_param = NULL;
+
+   struct iris_binding_table bt;
+   memset(&bt, 0, sizeof(bt));
+
+   struct iris_compiled_shader *shader =
+      iris_upload_shader(ice, IRIS_CACHE_BLORP, key_size, key, assembly,
+                         prog_data, NULL, NULL, 0, 0, &bt);
+
+   free(buffer);
+
+   return shader;
+#else
+   return NULL;
+#endif
+}
+
 /**
  * Initialize the on-disk shader cache.
  */
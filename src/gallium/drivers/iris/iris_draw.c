@@ -224,11 +224,40 @@ iris_simple_draw_vbo(struct iris_context *ice,
    batch->screen->vtbl.upload_render_state(ice, batch, draw);
 }
 
-/**
- * The pipe->draw_vbo() driver hook.  Performs a draw on the GPU.
- */
-void
-iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+static void
+iris_multi_draw_direct(struct iris_context *ice,
+                       const struct pipe_draw_info *dinfo,
+                       const struct pipe_draw_start_count *draws,
+                       unsigned num_draws)
+{
+   struct iris_batch *batch = &ice->batches[IRIS_BATCH_RENDER];
+   struct pipe_draw_info info = *dinfo;
+
+   const uint64_t orig_dirty = ice->state.dirty;
+   const uint64_t orig_stage_dirty = ice->state.stage_dirty;
+
+   for (unsigned i = 0; i < num_draws; i++) {
+      info.start = draws[i].start;
+      info.count = draws[i].count;
+
+      iris_batch_maybe_flush(batch, 1500);
+
+      iris_update_draw_parameters(ice, &info);
+
+      batch->screen->vtbl.upload_render_state(ice, batch, &info);
+
+      ice->state.dirty &= ~IRIS_ALL_DIRTY_FOR_RENDER;
+      ice->state.stage_dirty &= ~IRIS_ALL_STAGE_DIRTY_FOR_RENDER;
+   }
+
+   /* Put this back for post-draw resolves, we'll clear it again after. */
+   ice->state.dirty = orig_dirty;
+   ice->state.stage_dirty = orig_stage_dirty;
+}
+
+static void
+iris_draw(struct pipe_context *ctx, const struct pipe_draw_info *info,
+          const struct pipe_draw_start_count *draws, unsigned num_draws)
 {
    struct iris_context *ice = (struct iris_context *) ctx;
    struct iris_screen *screen = (struct iris_screen*)ice->ctx.screen;
@@ -271,6 +300,8 @@ iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
 
    if (info->indirect)
       iris_indirect_draw_vbo(ice, info);
+   else if (draws)
+      iris_multi_draw_direct(ice, info, draws, num_draws);
    else
       iris_simple_draw_vbo(ice, info);
 
@@ -282,6 +313,26 @@ iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
    ice->state.stage_dirty &= ~IRIS_ALL_STAGE_DIRTY_FOR_RENDER;
 }
 
+/**
+ * The pipe->draw_vbo() driver hook.  Performs a draw on the GPU.
+ */
+void
+iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+{
+   iris_draw(ctx, info, NULL, 0);
+}
+
+/**
+ * The pipe->multi_draw() driver hook.  Performs several draws sharing the
+ * same state, only validating it once.
+ */
+void
+iris_multi_draw(struct pipe_context *ctx, const struct pipe_draw_info *info,
+                const struct pipe_draw_start_count *draws, unsigned num_draws)
+{
+   iris_draw(ctx, info, draws, num_draws);
+}
+
 static void
 iris_update_grid_size_resource(struct iris_context *ice,
                                const struct pipe_grid_info *grid)
@@ -1067,6 +1067,116 @@ last_vue_stage(struct iris_context *ice)
    return MESA_SHADER_VERTEX;
 }
 
+/**
+ * A variant compiled by a precompile job.
+ *
+ * The program cache and the shader uploader belong to the context and
+ * aren't thread safe, so the jobs only compile.  The context uploads the
+ * result the next time it looks for a variant of the shader.
+ */
+struct iris_precompiled_shader {
+   enum iris_program_cache_id cache_id;
+   uint32_t key_size;
+   const void *key;
+   const void *assembly;
+   struct brw_stage_prog_data *prog_data;
+   uint32_t *so_decls;
+   enum brw_param_builtin *system_values;
+   unsigned num_system_values;
+   unsigned num_cbufs;
+   struct iris_binding_table bt;
+};
+
+/**
+ * Upload a freshly compiled variant and store it in the disk cache, or
+ * keep it for later if we're running in a precompile job.
+ *
+ * Takes ownership of mem_ctx.
+ */
+static struct iris_compiled_shader *
+iris_finish_compile(struct iris_context *ice,
+                    struct iris_uncompiled_shader *ish,
+                    void *mem_ctx,
+                    enum iris_program_cache_id cache_id,
+                    uint32_t key_size,
+                    const void *key,
+                    const void *assembly,
+                    struct brw_stage_prog_data *prog_data,
+                    uint32_t *so_decls,
+                    enum brw_param_builtin *system_values,
+                    unsigned num_system_values,
+                    unsigned num_cbufs,
+                    const struct iris_binding_table *bt)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+
+   if (ish && ish->compiling_async) {
+      struct iris_precompiled_shader *pre =
+         ralloc(NULL, struct iris_precompiled_shader);
+
+      pre->cache_id = cache_id;
+      pre->key_size = key_size;
+      pre->key = ralloc_memdup(pre, key, key_size);
+      pre->assembly = assembly;
+      pre->prog_data = prog_data;
+      pre->so_decls = so_decls;
+      pre->system_values = system_values;
+      pre->num_system_values = num_system_values;
+      pre->num_cbufs = num_cbufs;
+      pre->bt = *bt;
+
+      ralloc_steal(pre, mem_ctx);
+      ralloc_steal(pre, so_decls);
+
+      ish->precompiled = pre;
+      return NULL;
+   }
+
+   struct iris_compiled_shader *shader =
+      iris_upload_shader(ice, cache_id, key_size, key, assembly, prog_data,
+                         so_decls, system_values, num_system_values,
+                         num_cbufs, bt);
+
+   if (ish)
+      iris_disk_cache_store(screen->disk_cache, ish, shader, key, key_size);
+
+   ralloc_free(mem_ctx);
+   return shader;
+}
+
+/**
+ * Wait for the shader's precompile job, and upload the variant it compiled.
+ *
+ * Must be called before looking up variants of the shader.
+ */
+static void
+iris_finish_precompile(struct iris_context *ice,
+                       struct iris_uncompiled_shader *ish)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+
+   if (!ish)
+      return;
+
+   util_queue_fence_wait(&ish->ready);
+
+   /* The shader may be shared with another context. */
+   struct iris_precompiled_shader *pre = p_atomic_xchg(&ish->precompiled, NULL);
+   if (!pre)
+      return;
+
+   struct iris_compiled_shader *shader =
+      iris_upload_shader(ice, pre->cache_id, pre->key_size, pre->key,
+                         pre->assembly, pre->prog_data, pre->so_decls,
+                         pre->system_values, pre->num_system_values,
+                         pre->num_cbufs, &pre->bt);
+
+   iris_disk_cache_store(screen->disk_cache, ish, shader, pre->key,
+                         pre->key_size);
+
+   ralloc_free(pre);
+}
+
 /**
  * Compile a vertex shader, and upload the assembly.
  */
@@ -1136,15 +1246,10 @@ iris_compile_vs(struct iris_context *ice,
       screen->vtbl.create_so_decl_list(&ish->stream_output,
                                     &vue_prog_data->vue_map);
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_VS, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs, &bt);
-
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(ice, ish, mem_ctx, IRIS_CACHE_VS, sizeof(*key),
+                              key, program, prog_data, so_decls,
+                              system_values, num_system_values, num_cbufs,
+                              &bt);
 }
 
 /**
@@ -1163,6 +1268,8 @@ iris_update_compiled_vs(struct iris_context *ice)
    struct iris_vs_prog_key key = { KEY_ID(vue.base) };
    screen->vtbl.populate_vs_key(ice, &ish->nir->info, last_vue_stage(ice), &key);
 
+   iris_finish_precompile(ice, ish);
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_VS];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_VS, sizeof(key), &key);
@@ -1342,16 +1449,10 @@ iris_compile_tcs(struct iris_context *ice,
       }
    }
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_TCS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs, &bt);
-
-   if (ish)
-      iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(ice, ish, mem_ctx, IRIS_CACHE_TCS, sizeof(*key),
+                              key, program, prog_data, NULL,
+                              system_values, num_system_values, num_cbufs,
+                              &bt);
 }
 
 /**
@@ -1384,6 +1485,8 @@ iris_update_compiled_tcs(struct iris_context *ice)
                           &key.patch_outputs_written);
    screen->vtbl.populate_tcs_key(ice, &key);
 
+   iris_finish_precompile(ice, tcs);
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_TCS];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_TCS, sizeof(key), &key);
@@ -1471,15 +1574,10 @@ iris_compile_tes(struct iris_context *ice,
                                     &vue_prog_data->vue_map);
 
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_TES, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs, &bt);
-
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(ice, ish, mem_ctx, IRIS_CACHE_TES, sizeof(*key),
+                              key, program, prog_data, so_decls,
+                              system_values, num_system_values, num_cbufs,
+                              &bt);
 }
 
 /**
@@ -1499,6 +1597,8 @@ iris_update_compiled_tes(struct iris_context *ice)
    get_unified_tess_slots(ice, &key.inputs_read, &key.patch_inputs_read);
    screen->vtbl.populate_tes_key(ice, &ish->nir->info, last_vue_stage(ice), &key);
 
+   iris_finish_precompile(ice, ish);
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_TES];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_TES, sizeof(key), &key);
@@ -1592,15 +1692,10 @@ iris_compile_gs(struct iris_context *ice,
       screen->vtbl.create_so_decl_list(&ish->stream_output,
                                     &vue_prog_data->vue_map);
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_GS, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs, &bt);
-
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(ice, ish, mem_ctx, IRIS_CACHE_GS, sizeof(*key),
+                              key, program, prog_data, so_decls,
+                              system_values, num_system_values, num_cbufs,
+                              &bt);
 }
 
 /**
@@ -1622,6 +1717,8 @@ iris_update_compiled_gs(struct iris_context *ice)
       struct iris_gs_prog_key key = { KEY_ID(vue.base) };
       screen->vtbl.populate_gs_key(ice, &ish->nir->info, last_vue_stage(ice), &key);
 
+      iris_finish_precompile(ice, ish);
+
       shader =
          iris_find_cached_shader(ice, IRIS_CACHE_GS, sizeof(key), &key);
 
@@ -1707,15 +1804,10 @@ iris_compile_fs(struct iris_context *ice,
       ish->compiled_once = true;
    }
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_FS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs, &bt);
-
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(ice, ish, mem_ctx, IRIS_CACHE_FS, sizeof(*key),
+                              key, program, prog_data, NULL,
+                              system_values, num_system_values, num_cbufs,
+                              &bt);
 }
 
 /**
@@ -1736,6 +1828,8 @@ iris_update_compiled_fs(struct iris_context *ice)
    if (ish->nos & (1ull << IRIS_NOS_LAST_VUE_MAP))
       key.input_slots_valid = ice->shaders.last_vue_map->slots_valid;
 
+   iris_finish_precompile(ice, ish);
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_FS];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_FS, sizeof(key), &key);
@@ -1989,15 +2083,10 @@ iris_compile_cs(struct iris_context *ice,
       ish->compiled_once = true;
    }
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_CS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs, &bt);
-
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(ice, ish, mem_ctx, IRIS_CACHE_CS, sizeof(*key),
+                              key, program, prog_data, NULL,
+                              system_values, num_system_values, num_cbufs,
+                              &bt);
 }
 
 static void
@@ -2011,6 +2100,8 @@ iris_update_compiled_cs(struct iris_context *ice)
    struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
    screen->vtbl.populate_cs_key(ice, &key);
 
+   iris_finish_precompile(ice, ish);
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_CS];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_CS, sizeof(key), &key);
@@ -2154,6 +2245,8 @@ iris_create_uncompiled_shader(struct pipe_context *ctx,
    if (!ish)
       return NULL;
 
+   util_queue_fence_init(&ish->ready);
+
    NIR_PASS(ish->needs_edge_flag, nir, iris_fix_edge_flags);
 
    brw_preprocess_nir(screen->compiler, nir, NULL);
@@ -2204,6 +2297,93 @@ iris_create_uncompiled_shader(struct pipe_context *ctx,
    return ish;
 }
 
+struct iris_precompile_job {
+   struct iris_context *ice;
+   struct iris_uncompiled_shader *ish;
+   union {
+      struct iris_vs_prog_key vs;
+      struct iris_tcs_prog_key tcs;
+      struct iris_tes_prog_key tes;
+      struct iris_gs_prog_key gs;
+      struct iris_fs_prog_key fs;
+      struct iris_cs_prog_key cs;
+   } key;
+};
+
+static void
+iris_precompile_execute(void *data, int thread_index)
+{
+   struct iris_precompile_job *job = data;
+   struct iris_context *ice = job->ice;
+   struct iris_uncompiled_shader *ish = job->ish;
+
+   switch (ish->nir->info.stage) {
+   case MESA_SHADER_VERTEX:
+      iris_compile_vs(ice, ish, &job->key.vs);
+      break;
+   case MESA_SHADER_TESS_CTRL:
+      iris_compile_tcs(ice, ish, &job->key.tcs);
+      break;
+   case MESA_SHADER_TESS_EVAL:
+      iris_compile_tes(ice, ish, &job->key.tes);
+      break;
+   case MESA_SHADER_GEOMETRY:
+      iris_compile_gs(ice, ish, &job->key.gs);
+      break;
+   case MESA_SHADER_FRAGMENT:
+      iris_compile_fs(ice, ish, &job->key.fs, NULL);
+      break;
+   case MESA_SHADER_COMPUTE:
+      iris_compile_cs(ice, ish, &job->key.cs);
+      break;
+   default:
+      unreachable("invalid shader stage");
+   }
+
+   ish->compiling_async = false;
+}
+
+static void
+iris_precompile_cleanup(void *data, int thread_index)
+{
+   free(data);
+}
+
+/**
+ * Compile the variant we guess will be used, on the screen's compiler
+ * queue if there is one.
+ *
+ * The job only compiles; iris_finish_precompile() does the upload once
+ * the shader is actually used.  Draws never use a variant with a different
+ * key in the meantime, since the key contains state the program depends on.
+ */
+static void
+iris_precompile(struct iris_context *ice,
+                struct iris_uncompiled_shader *ish,
+                const void *key, unsigned key_size)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_precompile_job *job = calloc(1, sizeof(*job));
+
+   if (!job)
+      return;
+
+   assert(key_size <= sizeof(job->key));
+   job->ice = ice;
+   job->ish = ish;
+   memcpy(&job->key, key, key_size);
+
+   if (!util_queue_is_initialized(&screen->shader_compiler_queue)) {
+      iris_precompile_execute(job, 0);
+      iris_precompile_cleanup(job, 0);
+      return;
+   }
+
+   ish->compiling_async = true;
+   util_queue_add_job(&screen->shader_compiler_queue, job, &ish->ready,
+                      iris_precompile_execute, iris_precompile_cleanup, 0);
+}
+
 static struct iris_uncompiled_shader *
 iris_create_shader_state(struct pipe_context *ctx,
                          const struct pipe_shader_state *state)
@@ -2234,7 +2414,7 @@ iris_create_vs_state(struct pipe_context *ctx,
       struct iris_vs_prog_key key = { KEY_ID(vue.base) };
 
       if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_vs(ice, ish, &key);
+         iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2271,7 +2451,7 @@ iris_create_tcs_state(struct pipe_context *ctx,
          key.input_vertices = info->tess.tcs_vertices_out;
 
       if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_tcs(ice, ish, &key);
+         iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2299,7 +2479,7 @@ iris_create_tes_state(struct pipe_context *ctx,
       };
 
       if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_tes(ice, ish, &key);
+         iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2321,7 +2501,7 @@ iris_create_gs_state(struct pipe_context *ctx,
       struct iris_gs_prog_key key = { KEY_ID(vue.base) };
 
       if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_gs(ice, ish, &key);
+         iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2366,7 +2546,7 @@ iris_create_fs_state(struct pipe_context *ctx,
       };
 
       if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_fs(ice, ish, &key, NULL);
+         iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2389,7 +2569,7 @@ iris_create_compute_state(struct pipe_context *ctx,
       struct iris_cs_prog_key key = { KEY_ID(base) };
 
       if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_cs(ice, ish, &key);
+         iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2406,6 +2586,10 @@ iris_delete_shader_state(struct pipe_context *ctx, void *state, gl_shader_stage
    struct iris_uncompiled_shader *ish = state;
    struct iris_context *ice = (void *) ctx;
 
+   util_queue_fence_wait(&ish->ready);
+   ralloc_free(ish->precompiled);
+   util_queue_fence_destroy(&ish->ready);
+
    if (ice->shaders.uncompiled[stage] == ish) {
       ice->shaders.uncompiled[stage] = NULL;
       ice->state.stage_dirty |= IRIS_STAGE_DIRTY_UNCOMPILED_VS << stage;
@@ -263,6 +263,10 @@ iris_blorp_lookup_shader(struct blorp_batch *blorp_batch,
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_BLORP, key_size, key);
 
+   /* Other contexts and earlier runs store their BLORP shaders on disk. */
+   if (!shader)
+      shader = iris_disk_cache_retrieve_blorp(ice, key, key_size);
+
    if (!shader)
       return false;
 
@@ -279,15 +283,20 @@ iris_blorp_lookup_shader(struct blorp_batch *blorp_batch,
 bool
 iris_blorp_upload_shader(struct blorp_batch *blorp_batch, uint32_t stage,
                          const void *key, uint32_t key_size,
-                         const void *kernel, UNUSED uint32_t kernel_size,
+                         const void *kernel, uint32_t kernel_size,
                          const struct brw_stage_prog_data *prog_data_templ,
-                         UNUSED uint32_t prog_data_size,
+                         uint32_t prog_data_size,
                          uint32_t *kernel_out, void *prog_data_out)
 {
    struct blorp_context *blorp = blorp_batch->blorp;
    struct iris_context *ice = blorp->driver_ctx;
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
    struct iris_batch *batch = blorp_batch->driver_batch;
 
+   iris_disk_cache_store_blorp(screen->disk_cache, key, key_size,
+                               kernel, kernel_size,
+                               prog_data_templ, prog_data_size);
+
    void *prog_data = ralloc_size(NULL, prog_data_size);
    memcpy(prog_data, prog_data_templ, prog_data_size);
 
@@ -325,6 +334,12 @@ iris_init_program_cache(struct iris_context *ice)
 void
 iris_destroy_program_cache(struct iris_context *ice)
 {
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+
+   /* Precompile jobs for this context's shaders may still be running. */
+   if (util_queue_is_initialized(&screen->shader_compiler_queue))
+      util_queue_finish(&screen->shader_compiler_queue);
+
    for (int i = 0; i < MESA_SHADER_STAGES; i++) {
       ice->shaders.prog[i] = NULL;
 
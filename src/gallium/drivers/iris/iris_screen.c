@@ -38,6 +38,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_screen.h"
 #include "util/debug.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_inlines.h"
 #include "util/format/u_format.h"
 #include "util/u_transfer_helper.h"
@@ -194,6 +195,8 @@ iris_get_param(struct pipe_screen *pscreen, enum pipe_cap param)
    case PIPE_CAP_DEMOTE_TO_HELPER_INVOCATION:
    case PIPE_CAP_NATIVE_FENCE_FD:
    case PIPE_CAP_MIXED_COLOR_DEPTH_BITS:
+   case PIPE_CAP_CONSTBUF_PARTIAL_UPDATES:
+   case PIPE_CAP_SHAREABLE_CSOS:
       return true;
    case PIPE_CAP_FBFETCH:
       return BRW_MAX_DRAW_BUFFERS;
@@ -525,6 +528,8 @@ iris_get_timestamp(struct pipe_screen *pscreen)
 void
 iris_screen_destroy(struct iris_screen *screen)
 {
+   if (util_queue_is_initialized(&screen->shader_compiler_queue))
+      util_queue_destroy(&screen->shader_compiler_queue);
    iris_bo_unreference(screen->workaround_bo);
    u_transfer_helper_destroy(screen->base.transfer_helper);
    iris_bufmgr_unref(screen->bufmgr);
@@ -733,6 +738,18 @@ iris_screen_create(int fd, const struct pipe_screen_config *config)
 
    screen->precompile = env_var_as_boolean("shader_precompile", true);
 
+   if (screen->precompile) {
+      util_cpu_detect();
+      unsigned num_threads =
+         CLAMP(util_cpu_caps.nr_cpus - 1, 1, IRIS_MAX_COMPILER_THREADS);
+
+      /* If this fails, the precompiles just happen synchronously. */
+      util_queue_init(&screen->shader_compiler_queue, "iris_sh", 64,
+                      num_threads,
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                      UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY);
+   }
+
    isl_device_init(&screen->isl_dev, &screen->devinfo, false);
 
    screen->compiler = brw_compiler_create(screen, &screen->devinfo);
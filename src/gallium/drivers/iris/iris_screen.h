@@ -27,6 +27,7 @@
 #include "frontend/drm_driver.h"
 #include "util/disk_cache.h"
 #include "util/slab.h"
+#include "util/u_queue.h"
 #include "util/u_screen.h"
 #include "intel/dev/gen_device_info.h"
 #include "intel/isl/isl.h"
@@ -49,6 +50,7 @@ enum iris_program_cache_id;
 
 #define IRIS_MAX_TEXTURE_SAMPLERS 32
 #define IRIS_MAX_SOL_BUFFERS 4
+#define IRIS_MAX_COMPILER_THREADS 4
 #define IRIS_MAP_BUFFER_ALIGNMENT 64
 
 /**
@@ -171,6 +173,12 @@ struct iris_screen {
    /** Precompile shaders at link time?  (Can be disabled for debugging.) */
    bool precompile;
 
+   /**
+    * Threads running the precompiles, so that shader creation doesn't wait
+    * for the backend compiler.  Only initialized if precompile is set.
+    */
+   struct util_queue shader_compiler_queue;
+
    /** driconf options and application workarounds */
    struct {
       /** Dual color blend by location instead of index (for broken apps) */
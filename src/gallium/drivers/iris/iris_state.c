@@ -7725,6 +7725,7 @@ genX(init_state)(struct iris_context *ice)
    ctx->sampler_view_destroy = iris_sampler_view_destroy;
    ctx->surface_destroy = iris_surface_destroy;
    ctx->draw_vbo = iris_draw_vbo;
+   ctx->multi_draw = iris_multi_draw;
    ctx->launch_grid = iris_launch_grid;
    ctx->create_stream_output_target = iris_create_stream_output_target;
    ctx->stream_output_target_destroy = iris_stream_output_target_destroy;
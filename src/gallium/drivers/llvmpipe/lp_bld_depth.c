@@ -515,6 +515,21 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Extract one 8-wide half of a 16-wide fragment vector, passing
+ * through NULL for optional arguments.
+ */
+static LLVMValueRef
+lp_build_depth_half(struct gallivm_state *gallivm,
+                    LLVMValueRef value,
+                    unsigned half)
+{
+   if (!value)
+      return NULL;
+   return lp_build_extract_range(gallivm, value, half * 8, 8);
+}
+
+
 /**
  * Load depth/stencil values.
  * The stored values are linear, swizzle them.
@@ -549,6 +564,32 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
    struct lp_type zs_type = lp_depth_type(format_desc, z_src_type.length);
    struct lp_type zs_load_type = zs_type;
 
+   if (z_src_type.length == 16) {
+      /*
+       * A 16-wide vector covers the whole 4x4 block: load it as the two
+       * 4x2 halves the 8-wide path would see and concatenate them.
+       */
+      struct lp_type half_type = z_src_type;
+      LLVMValueRef z_half[2], s_half[2];
+      unsigned h;
+
+      assert(!is_1d);
+      half_type.length = 8;
+      for (h = 0; h < 2; h++) {
+         LLVMValueRef counter =
+            LLVMBuildAdd(builder,
+                         LLVMBuildShl(builder, loop_counter,
+                                      lp_build_const_int32(gallivm, 1), ""),
+                         lp_build_const_int32(gallivm, h), "");
+         lp_build_depth_stencil_load_swizzled(gallivm, half_type, format_desc,
+                                              is_1d, depth_ptr, depth_stride,
+                                              &z_half[h], &s_half[h], counter);
+      }
+      *z_fb = lp_build_concat(gallivm, z_half, half_type, 2);
+      *s_fb = lp_build_concat(gallivm, s_half, half_type, 2);
+      return;
+   }
+
    zs_load_type.length = zs_load_type.length / 2;
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
@@ -693,6 +734,31 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
    struct lp_type z_type = zs_type;
    struct lp_type zs_load_type = zs_type;
 
+   if (z_src_type.length == 16) {
+      /* Store the 16-wide vector as two 4x2 halves, see the load above. */
+      struct lp_type half_type = z_src_type;
+      unsigned h;
+
+      assert(!is_1d);
+      half_type.length = 8;
+      for (h = 0; h < 2; h++) {
+         LLVMValueRef counter =
+            LLVMBuildAdd(builder,
+                         LLVMBuildShl(builder, loop_counter,
+                                      lp_build_const_int32(gallivm, 1), ""),
+                         lp_build_const_int32(gallivm, h), "");
+         lp_build_depth_stencil_write_swizzled(gallivm, half_type, format_desc,
+                                               is_1d,
+                                               lp_build_depth_half(gallivm, mask_value, h),
+                                               lp_build_depth_half(gallivm, z_fb, h),
+                                               lp_build_depth_half(gallivm, s_fb, h),
+                                               counter, depth_ptr, depth_stride,
+                                               lp_build_depth_half(gallivm, z_value, h),
+                                               lp_build_depth_half(gallivm, s_value, h));
+      }
+      return;
+   }
+
    zs_load_type.length = zs_load_type.length / 2;
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
@@ -30,8 +30,38 @@
 
 #include "util/u_thread.h"
 #include "util/u_memory.h"
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "lp_cs_tpool.h"
 
+/**
+ * Claim the next chunk of iterations of a task, returning the number of
+ * iterations claimed starting at *first, or 0 if the task is exhausted.
+ *
+ * Chunks are guided: each claim takes a share of what is left divided
+ * between the threads, so early claims are big and amortize the atomic,
+ * while the last ones are single iterations to balance the tail.
+ */
+static unsigned
+lp_cs_tpool_claim(struct lp_cs_tpool *pool, struct lp_cs_tpool_task *task,
+                  unsigned *first)
+{
+   unsigned start = p_atomic_read(&task->iter_start);
+
+   while (start < task->iter_total) {
+      unsigned remaining = task->iter_total - start;
+      unsigned chunk = MAX2(remaining / (2 * pool->num_threads), 1);
+      unsigned prev = p_atomic_cmpxchg(&task->iter_start, start,
+                                       start + chunk);
+      if (prev == start) {
+         *first = start;
+         return chunk;
+      }
+      start = prev;
+   }
+   return 0;
+}
+
 static int
 lp_cs_tpool_worker(void *data)
 {
@@ -43,6 +73,7 @@ lp_cs_tpool_worker(void *data)
 
    while (!pool->shutdown) {
       struct lp_cs_tpool_task *task;
+      unsigned first, count, done = 0;
 
       while (list_is_empty(&pool->workqueue) && !pool->shutdown)
          cnd_wait(&pool->new_work, &pool->m);
@@ -52,16 +83,24 @@ lp_cs_tpool_worker(void *data)
 
       task = list_first_entry(&pool->workqueue, struct lp_cs_tpool_task,
                               list);
-      unsigned this_iter = task->iter_start++;
+      /* Keep the task alive while we claim from it without the lock. */
+      task->num_workers++;
+      mtx_unlock(&pool->m);
 
-      if (task->iter_start == task->iter_total)
-         list_del(&task->list);
+      while ((count = lp_cs_tpool_claim(pool, task, &first)) != 0) {
+         for (unsigned i = 0; i < count; i++)
+            task->work(task->data, first + i, &lmem);
+         done += count;
+      }
 
-      mtx_unlock(&pool->m);
-      task->work(task->data, this_iter, &lmem);
       mtx_lock(&pool->m);
-      task->iter_finished++;
-      if (task->iter_finished == task->iter_total)
+      if (task->queued) {
+         list_del(&task->list);
+         task->queued = false;
+      }
+      task->iter_finished += done;
+      task->num_workers--;
+      if (task->iter_finished == task->iter_total && task->num_workers == 0)
          cnd_broadcast(&task->finish);
    }
    mtx_unlock(&pool->m);
@@ -70,7 +109,7 @@ lp_cs_tpool_worker(void *data)
 }
 
 struct lp_cs_tpool *
-lp_cs_tpool_create(unsigned num_threads)
+lp_cs_tpool_create(unsigned num_threads, bool pin_threads)
 {
    struct lp_cs_tpool *pool = CALLOC_STRUCT(lp_cs_tpool);
 
@@ -85,6 +124,20 @@ lp_cs_tpool_create(unsigned num_threads)
    pool->num_threads = num_threads;
    for (unsigned i = 0; i < num_threads; i++)
       pool->threads[i] = u_thread_create(lp_cs_tpool_worker, pool);
+
+   /* Spread the workers evenly over the L3 caches, keeping neighbouring
+    * threads (which claim neighbouring chunks) on the same cache/node.
+    */
+   if (pin_threads && util_cpu_caps.cores_per_L3 &&
+       util_cpu_caps.nr_cpus > util_cpu_caps.cores_per_L3) {
+      unsigned num_L3_caches = util_cpu_caps.nr_cpus /
+                               util_cpu_caps.cores_per_L3;
+
+      for (unsigned i = 0; i < num_threads; i++)
+         util_pin_thread_to_L3(pool->threads[i],
+                               i * num_L3_caches / num_threads,
+                               util_cpu_caps.cores_per_L3);
+   }
    return pool;
 }
 
@@ -136,6 +189,7 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
    mtx_lock(&pool->m);
 
    list_addtail(&task->list, &pool->workqueue);
+   task->queued = true;
 
    cnd_broadcast(&pool->new_work);
    mtx_unlock(&pool->m);
@@ -152,7 +206,7 @@ lp_cs_tpool_wait_for_task(struct lp_cs_tpool *pool,
       return;
 
    mtx_lock(&pool->m);
-   while (task->iter_finished < task->iter_total)
+   while (task->iter_finished < task->iter_total || task->num_workers)
       cnd_wait(&task->finish, &pool->m);
    mtx_unlock(&pool->m);
 
@@ -64,11 +64,13 @@ struct lp_cs_tpool_task {
    struct list_head list;
    cnd_t finish;
    unsigned iter_total;
-   unsigned iter_start;
+   unsigned iter_start;    /* next unclaimed iteration, claimed atomically */
    unsigned iter_finished;
+   unsigned num_workers;   /* threads currently claiming from this task */
+   bool queued;
 };
 
-struct lp_cs_tpool *lp_cs_tpool_create(unsigned num_threads);
+struct lp_cs_tpool *lp_cs_tpool_create(unsigned num_threads, bool pin_threads);
 void lp_cs_tpool_destroy(struct lp_cs_tpool *);
 
 struct lp_cs_tpool_task *lp_cs_tpool_queue_task(struct lp_cs_tpool *,
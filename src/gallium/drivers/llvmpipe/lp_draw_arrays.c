@@ -39,6 +39,8 @@
 #include "lp_context.h"
 #include "lp_state.h"
 #include "lp_query.h"
+#include "lp_flush.h"
+#include "lp_setup.h"
 
 #include "draw/draw_context.h"
 
@@ -69,6 +71,27 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
+   /* Vertex processing runs right here while earlier scenes may still be
+    * rasterizing, so wait for those writing to anything it reads.
+    */
+   for (i = 0; i < lp->num_vertex_buffers; i++) {
+      if (!lp->vertex_buffer[i].is_user_buffer &&
+          lp->vertex_buffer[i].buffer.resource)
+         lp_setup_wait_resource(lp->setup,
+                                lp->vertex_buffer[i].buffer.resource, TRUE);
+   }
+   if (info->index_size && !info->has_user_indices)
+      lp_setup_wait_resource(lp->setup, info->index.resource, TRUE);
+   for (i = 0; i < lp->num_so_targets; i++) {
+      if (lp->so_targets[i])
+         lp_setup_wait_resource(lp->setup,
+                                lp->so_targets[i]->target.buffer, FALSE);
+   }
+   llvmpipe_wait_stage_resources(lp, PIPE_SHADER_VERTEX);
+   llvmpipe_wait_stage_resources(lp, PIPE_SHADER_GEOMETRY);
+   llvmpipe_wait_stage_resources(lp, PIPE_SHADER_TESS_CTRL);
+   llvmpipe_wait_stage_resources(lp, PIPE_SHADER_TESS_EVAL);
+
    /*
     * Map vertex buffers
     */
@@ -131,3 +131,41 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
 
    return TRUE;
 }
+
+
+/**
+ * Wait for queued scenes which conflict with the resources bound to a shader
+ * stage that runs on the application thread (vertex processing in the draw
+ * module, or compute).  Such stages don't go through the rasterizer, so
+ * they have to be ordered against earlier scenes explicitly.
+ */
+void
+llvmpipe_wait_stage_resources(struct llvmpipe_context *lp,
+                              enum pipe_shader_type stage)
+{
+   struct lp_setup_context *setup = lp->setup;
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(lp->constants[stage]); i++) {
+      if (lp->constants[stage][i].buffer)
+         lp_setup_wait_resource(setup, lp->constants[stage][i].buffer, TRUE);
+   }
+
+   for (i = 0; i < lp->num_sampler_views[stage]; i++) {
+      if (lp->sampler_views[stage][i])
+         lp_setup_wait_resource(setup, lp->sampler_views[stage][i]->texture,
+                                TRUE);
+   }
+
+   for (i = 0; i < lp->num_images[stage]; i++) {
+      const struct pipe_image_view *image = &lp->images[stage][i];
+      if (image->resource)
+         lp_setup_wait_resource(setup, image->resource,
+                                !(image->access & PIPE_IMAGE_ACCESS_WRITE));
+   }
+
+   for (i = 0; i < ARRAY_SIZE(lp->ssbos[stage]); i++) {
+      if (lp->ssbos[stage][i].buffer)
+         lp_setup_wait_resource(setup, lp->ssbos[stage][i].buffer, FALSE);
+   }
+}
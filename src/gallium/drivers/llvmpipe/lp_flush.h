@@ -29,7 +29,9 @@
 #define LP_FLUSH_H
 
 #include "pipe/p_compiler.h"
+#include "pipe/p_defines.h"
 
+struct llvmpipe_context;
 struct pipe_context;
 struct pipe_fence_handle;
 struct pipe_resource;
@@ -52,4 +54,8 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
                         boolean do_not_block,
                         const char *reason);
 
+void
+llvmpipe_wait_stage_resources(struct llvmpipe_context *lp,
+                              enum pipe_shader_type stage);
+
 #endif
@@ -34,10 +34,14 @@
 
 
 /**
- * Tile size (width and height). This needs to be a power of two.
+ * Tile size (width and height) as a power of two.  The screen picks the
+ * order with LP_TILE_SIZE, scenes covering very large framebuffers may use
+ * bigger tiles to stay within LP_MAX_BINS.
  */
-#define TILE_ORDER 6
-#define TILE_SIZE (1 << TILE_ORDER)
+#define LP_MIN_TILE_ORDER 5
+#define LP_MAX_TILE_ORDER 7
+#define LP_DEFAULT_TILE_ORDER 6
+#define LP_MAX_TILE_SIZE (1 << LP_MAX_TILE_ORDER)
 
 
 /**
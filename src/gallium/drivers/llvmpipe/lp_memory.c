@@ -32,5 +32,5 @@
 /* A single dummy tile used in a couple of out-of-memory situations. 
  */
 PIPE_ALIGN_VAR(LP_MIN_VECTOR_ALIGN)
-uint8_t lp_dummy_tile[TILE_SIZE * TILE_SIZE * 4];
+uint8_t lp_dummy_tile[LP_MAX_TILE_SIZE * LP_MAX_TILE_SIZE * 4];
 
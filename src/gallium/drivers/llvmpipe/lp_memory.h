@@ -35,6 +35,6 @@
 #include "gallivm/lp_bld_type.h"
 
 extern PIPE_ALIGN_VAR(LP_MIN_VECTOR_ALIGN)
-uint8_t lp_dummy_tile[TILE_SIZE * TILE_SIZE * 4];
+uint8_t lp_dummy_tile[LP_MAX_TILE_SIZE * LP_MAX_TILE_SIZE * 4];
 
 #endif /* LP_MEMORY_H */
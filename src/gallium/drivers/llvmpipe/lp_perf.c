@@ -46,6 +46,7 @@ lp_print_counters(void)
 {
    if (LP_DEBUG & DEBUG_COUNTERS) {
       unsigned total_64, total_16, total_4;
+      unsigned i;
       float p1, p2, p3, p4, p5, p6;
 
       debug_printf("llvmpipe: nr_triangles:                 %9u\n", lp_count.nr_tris);
@@ -97,6 +98,7 @@ lp_print_counters(void)
       debug_printf("llvmpipe:   nr_partially_covered_4x4:   %9u (%3.0f%% of %u)\n", lp_count.nr_partially_covered_4, p3, total_4);
       debug_printf("llvmpipe:   nr_empty_4x4:               %9u (%3.0f%% of %u)\n", lp_count.nr_empty_4, p1, total_4);
       debug_printf("llvmpipe:   nr_non_empty_4x4:           %9u (%3.0f%% of %u)\n", lp_count.nr_non_empty_4, p4, total_4);
+      debug_printf("llvmpipe:   nr_hiz_culled_4x4:          %9u\n", lp_count.nr_hiz_culled_4);
 
       debug_printf("llvmpipe: nr_color_tile_clear:          %9u\n", lp_count.nr_color_tile_clear);
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
@@ -106,5 +108,13 @@ lp_print_counters(void)
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
 
+      for (i = 0; i < LP_MAX_THREADS; i++) {
+         if (!lp_count.rast_busy_time[i])
+            continue;
+         debug_printf("llvmpipe: thread %2u busy time:          %.2f sec, %u bins stolen\n",
+                      i, lp_count.rast_busy_time[i] / 1000000.0,
+                      lp_count.nr_bins_stolen[i]);
+      }
+
    }
 }
@@ -74,15 +74,17 @@ lp_rast_begin( struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene, MAX2(1, rast->num_threads) );
 }
 
 
+/**
+ * The scene itself is cleaned up by the setup module once the scene's fence
+ * has signalled, so nothing here may touch it anymore.
+ */
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
-
    rast->curr_scene = NULL;
 }
 
@@ -103,18 +105,22 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    LP_DBG(DEBUG_RAST, "%s %d,%d\n", __FUNCTION__, x, y);
 
    task->bin = bin;
-   task->x = x * TILE_SIZE;
-   task->y = y * TILE_SIZE;
-   task->width = TILE_SIZE + x * TILE_SIZE > task->scene->fb.width ?
-                    task->scene->fb.width - x * TILE_SIZE : TILE_SIZE;
-   task->height = TILE_SIZE + y * TILE_SIZE > task->scene->fb.height ?
-                    task->scene->fb.height - y * TILE_SIZE : TILE_SIZE;
+   task->x = x << scene->tile_order;
+   task->y = y << scene->tile_order;
+   task->width = MIN2(scene->tile_size, scene->fb.width - task->x);
+   task->height = MIN2(scene->tile_size, scene->fb.height - task->y);
 
    task->thread_data.vis_counter = 0;
    task->thread_data.ps_invocations = 0;
 
    for (i = 0; i < task->scene->fb.nr_cbufs; i++) {
-      if (task->scene->fb.cbufs[i]) {
+      if (scene->cbufs[i].tile_row_stride) {
+         /* The tile is contiguous, with rows of cbufs[i].stride bytes. */
+         task->color_tiles[i] = scene->cbufs[i].map +
+                                scene->cbufs[i].tile_row_stride * y +
+                                scene->cbufs[i].stride * scene->tile_size * x;
+      }
+      else if (task->scene->fb.cbufs[i]) {
          task->color_tiles[i] = scene->cbufs[i].map +
                                 scene->cbufs[i].stride * task->y +
                                 scene->cbufs[i].format_bytes * task->x;
@@ -125,6 +131,17 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
                          scene->zsbuf.stride * task->y +
                          scene->zsbuf.format_bytes * task->x;
    }
+
+   /* The depth bounds are per tile, and only tracked for single layer,
+    * single sample depth buffers.
+    */
+   task->hiz_enabled = scene->zsbuf.map &&
+                       scene->fb_max_layer == 0 &&
+                       scene->fb_max_samples == 1;
+   if (task->hiz_enabled)
+      lp_rast_hiz_reset(task);
+
+   task->linear_state = NULL;
 }
 
 
@@ -156,14 +173,15 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
    LP_DBG(DEBUG_RAST, "%s clear value (target format %d) raw 0x%x,0x%x,0x%x,0x%x\n",
           __FUNCTION__, format, uc.ui[0], uc.ui[1], uc.ui[2], uc.ui[3]);
 
+   /* Relative to the tile, which works for both color buffer layouts. */
    for (unsigned s = 0; s < scene->cbufs[cbuf].nr_samples; s++) {
-      void *map = (char *)scene->cbufs[cbuf].map + scene->cbufs[cbuf].sample_stride * s;
+      void *map = task->color_tiles[cbuf] + scene->cbufs[cbuf].sample_stride * s;
       util_fill_box(map,
                     format,
                     scene->cbufs[cbuf].stride,
                     scene->cbufs[cbuf].layer_stride,
-                    task->x,
-                    task->y,
+                    0,
+                    0,
                     0,
                     task->width,
                     task->height,
@@ -292,11 +310,160 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
             dst_layer += scene->zsbuf.layer_stride;
          }
       }
+
+      if (task->hiz_enabled)
+         lp_rast_hiz_reset(task);
    }
 }
 
 
 
+/**
+ * Return the constant color of the current state's linear variant, as a
+ * cbuf 0 pixel.  It is found by running the shader once on a scratch 4x4
+ * block, cleared to zero so that premultiplied "over" blending leaves the
+ * source color.
+ */
+static uint32_t
+lp_rast_linear_color(struct lp_rasterizer_task *task,
+                     const struct lp_rast_shader_inputs *inputs)
+{
+   const struct lp_rast_state *state = task->state;
+
+   if (task->linear_state != state) {
+      PIPE_ALIGN_VAR(16) uint32_t block[4 * 4] = { 0 };
+      uint8_t *color[PIPE_MAX_COLOR_BUFS] = { (uint8_t *)block };
+      unsigned stride[PIPE_MAX_COLOR_BUFS] = { 4 * sizeof(uint32_t) };
+      unsigned sample_stride[PIPE_MAX_COLOR_BUFS] = { 0 };
+      uint64_t ps_invocations = task->thread_data.ps_invocations;
+
+      BEGIN_JIT_CALL(state, task);
+      state->variant->jit_function[RAST_WHOLE](&state->jit_context,
+                                               0, 0,
+                                               inputs->frontfacing,
+                                               GET_A0(inputs),
+                                               GET_DADX(inputs),
+                                               GET_DADY(inputs),
+                                               color,
+                                               NULL,
+                                               0xffff,
+                                               &task->thread_data,
+                                               stride,
+                                               0,
+                                               sample_stride,
+                                               0);
+      END_JIT_CALL();
+
+      /* The scratch block isn't a shader invocation. */
+      task->thread_data.ps_invocations = ps_invocations;
+
+      task->linear_state = state;
+      task->linear_color = block[0];
+   }
+
+   return task->linear_color;
+}
+
+
+/**
+ * Blend a premultiplied source pixel over a destination one, with the
+ * same rounding as the generated blend code.
+ */
+static inline uint32_t
+lp_rast_linear_over(uint32_t src, uint32_t dst, unsigned inv_alpha)
+{
+   uint32_t res = 0;
+   unsigned shift;
+
+   for (shift = 0; shift < 32; shift += 8) {
+      unsigned t = ((dst >> shift) & 0xff) * inv_alpha + 0x80;
+      t = ((src >> shift) & 0xff) + ((t + (t >> 8)) >> 8);
+      res |= MIN2(t, 0xff) << shift;
+   }
+
+   return res;
+}
+
+
+/**
+ * Shade the pixels of a width x height rectangle of cbuf 0 at x, y with
+ * the constant color of a linear variant, one span per row.  Bit
+ * 4 * row + column of mask enables a pixel of the first 4x4 block and
+ * must be all ones for larger rectangles.
+ */
+static void
+lp_rast_shade_linear(struct lp_rasterizer_task *task,
+                     const struct lp_rast_shader_inputs *inputs,
+                     unsigned x, unsigned y,
+                     unsigned width, unsigned height,
+                     unsigned mask)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct lp_fragment_shader_variant *variant = task->state->variant;
+   const unsigned stride = scene->cbufs[0].stride;
+   const unsigned px = x & (scene->tile_size - 1);
+   const unsigned py = y & (scene->tile_size - 1);
+   uint8_t *dst;
+   uint32_t color;
+   unsigned inv_alpha, i, j;
+
+   if (px >= task->width || py >= task->height)
+      return;
+
+   width = MIN2(width, task->width - px);
+   height = MIN2(height, task->height - py);
+
+   /* Counted per 4x4 block, like the generated code does. */
+   task->thread_data.ps_invocations +=
+      DIV_ROUND_UP(width, 4) * DIV_ROUND_UP(height, 4);
+
+   color = lp_rast_linear_color(task, inputs);
+   inv_alpha = 0xff;
+   if (variant->linear_mode == LP_FS_LINEAR_OVER) {
+      inv_alpha = 0xff - ((const uint8_t *)&color)[variant->linear_alpha];
+      if (inv_alpha == 0xff && color == 0)
+         return;
+   }
+
+   dst = lp_rast_get_color_block_pointer(task, 0, x, y, inputs->layer);
+
+   for (j = 0; j < height; j++) {
+      uint32_t *row = (uint32_t *)(dst + j * stride);
+      const unsigned row_mask = mask >> (4 * j);
+
+      if (variant->linear_mode == LP_FS_LINEAR_OPAQUE || inv_alpha == 0) {
+         if (mask == 0xffff) {
+            for (i = 0; i < width; i++)
+               row[i] = color;
+         }
+         else {
+            for (i = 0; i < width; i++)
+               if (row_mask & (1 << i))
+                  row[i] = color;
+         }
+      }
+      else {
+         for (i = 0; i < width; i++)
+            if (mask == 0xffff || (row_mask & (1 << i)))
+               row[i] = lp_rast_linear_over(color, row[i], inv_alpha);
+      }
+   }
+}
+
+
+/**
+ * Shade a 4x4 block of a linear variant, see lp_rast_shade_linear().
+ */
+void
+lp_rast_shade_linear_block(struct lp_rasterizer_task *task,
+                           const struct lp_rast_shader_inputs *inputs,
+                           unsigned x, unsigned y,
+                           unsigned mask)
+{
+   lp_rast_shade_linear(task, inputs, x, y, 4, 4, mask);
+}
+
+
 /**
  * Run the shader on all blocks in a tile.  This is used when a tile is
  * completely contained inside a triangle.
@@ -327,7 +494,13 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
-   /* render the whole 64x64 tile in 4x4 chunks */
+   if (variant->linear_mode) {
+      lp_rast_shade_linear(task, inputs, tile_x, tile_y,
+                           task->width, task->height, 0xffff);
+      return;
+   }
+
+   /* render the whole tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
          uint8_t *color[PIPE_MAX_COLOR_BUFS];
@@ -365,6 +538,9 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          for (unsigned i = 0; i < scene->fb_max_samples; i++)
             mask |= (uint64_t)(0xffff) << (16 * i);
 
+         if (!lp_rast_hiz_test(task, inputs, tile_x + x, tile_y + y, TRUE))
+            continue;
+
          /* Propagate non-interpolated raster state. */
          task->thread_data.raster_state.viewport_index = inputs->viewport_index;
 
@@ -436,14 +612,19 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
    assert(state);
 
    /* Sanity checks */
-   assert(x < scene->tiles_x * TILE_SIZE);
-   assert(y < scene->tiles_y * TILE_SIZE);
+   assert(x < scene->tiles_x * scene->tile_size);
+   assert(y < scene->tiles_y * scene->tile_size);
    assert(x % TILE_VECTOR_WIDTH == 0);
    assert(y % TILE_VECTOR_HEIGHT == 0);
 
    assert((x % 4) == 0);
    assert((y % 4) == 0);
 
+   if (variant->linear_mode) {
+      lp_rast_shade_linear_block(task, inputs, x, y, mask & 0xffff);
+      return;
+   }
+
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       if (scene->fb.cbufs[i]) {
@@ -472,7 +653,9 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
     * The rasterizer may produce fragments outside our
     * allocated 4x4 blocks hence need to filter them out here.
     */
-   if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height) {
+   if ((x & (scene->tile_size - 1)) < task->width &&
+       (y & (scene->tile_size - 1)) < task->height &&
+       lp_rast_hiz_test(task, inputs, x, y, (mask & 0xffff) == 0xffff)) {
       /* Propagate non-interpolated raster state. */
       task->thread_data.raster_state.viewport_index = inputs->viewport_index;
 
@@ -574,6 +757,7 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
    task->state = arg.state;
+   task->linear_state = NULL;
 }
 
 
@@ -651,7 +835,7 @@ do_rasterize_bin(struct lp_rasterizer_task *task,
    unsigned k;
 
    if (0)
-      lp_debug_bin(bin, x, y);
+      lp_debug_bin(bin, x, y, task->scene->tile_size);
 
    for (block = bin->head; block; block = block->next) {
       for (k = 0; k < block->count; k++) {
@@ -730,13 +914,22 @@ rasterize_scene(struct lp_rasterizer_task *task,
       /* loop over scene bins, rasterize each */
       {
          struct cmd_bin *bin;
+         int64_t start = 0;
          int i, j;
 
+         if (LP_DEBUG & DEBUG_COUNTERS)
+            start = os_time_get();
+
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
+         while ((bin = lp_scene_bin_iter_next(scene, task->thread_index,
+                                              &i, &j))) {
             if (!is_empty_bin( bin ))
                rasterize_bin(task, bin, i, j);
          }
+
+         if (LP_DEBUG & DEBUG_COUNTERS)
+            LP_COUNT_ADD(rast_busy_time[task->thread_index],
+                         os_time_get() - start);
       }
    }
 
@@ -807,23 +1000,6 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
-void
-lp_rast_finish( struct lp_rasterizer *rast )
-{
-   if (rast->num_threads == 0) {
-      /* nothing to do */
-   }
-   else {
-      int i;
-
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
-   }
-}
-
-
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
@@ -888,11 +1064,11 @@ thread_function(void *init_data)
          lp_rast_end( rast );
       }
 
-      /* signal done with work */
+      /* Completion is reported through the scene's fence, there's nobody
+       * waiting on work_done until the thread exits.
+       */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
 #ifdef _WIN32
@@ -37,6 +37,7 @@
 #include "lp_state.h"
 #include "lp_texture.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
 
 
 #define TILE_VECTOR_HEIGHT 4
@@ -100,6 +101,18 @@ struct lp_rasterizer_task
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
+   /**
+    * Hierarchical depth of the current tile: an upper bound of the stored
+    * depth values of each 4x4 block, or infinity when unknown.  Row stride
+    * is tile_size / 4.  See lp_rast_hiz_test().
+    */
+   boolean hiz_enabled;
+   float hiz_zmax[(LP_MAX_TILE_SIZE / 4) * (LP_MAX_TILE_SIZE / 4)];
+
+   /** Constant color of a linear variant, valid for linear_state */
+   const struct lp_rast_state *linear_state;
+   uint32_t linear_color;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -108,7 +121,7 @@ struct lp_rasterizer_task
 /**
  * This is the state required while rasterizing tiles.
  * Note that this contains per-thread information too.
- * The tile size is TILE_SIZE x TILE_SIZE pixels.
+ * The tile size is given by each scene's tile_size.
  */
 struct lp_rasterizer
 {
@@ -144,7 +157,7 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
 
 
 /**
- * Get the pointer to a 4x4 color block (within a 64x64 tile).
+ * Get the pointer to a 4x4 color block (within a tile).
  * \param x, y location of 4x4 block in window coords
  */
 static inline uint8_t *
@@ -155,8 +168,8 @@ lp_rast_get_color_block_pointer(struct lp_rasterizer_task *task,
    unsigned px, py, pixel_offset;
    uint8_t *color;
 
-   assert(x < task->scene->tiles_x * TILE_SIZE);
-   assert(y < task->scene->tiles_y * TILE_SIZE);
+   assert(x < task->scene->tiles_x * task->scene->tile_size);
+   assert(y < task->scene->tiles_y * task->scene->tile_size);
    assert((x % TILE_VECTOR_WIDTH) == 0);
    assert((y % TILE_VECTOR_HEIGHT) == 0);
    assert(buf < task->scene->fb.nr_cbufs);
@@ -168,8 +181,8 @@ lp_rast_get_color_block_pointer(struct lp_rasterizer_task *task,
     * it's just extra work - the mul/add would be exactly the same anyway.
     * Fortunately the extra work (modulo) here is very cheap at least...
     */
-   px = x % TILE_SIZE;
-   py = y % TILE_SIZE;
+   px = x & (task->scene->tile_size - 1);
+   py = y & (task->scene->tile_size - 1);
 
    pixel_offset = px * task->scene->cbufs[buf].format_bytes +
                   py * task->scene->cbufs[buf].stride;
@@ -185,7 +198,7 @@ lp_rast_get_color_block_pointer(struct lp_rasterizer_task *task,
 
 
 /**
- * Get the pointer to a 4x4 depth block (within a 64x64 tile).
+ * Get the pointer to a 4x4 depth block (within a tile).
  * \param x, y location of 4x4 block in window coords
  */
 static inline uint8_t *
@@ -195,15 +208,15 @@ lp_rast_get_depth_block_pointer(struct lp_rasterizer_task *task,
    unsigned px, py, pixel_offset;
    uint8_t *depth;
 
-   assert(x < task->scene->tiles_x * TILE_SIZE);
-   assert(y < task->scene->tiles_y * TILE_SIZE);
+   assert(x < task->scene->tiles_x * task->scene->tile_size);
+   assert(y < task->scene->tiles_y * task->scene->tile_size);
    assert((x % TILE_VECTOR_WIDTH) == 0);
    assert((y % TILE_VECTOR_HEIGHT) == 0);
 
    assert(task->depth_tile);
 
-   px = x % TILE_SIZE;
-   py = y % TILE_SIZE;
+   px = x & (task->scene->tile_size - 1);
+   py = y & (task->scene->tile_size - 1);
 
    pixel_offset = px * task->scene->zsbuf.format_bytes +
                   py * task->scene->zsbuf.stride;
@@ -219,11 +232,88 @@ lp_rast_get_depth_block_pointer(struct lp_rasterizer_task *task,
 
 
 
+/**
+ * Forget the hierarchical depth bounds of the current tile.
+ */
+static inline void
+lp_rast_hiz_reset(struct lp_rasterizer_task *task)
+{
+   const unsigned blocks = task->scene->tile_size / 4;
+
+   for (unsigned i = 0; i < blocks * blocks; i++)
+      task->hiz_zmax[i] = INFINITY;
+}
+
+
+/**
+ * Test a 4x4 block against the hierarchical depth bound, and lower the
+ * bound when the block is fully covered by a depth writing triangle.
+ *
+ * The triangle's depth range over the block is evaluated from the
+ * position plane equation at the block corners, with a margin for the
+ * quantization to the depth format and for the precision loss of
+ * interpolating from the window origin.
+ *
+ * \param x, y location of 4x4 block in window coords
+ * \param full  whether all the block's pixels are covered
+ * 
+eturn FALSE if the whole block would fail the depth test
+ */
+static inline boolean
+lp_rast_hiz_test(struct lp_rasterizer_task *task,
+                 const struct lp_rast_shader_inputs *inputs,
+                 unsigned x, unsigned y, boolean full)
+{
+   const unsigned hiz_mode = task->state->variant->hiz_mode;
+   float *zmax;
+   float a0, dzdx, dzdy, z0, zlo, zhi, margin;
+
+   if (!task->hiz_enabled || !hiz_mode)
+      return TRUE;
+
+   zmax = &task->hiz_zmax[((y - task->y) / 4) * (task->scene->tile_size / 4) +
+                          (x - task->x) / 4];
+
+   if (hiz_mode & LP_HIZ_INVALIDATE) {
+      *zmax = INFINITY;
+      return TRUE;
+   }
+
+   a0 = GET_A0(inputs)[0][2];
+   dzdx = GET_DADX(inputs)[0][2];
+   dzdy = GET_DADY(inputs)[0][2];
+   z0 = a0 + dzdx * x + dzdy * y;
+   zlo = z0 + MIN2(dzdx * 4, 0.0f) + MIN2(dzdy * 4, 0.0f);
+   zhi = z0 + MAX2(dzdx * 4, 0.0f) + MAX2(dzdy * 4, 0.0f);
+
+   if (hiz_mode & LP_HIZ_CULL) {
+      margin = LP_HIZ_EPSILON +
+               (fabsf(a0) + fabsf(dzdx * x) + fabsf(dzdy * y)) *
+               (1.0f / (1 << 20));
+      if (CLAMP(zlo, 0.0f, 1.0f) > *zmax + margin) {
+         LP_COUNT(nr_hiz_culled_4);
+         return FALSE;
+      }
+   }
+
+   if ((hiz_mode & LP_HIZ_UPDATE) && full)
+      *zmax = MIN2(*zmax, CLAMP(zhi, 0.0f, 1.0f));
+
+   return TRUE;
+}
+
+
 /**
  * Shade all pixels in a 4x4 block.  The fragment code omits the
  * triangle in/out tests.
  * \param x, y location of 4x4 block in window coords
  */
+void
+lp_rast_shade_linear_block(struct lp_rasterizer_task *task,
+                           const struct lp_rast_shader_inputs *inputs,
+                           unsigned x, unsigned y,
+                           unsigned mask);
+
 static inline void
 lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
                          const struct lp_rast_shader_inputs *inputs,
@@ -240,6 +330,11 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    unsigned depth_sample_stride = 0;
    unsigned i;
 
+   if (variant->linear_mode) {
+      lp_rast_shade_linear_block(task, inputs, x, y, 0xffff);
+      return;
+   }
+
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       if (scene->fb.cbufs[i]) {
@@ -269,7 +364,9 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
     * The rasterizer may produce fragments outside our
     * allocated 4x4 blocks hence need to filter them out here.
     */
-   if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height) {
+   if ((x & (scene->tile_size - 1)) < task->width &&
+       (y & (scene->tile_size - 1)) < task->height &&
+       lp_rast_hiz_test(task, inputs, x, y, TRUE)) {
       /* Propagate non-interpolated raster state. */
       task->thread_data.raster_state.viewport_index = inputs->viewport_index;
 
@@ -403,6 +500,6 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg);
  
 void
-lp_debug_bin( const struct cmd_bin *bin, int x, int y );
+lp_debug_bin( const struct cmd_bin *bin, int x, int y, unsigned tile_size );
 
 #endif
@@ -191,104 +191,92 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
 
 
 /**
- * Scan the tile in chunks and figure out which pixels to rasterize
- * for this triangle.
+ * Evaluate a 64x64 block of pixels to determine which 16x16 subblocks are
+ * in/out of the triangle's bounds.  Only the subblocks in block_mask are
+ * rasterized, which lets tiles smaller than 64x64 reuse this.
  */
-void
-TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
-                      const union lp_rast_cmd_arg arg)
+static void
+TAG(do_block_64)(struct lp_rasterizer_task *task,
+                 const struct lp_rast_triangle *tri,
+                 const struct lp_rast_plane *plane,
+                 int x, int y,
+                 const int64_t *c,
+                 unsigned block_mask)
 {
-   const struct lp_rast_triangle *tri = arg.triangle.tri;
-   unsigned plane_mask = arg.triangle.plane_mask;
-   const struct lp_rast_plane *tri_plane = GET_PLANES(tri);
-   const int x = task->x, y = task->y;
-   struct lp_rast_plane plane[NR_PLANES];
-   int64_t c[NR_PLANES];
    unsigned outmask, inmask, partmask, partial_mask;
-   unsigned j = 0;
-
-   if (tri->inputs.disable) {
-      /* This triangle was partially binned and has been disabled */
-      return;
-   }
+   unsigned j;
 
    outmask = 0;                 /* outside one or more trivial reject planes */
    partmask = 0;                /* outside one or more trivial accept planes */
 
-   while (plane_mask) {
-      int i = ffs(plane_mask) - 1;
-      plane[j] = tri_plane[i];
-      plane_mask &= ~(1 << i);
-      c[j] = plane[j].c + IMUL64(plane[j].dcdy, y) - IMUL64(plane[j].dcdx, x);
-
-      {
+   for (j = 0; j < NR_PLANES; j++) {
 #ifdef RASTER_64
-         /*
-          * Strip off lower FIXED_ORDER bits. Note that those bits from
-          * dcdx, dcdy, eo are always 0 (by definition).
-          * c values, however, are not. This means that for every
-          * addition of the form c + n*dcdx the lower FIXED_ORDER bits will
-          * NOT change. And those bits are not relevant to the sign bit (which
-          * is only what we need!) that is,
-          * sign(c + n*dcdx) == sign((c >> FIXED_ORDER) + n*(dcdx >> FIXED_ORDER))
-          * This means we can get away with using 32bit math for the most part.
-          * Only tricky part is the -1 adjustment for cdiff.
-          */
-         int32_t dcdx = -plane[j].dcdx >> FIXED_ORDER;
-         int32_t dcdy = plane[j].dcdy >> FIXED_ORDER;
-         const int32_t cox = plane[j].eo >> FIXED_ORDER;
-         const int32_t ei = (dcdy + dcdx - cox) << 4;
-         const int32_t cox_s = cox << 4;
-         const int32_t co = (int32_t)(c[j] >> (int64_t)FIXED_ORDER) + cox_s;
-         int32_t cdiff;
-         /*
-          * Plausibility check to ensure the 32bit math works.
-          * Note that within a tile, the max we can move the edge function
-          * is essentially dcdx * TILE_SIZE + dcdy * TILE_SIZE.
-          * TILE_SIZE is 64, dcdx/dcdy are nominally 21 bit (for 8192 max size
-          * and 8 subpixel bits), I'd be happy with 2 bits more too (1 for
-          * increasing fb size to 16384, the required d3d11 value, another one
-          * because I'm not quite sure we can't be _just_ above the max value
-          * here). This gives us 30 bits max - hence if c would exceed that here
-          * that means the plane is either trivial reject for the whole tile
-          * (in which case the tri will not get binned), or trivial accept for
-          * the whole tile (in which case plane_mask will not include it).
-          */
-         assert((c[j] >> (int64_t)FIXED_ORDER) > (int32_t)0xb0000000 &&
-                (c[j] >> (int64_t)FIXED_ORDER) < (int32_t)0x3fffffff);
-         /*
-          * Note the fixup part is constant throughout the tile - thus could
-          * just calculate this and avoid _all_ 64bit math in rasterization
-          * (except exactly this fixup calc).
-          * In fact theoretically could move that even to setup, albeit that
-          * seems tricky (pre-bin certainly can have values larger than 32bit,
-          * and would need to communicate that fixup value through).
-          * And if we want to support msaa, we'd probably don't want to do the
-          * downscaling in setup in any case...
-          */
-         cdiff = ei - cox_s + ((int32_t)((c[j] - 1) >> (int64_t)FIXED_ORDER) -
-                               (int32_t)(c[j] >> (int64_t)FIXED_ORDER));
-         dcdx <<= 4;
-         dcdy <<= 4;
+      /*
+       * Strip off lower FIXED_ORDER bits. Note that those bits from
+       * dcdx, dcdy, eo are always 0 (by definition).
+       * c values, however, are not. This means that for every
+       * addition of the form c + n*dcdx the lower FIXED_ORDER bits will
+       * NOT change. And those bits are not relevant to the sign bit (which
+       * is only what we need!) that is,
+       * sign(c + n*dcdx) == sign((c >> FIXED_ORDER) + n*(dcdx >> FIXED_ORDER))
+       * This means we can get away with using 32bit math for the most part.
+       * Only tricky part is the -1 adjustment for cdiff.
+       */
+      int32_t dcdx = -plane[j].dcdx >> FIXED_ORDER;
+      int32_t dcdy = plane[j].dcdy >> FIXED_ORDER;
+      const int32_t cox = plane[j].eo >> FIXED_ORDER;
+      const int32_t ei = (dcdy + dcdx - cox) << 4;
+      const int32_t cox_s = cox << 4;
+      const int32_t co = (int32_t)(c[j] >> (int64_t)FIXED_ORDER) + cox_s;
+      int32_t cdiff;
+      /*
+       * Plausibility check to ensure the 32bit math works.
+       * Note that within a tile, the max we can move the edge function
+       * is essentially dcdx * tile_size + dcdy * tile_size.
+       * With the largest tile size of 128, dcdx/dcdy are nominally 21 bit
+       * (for 8192 max size and 8 subpixel bits), I'd be happy with 1 bit
+       * more too (for increasing fb size to 16384, the required d3d11
+       * value). This gives us 30 bits max - hence if c would exceed that
+       * here that means the plane is either trivial reject for the whole
+       * tile (in which case the tri will not get binned), or trivial accept
+       * for the whole tile (in which case plane_mask will not include it).
+       */
+      assert((c[j] >> (int64_t)FIXED_ORDER) > (int32_t)0xb0000000 &&
+             (c[j] >> (int64_t)FIXED_ORDER) < (int32_t)0x3fffffff);
+      /*
+       * Note the fixup part is constant throughout the tile - thus could
+       * just calculate this and avoid _all_ 64bit math in rasterization
+       * (except exactly this fixup calc).
+       * In fact theoretically could move that even to setup, albeit that
+       * seems tricky (pre-bin certainly can have values larger than 32bit,
+       * and would need to communicate that fixup value through).
+       * And if we want to support msaa, we'd probably don't want to do the
+       * downscaling in setup in any case...
+       */
+      cdiff = ei - cox_s + ((int32_t)((c[j] - 1) >> (int64_t)FIXED_ORDER) -
+                            (int32_t)(c[j] >> (int64_t)FIXED_ORDER));
+      dcdx <<= 4;
+      dcdy <<= 4;
 #else
-         const int32_t dcdx = -plane[j].dcdx << 4;
-         const int32_t dcdy = plane[j].dcdy << 4;
-         const int32_t cox = plane[j].eo << 4;
-         const int32_t ei = plane[j].dcdy - plane[j].dcdx - (int32_t)plane[j].eo;
-         const int32_t cio = (ei << 4) - 1;
-         int32_t co, cdiff;
-         co = c[j] + cox;
-         cdiff = cio - cox;
+      const int32_t dcdx = -plane[j].dcdx << 4;
+      const int32_t dcdy = plane[j].dcdy << 4;
+      const int32_t cox = plane[j].eo << 4;
+      const int32_t ei = plane[j].dcdy - plane[j].dcdx - (int32_t)plane[j].eo;
+      const int32_t cio = (ei << 4) - 1;
+      int32_t co, cdiff;
+      co = c[j] + cox;
+      cdiff = cio - cox;
 #endif
-         BUILD_MASKS(co, cdiff,
-                     dcdx, dcdy,
-                     &outmask,   /* sign bits from c[i][0..15] + cox */
-                     &partmask); /* sign bits from c[i][0..15] + cio */
-      }
-
-      j++;
+      BUILD_MASKS(co, cdiff,
+                  dcdx, dcdy,
+                  &outmask,   /* sign bits from c[i][0..15] + cox */
+                  &partmask); /* sign bits from c[i][0..15] + cio */
    }
 
+   /* Treat subblocks outside the tile as outside the triangle */
+   outmask |= ~block_mask & 0xffff;
+   partmask |= ~block_mask & 0xffff;
+
    if (outmask == 0xffff)
       return;
 
@@ -303,7 +291,7 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
    assert((partial_mask & inmask) == 0);
 
-   LP_COUNT_ADD(nr_empty_16, util_bitcount(0xffff & ~(partial_mask | inmask)));
+   LP_COUNT_ADD(nr_empty_16, util_bitcount(block_mask & ~(partial_mask | inmask)));
 
    /* Iterate over partials:
     */
@@ -342,6 +330,55 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
    }
 }
 
+
+/**
+ * Scan the tile in chunks and figure out which pixels to rasterize
+ * for this triangle.
+ */
+void
+TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
+                      const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   unsigned plane_mask = arg.triangle.plane_mask;
+   const struct lp_rast_plane *tri_plane = GET_PLANES(tri);
+   const int x = task->x, y = task->y;
+   const int tile_size = task->scene->tile_size;
+   /* 32x32 tiles only cover the top-left 2x2 16x16 blocks */
+   const unsigned block_mask = tile_size >= 64 ? 0xffff : 0x0033;
+   struct lp_rast_plane plane[NR_PLANES];
+   int64_t c[NR_PLANES];
+   unsigned j = 0;
+   int ix, iy;
+
+   if (tri->inputs.disable) {
+      /* This triangle was partially binned and has been disabled */
+      return;
+   }
+
+   while (plane_mask) {
+      int i = ffs(plane_mask) - 1;
+      plane[j] = tri_plane[i];
+      plane_mask &= ~(1 << i);
+      c[j] = plane[j].c + IMUL64(plane[j].dcdy, y) - IMUL64(plane[j].dcdx, x);
+      j++;
+   }
+
+   /* Tiles larger than 64x64 are walked in 64x64 blocks */
+   for (iy = 0; iy < tile_size; iy += 64) {
+      for (ix = 0; ix < tile_size; ix += 64) {
+         int64_t cx[NR_PLANES];
+
+         for (j = 0; j < NR_PLANES; j++)
+            cx[j] = (c[j]
+                     - IMUL64(plane[j].dcdx, ix)
+                     + IMUL64(plane[j].dcdy, iy));
+
+         TAG(do_block_64)(task, tri, plane, x + ix, y + iy, cx, block_mask);
+      }
+   }
+}
+
 #if defined(PIPE_ARCH_SSE) && defined(TRI_16)
 /* XXX: special case this when intersection is not required.
  *      - tile completely within bbox,
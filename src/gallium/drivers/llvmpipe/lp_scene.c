@@ -32,8 +32,10 @@
 #include "util/simple_list.h"
 #include "util/format/u_format.h"
 #include "lp_scene.h"
+#include "lp_screen.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_perf.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -54,6 +56,8 @@ struct lp_scene *
 lp_scene_create( struct pipe_context *pipe )
 {
    struct lp_scene *scene = CALLOC_STRUCT(lp_scene);
+   unsigned i;
+
    if (!scene)
       return NULL;
 
@@ -62,12 +66,13 @@ lp_scene_create( struct pipe_context *pipe )
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
-   (void) mtx_init(&scene->mutex, mtx_plain);
+   for (i = 0; i < ARRAY_SIZE(scene->bin_ranges); i++)
+      (void) mtx_init(&scene->bin_ranges[i].mutex, mtx_plain);
 
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
-      size_t maxBins = TILES_X * TILES_Y;
+      size_t maxBins = LP_MAX_BINS;
       size_t maxCommandBytes = sizeof(struct cmd_block) * maxBins;
       size_t maxCommandPlusData = maxCommandBytes + DATA_BLOCK_SIZE;
       /* We'll need at least one command block per bin.  Make sure that's
@@ -89,10 +94,18 @@ lp_scene_create( struct pipe_context *pipe )
 void
 lp_scene_destroy(struct lp_scene *scene)
 {
+   unsigned i;
+
    lp_fence_reference(&scene->fence, NULL);
-   mtx_destroy(&scene->mutex);
+   for (i = 0; i < ARRAY_SIZE(scene->bin_ranges); i++)
+      mtx_destroy(&scene->bin_ranges[i].mutex);
    assert(scene->data.head->next == NULL);
    FREE(scene->data.head);
+   while (scene->data.free) {
+      struct data_block *block = scene->data.free;
+      scene->data.free = block->next;
+      FREE(block);
+   }
    FREE(scene);
 }
 
@@ -157,6 +170,8 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       struct pipe_surface *cbuf = scene->fb.cbufs[i];
 
+      scene->cbufs[i].tile_row_stride = 0;
+
       if (!cbuf) {
          scene->cbufs[i].stride = 0;
          scene->cbufs[i].layer_stride = 0;
@@ -166,7 +181,23 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
          continue;
       }
 
-      if (llvmpipe_resource_is_texture(cbuf->texture)) {
+      if (scene->tiled_cbufs & (1 << i)) {
+         /* Rows of a contiguous tile, see llvmpipe_resource_detile() */
+         struct llvmpipe_resource *lpr = llvmpipe_resource(cbuf->texture);
+         unsigned format_bytes = util_format_get_blocksize(cbuf->format);
+
+         assert(lpr->tiled_size == scene->tile_size);
+         scene->cbufs[i].stride = scene->tile_size * format_bytes;
+         scene->cbufs[i].tile_row_stride =
+            DIV_ROUND_UP(cbuf->texture->width0, scene->tile_size) *
+            scene->tile_size * scene->cbufs[i].stride;
+         scene->cbufs[i].layer_stride = 0;
+         scene->cbufs[i].sample_stride = 0;
+         scene->cbufs[i].map = lpr->tex_data;
+         scene->cbufs[i].format_bytes = format_bytes;
+         scene->cbufs[i].nr_samples = 1;
+      }
+      else if (llvmpipe_resource_is_texture(cbuf->texture)) {
          scene->cbufs[i].stride = llvmpipe_resource_stride(cbuf->texture,
                                                            cbuf->u.tex.level);
          scene->cbufs[i].layer_stride = llvmpipe_layer_stride(cbuf->texture,
@@ -281,7 +312,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
-   /* Free all scene data blocks:
+   /* Release all scene data blocks, keeping some for the next scene:
     */
    {
       struct data_block_list *list = &scene->data;
@@ -289,11 +320,19 @@ lp_scene_end_rasterization(struct lp_scene *scene )
 
       for (block = list->head->next; block; block = tmp) {
          tmp = block->next;
-	 FREE(block);
+         if (list->num_free < LP_SCENE_MAX_FREE_BLOCKS) {
+            block->next = list->free;
+            list->free = block;
+            list->num_free++;
+         }
+         else {
+            FREE(block);
+         }
       }
 
       list->head->next = NULL;
       list->head->used = 0;
+      list->num_blocks = 0;
    }
 
    lp_fence_reference(&scene->fence, NULL);
@@ -343,15 +382,27 @@ lp_scene_new_data_block( struct lp_scene *scene )
       return NULL;
    }
    else {
-      struct data_block *block = MALLOC_STRUCT(data_block);
-      if (!block)
-         return NULL;
-      
+      struct data_block_list *list = &scene->data;
+      struct data_block *block = list->free;
+
+      if (block) {
+         list->free = block->next;
+         list->num_free--;
+      }
+      else {
+         block = MALLOC_STRUCT(data_block);
+         if (!block)
+            return NULL;
+      }
+
       scene->scene_size += sizeof *block;
 
       block->used = 0;
-      block->next = scene->data.head;
-      scene->data.head = block;
+      block->next = list->head;
+      list->head = block;
+
+      list->num_blocks++;
+      list->max_blocks = MAX2(list->max_blocks, list->num_blocks);
 
       return block;
    }
@@ -456,61 +507,108 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/**
+ * Rough cost estimate of a bin: the number of commands in it.
+ */
+static unsigned
+bin_cost(const struct cmd_bin *bin)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
-   }
-   return TRUE;
+   const struct cmd_block *block;
+   unsigned cost = 0;
+
+   for (block = bin->head; block; block = block->next)
+      cost += block->count;
+
+   return cost;
 }
 
 
+/**
+ * Prepare for iterating over the scene's bins.
+ * The non-empty bins are split into one contiguous range per thread so that
+ * each range has about the same estimated cost.  Called once per scene by
+ * one thread, before any of them calls lp_scene_bin_iter_next().
+ */
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_threads )
 {
-   scene->curr_x = scene->curr_y = -1;
+   uint64_t total_cost = 0, cost = 0;
+   unsigned x, y, i, start, t;
+
+   assert(num_threads >= 1 && num_threads <= LP_MAX_THREADS);
+
+   scene->num_bins = 0;
+   for (y = 0; y < scene->tiles_y; y++) {
+      for (x = 0; x < scene->tiles_x; x++) {
+         const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+         if (bin->head) {
+            scene->bin_order[scene->num_bins++] = x | y << 16;
+            total_cost += bin_cost(bin);
+         }
+      }
+   }
+
+   scene->num_bin_ranges = num_threads;
+   for (t = 0; t < num_threads; t++)
+      scene->bin_ranges[t].head = scene->bin_ranges[t].tail = scene->num_bins;
+
+   start = 0;
+   t = 0;
+   for (i = 0; i < scene->num_bins && t + 1 < num_threads; i++) {
+      unsigned packed = scene->bin_order[i];
+
+      cost += bin_cost(lp_scene_get_bin(scene, packed & 0xffff, packed >> 16));
+      if (cost * num_threads >= total_cost * (t + 1)) {
+         scene->bin_ranges[t].head = start;
+         scene->bin_ranges[t].tail = i + 1;
+         start = i + 1;
+         t++;
+      }
+   }
+   scene->bin_ranges[t].head = start;
+   scene->bin_ranges[t].tail = scene->num_bins;
 }
 
 
 /**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
- * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * Return pointer to next bin to be rendered by the given thread, or NULL
+ * once all bins of the scene have been handed out.
+ * Threads work through their own range first and then steal bins from the
+ * end of the other threads' ranges.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned thread_index,
+                        int *x, int *y )
 {
-   struct cmd_bin *bin = NULL;
+   struct lp_bin_range *range = &scene->bin_ranges[thread_index];
+   unsigned index = ~0u;
+   unsigned i;
 
-   mtx_lock(&scene->mutex);
+   assert(thread_index < scene->num_bin_ranges);
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
+   mtx_lock(&range->mutex);
+   if (range->head < range->tail)
+      index = range->head++;
+   mtx_unlock(&range->mutex);
+
+   for (i = 1; i < scene->num_bin_ranges && index == ~0u; i++) {
+      struct lp_bin_range *victim =
+         &scene->bin_ranges[(thread_index + i) % scene->num_bin_ranges];
+
+      mtx_lock(&victim->mutex);
+      if (victim->head < victim->tail) {
+         index = --victim->tail;
+         LP_COUNT(nr_bins_stolen[thread_index]);
+      }
+      mtx_unlock(&victim->mutex);
    }
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+   if (index == ~0u)
+      return NULL;
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   mtx_unlock(&scene->mutex);
-   return bin;
+   *x = scene->bin_order[index] & 0xffff;
+   *y = scene->bin_order[index] >> 16;
+   return lp_scene_get_bin(scene, *x, *y);
 }
 
 
@@ -524,10 +622,21 @@ void lp_scene_begin_binning(struct lp_scene *scene,
 
    util_copy_framebuffer_state(&scene->fb, fb);
 
-   scene->tiles_x = align(fb->width, TILE_SIZE) / TILE_SIZE;
-   scene->tiles_y = align(fb->height, TILE_SIZE) / TILE_SIZE;
-   assert(scene->tiles_x <= TILES_X);
-   assert(scene->tiles_y <= TILES_Y);
+   /*
+    * Start from the screen's tile size, but switch to bigger tiles for
+    * framebuffers which would need more bins than a scene has.
+    */
+   scene->tile_order = llvmpipe_screen(scene->pipe->screen)->tile_order;
+   for (;;) {
+      scene->tile_size = 1 << scene->tile_order;
+      scene->tiles_x = align(fb->width, scene->tile_size) >> scene->tile_order;
+      scene->tiles_y = align(fb->height, scene->tile_size) >> scene->tile_order;
+      if (scene->tiles_x * scene->tiles_y <= LP_MAX_BINS ||
+          scene->tile_order == LP_MAX_TILE_ORDER)
+         break;
+      scene->tile_order++;
+   }
+   assert(scene->tiles_x * scene->tiles_y <= LP_MAX_BINS);
 
    /*
     * Determine how many layers the fb has (used for clamping layer value).
@@ -552,6 +661,18 @@ void lp_scene_begin_binning(struct lp_scene *scene,
       max_layer = MIN2(max_layer, zsbuf->u.tex.last_layer - zsbuf->u.tex.first_layer);
    }
    scene->fb_max_layer = max_layer;
+
+   /*
+    * The layout can only change while no scene uses the resource, see
+    * llvmpipe_resource_untile(), so it holds until this scene is done.
+    */
+   scene->tiled_cbufs = 0;
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct pipe_surface *cbuf = scene->fb.cbufs[i];
+      if (cbuf && llvmpipe_resource(cbuf->texture)->tiled)
+         scene->tiled_cbufs |= 1 << i;
+   }
+
    scene->fb_max_samples = util_framebuffer_get_num_samples(fb);
    if (scene->fb_max_samples == 4) {
       for (unsigned i = 0; i < 4; i++) {
@@ -570,6 +691,9 @@ void lp_scene_end_binning( struct lp_scene *scene )
                    scene->scene_size);
       debug_printf("  data size: %u\n",
                    lp_scene_data_size(scene));
+      debug_printf("  data blocks: %u (max %u, %u free)\n",
+                   scene->data.num_blocks, scene->data.max_blocks,
+                   scene->data.num_free);
 
       if (0)
          lp_debug_bins( scene );
@@ -42,11 +42,12 @@
 struct lp_scene_queue;
 struct lp_rast_state;
 
-/* We're limited to 2K by 2K for 32bit fixed point rasterization.
- * Will need a 64-bit version for larger framebuffers.
+/* Maximum number of bins in a scene, enough for the largest framebuffer
+ * with the default tile size.  Scenes use larger tiles rather than exceed
+ * this.
  */
-#define TILES_X (LP_MAX_WIDTH / TILE_SIZE)
-#define TILES_Y (LP_MAX_HEIGHT / TILE_SIZE)
+#define LP_MAX_BINS ((LP_MAX_WIDTH >> LP_DEFAULT_TILE_ORDER) * \
+                     (LP_MAX_HEIGHT >> LP_DEFAULT_TILE_ORDER))
 
 
 /* Commands per command block (ideally so sizeof(cmd_block) is a power of
@@ -58,6 +59,11 @@ struct lp_rast_state;
  */
 #define DATA_BLOCK_SIZE (64 * 1024)
 
+/* Data blocks kept for reuse by the next scene, instead of being freed
+ * when rasterization ends.
+ */
+#define LP_SCENE_MAX_FREE_BLOCKS 64
+
 /* Scene temporary storage is clamped to this size:
  */
 #define LP_SCENE_MAX_SIZE (36*1024*1024)
@@ -113,10 +119,30 @@ struct cmd_bin {
 struct data_block_list {
    struct data_block first;
    struct data_block *head;
+
+   /** Recycled blocks, at most LP_SCENE_MAX_FREE_BLOCKS of them */
+   struct data_block *free;
+   unsigned num_free;
+
+   /** Blocks in use, and the most ever used at once by this scene */
+   unsigned num_blocks;
+   unsigned max_blocks;
 };
 
 struct resource_ref;
 
+
+/**
+ * A contiguous run of lp_scene::bin_order handed to one rasterizer thread.
+ * The owner takes bins from the front while threads which ran out of work
+ * steal them from the back.
+ */
+struct lp_bin_range {
+   mtx_t mutex;
+   unsigned head, tail;
+};
+
+
 /**
  * All bins and bin data are contained here.
  * Per-bin data goes into the 'tile' bins.
@@ -145,8 +171,13 @@ struct lp_scene {
       unsigned format_bytes;
       unsigned sample_stride;
       unsigned nr_samples;
+      /** Bytes per row of tiles, for tiled color buffers only, else zero */
+      unsigned tile_row_stride;
    } zsbuf, cbufs[PIPE_MAX_COLOR_BUFS];
 
+   /** Mask of the color buffers which use the tiled layout */
+   unsigned tiled_cbufs;
+
    /* The amount of layers in the fb (minimum of all attachments) */
    unsigned fb_max_layer;
 
@@ -174,16 +205,27 @@ struct lp_scene {
    unsigned resource_reference_size;
 
    boolean alloc_failed;
+
+   /** Tile width and height in pixels, and its log2 */
+   unsigned tile_order, tile_size;
+
    /**
     * Number of active tiles in each dimension.
     * This basically the framebuffer size divided by tile size
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   mtx_t mutex;
+   /**
+    * For iterating over bins: the non-empty bins in raster order, packed as
+    * x | y << 16, split into one range per rasterizer thread.
+    */
+   unsigned num_bins;
+   uint32_t bin_order[LP_MAX_BINS];
+   struct lp_bin_range bin_ranges[LP_MAX_THREADS];
+   unsigned num_bin_ranges;
 
-   struct cmd_bin tile[TILES_X][TILES_Y];
+   /** The bins, tiles_x per row */
+   struct cmd_bin tile[LP_MAX_BINS];
    struct data_block_list data;
 };
 
@@ -292,7 +334,7 @@ lp_scene_putback_data( struct lp_scene *scene, unsigned size)
 static inline struct cmd_bin *
 lp_scene_get_bin(struct lp_scene *scene, unsigned x, unsigned y)
 {
-   return &scene->tile[x][y];
+   return &scene->tile[y * scene->tiles_x + x];
 }
 
 
@@ -386,10 +428,11 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 
 
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_threads );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned thread_index,
+                        int *x, int *y );
 
 
 
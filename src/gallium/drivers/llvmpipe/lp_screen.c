@@ -38,6 +38,7 @@
 #include "draw/draw_context.h"
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_nir.h"
+#include "gallivm/lp_bld_misc.h"
 #include "util/disk_cache.h"
 #include "util/os_misc.h"
 #include "util/os_time.h"
@@ -90,6 +91,8 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_blend",       PERF_NO_BLEND, NULL },
    { "no_depth",       PERF_NO_DEPTH, NULL },
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
+   { "no_hiz",         PERF_NO_HIZ, NULL },
+   { "no_fs_linear",   PERF_NO_FS_LINEAR, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -711,8 +714,20 @@ llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
    struct llvmpipe_resource *texture = llvmpipe_resource(resource);
 
    assert(texture->dt);
-   if (texture->dt)
+   if (texture->dt) {
+      struct lp_fence *fence = NULL;
+
+      /* The scene rendering to it may still be rasterizing. */
+      mtx_lock(&screen->rast_mutex);
+      lp_fence_reference(&fence, texture->dt_fence);
+      mtx_unlock(&screen->rast_mutex);
+      if (fence) {
+         lp_fence_wait(fence);
+         lp_fence_reference(&fence, NULL);
+      }
+
       winsys->displaytarget_display(winsys, texture->dt, context_private, sub_box);
+   }
 }
 
 static void
@@ -721,6 +736,9 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
 
+   if (screen->async_compile)
+      util_queue_destroy(&screen->compile_queue);
+
    if (screen->cs_tpool)
       lp_cs_tpool_destroy(screen->cs_tpool);
 
@@ -803,6 +821,25 @@ static void lp_disk_cache_create(struct llvmpipe_screen *screen)
       return;
 
    _mesa_sha1_update(&ctx, &gallivm_perf, sizeof(gallivm_perf));
+
+   /* The cached code is compiled for the host CPU, which matters when the
+    * cache directory is shared between machines.  Only hash the CPU
+    * features, not the topology which doesn't affect code generation.
+    */
+   struct util_cpu_caps cpu_caps;
+   memcpy(&cpu_caps, &util_cpu_caps, sizeof(cpu_caps));
+   cpu_caps.nr_cpus = 0;
+   cpu_caps.cores_per_L3 = 0;
+   _mesa_sha1_update(&ctx, &cpu_caps, sizeof(cpu_caps));
+   _mesa_sha1_update(&ctx, &lp_native_vector_width,
+                     sizeof(lp_native_vector_width));
+
+   char *cpu_name = lp_build_host_cpu_name();
+   if (cpu_name) {
+      _mesa_sha1_update(&ctx, cpu_name, strlen(cpu_name));
+      free(cpu_name);
+   }
+
    _mesa_sha1_final(&ctx, sha1);
    disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
 
@@ -911,6 +948,17 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
 
+   {
+      unsigned tile_size = debug_get_num_option("LP_TILE_SIZE",
+                                                1 << LP_DEFAULT_TILE_ORDER);
+      if (!util_is_power_of_two_nonzero(tile_size))
+         tile_size = 1 << LP_DEFAULT_TILE_ORDER;
+      screen->tile_order = CLAMP(util_logbase2(tile_size),
+                                 LP_MIN_TILE_ORDER, LP_MAX_TILE_ORDER);
+   }
+   screen->tiled_render_targets =
+      debug_get_bool_option("LP_TILED_RENDER_TARGETS", false);
+
    screen->rast = lp_rast_create(screen->num_threads);
    if (!screen->rast) {
       lp_jit_screen_cleanup(screen);
@@ -919,7 +967,9 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    (void) mtx_init(&screen->rast_mutex, mtx_plain);
 
-   screen->cs_tpool = lp_cs_tpool_create(screen->num_threads);
+   screen->cs_tpool =
+      lp_cs_tpool_create(screen->num_threads,
+                         debug_get_bool_option("LP_CS_PIN_THREADS", false));
    if (!screen->cs_tpool) {
       lp_rast_destroy(screen->rast);
       lp_jit_screen_cleanup(screen);
@@ -928,6 +978,11 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    (void) mtx_init(&screen->cs_mutex, mtx_plain);
 
+   screen->async_compile = debug_get_bool_option("LP_ASYNC_COMPILE", FALSE) &&
+      util_queue_init(&screen->compile_queue, "lpcompile", 64, 1,
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                      UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY);
+
    lp_disk_cache_create(screen);
    return &screen->base;
 }
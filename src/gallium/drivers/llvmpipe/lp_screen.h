@@ -37,6 +37,7 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
 #include "gallivm/lp_bld_misc.h"
 
@@ -51,6 +52,12 @@ struct llvmpipe_screen
 
    unsigned num_threads;
 
+   /** log2 of the tile size used for binning, LP_TILE_SIZE */
+   unsigned tile_order;
+
+   /** Store eligible render targets tile by tile, LP_TILED_RENDER_TARGETS */
+   bool tiled_render_targets;
+
    /* Increments whenever textures are modified.  Contexts can track this.
     */
    unsigned timestamp;
@@ -63,6 +70,10 @@ struct llvmpipe_screen
 
    bool use_tgsi;
 
+   /** Optimized fragment shader variants are compiled here, LP_ASYNC_COMPILE */
+   bool async_compile;
+   struct util_queue compile_queue;
+
    struct disk_cache *disk_shader_cache;
    unsigned num_disk_shader_cache_hits;
    unsigned num_disk_shader_cache_misses;
@@ -74,6 +74,10 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
 
    setup->scene = setup->scenes[setup->scene_idx];
 
+   /* The scenes are recycled in order, so this is the oldest one.  It may
+    * still be queued or rasterizing; once its fence has signalled the
+    * rasterizer threads are done with it and the setup thread owns it again.
+    */
    if (setup->scene->fence) {
       if (LP_DEBUG & DEBUG_SETUP)
          debug_printf("%s: wait for scene %d\n",
@@ -82,6 +86,9 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
       lp_fence_wait(setup->scene->fence);
    }
 
+   /* Drop the data and resource references of the previous use. */
+   lp_scene_end_rasterization(setup->scene);
+
    lp_scene_begin_binning(setup->scene, &setup->fb);
 
 }
@@ -153,6 +160,7 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
 {
    struct lp_scene *scene = setup->scene;
    struct llvmpipe_screen *screen = llvmpipe_screen(scene->pipe->screen);
+   unsigned i;
 
    scene->num_active_queries = setup->active_binned_queries;
    memcpy(scene->active_queries, setup->active_queries,
@@ -165,23 +173,20 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    if (setup->last_fence)
       setup->last_fence->issued = TRUE;
 
-   mtx_lock(&screen->rast_mutex);
-
-   /* FIXME: We enqueue the scene then wait on the rasterizer to finish.
-    * This means we never actually run any vertex stuff in parallel to
-    * rasterization (not in the same context at least) which is what the
-    * multiple scenes per setup is about - when we get a new empty scene
-    * any old one is already empty again because we waited here for
-    * raster tasks to be finished. Ideally, we shouldn't need to wait here
-    * and rely on fences elsewhere when waiting is necessary.
-    * Certainly, lp_scene_end_rasterization() would need to be deferred too
-    * and there's probably other bits why this doesn't actually work.
+   /* Don't wait for the rasterizer here: the next scene is binned while
+    * this one is rasterized, and the scene is only cleaned up once its
+    * fence has signalled and lp_setup_get_empty_scene() picks it again.
     */
+   mtx_lock(&screen->rast_mutex);
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct pipe_surface *cbuf = scene->fb.cbufs[i];
+      if (cbuf && llvmpipe_resource(cbuf->texture)->dt)
+         lp_fence_reference(&llvmpipe_resource(cbuf->texture)->dt_fence,
+                            scene->fence);
+   }
    lp_rast_queue_scene(screen->rast, scene);
-   lp_rast_finish(screen->rast);
    mtx_unlock(&screen->rast_mutex);
 
-   lp_scene_end_rasterization(setup->scene);
    lp_setup_reset( setup );
 
    LP_DBG(DEBUG_SETUP, "%s done \n", __FUNCTION__);
@@ -927,8 +932,8 @@ lp_setup_set_fragment_sampler_views(struct lp_setup_context *setup,
             if (LP_PERF & PERF_TEX_MEM) {
                /* use dummy tile memory */
                jit_tex->base = lp_dummy_tile;
-               jit_tex->width = TILE_SIZE/8;
-               jit_tex->height = TILE_SIZE/8;
+               jit_tex->width = LP_MAX_TILE_SIZE/8;
+               jit_tex->height = LP_MAX_TILE_SIZE/8;
                jit_tex->depth = 1;
                jit_tex->first_level = 0;
                jit_tex->last_level = 0;
@@ -1061,6 +1066,35 @@ lp_setup_set_fragment_sampler_state(struct lp_setup_context *setup,
 }
 
 
+/**
+ * How a scene which hasn't finished rasterizing uses the resource.
+ */
+static unsigned
+scene_resource_referenced(const struct lp_scene *scene,
+                          const struct pipe_resource *texture)
+{
+   unsigned i;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i] && scene->fb.cbufs[i]->texture == texture)
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+   }
+   if (scene->fb.zsbuf && scene->fb.zsbuf->texture == texture)
+      return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+
+   if (lp_scene_is_resource_referenced(scene, texture)) {
+      /* The scene doesn't track how a resource is bound, but only shader
+       * buffers and images can be written by the fragment shader.
+       */
+      if (texture->bind & (PIPE_BIND_SHADER_BUFFER | PIPE_BIND_SHADER_IMAGE))
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+      return LP_REFERENCED_FOR_READ;
+   }
+
+   return 0;
+}
+
+
 /**
  * Is the given texture referenced by any scene?
  * Note: we have to check all scenes including any scenes currently
@@ -1081,11 +1115,17 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
       return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
    }
 
-   /* check textures referenced by the scene */
+   /* check the scenes which are still being binned or rasterized */
    for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
-      if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
-         return LP_REFERENCED_FOR_READ;
-      }
+      struct lp_scene *scene = setup->scenes[i];
+      unsigned referenced;
+
+      if (!scene->fence || lp_fence_signalled(scene->fence))
+         continue;
+
+      referenced = scene_resource_referenced(scene, texture);
+      if (referenced)
+         return referenced;
    }
 
    for (i = 0; i < ARRAY_SIZE(setup->ssbos); i++) {
@@ -1102,6 +1142,38 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
 }
 
 
+/**
+ * Wait for the scenes already queued for rasterization which conflict with
+ * the setup thread accessing the resource directly, as the draw module and
+ * compute shaders do.  With read_only, only scenes writing the resource
+ * matter.  The scene currently being binned is left alone.
+ */
+void
+lp_setup_wait_resource( struct lp_setup_context *setup,
+                        const struct pipe_resource *texture,
+                        boolean read_only )
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
+      struct lp_scene *scene = setup->scenes[i];
+      unsigned referenced;
+
+      if (scene == setup->scene || !scene->fence ||
+          lp_fence_signalled(scene->fence))
+         continue;
+
+      referenced = scene_resource_referenced(scene, texture);
+      if ((referenced & LP_REFERENCED_FOR_WRITE) ||
+          (referenced && !read_only)) {
+         LP_DBG(DEBUG_SETUP, "%s: wait for scene %d\n",
+                __FUNCTION__, scene->fence->id);
+         lp_fence_wait(scene->fence);
+      }
+   }
+}
+
+
 /**
  * Called by vbuf code when we're about to draw something.
  *
@@ -1424,6 +1496,7 @@ lp_setup_destroy( struct lp_setup_context *setup )
       if (scene->fence)
          lp_fence_wait(scene->fence);
 
+      lp_scene_end_rasterization(scene);
       lp_scene_destroy(scene);
    }
 
@@ -54,9 +54,12 @@
 struct lp_setup_variant;
 
 
-/** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
+/**
+ * Max number of scenes per context.  While one scene is rasterized the
+ * next ones can be binned; the setup thread only blocks when it wraps around
+ * to a scene whose fence hasn't signalled yet.
+ */
+#define MAX_SCENES 4
 
 
 
@@ -194,6 +197,13 @@ scissor_planes_needed(boolean scis_planes[4], const struct u_rect *bbox,
 
 
 void lp_setup_choose_triangle( struct lp_setup_context *setup );
+
+/** Number of triangles lp_setup_triangle_batch() sets up together */
+#define LP_SETUP_TRI_BATCH 4
+
+void lp_setup_triangle_batch( struct lp_setup_context *setup,
+                              const float (*v[][3])[4],
+                              unsigned count );
 void lp_setup_choose_line( struct lp_setup_context *setup );
 void lp_setup_choose_point( struct lp_setup_context *setup );
 
@@ -772,6 +772,8 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                       unsigned viewport_index)
 {
    struct lp_scene *scene = setup->scene;
+   const unsigned tile_order = scene->tile_order;
+   const int tile_size = scene->tile_size;
    struct u_rect trimmed_box = *bbox;   
    int i;
    unsigned cmd;
@@ -808,23 +810,23 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
 
    /* Determine which tile(s) intersect the triangle's bounding box
     */
-   if (dx < TILE_SIZE)
+   if (dx < tile_size)
    {
-      int ix0 = bbox->x0 / TILE_SIZE;
-      int iy0 = bbox->y0 / TILE_SIZE;
-      unsigned px = bbox->x0 & 63 & ~3;
-      unsigned py = bbox->y0 & 63 & ~3;
+      int ix0 = bbox->x0 >> tile_order;
+      int iy0 = bbox->y0 >> tile_order;
+      unsigned px = bbox->x0 & (tile_size - 1) & ~3;
+      unsigned py = bbox->y0 & (tile_size - 1) & ~3;
 
-      assert(iy0 == bbox->y1 / TILE_SIZE &&
-	     ix0 == bbox->x1 / TILE_SIZE);
+      assert(iy0 == bbox->y1 >> tile_order &&
+	     ix0 == bbox->x1 >> tile_order);
 
       if (nr_planes == 3) {
          if (sz < 4)
          {
             /* Triangle is contained in a single 4x4 stamp:
              */
-            assert(px + 4 <= TILE_SIZE);
-            assert(py + 4 <= TILE_SIZE);
+            assert(px + 4 <= tile_size);
+            assert(py + 4 <= tile_size);
             if (setup->multisample)
                cmd = LP_RAST_OP_MS_TRIANGLE_3_4;
             else
@@ -844,11 +846,11 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
              * dimensions if the triangle is 16 pixels in one dimension but 4
              * in the other. So budge the 16x16 back inside the tile.
              */
-            px = MIN2(px, TILE_SIZE - 16);
-            py = MIN2(py, TILE_SIZE - 16);
+            px = MIN2(px, tile_size - 16);
+            py = MIN2(py, tile_size - 16);
 
-            assert(px + 16 <= TILE_SIZE);
-            assert(py + 16 <= TILE_SIZE);
+            assert(px + 16 <= tile_size);
+            assert(py + 16 <= tile_size);
 
             if (setup->multisample)
                cmd = LP_RAST_OP_MS_TRIANGLE_3_16;
@@ -861,11 +863,11 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
       }
       else if (nr_planes == 4 && sz < 16) 
       {
-         px = MIN2(px, TILE_SIZE - 16);
-         py = MIN2(py, TILE_SIZE - 16);
+         px = MIN2(px, tile_size - 16);
+         py = MIN2(py, tile_size - 16);
 
-         assert(px + 16 <= TILE_SIZE);
-         assert(py + 16 <= TILE_SIZE);
+         assert(px + 16 <= tile_size);
+         assert(py + 16 <= tile_size);
 
          if (setup->multisample)
             cmd = LP_RAST_OP_MS_TRIANGLE_4_16;
@@ -898,23 +900,23 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
       int64_t ystep[MAX_PLANES];
       int x, y;
 
-      int ix0 = trimmed_box.x0 / TILE_SIZE;
-      int iy0 = trimmed_box.y0 / TILE_SIZE;
-      int ix1 = trimmed_box.x1 / TILE_SIZE;
-      int iy1 = trimmed_box.y1 / TILE_SIZE;
+      int ix0 = trimmed_box.x0 >> tile_order;
+      int iy0 = trimmed_box.y0 >> tile_order;
+      int ix1 = trimmed_box.x1 >> tile_order;
+      int iy1 = trimmed_box.y1 >> tile_order;
       
       for (i = 0; i < nr_planes; i++) {
          c[i] = (plane[i].c + 
-                 IMUL64(plane[i].dcdy, iy0) * TILE_SIZE -
-                 IMUL64(plane[i].dcdx, ix0) * TILE_SIZE);
+                 IMUL64(plane[i].dcdy, iy0) * tile_size -
+                 IMUL64(plane[i].dcdx, ix0) * tile_size);
 
          ei[i] = (plane[i].dcdy - 
                   plane[i].dcdx - 
-                  (int64_t)plane[i].eo) << TILE_ORDER;
+                  (int64_t)plane[i].eo) << tile_order;
 
-         eo[i] = (int64_t)plane[i].eo << TILE_ORDER;
-         xstep[i] = -(((int64_t)plane[i].dcdx) << TILE_ORDER);
-         ystep[i] = ((int64_t)plane[i].dcdy) << TILE_ORDER;
+         eo[i] = (int64_t)plane[i].eo << tile_order;
+         xstep[i] = -(((int64_t)plane[i].dcdx) << tile_order);
+         ystep[i] = ((int64_t)plane[i].dcdy) << tile_order;
       }
 
 
@@ -1239,6 +1241,203 @@ static void triangle_noop(struct lp_setup_context *setup,
 }
 
 
+#if defined(PIPE_ARCH_SSE)
+
+static inline __m128i
+min_epi32(__m128i a, __m128i b)
+{
+   __m128i lt = _mm_cmplt_epi32(a, b);
+   return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));
+}
+
+static inline __m128i
+max_epi32(__m128i a, __m128i b)
+{
+   __m128i gt = _mm_cmpgt_epi32(a, b);
+   return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+#endif
+
+/**
+ * Calculate fixed position data for a batch of triangles, like
+ * calc_fixed_position(), and return a mask of the triangles whose bounding
+ * box isn't empty.
+ */
+static inline unsigned
+calc_fixed_position_batch(struct lp_setup_context *setup,
+                          struct fixed_position *position,
+                          const float (*v[][3])[4],
+                          unsigned count)
+{
+   const int adj = (setup->bottom_edge_rule != 0) ? 1 : 0;
+   unsigned i;
+#if defined(PIPE_ARCH_SSE)
+   float pixel_offset = setup->multisample ? 0.0 : setup->pixel_offset;
+   __m128 pix_offset = _mm_set1_ps(pixel_offset);
+   __m128 fixed_one = _mm_set1_ps((float)FIXED_ONE);
+   __m128i vone = _mm_set1_epi32(1);
+   __m128i vadj = _mm_set1_epi32(adj);
+   PIPE_ALIGN_VAR(16) float fx[3][LP_SETUP_TRI_BATCH];
+   PIPE_ALIGN_VAR(16) float fy[3][LP_SETUP_TRI_BATCH];
+   PIPE_ALIGN_VAR(16) int32_t x[3][LP_SETUP_TRI_BATCH];
+   PIPE_ALIGN_VAR(16) int32_t y[3][LP_SETUP_TRI_BATCH];
+   PIPE_ALIGN_VAR(16) int32_t d[4][LP_SETUP_TRI_BATCH];
+   __m128i vx[3], vy[3];
+   __m128i minx, maxx, miny, maxy, empty;
+   unsigned j;
+
+   STATIC_ASSERT(LP_SETUP_TRI_BATCH == 4);
+
+   /* Transpose to one vector per vertex coordinate, padding short
+    * batches with the last triangle.
+    */
+   for (i = 0; i < LP_SETUP_TRI_BATCH; i++) {
+      const unsigned t = MIN2(i, count - 1);
+      for (j = 0; j < 3; j++) {
+         fx[j][i] = v[t][j][0][0];
+         fy[j][i] = v[t][j][0][1];
+      }
+   }
+
+   for (j = 0; j < 3; j++) {
+      __m128 tx = _mm_sub_ps(_mm_load_ps(fx[j]), pix_offset);
+      __m128 ty = _mm_sub_ps(_mm_load_ps(fy[j]), pix_offset);
+      vx[j] = _mm_cvtps_epi32(_mm_mul_ps(tx, fixed_one));
+      vy[j] = _mm_cvtps_epi32(_mm_mul_ps(ty, fixed_one));
+      _mm_store_si128((__m128i *)x[j], vx[j]);
+      _mm_store_si128((__m128i *)y[j], vy[j]);
+   }
+
+   _mm_store_si128((__m128i *)d[0], _mm_sub_epi32(vx[0], vx[1]));
+   _mm_store_si128((__m128i *)d[1], _mm_sub_epi32(vy[0], vy[1]));
+   _mm_store_si128((__m128i *)d[2], _mm_sub_epi32(vx[2], vx[0]));
+   _mm_store_si128((__m128i *)d[3], _mm_sub_epi32(vy[2], vy[0]));
+
+   /* Same bounding box as in do_triangle_ccw(). */
+   minx = min_epi32(min_epi32(vx[0], vx[1]), vx[2]);
+   maxx = max_epi32(max_epi32(vx[0], vx[1]), vx[2]);
+   miny = min_epi32(min_epi32(vy[0], vy[1]), vy[2]);
+   maxy = max_epi32(max_epi32(vy[0], vy[1]), vy[2]);
+   minx = _mm_srai_epi32(minx, FIXED_ORDER);
+   maxx = _mm_srai_epi32(_mm_sub_epi32(maxx, vone), FIXED_ORDER);
+   miny = _mm_srai_epi32(_mm_add_epi32(miny, vadj), FIXED_ORDER);
+   maxy = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(maxy, vone), vadj),
+                         FIXED_ORDER);
+   empty = _mm_or_si128(_mm_cmplt_epi32(maxx, minx),
+                        _mm_cmplt_epi32(maxy, miny));
+
+   for (i = 0; i < count; i++) {
+      for (j = 0; j < 3; j++) {
+         position[i].x[j] = x[j][i];
+         position[i].y[j] = y[j][i];
+      }
+      position[i].x[3] = 0;
+      position[i].y[3] = 0;
+      position[i].dx01 = d[0][i];
+      position[i].dy01 = d[1][i];
+      position[i].dx20 = d[2][i];
+      position[i].dy20 = d[3][i];
+      position[i].area = IMUL64(position[i].dx01, position[i].dy20) -
+            IMUL64(position[i].dx20, position[i].dy01);
+   }
+
+   return ~_mm_movemask_ps(_mm_castsi128_ps(empty)) & ((1 << count) - 1);
+#else
+   unsigned nonempty = 0;
+
+   for (i = 0; i < count; i++) {
+      const struct fixed_position *p = &position[i];
+
+      calc_fixed_position(setup, &position[i], v[i][0], v[i][1], v[i][2]);
+
+      if ((MAX3(p->x[0], p->x[1], p->x[2]) - 1) >> FIXED_ORDER >=
+          MIN3(p->x[0], p->x[1], p->x[2]) >> FIXED_ORDER &&
+          (MAX3(p->y[0], p->y[1], p->y[2]) - 1 + adj) >> FIXED_ORDER >=
+          (MIN3(p->y[0], p->y[1], p->y[2]) + adj) >> FIXED_ORDER)
+         nonempty |= 1 << i;
+   }
+
+   return nonempty;
+#endif
+}
+
+
+/**
+ * Set up and bin a batch of up to LP_SETUP_TRI_BATCH triangles, in order,
+ * with the same results as calling setup->triangle on each.
+ *
+ * The fixed point positions and bounding boxes of the batch are computed
+ * together, so that culled and empty triangles, which dominate meshes
+ * with many sub-pixel triangles, never reach the per-triangle setup.
+ */
+void
+lp_setup_triangle_batch(struct lp_setup_context *setup,
+                        const float (*v[][3])[4],
+                        unsigned count)
+{
+   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
+   PIPE_ALIGN_VAR(16) struct fixed_position position[LP_SETUP_TRI_BATCH];
+   boolean draw_ccw, draw_cw;
+   unsigned nonempty;
+   unsigned i;
+
+   assert(count && count <= LP_SETUP_TRI_BATCH);
+
+   if (setup->triangle == triangle_both) {
+      draw_ccw = draw_cw = TRUE;
+   }
+   else if (setup->triangle == triangle_ccw) {
+      draw_ccw = TRUE;
+      draw_cw = FALSE;
+   }
+   else if (setup->triangle == triangle_cw) {
+      draw_ccw = FALSE;
+      draw_cw = TRUE;
+   }
+   else {
+      for (i = 0; i < count; i++)
+         setup->triangle(setup, v[i][0], v[i][1], v[i][2]);
+      return;
+   }
+
+   if (lp_context->active_statistics_queries) {
+      lp_context->pipeline_statistics.c_primitives += count;
+   }
+
+   nonempty = calc_fixed_position_batch(setup, position, v, count);
+
+   for (i = 0; i < count; i++) {
+      const float (*v0)[4] = v[i][0];
+      const float (*v1)[4] = v[i][1];
+      const float (*v2)[4] = v[i][2];
+
+      if (position[i].area > 0 && draw_ccw) {
+         if (nonempty & (1 << i))
+            retry_triangle_ccw(setup, &position[i], v0, v1, v2,
+                               setup->ccw_is_frontface);
+         else
+            LP_COUNT(nr_culled_tris);
+      }
+      else if (position[i].area < 0 && draw_cw) {
+         if (!(nonempty & (1 << i))) {
+            LP_COUNT(nr_culled_tris);
+         }
+         else if (setup->flatshade_first) {
+            rotate_fixed_position_12(&position[i]);
+            retry_triangle_ccw(setup, &position[i], v0, v2, v1,
+                               !setup->ccw_is_frontface);
+         }
+         else {
+            rotate_fixed_position_01(&position[i]);
+            retry_triangle_ccw(setup, &position[i], v1, v0, v2,
+                               !setup->ccw_is_frontface);
+         }
+      }
+   }
+}
+
+
 void 
 lp_setup_choose_triangle(struct lp_setup_context *setup)
 {
@@ -43,7 +43,7 @@
 #include "util/u_memory.h"
 
 
-#define LP_MAX_VBUF_INDEXES 1024
+#define LP_MAX_VBUF_INDEXES 4096
 #define LP_MAX_VBUF_SIZE    4096
 
   
@@ -183,14 +183,23 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       }
       break;
 
-   case PIPE_PRIM_TRIANGLES:
+   case PIPE_PRIM_TRIANGLES: {
+      const float (*v[LP_SETUP_TRI_BATCH][3])[4];
+      unsigned n = 0;
+
       for (i = 2; i < nr; i += 3) {
-         setup->triangle( setup,
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
+         v[n][0] = get_vert(vertex_buffer, indices[i-2], stride);
+         v[n][1] = get_vert(vertex_buffer, indices[i-1], stride);
+         v[n][2] = get_vert(vertex_buffer, indices[i-0], stride);
+         if (++n == LP_SETUP_TRI_BATCH) {
+            lp_setup_triangle_batch(setup, v, n);
+            n = 0;
+         }
       }
+      if (n)
+         lp_setup_triangle_batch(setup, v, n);
       break;
+   }
 
    case PIPE_PRIM_TRIANGLE_STRIP:
       if (flatshade_first) {
@@ -381,14 +390,23 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       }
       break;
 
-   case PIPE_PRIM_TRIANGLES:
+   case PIPE_PRIM_TRIANGLES: {
+      const float (*v[LP_SETUP_TRI_BATCH][3])[4];
+      unsigned n = 0;
+
       for (i = 2; i < nr; i += 3) {
-         setup->triangle( setup,
-                          get_vert(vertex_buffer, i-2, stride),
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
+         v[n][0] = get_vert(vertex_buffer, i-2, stride);
+         v[n][1] = get_vert(vertex_buffer, i-1, stride);
+         v[n][2] = get_vert(vertex_buffer, i-0, stride);
+         if (++n == LP_SETUP_TRI_BATCH) {
+            lp_setup_triangle_batch(setup, v, n);
+            n = 0;
+         }
       }
+      if (n)
+         lp_setup_triangle_batch(setup, v, n);
       break;
+   }
 
    case PIPE_PRIM_TRIANGLE_STRIP:
       if (flatshade_first) {
@@ -45,6 +45,7 @@
 #include "lp_memory.h"
 #include "lp_query.h"
 #include "lp_cs_tpool.h"
+#include "lp_flush.h"
 #include "frontend/sw_winsys.h"
 #include "nir/nir_to_tgsi_info.h"
 #include "util/mesa-sha1.h"
@@ -687,12 +688,19 @@ lp_cs_get_ir_cache_key(struct lp_compute_shader_variant *variant,
    void *ir_binary;
 
    blob_init(&blob);
-   nir_serialize(&blob, variant->shader->base.ir.nir, true);
+   if (variant->shader->base.type == PIPE_SHADER_IR_NIR)
+      nir_serialize(&blob, variant->shader->base.ir.nir, true);
+   else
+      blob_write_bytes(&blob, variant->shader->base.tokens,
+                       tgsi_num_tokens(variant->shader->base.tokens) *
+                       sizeof(struct tgsi_token));
    ir_binary = blob.data;
    ir_size = blob.size;
 
    struct mesa_sha1 ctx;
    _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &variant->shader->base.type,
+                     sizeof(variant->shader->base.type));
    _mesa_sha1_update(&ctx, &variant->key, variant->shader->variant_key_size);
    _mesa_sha1_update(&ctx, ir_binary, ir_size);
    _mesa_sha1_final(&ctx, ir_sha1_cache_key);
@@ -722,7 +730,7 @@ generate_variant(struct llvmpipe_context *lp,
    variant->shader = shader;
    memcpy(&variant->key, key, shader->variant_key_size);
 
-   if (shader->base.ir.nir) {
+   if (screen->disk_shader_cache) {
       lp_cs_get_ir_cache_key(variant, ir_sha1_cache_key);
 
       lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
@@ -915,8 +923,8 @@ lp_csctx_set_sampler_views(struct lp_cs_context *csctx,
             if (LP_PERF & PERF_TEX_MEM) {
                /* use dummy tile memory */
                jit_tex->base = lp_dummy_tile;
-               jit_tex->width = TILE_SIZE/8;
-               jit_tex->height = TILE_SIZE/8;
+               jit_tex->width = LP_MAX_TILE_SIZE/8;
+               jit_tex->height = LP_MAX_TILE_SIZE/8;
                jit_tex->depth = 1;
                jit_tex->first_level = 0;
                jit_tex->last_level = 0;
@@ -1325,6 +1333,7 @@ static void llvmpipe_launch_grid(struct pipe_context *pipe,
    memset(&job_info, 0, sizeof(job_info));
 
    llvmpipe_cs_update_derived(llvmpipe, info->input);
+   llvmpipe_wait_stage_resources(llvmpipe, PIPE_SHADER_COMPUTE);
 
    fill_grid_size(pipe, info, job_info.grid_size);
 
@@ -68,6 +68,7 @@
 #include "util/simple_list.h"
 #include "util/u_dual_blend.h"
 #include "util/os_time.h"
+#include "util/u_atomic.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "tgsi/tgsi_dump.h"
@@ -107,6 +108,7 @@
 #include "nir/nir_to_tgsi_info.h"
 
 #include "lp_screen.h"
+#include "lp_texture.h"
 #include "compiler/nir/nir_serialize.h"
 #include "util/mesa-sha1.h"
 /** Fragment shader number (for debugging) */
@@ -468,7 +470,7 @@ static void fs_fb_fetch(const struct lp_build_fs_iface *iface,
    const struct util_format_description* out_format_desc = util_format_description(cbuf_format);
    struct lp_type dst_type;
    unsigned block_size = bld->type.length;
-   unsigned block_height = key->resource_1d ? 1 : 2;
+   unsigned block_height = key->resource_1d ? 1 : (block_size == 16 ? 4 : 2);
    unsigned block_width = block_size / block_height;
 
    lp_mem_type_from_format_desc(out_format_desc, &dst_type);
@@ -1468,11 +1470,11 @@ load_unswizzled_block(struct gallivm_state *gallivm,
       unsigned x = i % row_size;
       unsigned y = i / row_size;
 
-      if (block_height == 2 && dst_count == 8 && fb_fetch_twiddle) {
+      if (block_height >= 2 && dst_count >= 8 && fb_fetch_twiddle) {
          /* remap the raw slots into the fragment shader execution mode. */
          /* this math took me way too long to work out, I'm sure it's overkill. */
-         x = (i & 1) + ((i >> 2) << 1);
-         y = (i & 2) >> 1;
+         x = (i & 1) + (((i >> 2) & 1) << 1);
+         y = ((i & 2) >> 1) + ((i >> 3) << 1);
       }
 
       LLVMValueRef x_val;
@@ -2327,7 +2329,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
    undef_src_val = lp_build_undef(gallivm, fs_type);
 
    row_type.length = fs_type.length;
-   vector_width    = dst_type.floating ? lp_native_vector_width : lp_integer_vector_width;
+   vector_width    = dst_type.floating ? MIN2(lp_native_vector_width, 256) : lp_integer_vector_width;
 
    /* Compute correct swizzle and count channels */
    memset(swizzle, LP_BLD_SWIZZLE_DONTCARE, TGSI_NUM_CHANNELS);
@@ -2898,6 +2900,34 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Split a pointer to a fragment shader output vector into pointers to
+ * its blend_fs_type sized parts.
+ */
+static void
+split_fs_color_ptr(struct gallivm_state *gallivm,
+                   LLVMValueRef ptr,
+                   struct lp_type blend_fs_type,
+                   unsigned split,
+                   LLVMValueRef *dst)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   unsigned i;
+
+   if (split == 1) {
+      dst[0] = ptr;
+      return;
+   }
+
+   ptr = LLVMBuildBitCast(builder, ptr,
+                          LLVMPointerType(lp_build_vec_type(gallivm, blend_fs_type), 0), "");
+   for (i = 0; i < split; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+      dst[i] = LLVMBuildGEP(builder, ptr, &index, 1, "");
+   }
+}
+
+
 /**
  * Generate the runtime callable function for the whole fragment pipeline.
  * Note that the function which we generate operates on a block of 16
@@ -2905,8 +2935,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2946,6 +2975,9 @@ generate_fragment(struct llvmpipe_context *lp,
    LLVMValueRef function;
    LLVMValueRef facing;
    unsigned num_fs;
+   struct lp_type blend_fs_type;
+   unsigned blend_num_fs;
+   unsigned blend_split;
    unsigned i;
    unsigned chan;
    unsigned cbuf;
@@ -2980,6 +3012,9 @@ generate_fragment(struct llvmpipe_context *lp,
    fs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
    fs_type.width = 32;           /* 32-bit float */
    fs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+   /* 1d resources only run the upper half of the stamp, at most 8 pixels */
+   if (key->resource_1d)
+      fs_type.length = MIN2(fs_type.length, 8);
 
    memset(&blend_type, 0, sizeof blend_type);
    blend_type.floating = FALSE; /* values are integers */
@@ -3102,6 +3137,15 @@ generate_fragment(struct llvmpipe_context *lp,
    if (key->resource_1d)
       num_fs /= 2;
 
+   /*
+    * Blending works on at most 8-wide vectors, so 16-wide (AVX-512)
+    * shader outputs get split into two halves of the 4x4 stamp.
+    */
+   blend_fs_type = fs_type;
+   blend_fs_type.length = MIN2(fs_type.length, 8);
+   blend_split = fs_type.length / blend_fs_type.length;
+   blend_num_fs = num_fs * blend_split;
+
    {
       LLVMValueRef num_loop = lp_build_const_int32(gallivm, num_fs);
       LLVMTypeRef mask_type = lp_build_int_vec_type(gallivm, fs_type);
@@ -3217,9 +3261,15 @@ generate_fragment(struct llvmpipe_context *lp,
          for (unsigned s = 0; s < key->coverage_samples; s++) {
             int idx = (i + (s * num_fs));
             LLVMValueRef sindexi = lp_build_const_int32(gallivm, idx);
+            LLVMValueRef smask;
             ptr = LLVMBuildGEP(builder, mask_store, &sindexi, 1, "");
 
-            fs_mask[idx] = LLVMBuildLoad(builder, ptr, "smask");
+            smask = LLVMBuildLoad(builder, ptr, "smask");
+            for (unsigned h = 0; h < blend_split; h++) {
+               fs_mask[s * blend_num_fs + i * blend_split + h] = blend_split > 1 ?
+                  lp_build_extract_range(gallivm, smask, h * blend_fs_type.length,
+                                         blend_fs_type.length) : smask;
+            }
          }
 
          for (unsigned s = 0; s < key->min_samples; s++) {
@@ -3231,7 +3281,8 @@ generate_fragment(struct llvmpipe_context *lp,
                   ptr = LLVMBuildGEP(builder,
                                      color_store[cbuf * !cbuf0_write_all][chan],
                                      &sindexi, 1, "");
-                  fs_out_color[s][cbuf][chan][i] = ptr;
+                  split_fs_color_ptr(gallivm, ptr, blend_fs_type, blend_split,
+                                     &fs_out_color[s][cbuf][chan][i * blend_split]);
                }
             }
             if (dual_source_blend) {
@@ -3240,7 +3291,8 @@ generate_fragment(struct llvmpipe_context *lp,
                   ptr = LLVMBuildGEP(builder,
                                      color_store[1][chan],
                                      &sindexi, 1, "");
-                  fs_out_color[s][1][chan][i] = ptr;
+                  split_fs_color_ptr(gallivm, ptr, blend_fs_type, blend_split,
+                                     &fs_out_color[s][1][chan][i * blend_split]);
                }
             }
          }
@@ -3278,7 +3330,7 @@ generate_fragment(struct llvmpipe_context *lp,
                                                        &index, 1, ""), "");
 
          for (unsigned s = 0; s < key->cbuf_nr_samples[cbuf]; s++) {
-            unsigned mask_idx = num_fs * (key->multisample ? s : 0);
+            unsigned mask_idx = blend_num_fs * (key->multisample ? s : 0);
             unsigned out_idx = key->min_samples == 1 ? 0 : s;
             LLVMValueRef out_ptr = color_ptr;;
 
@@ -3292,7 +3344,7 @@ generate_fragment(struct llvmpipe_context *lp,
 
             generate_unswizzled_blend(gallivm, cbuf, variant,
                                       key->cbuf_format[cbuf],
-                                      num_fs, fs_type, &fs_mask[mask_idx], fs_out_color[out_idx],
+                                      blend_num_fs, blend_fs_type, &fs_mask[mask_idx], fs_out_color[out_idx],
                                       context_ptr, out_ptr, stride,
                                       partial_mask, do_branch);
          }
@@ -3431,6 +3483,8 @@ lp_debug_fs_variant(struct lp_fragment_shader_variant *variant)
       nir_print_shader(variant->shader->base.ir.nir, stderr);
    dump_fs_variant_key(&variant->key);
    debug_printf("variant->opaque = %u\n", variant->opaque);
+   debug_printf("variant->hiz_mode = 0x%x\n", variant->hiz_mode);
+   debug_printf("variant->linear_mode = %u\n", variant->linear_mode);
    debug_printf("\n");
 }
 
@@ -3443,12 +3497,19 @@ lp_fs_get_ir_cache_key(struct lp_fragment_shader_variant *variant,
    void *ir_binary;
 
    blob_init(&blob);
-   nir_serialize(&blob, variant->shader->base.ir.nir, true);
+   if (variant->shader->base.type == PIPE_SHADER_IR_NIR)
+      nir_serialize(&blob, variant->shader->base.ir.nir, true);
+   else
+      blob_write_bytes(&blob, variant->shader->base.tokens,
+                       tgsi_num_tokens(variant->shader->base.tokens) *
+                       sizeof(struct tgsi_token));
    ir_binary = blob.data;
    ir_size = blob.size;
 
    struct mesa_sha1 ctx;
    _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &variant->shader->base.type,
+                     sizeof(variant->shader->base.type));
    _mesa_sha1_update(&ctx, &variant->key, variant->shader->variant_key_size);
    _mesa_sha1_update(&ctx, ir_binary, ir_size);
    _mesa_sha1_final(&ctx, ir_sha1_cache_key);
@@ -3456,6 +3517,289 @@ lp_fs_get_ir_cache_key(struct lp_fragment_shader_variant *variant,
    blob_finish(&blob);
 }
 
+/**
+ * Build, compile and JIT the functions of a variant whose gallivm has
+ * already been created.
+ */
+static void
+compile_variant(struct lp_fragment_shader *shader,
+                struct lp_fragment_shader_variant *variant)
+{
+   lp_jit_init_types(variant);
+
+   generate_fragment(shader, variant, RAST_EDGE_TEST);
+
+   if (variant->opaque) {
+      /* Specialized shader, which doesn't need to read the color buffer. */
+      generate_fragment(shader, variant, RAST_WHOLE);
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+         gallivm_jit_function(variant->gallivm,
+                              variant->function[RAST_EDGE_TEST]);
+
+   if (variant->function[RAST_WHOLE]) {
+      variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_WHOLE]);
+   } else {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+}
+
+
+/**
+ * Background recompilation of a variant which was first built without
+ * optimizations, see LP_ASYNC_COMPILE.
+ *
+ * The job works on private copies of the shader, its NIR and the variant
+ * in its own LLVM context, so it shares nothing with the driver thread but
+ * the variant's jit_function pointers, which are swapped atomically once
+ * the optimized code is ready.  The unoptimized code stays alive until the
+ * variant is destroyed since scenes in flight may still be running it.
+ */
+struct lp_fs_compile_job
+{
+   struct llvmpipe_screen *screen;
+   struct lp_fragment_shader_variant *variant;
+   struct lp_fragment_shader shader;
+   struct lp_fragment_shader_variant *shadow;
+   LLVMContextRef context;
+   char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   bool needs_caching;
+};
+
+
+static void
+fs_compile_job_execute(void *data, int thread_index)
+{
+   struct lp_fs_compile_job *job = data;
+   struct lp_fragment_shader_variant *variant = job->variant;
+   struct lp_fragment_shader_variant *shadow = job->shadow;
+   struct lp_cached_code cached = { 0 };
+
+   shadow->gallivm = gallivm_create(job->module_name, job->context, &cached);
+   if (!shadow->gallivm)
+      return;
+
+   compile_variant(&job->shader, shadow);
+
+   p_atomic_set(&variant->jit_function[RAST_EDGE_TEST],
+                shadow->jit_function[RAST_EDGE_TEST]);
+   p_atomic_set(&variant->jit_function[RAST_WHOLE],
+                shadow->jit_function[RAST_WHOLE]);
+   variant->async_gallivm = shadow->gallivm;
+
+   if (job->needs_caching) {
+      lp_disk_cache_insert_shader(job->screen, &cached,
+                                  job->ir_sha1_cache_key);
+   }
+
+   gallivm_free_ir(shadow->gallivm);
+}
+
+
+static void
+fs_compile_job_cleanup(void *data, int thread_index)
+{
+   struct lp_fs_compile_job *job = data;
+
+   if (job->shader.base.type == PIPE_SHADER_IR_NIR)
+      ralloc_free(job->shader.base.ir.nir);
+   LLVMContextDispose(job->context);
+   FREE(job->shadow);
+   FREE(job);
+}
+
+
+static void
+queue_optimized_variant(struct llvmpipe_screen *screen,
+                        struct lp_fragment_shader *shader,
+                        struct lp_fragment_shader_variant *variant,
+                        const char *module_name,
+                        const unsigned char *ir_sha1_cache_key,
+                        bool needs_caching)
+{
+   const size_t variant_size =
+      sizeof *variant + shader->variant_key_size - sizeof variant->key;
+   struct lp_fs_compile_job *job = CALLOC_STRUCT(lp_fs_compile_job);
+   if (!job)
+      return;
+
+   job->shadow = MALLOC(variant_size);
+   job->context = LLVMContextCreate();
+   if (!job->shadow || !job->context) {
+      if (job->context)
+         LLVMContextDispose(job->context);
+      FREE(job->shadow);
+      FREE(job);
+      return;
+   }
+
+   job->screen = screen;
+   job->variant = variant;
+   job->shader = *shader;
+   if (shader->base.type == PIPE_SHADER_IR_NIR)
+      job->shader.base.ir.nir = nir_shader_clone(NULL, shader->base.ir.nir);
+
+   memset(job->shadow, 0, sizeof *job->shadow);
+   memcpy(&job->shadow->key, &variant->key, shader->variant_key_size);
+   job->shadow->shader = &job->shader;
+   job->shadow->opaque = variant->opaque;
+
+   snprintf(job->module_name, sizeof(job->module_name), "%s_opt",
+            module_name);
+   memcpy(job->ir_sha1_cache_key, ir_sha1_cache_key,
+          sizeof(job->ir_sha1_cache_key));
+   job->needs_caching = needs_caching;
+
+   util_queue_add_job(&screen->compile_queue, job, &variant->async_fence,
+                      fs_compile_job_execute, fs_compile_job_cleanup, 0);
+   variant->async_pending = true;
+}
+
+
+/**
+ * Work out how a variant interacts with the rasterizer's hierarchical
+ * depth, which keeps upper bounds of the stored depth values.  Those stay
+ * valid as long as depth writes can only lower the stored values.
+ */
+static unsigned
+fs_hiz_mode(const struct lp_fragment_shader *shader,
+            const struct lp_fragment_shader_variant_key *key)
+{
+   const struct tgsi_shader_info *info = &shader->info.base;
+   const struct util_format_description *zs_desc;
+   boolean stencil_writes;
+   unsigned mode = 0;
+
+   if (!key->depth.enabled)
+      return 0;
+
+   if (key->depth.func != PIPE_FUNC_LESS &&
+       key->depth.func != PIPE_FUNC_LEQUAL) {
+      /* NEVER and EQUAL leave the stored values as they are */
+      if (key->depth.writemask &&
+          key->depth.func != PIPE_FUNC_NEVER &&
+          key->depth.func != PIPE_FUNC_EQUAL)
+         return LP_HIZ_INVALIDATE;
+      return 0;
+   }
+
+   if ((LP_PERF & PERF_NO_HIZ) ||
+       key->depth_clamp ||
+       info->writes_z)
+      return 0;
+
+   /* The bounds are compared in [0,1], as unorm depth is stored. */
+   zs_desc = util_format_description(key->zsbuf_format);
+   if (!zs_desc ||
+       zs_desc->channel[zs_desc->swizzle[0]].type != UTIL_FORMAT_TYPE_UNSIGNED ||
+       !zs_desc->channel[zs_desc->swizzle[0]].normalized)
+      return 0;
+
+   stencil_writes = key->stencil[0].enabled &&
+                    (key->stencil[0].writemask ||
+                     (key->stencil[1].enabled && key->stencil[1].writemask));
+
+   /* Culling must not skip stencil ops or the shader's side effects. */
+   if (!stencil_writes &&
+       (!info->writes_memory ||
+        info->properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL]))
+      mode |= LP_HIZ_CULL;
+
+   /* With a LESS/LEQUAL test, every pixel of a fully covered block ends up
+    * at or below the triangle's depth, unless fragments can get dropped
+    * before the depth write.
+    */
+   if (key->depth.writemask &&
+       !key->stencil[0].enabled &&
+       !key->alpha.enabled &&
+       !key->blend.alpha_to_coverage &&
+       !info->uses_kill &&
+       !info->writes_samplemask)
+      mode |= LP_HIZ_UPDATE;
+
+   return mode;
+}
+
+
+/**
+ * Work out whether the rasterizer can shade a variant with spans of a
+ * constant color.  That needs a shader whose only effect is writing a
+ * color that depends on nothing but constants, into a single sampled
+ * rgba8 color buffer with no per-fragment tests.
+ */
+static unsigned
+fs_linear_mode(const struct lp_fragment_shader *shader,
+               const struct lp_fragment_shader_variant_key *key,
+               unsigned *alpha)
+{
+   const struct tgsi_shader_info *info = &shader->info.base;
+   const struct pipe_rt_blend_state *rt = &key->blend.rt[0];
+   const struct util_format_description *desc;
+
+   if (LP_PERF & PERF_NO_FS_LINEAR)
+      return LP_FS_LINEAR_NONE;
+
+   if (info->num_inputs ||
+       info->num_system_values ||
+       info->num_outputs != 1 ||
+       info->output_semantic_name[0] != TGSI_SEMANTIC_COLOR ||
+       info->output_semantic_index[0] != 0 ||
+       info->file_count[TGSI_FILE_SAMPLER] ||
+       info->file_count[TGSI_FILE_SAMPLER_VIEW] ||
+       info->file_count[TGSI_FILE_IMAGE] ||
+       info->file_count[TGSI_FILE_BUFFER] ||
+       info->writes_memory ||
+       info->uses_kill)
+      return LP_FS_LINEAR_NONE;
+
+   if (key->nr_cbufs != 1 ||
+       key->cbuf_nr_samples[0] > 1 ||
+       key->multisample ||
+       key->depth.enabled ||
+       key->stencil[0].enabled ||
+       key->alpha.enabled ||
+       key->occlusion_count ||
+       key->blend.logicop_enable ||
+       key->blend.alpha_to_coverage)
+      return LP_FS_LINEAR_NONE;
+
+   desc = util_format_description(key->cbuf_format[0]);
+   if (!desc ||
+       !util_format_is_rgba8_variant(desc) ||
+       !util_format_colormask_full(desc, rt->colormask))
+      return LP_FS_LINEAR_NONE;
+
+   if (!rt->blend_enable)
+      return LP_FS_LINEAR_OPAQUE;
+
+   /* Premultiplied alpha "over", which needs alpha stored in the buffer. */
+   if (desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB ||
+       desc->swizzle[3] > PIPE_SWIZZLE_W ||
+       rt->rgb_func != PIPE_BLEND_ADD ||
+       rt->alpha_func != PIPE_BLEND_ADD ||
+       rt->rgb_src_factor != PIPE_BLENDFACTOR_ONE ||
+       rt->alpha_src_factor != PIPE_BLENDFACTOR_ONE ||
+       rt->rgb_dst_factor != PIPE_BLENDFACTOR_INV_SRC_ALPHA ||
+       rt->alpha_dst_factor != PIPE_BLENDFACTOR_INV_SRC_ALPHA)
+      return LP_FS_LINEAR_NONE;
+
+   *alpha = desc->swizzle[3];
+   return LP_FS_LINEAR_OVER;
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
@@ -3473,6 +3817,7 @@ generate_variant(struct llvmpipe_context *lp,
    unsigned char ir_sha1_cache_key[20];
    struct lp_cached_code cached = { 0 };
    bool needs_caching = false;
+   bool async = false;
    variant = MALLOC(sizeof *variant + shader->variant_key_size - sizeof variant->key);
    if (!variant)
       return NULL;
@@ -3484,7 +3829,7 @@ generate_variant(struct llvmpipe_context *lp,
    variant->shader = shader;
    memcpy(&variant->key, key, shader->variant_key_size);
 
-   if (shader->base.ir.nir) {
+   if (screen->disk_shader_cache) {
       lp_fs_get_ir_cache_key(variant, ir_sha1_cache_key);
 
       lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
@@ -3497,6 +3842,13 @@ generate_variant(struct llvmpipe_context *lp,
       return NULL;
    }
 
+   /*
+    * Nothing was found in the disk cache: get something running quickly
+    * and leave the optimized build to the compile queue.
+    */
+   if (screen->async_compile && !cached.data_size)
+      async = gallivm_disable_optimizations(variant->gallivm);
+
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
    variant->no = shader->variants_created++;
@@ -3525,45 +3877,20 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.writes_samplemask
       ? TRUE : FALSE;
 
+   variant->hiz_mode = fs_hiz_mode(shader, key);
+   variant->linear_mode = fs_linear_mode(shader, key, &variant->linear_alpha);
+
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
       lp_debug_fs_variant(variant);
    }
 
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
-
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
-      }
-   }
+   compile_variant(shader, variant);
 
-   /*
-    * Compile everything
-    */
-
-   gallivm_compile_module(variant->gallivm);
-
-   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
-
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
-   }
-
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
-   }
-
-   if (needs_caching) {
+   if (async) {
+      util_queue_fence_init(&variant->async_fence);
+      queue_optimized_variant(screen, shader, variant, module_name,
+                              ir_sha1_cache_key, needs_caching);
+   } else if (needs_caching) {
       lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
    }
 
@@ -3710,6 +4037,13 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants, variant->nr_instrs, lp->nr_fs_instrs);
    }
 
+   if (variant->async_pending) {
+      util_queue_fence_wait(&variant->async_fence);
+      util_queue_fence_destroy(&variant->async_fence);
+      if (variant->async_gallivm)
+         gallivm_destroy(variant->async_gallivm);
+   }
+
    gallivm_destroy(variant->gallivm);
 
    /* remove from shader's list */
@@ -3861,6 +4195,8 @@ llvmpipe_set_shader_images(struct pipe_context *pipe,
    for (i = start_slot, idx = 0; i < start_slot + count; i++, idx++) {
       const struct pipe_image_view *image = images ? &images[idx] : NULL;
 
+      if (image && image->resource)
+         llvmpipe_resource_untile(pipe, image->resource, FALSE);
       util_copy_image_view(&llvmpipe->images[shader][i], image);
    }
 
@@ -32,6 +32,7 @@
 
 #include "pipe/p_compiler.h"
 #include "pipe/p_state.h"
+#include "util/u_queue.h"
 #include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
@@ -47,6 +48,24 @@ struct lp_fragment_shader;
 #define RAST_EDGE_TEST 1
 
 
+/** How a variant uses the rasterizer's hierarchical depth (hiz_mode) */
+#define LP_HIZ_CULL       0x1  /**< skip blocks behind the depth bound */
+#define LP_HIZ_UPDATE     0x2  /**< fully covered blocks lower the bound */
+#define LP_HIZ_INVALIDATE 0x4  /**< depth writes may raise stored values */
+
+/** Depth quantization margin for the hierarchical depth test */
+#define LP_HIZ_EPSILON (1.0f / 16384.0f)
+
+/**
+ * How the rasterizer can shade a variant without running it per 4x4 block
+ * (linear_mode): the shader outputs a constant color, which is stored or
+ * premultiplied-alpha blended over whole spans of the rgba8 color buffer.
+ */
+#define LP_FS_LINEAR_NONE   0
+#define LP_FS_LINEAR_OPAQUE 1
+#define LP_FS_LINEAR_OVER   2
+
+
 struct lp_sampler_static_state
 {
    /*
@@ -131,6 +150,13 @@ struct lp_fragment_shader_variant
 
    boolean opaque;
 
+   /** LP_HIZ_x flags */
+   unsigned hiz_mode;
+
+   /** LP_FS_LINEAR_x, and the byte of a cbuf 0 pixel holding alpha */
+   unsigned linear_mode;
+   unsigned linear_alpha;
+
    struct gallivm_state *gallivm;
 
    LLVMTypeRef jit_context_ptr_type;
@@ -141,6 +167,11 @@ struct lp_fragment_shader_variant
 
    lp_jit_frag_func jit_function[2];
 
+   /* Optimized rebuild running on the screen's compile queue */
+   bool async_pending;
+   struct util_queue_fence async_fence;
+   struct gallivm_state *async_gallivm;
+
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
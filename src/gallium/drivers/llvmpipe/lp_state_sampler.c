@@ -40,6 +40,7 @@
 #include "lp_debug.h"
 #include "frontend/sw_winsys.h"
 #include "lp_flush.h"
+#include "lp_texture.h"
 
 
 static void *
@@ -185,6 +186,12 @@ llvmpipe_create_sampler_view(struct pipe_context *pipe,
       texture->bind |= PIPE_BIND_SAMPLER_VIEW;
    }
 
+   /* Sampling only knows the linear layout. */
+   if (!llvmpipe_resource_untile(pipe, texture, FALSE)) {
+      FREE(view);
+      return NULL;
+   }
+
    if (view) {
       *view = *templ;
       view->reference.count = 1;
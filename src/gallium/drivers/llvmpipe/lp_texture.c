@@ -44,12 +44,14 @@
 #include "util/u_transfer.h"
 
 #include "lp_context.h"
+#include "lp_fence.h"
 #include "lp_flush.h"
 #include "lp_screen.h"
 #include "lp_texture.h"
 #include "lp_setup.h"
 #include "lp_state.h"
 #include "lp_rast.h"
+#include "lp_scene.h"
 
 #include "frontend/sw_winsys.h"
 
@@ -171,6 +173,22 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
    lpr->sample_stride = total_size;
    total_size *= num_samples;
 
+   /* The tiled layout has whole tiles, which may go past the image. */
+   if (lpr->tiled_size) {
+      const unsigned tile_size = lpr->tiled_size;
+      uint64_t tiled_bytes = (uint64_t)DIV_ROUND_UP(pt->width0, tile_size) *
+                             DIV_ROUND_UP(pt->height0, tile_size) *
+                             tile_size * tile_size *
+                             util_format_get_blocksize(pt->format);
+
+      total_size = MAX2(total_size, tiled_bytes);
+      if (total_size > LP_MAX_TEXTURE_SIZE) {
+         goto fail;
+      }
+   }
+
+   lpr->total_alloc_size = total_size;
+
    if (allocate) {
       lpr->tex_data = align_malloc(total_size, mip_align);
       if (!lpr->tex_data) {
@@ -188,6 +206,52 @@ fail:
 }
 
 
+/**
+ * Tile size of the tiled layout a new texture can use, or zero.  Only
+ * single level 2D render targets which the rasterizer is the only expected
+ * user of qualify.
+ */
+static unsigned
+llvmpipe_tiled_size(const struct llvmpipe_screen *screen,
+                    const struct pipe_resource *templat)
+{
+   const struct util_format_description *desc =
+      util_format_description(templat->format);
+   unsigned tile_size;
+
+   if (!screen->tiled_render_targets ||
+       !(templat->bind & PIPE_BIND_RENDER_TARGET) ||
+       (templat->bind & (PIPE_BIND_DISPLAY_TARGET |
+                         PIPE_BIND_SCANOUT |
+                         PIPE_BIND_SHARED |
+                         PIPE_BIND_LINEAR |
+                         PIPE_BIND_SHADER_IMAGE |
+                         PIPE_BIND_SHADER_BUFFER)) ||
+       templat->usage == PIPE_USAGE_STAGING ||
+       (templat->target != PIPE_TEXTURE_2D &&
+        templat->target != PIPE_TEXTURE_RECT) ||
+       templat->last_level != 0 ||
+       templat->array_size != 1 ||
+       templat->nr_samples > 1 ||
+       !desc ||
+       desc->block.width != 1 ||
+       desc->block.height != 1 ||
+       util_format_is_depth_or_stencil(templat->format))
+      return 0;
+
+   /*
+    * Any scene rendering to it has to use the screen's tile size, which
+    * lp_scene_begin_binning() only grows for framebuffers needing more bins.
+    */
+   tile_size = 1 << screen->tile_order;
+   if (DIV_ROUND_UP(templat->width0, tile_size) *
+       DIV_ROUND_UP(templat->height0, tile_size) > LP_MAX_BINS)
+      return 0;
+
+   return tile_size;
+}
+
+
 /**
  * Check the size of the texture specified by 'res'.
  * \return TRUE if OK, FALSE if too large.
@@ -213,8 +277,8 @@ llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
    /* Round up the surface size to a multiple of the tile size to
     * avoid tile clipping.
     */
-   const unsigned width = MAX2(1, align(lpr->base.width0, TILE_SIZE));
-   const unsigned height = MAX2(1, align(lpr->base.height0, TILE_SIZE));
+   const unsigned width = MAX2(1, align(lpr->base.width0, LP_MAX_TILE_SIZE));
+   const unsigned height = MAX2(1, align(lpr->base.height0, LP_MAX_TILE_SIZE));
 
    lpr->dt = winsys->displaytarget_create(winsys,
                                           lpr->base.bind,
@@ -267,8 +331,11 @@ llvmpipe_resource_create_front(struct pipe_screen *_screen,
       }
       else {
          /* texture map */
+         lpr->tiled_size = llvmpipe_tiled_size(screen, templat);
          if (!llvmpipe_texture_layout(screen, lpr, true))
             goto fail;
+         /* The contents are undefined, so start out tiled. */
+         lpr->tiled = lpr->tiled_size != 0;
       }
    }
    else {
@@ -328,6 +395,7 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    if (lpr->dt) {
       /* display target */
       struct sw_winsys *winsys = screen->winsys;
+      lp_fence_reference(&lpr->dt_fence, NULL);
       winsys->displaytarget_destroy(winsys, lpr->dt);
    }
    else if (llvmpipe_resource_is_texture(pt)) {
@@ -531,6 +599,11 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
    assert(resource);
    assert(level <= resource->last_level);
 
+   /* The CPU needs the linear layout. */
+   if (!llvmpipe_resource_untile(pipe, resource,
+                                 !!(usage & PIPE_TRANSFER_DONTBLOCK)))
+      return NULL;
+
    /*
     * Transfers, like other pipe operations, must happen in order, so flush the
     * context if necessary.
@@ -766,6 +839,85 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
 }
 
 
+/**
+ * Rearrange the data of a tiled resource into the linear layout.
+ * Nothing may be using the resource meanwhile.
+ */
+static boolean
+llvmpipe_resource_detile(struct llvmpipe_resource *lpr)
+{
+   const unsigned tile_size = lpr->tiled_size;
+   const unsigned bpp = util_format_get_blocksize(lpr->base.format);
+   const unsigned tile_stride = tile_size * bpp;
+   const unsigned tile_bytes = tile_stride * tile_size;
+   const unsigned tiles_x = DIV_ROUND_UP(lpr->base.width0, tile_size);
+   const unsigned row_stride = lpr->row_stride[0];
+   ubyte *data = lpr->tex_data;
+   ubyte *copy;
+   unsigned x, y;
+
+   assert(tile_size);
+
+   if (!lpr->tiled)
+      return TRUE;
+
+   copy = MALLOC(lpr->total_alloc_size);
+   if (!copy)
+      return FALSE;
+   memcpy(copy, data, lpr->total_alloc_size);
+
+   for (y = 0; y < lpr->base.height0; y++) {
+      const unsigned tile_row = (y / tile_size) * tiles_x;
+      const unsigned tile_y = (y % tile_size) * tile_stride;
+
+      for (x = 0; x < lpr->base.width0; x += tile_size) {
+         const unsigned linear = y * row_stride + x * bpp;
+         const unsigned tile = (tile_row + x / tile_size) * tile_bytes + tile_y;
+         const unsigned bytes = MIN2(tile_size, lpr->base.width0 - x) * bpp;
+
+         memcpy(data + linear, copy + tile, bytes);
+      }
+   }
+
+   FREE(copy);
+   lpr->tiled = FALSE;
+   return TRUE;
+}
+
+
+/**
+ * Switch a resource which may use the tiled layout to the linear layout for
+ * good, before anything but the rasterizer's color buffer access sees its
+ * data.  Waits for queued rendering to the resource first.
+ * \return FALSE if that would block and do_not_block is set, or on OOM.
+ */
+boolean
+llvmpipe_resource_untile(struct pipe_context *pipe,
+                         struct pipe_resource *resource,
+                         boolean do_not_block)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+
+   if (!lpr->tiled_size)
+      return TRUE;
+
+   if (!llvmpipe_flush_resource(pipe, resource, 0,
+                                FALSE, /* read_only */
+                                TRUE, /* cpu_access */
+                                do_not_block,
+                                __FUNCTION__))
+      return FALSE;
+
+   if (!llvmpipe_resource_detile(lpr)) {
+      debug_printf("llvmpipe: out of memory untiling resource %u\n", lpr->id);
+      return FALSE;
+   }
+
+   lpr->tiled_size = 0;
+   return TRUE;
+}
+
+
 /**
  * Return size of resource in bytes
  */
@@ -45,6 +45,7 @@ enum lp_texture_usage
 struct pipe_context;
 struct pipe_screen;
 struct llvmpipe_context;
+struct lp_fence;
 
 struct sw_displaytarget;
 
@@ -75,6 +76,13 @@ struct llvmpipe_resource
     */
    struct sw_displaytarget *dt;
 
+   /**
+    * Fence of the last scene rendering to the display target, so that
+    * presenting it can wait for the rasterizer.  Protected by the screen's
+    * rast_mutex.
+    */
+   struct lp_fence *dt_fence;
+
    /**
     * Malloc'ed data for regular textures, or a mapping to dt above.
     */
@@ -91,6 +99,16 @@ struct llvmpipe_resource
    unsigned id;  /**< temporary, for debugging */
 
    unsigned sample_stride;
+
+   /**
+    * Tile size of the tiled layout, where the pixels of each scene tile
+    * are contiguous and tiles are stored in raster order, or zero for
+    * resources which always stay linear (LP_TILED_RENDER_TARGETS).
+    * tiled is the current layout.  It only changes on the application
+    * thread, while no queued scene uses the resource.
+    */
+   unsigned tiled_size;
+   boolean tiled;
 #ifdef DEBUG
    /** for linked list */
    struct llvmpipe_resource *prev, *next;
@@ -227,6 +245,12 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
                                    unsigned face_slice, unsigned level);
 
 
+boolean
+llvmpipe_resource_untile(struct pipe_context *pipe,
+                         struct pipe_resource *resource,
+                         boolean do_not_block);
+
+
 extern void
 llvmpipe_print_resources(void);
 
@@ -673,17 +673,17 @@ panfrost_batch_get_shared_memory(struct panfrost_batch *batch,
 struct panfrost_bo *
 panfrost_batch_get_tiler_heap(struct panfrost_batch *batch)
 {
+        struct panfrost_device *dev = pan_device(batch->ctx->base.screen);
+
         if (batch->tiler_heap)
                 return batch->tiler_heap;
 
-        batch->tiler_heap = panfrost_batch_create_bo(batch, 4096 * 4096,
-                                                     PAN_BO_INVISIBLE |
-                                                     PAN_BO_GROWABLE,
-                                                     PAN_BO_ACCESS_PRIVATE |
-                                                     PAN_BO_ACCESS_RW |
-                                                     PAN_BO_ACCESS_VERTEX_TILER |
-                                                     PAN_BO_ACCESS_FRAGMENT);
-        assert(batch->tiler_heap);
+        panfrost_batch_add_bo(batch, dev->tiler_heap,
+                              PAN_BO_ACCESS_PRIVATE |
+                              PAN_BO_ACCESS_RW |
+                              PAN_BO_ACCESS_VERTEX_TILER |
+                              PAN_BO_ACCESS_FRAGMENT);
+        batch->tiler_heap = dev->tiler_heap;
         return batch->tiler_heap;
 }
 
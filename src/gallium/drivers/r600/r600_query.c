@@ -189,7 +189,7 @@ static bool r600_query_sw_begin(struct r600_common_context *rctx,
 		break;
 	case R600_QUERY_GALLIUM_THREAD_BUSY:
 		query->begin_result =
-			rctx->tc ? util_queue_get_thread_time_nano(&rctx->tc->queue, 0) : 0;
+			rctx->tc ? u_thread_get_time_nano(rctx->tc->thread) : 0;
 		query->begin_time = os_time_get_nano();
 		break;
 	case R600_QUERY_GPU_LOAD:
@@ -339,7 +339,7 @@ static bool r600_query_sw_end(struct r600_common_context *rctx,
 		break;
 	case R600_QUERY_GALLIUM_THREAD_BUSY:
 		query->end_result =
-			rctx->tc ? util_queue_get_thread_time_nano(&rctx->tc->queue, 0) : 0;
+			rctx->tc ? u_thread_get_time_nano(rctx->tc->thread) : 0;
 		query->end_time = os_time_get_nano();
 		break;
 	case R600_QUERY_GPU_LOAD:
@@ -129,6 +129,11 @@ enum radeon_value_id
    RADEON_CURRENT_SCLK,
    RADEON_CURRENT_MCLK,
    RADEON_CS_THREAD_TIME,
+   RADEON_SLAB_UNUSED_MEMORY, /* allocated slab entries that aren't in use */
+   RADEON_NUM_SLAB_RECLAIM_CHECKS,
+   RADEON_BO_CACHE_HITS,
+   RADEON_BO_CACHE_MISSES,
+   RADEON_BO_CACHE_EVICTIONS,
 };
 
 enum radeon_bo_priority
@@ -531,9 +531,10 @@ static void cik_sdma_copy(struct pipe_context *ctx, struct pipe_resource *dst, u
     *   https://bugs.freedesktop.org/show_bug.cgi?id=110575
     *   https://bugs.freedesktop.org/show_bug.cgi?id=110635
     *
-    * Keep SDMA enabled on APUs.
+    * Keep SDMA enabled on APUs, and if it's requested for uploads. dma_copy
+    * is only used by transfers, texture reallocation and linear blits.
     */
-   if (sctx->screen->debug_flags & DBG(FORCE_SDMA) ||
+   if (sctx->screen->debug_flags & (DBG(FORCE_SDMA) | DBG(SDMA_UPLOADS)) ||
        (!sctx->screen->info.has_dedicated_vram &&
         !(sctx->screen->debug_flags & DBG(NO_SDMA_COPY_IMAGE)))) {
       if ((sctx->chip_class == GFX7 || sctx->chip_class == GFX8) &&
@@ -321,6 +321,18 @@ void si_replace_buffer_storage(struct pipe_context *ctx, struct pipe_resource *d
    si_rebind_buffer(sctx, dst);
 }
 
+/* Called by the threaded context from the application thread. */
+bool si_is_resource_busy(struct pipe_screen *screen, struct pipe_resource *resource,
+                         unsigned usage)
+{
+   struct si_screen *sscreen = (struct si_screen *)screen;
+
+   /* Writes must wait for all reads and writes, reads only for writes. */
+   return !sscreen->ws->buffer_wait(si_resource(resource)->buf, 0,
+                                    usage & PIPE_TRANSFER_WRITE ? RADEON_USAGE_READWRITE
+                                                                : RADEON_USAGE_WRITE);
+}
+
 static void si_invalidate_resource(struct pipe_context *ctx, struct pipe_resource *resource)
 {
    struct si_context *sctx = (struct si_context *)ctx;
@@ -559,9 +571,16 @@ static void si_buffer_do_flush_region(struct pipe_context *ctx, struct pipe_tran
          return;
       }
 
-      /* Copy the staging buffer into the original one. */
-      si_copy_buffer(sctx, transfer->resource, &stransfer->staging->b.b, box->x, src_offset,
-                     box->width);
+      /* Copy the staging buffer into the original one. SDMA runs in parallel
+       * with the gfx ring. The gfx IB depends on the SDMA IB, because the
+       * SDMA IB is always flushed first.
+       */
+      if (sctx->screen->debug_flags & DBG(SDMA_UPLOADS))
+         si_sdma_copy_buffer(sctx, transfer->resource, &stransfer->staging->b.b, box->x,
+                             src_offset, box->width);
+      else
+         si_copy_buffer(sctx, transfer->resource, &stransfer->staging->b.b, box->x, src_offset,
+                        box->width);
    }
 
    util_range_add(&buf->b.b, &buf->valid_buffer_range, box->x, box->x + box->width);
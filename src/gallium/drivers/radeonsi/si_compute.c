@@ -297,7 +297,7 @@ static void si_bind_compute_state(struct pipe_context *ctx, void *state)
 
    /* Wait because we need active slot usage masks. */
    if (program->ir_type != PIPE_SHADER_IR_NATIVE)
-      util_queue_fence_wait(&sel->ready);
+      util_queue_fence_wait_promote(&sctx->screen->shader_compiler_queue, &sel->ready);
 
    si_set_active_descriptors(sctx,
                              SI_DESCS_FIRST_COMPUTE + SI_SHADER_DESCS_CONST_AND_SHADER_BUFFERS,
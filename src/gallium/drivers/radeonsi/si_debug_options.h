@@ -1,5 +1,7 @@
 OPT_BOOL(aux_debug, false, "Generate ddebug_dumps for the auxiliary context")
 OPT_BOOL(sync_compile, false, "Always compile synchronously (will cause stalls)")
+OPT_BOOL(no_opt_variants, false,
+         "Don't compile optimized shader variants in the background (less CPU usage, slower shaders)")
 OPT_BOOL(dump_shader_binary, false, "Dump shader binary as part of ddebug_dumps")
 OPT_BOOL(debug_disassembly, false,
          "Report shader disassembly as part of driver debug messages (for shader db)")
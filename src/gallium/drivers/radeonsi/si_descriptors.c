@@ -123,6 +123,50 @@ static void si_release_descriptors(struct si_descriptors *desc)
 {
    si_resource_reference(&desc->buffer, NULL);
    FREE(desc->list);
+
+   for (unsigned i = 0; i < SI_NUM_DESCRIPTOR_UPLOADS; i++) {
+      si_resource_reference(&desc->uploads[i].buffer, NULL);
+      FREE(desc->uploads[i].list);
+   }
+}
+
+/* Return a previous upload of the active slots with the same contents. */
+static struct si_descriptors_upload *si_find_descriptors_upload(struct si_descriptors *desc,
+                                                                unsigned first_slot_offset,
+                                                                unsigned upload_size)
+{
+   for (unsigned i = 0; i < SI_NUM_DESCRIPTOR_UPLOADS; i++) {
+      struct si_descriptors_upload *upload = &desc->uploads[i];
+
+      if (upload->list && upload->first_active_slot == desc->first_active_slot &&
+          upload->num_active_slots == desc->num_active_slots &&
+          !memcmp((char *)upload->list + first_slot_offset,
+                  (char *)desc->list + first_slot_offset, upload_size))
+         return upload;
+   }
+   return NULL;
+}
+
+static void si_remember_descriptors_upload(struct si_descriptors *desc,
+                                           unsigned first_slot_offset, unsigned upload_size)
+{
+   struct si_descriptors_upload *upload = &desc->uploads[desc->next_upload];
+
+   if (!upload->list) {
+      upload->list = MALLOC(desc->num_elements * desc->element_dw_size * 4);
+      if (!upload->list)
+         return;
+   }
+
+   memcpy((char *)upload->list + first_slot_offset, (char *)desc->list + first_slot_offset,
+          upload_size);
+   si_resource_reference(&upload->buffer, desc->buffer);
+   upload->gpu_address = desc->gpu_address;
+   upload->gpu_list = desc->gpu_list;
+   upload->first_active_slot = desc->first_active_slot;
+   upload->num_active_slots = desc->num_active_slots;
+
+   desc->next_upload = (desc->next_upload + 1) % SI_NUM_DESCRIPTOR_UPLOADS;
 }
 
 static bool si_upload_descriptors(struct si_context *sctx, struct si_descriptors *desc)
@@ -151,6 +195,25 @@ static bool si_upload_descriptors(struct si_context *sctx, struct si_descriptors
       return true;
    }
 
+   /* Reuse a previous upload if the descriptors are the same. The uploaded
+    * memory is never overwritten while it's referenced.
+    */
+   if (desc->reuse_uploads) {
+      struct si_descriptors_upload *upload =
+         si_find_descriptors_upload(desc, first_slot_offset, upload_size);
+
+      if (upload) {
+         si_resource_reference(&desc->buffer, upload->buffer);
+         desc->gpu_list = upload->gpu_list;
+         desc->gpu_address = upload->gpu_address;
+
+         radeon_add_to_buffer_list(sctx, sctx->gfx_cs, desc->buffer, RADEON_USAGE_READ,
+                                   RADEON_PRIO_DESCRIPTORS);
+         si_mark_atom_dirty(sctx, &sctx->atoms.s.shader_pointers);
+         return true;
+      }
+   }
+
    uint32_t *ptr;
    unsigned buffer_offset;
    u_upload_alloc(sctx->b.const_uploader, first_slot_offset, upload_size,
@@ -175,6 +238,9 @@ static bool si_upload_descriptors(struct si_context *sctx, struct si_descriptors
    assert((desc->buffer->gpu_address >> 32) == sctx->screen->info.address32_hi);
    assert((desc->gpu_address >> 32) == sctx->screen->info.address32_hi);
 
+   if (desc->reuse_uploads)
+      si_remember_descriptors_upload(desc, first_slot_offset, upload_size);
+
    si_mark_atom_dirty(sctx, &sctx->atoms.s.shader_pointers);
    return true;
 }
@@ -2677,6 +2743,9 @@ void si_init_all_descriptors(struct si_context *sctx)
                             RADEON_PRIO_SHADER_RINGS, RADEON_PRIO_CONST_BUFFER);
    sctx->descriptors[SI_DESCS_RW_BUFFERS].num_active_slots = SI_NUM_RW_BUFFERS;
 
+   for (i = 0; i < SI_NUM_DESCS; ++i)
+      sctx->descriptors[i].reuse_uploads = true;
+
    /* Initialize an array of 1024 bindless descriptors, when the limit is
     * reached, just make it larger and re-upload the whole array.
     */
@@ -164,6 +164,8 @@ static int si_get_param(struct pipe_screen *pscreen, enum pipe_cap param)
    case PIPE_CAP_ALPHA_TO_COVERAGE_DITHER_CONTROL:
    case PIPE_CAP_MAP_UNSYNCHRONIZED_THREAD_SAFE:
    case PIPE_CAP_NO_CLIP_ON_COPY_TEX:
+   case PIPE_CAP_CONSTBUF_PARTIAL_UPDATES:
+   case PIPE_CAP_SHAREABLE_CSOS:
       return 1;
 
    case PIPE_CAP_GLSL_ZERO_INIT:
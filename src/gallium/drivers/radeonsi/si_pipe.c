@@ -87,6 +87,7 @@ static const struct debug_named_value debug_options[] = {
    {"nodma", DBG(NO_SDMA), "Disable SDMA"},
    {"nodmaclear", DBG(NO_SDMA_CLEARS), "Disable SDMA clears"},
    {"nodmacopyimage", DBG(NO_SDMA_COPY_IMAGE), "Disable SDMA image copies"},
+   {"dmauploads", DBG(SDMA_UPLOADS), "Use SDMA for texture and buffer uploads."},
    {"nowc", DBG(NO_WC), "Disable GTT write combining"},
    {"check_vm", DBG(CHECK_VM), "Check VM faults and dump debug info."},
    {"reserve_vmid", DBG(RESERVE_VMID), "Force VMID reservation per context."},
@@ -128,6 +129,7 @@ static const struct debug_named_value test_options[] = {
    {"testvmfaultsdma", DBG(TEST_VMFAULT_SDMA), "Invoke a SDMA VM fault test and exit."},
    {"testvmfaultshader", DBG(TEST_VMFAULT_SHADER), "Invoke a shader VM fault test and exit."},
    {"testdmaperf", DBG(TEST_DMA_PERF), "Test DMA performance"},
+   {"testtransferperf", DBG(TEST_TRANSFER_PERF), "Benchmark transfers, copies, blits and clears"},
    {"testgds", DBG(TEST_GDS), "Test GDS."},
    {"testgdsmm", DBG(TEST_GDS_MM), "Test GDS memory management."},
    {"testgdsoamm", DBG(TEST_GDS_OA_MM), "Test GDS OA memory management."},
@@ -415,6 +417,16 @@ static void si_set_context_param(struct pipe_context *ctx, enum pipe_context_par
    }
 }
 
+/* Whether a full stream upload buffer can be reused by the ring. */
+static bool si_upload_buffer_is_idle(struct pipe_context *ctx, struct pipe_resource *buffer)
+{
+   struct si_context *sctx = (struct si_context *)ctx;
+   struct pb_buffer *buf = si_resource(buffer)->buf;
+
+   return !si_rings_is_buffer_referenced(sctx, buf, RADEON_USAGE_READWRITE) &&
+          sctx->ws->buffer_wait(buf, 0, RADEON_USAGE_READWRITE);
+}
+
 static struct pipe_context *si_create_context(struct pipe_screen *screen, unsigned flags)
 {
    struct si_screen *sscreen = (struct si_screen *)screen;
@@ -468,6 +480,7 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen, unsign
       u_upload_create(&sctx->b, 1024 * 1024, 0, PIPE_USAGE_STREAM, SI_RESOURCE_FLAG_READ_ONLY);
    if (!sctx->b.stream_uploader)
       goto fail;
+   u_upload_enable_ring(sctx->b.stream_uploader, 4, si_upload_buffer_is_idle);
 
    sctx->cached_gtt_allocator = u_upload_create(&sctx->b, 16 * 1024, 0, PIPE_USAGE_STAGING, 0);
    if (!sctx->cached_gtt_allocator)
@@ -482,7 +495,7 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen, unsign
         *    https://gitlab.freedesktop.org/mesa/mesa/-/issues/1399
         *    https://gitlab.freedesktop.org/mesa/mesa/-/issues/1889
         */
-       (sctx->chip_class != GFX8 || sscreen->debug_flags & DBG(FORCE_SDMA)) &&
+       (sctx->chip_class != GFX8 || sscreen->debug_flags & (DBG(FORCE_SDMA) | DBG(SDMA_UPLOADS))) &&
        /* SDMA causes corruption on gfx9 APUs:
         *    https://gitlab.freedesktop.org/mesa/mesa/-/issues/2814
         *
@@ -490,12 +503,12 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen, unsign
         * everything, because neither gfx8 nor gfx10 enable SDMA, and it's not
         * easy to test.
         */
-       (sctx->chip_class != GFX9 || sscreen->debug_flags & DBG(FORCE_SDMA)) &&
+       (sctx->chip_class != GFX9 || sscreen->debug_flags & (DBG(FORCE_SDMA) | DBG(SDMA_UPLOADS))) &&
        /* SDMA timeouts sometimes on gfx10 so disable it for now. See:
         *    https://bugs.freedesktop.org/show_bug.cgi?id=111481
         *    https://gitlab.freedesktop.org/mesa/mesa/-/issues/1907
         */
-       (sctx->chip_class != GFX10 || sscreen->debug_flags & DBG(FORCE_SDMA))) {
+       (sctx->chip_class != GFX10 || sscreen->debug_flags & (DBG(FORCE_SDMA) | DBG(SDMA_UPLOADS)))) {
       sctx->sdma_cs = sctx->ws->cs_create(sctx->ctx, RING_DMA, (void *)si_flush_dma_cs, sctx,
                                           stop_exec_on_failure);
    }
@@ -742,7 +755,7 @@ static struct pipe_context *si_pipe_create_context(struct pipe_screen *screen, v
    struct pipe_context * tc = threaded_context_create(
             ctx, &sscreen->pool_transfers, si_replace_buffer_storage,
             sscreen->info.is_amdgpu ? si_create_fence : NULL,
-            &((struct si_context *)ctx)->tc);
+            si_is_resource_busy, &((struct si_context *)ctx)->tc);
 
    if (tc && tc != ctx && os_get_total_physical_memory(&total_ram)) {
       ((struct threaded_context *) tc)->bytes_mapped_limit = total_ram / 4;
@@ -1062,9 +1075,11 @@ static struct pipe_screen *radeonsi_screen_create_impl(struct radeon_winsys *ws,
    /* Take a reference on the glsl types for the compiler threads. */
    glsl_type_singleton_init_or_ref();
 
+   /* The compiler queues of all screens share one pool of threads. */
    if (!util_queue_init(
           &sscreen->shader_compiler_queue, "sh", 64, num_comp_hi_threads,
-          UTIL_QUEUE_INIT_RESIZE_IF_FULL | UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY)) {
+          UTIL_QUEUE_INIT_RESIZE_IF_FULL | UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY |
+             UTIL_QUEUE_INIT_SHARED_EXECUTOR)) {
       si_destroy_shader_cache(sscreen);
       FREE(sscreen);
       glsl_type_singleton_decref();
@@ -1074,7 +1089,8 @@ static struct pipe_screen *radeonsi_screen_create_impl(struct radeon_winsys *ws,
    if (!util_queue_init(&sscreen->shader_compiler_queue_low_priority, "shlo", 64,
                         num_comp_lo_threads,
                         UTIL_QUEUE_INIT_RESIZE_IF_FULL | UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY |
-                           UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY)) {
+                           UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY |
+                           UTIL_QUEUE_INIT_SHARED_EXECUTOR)) {
       si_destroy_shader_cache(sscreen);
       FREE(sscreen);
       glsl_type_singleton_decref();
@@ -1283,6 +1299,9 @@ static struct pipe_screen *radeonsi_screen_create_impl(struct radeon_winsys *ws,
       si_test_dma_perf(sscreen);
    }
 
+   if (test_flags & DBG(TEST_TRANSFER_PERF))
+      si_test_transfer_perf(sscreen);
+
    if (test_flags & (DBG(TEST_VMFAULT_CP) | DBG(TEST_VMFAULT_SDMA) | DBG(TEST_VMFAULT_SHADER)))
       si_test_vmfault(sscreen, test_flags);
 
@@ -181,6 +181,7 @@ enum
    DBG_NO_SDMA,
    DBG_NO_SDMA_CLEARS,
    DBG_NO_SDMA_COPY_IMAGE,
+   DBG_SDMA_UPLOADS,
    DBG_NO_WC,
    DBG_CHECK_VM,
    DBG_RESERVE_VMID,
@@ -223,6 +224,7 @@ enum
    DBG_TEST_VMFAULT_SDMA,
    DBG_TEST_VMFAULT_SHADER,
    DBG_TEST_DMA_PERF,
+   DBG_TEST_TRANSFER_PERF,
    DBG_TEST_GDS,
    DBG_TEST_GDS_MM,
    DBG_TEST_GDS_OA_MM,
@@ -553,6 +555,13 @@ struct si_screen {
     * are loading shaders on demand. This is a monotonic counter.
     */
    unsigned num_shaders_created;
+   /* Optimized (monolithic) variants compiled in the background, the total
+    * time from queuing them until they were ready, and how many shader
+    * selections fell back to the unoptimized variant meanwhile.
+    */
+   unsigned num_optimized_variants;
+   uint64_t optimized_variant_wait_ns;
+   unsigned num_unoptimized_variant_draws;
    unsigned num_memory_shader_cache_hits;
    unsigned num_memory_shader_cache_misses;
    unsigned num_disk_shader_cache_hits;
@@ -616,6 +625,13 @@ struct si_screen {
     */
    simple_mtx_t shader_cache_mutex;
    struct hash_table *shader_cache;
+   /* Entries of shader_cache, most recently used first. The least recently
+    * used ones are evicted when shader_cache_size exceeds
+    * shader_cache_max_size, but stay in the disk cache.
+    */
+   struct list_head shader_cache_lru;
+   uint64_t shader_cache_size;
+   uint64_t shader_cache_max_size;
 
    /* Shader cache of live shaders. */
    struct util_live_shader_cache live_shader_cache;
@@ -1311,6 +1327,8 @@ struct si_resource *si_aligned_buffer_create(struct pipe_screen *screen, unsigne
                                              unsigned usage, unsigned size, unsigned alignment);
 void si_replace_buffer_storage(struct pipe_context *ctx, struct pipe_resource *dst,
                                struct pipe_resource *src);
+bool si_is_resource_busy(struct pipe_screen *screen, struct pipe_resource *resource,
+                         unsigned usage);
 void si_init_screen_buffer_functions(struct si_screen *sscreen);
 void si_init_buffer_functions(struct si_context *sctx);
 
@@ -1495,6 +1513,9 @@ void si_test_dma(struct si_screen *sscreen);
 /* si_test_clearbuffer.c */
 void si_test_dma_perf(struct si_screen *sscreen);
 
+/* si_test_transfer_perf.c */
+void si_test_transfer_perf(struct si_screen *sscreen);
+
 /* si_uvd.c */
 struct pipe_video_codec *si_uvd_create_decoder(struct pipe_context *context,
                                                const struct pipe_video_codec *templ);
@@ -108,6 +108,16 @@ static enum radeon_value_id winsys_id_from_type(unsigned type)
       return RADEON_CURRENT_MCLK;
    case SI_QUERY_CS_THREAD_BUSY:
       return RADEON_CS_THREAD_TIME;
+   case SI_QUERY_SLAB_UNUSED_MEMORY:
+      return RADEON_SLAB_UNUSED_MEMORY;
+   case SI_QUERY_NUM_SLAB_RECLAIM_CHECKS:
+      return RADEON_NUM_SLAB_RECLAIM_CHECKS;
+   case SI_QUERY_BO_CACHE_HITS:
+      return RADEON_BO_CACHE_HITS;
+   case SI_QUERY_BO_CACHE_MISSES:
+      return RADEON_BO_CACHE_MISSES;
+   case SI_QUERY_BO_CACHE_EVICTIONS:
+      return RADEON_BO_CACHE_EVICTIONS;
    default:
       unreachable("query type does not correspond to winsys id");
    }
@@ -210,6 +220,7 @@ static bool si_query_sw_begin(struct si_context *sctx, struct si_query *squery)
    case SI_QUERY_CURRENT_GPU_MCLK:
    case SI_QUERY_BACK_BUFFER_PS_DRAW_RATIO:
    case SI_QUERY_NUM_MAPPED_BUFFERS:
+   case SI_QUERY_SLAB_UNUSED_MEMORY:
       query->begin_result = 0;
       break;
    case SI_QUERY_BUFFER_WAIT_TIME:
@@ -218,7 +229,11 @@ static bool si_query_sw_begin(struct si_context *sctx, struct si_query *squery)
    case SI_QUERY_NUM_SDMA_IBS:
    case SI_QUERY_NUM_BYTES_MOVED:
    case SI_QUERY_NUM_EVICTIONS:
-   case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
+   case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS:
+   case SI_QUERY_NUM_SLAB_RECLAIM_CHECKS:
+   case SI_QUERY_BO_CACHE_HITS:
+   case SI_QUERY_BO_CACHE_MISSES:
+   case SI_QUERY_BO_CACHE_EVICTIONS: {
       enum radeon_value_id ws_id = winsys_id_from_type(query->b.type);
       query->begin_result = sctx->ws->query_value(sctx->ws, ws_id);
       break;
@@ -234,7 +249,7 @@ static bool si_query_sw_begin(struct si_context *sctx, struct si_query *squery)
       query->begin_time = os_time_get_nano();
       break;
    case SI_QUERY_GALLIUM_THREAD_BUSY:
-      query->begin_result = sctx->tc ? util_queue_get_thread_time_nano(&sctx->tc->queue, 0) : 0;
+      query->begin_result = sctx->tc ? u_thread_get_time_nano(sctx->tc->thread) : 0;
       query->begin_time = os_time_get_nano();
       break;
    case SI_QUERY_GPU_LOAD:
@@ -266,6 +281,15 @@ static bool si_query_sw_begin(struct si_context *sctx, struct si_query *squery)
    case SI_QUERY_NUM_SHADERS_CREATED:
       query->begin_result = p_atomic_read(&sctx->screen->num_shaders_created);
       break;
+   case SI_QUERY_NUM_OPTIMIZED_VARIANTS:
+      query->begin_result = p_atomic_read(&sctx->screen->num_optimized_variants);
+      break;
+   case SI_QUERY_OPTIMIZED_VARIANT_WAIT_TIME:
+      query->begin_result = p_atomic_read(&sctx->screen->optimized_variant_wait_ns);
+      break;
+   case SI_QUERY_NUM_UNOPTIMIZED_VARIANT_DRAWS:
+      query->begin_result = p_atomic_read(&sctx->screen->num_unoptimized_variant_draws);
+      break;
    case SI_QUERY_LIVE_SHADER_CACHE_HITS:
       query->begin_result = sctx->screen->live_shader_cache.hits;
       break;
@@ -397,7 +421,12 @@ static bool si_query_sw_end(struct si_context *sctx, struct si_query *squery)
    case SI_QUERY_NUM_SDMA_IBS:
    case SI_QUERY_NUM_BYTES_MOVED:
    case SI_QUERY_NUM_EVICTIONS:
-   case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
+   case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS:
+   case SI_QUERY_SLAB_UNUSED_MEMORY:
+   case SI_QUERY_NUM_SLAB_RECLAIM_CHECKS:
+   case SI_QUERY_BO_CACHE_HITS:
+   case SI_QUERY_BO_CACHE_MISSES:
+   case SI_QUERY_BO_CACHE_EVICTIONS: {
       enum radeon_value_id ws_id = winsys_id_from_type(query->b.type);
       query->end_result = sctx->ws->query_value(sctx->ws, ws_id);
       break;
@@ -413,7 +442,7 @@ static bool si_query_sw_end(struct si_context *sctx, struct si_query *squery)
       query->end_time = os_time_get_nano();
       break;
    case SI_QUERY_GALLIUM_THREAD_BUSY:
-      query->end_result = sctx->tc ? util_queue_get_thread_time_nano(&sctx->tc->queue, 0) : 0;
+      query->end_result = sctx->tc ? u_thread_get_time_nano(sctx->tc->thread) : 0;
       query->end_time = os_time_get_nano();
       break;
    case SI_QUERY_GPU_LOAD:
@@ -446,6 +475,15 @@ static bool si_query_sw_end(struct si_context *sctx, struct si_query *squery)
    case SI_QUERY_NUM_SHADERS_CREATED:
       query->end_result = p_atomic_read(&sctx->screen->num_shaders_created);
       break;
+   case SI_QUERY_NUM_OPTIMIZED_VARIANTS:
+      query->end_result = p_atomic_read(&sctx->screen->num_optimized_variants);
+      break;
+   case SI_QUERY_OPTIMIZED_VARIANT_WAIT_TIME:
+      query->end_result = p_atomic_read(&sctx->screen->optimized_variant_wait_ns);
+      break;
+   case SI_QUERY_NUM_UNOPTIMIZED_VARIANT_DRAWS:
+      query->end_result = p_atomic_read(&sctx->screen->num_unoptimized_variant_draws);
+      break;
    case SI_QUERY_BACK_BUFFER_PS_DRAW_RATIO:
       query->end_result = sctx->last_tex_ps_draw_ratio;
       break;
@@ -544,6 +582,7 @@ static bool si_query_sw_get_result(struct si_context *sctx, struct si_query *squ
    switch (query->b.type) {
    case SI_QUERY_BUFFER_WAIT_TIME:
    case SI_QUERY_GPU_TEMPERATURE:
+   case SI_QUERY_OPTIMIZED_VARIANT_WAIT_TIME:
       result->u64 /= 1000;
       break;
    case SI_QUERY_CURRENT_GPU_SCLK:
@@ -1665,6 +1704,9 @@ void si_resume_queries(struct si_context *sctx)
 static struct pipe_driver_query_info si_driver_query_list[] = {
    X("num-compilations", NUM_COMPILATIONS, UINT64, CUMULATIVE),
    X("num-shaders-created", NUM_SHADERS_CREATED, UINT64, CUMULATIVE),
+   X("num-optimized-variants", NUM_OPTIMIZED_VARIANTS, UINT64, CUMULATIVE),
+   X("optimized-variant-wait-time", OPTIMIZED_VARIANT_WAIT_TIME, MICROSECONDS, CUMULATIVE),
+   X("num-unoptimized-variant-draws", NUM_UNOPTIMIZED_VARIANT_DRAWS, UINT64, CUMULATIVE),
    X("draw-calls", DRAW_CALLS, UINT64, AVERAGE),
    X("decompress-calls", DECOMPRESS_CALLS, UINT64, AVERAGE),
    X("MRT-draw-calls", MRT_DRAW_CALLS, UINT64, AVERAGE),
@@ -1703,6 +1745,11 @@ static struct pipe_driver_query_info si_driver_query_list[] = {
    X("VRAM-usage", VRAM_USAGE, BYTES, AVERAGE),
    X("VRAM-vis-usage", VRAM_VIS_USAGE, BYTES, AVERAGE),
    X("GTT-usage", GTT_USAGE, BYTES, AVERAGE),
+   X("slab-unused-memory", SLAB_UNUSED_MEMORY, BYTES, AVERAGE),
+   X("slab-reclaim-checks", NUM_SLAB_RECLAIM_CHECKS, UINT64, CUMULATIVE),
+   X("BO-cache-hits", BO_CACHE_HITS, UINT64, CUMULATIVE),
+   X("BO-cache-misses", BO_CACHE_MISSES, UINT64, CUMULATIVE),
+   X("BO-cache-evictions", BO_CACHE_EVICTIONS, UINT64, CUMULATIVE),
    X("back-buffer-ps-draw-ratio", BACK_BUFFER_PS_DRAW_RATIO, UINT64, AVERAGE),
    X("live-shader-cache-hits", LIVE_SHADER_CACHE_HITS, UINT, CUMULATIVE),
    X("live-shader-cache-misses", LIVE_SHADER_CACHE_MISSES, UINT, CUMULATIVE),
@@ -83,6 +83,11 @@ enum
    SI_QUERY_GPU_TEMPERATURE,
    SI_QUERY_CURRENT_GPU_SCLK,
    SI_QUERY_CURRENT_GPU_MCLK,
+   SI_QUERY_SLAB_UNUSED_MEMORY,
+   SI_QUERY_NUM_SLAB_RECLAIM_CHECKS,
+   SI_QUERY_BO_CACHE_HITS,
+   SI_QUERY_BO_CACHE_MISSES,
+   SI_QUERY_BO_CACHE_EVICTIONS,
    SI_QUERY_GPU_LOAD,
    SI_QUERY_GPU_SHADERS_BUSY,
    SI_QUERY_GPU_TA_BUSY,
@@ -106,6 +111,9 @@ enum
    SI_QUERY_GPU_SCRATCH_RAM_BUSY,
    SI_QUERY_NUM_COMPILATIONS,
    SI_QUERY_NUM_SHADERS_CREATED,
+   SI_QUERY_NUM_OPTIMIZED_VARIANTS,
+   SI_QUERY_OPTIMIZED_VARIANT_WAIT_TIME,
+   SI_QUERY_NUM_UNOPTIMIZED_VARIANT_DRAWS,
    SI_QUERY_BACK_BUFFER_PS_DRAW_RATIO,
    SI_QUERY_GPIN_ASIC_ID,
    SI_QUERY_GPIN_NUM_SIMD,
@@ -743,6 +743,7 @@ struct si_shader {
    struct si_resource *scratch_bo;
    struct si_shader_key key;
    struct util_queue_fence ready;
+   int64_t queue_time; /* for optimized variants, in ns */
    bool compilation_failed;
    bool is_monolithic;
    bool is_optimized;
@@ -420,6 +420,24 @@ static inline unsigned si_sampler_and_image_descriptors_idx(unsigned shader)
 /* This represents descriptors in memory, such as buffer resources,
  * image resources, and sampler states.
  */
+/* The number of previous uploads of a descriptor list that are remembered.
+ * When the list changes back to one of them, e.g. when an app alternates
+ * between a few textures, the old upload is reused.
+ */
+#define SI_NUM_DESCRIPTOR_UPLOADS 2
+
+struct si_descriptors_upload {
+   struct si_resource *buffer;
+   uint64_t gpu_address;
+   uint32_t *gpu_list;
+   /* A copy of the uploaded slots, indexed like si_descriptors::list.
+    * NULL if the upload is unused.
+    */
+   uint32_t *list;
+   uint32_t first_active_slot;
+   uint32_t num_active_slots;
+};
+
 struct si_descriptors {
    /* The list of descriptors in malloc'd memory. */
    uint32_t *list;
@@ -447,6 +465,13 @@ struct si_descriptors {
    /* If there is only one slot enabled, bind it directly instead of
     * uploading descriptors. -1 if disabled. */
    signed char slot_index_to_bind_directly;
+
+   /* Whether previous uploads are remembered and reused. This must be
+    * false if the uploaded descriptors are updated in place.
+    */
+   bool reuse_uploads;
+   ubyte next_upload;
+   struct si_descriptors_upload uploads[SI_NUM_DESCRIPTOR_UPLOADS];
 };
 
 struct si_buffer_resources {
@@ -1876,7 +1876,15 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
          */
         (!index_size && direct_count >= 1024 &&
          (prim == PIPE_PRIM_TRIANGLES || prim == PIPE_PRIM_TRIANGLE_STRIP) &&
-         !sctx->tes_shader.cso)) &&
+         !sctx->tes_shader.cso) ||
+        /* Indexed draws (including primitive restart) can't use fast launch,
+         * so they need bigger draws to amortize the culling overhead. If
+         * only view and small primitive culling is possible, most primitives
+         * survive, so require 4x more vertices.
+         */
+        (index_size && !sctx->tes_shader.cso &&
+         direct_count >= (rs->cull_front || rs->cull_back || rs->rasterizer_discard ?
+                             6000 * 3 : 4 * 6000 * 3))) &&
        si_get_vs(sctx)->cso->ngg_culling_allowed) {
       unsigned ngg_culling = 0;
 
@@ -2128,9 +2136,23 @@ void si_trace_emit(struct si_context *sctx)
       u_log_flush(sctx->log);
 }
 
+static void si_multi_draw(struct pipe_context *ctx, const struct pipe_draw_info *info,
+                          const struct pipe_draw_start_count *draws, unsigned num_draws)
+{
+   struct pipe_draw_info draw = *info;
+
+   /* Only the first draw emits dirty state, the rest are mostly packets. */
+   for (unsigned i = 0; i < num_draws; i++) {
+      draw.start = draws[i].start;
+      draw.count = draws[i].count;
+      si_draw_vbo(ctx, &draw);
+   }
+}
+
 void si_init_draw_functions(struct si_context *sctx)
 {
    sctx->b.draw_vbo = si_draw_vbo;
+   sctx->b.multi_draw = si_multi_draw;
 
    sctx->blitter->draw_rectangle = si_draw_rectangle;
 
@@ -32,6 +32,7 @@
 #include "util/disk_cache.h"
 #include "util/hash_table.h"
 #include "util/mesa-sha1.h"
+#include "util/os_time.h"
 #include "util/u_async_debug.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
@@ -197,6 +198,27 @@ static bool si_load_shader_binary(struct si_shader *shader, void *binary)
    return true;
 }
 
+struct si_shader_cache_entry {
+   struct list_head lru;
+   unsigned char key[20];
+   void *binary;
+};
+
+static void si_shader_cache_evict(struct si_screen *sscreen)
+{
+   while (sscreen->shader_cache_size > sscreen->shader_cache_max_size &&
+          !list_is_empty(&sscreen->shader_cache_lru)) {
+      struct si_shader_cache_entry *lru =
+         LIST_ENTRY(struct si_shader_cache_entry, sscreen->shader_cache_lru.prev, lru);
+
+      _mesa_hash_table_remove_key(sscreen->shader_cache, lru->key);
+      list_del(&lru->lru);
+      sscreen->shader_cache_size -= *(uint32_t *)lru->binary;
+      FREE(lru->binary);
+      FREE(lru);
+   }
+}
+
 /**
  * Insert a shader into the cache. It's assumed the shader is not in the cache.
  * Use si_shader_cache_load_shader before calling this.
@@ -204,6 +226,7 @@ static bool si_load_shader_binary(struct si_shader *shader, void *binary)
 void si_shader_cache_insert_shader(struct si_screen *sscreen, unsigned char ir_sha1_cache_key[20],
                                    struct si_shader *shader, bool insert_into_disk_cache)
 {
+   struct si_shader_cache_entry *cache_entry;
    void *hw_binary;
    struct hash_entry *entry;
    uint8_t key[CACHE_KEY_SIZE];
@@ -216,16 +239,35 @@ void si_shader_cache_insert_shader(struct si_screen *sscreen, unsigned char ir_s
    if (!hw_binary)
       return;
 
-   if (_mesa_hash_table_insert(sscreen->shader_cache, mem_dup(ir_sha1_cache_key, 20), hw_binary) ==
-       NULL) {
+   if (sscreen->disk_shader_cache && insert_into_disk_cache) {
+      disk_cache_compute_key(sscreen->disk_shader_cache, ir_sha1_cache_key, 20, key);
+      disk_cache_put(sscreen->disk_shader_cache, key, hw_binary, *((uint32_t *)hw_binary), NULL);
+   }
+
+   /* Don't keep binaries that would evict everything else. */
+   if (*(uint32_t *)hw_binary > sscreen->shader_cache_max_size) {
       FREE(hw_binary);
       return;
    }
 
-   if (sscreen->disk_shader_cache && insert_into_disk_cache) {
-      disk_cache_compute_key(sscreen->disk_shader_cache, ir_sha1_cache_key, 20, key);
-      disk_cache_put(sscreen->disk_shader_cache, key, hw_binary, *((uint32_t *)hw_binary), NULL);
+   cache_entry = CALLOC_STRUCT(si_shader_cache_entry);
+   if (!cache_entry) {
+      FREE(hw_binary);
+      return;
+   }
+
+   memcpy(cache_entry->key, ir_sha1_cache_key, 20);
+   cache_entry->binary = hw_binary;
+
+   if (_mesa_hash_table_insert(sscreen->shader_cache, cache_entry->key, cache_entry) == NULL) {
+      FREE(hw_binary);
+      FREE(cache_entry);
+      return;
    }
+
+   list_add(&cache_entry->lru, &sscreen->shader_cache_lru);
+   sscreen->shader_cache_size += *(uint32_t *)hw_binary;
+   si_shader_cache_evict(sscreen);
 }
 
 bool si_shader_cache_load_shader(struct si_screen *sscreen, unsigned char ir_sha1_cache_key[20],
@@ -234,7 +276,11 @@ bool si_shader_cache_load_shader(struct si_screen *sscreen, unsigned char ir_sha
    struct hash_entry *entry = _mesa_hash_table_search(sscreen->shader_cache, ir_sha1_cache_key);
 
    if (entry) {
-      if (si_load_shader_binary(shader, entry->data)) {
+      struct si_shader_cache_entry *cache_entry = entry->data;
+
+      if (si_load_shader_binary(shader, cache_entry->binary)) {
+         list_del(&cache_entry->lru);
+         list_add(&cache_entry->lru, &sscreen->shader_cache_lru);
          p_atomic_inc(&sscreen->num_memory_shader_cache_hits);
          return true;
       }
@@ -285,8 +331,10 @@ static bool si_shader_cache_key_equals(const void *a, const void *b)
 
 static void si_destroy_shader_cache_entry(struct hash_entry *entry)
 {
-   FREE((void *)entry->key);
-   FREE(entry->data);
+   struct si_shader_cache_entry *cache_entry = entry->data;
+
+   FREE(cache_entry->binary);
+   FREE(cache_entry);
 }
 
 bool si_init_shader_cache(struct si_screen *sscreen)
@@ -294,6 +342,10 @@ bool si_init_shader_cache(struct si_screen *sscreen)
    (void)simple_mtx_init(&sscreen->shader_cache_mutex, mtx_plain);
    sscreen->shader_cache =
       _mesa_hash_table_create(NULL, si_shader_cache_key_hash, si_shader_cache_key_equals);
+   list_inithead(&sscreen->shader_cache_lru);
+   sscreen->shader_cache_size = 0;
+   sscreen->shader_cache_max_size =
+      debug_get_num_option("AMD_SHADER_CACHE_MEM_SIZE", 64) * 1024 * 1024;
 
    return sscreen->shader_cache != NULL;
 }
@@ -2007,7 +2059,8 @@ static inline void si_shader_selector_key(struct pipe_context *ctx, struct si_sh
       assert(0);
    }
 
-   if (unlikely(sctx->screen->debug_flags & DBG(NO_OPT_VARIANT)))
+   if (unlikely(sctx->screen->debug_flags & DBG(NO_OPT_VARIANT)) ||
+       sctx->screen->options.no_opt_variants)
       memset(&key->opt, 0, sizeof(key->opt));
 }
 
@@ -2060,6 +2113,10 @@ static void si_build_shader_variant_low_priority(void *job, int thread_index)
    assert(thread_index >= 0);
 
    si_build_shader_variant(shader, thread_index, true);
+
+   struct si_screen *sscreen = shader->selector->screen;
+   p_atomic_inc(&sscreen->num_optimized_variants);
+   p_atomic_add(&sscreen->optimized_variant_wait_ns, os_time_get_nano() - shader->queue_time);
 }
 
 static const struct si_shader_key zeroed;
@@ -2124,6 +2181,7 @@ again:
             if (optimized_or_none)
                return -1;
 
+            p_atomic_inc(&sscreen->num_unoptimized_variant_draws);
             memset(&key->opt, 0, sizeof(key->opt));
             goto current_not_ready;
          }
@@ -2143,7 +2201,7 @@ current_not_ready:
     * in a compiler thread.
     */
    if (thread_index < 0)
-      util_queue_fence_wait(&sel->ready);
+      util_queue_fence_wait_promote(&sscreen->shader_compiler_queue, &sel->ready);
 
    simple_mtx_lock(&sel->mutex);
 
@@ -2161,6 +2219,7 @@ current_not_ready:
             if (iter->is_optimized) {
                if (optimized_or_none)
                   return -1;
+               p_atomic_inc(&sscreen->num_unoptimized_variant_draws);
                memset(&key->opt, 0, sizeof(key->opt));
                goto again;
             }
@@ -2271,6 +2330,7 @@ current_not_ready:
    /* If it's an optimized shader, compile it asynchronously. */
    if (shader->is_optimized && thread_index < 0) {
       /* Compile it asynchronously. */
+      shader->queue_time = os_time_get_nano();
       util_queue_add_job(&sscreen->shader_compiler_queue_low_priority, shader, &shader->ready,
                          si_build_shader_variant_low_priority, NULL, 0);
 
@@ -2293,6 +2353,7 @@ current_not_ready:
 
       if (optimized_or_none)
          return -1;
+      p_atomic_inc(&sscreen->num_unoptimized_variant_draws);
       goto again;
    }
 
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2020 Advanced Micro Devices, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/* This file implements a benchmark of the transfer paths that apps use:
+ * texture and buffer uploads and readbacks, resource_copy_region, blits and
+ * clears, for different sizes and resource usages (i.e. memory placements).
+ *
+ * Each operation is repeated NUM_RUNS times and timed on the CPU until the
+ * GPU is idle, so the results include the CPU overhead of the driver.
+ * They are printed as CSV.
+ */
+
+#include "si_pipe.h"
+#include "util/os_time.h"
+#include "util/u_box.h"
+#include "util/u_inlines.h"
+
+#include <inttypes.h>
+
+#define MIN_TEX_SIZE 64 /* width and height */
+#define MAX_TEX_SIZE 4096
+#define MIN_BUF_SIZE (4 * 1024)
+#define MAX_BUF_SIZE (64 * 1024 * 1024)
+#define NUM_RUNS     16
+
+enum si_transfer_op
+{
+   OP_TEXTURE_UPLOAD,
+   OP_TEXTURE_READBACK,
+   OP_BUFFER_UPLOAD,
+   OP_BUFFER_READBACK,
+   OP_COPY,
+   OP_BLIT,
+   OP_CLEAR,
+   NUM_OPS,
+};
+
+static const char *op_str[] = {
+   "texture upload",
+   "texture readback",
+   "buffer upload",
+   "buffer readback",
+   "copy region",
+   "blit",
+   "clear",
+};
+
+static const struct {
+   const char *name;
+   enum pipe_resource_usage usage;
+} placements[] = {
+   {"default", PIPE_USAGE_DEFAULT},
+   {"stream", PIPE_USAGE_STREAM},
+   {"staging", PIPE_USAGE_STAGING},
+};
+
+static bool op_is_texture(enum si_transfer_op op)
+{
+   return op != OP_BUFFER_UPLOAD && op != OP_BUFFER_READBACK;
+}
+
+static bool op_has_src(enum si_transfer_op op)
+{
+   return op == OP_TEXTURE_READBACK || op == OP_BUFFER_READBACK || op == OP_COPY ||
+          op == OP_BLIT;
+}
+
+static bool op_has_dst(enum si_transfer_op op)
+{
+   return op != OP_TEXTURE_READBACK && op != OP_BUFFER_READBACK;
+}
+
+/* For textures, size is the width and height. */
+static struct pipe_resource *create_resource(struct pipe_screen *screen, bool is_texture,
+                                             unsigned size, enum pipe_resource_usage usage)
+{
+   if (!is_texture)
+      return pipe_buffer_create(screen, 0, usage, size);
+
+   struct pipe_resource templ = {};
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.width0 = size;
+   templ.height0 = size;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.usage = usage;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_RENDER_TARGET;
+
+   return screen->resource_create(screen, &templ);
+}
+
+static void run_op(struct pipe_context *ctx, enum si_transfer_op op, struct pipe_resource *dst,
+                   struct pipe_resource *src, unsigned size, uint8_t *data)
+{
+   struct pipe_transfer *transfer;
+   struct pipe_box box;
+   uint8_t *map;
+
+   u_box_2d(0, 0, size, size, &box);
+
+   switch (op) {
+   case OP_TEXTURE_UPLOAD:
+      ctx->texture_subdata(ctx, dst, 0, PIPE_TRANSFER_WRITE, &box, data, size * 4, 0);
+      break;
+   case OP_TEXTURE_READBACK:
+      map = pipe_transfer_map(ctx, src, 0, 0, PIPE_TRANSFER_READ, 0, 0, size, size, &transfer);
+      if (!map)
+         break;
+      for (unsigned y = 0; y < size; y++)
+         memcpy(data + y * size * 4, map + y * transfer->stride, size * 4);
+      pipe_transfer_unmap(ctx, transfer);
+      break;
+   case OP_BUFFER_UPLOAD:
+      pipe_buffer_write(ctx, dst, 0, size, data);
+      break;
+   case OP_BUFFER_READBACK:
+      pipe_buffer_read(ctx, src, 0, size, data);
+      break;
+   case OP_COPY:
+      ctx->resource_copy_region(ctx, dst, 0, 0, 0, 0, src, 0, &box);
+      break;
+   case OP_BLIT: {
+      struct pipe_blit_info blit = {};
+
+      blit.src.resource = src;
+      blit.src.format = src->format;
+      blit.src.box = box;
+      blit.dst.resource = dst;
+      blit.dst.format = dst->format;
+      blit.dst.box = box;
+      blit.mask = PIPE_MASK_RGBA;
+      blit.filter = PIPE_TEX_FILTER_NEAREST;
+      ctx->blit(ctx, &blit);
+      break;
+   }
+   case OP_CLEAR:
+      ctx->clear_texture(ctx, dst, 0, &box, data);
+      break;
+   default:
+      unreachable("invalid transfer op");
+   }
+}
+
+static void wait_idle(struct pipe_context *ctx)
+{
+   struct pipe_screen *screen = ctx->screen;
+   struct pipe_fence_handle *fence = NULL;
+
+   ctx->flush(ctx, &fence, 0);
+   if (fence) {
+      screen->fence_finish(screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+      screen->fence_reference(screen, &fence, NULL);
+   }
+}
+
+void si_test_transfer_perf(struct si_screen *sscreen)
+{
+   struct pipe_screen *screen = &sscreen->b;
+   struct pipe_context *ctx = screen->context_create(screen, NULL, 0);
+   uint8_t *data = malloc(MAX2(MAX_TEX_SIZE * MAX_TEX_SIZE * 4, MAX_BUF_SIZE));
+
+   if (!ctx || !data) {
+      fprintf(stderr, "radeonsi: transfer benchmark initialization failed\n");
+      exit(1);
+   }
+
+   for (unsigned i = 0; i < MAX2(MAX_TEX_SIZE * MAX_TEX_SIZE * 4, MAX_BUF_SIZE); i++)
+      data[i] = i * 7;
+
+   printf("Operation,Source,Destination,Bytes,MB/s\n");
+
+   for (unsigned op = 0; op < NUM_OPS; op++) {
+      bool is_texture = op_is_texture(op);
+      unsigned num_src = op_has_src(op) ? ARRAY_SIZE(placements) : 1;
+      unsigned num_dst = op_has_dst(op) ? ARRAY_SIZE(placements) : 1;
+      unsigned min_size = is_texture ? MIN_TEX_SIZE : MIN_BUF_SIZE;
+      unsigned max_size = is_texture ? MAX_TEX_SIZE : MAX_BUF_SIZE;
+
+      for (unsigned s = 0; s < num_src; s++) {
+         for (unsigned d = 0; d < num_dst; d++) {
+            for (unsigned size = min_size; size <= max_size; size *= 2) {
+               struct pipe_resource *src = NULL, *dst = NULL;
+               uint64_t num_bytes = is_texture ? (uint64_t)size * size * 4 : size;
+
+               if (op_has_src(op)) {
+                  src = create_resource(screen, is_texture, size, placements[s].usage);
+                  if (!src)
+                     continue;
+               }
+               if (op_has_dst(op)) {
+                  dst = create_resource(screen, is_texture, size, placements[d].usage);
+                  if (!dst) {
+                     pipe_resource_reference(&src, NULL);
+                     continue;
+                  }
+               }
+
+               /* Warm up, so that first-use costs aren't measured. */
+               run_op(ctx, op, dst, src, size, data);
+               wait_idle(ctx);
+
+               int64_t start = os_time_get_nano();
+               for (unsigned i = 0; i < NUM_RUNS; i++)
+                  run_op(ctx, op, dst, src, size, data);
+               wait_idle(ctx);
+               int64_t ns = os_time_get_nano() - start;
+
+               printf("%s,%s,%s,%" PRIu64 ",%.0f\n", op_str[op],
+                      src ? placements[s].name : "-", dst ? placements[d].name : "-", num_bytes,
+                      (num_bytes * NUM_RUNS / (1024.0 * 1024.0)) / (ns / 1000000000.0));
+               fflush(stdout);
+
+               pipe_resource_reference(&src, NULL);
+               pipe_resource_reference(&dst, NULL);
+            }
+         }
+      }
+   }
+
+   free(data);
+   ctx->destroy(ctx);
+   exit(0);
+}
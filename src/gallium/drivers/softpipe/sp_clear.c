@@ -39,6 +39,7 @@
 #include "sp_context.h"
 #include "sp_screen.h"
 #include "sp_query.h"
+#include "sp_threads.h"
 #include "sp_tile_cache.h"
 
 
@@ -68,6 +69,9 @@ softpipe_clear(struct pipe_context *pipe, unsigned buffers,
    softpipe_update_derived(softpipe, PIPE_PRIM_TRIANGLES); /* not needed?? */
 #endif
 
+   /* don't let tiles rendered by the worker threads land on the clear */
+   sp_threads_flush(softpipe);
+
    if (buffers & PIPE_CLEAR_COLOR) {
       for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++) {
          if (buffers & (PIPE_CLEAR_COLOR0 << i))
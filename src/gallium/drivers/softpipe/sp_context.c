@@ -48,12 +48,17 @@
 #include "sp_surface.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
+#include "sp_threads.h"
 #include "sp_texture.h"
 #include "sp_query.h"
 #include "sp_screen.h"
 #include "sp_tex_sample.h"
 #include "sp_image.h"
 
+
+DEBUG_GET_ONCE_NUM_OPTION(num_threads, "SOFTPIPE_NUM_THREADS", 0)
+
+
 static void
 softpipe_destroy( struct pipe_context *pipe )
 {
@@ -75,6 +80,8 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
+   sp_threads_destroy(softpipe->threads);
+
    if (softpipe->quad.shade)
       softpipe->quad.shade->destroy( softpipe->quad.shade );
 
@@ -325,6 +332,10 @@ softpipe_create_context(struct pipe_screen *screen,
               (struct tgsi_buffer *)
               softpipe->tgsi.buffer[PIPE_SHADER_GEOMETRY]);
 
+   /* Optional tile-parallel rasterization, must be before the vbuf backend */
+   softpipe->threads = sp_threads_create(softpipe,
+                                         debug_get_option_num_threads());
+
    softpipe->vbuf_backend = sp_create_vbuf_backend(softpipe);
    if (!softpipe->vbuf_backend)
       goto fail;
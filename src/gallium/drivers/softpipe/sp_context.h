@@ -56,6 +56,7 @@ struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
 struct sp_so_state;
+struct sp_threads;
 
 struct softpipe_context {
    struct pipe_context pipe;  /**< base class */
@@ -189,6 +190,9 @@ struct softpipe_context {
 
    struct blitter_context *blitter;
 
+   /** Tile-parallel rasterizer threads, NULL if rendering serially */
+   struct sp_threads *threads;
+
    boolean dirty_render_cache;
 
    struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
@@ -38,6 +38,7 @@
 #include "sp_state.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
+#include "sp_threads.h"
 #include "util/u_debug_image.h"
 #include "util/u_memory.h"
 #include "util/u_string.h"
@@ -61,8 +62,11 @@ softpipe_flush( struct pipe_context *pipe,
             sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
          }
       }
+      sp_threads_flush_texture_caches(softpipe);
    }
 
+   sp_threads_flush(softpipe);
+
    /* If this is a swapbuffers, just flush color buffers.
     *
     * The zbuffer changes are not discarded, but held in the cache
@@ -179,6 +183,9 @@ void softpipe_texture_barrier(struct pipe_context *pipe, unsigned flags)
          sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
       }
    }
+   sp_threads_flush_texture_caches(softpipe);
+
+   sp_threads_flush(softpipe);
 
    for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
       if (softpipe->cbuf_cache[i])
@@ -40,6 +40,7 @@
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "sp_prim_vbuf.h"
+#include "sp_threads.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
 #include "util/u_memory.h"
@@ -49,6 +50,10 @@
 #define SP_MAX_VBUF_INDEXES 1024
 #define SP_MAX_VBUF_SIZE    4096
 
+/* Bigger batches amortize the thread synchronization per batch */
+#define SP_MAX_THREADED_VBUF_INDEXES 8192
+#define SP_MAX_THREADED_VBUF_SIZE    (64 * 1024)
+
 typedef const float (*cptrf4)[4];
 
 /**
@@ -154,20 +159,34 @@ static inline cptrf4 get_vert( const void *vertex_buffer,
 
 
 /**
- * draw elements / indexed primitives
+ * A batch of primitives, as handed to the tile-parallel rasterizer.
+ */
+struct sp_vbuf_batch
+{
+   enum pipe_prim_type prim;
+   const void *vertex_buffer;
+   unsigned stride;
+   boolean flatshade_first;
+   const ushort *indices;  /**< NULL for non-indexed batches */
+   uint nr;
+};
+
+
+/**
+ * Emit indexed primitives to the given setup context.
  */
 static void
-sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+sp_vbuf_emit_elements(struct setup_context *setup,
+                      enum pipe_prim_type prim,
+                      const void *vertex_buffer,
+                      const unsigned stride,
+                      const boolean flatshade_first,
+                      const ushort *indices,
+                      uint nr)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
-   struct softpipe_context *softpipe = cvbr->softpipe;
-   const unsigned stride = softpipe->vertex_info.size * sizeof(float);
-   const void *vertex_buffer = cvbr->vertex_buffer;
-   struct setup_context *setup = cvbr->setup;
-   const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
-   switch (cvbr->prim) {
+   switch (prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
          sp_setup_point( setup,
@@ -349,22 +368,19 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
 
 
 /**
- * This function is hit when the draw module is working in pass-through mode.
- * It's up to us to convert the vertex array into point/line/tri prims.
+ * Emit non-indexed primitives to the given setup context.
  */
 static void
-sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+sp_vbuf_emit_arrays(struct setup_context *setup,
+                    enum pipe_prim_type prim,
+                    const void *vertex_buffer,
+                    const unsigned stride,
+                    const boolean flatshade_first,
+                    uint nr)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
-   struct softpipe_context *softpipe = cvbr->softpipe;
-   struct setup_context *setup = cvbr->setup;
-   const unsigned stride = softpipe->vertex_info.size * sizeof(float);
-   const void *vertex_buffer =
-      (void *) get_vert(cvbr->vertex_buffer, start, stride);
-   const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
-   switch (cvbr->prim) {
+   switch (prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
          sp_setup_point( setup,
@@ -587,6 +603,97 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    }
 }
 
+
+/** Called by each tile-parallel rasterizer thread */
+static void
+sp_vbuf_emit_batch(struct setup_context *setup, const void *data)
+{
+   const struct sp_vbuf_batch *batch = (const struct sp_vbuf_batch *) data;
+
+   if (batch->indices)
+      sp_vbuf_emit_elements(setup, batch->prim, batch->vertex_buffer,
+                            batch->stride, batch->flatshade_first,
+                            batch->indices, batch->nr);
+   else
+      sp_vbuf_emit_arrays(setup, batch->prim, batch->vertex_buffer,
+                          batch->stride, batch->flatshade_first,
+                          batch->nr);
+}
+
+
+/**
+ * Hand the batch to the rasterizer threads if possible.
+ * \return FALSE if the caller has to render it serially
+ */
+static boolean
+sp_vbuf_render_threaded(struct softpipe_vbuf_render *cvbr,
+                        const struct sp_vbuf_batch *batch)
+{
+   struct softpipe_context *softpipe = cvbr->softpipe;
+
+   if (sp_threads_enabled(softpipe) &&
+       sp_threads_render(softpipe, sp_vbuf_emit_batch, batch))
+      return TRUE;
+
+   /* the main context's tile caches are about to be used */
+   sp_threads_flush(softpipe);
+   return FALSE;
+}
+
+
+/**
+ * draw elements / indexed primitives
+ */
+static void
+sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+{
+   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   struct softpipe_context *softpipe = cvbr->softpipe;
+   struct sp_vbuf_batch batch;
+
+   batch.prim = cvbr->prim;
+   batch.vertex_buffer = cvbr->vertex_buffer;
+   batch.stride = softpipe->vertex_info.size * sizeof(float);
+   batch.flatshade_first = softpipe->rasterizer->flatshade_first;
+   batch.indices = indices;
+   batch.nr = nr;
+
+   if (softpipe->threads && sp_vbuf_render_threaded(cvbr, &batch))
+      return;
+
+   sp_vbuf_emit_elements(cvbr->setup, batch.prim, batch.vertex_buffer,
+                         batch.stride, batch.flatshade_first,
+                         indices, nr);
+}
+
+
+/**
+ * This function is hit when the draw module is working in pass-through mode.
+ * It's up to us to convert the vertex array into point/line/tri prims.
+ */
+static void
+sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+{
+   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   struct softpipe_context *softpipe = cvbr->softpipe;
+   struct sp_vbuf_batch batch;
+
+   batch.prim = cvbr->prim;
+   batch.stride = softpipe->vertex_info.size * sizeof(float);
+   batch.vertex_buffer =
+      (void *) get_vert(cvbr->vertex_buffer, start, batch.stride);
+   batch.flatshade_first = softpipe->rasterizer->flatshade_first;
+   batch.indices = NULL;
+   batch.nr = nr;
+
+   if (softpipe->threads && sp_vbuf_render_threaded(cvbr, &batch))
+      return;
+
+   sp_vbuf_emit_arrays(cvbr->setup, batch.prim, batch.vertex_buffer,
+                       batch.stride, batch.flatshade_first, nr);
+}
+
+
 /*
  * FIXME: it is unclear if primitives_storage_needed (which is generally
  * the same as pipe query num_primitives_generated) should increase
@@ -650,8 +757,14 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
 
    assert(sp->draw);
 
-   cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
-   cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
+   if (sp->threads) {
+      cvbr->base.max_indices = SP_MAX_THREADED_VBUF_INDEXES;
+      cvbr->base.max_vertex_buffer_bytes = SP_MAX_THREADED_VBUF_SIZE;
+   }
+   else {
+      cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
+      cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
+   }
 
    cvbr->base.get_vertex_info = sp_vbuf_get_vertex_info;
    cvbr->base.allocate_vertices = sp_vbuf_allocate_vertices;
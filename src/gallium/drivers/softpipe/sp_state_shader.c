@@ -30,6 +30,7 @@
 #include "sp_state.h"
 #include "sp_fs.h"
 #include "sp_texture.h"
+#include "sp_threads.h"
 
 #include "pipe/p_defines.h"
 #include "util/u_memory.h"
@@ -223,6 +224,7 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
+      sp_threads_delete_fs_variant(softpipe, var);
       var->delete(var, softpipe->fs_machine);
    }
 
@@ -30,6 +30,7 @@
 
 #include "sp_context.h"
 #include "sp_state.h"
+#include "sp_threads.h"
 #include "sp_tile_cache.h"
 
 #include "draw/draw_context.h"
@@ -53,6 +54,8 @@ softpipe_set_framebuffer_state(struct pipe_context *pipe,
 
    draw_flush(sp->draw);
 
+   sp_threads_set_framebuffer(sp);
+
    for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
       struct pipe_surface *cb = i < fb->nr_cbufs ? fb->cbufs[i] : NULL;
 
@@ -0,0 +1,571 @@
+/**************************************************************************
+ *
+ * Copyright 2021 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tile-parallel rasterization for softpipe.
+ *
+ * The main thread still runs the draw module and primitive assembly.  For
+ * each vbuf batch it snapshots the context into every worker, restricts
+ * the worker's cliprects to its band of tiles and lets all workers
+ * rasterize the whole batch concurrently, then waits for them.  Worker
+ * tile caches stay resident between batches and are only written back
+ * when somebody else needs to see the surfaces (flush, clear, framebuffer
+ * change or a batch rendered serially by the main context).
+ */
+
+#include <stdio.h>
+
+#include "pipe/p_defines.h"
+#include "os/os_thread.h"
+#include "tgsi/tgsi_exec.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_thread.h"
+
+#include "sp_context.h"
+#include "sp_quad_pipe.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_threads.h"
+#include "sp_tile_cache.h"
+
+
+/**
+ * Per-thread rendering state.
+ */
+struct sp_thread_task
+{
+   struct sp_threads *threads;
+   unsigned index;
+
+   /**
+    * Snapshot of the main context, refreshed for every batch.  The fields
+    * below replace the shared ones so that nothing mutable is shared.
+    */
+   struct softpipe_context sp;
+
+   struct setup_context *setup;
+   struct tgsi_exec_machine *fs_machine;
+   struct sp_tgsi_sampler *sampler;
+
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *pstipple;
+
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   thrd_t thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+};
+
+
+struct sp_threads
+{
+   struct softpipe_context *sp;
+
+   unsigned num_threads;
+   struct sp_thread_task *tasks[SP_MAX_THREADS];
+
+   /** The batch being rendered */
+   sp_threads_render_func func;
+   const void *data;
+
+   /** Do the worker tile caches hold tiles which weren't written back? */
+   boolean tiles_dirty;
+
+   boolean exit_flag;
+};
+
+
+static int
+thread_function(void *init_data)
+{
+   struct sp_thread_task *task = (struct sp_thread_task *) init_data;
+   struct sp_threads *threads = task->threads;
+   char thread_name[16];
+
+   snprintf(thread_name, sizeof thread_name, "softpipe-%u", task->index);
+   u_thread_setname(thread_name);
+
+   while (1) {
+      pipe_semaphore_wait(&task->work_ready);
+
+      if (threads->exit_flag)
+         break;
+
+      threads->func(task->setup, threads->data);
+
+      pipe_semaphore_signal(&task->work_done);
+   }
+
+#ifdef _WIN32
+   pipe_semaphore_signal(&task->work_done);
+#endif
+
+   return 0;
+}
+
+
+static void
+destroy_task(struct sp_thread_task *task)
+{
+   uint i;
+
+   if (task->setup)
+      sp_setup_destroy_context(task->setup);
+
+   if (task->shade)
+      task->shade->destroy(task->shade);
+   if (task->depth_test)
+      task->depth_test->destroy(task->depth_test);
+   if (task->blend)
+      task->blend->destroy(task->blend);
+   if (task->pstipple)
+      task->pstipple->destroy(task->pstipple);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_destroy_tile_cache(task->cbuf_cache[i]);
+   sp_destroy_tile_cache(task->zsbuf_cache);
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+      if (task->tex_cache[i])
+         sp_destroy_tex_tile_cache(task->tex_cache[i]);
+   }
+
+   if (task->fs_machine)
+      tgsi_exec_machine_destroy(task->fs_machine);
+
+   FREE(task->sampler);
+   FREE(task);
+}
+
+
+static struct sp_thread_task *
+create_task(struct sp_threads *threads, unsigned index)
+{
+   struct pipe_context *pipe = &threads->sp->pipe;
+   struct sp_thread_task *task = CALLOC_STRUCT(sp_thread_task);
+   uint i;
+
+   if (!task)
+      return NULL;
+
+   task->threads = threads;
+   task->index = index;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      task->cbuf_cache[i] = sp_create_tile_cache(pipe);
+      if (!task->cbuf_cache[i])
+         goto fail;
+   }
+   task->zsbuf_cache = sp_create_tile_cache(pipe);
+   if (!task->zsbuf_cache)
+      goto fail;
+
+   task->sampler = sp_create_tgsi_sampler();
+   task->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+   if (!task->sampler || !task->fs_machine)
+      goto fail;
+
+   /* the stages and the setup context keep pointing at the snapshot */
+   task->shade = sp_quad_shade_stage(&task->sp);
+   task->depth_test = sp_quad_depth_test_stage(&task->sp);
+   task->blend = sp_quad_blend_stage(&task->sp);
+   task->pstipple = sp_quad_polygon_stipple_stage(&task->sp);
+   task->setup = sp_setup_create_context(&task->sp);
+   if (!task->shade || !task->depth_test || !task->blend ||
+       !task->pstipple || !task->setup)
+      goto fail;
+
+   return task;
+
+fail:
+   destroy_task(task);
+   return NULL;
+}
+
+
+struct sp_threads *
+sp_threads_create(struct softpipe_context *sp, unsigned num_threads)
+{
+   struct sp_threads *threads;
+   unsigned i;
+
+   num_threads = MIN2(num_threads, SP_MAX_THREADS);
+   if (!num_threads)
+      return NULL;
+
+   threads = CALLOC_STRUCT(sp_threads);
+   if (!threads)
+      return NULL;
+
+   threads->sp = sp;
+
+   for (i = 0; i < num_threads; i++) {
+      struct sp_thread_task *task = create_task(threads, i);
+      if (!task)
+         break;
+
+      pipe_semaphore_init(&task->work_ready, 0);
+      pipe_semaphore_init(&task->work_done, 0);
+      task->thread = u_thread_create(thread_function, task);
+      if (!task->thread) {
+         pipe_semaphore_destroy(&task->work_ready);
+         pipe_semaphore_destroy(&task->work_done);
+         destroy_task(task);
+         break;
+      }
+
+      threads->tasks[i] = task;
+      threads->num_threads = i + 1;
+   }
+
+   if (!threads->num_threads) {
+      FREE(threads);
+      return NULL;
+   }
+
+   return threads;
+}
+
+
+void
+sp_threads_destroy(struct sp_threads *threads)
+{
+   unsigned i;
+
+   if (!threads)
+      return;
+
+   threads->exit_flag = TRUE;
+   for (i = 0; i < threads->num_threads; i++)
+      pipe_semaphore_signal(&threads->tasks[i]->work_ready);
+
+   for (i = 0; i < threads->num_threads; i++) {
+#ifdef _WIN32
+      pipe_semaphore_wait(&threads->tasks[i]->work_done);
+#else
+      thrd_join(threads->tasks[i]->thread, NULL);
+#endif
+   }
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread_task *task = threads->tasks[i];
+      pipe_semaphore_destroy(&task->work_ready);
+      pipe_semaphore_destroy(&task->work_done);
+      destroy_task(task);
+   }
+
+   FREE(threads);
+}
+
+
+/**
+ * Can the current state be rendered by the worker threads?
+ * Fragment shaders with side effects have to run in primitive order, so
+ * those still go through the main context.
+ */
+boolean
+sp_threads_enabled(const struct softpipe_context *sp)
+{
+   return sp->threads &&
+          sp->fs_variant &&
+          !sp->fs_variant->info.writes_memory;
+}
+
+
+/**
+ * Point the task's fragment samplers at its private texture caches.
+ * \return FALSE if a cache couldn't be allocated
+ */
+static boolean
+task_update_samplers(struct sp_thread_task *task)
+{
+   struct softpipe_context *sp = task->threads->sp;
+   const struct sp_tgsi_sampler *src = sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   unsigned i;
+
+   memcpy(task->sampler, src, sizeof(*src));
+
+   for (i = 0; i < sp->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      struct pipe_sampler_view *view =
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i];
+      struct softpipe_tex_tile_cache *tc;
+
+      if (!view)
+         continue;
+
+      if (!task->tex_cache[i]) {
+         task->tex_cache[i] = sp_create_tex_tile_cache(&sp->pipe);
+         if (!task->tex_cache[i])
+            return FALSE;
+      }
+
+      tc = task->tex_cache[i];
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+      if (tc->texture) {
+         struct softpipe_resource *spt = softpipe_resource(tc->texture);
+         if (spt->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spt->timestamp;
+         }
+      }
+
+      task->sampler->sp_sview[i].cache = tc;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Refresh the task's copy of the context state for a new batch.
+ * Called on the main thread while the task is idle.
+ */
+static boolean
+task_begin(struct sp_thread_task *task, unsigned miny, unsigned maxy)
+{
+   struct softpipe_context *sp = task->threads->sp;
+   struct softpipe_context *tsp = &task->sp;
+   unsigned i;
+
+   memcpy(tsp, sp, sizeof(*tsp));
+
+   tsp->threads = NULL;
+
+   for (i = 0; i < PIPE_MAX_VIEWPORTS; i++) {
+      tsp->cliprect[i].miny = MAX2(sp->cliprect[i].miny, miny);
+      tsp->cliprect[i].maxy = MIN2(sp->cliprect[i].maxy, maxy);
+      if (tsp->cliprect[i].maxy < tsp->cliprect[i].miny)
+         tsp->cliprect[i].maxy = tsp->cliprect[i].miny;
+   }
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      if (sp->framebuffer.cbufs[i])
+         sp_tile_cache_set_surface(task->cbuf_cache[i],
+                                   sp->framebuffer.cbufs[i]);
+      tsp->cbuf_cache[i] = task->cbuf_cache[i];
+   }
+   if (sp->framebuffer.zsbuf)
+      sp_tile_cache_set_surface(task->zsbuf_cache, sp->framebuffer.zsbuf);
+   tsp->zsbuf_cache = task->zsbuf_cache;
+
+   if (!task_update_samplers(task))
+      return FALSE;
+   tsp->tgsi.sampler[PIPE_SHADER_FRAGMENT] = task->sampler;
+
+   /* rebinding parses the shader, so only do it when it changed */
+   if (task->fs_machine->Tokens != sp->fs_variant->tokens) {
+      sp->fs_variant->prepare(sp->fs_variant,
+                              task->fs_machine,
+                              (struct tgsi_sampler *) task->sampler,
+                              (struct tgsi_image *)
+                                 sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                              (struct tgsi_buffer *)
+                                 sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+   }
+   tsp->fs_machine = task->fs_machine;
+
+   tsp->quad.shade = task->shade;
+   tsp->quad.depth_test = task->depth_test;
+   tsp->quad.blend = task->blend;
+   tsp->quad.pstipple = task->pstipple;
+   sp_build_quad_pipeline(tsp);
+
+   /* the main context is fully validated, so this won't derive state */
+   assert(!tsp->dirty);
+   sp_setup_prepare(task->setup);
+
+   return TRUE;
+}
+
+
+/**
+ * Render a vbuf batch with all worker threads and wait for them.
+ * \return FALSE if the batch couldn't be handed to the workers, in which
+ *         case the caller should render it itself
+ */
+boolean
+sp_threads_render(struct softpipe_context *sp,
+                  sp_threads_render_func func,
+                  const void *data)
+{
+   struct sp_threads *threads = sp->threads;
+   const uint64_t occlusion_count = sp->occlusion_count;
+   const uint64_t ps_invocations = sp->pipeline_statistics.ps_invocations;
+   const uint64_t c_primitives = sp->pipeline_statistics.c_primitives;
+   unsigned band_height;
+   unsigned i;
+
+   assert(sp_threads_enabled(sp));
+
+   /* Pending clears and serially rendered tiles must reach the surfaces
+    * before the workers fetch them.
+    */
+   for (i = 0; i < sp->framebuffer.nr_cbufs; i++) {
+      if (sp->framebuffer.cbufs[i])
+         sp_flush_tile_cache(sp->cbuf_cache[i]);
+   }
+   if (sp->framebuffer.zsbuf)
+      sp_flush_tile_cache(sp->zsbuf_cache);
+
+   /* whole tiles per band so that no two workers cache the same tile */
+   band_height = align(DIV_ROUND_UP(MAX2(sp->framebuffer.height, 1),
+                                    threads->num_threads), TILE_SIZE);
+
+   for (i = 0; i < threads->num_threads; i++) {
+      unsigned miny = MIN2(i * band_height, sp->framebuffer.height);
+      unsigned maxy = MIN2(miny + band_height, sp->framebuffer.height);
+      if (!task_begin(threads->tasks[i], miny, maxy))
+         return FALSE;
+   }
+
+   threads->func = func;
+   threads->data = data;
+
+   for (i = 0; i < threads->num_threads; i++)
+      pipe_semaphore_signal(&threads->tasks[i]->work_ready);
+   for (i = 0; i < threads->num_threads; i++)
+      pipe_semaphore_wait(&threads->tasks[i]->work_done);
+
+   threads->tiles_dirty = TRUE;
+
+   /* Gather statistics.  Every worker sets up every primitive, so the
+    * primitive count is taken from the first one only.
+    */
+   sp->pipeline_statistics.c_primitives +=
+      threads->tasks[0]->sp.pipeline_statistics.c_primitives - c_primitives;
+   for (i = 0; i < threads->num_threads; i++) {
+      const struct softpipe_context *tsp = &threads->tasks[i]->sp;
+      sp->occlusion_count += tsp->occlusion_count - occlusion_count;
+      sp->pipeline_statistics.ps_invocations +=
+         tsp->pipeline_statistics.ps_invocations - ps_invocations;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Write back all the tiles cached by the worker threads.
+ */
+void
+sp_threads_flush(struct softpipe_context *sp)
+{
+   struct sp_threads *threads = sp->threads;
+   unsigned i, j;
+
+   if (!threads || !threads->tiles_dirty)
+      return;
+
+   /* the workers are idle between batches so do it from here */
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread_task *task = threads->tasks[i];
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++) {
+         if (sp_tile_cache_get_surface(task->cbuf_cache[j]))
+            sp_flush_tile_cache(task->cbuf_cache[j]);
+      }
+      if (sp_tile_cache_get_surface(task->zsbuf_cache))
+         sp_flush_tile_cache(task->zsbuf_cache);
+   }
+
+   threads->tiles_dirty = FALSE;
+}
+
+
+void
+sp_threads_flush_texture_caches(struct softpipe_context *sp)
+{
+   struct sp_threads *threads = sp->threads;
+   unsigned i, j;
+
+   if (!threads)
+      return;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++) {
+         if (threads->tasks[i]->tex_cache[j])
+            sp_flush_tex_tile_cache(threads->tasks[i]->tex_cache[j]);
+      }
+   }
+}
+
+
+/**
+ * Called before the framebuffer state changes.  Write back and release
+ * the worker surfaces so that no cache outlives its surface.
+ */
+void
+sp_threads_set_framebuffer(struct softpipe_context *sp)
+{
+   struct sp_threads *threads = sp->threads;
+   unsigned i, j;
+
+   if (!threads)
+      return;
+
+   sp_threads_flush(sp);
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread_task *task = threads->tasks[i];
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+         sp_tile_cache_set_surface(task->cbuf_cache[j], NULL);
+      sp_tile_cache_set_surface(task->zsbuf_cache, NULL);
+   }
+}
+
+
+/**
+ * Unbind a fragment shader variant which is about to be deleted from the
+ * worker machines.
+ */
+void
+sp_threads_delete_fs_variant(struct softpipe_context *sp,
+                             struct sp_fragment_shader_variant *var)
+{
+   struct sp_threads *threads = sp->threads;
+   unsigned i;
+
+   if (!threads)
+      return;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct tgsi_exec_machine *machine = threads->tasks[i]->fs_machine;
+      if (machine->Tokens == var->tokens)
+         tgsi_exec_machine_bind_shader(machine, NULL, NULL, NULL, NULL);
+   }
+}
@@ -0,0 +1,91 @@
+/**************************************************************************
+ *
+ * Copyright 2021 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Optional tile-parallel rasterization.
+ *
+ * The framebuffer is split into horizontal bands of whole tiles, one per
+ * worker thread.  Each worker owns a private copy of the context state
+ * along with its own setup context, quad pipeline, fragment shader
+ * machine and surface/texture tile caches, and replays every primitive of
+ * a vbuf batch clipped to its band.  Since the bands never share a tile
+ * the workers never touch the same cached data.
+ */
+
+#ifndef SP_THREADS_H
+#define SP_THREADS_H
+
+#include "pipe/p_compiler.h"
+
+
+/** Upper limit for SOFTPIPE_NUM_THREADS */
+#define SP_MAX_THREADS 16
+
+
+struct softpipe_context;
+struct setup_context;
+struct sp_fragment_shader_variant;
+struct sp_threads;
+
+
+/**
+ * Render the current primitive batch into the given setup context.
+ * Called once per worker, with the worker's own setup context.
+ */
+typedef void (*sp_threads_render_func)(struct setup_context *setup,
+                                       const void *data);
+
+
+struct sp_threads *
+sp_threads_create(struct softpipe_context *sp, unsigned num_threads);
+
+void
+sp_threads_destroy(struct sp_threads *threads);
+
+boolean
+sp_threads_enabled(const struct softpipe_context *sp);
+
+boolean
+sp_threads_render(struct softpipe_context *sp,
+                  sp_threads_render_func func,
+                  const void *data);
+
+void
+sp_threads_flush(struct softpipe_context *sp);
+
+void
+sp_threads_flush_texture_caches(struct softpipe_context *sp);
+
+void
+sp_threads_set_framebuffer(struct softpipe_context *sp);
+
+void
+sp_threads_delete_fs_variant(struct softpipe_context *sp,
+                             struct sp_fragment_shader_variant *var);
+
+
+#endif /* SP_THREADS_H */
@@ -398,6 +398,29 @@ namespace ArchRast
             mNeedFlush = true;
         }
 
+        // Add the counters of this draw to the driver visible stats
+        virtual void Handle(const DrawStatsEvent& event)
+        {
+            SWR_STATS* pStats = (SWR_STATS*)event.data.hStats;
+
+            pStats->EarlyZPassCount += mDSCombined.earlyZTestPassCount +
+                                       mDSPixelRate.earlyZTestPassCount +
+                                       mDSNullPS.earlyZTestPassCount;
+            pStats->EarlyZFailCount += mDSCombined.earlyZTestFailCount +
+                                       mDSPixelRate.earlyZTestFailCount +
+                                       mDSNullPS.earlyZTestFailCount;
+            pStats->LateZPassCount += mDSCombined.lateZTestPassCount +
+                                      mDSPixelRate.lateZTestPassCount;
+            pStats->LateZFailCount += mDSCombined.lateZTestFailCount +
+                                      mDSPixelRate.lateZTestFailCount;
+            pStats->BackfaceCullCount += mCullStats.backfacePrimCount;
+            pStats->DegenerateCullCount += mCullStats.degeneratePrimCount;
+            pStats->RasterTiles += rastStats.rasterTiles;
+
+            // Counters are only reset by a flush.
+            mNeedFlush = true;
+        }
+
         // Flush cached events for this draw
         virtual void FlushDraw(uint32_t drawId)
         {
@@ -96,7 +96,23 @@ KNOBS = [
                        '',
                        'IMPORTANT: If this is non-zero, no worker threads will be bound to',
                        'specific HW threads.  They will all be "floating" SW threads.',
-                       'In this case, the above 3 KNOBS will be ignored.'],
+                       'In this case, the above 3 KNOBS will be ignored',
+                       'unless THREAD_AFFINITY selects a binding policy.'],
+        'category'  : 'perf',
+    }],
+
+    ['THREAD_AFFINITY', {
+        'type'      : 'uint32_t',
+        'default'   : '0',
+        'desc'      : ['Worker thread binding policy.',
+                       '',
+                       '0 - Default: bind per the NUMA/CORE/HYPERTHREAD knobs',
+                       '1 - Pack: fill all HW threads of a core before the next core',
+                       '2 - Spread: round-robin workers across NUMA nodes and cores',
+                       '3 - No SMT: bind at most one worker per physical core',
+                       '',
+                       'Non-default policies use MAX_WORKER_THREADS as a cap on the',
+                       'number of bound workers.'],
         'category'  : 'perf',
     }],
 
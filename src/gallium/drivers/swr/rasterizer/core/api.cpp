@@ -60,6 +60,86 @@ void WakeAllThreads(SWR_CONTEXT* pContext)
     pContext->FifosNotEmpty.notify_all();
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Allocates the per worker data for the threads of the thread pool.
+/// @param pContext - pointer to context
+/// @param hArApiContext - ArchRast context of the API thread, kept last.
+static void CreateWorkerData(SWR_CONTEXT* pContext, HANDLE hArApiContext)
+{
+    if (pContext->threadInfo.SINGLE_THREADED)
+    {
+        pContext->pSingleThreadLockedTiles = new TileSet();
+    }
+
+    pContext->ppScratch = new uint8_t*[pContext->NumWorkerThreads];
+    pContext->pStats =
+        (SWR_STATS*)AlignedMalloc(sizeof(SWR_STATS) * pContext->NumWorkerThreads, 64);
+
+#if defined(KNOB_ENABLE_AR)
+    // Setup ArchRast thread contexts which includes +1 for API thread.
+    pContext->pArContext = new HANDLE[pContext->NumWorkerThreads + 1];
+    pContext->pArContext[pContext->NumWorkerThreads] = hArApiContext;
+#endif
+
+    // Allocate scratch space for workers.
+    ///@note We could lazily allocate this but its rather small amount of memory.
+    for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
+    {
+#if defined(_WIN32)
+        uint32_t numaNode =
+            pContext->threadPool.pThreadData ? pContext->threadPool.pThreadData[i].numaId : 0;
+        pContext->ppScratch[i] = (uint8_t*)VirtualAllocExNuma(GetCurrentProcess(),
+                                                              nullptr,
+                                                              KNOB_WORKER_SCRATCH_SPACE_SIZE,
+                                                              MEM_RESERVE | MEM_COMMIT,
+                                                              PAGE_READWRITE,
+                                                              numaNode);
+#else
+        pContext->ppScratch[i] =
+            (uint8_t*)AlignedMalloc(KNOB_WORKER_SCRATCH_SPACE_SIZE, KNOB_SIMD_WIDTH * 4);
+#endif
+
+#if defined(KNOB_ENABLE_AR)
+        // Initialize worker thread context for ArchRast.
+        pContext->pArContext[i] = ArchRast::CreateThreadContext(ArchRast::AR_THREAD::WORKER);
+
+        SWR_WORKER_DATA* pWorkerData = (SWR_WORKER_DATA*)pContext->threadPool.pThreadData[i].pWorkerPrivateData;
+        pWorkerData->hArContext = pContext->pArContext[i];
+#endif
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Frees the data allocated by CreateWorkerData.
+/// @param pContext - pointer to context
+static void DestroyWorkerData(SWR_CONTEXT* pContext)
+{
+    // Free scratch space.
+    for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
+    {
+#if defined(_WIN32)
+        VirtualFree(pContext->ppScratch[i], 0, MEM_RELEASE);
+#else
+        AlignedFree(pContext->ppScratch[i]);
+#endif
+
+#if defined(KNOB_ENABLE_AR)
+        ArchRast::DestroyThreadContext(pContext->pArContext[i]);
+#endif
+    }
+
+#if defined(KNOB_ENABLE_AR)
+    delete[] pContext->pArContext;
+    pContext->pArContext = nullptr;
+#endif
+
+    delete[] pContext->ppScratch;
+    AlignedFree(pContext->pStats);
+
+    delete pContext->pSingleThreadLockedTiles;
+    pContext->pSingleThreadLockedTiles = nullptr;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Create SWR Context.
 /// @param pCreateInfo - pointer to creation info.
@@ -124,6 +204,7 @@ HANDLE SwrCreateContext(SWR_CREATECONTEXT_INFO* pCreateInfo)
         pContext->threadInfo.MAX_CORES_PER_NUMA_NODE = KNOB_MAX_CORES_PER_NUMA_NODE;
         pContext->threadInfo.MAX_THREADS_PER_CORE    = KNOB_MAX_THREADS_PER_CORE;
         pContext->threadInfo.SINGLE_THREADED         = KNOB_SINGLE_THREADED;
+        pContext->threadInfo.AFFINITY                = (SWR_THREAD_AFFINITY)KNOB_THREAD_AFFINITY;
     }
 
     if (pCreateInfo->pApiThreadInfo)
@@ -136,6 +217,7 @@ HANDLE SwrCreateContext(SWR_CREATECONTEXT_INFO* pCreateInfo)
         pContext->apiThreadInfo.numAPIReservedThreads = 1;
         pContext->apiThreadInfo.numAPIThreadsPerCore  = 1;
     }
+    pContext->apiThreadInfoRequested = pContext->apiThreadInfo;
 
     if (pCreateInfo->pWorkerPrivateState)
     {
@@ -154,56 +236,17 @@ HANDLE SwrCreateContext(SWR_CREATECONTEXT_INFO* pCreateInfo)
         BindApiThread(pContext, 0);
     }
 
-    if (pContext->threadInfo.SINGLE_THREADED)
-    {
-        pContext->pSingleThreadLockedTiles = new TileSet();
-    }
-
-    pContext->ppScratch = new uint8_t*[pContext->NumWorkerThreads];
-    pContext->pStats =
-        (SWR_STATS*)AlignedMalloc(sizeof(SWR_STATS) * pContext->NumWorkerThreads, 64);
-
-#if defined(KNOB_ENABLE_AR)
-    // Setup ArchRast thread contexts which includes +1 for API thread.
-    pContext->pArContext = new HANDLE[pContext->NumWorkerThreads + 1];
-    pContext->pArContext[pContext->NumWorkerThreads] =
-        ArchRast::CreateThreadContext(ArchRast::AR_THREAD::API);
-#endif
-
 #if defined(KNOB_ENABLE_RDTSC)
     pContext->pBucketMgr = new BucketManager(pCreateInfo->contextName);
     RDTSC_RESET(pContext->pBucketMgr);
     RDTSC_INIT(pContext->pBucketMgr, 0);
 #endif
 
-    // Allocate scratch space for workers.
-    ///@note We could lazily allocate this but its rather small amount of memory.
-    for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
-    {
-#if defined(_WIN32)
-        uint32_t numaNode =
-            pContext->threadPool.pThreadData ? pContext->threadPool.pThreadData[i].numaId : 0;
-        pContext->ppScratch[i] = (uint8_t*)VirtualAllocExNuma(GetCurrentProcess(),
-                                                              nullptr,
-                                                              KNOB_WORKER_SCRATCH_SPACE_SIZE,
-                                                              MEM_RESERVE | MEM_COMMIT,
-                                                              PAGE_READWRITE,
-                                                              numaNode);
-#else
-        pContext->ppScratch[i] =
-            (uint8_t*)AlignedMalloc(KNOB_WORKER_SCRATCH_SPACE_SIZE, KNOB_SIMD_WIDTH * 4);
-#endif
-
+    HANDLE hArApiContext = nullptr;
 #if defined(KNOB_ENABLE_AR)
-        // Initialize worker thread context for ArchRast.
-        pContext->pArContext[i] = ArchRast::CreateThreadContext(ArchRast::AR_THREAD::WORKER);
-
-        SWR_WORKER_DATA* pWorkerData = (SWR_WORKER_DATA*)pContext->threadPool.pThreadData[i].pWorkerPrivateData;
-        pWorkerData->hArContext = pContext->pArContext[i];
+    hArApiContext = ArchRast::CreateThreadContext(ArchRast::AR_THREAD::API);
 #endif
-
-
-    }
+    CreateWorkerData(pContext, hArApiContext);
 
 #if defined(KNOB_ENABLE_AR)
     // cache the API thread event manager, for use with sim layer
@@ -440,34 +483,62 @@ void SwrDestroyContext(HANDLE hContext)
     AlignedFree(pContext->pDispatchQueueArray);
     AlignedFree(pContext->pMacroTileManagerArray);
 
-    // Free scratch space.
-    for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
-    {
-#if defined(_WIN32)
-        VirtualFree(pContext->ppScratch[i], 0, MEM_RELEASE);
-#else
-        AlignedFree(pContext->ppScratch[i]);
-#endif
-
-#if defined(KNOB_ENABLE_AR)
-        ArchRast::DestroyThreadContext(pContext->pArContext[i]);
-#endif
-    }
+    DestroyWorkerData(pContext);
 
 #if defined(KNOB_ENABLE_RDTSC)
     delete pContext->pBucketMgr;
 #endif
 
-    delete[] pContext->ppScratch;
-    AlignedFree(pContext->pStats);
-
     delete pContext->pHotTileMgr;
-    delete pContext->pSingleThreadLockedTiles;
 
     pContext->~SWR_CONTEXT();
     AlignedFree(GetContext(hContext));
 }
 
+void SwrSetThreadingInfo(HANDLE hContext, const SWR_THREADING_INFO* pThreadInfo)
+{
+    SWR_CONTEXT*  pContext = GetContext(hContext);
+    DRAW_CONTEXT* pDC      = GetDrawContext(pContext);
+
+    // Retire the current workers like SwrDestroyContext does, but wait for
+    // them to exit so none of them sees work queued for the new ones.
+    pDC->FeWork.type    = SHUTDOWN;
+    pDC->FeWork.pfnWork = ProcessShutdown;
+
+    QueueDraw(pContext);
+
+    DestroyThreadPool(pContext, &pContext->threadPool, true);
+
+    for (uint32_t i = 0; i < pContext->MAX_DRAWS_IN_FLIGHT; ++i)
+    {
+        AlignedFree(pContext->dcRing[i].dynState.pStats);
+    }
+
+    HANDLE hArApiContext = nullptr;
+#if defined(KNOB_ENABLE_AR)
+    hArApiContext = pContext->pArContext[pContext->NumWorkerThreads];
+#endif
+    DestroyWorkerData(pContext);
+
+    pContext->threadInfo       = *pThreadInfo;
+    pContext->apiThreadInfo    = pContext->apiThreadInfoRequested;
+    pContext->NumWorkerThreads = 0;
+    pContext->NumFEThreads     = 0;
+    pContext->NumBEThreads     = 0;
+    memset(&pContext->threadPool, 0, sizeof(pContext->threadPool));
+
+    CreateThreadPool(pContext, &pContext->threadPool);
+
+    if (pContext->apiThreadInfo.bindAPIThread0)
+    {
+        BindApiThread(pContext, 0);
+    }
+
+    CreateWorkerData(pContext, hArApiContext);
+
+    StartThreadPool(pContext, &pContext->threadPool);
+}
+
 void SwrBindApiThread(HANDLE hContext, uint32_t apiThreadId)
 {
     SWR_CONTEXT* pContext = GetContext(hContext);
@@ -1755,6 +1826,7 @@ void SwrGetInterface(SWR_INTERFACE& out_funcs)
     out_funcs.pfnSwrCreateContext          = SwrCreateContext;
     out_funcs.pfnSwrDestroyContext         = SwrDestroyContext;
     out_funcs.pfnSwrBindApiThread          = SwrBindApiThread;
+    out_funcs.pfnSwrSetThreadingInfo       = SwrSetThreadingInfo;
     out_funcs.pfnSwrSaveState              = SwrSaveState;
     out_funcs.pfnSwrRestoreState           = SwrRestoreState;
     out_funcs.pfnSwrSync                   = SwrSync;
@@ -199,6 +199,18 @@ typedef void(SWR_API* PFN_UPDATE_STREAMOUT)(HANDLE hPrivateContext, uint64_t num
 /////////////////////////////////////////////////////////////////////////
 class BucketManager;
 
+//////////////////////////////////////////////////////////////////////////
+/// SWR_THREAD_AFFINITY
+/// Order in which worker threads are bound to HW threads.
+/////////////////////////////////////////////////////////////////////////
+enum SWR_THREAD_AFFINITY
+{
+    SWR_THREAD_AFFINITY_DEFAULT = 0, // Bind all selected HW threads, unbound with MAX_WORKER_THREADS
+    SWR_THREAD_AFFINITY_PACK,        // Fill the cores of one NUMA node before using the next
+    SWR_THREAD_AFFINITY_SPREAD,      // Alternate NUMA nodes, and use all cores before hyper-threads
+    SWR_THREAD_AFFINITY_NO_SMT,      // Like PACK, but only one HW thread per core
+};
+
 //////////////////////////////////////////////////////////////////////////
 /// SWR_THREADING_INFO
 /////////////////////////////////////////////////////////////////////////
@@ -212,6 +224,7 @@ struct SWR_THREADING_INFO
     uint32_t MAX_CORES_PER_NUMA_NODE;
     uint32_t MAX_THREADS_PER_CORE;
     bool     SINGLE_THREADED;
+    SWR_THREAD_AFFINITY AFFINITY; // With MAX_WORKER_THREADS, binds that many threads in this order
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -317,6 +330,12 @@ SWR_FUNC(HANDLE, SwrCreateContext, SWR_CREATECONTEXT_INFO* pCreateInfo);
 /// @param hContext - Handle passed back from SwrCreateContext
 SWR_FUNC(void, SwrDestroyContext, HANDLE hContext);
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Replaces the worker threads of a context, after waiting for idle.
+/// @param hContext - Handle passed back from SwrCreateContext
+/// @param pThreadInfo - Threading info for the new workers.
+SWR_FUNC(void, SwrSetThreadingInfo, HANDLE hContext, const SWR_THREADING_INFO* pThreadInfo);
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Bind current thread to an API reserved HW thread
 /// @param hContext - Handle passed back from SwrCreateContext
@@ -718,6 +737,7 @@ struct SWR_INTERFACE
     PFNSwrCreateContext          pfnSwrCreateContext;
     PFNSwrDestroyContext         pfnSwrDestroyContext;
     PFNSwrBindApiThread          pfnSwrBindApiThread;
+    PFNSwrSetThreadingInfo       pfnSwrSetThreadingInfo;
     PFNSwrSaveState              pfnSwrSaveState;
     PFNSwrRestoreState           pfnSwrRestoreState;
     PFNSwrSync                   pfnSwrSync;
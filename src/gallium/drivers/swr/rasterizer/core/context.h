@@ -520,6 +520,7 @@ struct SWR_CONTEXT
     THREAD_POOL              threadPool; // Thread pool associated with this context
     SWR_THREADING_INFO       threadInfo;
     SWR_API_THREADING_INFO   apiThreadInfo;
+    SWR_API_THREADING_INFO   apiThreadInfoRequested; // apiThreadInfo before CreateThreadPool
     SWR_WORKER_PRIVATE_STATE workerPrivateState;
 
     uint32_t MAX_DRAWS_IN_FLIGHT;
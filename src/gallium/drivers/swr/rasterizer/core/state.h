@@ -614,6 +614,14 @@ OSALIGNLINE(struct) SWR_STATS
     uint64_t PsInvocations; // Number of Pixel Shader invocations
     uint64_t CsInvocations; // Number of Compute Shader invocations
 
+    // ArchRast Stats, only gathered when built with KNOB_ENABLE_AR
+    uint64_t EarlyZPassCount;     // Number of samples passing early depth test
+    uint64_t EarlyZFailCount;     // Number of samples failing early depth test
+    uint64_t LateZPassCount;      // Number of samples passing late depth test
+    uint64_t LateZFailCount;      // Number of samples failing late depth test
+    uint64_t BackfaceCullCount;   // Number of backface culled primitives
+    uint64_t DegenerateCullCount; // Number of degenerate culled primitives
+    uint64_t RasterTiles;         // Number of rasterized macro tiles
 };
 
 //////////////////////////////////////////////////////////////////////////
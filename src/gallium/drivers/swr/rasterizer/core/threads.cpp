@@ -309,9 +309,10 @@ void bindThread(SWR_CONTEXT* pContext,
                 uint32_t     procGroupId   = 0,
                 bool         bindProcGroup = false)
 {
-    // Only bind threads when MAX_WORKER_THREADS isn't set.
-    if (pContext->threadInfo.SINGLE_THREADED ||
-        (pContext->threadInfo.MAX_WORKER_THREADS && bindProcGroup == false))
+    // Only bind threads when MAX_WORKER_THREADS isn't set, or an affinity is.
+    bool floating = pContext->threadInfo.MAX_WORKER_THREADS &&
+                    pContext->threadInfo.AFFINITY == SWR_THREAD_AFFINITY_DEFAULT;
+    if (pContext->threadInfo.SINGLE_THREADED || (floating && bindProcGroup == false))
     {
         return;
     }
@@ -338,7 +339,7 @@ void bindThread(SWR_CONTEXT* pContext,
     {
         // If MAX_WORKER_THREADS is set, only bind to the proc group,
         // Not the individual HW thread.
-        if (!bindProcGroup && !pContext->threadInfo.MAX_WORKER_THREADS)
+        if (!bindProcGroup && !floating)
         {
             affinity.Mask = KAFFINITY(1) << threadId;
         }
@@ -419,7 +420,13 @@ INLINE void UpdateClientStats(SWR_CONTEXT* pContext, uint32_t workerId, DRAW_CON
         stats.DepthPassCount += dynState.pStats[i].DepthPassCount;
         stats.PsInvocations += dynState.pStats[i].PsInvocations;
         stats.CsInvocations += dynState.pStats[i].CsInvocations;
-
+        stats.EarlyZPassCount += dynState.pStats[i].EarlyZPassCount;
+        stats.EarlyZFailCount += dynState.pStats[i].EarlyZFailCount;
+        stats.LateZPassCount += dynState.pStats[i].LateZPassCount;
+        stats.LateZFailCount += dynState.pStats[i].LateZFailCount;
+        stats.BackfaceCullCount += dynState.pStats[i].BackfaceCullCount;
+        stats.DegenerateCullCount += dynState.pStats[i].DegenerateCullCount;
+        stats.RasterTiles += dynState.pStats[i].RasterTiles;
     }
 
 
@@ -445,11 +452,14 @@ INLINE void ExecuteCallbacks(SWR_CONTEXT* pContext, uint32_t workerId, DRAW_CONT
 // inlined-only version
 INLINE int32_t CompleteDrawContextInl(SWR_CONTEXT* pContext, uint32_t workerId, DRAW_CONTEXT* pDC)
 {
+    // ArchRast counters go into this worker's stats before the last worker
+    // sums them up in UpdateClientStats.
+    AR_EVENT(DrawStatsEvent(pDC->drawId, (HANDLE)&pDC->dynState.pStats[workerId]));
+    AR_FLUSH(pDC->drawId);
+
     int32_t result = static_cast<int32_t>(InterlockedDecrement(&pDC->threadsDone));
     SWR_ASSERT(result >= 0);
 
-    AR_FLUSH(pDC->drawId);
-
     if (result == 0)
     {
         ExecuteCallbacks(pContext, workerId, pDC);
@@ -914,8 +924,10 @@ DWORD workerThreadMain(LPVOID pData)
 
     auto threadHasWork = [&](uint32_t curDraw) { return curDraw != pContext->dcRing.GetHead(); };
 
-    uint32_t curDrawBE = 0;
-    uint32_t curDrawFE = 0;
+    // Start at the ring head rather than 0 so that a pool recreated by
+    // SwrSetThreadingInfo doesn't revisit draws retired by the previous pool.
+    uint32_t curDrawBE = pContext->dcRing.GetHead();
+    uint32_t curDrawFE = curDrawBE;
 
     bool bShutdown = false;
 
@@ -1139,6 +1151,20 @@ void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
         pContext->NumBEThreads     = 1;
         pPool->numThreads          = 0;
     }
+    else if (pContext->threadInfo.AFFINITY != SWR_THREAD_AFFINITY_DEFAULT)
+    {
+        if (pContext->threadInfo.AFFINITY == SWR_THREAD_AFFINITY_NO_SMT)
+        {
+            numHyperThreads = 1;
+        }
+
+        numThreads = numNodes * numCoresPerNode * numHyperThreads;
+        if (pContext->threadInfo.MAX_WORKER_THREADS)
+        {
+            numThreads = std::min(pContext->threadInfo.MAX_WORKER_THREADS, numThreads);
+        }
+        numAPIReservedThreads = 0;
+    }
     else if (pContext->threadInfo.MAX_WORKER_THREADS)
     {
         numThreads = std::min(pContext->threadInfo.MAX_WORKER_THREADS, numHWThreads);
@@ -1243,7 +1269,59 @@ void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
     pPool->pThreads = new (std::nothrow) THREAD_PTR[pPool->numThreads];
     assert(pPool->pThreads);
 
-    if (pContext->threadInfo.MAX_WORKER_THREADS)
+    if (pContext->threadInfo.AFFINITY != SWR_THREAD_AFFINITY_DEFAULT)
+    {
+        // PACK and NO_SMT fill each core, then each node.  SPREAD takes a core
+        // from each node in turn, and only then second hyper-threads.
+        bool     spread        = pContext->threadInfo.AFFINITY == SWR_THREAD_AFFINITY_SPREAD;
+        uint32_t threadsOnNode = numCoresPerNode * numHyperThreads;
+        uint32_t nodesUsed =
+            spread ? std::min(numNodes, numThreads)
+                   : (numThreads + threadsOnNode - 1) / threadsOnNode;
+
+        // Tiles are split between NUMA nodes only when all of a power of two
+        // number of nodes have workers.
+        bool useNuma    = nodesUsed > 1 && IsPow2(nodesUsed);
+        pPool->numaMask = useNuma ? nodesUsed - 1 : 0;
+
+        for (uint32_t workerId = 0; workerId < numThreads; ++workerId)
+        {
+            uint32_t n, c, t;
+            if (spread)
+            {
+                n = workerId % nodesUsed;
+                c = (workerId / nodesUsed) % numCoresPerNode;
+                t = workerId / (nodesUsed * numCoresPerNode);
+            }
+            else
+            {
+                t = workerId % numHyperThreads;
+                c = (workerId / numHyperThreads) % numCoresPerNode;
+                n = workerId / (numHyperThreads * numCoresPerNode);
+            }
+            n += pContext->threadInfo.BASE_NUMA_NODE;
+            c += pContext->threadInfo.BASE_CORE;
+            t += pContext->threadInfo.BASE_THREAD;
+
+            SWR_ASSERT(n < nodes.size() && c < nodes[n].cores.size() &&
+                       t < nodes[n].cores[c].threadIds.size());
+            auto& core = nodes[n].cores[c];
+
+            pPool->pThreadData[workerId].workerId           = workerId;
+            pPool->pThreadData[workerId].procGroupId        = core.procGroup;
+            pPool->pThreadData[workerId].threadId           = core.threadIds[t];
+            pPool->pThreadData[workerId].numaId =
+                useNuma ? n : pContext->threadInfo.BASE_NUMA_NODE;
+            pPool->pThreadData[workerId].coreId             = c;
+            pPool->pThreadData[workerId].htId               = t;
+            pPool->pThreadData[workerId].pContext           = pContext;
+            pPool->pThreadData[workerId].forceBindProcGroup = false;
+
+            pContext->NumBEThreads++;
+            pContext->NumFEThreads++;
+        }
+    }
+    else if (pContext->threadInfo.MAX_WORKER_THREADS)
     {
         bool     bForceBindProcGroup = (numThreads > numThreadsPerProcGroup);
         uint32_t numProcGroups = (numThreads + numThreadsPerProcGroup - 1) / numThreadsPerProcGroup;
@@ -1390,7 +1468,8 @@ void StartThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
 /// @brief Destroys thread pool.
 /// @param pContext - pointer to context
 /// @param pPool - pointer to thread pool object.
-void DestroyThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
+/// @param join - wait for the threads to exit, so the context can get new ones.
+void DestroyThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool, bool join)
 {
     // Wait for all threads to finish
     SwrWaitForIdle(pContext);
@@ -1402,7 +1481,15 @@ void DestroyThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
         {
             // Detach from thread.  Cannot join() due to possibility (in Windows) of code
             // in some DLLMain(THREAD_DETATCH case) blocking the thread until after this returns.
-            pPool->pThreads[t]->detach();
+            // That can't happen when the context lives on.
+            if (join)
+            {
+                pPool->pThreads[t]->join();
+            }
+            else
+            {
+                pPool->pThreads[t]->detach();
+            }
             delete (pPool->pThreads[t]);
         }
 
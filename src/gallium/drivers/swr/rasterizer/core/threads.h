@@ -66,7 +66,7 @@ struct TileSet;
 
 void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool);
 void StartThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool);
-void DestroyThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool);
+void DestroyThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool, bool join = false);
 
 // Expose FE and BE worker functions to the API thread if single threaded
 void    WorkOnFifoFE(SWR_CONTEXT* pContext, uint32_t workerId, uint32_t& curDrawFE);
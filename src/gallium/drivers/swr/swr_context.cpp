@@ -28,6 +28,7 @@
 #include "swr_scratch.h"
 #include "swr_query.h"
 #include "swr_fence.h"
+#include "swr_public.h"
 
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
@@ -443,6 +444,13 @@ swr_UpdateStats(HANDLE hPrivateContext, const SWR_STATS *pStats)
    pSwrStats->DepthPassCount += pStats->DepthPassCount;
    pSwrStats->PsInvocations += pStats->PsInvocations;
    pSwrStats->CsInvocations += pStats->CsInvocations;
+   pSwrStats->EarlyZPassCount += pStats->EarlyZPassCount;
+   pSwrStats->EarlyZFailCount += pStats->EarlyZFailCount;
+   pSwrStats->LateZPassCount += pStats->LateZPassCount;
+   pSwrStats->LateZFailCount += pStats->LateZFailCount;
+   pSwrStats->BackfaceCullCount += pStats->BackfaceCullCount;
+   pSwrStats->DegenerateCullCount += pStats->DegenerateCullCount;
+   pSwrStats->RasterTiles += pStats->RasterTiles;
 }
 
 static void
@@ -485,6 +493,44 @@ swr_UpdateStreamOut(HANDLE hPrivateContext, uint64_t numPrims)
    if (pDC->soPrims)
        *pDC->soPrims += numPrims;
 }
+static void
+swr_init_threading_info(struct swr_screen *screen, SWR_THREADING_INFO &info)
+{
+   info.MAX_WORKER_THREADS        = KNOB_MAX_WORKER_THREADS;
+   info.MAX_NUMA_NODES            = KNOB_MAX_NUMA_NODES;
+   info.MAX_CORES_PER_NUMA_NODE   = KNOB_MAX_CORES_PER_NUMA_NODE;
+   info.MAX_THREADS_PER_CORE      = KNOB_MAX_THREADS_PER_CORE;
+   info.SINGLE_THREADED           = KNOB_SINGLE_THREADED;
+   info.AFFINITY                  = (SWR_THREAD_AFFINITY)KNOB_THREAD_AFFINITY;
+
+   // Use non-standard settings for KNL
+   if (screen->is_knl && nullptr == getenv("KNOB_MAX_THREADS_PER_CORE"))
+      info.MAX_THREADS_PER_CORE  = 2;
+}
+
+/*
+ * Rebuild the rasterizer worker pool with at most max_threads workers
+ * (0 = one per available HW thread) bound according to affinity, one of
+ * SWR_THREAD_AFFINITY.  Waits for all outstanding work first.
+ */
+void
+swr_set_threading(struct pipe_context *pipe,
+                  unsigned max_threads,
+                  unsigned affinity)
+{
+   struct swr_context *ctx = swr_context(pipe);
+   struct swr_screen *screen = swr_screen(pipe->screen);
+
+   SWR_THREADING_INFO threadingInfo {0};
+
+   swr_init_threading_info(screen, threadingInfo);
+   threadingInfo.MAX_WORKER_THREADS = max_threads;
+   threadingInfo.AFFINITY = (SWR_THREAD_AFFINITY)affinity;
+
+   swr_fence_finish(pipe->screen, NULL, screen->flush_fence, 0);
+
+   ctx->api.pfnSwrSetThreadingInfo(ctx->swrContext, &threadingInfo);
+}
 
 struct pipe_context *
 swr_create_context(struct pipe_screen *p_screen, void *priv, unsigned flags)
@@ -515,18 +561,11 @@ swr_create_context(struct pipe_screen *p_screen, void *priv, unsigned flags)
 
    SWR_THREADING_INFO threadingInfo {0};
 
-   threadingInfo.MAX_WORKER_THREADS        = KNOB_MAX_WORKER_THREADS;
-   threadingInfo.MAX_NUMA_NODES            = KNOB_MAX_NUMA_NODES;
-   threadingInfo.MAX_CORES_PER_NUMA_NODE   = KNOB_MAX_CORES_PER_NUMA_NODE;
-   threadingInfo.MAX_THREADS_PER_CORE      = KNOB_MAX_THREADS_PER_CORE;
-   threadingInfo.SINGLE_THREADED           = KNOB_SINGLE_THREADED;
+   swr_init_threading_info(swr_screen(p_screen), threadingInfo);
 
    // Use non-standard settings for KNL
    if (swr_screen(p_screen)->is_knl)
    {
-      if (nullptr == getenv("KNOB_MAX_THREADS_PER_CORE"))
-         threadingInfo.MAX_THREADS_PER_CORE  = 2;
-
       if (nullptr == getenv("KNOB_MAX_DRAWS_IN_FLIGHT"))
       {
          ctx->max_draws_in_flight = 2048;
@@ -24,6 +24,7 @@
 #ifndef SWR_PUBLIC_H
 #define SWR_PUBLIC_H
 
+struct pipe_context;
 struct pipe_screen;
 struct sw_displaytarget;
 struct sw_winsys;
@@ -42,6 +43,11 @@ struct pipe_screen *swr_create_screen_internal(struct sw_winsys *winsys);
 // cleanup for failed screen creation
 void swr_destroy_screen_internal(struct swr_screen **screen);
 
+// resize the context's worker pool and select its thread affinity policy
+void swr_set_threading(struct pipe_context *pipe,
+                       unsigned max_threads,
+                       unsigned affinity);
+
 #ifdef _WIN32
 void swr_gdi_swap(struct pipe_screen *screen,
                   struct pipe_resource *res,
@@ -42,7 +42,8 @@ swr_create_query(struct pipe_context *pipe, unsigned type, unsigned index)
 {
    struct swr_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= PIPE_QUERY_DRIVER_SPECIFIC && type < SWR_QUERY_LAST));
    assert(index < MAX_SO_STREAMS);
 
    pq = (struct swr_query *) AlignedMalloc(sizeof(struct swr_query), 64);
@@ -114,6 +115,28 @@ swr_get_query_result(struct pipe_context *pipe,
    case PIPE_QUERY_PRIMITIVES_EMITTED:
       result->u64 = pq->result.coreFE.SoNumPrimsWritten[index];
       break;
+   /* ArchRast counters */
+   case SWR_QUERY_EARLY_Z_PASSED:
+      result->u64 = pq->result.core.EarlyZPassCount;
+      break;
+   case SWR_QUERY_EARLY_Z_FAILED:
+      result->u64 = pq->result.core.EarlyZFailCount;
+      break;
+   case SWR_QUERY_LATE_Z_PASSED:
+      result->u64 = pq->result.core.LateZPassCount;
+      break;
+   case SWR_QUERY_LATE_Z_FAILED:
+      result->u64 = pq->result.core.LateZFailCount;
+      break;
+   case SWR_QUERY_BACKFACE_CULLED:
+      result->u64 = pq->result.core.BackfaceCullCount;
+      break;
+   case SWR_QUERY_DEGENERATE_CULLED:
+      result->u64 = pq->result.core.DegenerateCullCount;
+      break;
+   case SWR_QUERY_RASTER_TILES:
+      result->u64 = pq->result.core.RasterTiles;
+      break;
    /* Structures */
    case PIPE_QUERY_SO_STATISTICS: {
       struct pipe_query_data_so_statistics *so_stats = &result->so_statistics;
@@ -251,6 +274,64 @@ swr_check_render_cond(struct pipe_context *pipe)
 }
 
 
+static const char *swr_query_names[] = {
+   "early-z-passed",
+   "early-z-failed",
+   "late-z-passed",
+   "late-z-failed",
+   "backface-culled",
+   "degenerate-culled",
+   "raster-tiles",
+};
+
+/* The counters only exist in rasterizers built with ArchRast. */
+int
+swr_get_driver_query_info(struct pipe_screen *screen,
+                          unsigned index,
+                          struct pipe_driver_query_info *info)
+{
+   STATIC_ASSERT(ARRAY_SIZE(swr_query_names) ==
+                 SWR_QUERY_LAST - PIPE_QUERY_DRIVER_SPECIFIC);
+#ifdef KNOB_ENABLE_AR
+   if (!info)
+      return ARRAY_SIZE(swr_query_names);
+
+   if (index >= ARRAY_SIZE(swr_query_names))
+      return 0;
+
+   info->name = swr_query_names[index];
+   info->query_type = PIPE_QUERY_DRIVER_SPECIFIC + index;
+   info->type = PIPE_DRIVER_QUERY_TYPE_UINT64;
+   info->result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE;
+   info->group_id = 0;
+   info->flags = 0;
+   return 1;
+#else
+   return 0;
+#endif
+}
+
+int
+swr_get_driver_query_group_info(struct pipe_screen *screen,
+                                unsigned index,
+                                struct pipe_driver_query_group_info *info)
+{
+#ifdef KNOB_ENABLE_AR
+   if (!info)
+      return 1;
+
+   if (index > 0)
+      return 0;
+
+   info->name = "ArchRast";
+   info->max_active_queries = ARRAY_SIZE(swr_query_names);
+   info->num_queries = ARRAY_SIZE(swr_query_names);
+   return 1;
+#else
+   return 0;
+#endif
+}
+
 static void
 swr_set_active_query_state(struct pipe_context *pipe, bool enable)
 {
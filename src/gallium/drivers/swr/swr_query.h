@@ -27,6 +27,18 @@
 
 #include <limits.h>
 
+/* Driver specific queries, backed by ArchRast counters */
+enum swr_query_type {
+   SWR_QUERY_EARLY_Z_PASSED = PIPE_QUERY_DRIVER_SPECIFIC,
+   SWR_QUERY_EARLY_Z_FAILED,
+   SWR_QUERY_LATE_Z_PASSED,
+   SWR_QUERY_LATE_Z_FAILED,
+   SWR_QUERY_BACKFACE_CULLED,
+   SWR_QUERY_DEGENERATE_CULLED,
+   SWR_QUERY_RASTER_TILES,
+   SWR_QUERY_LAST
+};
+
 struct swr_query_result {
    SWR_STATS core;
    SWR_STATS_FE coreFE;
@@ -44,5 +56,13 @@ OSALIGNLINE(struct) swr_query {
 
 extern void swr_query_init(struct pipe_context *pipe);
 
+extern int swr_get_driver_query_info(struct pipe_screen *screen,
+                                     unsigned index,
+                                     struct pipe_driver_query_info *info);
+
+extern int swr_get_driver_query_group_info(struct pipe_screen *screen,
+                                           unsigned index,
+                                           struct pipe_driver_query_group_info *info);
+
 extern bool swr_check_render_cond(struct pipe_context *pipe);
 #endif
@@ -428,6 +428,12 @@ struct v3d_job {
          */
         uint32_t tf_draw_calls_queued;
 
+        /**
+         * Estimate of the number of primitives binned by the job, used to
+         * size the tile alloc memory of the next job for this FBO.
+         */
+        uint64_t binned_prims;
+
         struct v3d_job_key key;
 };
 
@@ -652,6 +658,7 @@ void v3d_job_add_bo(struct v3d_job *job, struct v3d_bo *bo);
 void v3d_job_add_write_resource(struct v3d_job *job, struct pipe_resource *prsc);
 void v3d_job_add_tf_write_resource(struct v3d_job *job, struct pipe_resource *prsc);
 void v3d_job_submit(struct v3d_context *v3d, struct v3d_job *job);
+uint32_t v3d_job_get_tile_alloc_hint(struct v3d_job *job);
 void v3d_flush_jobs_using_bo(struct v3d_context *v3d, struct v3d_bo *bo);
 void v3d_flush_jobs_writing_resource(struct v3d_context *v3d,
                                      struct pipe_resource *prsc,
@@ -485,6 +485,63 @@ v3d_read_and_accumulate_primitive_counters(struct v3d_context *v3d)
         }
 }
 
+/* Rough tile alloc cost of binning one primitive, including its share of
+ * the state packets, assuming it lands in a couple of tiles.
+ */
+#define V3D_TILE_ALLOC_BYTES_PER_PRIM 16
+#define V3D_TILE_ALLOC_MIN_EXTRA (512 * 1024)
+#define V3D_TILE_ALLOC_MAX_EXTRA (32 * 1024 * 1024)
+
+static struct v3d_resource *
+v3d_job_get_fbo_resource(struct v3d_job *job)
+{
+        for (int i = 0; i < ARRAY_SIZE(job->cbufs); i++) {
+                if (job->cbufs[i])
+                        return v3d_resource(job->cbufs[i]->texture);
+        }
+
+        if (job->zsbuf)
+                return v3d_resource(job->zsbuf->texture);
+
+        return NULL;
+}
+
+/**
+ * Returns how much tile alloc memory to allocate for the job on top of the
+ * PTB's initial allocations, based on what the previous job rendering to the
+ * same FBO used.
+ */
+uint32_t
+v3d_job_get_tile_alloc_hint(struct v3d_job *job)
+{
+        struct v3d_resource *rsc = v3d_job_get_fbo_resource(job);
+
+        if (!rsc)
+                return V3D_TILE_ALLOC_MIN_EXTRA;
+
+        return MAX2(rsc->tile_alloc_hint, V3D_TILE_ALLOC_MIN_EXTRA);
+}
+
+/* Records the job's binning memory needs for the next job on this FBO.  The
+ * hint decays slowly so that a single light frame doesn't send us back to
+ * overflowing on the next heavy one.
+ */
+static void
+v3d_job_update_tile_alloc_hint(struct v3d_job *job)
+{
+        struct v3d_resource *rsc = v3d_job_get_fbo_resource(job);
+
+        if (!rsc)
+                return;
+
+        uint64_t needed = MIN2(job->binned_prims *
+                               V3D_TILE_ALLOC_BYTES_PER_PRIM,
+                               V3D_TILE_ALLOC_MAX_EXTRA);
+
+        uint32_t decayed = rsc->tile_alloc_hint - rsc->tile_alloc_hint / 4;
+        rsc->tile_alloc_hint = align(MAX2(needed, decayed), 4096);
+}
+
 /**
  * Submits the job to the kernel and then reinitializes it.
  */
@@ -496,6 +553,9 @@ v3d_job_submit(struct v3d_context *v3d, struct v3d_job *job)
         if (!job->needs_flush)
                 goto done;
 
+        if (job->draw_calls_queued)
+                v3d_job_update_tile_alloc_hint(job);
+
         if (screen->devinfo.ver >= 41)
                 v3d41_emit_rcl(job);
         else
@@ -153,6 +153,14 @@ struct v3d_resource {
          */
         uint32_t initialized_buffers;
 
+        /**
+         * Extra tile alloc memory beyond the PTB's initial allocations that
+         * the last job rendering to this resource is estimated to have
+         * needed, so the next job can be binned without going through the
+         * kernel's binner overflow handling.
+         */
+        uint32_t tile_alloc_hint;
+
         enum pipe_format internal_format;
 
         /* Resource storing the S8 part of a Z32F_S8 resource, or NULL. */
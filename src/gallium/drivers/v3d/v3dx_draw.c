@@ -74,9 +74,10 @@ v3d_start_draw(struct v3d_context *v3d)
 
         /* For performance, allocate some extra initial memory after the PTB's
          * minimal allocations, so that we hopefully don't have to block the
-         * GPU on the kernel handling an OOM signal.
+         * GPU on the kernel handling an OOM signal.  How much is based on
+         * what the last job rendering to this FBO binned.
          */
-        tile_alloc_size += 512 * 1024;
+        tile_alloc_size += v3d_job_get_tile_alloc_hint(job);
 
         job->tile_alloc = v3d_bo_alloc(v3d->screen, tile_alloc_size,
                                        "tile_alloc");
@@ -1380,6 +1381,13 @@ v3d_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
         if (v3d->streamout.num_targets)
            job->tf_draw_calls_queued++;
 
+        /* Indirect and TF draws have no CPU-side count and don't contribute
+         * to the estimate.
+         */
+        job->binned_prims += (uint64_t)u_prims_for_vertices(info->mode,
+                                                            info->count) *
+                             MAX2(info->instance_count, 1);
+
         /* Increment the TF offsets by how many verts we wrote.  XXX: This
          * needs some clamping to the buffer size.
          */
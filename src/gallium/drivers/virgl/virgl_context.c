@@ -630,6 +630,34 @@ static void virgl_hw_set_index_buffer(struct virgl_context *vctx,
    virgl_attach_res_index_buffer(vctx, ib);
 }
 
+/* Returns true if the user constants for index 0 are the ones the host
+ * already has, and otherwise remembers them as the last ones sent.
+ */
+static bool
+virgl_const0_unchanged(struct virgl_shader_binding_state *binding,
+                       unsigned size, const void *data)
+{
+   if (binding->const0_valid && binding->const0_size == size &&
+       !memcmp(binding->const0_data, data, size))
+      return true;
+
+   if (size > binding->const0_alloc) {
+      void *new_data = REALLOC(binding->const0_data,
+                               binding->const0_alloc, size);
+      if (!new_data) {
+         binding->const0_valid = false;
+         return false;
+      }
+      binding->const0_data = new_data;
+      binding->const0_alloc = size;
+   }
+
+   memcpy(binding->const0_data, data, size);
+   binding->const0_size = size;
+   binding->const0_valid = true;
+   return false;
+}
+
 static void virgl_set_constant_buffer(struct pipe_context *ctx,
                                      enum pipe_shader_type shader, uint index,
                                      const struct pipe_constant_buffer *buf)
@@ -649,10 +677,22 @@ static void virgl_set_constant_buffer(struct pipe_context *ctx,
       pipe_resource_reference(&binding->ubos[index].buffer, buf->buffer);
       binding->ubos[index] = *buf;
       binding->ubo_enabled_mask |= 1 << index;
+
+      if (index == 0)
+         binding->const0_valid = false;
    } else {
       static const struct pipe_constant_buffer dummy_ubo;
       if (!buf)
          buf = &dummy_ubo;
+
+      if (index == 0) {
+         if (!buf->user_buffer)
+            binding->const0_valid = false;
+         else if (virgl_const0_unchanged(binding, buf->buffer_size,
+                                         buf->user_buffer))
+            return;
+      }
+
       virgl_encoder_write_constant_buffer(vctx, shader, index,
                                           buf->buffer_size / 4,
                                           buf->user_buffer);
@@ -941,6 +981,7 @@ static void virgl_flush_eq(struct virgl_context *ctx, void *closure,
     * involving staging resources.
     */
    ctx->queued_staging_res_size = 0;
+   ctx->last_copy_transfer.dst = NULL;
 }
 
 static void virgl_flush_from_st(struct pipe_context *ctx,
@@ -1371,6 +1412,8 @@ virgl_release_shader_binding(struct virgl_context *vctx,
       int i = u_bit_scan(&binding->image_enabled_mask);
       pipe_resource_reference(&binding->images[i].resource, NULL);
    }
+
+   FREE(binding->const0_data);
 }
 
 static void
@@ -59,6 +59,15 @@ struct virgl_shader_binding_state {
    struct pipe_constant_buffer ubos[PIPE_MAX_CONSTANT_BUFFERS];
    uint32_t ubo_enabled_mask;
 
+   /* The user constants last sent inline for index 0.  Apps often upload
+    * the same uniforms for every draw, and the host keeps them across draws,
+    * so identical updates are skipped.
+    */
+   void *const0_data;
+   unsigned const0_size;
+   unsigned const0_alloc;
+   bool const0_valid;
+
    struct pipe_shader_buffer ssbos[PIPE_MAX_SHADER_BUFFERS];
    uint32_t ssbo_enabled_mask;
 
@@ -101,6 +110,19 @@ struct virgl_context {
 
    /* The total size of staging resources used in queued copy transfers. */
    uint64_t queued_staging_res_size;
+
+   /* The last buffer copy transfer encoded in cbuf.  A copy continuing it in
+    * both the staging and the destination buffer is merged into it, as long
+    * as nothing else was encoded in between.  dst is NULL if there is none.
+    */
+   struct {
+      struct virgl_hw_res *dst;
+      struct virgl_hw_res *src;
+      unsigned dst_end;
+      unsigned src_end;
+      unsigned cmd_cdw;
+      unsigned end_cdw;
+   } last_copy_transfer;
 };
 
 static inline struct virgl_sampler_view *
@@ -1437,16 +1437,59 @@ void virgl_encode_transfer(struct virgl_screen *vs, struct virgl_cmd_buf *buf,
    virgl_encoder_write_dword(buf, direction);
 }
 
+/* Streaming uploads tend to be a run of buffer copies that are contiguous in
+ * both the staging buffer and the destination, so extend the previous
+ * COPY_TRANSFER3D instead of emitting a new one when we can.
+ */
+static bool virgl_merge_copy_transfer(struct virgl_context *ctx,
+                                      struct virgl_transfer *trans)
+{
+   const struct pipe_box *box = &trans->base.box;
+   uint32_t *cmd;
+   unsigned width;
+
+   if (!ctx->last_copy_transfer.dst ||
+       ctx->last_copy_transfer.end_cdw != ctx->cbuf->cdw ||
+       ctx->last_copy_transfer.dst != trans->hw_res ||
+       ctx->last_copy_transfer.src != trans->copy_src_hw_res ||
+       ctx->last_copy_transfer.dst_end != box->x ||
+       ctx->last_copy_transfer.src_end != trans->copy_src_offset)
+      return false;
+
+   cmd = &ctx->cbuf->buf[ctx->last_copy_transfer.cmd_cdw];
+   width = cmd[VIRGL_RESOURCE_IW_W] + box->width;
+   cmd[VIRGL_RESOURCE_IW_W] = width;
+   cmd[VIRGL_RESOURCE_IW_STRIDE] = width;
+   cmd[VIRGL_RESOURCE_IW_LAYER_STRIDE] = width;
+
+   ctx->last_copy_transfer.dst_end += box->width;
+   ctx->last_copy_transfer.src_end += box->width;
+   return true;
+}
+
 void virgl_encode_copy_transfer(struct virgl_context *ctx,
                                 struct virgl_transfer *trans)
 {
    uint32_t command;
    struct virgl_screen *vs = virgl_screen(ctx->base.screen);
+   const struct pipe_box *box = &trans->base.box;
+   bool mergeable;
 
    assert(trans->copy_src_hw_res);
 
+   /* Only plain buffer copies, where the staging data is laid out exactly
+    * like the destination range, can be merged.
+    */
+   mergeable = trans->base.resource->target == PIPE_BUFFER &&
+               trans->base.stride == box->width;
+
+   if (mergeable && virgl_merge_copy_transfer(ctx, trans))
+      return;
+
    command = VIRGL_CMD0(VIRGL_CCMD_COPY_TRANSFER3D, 0, VIRGL_COPY_TRANSFER3D_SIZE);
    virgl_encoder_write_cmd_dword(ctx, command);
+   ctx->last_copy_transfer.cmd_cdw = ctx->cbuf->cdw - 1;
+
    /* Copy transfers need to explicitly specify the stride, since it may differ
     * from the image stride.
     */
@@ -1455,6 +1498,16 @@ void virgl_encode_copy_transfer(struct virgl_context *ctx,
    virgl_encoder_write_dword(ctx->cbuf, trans->copy_src_offset);
    /* At the moment all copy transfers are synchronized. */
    virgl_encoder_write_dword(ctx->cbuf, 1);
+
+   if (mergeable) {
+      ctx->last_copy_transfer.dst = trans->hw_res;
+      ctx->last_copy_transfer.src = trans->copy_src_hw_res;
+      ctx->last_copy_transfer.dst_end = box->x + box->width;
+      ctx->last_copy_transfer.src_end = trans->copy_src_offset + box->width;
+      ctx->last_copy_transfer.end_cdw = ctx->cbuf->cdw;
+   } else {
+      ctx->last_copy_transfer.dst = NULL;
+   }
 }
 
 void virgl_encode_end_transfers(struct virgl_cmd_buf *buf)
@@ -36,6 +36,10 @@ struct virgl_query {
 
    bool ready;
    uint64_t result;
+
+   /* Driver queries are answered by the guest and have no host object. */
+   unsigned type;
+   uint64_t begin;
 };
 
 #define VIRGL_QUERY_OCCLUSION_COUNTER     0
@@ -79,6 +83,25 @@ static inline struct virgl_query *virgl_query(struct pipe_query *q)
    return (struct virgl_query *)q;
 }
 
+static uint64_t virgl_driver_query_value(struct virgl_screen *vs,
+                                         unsigned type)
+{
+   struct virgl_resource_cache_stats stats;
+
+   vs->vws->get_resource_cache_stats(vs->vws, &stats);
+
+   switch (type) {
+   case VIRGL_QUERY_RESOURCE_CACHE_HITS:
+      return stats.hits;
+   case VIRGL_QUERY_RESOURCE_CACHE_MISSES:
+      return stats.misses;
+   case VIRGL_QUERY_RESOURCE_CACHE_EVICTIONS:
+      return stats.evictions;
+   default:
+      unreachable("invalid virgl driver query");
+   }
+}
+
 static void virgl_render_condition(struct pipe_context *ctx,
                                   struct pipe_query *q,
                                   bool condition,
@@ -102,6 +125,10 @@ static struct pipe_query *virgl_create_query(struct pipe_context *ctx,
    if (!query)
       return NULL;
 
+   query->type = query_type;
+   if (query_type >= PIPE_QUERY_DRIVER_SPECIFIC)
+      return (struct pipe_query *)query;
+
    query->buf = (struct virgl_resource *)
       pipe_buffer_create(ctx->screen, PIPE_BIND_CUSTOM, PIPE_USAGE_STAGING,
                          sizeof(struct virgl_host_query_state));
@@ -130,9 +157,10 @@ static void virgl_destroy_query(struct pipe_context *ctx,
    struct virgl_context *vctx = virgl_context(ctx);
    struct virgl_query *query = virgl_query(q);
 
-   virgl_encode_delete_object(vctx, query->handle, VIRGL_OBJECT_QUERY);
-
-   pipe_resource_reference((struct pipe_resource **)&query->buf, NULL);
+   if (query->buf) {
+      virgl_encode_delete_object(vctx, query->handle, VIRGL_OBJECT_QUERY);
+      pipe_resource_reference((struct pipe_resource **)&query->buf, NULL);
+   }
    FREE(query);
 }
 
@@ -142,6 +170,13 @@ static bool virgl_begin_query(struct pipe_context *ctx,
    struct virgl_context *vctx = virgl_context(ctx);
    struct virgl_query *query = virgl_query(q);
 
+   if (!query->buf) {
+      query->begin = virgl_driver_query_value(virgl_screen(ctx->screen),
+                                              query->type);
+      query->ready = false;
+      return true;
+   }
+
    virgl_encoder_begin_query(vctx, query->handle);
 
    return true;
@@ -155,6 +190,12 @@ static bool virgl_end_query(struct pipe_context *ctx,
    struct virgl_query *query = virgl_query(q);
    struct virgl_host_query_state *host_state;
 
+   if (!query->buf) {
+      query->result = virgl_driver_query_value(vs, query->type) - query->begin;
+      query->ready = true;
+      return true;
+   }
+
    host_state = vs->vws->resource_map(vs->vws, query->buf->hw_res);
    if (!host_state)
       return false;
@@ -247,6 +288,10 @@ virgl_get_query_result_resource(struct pipe_context *ctx,
    struct virgl_query *query = virgl_query(q);
    struct virgl_resource *qbo = (struct virgl_resource *)resource;
 
+   /* Driver queries aren't exposed as GL query objects. */
+   if (!query->buf)
+      return;
+
    virgl_encode_get_query_result_qbo(vctx, query->handle, qbo, wait, result_type, offset, index);
 }
 
@@ -272,6 +272,7 @@ virgl_staging_map(struct virgl_context *vctx,
    struct virgl_resource *vres = virgl_resource(vtransfer->base.resource);
    unsigned size;
    unsigned align_offset;
+   unsigned alignment;
    unsigned stride;
    unsigned layer_stride;
    void *map_addr;
@@ -297,10 +298,22 @@ virgl_staging_map(struct virgl_context *vctx,
    align_offset = vres->u.b.target == PIPE_BUFFER ?
                   vtransfer->base.box.x % VIRGL_MAP_BUFFER_ALIGNMENT :
                   0;
+   alignment = VIRGL_MAP_BUFFER_ALIGNMENT;
+
+   /* If the end of the last allocation already has the alignment we need,
+    * e.g. because the last transfer ended where this one starts, allocate
+    * right after it so that the two copy transfers can be merged.
+    */
+   if (align_offset &&
+       vctx->staging.offset % VIRGL_MAP_BUFFER_ALIGNMENT == align_offset &&
+       vctx->staging.offset + size <= vctx->staging.size) {
+      align_offset = 0;
+      alignment = 1;
+   }
 
    alloc_succeeded =
       virgl_staging_alloc(&vctx->staging, size + align_offset,
-                          VIRGL_MAP_BUFFER_ALIGNMENT,
+                          alignment,
                           &vtransfer->copy_src_offset,
                           &vtransfer->copy_src_hw_res,
                           &map_addr);
@@ -790,6 +790,27 @@ virgl_get_timestamp(struct pipe_screen *_screen)
    return os_time_get_nano();
 }
 
+static int
+virgl_get_driver_query_info(struct pipe_screen *screen,
+                            unsigned index,
+                            struct pipe_driver_query_info *info)
+{
+   static const struct pipe_driver_query_info list[] = {
+      {"resource-cache-hits", VIRGL_QUERY_RESOURCE_CACHE_HITS, {0}},
+      {"resource-cache-misses", VIRGL_QUERY_RESOURCE_CACHE_MISSES, {0}},
+      {"resource-cache-evictions", VIRGL_QUERY_RESOURCE_CACHE_EVICTIONS, {0}},
+   };
+
+   if (!info)
+      return ARRAY_SIZE(list);
+
+   if (index >= ARRAY_SIZE(list))
+      return 0;
+
+   *info = list[index];
+   return 1;
+}
+
 static void
 virgl_destroy_screen(struct pipe_screen *screen)
 {
@@ -861,6 +882,8 @@ virgl_create_screen(struct virgl_winsys *vws, const struct pipe_screen_config *c
    //screen->base.fence_signalled = virgl_fence_signalled;
    screen->base.fence_finish = virgl_fence_finish;
    screen->base.fence_get_fd = virgl_fence_get_fd;
+   if (vws->get_resource_cache_stats)
+      screen->base.get_driver_query_info = virgl_get_driver_query_info;
 
    virgl_init_screen_resource_functions(&screen->base);
 
@@ -75,4 +75,9 @@ virgl_has_readback_format(struct pipe_screen *screen, enum virgl_formats fmt);
  */
 #define VIRGL_MAP_BUFFER_ALIGNMENT 64
 
+/* Driver queries on the winsys resource cache, counted on the guest side. */
+#define VIRGL_QUERY_RESOURCE_CACHE_HITS      (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define VIRGL_QUERY_RESOURCE_CACHE_MISSES    (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+#define VIRGL_QUERY_RESOURCE_CACHE_EVICTIONS (PIPE_QUERY_DRIVER_SPECIFIC + 2)
+
 #endif
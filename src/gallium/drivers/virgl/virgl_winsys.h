@@ -24,6 +24,7 @@
 #define VIRGL_WINSYS_H
 
 #include "pipe/p_defines.h"
+#include "pipe/p_format.h"
 #include "virgl_hw.h"
 
 struct pipe_box;
@@ -43,6 +44,12 @@ struct virgl_cmd_buf {
    uint32_t *buf;
 };
 
+struct virgl_resource_cache_stats {
+   uint64_t hits;       /* Resources reused from the cache */
+   uint64_t misses;     /* Cacheable resources created on the host */
+   uint64_t evictions;  /* Resources released by timeout or over budget */
+};
+
 struct virgl_winsys {
    unsigned pci_id;
    int supports_fences; /* In/Out fences are supported */
@@ -125,6 +132,9 @@ struct virgl_winsys {
 
    int (*fence_get_fd)(struct virgl_winsys *vws,
                        struct pipe_fence_handle *fence);
+
+   void (*get_resource_cache_stats)(struct virgl_winsys *vws,
+                                    struct virgl_resource_cache_stats *stats);
 };
 
 /* this defaults all newer caps,
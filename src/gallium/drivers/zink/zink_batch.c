@@ -8,8 +8,22 @@
 #include "zink_resource.h"
 #include "zink_screen.h"
 
+#include "util/hash_table.h"
 #include "util/u_debug.h"
 #include "util/set.h"
+#include "util/xxhash.h"
+
+struct zink_descriptor_set_entry {
+   struct zink_descriptor_set_key key;
+   VkDescriptorSet desc_set;
+   /* followed by the buffer and image infos the key points at */
+};
+
+static void
+free_descriptor_set_entry(struct hash_entry *entry)
+{
+   free(entry->data);
+}
 
 static void
 reset_batch(struct zink_context *ctx, struct zink_batch *batch)
@@ -46,6 +60,7 @@ reset_batch(struct zink_context *ctx, struct zink_batch *batch)
    }
    util_dynarray_clear(&batch->zombie_samplers);
 
+   _mesa_hash_table_clear(batch->desc_sets, free_descriptor_set_entry);
    if (vkResetDescriptorPool(screen->dev, batch->descpool, 0) != VK_SUCCESS)
       fprintf(stderr, "vkResetDescriptorPool failed\n");
 }
@@ -118,3 +133,99 @@ zink_batch_reference_sampler_view(struct zink_batch *batch,
       pipe_reference(NULL, &sv->base.reference);
    }
 }
+
+static uint32_t
+hash_descriptor_set_key(const void *key)
+{
+   const struct zink_descriptor_set_key *k = key;
+   uint32_t hash = XXH32(&k->prog, sizeof(k->prog), 0);
+   hash = XXH32(k->buffer_infos,
+                k->num_buffer_infos * sizeof(VkDescriptorBufferInfo), hash);
+   return XXH32(k->image_infos,
+                k->num_image_infos * sizeof(VkDescriptorImageInfo), hash);
+}
+
+static bool
+equals_descriptor_set_key(const void *a, const void *b)
+{
+   const struct zink_descriptor_set_key *ka = a, *kb = b;
+   return ka->prog == kb->prog &&
+          ka->num_buffer_infos == kb->num_buffer_infos &&
+          ka->num_image_infos == kb->num_image_infos &&
+          !memcmp(ka->buffer_infos, kb->buffer_infos,
+                  ka->num_buffer_infos * sizeof(VkDescriptorBufferInfo)) &&
+          !memcmp(ka->image_infos, kb->image_infos,
+                  ka->num_image_infos * sizeof(VkDescriptorImageInfo));
+}
+
+bool
+zink_batch_init_descriptor_cache(struct zink_batch *batch)
+{
+   batch->desc_sets = _mesa_hash_table_create(NULL, hash_descriptor_set_key,
+                                              equals_descriptor_set_key);
+   return batch->desc_sets != NULL;
+}
+
+void
+zink_batch_destroy_descriptor_cache(struct zink_batch *batch)
+{
+   _mesa_hash_table_destroy(batch->desc_sets, free_descriptor_set_entry);
+   batch->desc_sets = NULL;
+}
+
+/* Descriptor sets live until the batch's pool is reset, and everything they
+ * point at is referenced by the batch, so a draw binding the same resources
+ * as an earlier draw in the batch can reuse its set as-is.
+ */
+VkDescriptorSet
+zink_batch_find_descriptor_set(struct zink_batch *batch,
+                               const struct zink_descriptor_set_key *key)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(batch->desc_sets, key);
+   if (!entry)
+      return VK_NULL_HANDLE;
+
+   return ((struct zink_descriptor_set_entry *)entry->data)->desc_set;
+}
+
+void
+zink_batch_add_descriptor_set(struct zink_batch *batch,
+                              const struct zink_descriptor_set_key *key,
+                              VkDescriptorSet desc_set)
+{
+   size_t buffer_size = key->num_buffer_infos * sizeof(VkDescriptorBufferInfo);
+   size_t image_size = key->num_image_infos * sizeof(VkDescriptorImageInfo);
+   struct zink_descriptor_set_entry *entry =
+      malloc(sizeof(*entry) + buffer_size + image_size);
+   if (!entry)
+      return;
+
+   VkDescriptorBufferInfo *buffer_infos = (void *)(entry + 1);
+   VkDescriptorImageInfo *image_infos = (void *)((char *)buffer_infos +
+                                                 buffer_size);
+   memcpy(buffer_infos, key->buffer_infos, buffer_size);
+   memcpy(image_infos, key->image_infos, image_size);
+
+   entry->key = *key;
+   entry->key.buffer_infos = buffer_infos;
+   entry->key.image_infos = image_infos;
+   entry->desc_set = desc_set;
+
+   _mesa_hash_table_insert(batch->desc_sets, &entry->key, entry);
+}
+
+/* Called when a program is destroyed, so that a new program allocated at the
+ * same address doesn't pick up sets with the wrong layout.
+ */
+void
+zink_batch_remove_program(struct zink_batch *batch,
+                          struct zink_gfx_program *prog)
+{
+   hash_table_foreach(batch->desc_sets, entry) {
+      struct zink_descriptor_set_entry *dse = entry->data;
+      if (dse->key.prog == prog) {
+         _mesa_hash_table_remove(batch->desc_sets, entry);
+         free(dse);
+      }
+   }
+}
@@ -32,12 +32,22 @@
 struct zink_context;
 struct zink_fence;
 struct zink_framebuffer;
+struct zink_gfx_program;
 struct zink_render_pass;
 struct zink_resource;
 struct zink_sampler_view;
 
 #define ZINK_BATCH_DESC_SIZE 1000
 
+/* The contents of a descriptor set, in the binding order of the program */
+struct zink_descriptor_set_key {
+   struct zink_gfx_program *prog;
+   unsigned num_buffer_infos;
+   unsigned num_image_infos;
+   const VkDescriptorBufferInfo *buffer_infos;
+   const VkDescriptorImageInfo *image_infos;
+};
+
 struct zink_batch {
    VkCommandBuffer cmdbuf;
    VkDescriptorPool descpool;
@@ -52,6 +62,9 @@ struct zink_batch {
 
    struct util_dynarray zombie_samplers;
 
+   /* zink_descriptor_set_key -> descriptor set allocated from descpool */
+   struct hash_table *desc_sets;
+
    struct set *active_queries; /* zink_query objects which were active at some point in this batch */
 };
 
@@ -69,4 +82,23 @@ void
 zink_batch_reference_sampler_view(struct zink_batch *batch,
                                   struct zink_sampler_view *sv);
 
+bool
+zink_batch_init_descriptor_cache(struct zink_batch *batch);
+
+void
+zink_batch_destroy_descriptor_cache(struct zink_batch *batch);
+
+VkDescriptorSet
+zink_batch_find_descriptor_set(struct zink_batch *batch,
+                               const struct zink_descriptor_set_key *key);
+
+void
+zink_batch_add_descriptor_set(struct zink_batch *batch,
+                              const struct zink_descriptor_set_key *key,
+                              VkDescriptorSet desc_set);
+
+void
+zink_batch_remove_program(struct zink_batch *batch,
+                          struct zink_gfx_program *prog);
+
 #endif
@@ -36,6 +36,7 @@
 #include "tgsi/tgsi_dump.h"
 #include "tgsi/tgsi_from_mesa.h"
 
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 
 static bool
@@ -215,6 +216,43 @@ update_so_info(struct pipe_stream_output_info *so_info,
    }
 }
 
+static void
+compile_spirv_job(void *data, int thread_index)
+{
+   struct zink_shader *shader = data;
+   struct zink_screen *screen = shader->screen;
+   const struct pipe_stream_output_info *so_info =
+      shader->has_so_info ? &shader->so_info : NULL;
+
+   struct spirv_shader *spirv = nir_to_spirv(shader->nir, so_info,
+                                             so_info ? &shader->stream_output : NULL);
+   assert(spirv);
+
+   if (zink_debug & ZINK_DEBUG_SPIRV) {
+      char buf[256];
+      static int i;
+      snprintf(buf, sizeof(buf), "dump%02d.spv", p_atomic_inc_return(&i) - 1);
+      FILE *fp = fopen(buf, "wb");
+      if (fp) {
+         fwrite(spirv->words, sizeof(uint32_t), spirv->num_words, fp);
+         fclose(fp);
+         fprintf(stderr, "wrote '%s'...\n", buf);
+      }
+   }
+
+   VkShaderModuleCreateInfo smci = {};
+   smci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+   smci.codeSize = spirv->num_words * sizeof(uint32_t);
+   smci.pCode = spirv->words;
+
+   if (vkCreateShaderModule(screen->dev, &smci, NULL,
+                            &shader->shader_module) != VK_SUCCESS)
+      debug_printf("vkCreateShaderModule failed\n");
+
+   free(spirv->words);
+   free(spirv);
+}
+
 struct zink_shader *
 zink_compile_nir(struct zink_screen *screen, struct nir_shader *nir,
                  const struct pipe_stream_output_info *so_info)
@@ -283,31 +321,25 @@ zink_compile_nir(struct zink_screen *screen, struct nir_shader *nir,
       update_so_info(&ret->stream_output, nir->info.outputs_written, have_psiz);
    }
 
-   struct spirv_shader *spirv = nir_to_spirv(nir, so_info, so_info ? &ret->stream_output : NULL);
-   assert(spirv);
-
-   if (zink_debug & ZINK_DEBUG_SPIRV) {
-      char buf[256];
-      static int i;
-      snprintf(buf, sizeof(buf), "dump%02d.spv", i++);
-      FILE *fp = fopen(buf, "wb");
-      if (fp) {
-         fwrite(spirv->words, sizeof(uint32_t), spirv->num_words, fp);
-         fclose(fp);
-         fprintf(stderr, "wrote '%s'...\n", buf);
-      }
+   ret->screen = screen;
+   ret->nir = nir;
+   if (so_info) {
+      ret->has_so_info = true;
+      memcpy(&ret->so_info, so_info, sizeof(ret->so_info));
    }
 
-   VkShaderModuleCreateInfo smci = {};
-   smci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-   smci.codeSize = spirv->num_words * sizeof(uint32_t);
-   smci.pCode = spirv->words;
+   util_queue_fence_init(&ret->ready);
 
-   if (vkCreateShaderModule(screen->dev, &smci, NULL, &ret->shader_module) != VK_SUCCESS)
-      return NULL;
-
-   free(spirv->words);
-   free(spirv);
+   /* SPIR-V emission only has to be done by the time a pipeline is created
+    * with the shader, which for most apps is well after the program was
+    * linked.
+    */
+   if (util_queue_is_initialized(&screen->compile_queue)) {
+      util_queue_add_job(&screen->compile_queue, ret, &ret->ready,
+                         compile_spirv_job, NULL, 0);
+   } else {
+      compile_spirv_job(ret, 0);
+   }
 
    return ret;
 }
@@ -316,9 +348,14 @@ void
 zink_shader_free(struct zink_context *ctx, struct zink_shader *shader)
 {
    struct zink_screen *screen = zink_screen(ctx->base.screen);
+   if (util_queue_is_initialized(&screen->compile_queue))
+      util_queue_drop_job(&screen->compile_queue, &shader->ready);
+   util_queue_fence_destroy(&shader->ready);
    vkDestroyShaderModule(screen->dev, shader->shader_module, NULL);
    set_foreach(shader->programs, entry) {
       struct zink_gfx_program *prog = (void*)entry->key;
+      for (int i = 0; i < ARRAY_SIZE(ctx->batches); ++i)
+         zink_batch_remove_program(&ctx->batches[i], prog);
       _mesa_hash_table_remove_key(ctx->program_cache, prog->stages);
       zink_destroy_gfx_program(screen, prog);
    }
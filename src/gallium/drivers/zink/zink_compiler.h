@@ -28,6 +28,7 @@
 #include "pipe/p_state.h"
 
 #include "compiler/shader_info.h"
+#include "util/u_queue.h"
 
 #include <vulkan/vulkan.h>
 
@@ -52,7 +53,14 @@ struct nir_shader *
 zink_tgsi_to_nir(struct pipe_screen *screen, const struct tgsi_token *tokens);
 
 struct zink_shader {
+   /* Created on the screen's compile queue, wait for ready before use */
    VkShaderModule shader_module;
+   struct util_queue_fence ready;
+
+   struct zink_screen *screen;
+   struct nir_shader *nir;
+   bool has_so_info;
+   struct pipe_stream_output_info so_info;
 
    shader_info info;
 
@@ -74,4 +82,11 @@ zink_compile_nir(struct zink_screen *screen, struct nir_shader *nir,
 void
 zink_shader_free(struct zink_context *ctx, struct zink_shader *shader);
 
+static inline VkShaderModule
+zink_shader_get_module(struct zink_shader *shader)
+{
+   util_queue_fence_wait(&shader->ready);
+   return shader->shader_module;
+}
+
 #endif
@@ -62,6 +62,7 @@ zink_context_destroy(struct pipe_context *pctx)
       pipe_resource_reference(&ctx->null_buffers[i], NULL);
 
    for (int i = 0; i < ARRAY_SIZE(ctx->batches); ++i) {
+      zink_batch_destroy_descriptor_cache(&ctx->batches[i]);
       vkDestroyDescriptorPool(screen->dev, ctx->batches[i].descpool, NULL);
       vkFreeCommandBuffers(screen->dev, ctx->cmdpool, 1, &ctx->batches[i].cmdbuf);
    }
@@ -1219,6 +1220,9 @@ zink_context_create(struct pipe_screen *pscreen, void *priv, unsigned flags)
       if (!ctx->batches[i].resources || !ctx->batches[i].sampler_views)
          goto fail;
 
+      if (!zink_batch_init_descriptor_cache(&ctx->batches[i]))
+         goto fail;
+
       util_dynarray_init(&ctx->batches[i].zombie_samplers, NULL);
 
       if (vkCreateDescriptorPool(screen->dev, &dpci, 0,
@@ -303,6 +303,10 @@ zink_draw_vbo(struct pipe_context *pctx,
                transitions[num_transitions++] = res;
                layout = VK_IMAGE_LAYOUT_GENERAL;
             }
+            /* The infos are hashed for the descriptor set cache, so don't
+             * leave garbage in the padding.
+             */
+            memset(&image_infos[num_image_info], 0, sizeof(image_infos[0]));
             image_infos[num_image_info].imageLayout = layout;
             image_infos[num_image_info].imageView = sampler_view->image_view;
             image_infos[num_image_info].sampler = ctx->samplers[i][index];
@@ -348,9 +352,20 @@ zink_draw_vbo(struct pipe_context *pctx,
       assert(batch->descs_left >= gfx_program->num_descriptors);
    }
 
-   VkDescriptorSet desc_set = allocate_descriptor_set(screen, batch,
-                                                      gfx_program);
-   assert(desc_set != VK_NULL_HANDLE);
+   struct zink_descriptor_set_key desc_key = {
+      .prog = gfx_program,
+      .num_buffer_infos = num_buffer_info,
+      .num_image_infos = num_image_info,
+      .buffer_infos = buffer_infos,
+      .image_infos = image_infos,
+   };
+   VkDescriptorSet desc_set = zink_batch_find_descriptor_set(batch, &desc_key);
+   bool update_desc_set = desc_set == VK_NULL_HANDLE;
+   if (update_desc_set) {
+      desc_set = allocate_descriptor_set(screen, batch, gfx_program);
+      assert(desc_set != VK_NULL_HANDLE);
+      zink_batch_add_descriptor_set(batch, &desc_key, desc_set);
+   }
 
    for (int i = 0; i < ARRAY_SIZE(ctx->gfx_stages); i++) {
       struct zink_shader *shader = ctx->gfx_stages[i];
@@ -397,7 +412,7 @@ zink_draw_vbo(struct pipe_context *pctx,
    if (ctx->gfx_pipeline_state.blend_state->need_blend_constants)
       vkCmdSetBlendConstants(batch->cmdbuf, ctx->blend_constants);
 
-   if (num_wds > 0) {
+   if (update_desc_set && num_wds > 0) {
       for (int i = 0; i < num_wds; ++i)
          wds[i].dstSet = desc_set;
       vkUpdateDescriptorSets(screen->dev, num_wds, wds, 0, NULL);
@@ -30,6 +30,7 @@
 #include "zink_resource.h"
 
 #include "os/os_process.h"
+#include "util/mesa-sha1.h"
 #include "util/u_debug.h"
 #include "util/format/u_format.h"
 #include "util/u_math.h"
@@ -39,6 +40,8 @@
 
 #include "frontend/sw_winsys.h"
 
+#include <unistd.h>
+
 static const struct debug_named_value
 debug_options[] = {
    { "nir", ZINK_DEBUG_NIR, "Dump NIR during program compile" },
@@ -595,10 +598,104 @@ zink_is_format_supported(struct pipe_screen *pscreen,
    return true;
 }
 
+static void
+disk_cache_init(struct zink_screen *screen)
+{
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char cache_id[20 * 2 + 1];
+
+   _mesa_sha1_init(&ctx);
+   if (!disk_cache_get_function_identifier(disk_cache_init, &ctx))
+      return;
+
+   _mesa_sha1_update(&ctx, screen->props.pipelineCacheUUID,
+                     VK_UUID_SIZE);
+   _mesa_sha1_final(&ctx, sha1);
+   disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+   screen->disk_cache = disk_cache_create("zink", cache_id, 0);
+}
+
+static void
+pipeline_cache_key(struct zink_screen *screen, cache_key key)
+{
+   disk_cache_compute_key(screen->disk_cache,
+                          screen->props.pipelineCacheUUID, VK_UUID_SIZE,
+                          key);
+}
+
+/* Seeds the VkPipelineCache with the data saved by a previous process, so
+ * pipelines it already compiled come back without a full compile.  The
+ * Vulkan driver validates the header and ignores data it can't use.
+ */
+static bool
+pipeline_cache_init(struct zink_screen *screen)
+{
+   VkPipelineCacheCreateInfo pcci = {};
+   pcci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+   void *data = NULL;
+   if (screen->disk_cache) {
+      cache_key key;
+      pipeline_cache_key(screen, key);
+      data = disk_cache_get(screen->disk_cache, key,
+                            &screen->pipeline_cache_size);
+      pcci.initialDataSize = screen->pipeline_cache_size;
+      pcci.pInitialData = data;
+   }
+
+   VkResult result = vkCreatePipelineCache(screen->dev, &pcci, NULL,
+                                           &screen->pipeline_cache);
+   free(data);
+
+   return result == VK_SUCCESS;
+}
+
+static void
+pipeline_cache_save(struct zink_screen *screen)
+{
+   size_t size;
+
+   if (!screen->disk_cache ||
+       vkGetPipelineCacheData(screen->dev, screen->pipeline_cache,
+                              &size, NULL) != VK_SUCCESS)
+      return;
+
+   /* Nothing was added since the data was loaded */
+   if (size == screen->pipeline_cache_size)
+      return;
+
+   void *data = malloc(size);
+   if (!data)
+      return;
+
+   if (vkGetPipelineCacheData(screen->dev, screen->pipeline_cache,
+                              &size, data) == VK_SUCCESS) {
+      cache_key key;
+      pipeline_cache_key(screen, key);
+      disk_cache_put(screen->disk_cache, key, data, size, NULL);
+      screen->pipeline_cache_size = size;
+   }
+
+   free(data);
+}
+
 static void
 zink_destroy_screen(struct pipe_screen *pscreen)
 {
    struct zink_screen *screen = zink_screen(pscreen);
+
+   if (util_queue_is_initialized(&screen->compile_queue))
+      util_queue_destroy(&screen->compile_queue);
+
+   if (screen->pipeline_cache) {
+      pipeline_cache_save(screen);
+      vkDestroyPipelineCache(screen->dev, screen->pipeline_cache, NULL);
+   }
+
+   disk_cache_destroy(screen->disk_cache);
+
    slab_destroy_parent(&screen->transfer_pool);
    FREE(screen);
 }
@@ -974,6 +1071,17 @@ zink_internal_create_screen(struct sw_winsys *winsys, int fd)
    if (!load_device_extensions(screen))
       goto fail;
 
+   disk_cache_init(screen);
+   if (!pipeline_cache_init(screen))
+      goto fail;
+
+   /* Leave a core for the app's thread.  If this fails, shaders are just
+    * compiled synchronously.
+    */
+   util_queue_init(&screen->compile_queue, "zink_compile", 64,
+                   MAX2(1, sysconf(_SC_NPROCESSORS_ONLN) - 1),
+                   UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+
    screen->winsys = winsys;
 
    screen->base.get_name = zink_get_name;
@@ -996,6 +1104,7 @@ zink_internal_create_screen(struct sw_winsys *winsys, int fd)
    return &screen->base;
 
 fail:
+   disk_cache_destroy(screen->disk_cache);
    FREE(screen);
    return NULL;
 }
@@ -25,7 +25,9 @@
 #define ZINK_SCREEN_H
 
 #include "pipe/p_screen.h"
+#include "util/disk_cache.h"
 #include "util/slab.h"
+#include "util/u_queue.h"
 
 #include <vulkan/vulkan.h>
 
@@ -70,6 +72,12 @@ struct zink_screen {
    uint32_t timestamp_valid_bits;
    VkDevice dev;
 
+   struct disk_cache *disk_cache;
+   VkPipelineCache pipeline_cache;
+   size_t pipeline_cache_size;
+
+   struct util_queue compile_queue;
+
    PFN_vkGetMemoryFdKHR vk_GetMemoryFdKHR;
    PFN_vkCmdBeginConditionalRenderingEXT vk_CmdBeginConditionalRenderingEXT;
    PFN_vkCmdEndConditionalRenderingEXT vk_CmdEndConditionalRenderingEXT;
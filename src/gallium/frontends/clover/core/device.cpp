@@ -27,6 +27,7 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
 #include "util/bitscan.h"
+#include "util/disk_cache.h"
 #include "util/u_debug.h"
 
 using namespace clover;
@@ -45,14 +46,18 @@ namespace {
 }
 
 device::device(clover::platform &platform, pipe_loader_device *ldev) :
-   platform(platform), ldev(ldev) {
+   platform(platform), ldev(ldev), disk_cache(NULL) {
    pipe = pipe_loader_create_screen(ldev);
    if (pipe && pipe->get_param(pipe, PIPE_CAP_COMPUTE)) {
-      if (supports_ir(PIPE_SHADER_IR_NATIVE))
+      if (supports_ir(PIPE_SHADER_IR_NATIVE)) {
+         create_disk_cache();
          return;
+      }
 #ifdef HAVE_CLOVER_SPIRV
-      if (supports_ir(PIPE_SHADER_IR_NIR_SERIALIZED))
+      if (supports_ir(PIPE_SHADER_IR_NIR_SERIALIZED)) {
+         create_disk_cache();
          return;
+      }
 #endif
    }
    if (pipe)
@@ -60,13 +65,46 @@ device::device(clover::platform &platform, pipe_loader_device *ldev) :
    throw error(CL_INVALID_DEVICE);
 }
 
+void
+device::create_disk_cache() {
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char cache_id[20 * 2 + 1];
+
+   _mesa_sha1_init(&ctx);
+
+   if (!disk_cache_get_function_identifier((void *)pipe_loader_create_screen,
+                                           &ctx))
+      return;
+
+   // Everything the compiler queries from the device goes into the cache
+   // identity, so a program built for another configuration is never
+   // picked up.
+   const std::string config = ir_target() + ":" + device_clc_version() +
+      ":" + supported_extensions() + ":" + std::to_string(address_bits()) +
+      ":" + std::to_string(ir_format());
+   _mesa_sha1_update(&ctx, config.data(), config.size());
+
+   _mesa_sha1_final(&ctx, sha1);
+   disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+   disk_cache = disk_cache_create("clover", cache_id, 0);
+}
+
 device::~device() {
+   if (disk_cache)
+      disk_cache_destroy(disk_cache);
    if (pipe)
       pipe->destroy(pipe);
    if (ldev)
       pipe_loader_release(&ldev, 1);
 }
 
+struct disk_cache *
+device::get_disk_cache() const {
+   return disk_cache;
+}
+
 bool
 device::operator==(const device &dev) const {
    return this == &dev;
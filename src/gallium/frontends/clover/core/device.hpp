@@ -30,6 +30,8 @@
 #include "core/format.hpp"
 #include "pipe-loader/pipe_loader.h"
 
+struct disk_cache;
+
 namespace clover {
    class platform;
    class root_resource;
@@ -93,6 +95,7 @@ namespace clover {
       friend std::set<cl_image_format>
       supported_formats(const context &, cl_mem_object_type);
       const void *get_compiler_options(enum pipe_shader_ir ir) const;
+      struct disk_cache *get_disk_cache() const;
 
       clover::platform &platform;
 
@@ -102,8 +105,11 @@ namespace clover {
       }
 
    private:
+      void create_disk_cache();
+
       pipe_screen *pipe;
       pipe_loader_device *ldev;
+      struct disk_cache *disk_cache;
    };
 }
 
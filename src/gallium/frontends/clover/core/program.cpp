@@ -20,11 +20,72 @@
 // OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <sstream>
+
 #include "core/compiler.hpp"
 #include "core/program.hpp"
+#include "util/disk_cache.h"
 
 using namespace clover;
 
+namespace {
+   void
+   hash_string(struct mesa_sha1 *ctx, const std::string &s) {
+      const uint64_t size = s.size();
+      _mesa_sha1_update(ctx, &size, sizeof(size));
+      _mesa_sha1_update(ctx, s.data(), s.size());
+   }
+
+   ///
+   /// Look up the result of \a build in the disk cache of \a dev
+   /// under \a key, or run it and store its result.  The part of the
+   /// build log written by \a build is cached along with the module.
+   ///
+   template<typename F>
+   module
+   cached_build(const device &dev, bool cacheable, const cache_key key,
+                std::string &log, F build) {
+      struct disk_cache *cache = cacheable ? dev.get_disk_cache() : NULL;
+
+      if (cache) {
+         size_t size;
+         char *data = (char *)disk_cache_get(cache, key, &size);
+
+         if (data) {
+            std::istringstream is(std::string(data, size));
+            uint64_t log_size;
+
+            free(data);
+            is.read((char *)&log_size, sizeof(log_size));
+            std::string cached_log(log_size, '\0');
+            is.read(&cached_log[0], log_size);
+            if (is) {
+               log += cached_log;
+               return module::deserialize(is);
+            }
+         }
+      }
+
+      const size_t log_start = log.size();
+      const module m = build();
+
+      if (cache) {
+         std::ostringstream os;
+         const std::string build_log = log.substr(log_start);
+         const uint64_t log_size = build_log.size();
+
+         os.write((const char *)&log_size, sizeof(log_size));
+         os << build_log;
+         m.serialize(os);
+
+         const std::string s = os.str();
+         disk_cache_put(cache, key, s.data(), s.size(), NULL);
+      }
+
+      return m;
+   }
+}
+
 program::program(clover::context &ctx, const std::string &source) :
    has_source(true), context(ctx), _devices(ctx.devices()), _source(source),
    _kernel_ref_counter(0) {
@@ -49,10 +110,27 @@ program::compile(const ref_vector<device> &devs, const std::string &opts,
 
       for (auto &dev : devs) {
          std::string log;
+         struct mesa_sha1 ctx;
+         cache_key key;
+
+         _mesa_sha1_init(&ctx);
+         hash_string(&ctx, "compile");
+         hash_string(&ctx, _source);
+         hash_string(&ctx, opts);
+         for (auto &header : headers) {
+            hash_string(&ctx, header.first);
+            hash_string(&ctx, header.second);
+         }
+         _mesa_sha1_final(&ctx, key);
 
          try {
-            const module m =
-               compiler::compile_program(_source, headers, dev, opts, log);
+            // Headers found through include paths aren't part of the
+            // key, don't risk returning a stale build.
+            const bool cacheable = opts.find("-I") == std::string::npos;
+            const module m = cached_build(dev, cacheable, key, log, [&]() {
+                  return compiler::compile_program(_source, headers, dev,
+                                                   opts, log);
+               });
             _builds[&dev] = { m, opts, log };
          } catch (...) {
             _builds[&dev] = { module(), opts, log };
@@ -72,9 +150,23 @@ program::link(const ref_vector<device> &devs, const std::string &opts,
          return prog.build(dev).binary;
          }, progs);
       std::string log = _builds[&dev].log;
+      struct mesa_sha1 ctx;
+      cache_key key;
+
+      _mesa_sha1_init(&ctx);
+      hash_string(&ctx, "link");
+      hash_string(&ctx, opts);
+      for (auto &m : ms) {
+         std::ostringstream os;
+         m.serialize(os);
+         hash_string(&ctx, os.str());
+      }
+      _mesa_sha1_final(&ctx, key);
 
       try {
-         const module m = compiler::link_program(ms, dev, opts, log);
+         const module m = cached_build(dev, true, key, log, [&]() {
+               return compiler::link_program(ms, dev, opts, log);
+            });
          _builds[&dev] = { m, opts, log };
       } catch (...) {
          _builds[&dev] = { module(), opts, log };
@@ -72,14 +72,22 @@ command_queue::flush() {
    if (!queued_events.empty()) {
       pipe->flush(pipe, &fence, 0);
 
-      while (!queued_events.empty() &&
-             queued_events.front()().signalled()) {
-         queued_events.front()().fence(fence);
-         queued_events.pop_front();
+      // Events of an out-of-order queue may be signalled in any
+      // order, so look past the ones still waiting on dependencies.
+      for (auto it = queued_events.begin(); it != queued_events.end();) {
+         if ((*it)().signalled()) {
+            (*it)().fence(fence);
+            it = queued_events.erase(it);
+         } else {
+            ++it;
+         }
       }
 
       screen->fence_reference(screen, &fence, NULL);
    }
+
+   if (last_barrier && last_barrier->signalled())
+      last_barrier = NULL;
 }
 
 cl_command_queue_properties
@@ -92,11 +100,35 @@ command_queue::profiling_enabled() const {
    return props & CL_QUEUE_PROFILING_ENABLE;
 }
 
+bool
+command_queue::out_of_order() const {
+   return props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+}
+
 void
 command_queue::sequence(hard_event &ev) {
    std::lock_guard<std::mutex> lock(queued_events_mutex);
-   if (!queued_events.empty())
-      queued_events.back()().chain(ev);
+
+   if (!out_of_order()) {
+      if (!queued_events.empty())
+         queued_events.back()().chain(ev);
+
+   } else if (ev.command() == CL_COMMAND_MARKER ||
+              ev.command() == CL_COMMAND_BARRIER || !ev.command()) {
+      // Markers, barriers and the internal event of clFinish() wait
+      // for everything enqueued before them.  Events already signalled
+      // don't hold them back.
+      for (hard_event &qev : queued_events)
+         qev.chain(ev);
+
+      last_barrier = &ev;
+
+   } else if (last_barrier) {
+      // Anything else only waits for its own dependencies and the last
+      // barrier, so independent commands can be executed right away
+      // even if an earlier one is blocked on a user event.
+      last_barrier->chain(ev);
+   }
 
    queued_events.push_back(ev);
 }
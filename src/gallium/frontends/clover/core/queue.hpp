@@ -50,6 +50,7 @@ namespace clover {
 
       cl_command_queue_properties properties() const;
       bool profiling_enabled() const;
+      bool out_of_order() const;
 
       const intrusive_ref<clover::context> context;
       const intrusive_ref<clover::device> device;
@@ -72,6 +73,10 @@ namespace clover {
       pipe_context *pipe;
       std::mutex queued_events_mutex;
       std::deque<intrusive_ref<hard_event>> queued_events;
+
+      /// Last pending marker or barrier of an out-of-order queue, which
+      /// subsequent events are serialized with respect to.
+      intrusive_ptr<hard_event> last_barrier;
    };
 }
 
@@ -20,6 +20,9 @@
 // OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <climits>
+#include <unistd.h>
+
 #include "core/resource.hpp"
 #include "core/memory.hpp"
 #include "pipe/p_screen.h"
@@ -48,7 +51,7 @@ namespace {
 }
 
 resource::resource(clover::device &dev, memory_obj &obj) :
-   device(dev), obj(obj), pipe(NULL), offset() {
+   device(dev), obj(obj), pipe(NULL), offset(), user_memory(false) {
 }
 
 resource::~resource() {
@@ -146,11 +149,36 @@ root_resource::root_resource(clover::device &dev, memory_obj &obj,
                 PIPE_BIND_GLOBAL);
 
    if (obj.flags() & CL_MEM_USE_HOST_PTR && dev.allows_user_pointers()) {
-      // Page alignment is normally required for this, just try, hope for the
-      // best and fall back if it fails.
-      pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info, obj.host_ptr());
-      if (pipe)
-         return;
+      if (info.target == PIPE_BUFFER) {
+         // Page alignment is normally required for this.  Import the
+         // whole pages spanned by the buffer, and point the resource at
+         // the start of the host memory through its offset.
+         const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+         const uintptr_t ptr = (uintptr_t)obj.host_ptr();
+         const uintptr_t start = ptr & ~(page_size - 1);
+         const uintptr_t end = (ptr + obj.size() + page_size - 1) &
+                               ~(page_size - 1);
+         pipe_resource user_info = info;
+
+         if (end - start <= UINT_MAX) {
+            user_info.width0 = end - start;
+            pipe = dev.pipe->resource_from_user_memory(dev.pipe, &user_info,
+                                                       (void *)start);
+            if (pipe) {
+               offset[0] = ptr - start;
+               user_memory = true;
+               return;
+            }
+         }
+      } else {
+         // Just try, hope for the best and fall back if it fails.
+         pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info,
+                                                    obj.host_ptr());
+         if (pipe) {
+            user_memory = true;
+            return;
+         }
+      }
    }
 
    if (obj.flags() & (CL_MEM_ALLOC_HOST_PTR | CL_MEM_USE_HOST_PTR)) {
@@ -190,6 +218,7 @@ sub_resource::sub_resource(resource &r, const vector &offset) :
    resource(r.device(), r.obj) {
    this->pipe = r.pipe;
    this->offset = r.offset + offset;
+   this->user_memory = r.user_memory;
 }
 
 mapping::mapping(command_queue &q, resource &r,
@@ -203,8 +232,16 @@ mapping::mapping(command_queue &q, resource &r,
                       PIPE_TRANSFER_DISCARD_RANGE : 0) |
                      (!blocking ? PIPE_TRANSFER_UNSYNCHRONIZED : 0));
 
-   p = pctx->transfer_map(pctx, r.pipe, 0, usage,
-                          box(origin + r.offset, region), &pxfer);
+   // Resources wrapping host memory are mapped in place, which makes
+   // the map and unmap of CL_MEM_USE_HOST_PTR objects free of copies.
+   p = NULL;
+   if (r.user_memory)
+      p = pctx->transfer_map(pctx, r.pipe, 0,
+                             usage | PIPE_TRANSFER_MAP_DIRECTLY,
+                             box(origin + r.offset, region), &pxfer);
+   if (!p)
+      p = pctx->transfer_map(pctx, r.pipe, 0, usage,
+                             box(origin + r.offset, region), &pxfer);
    if (!p) {
       pxfer = NULL;
       throw error(CL_OUT_OF_RESOURCES);
@@ -78,6 +78,10 @@ namespace clover {
       pipe_resource *pipe;
       vector offset;
 
+      /// Whether \a pipe wraps the host memory of a CL_MEM_USE_HOST_PTR
+      /// object, in which case mappings can point to it directly.
+      bool user_memory;
+
    private:
       std::list<mapping> maps;
    };
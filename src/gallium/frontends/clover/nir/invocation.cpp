@@ -58,6 +58,18 @@ dev_get_nir_compiler_options(const device &dev)
    return static_cast<const nir_shader_compiler_options*>(co);
 }
 
+// Cleans up a function before it gets inlined into its callers, so that the
+// work is done once rather than once per call site.  Only touches the
+// function itself, so it can run on all functions in parallel.
+static bool
+optimize_function_impl(nir_function_impl *impl, void *)
+{
+   bool progress = nir_lower_returns_impl(impl);
+   progress |= nir_copy_prop_impl(impl);
+   progress |= nir_opt_dce_impl(impl);
+   return progress;
+}
+
 module clover::nir::spirv_to_nir(const module &mod, const device &dev,
                                  std::string &r_log)
 {
@@ -110,7 +122,8 @@ module clover::nir::spirv_to_nir(const module &mod, const device &dev,
       // Inline all functions first.
       // according to the comment on nir_inline_functions
       NIR_PASS_V(nir, nir_lower_variable_initializers, nir_var_function_temp);
-      NIR_PASS_V(nir, nir_lower_returns);
+      NIR_PASS_V(nir, nir_shader_impls_parallel, optimize_function_impl,
+                 nullptr);
       NIR_PASS_V(nir, nir_inline_functions);
       NIR_PASS_V(nir, nir_copy_prop);
       NIR_PASS_V(nir, nir_opt_deref);
@@ -2095,12 +2095,18 @@ NineDevice9_SetTransform( struct NineDevice9 *This,
     user_assert(M, D3DERR_INVALIDCALL);
     nine_D3DMATRIX_print(pMatrix);
 
-    *M = *pMatrix;
     if (unlikely(This->is_recording)) {
+        *M = *pMatrix;
         state->ff.changed.transform[State / 32] |= 1 << (State % 32);
         state->changed.group |= NINE_STATE_FF_VSTRANSF;
-    } else
-        nine_context_set_transform(This, State, pMatrix);
+        return D3D_OK;
+    }
+
+    if (!memcmp(M, pMatrix, sizeof(*M)))
+        return D3D_OK;
+
+    *M = *pMatrix;
+    nine_context_set_transform(This, State, pMatrix);
 
     return D3D_OK;
 }
@@ -2642,13 +2648,18 @@ NineDevice9_SetTextureStageState( struct NineDevice9 *This,
     user_assert(Stage < ARRAY_SIZE(state->ff.tex_stage), D3DERR_INVALIDCALL);
     user_assert(Type < ARRAY_SIZE(state->ff.tex_stage[0]), D3DERR_INVALIDCALL);
 
-    state->ff.tex_stage[Stage][Type] = Value;
-
     if (unlikely(This->is_recording)) {
+        state->ff.tex_stage[Stage][Type] = Value;
         state->changed.group |= NINE_STATE_FF_PS_CONSTS;
         state->ff.changed.tex_stage[Stage][Type / 32] |= 1 << (Type % 32);
-    } else
-        nine_context_set_texture_stage_state(This, Stage, Type, Value);
+        return D3D_OK;
+    }
+
+    if (state->ff.tex_stage[Stage][Type] == Value)
+        return D3D_OK;
+
+    state->ff.tex_stage[Stage][Type] = Value;
+    nine_context_set_texture_stage_state(This, Stage, Type, Value);
 
     return D3D_OK;
 }
@@ -66,6 +66,9 @@ struct nine_buffer_upload {
 
     unsigned buffers_size; /* Size of the big allocated buffers */
     unsigned num_buffers;
+    unsigned max_buffers; /* Groups are added up to this before allocating
+                           * lonely buffers. The array is never reallocated,
+                           * as the subbuffers point to their group. */
     struct nine_buffer_group *buffers;
 };
 
@@ -147,8 +150,10 @@ nine_upload_create(struct pipe_context *pipe, unsigned buffers_size,
     upload->pipe = pipe;
     upload->buffers_size = align(buffers_size, 4096);
     upload->num_buffers = num_buffers;
+    upload->max_buffers = num_buffers * 2;
 
-    upload->buffers = CALLOC(num_buffers, sizeof(struct nine_buffer_group));
+    upload->buffers = CALLOC(upload->max_buffers,
+                             sizeof(struct nine_buffer_group));
     if (!upload->buffers)
         goto buffers_fail;
 
@@ -197,6 +202,16 @@ nine_upload_create_buffer(struct nine_buffer_upload *upload,
             break;
     }
 
+    /* All groups are busy: add one rather than creating a buffer
+     * for this allocation alone. */
+    if (i == upload->num_buffers && upload->num_buffers < upload->max_buffers &&
+        size <= upload->buffers_size) {
+        group = &upload->buffers[upload->num_buffers];
+        nine_upload_create_buffer_group(upload, group);
+        if (group->resource)
+            upload->num_buffers++;
+    }
+
     if (i == upload->num_buffers) {
         /* Allocate lonely buffer */
         struct pipe_resource resource;
@@ -204,6 +204,22 @@ nine_queue_alloc(struct nine_queue_pool* ctx, unsigned space)
     return cmdbuf->mem_pool + offset;
 }
 
+/* Gets a pointer to the last memory slice allocated, so that the producer
+ * can merge a new instruction into it.
+ * Returns NULL if it has been flushed already (the consumer may be reading
+ * it) or if the cmdbuf is empty. */
+void *
+nine_queue_get_last(struct nine_queue_pool* ctx)
+{
+    struct nine_cmdbuf *cmdbuf = &ctx->pool[ctx->head];
+
+    if (!cmdbuf->num_instr)
+        return NULL;
+
+    return cmdbuf->mem_pool + cmdbuf->offset -
+           cmdbuf->instr_size[cmdbuf->num_instr - 1];
+}
+
 /* Returns the current queue flush state.
  * TRUE nothing flushed
  * FALSE one ore more instructions queued flushed. */
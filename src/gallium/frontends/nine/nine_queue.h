@@ -39,6 +39,9 @@ nine_queue_flush(struct nine_queue_pool* ctx);
 void *
 nine_queue_alloc(struct nine_queue_pool* ctx, unsigned space);
 
+void *
+nine_queue_get_last(struct nine_queue_pool* ctx);
+
 bool
 nine_queue_no_flushed_work(struct nine_queue_pool* ctx);
 
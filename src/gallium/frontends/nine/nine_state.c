@@ -2322,7 +2322,14 @@ init_draw_info(struct pipe_draw_info *info,
     info->indirect = NULL;
 }
 
-CSMT_ITEM_NO_WAIT(nine_context_draw_primitive,
+/* Wrapped by nine_context_draw_primitive, which can merge draws. */
+static void
+nine_context_draw_primitive_queued(struct NineDevice9 *device,
+                                   D3DPRIMITIVETYPE PrimitiveType,
+                                   UINT StartVertex,
+                                   UINT PrimitiveCount);
+
+CSMT_ITEM_NO_WAIT(nine_context_draw_primitive_queued,
                   ARG_VAL(D3DPRIMITIVETYPE, PrimitiveType),
                   ARG_VAL(UINT, StartVertex),
                   ARG_VAL(UINT, PrimitiveCount))
@@ -2343,7 +2350,16 @@ CSMT_ITEM_NO_WAIT(nine_context_draw_primitive,
     context->pipe->draw_vbo(context->pipe, &info);
 }
 
-CSMT_ITEM_NO_WAIT(nine_context_draw_indexed_primitive,
+static void
+nine_context_draw_indexed_primitive_queued(struct NineDevice9 *device,
+                                           D3DPRIMITIVETYPE PrimitiveType,
+                                           INT BaseVertexIndex,
+                                           UINT MinVertexIndex,
+                                           UINT NumVertices,
+                                           UINT StartIndex,
+                                           UINT PrimitiveCount);
+
+CSMT_ITEM_NO_WAIT(nine_context_draw_indexed_primitive_queued,
                   ARG_VAL(D3DPRIMITIVETYPE, PrimitiveType),
                   ARG_VAL(INT, BaseVertexIndex),
                   ARG_VAL(UINT, MinVertexIndex),
@@ -2368,6 +2384,79 @@ CSMT_ITEM_NO_WAIT(nine_context_draw_indexed_primitive,
     context->pipe->draw_vbo(context->pipe, &info);
 }
 
+/* With csmt, a draw directly following another one in the queue, with the
+ * same list primitive type and the next range of vertices or indices, is
+ * merged into it: nothing can have changed in between, as any state change
+ * would have queued an instruction. */
+
+static inline boolean
+draw_is_mergeable(struct NineDevice9 *device, D3DPRIMITIVETYPE PrimitiveType)
+{
+    return device->csmt_active &&
+           (PrimitiveType == D3DPT_TRIANGLELIST ||
+            PrimitiveType == D3DPT_LINELIST ||
+            PrimitiveType == D3DPT_POINTLIST);
+}
+
+void
+nine_context_draw_primitive(struct NineDevice9 *device,
+                            D3DPRIMITIVETYPE PrimitiveType,
+                            UINT StartVertex,
+                            UINT PrimitiveCount)
+{
+    if (draw_is_mergeable(device, PrimitiveType)) {
+        struct s_nine_context_draw_primitive_queued_private *last =
+            nine_queue_get_last(device->csmt_ctx->pool);
+
+        if (last &&
+            last->instr.func == &nine_context_draw_primitive_queued_rx &&
+            last->_PrimitiveType == PrimitiveType &&
+            last->_StartVertex +
+            prim_count_to_vertex_count(PrimitiveType, last->_PrimitiveCount) == StartVertex) {
+            last->_PrimitiveCount += PrimitiveCount;
+            return;
+        }
+    }
+
+    nine_context_draw_primitive_queued(device, PrimitiveType, StartVertex,
+                                       PrimitiveCount);
+}
+
+void
+nine_context_draw_indexed_primitive(struct NineDevice9 *device,
+                                    D3DPRIMITIVETYPE PrimitiveType,
+                                    INT BaseVertexIndex,
+                                    UINT MinVertexIndex,
+                                    UINT NumVertices,
+                                    UINT StartIndex,
+                                    UINT PrimitiveCount)
+{
+    if (draw_is_mergeable(device, PrimitiveType)) {
+        struct s_nine_context_draw_indexed_primitive_queued_private *last =
+            nine_queue_get_last(device->csmt_ctx->pool);
+
+        if (last &&
+            last->instr.func == &nine_context_draw_indexed_primitive_queued_rx &&
+            last->_PrimitiveType == PrimitiveType &&
+            last->_BaseVertexIndex == BaseVertexIndex &&
+            last->_StartIndex +
+            prim_count_to_vertex_count(PrimitiveType, last->_PrimitiveCount) == StartIndex) {
+            UINT end = MAX2(last->_MinVertexIndex + last->_NumVertices,
+                            MinVertexIndex + NumVertices);
+
+            last->_MinVertexIndex = MIN2(last->_MinVertexIndex, MinVertexIndex);
+            last->_NumVertices = end - last->_MinVertexIndex;
+            last->_PrimitiveCount += PrimitiveCount;
+            return;
+        }
+    }
+
+    nine_context_draw_indexed_primitive_queued(device, PrimitiveType,
+                                               BaseVertexIndex, MinVertexIndex,
+                                               NumVertices, StartIndex,
+                                               PrimitiveCount);
+}
+
 CSMT_ITEM_NO_WAIT(nine_context_draw_primitive_from_vtxbuf,
                   ARG_VAL(D3DPRIMITIVETYPE, PrimitiveType),
                   ARG_VAL(UINT, PrimitiveCount),
@@ -49,6 +49,7 @@ struct pipe_debug_callback;
 struct pipe_depth_stencil_alpha_state;
 struct pipe_device_reset_callback;
 struct pipe_draw_info;
+struct pipe_draw_start_count;
 struct pipe_grid_info;
 struct pipe_fence_handle;
 struct pipe_framebuffer_state;
@@ -108,6 +109,15 @@ struct pipe_context {
    /*@{*/
    void (*draw_vbo)( struct pipe_context *pipe,
                      const struct pipe_draw_info *info );
+
+   /**
+    * Draw several ranges with the same draw info, as if draw_vbo was called
+    * for each range with "start" and "count" replaced. Optional.
+    */
+   void (*multi_draw)( struct pipe_context *pipe,
+                       const struct pipe_draw_info *info,
+                       const struct pipe_draw_start_count *draws,
+                       unsigned num_draws );
    /*@}*/
 
    /**
@@ -955,6 +955,8 @@ enum pipe_cap
    PIPE_CAP_GLSL_ZERO_INIT,
    PIPE_CAP_BLEND_EQUATION_ADVANCED,
    PIPE_CAP_NO_CLIP_ON_COPY_TEX,
+   PIPE_CAP_CONSTBUF_PARTIAL_UPDATES,
+   PIPE_CAP_SHAREABLE_CSOS,
 };
 
 /**
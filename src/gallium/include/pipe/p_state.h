@@ -786,6 +786,15 @@ struct pipe_draw_info
 };
 
 
+/**
+ * One range of a pipe_context::multi_draw call.
+ */
+struct pipe_draw_start_count {
+   unsigned start;
+   unsigned count;
+};
+
+
 /**
  * Information to describe a blit call.
  */
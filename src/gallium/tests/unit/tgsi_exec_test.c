@@ -0,0 +1,256 @@
+/*
+ * Checks the ALU ops and stores of tgsi_exec against a scalar reference.
+ *
+ * tgsi_exec uses SSE2/NEON for some ops, which must give bit-identical
+ * results to the plain C code, including for NaNs, infinities and negative
+ * zero.  Each op is run on all combinations of a set of interesting values,
+ * with and without saturate and source modifiers, and under a partial
+ * execution mask.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#define NUM_TOKENS 1024
+
+/* The instruction input is IN[0..2], IN[3] is what OUT[0] holds outside of
+ * the IF, and IN[4].x the IF condition.
+ */
+#define IN_OLD  3
+#define IN_COND 4
+
+static const float values[] = {
+   0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 2.0f, -3.5f, 1e-40f,
+   INFINITY, -INFINITY, NAN, -NAN,
+};
+
+struct op_test {
+   const char *name;
+   unsigned num_srcs;
+   float (*ref)(float a, float b, float c);
+};
+
+static float ref_add(float a, float b, float c) { return a + b; }
+static float ref_mul(float a, float b, float c) { return a * b; }
+static float ref_mad(float a, float b, float c) { return a * b + c; }
+static float ref_max(float a, float b, float c) { return a > b ? a : b; }
+static float ref_min(float a, float b, float c) { return a < b ? a : b; }
+static float ref_seq(float a, float b, float c) { return a == b ? 1.0f : 0.0f; }
+static float ref_sne(float a, float b, float c) { return a != b ? 1.0f : 0.0f; }
+static float ref_sge(float a, float b, float c) { return a >= b ? 1.0f : 0.0f; }
+static float ref_slt(float a, float b, float c) { return a < b ? 1.0f : 0.0f; }
+static float ref_mov(float a, float b, float c) { return a; }
+
+static float
+ref_and(float a, float b, float c)
+{
+   return uif(fui(a) & fui(b));
+}
+
+static float
+ref_or(float a, float b, float c)
+{
+   return uif(fui(a) | fui(b));
+}
+
+static float
+ref_xor(float a, float b, float c)
+{
+   return uif(fui(a) ^ fui(b));
+}
+
+static const struct op_test tests[] = {
+   { "ADD", 2, ref_add },
+   { "MUL", 2, ref_mul },
+   { "MAD", 3, ref_mad },
+   { "MAX", 2, ref_max },
+   { "MIN", 2, ref_min },
+   { "SEQ", 2, ref_seq },
+   { "SNE", 2, ref_sne },
+   { "SGE", 2, ref_sge },
+   { "SLT", 2, ref_slt },
+   { "AND", 2, ref_and },
+   { "OR",  2, ref_or },
+   { "XOR", 2, ref_xor },
+   { "MOV", 1, ref_mov },
+};
+
+enum modifier {
+   MOD_NONE,
+   MOD_NEGATE,
+   MOD_ABS,
+   MOD_SATURATE,
+   NUM_MODIFIERS,
+};
+
+static const char *modifier_names[] = { "", "neg", "abs", "sat" };
+
+static bool
+same_bits(float a, float b)
+{
+   /* Only the NaN-ness matters, not the payload. */
+   if (isnan(a) && isnan(b))
+      return true;
+   return fui(a) == fui(b);
+}
+
+static float
+saturate(float v)
+{
+   if (v < 0.0f)
+      return 0.0f;
+   else if (v > 1.0f)
+      return 1.0f;
+   return v;
+}
+
+static bool
+is_bitwise(const struct op_test *test)
+{
+   return test->ref == ref_and || test->ref == ref_or || test->ref == ref_xor;
+}
+
+static struct tgsi_token *
+build_shader(const struct op_test *test, enum modifier mod)
+{
+   static const char *src_fmt[NUM_MODIFIERS] = {
+      "IN[%u]", "-IN[%u]", "|IN[%u]|", "IN[%u]"
+   };
+   struct tgsi_token *tokens = CALLOC(NUM_TOKENS, sizeof(*tokens));
+   char text[1024], srcs[128] = "";
+   unsigned i;
+
+   for (i = 0; i < test->num_srcs; i++) {
+      char src[16];
+
+      snprintf(src, sizeof(src), src_fmt[mod], i);
+      strcat(srcs, ", ");
+      strcat(srcs, src);
+   }
+
+   snprintf(text, sizeof(text),
+            "VERT\n"
+            "DCL IN[0]\n"
+            "DCL IN[1]\n"
+            "DCL IN[2]\n"
+            "DCL IN[3]\n"
+            "DCL IN[4]\n"
+            "DCL OUT[0], GENERIC[0]\n"
+            "  0: MOV OUT[0], IN[%u]\n"
+            "  1: IF IN[%u].xxxx\n"
+            "  2:   %s%s OUT[0]%s\n"
+            "  3: ENDIF\n"
+            "  4: END\n",
+            IN_OLD, IN_COND, test->name,
+            mod == MOD_SATURATE ? "_SAT" : "", srcs);
+
+   if (!tgsi_text_translate(text, tokens, NUM_TOKENS)) {
+      printf("failed to translate:\n%s", text);
+      FREE(tokens);
+      return NULL;
+   }
+   return tokens;
+}
+
+static unsigned
+run_test(struct tgsi_exec_machine *mach, const struct op_test *test,
+         enum modifier mod)
+{
+   struct tgsi_token *tokens = build_shader(test, mod);
+   const unsigned n = ARRAY_SIZE(values);
+   unsigned fails = 0;
+
+   if (!tokens)
+      return 1;
+
+   tgsi_exec_machine_bind_shader(mach, tokens, NULL, NULL, NULL);
+
+   /* Walk all combinations of the inputs, 4 at a time. */
+   for (unsigned base = 0; base < n * n * n; base += TGSI_QUAD_SIZE) {
+      float in[3][TGSI_QUAD_SIZE];
+      unsigned execmask = (base / TGSI_QUAD_SIZE) % 16;
+
+      for (unsigned j = 0; j < TGSI_QUAD_SIZE; j++) {
+         unsigned k = (base + j) % (n * n * n);
+
+         in[0][j] = values[k % n];
+         in[1][j] = values[(k / n) % n];
+         in[2][j] = values[k / (n * n)];
+      }
+
+      for (unsigned c = 0; c < TGSI_NUM_CHANNELS; c++) {
+         for (unsigned j = 0; j < TGSI_QUAD_SIZE; j++) {
+            for (unsigned s = 0; s < 3; s++)
+               mach->Inputs[s].xyzw[c].f[j] = in[s][j];
+            mach->Inputs[IN_OLD].xyzw[c].f[j] = 42.0f + j;
+            mach->Inputs[IN_COND].xyzw[c].f[j] =
+               (execmask & (1 << j)) ? 1.0f : 0.0f;
+         }
+      }
+
+      tgsi_exec_machine_run(mach, 0);
+
+      for (unsigned j = 0; j < TGSI_QUAD_SIZE; j++) {
+         float a = in[0][j], b = in[1][j], c = in[2][j];
+         float expected;
+
+         if (!(execmask & (1 << j))) {
+            expected = 42.0f + j;
+         } else {
+            if (mod == MOD_NEGATE) {
+               a = -a; b = -b; c = -c;
+            } else if (mod == MOD_ABS) {
+               a = fabsf(a); b = fabsf(b); c = fabsf(c);
+            }
+            expected = test->ref(a, b, c);
+            if (mod == MOD_SATURATE)
+               expected = saturate(expected);
+         }
+
+         for (unsigned ch = 0; ch < TGSI_NUM_CHANNELS; ch++) {
+            float result = mach->Outputs[0].xyzw[ch].f[j];
+
+            if (!same_bits(result, expected)) {
+               printf("%s %s (%g, %g, %g) lane %u: expected %g (0x%08x), "
+                      "got %g (0x%08x)\n", test->name, modifier_names[mod],
+                      in[0][j], in[1][j], in[2][j], j, expected,
+                      fui(expected), result, fui(result));
+               fails++;
+               break;
+            }
+         }
+      }
+   }
+
+   FREE(tokens);
+   return fails;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct tgsi_exec_machine *mach =
+      tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
+   unsigned fails = 0;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(tests); i++) {
+      for (unsigned mod = 0; mod < NUM_MODIFIERS; mod++) {
+         /* The modifiers are only tested on float ops. */
+         if (mod != MOD_NONE && is_bitwise(&tests[i]))
+            continue;
+         fails += run_test(mach, &tests[i], mod);
+      }
+   }
+
+   tgsi_exec_machine_destroy(mach);
+
+   printf("%u failures\n", fails);
+   return fails ? 1 : 0;
+}
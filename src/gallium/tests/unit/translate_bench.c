@@ -0,0 +1,157 @@
+/**************************************************************************
+ *
+ * Copyright 2021 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Compare the throughput of the translate backends for common vertex
+ * format conversions, both for linear and indexed fetches.
+ *
+ * Usage: ./translate_bench [vertex count] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "translate/translate.h"
+#include "util/u_memory.h"
+#include "util/format/u_format.h"
+#include "util/u_cpu_detect.h"
+#include "util/os_time.h"
+
+static const struct {
+   enum pipe_format input;
+   enum pipe_format output;
+} conversions[] = {
+   { PIPE_FORMAT_R32G32B32_FLOAT,    PIPE_FORMAT_R32G32B32_FLOAT },
+   { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_R32G32_FLOAT,       PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_R32G32B32_FLOAT,    PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_R16G16_SNORM,       PIPE_FORMAT_R32G32_FLOAT },
+   { PIPE_FORMAT_R16G16_SSCALED,     PIPE_FORMAT_R32G32_FLOAT },
+   { PIPE_FORMAT_R16G16B16_UNORM,    PIPE_FORMAT_R32G32B32_FLOAT },
+   { PIPE_FORMAT_R8G8B8A8_UNORM,     PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_B8G8R8A8_UNORM,     PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_R8G8B8_UNORM,       PIPE_FORMAT_R32G32B32_FLOAT },
+   { PIPE_FORMAT_R10G10B10A2_SNORM,  PIPE_FORMAT_R32G32B32_FLOAT },
+   { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_R8G8B8A8_UNORM },
+   { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_B8G8R8A8_UNORM },
+};
+
+static const struct {
+   const char *name;
+   struct translate *(*create)(const struct translate_key *key);
+} backends[] = {
+   { "generic", translate_generic_create },
+   { "sse2",    translate_sse2_create },
+   { "avx2",    translate_avx2_create },
+};
+
+int main(int argc, char** argv)
+{
+   unsigned count = argc > 1 ? atoi(argv[1]) : 65536;
+   unsigned iterations = argc > 2 ? atoi(argv[2]) : 100;
+   unsigned char *input;
+   unsigned char *output;
+   unsigned *elts;
+   unsigned i, j, k;
+
+   util_cpu_detect();
+
+   if (!count || !iterations) {
+      printf("Usage: ./translate_bench [vertex count] [iterations]\n");
+      return 2;
+   }
+
+   /* big enough for 16 bytes per vertex in and out */
+   input = align_malloc(count * 16, 64);
+   output = align_malloc(count * 16, 64);
+   elts = align_malloc(count * sizeof *elts, 64);
+
+   srand(4359025);
+
+   /* avoid NaNs and infinities for the float formats */
+   for (i = 0; i < count * 16; ++i)
+      input[i] = rand() & 0x3f;
+
+   /* a mostly-forward index stream, like a typical mesh */
+   for (i = 0; i < count; ++i)
+      elts[i] = MIN2(i + (rand() % 64), count - 1);
+
+   printf("%-20s %-20s %-8s %12s %12s\n",
+          "input", "output", "backend", "run Mv/s", "elts Mv/s");
+
+   for (i = 0; i < ARRAY_SIZE(conversions); ++i) {
+      struct translate_key key;
+      unsigned input_size = util_format_get_blocksize(conversions[i].input);
+      unsigned output_size = util_format_get_blocksize(conversions[i].output);
+
+      memset(&key, 0, sizeof key);
+      key.output_stride = output_size;
+      key.nr_elements = 1;
+      key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+      key.element[0].input_format = conversions[i].input;
+      key.element[0].output_format = conversions[i].output;
+
+      for (j = 0; j < ARRAY_SIZE(backends); ++j) {
+         struct translate *translate = backends[j].create(&key);
+         int64_t start, run_time, elts_time;
+
+         if (!translate) {
+            printf("%-20s %-20s %-8s %12s %12s\n",
+                   util_format_short_name(conversions[i].input),
+                   util_format_short_name(conversions[i].output),
+                   backends[j].name, "n/a", "n/a");
+            continue;
+         }
+
+         translate->set_buffer(translate, 0, input, input_size, count - 1);
+
+         start = os_time_get_nano();
+         for (k = 0; k < iterations; ++k)
+            translate->run(translate, 0, count, 0, 0, output);
+         run_time = os_time_get_nano() - start;
+
+         start = os_time_get_nano();
+         for (k = 0; k < iterations; ++k)
+            translate->run_elts(translate, elts, count, 0, 0, output);
+         elts_time = os_time_get_nano() - start;
+
+         printf("%-20s %-20s %-8s %12.1f %12.1f\n",
+                util_format_short_name(conversions[i].input),
+                util_format_short_name(conversions[i].output),
+                backends[j].name,
+                (double)count * iterations * 1000.0 / MAX2(run_time, 1),
+                (double)count * iterations * 1000.0 / MAX2(elts_time, 1));
+
+         translate->release(translate);
+      }
+   }
+
+   align_free(elts);
+   align_free(output);
+   align_free(input);
+
+   return 0;
+}
@@ -127,10 +127,19 @@ int main(int argc, char** argv)
       }
       create_fn = translate_sse2_create;
    }
+   else if (!strcmp(argv[1], "avx2"))
+   {
+      if(!util_cpu_caps.has_avx2)
+      {
+         printf("Error: CPU doesn't support AVX2 (test with qemu)\n");
+         return 2;
+      }
+      create_fn = translate_avx2_create;
+   }
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1|avx2]\n");
       return 2;
    }
 
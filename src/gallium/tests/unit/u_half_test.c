@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <float.h>
+#include <string.h>
 
 #include "util/u_math.h"
 #include "util/u_half.h"
@@ -10,6 +11,9 @@ main(int argc, char **argv)
 {
    unsigned i;
    unsigned roundtrip_fails = 0;
+   unsigned array_fails = 0;
+   static uint16_t halves[1 << 16], rhalves[1 << 16];
+   static float floats[1 << 16];
 
    for(i = 0; i < 1 << 16; ++i)
    {
@@ -26,6 +30,50 @@ main(int argc, char **argv)
       }
    }
 
+   /* The bulk conversions must match the scalar ones bit for bit, including
+    * NaN payloads.  An odd count exercises the remainder loops too.
+    */
+   for(i = 0; i < 1 << 16; ++i)
+      halves[i] = (uint16_t) i;
+
+   _mesa_half_to_float_array(floats, halves, (1 << 16) - 3);
+   for(i = 0; i < (1 << 16) - 3; ++i) {
+      float f = util_half_to_float(halves[i]);
+      if (memcmp(&f, &floats[i], sizeof(f)) != 0) {
+         printf("_mesa_half_to_float_array failed: %x\n", halves[i]);
+         ++array_fails;
+      }
+   }
+
+   /* Halfway between representable halves, to check the rounding. */
+   for(i = 0; i < 1 << 16; ++i) {
+      union fi f;
+      f.f = util_half_to_float(halves[i]);
+      f.ui += 1 << 12;
+      floats[i] = f.f;
+   }
+
+   _mesa_float_to_half_array(rhalves, floats, (1 << 16) - 3);
+   for(i = 0; i < (1 << 16) - 3; ++i) {
+      if (rhalves[i] != util_float_to_half(floats[i])) {
+         printf("_mesa_float_to_half_array failed: %f\n", floats[i]);
+         ++array_fails;
+      }
+   }
+
+   _mesa_float_to_half_rtz_array(rhalves, floats, (1 << 16) - 3);
+   for(i = 0; i < (1 << 16) - 3; ++i) {
+      if (rhalves[i] != util_float_to_half_rtz(floats[i])) {
+         printf("_mesa_float_to_half_rtz_array failed: %f\n", floats[i]);
+         ++array_fails;
+      }
+   }
+
+   if(array_fails) {
+      printf("Failure! %u bulk conversions differ from the scalar ones.\n", array_fails);
+      return 1;
+   }
+
    if(roundtrip_fails) {
       printf("Failure! %u/65536 half floats failed a conversion to float and back.\n", roundtrip_fails);
       return 1;
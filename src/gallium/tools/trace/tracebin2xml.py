@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+
+'''Convert a binary trace (GALLIUM_TRACE_BINARY=true) to the XML format.
+
+The opcodes must match enum trace_bin_op in
+src/gallium/auxiliary/driver_trace/tr_dump.c.
+'''
+
+
+import optparse
+import struct
+import sys
+
+
+(CALL_BEGIN, CALL_END, ARG_BEGIN, ARG_END, RET_BEGIN, RET_END,
+ BOOL, INT, UINT, FLOAT, BYTES, BYTES_HASH, STRING, ENUM,
+ ARRAY_BEGIN, ARRAY_END, ELEM_BEGIN, ELEM_END, STRUCT_BEGIN, STRUCT_END,
+ MEMBER_BEGIN, MEMBER_END, NULL, PTR) = range(1, 25)
+
+
+def escape(s):
+    out = []
+    for c in s:
+        if c == '<':
+            out.append('&lt;')
+        elif c == '>':
+            out.append('&gt;')
+        elif c == '&':
+            out.append('&amp;')
+        elif c == '\'':
+            out.append('&apos;')
+        elif c == '"':
+            out.append('&quot;')
+        elif 0x20 <= ord(c) <= 0x7e:
+            out.append(c)
+        else:
+            out.append('&#%u;' % ord(c))
+    return ''.join(out)
+
+
+class BinaryTraceReader:
+
+    def __init__(self, fp, endian):
+        self.fp = fp
+        self.endian = endian
+
+    def read(self, fmt):
+        fmt = self.endian + fmt
+        data = self.fp.read(struct.calcsize(fmt))
+        if len(data) != struct.calcsize(fmt):
+            raise EOFError
+        return struct.unpack(fmt, data)[0]
+
+    def read_string(self):
+        size = self.read('I')
+        return self.fp.read(size).decode('latin-1')
+
+    def convert(self, out):
+        if self.fp.read(4) != b'GTRB':
+            raise ValueError('not a binary gallium trace')
+        version = self.read('I')
+        if version != 1:
+            raise ValueError('unsupported binary trace version %u' % version)
+
+        out.write("<?xml version='1.0' encoding='UTF-8'?>\n")
+        out.write("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n")
+        out.write("<trace version='0.1'>\n")
+
+        while True:
+            op = self.fp.read(1)
+            if not op:
+                break
+            try:
+                self.convert_token(ord(op), out)
+            except EOFError:
+                # The application didn't exit cleanly, the last chunk
+                # may have been cut short.
+                out.write('\n')
+                break
+
+        out.write('</trace>\n')
+
+    def convert_token(self, op, out):
+        if op == CALL_BEGIN:
+            no = self.read('I')
+            klass = self.read_string()
+            method = self.read_string()
+            out.write("\t<call no='%u' class='%s' method='%s'>\n" %
+                      (no, escape(klass), escape(method)))
+        elif op == CALL_END:
+            out.write('\t\t<time><int>%i</int></time>\n' % self.read('q'))
+            out.write('\t</call>\n')
+        elif op == ARG_BEGIN:
+            out.write("\t\t<arg name='%s'>" % escape(self.read_string()))
+        elif op == ARG_END:
+            out.write('</arg>\n')
+        elif op == RET_BEGIN:
+            out.write('\t\t<ret>')
+        elif op == RET_END:
+            out.write('</ret>\n')
+        elif op == BOOL:
+            out.write('<bool>%u</bool>' % (self.read('B') != 0))
+        elif op == INT:
+            out.write('<int>%i</int>' % self.read('q'))
+        elif op == UINT:
+            out.write('<uint>%u</uint>' % self.read('Q'))
+        elif op == FLOAT:
+            out.write('<float>%g</float>' % self.read('d'))
+        elif op == BYTES:
+            size = self.read('I')
+            data = self.fp.read(size)
+            out.write('<bytes>%s</bytes>' %
+                      ''.join('%02X' % b for b in bytearray(data)))
+        elif op == BYTES_HASH:
+            size = self.read('Q')
+            xxh64 = self.read('Q')
+            out.write("<bytes size='%u' hash='%016x'/>" % (size, xxh64))
+        elif op == STRING:
+            out.write('<string>%s</string>' % escape(self.read_string()))
+        elif op == ENUM:
+            out.write('<enum>%s</enum>' % escape(self.read_string()))
+        elif op == ARRAY_BEGIN:
+            out.write('<array>')
+        elif op == ARRAY_END:
+            out.write('</array>')
+        elif op == ELEM_BEGIN:
+            out.write('<elem>')
+        elif op == ELEM_END:
+            out.write('</elem>')
+        elif op == STRUCT_BEGIN:
+            out.write("<struct name='%s'>" % self.read_string())
+        elif op == STRUCT_END:
+            out.write('</struct>')
+        elif op == MEMBER_BEGIN:
+            out.write("<member name='%s'>" % self.read_string())
+        elif op == MEMBER_END:
+            out.write('</member>')
+        elif op == NULL:
+            out.write('<null/>')
+        elif op == PTR:
+            out.write('<ptr>0x%08x</ptr>' % self.read('Q'))
+        else:
+            raise ValueError('unknown opcode %u at offset %u' %
+                             (op, self.fp.tell() - 1))
+
+
+def main():
+    optparser = optparse.OptionParser(
+        usage='\n\t%prog [options] BINARY_TRACE [XML_TRACE]')
+    optparser.add_option(
+        '--big-endian',
+        action='store_true', dest='big_endian', default=False,
+        help='trace was captured on a big endian machine')
+    (options, args) = optparser.parse_args(sys.argv[1:])
+    if len(args) not in (1, 2):
+        optparser.error('incorrect number of arguments')
+
+    endian = '>' if options.big_endian else '<'
+    with open(args[0], 'rb') as fp:
+        if len(args) == 2:
+            with open(args[1], 'wt') as out:
+                BinaryTraceReader(fp, endian).convert(out)
+        else:
+            BinaryTraceReader(fp, endian).convert(sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
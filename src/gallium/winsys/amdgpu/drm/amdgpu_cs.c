@@ -410,45 +410,83 @@ static unsigned amdgpu_cs_epilog_dws(struct amdgpu_cs *cs)
    return 0;
 }
 
+static unsigned amdgpu_buffer_table_hash(struct amdgpu_cs_context *cs,
+                                         struct amdgpu_winsys_bo *bo)
+{
+   /* unique_id is sequential, so spread it with a multiplicative hash. */
+   return (bo->unique_id * 2654435761u) & (cs->buffer_table_size - 1);
+}
+
 int amdgpu_lookup_buffer(struct amdgpu_cs_context *cs, struct amdgpu_winsys_bo *bo)
 {
-   unsigned hash = bo->unique_id & (ARRAY_SIZE(cs->buffer_indices_hashlist)-1);
-   int i = cs->buffer_indices_hashlist[hash];
-   struct amdgpu_cs_buffer *buffers;
-   int num_buffers;
-
-   if (bo->bo) {
-      buffers = cs->real_buffers;
-      num_buffers = cs->num_real_buffers;
-   } else if (!bo->sparse) {
-      buffers = cs->slab_buffers;
-      num_buffers = cs->num_slab_buffers;
-   } else {
-      buffers = cs->sparse_buffers;
-      num_buffers = cs->num_sparse_buffers;
+   if (!cs->num_buffer_table_entries)
+      return -1;
+
+   unsigned mask = cs->buffer_table_size - 1;
+
+   for (unsigned i = amdgpu_buffer_table_hash(cs, bo);; i = (i + 1) & mask) {
+      struct amdgpu_buffer_table_entry *entry = &cs->buffer_table[i];
+
+      if (entry->generation != cs->buffer_table_generation)
+         return -1;
+      if (entry->bo == bo)
+         return entry->index;
    }
+}
 
-   /* not found or found */
-   if (i < 0 || (i < num_buffers && buffers[i].bo == bo))
-      return i;
-
-   /* Hash collision, look for the BO in the list of buffers linearly. */
-   for (i = num_buffers - 1; i >= 0; i--) {
-      if (buffers[i].bo == bo) {
-         /* Put this buffer in the hash list.
-          * This will prevent additional hash collisions if there are
-          * several consecutive lookup_buffer calls for the same buffer.
-          *
-          * Example: Assuming buffers A,B,C collide in the hash list,
-          * the following sequence of buffers:
-          *         AAAAAAAAAAABBBBBBBBBBBBBBCCCCCCCC
-          * will collide here: ^ and here:   ^,
-          * meaning that we should get very few collisions in the end. */
-         cs->buffer_indices_hashlist[hash] = i;
-         return i;
-      }
+static void amdgpu_buffer_table_insert(struct amdgpu_cs_context *cs,
+                                       struct amdgpu_winsys_bo *bo, int index)
+{
+   unsigned mask = cs->buffer_table_size - 1;
+   unsigned i = amdgpu_buffer_table_hash(cs, bo);
+
+   while (cs->buffer_table[i].generation == cs->buffer_table_generation)
+      i = (i + 1) & mask;
+
+   cs->buffer_table[i].bo = bo;
+   cs->buffer_table[i].index = index;
+   cs->buffer_table[i].generation = cs->buffer_table_generation;
+   cs->num_buffer_table_entries++;
+}
+
+/* Make sure that one more buffer can be added to the table, keeping the load
+ * factor at 1/2 at most.
+ */
+static bool amdgpu_buffer_table_reserve(struct amdgpu_cs_context *cs)
+{
+   if ((cs->num_buffer_table_entries + 1) * 2 <= cs->buffer_table_size)
+      return true;
+
+   struct amdgpu_buffer_table_entry *old_table = cs->buffer_table;
+   unsigned old_size = cs->buffer_table_size;
+   unsigned new_size = MAX2(old_size * 2, 4096);
+
+   cs->buffer_table = CALLOC(new_size, sizeof(*cs->buffer_table));
+   if (!cs->buffer_table) {
+      fprintf(stderr, "amdgpu_buffer_table_reserve: allocation failed\n");
+      cs->buffer_table = old_table;
+      return false;
+   }
+   cs->buffer_table_size = new_size;
+   cs->num_buffer_table_entries = 0;
+
+   for (unsigned i = 0; i < old_size; i++) {
+      if (old_table[i].generation == cs->buffer_table_generation)
+         amdgpu_buffer_table_insert(cs, old_table[i].bo, old_table[i].index);
+   }
+   FREE(old_table);
+   return true;
+}
+
+static void amdgpu_buffer_table_clear(struct amdgpu_cs_context *cs)
+{
+   cs->num_buffer_table_entries = 0;
+   /* On wrap-around, old entries could look valid again. */
+   if (++cs->buffer_table_generation == 0) {
+      if (cs->buffer_table)
+         memset(cs->buffer_table, 0, cs->buffer_table_size * sizeof(*cs->buffer_table));
+      cs->buffer_table_generation = 1;
    }
-   return -1;
 }
 
 static int
@@ -494,16 +532,19 @@ static int
 amdgpu_lookup_or_add_real_buffer(struct amdgpu_cs *acs, struct amdgpu_winsys_bo *bo)
 {
    struct amdgpu_cs_context *cs = acs->csc;
-   unsigned hash;
    int idx = amdgpu_lookup_buffer(cs, bo);
 
    if (idx >= 0)
       return idx;
 
+   if (!amdgpu_buffer_table_reserve(cs))
+      return -1;
+
    idx = amdgpu_do_add_real_buffer(cs, bo);
+   if (idx < 0)
+      return -1;
 
-   hash = bo->unique_id & (ARRAY_SIZE(cs->buffer_indices_hashlist)-1);
-   cs->buffer_indices_hashlist[hash] = idx;
+   amdgpu_buffer_table_insert(cs, bo, idx);
 
    if (bo->initial_domain & RADEON_DOMAIN_VRAM)
       acs->main.base.used_vram += bo->base.size;
@@ -518,7 +559,6 @@ static int amdgpu_lookup_or_add_slab_buffer(struct amdgpu_cs *acs,
 {
    struct amdgpu_cs_context *cs = acs->csc;
    struct amdgpu_cs_buffer *buffer;
-   unsigned hash;
    int idx = amdgpu_lookup_buffer(cs, bo);
    int real_idx;
 
@@ -529,6 +569,9 @@ static int amdgpu_lookup_or_add_slab_buffer(struct amdgpu_cs *acs,
    if (real_idx < 0)
       return -1;
 
+   if (!amdgpu_buffer_table_reserve(cs))
+      return -1;
+
    /* New buffer, check if the backing array is large enough. */
    if (cs->num_slab_buffers >= cs->max_slab_buffers) {
       unsigned new_max =
@@ -556,8 +599,7 @@ static int amdgpu_lookup_or_add_slab_buffer(struct amdgpu_cs *acs,
    p_atomic_inc(&bo->num_cs_references);
    cs->num_slab_buffers++;
 
-   hash = bo->unique_id & (ARRAY_SIZE(cs->buffer_indices_hashlist)-1);
-   cs->buffer_indices_hashlist[hash] = idx;
+   amdgpu_buffer_table_insert(cs, bo, idx);
 
    return idx;
 }
@@ -567,12 +609,14 @@ static int amdgpu_lookup_or_add_sparse_buffer(struct amdgpu_cs *acs,
 {
    struct amdgpu_cs_context *cs = acs->csc;
    struct amdgpu_cs_buffer *buffer;
-   unsigned hash;
    int idx = amdgpu_lookup_buffer(cs, bo);
 
    if (idx >= 0)
       return idx;
 
+   if (!amdgpu_buffer_table_reserve(cs))
+      return -1;
+
    /* New buffer, check if the backing array is large enough. */
    if (cs->num_sparse_buffers >= cs->max_sparse_buffers) {
       unsigned new_max =
@@ -599,8 +643,7 @@ static int amdgpu_lookup_or_add_sparse_buffer(struct amdgpu_cs *acs,
    p_atomic_inc(&bo->num_cs_references);
    cs->num_sparse_buffers++;
 
-   hash = bo->unique_id & (ARRAY_SIZE(cs->buffer_indices_hashlist)-1);
-   cs->buffer_indices_hashlist[hash] = idx;
+   amdgpu_buffer_table_insert(cs, bo, idx);
 
    /* We delay adding the backing buffers until we really have to. However,
     * we cannot delay accounting for memory use.
@@ -889,7 +932,7 @@ static bool amdgpu_init_cs_context(struct amdgpu_winsys *ws,
    cs->ib[IB_PARALLEL_COMPUTE].ip_type = AMDGPU_HW_IP_COMPUTE;
    cs->ib[IB_PARALLEL_COMPUTE].flags = AMDGPU_IB_FLAG_TC_WB_NOT_INVALIDATE;
 
-   memset(cs->buffer_indices_hashlist, -1, sizeof(cs->buffer_indices_hashlist));
+   cs->buffer_table_generation = 1;
    cs->last_added_bo = NULL;
    return true;
 }
@@ -928,7 +971,7 @@ static void amdgpu_cs_context_cleanup(struct amdgpu_cs_context *cs)
    cs->num_sparse_buffers = 0;
    amdgpu_fence_reference(&cs->fence, NULL);
 
-   memset(cs->buffer_indices_hashlist, -1, sizeof(cs->buffer_indices_hashlist));
+   amdgpu_buffer_table_clear(cs);
    cs->last_added_bo = NULL;
 }
 
@@ -938,6 +981,7 @@ static void amdgpu_destroy_cs_context(struct amdgpu_cs_context *cs)
    FREE(cs->real_buffers);
    FREE(cs->slab_buffers);
    FREE(cs->sparse_buffers);
+   FREE(cs->buffer_table);
    FREE(cs->fence_dependencies.list);
    FREE(cs->syncobj_dependencies.list);
    FREE(cs->syncobj_to_signal.list);
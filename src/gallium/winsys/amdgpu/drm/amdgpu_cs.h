@@ -88,6 +88,13 @@ struct amdgpu_fence_list {
    unsigned                    max;
 };
 
+struct amdgpu_buffer_table_entry {
+   struct amdgpu_winsys_bo     *bo;
+   int                         index;
+   /* The entry is empty if this isn't the table generation. */
+   uint32_t                    generation;
+};
+
 struct amdgpu_cs_context {
    struct drm_amdgpu_cs_chunk_ib ib[IB_NUM];
 
@@ -104,7 +111,14 @@ struct amdgpu_cs_context {
    unsigned                    max_sparse_buffers;
    struct amdgpu_cs_buffer     *sparse_buffers;
 
-   int                         buffer_indices_hashlist[4096];
+   /* Open-addressing hash table from BOs to their index in real_buffers,
+    * slab_buffers or sparse_buffers. It's cleared by bumping the
+    * generation.
+    */
+   struct amdgpu_buffer_table_entry *buffer_table;
+   unsigned                    buffer_table_size;
+   unsigned                    num_buffer_table_entries;
+   uint32_t                    buffer_table_generation;
 
    struct amdgpu_winsys_bo     *last_added_bo;
    unsigned                    last_added_bo_index;
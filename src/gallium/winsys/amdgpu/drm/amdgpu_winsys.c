@@ -258,6 +258,26 @@ static uint64_t amdgpu_query_value(struct radeon_winsys *rws,
       return retval;
    case RADEON_CS_THREAD_TIME:
       return util_queue_get_thread_time_nano(&ws->cs_queue, 0);
+   case RADEON_SLAB_UNUSED_MEMORY:
+      for (unsigned i = 0; i < NUM_SLAB_ALLOCATORS; i++) {
+         retval += pb_slabs_get_unused_size(&ws->bo_slabs[i]);
+         if (ws->secure)
+            retval += pb_slabs_get_unused_size(&ws->bo_slabs_encrypted[i]);
+      }
+      return retval;
+   case RADEON_NUM_SLAB_RECLAIM_CHECKS:
+      for (unsigned i = 0; i < NUM_SLAB_ALLOCATORS; i++) {
+         retval += ws->bo_slabs[i].num_reclaim_checks;
+         if (ws->secure)
+            retval += ws->bo_slabs_encrypted[i].num_reclaim_checks;
+      }
+      return retval;
+   case RADEON_BO_CACHE_HITS:
+      return ws->bo_cache.num_hits;
+   case RADEON_BO_CACHE_MISSES:
+      return ws->bo_cache.num_misses;
+   case RADEON_BO_CACHE_EVICTIONS:
+      return ws->bo_cache.num_evictions;
    }
    return 0;
 }
@@ -442,6 +462,13 @@ amdgpu_winsys_create(int fd, const struct pipe_screen_config *config,
                     (aws->info.vram_size + aws->info.gart_size) / 8,
                     amdgpu_bo_destroy, amdgpu_bo_can_reclaim);
 
+      uint64_t max_heap_cache_size =
+         debug_get_num_option("AMD_BO_CACHE_MAX_HEAP_SIZE", 0) * 1024 * 1024;
+      if (max_heap_cache_size) {
+         for (unsigned i = 0; i < RADEON_MAX_CACHED_HEAPS; i++)
+            pb_cache_set_heap_max_size(&aws->bo_cache, i, max_heap_cache_size);
+      }
+
       unsigned min_slab_order = 9;  /* 512 bytes */
       unsigned max_slab_order = 18; /* 256 KB - higher numbers increase memory usage */
       unsigned num_slab_orders_per_allocator = (max_slab_order - min_slab_order) /
@@ -745,6 +745,20 @@ static uint64_t radeon_query_value(struct radeon_winsys *rws,
       return retval;
    case RADEON_CS_THREAD_TIME:
       return util_queue_get_thread_time_nano(&ws->cs_queue, 0);
+   case RADEON_SLAB_UNUSED_MEMORY:
+      if (!ws->info.r600_has_virtual_memory)
+         return 0;
+      return pb_slabs_get_unused_size(&ws->bo_slabs);
+   case RADEON_NUM_SLAB_RECLAIM_CHECKS:
+      if (!ws->info.r600_has_virtual_memory)
+         return 0;
+      return ws->bo_slabs.num_reclaim_checks;
+   case RADEON_BO_CACHE_HITS:
+      return ws->bo_cache.num_hits;
+   case RADEON_BO_CACHE_MISSES:
+      return ws->bo_cache.num_misses;
+   case RADEON_BO_CACHE_EVICTIONS:
+      return ws->bo_cache.num_evictions;
    }
    return 0;
 }
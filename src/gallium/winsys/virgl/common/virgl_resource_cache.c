@@ -21,8 +21,11 @@
  * USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "virgl_resource_cache.h"
 #include "util/os_time.h"
+#include "util/u_debug.h"
 
 /* Checks whether the resource represented by a cache entry is able to hold
  * data of the specified size, bind and format.
@@ -46,6 +49,8 @@ virgl_resource_cache_entry_release(struct virgl_resource_cache *cache,
                                    struct virgl_resource_cache_entry *entry)
 {
       list_del(&entry->head);
+      cache->size -= entry->size;
+      cache->stats.evictions++;
       cache->entry_release_func(entry, cache->user_data);
 }
 
@@ -72,6 +77,10 @@ virgl_resource_cache_init(struct virgl_resource_cache *cache,
 {
    list_inithead(&cache->resources);
    cache->timeout_usecs = timeout_usecs;
+   cache->size = 0;
+   cache->max_size = debug_get_num_option("VIRGL_RESOURCE_CACHE_MB", 0) *
+                     1024 * 1024;
+   memset(&cache->stats, 0, sizeof(cache->stats));
    cache->entry_is_busy_func = is_busy_func;
    cache->entry_release_func = destroy_func;
    cache->user_data = user_data;
@@ -92,6 +101,15 @@ virgl_resource_cache_add(struct virgl_resource_cache *cache,
    entry->timeout_start = now;
    entry->timeout_end = entry->timeout_start + cache->timeout_usecs;
    list_addtail(&entry->head, &cache->resources);
+   cache->size += entry->size;
+
+   /* Over budget, drop the oldest resources first. */
+   while (cache->max_size && cache->size > cache->max_size) {
+      struct virgl_resource_cache_entry *oldest =
+         list_first_entry(&cache->resources,
+                          struct virgl_resource_cache_entry, head);
+      virgl_resource_cache_entry_release(cache, oldest);
+   }
 }
 
 struct virgl_resource_cache_entry *
@@ -134,8 +152,13 @@ virgl_resource_cache_remove_compatible(struct virgl_resource_cache *cache,
       }
    }
 
-   if (compat_entry)
+   if (compat_entry) {
       list_del(&compat_entry->head);
+      cache->size -= compat_entry->size;
+      cache->stats.hits++;
+   } else {
+      cache->stats.misses++;
+   }
 
    return compat_entry;
 }
@@ -27,6 +27,8 @@
 #include <stdint.h>
 
 #include "util/list.h"
+#include "util/u_math.h"
+#include "virgl/virgl_winsys.h"
 
 struct virgl_resource_cache_entry {
    struct list_head head;
@@ -52,6 +54,9 @@ typedef void (*virgl_resource_cache_entry_release_func) (
 struct virgl_resource_cache {
    struct list_head resources;
    unsigned timeout_usecs;
+   uint64_t size;       /* Total size of the cached resources */
+   uint64_t max_size;   /* 0 for no limit, see VIRGL_RESOURCE_CACHE_MB */
+   struct virgl_resource_cache_stats stats;
    virgl_resource_cache_entry_is_busy_func entry_is_busy_func;
    virgl_resource_cache_entry_release_func entry_release_func;
    void *user_data;
@@ -87,6 +92,24 @@ virgl_resource_cache_remove_compatible(struct virgl_resource_cache *cache,
 void
 virgl_resource_cache_flush(struct virgl_resource_cache *cache);
 
+/** Rounds up the size of a cacheable resource, so that resources created
+ *  for similar sizes can later be reused for each other.
+ *
+ *  Small sizes are rounded to pages, larger ones to quarters of a power of
+ *  two, which wastes less than 25%.
+ */
+static inline uint32_t
+virgl_resource_cache_size_class(uint32_t size)
+{
+   if (size <= 64 * 1024)
+      return align(size, 4096);
+
+   if (size > (1u << 31))
+      return size;
+
+   return align(size, util_next_power_of_two(size) / 8);
+}
+
 static inline void
 virgl_resource_cache_entry_init(struct virgl_resource_cache_entry *entry,
                                 uint32_t size, uint32_t bind,
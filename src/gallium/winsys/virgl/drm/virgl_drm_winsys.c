@@ -295,6 +295,14 @@ virgl_drm_winsys_resource_cache_create(struct virgl_winsys *qws,
    mtx_unlock(&qdws->mutex);
 
 alloc:
+   /* Round up buffer sizes so the resource can be reused for similar
+    * sizes once it gets released to the cache.
+    */
+   if (target == PIPE_BUFFER && can_cache_resource_with_bind(bind)) {
+      size = virgl_resource_cache_size_class(size);
+      width = size;
+   }
+
    res = virgl_drm_winsys_resource_create(qws, target, format, bind,
                                            width, height, depth, array_size,
                                            last_level, nr_samples, size, false);
@@ -933,6 +941,17 @@ virgl_drm_resource_cache_entry_release(struct virgl_resource_cache_entry *entry,
    virgl_hw_res_destroy(qdws, res);
 }
 
+static void
+virgl_drm_get_resource_cache_stats(struct virgl_winsys *qws,
+                                  struct virgl_resource_cache_stats *stats)
+{
+   struct virgl_drm_winsys *qdws = virgl_drm_winsys(qws);
+
+   mtx_lock(&qdws->mutex);
+   *stats = qdws->cache.stats;
+   mtx_unlock(&qdws->mutex);
+}
+
 static struct virgl_winsys *
 virgl_drm_winsys_create(int drmFD)
 {
@@ -992,6 +1011,7 @@ virgl_drm_winsys_create(int drmFD)
    qdws->base.supports_encoded_transfers = 1;
 
    qdws->base.get_caps = virgl_drm_get_caps;
+   qdws->base.get_resource_cache_stats = virgl_drm_get_resource_cache_stats;
 
    uint32_t value = 0;
    getparam.param = VIRTGPU_PARAM_CAPSET_QUERY_FIX;
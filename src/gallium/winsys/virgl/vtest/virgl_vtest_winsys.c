@@ -370,6 +370,14 @@ virgl_vtest_winsys_resource_cache_create(struct virgl_winsys *vws,
    mtx_unlock(&vtws->mutex);
 
 alloc:
+   /* Round up buffer sizes so the resource can be reused for similar
+    * sizes once it gets released to the cache.
+    */
+   if (target == PIPE_BUFFER && can_cache_resource_with_bind(bind)) {
+      size = virgl_resource_cache_size_class(size);
+      width = size;
+   }
+
    res = virgl_vtest_winsys_resource_create(vws, target, format, bind,
                                             width, height, depth, array_size,
                                             last_level, nr_samples, size);
@@ -648,6 +656,17 @@ virgl_vtest_resource_cache_entry_release(struct virgl_resource_cache_entry *entr
    virgl_hw_res_destroy(vtws, res);
 }
 
+static void
+virgl_vtest_get_resource_cache_stats(struct virgl_winsys *vws,
+                                     struct virgl_resource_cache_stats *stats)
+{
+   struct virgl_vtest_winsys *vtws = virgl_vtest_winsys(vws);
+
+   mtx_lock(&vtws->mutex);
+   *stats = vtws->cache.stats;
+   mtx_unlock(&vtws->mutex);
+}
+
 struct virgl_winsys *
 virgl_vtest_winsys_wrap(struct sw_winsys *sws)
 {
@@ -684,6 +703,8 @@ virgl_vtest_winsys_wrap(struct sw_winsys *sws)
    vtws->base.emit_res = virgl_vtest_emit_res;
    vtws->base.res_is_referenced = virgl_vtest_res_is_ref;
    vtws->base.get_caps = virgl_vtest_get_caps;
+   vtws->base.get_resource_cache_stats =
+      virgl_vtest_get_resource_cache_stats;
 
    vtws->base.cs_create_fence = virgl_cs_create_fence;
    vtws->base.fence_wait = virgl_fence_wait;
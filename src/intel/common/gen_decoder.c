@@ -590,6 +590,7 @@ gen_spec_init(void)
       _mesa_hash_table_create(spec, _mesa_hash_string, _mesa_key_string_equal);
    spec->access_cache =
       _mesa_hash_table_create(spec, _mesa_hash_string, _mesa_key_string_equal);
+   spec->commands_by_opcode = _mesa_hash_table_u64_create(spec);
 
    return spec;
 }
@@ -761,15 +762,41 @@ gen_spec_find_instruction(struct gen_spec *spec,
                           enum drm_i915_gem_engine_class engine,
                           const uint32_t *p)
 {
+   /* Stands for "no such instruction" in commands_by_opcode. */
+   static char unknown_command;
+
+   /* Which command matches only depends on the engine and on the bits that
+    * are part of some command's opcode, so we only have to go through all
+    * the commands once for each combination of those.
+    */
+   if (spec->commands_opcode_mask == 0) {
+      hash_table_foreach(spec->commands, entry) {
+         struct gen_group *command = entry->data;
+         spec->commands_opcode_mask |= command->opcode_mask;
+      }
+   }
+
+   uint64_t key = ((uint64_t) engine << 32) |
+                  (*p & spec->commands_opcode_mask);
+   void *cached = _mesa_hash_table_u64_search(spec->commands_by_opcode, key);
+   if (cached)
+      return cached == &unknown_command ? NULL : cached;
+
+   struct gen_group *found = NULL;
    hash_table_foreach(spec->commands, entry) {
       struct gen_group *command = entry->data;
       uint32_t opcode = *p & command->opcode_mask;
       if ((command->engine_mask & I915_ENGINE_CLASS_TO_MASK(engine)) &&
-           opcode == command->opcode)
-         return command;
+           opcode == command->opcode) {
+         found = command;
+         break;
+      }
    }
 
-   return NULL;
+   _mesa_hash_table_u64_insert(spec->commands_by_opcode, key,
+                               found ? (void *) found : &unknown_command);
+
+   return found;
 }
 
 struct gen_field *
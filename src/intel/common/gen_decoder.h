@@ -107,6 +107,12 @@ struct gen_spec {
    struct hash_table *enums;
 
    struct hash_table *access_cache;
+
+   /* Results of gen_spec_find_instruction(), keyed by engine and the opcode
+    * bits of the first dword.
+    */
+   struct hash_table_u64 *commands_by_opcode;
+   uint32_t commands_opcode_mask;
 };
 
 struct gen_group {
@@ -29,6 +29,26 @@
 #include "main/errors.h"
 #include "util/debug.h"
 
+static unsigned
+brw_loop_unroll_factor(const nir_shader *nir, const nir_loop *loop,
+                       unsigned trip_count, unsigned default_factor)
+{
+   if (default_factor > 0 || nir->info.stage != MESA_SHADER_COMPUTE)
+      return default_factor;
+
+   /* Small compute loops with a trip count only known at run time spend a
+    * good part of their time on the loop overhead.  Doubling or quadrupling
+    * their bodies amortizes that, and gives the scheduler more to work with,
+    * while keeping the extra register pressure and code size in check.
+    */
+   if (loop->info->instr_cost <= 16)
+      return 4;
+   if (loop->info->instr_cost <= 64)
+      return 2;
+
+   return 0;
+}
+
 #define COMMON_OPTIONS                                                        \
    .lower_sub = true,                                                         \
    .lower_fdiv = true,                                                        \
@@ -50,7 +70,8 @@
    .lower_base_vertex = true,                                                 \
    .use_scoped_barrier = true,                                                \
    .support_8bit_alu = true,                                                  \
-   .support_16bit_alu = true
+   .support_16bit_alu = true,                                                 \
+   .algebraic_worklist = true
 
 #define COMMON_SCALAR_OPTIONS                                                 \
    .lower_to_scalar = true,                                                   \
@@ -67,7 +88,8 @@
    .lower_usub_sat64 = true,                                                  \
    .lower_hadd64 = true,                                                      \
    .lower_bfe_with_two_constants = true,                                      \
-   .max_unroll_iterations = 32
+   .max_unroll_iterations = 32,                                               \
+   .loop_unroll_factor = brw_loop_unroll_factor
 
 static const struct nir_shader_compiler_options scalar_nir_options = {
    COMMON_OPTIONS,
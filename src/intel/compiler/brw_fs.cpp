@@ -8626,7 +8626,7 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
 
    fs_visitor *v8 = NULL, *v16 = NULL, *v32 = NULL;
    cfg_t *simd8_cfg = NULL, *simd16_cfg = NULL, *simd32_cfg = NULL;
-   float throughput = 0;
+   float throughput = 0, throughput8 = 0, throughput16 = 0;
    bool has_spilled = false;
 
    v8 = new fs_visitor(compiler, log_data, mem_ctx, &key->base,
@@ -8642,6 +8642,7 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
       prog_data->base.dispatch_grf_start_reg = v8->payload.num_regs;
       prog_data->reg_blocks_8 = brw_register_blocks(v8->grf_used);
       const performance &perf = v8->performance_analysis.require();
+      throughput8 = perf.throughput;
       throughput = MAX2(throughput, perf.throughput);
       has_spilled = v8->spilled_any_registers;
       allow_spilling = false;
@@ -8673,6 +8674,7 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
          prog_data->dispatch_grf_start_reg_16 = v16->payload.num_regs;
          prog_data->reg_blocks_16 = brw_register_blocks(v16->grf_used);
          const performance &perf = v16->performance_analysis.require();
+         throughput16 = perf.throughput;
          throughput = MAX2(throughput, perf.throughput);
          has_spilled = v16->spilled_any_registers;
          allow_spilling = false;
@@ -8681,8 +8683,21 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
 
    const bool simd16_failed = v16 && !simd16_cfg;
 
+   /* If going from SIMD8 to SIMD16 didn't improve the estimated throughput,
+    * going to SIMD32 is very unlikely to, and a SIMD32 program is only kept
+    * when it beats the best estimate so far.  Don't spend the time compiling
+    * it.
+    */
+   const bool simd32_unprofitable =
+      simd8_cfg && simd16_cfg && throughput16 <= throughput8 &&
+      !(INTEL_DEBUG & DEBUG_DO32);
+   if (simd32_unprofitable) {
+      compiler->shader_perf_log(log_data, "SIMD32 shader skipped: SIMD16 "
+                                "was no faster than SIMD8\n");
+   }
+
    /* Currently, the compiler only supports SIMD32 on SNB+ */
-   if (!has_spilled &&
+   if (!has_spilled && !simd32_unprofitable &&
        v8->max_dispatch_width >= 32 && !use_rep_send &&
        devinfo->gen >= 6 && !simd16_failed &&
        !(INTEL_DEBUG & DEBUG_NO32)) {
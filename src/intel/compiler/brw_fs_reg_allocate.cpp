@@ -32,6 +32,12 @@
 
 using namespace brw;
 
+/* Once allocation has failed repeatedly, spill this many more registers per
+ * round for every this many already spilled, so that shaders which need lots
+ * of spills don't go through one allocation attempt per spilled register.
+ */
+#define SPILL_BATCH_RATE 4
+
 static void
 assign_reg(unsigned *reg_hw_locations, fs_reg *reg)
 {
@@ -1168,7 +1174,7 @@ fs_reg_alloc::assign_regs(bool allow_spilling, bool spill_all)
 {
    build_interference_graph(fs->spilled_any_registers || spill_all);
 
-   bool spilled = false;
+   unsigned spilled = 0;
    while (1) {
       /* Debug of register spilling: Go spill everything. */
       if (unlikely(spill_all)) {
@@ -1179,30 +1185,41 @@ fs_reg_alloc::assign_regs(bool allow_spilling, bool spill_all)
          }
       }
 
-      if (ra_allocate(g))
+      /* The graph is kept across spills, so let the allocator reuse
+       * whatever part of the previous coloring is still valid.
+       */
+      if (ra_allocate_incremental(g))
          break;
 
       if (!allow_spilling)
          return false;
 
-      /* Failed to allocate registers.  Spill a reg, and the caller will
-       * loop back into here to try again.
+      /* Failed to allocate registers.  Spill some regs, and loop back to
+       * try again.  The first few rounds spill a single register so that
+       * shaders which barely don't fit get as few spills as possible.
        */
-      int reg = choose_spill_reg();
-      if (reg == -1)
-         return false;
+      const unsigned nr_spills = MAX2(1, spilled / SPILL_BATCH_RATE);
 
-      /* If we're going to spill but we've never spilled before, we need to
-       * re-build the interference graph with MRFs enabled to allow spilling.
-       */
-      if (!fs->spilled_any_registers) {
-         discard_interference_graph();
-         build_interference_graph(true);
-      }
+      for (unsigned i = 0; i < nr_spills; i++) {
+         int reg = choose_spill_reg();
+         if (reg == -1) {
+            if (i == 0)
+               return false;
+            break;
+         }
 
-      spilled = true;
+         /* If we're going to spill but we've never spilled before, we need
+          * to re-build the interference graph with MRFs enabled to allow
+          * spilling.
+          */
+         if (!fs->spilled_any_registers) {
+            discard_interference_graph();
+            build_interference_graph(true);
+         }
 
-      spill_reg(reg);
+         spill_reg(reg);
+         spilled++;
+      }
    }
 
    if (spilled)
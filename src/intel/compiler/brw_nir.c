@@ -26,6 +26,7 @@
 #include "dev/gen_debug.h"
 #include "compiler/glsl_types.h"
 #include "compiler/nir/nir_builder.h"
+#include "compiler/nir/nir_pass_manager.h"
 #include "util/u_math.h"
 
 static bool
@@ -497,39 +498,53 @@ brw_nir_optimize(nir_shader *nir, const struct brw_compiler *compiler,
       (nir->options->lower_flrp32 ? 32 : 0) |
       (nir->options->lower_flrp64 ? 64 : 0);
 
+   /* Passes which made no progress are skipped until some other pass
+    * changes the shader.
+    */
+   nir_pass_manager pm;
+   nir_pass_manager_init(&pm, nir, "brw_nir_optimize");
+
+#define LOOP_OPT(pass, ...) ({                             \
+   bool this_progress = false;                             \
+   NIR_PM_PASS(this_progress, &pm, pass, ##__VA_ARGS__);   \
+   if (this_progress)                                      \
+      progress = true;                                     \
+   this_progress;                                          \
+})
+
    do {
       progress = false;
-      OPT(nir_split_array_vars, nir_var_function_temp);
-      OPT(nir_shrink_vec_array_vars, nir_var_function_temp);
-      OPT(nir_opt_deref);
-      OPT(nir_lower_vars_to_ssa);
+      LOOP_OPT(nir_split_array_vars, nir_var_function_temp);
+      LOOP_OPT(nir_shrink_vec_array_vars, nir_var_function_temp);
+      LOOP_OPT(nir_opt_deref);
+      LOOP_OPT(nir_lower_vars_to_ssa);
       if (allow_copies) {
          /* Only run this pass in the first call to brw_nir_optimize.  Later
           * calls assume that we've lowered away any copy_deref instructions
           * and we don't want to introduce any more.
           */
-         OPT(nir_opt_find_array_copies);
+         LOOP_OPT(nir_opt_find_array_copies);
       }
-      OPT(nir_opt_copy_prop_vars);
-      OPT(nir_opt_dead_write_vars);
-      OPT(nir_opt_combine_stores, nir_var_all);
+      LOOP_OPT(nir_opt_copy_prop_vars);
+      LOOP_OPT(nir_opt_dead_write_vars);
+      LOOP_OPT(nir_opt_combine_stores, nir_var_all);
 
       if (is_scalar) {
-         OPT(nir_lower_alu_to_scalar, NULL, NULL);
+         LOOP_OPT(nir_lower_alu_to_scalar, NULL, NULL);
       } else {
-         OPT(nir_opt_shrink_vectors);
+         LOOP_OPT(nir_opt_shrink_vectors);
       }
 
-      OPT(nir_copy_prop);
+      LOOP_OPT(nir_copy_prop);
 
       if (is_scalar) {
-         OPT(nir_lower_phis_to_scalar);
+         LOOP_OPT(nir_lower_phis_to_scalar);
       }
 
-      OPT(nir_copy_prop);
-      OPT(nir_opt_dce);
-      OPT(nir_opt_cse);
-      OPT(nir_opt_combine_stores, nir_var_all);
+      LOOP_OPT(nir_copy_prop);
+      LOOP_OPT(nir_opt_dce);
+      LOOP_OPT(nir_opt_cse);
+      LOOP_OPT(nir_opt_combine_stores, nir_var_all);
 
       /* Passing 0 to the peephole select pass causes it to convert
        * if-statements that contain only move instructions in the branches
@@ -551,21 +566,26 @@ brw_nir_optimize(nir_shader *nir, const struct brw_compiler *compiler,
       const bool is_vec4_tessellation = !is_scalar &&
          (nir->info.stage == MESA_SHADER_TESS_CTRL ||
           nir->info.stage == MESA_SHADER_TESS_EVAL);
-      OPT(nir_opt_peephole_select, 0, !is_vec4_tessellation, false);
-      OPT(nir_opt_peephole_select, 8, !is_vec4_tessellation,
-          compiler->devinfo->gen >= 6);
+      LOOP_OPT(nir_opt_peephole_select, 0, !is_vec4_tessellation, false);
+      LOOP_OPT(nir_opt_peephole_select, 8, !is_vec4_tessellation,
+               compiler->devinfo->gen >= 6);
 
-      OPT(nir_opt_intrinsics);
-      OPT(nir_opt_idiv_const, 32);
-      OPT(nir_opt_algebraic);
-      OPT(nir_opt_constant_folding);
+      /* Do this after the peephole selects so it doesn't stop them from
+       * flattening ifs by adding instructions to their arms.
+       */
+      LOOP_OPT(nir_opt_gvn_pre);
+
+      LOOP_OPT(nir_opt_intrinsics);
+      LOOP_OPT(nir_opt_idiv_const, 32);
+      LOOP_OPT(nir_opt_algebraic);
+      LOOP_OPT(nir_opt_constant_folding);
 
       if (lower_flrp != 0) {
-         if (OPT(nir_lower_flrp,
-                 lower_flrp,
-                 false /* always_precise */,
-                 compiler->devinfo->gen >= 6)) {
-            OPT(nir_opt_constant_folding);
+         if (LOOP_OPT(nir_lower_flrp,
+                      lower_flrp,
+                      false /* always_precise */,
+                      compiler->devinfo->gen >= 6)) {
+            LOOP_OPT(nir_opt_constant_folding);
          }
 
          /* Nothing should rematerialize any flrps, so we only need to do this
@@ -574,25 +594,28 @@ brw_nir_optimize(nir_shader *nir, const struct brw_compiler *compiler,
          lower_flrp = 0;
       }
 
-      OPT(nir_opt_dead_cf);
-      if (OPT(nir_opt_trivial_continues)) {
+      LOOP_OPT(nir_opt_dead_cf);
+      if (LOOP_OPT(nir_opt_trivial_continues)) {
          /* If nir_opt_trivial_continues makes progress, then we need to clean
           * things up if we want any hope of nir_opt_if or nir_opt_loop_unroll
           * to make progress.
           */
-         OPT(nir_copy_prop);
-         OPT(nir_opt_dce);
+         LOOP_OPT(nir_copy_prop);
+         LOOP_OPT(nir_opt_dce);
       }
-      OPT(nir_opt_if, false);
-      OPT(nir_opt_conditional_discard);
+      LOOP_OPT(nir_opt_if, false);
+      LOOP_OPT(nir_opt_conditional_discard);
       if (nir->options->max_unroll_iterations != 0) {
-         OPT(nir_opt_loop_unroll, indirect_mask);
+         LOOP_OPT(nir_opt_loop_unroll, indirect_mask);
       }
-      OPT(nir_opt_remove_phis);
-      OPT(nir_opt_undef);
-      OPT(nir_lower_pack);
+      LOOP_OPT(nir_opt_remove_phis);
+      LOOP_OPT(nir_opt_undef);
+      LOOP_OPT(nir_lower_pack);
    } while (progress);
 
+#undef LOOP_OPT
+   nir_pass_manager_finish(&pm);
+
    /* Workaround Gfxbench unused local sampler variable which will trigger an
     * assert in the opt_large_constants pass.
     */
@@ -955,6 +978,14 @@ brw_postprocess_nir(nir_shader *nir, const struct brw_compiler *compiler,
           compiler->devinfo->gen >= 6);
    }
 
+   /* Subgroup operations on values which are uniform across the subgroup
+    * cost a FIND_LIVE_CHANNEL/BROADCAST or a reduction tree per use.
+    */
+   if (is_scalar && OPT(nir_opt_uniform_subgroup, 0)) {
+      OPT(nir_copy_prop);
+      OPT(nir_opt_dce);
+   }
+
    do {
       progress = false;
       if (OPT(nir_opt_algebraic_late)) {
@@ -26,6 +26,7 @@
 #include <stdio.h>
 
 #include "genxml/genX_bits.h"
+#include "util/u_cpu_detect.h"
 
 #include "isl.h"
 #include "isl_gen4.h"
@@ -36,6 +37,22 @@
 #include "isl_gen12.h"
 #include "isl_priv.h"
 
+#ifdef USE_ISL_TILED_MEMCPY_AVX2
+/**
+ * Whether to use the AVX2 tiled memcpy variant, which is only faster than
+ * the others for the swizzling and streaming copies.
+ */
+static bool
+use_avx2_tiled_memcpy(isl_memcpy_type copy_type)
+{
+   if (copy_type == ISL_MEMCPY)
+      return false;
+
+   util_cpu_detect();
+   return util_cpu_caps.has_avx2;
+}
+#endif
+
 void
 isl_memcpy_linear_to_tiled(uint32_t xt1, uint32_t xt2,
                            uint32_t yt1, uint32_t yt2,
@@ -45,6 +62,15 @@ isl_memcpy_linear_to_tiled(uint32_t xt1, uint32_t xt2,
                            enum isl_tiling tiling,
                            isl_memcpy_type copy_type)
 {
+#ifdef USE_ISL_TILED_MEMCPY_AVX2
+   if (use_avx2_tiled_memcpy(copy_type)) {
+      _isl_memcpy_linear_to_tiled_avx2(
+         xt1, xt2, yt1, yt2, dst, src, dst_pitch, src_pitch, has_swizzling,
+         tiling, copy_type);
+      return;
+   }
+#endif
+
 #ifdef USE_SSE41
    if (copy_type == ISL_MEMCPY_STREAMING_LOAD) {
       _isl_memcpy_linear_to_tiled_sse41(
@@ -68,6 +94,15 @@ isl_memcpy_tiled_to_linear(uint32_t xt1, uint32_t xt2,
                            enum isl_tiling tiling,
                            isl_memcpy_type copy_type)
 {
+#ifdef USE_ISL_TILED_MEMCPY_AVX2
+   if (use_avx2_tiled_memcpy(copy_type)) {
+      _isl_memcpy_tiled_to_linear_avx2(
+         xt1, xt2, yt1, yt2, dst, src, dst_pitch, src_pitch, has_swizzling,
+         tiling, copy_type);
+      return;
+   }
+#endif
+
 #ifdef USE_SSE41
    if (copy_type == ISL_MEMCPY_STREAMING_LOAD) {
       _isl_memcpy_tiled_to_linear_sse41(
@@ -36,10 +36,14 @@
 
 #include "isl_priv.h"
 
-#if defined(__SSSE3__)
+#if defined(INLINE_AVX2)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
 #include <tmmintrin.h>
 #elif defined(__SSE2__)
 #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
 #endif
 
 #define FILE_DEBUG_FLAG DEBUG_TEXTURE
@@ -100,10 +104,12 @@ rgba8_copy(void *dst, const void *src, size_t bytes)
    return dst;
 }
 
-#ifdef __SSSE3__
 static const uint8_t rgba8_permutation[16] =
    { 2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15 };
 
+#ifdef __SSSE3__
+#define HAVE_RGBA8_COPY_16
+
 static inline void
 rgba8_copy_16_aligned_dst(void *dst, const void *src)
 {
@@ -121,6 +127,8 @@ rgba8_copy_16_aligned_src(void *dst, const void *src)
 }
 
 #elif defined(__SSE2__)
+#define HAVE_RGBA8_COPY_16
+
 static inline void
 rgba8_copy_16_aligned_dst(void *dst, const void *src)
 {
@@ -154,6 +162,35 @@ rgba8_copy_16_aligned_src(void *dst, const void *src)
 
    _mm_storeu_si128((__m128i *)dst, dstreg);
 }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define HAVE_RGBA8_COPY_16
+
+static inline void
+rgba8_copy_16_aligned_dst(void *dst, const void *src)
+{
+   vst1q_u8(dst, vqtbl1q_u8(vld1q_u8(src), vld1q_u8(rgba8_permutation)));
+}
+
+static inline void
+rgba8_copy_16_aligned_src(void *dst, const void *src)
+{
+   vst1q_u8(dst, vqtbl1q_u8(vld1q_u8(src), vld1q_u8(rgba8_permutation)));
+}
+#endif
+
+#if defined(INLINE_AVX2)
+/**
+ * Copy RGBA to BGRA for 32 bytes, with no alignment requirements.
+ */
+static inline void
+rgba8_copy_32(void *dst, const void *src)
+{
+   const __m256i perm =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)rgba8_permutation));
+
+   _mm256_storeu_si256(dst, _mm256_shuffle_epi8(_mm256_loadu_si256(src), perm));
+}
 #endif
 
 /**
@@ -164,7 +201,15 @@ rgba8_copy_aligned_dst(void *dst, const void *src, size_t bytes)
 {
    assert(bytes == 0 || !(((uintptr_t)dst) & 0xf));
 
-#if defined(__SSSE3__) || defined(__SSE2__)
+#if defined(INLINE_AVX2)
+   if (bytes == 64) {
+      rgba8_copy_32(dst +  0, src +  0);
+      rgba8_copy_32(dst + 32, src + 32);
+      return dst;
+   }
+#endif
+
+#ifdef HAVE_RGBA8_COPY_16
    if (bytes == 64) {
       rgba8_copy_16_aligned_dst(dst +  0, src +  0);
       rgba8_copy_16_aligned_dst(dst + 16, src + 16);
@@ -194,7 +239,15 @@ rgba8_copy_aligned_src(void *dst, const void *src, size_t bytes)
 {
    assert(bytes == 0 || !(((uintptr_t)src) & 0xf));
 
-#if defined(__SSSE3__) || defined(__SSE2__)
+#if defined(INLINE_AVX2)
+   if (bytes == 64) {
+      rgba8_copy_32(dst +  0, src +  0);
+      rgba8_copy_32(dst + 32, src + 32);
+      return dst;
+   }
+#endif
+
+#ifdef HAVE_RGBA8_COPY_16
    if (bytes == 64) {
       rgba8_copy_16_aligned_src(dst +  0, src +  0);
       rgba8_copy_16_aligned_src(dst + 16, src + 16);
@@ -577,6 +630,14 @@ _memcpy_streaming_load(void *dest, const void *src, size_t count)
       __m128i val = _mm_stream_load_si128((__m128i *)src);
       _mm_storeu_si128((__m128i *)dest, val);
       return dest;
+#if defined(INLINE_AVX2)
+   } else if (count == 64) {
+      __m256i val0 = _mm256_stream_load_si256(((__m256i *)src) + 0);
+      __m256i val1 = _mm256_stream_load_si256(((__m256i *)src) + 1);
+      _mm256_storeu_si256(((__m256i *)dest) + 0, val0);
+      _mm256_storeu_si256(((__m256i *)dest) + 1, val1);
+      return dest;
+#else
    } else if (count == 64) {
       __m128i val0 = _mm_stream_load_si128(((__m128i *)src) + 0);
       __m128i val1 = _mm_stream_load_si128(((__m128i *)src) + 1);
@@ -587,6 +648,7 @@ _memcpy_streaming_load(void *dest, const void *src, size_t count)
       _mm_storeu_si128(((__m128i *)dest) + 2, val2);
       _mm_storeu_si128(((__m128i *)dest) + 3, val3);
       return dest;
+#endif
    } else {
       assert(count < 64); /* and (count < 16) for ytiled */
       return memcpy(dest, src, count);
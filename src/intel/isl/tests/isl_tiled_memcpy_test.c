@@ -0,0 +1,388 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checks every tiled memcpy variant built for this CPU against a simple
+ * reference, and against each other with swizzling enabled.
+ *
+ * With --bench, times the variants instead, for each tiling, copy type and
+ * surface width.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "isl/isl.h"
+#include "isl/isl_priv.h"
+
+// An assert that works regardless of NDEBUG.
+#define t_assert(cond) \
+   do { \
+      if (!(cond)) { \
+         fprintf(stderr, "%s:%d: assertion failed\n", __FILE__, __LINE__); \
+         abort(); \
+      } \
+   } while (0)
+
+#define SURF_PITCH  2048 /* bytes, a multiple of both tile widths */
+#define SURF_HEIGHT 64   /* rows, a multiple of both tile heights */
+#define FILL        0xcd
+
+typedef void (*linear_to_tiled_fn)(uint32_t xt1, uint32_t xt2,
+                                   uint32_t yt1, uint32_t yt2,
+                                   char *dst, const char *src,
+                                   uint32_t dst_pitch, int32_t src_pitch,
+                                   bool has_swizzling,
+                                   enum isl_tiling tiling,
+                                   isl_memcpy_type copy_type);
+
+typedef void (*tiled_to_linear_fn)(uint32_t xt1, uint32_t xt2,
+                                   uint32_t yt1, uint32_t yt2,
+                                   char *dst, const char *src,
+                                   int32_t dst_pitch, uint32_t src_pitch,
+                                   bool has_swizzling,
+                                   enum isl_tiling tiling,
+                                   isl_memcpy_type copy_type);
+
+struct variant {
+   const char *name;
+   linear_to_tiled_fn linear_to_tiled;
+   tiled_to_linear_fn tiled_to_linear;
+   bool has_streaming_load;
+   bool needs_avx2;
+};
+
+static const struct variant variants[] = {
+   { "normal", _isl_memcpy_linear_to_tiled, _isl_memcpy_tiled_to_linear,
+     false, false },
+#ifdef USE_SSE41
+   { "sse41", _isl_memcpy_linear_to_tiled_sse41,
+     _isl_memcpy_tiled_to_linear_sse41, true, false },
+#endif
+#ifdef USE_ISL_TILED_MEMCPY_AVX2
+   { "avx2", _isl_memcpy_linear_to_tiled_avx2,
+     _isl_memcpy_tiled_to_linear_avx2, true, true },
+#endif
+};
+
+static const struct {
+   uint32_t x1, x2, y1, y2;
+} regions[] = {
+   { 0, SURF_PITCH, 0, SURF_HEIGHT },
+   { 4, SURF_PITCH - 4, 1, SURF_HEIGHT - 3 },
+   { 60, 132, 5, 37 },
+   { 508, 1540, 7, 9 },
+   { 0, 64, 0, 1 },
+   { 16, 20, 31, 33 },
+};
+
+static const char *
+tiling_name(enum isl_tiling tiling)
+{
+   return tiling == ISL_TILING_X ? "X" : "Y";
+}
+
+static const char *
+copy_type_name(isl_memcpy_type copy_type)
+{
+   switch (copy_type) {
+   case ISL_MEMCPY:                return "memcpy";
+   case ISL_MEMCPY_BGRA8:          return "bgra8";
+   case ISL_MEMCPY_STREAMING_LOAD: return "streaming";
+   default:                        return "invalid";
+   }
+}
+
+static bool
+variant_supported(const struct variant *v)
+{
+   util_cpu_detect();
+   return !v->needs_avx2 || util_cpu_caps.has_avx2;
+}
+
+/** Offset of byte x of row y in a tiled surface, without swizzling. */
+static uint32_t
+tiled_offset(enum isl_tiling tiling, uint32_t x, uint32_t y)
+{
+   if (tiling == ISL_TILING_X) {
+      uint32_t tile = (y / 8) * (SURF_PITCH / 512) + x / 512;
+      return tile * 4096 + (y % 8) * 512 + x % 512;
+   } else {
+      uint32_t tile = (y / 32) * (SURF_PITCH / 128) + x / 128;
+      return tile * 4096 + (x % 128) / 16 * 512 + (y % 32) * 16 + x % 16;
+   }
+}
+
+/** Which source byte ends up at byte x of the destination. */
+static uint32_t
+source_byte(isl_memcpy_type copy_type, uint32_t x)
+{
+   static const uint8_t bgra_swap[4] = { 2, 1, 0, 3 };
+
+   if (copy_type == ISL_MEMCPY_BGRA8)
+      return x - x % 4 + bgra_swap[x % 4];
+   return x;
+}
+
+static void
+fill_pattern(uint8_t *data, size_t size, unsigned seed)
+{
+   for (size_t i = 0; i < size; i++)
+      data[i] = (i * 7 + seed) ^ (i >> 8);
+}
+
+static void
+test_linear_to_tiled(const struct variant *v, enum isl_tiling tiling,
+                     isl_memcpy_type copy_type, uint8_t *linear,
+                     uint8_t *tiled)
+{
+   for (unsigned r = 0; r < ARRAY_SIZE(regions); r++) {
+      const uint32_t x1 = regions[r].x1, x2 = regions[r].x2;
+      const uint32_t y1 = regions[r].y1, y2 = regions[r].y2;
+
+      fill_pattern(linear, SURF_PITCH * SURF_HEIGHT, r);
+      memset(tiled, FILL, SURF_PITCH * SURF_HEIGHT);
+
+      v->linear_to_tiled(x1, x2, y1, y2, (char *)tiled, (char *)linear,
+                         SURF_PITCH, SURF_PITCH, false, tiling, copy_type);
+
+      for (uint32_t y = 0; y < SURF_HEIGHT; y++) {
+         for (uint32_t x = 0; x < SURF_PITCH; x++) {
+            uint8_t got = tiled[tiled_offset(tiling, x, y)];
+
+            if (x < x1 || x >= x2 || y < y1 || y >= y2) {
+               t_assert(got == FILL);
+            } else {
+               uint32_t sx = source_byte(copy_type, x - x1);
+               t_assert(got == linear[(y - y1) * SURF_PITCH + sx]);
+            }
+         }
+      }
+   }
+}
+
+static void
+test_tiled_to_linear(const struct variant *v, enum isl_tiling tiling,
+                     isl_memcpy_type copy_type, uint8_t *linear,
+                     uint8_t *tiled)
+{
+   for (unsigned r = 0; r < ARRAY_SIZE(regions); r++) {
+      const uint32_t x1 = regions[r].x1, x2 = regions[r].x2;
+      const uint32_t y1 = regions[r].y1, y2 = regions[r].y2;
+      const uint32_t w = x2 - x1;
+
+      fill_pattern(tiled, SURF_PITCH * SURF_HEIGHT, r);
+      memset(linear, FILL, SURF_PITCH * SURF_HEIGHT);
+
+      v->tiled_to_linear(x1, x2, y1, y2, (char *)linear, (char *)tiled,
+                         SURF_PITCH, SURF_PITCH, false, tiling, copy_type);
+
+      for (uint32_t y = 0; y < SURF_HEIGHT; y++) {
+         for (uint32_t x = 0; x < SURF_PITCH; x++) {
+            uint8_t got = linear[y * SURF_PITCH + x];
+
+            if (x >= w || y >= y2 - y1) {
+               t_assert(got == FILL);
+            } else {
+               uint32_t sx = x1 + source_byte(copy_type, x);
+               t_assert(got == tiled[tiled_offset(tiling, sx, y1 + y)]);
+            }
+         }
+      }
+   }
+}
+
+/** With swizzling, compare each variant's output to the normal one's. */
+static void
+test_swizzling(const struct variant *v, enum isl_tiling tiling,
+               isl_memcpy_type copy_type, uint8_t *linear, uint8_t *tiled,
+               uint8_t *ref)
+{
+   const size_t size = SURF_PITCH * SURF_HEIGHT;
+
+   for (unsigned r = 0; r < ARRAY_SIZE(regions); r++) {
+      const uint32_t x1 = regions[r].x1, x2 = regions[r].x2;
+      const uint32_t y1 = regions[r].y1, y2 = regions[r].y2;
+
+      if (copy_type != ISL_MEMCPY_STREAMING_LOAD) {
+         fill_pattern(linear, size, r);
+         memset(tiled, FILL, size);
+         memset(ref, FILL, size);
+         v->linear_to_tiled(x1, x2, y1, y2, (char *)tiled, (char *)linear,
+                            SURF_PITCH, SURF_PITCH, true, tiling, copy_type);
+         variants[0].linear_to_tiled(x1, x2, y1, y2, (char *)ref,
+                                     (char *)linear, SURF_PITCH, SURF_PITCH,
+                                     true, tiling, copy_type);
+         t_assert(memcmp(tiled, ref, size) == 0);
+      }
+
+      /* The normal variant can't do streaming loads, but they are plain
+       * copies otherwise.
+       */
+      isl_memcpy_type ref_type = copy_type == ISL_MEMCPY_STREAMING_LOAD ?
+                                 ISL_MEMCPY : copy_type;
+
+      fill_pattern(tiled, size, r);
+      memset(linear, FILL, size);
+      memset(ref, FILL, size);
+      v->tiled_to_linear(x1, x2, y1, y2, (char *)linear, (char *)tiled,
+                         SURF_PITCH, SURF_PITCH, true, tiling, copy_type);
+      variants[0].tiled_to_linear(x1, x2, y1, y2, (char *)ref, (char *)tiled,
+                                  SURF_PITCH, SURF_PITCH, true, tiling,
+                                  ref_type);
+      t_assert(memcmp(linear, ref, size) == 0);
+   }
+}
+
+static void
+run_tests(uint8_t *linear, uint8_t *tiled, uint8_t *ref)
+{
+   static const enum isl_tiling tilings[] = { ISL_TILING_X, ISL_TILING_Y0 };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(variants); i++) {
+      const struct variant *v = &variants[i];
+
+      if (!variant_supported(v))
+         continue;
+
+      for (unsigned t = 0; t < ARRAY_SIZE(tilings); t++) {
+         test_linear_to_tiled(v, tilings[t], ISL_MEMCPY, linear, tiled);
+         test_linear_to_tiled(v, tilings[t], ISL_MEMCPY_BGRA8, linear, tiled);
+         test_tiled_to_linear(v, tilings[t], ISL_MEMCPY, linear, tiled);
+         test_tiled_to_linear(v, tilings[t], ISL_MEMCPY_BGRA8, linear, tiled);
+         test_swizzling(v, tilings[t], ISL_MEMCPY, linear, tiled, ref);
+         test_swizzling(v, tilings[t], ISL_MEMCPY_BGRA8, linear, tiled, ref);
+
+         if (v->has_streaming_load) {
+            test_tiled_to_linear(v, tilings[t], ISL_MEMCPY_STREAMING_LOAD,
+                                 linear, tiled);
+            test_swizzling(v, tilings[t], ISL_MEMCPY_STREAMING_LOAD,
+                           linear, tiled, ref);
+         }
+      }
+   }
+}
+
+#define BENCH_HEIGHT 256
+#define BENCH_RUNS   64
+
+static void
+run_benchmark(void)
+{
+   static const enum isl_tiling tilings[] = { ISL_TILING_X, ISL_TILING_Y0 };
+   static const isl_memcpy_type copy_types[] = {
+      ISL_MEMCPY, ISL_MEMCPY_BGRA8, ISL_MEMCPY_STREAMING_LOAD,
+   };
+   static const uint32_t widths[] = { 512, 2048, 8192, 16384 }; /* bytes */
+   const size_t max_size = 16384 * BENCH_HEIGHT;
+
+   uint8_t *linear = aligned_alloc(4096, max_size);
+   uint8_t *tiled = aligned_alloc(4096, max_size);
+   t_assert(linear && tiled);
+   fill_pattern(linear, max_size, 0);
+   fill_pattern(tiled, max_size, 1);
+
+   printf("Variant,Direction,Tiling,Copy,Width,MB/s\n");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(variants); i++) {
+      const struct variant *v = &variants[i];
+
+      if (!variant_supported(v))
+         continue;
+
+      for (unsigned t = 0; t < ARRAY_SIZE(tilings); t++) {
+         for (unsigned c = 0; c < ARRAY_SIZE(copy_types); c++) {
+            const isl_memcpy_type copy_type = copy_types[c];
+
+            if (copy_type == ISL_MEMCPY_STREAMING_LOAD &&
+                !v->has_streaming_load)
+               continue;
+
+            for (unsigned w = 0; w < ARRAY_SIZE(widths); w++) {
+               const uint32_t width = widths[w];
+               const double mb = (double)width * BENCH_HEIGHT * BENCH_RUNS /
+                                 (1024 * 1024);
+
+               /* Streaming loads only apply to reads from tiled memory. */
+               if (copy_type != ISL_MEMCPY_STREAMING_LOAD) {
+                  int64_t start = os_time_get_nano();
+                  for (unsigned run = 0; run < BENCH_RUNS; run++) {
+                     v->linear_to_tiled(0, width, 0, BENCH_HEIGHT,
+                                        (char *)tiled, (char *)linear,
+                                        width, width, false, tilings[t],
+                                        copy_type);
+                  }
+                  int64_t ns = os_time_get_nano() - start;
+
+                  printf("%s,linear to tiled,%s,%s,%u,%.0f\n", v->name,
+                         tiling_name(tilings[t]), copy_type_name(copy_type),
+                         width, mb / (ns / 1000000000.0));
+               }
+
+               int64_t start = os_time_get_nano();
+               for (unsigned run = 0; run < BENCH_RUNS; run++) {
+                  v->tiled_to_linear(0, width, 0, BENCH_HEIGHT,
+                                     (char *)linear, (char *)tiled,
+                                     width, width, false, tilings[t],
+                                     copy_type);
+               }
+               int64_t ns = os_time_get_nano() - start;
+
+               printf("%s,tiled to linear,%s,%s,%u,%.0f\n", v->name,
+                      tiling_name(tilings[t]), copy_type_name(copy_type),
+                      width, mb / (ns / 1000000000.0));
+            }
+         }
+      }
+   }
+
+   free(linear);
+   free(tiled);
+}
+
+int main(int argc, char **argv)
+{
+   if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+      run_benchmark();
+      return 0;
+   }
+
+   /* Tile bases are 4K aligned in real surfaces, and the streaming loads
+    * rely on that.
+    */
+   uint8_t *linear = aligned_alloc(4096, SURF_PITCH * SURF_HEIGHT);
+   uint8_t *tiled = aligned_alloc(4096, SURF_PITCH * SURF_HEIGHT);
+   uint8_t *ref = aligned_alloc(4096, SURF_PITCH * SURF_HEIGHT);
+   t_assert(linear && tiled && ref);
+
+   run_tests(linear, tiled, ref);
+
+   free(linear);
+   free(tiled);
+   free(ref);
+   return 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "common/gen_gem.h"
+
+#include "dev/gen_debug.h"
+#include "dev/gen_device_info.h"
+
+#include "perf/gen_perf.h"
+#include "perf/gen_perf_private.h"
+#include "perf/gen_perf_stream.h"
+
+#include "drm-uapi/i915_drm.h"
+
+#include "util/macros.h"
+#include "util/ralloc.h"
+
+#define FILE_DEBUG_FLAG DEBUG_PERFMON
+
+#define OA_REPORT_SIZE (I915_PERF_OA_SAMPLE_SIZE - \
+                        sizeof(struct drm_i915_perf_record_header))
+
+struct gen_perf_stream {
+   struct gen_perf_config *perf;
+   const struct gen_device_info *devinfo;
+   const struct gen_perf_query_info *query;
+
+   int fd;
+
+   /* Previous OA report, the start of the next sample. */
+   uint32_t last_report[OA_REPORT_SIZE / sizeof(uint32_t)];
+   bool has_last_report;
+
+   /* GPU time of last_report.  The reports only have 32bit timestamps,
+    * which wrap after a few minutes, so we track time by adding deltas.
+    */
+   uint64_t last_time_ns;
+
+   struct gen_perf_stream_sample *ring;
+   uint32_t ring_size;
+   uint32_t ring_head;
+   uint32_t ring_count;
+   uint64_t lost_samples;
+
+   uint8_t buf[I915_PERF_OA_SAMPLE_SIZE * 32];
+};
+
+#define NUM_PERF_PROPERTIES(array) (ARRAY_SIZE(array) / 2)
+
+/**
+ * Open a periodic OA stream for the given metric set.
+ *
+ * Sampling all contexts requires CAP_SYS_ADMIN or
+ * /proc/sys/dev/i915/perf_stream_paranoid set to 0.  Returns NULL if the
+ * stream can't be opened.
+ */
+struct gen_perf_stream *
+gen_perf_stream_open(void *mem_ctx,
+                     struct gen_perf_config *perf,
+                     const struct gen_device_info *devinfo,
+                     int drm_fd,
+                     const struct gen_perf_query_info *query,
+                     uint32_t period_exponent,
+                     uint32_t ring_size)
+{
+   assert(ring_size > 0);
+
+   if (query->kind == GEN_PERF_QUERY_TYPE_PIPELINE ||
+       query->oa_metrics_set_id == 0) {
+      DBG("gen perf stream: metric set '%s' isn't loaded\n", query->name);
+      return NULL;
+   }
+
+   uint64_t properties[] = {
+      /* Include OA reports in samples */
+      DRM_I915_PERF_PROP_SAMPLE_OA, true,
+
+      /* OA unit configuration */
+      DRM_I915_PERF_PROP_OA_METRICS_SET, query->oa_metrics_set_id,
+      DRM_I915_PERF_PROP_OA_FORMAT, query->oa_format,
+      DRM_I915_PERF_PROP_OA_EXPONENT, period_exponent,
+
+      /* SSEU configuration */
+      DRM_I915_PERF_PROP_GLOBAL_SSEU, to_user_pointer(&perf->sseu),
+   };
+   struct drm_i915_perf_open_param param = {
+      .flags = I915_PERF_FLAG_FD_CLOEXEC |
+               I915_PERF_FLAG_FD_NONBLOCK,
+      .num_properties = perf->i915_perf_version >= 4 ?
+                        NUM_PERF_PROPERTIES(properties) :
+                        NUM_PERF_PROPERTIES(properties) - 1,
+      .properties_ptr = (uintptr_t) properties,
+   };
+   int fd = gen_ioctl(drm_fd, DRM_IOCTL_I915_PERF_OPEN, &param);
+   if (fd == -1) {
+      DBG("Error opening gen perf periodic OA stream: %m\n");
+      return NULL;
+   }
+
+   struct gen_perf_stream *stream = rzalloc(mem_ctx, struct gen_perf_stream);
+   stream->ring = rzalloc_array(stream, struct gen_perf_stream_sample,
+                                ring_size);
+   if (!stream->ring) {
+      close(fd);
+      ralloc_free(stream);
+      return NULL;
+   }
+
+   stream->perf = perf;
+   stream->devinfo = devinfo;
+   stream->query = query;
+   stream->fd = fd;
+   stream->ring_size = ring_size;
+
+   return stream;
+}
+
+void
+gen_perf_stream_close(struct gen_perf_stream *stream)
+{
+   if (!stream)
+      return;
+
+   close(stream->fd);
+   ralloc_free(stream);
+}
+
+static struct gen_perf_stream_sample *
+push_sample(struct gen_perf_stream *stream)
+{
+   uint32_t index = (stream->ring_head + stream->ring_count) %
+                    stream->ring_size;
+
+   /* Overwrite the oldest sample if the consumer is falling behind. */
+   if (stream->ring_count == stream->ring_size) {
+      stream->ring_head = (stream->ring_head + 1) % stream->ring_size;
+      stream->lost_samples++;
+   } else {
+      stream->ring_count++;
+   }
+
+   return &stream->ring[index];
+}
+
+static void
+process_report(struct gen_perf_stream *stream, const uint32_t *report)
+{
+   const struct gen_device_info *devinfo = stream->devinfo;
+
+   if (!stream->has_last_report) {
+      stream->last_time_ns = gen_device_info_timebase_scale(devinfo,
+                                                            report[1]);
+   } else {
+      struct gen_perf_stream_sample *sample = push_sample(stream);
+
+      gen_perf_query_result_clear(&sample->result);
+      gen_perf_query_result_accumulate(&sample->result, stream->query,
+                                       stream->last_report, report);
+      gen_perf_query_result_read_frequencies(&sample->result, devinfo,
+                                             stream->last_report, report);
+
+      /* Takes care of 32bit timestamp overflow. */
+      uint32_t delta = report[1] - stream->last_report[1];
+      sample->timestamp_ns = stream->last_time_ns;
+      sample->duration_ns = gen_device_info_timebase_scale(devinfo, delta);
+      stream->last_time_ns += sample->duration_ns;
+   }
+
+   memcpy(stream->last_report, report, sizeof(stream->last_report));
+   stream->has_last_report = true;
+}
+
+/**
+ * Read all the reports the kernel has for us and turn them into samples.
+ *
+ * This doesn't block, and should be called often enough for the kernel's
+ * OA buffer not to overflow (which shows up as a gap in the samples).
+ * Returns false if the stream is broken.
+ */
+bool
+gen_perf_stream_update(struct gen_perf_stream *stream)
+{
+   while (1) {
+      int len = read(stream->fd, stream->buf, sizeof(stream->buf));
+
+      if (len < 0) {
+         if (errno == EINTR)
+            continue;
+         if (errno == EAGAIN)
+            return true;
+
+         DBG("Error reading i915 perf samples: %m\n");
+         return false;
+      }
+
+      if (len == 0)
+         return true;
+
+      int offset = 0;
+      while (offset < len) {
+         const struct drm_i915_perf_record_header *header =
+            (const struct drm_i915_perf_record_header *)(stream->buf + offset);
+
+         assert(header->size != 0);
+         assert(header->size <= len);
+
+         offset += header->size;
+
+         switch (header->type) {
+         case DRM_I915_PERF_RECORD_SAMPLE:
+            process_report(stream, (const uint32_t *)(header + 1));
+            break;
+
+         case DRM_I915_PERF_RECORD_OA_BUFFER_LOST:
+            /* Don't produce a sample spanning the gap. */
+            DBG("i915 perf: OA error: all reports lost\n");
+            stream->has_last_report = false;
+            break;
+
+         case DRM_I915_PERF_RECORD_OA_REPORT_LOST:
+            DBG("i915 perf: OA report lost\n");
+            break;
+         }
+      }
+   }
+}
+
+/**
+ * Move up to max_samples of the oldest samples into the samples array.
+ * Returns the number of samples written.
+ */
+uint32_t
+gen_perf_stream_get_samples(struct gen_perf_stream *stream,
+                            struct gen_perf_stream_sample *samples,
+                            uint32_t max_samples)
+{
+   uint32_t n = MIN2(max_samples, stream->ring_count);
+
+   for (uint32_t i = 0; i < n; i++) {
+      samples[i] = stream->ring[stream->ring_head];
+      stream->ring_head = (stream->ring_head + 1) % stream->ring_size;
+   }
+   stream->ring_count -= n;
+
+   return n;
+}
+
+/**
+ * Number of samples overwritten because they weren't read in time.
+ */
+uint64_t
+gen_perf_stream_lost_samples(const struct gen_perf_stream *stream)
+{
+   return stream->lost_samples;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GEN_PERF_STREAM_H
+#define GEN_PERF_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "perf/gen_perf.h"
+
+struct gen_device_info;
+
+/**
+ * Continuous, system-wide sampling of one OA metric set.
+ *
+ * The i915 perf stream is opened in periodic mode without a context filter,
+ * so the OA unit writes a report every 2^(period_exponent + 1) GPU timestamp
+ * ticks for whatever is running on the GPU.  Each pair of consecutive reports
+ * is decoded into one gen_perf_stream_sample, which can be read back with
+ * the generated counter read functions of the metric set:
+ *
+ *    counter->oa_counter_read_uint64(perf, query, sample->result.accumulator)
+ *
+ * Samples go into a fixed-size ring; when the consumer falls behind, the
+ * oldest samples are overwritten.  A stream is not thread-safe.
+ */
+struct gen_perf_stream;
+
+struct gen_perf_stream_sample {
+   /** GPU time at the start of the sample, in nanoseconds. */
+   uint64_t timestamp_ns;
+
+   /** Length of the sample, in nanoseconds. */
+   uint64_t duration_ns;
+
+   /** Counter deltas over the sample, in the layout of the metric set. */
+   struct gen_perf_query_result result;
+};
+
+struct gen_perf_stream *
+gen_perf_stream_open(void *mem_ctx,
+                     struct gen_perf_config *perf,
+                     const struct gen_device_info *devinfo,
+                     int drm_fd,
+                     const struct gen_perf_query_info *query,
+                     uint32_t period_exponent,
+                     uint32_t ring_size);
+
+void gen_perf_stream_close(struct gen_perf_stream *stream);
+
+bool gen_perf_stream_update(struct gen_perf_stream *stream);
+
+uint32_t gen_perf_stream_get_samples(struct gen_perf_stream *stream,
+                                     struct gen_perf_stream_sample *samples,
+                                     uint32_t max_samples);
+
+uint64_t gen_perf_stream_lost_samples(const struct gen_perf_stream *stream);
+
+#endif /* GEN_PERF_STREAM_H */
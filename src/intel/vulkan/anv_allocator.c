@@ -376,6 +376,8 @@ anv_block_pool_init(struct anv_block_pool *pool,
    pool->center_bo_offset = 0;
    pool->start_address = gen_canonical_address(start_address);
    pool->map = NULL;
+   pool->num_grows = 0;
+   pool->num_grow_waits = 0;
 
    if (pool->use_softpin) {
       pool->bo = NULL;
@@ -711,6 +713,7 @@ anv_block_pool_grow(struct anv_block_pool *pool, struct anv_block_state *state,
    assert(center_bo_offset % PAGE_SIZE == 0);
 
    result = anv_block_pool_expand_range(pool, center_bo_offset, size);
+   pool->num_grows++;
 
 done:
    pthread_mutex_unlock(&pool->device->mutex);
@@ -778,6 +781,7 @@ anv_block_pool_alloc_new(struct anv_block_pool *pool,
             futex_wake(&pool_state->end, INT_MAX);
          return state.next;
       } else {
+         p_atomic_inc(&pool->num_grow_waits);
          futex_wait(&pool_state->end, state.end, NULL);
          continue;
       }
@@ -902,6 +906,7 @@ anv_fixed_size_state_pool_alloc_new(struct anv_fixed_size_state_pool *pool,
          futex_wake(&pool->block.end, INT_MAX);
       return offset;
    } else {
+      p_atomic_inc(&block_pool->num_grow_waits);
       futex_wait(&pool->block.end, block.end, NULL);
       goto restart;
    }
@@ -1195,6 +1200,7 @@ anv_state_stream_init(struct anv_state_stream *stream,
                       uint32_t block_size)
 {
    stream->state_pool = state_pool;
+   stream->cache = NULL;
    stream->block_size = block_size;
 
    stream->block = ANV_STATE_NULL;
@@ -1209,13 +1215,26 @@ anv_state_stream_init(struct anv_state_stream *stream,
    VG(VALGRIND_CREATE_MEMPOOL(stream, 0, false));
 }
 
+void
+anv_state_stream_init_cached(struct anv_state_stream *stream,
+                             struct anv_state_stream_cache *cache)
+{
+   anv_state_stream_init(stream, cache->state_pool, cache->block_size);
+   stream->cache = cache;
+}
+
 void
 anv_state_stream_finish(struct anv_state_stream *stream)
 {
    util_dynarray_foreach(&stream->all_blocks, struct anv_state, block) {
       VG(VALGRIND_MEMPOOL_FREE(stream, block->map));
       VG(VALGRIND_MAKE_MEM_NOACCESS(block->map, block->alloc_size));
-      anv_state_pool_free_no_vg(stream->state_pool, *block);
+      if (stream->cache && block->alloc_size == stream->cache->block_size) {
+         util_dynarray_append(&stream->cache->blocks,
+                              struct anv_state, *block);
+      } else {
+         anv_state_pool_free_no_vg(stream->state_pool, *block);
+      }
    }
    util_dynarray_fini(&stream->all_blocks);
 
@@ -1237,8 +1256,15 @@ anv_state_stream_alloc(struct anv_state_stream *stream,
       if (block_size < size)
          block_size = round_to_power_of_two(size);
 
-      stream->block = anv_state_pool_alloc_no_vg(stream->state_pool,
-                                                 block_size, PAGE_SIZE);
+      if (stream->cache && block_size == stream->cache->block_size &&
+          util_dynarray_num_elements(&stream->cache->blocks,
+                                     struct anv_state) > 0) {
+         stream->block = util_dynarray_pop(&stream->cache->blocks,
+                                           struct anv_state);
+      } else {
+         stream->block = anv_state_pool_alloc_no_vg(stream->state_pool,
+                                                    block_size, PAGE_SIZE);
+      }
       util_dynarray_append(&stream->all_blocks,
                            struct anv_state, stream->block);
       VG(VALGRIND_MAKE_MEM_NOACCESS(stream->block.map, block_size));
@@ -1271,6 +1297,32 @@ anv_state_stream_alloc(struct anv_state_stream *stream,
    return state;
 }
 
+void
+anv_state_stream_cache_init(struct anv_state_stream_cache *cache,
+                            struct anv_state_pool *state_pool,
+                            uint32_t block_size)
+{
+   cache->state_pool = state_pool;
+   cache->block_size = block_size;
+   util_dynarray_init(&cache->blocks, NULL);
+}
+
+/* Returns the cached blocks to the state pool. */
+void
+anv_state_stream_cache_trim(struct anv_state_stream_cache *cache)
+{
+   util_dynarray_foreach(&cache->blocks, struct anv_state, block)
+      anv_state_pool_free_no_vg(cache->state_pool, *block);
+   util_dynarray_clear(&cache->blocks);
+}
+
+void
+anv_state_stream_cache_finish(struct anv_state_stream_cache *cache)
+{
+   anv_state_stream_cache_trim(cache);
+   util_dynarray_fini(&cache->blocks);
+}
+
 void
 anv_state_reserved_pool_init(struct anv_state_reserved_pool *pool,
                              struct anv_state_pool *parent,
@@ -1545,7 +1597,11 @@ anv_scratch_pool_alloc(struct anv_device *device, struct anv_scratch_pool *pool,
 VkResult
 anv_bo_cache_init(struct anv_bo_cache *cache)
 {
-   util_sparse_array_init(&cache->bo_map, sizeof(struct anv_bo), 1024);
+   /* GEM handles are allocated densely starting at 1, so big leaves keep
+    * the lookups shallow while the interior nodes can stay small.
+    */
+   util_sparse_array_init_with_leaf_size(&cache->bo_map, sizeof(struct anv_bo),
+                                         64, 1024);
 
    if (pthread_mutex_init(&cache->mutex, NULL)) {
       util_sparse_array_finish(&cache->bo_map);
@@ -1131,6 +1131,46 @@ anv_execbuf_add_bo_bitset(struct anv_device *device,
                           BITSET_WORD *deps,
                           uint32_t extra_flags);
 
+/* Makes room for at least min_len objects. */
+static VkResult
+anv_execbuf_grow(struct anv_execbuf *exec, uint32_t min_len)
+{
+   if (min_len <= exec->array_length)
+      return VK_SUCCESS;
+
+   uint32_t new_len = exec->objects ? exec->array_length * 2 : 64;
+   while (new_len < min_len)
+      new_len *= 2;
+
+   struct drm_i915_gem_exec_object2 *new_objects =
+      vk_alloc(exec->alloc, new_len * sizeof(*new_objects), 8, exec->alloc_scope);
+   if (new_objects == NULL)
+      return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
+
+   struct anv_bo **new_bos =
+      vk_alloc(exec->alloc, new_len * sizeof(*new_bos), 8, exec->alloc_scope);
+   if (new_bos == NULL) {
+      vk_free(exec->alloc, new_objects);
+      return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
+   }
+
+   if (exec->objects) {
+      memcpy(new_objects, exec->objects,
+             exec->bo_count * sizeof(*new_objects));
+      memcpy(new_bos, exec->bos,
+             exec->bo_count * sizeof(*new_bos));
+   }
+
+   vk_free(exec->alloc, exec->objects);
+   vk_free(exec->alloc, exec->bos);
+
+   exec->objects = new_objects;
+   exec->bos = new_bos;
+   exec->array_length = new_len;
+
+   return VK_SUCCESS;
+}
+
 static VkResult
 anv_execbuf_add_bo(struct anv_device *device,
                    struct anv_execbuf *exec,
@@ -1149,35 +1189,9 @@ anv_execbuf_add_bo(struct anv_device *device,
       /* We've never seen this one before.  Add it to the list and assign
        * an id that we can use later.
        */
-      if (exec->bo_count >= exec->array_length) {
-         uint32_t new_len = exec->objects ? exec->array_length * 2 : 64;
-
-         struct drm_i915_gem_exec_object2 *new_objects =
-            vk_alloc(exec->alloc, new_len * sizeof(*new_objects), 8, exec->alloc_scope);
-         if (new_objects == NULL)
-            return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
-
-         struct anv_bo **new_bos =
-            vk_alloc(exec->alloc, new_len * sizeof(*new_bos), 8, exec->alloc_scope);
-         if (new_bos == NULL) {
-            vk_free(exec->alloc, new_objects);
-            return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
-         }
-
-         if (exec->objects) {
-            memcpy(new_objects, exec->objects,
-                   exec->bo_count * sizeof(*new_objects));
-            memcpy(new_bos, exec->bos,
-                   exec->bo_count * sizeof(*new_bos));
-         }
-
-         vk_free(exec->alloc, exec->objects);
-         vk_free(exec->alloc, exec->bos);
-
-         exec->objects = new_objects;
-         exec->bos = new_bos;
-         exec->array_length = new_len;
-      }
+      VkResult result = anv_execbuf_grow(exec, exec->bo_count + 1);
+      if (result != VK_SUCCESS)
+         return result;
 
       assert(exec->bo_count < exec->array_length);
 
@@ -1240,14 +1254,22 @@ anv_execbuf_add_bo_bitset(struct anv_device *device,
                           uint32_t extra_flags)
 {
    for (uint32_t w = 0; w < dep_words; w++) {
+      uint32_t gem_handles[BITSET_WORDBITS];
+      struct anv_bo *bos[BITSET_WORDBITS];
+      unsigned count = 0;
+
       BITSET_WORD mask = deps[w];
       while (mask) {
          int i = u_bit_scan(&mask);
-         uint32_t gem_handle = w * BITSET_WORDBITS + i;
-         struct anv_bo *bo = anv_device_lookup_bo(device, gem_handle);
-         assert(bo->refcount > 0);
+         gem_handles[count++] = w * BITSET_WORDBITS + i;
+      }
+
+      anv_device_lookup_bos(device, gem_handles, count, bos);
+
+      for (unsigned i = 0; i < count; i++) {
+         assert(bos[i]->refcount > 0);
          VkResult result =
-            anv_execbuf_add_bo(device, exec, bo, NULL, extra_flags);
+            anv_execbuf_add_bo(device, exec, bos[i], NULL, extra_flags);
          if (result != VK_SUCCESS)
             return result;
       }
@@ -1256,6 +1278,102 @@ anv_execbuf_add_bo_bitset(struct anv_device *device,
    return VK_SUCCESS;
 }
 
+static uint32_t
+anv_device_state_pool_bo_count(struct anv_device *device)
+{
+   return device->surface_state_pool.block_pool.nbos +
+          device->dynamic_state_pool.block_pool.nbos +
+          device->instruction_state_pool.block_pool.nbos +
+          device->binding_table_pool.block_pool.nbos;
+}
+
+static VkResult
+anv_device_build_resident_bos(struct anv_device *device)
+{
+   struct anv_execbuf list;
+   anv_execbuf_init(&list);
+   list.alloc = &device->vk.alloc;
+   list.alloc_scope = VK_SYSTEM_ALLOCATION_SCOPE_DEVICE;
+
+   struct anv_block_pool *pools[] = {
+      &device->surface_state_pool.block_pool,
+      &device->dynamic_state_pool.block_pool,
+      &device->instruction_state_pool.block_pool,
+      &device->binding_table_pool.block_pool,
+   };
+
+   VkResult result = VK_SUCCESS;
+   for (unsigned i = 0; i < ARRAY_SIZE(pools); i++) {
+      anv_block_pool_foreach_bo(bo, pools[i]) {
+         result = anv_execbuf_add_bo(device, &list, bo, NULL, 0);
+         if (result != VK_SUCCESS)
+            goto fail;
+      }
+   }
+
+   list_for_each_entry(struct anv_device_memory, mem,
+                       &device->memory_objects, link) {
+      result = anv_execbuf_add_bo(device, &list, mem->bo, NULL, 0);
+      if (result != VK_SUCCESS)
+         goto fail;
+   }
+
+   vk_free(&device->vk.alloc, device->resident_objects);
+   vk_free(&device->vk.alloc, device->resident_bos);
+   device->resident_objects = list.objects;
+   device->resident_bos = list.bos;
+   device->resident_bo_count = list.bo_count;
+   device->resident_pool_bo_count = anv_device_state_pool_bo_count(device);
+   device->resident_bos_valid = true;
+
+   return VK_SUCCESS;
+
+ fail:
+   anv_execbuf_finish(&list);
+   return result;
+}
+
+/* With softpin, every execbuf references all of the state pool BOs and all
+ * memory objects.  Rather than walking them on each submit, we keep their
+ * exec objects around and only rebuild them when memory is allocated or
+ * freed or when a state pool grows.
+ */
+static VkResult
+anv_execbuf_add_resident_bos(struct anv_device *device,
+                             struct anv_execbuf *exec)
+{
+   assert(device->physical->use_softpin);
+
+   if (!device->resident_bos_valid ||
+       device->resident_pool_bo_count != anv_device_state_pool_bo_count(device)) {
+      VkResult result = anv_device_build_resident_bos(device);
+      if (result != VK_SUCCESS)
+         return result;
+
+      /* Building the list reassigned the indices of its BOs. */
+      for (uint32_t i = 0; i < exec->bo_count; i++)
+         exec->bos[i]->index = i;
+   }
+
+   VkResult result =
+      anv_execbuf_grow(exec, exec->bo_count + device->resident_bo_count);
+   if (result != VK_SUCCESS)
+      return result;
+
+   for (uint32_t i = 0; i < device->resident_bo_count; i++) {
+      struct anv_bo *bo = device->resident_bos[i];
+
+      if (bo->index < exec->bo_count && exec->bos[bo->index] == bo)
+         continue;
+
+      bo->index = exec->bo_count++;
+      exec->objects[bo->index] = device->resident_objects[i];
+      exec->bos[bo->index] = bo;
+   }
+
+   return VK_SUCCESS;
+}
+
 static void
 anv_cmd_buffer_process_relocs(struct anv_cmd_buffer *cmd_buffer,
                               struct anv_reloc_list *list)
@@ -1443,50 +1561,15 @@ setup_execbuf_for_cmd_buffer(struct anv_execbuf *execbuf,
                                       cmd_buffer->last_ss_pool_center);
    VkResult result;
    if (cmd_buffer->device->physical->use_softpin) {
-      anv_block_pool_foreach_bo(bo, &ss_pool->block_pool) {
-         result = anv_execbuf_add_bo(cmd_buffer->device, execbuf,
-                                     bo, NULL, 0);
-         if (result != VK_SUCCESS)
-            return result;
-      }
+      /* Add the state pool and memory object BOs */
+      result = anv_execbuf_add_resident_bos(cmd_buffer->device, execbuf);
+      if (result != VK_SUCCESS)
+         return result;
+
       /* Add surface dependencies (BOs) to the execbuf */
       anv_execbuf_add_bo_bitset(cmd_buffer->device, execbuf,
                                 cmd_buffer->surface_relocs.dep_words,
                                 cmd_buffer->surface_relocs.deps, 0);
-
-      /* Add the BOs for all memory objects */
-      list_for_each_entry(struct anv_device_memory, mem,
-                          &cmd_buffer->device->memory_objects, link) {
-         result = anv_execbuf_add_bo(cmd_buffer->device, execbuf,
-                                     mem->bo, NULL, 0);
-         if (result != VK_SUCCESS)
-            return result;
-      }
-
-      struct anv_block_pool *pool;
-      pool = &cmd_buffer->device->dynamic_state_pool.block_pool;
-      anv_block_pool_foreach_bo(bo, pool) {
-         result = anv_execbuf_add_bo(cmd_buffer->device, execbuf,
-                                     bo, NULL, 0);
-         if (result != VK_SUCCESS)
-            return result;
-      }
-
-      pool = &cmd_buffer->device->instruction_state_pool.block_pool;
-      anv_block_pool_foreach_bo(bo, pool) {
-         result = anv_execbuf_add_bo(cmd_buffer->device, execbuf,
-                                     bo, NULL, 0);
-         if (result != VK_SUCCESS)
-            return result;
-      }
-
-      pool = &cmd_buffer->device->binding_table_pool.block_pool;
-      anv_block_pool_foreach_bo(bo, pool) {
-         result = anv_execbuf_add_bo(cmd_buffer->device, execbuf,
-                                     bo, NULL, 0);
-         if (result != VK_SUCCESS)
-            return result;
-      }
    } else {
       /* Since we aren't in the softpin case, all of our STATE_BASE_ADDRESS BOs
        * will get added automatically by processing relocations on the batch
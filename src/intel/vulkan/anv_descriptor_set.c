@@ -668,6 +668,9 @@ void anv_DestroyPipelineLayout(
  * until the pool size with no freeing must succeed and 2) allocating and
  * freeing only descriptor sets with the same layout. Case 1) is easy enogh,
  * and the free lists lets us recycle blocks for case 2).
+ *
+ * Pools which don't allow freeing individual sets allocate their descriptor
+ * buffers linearly, which makes allocating and resetting them trivial.
  */
 
 /* The vma heap reserves 0 to mean NULL; we have to offset by some ammount to
@@ -755,6 +758,9 @@ VkResult anv_CreateDescriptorPool(
    pool->size = pool_size;
    pool->next = 0;
    pool->free_list = EMPTY;
+   pool->linear = !(pCreateInfo->flags &
+                    VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+   pool->bo_next = 0;
 
    if (descriptor_bo_size > 0) {
       VkResult result = anv_device_alloc_bo(device,
@@ -768,7 +774,8 @@ VkResult anv_CreateDescriptorPool(
          return result;
       }
 
-      util_vma_heap_init(&pool->bo_heap, POOL_HEAP_OFFSET, descriptor_bo_size);
+      if (!pool->linear)
+         util_vma_heap_init(&pool->bo_heap, POOL_HEAP_OFFSET, descriptor_bo_size);
    } else {
       pool->bo = NULL;
    }
@@ -824,8 +831,9 @@ VkResult anv_ResetDescriptorPool(
 
    pool->next = 0;
    pool->free_list = EMPTY;
+   pool->bo_next = 0;
 
-   if (pool->bo) {
+   if (pool->bo && !pool->linear) {
       util_vma_heap_finish(&pool->bo_heap);
       util_vma_heap_init(&pool->bo_heap, POOL_HEAP_OFFSET, pool->bo->size);
    }
@@ -896,6 +904,47 @@ struct surface_state_free_list_entry {
    struct anv_state state;
 };
 
+/* Returns the offset of a descriptor buffer in the pool BO, or -1. */
+static int64_t
+anv_descriptor_pool_alloc_desc_mem(struct anv_descriptor_pool *pool,
+                                   uint32_t size)
+{
+   if (pool->linear) {
+      const uint32_t offset = ALIGN(pool->bo_next, 32);
+      if (offset + (uint64_t)size > pool->bo->size)
+         return -1;
+
+      pool->bo_next = offset + size;
+      return offset;
+   }
+
+   uint64_t pool_vma_offset = util_vma_heap_alloc(&pool->bo_heap, size, 32);
+   if (pool_vma_offset == 0)
+      return -1;
+
+   assert(pool_vma_offset >= POOL_HEAP_OFFSET &&
+          pool_vma_offset - POOL_HEAP_OFFSET <= INT32_MAX);
+   return pool_vma_offset - POOL_HEAP_OFFSET;
+}
+
+static void
+anv_descriptor_pool_free_desc_mem(struct anv_descriptor_pool *pool,
+                                  struct anv_state desc_mem)
+{
+   if (pool->linear) {
+      /* Only the last allocation can be given back before the pool is
+       * reset.
+       */
+      if (desc_mem.offset + desc_mem.alloc_size == pool->bo_next)
+         pool->bo_next = desc_mem.offset;
+      return;
+   }
+
+   util_vma_heap_free(&pool->bo_heap,
+                      (uint64_t)desc_mem.offset + POOL_HEAP_OFFSET,
+                      desc_mem.alloc_size);
+}
+
 static struct anv_state
 anv_descriptor_pool_alloc_state(struct anv_descriptor_pool *pool)
 {
@@ -950,15 +999,14 @@ anv_descriptor_set_create(struct anv_device *device,
        * in the heap which can lead to bad performance.
        */
       uint32_t set_buffer_size = ALIGN(layout->descriptor_buffer_size, 32);
-      uint64_t pool_vma_offset =
-         util_vma_heap_alloc(&pool->bo_heap, set_buffer_size, 32);
-      if (pool_vma_offset == 0) {
+      int64_t offset =
+         anv_descriptor_pool_alloc_desc_mem(pool, set_buffer_size);
+      if (offset < 0) {
          anv_descriptor_pool_free_set(pool, set);
-         return vk_error(VK_ERROR_FRAGMENTED_POOL);
+         return vk_error(pool->linear ? VK_ERROR_OUT_OF_POOL_MEMORY :
+                                        VK_ERROR_FRAGMENTED_POOL);
       }
-      assert(pool_vma_offset >= POOL_HEAP_OFFSET &&
-             pool_vma_offset - POOL_HEAP_OFFSET <= INT32_MAX);
-      set->desc_mem.offset = pool_vma_offset - POOL_HEAP_OFFSET;
+      set->desc_mem.offset = offset;
       set->desc_mem.alloc_size = set_buffer_size;
       set->desc_mem.map = pool->bo->map + set->desc_mem.offset;
 
@@ -1034,9 +1082,7 @@ anv_descriptor_set_destroy(struct anv_device *device,
    anv_descriptor_set_layout_unref(device, set->layout);
 
    if (set->desc_mem.alloc_size) {
-      util_vma_heap_free(&pool->bo_heap,
-                         (uint64_t)set->desc_mem.offset + POOL_HEAP_OFFSET,
-                         set->desc_mem.alloc_size);
+      anv_descriptor_pool_free_desc_mem(pool, set->desc_mem);
       anv_descriptor_pool_free_state(pool, set->desc_surface_state);
    }
 
@@ -38,6 +38,7 @@
 #include "util/os_file.h"
 #include "util/os_misc.h"
 #include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_string.h"
 #include "util/driconf.h"
 #include "git_sha1.h"
@@ -53,6 +54,8 @@ DRI_CONF_BEGIN
    DRI_CONF_SECTION_PERFORMANCE
       DRI_CONF_VK_X11_OVERRIDE_MIN_IMAGE_COUNT(0)
       DRI_CONF_VK_X11_STRICT_IMAGE_COUNT("false")
+      DRI_CONF_VK_X11_MAX_FRAME_LATENCY(0)
+      DRI_CONF_VK_X11_PRIME_DIRECT("false")
    DRI_CONF_SECTION_END
 
    DRI_CONF_SECTION_DEBUG
@@ -2818,6 +2821,10 @@ VkResult anv_CreateDevice(
    }
 
    list_inithead(&device->memory_objects);
+   device->resident_objects = NULL;
+   device->resident_bos = NULL;
+   device->resident_bo_count = 0;
+   device->resident_bos_valid = false;
 
    /* As per spec, the driver implementation may deny requests to acquire
     * a priority above the default priority (MEDIUM) if the caller does not
@@ -3012,6 +3019,7 @@ VkResult anv_CreateDevice(
 
    anv_pipeline_cache_init(&device->default_pipeline_cache, device,
                            true /* cache_enabled */, false /* external_sync */);
+   device->compile_queue_initialized = false;
 
    anv_device_init_blorp(device);
 
@@ -3081,8 +3089,28 @@ void anv_DestroyDevice(
    if (!device)
       return;
 
+   if (unlikely(INTEL_DEBUG & DEBUG_PERF)) {
+      const struct {
+         const char *name;
+         struct anv_block_pool *pool;
+      } pools[] = {
+         { "surface", &device->surface_state_pool.block_pool },
+         { "dynamic", &device->dynamic_state_pool.block_pool },
+         { "instruction", &device->instruction_state_pool.block_pool },
+      };
+
+      for (unsigned i = 0; i < ARRAY_SIZE(pools); i++) {
+         intel_logd("%s state pool: %u grows, %u allocations waited",
+                    pools[i].name, pools[i].pool->num_grows,
+                    pools[i].pool->num_grow_waits);
+      }
+   }
+
    anv_device_finish_blorp(device);
 
+   if (device->compile_queue_initialized)
+      util_queue_destroy(&device->compile_queue);
+
    anv_pipeline_cache_finish(&device->default_pipeline_cache);
 
    anv_queue_finish(&device->queue);
@@ -3125,6 +3153,9 @@ void anv_DestroyDevice(
       util_vma_heap_finish(&device->vma_lo);
    }
 
+   vk_free(&device->vk.alloc, device->resident_objects);
+   vk_free(&device->vk.alloc, device->resident_bos);
+
    pthread_cond_destroy(&device->queue_submit);
    pthread_mutex_destroy(&device->mutex);
 
@@ -3139,6 +3170,38 @@ void anv_DestroyDevice(
    vk_free(&device->vk.alloc, device);
 }
 
+/* Returns the queue used to create several pipelines in parallel, or NULL if
+ * they have to be created on the calling thread.
+ */
+struct util_queue *
+anv_device_get_compile_queue(struct anv_device *device,
+                             const VkAllocationCallbacks *pAllocator)
+{
+   /* Application allocators may only be called from the thread that called
+    * the command.
+    */
+   if (pAllocator || device->vk.alloc.pfnAllocation != default_alloc_func)
+      return NULL;
+
+   pthread_mutex_lock(&device->mutex);
+   if (!device->compile_queue_initialized) {
+      util_cpu_detect();
+
+      /* The calling thread creates pipelines too. */
+      unsigned num_threads =
+         env_var_as_unsigned("ANV_PIPELINE_COMPILE_THREADS",
+                             MIN2(util_cpu_caps.nr_cpus - 1, 8));
+
+      device->compile_queue_initialized =
+         num_threads > 0 &&
+         util_queue_init(&device->compile_queue, "anv_compile", 32,
+                         num_threads, UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   }
+   pthread_mutex_unlock(&device->mutex);
+
+   return device->compile_queue_initialized ? &device->compile_queue : NULL;
+}
+
 VkResult anv_EnumerateInstanceLayerProperties(
     uint32_t*                                   pPropertyCount,
     VkLayerProperties*                          pProperties)
@@ -3639,6 +3702,7 @@ VkResult anv_AllocateMemory(
 
    pthread_mutex_lock(&device->mutex);
    list_addtail(&mem->link, &device->memory_objects);
+   device->resident_bos_valid = false;
    pthread_mutex_unlock(&device->mutex);
 
    *pMem = anv_device_memory_to_handle(mem);
@@ -3731,6 +3795,7 @@ void anv_FreeMemory(
 
    pthread_mutex_lock(&device->mutex);
    list_del(&mem->link);
+   device->resident_bos_valid = false;
    pthread_mutex_unlock(&device->mutex);
 
    if (mem->map)
@@ -626,21 +626,11 @@ anv_pipeline_hash_shader(const struct anv_shader_module *module,
                          const VkSpecializationInfo *spec_info,
                          unsigned char *sha1_out)
 {
-   struct mesa_sha1 ctx;
-   _mesa_sha1_init(&ctx);
-
-   _mesa_sha1_update(&ctx, module->sha1, sizeof(module->sha1));
-   _mesa_sha1_update(&ctx, entrypoint, strlen(entrypoint));
-   _mesa_sha1_update(&ctx, &stage, sizeof(stage));
-   if (spec_info) {
-      _mesa_sha1_update(&ctx, spec_info->pMapEntries,
-                        spec_info->mapEntryCount *
-                        sizeof(*spec_info->pMapEntries));
-      _mesa_sha1_update(&ctx, spec_info->pData,
-                        spec_info->dataSize);
-   }
-
-   _mesa_sha1_final(&ctx, sha1_out);
+   /* The SPIR-V options only depend on the device, which the cache is
+    * already tied to.
+    */
+   vk_spirv_to_nir_cache_key(module->sha1, entrypoint, stage, spec_info,
+                             NULL, sha1_out);
 }
 
 static void
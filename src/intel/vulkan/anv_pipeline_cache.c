@@ -141,12 +141,15 @@ anv_shader_bin_write_to_blob(const struct anv_shader_bin *shader,
    blob_write_uint32(blob, shader->key->size);
    blob_write_bytes(blob, shader->key->data, shader->key->size);
 
+   /* The kernel and constant data live as long as the shader, so don't
+    * copy them until the blob is flattened.
+    */
    blob_write_uint32(blob, shader->kernel_size);
-   blob_write_bytes(blob, shader->kernel.map, shader->kernel_size);
+   blob_write_bytes_ref(blob, shader->kernel.map, shader->kernel_size);
 
    blob_write_uint32(blob, shader->constant_data_size);
-   blob_write_bytes(blob, shader->constant_data.map,
-                    shader->constant_data_size);
+   blob_write_bytes_ref(blob, shader->constant_data.map,
+                        shader->constant_data_size);
 
    blob_write_uint32(blob, shader->prog_data_size);
    blob_write_bytes(blob, shader->prog_data, shader->prog_data_size);
@@ -266,18 +269,6 @@ shader_bin_key_compare_func(const void *void_a, const void *void_b)
    return memcmp(a->data, b->data, a->size) == 0;
 }
 
-static uint32_t
-sha1_hash_func(const void *sha1)
-{
-   return _mesa_hash_data(sha1, 20);
-}
-
-static bool
-sha1_compare_func(const void *sha1_a, const void *sha1_b)
-{
-   return memcmp(sha1_a, sha1_b, 20) == 0;
-}
-
 void
 anv_pipeline_cache_init(struct anv_pipeline_cache *cache,
                         struct anv_device *device,
@@ -293,11 +284,9 @@ anv_pipeline_cache_init(struct anv_pipeline_cache *cache,
    if (cache_enabled) {
       cache->cache = _mesa_hash_table_create(NULL, shader_bin_key_hash_func,
                                              shader_bin_key_compare_func);
-      cache->nir_cache = _mesa_hash_table_create(NULL, sha1_hash_func,
-                                                 sha1_compare_func);
+      vk_nir_cache_init(&cache->nir_cache);
    } else {
       cache->cache = NULL;
-      cache->nir_cache = NULL;
    }
 }
 
@@ -315,13 +304,8 @@ anv_pipeline_cache_finish(struct anv_pipeline_cache *cache)
          anv_shader_bin_unref(cache->device, entry->data);
 
       _mesa_hash_table_destroy(cache->cache, NULL);
-   }
 
-   if (cache->nir_cache) {
-      hash_table_foreach(cache->nir_cache, entry)
-         ralloc_free(entry->data);
-
-      _mesa_hash_table_destroy(cache->nir_cache, NULL);
+      vk_nir_cache_finish(&cache->nir_cache);
    }
 
    vk_object_base_finish(&cache->base);
@@ -397,41 +381,6 @@ anv_pipeline_cache_add_shader_bin(struct anv_pipeline_cache *cache,
    anv_cache_unlock(cache);
 }
 
-static struct anv_shader_bin *
-anv_pipeline_cache_add_shader_locked(struct anv_pipeline_cache *cache,
-                                     gl_shader_stage stage,
-                                     const void *key_data, uint32_t key_size,
-                                     const void *kernel_data,
-                                     uint32_t kernel_size,
-                                     const void *constant_data,
-                                     uint32_t constant_data_size,
-                                     const struct brw_stage_prog_data *prog_data,
-                                     uint32_t prog_data_size,
-                                     const struct brw_compile_stats *stats,
-                                     uint32_t num_stats,
-                                     const nir_xfb_info *xfb_info,
-                                     const struct anv_pipeline_bind_map *bind_map)
-{
-   struct anv_shader_bin *shader =
-      anv_pipeline_cache_search_locked(cache, key_data, key_size);
-   if (shader)
-      return shader;
-
-   struct anv_shader_bin *bin =
-      anv_shader_bin_create(cache->device, stage,
-                            key_data, key_size,
-                            kernel_data, kernel_size,
-                            constant_data, constant_data_size,
-                            prog_data, prog_data_size,
-                            stats, num_stats, xfb_info, bind_map);
-   if (!bin)
-      return NULL;
-
-   _mesa_hash_table_insert(cache->cache, bin->key, bin);
-
-   return bin;
-}
-
 struct anv_shader_bin *
 anv_pipeline_cache_upload_kernel(struct anv_pipeline_cache *cache,
                                  gl_shader_stage stage,
@@ -447,21 +396,41 @@ anv_pipeline_cache_upload_kernel(struct anv_pipeline_cache *cache,
                                  const struct anv_pipeline_bind_map *bind_map)
 {
    if (cache->cache) {
+      struct anv_shader_bin *bin =
+         anv_pipeline_cache_search(cache, key_data, key_size);
+      if (bin)
+         return bin;
+
+      /* Create the binary without holding the lock, so that threads
+       * uploading different shaders don't wait for each other's copies into
+       * the instruction pool.
+       */
+      bin = anv_shader_bin_create(cache->device, stage,
+                                  key_data, key_size,
+                                  kernel_data, kernel_size,
+                                  constant_data, constant_data_size,
+                                  prog_data, prog_data_size,
+                                  stats, num_stats, xfb_info, bind_map);
+      if (!bin)
+         return NULL;
+
       anv_cache_lock(cache);
 
-      struct anv_shader_bin *bin =
-         anv_pipeline_cache_add_shader_locked(cache, stage, key_data, key_size,
-                                              kernel_data, kernel_size,
-                                              constant_data, constant_data_size,
-                                              prog_data, prog_data_size,
-                                              stats, num_stats,
-                                              xfb_info, bind_map);
+      /* Another thread may have uploaded the same shader in the meantime. */
+      struct anv_shader_bin *cached =
+         anv_pipeline_cache_search_locked(cache, key_data, key_size);
+      if (!cached)
+         _mesa_hash_table_insert(cache->cache, bin->key, bin);
 
       anv_cache_unlock(cache);
 
+      if (cached) {
+         anv_shader_bin_unref(cache->device, bin);
+         bin = cached;
+      }
+
       /* We increment refcount before handing it to the caller */
-      if (bin)
-         anv_shader_bin_ref(bin);
+      anv_shader_bin_ref(bin);
 
       return bin;
    } else {
@@ -486,26 +455,21 @@ anv_pipeline_cache_load(struct anv_pipeline_cache *cache,
    if (cache->cache == NULL)
       return;
 
+   size_t header_size =
+      vk_pipeline_cache_header_check(data, size, 0x8086,
+                                     device->info.chipset_id,
+                                     pdevice->pipeline_cache_uuid);
+   if (header_size == 0)
+      return;
+
    struct blob_reader blob;
-   blob_reader_init(&blob, data, size);
+   blob_reader_init(&blob, (const char *)data + header_size,
+                    size - header_size);
 
-   struct vk_pipeline_cache_header header;
-   blob_copy_bytes(&blob, &header, sizeof(header));
    uint32_t count = blob_read_uint32(&blob);
    if (blob.overrun)
       return;
 
-   if (header.header_size < sizeof(header))
-      return;
-   if (header.header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
-      return;
-   if (header.vendor_id != 0x8086)
-      return;
-   if (header.device_id != device->info.chipset_id)
-      return;
-   if (memcmp(header.uuid, pdevice->pipeline_cache_uuid, VK_UUID_SIZE) != 0)
-      return;
-
    for (uint32_t i = 0; i < count; i++) {
       struct anv_shader_bin *bin =
          anv_shader_bin_create_from_blob(device, &blob);
@@ -579,13 +543,9 @@ VkResult anv_GetPipelineCacheData(
       blob_init_fixed(&blob, NULL, SIZE_MAX);
    }
 
-   struct vk_pipeline_cache_header header = {
-      .header_size = sizeof(struct vk_pipeline_cache_header),
-      .header_version = VK_PIPELINE_CACHE_HEADER_VERSION_ONE,
-      .vendor_id = 0x8086,
-      .device_id = device->info.chipset_id,
-   };
-   memcpy(header.uuid, device->physical->pipeline_cache_uuid, VK_UUID_SIZE);
+   struct vk_pipeline_cache_header header;
+   vk_pipeline_cache_header_init(&header, 0x8086, device->info.chipset_id,
+                                 device->physical->pipeline_cache_uuid);
    blob_write_bytes(&blob, &header, sizeof(header));
 
    uint32_t count = 0;
@@ -737,7 +697,8 @@ anv_device_upload_kernel(struct anv_device *device,
    if (disk_cache) {
       struct blob binary;
       blob_init(&binary);
-      if (anv_shader_bin_write_to_blob(bin, &binary)) {
+      if (anv_shader_bin_write_to_blob(bin, &binary) &&
+          blob_flatten(&binary)) {
          cache_key cache_key;
          disk_cache_compute_key(disk_cache, key_data, key_size, cache_key);
 
@@ -751,12 +712,6 @@ anv_device_upload_kernel(struct anv_device *device,
    return bin;
 }
 
-struct serialized_nir {
-   unsigned char sha1_key[20];
-   size_t size;
-   char data[0];
-};
-
 struct nir_shader *
 anv_device_search_for_nir(struct anv_device *device,
                           struct anv_pipeline_cache *cache,
@@ -764,27 +719,9 @@ anv_device_search_for_nir(struct anv_device *device,
                           unsigned char sha1_key[20],
                           void *mem_ctx)
 {
-   if (cache && cache->nir_cache) {
-      const struct serialized_nir *snir = NULL;
-
-      anv_cache_lock(cache);
-      struct hash_entry *entry =
-         _mesa_hash_table_search(cache->nir_cache, sha1_key);
-      if (entry)
-         snir = entry->data;
-      anv_cache_unlock(cache);
-
-      if (snir) {
-         struct blob_reader blob;
-         blob_reader_init(&blob, snir->data, snir->size);
-
-         nir_shader *nir = nir_deserialize(mem_ctx, nir_options, &blob);
-         if (blob.overrun) {
-            ralloc_free(nir);
-         } else {
-            return nir;
-         }
-      }
+   if (cache && cache->cache) {
+      return vk_nir_cache_search(&cache->nir_cache, sha1_key,
+                                 nir_options, mem_ctx);
    }
 
    return NULL;
@@ -796,45 +733,6 @@ anv_device_upload_nir(struct anv_device *device,
                       const struct nir_shader *nir,
                       unsigned char sha1_key[20])
 {
-   if (cache && cache->nir_cache) {
-      anv_cache_lock(cache);
-      struct hash_entry *entry =
-         _mesa_hash_table_search(cache->nir_cache, sha1_key);
-      anv_cache_unlock(cache);
-      if (entry)
-         return;
-
-      struct blob blob;
-      blob_init(&blob);
-
-      nir_serialize(&blob, nir, false);
-      if (blob.out_of_memory) {
-         blob_finish(&blob);
-         return;
-      }
-
-      anv_cache_lock(cache);
-      /* Because ralloc isn't thread-safe, we have to do all this inside the
-       * lock.  We could unlock for the big memcpy but it's probably not worth
-       * the hassle.
-       */
-      entry = _mesa_hash_table_search(cache->nir_cache, sha1_key);
-      if (entry) {
-         blob_finish(&blob);
-         anv_cache_unlock(cache);
-         return;
-      }
-
-      struct serialized_nir *snir =
-         ralloc_size(cache->nir_cache, sizeof(*snir) + blob.size);
-      memcpy(snir->sha1_key, sha1_key, 20);
-      snir->size = blob.size;
-      memcpy(snir->data, blob.data, blob.size);
-
-      blob_finish(&blob);
-
-      _mesa_hash_table_insert(cache->nir_cache, snir->sha1_key, snir);
-
-      anv_cache_unlock(cache);
-   }
+   if (cache && cache->cache)
+      vk_nir_cache_upload(&cache->nir_cache, sha1_key, nir);
 }
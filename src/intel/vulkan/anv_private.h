@@ -56,12 +56,14 @@
 #include "util/list.h"
 #include "util/sparse_array.h"
 #include "util/u_atomic.h"
+#include "util/u_queue.h"
 #include "util/u_vector.h"
 #include "util/u_math.h"
 #include "util/vma.h"
 #include "util/xmlconfig.h"
 #include "vk_alloc.h"
 #include "vk_debug_report.h"
+#include "vk_nir_cache.h"
 #include "vk_object.h"
 
 /* Pre-declarations needed for WSI entrypoints */
@@ -837,6 +839,13 @@ struct anv_block_pool {
    struct anv_block_state state;
 
    struct anv_block_state back_state;
+
+   /* How often the pool grew, and how often an allocation had to wait for
+    * another thread to grow the pool or to refill a state bucket.  Reported
+    * with INTEL_DEBUG=perf.
+    */
+   uint32_t num_grows;
+   uint32_t num_grow_waits;
 };
 
 /* Block pools are backed by a fixed-size 1GB memfd */
@@ -911,9 +920,25 @@ struct anv_state_reserved_pool {
    uint32_t count;
 };
 
+/* Free blocks of one size kept for the state streams of a command pool.
+ * Since command pools are externally synchronized, the streams can take and
+ * return blocks here without touching the shared free lists of the state
+ * pool, which all recording threads contend on.
+ */
+struct anv_state_stream_cache {
+   struct anv_state_pool *state_pool;
+   uint32_t block_size;
+
+   /* Array of struct anv_state */
+   struct util_dynarray blocks;
+};
+
 struct anv_state_stream {
    struct anv_state_pool *state_pool;
 
+   /* Where to take and return blocks of block_size, or NULL */
+   struct anv_state_stream_cache *cache;
+
    /* The size of blocks to allocate from the state pool */
    uint32_t block_size;
 
@@ -955,10 +980,18 @@ void anv_state_pool_free(struct anv_state_pool *pool, struct anv_state state);
 void anv_state_stream_init(struct anv_state_stream *stream,
                            struct anv_state_pool *state_pool,
                            uint32_t block_size);
+void anv_state_stream_init_cached(struct anv_state_stream *stream,
+                                  struct anv_state_stream_cache *cache);
 void anv_state_stream_finish(struct anv_state_stream *stream);
 struct anv_state anv_state_stream_alloc(struct anv_state_stream *stream,
                                         uint32_t size, uint32_t alignment);
 
+void anv_state_stream_cache_init(struct anv_state_stream_cache *cache,
+                                 struct anv_state_pool *state_pool,
+                                 uint32_t block_size);
+void anv_state_stream_cache_trim(struct anv_state_stream_cache *cache);
+void anv_state_stream_cache_finish(struct anv_state_stream_cache *cache);
+
 void anv_state_reserved_pool_init(struct anv_state_reserved_pool *pool,
                                       struct anv_state_pool *parent,
                                       uint32_t count, uint32_t size,
@@ -1241,7 +1274,7 @@ struct anv_pipeline_cache {
    struct anv_device *                          device;
    pthread_mutex_t                              mutex;
 
-   struct hash_table *                          nir_cache;
+   struct vk_nir_cache                          nir_cache;
 
    struct hash_table *                          cache;
 
@@ -1338,6 +1371,18 @@ struct anv_device {
     /** List of all anv_device_memory objects */
     struct list_head                            memory_objects;
 
+    /**
+     * Exec objects for the state pool BOs and the BOs of memory_objects,
+     * which every softpin execbuf references.  Rebuilt on the next submit
+     * when resident_bos_valid is cleared or a state pool grows.  Protected
+     * by mutex.
+     */
+    struct drm_i915_gem_exec_object2 *          resident_objects;
+    struct anv_bo **                            resident_bos;
+    uint32_t                                    resident_bo_count;
+    uint32_t                                    resident_pool_bo_count;
+    bool                                        resident_bos_valid;
+
     struct anv_bo_pool                          batch_bo_pool;
 
     struct anv_bo_cache                         bo_cache;
@@ -1368,6 +1413,13 @@ struct anv_device {
     struct anv_pipeline_cache                   default_pipeline_cache;
     struct blorp_context                        blorp;
 
+    /**
+     * Threads creating the pipelines of a vkCreate*Pipelines call in
+     * parallel.  Created on first use, under mutex.
+     */
+    struct util_queue                           compile_queue;
+    bool                                        compile_queue_initialized;
+
     struct anv_state                            border_colors;
 
     struct anv_state                            slice_hash;
@@ -1434,6 +1486,10 @@ anv_mocs_for_bo(const struct anv_device *device, const struct anv_bo *bo)
 void anv_device_init_blorp(struct anv_device *device);
 void anv_device_finish_blorp(struct anv_device *device);
 
+struct util_queue *
+anv_device_get_compile_queue(struct anv_device *device,
+                             const VkAllocationCallbacks *pAllocator);
+
 void _anv_device_set_all_queue_lost(struct anv_device *device);
 VkResult _anv_device_set_lost(struct anv_device *device,
                               const char *file, int line,
@@ -1525,6 +1581,14 @@ anv_device_lookup_bo(struct anv_device *device, uint32_t gem_handle)
    return util_sparse_array_get(&device->bo_cache.bo_map, gem_handle);
 }
 
+static inline void
+anv_device_lookup_bos(struct anv_device *device, const uint32_t *gem_handles,
+                      unsigned count, struct anv_bo **bos)
+{
+   util_sparse_array_get_many(&device->bo_cache.bo_map, gem_handles, count,
+                              (void **)bos);
+}
+
 VkResult anv_device_bo_busy(struct anv_device *device, struct anv_bo *bo);
 VkResult anv_device_wait(struct anv_device *device, struct anv_bo *bo,
                          int64_t timeout);
@@ -2086,6 +2150,13 @@ struct anv_descriptor_pool {
    struct anv_bo *bo;
    struct util_vma_heap bo_heap;
 
+   /* Pools created without VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+    * only free their sets all at once, so we bump-allocate the descriptor
+    * buffers from bo_next instead of using bo_heap.
+    */
+   bool linear;
+   uint32_t bo_next;
+
    struct anv_state_stream surface_state_stream;
    void *surface_state_free_list;
 
@@ -2932,6 +3003,9 @@ struct anv_cmd_pool {
    struct vk_object_base                        base;
    VkAllocationCallbacks                        alloc;
    struct list_head                             cmd_buffers;
+
+   struct anv_state_stream_cache                surface_state_cache;
+   struct anv_state_stream_cache                dynamic_state_cache;
 };
 
 #define ANV_CMD_BUFFER_BATCH_SIZE 8192
@@ -2491,6 +2491,116 @@ compute_pipeline_create(
    return pipeline->base.batch.status;
 }
 
+struct pipeline_create_job {
+   VkDevice device;
+   struct anv_pipeline_cache *cache;
+   const void *create_info;
+   const VkAllocationCallbacks *alloc;
+   VkPipeline *pipeline;
+   VkResult result;
+   struct util_queue_fence fence;
+};
+
+static void
+graphics_pipeline_create_job(void *data, int thread_index)
+{
+   struct pipeline_create_job *job = data;
+
+   job->result = genX(graphics_pipeline_create)(job->device, job->cache,
+                                                job->create_info, job->alloc,
+                                                job->pipeline);
+}
+
+static void
+compute_pipeline_create_job(void *data, int thread_index)
+{
+   struct pipeline_create_job *job = data;
+
+   job->result = compute_pipeline_create(job->device, job->cache,
+                                         job->create_info, job->alloc,
+                                         job->pipeline);
+}
+
+/* Creates the pipelines on the compile queue, with the calling thread
+ * taking the jobs that no other thread has started.  Returns false if they
+ * have to be created one after the other instead.
+ */
+static bool
+create_pipelines_in_parallel(VkDevice _device,
+                             struct anv_pipeline_cache *cache,
+                             uint32_t count,
+                             const void *create_infos,
+                             size_t create_info_size,
+                             const VkAllocationCallbacks *pAllocator,
+                             VkPipeline *pPipelines,
+                             VkPipelineCreateFlags all_flags,
+                             util_queue_execute_func execute,
+                             VkResult *result)
+{
+   ANV_FROM_HANDLE(anv_device, device, _device);
+
+   if (count < 2 || (cache && cache->external_sync))
+      return false;
+
+   /* Stopping at the first failure would waste the work of the other
+    * threads.
+    */
+   if (all_flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
+      return false;
+
+   struct util_queue *queue = anv_device_get_compile_queue(device, pAllocator);
+   if (!queue)
+      return false;
+
+   struct pipeline_create_job *jobs =
+      vk_zalloc(&device->vk.alloc, count * sizeof(*jobs), 8,
+                VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+   if (!jobs)
+      return false;
+
+   for (uint32_t i = 0; i < count; i++) {
+      jobs[i].device = _device;
+      jobs[i].cache = cache;
+      jobs[i].create_info = (const char *)create_infos + i * create_info_size;
+      jobs[i].alloc = pAllocator;
+      jobs[i].pipeline = &pPipelines[i];
+      util_queue_fence_init(&jobs[i].fence);
+   }
+
+   /* The first job is ours. */
+   for (uint32_t i = 1; i < count; i++) {
+      util_queue_add_job(queue, &jobs[i], &jobs[i].fence, execute, NULL, 0);
+   }
+   execute(&jobs[0], 0);
+
+   /* Take back the jobs that are still queued, starting with the last ones
+    * which the threads will get to last.
+    */
+   for (uint32_t i = count - 1; i > 0; i--) {
+      if (util_queue_cancel_job(queue, &jobs[i].fence))
+         execute(&jobs[i], 0);
+      else
+         util_queue_fence_wait(&jobs[i].fence);
+   }
+
+   /* Report an error over VK_PIPELINE_COMPILE_REQUIRED_EXT, as the failed
+    * pipelines aren't retried by the application in that case.
+    */
+   *result = VK_SUCCESS;
+   for (uint32_t i = 0; i < count; i++) {
+      if (jobs[i].result != VK_SUCCESS) {
+         pPipelines[i] = VK_NULL_HANDLE;
+         if (*result == VK_SUCCESS ||
+             *result == VK_PIPELINE_COMPILE_REQUIRED_EXT)
+            *result = jobs[i].result;
+      }
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+
+   vk_free(&device->vk.alloc, jobs);
+   return true;
+}
+
 VkResult genX(CreateGraphicsPipelines)(
     VkDevice                                    _device,
     VkPipelineCache                             pipelineCache,
@@ -2503,6 +2613,16 @@ VkResult genX(CreateGraphicsPipelines)(
 
    VkResult result = VK_SUCCESS;
 
+   VkPipelineCreateFlags all_flags = 0;
+   for (uint32_t i = 0; i < count; i++)
+      all_flags |= pCreateInfos[i].flags;
+
+   if (create_pipelines_in_parallel(_device, pipeline_cache, count,
+                                    pCreateInfos, sizeof(*pCreateInfos),
+                                    pAllocator, pPipelines, all_flags,
+                                    graphics_pipeline_create_job, &result))
+      return result;
+
    unsigned i;
    for (i = 0; i < count; i++) {
       VkResult res = genX(graphics_pipeline_create)(_device,
@@ -2542,6 +2662,16 @@ VkResult genX(CreateComputePipelines)(
 
    VkResult result = VK_SUCCESS;
 
+   VkPipelineCreateFlags all_flags = 0;
+   for (uint32_t i = 0; i < count; i++)
+      all_flags |= pCreateInfos[i].flags;
+
+   if (create_pipelines_in_parallel(_device, pipeline_cache, count,
+                                    pCreateInfos, sizeof(*pCreateInfos),
+                                    pAllocator, pPipelines, all_flags,
+                                    compute_pipeline_create_job, &result))
+      return result;
+
    unsigned i;
    for (i = 0; i < count; i++) {
       VkResult res = compute_pipeline_create(_device, pipeline_cache,
@@ -58,6 +58,7 @@
 #endif
 
 #include "util/macros.h"
+#include "util/simple_mtx.h"
 
 #define __IS_LOADER
 #include "pci_id_driver_map.h"
@@ -284,17 +285,78 @@ static bool drm_device_matches_tag(drmDevicePtr device, const char *prime_tag)
    return ret == 0;
 }
 
-static char *drm_get_id_path_tag_for_fd(int fd)
+/* drmGetDevice2() reads sysfs, which shows up in the startup time of
+ * short-lived processes, and the loader asks for the same device several
+ * times.  What the loader needs is remembered per device number.
+ */
+struct loader_device_info {
+   dev_t rdev;
+   bool is_pci;
+   int vendor_id, chip_id;
+   char *id_path_tag;
+};
+
+#define MAX_CACHED_DEVICES 16
+
+static struct loader_device_info cached_devices[MAX_CACHED_DEVICES];
+static unsigned num_cached_devices;
+static simple_mtx_t cached_devices_mutex = _SIMPLE_MTX_INITIALIZER_NP;
+
+/**
+ * Get the device info of fd.  The caller owns info->id_path_tag.
+ */
+static bool
+drm_get_device_info_for_fd(int fd, struct loader_device_info *info)
 {
+   struct loader_device_info entry;
    drmDevicePtr device;
-   char *tag;
+   struct stat st;
+   unsigned i;
 
-   if (drmGetDevice2(fd, 0, &device) != 0)
-       return NULL;
+   if (fstat(fd, &st) != 0)
+      return false;
+
+   simple_mtx_lock(&cached_devices_mutex);
+
+   for (i = 0; i < num_cached_devices; i++) {
+      if (cached_devices[i].rdev == st.st_rdev) {
+         *info = cached_devices[i];
+         info->id_path_tag = info->id_path_tag ? strdup(info->id_path_tag) : NULL;
+         simple_mtx_unlock(&cached_devices_mutex);
+         return true;
+      }
+   }
 
-   tag = drm_construct_id_path_tag(device);
+   if (drmGetDevice2(fd, 0, &device) != 0) {
+      simple_mtx_unlock(&cached_devices_mutex);
+      return false;
+   }
+
+   entry.rdev = st.st_rdev;
+   entry.is_pci = device->bustype == DRM_BUS_PCI;
+   entry.vendor_id = entry.is_pci ? device->deviceinfo.pci->vendor_id : 0;
+   entry.chip_id = entry.is_pci ? device->deviceinfo.pci->device_id : 0;
+   entry.id_path_tag = drm_construct_id_path_tag(device);
    drmFreeDevice(&device);
-   return tag;
+
+   *info = entry;
+   if (num_cached_devices < MAX_CACHED_DEVICES) {
+      cached_devices[num_cached_devices++] = entry;
+      info->id_path_tag = entry.id_path_tag ? strdup(entry.id_path_tag) : NULL;
+   }
+
+   simple_mtx_unlock(&cached_devices_mutex);
+   return true;
+}
+
+static char *drm_get_id_path_tag_for_fd(int fd)
+{
+   struct loader_device_info info;
+
+   if (!drm_get_device_info_for_fd(fd, &info))
+       return NULL;
+
+   return info.id_path_tag;
 }
 
 int loader_get_user_preferred_fd(int default_fd, bool *different_device)
@@ -386,22 +448,21 @@ int loader_get_user_preferred_fd(int default_fd, bool *different_device)
 static bool
 drm_get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
 {
-   drmDevicePtr device;
+   struct loader_device_info info;
 
-   if (drmGetDevice2(fd, 0, &device) != 0) {
+   if (!drm_get_device_info_for_fd(fd, &info)) {
       log_(_LOADER_WARNING, "MESA-LOADER: failed to retrieve device information\n");
       return false;
    }
+   free(info.id_path_tag);
 
-   if (device->bustype != DRM_BUS_PCI) {
-      drmFreeDevice(&device);
+   if (!info.is_pci) {
       log_(_LOADER_DEBUG, "MESA-LOADER: device is not located on the PCI bus\n");
       return false;
    }
 
-   *vendor_id = device->deviceinfo.pci->vendor_id;
-   *chip_id = device->deviceinfo.pci->device_id;
-   drmFreeDevice(&device);
+   *vendor_id = info.vendor_id;
+   *chip_id = info.chip_id;
    return true;
 }
 #endif
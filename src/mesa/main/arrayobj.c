@@ -397,6 +397,22 @@ _mesa_initialize_vao(struct gl_context *ctx,
 {
    memcpy(vao, &ctx->Array.DefaultVAOState, sizeof(*vao));
    vao->Name = name;
+   _mesa_update_vao_stamp(vao);
+}
+
+
+/**
+ * Give the VAO a new stamp.
+ *
+ * Stamps are unique across all contexts, since VAOs may be shared through
+ * display lists and a freed VAO may be reallocated at the same address.
+ */
+void
+_mesa_update_vao_stamp(struct gl_vertex_array_object *vao)
+{
+   static uint32_t vao_stamp;
+
+   vao->Stamp = p_atomic_inc_return(&vao_stamp);
 }
 
 
@@ -519,6 +535,8 @@ _mesa_update_vao_derived_arrays(struct gl_context *ctx,
    /* Make sure we do not run into problems with shared objects */
    assert(!vao->SharedAndImmutable || vao->NewArrays == 0);
 
+   _mesa_update_vao_stamp(vao);
+
    /* Limit used for common binding scanning below. */
    const GLsizeiptr MaxRelativeOffset =
       ctx->Const.MaxVertexAttribRelativeOffset;
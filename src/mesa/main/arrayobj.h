@@ -83,6 +83,9 @@ _mesa_initialize_vao(struct gl_context *ctx,
                      struct gl_vertex_array_object *obj, GLuint name);
 
 
+extern void
+_mesa_update_vao_stamp(struct gl_vertex_array_object *vao);
+
 extern void
 _mesa_update_vao_derived_arrays(struct gl_context *ctx,
                                 struct gl_vertex_array_object *vao);
@@ -1591,6 +1591,7 @@ copy_array_object(struct gl_context *ctx,
    dest->NewArrays = src->NewArrays;
    dest->NumUpdates = src->NumUpdates;
    dest->IsDynamic = src->IsDynamic;
+   _mesa_update_vao_stamp(dest);
 }
 
 /**
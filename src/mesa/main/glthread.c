@@ -36,6 +36,8 @@
 #include "main/glthread.h"
 #include "main/glthread_marshal.h"
 #include "main/hash.h"
+#include "util/debug.h"
+#include "util/os_time.h"
 #include "util/u_atomic.h"
 #include "util/u_thread.h"
 
@@ -63,6 +65,18 @@ glthread_unmarshal_batch(void *job, int thread_index)
    batch->used = 0;
 }
 
+static void
+glthread_execute_batch(void *job, int thread_index)
+{
+   struct glthread_batch *batch = (struct glthread_batch*)job;
+   struct glthread_state *glthread = &batch->ctx->GLThread;
+   int64_t start = os_time_get_nano();
+
+   glthread_unmarshal_batch(job, thread_index);
+
+   p_atomic_add(&glthread->exec_ns, os_time_get_nano() - start);
+}
+
 static void
 glthread_thread_initialization(void *job, int thread_index)
 {
@@ -90,11 +104,18 @@ _mesa_glthread_init(struct gl_context *ctx)
       return;
    }
 
+   if (!_mesa_glthread_init_shadow_state(ctx)) {
+      _mesa_DeleteHashTable(glthread->VAOs);
+      util_queue_destroy(&glthread->queue);
+      return;
+   }
+
    _mesa_glthread_reset_vao(&glthread->DefaultVAO);
    glthread->CurrentVAO = &glthread->DefaultVAO;
 
    ctx->MarshalExec = _mesa_create_marshal_table(ctx);
    if (!ctx->MarshalExec) {
+      _mesa_glthread_destroy_shadow_state(ctx);
       _mesa_DeleteHashTable(glthread->VAOs);
       util_queue_destroy(&glthread->queue);
       return;
@@ -106,6 +127,11 @@ _mesa_glthread_init(struct gl_context *ctx)
    }
    glthread->next_batch = &glthread->batches[glthread->next];
 
+   glthread->batch_size = MARSHAL_INIT_BATCH_SIZE;
+   glthread->window.start_ns = os_time_get_nano();
+   glthread->counters.enabled = env_var_as_boolean("MESA_GLTHREAD_STATS",
+                                                   false);
+
    glthread->enabled = true;
    glthread->stats.queue = &glthread->queue;
 
@@ -137,6 +163,25 @@ free_vao(GLuint key, void *data, void *userData)
    free(data);
 }
 
+static void
+glthread_print_stats(struct glthread_state *glthread)
+{
+   fprintf(stderr, "glthread: %u flushes, %u syncs (%u waited, "
+           "%u executed calls directly), final batch size %u "
+           "(%u grows, %u shrinks), %u queries answered without a sync\n",
+           glthread->counters.num_flushes, glthread->stats.num_syncs,
+           glthread->counters.num_wait_syncs,
+           glthread->counters.num_direct_syncs, glthread->batch_size,
+           glthread->counters.num_grows, glthread->counters.num_shrinks,
+           glthread->counters.num_shadowed_queries);
+
+   for (unsigned i = 0; i < glthread->counters.num_reasons; i++) {
+      fprintf(stderr, "glthread:    %6u syncs in %s\n",
+              glthread->counters.reason_count[i],
+              glthread->counters.reason[i]);
+   }
+}
+
 void
 _mesa_glthread_destroy(struct gl_context *ctx)
 {
@@ -148,11 +193,15 @@ _mesa_glthread_destroy(struct gl_context *ctx)
    _mesa_glthread_finish(ctx);
    util_queue_destroy(&glthread->queue);
 
+   if (glthread->counters.enabled)
+      glthread_print_stats(glthread);
+
    for (unsigned i = 0; i < MARSHAL_MAX_BATCHES; i++)
       util_queue_fence_destroy(&glthread->batches[i].fence);
 
    _mesa_HashDeleteAll(glthread->VAOs, free_vao, NULL);
    _mesa_DeleteHashTable(glthread->VAOs);
+   _mesa_glthread_destroy_shadow_state(ctx);
 
    ctx->GLThread.enabled = false;
 
@@ -184,6 +233,51 @@ _mesa_glthread_disable(struct gl_context *ctx, const char *func)
    _mesa_glthread_restore_dispatch(ctx, func);
 }
 
+/**
+ * Resize batches based on the calls made since the last adjustment.
+ *
+ * - If the app syncs often, most of the batch being filled is executed
+ *   by the app thread itself, and all queued batches have to be waited for.
+ *   Smaller batches get calls to the worker thread sooner.
+ * - If the worker thread is idle most of the time, it waits for batches to
+ *   fill up. Smaller batches reduce the latency.
+ * - If the worker thread is the bottleneck and batches fill up quickly,
+ *   bigger batches reduce the queue overhead in both threads.
+ */
+static void
+glthread_adapt_batch_size(struct glthread_state *glthread)
+{
+   unsigned num_flushes = glthread->window.num_flushes;
+   unsigned num_syncs = glthread->window.num_syncs;
+
+   if (num_flushes + num_syncs < MARSHAL_ADAPT_INTERVAL)
+      return;
+
+   int64_t now = os_time_get_nano();
+   int64_t elapsed = now - glthread->window.start_ns;
+   int64_t exec = p_atomic_read(&glthread->exec_ns) -
+                  glthread->window.start_exec_ns;
+   unsigned size = glthread->batch_size;
+
+   if (num_syncs * 4 > num_flushes || exec * 2 < elapsed) {
+      size = MAX2(size / 2, MARSHAL_MIN_BATCH_SIZE);
+   } else if (exec >= elapsed &&
+              elapsed / num_flushes < MARSHAL_FAST_BATCH_NS) {
+      size = MIN2(size * 2, MARSHAL_MAX_BATCH_SIZE);
+   }
+
+   if (size > glthread->batch_size)
+      glthread->counters.num_grows++;
+   else if (size < glthread->batch_size)
+      glthread->counters.num_shrinks++;
+   glthread->batch_size = size;
+
+   glthread->window.start_ns = now;
+   glthread->window.start_exec_ns += exec;
+   glthread->window.num_flushes = 0;
+   glthread->window.num_syncs = 0;
+}
+
 void
 _mesa_glthread_flush_batch(struct gl_context *ctx)
 {
@@ -207,22 +301,43 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
    }
 
    p_atomic_add(&glthread->stats.num_offloaded_items, next->used);
+   glthread->counters.num_flushes++;
+   glthread->window.num_flushes++;
+   glthread_adapt_batch_size(glthread);
 
    util_queue_add_job(&glthread->queue, next, &next->fence,
-                      glthread_unmarshal_batch, NULL, 0);
+                      glthread_execute_batch, NULL, 0);
    glthread->last = glthread->next;
    glthread->next = (glthread->next + 1) % MARSHAL_MAX_BATCHES;
    glthread->next_batch = &glthread->batches[glthread->next];
 }
 
-/**
- * Waits for all pending batches have been unmarshaled.
- *
- * This can be used by the main thread to synchronize access to the context,
- * since the worker thread will be idle after this.
- */
-void
-_mesa_glthread_finish(struct gl_context *ctx)
+static void
+glthread_count_sync_reason(struct glthread_state *glthread, const char *func)
+{
+   unsigned i;
+
+   if (!func)
+      func = "(no GL call)";
+
+   /* The reasons are string literals, so comparing pointers is enough. */
+   for (i = 0; i < glthread->counters.num_reasons; i++) {
+      if (glthread->counters.reason[i] == func)
+         break;
+   }
+
+   if (i == glthread->counters.num_reasons) {
+      if (i == MARSHAL_MAX_SYNC_REASONS)
+         return;
+      glthread->counters.reason[i] = func;
+      glthread->counters.num_reasons++;
+   }
+
+   glthread->counters.reason_count[i]++;
+}
+
+static void
+glthread_finish(struct gl_context *ctx, const char *func)
 {
    struct glthread_state *glthread = &ctx->GLThread;
    if (!glthread->enabled)
@@ -242,6 +357,7 @@ _mesa_glthread_finish(struct gl_context *ctx)
 
    if (!util_queue_fence_is_signalled(&last->fence)) {
       util_queue_fence_wait(&last->fence);
+      glthread->counters.num_wait_syncs++;
       synced = true;
    }
 
@@ -254,6 +370,7 @@ _mesa_glthread_finish(struct gl_context *ctx)
       struct _glapi_table *dispatch = _glapi_get_dispatch();
       glthread_unmarshal_batch(next, 0);
       _glapi_set_dispatch(dispatch);
+      glthread->counters.num_direct_syncs++;
 
       /* It's not a sync because we don't enqueue partial batches, but
        * it would be a sync if we did. So count it anyway.
@@ -261,14 +378,32 @@ _mesa_glthread_finish(struct gl_context *ctx)
       synced = true;
    }
 
-   if (synced)
+   if (synced) {
       p_atomic_inc(&glthread->stats.num_syncs);
+      if (glthread->counters.enabled)
+         glthread_count_sync_reason(glthread, func);
+
+      glthread->window.num_syncs++;
+      glthread_adapt_batch_size(glthread);
+   }
+}
+
+/**
+ * Waits for all pending batches have been unmarshaled.
+ *
+ * This can be used by the main thread to synchronize access to the context,
+ * since the worker thread will be idle after this.
+ */
+void
+_mesa_glthread_finish(struct gl_context *ctx)
+{
+   glthread_finish(ctx, NULL);
 }
 
 void
 _mesa_glthread_finish_before(struct gl_context *ctx, const char *func)
 {
-   _mesa_glthread_finish(ctx);
+   glthread_finish(ctx, func);
 
    /* Uncomment this if you want to know where glthread syncs. */
    /*printf("fallback to sync: %s\n", func);*/
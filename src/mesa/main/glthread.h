@@ -24,16 +24,37 @@
 #ifndef _GLTHREAD_H
 #define _GLTHREAD_H
 
-/* The size of one batch and the maximum size of one call.
+/* The maximum size of one call. A call of up to this size always fits
+ * into an empty batch.
+ */
+#define MARSHAL_MAX_CMD_SIZE (8 * 1024)
+
+/* The range of batch sizes, and the capacity of each batch buffer.
  *
- * This should be as low as possible, so that:
+ * Batches should be as small as possible, so that:
  * - multiple synchronizations within a frame don't slow us down much
  * - a smaller number of calls per frame can still get decent parallelism
  * - the memory footprint of the queue is low, and with that comes a lower
  *   chance of experiencing CPU cache thrashing
- * but it should be high enough so that u_queue overhead remains negligible.
+ * but big enough that u_queue overhead remains negligible. Since the best
+ * size depends on the app, the batch size adapts within this range to the
+ * observed call rate, worker thread load and number of syncs.
+ * See glthread_adapt_batch_size.
  */
-#define MARSHAL_MAX_CMD_SIZE (8 * 1024)
+#define MARSHAL_MIN_BATCH_SIZE (2 * 1024)
+#define MARSHAL_INIT_BATCH_SIZE (8 * 1024)
+#define MARSHAL_MAX_BATCH_SIZE (64 * 1024)
+
+/* The batch size is reconsidered after this many flushes and syncs. */
+#define MARSHAL_ADAPT_INTERVAL 16
+
+/* Batches filled in less time than this are grown if the worker thread
+ * can't keep up.
+ */
+#define MARSHAL_FAST_BATCH_NS (100 * 1000)
+
+/* The number of distinct functions that glthread counts syncs for. */
+#define MARSHAL_MAX_SYNC_REASONS 32
 
 /* The number of batch slots in memory.
  *
@@ -46,6 +67,11 @@
 /* Special value for glEnableClientState(GL_PRIMITIVE_RESTART_NV). */
 #define VERT_ATTRIB_PRIMITIVE_RESTART_NV -1
 
+/* Bits of glthread_state::KnownState, see glthread_get.c. */
+#define GLTHREAD_KNOWN_VIEWPORT           (1 << 0)
+#define GLTHREAD_KNOWN_ACTIVE_TEXTURE     (1 << 1)
+#define GLTHREAD_KNOWN_CURRENT_PROGRAM    (1 << 2)
+
 #include <inttypes.h>
 #include <stdbool.h>
 #include "util/u_queue.h"
@@ -105,7 +131,7 @@ struct glthread_batch
 #else
    __attribute__((aligned(8)))
 #endif
-   uint8_t buffer[MARSHAL_MAX_CMD_SIZE];
+   uint8_t buffer[MARSHAL_MAX_BATCH_SIZE];
 };
 
 struct glthread_client_attrib {
@@ -146,6 +172,34 @@ struct glthread_state
    /** Index of the batch being filled and about to be submitted. */
    unsigned next;
 
+   /** The size at which the batch being filled is submitted. */
+   unsigned batch_size;
+
+   /** Time spent executing batches, updated by the worker thread. */
+   uint64_t exec_ns;
+
+   /** The measurements the batch size is adapted from. */
+   struct {
+      int64_t start_ns;
+      uint64_t start_exec_ns;
+      unsigned num_flushes;
+      unsigned num_syncs;
+   } window;
+
+   /** Counters, printed on context destruction with MESA_GLTHREAD_STATS. */
+   struct {
+      bool enabled;
+      unsigned num_flushes;      /**< batches submitted because they were full */
+      unsigned num_wait_syncs;   /**< syncs that waited for the worker thread */
+      unsigned num_direct_syncs; /**< syncs that executed queued calls directly */
+      unsigned num_grows;
+      unsigned num_shrinks;
+      unsigned num_shadowed_queries; /**< queries answered without a sync */
+      unsigned num_reasons;
+      const char *reason[MARSHAL_MAX_SYNC_REASONS];
+      unsigned reason_count[MARSHAL_MAX_SYNC_REASONS];
+   } counters;
+
    /** Upload buffer. */
    struct gl_buffer_object *upload_buffer;
    uint8_t *upload_ptr;
@@ -175,6 +229,21 @@ struct glthread_state
    /** Currently-bound buffer object IDs. */
    GLuint CurrentArrayBufferName;
    GLuint CurrentDrawIndirectBufferName;
+
+   /**
+    * State shadowed for glGet* and glIsEnabled, so that they don't have to
+    * sync.  Anything glthread can't follow (display lists, glPopAttrib,
+    * indexed variants) makes it unknown, and the query syncs again.
+    */
+   GLbitfield EnabledCaps; /**< Bitmask of GLTHREAD_CAP_*. */
+   GLbitfield KnownCaps;   /**< Bitmask of GLTHREAD_CAP_*. */
+   GLbitfield KnownState;  /**< Bitmask of GLTHREAD_KNOWN_*. */
+   GLint Viewport[4];
+   GLenum ActiveTexture;
+   GLuint CurrentProgram;
+
+   /** Uniform locations looked up by the app, indexed by program name. */
+   struct _mesa_HashTable *UniformLocations;
 };
 
 void _mesa_glthread_init(struct gl_context *ctx);
@@ -245,4 +314,16 @@ void _mesa_glthread_PushClientAttrib(struct gl_context *ctx, GLbitfield mask,
 void _mesa_glthread_PopClientAttrib(struct gl_context *ctx);
 void _mesa_glthread_ClientAttribDefault(struct gl_context *ctx, GLbitfield mask);
 
+bool _mesa_glthread_init_shadow_state(struct gl_context *ctx);
+void _mesa_glthread_destroy_shadow_state(struct gl_context *ctx);
+void _mesa_glthread_forget_state(struct gl_context *ctx);
+void _mesa_glthread_forget_enable(struct gl_context *ctx, GLenum cap);
+void _mesa_glthread_forget_uniform_locations(struct gl_context *ctx,
+                                             GLuint program);
+void _mesa_glthread_Enable(struct gl_context *ctx, GLenum cap, bool enable);
+void _mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                             GLsizei width, GLsizei height);
+void _mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture);
+void _mesa_glthread_UseProgram(struct gl_context *ctx, GLuint program);
+
 #endif /* _GLTHREAD_H*/
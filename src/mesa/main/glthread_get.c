@@ -0,0 +1,448 @@
+/*
+ * Copyright © 2020 Advanced Micro Devices, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* glGet*, glIsEnabled and glGetUniformLocation answered from state that
+ * glthread shadows, so that the app thread doesn't have to wait for the
+ * worker thread.  Everything else falls back to a sync.
+ *
+ * The shadowed state follows what the app asked for, like the buffer and
+ * VAO bindings glthread already tracks.  Calls that fail with a GL error
+ * aren't detected, except where the check is cheap (e.g. a negative
+ * viewport size).
+ */
+
+#include <math.h>
+
+#include "main/glthread_marshal.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/hash.h"
+#include "main/mtypes.h"
+#include "main/shaderobj.h"
+#include "main/texstate.h"
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+
+/* Caps that are valid in all APIs and without an index. */
+enum glthread_cap {
+   GLTHREAD_CAP_BLEND,
+   GLTHREAD_CAP_CULL_FACE,
+   GLTHREAD_CAP_DEPTH_TEST,
+   GLTHREAD_CAP_DITHER,
+   GLTHREAD_CAP_POLYGON_OFFSET_FILL,
+   GLTHREAD_CAP_SAMPLE_ALPHA_TO_COVERAGE,
+   GLTHREAD_CAP_SAMPLE_COVERAGE,
+   GLTHREAD_CAP_SCISSOR_TEST,
+   GLTHREAD_CAP_STENCIL_TEST,
+   GLTHREAD_NUM_CAPS,
+};
+
+static int
+get_cap(GLenum cap)
+{
+   switch (cap) {
+   case GL_BLEND:
+      return GLTHREAD_CAP_BLEND;
+   case GL_CULL_FACE:
+      return GLTHREAD_CAP_CULL_FACE;
+   case GL_DEPTH_TEST:
+      return GLTHREAD_CAP_DEPTH_TEST;
+   case GL_DITHER:
+      return GLTHREAD_CAP_DITHER;
+   case GL_POLYGON_OFFSET_FILL:
+      return GLTHREAD_CAP_POLYGON_OFFSET_FILL;
+   case GL_SAMPLE_ALPHA_TO_COVERAGE:
+      return GLTHREAD_CAP_SAMPLE_ALPHA_TO_COVERAGE;
+   case GL_SAMPLE_COVERAGE:
+      return GLTHREAD_CAP_SAMPLE_COVERAGE;
+   case GL_SCISSOR_TEST:
+      return GLTHREAD_CAP_SCISSOR_TEST;
+   case GL_STENCIL_TEST:
+      return GLTHREAD_CAP_STENCIL_TEST;
+   default:
+      return -1;
+   }
+}
+
+static void
+set_cap(struct glthread_state *glthread, enum glthread_cap cap, bool enable)
+{
+   if (enable)
+      glthread->EnabledCaps |= BITFIELD_BIT(cap);
+   else
+      glthread->EnabledCaps &= ~BITFIELD_BIT(cap);
+
+   glthread->KnownCaps |= BITFIELD_BIT(cap);
+}
+
+/**
+ * Called by _mesa_glthread_init before the worker thread starts, so the
+ * context can be read directly.  The viewport is set by the first
+ * MakeCurrent, which can happen later, so it's only known after the app
+ * sets it.
+ */
+bool
+_mesa_glthread_init_shadow_state(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+
+   glthread->UniformLocations = _mesa_NewHashTable();
+   if (!glthread->UniformLocations)
+      return false;
+
+   glthread->EnabledCaps = 0;
+   glthread->KnownCaps = 0;
+   set_cap(glthread, GLTHREAD_CAP_BLEND, ctx->Color.BlendEnabled & 1);
+   set_cap(glthread, GLTHREAD_CAP_CULL_FACE, ctx->Polygon.CullFlag);
+   set_cap(glthread, GLTHREAD_CAP_DEPTH_TEST, ctx->Depth.Test);
+   set_cap(glthread, GLTHREAD_CAP_DITHER, ctx->Color.DitherFlag);
+   set_cap(glthread, GLTHREAD_CAP_POLYGON_OFFSET_FILL,
+           ctx->Polygon.OffsetFill);
+   set_cap(glthread, GLTHREAD_CAP_SAMPLE_ALPHA_TO_COVERAGE,
+           ctx->Multisample.SampleAlphaToCoverage);
+   set_cap(glthread, GLTHREAD_CAP_SAMPLE_COVERAGE,
+           ctx->Multisample.SampleCoverage);
+   set_cap(glthread, GLTHREAD_CAP_SCISSOR_TEST, ctx->Scissor.EnableFlags & 1);
+   set_cap(glthread, GLTHREAD_CAP_STENCIL_TEST, ctx->Stencil.Enabled);
+
+   glthread->ActiveTexture = GL_TEXTURE0 + ctx->Texture.CurrentUnit;
+   glthread->CurrentProgram = ctx->Shader.ActiveProgram ?
+                              ctx->Shader.ActiveProgram->Name : 0;
+   glthread->KnownState = GLTHREAD_KNOWN_ACTIVE_TEXTURE |
+                          GLTHREAD_KNOWN_CURRENT_PROGRAM;
+   return true;
+}
+
+static void
+free_uniform_locations(GLuint key, void *data, void *userData)
+{
+   _mesa_hash_table_destroy(data, NULL);
+}
+
+void
+_mesa_glthread_destroy_shadow_state(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+
+   _mesa_HashDeleteAll(glthread->UniformLocations, free_uniform_locations,
+                       NULL);
+   _mesa_DeleteHashTable(glthread->UniformLocations);
+   glthread->UniformLocations = NULL;
+}
+
+/**
+ * Called for glPopAttrib and glCallList(s), which can change any of the
+ * shadowed state.
+ */
+void
+_mesa_glthread_forget_state(struct gl_context *ctx)
+{
+   ctx->GLThread.KnownCaps = 0;
+   ctx->GLThread.KnownState = 0;
+}
+
+void
+_mesa_glthread_forget_enable(struct gl_context *ctx, GLenum cap)
+{
+   int i = get_cap(cap);
+
+   if (i >= 0)
+      ctx->GLThread.KnownCaps &= ~BITFIELD_BIT(i);
+}
+
+void
+_mesa_glthread_Enable(struct gl_context *ctx, GLenum cap, bool enable)
+{
+   int i = get_cap(cap);
+
+   if (i < 0)
+      return;
+
+   /* Without GL_COMPILE_AND_EXECUTE, the call doesn't change the state. */
+   if (ctx->GLThread.inside_dlist)
+      _mesa_glthread_forget_enable(ctx, cap);
+   else
+      set_cap(&ctx->GLThread, i, enable);
+}
+
+void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+
+   if (glthread->inside_dlist || width < 0 || height < 0) {
+      glthread->KnownState &= ~GLTHREAD_KNOWN_VIEWPORT;
+      return;
+   }
+
+   /* This matches clamp_viewport in viewport.c. */
+   GLfloat fx = x, fy = y;
+
+   if (_mesa_has_ARB_viewport_array(ctx) ||
+       _mesa_has_OES_viewport_array(ctx)) {
+      fx = CLAMP(fx, ctx->Const.ViewportBounds.Min,
+                 ctx->Const.ViewportBounds.Max);
+      fy = CLAMP(fy, ctx->Const.ViewportBounds.Min,
+                 ctx->Const.ViewportBounds.Max);
+   }
+
+   glthread->Viewport[0] = lroundf(fx);
+   glthread->Viewport[1] = lroundf(fy);
+   glthread->Viewport[2] = MIN2(width, (GLsizei)ctx->Const.MaxViewportWidth);
+   glthread->Viewport[3] = MIN2(height, (GLsizei)ctx->Const.MaxViewportHeight);
+   glthread->KnownState |= GLTHREAD_KNOWN_VIEWPORT;
+}
+
+void
+_mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+
+   if (glthread->inside_dlist ||
+       texture - GL_TEXTURE0 >= _mesa_max_tex_unit(ctx)) {
+      glthread->KnownState &= ~GLTHREAD_KNOWN_ACTIVE_TEXTURE;
+      return;
+   }
+
+   glthread->ActiveTexture = texture;
+   glthread->KnownState |= GLTHREAD_KNOWN_ACTIVE_TEXTURE;
+}
+
+void
+_mesa_glthread_UseProgram(struct gl_context *ctx, GLuint program)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+
+   if (glthread->inside_dlist) {
+      glthread->KnownState &= ~GLTHREAD_KNOWN_CURRENT_PROGRAM;
+      return;
+   }
+
+   glthread->CurrentProgram = program;
+   glthread->KnownState |= GLTHREAD_KNOWN_CURRENT_PROGRAM;
+}
+
+/**
+ * Return the number of values written to params, or 0 if glthread doesn't
+ * know the answer.
+ */
+static unsigned
+get_shadowed_integers(struct gl_context *ctx, GLenum pname, GLint *params)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+   int cap = get_cap(pname);
+
+   if (cap >= 0) {
+      if (!(glthread->KnownCaps & BITFIELD_BIT(cap)))
+         return 0;
+
+      params[0] = !!(glthread->EnabledCaps & BITFIELD_BIT(cap));
+      return 1;
+   }
+
+   switch (pname) {
+   case GL_VIEWPORT:
+      if (!(glthread->KnownState & GLTHREAD_KNOWN_VIEWPORT))
+         return 0;
+
+      memcpy(params, glthread->Viewport, sizeof(glthread->Viewport));
+      return 4;
+
+   case GL_ACTIVE_TEXTURE:
+      if (!(glthread->KnownState & GLTHREAD_KNOWN_ACTIVE_TEXTURE))
+         return 0;
+
+      params[0] = glthread->ActiveTexture;
+      return 1;
+
+   case GL_CURRENT_PROGRAM:
+      if (ctx->API == API_OPENGLES ||
+          !(glthread->KnownState & GLTHREAD_KNOWN_CURRENT_PROGRAM))
+         return 0;
+
+      params[0] = glthread->CurrentProgram;
+      return 1;
+
+   /* glthread only tracks these in the compatibility profile and GLES. */
+   case GL_ARRAY_BUFFER_BINDING:
+      if (ctx->API == API_OPENGL_CORE)
+         return 0;
+
+      params[0] = glthread->CurrentArrayBufferName;
+      return 1;
+
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      if (ctx->API == API_OPENGL_CORE)
+         return 0;
+
+      params[0] = glthread->CurrentVAO->CurrentElementBufferName;
+      return 1;
+
+   case GL_VERTEX_ARRAY_BINDING:
+      if (ctx->API != API_OPENGL_COMPAT && !_mesa_is_gles3(ctx))
+         return 0;
+
+      params[0] = glthread->CurrentVAO->Name;
+      return 1;
+
+   case GL_CLIENT_ACTIVE_TEXTURE:
+      if (ctx->API != API_OPENGL_COMPAT && ctx->API != API_OPENGLES)
+         return 0;
+
+      params[0] = GL_TEXTURE0 + glthread->ClientActiveTexture;
+      return 1;
+
+   default:
+      return 0;
+   }
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (get_shadowed_integers(ctx, pname, params)) {
+      ctx->GLThread.counters.num_shadowed_queries++;
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetIntegerv");
+   CALL_GetIntegerv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint values[4];
+   unsigned count = get_shadowed_integers(ctx, pname, values);
+
+   if (count) {
+      for (unsigned i = 0; i < count; i++)
+         params[i] = values[i] ? GL_TRUE : GL_FALSE;
+
+      ctx->GLThread.counters.num_shadowed_queries++;
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetBooleanv");
+   CALL_GetBooleanv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+GLboolean GLAPIENTRY
+_mesa_marshal_IsEnabled(GLenum cap)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct glthread_state *glthread = &ctx->GLThread;
+   int i = get_cap(cap);
+
+   if (i >= 0 && glthread->KnownCaps & BITFIELD_BIT(i)) {
+      glthread->counters.num_shadowed_queries++;
+      return !!(glthread->EnabledCaps & BITFIELD_BIT(i));
+   }
+
+   _mesa_glthread_finish_before(ctx, "IsEnabled");
+   return CALL_IsEnabled(ctx->CurrentServerDispatch, (cap));
+}
+
+/**
+ * Called when the program is linked or deleted, which invalidates its
+ * uniform locations.
+ */
+void
+_mesa_glthread_forget_uniform_locations(struct gl_context *ctx,
+                                        GLuint program)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+   struct hash_table *locations;
+
+   if (!program)
+      return;
+
+   locations = _mesa_HashLookupLocked(glthread->UniformLocations, program);
+   if (!locations)
+      return;
+
+   _mesa_HashRemoveLocked(glthread->UniformLocations, program);
+   _mesa_hash_table_destroy(locations, NULL);
+}
+
+GLint GLAPIENTRY
+_mesa_marshal_GetUniformLocation(GLuint program, const GLchar *name)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct glthread_state *glthread = &ctx->GLThread;
+   struct hash_table *locations = NULL;
+   struct gl_shader_program *shProg;
+   struct hash_entry *entry;
+   GLint location;
+
+   /* Another context can relink a shared program behind our back, so only
+    * cache locations while this context doesn't share its objects.
+    */
+   if (ctx->Shared->RefCount == 1) {
+      locations = _mesa_HashLookupLocked(glthread->UniformLocations,
+                                         program);
+   } else {
+      _mesa_HashDeleteAll(glthread->UniformLocations, free_uniform_locations,
+                          NULL);
+   }
+
+   if (locations && name) {
+      entry = _mesa_hash_table_search(locations, name);
+      if (entry) {
+         glthread->counters.num_shadowed_queries++;
+         return (GLint)(intptr_t)entry->data;
+      }
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetUniformLocation");
+   location = CALL_GetUniformLocation(ctx->CurrentServerDispatch,
+                                      (program, name));
+
+   if (ctx->Shared->RefCount > 1 || !program || !name)
+      return location;
+
+   /* glthread is idle now, so the program can be inspected directly.  Only
+    * the locations of linked programs are cached, because the lookup is an
+    * error otherwise.  That includes -1 for inactive uniforms.
+    */
+   shProg = _mesa_lookup_shader_program(ctx, program);
+   if (!shProg || shProg->data->LinkStatus == LINKING_FAILURE)
+      return location;
+
+   if (!locations) {
+      locations = _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                          _mesa_key_string_equal);
+      if (!locations)
+         return location;
+
+      _mesa_HashInsertLocked(glthread->UniformLocations, program, locations);
+   }
+
+   _mesa_hash_table_insert(locations, ralloc_strdup(locations, name),
+                           (void *)(intptr_t)location);
+   return location;
+}
@@ -60,7 +60,7 @@ _mesa_glthread_allocate_command(struct gl_context *ctx,
    struct glthread_batch *next = glthread->next_batch;
    struct marshal_cmd_base *cmd_base;
 
-   if (unlikely(next->used + size > MARSHAL_MAX_CMD_SIZE)) {
+   if (unlikely(next->used + size > glthread->batch_size && next->used)) {
       _mesa_glthread_flush_batch(ctx);
       next = glthread->next_batch;
    }
@@ -48,6 +48,7 @@
 #include "compiler/shader_info.h"
 #include "main/formats.h"       /* MESA_FORMAT_COUNT */
 #include "compiler/glsl/list.h"
+#include "util/bitset.h"
 #include "util/simple_mtx.h"
 #include "util/u_dynarray.h"
 #include "vbo/vbo.h"
@@ -1276,6 +1277,12 @@ struct gl_texture_attrib
    /** GL_ARB_seamless_cubemap */
    GLboolean CubeMapSeamless;
 
+   /**
+    * Units whose texture or sampler binding changed, flagged with
+    * _NEW_TEXTURE_UNIT. Cleared after the driver has been notified.
+    */
+   BITSET_DECLARE(_DirtyUnits, MAX_COMBINED_TEXTURE_IMAGE_UNITS);
+
    struct gl_texture_unit Unit[MAX_COMBINED_TEXTURE_IMAGE_UNITS];
    struct gl_fixedfunc_texture_unit FixedFuncUnit[MAX_TEXTURE_COORD_UNITS];
 };
@@ -1593,6 +1600,12 @@ struct gl_vertex_array_object
    /** Mask of VERT_BIT_* values indicating changed/dirty arrays */
    GLbitfield NewArrays;
 
+   /**
+    * Unique value that is renewed whenever the derived array state is
+    * recomputed, so drivers can cache vertex state translated from this VAO.
+    */
+   unsigned Stamp;
+
    /** The index buffer (also known as the element array buffer in OpenGL). */
    struct gl_buffer_object *IndexBufferObj;
 };
@@ -4163,6 +4176,12 @@ struct gl_constants
    /** When drivers are OK with mapped buffers during draw and other calls. */
    bool AllowMappedBuffersDuringExecution;
 
+   /**
+    * Whether the driver handles _NEW_TEXTURE_UNIT. Otherwise, it's turned
+    * into _NEW_TEXTURE_OBJECT before calling UpdateState.
+    */
+   bool HasTextureUnitDirtyTracking;
+
    /**
     * Whether buffer creation, unsynchronized mapping, unmapping, and
     * deletion is thread-safe.
@@ -4550,7 +4569,7 @@ struct gl_matrix_stack
 #define _NEW_TRANSFORM         (1u << 17)  /**< gl_context::Transform */
 #define _NEW_VIEWPORT          (1u << 18)  /**< gl_context::Viewport */
 #define _NEW_TEXTURE_STATE     (1u << 19)  /**< gl_context::Texture (states only) */
-/* gap */
+#define _NEW_TEXTURE_UNIT      (1u << 20)  /**< gl_context::Texture (bindings of _DirtyUnits only) */
 #define _NEW_RENDERMODE        (1u << 21)  /**< gl_context::RenderMode, etc */
 #define _NEW_BUFFERS           (1u << 22)  /**< gl_context::Visual, DrawBuffer, */
 #define _NEW_CURRENT_ATTRIB    (1u << 23)  /**< gl_context::Current */
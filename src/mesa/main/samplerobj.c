@@ -37,6 +37,7 @@
 #include "main/macros.h"
 #include "main/mtypes.h"
 #include "main/samplerobj.h"
+#include "main/texobj.h"
 #include "main/texturebindless.h"
 #include "util/u_memory.h"
 
@@ -302,7 +303,8 @@ _mesa_bind_sampler(struct gl_context *ctx, GLuint unit,
                    struct gl_sampler_object *sampObj)
 {
    if (ctx->Texture.Unit[unit].Sampler != sampObj) {
-      FLUSH_VERTICES(ctx, _NEW_TEXTURE_OBJECT);
+      FLUSH_VERTICES(ctx, 0);
+      _mesa_dirty_texture_unit(ctx, unit);
    }
 
    _mesa_reference_sampler_object(ctx, &ctx->Texture.Unit[unit].Sampler,
@@ -417,7 +419,7 @@ bind_samplers(struct gl_context *ctx, GLuint first, GLsizei count,
             _mesa_reference_sampler_object(ctx,
                                            &ctx->Texture.Unit[unit].Sampler,
                                            sampObj);
-            ctx->NewState |= _NEW_TEXTURE_OBJECT;
+            _mesa_dirty_texture_unit(ctx, unit);
          }
       }
 
@@ -431,7 +433,7 @@ bind_samplers(struct gl_context *ctx, GLuint first, GLsizei count,
             _mesa_reference_sampler_object(ctx,
                                            &ctx->Texture.Unit[unit].Sampler,
                                            NULL);
-            ctx->NewState |= _NEW_TEXTURE_OBJECT;
+            _mesa_dirty_texture_unit(ctx, unit);
          }
       }
    }
@@ -399,6 +399,15 @@ _mesa_update_state_locked( struct gl_context *ctx )
    GLbitfield new_prog_state = 0x0;
    const GLbitfield computed_states = ~(_NEW_CURRENT_ATTRIB | _NEW_LINE);
 
+   /* A binding change of a few texture units is a texture binding change
+    * for everything here. Drivers only see the difference if they ask for it.
+    */
+   if (new_state & _NEW_TEXTURE_UNIT) {
+      new_state |= _NEW_TEXTURE_OBJECT;
+      if (!ctx->Const.HasTextureUnitDirtyTracking)
+         ctx->NewState |= _NEW_TEXTURE_OBJECT;
+   }
+
    /* we can skip a bunch of state validation checks if the dirty
     * state matches one or more bits in 'computed_states'.
     */
@@ -491,6 +500,9 @@ _mesa_update_state_locked( struct gl_context *ctx )
     * active modules (such as swrast_setup, swrast, tnl, etc).
     */
    ctx->Driver.UpdateState(ctx);
+
+   if (ctx->NewState & _NEW_TEXTURE_UNIT)
+      BITSET_ZERO(ctx->Texture._DirtyUnits);
    ctx->NewState = 0;
 }
 
@@ -42,6 +42,8 @@
 #include "texcompress_s3tc.h"
 #include "texcompress_etc.h"
 #include "texcompress_bptc.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_thread.h"
 
 
 /**
@@ -961,3 +963,69 @@ _mesa_decompress_image(mesa_format format, GLuint width, GLuint height,
       }
    }
 }
+
+
+/* Images with fewer blocks than this per thread are decoded on the calling
+ * thread.
+ */
+#define MIN_BLOCKS_PER_THREAD 4096
+#define MAX_THREADS 8
+
+struct unpack_rows_job {
+   compressed_unpack_rows_func func;
+   void *data;
+   unsigned start, end;
+};
+
+static int
+unpack_rows_thread(void *data)
+{
+   struct unpack_rows_job *job = data;
+
+   job->func(job->data, job->start, job->end);
+   return 0;
+}
+
+/**
+ * Decode a compressed image on the CPU, in parallel if it's big enough.
+ *
+ * Drivers without support for ETC2 or ASTC get those textures decoded at
+ * upload time, which can be hundreds of MB for some apps.  The image is
+ * split into bands of block rows, which func decodes independently.
+ *
+ * \param num_blocks  total number of blocks in the image
+ * \param num_block_rows  number of block rows in the image
+ */
+void
+_mesa_unpack_compressed_rows(unsigned num_blocks, unsigned num_block_rows,
+                             compressed_unpack_rows_func func, void *data)
+{
+   struct unpack_rows_job jobs[MAX_THREADS];
+   thrd_t threads[MAX_THREADS];
+   unsigned num_threads, i;
+
+   util_cpu_detect();
+   num_threads = MIN3(num_blocks / MIN_BLOCKS_PER_THREAD,
+                      (unsigned)util_cpu_caps.nr_cpus, MAX_THREADS);
+   num_threads = CLAMP(num_threads, 1, MAX2(num_block_rows, 1));
+
+   for (i = 0; i < num_threads; i++) {
+      jobs[i].func = func;
+      jobs[i].data = data;
+      jobs[i].start = num_block_rows * i / num_threads;
+      jobs[i].end = num_block_rows * (i + 1) / num_threads;
+   }
+
+   /* The first band is decoded by this thread. */
+   for (i = 1; i < num_threads; i++)
+      threads[i] = u_thread_create(unpack_rows_thread, &jobs[i]);
+
+   func(data, jobs[0].start, jobs[0].end);
+
+   for (i = 1; i < num_threads; i++) {
+      if (threads[i])
+         thrd_join(threads[i], NULL);
+      else
+         func(data, jobs[i].start, jobs[i].end);
+   }
+}
@@ -28,6 +28,10 @@
 #include "formats.h"
 #include "glheader.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct gl_context;
 
 extern GLenum
@@ -63,4 +67,17 @@ _mesa_decompress_image(mesa_format format, GLuint width, GLuint height,
                        const GLubyte *src, GLint srcRowStride,
                        GLfloat *dest);
 
+
+/** Decodes the block rows [start, end) of an image */
+typedef void (*compressed_unpack_rows_func)(void *data,
+                                            unsigned start, unsigned end);
+
+extern void
+_mesa_unpack_compressed_rows(unsigned num_blocks, unsigned num_block_rows,
+                             compressed_unpack_rows_func func, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* TEXCOMPRESS_H */
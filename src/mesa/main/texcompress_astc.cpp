@@ -36,16 +36,30 @@
 #include "texcompress_astc.h"
 #include "macros.h"
 #include "util/half_float.h"
+#include "c11/threads.h"
 #include <stdio.h>
 #include <cstdlib>  // for abort() on windows
 
 static bool VERBOSE_DECODE = false;
 static bool VERBOSE_WRITE = false;
 
+/* The conversion goes through half floats for every texel, which is most of
+ * the cost of writing a decoded block, so it is done with a table.
+ */
+static uint8_t unorm8_table[1 << 16];
+static once_flag unorm8_table_once = ONCE_FLAG_INIT;
+
+static void
+init_unorm8_table(void)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(unorm8_table); i++)
+      unorm8_table[i] = _mesa_half_to_unorm8(_mesa_uint16_div_64k_to_half(i));
+}
+
 static inline uint8_t
 uint16_div_64k_to_half_to_unorm8(uint16_t v)
 {
-   return _mesa_half_to_unorm8(_mesa_uint16_div_64k_to_half(v));
+   return unorm8_table[v];
 }
 
 class decode_error
@@ -1814,6 +1828,56 @@ decode_error::type Block::calculate_colour_endpoints_size()
    return decode_error::invalid_colour_endpoints_size;
 }
 
+struct astc_decode_job
+{
+   const Decoder *dec;
+   uint8_t *dst_row;
+   unsigned dst_stride;
+   const uint8_t *src_row;
+   unsigned src_stride;
+   unsigned src_width, src_height;
+};
+
+static void
+unpack_astc_2d_ldr_rows(void *data, unsigned y_start, unsigned y_end)
+{
+   const astc_decode_job *job = (const astc_decode_job *)data;
+   const Decoder &dec = *job->dec;
+   const unsigned blk_w = dec.block_w, blk_h = dec.block_h;
+   const unsigned block_size = 16;
+   const unsigned x_blocks = (job->src_width + blk_w - 1) / blk_w;
+   const uint8_t *src_row = job->src_row + y_start * job->src_stride;
+   uint8_t *dst_row = job->dst_row + y_start * job->dst_stride * blk_h;
+
+   for (unsigned y = y_start; y < y_end; ++y) {
+      for (unsigned x = 0; x < x_blocks; ++x) {
+         /* Same size as the largest block. */
+         uint16_t block_out[12 * 12 * 4];
+
+         dec.decode(src_row + x * block_size, block_out);
+
+         /* This can be smaller with NPOT dimensions. */
+         unsigned dst_blk_w = MIN2(blk_w, job->src_width  - x*blk_w);
+         unsigned dst_blk_h = MIN2(blk_h, job->src_height - y*blk_h);
+
+         for (unsigned sub_y = 0; sub_y < dst_blk_h; ++sub_y) {
+            for (unsigned sub_x = 0; sub_x < dst_blk_w; ++sub_x) {
+               uint8_t *dst = dst_row + sub_y * job->dst_stride +
+                              (x * blk_w + sub_x) * 4;
+               const uint16_t *src = &block_out[(sub_y * blk_w + sub_x) * 4];
+
+               dst[0] = src[0];
+               dst[1] = src[1];
+               dst[2] = src[2];
+               dst[3] = src[3];
+            }
+         }
+      }
+      src_row += job->src_stride;
+      dst_row += job->dst_stride * blk_h;
+   }
+}
+
 /**
  * Decode ASTC 2D LDR texture data.
  *
@@ -1836,37 +1900,22 @@ _mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
    unsigned blk_w, blk_h;
    _mesa_get_format_block_size(format, &blk_w, &blk_h);
 
-   const unsigned block_size = 16;
    unsigned x_blocks = (src_width + blk_w - 1) / blk_w;
    unsigned y_blocks = (src_height + blk_h - 1) / blk_h;
 
-   Decoder dec(blk_w, blk_h, 1, srgb, true);
-
-   for (unsigned y = 0; y < y_blocks; ++y) {
-      for (unsigned x = 0; x < x_blocks; ++x) {
-         /* Same size as the largest block. */
-         uint16_t block_out[12 * 12 * 4];
-
-         dec.decode(src_row + x * block_size, block_out);
-
-         /* This can be smaller with NPOT dimensions. */
-         unsigned dst_blk_w = MIN2(blk_w, src_width  - x*blk_w);
-         unsigned dst_blk_h = MIN2(blk_h, src_height - y*blk_h);
+   call_once(&unorm8_table_once, init_unorm8_table);
 
-         for (unsigned sub_y = 0; sub_y < dst_blk_h; ++sub_y) {
-            for (unsigned sub_x = 0; sub_x < dst_blk_w; ++sub_x) {
-               uint8_t *dst = dst_row + sub_y * dst_stride +
-                              (x * blk_w + sub_x) * 4;
-               const uint16_t *src = &block_out[(sub_y * blk_w + sub_x) * 4];
+   Decoder dec(blk_w, blk_h, 1, srgb, true);
 
-               dst[0] = src[0];
-               dst[1] = src[1];
-               dst[2] = src[2];
-               dst[3] = src[3];
-            }
-         }
-      }
-      src_row += src_stride;
-      dst_row += dst_stride * blk_h;
-   }
+   astc_decode_job job;
+   job.dec = &dec;
+   job.dst_row = dst_row;
+   job.dst_stride = dst_stride;
+   job.src_row = src_row;
+   job.src_stride = src_stride;
+   job.src_width = src_width;
+   job.src_height = src_height;
+
+   _mesa_unpack_compressed_rows(x_blocks * y_blocks, y_blocks,
+                                unpack_astc_2d_ldr_rows, &job);
 }
@@ -659,21 +659,27 @@ decompress_rgba_unorm_block(int src_width, int src_height,
                             const uint8_t *block,
                             uint8_t *dst_row, int dst_rowstride)
 {
+   static const uint8_t weights2[] = { 0, 21, 43, 64 };
+   static const uint8_t weights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+   static const uint8_t weights4[] =
+      { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+   static const uint8_t *weights[] = {
+      NULL, NULL, weights2, weights3, weights4
+   };
    int mode_num = ffs(block[0]);
    const struct bptc_unorm_mode *mode;
    int bit_offset, secondary_bit_offset;
    int partition_num;
-   int subset_num;
    int rotation;
    int index_selection;
    int index_bits;
-   int indices[2];
-   int index;
-   int anchors_before_texel;
-   bool anchor;
+   uint8_t indices[2][BLOCK_SIZE * BLOCK_SIZE];
+   const uint8_t *color_indices, *alpha_indices;
+   const uint8_t *color_weights, *alpha_weights;
    uint8_t endpoints[3 * 2][4];
    uint32_t subsets;
    int component;
+   int texel;
    unsigned x, y;
 
    if (mode_num == 0) {
@@ -727,66 +733,64 @@ decompress_rgba_unorm_block(int src_width, int src_height,
 
    bit_offset = extract_unorm_endpoints(mode, block, bit_offset, endpoints);
 
-   for(y = 0; y < src_height; y += 1) {
-      uint8_t *result = dst_row;
-      for(x = 0; x < src_width; x += 1) {
-         int texel;
-         texel = x + y * 4;
-
-         anchors_before_texel = count_anchors_before_texel(mode->n_subsets,
-                                                           partition_num,
-                                                           texel);
+   /* The indices are packed one after the other, with one bit less for the
+    * anchor texels, so unpack all of them in one pass instead of working
+    * out the offset of each texel separately.
+    */
+   secondary_bit_offset = (bit_offset +
+                           BLOCK_SIZE * BLOCK_SIZE * mode->n_index_bits -
+                           mode->n_subsets);
 
-         /* Calculate the offset to the secondary index */
-         secondary_bit_offset = (bit_offset +
-                                 BLOCK_SIZE * BLOCK_SIZE * mode->n_index_bits -
-                                 mode->n_subsets +
-                                 mode->n_secondary_index_bits * texel -
-                                 anchors_before_texel);
+   for (texel = 0; texel < BLOCK_SIZE * BLOCK_SIZE; texel++) {
+      bool anchor = is_anchor(mode->n_subsets, partition_num, texel);
 
-         /* Calculate the offset to the primary index for this texel */
-         bit_offset += mode->n_index_bits * texel - anchors_before_texel;
+      index_bits = mode->n_index_bits - anchor;
+      indices[0][texel] = extract_bits(block, bit_offset, index_bits);
+      bit_offset += index_bits;
 
-         subset_num = (subsets >> (texel * 2)) & 3;
+      if (mode->n_secondary_index_bits) {
+         index_bits = mode->n_secondary_index_bits - anchor;
+         indices[1][texel] = extract_bits(block, secondary_bit_offset,
+                                          index_bits);
+         secondary_bit_offset += index_bits;
+      }
+   }
 
-         anchor = is_anchor(mode->n_subsets, partition_num, texel);
+   /* Alpha uses the opposite index from the color components */
+   if (index_selection) {
+      color_indices = indices[1];
+      color_weights = weights[mode->n_secondary_index_bits];
+   } else {
+      color_indices = indices[0];
+      color_weights = weights[mode->n_index_bits];
+   }
 
-         index_bits = mode->n_index_bits;
-         if (anchor)
-            index_bits--;
-         indices[0] = extract_bits(block, bit_offset, index_bits);
+   if (mode->n_secondary_index_bits && !index_selection) {
+      alpha_indices = indices[1];
+      alpha_weights = weights[mode->n_secondary_index_bits];
+   } else {
+      alpha_indices = indices[0];
+      alpha_weights = weights[mode->n_index_bits];
+   }
 
-         if (mode->n_secondary_index_bits) {
-            index_bits = mode->n_secondary_index_bits;
-            if (anchor)
-               index_bits--;
-            indices[1] = extract_bits(block, secondary_bit_offset, index_bits);
-         }
+   for(y = 0; y < src_height; y += 1) {
+      uint8_t *result = dst_row;
+      for(x = 0; x < src_width; x += 1) {
+         const uint8_t *e0, *e1;
+         int subset_num, weight;
 
-         index = indices[index_selection];
-         index_bits = (index_selection ?
-                       mode->n_secondary_index_bits :
-                       mode->n_index_bits);
+         texel = x + y * 4;
+         subset_num = (subsets >> (texel * 2)) & 3;
+         e0 = endpoints[subset_num * 2];
+         e1 = endpoints[subset_num * 2 + 1];
 
+         weight = color_weights[color_indices[texel]];
          for (component = 0; component < 3; component++)
-            result[component] = interpolate(endpoints[subset_num * 2][component],
-                                            endpoints[subset_num * 2 + 1][component],
-                                            index,
-                                            index_bits);
-
-         /* Alpha uses the opposite index from the color components */
-         if (mode->n_secondary_index_bits && !index_selection) {
-            index = indices[1];
-            index_bits = mode->n_secondary_index_bits;
-         } else {
-            index = indices[0];
-            index_bits = mode->n_index_bits;
-         }
+            result[component] = ((64 - weight) * e0[component] +
+                                 weight * e1[component] + 32) >> 6;
 
-         result[3] = interpolate(endpoints[subset_num * 2][3],
-                                 endpoints[subset_num * 2 + 1][3],
-                                 index,
-                                 index_bits);
+         weight = alpha_weights[alpha_indices[texel]];
+         result[3] = ((64 - weight) * e0[3] + weight * e1[3] + 32) >> 6;
 
          apply_rotation(rotation, result);
          result += 4;
@@ -105,6 +105,22 @@ static const int etc2_modifier_tables_non_opaque[8][4] = {
 #undef TAG
 #undef UINT8_TYPE
 
+/** Arguments of an ETC1/ETC2 decode, split by _mesa_unpack_compressed_rows */
+struct etc_unpack_job
+{
+   uint8_t *dst_row;
+   unsigned dst_stride;
+   const uint8_t *src_row;
+   unsigned src_stride;
+   unsigned src_width;
+   unsigned src_height;
+   mesa_format format;
+   bool bgra;
+};
+
+static void
+etc_unpack_rows(void *data, unsigned start, unsigned end);
+
 GLboolean
 _mesa_texstore_etc1_rgb8(UNUSED_TEXSTORE_PARAMS)
 {
@@ -142,9 +158,19 @@ _mesa_etc1_unpack_rgba8888(uint8_t *dst_row,
                            unsigned src_width,
                            unsigned src_height)
 {
-   etc1_unpack_rgba8888(dst_row, dst_stride,
-                        src_row, src_stride,
-                        src_width, src_height);
+   struct etc_unpack_job job = {
+      .dst_row = dst_row,
+      .dst_stride = dst_stride,
+      .src_row = src_row,
+      .src_stride = src_stride,
+      .src_width = src_width,
+      .src_height = src_height,
+      .format = MESA_FORMAT_ETC1_RGB8,
+   };
+   unsigned y_blocks = (src_height + 3) / 4;
+
+   _mesa_unpack_compressed_rows(y_blocks * ((src_width + 3) / 4), y_blocks,
+                                etc_unpack_rows, &job);
 }
 
 static uint8_t
@@ -1192,37 +1218,26 @@ _mesa_texstore_etc2_srgb8_punchthrough_alpha1(UNUSED_TEXSTORE_PARAMS)
 
 
 /**
- * Decode texture data in any one of following formats:
- * `MESA_FORMAT_ETC2_RGB8`
- * `MESA_FORMAT_ETC2_SRGB8`
- * `MESA_FORMAT_ETC2_RGBA8_EAC`
- * `MESA_FORMAT_ETC2_SRGB8_ALPHA8_EAC`
- * `MESA_FORMAT_ETC2_R11_EAC`
- * `MESA_FORMAT_ETC2_RG11_EAC`
- * `MESA_FORMAT_ETC2_SIGNED_R11_EAC`
- * `MESA_FORMAT_ETC2_SIGNED_RG11_EAC`
- * `MESA_FORMAT_ETC2_RGB8_PUNCHTHROUGH_ALPHA1`
- * `MESA_FORMAT_ETC2_SRGB8_PUNCHTHROUGH_ALPHA1`
- *
- * The size of the source data must be a multiple of the ETC2 block size
- * even if the texture image's dimensions are not aligned to 4.
- *
- * \param src_width in pixels
- * \param src_height in pixels
- * \param dst_stride in bytes
+ * Decode the block rows [start, end) of an ETC1/ETC2 image.
  */
-
-void
-_mesa_unpack_etc2_format(uint8_t *dst_row,
-                         unsigned dst_stride,
-                         const uint8_t *src_row,
-                         unsigned src_stride,
-                         unsigned src_width,
-                         unsigned src_height,
-			 mesa_format format,
-			 bool bgra)
+static void
+etc_unpack_rows(void *data, unsigned start, unsigned end)
 {
-   if (format == MESA_FORMAT_ETC2_RGB8)
+   const struct etc_unpack_job *job = data;
+   uint8_t *dst_row = job->dst_row + start * 4 * job->dst_stride;
+   const uint8_t *src_row = job->src_row + start * job->src_stride;
+   unsigned src_width = job->src_width;
+   unsigned src_height = MIN2(end * 4, job->src_height) - start * 4;
+   unsigned dst_stride = job->dst_stride;
+   unsigned src_stride = job->src_stride;
+   mesa_format format = job->format;
+   bool bgra = job->bgra;
+
+   if (format == MESA_FORMAT_ETC1_RGB8)
+      etc1_unpack_rgba8888(dst_row, dst_stride,
+                           src_row, src_stride,
+                           src_width, src_height);
+   else if (format == MESA_FORMAT_ETC2_RGB8)
       etc2_unpack_rgb8(dst_row, dst_stride,
                        src_row, src_stride,
                        src_width, src_height);
@@ -1264,6 +1279,53 @@ _mesa_unpack_etc2_format(uint8_t *dst_row,
 					    src_width, src_height, bgra);
 }
 
+/**
+ * Decode texture data in any one of following formats:
+ * `MESA_FORMAT_ETC2_RGB8`
+ * `MESA_FORMAT_ETC2_SRGB8`
+ * `MESA_FORMAT_ETC2_RGBA8_EAC`
+ * `MESA_FORMAT_ETC2_SRGB8_ALPHA8_EAC`
+ * `MESA_FORMAT_ETC2_R11_EAC`
+ * `MESA_FORMAT_ETC2_RG11_EAC`
+ * `MESA_FORMAT_ETC2_SIGNED_R11_EAC`
+ * `MESA_FORMAT_ETC2_SIGNED_RG11_EAC`
+ * `MESA_FORMAT_ETC2_RGB8_PUNCHTHROUGH_ALPHA1`
+ * `MESA_FORMAT_ETC2_SRGB8_PUNCHTHROUGH_ALPHA1`
+ *
+ * The size of the source data must be a multiple of the ETC2 block size
+ * even if the texture image's dimensions are not aligned to 4.
+ *
+ * \param src_width in pixels
+ * \param src_height in pixels
+ * \param dst_stride in bytes
+ */
+
+void
+_mesa_unpack_etc2_format(uint8_t *dst_row,
+                         unsigned dst_stride,
+                         const uint8_t *src_row,
+                         unsigned src_stride,
+                         unsigned src_width,
+                         unsigned src_height,
+			 mesa_format format,
+			 bool bgra)
+{
+   struct etc_unpack_job job = {
+      .dst_row = dst_row,
+      .dst_stride = dst_stride,
+      .src_row = src_row,
+      .src_stride = src_stride,
+      .src_width = src_width,
+      .src_height = src_height,
+      .format = format,
+      .bgra = bgra,
+   };
+   unsigned y_blocks = (src_height + 3) / 4;
+
+   _mesa_unpack_compressed_rows(y_blocks * ((src_width + 3) / 4), y_blocks,
+                                etc_unpack_rows, &job);
+}
+
 
 
 static void
@@ -943,6 +943,21 @@ _mesa_dirty_texobj(struct gl_context *ctx, struct gl_texture_object *texObj)
 }
 
 
+/**
+ * Mark the texture or sampler binding of a single texture unit dirty.
+ * Unlike _NEW_TEXTURE_OBJECT, this lets the driver only update that unit.
+ *
+ * \param ctx GL context.
+ * \param unit texture unit.
+ */
+void
+_mesa_dirty_texture_unit(struct gl_context *ctx, GLuint unit)
+{
+   BITSET_SET(ctx->Texture._DirtyUnits, unit);
+   ctx->NewState |= _NEW_TEXTURE_UNIT;
+}
+
+
 /**
  * Return pointer to a default/fallback texture of the given type/target.
  * The texture is an RGBA texture with all texels = (0,0,0,1).
@@ -1448,7 +1463,7 @@ unbind_textures_from_unit(struct gl_context *ctx, GLuint unit)
          ctx->Driver.BindTexture(ctx, unit, 0, texObj);
 
       texUnit->_BoundTextures &= ~(1 << index);
-      ctx->NewState |= _NEW_TEXTURE_OBJECT;
+      _mesa_dirty_texture_unit(ctx, unit);
    }
 }
 
@@ -1687,7 +1702,8 @@ bind_texture_object(struct gl_context *ctx, unsigned unit,
    }
 
    /* flush before changing binding */
-   FLUSH_VERTICES(ctx, _NEW_TEXTURE_OBJECT);
+   FLUSH_VERTICES(ctx, 0);
+   _mesa_dirty_texture_unit(ctx, unit);
 
    /* If the refcount on the previously bound texture is decremented to
     * zero, it'll be deleted here.
@@ -188,6 +188,9 @@ _mesa_cube_complete(const struct gl_texture_object *texObj);
 extern void
 _mesa_dirty_texobj(struct gl_context *ctx, struct gl_texture_object *texObj);
 
+extern void
+_mesa_dirty_texture_unit(struct gl_context *ctx, GLuint unit);
+
 extern struct gl_texture_object *
 _mesa_get_fallback_texture(struct gl_context *ctx, gl_texture_index tex);
 
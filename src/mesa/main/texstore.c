@@ -76,6 +76,9 @@
 #include "pixeltransfer.h"
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
+#include "util/debug.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
 
 
 enum {
@@ -907,13 +910,8 @@ _mesa_texstore_memcpy(TEXSTORE_PARAMS)
 }
 
 
-/**
- * Store user data into texture memory.
- * Called via glTex[Sub]Image1/2/3D()
- * \return GL_TRUE for success, GL_FALSE for failure (out of memory).
- */
-GLboolean
-_mesa_texstore(TEXSTORE_PARAMS)
+static GLboolean
+texstore_serial(TEXSTORE_PARAMS)
 {
    if (_mesa_texstore_memcpy(ctx, dims, baseInternalFormat,
                              dstFormat,
@@ -942,6 +940,174 @@ _mesa_texstore(TEXSTORE_PARAMS)
 }
 
 
+/* Images with fewer texels than this are always stored on the calling
+ * thread, because handing them to the workers costs more than it saves.
+ */
+#define TEXSTORE_THREAD_MIN_TEXELS (256 * 256)
+#define TEXSTORE_THREAD_MIN_ROWS 16
+#define TEXSTORE_MAX_BANDS 16
+
+/**
+ * A horizontal band of rows of an image, stored by one thread.
+ */
+struct texstore_band
+{
+   struct util_queue_fence fence;
+   struct gl_context *ctx;
+   GLuint dims;
+   GLenum baseInternalFormat;
+   mesa_format dstFormat;
+   GLint dstRowStride;
+   GLubyte *dstSlice;
+   GLint srcWidth, srcHeight;
+   GLenum srcFormat, srcType;
+   const GLvoid *srcAddr;
+   struct gl_pixelstore_attrib packing; /**< SkipRows points at the band */
+   GLboolean success;
+};
+
+static struct util_queue texstore_queue;
+static unsigned texstore_num_bands;
+static once_flag texstore_queue_once = ONCE_FLAG_INIT;
+
+static void
+texstore_queue_init(void)
+{
+   util_cpu_detect();
+
+   /* The calling thread stores one band itself. */
+   unsigned num_bands =
+      env_var_as_unsigned("MESA_TEXSTORE_THREADS",
+                          MIN2(util_cpu_caps.nr_cpus, TEXSTORE_MAX_BANDS));
+   num_bands = MIN2(num_bands, TEXSTORE_MAX_BANDS);
+
+   if (num_bands > 1 &&
+       util_queue_init(&texstore_queue, "texstore", 32, num_bands - 1,
+                       UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                       UTIL_QUEUE_INIT_SHARED_EXECUTOR))
+      texstore_num_bands = num_bands;
+}
+
+static void
+texstore_band_execute(void *data, UNUSED int thread_index)
+{
+   struct texstore_band *band = (struct texstore_band *)data;
+
+   band->success = texstore_serial(band->ctx, band->dims,
+                                   band->baseInternalFormat,
+                                   band->dstFormat, band->dstRowStride,
+                                   &band->dstSlice,
+                                   band->srcWidth, band->srcHeight, 1,
+                                   band->srcFormat, band->srcType,
+                                   band->srcAddr, &band->packing);
+}
+
+/**
+ * Whether the rows of the image can be converted independently of each
+ * other and the image is large enough to be worth splitting.
+ */
+static bool
+texstore_can_split(TEXSTORE_PARAMS)
+{
+   return dims >= 2 &&
+          srcDepth == 1 &&
+          srcHeight >= 2 * TEXSTORE_THREAD_MIN_ROWS &&
+          srcWidth * srcHeight >= TEXSTORE_THREAD_MIN_TEXELS &&
+          srcType != GL_BITMAP &&
+          !srcPacking->Invert &&
+          !_mesa_is_format_compressed(dstFormat) &&
+          !_mesa_is_depth_or_stencil_format(baseInternalFormat);
+}
+
+
+/**
+ * Split the image into num_bands bands of rows, store all but the first
+ * one on the worker threads and the first one on the calling thread.
+ */
+static GLboolean
+texstore_split(TEXSTORE_PARAMS, unsigned num_bands)
+{
+   struct texstore_band bands[TEXSTORE_MAX_BANDS];
+   GLboolean success;
+
+   for (unsigned i = 0; i < num_bands; i++) {
+      struct texstore_band *band = &bands[i];
+      const GLint y0 = srcHeight * i / num_bands;
+      const GLint y1 = srcHeight * (i + 1) / num_bands;
+
+      band->ctx = ctx;
+      band->dims = dims;
+      band->baseInternalFormat = baseInternalFormat;
+      band->dstFormat = dstFormat;
+      band->dstRowStride = dstRowStride;
+      band->dstSlice = dstSlices[0] + y0 * dstRowStride;
+      band->srcWidth = srcWidth;
+      band->srcHeight = y1 - y0;
+      band->srcFormat = srcFormat;
+      band->srcType = srcType;
+      band->srcAddr = srcAddr;
+      band->packing = *srcPacking;
+      band->packing.SkipRows += y0;
+      /* Keep the image stride of the whole image for SkipImages. */
+      if (!band->packing.ImageHeight)
+         band->packing.ImageHeight = srcHeight;
+   }
+
+   for (unsigned i = 1; i < num_bands; i++) {
+      util_queue_fence_init(&bands[i].fence);
+      util_queue_add_job(&texstore_queue, &bands[i], &bands[i].fence,
+                         texstore_band_execute, NULL, 0);
+   }
+
+   texstore_band_execute(&bands[0], 0);
+   success = bands[0].success;
+
+   for (unsigned i = 1; i < num_bands; i++) {
+      util_queue_fence_wait_promote(&texstore_queue, &bands[i].fence);
+      util_queue_fence_destroy(&bands[i].fence);
+      success = success && bands[i].success;
+   }
+
+   return success;
+}
+
+
+/**
+ * Store user data into texture memory.
+ * Called via glTex[Sub]Image1/2/3D()
+ *
+ * Large images are split into bands of rows that are converted in parallel
+ * by the texstore worker threads and the calling thread.
+ *
+ * \return GL_TRUE for success, GL_FALSE for failure (out of memory).
+ */
+GLboolean
+_mesa_texstore(TEXSTORE_PARAMS)
+{
+   if (texstore_can_split(ctx, dims, baseInternalFormat, dstFormat,
+                          dstRowStride, dstSlices,
+                          srcWidth, srcHeight, srcDepth,
+                          srcFormat, srcType, srcAddr, srcPacking)) {
+      call_once(&texstore_queue_once, texstore_queue_init);
+
+      const unsigned num_bands = MIN2(texstore_num_bands,
+                                      srcHeight / TEXSTORE_THREAD_MIN_ROWS);
+      if (num_bands > 1) {
+         return texstore_split(ctx, dims, baseInternalFormat, dstFormat,
+                               dstRowStride, dstSlices,
+                               srcWidth, srcHeight, srcDepth,
+                               srcFormat, srcType, srcAddr, srcPacking,
+                               num_bands);
+      }
+   }
+
+   return texstore_serial(ctx, dims, baseInternalFormat, dstFormat,
+                          dstRowStride, dstSlices,
+                          srcWidth, srcHeight, srcDepth,
+                          srcFormat, srcType, srcAddr, srcPacking);
+}
+
+
 /**
  * Normally, we'll only _write_ texel data to a texture when we map it.
  * But if the user is providing depth or stencil values and the texture
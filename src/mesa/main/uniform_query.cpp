@@ -1074,6 +1074,42 @@ copy_uniforms_to_storage(gl_constant_value *storage,
 }
 
 
+/**
+ * Return true if storing \p values into the uniform would leave its current
+ * contents unchanged.
+ *
+ * Applications frequently re-send the same uniform values between draws.
+ * Skipping those updates avoids flushing the buffered immediate-mode
+ * vertices, so consecutive glBegin/glEnd pairs can still be batched into a
+ * single draw.  Only values that are stored verbatim are considered; opaque
+ * and boolean uniforms always go down the regular path.
+ */
+static bool
+uniform_values_unchanged(struct gl_context *ctx,
+                         const struct gl_uniform_storage *uni,
+                         GLsizei count, const void *values,
+                         const unsigned size_mul, const unsigned offset,
+                         const unsigned elements)
+{
+   if (uni->type->contains_opaque() || uni->type->is_boolean())
+      return false;
+
+   const size_t size = sizeof(uni->storage[0]) * elements * count * size_mul;
+   const gl_constant_value *storage;
+
+   if (ctx->Const.PackedDriverUniformStorage) {
+      if (uni->num_driver_storage == 0)
+         return false;
+
+      storage = (const gl_constant_value *)
+         uni->driver_storage[0].data + (size_mul * offset * elements);
+   } else {
+      storage = &uni->storage[size_mul * elements * offset];
+   }
+
+   return memcmp(storage, values, size) == 0;
+}
+
 /**
  * Called via glUniform*() functions.
  */
@@ -1127,6 +1163,10 @@ _mesa_uniform(GLint location, GLsizei count, const GLvoid *values,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
+   if (uniform_values_unchanged(ctx, uni, count, values, size_mul, offset,
+                                components))
+      return;
+
    /* We check samplers for changes and flush if needed in the sampler
     * handling code further down, so just skip them here.
     */
@@ -1387,12 +1427,18 @@ _mesa_uniform_matrix(GLint location, GLsizei count,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
+   const unsigned elements = components * vectors;
+
+   if (!transpose &&
+       uniform_values_unchanged(ctx, uni, count, values, size_mul, offset,
+                                elements))
+      return;
+
    _mesa_flush_vertices_for_uniforms(ctx, uni);
 
    /* Store the data in the "actual type" backing storage for the uniform.
     */
    gl_constant_value *storage;
-   const unsigned elements = components * vectors;
    if (ctx->Const.PackedDriverUniformStorage) {
       for (unsigned s = 0; s < uni->num_driver_storage; s++) {
          storage = (gl_constant_value *)
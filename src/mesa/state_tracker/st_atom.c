@@ -248,6 +248,8 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
    }
 
    dirty = st->dirty & pipeline_mask;
+   st->partial_states = st->partial_dirty & pipeline_mask & ~dirty;
+   dirty |= st->partial_states;
    if (!dirty)
       return;
 
@@ -265,4 +267,29 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
 
    /* Clear the render or compute state bits. */
    st->dirty &= ~pipeline_mask;
+   st->partial_dirty &= ~pipeline_mask;
+   st->partial_states = 0;
+   if (!st->partial_dirty)
+      BITSET_ZERO(st->dirty_texture_units);
+}
+
+
+/**
+ * Return the samplers of the program that read from texture units in
+ * st_context::dirty_texture_units.
+ */
+GLbitfield
+st_get_dirty_unit_samplers(const struct st_context *st,
+                           const struct gl_program *prog)
+{
+   GLbitfield samplers_used = prog->SamplersUsed;
+   GLbitfield dirty = 0;
+
+   while (samplers_used) {
+      unsigned i = u_bit_scan(&samplers_used);
+
+      if (BITSET_TEST(st->dirty_texture_units, prog->SamplerUnits[i]))
+         dirty |= 1u << i;
+   }
+   return dirty;
 }
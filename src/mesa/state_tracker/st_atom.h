@@ -58,6 +58,8 @@ void st_init_atoms( struct st_context *st );
 void st_destroy_atoms( struct st_context *st );
 void st_validate_state( struct st_context *st, enum st_pipeline pipeline );
 GLuint st_compare_func_to_pipe(GLenum func);
+GLbitfield st_get_dirty_unit_samplers(const struct st_context *st,
+                                      const struct gl_program *prog);
 
 void
 st_setup_arrays(struct st_context *st,
@@ -159,6 +161,12 @@ enum {
                                  ST_NEW_STORAGE_BUFFER | \
                                  ST_NEW_IMAGE_UNITS)
 
+/* States that can be updated for single texture units. */
+#define ST_NEW_TEXTURE_UNIT_STATES (ST_NEW_VS_SAMPLER_VIEWS | \
+                                    ST_NEW_VS_SAMPLERS | \
+                                    ST_NEW_FS_SAMPLER_VIEWS | \
+                                    ST_NEW_FS_SAMPLERS)
+
 /* All state flags within each group: */
 #define ST_PIPELINE_RENDER_STATE_MASK  (ST_NEW_CS_STATE - 1)
 #define ST_PIPELINE_COMPUTE_STATE_MASK (0xffull << ST_NEW_CS_STATE_INDEX)
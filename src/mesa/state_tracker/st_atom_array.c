@@ -43,6 +43,7 @@
 #include "st_program.h"
 
 #include "cso_cache/cso_context.h"
+#include "util/hash_table.h"
 #include "util/u_math.h"
 #include "util/u_upload_mgr.h"
 #include "main/bufferobj.h"
@@ -124,17 +125,17 @@ init_velement(const struct st_vertex_program *vp,
 
 /* ALWAYS_INLINE helps the compiler realize that most of the parameters are
  * on the stack.
+ *
+ * If setup_velems is false, only the vertex buffers are filled in and the
+ * vertex elements are expected to be known already.
  */
-void
-#ifndef _MSC_VER /* MSVC doesn't like inlining public functions */
-ALWAYS_INLINE
-#endif
-st_setup_arrays(struct st_context *st,
-                const struct st_vertex_program *vp,
-                const struct st_common_variant *vp_variant,
-                struct cso_velems_state *velements,
-                struct pipe_vertex_buffer *vbuffer, unsigned *num_vbuffers,
-                bool *has_user_vertex_buffers)
+static void ALWAYS_INLINE
+setup_arrays(struct st_context *st,
+             const struct st_vertex_program *vp,
+             const struct st_common_variant *vp_variant,
+             struct cso_velems_state *velements,
+             struct pipe_vertex_buffer *vbuffer, unsigned *num_vbuffers,
+             bool *has_user_vertex_buffers, bool setup_velems)
 {
    struct gl_context *ctx = st->ctx;
    const struct gl_vertex_array_object *vao = ctx->Array._DrawVAO;
@@ -174,9 +175,11 @@ st_setup_arrays(struct st_context *st,
          vbuffer[bufidx].stride = binding->Stride; /* in bytes */
 
          /* Set the vertex element. */
-         init_velement(vp, velements->velems, &attrib->Format, 0,
-                       binding->InstanceDivisor, bufidx,
-                       input_to_index[attr]);
+         if (setup_velems) {
+            init_velement(vp, velements->velems, &attrib->Format, 0,
+                          binding->InstanceDivisor, bufidx,
+                          input_to_index[attr]);
+         }
       }
       return;
    }
@@ -210,6 +213,8 @@ st_setup_arrays(struct st_context *st,
       mask &= ~boundmask;
       /* We can assume that we have array for the binding */
       assert(attrmask);
+      if (!setup_velems)
+         continue;
       /* Walk attributes belonging to the binding */
       do {
          const gl_vert_attrib attr = u_bit_scan(&attrmask);
@@ -223,6 +228,67 @@ st_setup_arrays(struct st_context *st,
    }
 }
 
+void
+#ifndef _MSC_VER /* MSVC doesn't like inlining public functions */
+ALWAYS_INLINE
+#endif
+st_setup_arrays(struct st_context *st,
+                const struct st_vertex_program *vp,
+                const struct st_common_variant *vp_variant,
+                struct cso_velems_state *velements,
+                struct pipe_vertex_buffer *vbuffer, unsigned *num_vbuffers,
+                bool *has_user_vertex_buffers)
+{
+   setup_arrays(st, vp, vp_variant, velements, vbuffer, num_vbuffers,
+                has_user_vertex_buffers, true);
+}
+
+/* Same as st_setup_arrays, but the vertex elements of the draw VAO's arrays
+ * are only translated when the VAO, its enabled arrays or the vertex program
+ * input layout changed. Switching between a few VAOs then just copies the
+ * cached vertex elements.
+ */
+static void ALWAYS_INLINE
+st_setup_arrays_cached(struct st_context *st,
+                       const struct st_vertex_program *vp,
+                       const struct st_common_variant *vp_variant,
+                       struct cso_velems_state *velements,
+                       struct pipe_vertex_buffer *vbuffer,
+                       unsigned *num_vbuffers,
+                       bool *has_user_vertex_buffers)
+{
+   struct gl_context *ctx = st->ctx;
+   const struct gl_vertex_array_object *vao = ctx->Array._DrawVAO;
+   const GLbitfield array_mask =
+      vp_variant->vert_attrib_mask & _mesa_draw_array_bits(ctx);
+   struct st_vao_velems_cache_entry *entry =
+      &st->vao_velems_cache[_mesa_hash_pointer(vao) %
+                            NUM_VAO_VELEMS_CACHE_ENTRIES];
+
+   if (entry->vao == vao &&
+       entry->vao_stamp == vao->Stamp &&
+       entry->array_mask == array_mask &&
+       entry->num_inputs == vp->num_inputs &&
+       !memcmp(entry->input_to_index, vp->input_to_index,
+               sizeof(entry->input_to_index))) {
+      memcpy(velements->velems, entry->velems, sizeof(entry->velems));
+      setup_arrays(st, vp, vp_variant, velements, vbuffer, num_vbuffers,
+                   has_user_vertex_buffers, false);
+      return;
+   }
+
+   setup_arrays(st, vp, vp_variant, velements, vbuffer, num_vbuffers,
+                has_user_vertex_buffers, true);
+
+   entry->vao = vao;
+   entry->vao_stamp = vao->Stamp;
+   entry->array_mask = array_mask;
+   entry->num_inputs = vp->num_inputs;
+   memcpy(entry->input_to_index, vp->input_to_index,
+          sizeof(entry->input_to_index));
+   memcpy(entry->velems, velements->velems, sizeof(entry->velems));
+}
+
 /* ALWAYS_INLINE helps the compiler realize that most of the parameters are
  * on the stack.
  *
@@ -336,8 +402,8 @@ st_update_array(struct st_context *st)
 
    /* ST_NEW_VERTEX_ARRAYS alias ctx->DriverFlags.NewArray */
    /* Setup arrays */
-   st_setup_arrays(st, vp, vp_variant, &velements, vbuffer, &num_vbuffers,
-                   &uses_user_vertex_buffers);
+   st_setup_arrays_cached(st, vp, vp_variant, &velements, vbuffer,
+                          &num_vbuffers, &uses_user_vertex_buffers);
 
    /* _NEW_CURRENT_ATTRIB */
    /* Setup zero-stride attribs. */
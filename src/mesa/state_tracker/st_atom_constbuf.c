@@ -48,6 +48,82 @@
 #include "st_program.h"
 #include "st_cb_bufferobjects.h"
 
+/* Parameter lists smaller than this are always passed as user buffers. */
+#define ST_MIN_RESIDENT_CONSTBUF_SIZE 1024
+
+/**
+ * Write the parameter values to a constant buffer that stays resident, but
+ * only the range that changed since the last upload.  Programs with large
+ * uniform arrays that change one element per draw then upload a few bytes
+ * instead of the whole array.
+ *
+ * The changed range is found by comparing against a shadow copy of the
+ * buffer, because parameter values are written from many places (uniform
+ * updates, state parameters, subroutine indices, ...).
+ *
+ * Return false if no resident buffer could be used.
+ */
+static bool
+st_update_resident_constants(struct st_context *st, struct st_program *p,
+                             const struct gl_program_parameter_list *params,
+                             unsigned size, struct pipe_constant_buffer *cb)
+{
+   struct pipe_context *pipe = st->pipe;
+   const gl_constant_value *values = params->ParameterValues;
+
+   if (!p->constbuf || p->constbuf_st != st ||
+       p->constbuf->screen != pipe->screen ||
+       p->constbuf->width0 != size) {
+      pipe_resource_reference(&p->constbuf, NULL);
+      free(p->constbuf_shadow);
+
+      p->constbuf_shadow = malloc(size);
+      if (!p->constbuf_shadow)
+         return false;
+
+      p->constbuf = pipe_buffer_create_const0(pipe->screen,
+                                              PIPE_BIND_CONSTANT_BUFFER,
+                                              PIPE_USAGE_DEFAULT, size);
+      if (!p->constbuf) {
+         free(p->constbuf_shadow);
+         p->constbuf_shadow = NULL;
+         return false;
+      }
+
+      p->constbuf_st = st;
+      memcpy(p->constbuf_shadow, values, size);
+      pipe_buffer_write(pipe, p->constbuf, 0, size, values);
+   } else {
+      gl_constant_value *shadow = p->constbuf_shadow;
+      const unsigned num_values = size / sizeof(gl_constant_value);
+      unsigned first = 0, last = num_values;
+
+      while (first < num_values && values[first].u == shadow[first].u)
+         first++;
+
+      if (first < num_values) {
+         while (values[last - 1].u == shadow[last - 1].u)
+            last--;
+
+         /* Write whole vec4s. */
+         first = ROUND_DOWN_TO(first, 4);
+         last = MIN2(align(last, 4), num_values);
+
+         memcpy(shadow + first, values + first,
+                (last - first) * sizeof(gl_constant_value));
+         pipe_buffer_write(pipe, p->constbuf,
+                           first * sizeof(gl_constant_value),
+                           (last - first) * sizeof(gl_constant_value),
+                           values + first);
+      }
+   }
+
+   cb->buffer = p->constbuf;
+   cb->user_buffer = NULL;
+   return true;
+}
+
+
 /**
  * Pass the given program parameters to the graphics pipe as a
  * constant buffer.
@@ -104,11 +180,17 @@ st_upload_constants(struct st_context *st, struct gl_program *prog)
 
       _mesa_shader_write_subroutine_indices(st->ctx, stage);
 
-      cb.buffer = NULL;
-      cb.user_buffer = params->ParameterValues;
       cb.buffer_offset = 0;
       cb.buffer_size = paramBytes;
 
+      if (!st->has_constbuf_partial_updates ||
+          paramBytes < ST_MIN_RESIDENT_CONSTBUF_SIZE ||
+          !st_update_resident_constants(st, st_program(prog), params,
+                                        paramBytes, &cb)) {
+         cb.buffer = NULL;
+         cb.user_buffer = params->ParameterValues;
+      }
+
       if (ST_DEBUG & DEBUG_CONSTANTS) {
          debug_printf("%s(shader=%d, numParams=%d, stateFlags=0x%x)\n",
                       __func__, shader_type, params->NumParameters,
@@ -117,7 +199,6 @@ st_upload_constants(struct st_context *st, struct gl_program *prog)
       }
 
       cso_set_constant_buffer(st->cso_context, shader_type, 0, &cb);
-      pipe_resource_reference(&cb.buffer, NULL);
 
       st->state.constants[shader_type].ptr = params->ParameterValues;
       st->state.constants[shader_type].size = paramBytes;
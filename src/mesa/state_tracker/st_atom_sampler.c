@@ -344,11 +344,49 @@ update_shader_samplers(struct st_context *st,
 }
 
 
+/* Same as update_shader_samplers, but only for the samplers of texture units
+ * whose binding changed. The other sampler states are still bound.
+ */
+static void
+update_dirty_unit_samplers(struct st_context *st,
+                           enum pipe_shader_type shader_stage,
+                           const struct gl_program *prog,
+                           struct pipe_sampler_state *samplers)
+{
+   struct gl_context *ctx = st->ctx;
+   GLbitfield dirty = st_get_dirty_unit_samplers(st, prog);
+
+   if (!dirty)
+      return;
+
+   while (dirty) {
+      unsigned unit = u_bit_scan(&dirty);
+      unsigned tex_unit = prog->SamplerUnits[unit];
+
+      /* Don't update the sampler for TBOs, like update_shader_samplers. */
+      if (ctx->Texture.Unit[tex_unit]._Current->Target != GL_TEXTURE_BUFFER) {
+         st_convert_sampler_from_unit(st, &samplers[unit], tex_unit);
+         cso_single_sampler(st->cso_context, shader_stage, unit,
+                            &samplers[unit]);
+      }
+   }
+
+   cso_single_sampler_done(st->cso_context, shader_stage);
+}
+
+
 void
 st_update_vertex_samplers(struct st_context *st)
 {
    const struct gl_context *ctx = st->ctx;
 
+   if (st->partial_states & ST_NEW_VS_SAMPLERS) {
+      update_dirty_unit_samplers(st, PIPE_SHADER_VERTEX,
+                                 ctx->VertexProgram._Current,
+                                 st->state.vert_samplers);
+      return;
+   }
+
    update_shader_samplers(st,
                           PIPE_SHADER_VERTEX,
                           ctx->VertexProgram._Current,
@@ -401,6 +439,13 @@ st_update_fragment_samplers(struct st_context *st)
 {
    const struct gl_context *ctx = st->ctx;
 
+   if (st->partial_states & ST_NEW_FS_SAMPLERS) {
+      update_dirty_unit_samplers(st, PIPE_SHADER_FRAGMENT,
+                                 ctx->FragmentProgram._Current,
+                                 st->state.frag_samplers);
+      return;
+   }
+
    update_shader_samplers(st,
                           PIPE_SHADER_FRAGMENT,
                           ctx->FragmentProgram._Current,
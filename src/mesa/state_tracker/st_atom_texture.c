@@ -246,6 +246,39 @@ update_textures(struct st_context *st,
    st->state.num_sampler_views[shader_stage] = num_textures;
 }
 
+/* Same as update_textures, but only for the samplers of texture units whose
+ * binding changed. The stored views of the other samplers are still valid.
+ */
+static void
+update_dirty_unit_textures(struct st_context *st,
+                           enum pipe_shader_type shader_stage,
+                           const struct gl_program *prog,
+                           struct pipe_sampler_view **sampler_views)
+{
+   GLbitfield dirty = st_get_dirty_unit_samplers(st, prog);
+   GLbitfield texel_fetch_samplers = prog->info.textures_used_by_txf;
+
+   if (!dirty)
+      return;
+
+   /* prog->sh.data is NULL if it's ARB_fragment_program */
+   bool glsl130 = (prog->sh.data ? prog->sh.data->Version : 0) >= 130;
+
+   while (dirty) {
+      unsigned unit = u_bit_scan(&dirty);
+      struct pipe_sampler_view *sampler_view = NULL;
+
+      st_update_single_texture(st, &sampler_view, prog->SamplerUnits[unit],
+                               glsl130, texel_fetch_samplers & (1u << unit));
+      pipe_sampler_view_reference(&(sampler_views[unit]), sampler_view);
+   }
+
+   cso_set_sampler_views(st->cso_context,
+                         shader_stage,
+                         st->state.num_sampler_views[shader_stage],
+                         sampler_views);
+}
+
 /* Same as update_textures, but don't store the views in st_context. */
 static void
 update_textures_local(struct st_context *st,
@@ -267,6 +300,14 @@ st_update_vertex_textures(struct st_context *st)
    const struct gl_context *ctx = st->ctx;
 
    if (ctx->Const.Program[MESA_SHADER_VERTEX].MaxTextureImageUnits > 0) {
+      if (st->partial_states & ST_NEW_VS_SAMPLER_VIEWS) {
+         update_dirty_unit_textures(st,
+                                    PIPE_SHADER_VERTEX,
+                                    ctx->VertexProgram._Current,
+                                    st->state.vert_sampler_views);
+         return;
+      }
+
       update_textures(st,
                       PIPE_SHADER_VERTEX,
                       ctx->VertexProgram._Current,
@@ -280,6 +321,14 @@ st_update_fragment_textures(struct st_context *st)
 {
    const struct gl_context *ctx = st->ctx;
 
+   if (st->partial_states & ST_NEW_FS_SAMPLER_VIEWS) {
+      update_dirty_unit_textures(st,
+                                 PIPE_SHADER_FRAGMENT,
+                                 ctx->FragmentProgram._Current,
+                                 st->state.frag_sampler_views);
+      return;
+   }
+
    update_textures(st,
                    PIPE_SHADER_FRAGMENT,
                    ctx->FragmentProgram._Current,
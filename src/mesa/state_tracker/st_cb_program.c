@@ -84,6 +84,9 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
 
    st_release_variants(st, stp);
 
+   pipe_resource_reference(&stp->constbuf, NULL);
+   free(stp->constbuf_shadow);
+
    if (stp->glsl_to_tgsi)
       free_glsl_to_tgsi_visitor(stp->glsl_to_tgsi);
 
@@ -93,9 +93,43 @@ needs_integer_signed_unsigned_conversion(const struct gl_context *ctx,
    return FALSE;
 }
 
+/**
+ * Fill in the sampler view template for reading from the surface, and set
+ * up addr for the selected layer.
+ */
+static void
+init_pbo_sampler_view(struct pipe_sampler_view *templ,
+                      struct pipe_resource *texture,
+                      struct pipe_surface *surface,
+                      enum pipe_format src_format,
+                      struct st_pbo_addresses *addr)
+{
+   u_sampler_view_default_template(templ, texture, src_format);
+
+   switch (texture->target) {
+   case PIPE_TEXTURE_CUBE:
+   case PIPE_TEXTURE_CUBE_ARRAY:
+      templ->target = PIPE_TEXTURE_2D_ARRAY;
+      break;
+   default:
+      templ->target = texture->target;
+      break;
+   }
+
+   templ->u.tex.first_level = surface->u.tex.level;
+   templ->u.tex.last_level = templ->u.tex.first_level;
+
+   if (templ->target != PIPE_TEXTURE_3D) {
+      templ->u.tex.first_layer = surface->u.tex.first_layer;
+      templ->u.tex.last_layer = templ->u.tex.first_layer;
+   } else {
+      addr->constants.layer_offset = surface->u.tex.first_layer;
+   }
+}
+
 static bool
-try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
-                   bool invert_y,
+try_pbo_readpixels(struct st_context *st, struct pipe_resource *texture,
+                   struct pipe_surface *surface, bool invert_y,
                    GLint x, GLint y, GLsizei width, GLsizei height,
                    enum pipe_format src_format, enum pipe_format dst_format,
                    const struct gl_pixelstore_attrib *pack, void *pixels)
@@ -103,11 +137,10 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
    struct pipe_context *pipe = st->pipe;
    struct pipe_screen *screen = pipe->screen;
    struct cso_context *cso = st->cso_context;
-   struct pipe_surface *surface = strb->surface;
-   struct pipe_resource *texture = strb->texture;
    const struct util_format_description *desc;
    struct st_pbo_addresses addr;
    struct pipe_framebuffer_state fb;
+   struct pipe_sampler_view templ;
    enum pipe_texture_target view_target;
    bool success = false;
 
@@ -130,6 +163,36 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
    if (!st_pbo_addresses_pixelstore(st, GL_TEXTURE_2D, false, pack, pixels, &addr))
       return false;
 
+   init_pbo_sampler_view(&templ, texture, surface, src_format, &addr);
+   view_target = templ.target;
+
+   /* The compute path needs neither a framebuffer nor any of the state
+    * saved below.  It doesn't handle 1D textures, where the second
+    * coordinate is the layer.
+    */
+   if (st->pbo.download_cs_enabled &&
+       view_target != PIPE_TEXTURE_1D &&
+       view_target != PIPE_TEXTURE_1D_ARRAY) {
+      int surface_y = y;
+
+      if (invert_y) {
+         st_pbo_addresses_invert_y(&addr, surface->height);
+         surface_y = surface->height - y - height;
+      }
+
+      success = st_pbo_download_compute(st, &addr, texture, &templ,
+                                        dst_format, x, surface_y);
+
+      /* Buffer written via shader images needs explicit synchronization. */
+      if (success)
+         pipe->memory_barrier(pipe, PIPE_BARRIER_ALL);
+
+      return success;
+   }
+
+   if (!st->pbo.download_enabled)
+      return false;
+
    cso_save_state(cso, (CSO_BIT_FRAGMENT_SAMPLER_VIEWS |
                         CSO_BIT_FRAGMENT_SAMPLERS |
                         CSO_BIT_FRAGMENT_IMAGE0 |
@@ -154,34 +217,10 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
 
    /* Set up the sampler_view */
    {
-      struct pipe_sampler_view templ;
       struct pipe_sampler_view *sampler_view;
       struct pipe_sampler_state sampler = {0};
       const struct pipe_sampler_state *samplers[1] = {&sampler};
 
-      u_sampler_view_default_template(&templ, texture, src_format);
-
-      switch (texture->target) {
-      case PIPE_TEXTURE_CUBE:
-      case PIPE_TEXTURE_CUBE_ARRAY:
-         view_target = PIPE_TEXTURE_2D_ARRAY;
-         break;
-      default:
-         view_target = texture->target;
-         break;
-      }
-
-      templ.target = view_target;
-      templ.u.tex.first_level = surface->u.tex.level;
-      templ.u.tex.last_level = templ.u.tex.first_level;
-
-      if (view_target != PIPE_TEXTURE_3D) {
-         templ.u.tex.first_layer = surface->u.tex.first_layer;
-         templ.u.tex.last_layer = templ.u.tex.first_layer;
-      } else {
-         addr.constants.layer_offset = surface->u.tex.first_layer;
-      }
-
       sampler_view = pipe->create_sampler_view(pipe, texture, &templ);
       if (sampler_view == NULL)
          goto fail;
@@ -254,6 +293,47 @@ fail:
    return success;
 }
 
+/**
+ * Blit the requested region to the top-left corner of dst.
+ */
+static void
+blit_to_texture(struct st_context *st, struct st_renderbuffer *strb,
+                bool invert_y,
+                GLint x, GLint y, GLsizei width, GLsizei height,
+                GLenum format, enum pipe_format src_format,
+                struct pipe_resource *dst)
+{
+   struct pipe_blit_info blit;
+
+   memset(&blit, 0, sizeof(blit));
+   blit.src.resource = strb->texture;
+   blit.src.level = strb->surface->u.tex.level;
+   blit.src.format = src_format;
+   blit.dst.resource = dst;
+   blit.dst.level = 0;
+   blit.dst.format = dst->format;
+   blit.src.box.x = x;
+   blit.dst.box.x = 0;
+   blit.src.box.y = y;
+   blit.dst.box.y = 0;
+   blit.src.box.z = strb->surface->u.tex.first_layer;
+   blit.dst.box.z = 0;
+   blit.src.box.width = blit.dst.box.width = width;
+   blit.src.box.height = blit.dst.box.height = height;
+   blit.src.box.depth = blit.dst.box.depth = 1;
+   blit.mask = st_get_blit_mask(strb->Base._BaseFormat, format);
+   blit.filter = PIPE_TEX_FILTER_NEAREST;
+   blit.scissor_enable = FALSE;
+
+   if (invert_y) {
+      blit.src.box.y = strb->Base.Height - blit.src.box.y;
+      blit.src.box.height = -blit.src.box.height;
+   }
+
+   /* blit */
+   st->pipe->blit(st->pipe, &blit);
+}
+
 /**
  * Create a staging texture and blit the requested region to it.
  */
@@ -264,11 +344,9 @@ blit_to_staging(struct st_context *st, struct st_renderbuffer *strb,
                    GLenum format,
                    enum pipe_format src_format, enum pipe_format dst_format)
 {
-   struct pipe_context *pipe = st->pipe;
-   struct pipe_screen *screen = pipe->screen;
+   struct pipe_screen *screen = st->pipe->screen;
    struct pipe_resource dst_templ;
    struct pipe_resource *dst;
-   struct pipe_blit_info blit;
 
    /* We are creating a texture of the size of the region being read back.
     * Need to check for NPOT texture support. */
@@ -295,35 +373,122 @@ blit_to_staging(struct st_context *st, struct st_renderbuffer *strb,
    if (!dst)
       return NULL;
 
-   memset(&blit, 0, sizeof(blit));
-   blit.src.resource = strb->texture;
-   blit.src.level = strb->surface->u.tex.level;
-   blit.src.format = src_format;
-   blit.dst.resource = dst;
-   blit.dst.level = 0;
-   blit.dst.format = dst->format;
-   blit.src.box.x = x;
-   blit.dst.box.x = 0;
-   blit.src.box.y = y;
-   blit.dst.box.y = 0;
-   blit.src.box.z = strb->surface->u.tex.first_layer;
-   blit.dst.box.z = 0;
-   blit.src.box.width = blit.dst.box.width = width;
-   blit.src.box.height = blit.dst.box.height = height;
-   blit.src.box.depth = blit.dst.box.depth = 1;
-   blit.mask = st_get_blit_mask(strb->Base._BaseFormat, format);
-   blit.filter = PIPE_TEX_FILTER_NEAREST;
-   blit.scissor_enable = FALSE;
+   blit_to_texture(st, strb, invert_y, x, y, width, height, format,
+                   src_format, dst);
+   return dst;
+}
 
-   if (invert_y) {
-      blit.src.box.y = strb->Base.Height - blit.src.box.y;
-      blit.src.box.height = -blit.src.box.height;
+/**
+ * Return a texture from the small ring used by try_pbo_readpixels_staged,
+ * reallocating it if the format or size doesn't match.  Cycling through
+ * more than one lets a readback start before the previous one has finished
+ * reading its texture.
+ */
+static struct pipe_resource *
+get_pbo_staging_texture(struct st_context *st, enum pipe_format format,
+                        unsigned width, unsigned height)
+{
+   struct pipe_screen *screen = st->pipe->screen;
+   unsigned slot = st->readpix_cache.pbo_staging_next;
+   struct pipe_resource **res = &st->readpix_cache.pbo_staging[slot];
+
+   st->readpix_cache.pbo_staging_next =
+      (slot + 1) % ARRAY_SIZE(st->readpix_cache.pbo_staging);
+
+   if (*res && (*res)->format == format &&
+       (*res)->width0 == width && (*res)->height0 == height)
+      return *res;
+
+   struct pipe_resource templ;
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = format;
+   templ.bind = PIPE_BIND_RENDER_TARGET | PIPE_BIND_SAMPLER_VIEW;
+   templ.usage = PIPE_USAGE_DEFAULT;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+
+   pipe_resource_reference(res, NULL);
+   *res = screen->resource_create(screen, &templ);
+   return *res;
+}
+
+/**
+ * PBO readback for destination formats that can't be stored through a
+ * shader image: blit the region to a texture in the destination format,
+ * then copy its bits into the PBO as unsigned integers of the same size.
+ * Everything stays on the GPU, so only mapping the PBO waits for it.
+ */
+static bool
+try_pbo_readpixels_staged(struct st_context *st, struct st_renderbuffer *strb,
+                          bool invert_y,
+                          GLint x, GLint y, GLsizei width, GLsizei height,
+                          GLenum format,
+                          enum pipe_format src_format,
+                          enum pipe_format dst_format,
+                          const struct gl_pixelstore_attrib *pack,
+                          void *pixels)
+{
+   struct pipe_screen *screen = st->pipe->screen;
+   enum pipe_format raw_format;
+
+   if (strb->texture->nr_samples > 1 ||
+       util_format_is_depth_or_stencil(dst_format))
+      return false;
+
+   switch (util_format_get_blocksize(dst_format)) {
+   case 1:
+      raw_format = PIPE_FORMAT_R8_UINT;
+      break;
+   case 2:
+      raw_format = PIPE_FORMAT_R16_UINT;
+      break;
+   case 4:
+      raw_format = PIPE_FORMAT_R32_UINT;
+      break;
+   case 8:
+      raw_format = PIPE_FORMAT_R32G32_UINT;
+      break;
+   case 16:
+      raw_format = PIPE_FORMAT_R32G32B32A32_UINT;
+      break;
+   default:
+      return false;
    }
 
-   /* blit */
-   st->pipe->blit(st->pipe, &blit);
+   if (!screen->get_param(screen, PIPE_CAP_NPOT_TEXTURES) &&
+       (!util_is_power_of_two_or_zero(width) ||
+        !util_is_power_of_two_or_zero(height)))
+      return false;
 
-   return dst;
+   if (!screen->is_format_supported(screen, dst_format, PIPE_TEXTURE_2D,
+                                    0, 0, PIPE_BIND_RENDER_TARGET) ||
+       !screen->is_format_supported(screen, raw_format, PIPE_TEXTURE_2D,
+                                    0, 0, PIPE_BIND_SAMPLER_VIEW) ||
+       !screen->is_format_supported(screen, raw_format, PIPE_BUFFER,
+                                    0, 0, PIPE_BIND_SHADER_IMAGE))
+      return false;
+
+   struct pipe_resource *staging =
+      get_pbo_staging_texture(st, dst_format, width, height);
+   if (!staging)
+      return false;
+
+   blit_to_texture(st, strb, invert_y, x, y, width, height, format,
+                   src_format, staging);
+
+   /* Only the size and the level/layer are looked at. */
+   struct pipe_surface surface;
+   memset(&surface, 0, sizeof(surface));
+   surface.format = dst_format;
+   surface.width = width;
+   surface.height = height;
+
+   return try_pbo_readpixels(st, staging, &surface, false,
+                             0, 0, width, height, raw_format, raw_format,
+                             pack, pixels);
 }
 
 static struct pipe_resource *
@@ -470,13 +635,22 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
       goto fallback;
    }
 
-   if (st->pbo.download_enabled && pack->BufferObj) {
-      if (try_pbo_readpixels(st, strb,
-                             st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP,
+   if ((st->pbo.download_enabled || st->pbo.download_cs_enabled) &&
+       pack->BufferObj) {
+      bool invert_y = st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP;
+
+      if (try_pbo_readpixels(st, strb->texture, strb->surface, invert_y,
                              x, y, width, height,
                              src_format, dst_format,
                              pack, pixels))
          return;
+
+      if (!needs_integer_signed_unsigned_conversion(ctx, format, type) &&
+          try_pbo_readpixels_staged(st, strb, invert_y,
+                                    x, y, width, height, format,
+                                    src_format, dst_format,
+                                    pack, pixels))
+         return;
    }
 
    if (needs_integer_signed_unsigned_conversion(ctx, format, type)) {
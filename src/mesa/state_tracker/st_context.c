@@ -276,6 +276,25 @@ st_invalidate_state(struct gl_context *ctx)
          st->dirty |= ST_NEW_FS_STATE;
       }
    }
+
+   /* Only the bindings of some texture units changed. The vertex and
+    * fragment samplers of those units are updated individually, the other
+    * stages don't keep their sampler views around and update all of them.
+    */
+   if (new_state & _NEW_TEXTURE_UNIT) {
+      for (unsigned i = 0; i < ARRAY_SIZE(st->dirty_texture_units); i++)
+         st->dirty_texture_units[i] |= ctx->Texture._DirtyUnits[i];
+
+      st->partial_dirty |= st->active_states & ST_NEW_TEXTURE_UNIT_STATES;
+      st->dirty |= st->active_states &
+                   (ST_NEW_SAMPLER_VIEWS | ST_NEW_SAMPLERS) &
+                   ~ST_NEW_TEXTURE_UNIT_STATES;
+      if (ctx->FragmentProgram._Current &&
+          ctx->FragmentProgram._Current->ExternalSamplersUsed) {
+         st->dirty |= ST_NEW_FS_STATE | ST_NEW_FS_SAMPLER_VIEWS |
+                      ST_NEW_FS_SAMPLERS;
+      }
+   }
 }
 
 
@@ -454,6 +473,7 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
    st_destroy_drawtex(st);
    st_destroy_perfmon(st);
    st_destroy_pbo_helpers(st);
+   st_destroy_gen_mipmap(st);
    st_destroy_bound_texture_handles(st);
    st_destroy_bound_image_handles(st);
 
@@ -464,6 +484,8 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
 
    /* free glReadPixels cache data */
    st_invalidate_readpix_cache(st);
+   for (i = 0; i < ARRAY_SIZE(st->readpix_cache.pbo_staging); i++)
+      pipe_resource_reference(&st->readpix_cache.pbo_staging[i], NULL);
    util_throttle_deinit(st->pipe->screen, &st->throttle);
 
    cso_destroy_context(st->cso_context);
@@ -688,6 +710,8 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
       screen->get_param(screen, PIPE_CAP_QUERY_PIPELINE_STATISTICS_SINGLE);
    st->has_indep_blend_func =
       screen->get_param(screen, PIPE_CAP_INDEP_BLEND_FUNC);
+   st->has_constbuf_partial_updates =
+      screen->get_param(screen, PIPE_CAP_CONSTBUF_PARTIAL_UPDATES);
    st->needs_rgb_dst_alpha_override =
       screen->get_param(screen, PIPE_CAP_RGB_OVERRIDE_DST_ALPHA_BLEND);
    st->lower_flatshade =
@@ -707,6 +731,15 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
                                PIPE_SHADER_CAP_MAX_HW_ATOMIC_COUNTERS)
       ? true : false;
 
+   /* util_compute_gen_mipmap needs TGSI compute shaders and two images. */
+   st->has_compute_gen_mipmap =
+      screen->get_param(screen, PIPE_CAP_COMPUTE) &&
+      (screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                                PIPE_SHADER_CAP_SUPPORTED_IRS) &
+       (1 << PIPE_SHADER_IR_TGSI)) &&
+      screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                               PIPE_SHADER_CAP_MAX_SHADER_IMAGES) >= 2;
+
    util_throttle_init(&st->throttle,
                       screen->get_param(screen,
                                         PIPE_CAP_MAX_TEXTURE_UPLOAD_MEMORY_BUDGET));
@@ -768,6 +801,7 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
 
    ctx->Const.NoClippingOnCopyTex = screen->get_param(screen,
                                                       PIPE_CAP_NO_CLIP_ON_COPY_TEX);
+   ctx->Const.HasTextureUnitDirtyTracking = true;
 
    /* For vertex shaders, make sure not to emit saturate when SM 3.0
     * is not supported
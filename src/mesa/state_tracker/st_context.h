@@ -97,6 +97,26 @@ struct drawpix_cache_entry
 };
 
 
+#define NUM_VAO_VELEMS_CACHE_ENTRIES 8
+
+/**
+ * Vertex elements translated from the arrays of a VAO.
+ *
+ * Only depends on the VAO's derived array state, the enabled draw arrays
+ * and the vertex program input layout, so a VAO that is bound again with
+ * the same program skips the translation.
+ */
+struct st_vao_velems_cache_entry
+{
+   const struct gl_vertex_array_object *vao;  /**< not referenced */
+   unsigned vao_stamp;
+   GLbitfield array_mask;
+   ubyte num_inputs;
+   ubyte input_to_index[VERT_ATTRIB_MAX];
+   struct pipe_vertex_element velems[PIPE_MAX_ATTRIBS];
+};
+
+
 /*
  * Node for a linked list of dead sampler views.
  */
@@ -146,6 +166,7 @@ struct st_context
    boolean has_multi_draw_indirect;
    boolean has_single_pipe_stat;
    boolean has_indep_blend_func;
+   boolean has_constbuf_partial_updates;
    boolean needs_rgb_dst_alpha_override;
    boolean can_bind_const_buffer_as_vertex;
    boolean lower_flatshade;
@@ -181,6 +202,7 @@ struct st_context
    boolean invalidate_on_gl_viewport;
    boolean draw_needs_minmax_index;
    boolean has_hw_atomics;
+   boolean has_compute_gen_mipmap;
 
 
    /* driver supports scissored clears */
@@ -232,6 +254,16 @@ struct st_context
 
    uint64_t dirty; /**< dirty states */
 
+   /**
+    * States that are only dirty because the bindings of the texture units
+    * in dirty_texture_units changed. st_validate_state moves them to
+    * partial_states if they aren't fully dirty, and the atoms then only
+    * update the samplers of those units.
+    */
+   uint64_t partial_dirty;
+   uint64_t partial_states;
+   BITSET_DECLARE(dirty_texture_units, MAX_COMBINED_TEXTURE_IMAGE_UNITS);
+
    /** This masks out unused shader resources. Only valid in draw calls. */
    uint64_t active_states;
 
@@ -299,6 +331,10 @@ struct st_context
       unsigned level;
       unsigned layer;
       unsigned hits;
+
+      /* Ring of textures for PBO readbacks that need a blit first. */
+      struct pipe_resource *pbo_staging[2];
+      unsigned pbo_staging_next;
    } readpix_cache;
 
    /** for glClear */
@@ -319,13 +355,18 @@ struct st_context
       void *gs;
       void *upload_fs[3];
       void *download_fs[3][PIPE_MAX_TEXTURE_TYPES];
+      void *download_cs[3][PIPE_MAX_TEXTURE_TYPES];
       bool upload_enabled;
       bool download_enabled;
+      bool download_cs_enabled;
       bool rgba_only;
       bool layers;
       bool use_gs;
    } pbo;
 
+   /** compute shader for util_compute_gen_mipmap */
+   void *gen_mipmap_cs;
+
    /** for drawing with st_util_vertex */
    struct cso_velems_state util_velems;
 
@@ -341,6 +382,8 @@ struct st_context
    /* The number of vertex buffers from the last call of validate_arrays. */
    unsigned last_num_vbuffers;
 
+   struct st_vao_velems_cache_entry vao_velems_cache[NUM_VAO_VELEMS_CACHE_ENTRIES];
+
    unsigned last_used_atomic_bindings[PIPE_SHADER_TYPES];
    unsigned last_num_ssbos[PIPE_SHADER_TYPES];
 
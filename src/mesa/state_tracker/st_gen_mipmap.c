@@ -35,8 +35,12 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "util/format/u_format.h"
+#include "util/u_compute.h"
 #include "util/u_gen_mipmap.h"
 
+#include "cso_cache/cso_context.h"
+
+#include "st_atom.h"
 #include "st_debug.h"
 #include "st_context.h"
 #include "st_texture.h"
@@ -46,6 +50,31 @@
 #include "st_cb_texture.h"
 
 
+/**
+ * Generate the levels with compute dispatches, which write two levels per
+ * dispatch for most textures instead of one blit per level.
+ */
+static bool
+st_compute_gen_mipmap(struct st_context *st, struct pipe_resource *pt,
+                      enum pipe_format format, uint baseLevel, uint lastLevel,
+                      uint first_layer, uint last_layer)
+{
+   if (!st->has_compute_gen_mipmap)
+      return false;
+
+   if (!util_compute_gen_mipmap(st->pipe, pt, format, baseLevel, lastLevel,
+                                first_layer, last_layer, &st->gen_mipmap_cs))
+      return false;
+
+   /* The helper unbound the compute shader, sampler views, images and
+    * constant buffer behind our back.
+    */
+   cso_set_compute_shader_handle(st->cso_context, NULL);
+   st->dirty |= ST_PIPELINE_COMPUTE_STATE_MASK;
+   return true;
+}
+
+
 /**
  * Called via ctx->Driver.GenerateMipmap().
  */
@@ -143,9 +172,21 @@ st_generate_mipmap(struct gl_context *ctx, GLenum target,
        !st->pipe->generate_mipmap(st->pipe, pt, format, baseLevel,
                                   lastLevel, first_layer, last_layer)) {
 
-      if (!util_gen_mipmap(st->pipe, pt, format, baseLevel, lastLevel,
+      if (!st_compute_gen_mipmap(st, pt, format, baseLevel, lastLevel,
+                                 first_layer, last_layer) &&
+          !util_gen_mipmap(st->pipe, pt, format, baseLevel, lastLevel,
                            first_layer, last_layer, PIPE_TEX_FILTER_LINEAR)) {
          _mesa_generate_mipmap(ctx, target, texObj);
       }
    }
 }
+
+
+void
+st_destroy_gen_mipmap(struct st_context *st)
+{
+   if (st->gen_mipmap_cs) {
+      st->pipe->delete_compute_state(st->pipe, st->gen_mipmap_cs);
+      st->gen_mipmap_cs = NULL;
+   }
+}
@@ -83,6 +83,13 @@ st_nir_finish_builtin_shader(struct st_context *st,
       return pipe->create_gs_state(pipe, &state);
    case MESA_SHADER_FRAGMENT:
       return pipe->create_fs_state(pipe, &state);
+   case MESA_SHADER_COMPUTE: {
+      struct pipe_compute_state cs = {0};
+      cs.ir_type = PIPE_SHADER_IR_NIR;
+      cs.prog = nir;
+      cs.req_local_mem = nir->info.cs.shared_size;
+      return pipe->create_compute_state(pipe, &cs);
+   }
    default:
       unreachable("unsupported shader stage");
       return NULL;
@@ -29,6 +29,7 @@
  */
 
 #include "state_tracker/st_context.h"
+#include "state_tracker/st_atom.h"
 #include "state_tracker/st_nir.h"
 #include "state_tracker/st_pbo.h"
 #include "state_tracker/st_cb_bufferobjects.h"
@@ -782,6 +783,213 @@ st_pbo_get_download_fs(struct st_context *st, enum pipe_texture_target target,
    return st->pbo.download_fs[conversion][target];
 }
 
+/* Same as the download fragment shader, but each invocation handles the
+ * texel at rect.xy + global invocation id instead of the fragment position.
+ */
+static void *
+create_download_cs(struct st_context *st, enum pipe_texture_target target,
+                   enum st_pbo_conversion conversion)
+{
+   struct nir_builder b;
+   const nir_shader_compiler_options *options =
+      st->ctx->Const.ShaderCompilerOptions[MESA_SHADER_COMPUTE].NirOptions;
+
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_COMPUTE, options);
+   b.shader->info.cs.local_size[0] = 8;
+   b.shader->info.cs.local_size[1] = 8;
+   b.shader->info.cs.local_size[2] = 1;
+
+   nir_ssa_def *zero = nir_imm_int(&b, 0);
+
+   /* param = [ -xoffset + skip_pixels, -yoffset, stride, image_height ] */
+   nir_variable *param_var =
+      nir_variable_create(b.shader, nir_var_uniform, glsl_vec4_type(), "param");
+   nir_ssa_def *param = nir_load_var(&b, param_var);
+
+   nir_variable *layer_offset_var =
+      nir_variable_create(b.shader, nir_var_uniform, glsl_int_type(),
+                          "layer_offset");
+   layer_offset_var->data.driver_location = 4;
+   nir_ssa_def *layer_offset = nir_load_var(&b, layer_offset_var);
+
+   /* rect = [ x, y, width, height ] of the surface area to download */
+   nir_variable *rect_var =
+      nir_variable_create(b.shader, nir_var_uniform, glsl_vec4_type(), "rect");
+   rect_var->data.driver_location = 8;
+   nir_ssa_def *rect = nir_load_var(&b, rect_var);
+   b.shader->num_uniforms += 12;
+
+   nir_ssa_def *id =
+      nir_iadd(&b, nir_imul(&b, nir_load_work_group_id(&b),
+                            nir_imm_ivec4(&b, 8, 8, 1, 0)),
+               nir_load_local_invocation_id(&b));
+
+   nir_push_if(&b, nir_iand(&b, nir_ult(&b, nir_channel(&b, id, 0),
+                                        nir_channel(&b, rect, 2)),
+                            nir_ult(&b, nir_channel(&b, id, 1),
+                                    nir_channel(&b, rect, 3))));
+
+   nir_ssa_def *pos = nir_iadd(&b, nir_channels(&b, rect, TGSI_WRITEMASK_XY),
+                               nir_channels(&b, id, TGSI_WRITEMASK_XY));
+   nir_ssa_def *layer = nir_channel(&b, id, 2);
+
+   /* addr = offset_pos.x + offset_pos.y * stride + layer * image_height */
+   nir_ssa_def *offset_pos =
+      nir_iadd(&b, nir_channels(&b, param, TGSI_WRITEMASK_XY), pos);
+   nir_ssa_def *pbo_addr =
+      nir_iadd(&b, nir_channel(&b, offset_pos, 0),
+               nir_imul(&b, nir_channel(&b, offset_pos, 1),
+                        nir_channel(&b, param, 2)));
+   pbo_addr = nir_iadd(&b, pbo_addr,
+                       nir_imul(&b, layer, nir_channel(&b, param, 3)));
+
+   nir_ssa_def *texcoord = pos;
+   if (target != PIPE_TEXTURE_2D && target != PIPE_TEXTURE_RECT) {
+      texcoord = nir_vec3(&b, nir_channel(&b, pos, 0),
+                              nir_channel(&b, pos, 1),
+                              nir_iadd(&b, layer, layer_offset));
+   }
+
+   nir_variable *tex_var =
+      nir_variable_create(b.shader, nir_var_uniform,
+                          sampler_type_for_target(target), "tex");
+   tex_var->data.explicit_binding = true;
+   tex_var->data.binding = 0;
+
+   nir_deref_instr *tex_deref = nir_build_deref_var(&b, tex_var);
+
+   nir_tex_instr *tex = nir_tex_instr_create(b.shader, 3);
+   tex->op = nir_texop_txf;
+   tex->sampler_dim = glsl_get_sampler_dim(tex_var->type);
+   tex->coord_components =
+      glsl_get_sampler_coordinate_components(tex_var->type);
+   tex->dest_type = nir_type_float;
+   tex->src[0].src_type = nir_tex_src_texture_deref;
+   tex->src[0].src = nir_src_for_ssa(&tex_deref->dest.ssa);
+   tex->src[1].src_type = nir_tex_src_sampler_deref;
+   tex->src[1].src = nir_src_for_ssa(&tex_deref->dest.ssa);
+   tex->src[2].src_type = nir_tex_src_coord;
+   tex->src[2].src = nir_src_for_ssa(texcoord);
+   nir_ssa_dest_init(&tex->instr, &tex->dest, 4, 32, NULL);
+   nir_builder_instr_insert(&b, &tex->instr);
+   nir_ssa_def *result = &tex->dest.ssa;
+
+   if (conversion == ST_PBO_CONVERT_SINT_TO_UINT)
+      result = nir_imax(&b, result, zero);
+   else if (conversion == ST_PBO_CONVERT_UINT_TO_SINT)
+      result = nir_umin(&b, result, nir_imm_int(&b, (1u << 31) - 1));
+
+   nir_variable *img_var =
+      nir_variable_create(b.shader, nir_var_uniform,
+                          glsl_image_type(GLSL_SAMPLER_DIM_BUF, false,
+                                          GLSL_TYPE_FLOAT), "img");
+   img_var->data.access = ACCESS_NON_READABLE;
+   img_var->data.explicit_binding = true;
+   img_var->data.binding = 0;
+   nir_deref_instr *img_deref = nir_build_deref_var(&b, img_var);
+   nir_intrinsic_instr *intrin =
+      nir_intrinsic_instr_create(b.shader, nir_intrinsic_image_deref_store);
+   intrin->src[0] = nir_src_for_ssa(&img_deref->dest.ssa);
+   intrin->src[1] = nir_src_for_ssa(nir_vec4(&b, pbo_addr, zero, zero, zero));
+   intrin->src[2] = nir_src_for_ssa(zero);
+   intrin->src[3] = nir_src_for_ssa(result);
+   intrin->src[4] = nir_src_for_ssa(nir_imm_int(&b, 0));
+   intrin->num_components = 4;
+   nir_builder_instr_insert(&b, &intrin->instr);
+
+   nir_pop_if(&b, NULL);
+
+   return st_nir_finish_builtin_shader(st, b.shader, "st/pbo download CS");
+}
+
+/* Download addr->width x addr->height texels of each of addr->depth layers
+ * of the view, starting at (x, y), with a compute dispatch.  Unlike
+ * st_pbo_draw, this needs no framebuffer or vertex pipeline state.
+ *
+ * The caller only has to do the memory barrier.  All compute state set here
+ * is unbound again afterwards.
+ */
+bool
+st_pbo_download_compute(struct st_context *st,
+                        const struct st_pbo_addresses *addr,
+                        struct pipe_resource *texture,
+                        const struct pipe_sampler_view *view_templ,
+                        enum pipe_format dst_format, int x, int y)
+{
+   struct pipe_context *pipe = st->pipe;
+   enum pipe_texture_target target = view_templ->target;
+   enum st_pbo_conversion conversion =
+      get_pbo_conversion(view_templ->format, dst_format);
+
+   STATIC_ASSERT(ARRAY_SIZE(st->pbo.download_cs) == ST_NUM_PBO_CONVERSIONS);
+   assert(target < PIPE_MAX_TEXTURE_TYPES);
+
+   if (!st->pbo.download_cs[conversion][target])
+      st->pbo.download_cs[conversion][target] =
+         create_download_cs(st, target, conversion);
+   if (!st->pbo.download_cs[conversion][target])
+      return false;
+
+   struct pipe_sampler_view *view =
+      pipe->create_sampler_view(pipe, texture, view_templ);
+   if (!view)
+      return false;
+
+   int32_t constants[12] = {
+      addr->constants.xoffset,
+      addr->constants.yoffset,
+      addr->constants.stride,
+      addr->constants.image_size,
+      addr->constants.layer_offset,
+      0, 0, 0,
+      x, y, addr->width, addr->height,
+   };
+   struct pipe_constant_buffer cb = {0};
+   cb.user_buffer = constants;
+   cb.buffer_size = sizeof(constants);
+
+   struct pipe_image_view image;
+   memset(&image, 0, sizeof(image));
+   image.resource = addr->buffer;
+   image.format = dst_format;
+   image.access = PIPE_IMAGE_ACCESS_WRITE;
+   image.shader_access = PIPE_IMAGE_ACCESS_WRITE;
+   image.u.buf.offset = addr->first_element * addr->bytes_per_pixel;
+   image.u.buf.size = (addr->last_element - addr->first_element + 1) *
+                      addr->bytes_per_pixel;
+
+   struct pipe_sampler_state sampler = {0};
+   void *sampler_cso = pipe->create_sampler_state(pipe, &sampler);
+
+   pipe->bind_compute_state(pipe, st->pbo.download_cs[conversion][target]);
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_COMPUTE, 0, &cb);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_COMPUTE, 0, 1, &view);
+   pipe->bind_sampler_states(pipe, PIPE_SHADER_COMPUTE, 0, 1, &sampler_cso);
+   pipe->set_shader_images(pipe, PIPE_SHADER_COMPUTE, 0, 1, &image);
+
+   struct pipe_grid_info info = {0};
+   info.block[0] = 8;
+   info.block[1] = 8;
+   info.block[2] = 1;
+   info.grid[0] = DIV_ROUND_UP(addr->width, 8);
+   info.grid[1] = DIV_ROUND_UP(addr->height, 8);
+   info.grid[2] = addr->depth;
+   pipe->launch_grid(pipe, &info);
+
+   pipe->set_shader_images(pipe, PIPE_SHADER_COMPUTE, 0, 1, NULL);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_COMPUTE, 0, 1, NULL);
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_COMPUTE, 0, NULL);
+   pipe->bind_compute_state(pipe, NULL);
+   pipe->delete_sampler_state(pipe, sampler_cso);
+   pipe_sampler_view_reference(&view, NULL);
+
+   /* Compute state has been changed behind the state tracker's back. */
+   cso_set_compute_shader_handle(st->cso_context, NULL);
+   st->dirty |= ST_PIPELINE_COMPUTE_STATE_MASK;
+
+   return true;
+}
+
 void
 st_init_pbo_helpers(struct st_context *st)
 {
@@ -802,6 +1010,18 @@ st_init_pbo_helpers(struct st_context *st)
       screen->get_shader_param(screen, PIPE_SHADER_FRAGMENT,
                                        PIPE_SHADER_CAP_MAX_SHADER_IMAGES) >= 1;
 
+   /* Downloads with a compute shader don't need a framebuffer, so they
+    * also work where the fragment shader path doesn't.
+    */
+   st->pbo.download_cs_enabled =
+      screen->get_param(screen, PIPE_CAP_SAMPLER_VIEW_TARGET) &&
+      screen->get_param(screen, PIPE_CAP_COMPUTE) &&
+      screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                               PIPE_SHADER_CAP_PREFERRED_IR) ==
+         PIPE_SHADER_IR_NIR &&
+      screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                               PIPE_SHADER_CAP_MAX_SHADER_IMAGES) >= 1;
+
    st->pbo.rgba_only =
       screen->get_param(screen, PIPE_CAP_BUFFER_SAMPLER_VIEW_RGBA_ONLY);
 
@@ -844,6 +1064,15 @@ st_destroy_pbo_helpers(struct st_context *st)
       }
    }
 
+   for (i = 0; i < ARRAY_SIZE(st->pbo.download_cs); ++i) {
+      for (unsigned j = 0; j < ARRAY_SIZE(st->pbo.download_cs[0]); ++j) {
+         if (st->pbo.download_cs[i][j]) {
+            st->pipe->delete_compute_state(st->pipe, st->pbo.download_cs[i][j]);
+            st->pbo.download_cs[i][j] = NULL;
+         }
+      }
+   }
+
    if (st->pbo.gs) {
       st->pipe->delete_gs_state(st->pipe, st->pbo.gs);
       st->pbo.gs = NULL;
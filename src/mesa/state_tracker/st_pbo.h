@@ -25,6 +25,7 @@
 #define ST_PBO_H
 
 struct gl_pixelstore_attrib;
+struct pipe_sampler_view;
 
 struct st_context;
 
@@ -94,6 +95,13 @@ st_pbo_get_download_fs(struct st_context *st, enum pipe_texture_target target,
                        enum pipe_format src_format,
                        enum pipe_format dst_format);
 
+bool
+st_pbo_download_compute(struct st_context *st,
+                        const struct st_pbo_addresses *addr,
+                        struct pipe_resource *texture,
+                        const struct pipe_sampler_view *view_templ,
+                        enum pipe_format dst_format, int x, int y);
+
 extern void
 st_init_pbo_helpers(struct st_context *st);
 
@@ -848,6 +848,8 @@ st_get_vp_variant(struct st_context *st,
          /* insert into list */
          vpv->base.next = stp->variants;
          stp->variants = &vpv->base;
+
+         st_store_variant_keys_in_disk_cache(st, stp);
       }
    }
 
@@ -1571,6 +1573,8 @@ st_get_fp_variant(struct st_context *st,
             fpv->base.next = stfp->variants;
             stfp->variants = &fpv->base;
          }
+
+         st_store_variant_keys_in_disk_cache(st, stfp);
       }
    }
 
@@ -1867,6 +1871,8 @@ st_get_common_variant(struct st_context *st,
          /* insert into list */
          v->next = prog->variants;
          prog->variants = v;
+
+         st_store_variant_keys_in_disk_cache(st, prog);
       }
    }
 
@@ -2068,4 +2074,7 @@ st_finalize_program(struct st_context *st, struct gl_program *prog)
    if (ST_DEBUG & DEBUG_PRECOMPILE ||
        st->shader_has_one_variant[prog->info.stage])
       st_precompile_shader_variant(st, prog);
+
+   /* Create the variants that were needed by the previous runs. */
+   st_precompile_cached_variants(st, prog);
 }
@@ -239,6 +239,14 @@ struct st_program
    struct gl_shader_program *shader_program;
 
    struct st_variant *variants;
+
+   /** Number of variant keys last stored in or loaded from the disk cache */
+   unsigned num_cached_variant_keys;
+
+   /** Resident copy of the parameter values for partial constant uploads */
+   struct pipe_resource *constbuf;
+   gl_constant_value *constbuf_shadow; /**< what was written to constbuf */
+   struct st_context *constbuf_st;      /**< the context writing constbuf */
 };
 
 
@@ -313,3 +313,191 @@ st_deserialise_nir_program(struct gl_context *ctx,
 {
    st_deserialise_ir_program(ctx, shProg, prog, true);
 }
+
+/**
+ * Compute the disk cache key under which the variant keys seen for \p prog
+ * are stored.  Only GLSL programs have a stable hash to derive it from.
+ */
+static bool
+get_variant_keys_cache_key(struct disk_cache *cache, struct gl_program *prog,
+                           cache_key key)
+{
+   static const char zero[sizeof(prog->sh.data->sha1)] = {0};
+
+   if (!cache || prog->is_arb_asm || st_program(prog)->ati_fs ||
+       !prog->sh.data ||
+       memcmp(prog->sh.data->sha1, zero, sizeof(zero)) == 0)
+      return false;
+
+   struct {
+      char tag[12];
+      uint8_t stage;
+      uint8_t sha1[sizeof(prog->sh.data->sha1)];
+   } data;
+
+   memset(&data, 0, sizeof(data));
+   memcpy(data.tag, "st_variants", sizeof("st_variants"));
+   data.stage = prog->info.stage;
+   memcpy(data.sha1, prog->sh.data->sha1, sizeof(data.sha1));
+
+   disk_cache_compute_key(cache, &data, sizeof(data), key);
+   return true;
+}
+
+static unsigned
+get_variant_key_size(gl_shader_stage stage)
+{
+   return stage == MESA_SHADER_FRAGMENT ? sizeof(struct st_fp_variant_key) :
+                                          sizeof(struct st_common_variant_key);
+}
+
+/**
+ * Copy the key of \p v into \p key with the context pointer cleared.
+ * Returns false for variants that only exist for internal draws and that
+ * are not worth precompiling.
+ */
+static bool
+get_cacheable_variant_key(gl_shader_stage stage, struct st_variant *v,
+                          void *key)
+{
+   if (stage == MESA_SHADER_FRAGMENT) {
+      struct st_fp_variant_key *fp_key = key;
+
+      *fp_key = st_fp_variant(v)->key;
+      fp_key->st = NULL;
+      return !fp_key->bitmap && !fp_key->drawpixels;
+   } else {
+      struct st_common_variant_key *common_key = key;
+
+      *common_key = st_common_variant(v)->key;
+      common_key->st = NULL;
+      return !common_key->is_draw_shader;
+   }
+}
+
+/**
+ * Record the keys of all variants of \p stp in the disk cache, so that the
+ * next run can compile them right after linking instead of at draw time.
+ * This is called whenever a new variant is created.
+ */
+void
+st_store_variant_keys_in_disk_cache(struct st_context *st,
+                                    struct st_program *stp)
+{
+   gl_shader_stage stage = stp->Base.info.stage;
+   unsigned key_size = get_variant_key_size(stage);
+   cache_key cache_key;
+
+   if (!get_variant_keys_cache_key(st->ctx->Cache, &stp->Base, cache_key))
+      return;
+
+   struct blob blob;
+   blob_init(&blob);
+   blob_write_uint32(&blob, key_size);
+
+   intptr_t count_offset = blob_reserve_uint32(&blob);
+   unsigned count = 0;
+   uint8_t key[MAX2(sizeof(struct st_fp_variant_key),
+                    sizeof(struct st_common_variant_key))];
+
+   for (struct st_variant *v = stp->variants; v; v = v->next) {
+      if (!get_cacheable_variant_key(stage, v, key))
+         continue;
+
+      /* Variants of other contexts differ only by the context pointer. */
+      bool duplicate = false;
+      for (unsigned i = 0; i < count && !duplicate; i++) {
+         duplicate = memcmp(blob.data + 8 + i * key_size, key,
+                            key_size) == 0;
+      }
+      if (duplicate)
+         continue;
+
+      blob_write_bytes(&blob, key, key_size);
+      count++;
+   }
+
+   /* Only write when a key was added since the last store or load. */
+   if (count > stp->num_cached_variant_keys && !blob.out_of_memory) {
+      blob_overwrite_uint32(&blob, count_offset, count);
+      disk_cache_put(st->ctx->Cache, cache_key, blob.data, blob.size, NULL);
+      stp->num_cached_variant_keys = count;
+
+      if (st->ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+         fprintf(stderr, "putting %u %s state tracker variant keys in cache\n",
+                 count, _mesa_shader_stage_to_string(stage));
+      }
+   }
+
+   blob_finish(&blob);
+}
+
+/**
+ * Compile the variants recorded by st_store_variant_keys_in_disk_cache in a
+ * previous run.
+ *
+ * Gallium contexts can't create shaders from another thread, so this runs
+ * at link time.  Drivers that compile in create_*_state asynchronously keep
+ * the actual compilation off the application thread.
+ */
+void
+st_precompile_cached_variants(struct st_context *st, struct gl_program *prog)
+{
+   struct st_program *stp = st_program(prog);
+   gl_shader_stage stage = prog->info.stage;
+   unsigned key_size = get_variant_key_size(stage);
+   cache_key cache_key;
+   size_t size;
+
+   if (!get_variant_keys_cache_key(st->ctx->Cache, prog, cache_key))
+      return;
+
+   void *buffer = disk_cache_get(st->ctx->Cache, cache_key, &size);
+   if (!buffer)
+      return;
+
+   struct blob_reader blob_reader;
+   blob_reader_init(&blob_reader, buffer, size);
+
+   unsigned stored_key_size = blob_read_uint32(&blob_reader);
+   unsigned count = blob_read_uint32(&blob_reader);
+
+   /* Keys written by a build with another key layout are useless. */
+   if (stored_key_size != key_size || blob_reader.overrun ||
+       size != 8 + (size_t)count * key_size) {
+      free(buffer);
+      return;
+   }
+
+   /* Don't write the same keys back while compiling them. */
+   stp->num_cached_variant_keys = count;
+
+   for (unsigned i = 0; i < count; i++) {
+      const void *key = blob_read_bytes(&blob_reader, key_size);
+
+      if (stage == MESA_SHADER_FRAGMENT) {
+         struct st_fp_variant_key fp_key;
+
+         memcpy(&fp_key, key, sizeof(fp_key));
+         fp_key.st = st->has_shareable_shaders ? NULL : st;
+         st_get_fp_variant(st, stp, &fp_key);
+      } else {
+         struct st_common_variant_key common_key;
+
+         memcpy(&common_key, key, sizeof(common_key));
+         common_key.st = st->has_shareable_shaders ? NULL : st;
+
+         if (stage == MESA_SHADER_VERTEX)
+            st_get_vp_variant(st, stp, &common_key);
+         else
+            st_get_common_variant(st, stp, &common_key);
+      }
+   }
+
+   if (st->ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+      fprintf(stderr, "precompiled %u %s state tracker variants from cache\n",
+              count, _mesa_shader_stage_to_string(stage));
+   }
+
+   free(buffer);
+}
@@ -73,6 +73,13 @@ void
 st_store_ir_in_disk_cache(struct st_context *st, struct gl_program *prog,
                           bool nir);
 
+void
+st_store_variant_keys_in_disk_cache(struct st_context *st,
+                                    struct st_program *stp);
+
+void
+st_precompile_cached_variants(struct st_context *st, struct gl_program *prog);
+
 #ifdef __cplusplus
 }
 #endif
@@ -167,6 +167,14 @@ struct vbo_save_context {
 
    GLuint opcode_vertex_list;
 
+   /* The last vertex list compiled into the current display list and the
+    * display list position right after it, to detect whether vertex lists
+    * can be merged.
+    */
+   struct vbo_save_vertex_list *last_node;
+   union gl_dlist_node *last_node_block;
+   GLuint last_node_pos;
+
    struct vbo_save_copied_vtx copied;
 
    fi_type *current[VBO_ATTRIB_MAX]; /* points into ctx->ListState */
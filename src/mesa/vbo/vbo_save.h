@@ -66,6 +66,7 @@ struct vbo_save_vertex_list {
 
    struct _mesa_prim *prims;
    GLuint prim_count;
+   bool owns_prims;   /**< prims were merged into a malloc'ed array */
 
    struct vbo_save_primitive_store *prim_store;
 };
@@ -465,23 +465,67 @@ update_vao(struct gl_context *ctx,
  * Insert the active immediate struct onto the display list currently
  * being built.
  */
-static void
-compile_vertex_list(struct gl_context *ctx)
+/**
+ * Append the primitives of the vertex list that was just compiled to the
+ * previous vertex list of the display list.  This is only possible if both
+ * source the same vertex buffer with the same layout and the new list
+ * doesn't continue a primitive of the previous one.
+ *
+ * Large display lists of many glBegin/glEnd pairs are otherwise split into
+ * one vertex list per primitive store, and each of them is validated and
+ * drawn separately on replay.
+ */
+static bool
+merge_vertex_lists(struct gl_context *ctx, struct vbo_save_vertex_list *prev,
+                   struct vbo_save_vertex_list *node)
 {
-   struct vbo_save_context *save = &vbo_context(ctx)->save;
-   struct vbo_save_vertex_list *node;
+   for (gl_vertex_processing_mode vpm = VP_MODE_FF; vpm < VP_MODE_MAX; ++vpm) {
+      if (prev->VAO[vpm] != node->VAO[vpm])
+         return false;
+   }
 
-   /* Allocate space for this structure in the display list currently
-    * being compiled.
-    */
-   node = (struct vbo_save_vertex_list *)
-      _mesa_dlist_alloc_aligned(ctx, save->opcode_vertex_list, sizeof(*node));
+   if (!prev->prim_count || !node->prim_count ||
+       !prev->prims[prev->prim_count - 1].end ||
+       !node->prims[0].begin || node->wrap_count)
+      return false;
 
-   if (!node)
-      return;
+   const GLuint prim_count = prev->prim_count + node->prim_count;
+   struct _mesa_prim *prims;
+
+   if (prev->owns_prims) {
+      prims = realloc(prev->prims, prim_count * sizeof(*prims));
+      if (!prims)
+         return false;
+   } else {
+      prims = malloc(prim_count * sizeof(*prims));
+      if (!prims)
+         return false;
+      memcpy(prims, prev->prims, prev->prim_count * sizeof(*prims));
+   }
+   memcpy(prims + prev->prim_count, node->prims,
+          node->prim_count * sizeof(*prims));
 
-   /* Make sure the pointer is aligned to the size of a pointer */
-   assert((GLintptr) node % sizeof(void *) == 0);
+   prev->prims = prims;
+   prev->prim_count = prim_count;
+   prev->owns_prims = true;
+   merge_prims(ctx, prev->prims, &prev->prim_count);
+
+   prev->vertex_count += node->vertex_count;
+
+   /* The current values are those after the last vertex. */
+   free(prev->current_data);
+   prev->current_data = node->current_data;
+   node->current_data = NULL;
+   return true;
+}
+
+
+static void
+compile_vertex_list(struct gl_context *ctx)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+   struct vbo_save_vertex_list list = {0};
+   struct vbo_save_vertex_list *node = &list;
 
    /* Duplicate our template, increment refcounts to the storage structs:
     */
@@ -536,8 +580,6 @@ compile_vertex_list(struct gl_context *ctx)
       _mesa_reference_vao(ctx, &node->VAO[vpm], save->VAO[vpm]);
    }
 
-   node->prim_store->refcount++;
-
    if (save->no_current_update) {
       node->current_data = NULL;
    }
@@ -590,6 +632,40 @@ compile_vertex_list(struct gl_context *ctx)
       node->prims[i].start += start_offset;
    }
 
+   /* Append the primitives to the previous vertex list if nothing else
+    * was compiled since, or store a new one in the display list.
+    */
+   if (save->last_node &&
+       save->last_node_block == ctx->ListState.CurrentBlock &&
+       save->last_node_pos == ctx->ListState.CurrentPos &&
+       merge_vertex_lists(ctx, save->last_node, node)) {
+      for (gl_vertex_processing_mode vpm = VP_MODE_FF; vpm < VP_MODE_MAX; ++vpm)
+         _mesa_reference_vao(ctx, &node->VAO[vpm], NULL);
+   } else {
+      struct vbo_save_vertex_list *dlist_node =
+         (struct vbo_save_vertex_list *)
+         _mesa_dlist_alloc_aligned(ctx, save->opcode_vertex_list,
+                                   sizeof(*dlist_node));
+
+      if (dlist_node) {
+         /* Make sure the pointer is aligned to the size of a pointer */
+         assert((GLintptr) dlist_node % sizeof(void *) == 0);
+
+         *dlist_node = list;
+         dlist_node->prim_store->refcount++;
+
+         save->last_node = dlist_node;
+         save->last_node_block = ctx->ListState.CurrentBlock;
+         save->last_node_pos = ctx->ListState.CurrentPos;
+      } else {
+         for (gl_vertex_processing_mode vpm = VP_MODE_FF; vpm < VP_MODE_MAX; ++vpm)
+            _mesa_reference_vao(ctx, &node->VAO[vpm], NULL);
+         free(node->current_data);
+         node->current_data = NULL;
+         save->last_node = NULL;
+      }
+   }
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -634,8 +710,9 @@ compile_vertex_list(struct gl_context *ctx)
    }
 
    if (save->prim_store->used > VBO_SAVE_PRIM_SIZE - 6) {
-      save->prim_store->refcount--;
-      assert(save->prim_store->refcount != 0);
+      /* The store may be unreferenced if its vertex lists were merged. */
+      if (--save->prim_store->refcount == 0)
+         free(save->prim_store);
       save->prim_store = alloc_prim_store();
    }
 
@@ -1559,6 +1636,7 @@ vbo_save_NewList(struct gl_context *ctx, GLuint list, GLenum mode)
       save->vertex_store = alloc_vertex_store(ctx);
 
    save->buffer_ptr = vbo_save_map_vertex_store(ctx, save->vertex_store);
+   save->last_node = NULL;
 
    reset_vertex(ctx);
    reset_counters(ctx);
@@ -1643,6 +1721,9 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
    if (--node->prim_store->refcount == 0)
       free(node->prim_store);
 
+   if (node->owns_prims)
+      free(node->prims);
+
    free(node->current_data);
    node->current_data = NULL;
 }
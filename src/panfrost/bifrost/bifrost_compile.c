@@ -40,6 +40,7 @@
 static const struct debug_named_value debug_options[] = {
         {"msgs",      BIFROST_DBG_MSGS,		"Print debug messages"},
         {"shaders",   BIFROST_DBG_SHADERS,	"Dump shaders in NIR and MIR"},
+        {"shaderdb",  BIFROST_DBG_SHADERDB,	"Print shader-db statistics"},
         DEBUG_NAMED_VALUE_END
 };
 
@@ -47,6 +48,8 @@ DEBUG_GET_ONCE_FLAGS_OPTION(bifrost_debug, "BIFROST_MESA_DEBUG", debug_options,
 
 int bifrost_debug = 0;
 
+static unsigned SHADER_DB_COUNT = 0;
+
 #define DBG(fmt, ...) \
 		do { if (bifrost_debug & BIFROST_DBG_MSGS) \
 			fprintf(stderr, "%s:%d: "fmt, \
@@ -1305,6 +1308,37 @@ bi_optimize_nir(nir_shader *nir)
         NIR_PASS(progress, nir, nir_convert_from_ssa, true);
 }
 
+/* Bundle density is what limits ALU throughput, so report it alongside the
+ * clause count in a shader-db friendly format to judge scheduler changes */
+
+static void
+bi_print_stats(bi_context *ctx, unsigned size)
+{
+        unsigned nr_clauses = 0, nr_bundles = 0, nr_ins = 0;
+
+        bi_foreach_block(ctx, _block) {
+                bi_block *block = (bi_block *) _block;
+
+                bi_foreach_clause_in_block(block, clause) {
+                        nr_clauses++;
+                        nr_bundles += clause->bundle_count;
+
+                        for (unsigned i = 0; i < clause->bundle_count; ++i) {
+                                nr_ins += !!clause->bundles[i].fma;
+                                nr_ins += !!clause->bundles[i].add;
+                        }
+                }
+        }
+
+        fprintf(stderr, "shader%u - %s shader: "
+                        "%u inst, %u bundles, %u clauses, %u quadwords, "
+                        "%u loops\n",
+                        SHADER_DB_COUNT++,
+                        gl_shader_stage_name(ctx->stage),
+                        nr_ins, nr_bundles, nr_clauses, size / 16,
+                        ctx->loop_count);
+}
+
 void
 bifrost_compile_shader_nir(nir_shader *nir, panfrost_program *program, unsigned product_id)
 {
@@ -1390,5 +1424,8 @@ bifrost_compile_shader_nir(nir_shader *nir, panfrost_program *program, unsigned
         if (bifrost_debug & BIFROST_DBG_SHADERS)
                 disassemble_bifrost(stdout, program->compiled.data, program->compiled.size, true);
 
+        if (bifrost_debug & BIFROST_DBG_SHADERDB)
+                bi_print_stats(ctx, program->compiled.size);
+
         ralloc_free(ctx);
 }
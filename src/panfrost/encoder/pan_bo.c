@@ -35,6 +35,7 @@
 #include "../pandecode/public.h"
 
 #include "os/os_mman.h"
+#include "util/os_misc.h"
 
 #include "util/u_inlines.h"
 #include "util/u_math.h"
@@ -186,6 +187,59 @@ pan_bucket(struct panfrost_device *dev, unsigned size)
  * cache. If it fails, it returns NULL signaling the caller to allocate a new
  * BO. */
 
+/* Removes a BO from the cache lists, with the cache lock held */
+
+static void
+panfrost_bo_cache_remove(struct panfrost_device *dev, struct panfrost_bo *bo)
+{
+        list_del(&bo->bucket_link);
+        list_del(&bo->lru_link);
+        dev->bo_cache.size -= bo->size;
+}
+
+/* Frees the cached BOs whose backing pages the kernel reclaimed. They would
+ * need a fresh allocation on reuse anyway, and until then they only hold on
+ * to a GEM handle and some GPU VA. */
+
+static void
+panfrost_bo_cache_free_purged(struct panfrost_device *dev)
+{
+        list_for_each_entry_safe(struct panfrost_bo, entry,
+                                 &dev->bo_cache.lru, lru_link) {
+                /* Cached BOs are already DONTNEED, this just queries
+                 * whether they were retained */
+                struct drm_panfrost_madvise madv = {
+                        .handle = entry->gem_handle,
+                        .madv = PANFROST_MADV_DONTNEED,
+                };
+
+                if (drmIoctl(dev->fd, DRM_IOCTL_PANFROST_MADVISE, &madv) ||
+                    madv.retained)
+                        continue;
+
+                panfrost_bo_cache_remove(dev, entry);
+                dev->bo_cache.stats.purged++;
+                panfrost_bo_free(entry);
+        }
+}
+
+/* Frees the least recently used BOs until the cache holds at most target
+ * bytes, with the cache lock held */
+
+static void
+panfrost_bo_cache_trim(struct panfrost_device *dev, uint64_t target)
+{
+        list_for_each_entry_safe(struct panfrost_bo, entry,
+                                 &dev->bo_cache.lru, lru_link) {
+                if (dev->bo_cache.size <= target)
+                        break;
+
+                panfrost_bo_cache_remove(dev, entry);
+                dev->bo_cache.stats.evicted++;
+                panfrost_bo_free(entry);
+        }
+}
+
 static struct panfrost_bo *
 panfrost_bo_cache_fetch(struct panfrost_device *dev,
                         size_t size, uint32_t flags, bool dontwait)
@@ -193,6 +247,7 @@ panfrost_bo_cache_fetch(struct panfrost_device *dev,
         pthread_mutex_lock(&dev->bo_cache.lock);
         struct list_head *bucket = pan_bucket(dev, size);
         struct panfrost_bo *bo = NULL;
+        bool purged = false;
 
         /* Iterate the bucket looking for something suitable */
         list_for_each_entry_safe(struct panfrost_bo, entry, bucket,
@@ -211,18 +266,26 @@ panfrost_bo_cache_fetch(struct panfrost_device *dev,
                 int ret;
 
                 /* This one works, splice it out of the cache */
-                list_del(&entry->bucket_link);
-                list_del(&entry->lru_link);
+                panfrost_bo_cache_remove(dev, entry);
 
                 ret = drmIoctl(dev->fd, DRM_IOCTL_PANFROST_MADVISE, &madv);
                 if (!ret && !madv.retained) {
+                        dev->bo_cache.stats.purged++;
                         panfrost_bo_free(entry);
+                        purged = true;
                         continue;
                 }
                 /* Let's go! */
                 bo = entry;
+                dev->bo_cache.stats.hits++;
                 break;
         }
+
+        /* The kernel only purges under memory pressure, and has likely taken
+         * more of our cached BOs, so get rid of those too */
+        if (purged)
+                panfrost_bo_cache_free_purged(dev);
+
         pthread_mutex_unlock(&dev->bo_cache.lock);
 
         return bo;
@@ -247,10 +310,22 @@ panfrost_bo_cache_evict_stale_bos(struct panfrost_device *dev)
                 if (time.tv_sec - entry->last_used <= 2)
                         break;
 
-                list_del(&entry->bucket_link);
-                list_del(&entry->lru_link);
+                panfrost_bo_cache_remove(dev, entry);
                 panfrost_bo_free(entry);
         }
+
+        /* If the system is running out of memory, don't keep anything
+         * around */
+        uint64_t available;
+
+        if (dev->bo_cache.size && dev->bo_cache.low_memory_threshold &&
+            dev->bo_cache.last_memory_check != time.tv_sec) {
+                dev->bo_cache.last_memory_check = time.tv_sec;
+
+                if (os_get_available_system_memory(&available) &&
+                    available < dev->bo_cache.low_memory_threshold)
+                        panfrost_bo_cache_trim(dev, 0);
+        }
 }
 
 /* Tries to add a BO to the cache. Returns if it was
@@ -282,6 +357,10 @@ panfrost_bo_cache_put(struct panfrost_bo *bo)
         list_addtail(&bo->lru_link, &dev->bo_cache.lru);
         clock_gettime(CLOCK_MONOTONIC, &time);
         bo->last_used = time.tv_sec;
+        dev->bo_cache.size += bo->size;
+
+        if (dev->bo_cache.size > dev->bo_cache.max_size)
+                panfrost_bo_cache_trim(dev, dev->bo_cache.max_size);
 
         /* Let's do some cleanup in the BO cache while we hold the
          * lock.
@@ -308,8 +387,7 @@ panfrost_bo_cache_evict_all(
 
                 list_for_each_entry_safe(struct panfrost_bo, entry, bucket,
                                          bucket_link) {
-                        list_del(&entry->bucket_link);
-                        list_del(&entry->lru_link);
+                        panfrost_bo_cache_remove(dev, entry);
                         panfrost_bo_free(entry);
                 }
         }
@@ -377,8 +455,11 @@ panfrost_bo_create(struct panfrost_device *dev, size_t size,
          * cache, but this time we accept to wait.
          */
         bo = panfrost_bo_cache_fetch(dev, size, flags, true);
-        if (!bo)
+        if (!bo) {
                 bo = panfrost_bo_alloc(dev, size, flags);
+                if (bo)
+                        p_atomic_inc(&dev->bo_cache.stats.fresh);
+        }
         if (!bo)
                 bo = panfrost_bo_cache_fetch(dev, size, flags, false);
 
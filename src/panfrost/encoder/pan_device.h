@@ -30,6 +30,7 @@
 #ifndef PAN_DEVICE_H
 #define PAN_DEVICE_H
 
+#include <time.h>
 #include <xf86drm.h>
 #include "renderonly/renderonly.h"
 #include "util/u_dynarray.h"
@@ -124,9 +125,32 @@ struct panfrost_device {
                  * Each bucket is a linked list of free panfrost_bo objects. */
 
                 struct list_head buckets[NR_BO_CACHE_BUCKETS];
+
+                /* Total size of the cached BOs, and the limit for it */
+                uint64_t size;
+                uint64_t max_size;
+
+                /* Empty the cache when less system memory than this is
+                 * available, checked at most once a second */
+                uint64_t low_memory_threshold;
+                time_t last_memory_check;
+
+                struct {
+                        uint64_t hits;    /* allocations served from the cache */
+                        uint64_t fresh;   /* allocations of a new GEM object */
+                        uint64_t purged;  /* cached BOs the kernel had purged */
+                        uint64_t evicted; /* cached BOs freed to stay in budget */
+                } stats;
         } bo_cache;
 
         struct pan_blit_shaders blit_shaders;
+
+        /* Tiler heap shared across all tiler jobs, allocated against the
+         * device since there's only a single tiler.  Being growable, its
+         * backing is populated on demand by the kernel, so sharing it avoids
+         * repaying for that on every frame.  Batches using it are serialized
+         * by the kernel's implicit BO fences. */
+        struct panfrost_bo *tiler_heap;
 };
 
 void
@@ -26,8 +26,13 @@
 
 #include <xf86drm.h>
 
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "util/debug.h"
 #include "util/u_math.h"
 #include "util/macros.h"
+#include "util/os_misc.h"
 #include "util/hash_table.h"
 #include "util/u_thread.h"
 #include "drm-uapi/panfrost_drm.h"
@@ -35,6 +40,7 @@
 #include "pan_device.h"
 #include "panfrost-quirks.h"
 #include "pan_bo.h"
+#include "pan_util.h"
 
 /* Abstraction over the raw drm_panfrost_get_param ioctl for fetching
  * information about devices */
@@ -172,12 +178,35 @@ panfrost_open_device(void *memctx, int fd, struct panfrost_device *dev)
 
         for (unsigned i = 0; i < ARRAY_SIZE(dev->bo_cache.buckets); ++i)
                 list_inithead(&dev->bo_cache.buckets[i]);
+
+        /* Cached BOs are unused memory, which hurts on small-memory systems.
+         * Keep them to a fraction of RAM unless told otherwise. */
+        uint64_t total_ram = 0;
+        os_get_total_physical_memory(&total_ram);
+        dev->bo_cache.max_size =
+                (uint64_t)env_var_as_unsigned("PAN_BO_CACHE_MB", 0) << 20;
+        if (dev->bo_cache.max_size == 0)
+                dev->bo_cache.max_size = total_ram ? total_ram / 16 : UINT64_MAX;
+        dev->bo_cache.low_memory_threshold = total_ram / 32;
+
+        dev->tiler_heap = panfrost_bo_create(dev, 4096 * 4096,
+                        PAN_BO_INVISIBLE | PAN_BO_GROWABLE);
 }
 
 void
 panfrost_close_device(struct panfrost_device *dev)
 {
         panfrost_bo_unreference(dev->blit_shaders.bo);
+        panfrost_bo_unreference(dev->tiler_heap);
+
+        if (dev->debug & PAN_DBG_MSGS) {
+                fprintf(stderr, "BO cache: %" PRIu64 " hits, %" PRIu64
+                        " fresh allocations, %" PRIu64 " purged, %" PRIu64
+                        " evicted\n",
+                        dev->bo_cache.stats.hits, dev->bo_cache.stats.fresh,
+                        dev->bo_cache.stats.purged, dev->bo_cache.stats.evicted);
+        }
+
         panfrost_bo_cache_evict_all(dev);
         pthread_mutex_destroy(&dev->bo_cache.lock);
         drmFreeVersion(dev->kernel_version);
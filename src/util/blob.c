@@ -36,6 +36,16 @@
 
 #define BLOB_INITIAL_SIZE 4096
 
+/* Buffers smaller than this are copied even by blob_write_bytes_ref */
+#define BLOB_REF_MIN_SIZE 1024
+
+/* Number of bytes in blob->data, i.e. not counting referenced buffers */
+static inline size_t
+blob_data_size(const struct blob *blob)
+{
+   return blob->size - blob->ref_size;
+}
+
 /* Ensure that \blob will be able to fit an additional object of size
  * \additional.  The growing (if any) will occur by doubling the existing
  * allocation.
@@ -49,7 +59,7 @@ grow_to_fit(struct blob *blob, size_t additional)
    if (blob->out_of_memory)
       return false;
 
-   if (blob->size + additional <= blob->allocated)
+   if (blob_data_size(blob) + additional <= blob->allocated)
       return true;
 
    if (blob->fixed_allocation) {
@@ -62,7 +72,7 @@ grow_to_fit(struct blob *blob, size_t additional)
    else
       to_allocate = blob->allocated * 2;
 
-   to_allocate = MAX2(to_allocate, blob->allocated + additional);
+   to_allocate = MAX2(to_allocate, blob_data_size(blob) + additional);
 
    new_data = realloc(blob->data, to_allocate);
    if (new_data == NULL) {
@@ -92,7 +102,7 @@ align_blob(struct blob *blob, size_t alignment)
          return false;
 
       if (blob->data)
-         memset(blob->data + blob->size, 0, new_size - blob->size);
+         memset(blob->data + blob_data_size(blob), 0, new_size - blob->size);
       blob->size = new_size;
    }
 
@@ -111,6 +121,10 @@ blob_init(struct blob *blob)
    blob->data = NULL;
    blob->allocated = 0;
    blob->size = 0;
+   blob->refs = NULL;
+   blob->num_refs = 0;
+   blob->refs_allocated = 0;
+   blob->ref_size = 0;
    blob->fixed_allocation = false;
    blob->out_of_memory = false;
 }
@@ -121,13 +135,74 @@ blob_init_fixed(struct blob *blob, void *data, size_t size)
    blob->data = data;
    blob->allocated = size;
    blob->size = 0;
+   blob->refs = NULL;
+   blob->num_refs = 0;
+   blob->refs_allocated = 0;
+   blob->ref_size = 0;
    blob->fixed_allocation = true;
    blob->out_of_memory = false;
 }
 
+bool
+blob_flatten(struct blob *blob)
+{
+   if (blob->num_refs == 0)
+      return true;
+
+   assert(!blob->fixed_allocation);
+
+   uint8_t *data = malloc(blob->size);
+   if (data == NULL) {
+      blob->out_of_memory = true;
+      return false;
+   }
+
+   /* Interleave the copied bytes with the referenced ones. */
+   size_t offset = 0, data_offset = 0;
+   for (unsigned i = 0; i < blob->num_refs; i++) {
+      const struct blob_ref *ref = &blob->refs[i];
+
+      if (ref->data_offset > data_offset) {
+         memcpy(data + offset, blob->data + data_offset,
+                ref->data_offset - data_offset);
+         offset += ref->data_offset - data_offset;
+         data_offset = ref->data_offset;
+      }
+
+      assert(offset == ref->offset);
+      memcpy(data + offset, ref->bytes, ref->size);
+      offset += ref->size;
+   }
+
+   if (blob_data_size(blob) > data_offset) {
+      memcpy(data + offset, blob->data + data_offset,
+             blob_data_size(blob) - data_offset);
+   }
+
+   free(blob->data);
+   free(blob->refs);
+   blob->data = data;
+   blob->allocated = blob->size;
+   blob->refs = NULL;
+   blob->num_refs = 0;
+   blob->refs_allocated = 0;
+   blob->ref_size = 0;
+
+   return true;
+}
+
 void
 blob_finish_get_buffer(struct blob *blob, void **buffer, size_t *size)
 {
+   if (!blob_flatten(blob)) {
+      blob_finish(blob);
+      *buffer = NULL;
+      *size = 0;
+      blob->data = NULL;
+      blob->refs = NULL;
+      return;
+   }
+
    *buffer = blob->data;
    *size = blob->size;
    blob->data = NULL;
@@ -148,8 +223,33 @@ blob_overwrite_bytes(struct blob *blob,
 
    VG(VALGRIND_CHECK_MEM_IS_DEFINED(bytes, to_write));
 
+   size_t data_offset = offset;
+   if (blob->num_refs > 0) {
+      /* Find the last reference before offset. */
+      unsigned lo = 0, hi = blob->num_refs;
+      while (lo < hi) {
+         unsigned mid = lo + (hi - lo) / 2;
+         if (blob->refs[mid].offset <= offset)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+
+      /* Referenced bytes can't be overwritten. */
+      if (lo < blob->num_refs && blob->refs[lo].offset < offset + to_write)
+         return false;
+
+      if (lo > 0) {
+         const struct blob_ref *ref = &blob->refs[lo - 1];
+         if (offset < ref->offset + ref->size)
+            return false;
+
+         data_offset = ref->data_offset + (offset - ref->offset - ref->size);
+      }
+   }
+
    if (blob->data)
-      memcpy(blob->data + offset, bytes, to_write);
+      memcpy(blob->data + data_offset, bytes, to_write);
 
    return true;
 }
@@ -163,8 +263,44 @@ blob_write_bytes(struct blob *blob, const void *bytes, size_t to_write)
    VG(VALGRIND_CHECK_MEM_IS_DEFINED(bytes, to_write));
 
    if (blob->data && to_write > 0)
-      memcpy(blob->data + blob->size, bytes, to_write);
+      memcpy(blob->data + blob_data_size(blob), bytes, to_write);
+   blob->size += to_write;
+
+   return true;
+}
+
+bool
+blob_write_bytes_ref(struct blob *blob, const void *bytes, size_t to_write)
+{
+   if (blob->fixed_allocation || to_write < BLOB_REF_MIN_SIZE)
+      return blob_write_bytes(blob, bytes, to_write);
+
+   if (blob->out_of_memory)
+      return false;
+
+   if (blob->num_refs == blob->refs_allocated) {
+      unsigned refs_allocated = MAX2(blob->refs_allocated * 2, 8);
+      struct blob_ref *refs =
+         realloc(blob->refs, refs_allocated * sizeof(*refs));
+      if (refs == NULL) {
+         blob->out_of_memory = true;
+         return false;
+      }
+
+      blob->refs = refs;
+      blob->refs_allocated = refs_allocated;
+   }
+
+   VG(VALGRIND_CHECK_MEM_IS_DEFINED(bytes, to_write));
+
+   blob->refs[blob->num_refs++] = (struct blob_ref) {
+      .offset = blob->size,
+      .data_offset = blob_data_size(blob),
+      .bytes = bytes,
+      .size = to_write,
+   };
    blob->size += to_write;
+   blob->ref_size += to_write;
 
    return true;
 }
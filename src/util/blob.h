@@ -46,8 +46,26 @@ extern "C" {
  * allocation costs are logarithmic.
  */
 
+/* A buffer that was written to a blob by reference, see blob_write_bytes_ref.
+ */
+struct blob_ref {
+   /** Offset of the referenced bytes in the blob. */
+   size_t offset;
+
+   /** Number of bytes of \c blob::data that precede the referenced bytes. */
+   size_t data_offset;
+
+   const void *bytes;
+   size_t size;
+};
+
 struct blob {
-   /* The data actually written to the blob. */
+   /* The data actually written to the blob.
+    *
+    * If the blob holds references (see blob_write_bytes_ref), this only
+    * contains the bytes that were copied into the blob, and blob_flatten()
+    * must be called before using it directly.
+    */
    uint8_t *data;
 
    /** Number of bytes that have been allocated for \c data. */
@@ -56,6 +74,14 @@ struct blob {
    /** The number of bytes that have actual data written to them. */
    size_t size;
 
+   /** Buffers written by reference, in the order they were written. */
+   struct blob_ref *refs;
+   unsigned num_refs;
+   unsigned refs_allocated;
+
+   /** Sum of the sizes of all \c refs. */
+   size_t ref_size;
+
    /** True if \c data a fixed allocation that we cannot resize
     *
     * \see blob_init_fixed
@@ -115,6 +141,7 @@ blob_finish(struct blob *blob)
 {
    if (!blob->fixed_allocation)
       free(blob->data);
+   free(blob->refs);
 }
 
 void
@@ -128,6 +155,32 @@ blob_finish_get_buffer(struct blob *blob, void **buffer, size_t *size);
 bool
 blob_write_bytes(struct blob *blob, const void *bytes, size_t to_write);
 
+/**
+ * Add a large buffer to a blob without copying it.
+ *
+ * The blob only records a pointer to \bytes, which must therefore remain
+ * valid and unchanged until the blob is flattened or finished.  The bytes
+ * are copied once, straight to their final location, by blob_flatten() or
+ * blob_finish_get_buffer().  This avoids copying them again every time the
+ * blob grows, which matters for things like shader binaries.
+ *
+ * Small buffers, and buffers written to a fixed-size blob (which never
+ * grows), are simply copied as by blob_write_bytes.
+ *
+ * \return True unless allocation failed.
+ */
+bool
+blob_write_bytes_ref(struct blob *blob, const void *bytes, size_t to_write);
+
+/**
+ * Copy the buffers written with blob_write_bytes_ref into the blob, so that
+ * \c blob->data holds all \c blob->size bytes written to it.
+ *
+ * \return True unless allocation failed.
+ */
+bool
+blob_flatten(struct blob *blob);
+
 /**
  * Reserve space in \blob for a number of bytes.
  *
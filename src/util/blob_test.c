@@ -316,6 +316,69 @@ test_big_objects(void)
    ralloc_free(ctx);
 }
 
+/* Test that buffers written by reference end up in the right place, between
+ * data that was copied and overwritten.
+ */
+static void
+test_refs(void)
+{
+   void *ctx = ralloc_context(NULL);
+   struct blob blob;
+   struct blob_reader reader;
+   int size = 5000;
+   int count = 10;
+   size_t i;
+   char *buf;
+   void *flat;
+   size_t flat_size;
+   intptr_t count_offset;
+   size_t ref_offset = 0;
+
+   blob_init(&blob);
+
+   buf = ralloc_size(ctx, size);
+   for (i = 0; i < size; i++) {
+      buf[i] = i % 251;
+   }
+
+   count_offset = blob_reserve_uint32(&blob);
+   for (i = 0; i < count; i++) {
+      blob_write_uint8(&blob, i);
+      /* Overwriting has to skip the referenced buffers written so far. */
+      blob_overwrite_uint32(&blob, blob_reserve_uint32(&blob), i);
+      if (i == 0)
+         ref_offset = blob.size;
+      blob_write_bytes_ref(&blob, buf, size);
+      blob_write_bytes_ref(&blob, buf, 3);
+   }
+   blob_overwrite_uint32(&blob, count_offset, count);
+
+   expect_equal(false, blob_overwrite_uint8(&blob, ref_offset + 1, 0),
+                "overwrite of a referenced buffer");
+
+   blob_finish_get_buffer(&blob, &flat, &flat_size);
+   blob_reader_init(&reader, flat, flat_size);
+
+   expect_equal(count, blob_read_uint32(&reader), "overwrite before refs");
+   for (i = 0; i < count; i++) {
+      expect_equal(i, blob_read_uint8(&reader), "uint8 between refs");
+      expect_equal(i, blob_read_uint32(&reader), "uint32 between refs");
+      expect_equal_bytes((uint8_t *) buf, blob_read_bytes(&reader, size), size,
+                         "read of referenced object");
+      expect_equal_bytes((uint8_t *) buf, blob_read_bytes(&reader, 3), 3,
+                         "read of small referenced object");
+   }
+
+   expect_equal(reader.end - reader.data, reader.current - reader.data,
+                "number of bytes read reading refs");
+
+   expect_equal(false, reader.overrun,
+                "overrun flag not set reading refs");
+
+   free(flat);
+   ralloc_free(ctx);
+}
+
 int
 main (void)
 {
@@ -323,6 +386,7 @@ main (void)
    test_alignment ();
    test_overrun ();
    test_big_objects ();
+   test_refs ();
 
    return error ? 1 : 0;
 }
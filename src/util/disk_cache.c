@@ -44,16 +44,25 @@
 #include "zstd.h"
 #endif
 
+#ifdef HAVE_LZ4
+#include "lz4.h"
+#endif
+
+#include "util/blob.h"
 #include "util/crc32.h"
 #include "util/debug.h"
+#include "util/hash_table.h"
+#include "util/list.h"
 #include "util/rand_xor.h"
 #include "util/u_atomic.h"
 #include "util/u_queue.h"
 #include "util/mesa-sha1.h"
 #include "util/ralloc.h"
+#include "util/simple_mtx.h"
 #include "util/compiler.h"
 
 #include "disk_cache.h"
+#include "disk_cache_db.h"
 
 /* Number of bits to mask off from a cache key to get an index. */
 #define CACHE_INDEX_KEY_BITS 16
@@ -76,7 +85,7 @@
  * - There is no strict requirement that cache versions be backwards
  *   compatible but effort should be taken to limit disruption where possible.
  */
-#define CACHE_VERSION 1
+#define CACHE_VERSION 2
 
 /* 3 is the recomended level, with 22 as the absolute maximum */
 #define ZSTD_COMPRESSION_LEVEL 3
@@ -86,6 +95,15 @@ struct disk_cache {
    char *path;
    bool path_init_failed;
 
+   enum disk_cache_type type;
+
+   /* enum cache_codec and level used by disk_cache_put(). */
+   uint32_t codec;
+   int codec_level;
+
+   /* Single file storage, (only for DISK_CACHE_SINGLE_FILE). */
+   struct disk_cache_db *db;
+
    /* Thread queue for compressing and writing cache entries to disk */
    struct util_queue cache_queue;
 
@@ -111,6 +129,21 @@ struct disk_cache {
 
    disk_cache_put_cb blob_put_cb;
    disk_cache_get_cb blob_get_cb;
+
+   /* In-memory tier in front of the disk, disabled if mem_max_size is 0. */
+   simple_mtx_t mem_mtx;
+   struct hash_table *mem_entries;
+   struct list_head mem_lru;
+   uint64_t mem_size;
+   uint64_t mem_max_size;
+   struct disk_cache_stats stats;
+};
+
+/* An item of the in-memory tier, followed by its data. */
+struct mem_cache_entry {
+   struct list_head link;
+   cache_key key;
+   size_t size;
 };
 
 struct disk_cache_put_job {
@@ -126,9 +159,277 @@ struct disk_cache_put_job {
    /* Size of data to be compressed and written. */
    size_t size;
 
+   /* enum cache_codec used to store the data, and its compression level. */
+   uint32_t codec;
+   int level;
+
    struct cache_item_metadata cache_item_metadata;
 };
 
+/* How the data of a cache entry is stored, recorded in each entry. */
+enum cache_codec {
+   CACHE_CODEC_NONE = 0,
+   CACHE_CODEC_ZLIB = 1,
+   CACHE_CODEC_ZSTD = 2,
+   CACHE_CODEC_LZ4 = 3,
+   CACHE_CODEC_COUNT,
+};
+
+static bool
+none_deflate(const void *in_data, size_t in_data_size, int level,
+             struct blob *out)
+{
+   return blob_write_bytes(out, in_data, in_data_size);
+}
+
+static bool
+none_inflate(const uint8_t *in_data, size_t in_data_size,
+             uint8_t *out_data, size_t out_data_size)
+{
+   if (in_data_size != out_data_size)
+      return false;
+
+   memcpy(out_data, in_data, in_data_size);
+   return true;
+}
+
+static bool
+zlib_deflate(const void *in_data, size_t in_data_size, int level,
+             struct blob *out)
+{
+   /* allocate deflate state */
+   z_stream strm;
+   strm.zalloc = Z_NULL;
+   strm.zfree = Z_NULL;
+   strm.opaque = Z_NULL;
+   strm.next_in = (uint8_t *) in_data;
+   strm.avail_in = in_data_size;
+
+   int ret = deflateInit(&strm, level);
+   if (ret != Z_OK)
+       return false;
+
+   /* With an output buffer of deflateBound() bytes everything is compressed
+    * with a single call.
+    */
+   size_t out_size = deflateBound(&strm, in_data_size);
+   intptr_t offset = blob_reserve_bytes(out, out_size);
+   if (offset < 0) {
+      (void)deflateEnd(&strm);
+      return false;
+   }
+
+   strm.next_out = out->data + offset;
+   strm.avail_out = out_size;
+
+   ret = deflate(&strm, Z_FINISH);
+   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+
+   /* clean up and return */
+   (void)deflateEnd(&strm);
+   if (ret != Z_STREAM_END)
+      return false;
+
+   /* Drop the unused part of the reservation. */
+   out->size = offset + (out_size - strm.avail_out);
+   return true;
+}
+
+static bool
+zlib_inflate(const uint8_t *in_data, size_t in_data_size,
+             uint8_t *out_data, size_t out_data_size)
+{
+   z_stream strm;
+
+   /* allocate inflate state */
+   strm.zalloc = Z_NULL;
+   strm.zfree = Z_NULL;
+   strm.opaque = Z_NULL;
+   strm.next_in = (uint8_t *) in_data;
+   strm.avail_in = in_data_size;
+   strm.next_out = out_data;
+   strm.avail_out = out_data_size;
+
+   int ret = inflateInit(&strm);
+   if (ret != Z_OK)
+      return false;
+
+   ret = inflate(&strm, Z_NO_FLUSH);
+   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+
+   /* Unless there was an error we should have decompressed everything in one
+    * go as we know the uncompressed file size.
+    */
+   if (ret != Z_STREAM_END) {
+      (void)inflateEnd(&strm);
+      return false;
+   }
+   assert(strm.avail_out == 0);
+
+   /* clean up and return */
+   (void)inflateEnd(&strm);
+   return true;
+}
+
+#ifdef HAVE_ZSTD
+static bool
+zstd_deflate(const void *in_data, size_t in_data_size, int level,
+             struct blob *out)
+{
+   /* from the zstd docs (https://facebook.github.io/zstd/zstd_manual.html):
+    * compression runs faster if `dstCapacity` >= `ZSTD_compressBound(srcSize)`.
+    */
+   size_t out_size = ZSTD_compressBound(in_data_size);
+   intptr_t offset = blob_reserve_bytes(out, out_size);
+   if (offset < 0)
+      return false;
+
+   size_t ret = ZSTD_compress(out->data + offset, out_size, in_data,
+                              in_data_size, level);
+   if (ZSTD_isError(ret))
+      return false;
+
+   /* Drop the unused part of the reservation. */
+   out->size = offset + ret;
+   return true;
+}
+
+static bool
+zstd_inflate(const uint8_t *in_data, size_t in_data_size,
+             uint8_t *out_data, size_t out_data_size)
+{
+   size_t ret = ZSTD_decompress(out_data, out_data_size, in_data, in_data_size);
+   return !ZSTD_isError(ret) && ret == out_data_size;
+}
+#endif
+
+#ifdef HAVE_LZ4
+static bool
+lz4_deflate(const void *in_data, size_t in_data_size, int level,
+            struct blob *out)
+{
+   if (in_data_size > LZ4_MAX_INPUT_SIZE)
+      return false;
+
+   int out_size = LZ4_compressBound(in_data_size);
+   intptr_t offset = blob_reserve_bytes(out, out_size);
+   if (offset < 0)
+      return false;
+
+   /* For LZ4 the level is the acceleration factor, 1 being the default. */
+   int ret = LZ4_compress_fast(in_data, (char *)out->data + offset,
+                               in_data_size, out_size, level);
+   if (ret <= 0)
+      return false;
+
+   /* Drop the unused part of the reservation. */
+   out->size = offset + ret;
+   return true;
+}
+
+static bool
+lz4_inflate(const uint8_t *in_data, size_t in_data_size,
+            uint8_t *out_data, size_t out_data_size)
+{
+   int ret = LZ4_decompress_safe((const char *)in_data, (char *)out_data,
+                                 in_data_size, out_data_size);
+   return ret >= 0 && ret == out_data_size;
+}
+#endif
+
+struct cache_codec_info {
+   bool (*deflate)(const void *in_data, size_t in_data_size, int level,
+                   struct blob *out);
+   bool (*inflate)(const uint8_t *in_data, size_t in_data_size,
+                   uint8_t *out_data, size_t out_data_size);
+};
+
+/* Entries for codecs this build lacks are left NULL, so entries written by
+ * builds that have them are treated as cache misses.
+ */
+static const struct cache_codec_info cache_codecs[CACHE_CODEC_COUNT] = {
+   [CACHE_CODEC_NONE] = { none_deflate, none_inflate },
+   [CACHE_CODEC_ZLIB] = { zlib_deflate, zlib_inflate },
+#ifdef HAVE_ZSTD
+   [CACHE_CODEC_ZSTD] = { zstd_deflate, zstd_inflate },
+#endif
+#ifdef HAVE_LZ4
+   [CACHE_CODEC_LZ4] = { lz4_deflate, lz4_inflate },
+#endif
+};
+
+/* The choices for MESA_DISK_CACHE_CODEC. */
+static const struct {
+   const char *name;
+   enum cache_codec codec;
+   int level;
+} cache_codec_options[] = {
+#ifdef HAVE_ZSTD
+   { "zstd", CACHE_CODEC_ZSTD, ZSTD_COMPRESSION_LEVEL },
+   { "zstd-fast", CACHE_CODEC_ZSTD, 1 },
+#endif
+   { "zlib", CACHE_CODEC_ZLIB, Z_BEST_COMPRESSION },
+   { "zlib-fast", CACHE_CODEC_ZLIB, Z_BEST_SPEED },
+#ifdef HAVE_LZ4
+   { "lz4", CACHE_CODEC_LZ4, 1 },
+#endif
+   { "none", CACHE_CODEC_NONE, 0 },
+};
+
+/* Pick the codec used by disk_cache_put(). The first option is the default,
+ * the best compressing codec available.
+ */
+static void
+select_cache_codec(struct disk_cache *cache)
+{
+   const char *name = getenv("MESA_DISK_CACHE_CODEC");
+   unsigned i;
+
+   for (i = 0; name && i < ARRAY_SIZE(cache_codec_options); i++) {
+      if (strcmp(name, cache_codec_options[i].name) == 0)
+         break;
+   }
+
+   if (!name || i == ARRAY_SIZE(cache_codec_options)) {
+      if (name) {
+         fprintf(stderr, "Mesa: MESA_DISK_CACHE_CODEC \"%s\" is not "
+                 "supported by this build, using \"%s\".\n", name,
+                 cache_codec_options[0].name);
+      }
+      i = 0;
+   }
+
+   cache->codec = cache_codec_options[i].codec;
+   cache->codec_level = cache_codec_options[i].level;
+}
+
+/**
+ * Compresses cache entry in memory and appends it to \p out. Returns false
+ * on failure.
+ */
+static bool
+deflate_cache_data(enum cache_codec codec, int level, const void *in_data,
+                   size_t in_data_size, struct blob *out)
+{
+   assert(codec < CACHE_CODEC_COUNT && cache_codecs[codec].deflate);
+   return cache_codecs[codec].deflate(in_data, in_data_size, level, out);
+}
+
+/**
+ * Decompresses cache entry, returns true if successful.
+ */
+static bool
+inflate_cache_data(uint32_t codec, const uint8_t *in_data, size_t in_data_size,
+                   uint8_t *out_data, size_t out_data_size)
+{
+   /* Written by a build with a codec we don't have. */
+   if (codec >= CACHE_CODEC_COUNT || !cache_codecs[codec].inflate)
+      return false;
+
+   return cache_codecs[codec].inflate(in_data, in_data_size,
+                                      out_data, out_data_size);
+}
+
 /* Create a directory named 'path' if it does not already exist.
  *
  * Returns: 0 if path already exists as a directory or if created.
@@ -189,6 +490,155 @@ concatenate_and_mkdir(void *ctx, const char *path, const char *name)
       return NULL;
 }
 
+/* Parse a size, in gigabytes unless followed by K, M or G, from the
+ * environment variable \p name. Returns 0 if unset or invalid.
+ */
+static uint64_t
+parse_size_env(const char *name)
+{
+   const char *str = getenv(name);
+   uint64_t size;
+   char *end;
+
+   if (!str)
+      return 0;
+
+   size = strtoul(str, &end, 10);
+   if (end == str)
+      return 0;
+
+   switch (*end) {
+   case 'K':
+   case 'k':
+      size *= 1024;
+      break;
+   case 'M':
+   case 'm':
+      size *= 1024*1024;
+      break;
+   case '\0':
+   case 'G':
+   case 'g':
+   default:
+      size *= 1024*1024*1024;
+      break;
+   }
+
+   return size;
+}
+
+static uint32_t
+mem_cache_key_hash(const void *key)
+{
+   /* The keys are SHA-1 hashes so any 32 bits of them are a good hash. */
+   uint32_t hash;
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+mem_cache_key_equals(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+static void
+mem_cache_evict(struct disk_cache *cache, struct mem_cache_entry *entry)
+{
+   _mesa_hash_table_remove_key(cache->mem_entries, entry->key);
+   list_del(&entry->link);
+   cache->mem_size -= entry->size;
+   free(entry);
+}
+
+/* Returns a malloc'ed copy of the item stored under \p key in the
+ * in-memory tier, or NULL.
+ */
+static void *
+mem_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   void *data = NULL;
+
+   if (!cache->mem_max_size)
+      return NULL;
+
+   simple_mtx_lock(&cache->mem_mtx);
+
+   struct hash_entry *he = _mesa_hash_table_search(cache->mem_entries, key);
+   if (he) {
+      struct mem_cache_entry *entry = he->data;
+
+      data = malloc(entry->size);
+      if (data) {
+         memcpy(data, entry + 1, entry->size);
+         if (size)
+            *size = entry->size;
+
+         /* Move to the most recently used end. */
+         list_del(&entry->link);
+         list_add(&entry->link, &cache->mem_lru);
+      }
+   }
+
+   if (data)
+      cache->stats.mem_hits++;
+   else
+      cache->stats.mem_misses++;
+
+   simple_mtx_unlock(&cache->mem_mtx);
+
+   return data;
+}
+
+static void
+mem_cache_put(struct disk_cache *cache, const cache_key key,
+              const void *data, size_t size)
+{
+   if (!cache->mem_max_size || size > cache->mem_max_size / 4)
+      return;
+
+   struct mem_cache_entry *entry = malloc(sizeof(*entry) + size);
+   if (!entry)
+      return;
+
+   memcpy(entry->key, key, CACHE_KEY_SIZE);
+   entry->size = size;
+   memcpy(entry + 1, data, size);
+
+   simple_mtx_lock(&cache->mem_mtx);
+
+   struct hash_entry *he = _mesa_hash_table_search(cache->mem_entries, key);
+   if (he)
+      mem_cache_evict(cache, he->data);
+
+   while (cache->mem_size + size > cache->mem_max_size) {
+      mem_cache_evict(cache, list_last_entry(&cache->mem_lru,
+                                             struct mem_cache_entry, link));
+      cache->stats.mem_evictions++;
+   }
+
+   _mesa_hash_table_insert(cache->mem_entries, entry->key, entry);
+   list_add(&entry->link, &cache->mem_lru);
+   cache->mem_size += size;
+
+   simple_mtx_unlock(&cache->mem_mtx);
+}
+
+static void
+mem_cache_remove(struct disk_cache *cache, const cache_key key)
+{
+   if (!cache->mem_max_size)
+      return;
+
+   simple_mtx_lock(&cache->mem_mtx);
+
+   struct hash_entry *he = _mesa_hash_table_search(cache->mem_entries, key);
+   if (he)
+      mem_cache_evict(cache, he->data);
+
+   simple_mtx_unlock(&cache->mem_mtx);
+}
+
 #define DRV_KEY_CPY(_dst, _src, _src_size) \
 do {                                       \
    memcpy(_dst, _src, _src_size);          \
@@ -196,12 +646,12 @@ do {                                       \
 } while (0);
 
 struct disk_cache *
-disk_cache_create(const char *gpu_name, const char *driver_id,
-                  uint64_t driver_flags)
+disk_cache_type_create(const char *gpu_name, const char *driver_id,
+                       uint64_t driver_flags, enum disk_cache_type type)
 {
    void *local;
    struct disk_cache *cache = NULL;
-   char *path, *max_size_str;
+   char *path;
    uint64_t max_size;
    int fd = -1;
    struct stat sb;
@@ -340,33 +790,7 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    cache->size = (uint64_t *) cache->index_mmap;
    cache->stored_keys = cache->index_mmap + sizeof(uint64_t);
 
-   max_size = 0;
-
-   max_size_str = getenv("MESA_GLSL_CACHE_MAX_SIZE");
-   if (max_size_str) {
-      char *end;
-      max_size = strtoul(max_size_str, &end, 10);
-      if (end == max_size_str) {
-         max_size = 0;
-      } else {
-         switch (*end) {
-         case 'K':
-         case 'k':
-            max_size *= 1024;
-            break;
-         case 'M':
-         case 'm':
-            max_size *= 1024*1024;
-            break;
-         case '\0':
-         case 'G':
-         case 'g':
-         default:
-            max_size *= 1024*1024*1024;
-            break;
-         }
-      }
-   }
+   max_size = parse_size_env("MESA_GLSL_CACHE_MAX_SIZE");
 
    /* Default to 1GB for maximum cache size. */
    if (max_size == 0) {
@@ -375,6 +799,31 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
 
    cache->max_size = max_size;
 
+   /* The in-memory tier is off unless a size is given. Keep it small
+    * relative to the size of the disk cache.
+    */
+   cache->mem_max_size = MIN2(parse_size_env("MESA_DISK_CACHE_MEMORY_SIZE"),
+                              max_size);
+   if (cache->mem_max_size) {
+      cache->mem_entries = _mesa_hash_table_create(cache, mem_cache_key_hash,
+                                                   mem_cache_key_equals);
+      if (!cache->mem_entries)
+         cache->mem_max_size = 0;
+   }
+   simple_mtx_init(&cache->mem_mtx, mtx_plain);
+   list_inithead(&cache->mem_lru);
+
+   cache->type = type;
+
+   select_cache_codec(cache);
+   if (type == DISK_CACHE_SINGLE_FILE) {
+      cache->db = disk_cache_db_open(cache, cache->path, max_size);
+      if (cache->db == NULL) {
+         munmap(cache->index_mmap, cache->index_mmap_size);
+         goto path_fail;
+      }
+   }
+
    /* 4 threads were chosen below because just about all modern CPUs currently
     * available that run Mesa have *at least* 4 cores. For these CPUs allowing
     * more threads can result in the queue being processed faster, thus
@@ -384,11 +833,15 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
     *
     * The queue will resize automatically when it's full, so adding new jobs
     * doesn't stall.
+    *
+    * The jobs run on the shared executor, so several caches (e.g. one per
+    * screen) don't each add 4 threads of their own.
     */
    util_queue_init(&cache->cache_queue, "disk$", 32, 4,
                    UTIL_QUEUE_INIT_RESIZE_IF_FULL |
                    UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY |
-                   UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY);
+                   UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY |
+                   UTIL_QUEUE_INIT_SHARED_EXECUTOR);
 
    cache->path_init_failed = false;
 
@@ -442,6 +895,18 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    return NULL;
 }
 
+struct disk_cache *
+disk_cache_create(const char *gpu_name, const char *driver_id,
+                  uint64_t driver_flags)
+{
+   enum disk_cache_type type = DISK_CACHE_MULTI_FILE;
+
+   if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false))
+      type = DISK_CACHE_SINGLE_FILE;
+
+   return disk_cache_type_create(gpu_name, driver_id, driver_flags, type);
+}
+
 void
 disk_cache_destroy(struct disk_cache *cache)
 {
@@ -449,6 +914,12 @@ disk_cache_destroy(struct disk_cache *cache)
       util_queue_finish(&cache->cache_queue);
       util_queue_destroy(&cache->cache_queue);
       munmap(cache->index_mmap, cache->index_mmap_size);
+      disk_cache_db_close(cache->db);
+
+      list_for_each_entry_safe(struct mem_cache_entry, entry,
+                               &cache->mem_lru, link)
+         free(entry);
+      simple_mtx_destroy(&cache->mem_mtx);
    }
 
    ralloc_free(cache);
@@ -460,11 +931,25 @@ disk_cache_wait_for_idle(struct disk_cache *cache)
    util_queue_finish(&cache->cache_queue);
 }
 
-/* Return a filename within the cache's directory corresponding to 'key'. The
- * returned filename is ralloced with 'cache' as the parent context.
- *
- * Returns NULL if out of memory.
- */
+void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+
+   if (cache->path_init_failed)
+      return;
+
+   simple_mtx_lock(&cache->mem_mtx);
+   *stats = cache->stats;
+   stats->mem_size = cache->mem_size;
+   simple_mtx_unlock(&cache->mem_mtx);
+}
+
+/* Return a filename within the cache's directory corresponding to 'key'. The
+ * returned filename is ralloced with 'cache' as the parent context.
+ *
+ * Returns NULL if out of memory.
+ */
 static char *
 get_cache_file(struct disk_cache *cache, const cache_key key)
 {
@@ -689,6 +1174,13 @@ disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
    struct stat sb;
 
+   mem_cache_remove(cache, key);
+
+   if (cache->db) {
+      disk_cache_db_remove(cache->db, key);
+      return;
+   }
+
    char *filename = get_cache_file(cache, key);
    if (filename == NULL) {
       return;
@@ -736,108 +1228,11 @@ write_all(int fd, const void *buf, size_t count)
    return done;
 }
 
-/* From the zlib docs:
- *    "If the memory is available, buffers sizes on the order of 128K or 256K
- *    bytes should be used."
- */
-#define BUFSIZE 256 * 1024
-
-/**
- * Compresses cache entry in memory and writes it to disk. Returns the size
- * of the data written to disk.
- */
-static size_t
-deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
-                          const char *filename)
-{
-#ifdef HAVE_ZSTD
-   /* from the zstd docs (https://facebook.github.io/zstd/zstd_manual.html):
-    * compression runs faster if `dstCapacity` >= `ZSTD_compressBound(srcSize)`.
-    */
-   size_t out_size = ZSTD_compressBound(in_data_size);
-   void * out = malloc(out_size);
-
-   size_t ret = ZSTD_compress(out, out_size, in_data, in_data_size,
-                              ZSTD_COMPRESSION_LEVEL);
-   if (ZSTD_isError(ret)) {
-      free(out);
-      return 0;
-   }
-   ssize_t written = write_all(dest, out, ret);
-   if (written == -1) {
-      free(out);
-      return 0;
-   }
-   free(out);
-   return ret;
-#else
-   unsigned char *out;
-
-   /* allocate deflate state */
-   z_stream strm;
-   strm.zalloc = Z_NULL;
-   strm.zfree = Z_NULL;
-   strm.opaque = Z_NULL;
-   strm.next_in = (uint8_t *) in_data;
-   strm.avail_in = in_data_size;
-
-   int ret = deflateInit(&strm, Z_BEST_COMPRESSION);
-   if (ret != Z_OK)
-       return 0;
-
-   /* compress until end of in_data */
-   size_t compressed_size = 0;
-   int flush;
-
-   out = malloc(BUFSIZE * sizeof(unsigned char));
-   if (out == NULL)
-      return 0;
-
-   do {
-      int remaining = in_data_size - BUFSIZE;
-      flush = remaining > 0 ? Z_NO_FLUSH : Z_FINISH;
-      in_data_size -= BUFSIZE;
-
-      /* Run deflate() on input until the output buffer is not full (which
-       * means there is no more data to deflate).
-       */
-      do {
-         strm.avail_out = BUFSIZE;
-         strm.next_out = out;
-
-         ret = deflate(&strm, flush);    /* no bad return value */
-         assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-
-         size_t have = BUFSIZE - strm.avail_out;
-         compressed_size += have;
-
-         ssize_t written = write_all(dest, out, have);
-         if (written == -1) {
-            (void)deflateEnd(&strm);
-            free(out);
-            return 0;
-         }
-      } while (strm.avail_out == 0);
-
-      /* all input should be used */
-      assert(strm.avail_in == 0);
-
-   } while (flush != Z_FINISH);
-
-   /* stream should be complete */
-   assert(ret == Z_STREAM_END);
-
-   /* clean up and return */
-   (void)deflateEnd(&strm);
-   free(out);
-   return compressed_size;
-# endif
-}
-
 static struct disk_cache_put_job *
 create_put_job(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
-               struct cache_item_metadata *cache_item_metadata)
+               struct cache_item_metadata *cache_item_metadata,
+               uint32_t codec)
 {
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *)
       malloc(sizeof(struct disk_cache_put_job) + size);
@@ -848,6 +1243,8 @@ create_put_job(struct disk_cache *cache, const cache_key key,
       dc_job->data = dc_job + 1;
       memcpy(dc_job->data, data, size);
       dc_job->size = size;
+      dc_job->codec = codec;
+      dc_job->level = codec == cache->codec ? cache->codec_level : 0;
 
       /* Copy the cache item metadata */
       if (cache_item_metadata) {
@@ -893,8 +1290,57 @@ destroy_put_job(void *job, int thread_index)
 struct cache_entry_file_data {
    uint32_t crc32;
    uint32_t uncompressed_size;
+   uint32_t codec;
 };
 
+/* Serialize a cache item, (as it is stored on disk), into \p cache_blob. */
+static bool
+create_cache_item_blob(struct disk_cache_put_job *dc_job,
+                       struct blob *cache_blob)
+{
+   /* Write the driver_keys_blob, this can be used find information about the
+    * mesa version that produced the entry or deal with hash collisions,
+    * should that ever become a real problem.
+    */
+   if (!blob_write_bytes(cache_blob, dc_job->cache->driver_keys_blob,
+                         dc_job->cache->driver_keys_blob_size))
+      return false;
+
+   /* Write the cache item metadata. This data can be used to deal with
+    * hash collisions, as well as providing useful information to 3rd party
+    * tools reading the cache files.
+    */
+   if (!blob_write_bytes(cache_blob, &dc_job->cache_item_metadata.type,
+                         sizeof(uint32_t)))
+      return false;
+
+   if (dc_job->cache_item_metadata.type == CACHE_ITEM_TYPE_GLSL) {
+      if (!blob_write_bytes(cache_blob, &dc_job->cache_item_metadata.num_keys,
+                            sizeof(uint32_t)))
+         return false;
+
+      if (!blob_write_bytes(cache_blob, dc_job->cache_item_metadata.keys[0],
+                            dc_job->cache_item_metadata.num_keys *
+                            sizeof(cache_key)))
+         return false;
+   }
+
+   /* Create CRC of the data. We will read this when restoring the cache and
+    * use it to check for corruption.
+    */
+   struct cache_entry_file_data cf_data;
+   cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
+   cf_data.uncompressed_size = dc_job->size;
+   cf_data.codec = dc_job->codec;
+
+   if (!blob_write_bytes(cache_blob, &cf_data, sizeof(cf_data)))
+      return false;
+
+   /* Finally, the compressed contents. */
+   return deflate_cache_data(dc_job->codec, dc_job->level, dc_job->data,
+                             dc_job->size, cache_blob);
+}
+
 static void
 cache_put(void *job, int thread_index)
 {
@@ -904,6 +1350,9 @@ cache_put(void *job, int thread_index)
    unsigned i = 0;
    char *filename = NULL, *filename_tmp = NULL;
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
+   struct blob cache_blob;
+
+   blob_init(&cache_blob);
 
    filename = get_cache_file(dc_job->cache, dc_job->key);
    if (filename == NULL)
@@ -972,56 +1421,7 @@ cache_put(void *job, int thread_index)
     * not in the cache, and is also not being written out to the cache
     * by some other process.
     */
-
-   /* Write the driver_keys_blob, this can be used find information about the
-    * mesa version that produced the entry or deal with hash collisions,
-    * should that ever become a real problem.
-    */
-   ret = write_all(fd, dc_job->cache->driver_keys_blob,
-                   dc_job->cache->driver_keys_blob_size);
-   if (ret == -1) {
-      unlink(filename_tmp);
-      goto done;
-   }
-
-   /* Write the cache item metadata. This data can be used to deal with
-    * hash collisions, as well as providing useful information to 3rd party
-    * tools reading the cache files.
-    */
-   ret = write_all(fd, &dc_job->cache_item_metadata.type,
-                   sizeof(uint32_t));
-   if (ret == -1) {
-      unlink(filename_tmp);
-      goto done;
-   }
-
-   if (dc_job->cache_item_metadata.type == CACHE_ITEM_TYPE_GLSL) {
-      ret = write_all(fd, &dc_job->cache_item_metadata.num_keys,
-                      sizeof(uint32_t));
-      if (ret == -1) {
-         unlink(filename_tmp);
-         goto done;
-      }
-
-      ret = write_all(fd, dc_job->cache_item_metadata.keys[0],
-                      dc_job->cache_item_metadata.num_keys *
-                      sizeof(cache_key));
-      if (ret == -1) {
-         unlink(filename_tmp);
-         goto done;
-      }
-   }
-
-   /* Create CRC of the data. We will read this when restoring the cache and
-    * use it to check for corruption.
-    */
-   struct cache_entry_file_data cf_data;
-   cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
-   cf_data.uncompressed_size = dc_job->size;
-
-   size_t cf_data_size = sizeof(cf_data);
-   ret = write_all(fd, &cf_data, cf_data_size);
-   if (ret == -1) {
+   if (!create_cache_item_blob(dc_job, &cache_blob)) {
       unlink(filename_tmp);
       goto done;
    }
@@ -1030,9 +1430,8 @@ cache_put(void *job, int thread_index)
     * rename them atomically to the destination filename, and also
     * perform an atomic increment of the total cache size.
     */
-   size_t file_size = deflate_and_write_to_disk(dc_job->data, dc_job->size,
-                                                fd, filename_tmp);
-   if (file_size == 0) {
+   ret = write_all(fd, cache_blob.data, cache_blob.size);
+   if (ret == -1) {
       unlink(filename_tmp);
       goto done;
    }
@@ -1061,12 +1460,32 @@ cache_put(void *job, int thread_index)
       close(fd);
    free(filename_tmp);
    free(filename);
+   blob_finish(&cache_blob);
 }
 
-void
-disk_cache_put(struct disk_cache *cache, const cache_key key,
+static void
+cache_put_db(void *job, int thread_index)
+{
+   assert(job);
+
+   struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
+   struct blob cache_blob;
+
+   blob_init(&cache_blob);
+
+   if (create_cache_item_blob(dc_job, &cache_blob)) {
+      disk_cache_db_put(dc_job->cache->db, dc_job->key, cache_blob.data,
+                        cache_blob.size);
+   }
+
+   blob_finish(&cache_blob);
+}
+
+static void
+put_with_codec(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
-               struct cache_item_metadata *cache_item_metadata)
+               struct cache_item_metadata *cache_item_metadata,
+               uint32_t codec)
 {
    if (cache->blob_put_cb) {
       cache->blob_put_cb(key, CACHE_KEY_SIZE, data, size);
@@ -1076,58 +1495,138 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    if (cache->path_init_failed)
       return;
 
+   /* Make the item available right away, the write happens in the
+    * background.
+    */
+   mem_cache_put(cache, key, data, size);
+
    struct disk_cache_put_job *dc_job =
-      create_put_job(cache, key, data, size, cache_item_metadata);
+      create_put_job(cache, key, data, size, cache_item_metadata, codec);
 
    if (dc_job) {
       util_queue_fence_init(&dc_job->fence);
       util_queue_add_job(&cache->cache_queue, dc_job, &dc_job->fence,
-                         cache_put, destroy_put_job, dc_job->size);
+                         cache->db ? cache_put_db : cache_put,
+                         destroy_put_job, dc_job->size);
    }
 }
 
+void
+disk_cache_put(struct disk_cache *cache, const cache_key key,
+               const void *data, size_t size,
+               struct cache_item_metadata *cache_item_metadata)
+{
+   put_with_codec(cache, key, data, size, cache_item_metadata, cache->codec);
+}
+
+void
+disk_cache_put_uncompressed(struct disk_cache *cache, const cache_key key,
+                            const void *data, size_t size,
+                            struct cache_item_metadata *cache_item_metadata)
+{
+   put_with_codec(cache, key, data, size, cache_item_metadata,
+                  CACHE_CODEC_NONE);
+}
+
 /**
- * Decompresses cache entry, returns true if successful.
+ * Validate the header of a cache item, (as written by create_cache_item_blob),
+ * and locate the, possibly compressed, data that follows it.
  */
 static bool
-inflate_cache_data(uint8_t *in_data, size_t in_data_size,
-                   uint8_t *out_data, size_t out_data_size)
+parse_cache_item_header(struct disk_cache *cache, const void *cache_item,
+                        size_t cache_item_size,
+                        struct cache_entry_file_data *cf_data,
+                        const uint8_t **data, size_t *data_size)
 {
-#ifdef HAVE_ZSTD
-   size_t ret = ZSTD_decompress(out_data, out_data_size, in_data, in_data_size);
-   return !ZSTD_isError(ret);
-#else
-   z_stream strm;
+   struct blob_reader ci_blob_reader;
 
-   /* allocate inflate state */
-   strm.zalloc = Z_NULL;
-   strm.zfree = Z_NULL;
-   strm.opaque = Z_NULL;
-   strm.next_in = in_data;
-   strm.avail_in = in_data_size;
-   strm.next_out = out_data;
-   strm.avail_out = out_data_size;
+   blob_reader_init(&ci_blob_reader, cache_item, cache_item_size);
 
-   int ret = inflateInit(&strm);
-   if (ret != Z_OK)
+   size_t ck_size = cache->driver_keys_blob_size;
+   const void *keys_blob = blob_read_bytes(&ci_blob_reader, ck_size);
+   if (ci_blob_reader.overrun)
       return false;
 
-   ret = inflate(&strm, Z_NO_FLUSH);
-   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+   /* Check for extremely unlikely hash collisions */
+   if (memcmp(cache->driver_keys_blob, keys_blob, ck_size) != 0) {
+      assert(!"Mesa cache keys mismatch!");
+      return false;
+   }
 
-   /* Unless there was an error we should have decompressed everything in one
-    * go as we know the uncompressed file size.
-    */
-   if (ret != Z_STREAM_END) {
-      (void)inflateEnd(&strm);
+   uint32_t md_type;
+   blob_copy_bytes(&ci_blob_reader, &md_type, sizeof(uint32_t));
+   if (ci_blob_reader.overrun)
       return false;
+
+   if (md_type == CACHE_ITEM_TYPE_GLSL) {
+      uint32_t num_keys;
+      blob_copy_bytes(&ci_blob_reader, &num_keys, sizeof(uint32_t));
+      if (ci_blob_reader.overrun)
+         return false;
+
+      /* The cache item metadata is currently just used for distributing
+       * precompiled shaders, they are not used by Mesa so just skip them for
+       * now.
+       * TODO: pass the metadata back to the caller and do some basic
+       * validation.
+       */
+      blob_skip_bytes(&ci_blob_reader, num_keys * sizeof(cache_key));
+      if (ci_blob_reader.overrun)
+         return false;
    }
-   assert(strm.avail_out == 0);
 
-   /* clean up and return */
-   (void)inflateEnd(&strm);
+   /* Load the CRC that was created when the file was written. */
+   blob_copy_bytes(&ci_blob_reader, cf_data, sizeof(*cf_data));
+   if (ci_blob_reader.overrun)
+      return false;
+
+   /* The rest is the actual cache data. */
+   *data = ci_blob_reader.current;
+   *data_size = ci_blob_reader.end - ci_blob_reader.current;
+
    return true;
-#endif
+}
+
+/**
+ * Validate a cache item, (as written by create_cache_item_blob), and return
+ * its uncompressed contents. The returned data is malloc'ed.
+ */
+static void *
+parse_and_validate_cache_item(struct disk_cache *cache, const void *cache_item,
+                              size_t cache_item_size, size_t *size)
+{
+   struct cache_entry_file_data cf_data;
+   uint8_t *uncompressed_data;
+   const uint8_t *data;
+   size_t data_size;
+
+   if (!parse_cache_item_header(cache, cache_item, cache_item_size, &cf_data,
+                                &data, &data_size))
+      return NULL;
+
+   /* Uncompress the cache data */
+   uncompressed_data = malloc(cf_data.uncompressed_size);
+   if (!uncompressed_data)
+      return NULL;
+
+   if (!inflate_cache_data(cf_data.codec, data, data_size, uncompressed_data,
+                           cf_data.uncompressed_size))
+      goto fail;
+
+   /* Check the data for corruption */
+   if (cf_data.crc32 != util_hash_crc32(uncompressed_data,
+                                        cf_data.uncompressed_size))
+      goto fail;
+
+   if (size)
+      *size = cf_data.uncompressed_size;
+
+   return uncompressed_data;
+
+ fail:
+   free(uncompressed_data);
+
+   return NULL;
 }
 
 void *
@@ -1138,7 +1637,6 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    char *filename = NULL;
    uint8_t *data = NULL;
    uint8_t *uncompressed_data = NULL;
-   uint8_t *file_header = NULL;
 
    if (size)
       *size = 0;
@@ -1165,6 +1663,35 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
       return blob;
    }
 
+   if (cache->path_init_failed)
+      return NULL;
+
+   uncompressed_data = mem_cache_get(cache, key, size);
+   if (uncompressed_data)
+      return uncompressed_data;
+
+   if (cache->db) {
+      size_t db_size;
+
+      data = disk_cache_db_get(cache->db, key, &db_size);
+      if (data == NULL)
+         return NULL;
+
+      size_t uncompressed_size;
+      uncompressed_data =
+         parse_and_validate_cache_item(cache, data, db_size,
+                                       &uncompressed_size);
+      free(data);
+
+      if (uncompressed_data) {
+         mem_cache_put(cache, key, uncompressed_data, uncompressed_size);
+         if (size)
+            *size = uncompressed_size;
+      }
+
+      return uncompressed_data;
+   }
+
    filename = get_cache_file(cache, key);
    if (filename == NULL)
       goto fail;
@@ -1180,97 +1707,243 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    if (data == NULL)
       goto fail;
 
-   size_t ck_size = cache->driver_keys_blob_size;
-   file_header = malloc(ck_size);
-   if (!file_header)
+   /* Read in the whole item and parse it from memory. */
+   ret = read_all(fd, data, sb.st_size);
+   if (ret == -1)
       goto fail;
 
-   if (sb.st_size < ck_size)
-      goto fail;
+   size_t uncompressed_size;
+   uncompressed_data =
+      parse_and_validate_cache_item(cache, data, sb.st_size,
+                                    &uncompressed_size);
+   if (uncompressed_data) {
+      mem_cache_put(cache, key, uncompressed_data, uncompressed_size);
+      if (size)
+         *size = uncompressed_size;
+   }
 
-   ret = read_all(fd, file_header, ck_size);
-   if (ret == -1)
-      goto fail;
+ fail:
+   if (data)
+      free(data);
+   if (filename)
+      free(filename);
+   if (fd != -1)
+      close(fd);
 
-   /* Check for extremely unlikely hash collisions */
-   if (memcmp(cache->driver_keys_blob, file_header, ck_size) != 0) {
-      assert(!"Mesa cache keys mismatch!");
-      goto fail;
+   return uncompressed_data;
+}
+
+struct disk_cache_get_job {
+   struct util_queue_fence fence;
+   struct disk_cache *cache;
+   const uint8_t *key;
+   unsigned index;
+   disk_cache_get_batch_cb callback;
+   void *callback_data;
+};
+
+static void
+cache_get_job(void *job, int thread_index)
+{
+   struct disk_cache_get_job *dc_job = (struct disk_cache_get_job *) job;
+   size_t size = 0;
+
+   void *data = disk_cache_get(dc_job->cache, dc_job->key, &size);
+   dc_job->callback(dc_job->callback_data, dc_job->index, data, size);
+}
+
+void
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys, disk_cache_get_batch_cb callback,
+                     void *callback_data)
+{
+   struct disk_cache_get_job *jobs = NULL;
+
+   /* The callbacks don't need to wait for I/O, so only use the queue when
+    * there is I/O to overlap.
+    */
+   if (num_keys > 1 && !cache->path_init_failed && !cache->blob_get_cb)
+      jobs = calloc(num_keys, sizeof(*jobs));
+
+   if (!jobs) {
+      for (unsigned i = 0; i < num_keys; i++) {
+         size_t size = 0;
+         void *data = disk_cache_get(cache, keys[i], &size);
+         callback(callback_data, i, data, size);
+      }
+      return;
    }
 
-   size_t cache_item_md_size = sizeof(uint32_t);
-   uint32_t md_type;
-   ret = read_all(fd, &md_type, cache_item_md_size);
-   if (ret == -1)
-      goto fail;
+   for (unsigned i = 1; i < num_keys; i++) {
+      struct disk_cache_get_job *dc_job = &jobs[i];
 
-   if (md_type == CACHE_ITEM_TYPE_GLSL) {
-      uint32_t num_keys;
-      cache_item_md_size += sizeof(uint32_t);
-      ret = read_all(fd, &num_keys, sizeof(uint32_t));
-      if (ret == -1)
-         goto fail;
+      dc_job->cache = cache;
+      dc_job->key = keys[i];
+      dc_job->index = i;
+      dc_job->callback = callback;
+      dc_job->callback_data = callback_data;
 
-      /* The cache item metadata is currently just used for distributing
-       * precompiled shaders, they are not used by Mesa so just skip them for
-       * now.
-       * TODO: pass the metadata back to the caller and do some basic
-       * validation.
-       */
-      cache_item_md_size += num_keys * sizeof(cache_key);
-      ret = lseek(fd, num_keys * sizeof(cache_key), SEEK_CUR);
-      if (ret == -1)
-         goto fail;
+      util_queue_fence_init(&dc_job->fence);
+      util_queue_add_job(&cache->cache_queue, dc_job, &dc_job->fence,
+                         cache_get_job, NULL, 0);
    }
 
-   /* Load the CRC that was created when the file was written. */
+   /* The queue threads may be busy writing entries, so do some of the work
+    * on this thread rather than just waiting.
+    */
+   jobs[0].cache = cache;
+   jobs[0].key = keys[0];
+   jobs[0].index = 0;
+   jobs[0].callback = callback;
+   jobs[0].callback_data = callback_data;
+   cache_get_job(&jobs[0], -1);
+
+   for (unsigned i = 1; i < num_keys; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+
+   free(jobs);
+}
+
+static void
+release_malloced_entry(struct disk_cache_entry *entry)
+{
+   free(entry->release_data);
+}
+
+static void
+release_mapped_entry(struct disk_cache_entry *entry)
+{
+   munmap(entry->release_data, entry->release_size);
+}
+
+/* Fill \p entry from a mapped cache item, keeping the mapping around if the
+ * data was stored uncompressed. Takes ownership of the mapping.
+ */
+static bool
+entry_from_mapped_item(struct disk_cache *cache, struct disk_cache_entry *entry,
+                       void *map, size_t map_size,
+                       const void *cache_item, size_t cache_item_size)
+{
    struct cache_entry_file_data cf_data;
-   size_t cf_data_size = sizeof(cf_data);
-   ret = read_all(fd, &cf_data, cf_data_size);
-   if (ret == -1)
-      goto fail;
+   const uint8_t *data;
+   size_t data_size;
 
-   /* Load the actual cache data. */
-   size_t cache_data_size =
-      sb.st_size - cf_data_size - ck_size - cache_item_md_size;
-   ret = read_all(fd, data, cache_data_size);
-   if (ret == -1)
+   if (!parse_cache_item_header(cache, cache_item, cache_item_size, &cf_data,
+                                &data, &data_size))
       goto fail;
 
-   /* Uncompress the cache data */
-   uncompressed_data = malloc(cf_data.uncompressed_size);
-   if (!inflate_cache_data(data, cache_data_size, uncompressed_data,
-                           cf_data.uncompressed_size))
-      goto fail;
+   if (cf_data.codec == CACHE_CODEC_NONE) {
+      if (data_size != cf_data.uncompressed_size ||
+          cf_data.crc32 != util_hash_crc32(data, data_size))
+         goto fail;
 
-   /* Check the data for corruption */
-   if (cf_data.crc32 != util_hash_crc32(uncompressed_data,
-                                        cf_data.uncompressed_size))
-      goto fail;
+      entry->data = data;
+      entry->size = data_size;
+      entry->release = release_mapped_entry;
+      entry->release_data = map;
+      entry->release_size = map_size;
+      return true;
+   }
+
+   void *uncompressed_data =
+      parse_and_validate_cache_item(cache, cache_item, cache_item_size,
+                                    &entry->size);
+   munmap(map, map_size);
+   if (!uncompressed_data)
+      return false;
+
+   entry->data = uncompressed_data;
+   entry->release = release_malloced_entry;
+   entry->release_data = uncompressed_data;
+   return true;
+
+ fail:
+   munmap(map, map_size);
+   return false;
+}
+
+bool
+disk_cache_get_entry(struct disk_cache *cache, const cache_key key,
+                     struct disk_cache_entry *entry)
+{
+   memset(entry, 0, sizeof(*entry));
+
+   /* Items of the in-memory tier are always handed out as copies. */
+   void *data = mem_cache_get(cache, key, &entry->size);
+   if (data) {
+      entry->data = data;
+      entry->release = release_malloced_entry;
+      entry->release_data = data;
+      return true;
+   }
+
+   if (cache->path_init_failed || cache->blob_get_cb) {
+      data = disk_cache_get(cache, key, &entry->size);
+      if (!data)
+         return false;
+
+      entry->data = data;
+      entry->release = release_malloced_entry;
+      entry->release_data = data;
+      return true;
+   }
+
+   if (cache->db) {
+      void *map, *item;
+      size_t map_size, item_size;
 
-   free(data);
+      if (!disk_cache_db_map(cache->db, key, &map, &map_size,
+                             &item, &item_size))
+         return false;
+
+      if (!entry_from_mapped_item(cache, entry, map, map_size,
+                                  item, item_size))
+         return false;
+
+      mem_cache_put(cache, key, entry->data, entry->size);
+      return true;
+   }
+
+   char *filename = get_cache_file(cache, key);
+   if (filename == NULL)
+      return false;
+
+   int fd = open(filename, O_RDONLY | O_CLOEXEC);
    free(filename);
-   free(file_header);
+   if (fd == -1)
+      return false;
+
+   struct stat sb;
+   if (fstat(fd, &sb) == -1 || sb.st_size == 0) {
+      close(fd);
+      return false;
+   }
+
+   /* Cache files are never modified in place, so the mapping stays valid
+    * even if the file is evicted while it is in use.
+    */
+   void *map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
    close(fd);
+   if (map == MAP_FAILED)
+      return false;
 
-   if (size)
-      *size = cf_data.uncompressed_size;
+   if (!entry_from_mapped_item(cache, entry, map, sb.st_size,
+                               map, sb.st_size))
+      return false;
 
-   return uncompressed_data;
+   mem_cache_put(cache, key, entry->data, entry->size);
+   return true;
+}
 
- fail:
-   if (data)
-      free(data);
-   if (uncompressed_data)
-      free(uncompressed_data);
-   if (filename)
-      free(filename);
-   if (file_header)
-      free(file_header);
-   if (fd != -1)
-      close(fd);
+void
+disk_cache_entry_release(struct disk_cache_entry *entry)
+{
+   if (entry->release)
+      entry->release(entry);
 
-   return NULL;
+   entry->release = NULL;
 }
 
 void
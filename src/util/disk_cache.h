@@ -32,6 +32,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <sys/stat.h>
 #include "util/mesa-sha1.h"
 
@@ -46,6 +47,13 @@ extern "C" {
 
 typedef uint8_t cache_key[CACHE_KEY_SIZE];
 
+enum disk_cache_type {
+   /* One file per cache item, in two-character subdirectories. */
+   DISK_CACHE_MULTI_FILE,
+   /* All cache items in one data file with a memory-mapped index. */
+   DISK_CACHE_SINGLE_FILE,
+};
+
 /* WARNING: 3rd party applications might be reading the cache item metadata.
  * Do not change these values without making the change widely known.
  * Please contact Valve developers and make them aware of this change.
@@ -61,6 +69,13 @@ typedef signed long
 (*disk_cache_get_cb) (const void *key, signed long keySize,
                       void *value, signed long valueSize);
 
+/* Called by disk_cache_get_batch() for every requested key, with the
+ * malloc'ed value (to be freed by the callee) or NULL if it wasn't found.
+ */
+typedef void
+(*disk_cache_get_batch_cb) (void *callback_data, unsigned index,
+                            void *value, size_t size);
+
 struct cache_item_metadata {
    /**
     * The cache item type. This could be used to identify a GLSL cache item,
@@ -76,6 +91,30 @@ struct cache_item_metadata {
 
 struct disk_cache;
 
+/**
+ * Counters of the in-memory tier, see disk_cache_get_stats().
+ */
+struct disk_cache_stats {
+   uint64_t mem_hits;
+   uint64_t mem_misses;
+   uint64_t mem_evictions;
+   /* Bytes currently held by the in-memory tier. */
+   uint64_t mem_size;
+};
+
+/**
+ * A reference to the data of a cache item, see disk_cache_get_entry().
+ */
+struct disk_cache_entry {
+   const void *data;
+   size_t size;
+
+   /* Private, used by disk_cache_entry_release(). */
+   void (*release)(struct disk_cache_entry *entry);
+   void *release_data;
+   size_t release_size;
+};
+
 static inline char *
 disk_cache_format_hex_id(char *buf, const uint8_t *hex_id, unsigned size)
 {
@@ -169,11 +208,24 @@ disk_cache_get_function_identifier(void *ptr, struct mesa_sha1 *ctx)
  * (though nothing in this implementation directly relies on how the
  * names are computed). See mesa-sha1.h and _mesa_sha1_compute for
  * assistance in computing SHA-1 signatures.
+ *
+ * The storage backend is DISK_CACHE_MULTI_FILE unless the
+ * MESA_DISK_CACHE_SINGLE_FILE environment variable is set.
  */
 struct disk_cache *
 disk_cache_create(const char *gpu_name, const char *timestamp,
                   uint64_t driver_flags);
 
+/**
+ * Create a new cache object using the storage backend \type.
+ *
+ * The two backends use different files within the cache directory, items
+ * stored by one are not visible to the other.
+ */
+struct disk_cache *
+disk_cache_type_create(const char *gpu_name, const char *timestamp,
+                       uint64_t driver_flags, enum disk_cache_type type);
+
 /**
  * Destroy a cache object, (freeing all associated resources).
  */
@@ -186,6 +238,14 @@ disk_cache_destroy(struct disk_cache *cache);
 void
 disk_cache_wait_for_idle(struct disk_cache *cache);
 
+/**
+ * Return the counters of the in-memory tier, which sits in front of the
+ * disk when MESA_DISK_CACHE_MEMORY_SIZE is set. Hits and misses count
+ * lookups through disk_cache_get() and disk_cache_get_entry().
+ */
+void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats);
+
 /**
  * Remove the item in the cache under the name \key.
  */
@@ -222,6 +282,51 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
 void *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size);
 
+/**
+ * Store an item in the cache under the name \key, without compressing it.
+ *
+ * This trades disk space for cheaper retrieval: disk_cache_get_entry() can
+ * return such items straight from the page cache.
+ */
+void
+disk_cache_put_uncompressed(struct disk_cache *cache, const cache_key key,
+                            const void *data, size_t size,
+                            struct cache_item_metadata *cache_item_metadata);
+
+/**
+ * Retrieve an item previously stored in the cache with the name <key>,
+ * without copying it if possible.
+ *
+ * For items stored with disk_cache_put_uncompressed(), \entry->data points
+ * into a read-only mapping of the cache file. Other items are uncompressed
+ * into a temporary buffer, like disk_cache_get() does.
+ *
+ * \return true if the item was found, in which case \entry->data and
+ * \entry->size describe its contents until disk_cache_entry_release() is
+ * called.
+ */
+bool
+disk_cache_get_entry(struct disk_cache *cache, const cache_key key,
+                     struct disk_cache_entry *entry);
+
+/**
+ * Release an entry returned by disk_cache_get_entry().
+ */
+void
+disk_cache_entry_release(struct disk_cache_entry *entry);
+
+/**
+ * Retrieve the items stored under \keys in parallel.
+ *
+ * \callback is called once for each key, as soon as the item is read, with
+ * \index being the position of the key in \keys. It may be called from
+ * several threads at a time. Returns after all callbacks have finished.
+ */
+void
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys, disk_cache_get_batch_cb callback,
+                     void *callback_data);
+
 /**
  * Store the name \key within the cache, (without any associated data).
  *
@@ -267,6 +372,13 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
    return NULL;
 }
 
+static inline struct disk_cache *
+disk_cache_type_create(const char *gpu_name, const char *timestamp,
+                       uint64_t driver_flags, enum disk_cache_type type)
+{
+   return NULL;
+}
+
 static inline void
 disk_cache_destroy(struct disk_cache *cache) {
    return;
@@ -280,6 +392,12 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    return;
 }
 
+static inline void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+}
+
 static inline void
 disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
@@ -292,6 +410,36 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    return NULL;
 }
 
+static inline void
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys, disk_cache_get_batch_cb callback,
+                     void *callback_data)
+{
+   for (unsigned i = 0; i < num_keys; i++)
+      callback(callback_data, i, NULL, 0);
+}
+
+static inline void
+disk_cache_put_uncompressed(struct disk_cache *cache, const cache_key key,
+                            const void *data, size_t size,
+                            struct cache_item_metadata *cache_item_metadata)
+{
+   return;
+}
+
+static inline bool
+disk_cache_get_entry(struct disk_cache *cache, const cache_key key,
+                     struct disk_cache_entry *entry)
+{
+   return false;
+}
+
+static inline void
+disk_cache_entry_release(struct disk_cache_entry *entry)
+{
+   return;
+}
+
 static inline void
 disk_cache_put_key(struct disk_cache *cache, const cache_key key)
 {
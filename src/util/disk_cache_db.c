@@ -0,0 +1,758 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "util/compiler.h"
+#include "util/macros.h"
+#include "util/ralloc.h"
+#include "util/simple_mtx.h"
+#include "util/u_atomic.h"
+
+#include "disk_cache_db.h"
+
+#define DB_DATA_FILE_NAME "mesa_cache.db"
+#define DB_INDEX_FILE_NAME "mesa_cache.idx"
+
+#define DB_MAGIC 0x4244434d /* "MCDB" */
+#define DB_RECORD_MAGIC 0x5243434d /* "MCCR" */
+
+/* Bump whenever the layout of the index or the data file changes. */
+#define DB_VERSION 1
+
+/* Number of slots in the index hash table, must be a power of two.  At 40
+ * bytes per slot this is a 20MB (sparse) file, which leaves enough room for
+ * several hundred thousand entries.
+ */
+#define DB_INDEX_SLOTS (1 << 19)
+
+/* Compact once the table is this full, (including removed entries), to keep
+ * probe sequences short.
+ */
+#define DB_INDEX_MAX_ENTRIES (DB_INDEX_SLOTS / 4 * 3)
+
+/* Chunk size used to copy records around during compaction. */
+#define DB_COPY_BUFSIZE (256 * 1024)
+
+struct db_index_header {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_slots;
+   /* Used and removed slots. */
+   uint32_t num_entries;
+   /* Bumped every time the data file is replaced by a compaction. */
+   uint64_t generation;
+   /* Logical clock used to order entries by last access. */
+   uint64_t access_clock;
+   /* Total size of all records referenced by the index. */
+   uint64_t live_size;
+};
+
+/* An index slot is empty if offset is 0 (the data file header lives there)
+ * and has been removed if size is 0.
+ */
+struct db_index_entry {
+   uint8_t key[CACHE_KEY_SIZE];
+   uint32_t size;
+   uint64_t offset;
+   uint64_t last_access;
+};
+
+struct db_file_header {
+   uint32_t magic;
+   uint32_t version;
+};
+
+struct db_record_header {
+   uint32_t magic;
+   uint32_t size;
+   uint8_t key[CACHE_KEY_SIZE];
+};
+
+struct disk_cache_db {
+   char *data_path;
+   uint64_t max_size;
+
+   /* Serializes all accesses from this process, flock() only provides
+    * exclusion against other processes.
+    */
+   simple_mtx_t mtx;
+
+   int index_fd;
+   void *index_mmap;
+   size_t index_mmap_size;
+   struct db_index_header *header;
+   struct db_index_entry *entries;
+
+   /* The data file and the index generation it belongs to. */
+   int data_fd;
+   uint64_t data_generation;
+};
+
+static bool
+db_lock(struct disk_cache_db *db)
+{
+   int err;
+
+   simple_mtx_lock(&db->mtx);
+
+#ifdef HAVE_FLOCK
+   err = flock(db->index_fd, LOCK_EX);
+#else
+   struct flock lock = {
+      .l_start = 0,
+      .l_len = 0, /* entire file */
+      .l_type = F_WRLCK,
+      .l_whence = SEEK_SET
+   };
+   err = fcntl(db->index_fd, F_SETLKW, &lock);
+#endif
+   if (err == -1) {
+      simple_mtx_unlock(&db->mtx);
+      return false;
+   }
+
+   return true;
+}
+
+static void
+db_unlock(struct disk_cache_db *db)
+{
+#ifdef HAVE_FLOCK
+   flock(db->index_fd, LOCK_UN);
+#else
+   struct flock lock = {
+      .l_start = 0,
+      .l_len = 0, /* entire file */
+      .l_type = F_UNLCK,
+      .l_whence = SEEK_SET
+   };
+   fcntl(db->index_fd, F_SETLK, &lock);
+#endif
+   simple_mtx_unlock(&db->mtx);
+}
+
+static bool
+db_write_all(int fd, const void *buf, size_t count, off_t offset)
+{
+   const char *out = buf;
+   size_t done;
+   ssize_t written;
+
+   for (done = 0; done < count; done += written) {
+      written = pwrite(fd, out + done, count - done, offset + done);
+      if (written == -1)
+         return false;
+   }
+
+   return true;
+}
+
+static bool
+db_read_all(int fd, void *buf, size_t count, off_t offset)
+{
+   char *in = buf;
+   size_t done;
+   ssize_t read_ret;
+
+   for (done = 0; done < count; done += read_ret) {
+      read_ret = pread(fd, in + done, count - done, offset + done);
+      if (read_ret == -1 || read_ret == 0)
+         return false;
+   }
+
+   return true;
+}
+
+static bool
+db_init_data_file(int fd)
+{
+   struct db_file_header fh = {
+      .magic = DB_MAGIC,
+      .version = DB_VERSION,
+   };
+
+   return db_write_all(fd, &fh, sizeof(fh), 0);
+}
+
+/* Make sure db->data_fd refers to the data file the index currently
+ * describes. Must be called with db->mtx held.
+ */
+static bool
+db_update_data_fd(struct disk_cache_db *db)
+{
+   /* Read the generation before opening, so a compaction racing with us
+    * can at worst cause a needless reopen next time.
+    */
+   uint64_t generation = p_atomic_read(&db->header->generation);
+
+   if (db->data_fd != -1 && generation == db->data_generation)
+      return true;
+
+   int fd = open(db->data_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   if (fd == -1)
+      return false;
+
+   if (db->data_fd != -1)
+      close(db->data_fd);
+
+   db->data_fd = fd;
+   db->data_generation = generation;
+
+   return true;
+}
+
+static inline uint32_t
+db_key_hash(const cache_key key)
+{
+   uint32_t hash;
+
+   /* The keys are SHA-1 hashes so any 32 bits of them are a good hash. */
+   memcpy(&hash, key, sizeof(hash));
+   return CPU_TO_LE32(hash);
+}
+
+static struct db_index_entry *
+db_find_entry(struct disk_cache_db *db, const cache_key key)
+{
+   uint32_t mask = db->header->num_slots - 1;
+   uint32_t slot = db_key_hash(key) & mask;
+
+   for (uint32_t i = 0; i < db->header->num_slots; i++) {
+      struct db_index_entry *entry = &db->entries[(slot + i) & mask];
+
+      if (entry->offset == 0)
+         return NULL;
+
+      if (entry->size && memcmp(entry->key, key, CACHE_KEY_SIZE) == 0)
+         return entry;
+   }
+
+   return NULL;
+}
+
+static struct db_index_entry *
+db_find_free_entry(struct disk_cache_db *db, const cache_key key)
+{
+   uint32_t mask = db->header->num_slots - 1;
+   uint32_t slot = db_key_hash(key) & mask;
+
+   for (uint32_t i = 0; i < db->header->num_slots; i++) {
+      struct db_index_entry *entry = &db->entries[(slot + i) & mask];
+
+      if (entry->offset == 0 || entry->size == 0)
+         return entry;
+   }
+
+   return NULL;
+}
+
+static void
+db_insert_entry(struct disk_cache_db *db, const cache_key key,
+                uint64_t offset, uint32_t size, uint64_t last_access)
+{
+   struct db_index_entry *entry = db_find_free_entry(db, key);
+   assert(entry);
+
+   if (entry->offset == 0)
+      db->header->num_entries++;
+
+   /* Readers in other processes may observe a partially updated entry, they
+    * will notice when checking the record header.
+    */
+   memcpy(entry->key, key, CACHE_KEY_SIZE);
+   entry->last_access = last_access;
+   entry->offset = offset;
+   entry->size = size;
+
+   db->header->live_size += size;
+}
+
+/* Atomically replace the data file with an empty one. The old file is
+ * never truncated, other processes may still have it mapped.
+ */
+static int
+db_replace_data_file(struct disk_cache_db *db, const char *tmp_path)
+{
+   int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (fd == -1)
+      return -1;
+
+   if (!db_init_data_file(fd)) {
+      close(fd);
+      unlink(tmp_path);
+      return -1;
+   }
+
+   return fd;
+}
+
+static bool
+db_reset(struct disk_cache_db *db)
+{
+   char *tmp_path;
+   int fd;
+
+   if (asprintf(&tmp_path, "%s.tmp", db->data_path) == -1)
+      return false;
+
+   fd = db_replace_data_file(db, tmp_path);
+   if (fd == -1 || rename(tmp_path, db->data_path) == -1) {
+      if (fd != -1) {
+         close(fd);
+         unlink(tmp_path);
+      }
+      free(tmp_path);
+      return false;
+   }
+   free(tmp_path);
+
+   memset(db->entries, 0, db->header->num_slots * sizeof(*db->entries));
+   db->header->num_entries = 0;
+   db->header->live_size = 0;
+
+   if (db->data_fd != -1)
+      close(db->data_fd);
+   db->data_fd = fd;
+   db->data_generation = p_atomic_inc_return(&db->header->generation);
+
+   return true;
+}
+
+static int
+db_cmp_last_access(const void *a, const void *b)
+{
+   const struct db_index_entry *ea = a, *eb = b;
+
+   /* Most recently used first. */
+   if (ea->last_access > eb->last_access)
+      return -1;
+   if (ea->last_access < eb->last_access)
+      return 1;
+   return 0;
+}
+
+/* Copy the most recently used entries into a new data file until it holds
+ * \p target_size bytes and swap it with the old one. Must be called with
+ * the lock held.
+ */
+static bool
+db_compact(struct disk_cache_db *db, uint64_t target_size)
+{
+   struct db_index_entry *live;
+   char *tmp_path = NULL;
+   uint8_t *buf = NULL;
+   uint64_t offset = sizeof(struct db_file_header);
+   unsigned num_live = 0, num_kept = 0;
+   int fd = -1;
+   bool ret = false;
+
+   live = malloc(db->header->num_entries * sizeof(*live));
+   buf = malloc(DB_COPY_BUFSIZE);
+   if ((db->header->num_entries && !live) || !buf)
+      goto out;
+
+   for (uint32_t i = 0; i < db->header->num_slots; i++) {
+      if (db->entries[i].offset && db->entries[i].size)
+         live[num_live++] = db->entries[i];
+   }
+
+   qsort(live, num_live, sizeof(*live), db_cmp_last_access);
+
+   if (asprintf(&tmp_path, "%s.tmp", db->data_path) == -1) {
+      tmp_path = NULL;
+      goto out;
+   }
+
+   fd = db_replace_data_file(db, tmp_path);
+   if (fd == -1)
+      goto out;
+
+   for (unsigned i = 0; i < num_live; i++) {
+      struct db_index_entry *entry = &live[i];
+
+      if (offset + entry->size > target_size)
+         break;
+
+      for (uint32_t done = 0; done < entry->size;) {
+         uint32_t chunk = MIN2(entry->size - done, DB_COPY_BUFSIZE);
+
+         if (!db_read_all(db->data_fd, buf, chunk, entry->offset + done) ||
+             !db_write_all(fd, buf, chunk, offset + done))
+            goto out;
+
+         done += chunk;
+      }
+
+      entry->offset = offset;
+      offset += entry->size;
+      live[num_kept++] = *entry;
+   }
+
+   if (rename(tmp_path, db->data_path) == -1)
+      goto out;
+
+   memset(db->entries, 0, db->header->num_slots * sizeof(*db->entries));
+   db->header->num_entries = 0;
+   db->header->live_size = 0;
+
+   for (unsigned i = 0; i < num_kept; i++) {
+      db_insert_entry(db, live[i].key, live[i].offset, live[i].size,
+                      live[i].last_access);
+   }
+
+   close(db->data_fd);
+   db->data_fd = fd;
+   db->data_generation = p_atomic_inc_return(&db->header->generation);
+   fd = -1;
+
+   ret = true;
+
+ out:
+   if (fd != -1) {
+      close(fd);
+      unlink(tmp_path);
+   }
+   free(tmp_path);
+   free(buf);
+   free(live);
+
+   return ret;
+}
+
+static bool
+db_validate_index(struct disk_cache_db *db)
+{
+   return db->header->magic == DB_MAGIC &&
+          db->header->version == DB_VERSION &&
+          db->header->num_slots == DB_INDEX_SLOTS &&
+          db->header->num_entries <= DB_INDEX_SLOTS;
+}
+
+struct disk_cache_db *
+disk_cache_db_open(void *mem_ctx, const char *path, uint64_t max_size)
+{
+   struct disk_cache_db *db;
+   char *index_path;
+   struct stat sb;
+
+   db = rzalloc(mem_ctx, struct disk_cache_db);
+   if (!db)
+      return NULL;
+
+   db->index_fd = -1;
+   db->data_fd = -1;
+   db->index_mmap = MAP_FAILED;
+   db->max_size = max_size;
+   simple_mtx_init(&db->mtx, mtx_plain);
+
+   db->data_path = ralloc_asprintf(db, "%s/%s", path, DB_DATA_FILE_NAME);
+   index_path = ralloc_asprintf(db, "%s/%s", path, DB_INDEX_FILE_NAME);
+   if (!db->data_path || !index_path)
+      goto fail;
+
+   db->index_fd = open(index_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   if (db->index_fd == -1)
+      goto fail;
+
+   db->index_mmap_size = sizeof(struct db_index_header) +
+                         DB_INDEX_SLOTS * sizeof(struct db_index_entry);
+
+   if (!db_lock(db))
+      goto fail;
+
+   if (fstat(db->index_fd, &sb) == -1)
+      goto fail_unlock;
+
+   /* Only ever grow the file, other processes may have it mapped. An index
+    * with unexpected contents is reset below.
+    */
+   if (sb.st_size < db->index_mmap_size) {
+      if (ftruncate(db->index_fd, db->index_mmap_size) == -1)
+         goto fail_unlock;
+   }
+
+   db->index_mmap = mmap(NULL, db->index_mmap_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, db->index_fd, 0);
+   if (db->index_mmap == MAP_FAILED)
+      goto fail_unlock;
+
+   db->header = db->index_mmap;
+   db->entries = (struct db_index_entry *)(db->header + 1);
+
+   if (!db_validate_index(db)) {
+      db->header->magic = DB_MAGIC;
+      db->header->version = DB_VERSION;
+      db->header->num_slots = DB_INDEX_SLOTS;
+      db->header->access_clock = 0;
+
+      if (!db_reset(db))
+         goto fail_unlock;
+   } else {
+      struct db_file_header fh;
+
+      if (!db_update_data_fd(db))
+         goto fail_unlock;
+
+      /* If the data file went missing or was replaced behind our back the
+       * index can't be trusted anymore.
+       */
+      if (!db_read_all(db->data_fd, &fh, sizeof(fh), 0) ||
+          fh.magic != DB_MAGIC || fh.version != DB_VERSION) {
+         if (!db_reset(db))
+            goto fail_unlock;
+      }
+   }
+
+   db_unlock(db);
+   ralloc_free(index_path);
+
+   return db;
+
+ fail_unlock:
+   db_unlock(db);
+ fail:
+   disk_cache_db_close(db);
+
+   return NULL;
+}
+
+void
+disk_cache_db_close(struct disk_cache_db *db)
+{
+   if (!db)
+      return;
+
+   if (db->index_mmap != MAP_FAILED)
+      munmap(db->index_mmap, db->index_mmap_size);
+   if (db->index_fd != -1)
+      close(db->index_fd);
+   if (db->data_fd != -1)
+      close(db->data_fd);
+
+   simple_mtx_destroy(&db->mtx);
+   ralloc_free(db);
+}
+
+bool
+disk_cache_db_put(struct disk_cache_db *db, const cache_key key,
+                  const void *data, size_t size)
+{
+   struct db_record_header rh;
+   uint64_t record_size = sizeof(rh) + size;
+   struct stat sb;
+   bool ret = false;
+
+   if (record_size > db->max_size || record_size > UINT32_MAX)
+      return false;
+
+   if (!db_lock(db))
+      return false;
+
+   if (!db_update_data_fd(db))
+      goto out;
+
+   /* Another thread or process beat us to it. */
+   if (db_find_entry(db, key))
+      goto out;
+
+   if (fstat(db->data_fd, &sb) == -1)
+      goto out;
+
+   /* Evicting 25% at once keeps the cost of compaction amortized over many
+    * writes.
+    */
+   if (sb.st_size + record_size > db->max_size ||
+       db->header->num_entries >= DB_INDEX_MAX_ENTRIES) {
+      if (!db_compact(db, (db->max_size - record_size) / 4 * 3))
+         goto out;
+
+      if (fstat(db->data_fd, &sb) == -1)
+         goto out;
+   }
+
+   /* Write the payload first and the header last, so a reader can never
+    * validate a record that hasn't been fully written.
+    */
+   memset(&rh, 0, sizeof(rh));
+   if (!db_write_all(db->data_fd, data, size, sb.st_size + sizeof(rh)))
+      goto out;
+
+   rh.magic = DB_RECORD_MAGIC;
+   rh.size = record_size;
+   memcpy(rh.key, key, CACHE_KEY_SIZE);
+   if (!db_write_all(db->data_fd, &rh, sizeof(rh), sb.st_size))
+      goto out;
+
+   db_insert_entry(db, key, sb.st_size, record_size,
+                   p_atomic_inc_return(&db->header->access_clock));
+
+   ret = true;
+
+ out:
+   db_unlock(db);
+
+   return ret;
+}
+
+void *
+disk_cache_db_get(struct disk_cache_db *db, const cache_key key,
+                  size_t *size)
+{
+   struct db_index_entry *entry;
+   struct db_record_header rh;
+   uint64_t offset;
+   uint32_t record_size;
+   void *data = NULL;
+
+   simple_mtx_lock(&db->mtx);
+
+   if (!db_update_data_fd(db))
+      goto out;
+
+   entry = db_find_entry(db, key);
+   if (!entry)
+      goto out;
+
+   offset = entry->offset;
+   record_size = entry->size;
+   if (record_size < sizeof(rh))
+      goto out;
+
+   /* Racy, but the worst outcome is a slightly wrong eviction order. */
+   entry->last_access = p_atomic_inc_return(&db->header->access_clock);
+
+   if (!db_read_all(db->data_fd, &rh, sizeof(rh), offset))
+      goto out;
+
+   if (rh.magic != DB_RECORD_MAGIC || rh.size != record_size ||
+       memcmp(rh.key, key, CACHE_KEY_SIZE) != 0)
+      goto out;
+
+   data = malloc(record_size - sizeof(rh));
+   if (!data)
+      goto out;
+
+   if (!db_read_all(db->data_fd, data, record_size - sizeof(rh),
+                    offset + sizeof(rh))) {
+      free(data);
+      data = NULL;
+      goto out;
+   }
+
+   if (size)
+      *size = record_size - sizeof(rh);
+
+ out:
+   simple_mtx_unlock(&db->mtx);
+
+   return data;
+}
+
+bool
+disk_cache_db_map(struct disk_cache_db *db, const cache_key key,
+                  void **map, size_t *map_size, void **data, size_t *size)
+{
+   struct db_index_entry *entry;
+   const struct db_record_header *rh;
+   uint64_t offset, map_offset;
+   uint32_t record_size;
+   bool ret = false;
+
+   simple_mtx_lock(&db->mtx);
+
+   if (!db_update_data_fd(db))
+      goto out;
+
+   entry = db_find_entry(db, key);
+   if (!entry)
+      goto out;
+
+   offset = entry->offset;
+   record_size = entry->size;
+   if (record_size < sizeof(*rh))
+      goto out;
+
+   /* Racy, but the worst outcome is a slightly wrong eviction order. */
+   entry->last_access = p_atomic_inc_return(&db->header->access_clock);
+
+   map_offset = offset & ~(uint64_t)(sysconf(_SC_PAGESIZE) - 1);
+   *map_size = offset - map_offset + record_size;
+   *map = mmap(NULL, *map_size, PROT_READ, MAP_PRIVATE, db->data_fd,
+               map_offset);
+   if (*map == MAP_FAILED)
+      goto out;
+
+   rh = (const struct db_record_header *)
+      ((uint8_t *)*map + (offset - map_offset));
+
+   /* A torn or stale index entry could point past the end of the file, make
+    * sure the whole record is there before touching it.
+    */
+   struct stat sb;
+   if (fstat(db->data_fd, &sb) == -1 || offset + record_size > sb.st_size ||
+       rh->magic != DB_RECORD_MAGIC || rh->size != record_size ||
+       memcmp(rh->key, key, CACHE_KEY_SIZE) != 0) {
+      munmap(*map, *map_size);
+      goto out;
+   }
+
+   *data = (void *)(rh + 1);
+   *size = record_size - sizeof(*rh);
+   ret = true;
+
+ out:
+   simple_mtx_unlock(&db->mtx);
+
+   return ret;
+}
+
+void
+disk_cache_db_remove(struct disk_cache_db *db, const cache_key key)
+{
+   struct db_index_entry *entry;
+
+   if (!db_lock(db))
+      return;
+
+   entry = db_find_entry(db, key);
+   if (entry) {
+      db->header->live_size -= entry->size;
+      entry->size = 0;
+   }
+
+   db_unlock(db);
+}
+
+#endif /* ENABLE_SHADER_CACHE */
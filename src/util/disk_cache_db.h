@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * A single-file storage backend for the shader disk cache.
+ *
+ * All cache entries are appended to one data file ("mesa_cache.db"), and a
+ * fixed-size open-addressing hash table stored in a second, memory-mapped
+ * file ("mesa_cache.idx") maps every cache key to the offset and size of its
+ * record.  A lookup is therefore a probe of shared memory followed by a
+ * single pread(), without any path lookups or directory walks.
+ *
+ * The files are shared between processes.  Writers serialize on an exclusive
+ * flock() of the index file.  Readers don't take any file lock; they validate
+ * the record header (magic, key and size) they read back, so a racing write
+ * or compaction in another process only ever results in a cache miss.
+ *
+ * Eviction happens by compaction: once the data file would grow beyond the
+ * maximum cache size, the most recently used entries are copied into a new
+ * data file which atomically replaces the old one, and the index is rebuilt.
+ * Data files are only ever appended to, never rewritten or truncated in
+ * place, so entries can safely be read through a mapping.
+ */
+
+#ifndef DISK_CACHE_DB_H
+#define DISK_CACHE_DB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/disk_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct disk_cache_db;
+
+/**
+ * Open (creating it if needed) the single-file cache in directory \path.
+ *
+ * \p max_size is the maximum number of bytes the data file may occupy.
+ *
+ * Returns NULL on any error.  The returned object is ralloc'ed off \p mem_ctx.
+ */
+struct disk_cache_db *
+disk_cache_db_open(void *mem_ctx, const char *path, uint64_t max_size);
+
+void
+disk_cache_db_close(struct disk_cache_db *db);
+
+/**
+ * Append \p data to the cache under \p key, compacting the cache first if
+ * needed.  Does nothing if an entry for \p key already exists.
+ */
+bool
+disk_cache_db_put(struct disk_cache_db *db, const cache_key key,
+                  const void *data, size_t size);
+
+/**
+ * Read the entry stored under \p key.
+ *
+ * Returns a malloc'ed copy of the data the entry was stored with, or NULL
+ * if it was not found.
+ */
+void *
+disk_cache_db_get(struct disk_cache_db *db, const cache_key key,
+                  size_t *size);
+
+/**
+ * Map the entry stored under \p key read-only.
+ *
+ * On success, \p data points to the data the entry was stored with and
+ * \p map/\p map_size describe the mapping, which the caller must munmap().
+ * The mapping remains valid even if the entry is evicted.
+ */
+bool
+disk_cache_db_map(struct disk_cache_db *db, const cache_key key,
+                  void **map, size_t *map_size, void **data, size_t *size);
+
+void
+disk_cache_db_remove(struct disk_cache_db *db, const cache_key key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_DB_H */
@@ -317,6 +317,16 @@ DRI_CONF_OPT_BEGIN_B(vk_x11_ensure_min_image_count, def) \
         DRI_CONF_DESC("Force the X11 WSI to create at least the number of image specified by the driver in VkSurfaceCapabilitiesKHR::minImageCount") \
 DRI_CONF_OPT_END
 
+#define DRI_CONF_VK_X11_MAX_FRAME_LATENCY(def) \
+DRI_CONF_OPT_BEGIN_V(vk_x11_max_frame_latency, int, def, "0:16") \
+        DRI_CONF_DESC("Limit the number of frames queued for presentation in FIFO mode, to lower input latency (0 = no limit)") \
+DRI_CONF_OPT_END
+
+#define DRI_CONF_VK_X11_PRIME_DIRECT(def) \
+DRI_CONF_OPT_BEGIN_B(vk_x11_prime_direct, def) \
+        DRI_CONF_DESC("With PRIME, let the display GPU use the swapchain images directly when it supports one of their modifiers, instead of copying every frame") \
+DRI_CONF_OPT_END
+
 #define DRI_CONF_MESA_GLTHREAD(def) \
 DRI_CONF_OPT_BEGIN_B(mesa_glthread, def) \
         DRI_CONF_DESC("Enable offloading GL driver work to a separate thread") \
@@ -619,6 +619,53 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print_channels(format, pack_into_struct)
 
 
+# Formats with kernels in u_format_simd.c.
+simd_formats = set([
+    'PIPE_FORMAT_R8G8B8A8_UNORM',
+    'PIPE_FORMAT_R8G8B8X8_UNORM',
+    'PIPE_FORMAT_B8G8R8A8_UNORM',
+    'PIPE_FORMAT_B8G8R8X8_UNORM',
+    'PIPE_FORMAT_A8R8G8B8_UNORM',
+    'PIPE_FORMAT_X8R8G8B8_UNORM',
+    'PIPE_FORMAT_A8B8G8R8_UNORM',
+    'PIPE_FORMAT_X8B8G8R8_UNORM',
+    'PIPE_FORMAT_B5G6R5_UNORM',
+    'PIPE_FORMAT_R5G6B5_UNORM',
+    'PIPE_FORMAT_B5G5R5A1_UNORM',
+    'PIPE_FORMAT_B5G5R5X1_UNORM',
+    'PIPE_FORMAT_B4G4R4A4_UNORM',
+    'PIPE_FORMAT_B4G4R4X4_UNORM',
+    'PIPE_FORMAT_R10G10B10A2_UNORM',
+    'PIPE_FORMAT_B10G10R10A2_UNORM',
+])
+
+
+def generate_simd_call(format, func):
+    '''Try the SIMD kernel first, for the formats that have one.'''
+
+    if format.name not in simd_formats:
+        return
+
+    print('   if (util_format_simd_%s(%s, dst_row, dst_stride, src_row, src_stride, width, height))' % (func, format.name))
+    print('      return;')
+    print()
+
+
+def is_half_rgba_array(format):
+    '''Whether the format is an array of four half floats in RGBA order, which
+    can be converted a whole row at a time.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    for i in range(4):
+        channel = format.le_channels[i]
+        if channel.type != FLOAT or channel.size != 16:
+            return False
+        if format.le_swizzles[i] != i or format.be_swizzles[i] != i:
+            return False
+    return True
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
@@ -634,6 +681,16 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     print('{')
 
     if is_format_supported(format):
+        generate_simd_call(format, 'unpack_%s' % dst_suffix)
+
+    if is_format_supported(format) and dst_channel.type == FLOAT and is_half_rgba_array(format):
+        print('   unsigned y;')
+        print('   for(y = 0; y < height; y += 1) {')
+        print('      _mesa_half_to_float_array((float *)dst_row, (const uint16_t *)src_row, width * 4);')
+        print('      src_row += src_stride;')
+        print('      dst_row = (uint8_t *)dst_row + dst_stride;')
+        print('   }')
+    elif is_format_supported(format):
         print('   unsigned x, y;')
         print('   for(y = 0; y < height; y += %u) {' % (format.block_height,))
         print('      %s *dst = dst_row;' % (dst_native_type))
@@ -663,6 +720,16 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
     print('{')
     
     if is_format_supported(format):
+        generate_simd_call(format, 'pack_%s' % src_suffix)
+
+    if is_format_supported(format) and src_channel.type == FLOAT and is_half_rgba_array(format):
+        print('   unsigned y;')
+        print('   for(y = 0; y < height; y += 1) {')
+        print('      _mesa_float_to_half_rtz_array((uint16_t *)dst_row, src_row, width * 4);')
+        print('      dst_row += dst_stride;')
+        print('      src_row += src_stride/sizeof(*src_row);')
+        print('   }')
+    elif is_format_supported(format):
         print('   unsigned x, y;')
         print('   for(y = 0; y < height; y += %u) {' % (format.block_height,))
         print('      const %s *src = src_row;' % (src_native_type))
@@ -709,6 +776,7 @@ def generate(formats):
     print('#include "util/u_half.h"')
     print('#include "u_format.h"')
     print('#include "u_format_other.h"')
+    print('#include "u_format_simd.h"')
     print('#include "util/format_srgb.h"')
     print('#include "u_format_yuv.h"')
     print('#include "u_format_zs.h"')
@@ -0,0 +1,261 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "c11/threads.h"
+#include "util/format/u_format.h"
+#include "util/format/u_format_simd.h"
+#include "util/u_cpu_detect.h"
+#include "util/macros.h"
+
+/* Keep in sync with simd_formats in u_format_pack.py and with the callers in
+ * u_format_zs.c.
+ */
+static const struct {
+   enum pipe_format format;
+   enum util_format_simd_class class;
+} simd_formats[] = {
+   { PIPE_FORMAT_R8G8B8A8_UNORM, UTIL_FORMAT_SIMD_RGBA8 },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, UTIL_FORMAT_SIMD_RGBA8 },
+   { PIPE_FORMAT_B8G8R8A8_UNORM, UTIL_FORMAT_SIMD_RGBA8 },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, UTIL_FORMAT_SIMD_RGBA8 },
+   { PIPE_FORMAT_A8R8G8B8_UNORM, UTIL_FORMAT_SIMD_RGBA8 },
+   { PIPE_FORMAT_X8R8G8B8_UNORM, UTIL_FORMAT_SIMD_RGBA8 },
+   { PIPE_FORMAT_A8B8G8R8_UNORM, UTIL_FORMAT_SIMD_RGBA8 },
+   { PIPE_FORMAT_X8B8G8R8_UNORM, UTIL_FORMAT_SIMD_RGBA8 },
+   { PIPE_FORMAT_B5G6R5_UNORM, UTIL_FORMAT_SIMD_PACKED16 },
+   { PIPE_FORMAT_R5G6B5_UNORM, UTIL_FORMAT_SIMD_PACKED16 },
+   { PIPE_FORMAT_B5G5R5A1_UNORM, UTIL_FORMAT_SIMD_PACKED16 },
+   { PIPE_FORMAT_B5G5R5X1_UNORM, UTIL_FORMAT_SIMD_PACKED16 },
+   { PIPE_FORMAT_B4G4R4A4_UNORM, UTIL_FORMAT_SIMD_PACKED16 },
+   { PIPE_FORMAT_B4G4R4X4_UNORM, UTIL_FORMAT_SIMD_PACKED16 },
+   { PIPE_FORMAT_R10G10B10A2_UNORM, UTIL_FORMAT_SIMD_PACKED32 },
+   { PIPE_FORMAT_B10G10R10A2_UNORM, UTIL_FORMAT_SIMD_PACKED32 },
+   { PIPE_FORMAT_Z16_UNORM, UTIL_FORMAT_SIMD_DEPTH },
+   { PIPE_FORMAT_Z24_UNORM_S8_UINT, UTIL_FORMAT_SIMD_DEPTH },
+   { PIPE_FORMAT_S8_UINT_Z24_UNORM, UTIL_FORMAT_SIMD_DEPTH },
+   { PIPE_FORMAT_Z24X8_UNORM, UTIL_FORMAT_SIMD_DEPTH },
+   { PIPE_FORMAT_X8Z24_UNORM, UTIL_FORMAT_SIMD_DEPTH },
+};
+
+struct simd_entry {
+   struct util_format_simd_layout layout;
+   struct util_format_simd_kernels kernels;
+};
+
+static struct simd_entry simd_table[PIPE_FORMAT_COUNT];
+static once_flag simd_once_flag = ONCE_FLAG_INIT;
+static bool simd_enabled = true;
+
+static void
+simd_get_layout(const struct util_format_description *desc,
+                enum util_format_simd_class class,
+                struct util_format_simd_layout *layout)
+{
+   memset(layout, 0, sizeof(*layout));
+   layout->block_bits = desc->block.bits;
+
+   for (unsigned c = 0; c < 4; c++) {
+      unsigned swizzle = desc->swizzle[c];
+
+      if (class == UTIL_FORMAT_SIMD_DEPTH && c > 0)
+         break;
+
+      if (swizzle <= PIPE_SWIZZLE_W) {
+         layout->shift[c] = desc->channel[swizzle].shift;
+         layout->size[c] = desc->channel[swizzle].size;
+      } else {
+         assert(swizzle == PIPE_SWIZZLE_1);
+      }
+   }
+}
+
+static void
+simd_init(void)
+{
+   struct util_format_simd_kernels kernels[UTIL_FORMAT_SIMD_NUM_CLASSES];
+
+   memset(kernels, 0, sizeof(kernels));
+
+#if UTIL_ARCH_LITTLE_ENDIAN
+   util_cpu_detect();
+
+#ifdef UTIL_FORMAT_SIMD_X86
+   if (util_cpu_caps.has_ssse3 && util_cpu_caps.has_sse4_1)
+      util_format_simd_get_kernels_sse41(kernels);
+   if (util_cpu_caps.has_avx2)
+      util_format_simd_get_kernels_avx2(kernels);
+#endif
+
+#ifdef UTIL_FORMAT_SIMD_NEON
+   util_format_simd_get_kernels_neon(kernels);
+#endif
+#endif
+
+   for (unsigned i = 0; i < ARRAY_SIZE(simd_formats); i++) {
+      struct simd_entry *entry = &simd_table[simd_formats[i].format];
+
+      simd_get_layout(util_format_description(simd_formats[i].format),
+                      simd_formats[i].class, &entry->layout);
+      entry->kernels = kernels[simd_formats[i].class];
+   }
+}
+
+void
+util_format_simd_set_enabled(bool enabled)
+{
+   simd_enabled = enabled;
+}
+
+static inline const struct simd_entry *
+simd_get_entry(enum pipe_format format, unsigned width)
+{
+   if (width < UTIL_FORMAT_SIMD_PIXELS || !simd_enabled)
+      return NULL;
+
+   call_once(&simd_once_flag, simd_init);
+   return &simd_table[format];
+}
+
+/**
+ * Run \p func over all rows.  Each row is split into a part the kernel can
+ * process in place and a tail which goes through zero-padded temporaries.
+ */
+static void
+simd_run(util_format_simd_row_func func,
+         const struct util_format_simd_layout *layout,
+         uint8_t *dst_row, unsigned dst_stride, unsigned dst_cpp,
+         const uint8_t *src_row, unsigned src_stride, unsigned src_cpp,
+         unsigned width, unsigned height)
+{
+   const unsigned body = width & ~(UTIL_FORMAT_SIMD_PIXELS - 1);
+   const unsigned tail = width - body;
+
+   for (unsigned y = 0; y < height; y++) {
+      func(dst_row, src_row, body, layout);
+
+      if (tail) {
+         uint8_t src_tmp[UTIL_FORMAT_SIMD_PIXELS * 16];
+         uint8_t dst_tmp[UTIL_FORMAT_SIMD_PIXELS * 16];
+
+         memset(src_tmp, 0, sizeof(src_tmp));
+         memcpy(src_tmp, src_row + body * src_cpp, tail * src_cpp);
+         func(dst_tmp, src_tmp, UTIL_FORMAT_SIMD_PIXELS, layout);
+         memcpy(dst_row + body * dst_cpp, dst_tmp, tail * dst_cpp);
+      }
+
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+}
+
+bool
+util_format_simd_unpack_rgba_8unorm(enum pipe_format format,
+                                    uint8_t *dst_row, unsigned dst_stride,
+                                    const uint8_t *src_row, unsigned src_stride,
+                                    unsigned width, unsigned height)
+{
+   const struct simd_entry *entry = simd_get_entry(format, width);
+
+   if (!entry || !entry->kernels.unpack_rgba_8unorm)
+      return false;
+
+   simd_run(entry->kernels.unpack_rgba_8unorm, &entry->layout,
+            dst_row, dst_stride, 4,
+            src_row, src_stride, entry->layout.block_bits / 8,
+            width, height);
+   return true;
+}
+
+bool
+util_format_simd_pack_rgba_8unorm(enum pipe_format format,
+                                  uint8_t *dst_row, unsigned dst_stride,
+                                  const uint8_t *src_row, unsigned src_stride,
+                                  unsigned width, unsigned height)
+{
+   const struct simd_entry *entry = simd_get_entry(format, width);
+
+   if (!entry || !entry->kernels.pack_rgba_8unorm)
+      return false;
+
+   simd_run(entry->kernels.pack_rgba_8unorm, &entry->layout,
+            dst_row, dst_stride, entry->layout.block_bits / 8,
+            src_row, src_stride, 4,
+            width, height);
+   return true;
+}
+
+bool
+util_format_simd_unpack_rgba_float(enum pipe_format format,
+                                   void *dst_row, unsigned dst_stride,
+                                   const uint8_t *src_row, unsigned src_stride,
+                                   unsigned width, unsigned height)
+{
+   const struct simd_entry *entry = simd_get_entry(format, width);
+
+   if (!entry || !entry->kernels.unpack_rgba_float)
+      return false;
+
+   simd_run(entry->kernels.unpack_rgba_float, &entry->layout,
+            dst_row, dst_stride, 4 * sizeof(float),
+            src_row, src_stride, entry->layout.block_bits / 8,
+            width, height);
+   return true;
+}
+
+bool
+util_format_simd_pack_rgba_float(enum pipe_format format,
+                                 uint8_t *dst_row, unsigned dst_stride,
+                                 const float *src_row, unsigned src_stride,
+                                 unsigned width, unsigned height)
+{
+   const struct simd_entry *entry = simd_get_entry(format, width);
+
+   if (!entry || !entry->kernels.pack_rgba_float)
+      return false;
+
+   simd_run(entry->kernels.pack_rgba_float, &entry->layout,
+            dst_row, dst_stride, entry->layout.block_bits / 8,
+            (const uint8_t *)src_row, src_stride, 4 * sizeof(float),
+            width, height);
+   return true;
+}
+
+bool
+util_format_simd_unpack_z_float(enum pipe_format format,
+                                float *dst_row, unsigned dst_stride,
+                                const uint8_t *src_row, unsigned src_stride,
+                                unsigned width, unsigned height)
+{
+   const struct simd_entry *entry = simd_get_entry(format, width);
+
+   if (!entry || !entry->kernels.unpack_z_float)
+      return false;
+
+   simd_run(entry->kernels.unpack_z_float, &entry->layout,
+            (uint8_t *)dst_row, dst_stride, sizeof(float),
+            src_row, src_stride, entry->layout.block_bits / 8,
+            width, height);
+   return true;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * SIMD row kernels for the most common plain formats.
+ *
+ * The generated (and some hand-written) pack/unpack functions first try the
+ * util_format_simd_* entrypoints below, which return false if there is no
+ * kernel for the format on this CPU, or if the rows are too short to be
+ * worth it.  The kernels are picked at runtime from util_cpu_caps and give
+ * bit-identical results to the C code they replace.
+ *
+ * Kernels are only used on little-endian hosts.
+ */
+
+#ifndef U_FORMAT_SIMD_H
+#define U_FORMAT_SIMD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pipe/p_config.h"
+#include "pipe/p_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(USE_SSE41) && defined(PIPE_ARCH_X86_64)
+#define UTIL_FORMAT_SIMD_X86
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define UTIL_FORMAT_SIMD_NEON
+#endif
+
+bool
+util_format_simd_unpack_rgba_8unorm(enum pipe_format format,
+                                    uint8_t *dst_row, unsigned dst_stride,
+                                    const uint8_t *src_row, unsigned src_stride,
+                                    unsigned width, unsigned height);
+
+bool
+util_format_simd_pack_rgba_8unorm(enum pipe_format format,
+                                  uint8_t *dst_row, unsigned dst_stride,
+                                  const uint8_t *src_row, unsigned src_stride,
+                                  unsigned width, unsigned height);
+
+bool
+util_format_simd_unpack_rgba_float(enum pipe_format format,
+                                   void *dst_row, unsigned dst_stride,
+                                   const uint8_t *src_row, unsigned src_stride,
+                                   unsigned width, unsigned height);
+
+bool
+util_format_simd_pack_rgba_float(enum pipe_format format,
+                                 uint8_t *dst_row, unsigned dst_stride,
+                                 const float *src_row, unsigned src_stride,
+                                 unsigned width, unsigned height);
+
+bool
+util_format_simd_unpack_z_float(enum pipe_format format,
+                                float *dst_row, unsigned dst_stride,
+                                const uint8_t *src_row, unsigned src_stride,
+                                unsigned width, unsigned height);
+
+/**
+ * Enable or disable the SIMD kernels (enabled by default), so that tests and
+ * benchmarks can compare them against the C code.
+ */
+void
+util_format_simd_set_enabled(bool enabled);
+
+
+/*
+ * Backend interface.
+ */
+
+/* Kernels process a multiple of this many pixels. */
+#define UTIL_FORMAT_SIMD_PIXELS 16
+
+/**
+ * Where the RGBA (or, for depth formats, Z) channels live in a pixel.
+ * A size of 0 means the channel reads as one and isn't stored.
+ */
+struct util_format_simd_layout {
+   unsigned block_bits;
+   uint8_t shift[4];
+   uint8_t size[4];
+};
+
+enum util_format_simd_class {
+   UTIL_FORMAT_SIMD_RGBA8,     /* 8-bit unorm channels in a 32-bit pixel */
+   UTIL_FORMAT_SIMD_PACKED16,  /* unorm bitfields in a 16-bit pixel */
+   UTIL_FORMAT_SIMD_PACKED32,  /* unorm bitfields in a 32-bit pixel */
+   UTIL_FORMAT_SIMD_DEPTH,     /* 16-bit or 24-bit unorm Z */
+   UTIL_FORMAT_SIMD_NUM_CLASSES,
+};
+
+typedef void
+(*util_format_simd_row_func)(void *dst, const void *src, unsigned width,
+                             const struct util_format_simd_layout *layout);
+
+struct util_format_simd_kernels {
+   util_format_simd_row_func unpack_rgba_8unorm;
+   util_format_simd_row_func pack_rgba_8unorm;
+   util_format_simd_row_func unpack_rgba_float;
+   util_format_simd_row_func pack_rgba_float;
+   util_format_simd_row_func unpack_z_float;
+};
+
+/* Each backend fills in the kernels it has, overriding earlier ones. */
+#ifdef UTIL_FORMAT_SIMD_X86
+void
+util_format_simd_get_kernels_sse41(struct util_format_simd_kernels *kernels);
+void
+util_format_simd_get_kernels_avx2(struct util_format_simd_kernels *kernels);
+#endif
+
+#ifdef UTIL_FORMAT_SIMD_NEON
+void
+util_format_simd_get_kernels_neon(struct util_format_simd_kernels *kernels);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_FORMAT_SIMD_H */
@@ -0,0 +1,180 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * aarch64 NEON format kernels.
+ *
+ * Only conversions that are a shuffle or a single multiply are done here:
+ * the C code for float -> unorm has a multiply followed by an add, which the
+ * compiler may or may not contract into an FMA, so a vector version couldn't
+ * be guaranteed to match it.
+ */
+
+#include "util/format/u_format_simd.h"
+
+#ifdef UTIL_FORMAT_SIMD_NEON
+
+#include <arm_neon.h>
+#include <string.h>
+
+/* tbl masks for converting four pixels between the memory layout and RGBA8,
+ * like the pshufb masks in u_format_simd_x86.c.  Out of range indices read
+ * as zero.
+ */
+static void
+rgba8_unpack_mask(const struct util_format_simd_layout *layout,
+                  uint8_t mask[16], uint8_t one[16])
+{
+   for (unsigned p = 0; p < 4; p++) {
+      for (unsigned c = 0; c < 4; c++) {
+         if (layout->size[c]) {
+            mask[p * 4 + c] = p * 4 + layout->shift[c] / 8;
+            one[p * 4 + c] = 0;
+         } else {
+            mask[p * 4 + c] = 0xff;
+            one[p * 4 + c] = 0xff;
+         }
+      }
+   }
+}
+
+static void
+rgba8_pack_mask(const struct util_format_simd_layout *layout,
+                uint8_t mask[16])
+{
+   memset(mask, 0xff, 16);
+   for (unsigned p = 0; p < 4; p++) {
+      for (unsigned c = 0; c < 4; c++) {
+         if (layout->size[c])
+            mask[p * 4 + layout->shift[c] / 8] = p * 4 + c;
+      }
+   }
+}
+
+static void
+rgba8_unpack_rgba_8unorm_neon(void *dst, const void *src, unsigned width,
+                              const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16], one_bytes[16];
+   rgba8_unpack_mask(layout, mask_bytes, one_bytes);
+   const uint8x16_t mask = vld1q_u8(mask_bytes);
+   const uint8x16_t one = vld1q_u8(one_bytes);
+
+   for (unsigned x = 0; x < width; x += 4) {
+      uint8x16_t v = vld1q_u8((const uint8_t *)src + x * 4);
+      vst1q_u8((uint8_t *)dst + x * 4, vorrq_u8(vqtbl1q_u8(v, mask), one));
+   }
+}
+
+static void
+rgba8_pack_rgba_8unorm_neon(void *dst, const void *src, unsigned width,
+                            const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16];
+   rgba8_pack_mask(layout, mask_bytes);
+   const uint8x16_t mask = vld1q_u8(mask_bytes);
+
+   for (unsigned x = 0; x < width; x += 4) {
+      uint8x16_t v = vld1q_u8((const uint8_t *)src + x * 4);
+      vst1q_u8((uint8_t *)dst + x * 4, vqtbl1q_u8(v, mask));
+   }
+}
+
+static void
+rgba8_unpack_rgba_float_neon(void *dst, const void *src, unsigned width,
+                             const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16], one_bytes[16];
+   rgba8_unpack_mask(layout, mask_bytes, one_bytes);
+   const uint8x16_t mask = vld1q_u8(mask_bytes);
+   const uint8x16_t one = vld1q_u8(one_bytes);
+   const float32x4_t scale = vdupq_n_f32(1.0f / 255.0f);
+   float *out = dst;
+
+   for (unsigned x = 0; x < width; x += 4) {
+      uint8x16_t v = vld1q_u8((const uint8_t *)src + x * 4);
+      v = vorrq_u8(vqtbl1q_u8(v, mask), one);
+
+      uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+      uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+
+      vst1q_f32(out + x * 4 + 0,
+                vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), scale));
+      vst1q_f32(out + x * 4 + 4,
+                vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), scale));
+      vst1q_f32(out + x * 4 + 8,
+                vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), scale));
+      vst1q_f32(out + x * 4 + 12,
+                vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), scale));
+   }
+}
+
+static void
+depth_unpack_z_float_neon(void *dst, const void *src, unsigned width,
+                          const struct util_format_simd_layout *layout)
+{
+   float *out = dst;
+
+   if (layout->block_bits == 16) {
+      /* z16_unorm_to_z32_float() */
+      const float32x4_t scale = vdupq_n_f32((float)(1.0 / 0xffff));
+
+      for (unsigned x = 0; x < width; x += 8) {
+         uint16x8_t v = vld1q_u16((const uint16_t *)src + x);
+
+         vst1q_f32(out + x,
+                   vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), scale));
+         vst1q_f32(out + x + 4,
+                   vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), scale));
+      }
+   } else {
+      /* z24_unorm_to_z32_float() */
+      const int32x4_t shift = vdupq_n_s32(-(int)layout->shift[0]);
+      const float64x2_t scale = vdupq_n_f64(1.0 / 0xffffff);
+
+      for (unsigned x = 0; x < width; x += 4) {
+         uint32x4_t v = vld1q_u32((const uint32_t *)src + x);
+         v = vandq_u32(vshlq_u32(v, shift), vdupq_n_u32(0xffffff));
+
+         float64x2_t lo = vmulq_f64(vcvtq_f64_u64(vmovl_u32(vget_low_u32(v))), scale);
+         float64x2_t hi = vmulq_f64(vcvtq_f64_u64(vmovl_u32(vget_high_u32(v))), scale);
+         vst1q_f32(out + x, vcvt_high_f32_f64(vcvt_f32_f64(lo), hi));
+      }
+   }
+}
+
+void
+util_format_simd_get_kernels_neon(struct util_format_simd_kernels *kernels)
+{
+   struct util_format_simd_kernels *k;
+
+   k = &kernels[UTIL_FORMAT_SIMD_RGBA8];
+   k->unpack_rgba_8unorm = rgba8_unpack_rgba_8unorm_neon;
+   k->pack_rgba_8unorm = rgba8_pack_rgba_8unorm_neon;
+   k->unpack_rgba_float = rgba8_unpack_rgba_float_neon;
+
+   k = &kernels[UTIL_FORMAT_SIMD_DEPTH];
+   k->unpack_z_float = depth_unpack_z_float_neon;
+}
+
+#endif /* UTIL_FORMAT_SIMD_NEON */
@@ -0,0 +1,483 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * SSE4.1 and AVX2 format kernels.  The functions are compiled with target
+ * attributes and only selected at runtime, so this file doesn't need any
+ * special compiler flags.
+ *
+ * All of these must match the generated C code (see u_format_pack.py and
+ * u_format_zs.c) bit for bit:
+ *
+ *  - unorm -> unorm8 is x * 0xff / max, which is done with a multiply-high
+ *    that gives the same truncated result for every input;
+ *  - unorm -> float is x * (1.0f / max) in single precision, except for
+ *    24-bit depth, which is done in double precision;
+ *  - float -> unorm8 is float_to_ubyte(), and float -> other unorms is
+ *    util_iround(CLAMP(f, 0, 1) * max), i.e. (int)(f * max + 0.5f) on
+ *    x86-64.  max/min with the input as first operand turn NaNs into 0,
+ *    like CLAMP().
+ *
+ * Bitfield -> float unpacking and RGBA8 -> 16-bit packing are left to the C
+ * code, which the compiler already vectorizes about as well.
+ */
+
+#include "util/format/u_format_simd.h"
+
+#ifdef UTIL_FORMAT_SIMD_X86
+
+#include <immintrin.h>
+#include <string.h>
+
+#include "util/macros.h"
+
+#define SSE41 __attribute__((target("ssse3,sse4.1")))
+#define AVX2 __attribute__((target("avx2")))
+
+/* Multipliers such that mulhi(x << shift, mul) == x * 0xff / (2^size - 1)
+ * for every size-bit x.
+ */
+static const struct {
+   uint8_t shift;
+   uint16_t mul;
+} unorm8_scale[9] = {
+   [1] = { 15, 510 },
+   [2] = { 14, 340 },
+   [3] = { 12, 583 },
+   [4] = { 12, 272 },
+   [5] = { 9, 1053 },
+   [6] = { 6, 4145 },
+   [7] = { 3, 16449 },
+   [8] = { 8, 256 },
+};
+
+static inline float
+unorm_max(unsigned size)
+{
+   return (float)((1u << size) - 1);
+}
+
+/* pshufb masks for converting four pixels between the memory layout and
+ * RGBA8.
+ */
+static void
+rgba8_unpack_mask(const struct util_format_simd_layout *layout,
+                  uint8_t mask[16], uint8_t one[16])
+{
+   for (unsigned p = 0; p < 4; p++) {
+      for (unsigned c = 0; c < 4; c++) {
+         if (layout->size[c]) {
+            mask[p * 4 + c] = p * 4 + layout->shift[c] / 8;
+            one[p * 4 + c] = 0;
+         } else {
+            mask[p * 4 + c] = 0x80;
+            one[p * 4 + c] = 0xff;
+         }
+      }
+   }
+}
+
+static void
+rgba8_pack_mask(const struct util_format_simd_layout *layout,
+                uint8_t mask[16])
+{
+   memset(mask, 0x80, 16);
+   for (unsigned p = 0; p < 4; p++) {
+      for (unsigned c = 0; c < 4; c++) {
+         if (layout->size[c])
+            mask[p * 4 + layout->shift[c] / 8] = p * 4 + c;
+      }
+   }
+}
+
+static inline SSE41 __m128i
+load_mask(const uint8_t mask[16])
+{
+   return _mm_loadu_si128((const __m128i *)mask);
+}
+
+/* float_to_ubyte() of four floats, in the low byte of each 32-bit lane. */
+static inline SSE41 __m128i
+float_to_ubyte_sse41(__m128 f)
+{
+   f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+   f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f / 256.0f)),
+                  _mm_set1_ps(32768.0f));
+   return _mm_and_si128(_mm_castps_si128(f), _mm_set1_epi32(0xff));
+}
+
+/* util_iround(CLAMP(f, 0, 1) * max) */
+static inline SSE41 __m128i
+float_to_unorm_sse41(__m128 f, float max)
+{
+   f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+   f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(max)), _mm_set1_ps(0.5f));
+   return _mm_cvttps_epi32(f);
+}
+
+
+/*
+ * RGBA8
+ */
+
+static SSE41 void
+rgba8_unpack_rgba_8unorm_sse41(void *dst, const void *src, unsigned width,
+                               const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16], one_bytes[16];
+   rgba8_unpack_mask(layout, mask_bytes, one_bytes);
+   const __m128i mask = load_mask(mask_bytes);
+   const __m128i one = load_mask(one_bytes);
+
+   for (unsigned x = 0; x < width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 4));
+      v = _mm_or_si128(_mm_shuffle_epi8(v, mask), one);
+      _mm_storeu_si128((__m128i *)((uint8_t *)dst + x * 4), v);
+   }
+}
+
+static SSE41 void
+rgba8_pack_rgba_8unorm_sse41(void *dst, const void *src, unsigned width,
+                             const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16];
+   rgba8_pack_mask(layout, mask_bytes);
+   const __m128i mask = load_mask(mask_bytes);
+
+   for (unsigned x = 0; x < width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 4));
+      _mm_storeu_si128((__m128i *)((uint8_t *)dst + x * 4),
+                       _mm_shuffle_epi8(v, mask));
+   }
+}
+
+static SSE41 void
+rgba8_unpack_rgba_float_sse41(void *dst, const void *src, unsigned width,
+                              const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16], one_bytes[16];
+   rgba8_unpack_mask(layout, mask_bytes, one_bytes);
+   const __m128i mask = load_mask(mask_bytes);
+   const __m128i one = load_mask(one_bytes);
+   const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+   float *out = dst;
+
+   for (unsigned x = 0; x < width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 4));
+      v = _mm_or_si128(_mm_shuffle_epi8(v, mask), one);
+
+      _mm_storeu_ps(out + x * 4 + 0,
+                    _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)), scale));
+      _mm_storeu_ps(out + x * 4 + 4,
+                    _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4))), scale));
+      _mm_storeu_ps(out + x * 4 + 8,
+                    _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8))), scale));
+      _mm_storeu_ps(out + x * 4 + 12,
+                    _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12))), scale));
+   }
+}
+
+static SSE41 void
+rgba8_pack_rgba_float_sse41(void *dst, const void *src, unsigned width,
+                            const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16];
+   rgba8_pack_mask(layout, mask_bytes);
+   const __m128i mask = load_mask(mask_bytes);
+   const float *in = src;
+
+   for (unsigned x = 0; x < width; x += 4) {
+      __m128i p0 = float_to_ubyte_sse41(_mm_loadu_ps(in + x * 4 + 0));
+      __m128i p1 = float_to_ubyte_sse41(_mm_loadu_ps(in + x * 4 + 4));
+      __m128i p2 = float_to_ubyte_sse41(_mm_loadu_ps(in + x * 4 + 8));
+      __m128i p3 = float_to_ubyte_sse41(_mm_loadu_ps(in + x * 4 + 12));
+      __m128i v = _mm_packus_epi16(_mm_packus_epi32(p0, p1),
+                                   _mm_packus_epi32(p2, p3));
+
+      _mm_storeu_si128((__m128i *)((uint8_t *)dst + x * 4),
+                       _mm_shuffle_epi8(v, mask));
+   }
+}
+
+static AVX2 void
+rgba8_unpack_rgba_float_avx2(void *dst, const void *src, unsigned width,
+                             const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16], one_bytes[16];
+   rgba8_unpack_mask(layout, mask_bytes, one_bytes);
+   const __m128i mask = _mm_loadu_si128((const __m128i *)mask_bytes);
+   const __m128i one = _mm_loadu_si128((const __m128i *)one_bytes);
+   const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+   float *out = dst;
+
+   for (unsigned x = 0; x < width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 4));
+      v = _mm_or_si128(_mm_shuffle_epi8(v, mask), one);
+
+      __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+      __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+      _mm256_storeu_ps(out + x * 4 + 0, _mm256_mul_ps(lo, scale));
+      _mm256_storeu_ps(out + x * 4 + 8, _mm256_mul_ps(hi, scale));
+   }
+}
+
+static inline AVX2 __m256i
+float_to_ubyte_avx2(__m256 f)
+{
+   f = _mm256_min_ps(_mm256_max_ps(f, _mm256_setzero_ps()),
+                     _mm256_set1_ps(1.0f));
+   f = _mm256_add_ps(_mm256_mul_ps(f, _mm256_set1_ps(255.0f / 256.0f)),
+                     _mm256_set1_ps(32768.0f));
+   return _mm256_and_si256(_mm256_castps_si256(f), _mm256_set1_epi32(0xff));
+}
+
+static AVX2 void
+rgba8_pack_rgba_float_avx2(void *dst, const void *src, unsigned width,
+                           const struct util_format_simd_layout *layout)
+{
+   uint8_t mask_bytes[16];
+   rgba8_pack_mask(layout, mask_bytes);
+   const __m256i mask =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)mask_bytes));
+   /* The 128-bit lanes of the packs below leave pixels 0, 2, 4, 6 in the
+    * low lane and 1, 3, 5, 7 in the high one.
+    */
+   const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+   const float *in = src;
+
+   for (unsigned x = 0; x < width; x += 8) {
+      __m256i p0 = float_to_ubyte_avx2(_mm256_loadu_ps(in + x * 4 + 0));
+      __m256i p1 = float_to_ubyte_avx2(_mm256_loadu_ps(in + x * 4 + 8));
+      __m256i p2 = float_to_ubyte_avx2(_mm256_loadu_ps(in + x * 4 + 16));
+      __m256i p3 = float_to_ubyte_avx2(_mm256_loadu_ps(in + x * 4 + 24));
+      __m256i v = _mm256_packus_epi16(_mm256_packus_epi32(p0, p1),
+                                      _mm256_packus_epi32(p2, p3));
+
+      v = _mm256_permutevar8x32_epi32(v, order);
+      _mm256_storeu_si256((__m256i *)((uint8_t *)dst + x * 4),
+                          _mm256_shuffle_epi8(v, mask));
+   }
+}
+
+
+/*
+ * PACKED16
+ */
+
+/* Channel c of eight 16-bit pixels, as x * 0xff / max. */
+static inline SSE41 __m128i
+packed16_channel_8unorm(__m128i v, const struct util_format_simd_layout *layout,
+                        unsigned c)
+{
+   const unsigned size = layout->size[c];
+
+   if (!size)
+      return _mm_set1_epi16(0xff);
+
+   __m128i x = _mm_srl_epi16(v, _mm_cvtsi32_si128(layout->shift[c]));
+   x = _mm_and_si128(x, _mm_set1_epi16((1 << size) - 1));
+   x = _mm_sll_epi16(x, _mm_cvtsi32_si128(unorm8_scale[size].shift));
+   return _mm_mulhi_epu16(x, _mm_set1_epi16(unorm8_scale[size].mul));
+}
+
+static SSE41 void
+packed16_unpack_rgba_8unorm_sse41(void *dst, const void *src, unsigned width,
+                                  const struct util_format_simd_layout *layout)
+{
+   for (unsigned x = 0; x < width; x += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 2));
+      __m128i r = packed16_channel_8unorm(v, layout, 0);
+      __m128i g = packed16_channel_8unorm(v, layout, 1);
+      __m128i b = packed16_channel_8unorm(v, layout, 2);
+      __m128i a = packed16_channel_8unorm(v, layout, 3);
+      __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+      __m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+      uint8_t *out = (uint8_t *)dst + x * 4;
+
+      _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(rg, ba));
+      _mm_storeu_si128((__m128i *)(out + 16), _mm_unpackhi_epi16(rg, ba));
+   }
+}
+
+/* Four RGBA float pixels to four 32-bit lanes of packed pixels. */
+static inline SSE41 __m128i
+packed_pack_float4(const float *in, const struct util_format_simd_layout *layout)
+{
+   __m128 ch[4] = {
+      _mm_loadu_ps(in + 0),
+      _mm_loadu_ps(in + 4),
+      _mm_loadu_ps(in + 8),
+      _mm_loadu_ps(in + 12),
+   };
+   __m128i v = _mm_setzero_si128();
+
+   _MM_TRANSPOSE4_PS(ch[0], ch[1], ch[2], ch[3]);
+
+   for (unsigned c = 0; c < 4; c++) {
+      const unsigned size = layout->size[c];
+
+      if (!size)
+         continue;
+
+      __m128i x = float_to_unorm_sse41(ch[c], unorm_max(size));
+      v = _mm_or_si128(v, _mm_sll_epi32(x, _mm_cvtsi32_si128(layout->shift[c])));
+   }
+
+   return v;
+}
+
+static SSE41 void
+packed16_pack_rgba_float_sse41(void *dst, const void *src, unsigned width,
+                               const struct util_format_simd_layout *layout)
+{
+   for (unsigned x = 0; x < width; x += 8) {
+      const float *in = (const float *)src + x * 4;
+      __m128i lo = packed_pack_float4(in, layout);
+      __m128i hi = packed_pack_float4(in + 16, layout);
+
+      _mm_storeu_si128((__m128i *)((uint8_t *)dst + x * 2),
+                       _mm_packus_epi32(lo, hi));
+   }
+}
+
+
+/*
+ * PACKED32
+ */
+
+static SSE41 void
+packed32_pack_rgba_float_sse41(void *dst, const void *src, unsigned width,
+                               const struct util_format_simd_layout *layout)
+{
+   for (unsigned x = 0; x < width; x += 4) {
+      __m128i v = packed_pack_float4((const float *)src + x * 4, layout);
+      _mm_storeu_si128((__m128i *)((uint8_t *)dst + x * 4), v);
+   }
+}
+
+
+/*
+ * DEPTH
+ */
+
+static SSE41 void
+depth_unpack_z_float_sse41(void *dst, const void *src, unsigned width,
+                           const struct util_format_simd_layout *layout)
+{
+   float *out = dst;
+
+   if (layout->block_bits == 16) {
+      /* z16_unorm_to_z32_float() */
+      const __m128 scale = _mm_set1_ps((float)(1.0 / 0xffff));
+
+      for (unsigned x = 0; x < width; x += 8) {
+         __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 2));
+         __m128 lo = _mm_cvtepi32_ps(_mm_cvtepu16_epi32(v));
+         __m128 hi = _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+
+         _mm_storeu_ps(out + x, _mm_mul_ps(lo, scale));
+         _mm_storeu_ps(out + x + 4, _mm_mul_ps(hi, scale));
+      }
+   } else {
+      /* z24_unorm_to_z32_float() */
+      const __m128i shift = _mm_cvtsi32_si128(layout->shift[0]);
+      const __m128d scale = _mm_set1_pd(1.0 / 0xffffff);
+
+      for (unsigned x = 0; x < width; x += 4) {
+         __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 4));
+         v = _mm_and_si128(_mm_srl_epi32(v, shift), _mm_set1_epi32(0xffffff));
+
+         __m128 lo = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(v), scale));
+         __m128 hi = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)),
+                                             scale));
+         _mm_storeu_ps(out + x, _mm_movelh_ps(lo, hi));
+      }
+   }
+}
+
+static AVX2 void
+depth_unpack_z_float_avx2(void *dst, const void *src, unsigned width,
+                          const struct util_format_simd_layout *layout)
+{
+   float *out = dst;
+
+   if (layout->block_bits == 16) {
+      const __m256 scale = _mm256_set1_ps((float)(1.0 / 0xffff));
+
+      for (unsigned x = 0; x < width; x += 8) {
+         __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 2));
+         __m256 z = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v));
+
+         _mm256_storeu_ps(out + x, _mm256_mul_ps(z, scale));
+      }
+   } else {
+      const __m128i shift = _mm_cvtsi32_si128(layout->shift[0]);
+      const __m256d scale = _mm256_set1_pd(1.0 / 0xffffff);
+
+      for (unsigned x = 0; x < width; x += 4) {
+         __m128i v = _mm_loadu_si128((const __m128i *)((const uint8_t *)src + x * 4));
+         v = _mm_and_si128(_mm_srl_epi32(v, shift), _mm_set1_epi32(0xffffff));
+
+         __m256d z = _mm256_mul_pd(_mm256_cvtepi32_pd(v), scale);
+         _mm_storeu_ps(out + x, _mm256_cvtpd_ps(z));
+      }
+   }
+}
+
+
+void
+util_format_simd_get_kernels_sse41(struct util_format_simd_kernels *kernels)
+{
+   struct util_format_simd_kernels *k;
+
+   k = &kernels[UTIL_FORMAT_SIMD_RGBA8];
+   k->unpack_rgba_8unorm = rgba8_unpack_rgba_8unorm_sse41;
+   k->pack_rgba_8unorm = rgba8_pack_rgba_8unorm_sse41;
+   k->unpack_rgba_float = rgba8_unpack_rgba_float_sse41;
+   k->pack_rgba_float = rgba8_pack_rgba_float_sse41;
+
+   k = &kernels[UTIL_FORMAT_SIMD_PACKED16];
+   k->unpack_rgba_8unorm = packed16_unpack_rgba_8unorm_sse41;
+   k->pack_rgba_float = packed16_pack_rgba_float_sse41;
+
+   k = &kernels[UTIL_FORMAT_SIMD_PACKED32];
+   k->pack_rgba_float = packed32_pack_rgba_float_sse41;
+
+   k = &kernels[UTIL_FORMAT_SIMD_DEPTH];
+   k->unpack_z_float = depth_unpack_z_float_sse41;
+}
+
+void
+util_format_simd_get_kernels_avx2(struct util_format_simd_kernels *kernels)
+{
+   struct util_format_simd_kernels *k;
+
+   k = &kernels[UTIL_FORMAT_SIMD_RGBA8];
+   k->unpack_rgba_float = rgba8_unpack_rgba_float_avx2;
+   k->pack_rgba_float = rgba8_pack_rgba_float_avx2;
+
+   k = &kernels[UTIL_FORMAT_SIMD_DEPTH];
+   k->unpack_z_float = depth_unpack_z_float_avx2;
+}
+
+#endif /* UTIL_FORMAT_SIMD_X86 */
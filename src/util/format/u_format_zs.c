@@ -27,6 +27,7 @@
 
 
 #include "util/format/u_format_zs.h"
+#include "util/format/u_format_simd.h"
 #include "util/u_math.h"
 
 
@@ -141,6 +142,10 @@ util_format_z16_unorm_unpack_z_float(float *dst_row, unsigned dst_stride,
                                      const uint8_t *src_row, unsigned src_stride,
                                      unsigned width, unsigned height)
 {
+   if (util_format_simd_unpack_z_float(PIPE_FORMAT_Z16_UNORM, dst_row, dst_stride,
+                                       src_row, src_stride, width, height))
+      return;
+
    unsigned x, y;
    for(y = 0; y < height; ++y) {
       float *dst = dst_row;
@@ -386,6 +391,10 @@ util_format_z24_unorm_s8_uint_unpack_z_float(float *dst_row, unsigned dst_stride
                                                 const uint8_t *src_row, unsigned src_stride,
                                                 unsigned width, unsigned height)
 {
+   if (util_format_simd_unpack_z_float(PIPE_FORMAT_Z24_UNORM_S8_UINT, dst_row, dst_stride,
+                                       src_row, src_stride, width, height))
+      return;
+
    unsigned x, y;
    for(y = 0; y < height; ++y) {
       float *dst = dst_row;
@@ -520,6 +529,10 @@ util_format_s8_uint_z24_unorm_unpack_z_float(float *dst_row, unsigned dst_stride
                                                 const uint8_t *src_row, unsigned src_stride,
                                                 unsigned width, unsigned height)
 {
+   if (util_format_simd_unpack_z_float(PIPE_FORMAT_S8_UINT_Z24_UNORM, dst_row, dst_stride,
+                                       src_row, src_stride, width, height))
+      return;
+
    unsigned x, y;
    for(y = 0; y < height; ++y) {
       float *dst = dst_row;
@@ -634,6 +647,10 @@ util_format_z24x8_unorm_unpack_z_float(float *dst_row, unsigned dst_stride,
                                        const uint8_t *src_row, unsigned src_stride,
                                        unsigned width, unsigned height)
 {
+   if (util_format_simd_unpack_z_float(PIPE_FORMAT_Z24X8_UNORM, dst_row, dst_stride,
+                                       src_row, src_stride, width, height))
+      return;
+
    unsigned x, y;
    for(y = 0; y < height; ++y) {
       float *dst = dst_row;
@@ -708,6 +725,10 @@ util_format_x8z24_unorm_unpack_z_float(float *dst_row, unsigned dst_stride,
                                        const uint8_t *src_row, unsigned src_stride,
                                        unsigned width, unsigned height)
 {
+   if (util_format_simd_unpack_z_float(PIPE_FORMAT_X8Z24_UNORM, dst_row, dst_stride,
+                                       src_row, src_stride, width, height))
+      return;
+
    unsigned x, y;
    for(y = 0; y < height; ++y) {
       float *dst = dst_row;
@@ -32,6 +32,21 @@
 #include "rounding.h"
 #include "softfloat.h"
 #include "macros.h"
+#include "u_cpu_detect.h"
+
+#ifdef USE_F16C
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2_HALF
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define USE_NEON_HALF
+#endif
 
 typedef union { float f; int32_t i; uint32_t u; } fi_type;
 
@@ -211,3 +226,214 @@ uint16_t _mesa_uint16_div_64k_to_half(uint16_t v)
 
    return (e << 10) | m;
 }
+
+#ifdef USE_F16C
+/* vcvtph2ps/vcvtps2ph handle NaNs differently than the scalar code (they
+ * quiet signaling NaNs and keep the float's payload), so groups containing
+ * a NaN are converted with the scalar functions.
+ */
+__attribute__((target("f16c")))
+static void
+half_to_float_array_f16c(float *dst, const uint16_t *src, size_t count)
+{
+   const __m128i abs_mask = _mm_set1_epi16(0x7fff);
+   const __m128i inf = _mm_set1_epi16(0x7c00);
+   size_t i = 0;
+
+   for (; i + 8 <= count; i += 8) {
+      __m128i h = _mm_loadu_si128((const __m128i *)(src + i));
+      __m128i nan = _mm_cmpgt_epi16(_mm_and_si128(h, abs_mask), inf);
+
+      if (unlikely(_mm_movemask_epi8(nan))) {
+         for (unsigned j = 0; j < 8; j++)
+            dst[i + j] = util_half_to_float(src[i + j]);
+         continue;
+      }
+
+      _mm_storeu_ps(dst + i, _mm_cvtph_ps(h));
+      _mm_storeu_ps(dst + i + 4, _mm_cvtph_ps(_mm_unpackhi_epi64(h, h)));
+   }
+
+   for (; i < count; i++)
+      dst[i] = util_half_to_float(src[i]);
+}
+
+__attribute__((target("f16c")))
+static void
+float_to_half_array_f16c(uint16_t *dst, const float *src, size_t count)
+{
+   size_t i = 0;
+
+   for (; i + 8 <= count; i += 8) {
+      __m128 lo = _mm_loadu_ps(src + i);
+      __m128 hi = _mm_loadu_ps(src + i + 4);
+      __m128 nan = _mm_or_ps(_mm_cmpunord_ps(lo, lo),
+                             _mm_cmpunord_ps(hi, hi));
+
+      if (unlikely(_mm_movemask_ps(nan))) {
+         for (unsigned j = 0; j < 8; j++)
+            dst[i + j] = _mesa_float_to_half(src[i + j]);
+         continue;
+      }
+
+      __m128i h = _mm_unpacklo_epi64(_mm_cvtps_ph(lo, _MM_FROUND_TO_NEAREST_INT),
+                                     _mm_cvtps_ph(hi, _MM_FROUND_TO_NEAREST_INT));
+      _mm_storeu_si128((__m128i *)(dst + i), h);
+   }
+
+   for (; i < count; i++)
+      dst[i] = _mesa_float_to_half(src[i]);
+}
+#endif /* USE_F16C */
+
+#ifdef USE_SSE2_HALF
+/* util_float_to_half_rtz() with four floats at a time. */
+static inline __m128i
+float_to_half_rtz_sse2(__m128 f)
+{
+   const __m128i f32inf = _mm_set1_epi32(0xff << 23);
+   const __m128i f16inf = _mm_set1_epi32(0x1f << 23);
+   const __m128i round_mask = _mm_set1_epi32(~0xfff);
+   const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(0xf << 23));
+
+   __m128i x = _mm_castps_si128(f);
+   __m128i sign = _mm_and_si128(x, _mm_set1_epi32(0x80000000));
+   x = _mm_xor_si128(x, sign);
+
+   __m128i is_inf = _mm_cmpeq_epi32(x, f32inf);
+   __m128i is_nan = _mm_cmpgt_epi32(x, f32inf);
+
+   __m128i v = _mm_and_si128(x, round_mask);
+   v = _mm_castps_si128(_mm_mul_ps(_mm_castsi128_ps(v), magic));
+   v = _mm_sub_epi32(v, round_mask);
+
+   /* Clamp to max finite value if overflowed. */
+   __m128i overflow = _mm_cmpgt_epi32(v, f16inf);
+   v = _mm_or_si128(_mm_andnot_si128(overflow, v),
+                    _mm_and_si128(overflow, _mm_sub_epi32(f16inf,
+                                                          _mm_set1_epi32(1))));
+   v = _mm_srli_epi32(v, 13);
+
+   v = _mm_or_si128(_mm_andnot_si128(is_inf, v),
+                    _mm_and_si128(is_inf, _mm_set1_epi32(0x7c00)));
+   v = _mm_or_si128(_mm_andnot_si128(is_nan, v),
+                    _mm_and_si128(is_nan, _mm_set1_epi32(0x7e00)));
+
+   v = _mm_or_si128(v, _mm_srli_epi32(sign, 16));
+
+   /* Sign-extend so that _mm_packs_epi32() doesn't saturate. */
+   return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+#endif
+
+#ifdef USE_NEON_HALF
+/* util_float_to_half_rtz() with four floats at a time. */
+static inline uint16x4_t
+float_to_half_rtz_neon(float32x4_t f)
+{
+   const uint32x4_t f32inf = vdupq_n_u32(0xff << 23);
+   const uint32x4_t f16inf = vdupq_n_u32(0x1f << 23);
+   const float32x4_t magic = vreinterpretq_f32_u32(vdupq_n_u32(0xf << 23));
+
+   uint32x4_t x = vreinterpretq_u32_f32(f);
+   uint32x4_t sign = vandq_u32(x, vdupq_n_u32(0x80000000));
+   x = veorq_u32(x, sign);
+
+   uint32x4_t v = vandq_u32(x, vdupq_n_u32(~0xfff));
+   v = vreinterpretq_u32_f32(vmulq_f32(vreinterpretq_f32_u32(v), magic));
+   v = vaddq_u32(v, vdupq_n_u32(0x1000));
+
+   /* Clamp to max finite value if overflowed. */
+   v = vbslq_u32(vcgtq_u32(v, f16inf), vsubq_u32(f16inf, vdupq_n_u32(1)), v);
+   v = vshrq_n_u32(v, 13);
+
+   v = vbslq_u32(vceqq_u32(x, f32inf), vdupq_n_u32(0x7c00), v);
+   v = vbslq_u32(vcgtq_u32(x, f32inf), vdupq_n_u32(0x7e00), v);
+
+   v = vorrq_u32(v, vshrq_n_u32(sign, 16));
+
+   return vmovn_u32(v);
+}
+#endif
+
+void
+_mesa_float_to_half_array(uint16_t *dst, const float *src, size_t count)
+{
+   size_t i = 0;
+
+#if defined(USE_F16C)
+   util_cpu_detect();
+   if (util_cpu_caps.has_f16c) {
+      float_to_half_array_f16c(dst, src, count);
+      return;
+   }
+#elif defined(USE_NEON_HALF)
+   for (; i + 4 <= count; i += 4) {
+      float32x4_t f = vld1q_f32(src + i);
+      uint32x4_t x = vandq_u32(vreinterpretq_u32_f32(f),
+                               vdupq_n_u32(0x7fffffff));
+
+      /* FCVT quiets signaling NaNs, unlike the scalar code. */
+      if (unlikely(vmaxvq_u32(x) > 0x7f800000)) {
+         for (unsigned j = 0; j < 4; j++)
+            dst[i + j] = _mesa_float_to_half(src[i + j]);
+         continue;
+      }
+
+      vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(f)));
+   }
+#endif
+
+   for (; i < count; i++)
+      dst[i] = _mesa_float_to_half(src[i]);
+}
+
+void
+_mesa_float_to_half_rtz_array(uint16_t *dst, const float *src, size_t count)
+{
+   size_t i = 0;
+
+#if defined(USE_SSE2_HALF)
+   for (; i + 8 <= count; i += 8) {
+      __m128i lo = float_to_half_rtz_sse2(_mm_loadu_ps(src + i));
+      __m128i hi = float_to_half_rtz_sse2(_mm_loadu_ps(src + i + 4));
+      _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+   }
+#elif defined(USE_NEON_HALF)
+   for (; i + 4 <= count; i += 4)
+      vst1_u16(dst + i, float_to_half_rtz_neon(vld1q_f32(src + i)));
+#endif
+
+   for (; i < count; i++)
+      dst[i] = util_float_to_half_rtz(src[i]);
+}
+
+void
+_mesa_half_to_float_array(float *dst, const uint16_t *src, size_t count)
+{
+   size_t i = 0;
+
+#if defined(USE_F16C)
+   util_cpu_detect();
+   if (util_cpu_caps.has_f16c) {
+      half_to_float_array_f16c(dst, src, count);
+      return;
+   }
+#elif defined(USE_NEON_HALF)
+   for (; i + 4 <= count; i += 4) {
+      uint16x4_t h = vld1_u16(src + i);
+
+      /* FCVT quiets signaling NaNs, unlike the scalar code. */
+      if (unlikely(vmaxv_u16(vand_u16(h, vdup_n_u16(0x7fff))) > 0x7c00)) {
+         for (unsigned j = 0; j < 4; j++)
+            dst[i + j] = util_half_to_float(src[i + j]);
+         continue;
+      }
+
+      vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(h)));
+   }
+#endif
+
+   for (; i < count; i++)
+      dst[i] = util_half_to_float(src[i]);
+}
@@ -27,6 +27,7 @@
 #define _HALF_FLOAT_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -55,6 +56,22 @@ _mesa_float_to_float16_rtne(float val)
    return _mesa_float_to_half(val);
 }
 
+/*
+ * Bulk conversions of \p count values.  These give exactly the same results
+ * as calling the scalar function on every element, but use F16C on x86 and
+ * the FCVT instructions on aarch64 when available.
+ *
+ * _mesa_float_to_half_array() converts like _mesa_float_to_half(), and
+ * _mesa_half_to_float_array() like _mesa_half_to_float().
+ * _mesa_float_to_half_rtz_array() converts like util_float_to_half_rtz()
+ * from u_half.h (clamping overflows to the largest finite value), which is
+ * what the generated format packing code uses.
+ */
+void _mesa_float_to_half_array(uint16_t *dst, const float *src, size_t count);
+void _mesa_float_to_half_rtz_array(uint16_t *dst, const float *src,
+                                   size_t count);
+void _mesa_half_to_float_array(float *dst, const uint16_t *src, size_t count);
+
 static inline bool
 _mesa_half_is_negative(uint16_t h)
 {
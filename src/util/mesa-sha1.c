@@ -24,8 +24,273 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "sha1/sha1.h"
 #include "mesa-sha1.h"
+#include "c11/threads.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#ifdef USE_SHA_NI
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)
+#include <arm_neon.h>
+#define USE_ARM_SHA1
+#endif
+
+/* Process \p blocks consecutive 64-byte blocks of \p data. */
+typedef void (*sha1_blocks_func)(uint32_t state[5], const uint8_t *data,
+                                 size_t blocks);
+
+static void
+sha1_blocks_c(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+   for (; blocks; blocks--, data += SHA1_BLOCK_LENGTH)
+      SHA1Transform(state, data);
+}
+
+#ifdef USE_SHA_NI
+
+/* Rounds 4k to 4k + 3 (k >= 4) of the SHA-NI block function, ping-ponging
+ * the "E" value between e_in and e_out and scheduling the message words
+ * 16 rounds ahead.  In the trailing rounds this computes a few schedule
+ * words that are never used, which the compiler drops.
+ */
+#define SHA_NI_ROUNDS4(f, e_in, e_out, m0, m1, m2, m3)                     \
+   do {                                                                     \
+      e_in = _mm_sha1nexte_epu32(e_in, m0);                                 \
+      e_out = abcd;                                                         \
+      m1 = _mm_sha1msg2_epu32(m1, m0);                                      \
+      abcd = _mm_sha1rnds4_epu32(abcd, e_in, f);                            \
+      m3 = _mm_sha1msg1_epu32(m3, m0);                                      \
+      m2 = _mm_xor_si128(m2, m0);                                           \
+   } while (0)
+
+__attribute__((target("sha,sse4.1")))
+static void
+sha1_blocks_sha_ni(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+   const __m128i bswap = _mm_set_epi64x(0x0001020304050607ull,
+                                        0x08090a0b0c0d0e0full);
+   __m128i abcd = _mm_loadu_si128((const __m128i *)state);
+   __m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+   __m128i e1, m0, m1, m2, m3;
+
+   abcd = _mm_shuffle_epi32(abcd, 0x1b);
+
+   for (; blocks; blocks--, data += SHA1_BLOCK_LENGTH) {
+      const __m128i abcd_save = abcd;
+      const __m128i e_save = e0;
+
+      m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), bswap);
+      m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 1), bswap);
+      m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 2), bswap);
+      m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 3), bswap);
+
+      /* Rounds 0-15, while the first message words are still coming in. */
+      e0 = _mm_add_epi32(e0, m0);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+      e1 = _mm_sha1nexte_epu32(e1, m1);
+      e0 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+      m0 = _mm_sha1msg1_epu32(m0, m1);
+
+      e0 = _mm_sha1nexte_epu32(e0, m2);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+      m1 = _mm_sha1msg1_epu32(m1, m2);
+      m0 = _mm_xor_si128(m0, m2);
+
+      e1 = _mm_sha1nexte_epu32(e1, m3);
+      e0 = abcd;
+      m0 = _mm_sha1msg2_epu32(m0, m3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+      m2 = _mm_sha1msg1_epu32(m2, m3);
+      m1 = _mm_xor_si128(m1, m3);
+
+      /* Rounds 16-79 */
+      SHA_NI_ROUNDS4(0, e0, e1, m0, m1, m2, m3);
+      SHA_NI_ROUNDS4(1, e1, e0, m1, m2, m3, m0);
+      SHA_NI_ROUNDS4(1, e0, e1, m2, m3, m0, m1);
+      SHA_NI_ROUNDS4(1, e1, e0, m3, m0, m1, m2);
+      SHA_NI_ROUNDS4(1, e0, e1, m0, m1, m2, m3);
+      SHA_NI_ROUNDS4(1, e1, e0, m1, m2, m3, m0);
+      SHA_NI_ROUNDS4(2, e0, e1, m2, m3, m0, m1);
+      SHA_NI_ROUNDS4(2, e1, e0, m3, m0, m1, m2);
+      SHA_NI_ROUNDS4(2, e0, e1, m0, m1, m2, m3);
+      SHA_NI_ROUNDS4(2, e1, e0, m1, m2, m3, m0);
+      SHA_NI_ROUNDS4(2, e0, e1, m2, m3, m0, m1);
+      SHA_NI_ROUNDS4(3, e1, e0, m3, m0, m1, m2);
+      SHA_NI_ROUNDS4(3, e0, e1, m0, m1, m2, m3);
+      SHA_NI_ROUNDS4(3, e1, e0, m1, m2, m3, m0);
+      SHA_NI_ROUNDS4(3, e0, e1, m2, m3, m0, m1);
+      SHA_NI_ROUNDS4(3, e1, e0, m3, m0, m1, m2);
+
+      e0 = _mm_sha1nexte_epu32(e0, e_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
+   }
+
+   abcd = _mm_shuffle_epi32(abcd, 0x1b);
+   _mm_storeu_si128((__m128i *)state, abcd);
+   state[4] = _mm_extract_epi32(e0, 3);
+}
+
+#endif /* USE_SHA_NI */
+
+#ifdef USE_ARM_SHA1
+
+/* Rounds 4k to 4k + 3 (2 <= k < 16) of the ARMv8 block function.  \p e_in
+ * is the E value for these rounds and the rotated A for the next ones goes
+ * to \p e_out.  \p wk is refilled with the words for rounds 4k + 8 onwards,
+ * and the message schedule is advanced by four words.
+ */
+#define ARM_SHA1_ROUNDS4(op, e_in, e_out, wk, k_next, m0, m1, m2, m3)        \
+   do {                                                                     \
+      e_out = vsha1h_u32(vgetq_lane_u32(abcd, 0));                          \
+      abcd = op(abcd, e_in, wk);                                            \
+      wk = vaddq_u32(m2, vdupq_n_u32(k_next));                              \
+      m3 = vsha1su1q_u32(m3, m2);                                           \
+      m0 = vsha1su0q_u32(m0, m1, m2);                                       \
+   } while (0)
+
+static void
+sha1_blocks_arm(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+   const uint32_t k0 = 0x5a827999;
+   const uint32_t k1 = 0x6ed9eba1;
+   const uint32_t k2 = 0x8f1bbcdc;
+   const uint32_t k3 = 0xca62c1d6;
+   uint32x4_t abcd = vld1q_u32(state);
+   uint32_t e0 = state[4], e1;
+   uint32x4_t m0, m1, m2, m3, wk0, wk1;
+
+   for (; blocks; blocks--, data += SHA1_BLOCK_LENGTH) {
+      const uint32x4_t abcd_save = abcd;
+      const uint32_t e_save = e0;
+
+      m0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+      m1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+      m2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+      m3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+      wk0 = vaddq_u32(m0, vdupq_n_u32(k0));
+      wk1 = vaddq_u32(m1, vdupq_n_u32(k0));
+
+      /* Rounds 0-7, while the first message words are still coming in. */
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1cq_u32(abcd, e0, wk0);
+      wk0 = vaddq_u32(m2, vdupq_n_u32(k0));
+      m0 = vsha1su0q_u32(m0, m1, m2);
+
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1cq_u32(abcd, e1, wk1);
+      wk1 = vaddq_u32(m3, vdupq_n_u32(k0));
+      m0 = vsha1su1q_u32(m0, m3);
+      m1 = vsha1su0q_u32(m1, m2, m3);
+
+      /* Rounds 8-63 */
+      ARM_SHA1_ROUNDS4(vsha1cq_u32, e0, e1, wk0, k0, m2, m3, m0, m1);
+      ARM_SHA1_ROUNDS4(vsha1cq_u32, e1, e0, wk1, k1, m3, m0, m1, m2);
+      ARM_SHA1_ROUNDS4(vsha1cq_u32, e0, e1, wk0, k1, m0, m1, m2, m3);
+      ARM_SHA1_ROUNDS4(vsha1pq_u32, e1, e0, wk1, k1, m1, m2, m3, m0);
+      ARM_SHA1_ROUNDS4(vsha1pq_u32, e0, e1, wk0, k1, m2, m3, m0, m1);
+      ARM_SHA1_ROUNDS4(vsha1pq_u32, e1, e0, wk1, k1, m3, m0, m1, m2);
+      ARM_SHA1_ROUNDS4(vsha1pq_u32, e0, e1, wk0, k2, m0, m1, m2, m3);
+      ARM_SHA1_ROUNDS4(vsha1pq_u32, e1, e0, wk1, k2, m1, m2, m3, m0);
+      ARM_SHA1_ROUNDS4(vsha1mq_u32, e0, e1, wk0, k2, m2, m3, m0, m1);
+      ARM_SHA1_ROUNDS4(vsha1mq_u32, e1, e0, wk1, k2, m3, m0, m1, m2);
+      ARM_SHA1_ROUNDS4(vsha1mq_u32, e0, e1, wk0, k2, m0, m1, m2, m3);
+      ARM_SHA1_ROUNDS4(vsha1mq_u32, e1, e0, wk1, k3, m1, m2, m3, m0);
+      ARM_SHA1_ROUNDS4(vsha1mq_u32, e0, e1, wk0, k3, m2, m3, m0, m1);
+      ARM_SHA1_ROUNDS4(vsha1pq_u32, e1, e0, wk1, k3, m3, m0, m1, m2);
+
+      /* Rounds 64-79, which only consume the remaining schedule. */
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e0, wk0);
+      wk0 = vaddq_u32(m2, vdupq_n_u32(k3));
+      m3 = vsha1su1q_u32(m3, m2);
+
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e1, wk1);
+      wk1 = vaddq_u32(m3, vdupq_n_u32(k3));
+
+      e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e0, wk0);
+
+      e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+      abcd = vsha1pq_u32(abcd, e1, wk1);
+
+      e0 += e_save;
+      abcd = vaddq_u32(abcd, abcd_save);
+   }
+
+   vst1q_u32(state, abcd);
+   state[4] = e0;
+}
+
+#endif /* USE_ARM_SHA1 */
+
+static sha1_blocks_func sha1_blocks = sha1_blocks_c;
+static once_flag sha1_once_flag = ONCE_FLAG_INIT;
+
+static void
+sha1_select_blocks_func(void)
+{
+   util_cpu_detect();
+
+#ifdef USE_SHA_NI
+   if (util_cpu_caps.has_sha1 && util_cpu_caps.has_sse4_1)
+      sha1_blocks = sha1_blocks_sha_ni;
+#endif
+#ifdef USE_ARM_SHA1
+   if (util_cpu_caps.has_sha1)
+      sha1_blocks = sha1_blocks_arm;
+#endif
+}
+
+/* Same as SHA1Update(), except that runs of whole blocks are handed to the
+ * fastest block function the CPU supports.
+ */
+void
+_mesa_sha1_update(struct mesa_sha1 *ctx, const void *data, size_t size)
+{
+   const uint8_t *bytes = data;
+   size_t used = (ctx->count >> 3) & (SHA1_BLOCK_LENGTH - 1);
+
+   call_once(&sha1_once_flag, sha1_select_blocks_func);
+
+   ctx->count += (uint64_t)size << 3;
+
+   if (used) {
+      size_t n = MIN2(SHA1_BLOCK_LENGTH - used, size);
+
+      memcpy(ctx->buffer + used, bytes, n);
+      if (used + n < SHA1_BLOCK_LENGTH)
+         return;
+
+      sha1_blocks(ctx->state, ctx->buffer, 1);
+      bytes += n;
+      size -= n;
+   }
+
+   if (size >= SHA1_BLOCK_LENGTH) {
+      size_t blocks = size / SHA1_BLOCK_LENGTH;
+
+      sha1_blocks(ctx->state, bytes, blocks);
+      bytes += blocks * SHA1_BLOCK_LENGTH;
+      size -= blocks * SHA1_BLOCK_LENGTH;
+   }
+
+   memcpy(ctx->buffer, bytes, size);
+}
 
 void
 _mesa_sha1_compute(const void *data, size_t size, unsigned char result[20])
@@ -49,3 +314,16 @@ _mesa_sha1_format(char *buf, const unsigned char *sha1)
    }
    buf[i] = '\0';
 }
+
+void
+_mesa_fast_key_compute(const void *data, size_t size,
+                       unsigned char result[20])
+{
+   const uint64_t h0 = XXH64(data, size, 0);
+   const uint64_t h1 = XXH64(data, size, 0x9e3779b97f4a7c15ull);
+   const uint32_t size32 = size;
+
+   memcpy(result, &h0, sizeof(h0));
+   memcpy(result + 8, &h1, sizeof(h1));
+   memcpy(result + 16, &size32, sizeof(size32));
+}
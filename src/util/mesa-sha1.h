@@ -39,11 +39,8 @@ _mesa_sha1_init(struct mesa_sha1 *ctx)
    SHA1Init(ctx);
 }
 
-static inline void
-_mesa_sha1_update(struct mesa_sha1 *ctx, const void *data, size_t size)
-{
-   SHA1Update(ctx, (const unsigned char *)data, size);
-}
+void
+_mesa_sha1_update(struct mesa_sha1 *ctx, const void *data, size_t size);
 
 static inline void
 _mesa_sha1_final(struct mesa_sha1 *ctx, unsigned char result[20])
@@ -57,6 +54,18 @@ _mesa_sha1_format(char *buf, const unsigned char *sha1);
 void
 _mesa_sha1_compute(const void *data, size_t size, unsigned char result[20]);
 
+/**
+ * Compute a 20-byte key for \p data from two 64-bit xxHash values and the
+ * size of the data.
+ *
+ * This is much cheaper than SHA-1, but it is not a cryptographic hash, so
+ * only use it for keys that never leave the process (e.g. the keys of an
+ * in-memory cache), never for anything that is stored on disk.
+ */
+void
+_mesa_fast_key_compute(const void *data, size_t size,
+                       unsigned char result[20]);
+
 #ifdef __cplusplus
 } /* extern C */
 #endif
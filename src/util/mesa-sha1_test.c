@@ -61,5 +61,28 @@ int main(int argc, char *argv[])
       }
    }
 
+   /* Long enough to go through the multi-block path, fed in pieces that
+    * don't line up with the block size.
+    */
+   static const char million_a_sha1[] =
+      "34aa973cd4c4daa4f61eeb2bdbad27316534016f";
+   char chunk[1000];
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char buf[41];
+
+   memset(chunk, 'a', sizeof(chunk));
+   _mesa_sha1_init(&ctx);
+   for (i = 0; i < 1000; i++)
+      _mesa_sha1_update(&ctx, chunk, sizeof(chunk));
+   _mesa_sha1_final(&ctx, sha1);
+   _mesa_sha1_format(buf, sha1);
+
+   if (memcmp(million_a_sha1, buf, SHA1_LENGTH) != 0) {
+      printf("For one million 'a':\n"
+             "\tExpected: %s\n\t     Got: %s\n", million_a_sha1, buf);
+      failed = true;
+   }
+
    return failed;
 }
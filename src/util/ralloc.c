@@ -80,12 +80,31 @@ __declspec(align(16))
    struct ralloc_header *next;
 
    void (*destructor)(void *);
+
+   /* The arena new children are allocated from, see ralloc_arena_context.
+    * The block itself lives in that arena too, unless it is its root.
+    */
+   struct ralloc_arena *arena;
 };
 
 typedef struct ralloc_header ralloc_header;
 
+/* See ralloc_arena_context. */
+struct ralloc_arena {
+   unsigned refcount;
+   ralloc_header *root;   /* the arena context, NULL once it's freed */
+   char *next, *end;      /* free space in the current page */
+   size_t page_size;      /* size of the current page */
+   struct ralloc_arena_page *pages;
+};
+
 static void unlink_block(ralloc_header *info);
 static void unsafe_free(ralloc_header *info);
+static void *arena_alloc(struct ralloc_arena *arena, size_t size);
+static void *arena_resize(ralloc_header *info, size_t size);
+static bool holds_arena_ref(ralloc_header *info);
+static void update_arena_ref(ralloc_header *info, bool had_ref);
+static void arena_unref(struct ralloc_arena *arena);
 
 static ralloc_header *
 get_header(const void *ptr)
@@ -117,17 +136,11 @@ ralloc_context(const void *ctx)
    return ralloc_size(ctx, 0);
 }
 
-void *
-ralloc_size(const void *ctx, size_t size)
+static void *
+init_block(void *block, ralloc_header *parent, struct ralloc_arena *arena)
 {
-   void *block = malloc(size + sizeof(ralloc_header));
-   ralloc_header *info;
-   ralloc_header *parent;
-
-   if (unlikely(block == NULL))
-      return NULL;
+   ralloc_header *info = (ralloc_header *) block;
 
-   info = (ralloc_header *) block;
    /* measurements have shown that calloc is slower (because of
     * the multiplication overflow checking?), so clear things
     * manually
@@ -137,8 +150,7 @@ ralloc_size(const void *ctx, size_t size)
    info->prev = NULL;
    info->next = NULL;
    info->destructor = NULL;
-
-   parent = ctx != NULL ? get_header(ctx) : NULL;
+   info->arena = arena;
 
    add_child(parent, info);
 
@@ -149,6 +161,23 @@ ralloc_size(const void *ctx, size_t size)
    return PTR_FROM_HEADER(info);
 }
 
+void *
+ralloc_size(const void *ctx, size_t size)
+{
+   ralloc_header *parent = ctx != NULL ? get_header(ctx) : NULL;
+   void *block;
+
+   if (parent && parent->arena)
+      block = arena_alloc(parent->arena, size + sizeof(ralloc_header));
+   else
+      block = malloc(size + sizeof(ralloc_header));
+
+   if (unlikely(block == NULL))
+      return NULL;
+
+   return init_block(block, parent, parent ? parent->arena : NULL);
+}
+
 void *
 rzalloc_size(const void *ctx, size_t size)
 {
@@ -165,13 +194,22 @@ static void *
 resize(void *ptr, size_t size)
 {
    ralloc_header *child, *old, *info;
+   bool is_arena_root;
 
    old = get_header(ptr);
+
+   if (old->arena && old->arena->root != old)
+      return arena_resize(old, size);
+
+   is_arena_root = old->arena != NULL;
    info = realloc(old, size + sizeof(ralloc_header));
 
    if (info == NULL)
       return NULL;
 
+   if (is_arena_root)
+      info->arena->root = info;
+
    /* Update parent and sibling's links to the reallocated node. */
    if (info != old && info->parent != NULL) {
       if (info->parent->child == old)
@@ -262,7 +300,9 @@ ralloc_free(void *ptr)
       return;
 
    info = get_header(ptr);
+   bool had_arena_ref = holds_arena_ref(info);
    unlink_block(info);
+   update_arena_ref(info, had_arena_ref);
    unsafe_free(info);
 }
 
@@ -300,7 +340,21 @@ unsafe_free(ralloc_header *info)
    if (info->destructor != NULL)
       info->destructor(PTR_FROM_HEADER(info));
 
-   free(info);
+   if (info->arena) {
+      /* Arena blocks are only released together with the arena. */
+      struct ralloc_arena *arena = info->arena;
+      bool had_arena_ref = holds_arena_ref(info);
+
+      if (arena->root == info) {
+         arena->root = NULL;
+         free(info);
+      }
+
+      if (had_arena_ref)
+         arena_unref(arena);
+   } else {
+      free(info);
+   }
 }
 
 void
@@ -314,9 +368,11 @@ ralloc_steal(const void *new_ctx, void *ptr)
    info = get_header(ptr);
    parent = new_ctx ? get_header(new_ctx) : NULL;
 
+   bool had_arena_ref = holds_arena_ref(info);
    unlink_block(info);
 
    add_child(parent, info);
+   update_arena_ref(info, had_arena_ref);
 }
 
 void
@@ -336,9 +392,13 @@ ralloc_adopt(const void *new_ctx, void *old_ctx)
 
    /* Set all the children's parent to new_ctx; get a pointer to the last child. */
    for (child = old_info->child; child->next != NULL; child = child->next) {
+      bool had_arena_ref = holds_arena_ref(child);
       child->parent = new_info;
+      update_arena_ref(child, had_arena_ref);
    }
+   bool had_arena_ref = holds_arena_ref(child);
    child->parent = new_info;
+   update_arena_ref(child, had_arena_ref);
 
    /* Connect the two lists together; parent them to new_ctx; make old_ctx empty. */
    child->next = new_info->child;
@@ -562,6 +622,193 @@ ralloc_vasprintf_rewrite_tail(char **str, size_t *start, const char *fmt,
    return true;
 }
 
+/***************************************************************************
+ * Arena contexts.
+ ***************************************************************************
+ *
+ * All descendants of an arena context are carved out of large pages with a
+ * pointer bump instead of being malloc'ed one by one. They keep the full
+ * ralloc semantics (destructors, stealing, adopting), but freeing them only
+ * unlinks them and runs destructors; their memory is released when the
+ * whole arena goes away.
+ *
+ * Blocks can be stolen out of the arena. To keep their memory valid, the
+ * arena is reference counted: the arena context itself and every arena block
+ * whose parent is not part of the same arena hold a reference.
+ */
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_MIN_PAGE_SIZE (16 * 1024)
+#define ARENA_MAX_PAGE_SIZE (1024 * 1024)
+
+/* Every block is preceded by its size, which resize() needs. */
+#define ARENA_PREFIX_SIZE ALIGN_POT(sizeof(size_t), ARENA_ALIGNMENT)
+
+struct ralloc_arena_page {
+   struct ralloc_arena_page *next;
+};
+
+#define ARENA_PAGE_HEADER_SIZE \
+   ALIGN_POT(sizeof(struct ralloc_arena_page), ARENA_ALIGNMENT)
+
+static bool
+holds_arena_ref(ralloc_header *info)
+{
+   return info->arena &&
+          (!info->parent || info->parent->arena != info->arena);
+}
+
+/* Fix up the arena reference count after info has been reparented. */
+static void
+update_arena_ref(ralloc_header *info, bool had_ref)
+{
+   bool has_ref = holds_arena_ref(info);
+
+   if (has_ref && !had_ref)
+      info->arena->refcount++;
+   else if (!has_ref && had_ref)
+      arena_unref(info->arena);
+}
+
+static void
+arena_unref(struct ralloc_arena *arena)
+{
+   assert(arena->refcount > 0);
+   if (--arena->refcount)
+      return;
+
+   while (arena->pages) {
+      struct ralloc_arena_page *page = arena->pages;
+      arena->pages = page->next;
+      free(page);
+   }
+   free(arena);
+}
+
+static char *
+arena_add_page(struct ralloc_arena *arena, size_t size)
+{
+   struct ralloc_arena_page *page = malloc(ARENA_PAGE_HEADER_SIZE + size);
+
+   if (unlikely(!page))
+      return NULL;
+
+   page->next = arena->pages;
+   arena->pages = page;
+   return (char *) page + ARENA_PAGE_HEADER_SIZE;
+}
+
+static void *
+arena_alloc(struct ralloc_arena *arena, size_t size)
+{
+   size_t full_size = ALIGN_POT(ARENA_PREFIX_SIZE + size, ARENA_ALIGNMENT);
+   char *ptr;
+
+   if (unlikely(full_size < size))
+      return NULL;
+
+   if (likely(full_size <= (size_t) (arena->end - arena->next))) {
+      ptr = arena->next;
+      arena->next += full_size;
+   } else {
+      size_t page_size = arena->page_size ?
+         MIN2(arena->page_size * 2, ARENA_MAX_PAGE_SIZE) : ARENA_MIN_PAGE_SIZE;
+
+      if (full_size > page_size / 4) {
+         /* Big blocks get their own page, keep filling the current one. */
+         ptr = arena_add_page(arena, full_size);
+         if (unlikely(!ptr))
+            return NULL;
+      } else {
+         ptr = arena_add_page(arena, page_size);
+         if (unlikely(!ptr))
+            return NULL;
+
+         arena->page_size = page_size;
+         arena->next = ptr + full_size;
+         arena->end = ptr + page_size;
+      }
+   }
+
+   *(size_t *) ptr = size;
+   return ptr + ARENA_PREFIX_SIZE;
+}
+
+static void *
+arena_resize(ralloc_header *old, size_t size)
+{
+   struct ralloc_arena *arena = old->arena;
+   char *start = (char *) old - ARENA_PREFIX_SIZE;
+   size_t old_size = *(size_t *) start;
+   size_t full_old_size = ALIGN_POT(ARENA_PREFIX_SIZE + old_size,
+                                    ARENA_ALIGNMENT);
+   size_t full_size = ALIGN_POT(ARENA_PREFIX_SIZE + sizeof(ralloc_header) +
+                                size, ARENA_ALIGNMENT);
+   ralloc_header *child, *info;
+
+   /* Shrinking, or growing the last block of the current page, is free. */
+   if (sizeof(ralloc_header) + size <= old_size ||
+       (start + full_old_size == arena->next &&
+        full_size <= (size_t) (arena->end - start))) {
+      if (sizeof(ralloc_header) + size > old_size) {
+         arena->next = start + full_size;
+         *(size_t *) start = sizeof(ralloc_header) + size;
+      }
+      return PTR_FROM_HEADER(old);
+   }
+
+   /* Moving leaves the old copy behind, so grow geometrically to keep
+    * repeated appends from wasting quadratic amounts of memory.
+    */
+   info = arena_alloc(arena, MAX2(sizeof(ralloc_header) + size, old_size * 2));
+   if (info == NULL)
+      return NULL;
+
+   memcpy(info, old, old_size);
+
+   /* Update parent and sibling's links to the reallocated node. */
+   if (info->parent != NULL) {
+      if (info->parent->child == old)
+         info->parent->child = info;
+
+      if (info->prev != NULL)
+         info->prev->next = info;
+
+      if (info->next != NULL)
+         info->next->prev = info;
+   }
+
+   /* Update child->parent links for all children */
+   for (child = info->child; child != NULL; child = child->next)
+      child->parent = info;
+
+   return PTR_FROM_HEADER(info);
+}
+
+void *
+ralloc_arena_context(const void *ctx)
+{
+   ralloc_header *parent = ctx != NULL ? get_header(ctx) : NULL;
+   struct ralloc_arena *arena;
+   void *block, *ptr;
+
+   arena = calloc(1, sizeof(*arena));
+   if (unlikely(arena == NULL))
+      return NULL;
+
+   /* The context itself is malloc'ed, even if ctx is part of an arena. */
+   block = malloc(sizeof(ralloc_header));
+   if (unlikely(block == NULL)) {
+      free(arena);
+      return NULL;
+   }
+
+   ptr = init_block(block, parent, arena);
+   arena->root = block;
+   arena->refcount = 1;
+   return ptr;
+}
+
 /***************************************************************************
  * Linear allocator for short-lived allocations.
  ***************************************************************************
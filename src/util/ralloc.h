@@ -91,6 +91,20 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new ralloc context whose descendants are allocated from an
+ * arena.
+ *
+ * Allocating from the context, or from anything allocated from it, is a
+ * pointer bump into large pages, and freeing the context releases all of
+ * them at once without walking the tree.  The usual ralloc semantics are
+ * preserved, but freeing a descendant doesn't make its memory available
+ * again; it is only released when the context and everything that was
+ * stolen out of it is gone.  Use this for contexts whose content is
+ * short-lived or freed as a whole, like the temporary context of a pass.
+ */
+void *ralloc_arena_context(const void *ctx);
+
 /**
  * Allocate memory chained off of the given context.
  *
@@ -120,15 +120,11 @@ struct ra_class {
 };
 
 struct ra_node {
-   /** @{
-    *
+   /**
     * List of which nodes this node interferes with.  This should be
     * symmetric with the other node.
     */
-   BITSET_WORD *adjacency;
-
    struct util_dynarray adjacency_list;
-   /** @} */
 
    unsigned int class;
 
@@ -138,6 +134,13 @@ struct ra_node {
    /* Register, if assigned, or NO_REG. */
    unsigned int reg;
 
+   /**
+    * Whether reg may be invalid because this node's class, interference or
+    * the forced register of a neighbor changed since the last allocation.
+    * Used by ra_allocate_incremental().
+    */
+   bool dirty;
+
    /**
     * The q total, as defined in the Runeson/Nyström paper, for all the
     * interfering nodes not in the stack.
@@ -167,6 +170,17 @@ struct ra_graph {
    struct ra_node *nodes;
    unsigned int count; /**< count of nodes. */
 
+   /**
+    * Lower-triangular interference bit-matrix, see ra_adjacency_bit().
+    *
+    * Interference is symmetric and no node interferes with itself, so only
+    * the bits for n1 > n2 are stored, each row being n1 bits long.  That
+    * halves the size of a full matrix, and as row n1 starts at bit
+    * n1 * (n1 - 1) / 2, growing the graph only appends rows for the new
+    * nodes instead of reallocating every row.
+    */
+   BITSET_WORD *adjacency;
+
    unsigned int alloc; /**< count of nodes allocated. */
 
    ra_select_reg_callback select_reg_callback;
@@ -484,10 +498,29 @@ ra_set_deserialize(void *mem_ctx, struct blob_reader *blob)
    return regs;
 }
 
+/* Number of bits in the adjacency matrix of a graph of count nodes */
+static inline uint64_t
+ra_adjacency_bits(unsigned int count)
+{
+   return (uint64_t)count * (count - 1) / 2;
+}
+
+static inline uint64_t
+ra_adjacency_bit(unsigned int n1, unsigned int n2)
+{
+   assert(n1 != n2);
+   if (n1 < n2) {
+      unsigned int tmp = n1;
+      n1 = n2;
+      n2 = tmp;
+   }
+   return ra_adjacency_bits(n1) + n2;
+}
+
 static void
 ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
-   BITSET_SET(g->nodes[n1].adjacency, n2);
+   g->nodes[n1].dirty = true;
 
    assert(n1 != n2);
 
@@ -501,8 +534,6 @@ ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 static void
 ra_node_remove_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
-   BITSET_CLEAR(g->nodes[n1].adjacency, n2);
-
    assert(n1 != n2);
 
    int n1_class = g->nodes[n1].class;
@@ -527,24 +558,24 @@ ra_realloc_interference_graph(struct ra_graph *g, unsigned int alloc)
 
    g->nodes = reralloc(g, g->nodes, struct ra_node, alloc);
 
-   unsigned g_bitset_count = BITSET_WORDS(g->alloc);
+   /* The rows of the nodes already in the graph stay where they are, so
+    * this just appends zeroed rows for the new nodes.
+    */
+   g->adjacency = rerzalloc_size(g, g->adjacency,
+      BITSET_WORDS(ra_adjacency_bits(g->alloc)) * sizeof(BITSET_WORD),
+      BITSET_WORDS(ra_adjacency_bits(alloc)) * sizeof(BITSET_WORD));
+
    unsigned bitset_count = BITSET_WORDS(alloc);
-   /* For nodes already in the graph, we just have to grow the adjacency set */
-   for (unsigned i = 0; i < g->alloc; i++) {
-      assert(g->nodes[i].adjacency != NULL);
-      g->nodes[i].adjacency = rerzalloc(g, g->nodes[i].adjacency, BITSET_WORD,
-                                        g_bitset_count, bitset_count);
-   }
 
    /* For new nodes, we have to fully initialize them */
    for (unsigned i = g->alloc; i < alloc; i++) {
       memset(&g->nodes[i], 0, sizeof(g->nodes[i]));
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
       util_dynarray_init(&g->nodes[i].adjacency_list, g);
       g->nodes[i].q_total = 0;
 
       g->nodes[i].forced_reg = NO_REG;
       g->nodes[i].reg = NO_REG;
+      g->nodes[i].dirty = true;
    }
 
    /* These are scratch values and don't need to be zeroed.  We'll clear them
@@ -598,6 +629,7 @@ ra_set_node_class(struct ra_graph *g,
                   unsigned int n, unsigned int class)
 {
    g->nodes[n].class = class;
+   g->nodes[n].dirty = true;
 }
 
 unsigned int
@@ -623,7 +655,8 @@ ra_add_node_interference(struct ra_graph *g,
                          unsigned int n1, unsigned int n2)
 {
    assert(n1 < g->count && n2 < g->count);
-   if (n1 != n2 && !BITSET_TEST(g->nodes[n1].adjacency, n2)) {
+   if (n1 != n2 && !BITSET_TEST(g->adjacency, ra_adjacency_bit(n1, n2))) {
+      BITSET_SET(g->adjacency, ra_adjacency_bit(n1, n2));
       ra_add_node_adjacency(g, n1, n2);
       ra_add_node_adjacency(g, n2, n1);
    }
@@ -633,14 +666,24 @@ void
 ra_reset_node_interference(struct ra_graph *g, unsigned int n)
 {
    util_dynarray_foreach(&g->nodes[n].adjacency_list, unsigned int, n2p) {
+      BITSET_CLEAR(g->adjacency, ra_adjacency_bit(n, *n2p));
       ra_node_remove_adjacency(g, *n2p, n);
    }
 
-   memset(g->nodes[n].adjacency, 0,
-          BITSET_WORDS(g->count) * sizeof(BITSET_WORD));
    util_dynarray_clear(&g->nodes[n].adjacency_list);
 }
 
+/**
+ * Whether ra_allocate_incremental() can keep the register the previous
+ * allocation assigned to n.
+ */
+static inline bool
+ra_node_keeps_reg(struct ra_graph *g, unsigned int n)
+{
+   return !g->nodes[n].dirty && g->nodes[n].forced_reg == NO_REG &&
+          g->nodes[n].reg != NO_REG;
+}
+
 static void
 update_pq_info(struct ra_graph *g, unsigned int n)
 {
@@ -700,9 +743,13 @@ add_node_to_stack(struct ra_graph *g, unsigned int n)
  * we optimistically choose a node and push it on the stack. We heuristically
  * push the node with the lowest total q value, since it has the fewest
  * neighbors and therefore is most likely to be allocated.
+ *
+ * If reuse_colors is set, nodes which are still validly colored from the
+ * previous allocation keep their register and are treated like nodes with a
+ * forced register.
  */
 static void
-ra_simplify(struct ra_graph *g)
+ra_simplify(struct ra_graph *g, bool reuse_colors)
 {
    bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
@@ -723,7 +770,8 @@ ra_simplify(struct ra_graph *g)
       g->tmp.min_q_node[i] = UINT_MAX;
       for (int j = high_bit; j >= 0; j--) {
          unsigned int n = i * BITSET_WORDBITS + j;
-         g->nodes[n].reg = g->nodes[n].forced_reg;
+         if (!reuse_colors || !ra_node_keeps_reg(g, n))
+            g->nodes[n].reg = g->nodes[n].forced_reg;
          g->nodes[n].tmp.q_total = g->nodes[n].q_total;
          if (g->nodes[n].reg != NO_REG)
             g->tmp.reg_assigned[i] |= BITSET_BIT(j);
@@ -926,11 +974,70 @@ ra_select(struct ra_graph *g)
    return true;
 }
 
+static void
+ra_clear_dirty(struct ra_graph *g)
+{
+   for (unsigned int n = 0; n < g->count; n++)
+      g->nodes[n].dirty = false;
+}
+
 bool
 ra_allocate(struct ra_graph *g)
 {
-   ra_simplify(g);
-   return ra_select(g);
+   ra_simplify(g, false);
+   bool ok = ra_select(g);
+   ra_clear_dirty(g);
+   return ok;
+}
+
+/**
+ * Like ra_allocate(), but keeps the registers the previous allocation of
+ * this graph assigned to nodes which haven't changed since, and only colors
+ * the nodes which were added, got new interference, or were left uncolored.
+ *
+ * This is meant for allocators which modify the graph and retry with it, for
+ * example after spilling: changes usually only affect a few nodes and their
+ * neighbors, so most of the previous coloring remains valid.
+ *
+ * If coloring just those nodes fails, their neighbors are uncolored as well
+ * and we try again.  If that fails too, or if most of the graph needs to be
+ * colored anyway, we color the whole graph like ra_allocate() does, so this
+ * never fails where ra_allocate() would succeed.
+ */
+bool
+ra_allocate_incremental(struct ra_graph *g)
+{
+   unsigned int recolor_count = 0;
+   for (unsigned int n = 0; n < g->count; n++) {
+      if (!ra_node_keeps_reg(g, n))
+         recolor_count++;
+   }
+
+   if (recolor_count > g->count / 4)
+      return ra_allocate(g);
+
+   for (unsigned int attempt = 0; attempt < 2; attempt++) {
+      ra_simplify(g, true);
+      if (ra_select(g)) {
+         ra_clear_dirty(g);
+         return true;
+      }
+
+      /* Widen the set of nodes to recolor to the neighborhood of the ones
+       * we just failed to color.  The reg_assigned set still tells which
+       * nodes kept their previous (or forced) register.
+       */
+      for (unsigned int n = 0; n < g->count; n++) {
+         if (BITSET_TEST(g->tmp.reg_assigned, n))
+            continue;
+
+         g->nodes[n].dirty = true;
+         util_dynarray_foreach(&g->nodes[n].adjacency_list, unsigned int, n2p)
+            g->nodes[*n2p].dirty = true;
+      }
+   }
+
+   return ra_allocate(g);
 }
 
 unsigned int
@@ -959,6 +1066,11 @@ void
 ra_set_node_reg(struct ra_graph *g, unsigned int n, unsigned int reg)
 {
    g->nodes[n].forced_reg = reg;
+   g->nodes[n].dirty = true;
+
+   /* The neighbors' registers may conflict with the new forced register. */
+   util_dynarray_foreach(&g->nodes[n].adjacency_list, unsigned int, n2p)
+      g->nodes[*n2p].dirty = true;
 }
 
 static float
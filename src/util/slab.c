@@ -24,6 +24,7 @@
 #include "slab.h"
 #include "macros.h"
 #include "u_atomic.h"
+#include "u_thread.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
@@ -95,6 +96,21 @@ slab_free_orphaned(struct slab_element_header *elt)
       free(page);
 }
 
+/* Take the whole migrated list of the pool. Other threads may be pushing
+ * onto it concurrently.
+ */
+static struct slab_element_header *
+slab_take_migrated(struct slab_child_pool *pool)
+{
+   struct slab_element_header *list;
+
+   do {
+      list = p_atomic_read(&pool->migrated);
+   } while (list && p_atomic_cmpxchg(&pool->migrated, list, NULL) != list);
+
+   return list;
+}
+
 /**
  * Create a parent pool for the allocation of same-sized objects.
  *
@@ -106,7 +122,7 @@ slab_create_parent(struct slab_parent_pool *parent,
                    unsigned item_size,
                    unsigned num_items)
 {
-   mtx_init(&parent->mutex, mtx_plain);
+   parent->num_remote_frees = 0;
    parent->element_size = ALIGN_POT(sizeof(struct slab_element_header) + item_size,
                                     sizeof(intptr_t));
    parent->num_elements = num_items;
@@ -115,7 +131,7 @@ slab_create_parent(struct slab_parent_pool *parent,
 void
 slab_destroy_parent(struct slab_parent_pool *parent)
 {
-   mtx_destroy(&parent->mutex);
+   assert(parent->num_remote_frees == 0);
 }
 
 /**
@@ -138,11 +154,11 @@ void slab_create_child(struct slab_child_pool *pool,
  */
 void slab_destroy_child(struct slab_child_pool *pool)
 {
+   struct slab_element_header *migrated;
+
    if (!pool->parent)
       return; /* the slab probably wasn't even created */
 
-   mtx_lock(&pool->parent->mutex);
-
    while (pool->pages) {
       struct slab_page_header *page = pool->pages;
       pool->pages = page->u.next;
@@ -154,14 +170,22 @@ void slab_destroy_child(struct slab_child_pool *pool)
       }
    }
 
-   while (pool->migrated) {
-      struct slab_element_header *elt = pool->migrated;
-      pool->migrated = elt->next;
+   /* A slab_free in another thread may have read the owner before it was
+    * changed above, and may still be about to push onto our migrated list.
+    * Wait for those to finish; later ones see the orphaned page. The
+    * compare-and-swap is a full barrier that orders this read after the
+    * stores above.
+    */
+   while (p_atomic_cmpxchg(&pool->parent->num_remote_frees, 0, 0))
+      thrd_yield();
+
+   migrated = slab_take_migrated(pool);
+   while (migrated) {
+      struct slab_element_header *elt = migrated;
+      migrated = elt->next;
       slab_free_orphaned(elt);
    }
 
-   mtx_unlock(&pool->parent->mutex);
-
    while (pool->free) {
       struct slab_element_header *elt = pool->free;
       pool->free = elt->next;
@@ -211,10 +235,7 @@ slab_alloc(struct slab_child_pool *pool)
       /* First, collect elements that belong to us but were freed from a
        * different child pool.
        */
-      mtx_lock(&pool->parent->mutex);
-      pool->free = pool->migrated;
-      pool->migrated = NULL;
-      mtx_unlock(&pool->parent->mutex);
+      pool->free = slab_take_migrated(pool);
 
       /* Now allocate a new page. */
       if (!pool->free && !slab_add_new_page(pool))
@@ -242,6 +263,7 @@ slab_alloc(struct slab_child_pool *pool)
 void slab_free(struct slab_child_pool *pool, void *ptr)
 {
    struct slab_element_header *elt = ((struct slab_element_header*)ptr - 1);
+   struct slab_parent_pool *parent = pool->parent;
    intptr_t owner_int;
 
    CHECK_MAGIC(elt, SLAB_MAGIC_ALLOCATED);
@@ -256,21 +278,30 @@ void slab_free(struct slab_child_pool *pool, void *ptr)
       return;
    }
 
-   /* The slow case: migration or an orphaned page. */
-   mtx_lock(&pool->parent->mutex);
-
-   /* Note: we _must_ re-read elt->owner here because the owning child pool
-    * may have been destroyed by another thread in the meantime.
+   /* The slow case: migration or an orphaned page.
+    *
+    * Announce the free first, so that slab_destroy_child of the owner waits
+    * for us if it races with this. We _must_ then re-read elt->owner because
+    * the owning child pool may have been destroyed by another thread in the
+    * meantime. The compare-and-swap (which never succeeds, owner is never 0)
+    * is a full barrier that orders the read after the increment.
     */
-   owner_int = p_atomic_read(&elt->owner);
+   p_atomic_inc(&parent->num_remote_frees);
+   owner_int = p_atomic_cmpxchg(&elt->owner, 0, 0);
 
    if (!(owner_int & 1)) {
       struct slab_child_pool *owner = (struct slab_child_pool *)owner_int;
-      elt->next = owner->migrated;
-      owner->migrated = elt;
-      mtx_unlock(&pool->parent->mutex);
+      struct slab_element_header *head;
+
+      /* Only whole lists are ever taken off, so there is no ABA problem. */
+      do {
+         head = p_atomic_read(&owner->migrated);
+         elt->next = head;
+      } while (p_atomic_cmpxchg(&owner->migrated, head, elt) != head);
+
+      p_atomic_dec(&parent->num_remote_frees);
    } else {
-      mtx_unlock(&pool->parent->mutex);
+      p_atomic_dec(&parent->num_remote_frees);
 
       slab_free_orphaned(elt);
    }
@@ -32,8 +32,9 @@
  *
  * Allocations obtained from one child pool should usually be freed in the
  * same child pool. Freeing an allocation in a different child pool associated
- * to the same parent is allowed (and requires no locking by the caller), but
- * it is discouraged because it implies a performance penalty.
+ * to the same parent is allowed (and requires no locking by the caller). Such
+ * elements are pushed onto a lock-free list of the owning pool and reclaimed
+ * all at once by its next slab_alloc that runs out of free elements.
  *
  * For convenience and to ease the transition, there is also a set of wrapper
  * functions around a single parent-child pair.
@@ -48,7 +49,10 @@ struct slab_element_header;
 struct slab_page_header;
 
 struct slab_parent_pool {
-   mtx_t mutex;
+   /* Number of slab_free calls currently pushing an element onto the
+    * migrated list of another child pool.
+    */
+   int num_remote_frees;
    unsigned element_size;
    unsigned num_elements;
 };
@@ -64,7 +68,8 @@ struct slab_child_pool {
    /* Elements that are owned by this pool but were freed with a different
     * pool as the argument to slab_free.
     *
-    * This list is protected by the parent mutex.
+    * Other threads push onto this list with compare-and-swap, the owner
+    * takes the whole list at once with an atomic exchange.
     */
    struct slab_element_header *migrated;
 };
@@ -35,14 +35,30 @@
  */
 #define NODE_ALLOC_ALIGN 64
 
+#if defined(__GNUC__)
+#define sparse_array_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define sparse_array_prefetch(addr) ((void)(addr))
+#endif
+
 void
-util_sparse_array_init(struct util_sparse_array *arr,
-                       size_t elem_size, size_t node_size)
+util_sparse_array_init_with_leaf_size(struct util_sparse_array *arr,
+                                      size_t elem_size, size_t node_size,
+                                      size_t leaf_size)
 {
    memset(arr, 0, sizeof(*arr));
    arr->elem_size = elem_size;
    arr->node_size_log2 = util_logbase2_64(node_size);
+   arr->leaf_size_log2 = util_logbase2_64(leaf_size);
    assert(node_size >= 2 && node_size == (1ull << arr->node_size_log2));
+   assert(leaf_size >= 2 && leaf_size == (1ull << arr->leaf_size_log2));
+}
+
+void
+util_sparse_array_init(struct util_sparse_array *arr,
+                       size_t elem_size, size_t node_size)
+{
+   util_sparse_array_init_with_leaf_size(arr, elem_size, node_size, node_size);
 }
 
 #define NODE_PTR_MASK (~((uintptr_t)NODE_ALLOC_ALIGN - 1))
@@ -70,6 +86,13 @@ _util_sparse_array_node_level(uintptr_t handle)
    return handle & NODE_LEVEL_MASK;
 }
 
+/** Returns the number of index bits covered by a node at the given level */
+static inline unsigned
+_util_sparse_array_level_bits(struct util_sparse_array *arr, unsigned level)
+{
+   return arr->leaf_size_log2 + level * arr->node_size_log2;
+}
+
 static inline void
 _util_sparse_array_node_finish(struct util_sparse_array *arr,
                                uintptr_t node)
@@ -99,7 +122,7 @@ _util_sparse_array_node_alloc(struct util_sparse_array *arr,
 {
    size_t size;
    if (level == 0) {
-      size = arr->elem_size << arr->node_size_log2;
+      size = arr->elem_size << arr->leaf_size_log2;
    } else {
       size = sizeof(uintptr_t) << arr->node_size_log2;
    }
@@ -128,14 +151,15 @@ _util_sparse_array_set_or_free_node(uintptr_t *node_ptr,
    }
 }
 
-void *
-util_sparse_array_get(struct util_sparse_array *arr, uint64_t idx)
+/** Returns the leaf node containing element idx, allocating it if needed */
+static void *
+_util_sparse_array_get_leaf(struct util_sparse_array *arr, uint64_t idx)
 {
    const unsigned node_size_log2 = arr->node_size_log2;
    uintptr_t root = p_atomic_read(&arr->root);
    if (unlikely(!root)) {
       unsigned root_level = 0;
-      uint64_t idx_iter = idx >> node_size_log2;
+      uint64_t idx_iter = idx >> arr->leaf_size_log2;
       while (idx_iter) {
          idx_iter >>= node_size_log2;
          root_level++;
@@ -147,8 +171,8 @@ util_sparse_array_get(struct util_sparse_array *arr, uint64_t idx)
 
    while (1) {
       unsigned root_level = _util_sparse_array_node_level(root);
-      uint64_t root_idx = idx >> (root_level * node_size_log2);
-      if (likely(root_idx < (1ull << node_size_log2)))
+      unsigned root_bits = _util_sparse_array_level_bits(arr, root_level);
+      if (likely(root_bits >= 64 || (idx >> root_bits) == 0))
          break;
 
       /* In this case, we have a root but its level is low enough that the
@@ -171,8 +195,9 @@ util_sparse_array_get(struct util_sparse_array *arr, uint64_t idx)
    void *node_data = _util_sparse_array_node_data(root);
    unsigned node_level = _util_sparse_array_node_level(root);
    while (node_level > 0) {
-      uint64_t child_idx = (idx >> (node_level * node_size_log2)) &
-                           ((1ull << node_size_log2) - 1);
+      uint64_t child_idx =
+         (idx >> _util_sparse_array_level_bits(arr, node_level - 1)) &
+         ((1ull << node_size_log2) - 1);
 
       uintptr_t *children = node_data;
       uintptr_t child = p_atomic_read(&children[child_idx]);
@@ -187,8 +212,39 @@ util_sparse_array_get(struct util_sparse_array *arr, uint64_t idx)
       node_level = _util_sparse_array_node_level(child);
    }
 
-   uint64_t elem_idx = idx & ((1ull << node_size_log2) - 1);
-   return (void *)((char *)node_data + (elem_idx * arr->elem_size));
+   return node_data;
+}
+
+void *
+util_sparse_array_get(struct util_sparse_array *arr, uint64_t idx)
+{
+   void *leaf = _util_sparse_array_get_leaf(arr, idx);
+   uint64_t elem_idx = idx & ((1ull << arr->leaf_size_log2) - 1);
+   return (void *)((char *)leaf + (elem_idx * arr->elem_size));
+}
+
+void
+util_sparse_array_get_many(struct util_sparse_array *arr,
+                           const uint32_t *idx, unsigned count,
+                           void **elems)
+{
+   const unsigned leaf_size_log2 = arr->leaf_size_log2;
+   const uint64_t elem_mask = (1ull << leaf_size_log2) - 1;
+   uint64_t leaf_idx = UINT64_MAX;
+   char *leaf = NULL;
+
+   for (unsigned i = 0; i < count; i++) {
+      /* Indices handed to us together tend to be close to each other, so
+       * only walk the tree when we move to a different leaf.
+       */
+      if ((idx[i] >> leaf_size_log2) != leaf_idx) {
+         leaf_idx = idx[i] >> leaf_size_log2;
+         leaf = _util_sparse_array_get_leaf(arr, idx[i]);
+      }
+
+      elems[i] = leaf + (idx[i] & elem_mask) * arr->elem_size;
+      sparse_array_prefetch(elems[i]);
+   }
 }
 
 static void
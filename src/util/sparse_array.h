@@ -45,6 +45,9 @@ struct util_sparse_array_node;
  *     O(log_b n) where the base b is the node size and n is the maximum
  *     index.  However, node sizes are expected to be fairly large and the
  *     index is a uint64_t so, if your node size is 256, it's O(8).
+ *     Leaf nodes may be given a larger size than the interior ones, which
+ *     keeps the tree of an array with dense indices shallow without making
+ *     every interior node huge.
  *
  *  2. The data stored in the array is never moved in memory.  Instead, the
  *     data structure only ever grows and new nodes are added as-needed.  This
@@ -68,6 +71,7 @@ struct util_sparse_array_node;
 struct util_sparse_array {
    size_t elem_size;
    unsigned node_size_log2;
+   unsigned leaf_size_log2;
 
    uintptr_t root;
 };
@@ -75,10 +79,28 @@ struct util_sparse_array {
 void util_sparse_array_init(struct util_sparse_array *arr,
                             size_t elem_size, size_t node_size);
 
+/** Like util_sparse_array_init but with leaf nodes of leaf_size elements
+ *
+ * Both node_size and leaf_size must be powers of two.
+ */
+void util_sparse_array_init_with_leaf_size(struct util_sparse_array *arr,
+                                           size_t elem_size, size_t node_size,
+                                           size_t leaf_size);
+
 void util_sparse_array_finish(struct util_sparse_array *arr);
 
 void *util_sparse_array_get(struct util_sparse_array *arr, uint64_t idx);
 
+/** Look up count elements at once
+ *
+ * This is equivalent to elems[i] = util_sparse_array_get(arr, idx[i]) for
+ * each i, except that the tree is only walked once per run of indices in the
+ * same leaf node and the returned elements are prefetched.
+ */
+void util_sparse_array_get_many(struct util_sparse_array *arr,
+                                const uint32_t *idx, unsigned count,
+                                void **elems);
+
 void util_sparse_array_validate(struct util_sparse_array *arr);
 
 /** A thread-safe free list for use with struct util_sparse_array
@@ -0,0 +1,531 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "swiss_table.h"
+#include "bitscan.h"
+#include "macros.h"
+#include "ralloc.h"
+#include "u_math.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWISS_TABLE_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SWISS_TABLE_NEON
+#endif
+
+#define GROUP_WIDTH SWISS_TABLE_GROUP_WIDTH
+
+/* Control byte values. Full slots store the low 7 bits of the hash, so only
+ * the special values have the top bit set.
+ */
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xfe
+
+#define MIN_SIZE GROUP_WIDTH
+
+/* Keep the load factor, including deleted slots, at or below 7/8. */
+static inline uint32_t
+max_load(uint32_t size)
+{
+   return size - size / 8;
+}
+
+static inline bool
+ctrl_is_full(uint8_t ctrl)
+{
+   return !(ctrl & 0x80);
+}
+
+static inline uint8_t
+hash_h2(uint32_t hash)
+{
+   return hash & 0x7f;
+}
+
+/* The starting slot of the probe sequence. The Fibonacci hash spreads
+ * hash functions which only vary in their low bits over the whole table.
+ */
+static inline uint32_t
+hash_h1(const struct swiss_table *st, uint32_t hash)
+{
+   return (hash * 0x9e3779b1u) >> st->size_shift;
+}
+
+/* Bit i of the returned masks refers to slot (pos + i). */
+#if defined(SWISS_TABLE_SSE2)
+
+static inline uint32_t
+group_match(const uint8_t *ctrl, uint8_t value)
+{
+   __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+}
+
+static inline uint32_t
+group_match_empty_or_deleted(const uint8_t *ctrl)
+{
+   return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#elif defined(SWISS_TABLE_NEON)
+
+static inline uint32_t
+neon_movemask(uint8x16_t cmp)
+{
+   static const uint8_t bits[16] = {
+      1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128,
+   };
+   uint8x16_t masked = vandq_u8(cmp, vld1q_u8(bits));
+   uint8x8_t lo = vget_low_u8(masked);
+   uint8x8_t hi = vget_high_u8(masked);
+
+   /* Three pairwise additions sum up each half into its first byte. */
+   lo = vpadd_u8(lo, lo);
+   hi = vpadd_u8(hi, hi);
+   lo = vpadd_u8(lo, lo);
+   hi = vpadd_u8(hi, hi);
+   lo = vpadd_u8(lo, lo);
+   hi = vpadd_u8(hi, hi);
+
+   return vget_lane_u8(lo, 0) | (vget_lane_u8(hi, 0) << 8);
+}
+
+static inline uint32_t
+group_match(const uint8_t *ctrl, uint8_t value)
+{
+   return neon_movemask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(value)));
+}
+
+static inline uint32_t
+group_match_empty_or_deleted(const uint8_t *ctrl)
+{
+   return neon_movemask(vtstq_u8(vld1q_u8(ctrl), vdupq_n_u8(0x80)));
+}
+
+#else
+
+static inline uint32_t
+group_match(const uint8_t *ctrl, uint8_t value)
+{
+   uint32_t mask = 0;
+
+   for (unsigned i = 0; i < GROUP_WIDTH; i++) {
+      if (ctrl[i] == value)
+         mask |= 1u << i;
+   }
+   return mask;
+}
+
+static inline uint32_t
+group_match_empty_or_deleted(const uint8_t *ctrl)
+{
+   uint32_t mask = 0;
+
+   for (unsigned i = 0; i < GROUP_WIDTH; i++) {
+      if (ctrl[i] & 0x80)
+         mask |= 1u << i;
+   }
+   return mask;
+}
+
+#endif
+
+static inline uint32_t
+group_match_empty(const uint8_t *ctrl)
+{
+   return group_match(ctrl, CTRL_EMPTY);
+}
+
+/* Pops the lowest set bit of *mask. */
+static inline unsigned
+mask_next(uint32_t *mask)
+{
+   unsigned i = ffs(*mask) - 1;
+   *mask &= *mask - 1;
+   return i;
+}
+
+static inline void
+set_ctrl(struct swiss_table *st, uint32_t index, uint8_t value)
+{
+   st->ctrl[index] = value;
+
+   /* Keep the mirrored group after the end in sync. */
+   if (index < GROUP_WIDTH)
+      st->ctrl[st->size + index] = value;
+}
+
+static bool
+swiss_table_alloc(struct swiss_table *st, void *mem_ctx, uint32_t size)
+{
+   struct hash_entry *table =
+      ralloc_size(mem_ctx, size * sizeof(struct hash_entry) +
+                           size + GROUP_WIDTH);
+   if (!table)
+      return false;
+
+   st->table = table;
+   st->ctrl = (uint8_t *)(table + size);
+   st->size = size;
+   st->size_shift = 32 - util_logbase2(size);
+   st->entries = 0;
+   st->deleted_entries = 0;
+   st->growth_left = max_load(size);
+   memset(st->ctrl, CTRL_EMPTY, size + GROUP_WIDTH);
+   return true;
+}
+
+struct swiss_table *
+_mesa_swiss_table_create(void *mem_ctx,
+                         uint32_t (*key_hash_function)(const void *key),
+                         bool (*key_equals_function)(const void *a,
+                                                     const void *b))
+{
+   struct swiss_table *st;
+
+   /* mem_ctx is used to allocate the table, but the table is used to
+    * allocate the slots.
+    */
+   st = ralloc(mem_ctx, struct swiss_table);
+   if (st == NULL)
+      return NULL;
+
+   st->key_hash_function = key_hash_function;
+   st->key_equals_function = key_equals_function;
+
+   if (!swiss_table_alloc(st, st, MIN_SIZE)) {
+      ralloc_free(st);
+      return NULL;
+   }
+
+   return st;
+}
+
+/**
+ * Frees the given table.
+ *
+ * If delete_function is passed, it gets called on each entry present before
+ * freeing.
+ */
+void
+_mesa_swiss_table_destroy(struct swiss_table *st,
+                          void (*delete_function)(struct hash_entry *entry))
+{
+   if (!st)
+      return;
+
+   if (delete_function) {
+      swiss_table_foreach(st, entry) {
+         delete_function(entry);
+      }
+   }
+   ralloc_free(st);
+}
+
+/**
+ * Deletes all entries of the given table without deleting the table itself
+ * or changing its size.
+ *
+ * If delete_function is passed, it gets called on each entry present.
+ */
+void
+_mesa_swiss_table_clear(struct swiss_table *st,
+                        void (*delete_function)(struct hash_entry *entry))
+{
+   if (delete_function) {
+      swiss_table_foreach(st, entry) {
+         delete_function(entry);
+      }
+   }
+
+   memset(st->ctrl, CTRL_EMPTY, st->size + GROUP_WIDTH);
+   st->entries = 0;
+   st->deleted_entries = 0;
+   st->growth_left = max_load(st->size);
+}
+
+/* The probe sequence visits groups at triangular offsets, which covers
+ * every slot of a power-of-two table.
+ */
+#define foreach_probe_group(st, hash, pos)                                  \
+   for (uint32_t pos = hash_h1(st, hash), _stride = 0, _n = 0;              \
+        _n <= (st)->size / GROUP_WIDTH;                                     \
+        _stride += GROUP_WIDTH, pos = (pos + _stride) & ((st)->size - 1),   \
+        _n++)
+
+static struct hash_entry *
+swiss_table_search(struct swiss_table *st, uint32_t hash, const void *key)
+{
+   const uint8_t h2 = hash_h2(hash);
+
+   foreach_probe_group(st, hash, pos) {
+      const uint8_t *ctrl = st->ctrl + pos;
+      uint32_t match = group_match(ctrl, h2);
+
+      while (match) {
+         uint32_t index = (pos + mask_next(&match)) & (st->size - 1);
+         struct hash_entry *entry = st->table + index;
+
+         if (entry->hash == hash && st->key_equals_function(key, entry->key))
+            return entry;
+      }
+
+      if (likely(group_match_empty(ctrl)))
+         return NULL;
+   }
+
+   return NULL;
+}
+
+/**
+ * Finds an entry with the given key.
+ *
+ * Returns NULL if no entry is found.  Note that the data pointer may be
+ * modified by the user.
+ */
+struct hash_entry *
+_mesa_swiss_table_search(struct swiss_table *st, const void *key)
+{
+   assert(st->key_hash_function);
+   return swiss_table_search(st, st->key_hash_function(key), key);
+}
+
+struct hash_entry *
+_mesa_swiss_table_search_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key)
+{
+   assert(st->key_hash_function == NULL || hash == st->key_hash_function(key));
+   return swiss_table_search(st, hash, key);
+}
+
+/* Returns the first empty or deleted slot in the probe sequence of hash. */
+static uint32_t
+find_first_non_full(struct swiss_table *st, uint32_t hash)
+{
+   foreach_probe_group(st, hash, pos) {
+      uint32_t mask = group_match_empty_or_deleted(st->ctrl + pos);
+
+      if (likely(mask))
+         return (pos + mask_next(&mask)) & (st->size - 1);
+   }
+
+   unreachable("swiss_table is full");
+}
+
+static void
+swiss_table_rehash(struct swiss_table *st, uint32_t new_size)
+{
+   struct swiss_table old_st = *st;
+
+   if (!swiss_table_alloc(st, ralloc_parent(old_st.table), new_size))
+      return;
+
+   for (uint32_t i = 0; i < old_st.size; i++) {
+      if (!ctrl_is_full(old_st.ctrl[i]))
+         continue;
+
+      struct hash_entry *old_entry = old_st.table + i;
+      uint32_t index = find_first_non_full(st, old_entry->hash);
+
+      set_ctrl(st, index, hash_h2(old_entry->hash));
+      st->table[index] = *old_entry;
+   }
+
+   st->entries = old_st.entries;
+   st->growth_left -= old_st.entries;
+
+   ralloc_free(old_st.table);
+}
+
+static struct hash_entry *
+swiss_table_insert(struct swiss_table *st, uint32_t hash,
+                   const void *key, void *data)
+{
+   const uint8_t h2 = hash_h2(hash);
+   struct hash_entry *entry;
+   uint32_t index = UINT32_MAX;
+
+   /* Look for an existing entry, and remember the first slot we can insert
+    * into on the way so that we don't have to probe twice.
+    */
+   foreach_probe_group(st, hash, pos) {
+      const uint8_t *ctrl = st->ctrl + pos;
+      uint32_t match = group_match(ctrl, h2);
+
+      while (match) {
+         entry = st->table + ((pos + mask_next(&match)) & (st->size - 1));
+
+         /* Replace the key and data of an existing entry, like
+          * _mesa_hash_table_insert does.
+          */
+         if (entry->hash == hash && st->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
+      }
+
+      if (index == UINT32_MAX) {
+         uint32_t non_full = group_match_empty_or_deleted(ctrl);
+         if (non_full)
+            index = (pos + mask_next(&non_full)) & (st->size - 1);
+      }
+
+      if (likely(group_match_empty(ctrl)))
+         break;
+   }
+
+   assert(index != UINT32_MAX);
+
+   if (unlikely(st->growth_left == 0 && st->ctrl[index] == CTRL_EMPTY)) {
+      /* Drop the deleted slots if that frees up enough space, grow
+       * otherwise.
+       */
+      if (st->entries < max_load(st->size) / 2)
+         swiss_table_rehash(st, st->size);
+      else
+         swiss_table_rehash(st, st->size * 2);
+
+      /* We could hit here if a required resize failed. An unchecked-malloc
+       * application could ignore this result.
+       */
+      if (st->growth_left == 0)
+         return NULL;
+
+      index = find_first_non_full(st, hash);
+   }
+
+   if (st->ctrl[index] == CTRL_DELETED)
+      st->deleted_entries--;
+   else
+      st->growth_left--;
+
+   set_ctrl(st, index, hash_h2(hash));
+   st->entries++;
+
+   entry = st->table + index;
+   entry->hash = hash;
+   entry->key = key;
+   entry->data = data;
+   return entry;
+}
+
+/**
+ * Inserts the key into the table, replacing the entry for an equal key.
+ *
+ * Note that insertion may rearrange the table on a resize or rehash,
+ * so previously found hash_entries are no longer valid after this function.
+ */
+struct hash_entry *
+_mesa_swiss_table_insert(struct swiss_table *st, const void *key, void *data)
+{
+   assert(st->key_hash_function);
+   return swiss_table_insert(st, st->key_hash_function(key), key, data);
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key, void *data)
+{
+   assert(st->key_hash_function == NULL || hash == st->key_hash_function(key));
+   return swiss_table_insert(st, hash, key, data);
+}
+
+/**
+ * This function deletes the given entry.
+ *
+ * Note that deletion doesn't otherwise modify the table, so an iteration over
+ * the table deleting entries is safe.
+ */
+void
+_mesa_swiss_table_remove(struct swiss_table *st, struct hash_entry *entry)
+{
+   if (!entry)
+      return;
+
+   uint32_t index = entry - st->table;
+   uint32_t index_before = (index - GROUP_WIDTH) & (st->size - 1);
+   uint32_t empty_after = group_match_empty(st->ctrl + index);
+   uint32_t empty_before = group_match_empty(st->ctrl + index_before);
+
+   assert(ctrl_is_full(st->ctrl[index]));
+
+   /* If there was never a full window of GROUP_WIDTH slots around this one,
+    * no probe sequence ever continued past it, so it can become empty again.
+    * Otherwise, it has to be marked as deleted so that lookups keep going.
+    */
+   bool was_never_full =
+      empty_before && empty_after &&
+      (ffs(empty_after) - 1) + (GROUP_WIDTH - util_last_bit(empty_before)) <
+      GROUP_WIDTH;
+
+   if (was_never_full) {
+      set_ctrl(st, index, CTRL_EMPTY);
+      st->growth_left++;
+   } else {
+      set_ctrl(st, index, CTRL_DELETED);
+      st->deleted_entries++;
+   }
+
+   st->entries--;
+}
+
+/**
+ * Removes the entry with the corresponding key, if exists.
+ */
+void
+_mesa_swiss_table_remove_key(struct swiss_table *st, const void *key)
+{
+   _mesa_swiss_table_remove(st, _mesa_swiss_table_search(st, key));
+}
+
+/**
+ * This function is an iterator over the table.
+ *
+ * Pass in NULL for the first entry, as in the start of a for loop.
+ */
+struct hash_entry *
+_mesa_swiss_table_next_entry(struct swiss_table *st, struct hash_entry *entry)
+{
+   uint32_t index = entry ? entry - st->table + 1 : 0;
+
+   for (; index < st->size; index++) {
+      if (ctrl_is_full(st->ctrl[index]))
+         return st->table + index;
+   }
+
+   return NULL;
+}
+
+struct swiss_table *
+_mesa_pointer_swiss_table_create(void *mem_ctx)
+{
+   return _mesa_swiss_table_create(mem_ctx, _mesa_hash_pointer,
+                                   _mesa_key_pointer_equal);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * An open-addressing hash table with per-slot control bytes, in the style
+ * of Abseil's "SwissTable".
+ *
+ * Every slot has a control byte which is either "empty", "deleted", or holds
+ * 7 bits of the key's hash.  Lookups compare the control bytes of 16 slots
+ * at once (with SSE2 or NEON where available) and only call the key
+ * comparison function for slots whose 7 hash bits match, so probing rarely
+ * touches the entries themselves.
+ *
+ * The API mirrors _mesa_hash_table_*, and entries are struct hash_entry, so
+ * a table can be switched over by replacing the type and function prefix.
+ * Unlike struct hash_table, there are no reserved key values; NULL is a
+ * valid key.
+ */
+
+#ifndef _SWISS_TABLE_H
+#define _SWISS_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SWISS_TABLE_GROUP_WIDTH 16
+
+struct swiss_table {
+   /* size + SWISS_TABLE_GROUP_WIDTH control bytes; the last group mirrors
+    * the first one so that groups can be loaded at any slot.
+    */
+   uint8_t *ctrl;
+   struct hash_entry *table;
+   uint32_t (*key_hash_function)(const void *key);
+   bool (*key_equals_function)(const void *a, const void *b);
+   uint32_t size;         /* number of slots, a power of two */
+   uint32_t size_shift;   /* 32 - log2(size) */
+   uint32_t entries;
+   uint32_t deleted_entries;
+   uint32_t growth_left;  /* empty slots we may fill before rehashing */
+};
+
+struct swiss_table *
+_mesa_swiss_table_create(void *mem_ctx,
+                         uint32_t (*key_hash_function)(const void *key),
+                         bool (*key_equals_function)(const void *a,
+                                                     const void *b));
+void _mesa_swiss_table_destroy(struct swiss_table *st,
+                               void (*delete_function)(struct hash_entry *entry));
+void _mesa_swiss_table_clear(struct swiss_table *st,
+                             void (*delete_function)(struct hash_entry *entry));
+
+static inline uint32_t _mesa_swiss_table_num_entries(struct swiss_table *st)
+{
+   return st->entries;
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert(struct swiss_table *st, const void *key, void *data);
+struct hash_entry *
+_mesa_swiss_table_insert_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key, void *data);
+struct hash_entry *
+_mesa_swiss_table_search(struct swiss_table *st, const void *key);
+struct hash_entry *
+_mesa_swiss_table_search_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key);
+void _mesa_swiss_table_remove(struct swiss_table *st,
+                              struct hash_entry *entry);
+void _mesa_swiss_table_remove_key(struct swiss_table *st,
+                                  const void *key);
+
+struct hash_entry *_mesa_swiss_table_next_entry(struct swiss_table *st,
+                                                struct hash_entry *entry);
+
+struct swiss_table *
+_mesa_pointer_swiss_table_create(void *mem_ctx);
+
+/**
+ * This foreach function is safe against deletion, but not against insertion
+ * (which may rehash the table, making entry a dangling pointer).
+ */
+#define swiss_table_foreach(st, entry)                                      \
+   for (struct hash_entry *entry = _mesa_swiss_table_next_entry(st, NULL);  \
+        entry != NULL;                                                      \
+        entry = _mesa_swiss_table_next_entry(st, entry))
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* _SWISS_TABLE_H */
@@ -0,0 +1,295 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that the SIMD format kernels give the same results as the C code.
+ *
+ * Run with "bench" as the argument to print the throughput of both instead.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/format/u_format.h"
+#include "util/format/u_format_simd.h"
+#include "util/os_time.h"
+
+#define MAX_WIDTH 70
+#define HEIGHT 2
+/* Room for the widest (R64G64B64A64) texels, plus some stride padding. */
+#define STRIDE (MAX_WIDTH * 32 + 12)
+
+enum op {
+   UNPACK_RGBA_8UNORM,
+   PACK_RGBA_8UNORM,
+   UNPACK_RGBA_FLOAT,
+   PACK_RGBA_FLOAT,
+   UNPACK_Z_FLOAT,
+   NUM_OPS,
+};
+
+static const char *op_names[NUM_OPS] = {
+   "unpack_rgba_8unorm",
+   "pack_rgba_8unorm",
+   "unpack_rgba_float",
+   "pack_rgba_float",
+   "unpack_z_float",
+};
+
+static bool
+has_op(const struct util_format_description *desc, enum op op)
+{
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       util_format_is_pure_integer(desc->format))
+      return false;
+
+   switch (op) {
+   case UNPACK_RGBA_8UNORM:
+      return desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS &&
+             desc->unpack_rgba_8unorm;
+   case PACK_RGBA_8UNORM:
+      return desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS &&
+             desc->pack_rgba_8unorm;
+   case UNPACK_RGBA_FLOAT:
+      return desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS &&
+             desc->unpack_rgba;
+   case PACK_RGBA_FLOAT:
+      return desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS &&
+             desc->pack_rgba_float;
+   case UNPACK_Z_FLOAT:
+      /* Z16_UNORM_S8_UINT has stubs which abort. */
+      return util_format_has_depth(desc) && desc->unpack_z_float &&
+             desc->format != PIPE_FORMAT_Z16_UNORM_S8_UINT;
+   default:
+      return false;
+   }
+}
+
+static void
+run_op(const struct util_format_description *desc, enum op op,
+       void *dst, unsigned dst_stride, const void *src, unsigned src_stride,
+       unsigned width, unsigned height)
+{
+   switch (op) {
+   case UNPACK_RGBA_8UNORM:
+      desc->unpack_rgba_8unorm(dst, dst_stride, src, src_stride, width, height);
+      break;
+   case PACK_RGBA_8UNORM:
+      desc->pack_rgba_8unorm(dst, dst_stride, src, src_stride, width, height);
+      break;
+   case UNPACK_RGBA_FLOAT:
+      desc->unpack_rgba(dst, dst_stride, src, src_stride, width, height);
+      break;
+   case PACK_RGBA_FLOAT:
+      desc->pack_rgba_float(dst, dst_stride, src, src_stride, width, height);
+      break;
+   case UNPACK_Z_FLOAT:
+      desc->unpack_z_float(dst, dst_stride, src, src_stride, width, height);
+      break;
+   default:
+      break;
+   }
+}
+
+/* Whether the SIMD entrypoint takes care of the op. */
+static bool
+has_kernel(const struct util_format_description *desc, enum op op)
+{
+   const unsigned width = UTIL_FORMAT_SIMD_PIXELS;
+   uint8_t src[UTIL_FORMAT_SIMD_PIXELS * 16] = { 0 };
+   uint8_t dst[UTIL_FORMAT_SIMD_PIXELS * 16];
+   enum pipe_format format = desc->format;
+
+   switch (op) {
+   case UNPACK_RGBA_8UNORM:
+      return util_format_simd_unpack_rgba_8unorm(format, dst, 0, src, 0, width, 1);
+   case PACK_RGBA_8UNORM:
+      return util_format_simd_pack_rgba_8unorm(format, dst, 0, src, 0, width, 1);
+   case UNPACK_RGBA_FLOAT:
+      return util_format_simd_unpack_rgba_float(format, dst, 0, src, 0, width, 1);
+   case PACK_RGBA_FLOAT:
+      return util_format_simd_pack_rgba_float(format, dst, 0, (const float *)src, 0, width, 1);
+   case UNPACK_Z_FLOAT:
+      return util_format_simd_unpack_z_float(format, (float *)dst, 0, src, 0, width, 1);
+   default:
+      return false;
+   }
+}
+
+static uint32_t rand_state = 0x12345678;
+
+static uint32_t
+rand32(void)
+{
+   rand_state ^= rand_state << 13;
+   rand_state ^= rand_state >> 17;
+   rand_state ^= rand_state << 5;
+   return rand_state;
+}
+
+/* Random floats, mostly in [0, 1] but with every interesting corner. */
+static float
+rand_float(void)
+{
+   static const float special[] = {
+      0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 2.0f, 1e-30f, -1e-30f,
+      INFINITY, -INFINITY, NAN, 1.0f / 255.0f, 0.5f / 255.0f,
+      0.5f / 31.0f, 1.5f / 31.0f, 0.5f / 1023.0f,
+   };
+   const uint32_t r = rand32();
+
+   switch (r % 4) {
+   case 0:
+      return special[(r >> 8) % ARRAY_SIZE(special)];
+   case 1: {
+      /* Halfway points of the common unorm sizes. */
+      static const float max[] = { 1, 3, 15, 31, 63, 255, 1023 };
+      const float m = max[(r >> 8) % ARRAY_SIZE(max)];
+      return (((r >> 16) % (unsigned)(m + 1)) + 0.5f) / m;
+   }
+   default:
+      return (float)(r >> 8) / (1 << 24) * 1.2f - 0.1f;
+   }
+}
+
+static void
+fill_src(enum op op, uint8_t *src, unsigned size)
+{
+   if (op == PACK_RGBA_FLOAT) {
+      float *f = (float *)src;
+      for (unsigned i = 0; i < size / sizeof(float); i++)
+         f[i] = rand_float();
+   } else {
+      for (unsigned i = 0; i < size; i++)
+         src[i] = rand32();
+   }
+}
+
+static bool
+test_format(const struct util_format_description *desc, enum op op)
+{
+   static uint8_t src[HEIGHT * STRIDE];
+   static uint8_t ref[HEIGHT * STRIDE], res[HEIGHT * STRIDE];
+   bool success = true;
+
+   for (unsigned width = 1; width <= MAX_WIDTH; width++) {
+      for (unsigned iter = 0; iter < 4; iter++) {
+         fill_src(op, src, sizeof(src));
+         memset(ref, 0xcd, sizeof(ref));
+         memset(res, 0xcd, sizeof(res));
+
+         util_format_simd_set_enabled(false);
+         run_op(desc, op, ref, STRIDE, src, STRIDE, width, HEIGHT);
+         util_format_simd_set_enabled(true);
+         run_op(desc, op, res, STRIDE, src, STRIDE, width, HEIGHT);
+
+         if (memcmp(ref, res, sizeof(ref)) != 0) {
+            printf("%s %s: mismatch at width %u\n",
+                   desc->short_name, op_names[op], width);
+            success = false;
+            break;
+         }
+      }
+   }
+
+   return success;
+}
+
+static double
+time_op(const struct util_format_description *desc, enum op op,
+        uint8_t *dst, const uint8_t *src, unsigned width, unsigned height)
+{
+   const unsigned stride = width * 16;
+   const int64_t start = os_time_get_nano();
+   unsigned iters = 0;
+
+   do {
+      run_op(desc, op, dst, stride, src, stride, width, height);
+      iters++;
+   } while (os_time_get_nano() - start < 200000000);
+
+   return (double)width * height * iters /
+          ((os_time_get_nano() - start) / 1000.0);
+}
+
+static void
+bench(void)
+{
+   const unsigned width = 1024, height = 1024;
+   uint8_t *src = calloc(width * height, 16);
+   uint8_t *dst = calloc(width * height, 16);
+
+   printf("%-24s %-20s %10s %10s\n", "format", "op", "C Mpix/s", "SIMD");
+
+   for (enum pipe_format format = 0; format < PIPE_FORMAT_COUNT; format++) {
+      const struct util_format_description *desc =
+         util_format_description(format);
+      if (!desc)
+         continue;
+
+      for (enum op op = 0; op < NUM_OPS; op++) {
+         if (!has_op(desc, op) || !has_kernel(desc, op))
+            continue;
+
+         fill_src(op, src, width * height * 16);
+
+         util_format_simd_set_enabled(false);
+         double c = time_op(desc, op, dst, src, width, height);
+         util_format_simd_set_enabled(true);
+         double simd = time_op(desc, op, dst, src, width, height);
+
+         printf("%-24s %-20s %10.1f %10.1f\n",
+                desc->short_name, op_names[op], c, simd);
+      }
+   }
+
+   free(src);
+   free(dst);
+}
+
+int
+main(int argc, char **argv)
+{
+   bool success = true;
+
+   if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+      bench();
+      return 0;
+   }
+
+   for (enum pipe_format format = 0; format < PIPE_FORMAT_COUNT; format++) {
+      const struct util_format_description *desc =
+         util_format_description(format);
+      if (!desc)
+         continue;
+
+      for (enum op op = 0; op < NUM_OPS; op++) {
+         if (has_op(desc, op))
+            success &= test_format(desc, op);
+      }
+   }
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright © 2021 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that the SIMD index min/max kernels give the same results as the
+ * C code, for all index sizes, with and without primitive restart.
+ *
+ * Run with "bench" as the argument to print the throughput of both instead.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/u_index_minmax.h"
+
+#define MAX_COUNT 300
+
+static const unsigned index_sizes[] = { 1, 2, 4 };
+
+static unsigned
+random_index(unsigned index_size)
+{
+   unsigned value = ((unsigned)rand() << 16) ^ (unsigned)rand();
+
+   return index_size == 4 ? value : value & ((1u << (index_size * 8)) - 1);
+}
+
+static void
+store_index(void *indices, unsigned index_size, unsigned i, unsigned value)
+{
+   switch (index_size) {
+   case 1: ((uint8_t *)indices)[i] = value; break;
+   case 2: ((uint16_t *)indices)[i] = value; break;
+   case 4: ((uint32_t *)indices)[i] = value; break;
+   }
+}
+
+static bool
+test_case(const uint8_t *indices, unsigned index_size, unsigned count,
+          bool restart, unsigned restart_index)
+{
+   unsigned c_min, c_max, simd_min, simd_max;
+
+   util_index_minmax_set_simd_enabled(false);
+   util_index_minmax(indices, index_size, count, restart, restart_index,
+                     &c_min, &c_max);
+   util_index_minmax_set_simd_enabled(true);
+   util_index_minmax(indices, index_size, count, restart, restart_index,
+                     &simd_min, &simd_max);
+
+   if (c_min != simd_min || c_max != simd_max) {
+      printf("index_size %u count %u restart %d (0x%x): "
+             "C %u..%u, SIMD %u..%u\n",
+             index_size, count, restart, restart_index,
+             c_min, c_max, simd_min, simd_max);
+      return false;
+   }
+
+   return true;
+}
+
+static bool
+test_index_size(unsigned index_size)
+{
+   /* One extra index so that unaligned starts are tested too. */
+   uint8_t *buf = malloc((MAX_COUNT + 1) * index_size);
+   const unsigned type_max =
+      index_size == 4 ? ~0u : (1u << (index_size * 8)) - 1;
+   bool success = true;
+
+   for (unsigned count = 0; count <= MAX_COUNT; count += 7) {
+      for (unsigned offset = 0; offset <= 1; offset++) {
+         uint8_t *indices = buf + offset * index_size;
+
+         /* Random indices, with some restart indices mixed in. */
+         for (unsigned i = 0; i < count; i++) {
+            store_index(indices, index_size, i,
+                        rand() % 8 ? random_index(index_size) : type_max);
+         }
+         success &= test_case(indices, index_size, count, false, 0);
+         success &= test_case(indices, index_size, count, true, type_max);
+         success &= test_case(indices, index_size, count, true, 0x10000);
+
+         /* Nothing but restart indices. */
+         for (unsigned i = 0; i < count; i++)
+            store_index(indices, index_size, i, 5);
+         success &= test_case(indices, index_size, count, true, 5);
+
+         /* Restart indices at both ends of the range of the others. */
+         for (unsigned i = 0; i < count; i++)
+            store_index(indices, index_size, i, i % 3 ? 0 : type_max);
+         success &= test_case(indices, index_size, count, true, 0);
+         success &= test_case(indices, index_size, count, true, type_max);
+      }
+   }
+
+   free(buf);
+   return success;
+}
+
+static double
+time_scan(const void *indices, unsigned index_size, unsigned count,
+          bool restart)
+{
+   const int64_t start = os_time_get_nano();
+   unsigned iters = 0, min, max;
+
+   do {
+      util_index_minmax(indices, index_size, count, restart, ~0u,
+                        &min, &max);
+      iters++;
+   } while (os_time_get_nano() - start < 200000000);
+
+   return (double)count * iters /
+          ((os_time_get_nano() - start) / 1000.0);
+}
+
+static void
+bench(void)
+{
+   const unsigned count = 1 << 20;
+   uint8_t *indices = malloc(count * 4);
+
+   printf("%-10s %-8s %12s %12s\n", "size", "restart", "C Mindex/s", "SIMD");
+
+   for (unsigned s = 0; s < ARRAY_SIZE(index_sizes); s++) {
+      const unsigned index_size = index_sizes[s];
+
+      for (unsigned i = 0; i < count; i++)
+         store_index(indices, index_size, i, random_index(index_size));
+
+      for (unsigned restart = 0; restart <= 1; restart++) {
+         util_index_minmax_set_simd_enabled(false);
+         double c = time_scan(indices, index_size, count, restart);
+         util_index_minmax_set_simd_enabled(true);
+         double simd = time_scan(indices, index_size, count, restart);
+
+         printf("%-10u %-8u %12.1f %12.1f\n", index_size, restart, c, simd);
+      }
+   }
+
+   free(indices);
+}
+
+int
+main(int argc, char **argv)
+{
+   bool success = true;
+
+   if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+      bench();
+      return 0;
+   }
+
+   for (unsigned s = 0; s < ARRAY_SIZE(index_sizes); s++)
+      success &= test_index_size(index_sizes[s]);
+
+   return success ? 0 : 1;
+}
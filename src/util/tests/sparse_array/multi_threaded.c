@@ -51,9 +51,12 @@ static void
 run_test(unsigned run_idx)
 {
    size_t node_size = 4 << (run_idx / 2);
+   /* Every other run uses leaves bigger than the interior nodes */
+   size_t leaf_size = node_size << ((run_idx & 1) * 3);
 
    struct util_sparse_array arr;
-   util_sparse_array_init(&arr, sizeof(uint32_t), node_size);
+   util_sparse_array_init_with_leaf_size(&arr, sizeof(uint32_t),
+                                         node_size, leaf_size);
 
    thrd_t threads[NUM_THREADS];
    for (unsigned i = 0; i < NUM_THREADS; i++) {
@@ -73,6 +76,14 @@ run_test(unsigned run_idx)
       assert(*elem == 0 || *elem == i);
    }
 
+   uint32_t idx[64];
+   void *elems[64];
+   for (unsigned i = 0; i < 64; i++)
+      idx[i] = (i & 1) ? rand() % MAX_ARR_SIZE : i * 3;
+   util_sparse_array_get_many(&arr, idx, 64, elems);
+   for (unsigned i = 0; i < 64; i++)
+      assert(elems[i] == util_sparse_array_get(&arr, idx[i]));
+
    util_sparse_array_finish(&arr);
 }
 
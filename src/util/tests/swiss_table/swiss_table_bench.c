@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Compares struct swiss_table with struct hash_table on pointer keys, which
+ * is what most users of the tables (nir_instr_set, BO handle tables, ...)
+ * look like.
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hash_table.h"
+#include "os_time.h"
+#include "swiss_table.h"
+
+#define NUM_ITERATIONS 20
+
+struct table_ops {
+   const char *name;
+   void *(*create)(void);
+   void (*destroy)(void *table);
+   void (*insert)(void *table, const void *key);
+   bool (*search)(void *table, const void *key);
+   void (*remove)(void *table, const void *key);
+};
+
+static void *
+ht_create(void)
+{
+   return _mesa_pointer_hash_table_create(NULL);
+}
+
+static void
+ht_destroy(void *table)
+{
+   _mesa_hash_table_destroy(table, NULL);
+}
+
+static void
+ht_insert(void *table, const void *key)
+{
+   _mesa_hash_table_insert(table, key, NULL);
+}
+
+static bool
+ht_search(void *table, const void *key)
+{
+   return _mesa_hash_table_search(table, key) != NULL;
+}
+
+static void
+ht_remove(void *table, const void *key)
+{
+   _mesa_hash_table_remove_key(table, key);
+}
+
+static void *
+st_create(void)
+{
+   return _mesa_pointer_swiss_table_create(NULL);
+}
+
+static void
+st_destroy(void *table)
+{
+   _mesa_swiss_table_destroy(table, NULL);
+}
+
+static void
+st_insert(void *table, const void *key)
+{
+   _mesa_swiss_table_insert(table, key, NULL);
+}
+
+static bool
+st_search(void *table, const void *key)
+{
+   return _mesa_swiss_table_search(table, key) != NULL;
+}
+
+static void
+st_remove(void *table, const void *key)
+{
+   _mesa_swiss_table_remove_key(table, key);
+}
+
+static const struct table_ops tables[] = {
+   { "hash_table", ht_create, ht_destroy, ht_insert, ht_search, ht_remove },
+   { "swiss_table", st_create, st_destroy, st_insert, st_search, st_remove },
+};
+
+static void
+run(const struct table_ops *ops, void **keys, unsigned num_keys)
+{
+   int64_t insert_time = 0, hit_time = 0, miss_time = 0, remove_time = 0;
+   unsigned found = 0;
+
+   for (unsigned iter = 0; iter < NUM_ITERATIONS; iter++) {
+      void *table = ops->create();
+      int64_t start = os_time_get_nano();
+
+      /* Insert the first half, the second half is used for misses. */
+      for (unsigned i = 0; i < num_keys / 2; i++)
+         ops->insert(table, keys[i]);
+      int64_t inserted = os_time_get_nano();
+
+      for (unsigned i = 0; i < num_keys / 2; i++)
+         found += ops->search(table, keys[i]);
+      int64_t hits = os_time_get_nano();
+
+      for (unsigned i = num_keys / 2; i < num_keys; i++)
+         found += ops->search(table, keys[i]);
+      int64_t misses = os_time_get_nano();
+
+      for (unsigned i = 0; i < num_keys / 2; i++)
+         ops->remove(table, keys[i]);
+      int64_t removed = os_time_get_nano();
+
+      insert_time += inserted - start;
+      hit_time += hits - inserted;
+      miss_time += misses - hits;
+      remove_time += removed - misses;
+
+      ops->destroy(table);
+   }
+
+   if (found != NUM_ITERATIONS * (num_keys / 2)) {
+      fprintf(stderr, "%s: wrong number of entries found\n", ops->name);
+      exit(1);
+   }
+
+   const double n = (double)NUM_ITERATIONS * (num_keys / 2);
+   printf("%-12s %8u keys: insert %6.1f ns, hit %6.1f ns, miss %6.1f ns, "
+          "remove %6.1f ns\n", ops->name, num_keys / 2,
+          insert_time / n, hit_time / n, miss_time / n, remove_time / n);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const unsigned sizes[] = { 64, 1024, 32 * 1024, 1024 * 1024 };
+
+   (void) argc;
+   (void) argv;
+
+   for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+      unsigned num_keys = sizes[s] * 2;
+      void **keys = malloc(num_keys * sizeof(*keys));
+
+      /* Heap pointers of a typical node size, in allocation order. */
+      for (unsigned i = 0; i < num_keys; i++)
+         keys[i] = malloc(48);
+
+      for (unsigned t = 0; t < ARRAY_SIZE(tables); t++)
+         run(&tables[t], keys, num_keys);
+
+      for (unsigned i = 0; i < num_keys; i++)
+         free(keys[i]);
+      free(keys);
+   }
+
+   return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "swiss_table.h"
+
+#define SIZE 20000
+
+static uint32_t
+key_value(const void *key)
+{
+   return *(const uint32_t *)key;
+}
+
+static bool
+uint32_t_key_equals(const void *a, const void *b)
+{
+   return key_value(a) == key_value(b);
+}
+
+/* All keys collide, so every lookup has to go through the probe sequence
+ * and the control bytes never filter anything out.
+ */
+static uint32_t
+bad_hash(const void *key)
+{
+   return 42;
+}
+
+static void
+count_entry(struct hash_entry *entry)
+{
+   (*(unsigned *)entry->data)++;
+}
+
+static void
+test_insert_search_remove(uint32_t (*hash)(const void *key), unsigned size)
+{
+   struct swiss_table *st;
+   struct hash_entry *entry;
+   uint32_t *keys = malloc(size * sizeof(*keys));
+   uint32_t i;
+
+   st = _mesa_swiss_table_create(NULL, hash, uint32_t_key_equals);
+
+   for (i = 0; i < size; i++) {
+      keys[i] = i;
+      _mesa_swiss_table_insert(st, keys + i, NULL);
+   }
+   assert(_mesa_swiss_table_num_entries(st) == size);
+
+   for (i = 0; i < size; i++) {
+      entry = _mesa_swiss_table_search(st, keys + i);
+      assert(entry);
+      assert(key_value(entry->key) == i);
+   }
+
+   /* Replacing keeps the number of entries. */
+   _mesa_swiss_table_insert(st, keys + 1, keys);
+   assert(_mesa_swiss_table_num_entries(st) == size);
+   assert(_mesa_swiss_table_search(st, keys + 1)->data == keys);
+
+   /* Remove every other key, then reinsert them, so that deleted slots are
+    * both reused and purged by rehashing.
+    */
+   for (i = 0; i < size; i += 2)
+      _mesa_swiss_table_remove_key(st, keys + i);
+   assert(_mesa_swiss_table_num_entries(st) == size / 2);
+
+   for (i = 0; i < size; i++) {
+      entry = _mesa_swiss_table_search(st, keys + i);
+      assert((entry != NULL) == (i % 2 == 1));
+   }
+
+   for (unsigned pass = 0; pass < 4; pass++) {
+      for (i = 0; i < size; i += 2)
+         _mesa_swiss_table_insert(st, keys + i, NULL);
+      for (i = 0; i < size; i += 2)
+         _mesa_swiss_table_remove_key(st, keys + i);
+   }
+   assert(_mesa_swiss_table_num_entries(st) == size / 2);
+
+   unsigned count = 0;
+   swiss_table_foreach(st, entry) {
+      assert(key_value(entry->key) % 2 == 1);
+      _mesa_swiss_table_remove(st, entry);
+      count++;
+   }
+   assert(count == size / 2);
+   assert(_mesa_swiss_table_num_entries(st) == 0);
+
+   _mesa_swiss_table_destroy(st, NULL);
+   free(keys);
+}
+
+static void
+test_clear_and_destroy(void)
+{
+   struct swiss_table *st;
+   uint32_t keys[100];
+   unsigned deleted = 0;
+
+   st = _mesa_swiss_table_create(NULL, key_value, uint32_t_key_equals);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i++) {
+      keys[i] = i;
+      _mesa_swiss_table_insert(st, keys + i, &deleted);
+   }
+
+   _mesa_swiss_table_clear(st, count_entry);
+   assert(deleted == ARRAY_SIZE(keys));
+   assert(_mesa_swiss_table_num_entries(st) == 0);
+   assert(_mesa_swiss_table_next_entry(st, NULL) == NULL);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i++)
+      _mesa_swiss_table_insert(st, keys + i, &deleted);
+
+   _mesa_swiss_table_destroy(st, count_entry);
+   assert(deleted == 2 * ARRAY_SIZE(keys));
+}
+
+static void
+test_null_key(void)
+{
+   struct swiss_table *st = _mesa_pointer_swiss_table_create(NULL);
+   int data;
+
+   assert(_mesa_swiss_table_search(st, NULL) == NULL);
+   _mesa_swiss_table_insert(st, NULL, &data);
+   assert(_mesa_swiss_table_search(st, NULL)->data == &data);
+   _mesa_swiss_table_remove_key(st, NULL);
+   assert(_mesa_swiss_table_search(st, NULL) == NULL);
+
+   _mesa_swiss_table_destroy(st, NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+   (void) argc;
+   (void) argv;
+
+   test_insert_search_remove(key_value, SIZE);
+   test_insert_search_remove(bad_hash, 500);
+   test_clear_and_destroy();
+   test_null_key();
+
+   return 0;
+}
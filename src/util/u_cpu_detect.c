@@ -67,6 +67,10 @@
 #include <elf.h>
 #endif
 
+#if defined(PIPE_ARCH_AARCH64) && defined(PIPE_OS_LINUX)
+#include <sys/auxv.h>
+#endif
+
 #ifdef PIPE_OS_UNIX
 #include <unistd.h>
 #endif
@@ -426,6 +430,9 @@ static void
 check_os_arm_support(void)
 {
     util_cpu_caps.has_neon = true;
+#if defined(PIPE_OS_LINUX)
+    util_cpu_caps.has_sha1 = (getauxval(AT_HWCAP) >> 5) & 1; /* HWCAP_SHA1 */
+#endif
 }
 #endif /* PIPE_ARCH_ARM || PIPE_ARCH_AARCH64 */
 
@@ -541,6 +548,13 @@ util_cpu_detect_once(void)
          util_cpu_caps.has_avx2 = (regs7[1] >> 5) & 1;
       }
 
+      /* The SHA extensions don't depend on AVX (e.g. Goldmont has them). */
+      if (regs[0] >= 0x00000007) {
+         uint32_t regs7[4];
+         cpuid_count(0x00000007, 0x00000000, regs7);
+         util_cpu_caps.has_sha1 = (regs7[1] >> 29) & 1;
+      }
+
       // check for avx512
       if (((regs2[2] >> 27) & 1) && // OSXSAVE
           (xgetbv() & (0x7 << 5)) && // OPMASK: upper-256 enabled by OS
@@ -632,6 +646,7 @@ util_cpu_detect_once(void)
       debug_printf("util_cpu_caps.has_altivec = %u\n", util_cpu_caps.has_altivec);
       debug_printf("util_cpu_caps.has_vsx = %u\n", util_cpu_caps.has_vsx);
       debug_printf("util_cpu_caps.has_neon = %u\n", util_cpu_caps.has_neon);
+      debug_printf("util_cpu_caps.has_sha1 = %u\n", util_cpu_caps.has_sha1);
       debug_printf("util_cpu_caps.has_daz = %u\n", util_cpu_caps.has_daz);
       debug_printf("util_cpu_caps.has_avx512f = %u\n", util_cpu_caps.has_avx512f);
       debug_printf("util_cpu_caps.has_avx512dq = %u\n", util_cpu_caps.has_avx512dq);
@@ -0,0 +1,282 @@
+/*
+ * Copyright © 2021 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * The SIMD kernels handle primitive restart without a branch: restart
+ * indices are replaced by all ones before the min and by zero before the
+ * max, which leaves both unchanged.  A lane that only saw restart indices
+ * thus ends up with min > max, and so does the whole vector if there was no
+ * other index at all.
+ *
+ * The x86 kernels are compiled with target attributes, so this file doesn't
+ * need any special compiler flags.
+ */
+
+#include <stdint.h>
+
+#include "c11/threads.h"
+#include "pipe/p_config.h"
+#include "util/macros.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_index_minmax.h"
+
+#if defined(USE_SSE41) && defined(PIPE_ARCH_X86_64)
+#define INDEX_MINMAX_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define INDEX_MINMAX_NEON
+#include <arm_neon.h>
+#endif
+
+/* Below this many indices, the C loop is as fast as the kernel setup. */
+#define MIN_SIMD_COUNT 64
+
+/* Scans a multiple of the kernel's vector width and returns how many indices
+ * it consumed.  *out_min and *out_max are only lowered/raised.
+ */
+typedef unsigned
+(*index_minmax_func)(const void *indices, unsigned count, bool restart,
+                     unsigned restart_index,
+                     unsigned *out_min, unsigned *out_max);
+
+/* Indexed by index_size / 2. */
+static index_minmax_func minmax_kernels[3];
+static once_flag minmax_once_flag = ONCE_FLAG_INIT;
+static bool minmax_simd_enabled = true;
+
+#define MINMAX_C(bits)                                                        \
+static void                                                                   \
+minmax_u##bits##_c(const uint##bits##_t *indices, unsigned count,             \
+                   bool restart, unsigned restart_index,                      \
+                   unsigned *out_min, unsigned *out_max)                      \
+{                                                                             \
+   unsigned min = *out_min;                                                   \
+   unsigned max = *out_max;                                                   \
+                                                                              \
+   if (restart) {                                                             \
+      for (unsigned i = 0; i < count; i++) {                                  \
+         if (indices[i] != restart_index) {                                   \
+            if (indices[i] > max) max = indices[i];                           \
+            if (indices[i] < min) min = indices[i];                           \
+         }                                                                    \
+      }                                                                       \
+   } else {                                                                   \
+      for (unsigned i = 0; i < count; i++) {                                  \
+         if (indices[i] > max) max = indices[i];                              \
+         if (indices[i] < min) min = indices[i];                              \
+      }                                                                       \
+   }                                                                          \
+                                                                              \
+   *out_min = min;                                                            \
+   *out_max = max;                                                            \
+}
+
+MINMAX_C(8)
+MINMAX_C(16)
+MINMAX_C(32)
+
+/* Fold the per-lane results of a kernel into *out_min and *out_max. */
+#define MINMAX_REDUCE(lanes, mins, maxs, out_min, out_max)                    \
+   do {                                                                       \
+      unsigned min = ~0u, max = 0;                                            \
+      for (unsigned l = 0; l < (lanes); l++) {                                \
+         if ((mins)[l] < min) min = (mins)[l];                                \
+         if ((maxs)[l] > max) max = (maxs)[l];                                \
+      }                                                                       \
+      if (min <= max) {                                                       \
+         *(out_min) = MIN2(*(out_min), min);                                  \
+         *(out_max) = MAX2(*(out_max), max);                                  \
+      }                                                                       \
+   } while (0)
+
+#ifdef INDEX_MINMAX_X86
+
+#define SSE41 __attribute__((target("sse4.1")))
+#define AVX2 __attribute__((target("avx2")))
+
+/* pfx is the intrinsic prefix (_mm or _mm256) and si the whole-register
+ * suffix (si128 or si256).
+ */
+#define MINMAX_X86(name, attr, vec, pfx, si, bits)                           \
+static attr unsigned                                                          \
+name(const void *indices, unsigned count, bool restart,                       \
+     unsigned restart_index, unsigned *out_min, unsigned *out_max)            \
+{                                                                             \
+   enum { lanes = sizeof(vec) / sizeof(uint##bits##_t) };                     \
+   const vec *src = (const vec *)indices;                                     \
+   const unsigned vec_count = count / lanes;                                  \
+   vec vmin = pfx##_set1_epi##bits(-1);                                       \
+   vec vmax = pfx##_setzero_##si();                                           \
+                                                                              \
+   if (restart) {                                                             \
+      const vec vrestart = pfx##_set1_epi##bits(restart_index);               \
+      for (unsigned i = 0; i < vec_count; i++) {                              \
+         vec v = pfx##_loadu_##si(&src[i]);                                   \
+         vec mask = pfx##_cmpeq_epi##bits(v, vrestart);                       \
+         vmin = pfx##_min_epu##bits(vmin, pfx##_or_##si(v, mask));            \
+         vmax = pfx##_max_epu##bits(vmax, pfx##_andnot_##si(mask, v));        \
+      }                                                                       \
+   } else {                                                                   \
+      for (unsigned i = 0; i < vec_count; i++) {                              \
+         vec v = pfx##_loadu_##si(&src[i]);                                   \
+         vmin = pfx##_min_epu##bits(vmin, v);                                 \
+         vmax = pfx##_max_epu##bits(vmax, v);                                 \
+      }                                                                       \
+   }                                                                          \
+                                                                              \
+   uint##bits##_t mins[lanes], maxs[lanes];                                   \
+   pfx##_storeu_##si((vec *)mins, vmin);                                      \
+   pfx##_storeu_##si((vec *)maxs, vmax);                                      \
+   MINMAX_REDUCE(lanes, mins, maxs, out_min, out_max);                        \
+                                                                              \
+   return vec_count * lanes;                                                  \
+}
+
+MINMAX_X86(minmax_u8_sse41, SSE41, __m128i, _mm, si128, 8)
+MINMAX_X86(minmax_u16_sse41, SSE41, __m128i, _mm, si128, 16)
+MINMAX_X86(minmax_u32_sse41, SSE41, __m128i, _mm, si128, 32)
+MINMAX_X86(minmax_u8_avx2, AVX2, __m256i, _mm256, si256, 8)
+MINMAX_X86(minmax_u16_avx2, AVX2, __m256i, _mm256, si256, 16)
+MINMAX_X86(minmax_u32_avx2, AVX2, __m256i, _mm256, si256, 32)
+
+#endif /* INDEX_MINMAX_X86 */
+
+#ifdef INDEX_MINMAX_NEON
+
+#define MINMAX_NEON(bits, vec)                                                \
+static unsigned                                                               \
+minmax_u##bits##_neon(const void *indices, unsigned count, bool restart,      \
+                      unsigned restart_index,                                 \
+                      unsigned *out_min, unsigned *out_max)                   \
+{                                                                             \
+   enum { lanes = 16 / sizeof(uint##bits##_t) };                              \
+   const uint##bits##_t *src = (const uint##bits##_t *)indices;               \
+   const unsigned vec_count = count / lanes;                                  \
+   vec vmin = vdupq_n_u##bits((uint##bits##_t)~0u);                           \
+   vec vmax = vdupq_n_u##bits(0);                                             \
+                                                                              \
+   if (restart) {                                                             \
+      const vec vrestart = vdupq_n_u##bits(restart_index);                    \
+      for (unsigned i = 0; i < vec_count; i++) {                              \
+         vec v = vld1q_u##bits(&src[i * lanes]);                              \
+         vec mask = vceqq_u##bits(v, vrestart);                               \
+         vmin = vminq_u##bits(vmin, vorrq_u##bits(v, mask));                  \
+         vmax = vmaxq_u##bits(vmax, vbicq_u##bits(v, mask));                  \
+      }                                                                       \
+   } else {                                                                   \
+      for (unsigned i = 0; i < vec_count; i++) {                              \
+         vec v = vld1q_u##bits(&src[i * lanes]);                              \
+         vmin = vminq_u##bits(vmin, v);                                       \
+         vmax = vmaxq_u##bits(vmax, v);                                       \
+      }                                                                       \
+   }                                                                          \
+                                                                              \
+   const uint##bits##_t mins[1] = { vminvq_u##bits(vmin) };                   \
+   const uint##bits##_t maxs[1] = { vmaxvq_u##bits(vmax) };                   \
+   MINMAX_REDUCE(1, mins, maxs, out_min, out_max);                            \
+                                                                              \
+   return vec_count * lanes;                                                  \
+}
+
+MINMAX_NEON(8, uint8x16_t)
+MINMAX_NEON(16, uint16x8_t)
+MINMAX_NEON(32, uint32x4_t)
+
+#endif /* INDEX_MINMAX_NEON */
+
+static void
+minmax_init(void)
+{
+#ifdef INDEX_MINMAX_X86
+   util_cpu_detect();
+
+   if (util_cpu_caps.has_sse4_1) {
+      minmax_kernels[0] = minmax_u8_sse41;
+      minmax_kernels[1] = minmax_u16_sse41;
+      minmax_kernels[2] = minmax_u32_sse41;
+   }
+   if (util_cpu_caps.has_avx2) {
+      minmax_kernels[0] = minmax_u8_avx2;
+      minmax_kernels[1] = minmax_u16_avx2;
+      minmax_kernels[2] = minmax_u32_avx2;
+   }
+#endif
+
+#ifdef INDEX_MINMAX_NEON
+   minmax_kernels[0] = minmax_u8_neon;
+   minmax_kernels[1] = minmax_u16_neon;
+   minmax_kernels[2] = minmax_u32_neon;
+#endif
+}
+
+void
+util_index_minmax_set_simd_enabled(bool enabled)
+{
+   minmax_simd_enabled = enabled;
+}
+
+void
+util_index_minmax(const void *indices, unsigned index_size, unsigned count,
+                  bool primitive_restart, unsigned restart_index,
+                  unsigned *out_min, unsigned *out_max)
+{
+   unsigned min = ~0u;
+   unsigned max = 0;
+   unsigned done = 0;
+
+   /* A restart index that doesn't fit the index type never matches. */
+   if (index_size < 4 && restart_index >> (index_size * 8))
+      primitive_restart = false;
+
+   if (count >= MIN_SIMD_COUNT && minmax_simd_enabled) {
+      call_once(&minmax_once_flag, minmax_init);
+
+      index_minmax_func kernel = minmax_kernels[index_size / 2];
+      if (kernel) {
+         done = kernel(indices, count, primitive_restart, restart_index,
+                       &min, &max);
+      }
+   }
+
+   switch (index_size) {
+   case 4:
+      minmax_u32_c((const uint32_t *)indices + done, count - done,
+                   primitive_restart, restart_index, &min, &max);
+      break;
+   case 2:
+      minmax_u16_c((const uint16_t *)indices + done, count - done,
+                   primitive_restart, restart_index, &min, &max);
+      break;
+   case 1:
+      minmax_u8_c((const uint8_t *)indices + done, count - done,
+                  primitive_restart, restart_index, &min, &max);
+      break;
+   default:
+      unreachable("bad index size");
+   }
+
+   *out_min = min;
+   *out_max = max;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2021 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Min/max scan of 8, 16 and 32-bit index buffers, used to find the vertex
+ * range of indexed draws with user-pointer or CPU-visible index buffers.
+ *
+ * The scan is done with SSE4.1, AVX2 or NEON when the CPU has them.  The
+ * kernels are picked at runtime from util_cpu_caps.
+ */
+
+#ifndef U_INDEX_MINMAX_H
+#define U_INDEX_MINMAX_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Find the smallest and largest of \p count indices of \p index_size bytes.
+ * If \p primitive_restart is set, indices equal to \p restart_index are
+ * skipped.  If no index is left, *out_min is ~0u and *out_max is 0.
+ */
+void
+util_index_minmax(const void *indices, unsigned index_size, unsigned count,
+                  bool primitive_restart, unsigned restart_index,
+                  unsigned *out_min, unsigned *out_max);
+
+/**
+ * Enable or disable the SIMD kernels (enabled by default), so that tests and
+ * benchmarks can compare them against the C code.
+ */
+void
+util_index_minmax_set_simd_enabled(bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_INDEX_MINMAX_H */
@@ -29,6 +29,9 @@
 #include "c11/threads.h"
 
 #include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
 #include "u_process.h"
@@ -46,6 +49,8 @@
 static void
 util_queue_kill_threads(struct util_queue *queue, unsigned keep_num_threads,
                         bool finish_locked);
+static void
+util_queue_finish_execute(void *data, int num_thread);
 
 /****************************************************************************
  * Wait for all queues to assert idle when exit() is called.
@@ -243,6 +248,471 @@ struct thread_input {
    int thread_index;
 };
 
+/****************************************************************************
+ * Statistics
+ */
+
+static unsigned
+util_queue_stats_bucket(int64_t duration_ns)
+{
+   uint64_t us = MAX2(duration_ns, 0) / 1000;
+
+   return us ? MIN2(util_logbase2_64(us), UTIL_QUEUE_STATS_NUM_BUCKETS - 1)
+             : 0;
+}
+
+static void
+util_queue_stats_update_depth(struct util_queue *queue, unsigned depth)
+{
+   unsigned max_depth = p_atomic_read(&queue->stats.max_depth);
+
+   while (depth > max_depth) {
+      unsigned old = p_atomic_cmpxchg(&queue->stats.max_depth, max_depth,
+                                      depth);
+      if (old == max_depth)
+         break;
+      max_depth = old;
+   }
+}
+
+static inline void
+util_queue_stats_count_blocked(struct util_queue *queue)
+{
+   if (p_atomic_read(&queue->collect_stats))
+      p_atomic_inc(&queue->stats.num_blocked);
+}
+
+static void
+util_queue_execute_job(struct util_queue *queue, struct util_queue_job *job,
+                       int thread_index)
+{
+   int64_t start = 0;
+
+   if (job->enqueue_time) {
+      start = os_time_get_nano();
+      p_atomic_inc(&queue->stats.num_jobs);
+      p_atomic_add(&queue->stats.total_latency_ns, start - job->enqueue_time);
+      p_atomic_inc(&queue->stats.latency_hist[
+         util_queue_stats_bucket(start - job->enqueue_time)]);
+   }
+
+   job->execute(job->job, thread_index);
+
+   /* The queue may be gone once the fence is signalled. */
+   if (start) {
+      int64_t duration = os_time_get_nano() - start;
+
+      p_atomic_add(&queue->stats.total_execute_ns, duration);
+      p_atomic_inc(&queue->stats.execute_hist[
+         util_queue_stats_bucket(duration)]);
+   }
+
+   util_queue_fence_signal(job->fence);
+   if (job->cleanup)
+      job->cleanup(job->job, thread_index);
+}
+
+/****************************************************************************
+ * Per-thread deques for UTIL_QUEUE_INIT_WORK_STEALING
+ *
+ * There is one deque per thread, plus one shared deque at index max_threads
+ * for UTIL_QUEUE_PRIORITY_HIGH jobs, which all threads check first.
+ *
+ * Both the owner and thieves take jobs from the front of a deque. Keeping
+ * every deque FIFO is what lets util_queue_finish keep working: a thread can
+ * only pick up its barrier job after all jobs queued in front of it in the
+ * same deque have been picked up.
+ */
+
+static bool
+util_queue_deque_init(struct util_queue_deque *deque, unsigned size)
+{
+   deque->jobs = (struct util_queue_job*)
+                 calloc(size, sizeof(struct util_queue_job));
+   if (!deque->jobs)
+      return false;
+
+   (void) mtx_init(&deque->lock, mtx_plain);
+   deque->size = size;
+   deque->read_idx = 0;
+   deque->write_idx = 0;
+   return true;
+}
+
+static void
+util_queue_deque_push_locked(struct util_queue_deque *deque,
+                             const struct util_queue_job *job)
+{
+   if (deque->write_idx - deque->read_idx == deque->size) {
+      /* The number of jobs is limited by util_queue::max_jobs, so this
+       * only happens until the deque has grown to its working set.
+       */
+      unsigned new_size = deque->size * 2;
+      struct util_queue_job *jobs =
+         (struct util_queue_job*)calloc(new_size,
+                                        sizeof(struct util_queue_job));
+      assert(jobs);
+
+      for (unsigned i = 0; i < deque->size; i++) {
+         jobs[i] = deque->jobs[(deque->read_idx + i) & (deque->size - 1)];
+      }
+
+      free(deque->jobs);
+      deque->jobs = jobs;
+      deque->read_idx = 0;
+      deque->write_idx = deque->size;
+      deque->size = new_size;
+   }
+
+   deque->jobs[deque->write_idx & (deque->size - 1)] = *job;
+   p_atomic_set(&deque->write_idx, deque->write_idx + 1);
+}
+
+static bool
+util_queue_deque_pop_locked(struct util_queue_deque *deque,
+                            struct util_queue_job *job)
+{
+   if (deque->read_idx == deque->write_idx)
+      return false;
+
+   struct util_queue_job *ptr =
+      &deque->jobs[deque->read_idx & (deque->size - 1)];
+
+   *job = *ptr;
+   memset(ptr, 0, sizeof(*ptr));
+   p_atomic_set(&deque->read_idx, deque->read_idx + 1);
+   return true;
+}
+
+static bool
+util_queue_deque_pop(struct util_queue_deque *deque,
+                     struct util_queue_job *job)
+{
+   /* Skip empty deques without taking their lock. A stale result is fine:
+    * a thread that finds nothing re-checks num_queued before sleeping.
+    */
+   if (p_atomic_read(&deque->read_idx) == p_atomic_read(&deque->write_idx))
+      return false;
+
+   mtx_lock(&deque->lock);
+   bool found = util_queue_deque_pop_locked(deque, job);
+   mtx_unlock(&deque->lock);
+   return found;
+}
+
+static inline unsigned
+util_queue_num_deques(struct util_queue *queue)
+{
+   return queue->max_threads + 1;
+}
+
+static inline struct util_queue_deque *
+util_queue_high_priority_deque(struct util_queue *queue)
+{
+   return &queue->deques[queue->max_threads];
+}
+
+static void
+util_queue_destroy_deques(struct util_queue *queue)
+{
+   if (!queue->deques)
+      return;
+
+   for (unsigned i = 0; i < util_queue_num_deques(queue); i++) {
+      if (queue->deques[i].jobs) {
+         mtx_destroy(&queue->deques[i].lock);
+         free(queue->deques[i].jobs);
+      }
+   }
+   free(queue->deques);
+   queue->deques = NULL;
+}
+
+/* Take the next job, trying high priority jobs and then the thread's own
+ * deque first.
+ */
+static bool
+util_queue_steal_job(struct util_queue *queue, int thread_index,
+                     struct util_queue_job *job)
+{
+   if (util_queue_deque_pop(util_queue_high_priority_deque(queue), job))
+      return true;
+
+   for (unsigned i = 0; i < queue->max_threads; i++) {
+      unsigned index = (thread_index + i) % queue->max_threads;
+
+      if (util_queue_deque_pop(&queue->deques[index], job))
+         return true;
+   }
+   return false;
+}
+
+/* Read a counter with a read-modify-write operation, so that the read is
+ * ordered against the preceding atomic update of a different counter. This
+ * is what prevents lost wakeups between the threads adding and fetching
+ * jobs, which check each other's counters without holding a common lock.
+ */
+static inline int
+util_queue_read_counter(int *counter)
+{
+   return p_atomic_add_return(counter, 0);
+}
+
+static void
+util_queue_wake_waiter(struct util_queue *queue, int *num_waiters,
+                       cnd_t *cond)
+{
+   if (util_queue_read_counter(num_waiters)) {
+      mtx_lock(&queue->lock);
+      cnd_signal(cond);
+      mtx_unlock(&queue->lock);
+   }
+}
+
+static void
+util_queue_work_stealing_loop(struct util_queue *queue, int thread_index)
+{
+   while (1) {
+      struct util_queue_job job;
+
+      /* only kill threads that are above "num_threads" */
+      if (thread_index >= p_atomic_read(&queue->num_threads))
+         break;
+
+      if (!util_queue_steal_job(queue, thread_index, &job)) {
+         /* wait if the queue is empty */
+         mtx_lock(&queue->lock);
+         p_atomic_inc(&queue->num_sleeping);
+         while (thread_index < queue->num_threads &&
+                util_queue_read_counter(&queue->num_queued) == 0)
+            cnd_wait(&queue->has_queued_cond, &queue->lock);
+         p_atomic_dec(&queue->num_sleeping);
+         mtx_unlock(&queue->lock);
+         continue;
+      }
+
+      p_atomic_dec(&queue->num_queued);
+      util_queue_wake_waiter(queue, &queue->num_space_waiters,
+                             &queue->has_space_cond);
+
+      if (job.job) {
+         p_atomic_add(&queue->total_jobs_size, -job.job_size);
+         util_queue_execute_job(queue, &job, thread_index);
+      }
+   }
+
+   /* signal remaining jobs if all threads are being terminated */
+   mtx_lock(&queue->lock);
+   if (queue->num_threads == 0) {
+      for (unsigned i = 0; i < util_queue_num_deques(queue); i++) {
+         struct util_queue_deque *deque = &queue->deques[i];
+         struct util_queue_job job;
+
+         mtx_lock(&deque->lock);
+         while (util_queue_deque_pop_locked(deque, &job)) {
+            if (job.job)
+               util_queue_fence_signal(job.fence);
+         }
+         mtx_unlock(&deque->lock);
+      }
+      p_atomic_set(&queue->num_queued, 0);
+   }
+   mtx_unlock(&queue->lock);
+}
+
+/* Reserve space for one job against max_jobs, growing or waiting like the
+ * shared ring buffer does when it is full.
+ */
+static void
+util_queue_reserve_job(struct util_queue *queue, size_t job_size)
+{
+   while (1) {
+      int num_queued = p_atomic_read(&queue->num_queued);
+
+      if (num_queued < p_atomic_read(&queue->max_jobs)) {
+         if (p_atomic_cmpxchg(&queue->num_queued, num_queued,
+                              num_queued + 1) == num_queued) {
+            if (p_atomic_read(&queue->collect_stats))
+               util_queue_stats_update_depth(queue, num_queued + 1);
+            return;
+         }
+         continue;
+      }
+
+      mtx_lock(&queue->lock);
+      if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL &&
+          p_atomic_read(&queue->total_jobs_size) + job_size < S_256MB) {
+         /* There is no shared ring to reallocate, the deques grow on
+          * demand. Just raise the limit.
+          */
+         if (p_atomic_read(&queue->num_queued) >= queue->max_jobs)
+            p_atomic_set(&queue->max_jobs, queue->max_jobs + 8);
+      } else {
+         /* Wait until there is a free slot. */
+         util_queue_stats_count_blocked(queue);
+         p_atomic_inc(&queue->num_space_waiters);
+         while (util_queue_read_counter(&queue->num_queued) >=
+                queue->max_jobs)
+            cnd_wait(&queue->has_space_cond, &queue->lock);
+         p_atomic_dec(&queue->num_space_waiters);
+      }
+      mtx_unlock(&queue->lock);
+   }
+}
+
+static void
+util_queue_add_job_work_stealing(struct util_queue *queue,
+                                 const struct util_queue_job *job,
+                                 enum util_queue_priority priority)
+{
+   unsigned num_threads = p_atomic_read(&queue->num_threads);
+
+   if (num_threads == 0) {
+      /* well no good option here, but any leaks will be
+       * short-lived as things are shutting down..
+       */
+      return;
+   }
+
+   util_queue_fence_reset(job->fence);
+   util_queue_reserve_job(queue, job->job_size);
+   p_atomic_add(&queue->total_jobs_size, job->job_size);
+
+   struct util_queue_deque *deque;
+
+   if (priority == UTIL_QUEUE_PRIORITY_HIGH)
+      deque = util_queue_high_priority_deque(queue);
+   else
+      deque = &queue->deques[p_atomic_inc_return(&queue->next_deque) %
+                             num_threads];
+
+   mtx_lock(&deque->lock);
+   util_queue_deque_push_locked(deque, job);
+   mtx_unlock(&deque->lock);
+
+   util_queue_wake_waiter(queue, &queue->num_sleeping,
+                          &queue->has_queued_cond);
+}
+
+static bool
+util_queue_remove_job_work_stealing(struct util_queue *queue,
+                                    struct util_queue_fence *fence)
+{
+   for (unsigned i = 0; i < util_queue_num_deques(queue); i++) {
+      struct util_queue_deque *deque = &queue->deques[i];
+
+      mtx_lock(&deque->lock);
+      for (unsigned j = deque->read_idx; j != deque->write_idx; j++) {
+         struct util_queue_job *ptr = &deque->jobs[j & (deque->size - 1)];
+
+         if (ptr->fence == fence) {
+            if (ptr->cleanup)
+               ptr->cleanup(ptr->job, -1);
+
+            /* Just clear it. The threads will treat as a no-op job. */
+            memset(ptr, 0, sizeof(*ptr));
+            mtx_unlock(&deque->lock);
+            return true;
+         }
+      }
+      mtx_unlock(&deque->lock);
+   }
+   return false;
+}
+
+static void
+util_queue_promote_job_work_stealing(struct util_queue *queue,
+                                     struct util_queue_fence *fence)
+{
+   struct util_queue_deque *high = util_queue_high_priority_deque(queue);
+   struct util_queue_job job = {0};
+
+   for (unsigned i = 0; i < queue->max_threads && !job.job; i++) {
+      struct util_queue_deque *deque = &queue->deques[i];
+
+      mtx_lock(&deque->lock);
+      for (unsigned j = deque->read_idx; j != deque->write_idx; j++) {
+         struct util_queue_job *ptr = &deque->jobs[j & (deque->size - 1)];
+
+         if (ptr->job && ptr->fence == fence) {
+            /* Leave a no-op job behind, it keeps its num_queued slot. */
+            job = *ptr;
+            memset(ptr, 0, sizeof(*ptr));
+            break;
+         }
+      }
+      mtx_unlock(&deque->lock);
+   }
+
+   if (!job.job)
+      return;
+
+   /* The copy takes one slot above max_jobs until the no-op is consumed. */
+   p_atomic_inc(&queue->num_queued);
+
+   mtx_lock(&high->lock);
+   util_queue_deque_push_locked(high, &job);
+   mtx_unlock(&high->lock);
+
+   util_queue_wake_waiter(queue, &queue->num_sleeping,
+                          &queue->has_queued_cond);
+}
+
+/****************************************************************************
+ * Shared ring buffer
+ *
+ * UTIL_QUEUE_PRIORITY_HIGH jobs are kept in order in front of all other
+ * jobs; num_high_queued counts them, starting at read_idx.
+ */
+
+/* Move the job at position "from" (relative to read_idx) to position
+ * "to" <= from, shifting the jobs in between back by one.
+ */
+static void
+util_queue_move_job_locked(struct util_queue *queue, int from, int to)
+{
+   struct util_queue_job job =
+      queue->jobs[(queue->read_idx + from) % queue->max_jobs];
+
+   for (int i = from; i > to; i--) {
+      queue->jobs[(queue->read_idx + i) % queue->max_jobs] =
+         queue->jobs[(queue->read_idx + i - 1) % queue->max_jobs];
+   }
+   queue->jobs[(queue->read_idx + to) % queue->max_jobs] = job;
+}
+
+/* Take the job at read_idx out of the ring buffer. */
+static void
+util_queue_pop_job_locked(struct util_queue *queue, struct util_queue_job *job)
+{
+   *job = queue->jobs[queue->read_idx];
+   memset(&queue->jobs[queue->read_idx], 0, sizeof(struct util_queue_job));
+   queue->read_idx = (queue->read_idx + 1) % queue->max_jobs;
+
+   queue->num_queued--;
+   if (queue->num_high_queued)
+      queue->num_high_queued--;
+   cnd_signal(&queue->has_space_cond);
+   if (job->job)
+      queue->total_jobs_size -= job->job_size;
+}
+
+/* Signal the fences of all jobs left in the ring buffer and drop them. */
+static void
+util_queue_signal_remaining_jobs_locked(struct util_queue *queue)
+{
+   for (unsigned i = queue->read_idx; i != queue->write_idx;
+        i = (i + 1) % queue->max_jobs) {
+      if (queue->jobs[i].job) {
+         util_queue_fence_signal(queue->jobs[i].fence);
+         queue->jobs[i].job = NULL;
+      }
+   }
+   queue->read_idx = queue->write_idx;
+   queue->num_queued = 0;
+   queue->num_high_queued = 0;
+}
+
 static int
 util_queue_thread_func(void *input)
 {
@@ -278,6 +748,11 @@ util_queue_thread_func(void *input)
       u_thread_setname(name);
    }
 
+   if (queue->flags & UTIL_QUEUE_INIT_WORK_STEALING) {
+      util_queue_work_stealing_loop(queue, thread_index);
+      return 0;
+   }
+
    while (1) {
       struct util_queue_job job;
 
@@ -294,41 +769,192 @@ util_queue_thread_func(void *input)
          break;
       }
 
-      job = queue->jobs[queue->read_idx];
-      memset(&queue->jobs[queue->read_idx], 0, sizeof(struct util_queue_job));
-      queue->read_idx = (queue->read_idx + 1) % queue->max_jobs;
-
-      queue->num_queued--;
-      cnd_signal(&queue->has_space_cond);
-      if (job.job)
-         queue->total_jobs_size -= job.job_size;
+      util_queue_pop_job_locked(queue, &job);
       mtx_unlock(&queue->lock);
 
-      if (job.job) {
-         job.execute(job.job, thread_index);
-         util_queue_fence_signal(job.fence);
-         if (job.cleanup)
-            job.cleanup(job.job, thread_index);
-      }
+      if (job.job)
+         util_queue_execute_job(queue, &job, thread_index);
    }
 
    /* signal remaining jobs if all threads are being terminated */
    mtx_lock(&queue->lock);
-   if (queue->num_threads == 0) {
-      for (unsigned i = queue->read_idx; i != queue->write_idx;
-           i = (i + 1) % queue->max_jobs) {
-         if (queue->jobs[i].job) {
-            util_queue_fence_signal(queue->jobs[i].fence);
-            queue->jobs[i].job = NULL;
+   if (queue->num_threads == 0)
+      util_queue_signal_remaining_jobs_locked(queue);
+   mtx_unlock(&queue->lock);
+   return 0;
+}
+
+/****************************************************************************
+ * Shared executor for UTIL_QUEUE_INIT_SHARED_EXECUTOR
+ *
+ * The queues keep their jobs in their own ring buffer, the executor only
+ * owns the threads.  A thread that is looking for work walks the list of
+ * attached queues and takes the first job it is allowed to run, then moves
+ * that queue to the end of the list so that every queue gets its turn.
+ *
+ * Lock order: executor.lock, then util_queue::lock.
+ */
+
+static struct {
+   mtx_t lock;
+   cnd_t has_work_cond;
+   struct list_head queues;
+   unsigned max_threads;
+   unsigned num_threads;
+   unsigned num_idle;    /* threads waiting on has_work_cond */
+} executor;
+
+static once_flag executor_once_flag = ONCE_FLAG_INIT;
+
+static void
+executor_init(void)
+{
+   (void) mtx_init(&executor.lock, mtx_plain);
+   cnd_init(&executor.has_work_cond);
+   list_inithead(&executor.queues);
+
+   util_cpu_detect();
+   executor.max_threads =
+      MAX2(debug_get_num_option("MESA_SHARED_QUEUE_THREADS",
+                                util_cpu_caps.nr_cpus), 1);
+}
+
+/* Take the next job this queue is allowed to run, if any, and reserve a
+ * thread_index for it.
+ */
+static bool
+executor_take_job_locked(struct util_queue *queue, struct util_queue_job *job,
+                         int *thread_index)
+{
+   uint32_t free_slots = ~queue->busy_slots &
+                         (uint32_t)BITFIELD_MASK(queue->num_threads);
+
+   if (!queue->num_queued || !free_slots)
+      return false;
+
+   *thread_index = ffs(free_slots) - 1;
+   queue->busy_slots |= 1u << *thread_index;
+   util_queue_pop_job_locked(queue, job);
+   return true;
+}
+
+static struct util_queue *
+executor_get_job_locked(struct util_queue_job *job, int *thread_index)
+{
+   /* Queues with UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY are only served when
+    * no other queue has work.
+    */
+   for (unsigned low_priority = 0; low_priority < 2; low_priority++) {
+      struct util_queue *queue;
+
+      LIST_FOR_EACH_ENTRY(queue, &executor.queues, executor_link) {
+         if (!(queue->flags & UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY) !=
+             !low_priority)
+            continue;
+
+         mtx_lock(&queue->lock);
+         bool found = executor_take_job_locked(queue, job, thread_index);
+         mtx_unlock(&queue->lock);
+
+         if (found) {
+            list_del(&queue->executor_link);
+            list_addtail(&queue->executor_link, &executor.queues);
+            return queue;
          }
       }
-      queue->read_idx = queue->write_idx;
-      queue->num_queued = 0;
    }
-   mtx_unlock(&queue->lock);
+   return NULL;
+}
+
+static int
+executor_thread_func(void *input)
+{
+   char name[16];
+   snprintf(name, sizeof(name), "mesa_queue%u", (unsigned)(uintptr_t)input);
+   u_thread_setname(name);
+
+   mtx_lock(&executor.lock);
+   while (1) {
+      struct util_queue_job job;
+      int thread_index;
+      struct util_queue *queue = executor_get_job_locked(&job, &thread_index);
+
+      if (!queue) {
+         executor.num_idle++;
+         cnd_wait(&executor.has_work_cond, &executor.lock);
+         executor.num_idle--;
+         continue;
+      }
+
+      /* Let another thread look for more work while we're busy. */
+      if (executor.num_idle)
+         cnd_signal(&executor.has_work_cond);
+      mtx_unlock(&executor.lock);
+
+      if (job.job)
+         util_queue_execute_job(queue, &job, thread_index);
+
+      mtx_lock(&queue->lock);
+      queue->busy_slots &= ~(1u << thread_index);
+      if (!queue->busy_slots)
+         cnd_broadcast(&queue->idle_cond);
+      mtx_unlock(&queue->lock);
+
+      mtx_lock(&executor.lock);
+   }
    return 0;
 }
 
+static bool
+executor_create_thread_locked(void)
+{
+   thrd_t thread = u_thread_create(executor_thread_func,
+                                   (void*)(uintptr_t)executor.num_threads);
+   if (!thread)
+      return false;
+
+   thrd_detach(thread);
+   executor.num_threads++;
+   return true;
+}
+
+/* Make sure a thread will look at the queues, after a job was added or a
+ * queue was allowed to run more jobs at once.
+ */
+static void
+executor_wake(void)
+{
+   mtx_lock(&executor.lock);
+   if (executor.num_idle)
+      cnd_signal(&executor.has_work_cond);
+   else if (executor.num_threads < executor.max_threads)
+      executor_create_thread_locked();
+   mtx_unlock(&executor.lock);
+}
+
+static bool
+executor_add_queue(struct util_queue *queue)
+{
+   call_once(&executor_once_flag, executor_init);
+
+   mtx_lock(&executor.lock);
+   if (!executor.num_threads && !executor_create_thread_locked()) {
+      mtx_unlock(&executor.lock);
+      return false;
+   }
+   list_addtail(&queue->executor_link, &executor.queues);
+   mtx_unlock(&executor.lock);
+   return true;
+}
+
+static void
+executor_remove_queue(struct util_queue *queue)
+{
+   mtx_lock(&executor.lock);
+   list_del(&queue->executor_link);
+   mtx_unlock(&executor.lock);
+}
+
 static bool
 util_queue_create_thread(struct util_queue *queue, unsigned index)
 {
@@ -381,6 +1007,15 @@ util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads)
       return;
    }
 
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_EXECUTOR) {
+      mtx_lock(&queue->lock);
+      queue->num_threads = num_threads;
+      mtx_unlock(&queue->lock);
+      mtx_unlock(&queue->finish_lock);
+      executor_wake();
+      return;
+   }
+
    /* Create threads.
     *
     * We need to update num_threads first, because threads terminate
@@ -424,6 +1059,14 @@ util_queue_init(struct util_queue *queue,
 
    memset(queue, 0, sizeof(*queue));
 
+   if (flags & UTIL_QUEUE_INIT_SHARED_EXECUTOR) {
+      /* Jobs go through the ring buffer, and thread_index has to fit into
+       * busy_slots.
+       */
+      flags &= ~UTIL_QUEUE_INIT_WORK_STEALING;
+      num_threads = MIN2(num_threads, 32);
+   }
+
    if (process_len) {
       snprintf(queue->name, sizeof(queue->name), "%.*s:%s",
                process_len, process_name, name);
@@ -447,11 +1090,36 @@ util_queue_init(struct util_queue *queue,
    queue->num_queued = 0;
    cnd_init(&queue->has_queued_cond);
    cnd_init(&queue->has_space_cond);
+   cnd_init(&queue->idle_cond);
 
    queue->threads = (thrd_t*) calloc(num_threads, sizeof(thrd_t));
    if (!queue->threads)
       goto fail;
 
+   if (flags & UTIL_QUEUE_INIT_WORK_STEALING) {
+      unsigned deque_size =
+         MAX2(util_next_power_of_two(DIV_ROUND_UP(max_jobs, num_threads)), 4);
+
+      queue->deques = (struct util_queue_deque*)
+                      calloc(util_queue_num_deques(queue),
+                             sizeof(struct util_queue_deque));
+      if (!queue->deques)
+         goto fail;
+
+      for (i = 0; i < util_queue_num_deques(queue); i++) {
+         if (!util_queue_deque_init(&queue->deques[i], deque_size))
+            goto fail;
+      }
+   }
+
+   if (flags & UTIL_QUEUE_INIT_SHARED_EXECUTOR) {
+      if (!executor_add_queue(queue))
+         goto fail;
+
+      add_to_atexit_list(queue);
+      return true;
+   }
+
    /* start threads */
    for (i = 0; i < num_threads; i++) {
       if (!util_queue_create_thread(queue, i)) {
@@ -470,9 +1138,11 @@ util_queue_init(struct util_queue *queue,
    return true;
 
 fail:
+   util_queue_destroy_deques(queue);
    free(queue->threads);
 
    if (queue->jobs) {
+      cnd_destroy(&queue->idle_cond);
       cnd_destroy(&queue->has_space_cond);
       cnd_destroy(&queue->has_queued_cond);
       mtx_destroy(&queue->lock);
@@ -498,6 +1168,24 @@ util_queue_kill_threads(struct util_queue *queue, unsigned keep_num_threads,
       return;
    }
 
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_EXECUTOR) {
+      /* Jobs that are already running with a higher thread_index just
+       * finish, no new ones are started.
+       */
+      mtx_lock(&queue->lock);
+      queue->num_threads = keep_num_threads;
+      if (keep_num_threads == 0) {
+         while (queue->busy_slots)
+            cnd_wait(&queue->idle_cond, &queue->lock);
+         util_queue_signal_remaining_jobs_locked(queue);
+      }
+      mtx_unlock(&queue->lock);
+
+      if (!finish_locked)
+         mtx_unlock(&queue->finish_lock);
+      return;
+   }
+
    mtx_lock(&queue->lock);
    unsigned old_num_threads = queue->num_threads;
    /* Setting num_threads is what causes the threads to terminate.
@@ -519,11 +1207,15 @@ util_queue_destroy(struct util_queue *queue)
 {
    util_queue_kill_threads(queue, 0, false);
    remove_from_atexit_list(queue);
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_EXECUTOR)
+      executor_remove_queue(queue);
 
+   cnd_destroy(&queue->idle_cond);
    cnd_destroy(&queue->has_space_cond);
    cnd_destroy(&queue->has_queued_cond);
    mtx_destroy(&queue->finish_lock);
    mtx_destroy(&queue->lock);
+   util_queue_destroy_deques(queue);
    free(queue->jobs);
    free(queue->threads);
 }
@@ -535,8 +1227,39 @@ util_queue_add_job(struct util_queue *queue,
                    util_queue_execute_func execute,
                    util_queue_execute_func cleanup,
                    const size_t job_size)
+{
+   util_queue_add_job_with_priority(queue, job, fence, execute, cleanup,
+                                    job_size, UTIL_QUEUE_PRIORITY_NORMAL);
+}
+
+void
+util_queue_add_job_with_priority(struct util_queue *queue,
+                                 void *job,
+                                 struct util_queue_fence *fence,
+                                 util_queue_execute_func execute,
+                                 util_queue_execute_func cleanup,
+                                 const size_t job_size,
+                                 enum util_queue_priority priority)
 {
    struct util_queue_job *ptr;
+   int64_t enqueue_time = 0;
+
+   if (p_atomic_read(&queue->collect_stats) &&
+       execute != util_queue_finish_execute)
+      enqueue_time = os_time_get_nano();
+
+   if (queue->flags & UTIL_QUEUE_INIT_WORK_STEALING) {
+      struct util_queue_job new_job = {
+         .job = job,
+         .job_size = job_size,
+         .fence = fence,
+         .execute = execute,
+         .cleanup = cleanup,
+         .enqueue_time = enqueue_time,
+      };
+      util_queue_add_job_work_stealing(queue, &new_job, priority);
+      return;
+   }
 
    mtx_lock(&queue->lock);
    if (queue->num_threads == 0) {
@@ -581,6 +1304,7 @@ util_queue_add_job(struct util_queue *queue,
          queue->max_jobs = new_max_jobs;
       } else {
          /* Wait until there is a free slot. */
+         util_queue_stats_count_blocked(queue);
          while (queue->num_queued == queue->max_jobs)
             cnd_wait(&queue->has_space_cond, &queue->lock);
       }
@@ -593,32 +1317,48 @@ util_queue_add_job(struct util_queue *queue,
    ptr->execute = execute;
    ptr->cleanup = cleanup;
    ptr->job_size = job_size;
+   ptr->enqueue_time = enqueue_time;
 
    queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
    queue->total_jobs_size += ptr->job_size;
 
+   if (priority == UTIL_QUEUE_PRIORITY_HIGH) {
+      util_queue_move_job_locked(queue, queue->num_queued,
+                                 queue->num_high_queued);
+      queue->num_high_queued++;
+   }
+
    queue->num_queued++;
+   if (queue->collect_stats)
+      util_queue_stats_update_depth(queue, queue->num_queued);
    cnd_signal(&queue->has_queued_cond);
    mtx_unlock(&queue->lock);
+
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_EXECUTOR)
+      executor_wake();
 }
 
 /**
- * Remove a queued job. If the job hasn't started execution, it's removed from
- * the queue. If the job has started execution, the function waits for it to
- * complete.
- *
- * In all cases, the fence is signalled when the function returns.
+ * Remove a queued job if it hasn't started execution yet. Its cleanup
+ * callback is called with thread_index = -1 and the fence is signalled.
  *
- * The function can be used when destroying an object associated with the job
- * when you don't care about the job completion state.
+ * Returns false if the job is already executing or done, in which case the
+ * fence is left alone.
  */
-void
-util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
+bool
+util_queue_cancel_job(struct util_queue *queue, struct util_queue_fence *fence)
 {
    bool removed = false;
 
    if (util_queue_fence_is_signalled(fence))
-      return;
+      return false;
+
+   if (queue->flags & UTIL_QUEUE_INIT_WORK_STEALING) {
+      removed = util_queue_remove_job_work_stealing(queue, fence);
+      if (removed)
+         util_queue_fence_signal(fence);
+      return removed;
+   }
 
    mtx_lock(&queue->lock);
    for (unsigned i = queue->read_idx; i != queue->write_idx;
@@ -637,10 +1377,57 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
 
    if (removed)
       util_queue_fence_signal(fence);
-   else
+   return removed;
+}
+
+/**
+ * Remove a queued job. If the job hasn't started execution, it's removed from
+ * the queue. If the job has started execution, the function waits for it to
+ * complete.
+ *
+ * In all cases, the fence is signalled when the function returns.
+ *
+ * The function can be used when destroying an object associated with the job
+ * when you don't care about the job completion state.
+ */
+void
+util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
+{
+   if (!util_queue_cancel_job(queue, fence))
       util_queue_fence_wait(fence);
 }
 
+/**
+ * Move a queued job in front of all UTIL_QUEUE_PRIORITY_NORMAL jobs, e.g.
+ * because a thread is about to wait for it. Does nothing if the job has
+ * already started execution or is high priority already.
+ */
+void
+util_queue_promote_job(struct util_queue *queue,
+                       struct util_queue_fence *fence)
+{
+   if (util_queue_fence_is_signalled(fence))
+      return;
+
+   if (queue->flags & UTIL_QUEUE_INIT_WORK_STEALING) {
+      util_queue_promote_job_work_stealing(queue, fence);
+      return;
+   }
+
+   mtx_lock(&queue->lock);
+   for (int i = queue->num_high_queued; i < queue->num_queued; i++) {
+      struct util_queue_job *ptr =
+         &queue->jobs[(queue->read_idx + i) % queue->max_jobs];
+
+      if (ptr->job && ptr->fence == fence) {
+         util_queue_move_job_locked(queue, i, queue->num_high_queued);
+         queue->num_high_queued++;
+         break;
+      }
+   }
+   mtx_unlock(&queue->lock);
+}
+
 static void
 util_queue_finish_execute(void *data, int num_thread)
 {
@@ -669,6 +1456,19 @@ util_queue_finish(struct util_queue *queue)
       return;
    }
 
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_EXECUTOR) {
+      /* The queue has no threads of its own to put behind a barrier, so
+       * wait until it's idle instead. This also waits for jobs that are
+       * added while waiting.
+       */
+      mtx_lock(&queue->lock);
+      while (queue->num_threads && (queue->num_queued || queue->busy_slots))
+         cnd_wait(&queue->idle_cond, &queue->lock);
+      mtx_unlock(&queue->lock);
+      mtx_unlock(&queue->finish_lock);
+      return;
+   }
+
    fences = malloc(queue->num_threads * sizeof(*fences));
    util_barrier_init(&barrier, queue->num_threads);
 
@@ -693,8 +1493,31 @@ int64_t
 util_queue_get_thread_time_nano(struct util_queue *queue, unsigned thread_index)
 {
    /* Allow some flexibility by not raising an error. */
-   if (thread_index >= queue->num_threads)
+   if (thread_index >= queue->num_threads ||
+       queue->flags & UTIL_QUEUE_INIT_SHARED_EXECUTOR)
       return 0;
 
    return u_thread_get_time_nano(queue->threads[thread_index]);
 }
+
+void
+util_queue_enable_stats(struct util_queue *queue)
+{
+   p_atomic_set(&queue->collect_stats, true);
+}
+
+void
+util_queue_get_stats(struct util_queue *queue,
+                     struct util_queue_stats *stats)
+{
+   stats->num_jobs = p_atomic_read(&queue->stats.num_jobs);
+   stats->total_latency_ns = p_atomic_read(&queue->stats.total_latency_ns);
+   stats->total_execute_ns = p_atomic_read(&queue->stats.total_execute_ns);
+   for (unsigned i = 0; i < UTIL_QUEUE_STATS_NUM_BUCKETS; i++) {
+      stats->latency_hist[i] = p_atomic_read(&queue->stats.latency_hist[i]);
+      stats->execute_hist[i] = p_atomic_read(&queue->stats.execute_hist[i]);
+   }
+   stats->num_blocked = p_atomic_read(&queue->stats.num_blocked);
+   stats->max_depth = p_atomic_read(&queue->stats.max_depth);
+   stats->depth = MAX2(p_atomic_read(&queue->num_queued), 0);
+}
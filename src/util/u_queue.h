@@ -49,6 +49,25 @@ extern "C" {
 #define UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY      (1 << 0)
 #define UTIL_QUEUE_INIT_RESIZE_IF_FULL            (1 << 1)
 #define UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY  (1 << 2)
+/* Give every thread its own job deque instead of sharing one ring buffer.
+ * Jobs are distributed round-robin and idle threads steal from the deques
+ * of other threads, so adding and fetching short jobs doesn't serialize all
+ * threads on a single lock.  Jobs are no longer executed in strict FIFO
+ * order across threads.
+ */
+#define UTIL_QUEUE_INIT_WORK_STEALING             (1 << 3)
+/* Don't create any threads, run the jobs on the process-wide pool of worker
+ * threads shared by all queues with this flag instead.  The pool has at most
+ * MESA_SHARED_QUEUE_THREADS threads (the number of CPUs by default) and picks
+ * jobs from the queues round-robin, preferring queues without
+ * UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY.
+ *
+ * num_threads still caps how many jobs of the queue run at once, and
+ * thread_index is unique among them and below num_threads, so per-thread
+ * state indexed by thread_index keeps working.  The thread priority and
+ * affinity flags and UTIL_QUEUE_INIT_WORK_STEALING are ignored.
+ */
+#define UTIL_QUEUE_INIT_SHARED_EXECUTOR           (1 << 4)
 
 #if UTIL_FUTEX_SUPPORTED
 #define UTIL_QUEUE_FENCE_FUTEX
@@ -191,12 +210,46 @@ util_queue_fence_wait_timeout(struct util_queue_fence *fence,
 
 typedef void (*util_queue_execute_func)(void *job, int thread_index);
 
+enum util_queue_priority {
+   UTIL_QUEUE_PRIORITY_NORMAL,
+   /* Executed before all normal priority jobs, in the order added. */
+   UTIL_QUEUE_PRIORITY_HIGH,
+};
+
 struct util_queue_job {
    void *job;
    size_t job_size;
    struct util_queue_fence *fence;
    util_queue_execute_func execute;
    util_queue_execute_func cleanup;
+   int64_t enqueue_time; /* 0 if the queue doesn't collect statistics */
+};
+
+#define UTIL_QUEUE_STATS_NUM_BUCKETS 24
+
+/* Statistics collected after util_queue_enable_stats.
+ *
+ * Bucket i of the histograms counts the jobs that took 2^i to 2^(i+1)
+ * microseconds, bucket 0 also counts shorter ones and the last bucket all
+ * longer ones.  The jobs util_queue_finish adds are not counted.
+ */
+struct util_queue_stats {
+   uint64_t num_jobs;          /* jobs that started executing */
+   uint64_t total_latency_ns;  /* from util_queue_add_job to execution */
+   uint64_t total_execute_ns;
+   uint64_t latency_hist[UTIL_QUEUE_STATS_NUM_BUCKETS];
+   uint64_t execute_hist[UTIL_QUEUE_STATS_NUM_BUCKETS];
+   uint64_t num_blocked;       /* util_queue_add_job calls that waited */
+   unsigned max_depth;         /* most jobs that were queued at once */
+   unsigned depth;             /* jobs queued right now */
+};
+
+/* Per-thread job ring used by UTIL_QUEUE_INIT_WORK_STEALING. */
+struct util_queue_deque {
+   mtx_t lock;
+   struct util_queue_job *jobs;
+   unsigned size; /* power of two, grows on demand */
+   unsigned read_idx, write_idx; /* free-running, masked by size - 1 */
 };
 
 /* Put this into your context. */
@@ -213,9 +266,30 @@ struct util_queue {
    unsigned num_threads; /* decreasing this number will terminate threads */
    int max_jobs;
    int write_idx, read_idx; /* ring buffer pointers */
+   int num_high_queued;     /* high priority jobs at the start of the ring */
    size_t total_jobs_size;  /* memory use of all jobs in the queue */
    struct util_queue_job *jobs;
 
+   /* UTIL_QUEUE_INIT_WORK_STEALING: one deque per thread (max_threads).
+    * num_queued, max_jobs and total_jobs_size are then updated atomically
+    * and "lock" is only taken by threads that need to sleep or wake others.
+    */
+   struct util_queue_deque *deques;
+   unsigned next_deque;
+   int num_sleeping;     /* threads waiting on has_queued_cond */
+   int num_space_waiters; /* threads waiting on has_space_cond */
+
+   /* UTIL_QUEUE_INIT_SHARED_EXECUTOR: bit i is set while a job is running
+    * with thread_index i, protected by "lock".  idle_cond is broadcast when
+    * the last running job finishes.
+    */
+   uint32_t busy_slots;
+   cnd_t idle_cond;
+   struct list_head executor_link; /* protected by the executor lock */
+
+   bool collect_stats;
+   struct util_queue_stats stats; /* updated atomically */
+
    /* for cleanup at exit(), protected by exit_mutex */
    struct list_head head;
 };
@@ -234,8 +308,33 @@ void util_queue_add_job(struct util_queue *queue,
                         util_queue_execute_func execute,
                         util_queue_execute_func cleanup,
                         const size_t job_size);
+void util_queue_add_job_with_priority(struct util_queue *queue,
+                                      void *job,
+                                      struct util_queue_fence *fence,
+                                      util_queue_execute_func execute,
+                                      util_queue_execute_func cleanup,
+                                      const size_t job_size,
+                                      enum util_queue_priority priority);
 void util_queue_drop_job(struct util_queue *queue,
                          struct util_queue_fence *fence);
+bool util_queue_cancel_job(struct util_queue *queue,
+                           struct util_queue_fence *fence);
+void util_queue_promote_job(struct util_queue *queue,
+                            struct util_queue_fence *fence);
+
+/* Wait for a job, moving it to the front of the queue first if it hasn't
+ * started yet. Use this when something (e.g. a draw call) is blocked on the
+ * job, so that it doesn't wait behind background work.
+ */
+static inline void
+util_queue_fence_wait_promote(struct util_queue *queue,
+                              struct util_queue_fence *fence)
+{
+   if (unlikely(!util_queue_fence_is_signalled(fence))) {
+      util_queue_promote_job(queue, fence);
+      _util_queue_fence_wait(fence);
+   }
+}
 
 void util_queue_finish(struct util_queue *queue);
 
@@ -249,6 +348,16 @@ util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads);
 int64_t util_queue_get_thread_time_nano(struct util_queue *queue,
                                         unsigned thread_index);
 
+/* Start collecting statistics for the jobs added from now on. */
+void util_queue_enable_stats(struct util_queue *queue);
+
+/* Return a snapshot of the statistics collected so far. The counters are
+ * cumulative, and they are read one by one, so they may be slightly out of
+ * sync with each other.
+ */
+void util_queue_get_stats(struct util_queue *queue,
+                          struct util_queue_stats *stats);
+
 /* util_queue needs to be cleared to zeroes for this to work */
 static inline bool
 util_queue_is_initialized(struct util_queue *queue)
@@ -27,30 +27,182 @@
 #include "util/u_math.h"
 #include "util/vma.h"
 
+/* Holes are kept in two red-black trees: heap->holes sorts them by address
+ * and is used to find the neighbours of a range in util_vma_heap_free and
+ * util_vma_heap_alloc_addr, while heap->holes_by_size sorts them by size
+ * and lets util_vma_heap_alloc find the smallest hole that fits.  Both
+ * lookups are O(log n) in the number of holes.
+ */
 struct util_vma_hole {
-   struct list_head link;
+   struct rb_node node;
+   struct rb_node size_node;
    uint64_t offset;
    uint64_t size;
+
+   /* Orders holes of the same size in heap->holes_by_size so that the one
+    * at the preferred end of the address space (see alloc_high) comes
+    * first.
+    */
+   uint64_t size_tiebreak;
 };
 
+/* How many holes util_vma_heap_alloc checks for a best fit before it
+ * settles for any hole big enough to fit the allocation regardless of the
+ * alignment of its start.
+ */
+#define UTIL_VMA_MAX_FIT_ATTEMPTS 32
+
+#define util_vma_hole(_node) \
+   rb_node_data(struct util_vma_hole, _node, node)
+
+#define util_vma_hole_by_size(_node) \
+   rb_node_data(struct util_vma_hole, _node, size_node)
+
 #define util_vma_foreach_hole(_hole, _heap) \
-   list_for_each_entry(struct util_vma_hole, _hole, &(_heap)->holes, link)
+   rb_tree_foreach(struct util_vma_hole, _hole, &(_heap)->holes, node)
 
 #define util_vma_foreach_hole_safe(_hole, _heap) \
-   list_for_each_entry_safe(struct util_vma_hole, _hole, &(_heap)->holes, link)
+   rb_tree_foreach_safe(struct util_vma_hole, _hole, &(_heap)->holes, node)
+
+#define util_vma_foreach_hole_rev(_hole, _heap) \
+   rb_tree_foreach_rev(struct util_vma_hole, _hole, &(_heap)->holes, node)
+
+static inline int
+util_vma_cmp_uint64(uint64_t a, uint64_t b)
+{
+   if (a < b)
+      return 1;
+   if (a > b)
+      return -1;
+   return 0;
+}
+
+static int
+util_vma_hole_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+   return util_vma_cmp_uint64(util_vma_hole(a)->offset,
+                              util_vma_hole(b)->offset);
+}
+
+static int
+util_vma_hole_cmp_size(const struct rb_node *a, const struct rb_node *b)
+{
+   const struct util_vma_hole *ha = util_vma_hole_by_size(a);
+   const struct util_vma_hole *hb = util_vma_hole_by_size(b);
+
+   if (ha->size != hb->size)
+      return util_vma_cmp_uint64(ha->size, hb->size);
+
+   return util_vma_cmp_uint64(ha->size_tiebreak, hb->size_tiebreak);
+}
+
+static void
+util_vma_hole_insert_by_size(struct util_vma_heap *heap,
+                             struct util_vma_hole *hole)
+{
+   hole->size_tiebreak = heap->holes_by_size_high ? ~hole->offset :
+                                                    hole->offset;
+   rb_tree_insert(&heap->holes_by_size, &hole->size_node,
+                  util_vma_hole_cmp_size);
+}
+
+/* Make heap->holes_by_size honor the current value of heap->alloc_high,
+ * which the heap's owner is free to change at any time.
+ */
+static void
+util_vma_heap_sort_by_size(struct util_vma_heap *heap)
+{
+   if (heap->holes_by_size_high == heap->alloc_high)
+      return;
+
+   heap->holes_by_size_high = heap->alloc_high;
+   rb_tree_init(&heap->holes_by_size);
+   util_vma_foreach_hole(hole, heap)
+      util_vma_hole_insert_by_size(heap, hole);
+}
+
+static void
+util_vma_hole_create(struct util_vma_heap *heap,
+                     uint64_t offset, uint64_t size)
+{
+   struct util_vma_hole *hole = calloc(1, sizeof(*hole));
 
-#define util_vma_foreach_hole_safe_rev(_hole, _heap) \
-   list_for_each_entry_safe_rev(struct util_vma_hole, _hole, &(_heap)->holes, link)
+   hole->offset = offset;
+   hole->size = size;
+
+   rb_tree_insert(&heap->holes, &hole->node, util_vma_hole_cmp);
+   util_vma_hole_insert_by_size(heap, hole);
+}
+
+static void
+util_vma_hole_destroy(struct util_vma_heap *heap,
+                      struct util_vma_hole *hole)
+{
+   rb_tree_remove(&heap->holes, &hole->node);
+   rb_tree_remove(&heap->holes_by_size, &hole->size_node);
+   free(hole);
+}
+
+/* Changing a hole's range never changes its position relative to the other
+ * holes in the address tree, so only the size tree needs to be updated.
+ */
+static void
+util_vma_hole_resize(struct util_vma_heap *heap, struct util_vma_hole *hole,
+                     uint64_t offset, uint64_t size)
+{
+   rb_tree_remove(&heap->holes_by_size, &hole->size_node);
+   hole->offset = offset;
+   hole->size = size;
+   util_vma_hole_insert_by_size(heap, hole);
+}
+
+/* Returns the highest hole starting at or below offset, or NULL */
+static struct util_vma_hole *
+util_vma_heap_find_hole_below(struct util_vma_heap *heap, uint64_t offset)
+{
+   struct util_vma_hole *found = NULL;
+   struct rb_node *node = heap->holes.root;
+   while (node != NULL) {
+      struct util_vma_hole *hole = util_vma_hole(node);
+      if (hole->offset <= offset) {
+         found = hole;
+         node = node->right;
+      } else {
+         node = node->left;
+      }
+   }
+   return found;
+}
+
+/* Returns the first hole of at least the given size in the size tree */
+static struct rb_node *
+util_vma_heap_find_size(struct util_vma_heap *heap, uint64_t size)
+{
+   struct rb_node *found = NULL;
+   struct rb_node *node = heap->holes_by_size.root;
+   while (node != NULL) {
+      if (util_vma_hole_by_size(node)->size >= size) {
+         found = node;
+         node = node->left;
+      } else {
+         node = node->right;
+      }
+   }
+   return found;
+}
 
 void
 util_vma_heap_init(struct util_vma_heap *heap,
                    uint64_t start, uint64_t size)
 {
-   list_inithead(&heap->holes);
-   util_vma_heap_free(heap, start, size);
+   rb_tree_init(&heap->holes);
+   rb_tree_init(&heap->holes_by_size);
 
    /* Default to using high addresses */
    heap->alloc_high = true;
+   heap->holes_by_size_high = true;
+
+   util_vma_heap_free(heap, start, size);
 }
 
 void
@@ -64,27 +216,27 @@ util_vma_heap_finish(struct util_vma_heap *heap)
 static void
 util_vma_heap_validate(struct util_vma_heap *heap)
 {
-   uint64_t prev_offset = 0;
+   uint64_t prev_end = 0;
    util_vma_foreach_hole(hole, heap) {
       assert(hole->offset > 0);
       assert(hole->size > 0);
 
-      if (&hole->link == heap->holes.next) {
+      /* Holes are ordered low-to-high and must not touch, or else we failed
+       * to join holes during a util_vma_heap_free.
+       */
+      assert(hole->offset > prev_end);
+
+      if (rb_node_next(&hole->node) == NULL) {
          /* This must be the top-most hole.  Assert that, if it overflows, it
           * overflows to 0, i.e. 2^64.
           */
          assert(hole->size + hole->offset == 0 ||
                 hole->size + hole->offset > hole->offset);
       } else {
-         /* This is not the top-most hole so it must not overflow and, in
-          * fact, must be strictly lower than the top-most hole.  If
-          * hole->size + hole->offset == prev_offset, then we failed to join
-          * holes during a util_vma_heap_free.
-          */
-         assert(hole->size + hole->offset > hole->offset &&
-                hole->size + hole->offset < prev_offset);
+         /* This is not the top-most hole so it must not overflow. */
+         assert(hole->size + hole->offset > hole->offset);
       }
-      prev_offset = hole->offset;
+      prev_end = hole->offset + hole->size;
    }
 }
 #else
@@ -92,7 +244,7 @@ util_vma_heap_validate(struct util_vma_heap *heap)
 #endif
 
 static void
-util_vma_hole_alloc(struct util_vma_hole *hole,
+util_vma_hole_alloc(struct util_vma_heap *heap, struct util_vma_hole *hole,
                     uint64_t offset, uint64_t size)
 {
    assert(hole->offset <= offset);
@@ -100,8 +252,7 @@ util_vma_hole_alloc(struct util_vma_hole *hole,
 
    if (offset == hole->offset && size == hole->size) {
       /* Just get rid of the hole. */
-      list_del(&hole->link);
-      free(hole);
+      util_vma_hole_destroy(heap, hole);
       return;
    }
 
@@ -109,33 +260,65 @@ util_vma_hole_alloc(struct util_vma_hole *hole,
    uint64_t waste = (hole->size - size) - (offset - hole->offset);
    if (waste == 0) {
       /* We allocated at the top.  Shrink the hole down. */
-      hole->size -= size;
+      util_vma_hole_resize(heap, hole, hole->offset, hole->size - size);
       return;
    }
 
    if (offset == hole->offset) {
       /* We allocated at the bottom. Shrink the hole up. */
-      hole->offset += size;
-      hole->size -= size;
+      util_vma_hole_resize(heap, hole, hole->offset + size,
+                           hole->size - size);
       return;
    }
 
    /* We allocated in the middle.  We need to split the old hole into two
-    * holes, one high and one low.
+    * holes, one high and one low.  The old hole keeps the amount of space
+    * left at the bottom.
     */
-   struct util_vma_hole *high_hole = calloc(1, sizeof(*hole));
-   high_hole->offset = offset + size;
-   high_hole->size = waste;
+   util_vma_hole_resize(heap, hole, hole->offset, offset - hole->offset);
+   util_vma_hole_create(heap, offset + size, waste);
+}
 
-   /* Adjust the hole to be the amount of space left at he bottom of the
-    * original hole.
-    */
-   hole->size = offset - hole->offset;
+/* Returns the offset at which an allocation of the given size and alignment
+ * would be placed in the hole, or 0 if it doesn't fit.
+ */
+static uint64_t
+util_vma_hole_fit(const struct util_vma_heap *heap,
+                  const struct util_vma_hole *hole,
+                  uint64_t size, uint64_t alignment)
+{
+   assert(size <= hole->size);
 
-   /* Place the new hole before the old hole so that the list is in order
-    * from high to low.
-    */
-   list_addtail(&high_hole->link, &hole->link);
+   if (heap->alloc_high) {
+      /* Compute the offset as the highest address where a chunk of the
+       * given size can be without going over the top of the hole.
+       *
+       * This calculation is known to not overflow because we know that
+       * hole->size + hole->offset can only overflow to 0 and size > 0.
+       */
+      uint64_t offset = (hole->size - size) + hole->offset;
+
+      /* Align the offset.  We align down and not up because we are
+       * allocating from the top of the hole and not the bottom.
+       */
+      offset = (offset / alignment) * alignment;
+
+      return offset < hole->offset ? 0 : offset;
+   } else {
+      uint64_t offset = hole->offset;
+
+      /* Align the offset */
+      uint64_t misalign = offset % alignment;
+      if (misalign) {
+         uint64_t pad = alignment - misalign;
+         if (pad > hole->size - size)
+            return 0;
+
+         offset += pad;
+      }
+
+      return offset;
+   }
 }
 
 uint64_t
@@ -147,53 +330,46 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
    assert(alignment > 0);
 
    util_vma_heap_validate(heap);
+   util_vma_heap_sort_by_size(heap);
 
-   if (heap->alloc_high) {
-      util_vma_foreach_hole_safe(hole, heap) {
-         if (size > hole->size)
-            continue;
-
-         /* Compute the offset as the highest address where a chunk of the
-          * given size can be without going over the top of the hole.
-          *
-          * This calculation is known to not overflow because we know that
-          * hole->size + hole->offset can only overflow to 0 and size > 0.
-          */
-         uint64_t offset = (hole->size - size) + hole->offset;
-
-         /* Align the offset.  We align down and not up because we are
-          * allocating from the top of the hole and not the bottom.
-          */
-         offset = (offset / alignment) * alignment;
-
-         if (offset < hole->offset)
-            continue;
-
-         util_vma_hole_alloc(hole, offset, size);
+   /* A hole of at least size + alignment - 1 fits the allocation wherever
+    * it starts.  Smaller ones may or may not, depending on their alignment.
+    */
+   uint64_t fits_any = size + (alignment - 1);
+   if (fits_any < size)
+      fits_any = UINT64_MAX;
+
+   /* Walk the holes from the smallest one which is large enough, so that we
+    * allocate from the best fit.  If too many holes of about the right size
+    * are misaligned, jump straight to the ones which always fit, and only
+    * come back to the remaining small ones if there are none.
+    */
+   unsigned attempts = 0;
+   struct rb_node *node = util_vma_heap_find_size(heap, size);
+   while (node != NULL) {
+      struct util_vma_hole *hole = util_vma_hole_by_size(node);
+
+      uint64_t offset = util_vma_hole_fit(heap, hole, size, alignment);
+      if (offset != 0) {
+         util_vma_hole_alloc(heap, hole, offset, size);
          util_vma_heap_validate(heap);
          return offset;
       }
-   } else {
-      util_vma_foreach_hole_safe_rev(hole, heap) {
-         if (size > hole->size)
-            continue;
-
-         uint64_t offset = hole->offset;
 
-         /* Align the offset */
-         uint64_t misalign = offset % alignment;
-         if (misalign) {
-            uint64_t pad = alignment - misalign;
-            if (pad > hole->size - size)
-               continue;
+      if (++attempts == UTIL_VMA_MAX_FIT_ATTEMPTS) {
+         struct rb_node *large = util_vma_heap_find_size(heap, fits_any);
+         if (large != NULL) {
+            hole = util_vma_hole_by_size(large);
+            offset = util_vma_hole_fit(heap, hole, size, alignment);
+            assert(offset != 0);
 
-            offset += pad;
+            util_vma_hole_alloc(heap, hole, offset, size);
+            util_vma_heap_validate(heap);
+            return offset;
          }
-
-         util_vma_hole_alloc(hole, offset, size);
-         util_vma_heap_validate(heap);
-         return offset;
       }
+
+      node = rb_node_next(node);
    }
 
    /* Failed to allocate */
@@ -217,25 +393,17 @@ util_vma_heap_alloc_addr(struct util_vma_heap *heap,
     */
    assert(offset + size == 0 || offset + size > offset);
 
-   /* Find the hole if one exists. */
-   util_vma_foreach_hole_safe(hole, heap) {
-      if (hole->offset > offset)
-         continue;
-
-      /* Holes are ordered high-to-low so the first hole we find with
-       * hole->offset <= is our hole.  If it's not big enough to contain the
-       * requested range, then the allocation fails.
-       */
-      assert(hole->offset <= offset);
-      if (hole->size < offset - hole->offset + size)
-         return false;
-
-      util_vma_hole_alloc(hole, offset, size);
-      return true;
-   }
+   /* The only hole which can contain the range is the highest one starting
+    * at or below offset.  If it's not big enough to contain the requested
+    * range, then the allocation fails.
+    */
+   struct util_vma_hole *hole = util_vma_heap_find_hole_below(heap, offset);
+   if (hole == NULL || hole->size < offset - hole->offset + size)
+      return false;
 
-   /* We didn't find a suitable hole */
-   return false;
+   util_vma_heap_sort_by_size(heap);
+   util_vma_hole_alloc(heap, hole, offset, size);
+   return true;
 }
 
 void
@@ -256,16 +424,15 @@ util_vma_heap_free(struct util_vma_heap *heap,
    assert(offset + size == 0 || offset + size > offset);
 
    util_vma_heap_validate(heap);
+   util_vma_heap_sort_by_size(heap);
 
    /* Find immediately higher and lower holes if they exist. */
-   struct util_vma_hole *high_hole = NULL, *low_hole = NULL;
-   util_vma_foreach_hole(hole, heap) {
-      if (hole->offset <= offset) {
-         low_hole = hole;
-         break;
-      }
-      high_hole = hole;
-   }
+   struct util_vma_hole *low_hole =
+      util_vma_heap_find_hole_below(heap, offset);
+   struct rb_node *high_node = low_hole ? rb_node_next(&low_hole->node) :
+                                          rb_tree_first(&heap->holes);
+   struct util_vma_hole *high_hole = high_node ? util_vma_hole(high_node) :
+                                                 NULL;
 
    if (high_hole)
       assert(offset + size <= high_hole->offset);
@@ -279,28 +446,20 @@ util_vma_heap_free(struct util_vma_heap *heap,
 
    if (low_adjacent && high_adjacent) {
       /* Merge the two holes */
-      low_hole->size += size + high_hole->size;
-      list_del(&high_hole->link);
-      free(high_hole);
+      uint64_t high_size = high_hole->size;
+      util_vma_hole_destroy(heap, high_hole);
+      util_vma_hole_resize(heap, low_hole, low_hole->offset,
+                           low_hole->size + size + high_size);
    } else if (low_adjacent) {
       /* Merge into the low hole */
-      low_hole->size += size;
+      util_vma_hole_resize(heap, low_hole, low_hole->offset,
+                           low_hole->size + size);
    } else if (high_adjacent) {
       /* Merge into the high hole */
-      high_hole->offset = offset;
-      high_hole->size += size;
+      util_vma_hole_resize(heap, high_hole, offset, high_hole->size + size);
    } else {
       /* Neither hole is adjacent; make a new one */
-      struct util_vma_hole *hole = calloc(1, sizeof(*hole));
-
-      hole->offset = offset;
-      hole->size = size;
-
-      /* Add it after the high hole so we maintain high-to-low ordering */
-      if (high_hole)
-         list_add(&hole->link, &high_hole->link);
-      else
-         list_add(&hole->link, &heap->holes);
+      util_vma_hole_create(heap, offset, size);
    }
 
    util_vma_heap_validate(heap);
@@ -313,7 +472,7 @@ util_vma_heap_print(struct util_vma_heap *heap, FILE *fp,
    fprintf(fp, "%sutil_vma_heap:\n", tab);
 
    uint64_t total_free = 0;
-   util_vma_foreach_hole(hole, heap) {
+   util_vma_foreach_hole_rev(hole, heap) {
       fprintf(fp, "%s    hole: offset = %"PRIu64" (0x%"PRIx64", "
               "size = %"PRIu64" (0x%"PRIx64")\n",
               tab, hole->offset, hole->offset, hole->size, hole->size);
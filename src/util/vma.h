@@ -24,23 +24,29 @@
 #ifndef _UTIL_VMA_H
 #define _UTIL_VMA_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
-#include "list.h"
+#include "rb_tree.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct util_vma_heap {
-   struct list_head holes;
+   /* Free ranges, indexed both by address and by size */
+   struct rb_tree holes;
+   struct rb_tree holes_by_size;
 
    /** If true, util_vma_heap_alloc will prefer high addresses
     *
     * Default is true.
     */
    bool alloc_high;
+
+   /* Value of alloc_high that holes_by_size is currently sorted for */
+   bool holes_by_size_high;
 };
 
 void util_vma_heap_init(struct util_vma_heap *heap,
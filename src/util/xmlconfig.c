@@ -43,10 +43,14 @@
 #include <dirent.h>
 #include <fnmatch.h>
 #include <regex.h>
+#include <sys/stat.h>
 #include "strndup.h"
 #include "xmlconfig.h"
 #include "u_process.h"
 #include "os_file.h"
+#include "blob.h"
+#include "debug.h"
+#include "simple_mtx.h"
 
 /* For systems like Hurd */
 #ifndef PATH_MAX
@@ -394,14 +398,20 @@ checkValue(const driOptionValue *v, const driOptionInfo *info)
  * 
  * \param f \c printf like format string.
  */
+static bool
+driUtilMessagesEnabled(void)
+{
+    const char *libgl_debug = getenv("LIBGL_DEBUG");
+
+    return libgl_debug && !strstr(libgl_debug, "quiet");
+}
+
 static void
 __driUtilMessage(const char *f, ...)
 {
     va_list args;
-    const char *libgl_debug;
 
-    libgl_debug=getenv("LIBGL_DEBUG");
-    if (libgl_debug && !strstr(libgl_debug, "quiet")) {
+    if (driUtilMessagesEnabled()) {
         fprintf(stderr, "libGL: ");
         va_start(args, f);
         vfprintf(stderr, f, args);
@@ -410,43 +420,47 @@ __driUtilMessage(const char *f, ...)
     }
 }
 
+/* Configuration files replayed from the cache have no parser. */
+#define XML_LINE(p) ((p) ? (int) XML_GetCurrentLineNumber(p) : 0)
+#define XML_COLUMN(p) ((p) ? (int) XML_GetCurrentColumnNumber(p) : 0)
+
 /** \brief Output a warning message. */
 #define XML_WARNING1(msg) do {\
     __driUtilMessage ("Warning in %s line %d, column %d: "msg, data->name, \
-                      (int) XML_GetCurrentLineNumber(data->parser), \
-                      (int) XML_GetCurrentColumnNumber(data->parser)); \
+                      XML_LINE(data->parser), \
+                      XML_COLUMN(data->parser)); \
 } while (0)
 #define XML_WARNING(msg, ...) do { \
     __driUtilMessage ("Warning in %s line %d, column %d: "msg, data->name, \
-                      (int) XML_GetCurrentLineNumber(data->parser), \
-                      (int) XML_GetCurrentColumnNumber(data->parser), \
+                      XML_LINE(data->parser), \
+                      XML_COLUMN(data->parser), \
                       ##__VA_ARGS__); \
 } while (0)
 /** \brief Output an error message. */
 #define XML_ERROR1(msg) do { \
     __driUtilMessage ("Error in %s line %d, column %d: "msg, data->name, \
-                      (int) XML_GetCurrentLineNumber(data->parser), \
-                      (int) XML_GetCurrentColumnNumber(data->parser)); \
+                      XML_LINE(data->parser), \
+                      XML_COLUMN(data->parser)); \
 } while (0)
 #define XML_ERROR(msg, ...) do { \
     __driUtilMessage ("Error in %s line %d, column %d: "msg, data->name, \
-                      (int) XML_GetCurrentLineNumber(data->parser), \
-                      (int) XML_GetCurrentColumnNumber(data->parser), \
+                      XML_LINE(data->parser), \
+                      XML_COLUMN(data->parser), \
                       ##__VA_ARGS__); \
 } while (0)
 /** \brief Output a fatal error message and abort. */
 #define XML_FATAL1(msg) do { \
     fprintf (stderr, "Fatal error in %s line %d, column %d: "msg"\n", \
              data->name, \
-             (int) XML_GetCurrentLineNumber(data->parser),        \
-             (int) XML_GetCurrentColumnNumber(data->parser)); \
+             XML_LINE(data->parser),        \
+             XML_COLUMN(data->parser)); \
     abort();\
 } while (0)
 #define XML_FATAL(msg, ...) do { \
     fprintf (stderr, "Fatal error in %s line %d, column %d: "msg"\n", \
              data->name, \
-             (int) XML_GetCurrentLineNumber(data->parser), \
-             (int) XML_GetCurrentColumnNumber(data->parser), \
+             XML_LINE(data->parser), \
+             XML_COLUMN(data->parser), \
              ##__VA_ARGS__); \
     abort();\
 } while (0)
@@ -777,6 +791,38 @@ valueInRanges(const driOptionInfo *info, uint32_t value)
     return false;
 }
 
+/** \brief SHA1 of the executable, or NULL if it can't be read
+ *
+ * Hashing the whole executable is slow, so it is only done once. */
+static const char *
+getExecSha1(void)
+{
+    static simple_mtx_t mutex = _SIMPLE_MTX_INITIALIZER_NP;
+    static char sha1s[SHA1_DIGEST_STRING_LENGTH];
+    static bool done;
+    const char *result;
+
+    simple_mtx_lock(&mutex);
+    if (!done) {
+        size_t len;
+        char *content;
+        char path[PATH_MAX];
+
+        if (util_get_process_exec_path(path, ARRAY_SIZE(path)) > 0 &&
+            (content = os_read_file(path, &len))) {
+            uint8_t sha1x[SHA1_DIGEST_LENGTH];
+            _mesa_sha1_compute(content, len, sha1x);
+            _mesa_sha1_format(sha1s, sha1x);
+            free(content);
+        }
+        done = true;
+    }
+    result = sha1s[0] ? sha1s : NULL;
+    simple_mtx_unlock(&mutex);
+
+    return result;
+}
+
 /** \brief Parse attributes of an application element. */
 static void
 parseAppAttr(struct OptConfData *data, const XML_Char **attr)
@@ -808,23 +854,10 @@ parseAppAttr(struct OptConfData *data, const XML_Char **attr)
             XML_WARNING("Incorrect sha1 application attribute");
             data->ignoringApp = data->inApp;
         } else {
-            size_t len;
-            char* content;
-            char path[PATH_MAX];
-            if (util_get_process_exec_path(path, ARRAY_SIZE(path)) > 0 &&
-                (content = os_read_file(path, &len))) {
-                uint8_t sha1x[SHA1_DIGEST_LENGTH];
-                char sha1s[SHA1_DIGEST_STRING_LENGTH];
-                _mesa_sha1_compute(content, len, sha1x);
-                _mesa_sha1_format((char*) sha1s, sha1x);
-                free(content);
-
-                if (strcmp(sha1, sha1s)) {
-                    data->ignoringApp = data->inApp;
-                }
-            } else {
+            const char *sha1s = getExecSha1();
+
+            if (!sha1s || strcmp(sha1, sha1s))
                 data->ignoringApp = data->inApp;
-            }
         }
     } else if (application_name_match) {
        regex_t re;
@@ -1012,11 +1045,71 @@ initOptionCache(driOptionCache *cache, const driOptionCache *info)
     }
 }
 
+/* Configuration files are parsed into a list of element events, which is
+ * replayed into optConfStartElem/optConfEndElem for each
+ * driParseConfigFiles call.  The events only depend on the file, so they
+ * are cached in memory and on disk, keyed by the file's mtime, size and
+ * inode.  This saves parsing all of drirc.d for every screen and process.
+ */
+enum OptConfEvent {
+    OCE_END_OF_FILE = 0, OCE_START_ELEM, OCE_END_ELEM
+};
+
+/* Attribute names and values, more are dropped. */
+#define MAX_CONF_ATTRS 32
+
+#define CONF_CACHE_MAGIC 0x43495244 /* "DRIC" */
+#define CONF_CACHE_VERSION 1
+
+struct OptConfFile {
+    struct OptConfFile *next;
+    char *name;
+    uint64_t mtime, size, ino;
+    void *events;
+    size_t eventsSize;
+};
+
+static struct OptConfFile *confFiles;
+static simple_mtx_t confFilesMutex = _SIMPLE_MTX_INITIALIZER_NP;
+
+static uint64_t
+statMtime(const struct stat *st)
+{
+#ifdef __linux__
+    return st->st_mtim.tv_sec * 1000000000ull + st->st_mtim.tv_nsec;
+#else
+    return st->st_mtime;
+#endif
+}
+
+static void
+recordStartElem(void *userData, const XML_Char *name, const XML_Char **attr)
+{
+    struct blob *events = (struct blob *)userData;
+    uint32_t i, n;
+
+    for (n = 0; attr[n] && n < MAX_CONF_ATTRS; n += 2);
+
+    blob_write_uint8(events, OCE_START_ELEM);
+    blob_write_string(events, name);
+    blob_write_uint32(events, n);
+    for (i = 0; i < n; i++)
+        blob_write_string(events, attr[i]);
+}
+
 static void
-_parseOneConfigFile(XML_Parser p)
+recordEndElem(void *userData, const XML_Char *name)
+{
+    struct blob *events = (struct blob *)userData;
+
+    blob_write_uint8(events, OCE_END_ELEM);
+    blob_write_string(events, name);
+}
+
+static void
+_parseOneConfigFile(struct OptConfData *data, XML_Parser p)
 {
 #define BUF_SIZE 0x1000
-    struct OptConfData *data = (struct OptConfData *)XML_GetUserData (p);
     int status;
     int fd;
 
@@ -1052,25 +1145,273 @@ _parseOneConfigFile(XML_Parser p)
 #undef BUF_SIZE
 }
 
+static void
+resetOptConfData(struct OptConfData *data, const char *filename)
+{
+    data->name = filename;
+    data->ignoringDevice = 0;
+    data->ignoringApp = 0;
+    data->inDriConf = 0;
+    data->inDevice = 0;
+    data->inApp = 0;
+    data->inOption = 0;
+}
+
+/** \brief Parse a configuration file into events, false on failure */
+static bool
+recordConfigFile(const char *filename, struct blob *events)
+{
+    struct OptConfData data;
+    XML_Parser p;
+
+    p = XML_ParserCreate (NULL); /* use encoding specified by file */
+    if (!p)
+        return false;
+    XML_SetElementHandler (p, recordStartElem, recordEndElem);
+    XML_SetUserData (p, events);
+    resetOptConfData (&data, filename);
+    data.parser = p;
+
+    _parseOneConfigFile (&data, p);
+    XML_ParserFree (p);
+
+    blob_write_uint8(events, OCE_END_OF_FILE);
+    return !events->out_of_memory;
+}
+
+static void
+replayConfigEvents(struct OptConfData *data, const void *events, size_t size)
+{
+    struct blob_reader reader;
+    const XML_Char *attr[MAX_CONF_ATTRS + 1];
+
+    blob_reader_init(&reader, events, size);
+    while (1) {
+        uint8_t event = blob_read_uint8(&reader);
+        const char *name;
+        uint32_t i, n;
+
+        if (reader.overrun || event == OCE_END_OF_FILE)
+            break;
+
+        name = blob_read_string(&reader);
+        if (event == OCE_START_ELEM) {
+            n = blob_read_uint32(&reader);
+            n = MIN2(n, MAX_CONF_ATTRS);
+            for (i = 0; i < n; i++)
+                attr[i] = blob_read_string(&reader);
+            attr[n] = NULL;
+            if (reader.overrun)
+                break;
+            optConfStartElem (data, name, attr);
+        } else {
+            if (reader.overrun)
+                break;
+            optConfEndElem (data, name);
+        }
+    }
+}
+
+static bool
+confCacheEnabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled < 0)
+        enabled = geteuid() == getuid() &&
+                  env_var_as_boolean("MESA_DRICONF_CACHE", true);
+    return enabled;
+}
+
+/** \brief Path of the on-disk cache of a configuration file
+ *
+ * $XDG_CACHE_HOME/mesa_driconf_cache/<sha1 of the file name>, or
+ * $HOME/.cache/... . The directories are created if create is set. */
+static bool
+confCachePath(const char *filename, char *path, size_t path_size,
+              bool create)
+{
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    uint8_t sha1[SHA1_DIGEST_LENGTH];
+    char sha1s[SHA1_DIGEST_STRING_LENGTH];
+    int len, dirLen;
+
+    if (xdg && *xdg) {
+        len = snprintf(path, path_size, "%s/mesa_driconf_cache", xdg);
+    } else if (home && *home) {
+        len = snprintf(path, path_size, "%s/.cache", home);
+        if (create && len < path_size)
+            mkdir(path, 0755);
+        len = snprintf(path, path_size, "%s/.cache/mesa_driconf_cache", home);
+    } else {
+        return false;
+    }
+    if (len < 0 || len >= path_size)
+        return false;
+    if (create && mkdir(path, 0755) != 0 && errno != EEXIST)
+        return false;
+
+    _mesa_sha1_compute(filename, strlen(filename), sha1);
+    _mesa_sha1_format(sha1s, sha1);
+    dirLen = len;
+    len = snprintf(path + dirLen, path_size - dirLen, "/%s", sha1s);
+    return len > 0 && len < path_size - dirLen;
+}
+
+static bool
+readConfCache(struct OptConfFile *file)
+{
+    char path[PATH_MAX];
+    struct blob_reader reader;
+    const char *name;
+    const void *events;
+    size_t size;
+    char *content;
+    bool valid;
+
+    if (!confCachePath(file->name, path, sizeof(path), false))
+        return false;
+
+    content = os_read_file(path, &size);
+    if (!content)
+        return false;
+
+    blob_reader_init(&reader, content, size);
+    valid = blob_read_uint32(&reader) == CONF_CACHE_MAGIC &&
+            blob_read_uint32(&reader) == CONF_CACHE_VERSION &&
+            (name = blob_read_string(&reader)) && !strcmp(name, file->name) &&
+            blob_read_uint64(&reader) == file->mtime &&
+            blob_read_uint64(&reader) == file->size &&
+            blob_read_uint64(&reader) == file->ino;
+    if (valid) {
+        file->eventsSize = blob_read_uint32(&reader);
+        events = blob_read_bytes(&reader, file->eventsSize);
+        valid = !reader.overrun && (file->events = malloc(file->eventsSize));
+        if (valid)
+            memcpy(file->events, events, file->eventsSize);
+    }
+
+    free(content);
+    return valid;
+}
+
+static void
+writeConfCache(const struct OptConfFile *file)
+{
+    char path[PATH_MAX], tmp[PATH_MAX + 32];
+    struct blob blob;
+    int fd;
+
+    if (!confCachePath(file->name, path, sizeof(path), true))
+        return;
+
+    blob_init(&blob);
+    blob_write_uint32(&blob, CONF_CACHE_MAGIC);
+    blob_write_uint32(&blob, CONF_CACHE_VERSION);
+    blob_write_string(&blob, file->name);
+    blob_write_uint64(&blob, file->mtime);
+    blob_write_uint64(&blob, file->size);
+    blob_write_uint64(&blob, file->ino);
+    blob_write_uint32(&blob, file->eventsSize);
+    blob_write_bytes(&blob, file->events, file->eventsSize);
+
+    /* Write to a temporary file and rename it, so that other processes
+     * never see a partial file. */
+    snprintf(tmp, sizeof(tmp), "%s.tmp%d", path, (int) getpid());
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd != -1) {
+        bool ok = !blob.out_of_memory &&
+                  write(fd, blob.data, blob.size) == (ssize_t) blob.size;
+        close(fd);
+        if (!ok || rename(tmp, path) != 0)
+            unlink(tmp);
+    }
+    blob_finish(&blob);
+}
+
+/** \brief Get the cached events of a configuration file
+ *
+ * Returns NULL if the file doesn't exist or can't be parsed into events, in
+ * which case the caller parses it directly. The entry stays valid until
+ * the process exits. */
+static const struct OptConfFile *
+getConfFile(const char *filename)
+{
+    struct OptConfFile *file;
+    struct stat st;
+    struct blob events;
+
+    if (!confCacheEnabled() || stat(filename, &st) != 0)
+        return NULL;
+
+    simple_mtx_lock(&confFilesMutex);
+
+    for (file = confFiles; file; file = file->next) {
+        if (!strcmp(file->name, filename) &&
+            file->mtime == statMtime(&st) &&
+            file->size == (uint64_t) st.st_size &&
+            file->ino == (uint64_t) st.st_ino)
+            goto out;
+    }
+
+    /* Stale entries are left in the list, they are rare and small. */
+    file = calloc(1, sizeof(*file));
+    if (!file)
+        goto out;
+    file->name = strdup(filename);
+    file->mtime = statMtime(&st);
+    file->size = st.st_size;
+    file->ino = st.st_ino;
+
+    if (!file->name)
+        goto fail;
+
+    if (!readConfCache(file)) {
+        blob_init(&events);
+        if (!recordConfigFile(filename, &events)) {
+            blob_finish(&events);
+            goto fail;
+        }
+        blob_finish_get_buffer(&events, &file->events, &file->eventsSize);
+        writeConfCache(file);
+    }
+
+    file->next = confFiles;
+    confFiles = file;
+    goto out;
+
+fail:
+    free(file->name);
+    free(file);
+    file = NULL;
+out:
+    simple_mtx_unlock(&confFilesMutex);
+    return file;
+}
+
 /** \brief Parse the named configuration file */
 static void
 parseOneConfigFile(struct OptConfData *data, const char *filename)
 {
+    const struct OptConfFile *file;
     XML_Parser p;
 
+    resetOptConfData (data, filename);
+
+    /* Parse directly when debugging, for line numbers in warnings. */
+    if (!driUtilMessagesEnabled() && (file = getConfFile(filename))) {
+        data->parser = NULL;
+        replayConfigEvents (data, file->events, file->eventsSize);
+        return;
+    }
+
     p = XML_ParserCreate (NULL); /* use encoding specified by file */
     XML_SetElementHandler (p, optConfStartElem, optConfEndElem);
     XML_SetUserData (p, data);
     data->parser = p;
-    data->name = filename;
-    data->ignoringDevice = 0;
-    data->ignoringApp = 0;
-    data->inDriConf = 0;
-    data->inDevice = 0;
-    data->inApp = 0;
-    data->inOption = 0;
 
-    _parseOneConfigFile (p);
+    _parseOneConfigFile (data, p);
     XML_ParserFree (p);
 }
 
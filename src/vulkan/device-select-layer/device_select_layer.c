@@ -54,6 +54,16 @@ struct instance_info {
    PFN_vkGetPhysicalDeviceProperties2KHR GetPhysicalDeviceProperties2KHR;
    bool has_props2, has_pci_bus;
    bool has_wayland, has_xcb;
+
+   /* The physical devices with the selected one first, computed on the
+    * first vkEnumeratePhysicalDevices() call.  Probing the devices and the
+    * display server is slow, and the result doesn't change during the life
+    * of the instance.
+    */
+   mtx_t selection_mutex;
+   bool has_selection;
+   uint32_t selected_physical_device_count;
+   VkPhysicalDevice *selected_physical_devices;
 };
 
 static struct hash_table *device_select_instance_ht = NULL;
@@ -173,6 +183,8 @@ static VkResult device_select_CreateInstance(const VkInstanceCreateInfo *pCreate
       DEVSEL_GET_CB(GetPhysicalDeviceProperties2KHR);
 #undef DEVSEL_GET_CB
 
+   mtx_init(&info->selection_mutex, mtx_plain);
+
    device_select_layer_add_instance(*pInstance, info);
 
    return VK_SUCCESS;
@@ -184,6 +196,8 @@ static void device_select_DestroyInstance(VkInstance instance, const VkAllocatio
 
    device_select_layer_remove_instance(instance);
    info->DestroyInstance(instance, pAllocator);
+   mtx_destroy(&info->selection_mutex);
+   free(info->selected_physical_devices);
    free(info);
 }
 
@@ -370,16 +384,13 @@ static uint32_t get_default_device(const struct instance_info *info,
    return default_idx == -1 ? 0 : default_idx;
 }
 
-static VkResult device_select_EnumeratePhysicalDevices(VkInstance instance,
-						       uint32_t* pPhysicalDeviceCount,
-						       VkPhysicalDevice *pPhysicalDevices)
+static VkResult device_select_compute_selection(VkInstance instance,
+                                                struct instance_info *info)
 {
-   struct instance_info *info = device_select_layer_get_instance(instance);
    uint32_t physical_device_count = 0;
    uint32_t selected_physical_device_count = 0;
    const char* selection = getenv("MESA_VK_DEVICE_SELECT");
    VkResult result = info->EnumeratePhysicalDevices(instance, &physical_device_count, NULL);
-   VK_OUTARRAY_MAKE(out, pPhysicalDevices, pPhysicalDeviceCount);
    if (result != VK_SUCCESS)
       return result;
 
@@ -429,20 +440,40 @@ static VkResult device_select_EnumeratePhysicalDevices(VkInstance instance,
       fprintf(stderr, "WARNING: selected no devices with MESA_VK_DEVICE_SELECT\n");
    }
 
-   assert(result == VK_SUCCESS);
+   info->selected_physical_device_count = selected_physical_device_count;
+   info->selected_physical_devices = selected_physical_devices;
+   info->has_selection = true;
+   selected_physical_devices = NULL;
 
-   for (unsigned i = 0; i < selected_physical_device_count; i++) {
-      vk_outarray_append(&out, ent) {
-         *ent = selected_physical_devices[i];
-      }
-   }
-   result = vk_outarray_status(&out);
  out:
    free(physical_devices);
    free(selected_physical_devices);
    return result;
 }
 
+static VkResult device_select_EnumeratePhysicalDevices(VkInstance instance,
+						       uint32_t* pPhysicalDeviceCount,
+						       VkPhysicalDevice *pPhysicalDevices)
+{
+   struct instance_info *info = device_select_layer_get_instance(instance);
+   VkResult result = VK_SUCCESS;
+   VK_OUTARRAY_MAKE(out, pPhysicalDevices, pPhysicalDeviceCount);
+
+   mtx_lock(&info->selection_mutex);
+   if (!info->has_selection)
+      result = device_select_compute_selection(instance, info);
+   mtx_unlock(&info->selection_mutex);
+   if (result != VK_SUCCESS)
+      return result;
+
+   for (unsigned i = 0; i < info->selected_physical_device_count; i++) {
+      vk_outarray_append(&out, ent) {
+         *ent = info->selected_physical_devices[i];
+      }
+   }
+   return vk_outarray_status(&out);
+}
+
 static VkResult device_select_EnumeratePhysicalDeviceGroups(VkInstance instance,
 							    uint32_t* pPhysicalDeviceGroupCount,
 							    VkPhysicalDeviceGroupProperties *pPhysicalDeviceGroups)
@@ -558,6 +558,7 @@ static const char *param_unit(enum overlay_param_enabled param)
 {
    switch (param) {
    case OVERLAY_PARAM_ENABLED_frame_timing:
+   case OVERLAY_PARAM_ENABLED_submit_timing:
    case OVERLAY_PARAM_ENABLED_acquire_timing:
    case OVERLAY_PARAM_ENABLED_present_timing:
       return "(us)";
@@ -828,17 +829,19 @@ static void snapshot_swapchain_frame(struct swapchain_data *data)
                fprintf(instance_data->params.output_file, "\n");
             }
 
+            bool first_column = true;
             for (int s = 0; s < OVERLAY_PARAM_ENABLED_MAX; s++) {
                if (!instance_data->params.enabled[s])
                   continue;
                if (s == OVERLAY_PARAM_ENABLED_fps) {
                   fprintf(instance_data->params.output_file,
-                          "%s%.2f", s == 0 ? "" : ", ", data->fps);
+                          "%s%.2f", first_column ? "" : ", ", data->fps);
                } else {
                   fprintf(instance_data->params.output_file,
-                          "%s%" PRIu64, s == 0 ? "" : ", ",
+                          "%s%" PRIu64, first_column ? "" : ", ",
                           data->accumulated_stats.stats[s]);
                }
+               first_column = false;
             }
             fprintf(instance_data->params.output_file, "\n");
             fflush(instance_data->params.output_file);
@@ -968,6 +971,7 @@ static void compute_swapchain_display(struct swapchain_data *data)
          data->time_dividor = 1000000.0f;
 
       if (s == OVERLAY_PARAM_ENABLED_frame_timing ||
+          s == OVERLAY_PARAM_ENABLED_submit_timing ||
           s == OVERLAY_PARAM_ENABLED_acquire_timing ||
           s == OVERLAY_PARAM_ENABLED_present_timing ||
           s == OVERLAY_PARAM_ENABLED_gpu_timing) {
@@ -2440,7 +2444,12 @@ static VkResult overlay_QueueSubmit(
       }
    }
 
-   return device_data->vtable.QueueSubmit(queue, submitCount, pSubmits, fence);
+   uint64_t ts0 = os_time_get();
+   VkResult result = device_data->vtable.QueueSubmit(queue, submitCount, pSubmits, fence);
+   uint64_t ts1 = os_time_get();
+   device_data->frame_stats.stats[OVERLAY_PARAM_ENABLED_submit_timing] += ts1 - ts0;
+
+   return result;
 }
 
 static VkResult overlay_CreateDevice(
@@ -37,6 +37,7 @@ extern "C" {
    OVERLAY_PARAM_BOOL(frame)                         \
    OVERLAY_PARAM_BOOL(frame_timing)                  \
    OVERLAY_PARAM_BOOL(submit)                        \
+   OVERLAY_PARAM_BOOL(submit_timing)                 \
    OVERLAY_PARAM_BOOL(draw)                          \
    OVERLAY_PARAM_BOOL(draw_indexed)                  \
    OVERLAY_PARAM_BOOL(draw_indirect)                 \
@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "vk_nir_cache.h"
+
+#include <string.h>
+
+#include "compiler/nir/nir.h"
+#include "compiler/nir/nir_serialize.h"
+#include "compiler/spirv/nir_spirv.h"
+#include "util/blob.h"
+#include "util/hash_table.h"
+#include "util/mesa-sha1.h"
+#include "util/ralloc.h"
+
+struct serialized_nir {
+   unsigned char sha1_key[20];
+   size_t size;
+   char data[0];
+};
+
+static uint32_t
+sha1_hash_func(const void *sha1)
+{
+   return _mesa_hash_data(sha1, 20);
+}
+
+static bool
+sha1_compare_func(const void *sha1_a, const void *sha1_b)
+{
+   return memcmp(sha1_a, sha1_b, 20) == 0;
+}
+
+void
+vk_nir_cache_init(struct vk_nir_cache *cache)
+{
+   mtx_init(&cache->mutex, mtx_plain);
+   cache->table = _mesa_hash_table_create(NULL, sha1_hash_func,
+                                          sha1_compare_func);
+}
+
+void
+vk_nir_cache_finish(struct vk_nir_cache *cache)
+{
+   /* The serialized shaders are ralloc'ed off the table. */
+   _mesa_hash_table_destroy(cache->table, NULL);
+   mtx_destroy(&cache->mutex);
+}
+
+struct nir_shader *
+vk_nir_cache_search(struct vk_nir_cache *cache,
+                    const unsigned char sha1_key[20],
+                    const struct nir_shader_compiler_options *nir_options,
+                    void *mem_ctx)
+{
+   const struct serialized_nir *snir = NULL;
+
+   mtx_lock(&cache->mutex);
+   struct hash_entry *entry = _mesa_hash_table_search(cache->table, sha1_key);
+   if (entry)
+      snir = entry->data;
+   mtx_unlock(&cache->mutex);
+
+   if (snir == NULL)
+      return NULL;
+
+   /* Nothing is ever removed from the table before it's destroyed, so the
+    * data stays valid after unlocking.
+    */
+   struct blob_reader blob;
+   blob_reader_init(&blob, snir->data, snir->size);
+
+   nir_shader *nir = nir_deserialize(mem_ctx, nir_options, &blob);
+   if (blob.overrun) {
+      ralloc_free(nir);
+      return NULL;
+   }
+
+   return nir;
+}
+
+void
+vk_nir_cache_upload(struct vk_nir_cache *cache,
+                    const unsigned char sha1_key[20],
+                    const struct nir_shader *nir)
+{
+   mtx_lock(&cache->mutex);
+   struct hash_entry *entry = _mesa_hash_table_search(cache->table, sha1_key);
+   mtx_unlock(&cache->mutex);
+   if (entry)
+      return;
+
+   struct blob blob;
+   blob_init(&blob);
+
+   nir_serialize(&blob, nir, false);
+   if (blob.out_of_memory) {
+      blob_finish(&blob);
+      return;
+   }
+
+   mtx_lock(&cache->mutex);
+   /* Because ralloc isn't thread-safe, we have to do all this inside the
+    * lock.  We could unlock for the big memcpy but it's probably not worth
+    * the hassle.
+    */
+   entry = _mesa_hash_table_search(cache->table, sha1_key);
+   if (entry) {
+      blob_finish(&blob);
+      mtx_unlock(&cache->mutex);
+      return;
+   }
+
+   struct serialized_nir *snir =
+      ralloc_size(cache->table, sizeof(*snir) + blob.size);
+   memcpy(snir->sha1_key, sha1_key, 20);
+   snir->size = blob.size;
+   memcpy(snir->data, blob.data, blob.size);
+
+   blob_finish(&blob);
+
+   _mesa_hash_table_insert(cache->table, snir->sha1_key, snir);
+
+   mtx_unlock(&cache->mutex);
+}
+
+void
+vk_spirv_to_nir_cache_key(const unsigned char module_sha1[20],
+                          const char *entrypoint,
+                          gl_shader_stage stage,
+                          const VkSpecializationInfo *spec_info,
+                          const struct spirv_to_nir_options *options,
+                          unsigned char sha1_out[20])
+{
+   struct mesa_sha1 ctx;
+   _mesa_sha1_init(&ctx);
+
+   _mesa_sha1_update(&ctx, module_sha1, 20);
+   _mesa_sha1_update(&ctx, entrypoint, strlen(entrypoint));
+   _mesa_sha1_update(&ctx, &stage, sizeof(stage));
+   if (spec_info) {
+      _mesa_sha1_update(&ctx, spec_info->pMapEntries,
+                        spec_info->mapEntryCount *
+                        sizeof(*spec_info->pMapEntries));
+      _mesa_sha1_update(&ctx, spec_info->pData,
+                        spec_info->dataSize);
+   }
+
+   /* Hash the options field by field so that padding and the debug
+    * callback don't end up in the key.
+    */
+   if (options) {
+#define HASH(x) _mesa_sha1_update(&ctx, &options->x, sizeof(options->x))
+      HASH(environment);
+      HASH(lower_ubo_ssbo_access_to_offsets);
+      HASH(frag_coord_is_sysval);
+      HASH(caps);
+      HASH(ubo_addr_format);
+      HASH(ssbo_addr_format);
+      HASH(phys_ssbo_addr_format);
+      HASH(push_const_addr_format);
+      HASH(shared_addr_format);
+      HASH(global_addr_format);
+      HASH(temp_addr_format);
+      HASH(constant_as_global);
+#undef HASH
+   }
+
+   _mesa_sha1_final(&ctx, sha1_out);
+}
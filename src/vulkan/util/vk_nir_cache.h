@@ -0,0 +1,85 @@
+/*
+ * Copyright © 2020 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef VK_NIR_CACHE_H
+#define VK_NIR_CACHE_H
+
+#include <vulkan/vulkan.h>
+
+#include "c11/threads.h"
+#include "compiler/shader_enums.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct hash_table;
+struct nir_shader;
+struct nir_shader_compiler_options;
+struct spirv_to_nir_options;
+
+/** An in-memory cache of NIR shaders translated from SPIR-V
+ *
+ * Drivers run spirv_to_nir and the same generic lowering for every stage
+ * of every pipeline, even for modules they have seen before.  They can keep
+ * the resulting NIR in one of these, keyed by vk_spirv_to_nir_cache_key(),
+ * and deserialize it instead of translating the module again.
+ *
+ * Everything else which affects the cached NIR, such as driver lowering
+ * done before uploading, has to either be the same for every user of the
+ * cache or be folded into the key by the driver.
+ */
+struct vk_nir_cache {
+   mtx_t mutex;
+   struct hash_table *table;
+};
+
+void vk_nir_cache_init(struct vk_nir_cache *cache);
+void vk_nir_cache_finish(struct vk_nir_cache *cache);
+
+/* Returns a new shader allocated out of mem_ctx, or NULL on a miss. */
+struct nir_shader *
+vk_nir_cache_search(struct vk_nir_cache *cache,
+                    const unsigned char sha1_key[20],
+                    const struct nir_shader_compiler_options *nir_options,
+                    void *mem_ctx);
+
+void vk_nir_cache_upload(struct vk_nir_cache *cache,
+                         const unsigned char sha1_key[20],
+                         const struct nir_shader *nir);
+
+/* Hashes everything spirv_to_nir gets to see for one pipeline stage.
+ * module_sha1 is the hash of the SPIR-V words.  spec_info and options may
+ * be NULL.
+ */
+void vk_spirv_to_nir_cache_key(const unsigned char module_sha1[20],
+                               const char *entrypoint,
+                               gl_shader_stage stage,
+                               const VkSpecializationInfo *spec_info,
+                               const struct spirv_to_nir_options *options,
+                               unsigned char sha1_out[20]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VK_NIR_CACHE_H */
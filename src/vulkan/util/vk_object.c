@@ -57,6 +57,9 @@ vk_device_init(struct vk_device *device,
 
    p_atomic_set(&device->private_data_next_index, 0);
 
+   mtx_init(&device->object_cache_mtx, mtx_plain);
+   memset(device->object_cache, 0, sizeof(device->object_cache));
+
 #ifdef ANDROID
    mtx_init(&device->swapchain_private_mtx, mtx_plain);
    device->swapchain_private = NULL;
@@ -74,17 +77,106 @@ vk_device_finish(UNUSED struct vk_device *device)
    }
 #endif /* ANDROID */
 
+   for (unsigned i = 0; i < VK_OBJECT_CACHE_TYPE_COUNT; i++) {
+      void *next;
+      for (void *ptr = device->object_cache[i].free_list; ptr; ptr = next) {
+         next = *(void **)ptr;
+         vk_free(&device->alloc, ptr);
+      }
+   }
+   mtx_destroy(&device->object_cache_mtx);
+
    vk_object_base_finish(&device->base);
 }
 
+static int
+vk_object_cache_index(VkObjectType obj_type)
+{
+   switch (obj_type) {
+   case VK_OBJECT_TYPE_SAMPLER:     return 0;
+   case VK_OBJECT_TYPE_IMAGE_VIEW:  return 1;
+   case VK_OBJECT_TYPE_BUFFER_VIEW: return 2;
+   default:                         return -1;
+   }
+}
+
+/* Returns a cached object of the given type and size, or NULL. */
+static void *
+vk_object_cache_get(struct vk_device *device,
+                    const VkAllocationCallbacks *alloc,
+                    size_t size,
+                    VkObjectType obj_type)
+{
+   int idx = vk_object_cache_index(obj_type);
+   if (alloc != NULL || idx < 0)
+      return NULL;
+
+   struct vk_object_cache *cache = &device->object_cache[idx];
+   void *ptr = NULL;
+
+   mtx_lock(&device->object_cache_mtx);
+   if (cache->size == 0)
+      cache->size = size;
+
+   if (cache->size != size && !cache->disabled) {
+      /* Mixed sizes, the cached memory may be too small. */
+      cache->disabled = true;
+      void *next;
+      for (void *p = cache->free_list; p; p = next) {
+         next = *(void **)p;
+         vk_free(&device->alloc, p);
+      }
+      cache->free_list = NULL;
+      cache->count = 0;
+   }
+
+   if (cache->free_list) {
+      ptr = cache->free_list;
+      cache->free_list = *(void **)ptr;
+      cache->count--;
+   }
+   mtx_unlock(&device->object_cache_mtx);
+
+   return ptr;
+}
+
+/* Returns whether the cache took the memory of the object. */
+static bool
+vk_object_cache_put(struct vk_device *device,
+                    const VkAllocationCallbacks *alloc,
+                    void *data,
+                    VkObjectType obj_type)
+{
+   int idx = vk_object_cache_index(obj_type);
+   if (alloc != NULL || idx < 0)
+      return false;
+
+   struct vk_object_cache *cache = &device->object_cache[idx];
+   bool cached = false;
+
+   mtx_lock(&device->object_cache_mtx);
+   if (!cache->disabled && cache->count < VK_OBJECT_CACHE_MAX_ENTRIES) {
+      *(void **)data = cache->free_list;
+      cache->free_list = data;
+      cache->count++;
+      cached = true;
+   }
+   mtx_unlock(&device->object_cache_mtx);
+
+   return cached;
+}
+
 void *
 vk_object_alloc(struct vk_device *device,
                 const VkAllocationCallbacks *alloc,
                 size_t size,
                 VkObjectType obj_type)
 {
-   void *ptr = vk_alloc2(&device->alloc, alloc, size, 8,
-                         VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+   void *ptr = vk_object_cache_get(device, alloc, size, obj_type);
+   if (ptr == NULL) {
+      ptr = vk_alloc2(&device->alloc, alloc, size, 8,
+                      VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+   }
    if (ptr == NULL)
       return NULL;
 
@@ -99,8 +191,13 @@ vk_object_zalloc(struct vk_device *device,
                 size_t size,
                 VkObjectType obj_type)
 {
-   void *ptr = vk_zalloc2(&device->alloc, alloc, size, 8,
-                         VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+   void *ptr = vk_object_cache_get(device, alloc, size, obj_type);
+   if (ptr != NULL) {
+      memset(ptr, 0, size);
+   } else {
+      ptr = vk_zalloc2(&device->alloc, alloc, size, 8,
+                       VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+   }
    if (ptr == NULL)
       return NULL;
 
@@ -114,8 +211,12 @@ vk_object_free(struct vk_device *device,
                const VkAllocationCallbacks *alloc,
                void *data)
 {
-   vk_object_base_finish((struct vk_object_base *)data);
-   vk_free2(&device->alloc, alloc, data);
+   struct vk_object_base *base = data;
+   VkObjectType obj_type = base->type;
+
+   vk_object_base_finish(base);
+   if (!vk_object_cache_put(device, alloc, data, obj_type))
+      vk_free2(&device->alloc, alloc, data);
 }
 
 VkResult
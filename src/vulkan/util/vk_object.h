@@ -67,6 +67,20 @@ vk_object_base_from_u64_handle(uint64_t handle, VkObjectType obj_type)
 }
 
 
+/* Object types whose freed memory vk_object_free() keeps for reuse */
+#define VK_OBJECT_CACHE_TYPE_COUNT 3
+#define VK_OBJECT_CACHE_MAX_ENTRIES 64
+
+struct vk_object_cache {
+   /* Size of every object of the type so far, 0 before the first one */
+   size_t size;
+   /* Set when objects of the type turn out not to have a fixed size */
+   bool disabled;
+
+   uint32_t count;
+   void *free_list;
+};
+
 struct vk_device {
    struct vk_object_base base;
    VkAllocationCallbacks alloc;
@@ -74,6 +88,13 @@ struct vk_device {
    /* For VK_EXT_private_data */
    uint32_t private_data_next_index;
 
+   /* Samplers, image views and buffer views are often created and destroyed
+    * every frame.  The ones allocated with the device allocator are recycled
+    * through these lists instead of going back to the host allocator.
+    */
+   mtx_t object_cache_mtx;
+   struct vk_object_cache object_cache[VK_OBJECT_CACHE_TYPE_COUNT];
+
 #ifdef ANDROID
    mtx_t swapchain_private_mtx;
    struct hash_table *swapchain_private;
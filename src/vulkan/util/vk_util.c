@@ -67,3 +67,43 @@ uint32_t vk_get_version_override(void)
 
    return VK_MAKE_VERSION(major, minor, patch);
 }
+
+void
+vk_pipeline_cache_header_init(struct vk_pipeline_cache_header *header,
+                              uint32_t vendor_id, uint32_t device_id,
+                              const uint8_t uuid[VK_UUID_SIZE])
+{
+   header->header_size = sizeof(*header);
+   header->header_version = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+   header->vendor_id = vendor_id;
+   header->device_id = device_id;
+   memcpy(header->uuid, uuid, VK_UUID_SIZE);
+}
+
+/**
+ * Checks that pipeline cache data was written by this device and driver
+ * build, and returns the size of its header, or 0 if it can't be used.
+ */
+size_t
+vk_pipeline_cache_header_check(const void *data, size_t size,
+                               uint32_t vendor_id, uint32_t device_id,
+                               const uint8_t uuid[VK_UUID_SIZE])
+{
+   struct vk_pipeline_cache_header header;
+
+   if (size < sizeof(header))
+      return 0;
+   memcpy(&header, data, sizeof(header));
+   if (header.header_size < sizeof(header) || header.header_size > size)
+      return 0;
+   if (header.header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+      return 0;
+   if (header.vendor_id != vendor_id)
+      return 0;
+   if (header.device_id != device_id)
+      return 0;
+   if (memcmp(header.uuid, uuid, VK_UUID_SIZE) != 0)
+      return 0;
+
+   return header.header_size;
+}
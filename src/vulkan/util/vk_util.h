@@ -220,6 +220,14 @@ struct vk_pipeline_cache_header {
    uint8_t  uuid[VK_UUID_SIZE];
 };
 
+void vk_pipeline_cache_header_init(struct vk_pipeline_cache_header *header,
+                                   uint32_t vendor_id, uint32_t device_id,
+                                   const uint8_t uuid[VK_UUID_SIZE]);
+
+size_t vk_pipeline_cache_header_check(const void *data, size_t size,
+                                      uint32_t vendor_id, uint32_t device_id,
+                                      const uint8_t uuid[VK_UUID_SIZE]);
+
 #define VK_EXT_OFFSET (1000000000UL)
 #define VK_ENUM_EXTENSION(__enum) \
    ((__enum) >= VK_EXT_OFFSET ? ((((__enum) - VK_EXT_OFFSET) / 1000UL) + 1) : 0)
@@ -345,6 +345,130 @@ align_u32(uint32_t v, uint32_t a)
    return (v + a - 1) & ~(a - 1);
 }
 
+/* Returns the modifiers the driver supports for the swapchain images, as
+ * an array allocated from alloc.
+ */
+static VkResult
+wsi_get_supported_modifiers(const struct wsi_device *wsi,
+                            const VkAllocationCallbacks *alloc,
+                            const VkSwapchainCreateInfoKHR *pCreateInfo,
+                            VkDrmFormatModifierPropertiesEXT **props_out,
+                            uint32_t *count_out)
+{
+   VkImageCreateFlags flags = 0;
+   const VkImageFormatListCreateInfoKHR *format_list_in = NULL;
+   if (pCreateInfo->flags & VK_SWAPCHAIN_CREATE_MUTABLE_FORMAT_BIT_KHR) {
+      flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT |
+               VK_IMAGE_CREATE_EXTENDED_USAGE_BIT_KHR;
+      format_list_in = vk_find_struct_const(pCreateInfo->pNext,
+                                            IMAGE_FORMAT_LIST_CREATE_INFO_KHR);
+   }
+
+   struct VkDrmFormatModifierPropertiesListEXT modifier_props_list = {
+      .sType = VK_STRUCTURE_TYPE_DRM_FORMAT_MODIFIER_PROPERTIES_LIST_EXT,
+   };
+   VkFormatProperties2 format_props = {
+      .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
+      .pNext = &modifier_props_list,
+   };
+   wsi->GetPhysicalDeviceFormatProperties2KHR(wsi->pdevice,
+                                              pCreateInfo->imageFormat,
+                                              &format_props);
+   assert(modifier_props_list.drmFormatModifierCount > 0);
+   VkDrmFormatModifierPropertiesEXT *modifier_props =
+      vk_alloc(alloc, sizeof(*modifier_props) *
+                      modifier_props_list.drmFormatModifierCount,
+               8, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+   if (!modifier_props)
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+   modifier_props_list.pDrmFormatModifierProperties = modifier_props;
+   wsi->GetPhysicalDeviceFormatProperties2KHR(wsi->pdevice,
+                                              pCreateInfo->imageFormat,
+                                              &format_props);
+
+   /* Call GetImageFormatProperties with every modifier and filter the list
+    * down to those that we know work.
+    */
+   uint32_t modifier_prop_count = 0;
+   for (uint32_t i = 0; i < modifier_props_list.drmFormatModifierCount; i++) {
+      VkPhysicalDeviceImageDrmFormatModifierInfoEXT mod_info = {
+         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_DRM_FORMAT_MODIFIER_INFO_EXT,
+         .drmFormatModifier = modifier_props[i].drmFormatModifier,
+         .sharingMode = pCreateInfo->imageSharingMode,
+         .queueFamilyIndexCount = pCreateInfo->queueFamilyIndexCount,
+         .pQueueFamilyIndices = pCreateInfo->pQueueFamilyIndices,
+      };
+      VkPhysicalDeviceImageFormatInfo2 format_info = {
+         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
+         .format = pCreateInfo->imageFormat,
+         .type = VK_IMAGE_TYPE_2D,
+         .tiling = VK_IMAGE_TILING_DRM_FORMAT_MODIFIER_EXT,
+         .usage = pCreateInfo->imageUsage,
+         .flags = flags,
+      };
+
+      VkImageFormatListCreateInfoKHR format_list;
+      if (format_list_in) {
+         format_list = *format_list_in;
+         format_list.pNext = NULL;
+         __vk_append_struct(&format_info, &format_list);
+      }
+
+      VkImageFormatProperties2 format_props = {
+         .sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
+         .pNext = NULL,
+      };
+      __vk_append_struct(&format_info, &mod_info);
+      VkResult result =
+         wsi->GetPhysicalDeviceImageFormatProperties2(wsi->pdevice,
+                                                      &format_info,
+                                                      &format_props);
+      if (result == VK_SUCCESS)
+         modifier_props[modifier_prop_count++] = modifier_props[i];
+   }
+
+   *props_out = modifier_props;
+   *count_out = modifier_prop_count;
+
+   return VK_SUCCESS;
+}
+
+/**
+ * Whether one of the modifiers in the lists can be used for the swapchain
+ * images, i.e. whether wsi_create_native_image() can honour them.
+ */
+bool
+wsi_has_common_modifier(const struct wsi_device *wsi,
+                        const VkSwapchainCreateInfoKHR *pCreateInfo,
+                        uint32_t num_modifier_lists,
+                        const uint32_t *num_modifiers,
+                        const uint64_t *const *modifiers)
+{
+   VkDrmFormatModifierPropertiesEXT *modifier_props;
+   uint32_t modifier_prop_count;
+   if (wsi_get_supported_modifiers(wsi, &wsi->instance_alloc, pCreateInfo,
+                                   &modifier_props,
+                                   &modifier_prop_count) != VK_SUCCESS)
+      return false;
+
+   bool found = false;
+   for (uint32_t l = 0; l < num_modifier_lists && !found; l++) {
+      for (uint32_t i = 0; i < num_modifiers[l] && !found; i++) {
+         for (uint32_t j = 0; j < modifier_prop_count; j++) {
+            if (modifier_props[j].drmFormatModifier == modifiers[l][i]) {
+               found = true;
+               break;
+            }
+         }
+      }
+   }
+
+   vk_free(&wsi->instance_alloc, modifier_props);
+
+   return found;
+}
+
 VkResult
 wsi_create_native_image(const struct wsi_swapchain *chain,
                         const VkSwapchainCreateInfoKHR *pCreateInfo,
@@ -420,71 +544,11 @@ wsi_create_native_image(const struct wsi_swapchain *chain,
    } else {
       /* The winsys can't request modifiers if we don't support them. */
       assert(wsi->supports_modifiers);
-      struct VkDrmFormatModifierPropertiesListEXT modifier_props_list = {
-         .sType = VK_STRUCTURE_TYPE_DRM_FORMAT_MODIFIER_PROPERTIES_LIST_EXT,
-      };
-      VkFormatProperties2 format_props = {
-         .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
-         .pNext = &modifier_props_list,
-      };
-      wsi->GetPhysicalDeviceFormatProperties2KHR(wsi->pdevice,
-                                                 pCreateInfo->imageFormat,
-                                                 &format_props);
-      assert(modifier_props_list.drmFormatModifierCount > 0);
-      modifier_props = vk_alloc(&chain->alloc,
-                                sizeof(*modifier_props) *
-                                modifier_props_list.drmFormatModifierCount,
-                                8,
-                                VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
-      if (!modifier_props) {
-         result = VK_ERROR_OUT_OF_HOST_MEMORY;
+      result = wsi_get_supported_modifiers(wsi, &chain->alloc, pCreateInfo,
+                                           &modifier_props,
+                                           &modifier_prop_count);
+      if (result != VK_SUCCESS)
          goto fail;
-      }
-
-      modifier_props_list.pDrmFormatModifierProperties = modifier_props;
-      wsi->GetPhysicalDeviceFormatProperties2KHR(wsi->pdevice,
-                                                 pCreateInfo->imageFormat,
-                                                 &format_props);
-
-      /* Call GetImageFormatProperties with every modifier and filter the list
-       * down to those that we know work.
-       */
-      modifier_prop_count = 0;
-      for (uint32_t i = 0; i < modifier_props_list.drmFormatModifierCount; i++) {
-         VkPhysicalDeviceImageDrmFormatModifierInfoEXT mod_info = {
-            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_DRM_FORMAT_MODIFIER_INFO_EXT,
-            .drmFormatModifier = modifier_props[i].drmFormatModifier,
-            .sharingMode = pCreateInfo->imageSharingMode,
-            .queueFamilyIndexCount = pCreateInfo->queueFamilyIndexCount,
-            .pQueueFamilyIndices = pCreateInfo->pQueueFamilyIndices,
-         };
-         VkPhysicalDeviceImageFormatInfo2 format_info = {
-            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
-            .format = pCreateInfo->imageFormat,
-            .type = VK_IMAGE_TYPE_2D,
-            .tiling = VK_IMAGE_TILING_DRM_FORMAT_MODIFIER_EXT,
-            .usage = pCreateInfo->imageUsage,
-            .flags = image_info.flags,
-         };
-
-         VkImageFormatListCreateInfoKHR format_list;
-         if (image_info.flags & VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT) {
-            format_list = image_format_list;
-            format_list.pNext = NULL;
-            __vk_append_struct(&format_info, &format_list);
-         }
-
-         VkImageFormatProperties2 format_props = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
-            .pNext = NULL,
-         };
-         __vk_append_struct(&format_info, &mod_info);
-         result = wsi->GetPhysicalDeviceImageFormatProperties2(wsi->pdevice,
-                                                               &format_info,
-                                                               &format_props);
-         if (result == VK_SUCCESS)
-            modifier_props[modifier_prop_count++] = modifier_props[i];
-      }
 
       uint32_t max_modifier_count = 0;
       for (uint32_t l = 0; l < num_modifier_lists; l++)
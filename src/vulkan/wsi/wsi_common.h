@@ -114,6 +114,18 @@ struct wsi_device {
        * driver in VkSurfaceCapabilitiesKHR::minImageCount.
        */
       bool ensure_minImageCount;
+
+      /* In FIFO mode, makes vkAcquireNextImageKHR wait until fewer than
+       * this many presented frames are still waiting to be displayed.
+       * 0 = no limit
+       */
+      uint32_t max_frame_latency;
+
+      /* When the display GPU isn't ours, share the swapchain images with it
+       * using a modifier both GPUs support instead of blitting each frame
+       * into a linear buffer.
+       */
+      bool prime_direct;
    } x11;
 
    /* Signals the semaphore such that any wait on the semaphore will wait on
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <pthread.h>
 #include <poll.h>
@@ -724,6 +725,7 @@ VkResult wsi_create_wl_surface(const VkAllocationCallbacks *pAllocator,
 
 struct wsi_wl_image {
    struct wsi_image                             base;
+   struct wsi_wl_swapchain *                    chain;
    struct wl_buffer *                           buffer;
    bool                                         busy;
 };
@@ -753,6 +755,22 @@ struct wsi_wl_swapchain {
    VkPresentModeKHR                             present_mode;
    bool                                         fifo_ready;
 
+   /* The swapchain objects live on their own event queue, which
+    * event_thread dispatches as soon as events arrive.  That way, buffer
+    * releases and frame callbacks don't wait for the app to call into us.
+    */
+   struct wl_event_queue *                      queue;
+   pthread_t                                    event_thread;
+   bool                                         has_event_thread;
+   int                                          event_thread_pipe[2];
+
+   /* Protects the busy flags of the images, frame, fifo_ready and status
+    * against the event thread.
+    */
+   pthread_mutex_t                              lock;
+   pthread_cond_t                               cond;
+   VkResult                                     status;
+
    struct wsi_wl_image                          images[0];
 };
 VK_DEFINE_NONDISP_HANDLE_CASTS(wsi_wl_swapchain, base.base, VkSwapchainKHR,
@@ -774,71 +792,56 @@ wsi_wl_swapchain_acquire_next_image(struct wsi_swapchain *wsi_chain,
    struct wsi_wl_swapchain *chain = (struct wsi_wl_swapchain *)wsi_chain;
    struct timespec start_time, end_time;
    struct timespec rel_timeout;
-   int wl_fd = wl_display_get_fd(chain->display->wl_display);
+   VkResult result;
 
    timespec_from_nsec(&rel_timeout, info->timeout);
 
    clock_gettime(CLOCK_MONOTONIC, &start_time);
    timespec_add(&end_time, &rel_timeout, &start_time);
 
+   pthread_mutex_lock(&chain->lock);
+
    while (1) {
-      /* Try to dispatch potential events. */
-      int ret = wl_display_dispatch_queue_pending(chain->display->wl_display,
-                                                  chain->display->queue);
-      if (ret < 0)
-         return VK_ERROR_OUT_OF_DATE_KHR;
+      if (chain->status < 0) {
+         result = chain->status;
+         break;
+      }
 
       /* Try to find a free image. */
+      bool found = false;
       for (uint32_t i = 0; i < chain->base.image_count; i++) {
          if (!chain->images[i].busy) {
             /* We found a non-busy image */
             *image_index = i;
             chain->images[i].busy = true;
-            return VK_SUCCESS;
+            found = true;
+            break;
          }
       }
-
-      /* Check for timeout. */
-      struct timespec current_time;
-      clock_gettime(CLOCK_MONOTONIC, &current_time);
-      if (timespec_after(&current_time, &end_time))
-         return VK_NOT_READY;
-
-      /* Try to read events from the server. */
-      ret = wl_display_prepare_read_queue(chain->display->wl_display,
-                                          chain->display->queue);
-      if (ret < 0) {
-         /* Another thread might have read events for our queue already. Go
-          * back to dispatch them.
-          */
-         if (errno == EAGAIN)
-            continue;
-         return VK_ERROR_OUT_OF_DATE_KHR;
+      if (found) {
+         result = VK_SUCCESS;
+         break;
       }
 
-      struct pollfd pollfd = {
-         .fd = wl_fd,
-         .events = POLLIN
-      };
-      timespec_sub(&rel_timeout, &end_time, &current_time);
-      ret = ppoll(&pollfd, 1, &rel_timeout, NULL);
-      if (ret <= 0) {
-         int lerrno = errno;
-         wl_display_cancel_read(chain->display->wl_display);
-         if (ret < 0) {
-            /* If ppoll() was interrupted, try again. */
-            if (lerrno == EINTR || lerrno == EAGAIN)
-               continue;
-            return VK_ERROR_OUT_OF_DATE_KHR;
-         }
-         assert(ret == 0);
-         continue;
+      if (info->timeout == 0) {
+         result = VK_NOT_READY;
+         break;
       }
 
-      ret = wl_display_read_events(chain->display->wl_display);
-      if (ret < 0)
-         return VK_ERROR_OUT_OF_DATE_KHR;
+      /* Wait for the event thread to release an image. */
+      int ret = pthread_cond_timedwait(&chain->cond, &chain->lock, &end_time);
+      if (ret == ETIMEDOUT) {
+         result = VK_TIMEOUT;
+         break;
+      } else if (ret) {
+         result = VK_ERROR_OUT_OF_DATE_KHR;
+         break;
+      }
    }
+
+   pthread_mutex_unlock(&chain->lock);
+
+   return result;
 }
 
 static void
@@ -846,8 +849,11 @@ frame_handle_done(void *data, struct wl_callback *callback, uint32_t serial)
 {
    struct wsi_wl_swapchain *chain = data;
 
+   pthread_mutex_lock(&chain->lock);
    chain->frame = NULL;
    chain->fifo_ready = true;
+   pthread_cond_broadcast(&chain->cond);
+   pthread_mutex_unlock(&chain->lock);
 
    wl_callback_destroy(callback);
 }
@@ -863,13 +869,17 @@ wsi_wl_swapchain_queue_present(struct wsi_swapchain *wsi_chain,
 {
    struct wsi_wl_swapchain *chain = (struct wsi_wl_swapchain *)wsi_chain;
 
+   pthread_mutex_lock(&chain->lock);
+
    if (chain->base.present_mode == VK_PRESENT_MODE_FIFO_KHR) {
-      while (!chain->fifo_ready) {
-         int ret = wl_display_dispatch_queue(chain->display->wl_display,
-                                             chain->display->queue);
-         if (ret < 0)
-            return VK_ERROR_OUT_OF_DATE_KHR;
-      }
+      while (!chain->fifo_ready && chain->status >= 0)
+         pthread_cond_wait(&chain->cond, &chain->lock);
+   }
+
+   if (chain->status < 0) {
+      VkResult result = chain->status;
+      pthread_mutex_unlock(&chain->lock);
+      return result;
    }
 
    assert(image_index < chain->base.image_count);
@@ -896,6 +906,9 @@ wsi_wl_swapchain_queue_present(struct wsi_swapchain *wsi_chain,
 
    chain->images[image_index].busy = true;
    wl_surface_commit(chain->surface);
+
+   pthread_mutex_unlock(&chain->lock);
+
    wl_display_flush(chain->display->wl_display);
 
    return VK_SUCCESS;
@@ -905,10 +918,14 @@ static void
 buffer_handle_release(void *data, struct wl_buffer *buffer)
 {
    struct wsi_wl_image *image = data;
+   struct wsi_wl_swapchain *chain = image->chain;
 
    assert(image->buffer == buffer);
 
+   pthread_mutex_lock(&chain->lock);
    image->busy = false;
+   pthread_cond_broadcast(&chain->cond);
+   pthread_mutex_unlock(&chain->lock);
 }
 
 static const struct wl_buffer_listener buffer_listener = {
@@ -939,7 +956,7 @@ wsi_wl_image_init(struct wsi_wl_swapchain *chain,
 
       struct zwp_linux_buffer_params_v1 *params =
          zwp_linux_dmabuf_v1_create_params(display->dmabuf.wl_dmabuf);
-      wl_proxy_set_queue((struct wl_proxy *) params, chain->display->queue);
+      wl_proxy_set_queue((struct wl_proxy *) params, chain->queue);
 
       for (int i = 0; i < image->base.num_planes; i++) {
          zwp_linux_buffer_params_v1_add(params,
@@ -979,6 +996,7 @@ wsi_wl_image_init(struct wsi_wl_swapchain *chain,
    if (!image->buffer)
       goto fail_image;
 
+   image->chain = chain;
    wl_buffer_add_listener(image->buffer, &buffer_listener, image);
 
    return VK_SUCCESS;
@@ -989,12 +1007,69 @@ fail_image:
    return result;
 }
 
+static void *
+wsi_wl_swapchain_event_thread(void *data)
+{
+   struct wsi_wl_swapchain *chain = data;
+   struct wl_display *wl_display = chain->display->wl_display;
+   struct pollfd pollfds[2] = {
+      { .fd = wl_display_get_fd(wl_display), .events = POLLIN },
+      { .fd = chain->event_thread_pipe[0], .events = POLLIN },
+   };
+
+   while (1) {
+      while (wl_display_prepare_read_queue(wl_display, chain->queue) != 0) {
+         if (wl_display_dispatch_queue_pending(wl_display, chain->queue) < 0)
+            goto fail;
+      }
+
+      int ret = poll(pollfds, ARRAY_SIZE(pollfds), -1);
+      if (ret < 0) {
+         int lerrno = errno;
+         wl_display_cancel_read(wl_display);
+         if (lerrno == EINTR || lerrno == EAGAIN)
+            continue;
+         goto fail;
+      }
+
+      /* The swapchain is going away. */
+      if (pollfds[1].revents) {
+         wl_display_cancel_read(wl_display);
+         return NULL;
+      }
+
+      if (wl_display_read_events(wl_display) < 0)
+         goto fail;
+
+      if (wl_display_dispatch_queue_pending(wl_display, chain->queue) < 0)
+         goto fail;
+   }
+
+fail:
+   pthread_mutex_lock(&chain->lock);
+   chain->status = VK_ERROR_OUT_OF_DATE_KHR;
+   pthread_cond_broadcast(&chain->cond);
+   pthread_mutex_unlock(&chain->lock);
+
+   return NULL;
+}
+
 static VkResult
 wsi_wl_swapchain_destroy(struct wsi_swapchain *wsi_chain,
                          const VkAllocationCallbacks *pAllocator)
 {
    struct wsi_wl_swapchain *chain = (struct wsi_wl_swapchain *)wsi_chain;
 
+   if (chain->has_event_thread) {
+      ASSERTED ssize_t ret = write(chain->event_thread_pipe[1], "", 1);
+      assert(ret == 1);
+      pthread_join(chain->event_thread, NULL);
+   }
+   for (int i = 0; i < ARRAY_SIZE(chain->event_thread_pipe); i++) {
+      if (chain->event_thread_pipe[i] >= 0)
+         close(chain->event_thread_pipe[i]);
+   }
+
    for (uint32_t i = 0; i < chain->base.image_count; i++) {
       if (chain->images[i].buffer) {
          wl_buffer_destroy(chain->images[i].buffer);
@@ -1008,10 +1083,15 @@ wsi_wl_swapchain_destroy(struct wsi_swapchain *wsi_chain,
       wl_proxy_wrapper_destroy(chain->surface);
    if (chain->drm_wrapper)
       wl_proxy_wrapper_destroy(chain->drm_wrapper);
+   if (chain->queue)
+      wl_event_queue_destroy(chain->queue);
 
    if (chain->display)
       wsi_wl_display_unref(chain->display);
 
+   pthread_cond_destroy(&chain->cond);
+   pthread_mutex_destroy(&chain->lock);
+
    wsi_swapchain_finish(&chain->base);
 
    vk_free(pAllocator, chain);
@@ -1019,6 +1099,29 @@ wsi_wl_swapchain_destroy(struct wsi_swapchain *wsi_chain,
    return VK_SUCCESS;
 }
 
+static VkResult
+wsi_wl_swapchain_init_lock(struct wsi_wl_swapchain *chain)
+{
+   pthread_condattr_t condattr;
+   if (pthread_condattr_init(&condattr) != 0)
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+   /* acquire computes its deadline with CLOCK_MONOTONIC. */
+   if (pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC) != 0 ||
+       pthread_cond_init(&chain->cond, &condattr) != 0) {
+      pthread_condattr_destroy(&condattr);
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
+   }
+   pthread_condattr_destroy(&condattr);
+
+   if (pthread_mutex_init(&chain->lock, NULL) != 0) {
+      pthread_cond_destroy(&chain->cond);
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
+   }
+
+   return VK_SUCCESS;
+}
+
 static VkResult
 wsi_wl_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
                                 VkDevice device,
@@ -1050,6 +1153,13 @@ wsi_wl_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
       return result;
    }
 
+   result = wsi_wl_swapchain_init_lock(chain);
+   if (result != VK_SUCCESS) {
+      wsi_swapchain_finish(&chain->base);
+      vk_free(pAllocator, chain);
+      return result;
+   }
+
    /* Mark a bunch of stuff as NULL.  This way we can just call
     * destroy_swapchain for cleanup.
     */
@@ -1058,6 +1168,11 @@ wsi_wl_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    chain->surface = NULL;
    chain->drm_wrapper = NULL;
    chain->frame = NULL;
+   chain->queue = NULL;
+   chain->has_event_thread = false;
+   chain->event_thread_pipe[0] = -1;
+   chain->event_thread_pipe[1] = -1;
+   chain->status = VK_SUCCESS;
 
    bool alpha = pCreateInfo->compositeAlpha ==
                       VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR;
@@ -1085,13 +1200,18 @@ wsi_wl_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
          goto fail;
    }
 
+   chain->queue = wl_display_create_queue(chain->display->wl_display);
+   if (!chain->queue) {
+      result = VK_ERROR_OUT_OF_HOST_MEMORY;
+      goto fail;
+   }
+
    chain->surface = wl_proxy_create_wrapper(surface->surface);
    if (!chain->surface) {
       result = VK_ERROR_OUT_OF_HOST_MEMORY;
       goto fail;
    }
-   wl_proxy_set_queue((struct wl_proxy *) chain->surface,
-                      chain->display->queue);
+   wl_proxy_set_queue((struct wl_proxy *) chain->surface, chain->queue);
    chain->surface_version = wl_proxy_get_version((void *)surface->surface);
 
    chain->num_drm_modifiers = 0;
@@ -1135,7 +1255,7 @@ wsi_wl_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
          goto fail;
       }
       wl_proxy_set_queue((struct wl_proxy *) chain->drm_wrapper,
-                         chain->display->queue);
+                         chain->queue);
    }
 
    chain->fifo_ready = true;
@@ -1148,6 +1268,18 @@ wsi_wl_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
       chain->images[i].busy = false;
    }
 
+   if (pipe2(chain->event_thread_pipe, O_CLOEXEC) < 0) {
+      result = VK_ERROR_OUT_OF_HOST_MEMORY;
+      goto fail;
+   }
+
+   if (pthread_create(&chain->event_thread, NULL,
+                      wsi_wl_swapchain_event_thread, chain) != 0) {
+      result = VK_ERROR_OUT_OF_HOST_MEMORY;
+      goto fail;
+   }
+   chain->has_event_thread = true;
+
    *swapchain_out = &chain->base;
 
    return VK_SUCCESS;
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 #include <fcntl.h>
 #include <poll.h>
@@ -741,6 +742,11 @@ struct x11_swapchain {
 
    bool                                         has_dri3_modifiers;
 
+   /* The display GPU is a different one, but imports our images directly
+    * instead of us blitting them into a linear buffer (use_prime_blit).
+    */
+   bool                                         prime_direct;
+
    xcb_connection_t *                           conn;
    xcb_window_t                                 window;
    xcb_gc_t                                     gc;
@@ -762,6 +768,14 @@ struct x11_swapchain {
    struct wsi_queue                             acquire_queue;
    pthread_t                                    queue_manager;
 
+   /* FIFO only: when max_frame_latency is non-zero, acquire waits until
+    * fewer than that many presented frames are still waiting to be shown.
+    */
+   uint32_t                                     max_frame_latency;
+   uint32_t                                     frames_in_flight;
+   pthread_mutex_t                              latency_mutex;
+   pthread_cond_t                               latency_cond;
+
    struct x11_image                             images[0];
 };
 VK_DEFINE_NONDISP_HANDLE_CASTS(x11_swapchain, base.base, VkSwapchainKHR,
@@ -1059,6 +1073,62 @@ x11_present_to_x11(struct x11_swapchain *chain, uint32_t image_index,
    return x11_swapchain_result(chain, VK_SUCCESS);
 }
 
+static void
+x11_frame_latency_update(struct x11_swapchain *chain, int delta)
+{
+   pthread_mutex_lock(&chain->latency_mutex);
+   /* On error, delta is INT_MIN to wake up everyone. */
+   if (delta < 0 && (uint32_t) -(int64_t) delta > chain->frames_in_flight)
+      chain->frames_in_flight = 0;
+   else
+      chain->frames_in_flight += delta;
+   pthread_cond_broadcast(&chain->latency_cond);
+   pthread_mutex_unlock(&chain->latency_mutex);
+}
+
+/**
+ * Wait until fewer than max_frame_latency presented frames are waiting to
+ * be shown.  On success, the time spent waiting is taken off *timeout.
+ */
+static VkResult
+x11_wait_for_frame_latency(struct x11_swapchain *chain, uint64_t *timeout)
+{
+   VkResult result = VK_SUCCESS;
+   uint64_t atimeout = wsi_get_absolute_timeout(*timeout);
+
+   struct timespec abstime = {
+      .tv_sec = MIN2(atimeout / NSEC_PER_SEC, INT_TYPE_MAX(abstime.tv_sec)),
+      .tv_nsec = atimeout % NSEC_PER_SEC,
+   };
+
+   pthread_mutex_lock(&chain->latency_mutex);
+
+   while (chain->frames_in_flight >= chain->max_frame_latency &&
+          chain->status >= 0) {
+      if (*timeout == 0) {
+         result = VK_NOT_READY;
+         break;
+      }
+
+      int ret = pthread_cond_timedwait(&chain->latency_cond,
+                                       &chain->latency_mutex, &abstime);
+      if (ret == ETIMEDOUT) {
+         result = VK_TIMEOUT;
+         break;
+      } else if (ret) {
+         result = VK_ERROR_OUT_OF_DATE_KHR;
+         break;
+      }
+   }
+
+   pthread_mutex_unlock(&chain->latency_mutex);
+
+   uint64_t current_time = wsi_common_get_current_time();
+   *timeout = atimeout > current_time ? atimeout - current_time : 0;
+
+   return result;
+}
+
 static VkResult
 x11_acquire_next_image(struct wsi_swapchain *anv_chain,
                        const VkAcquireNextImageInfoKHR *info,
@@ -1071,6 +1141,12 @@ x11_acquire_next_image(struct wsi_swapchain *anv_chain,
    if (chain->status < 0)
       return chain->status;
 
+   if (chain->max_frame_latency) {
+      VkResult result = x11_wait_for_frame_latency(chain, &timeout);
+      if (result != VK_SUCCESS)
+         return x11_swapchain_result(chain, result);
+   }
+
    if (chain->has_acquire_queue) {
       return x11_acquire_next_image_from_queue(chain, image_index, timeout);
    } else {
@@ -1091,6 +1167,8 @@ x11_queue_present(struct wsi_swapchain *anv_chain,
 
    chain->images[image_index].busy = true;
    if (chain->has_present_queue) {
+      if (chain->max_frame_latency)
+         x11_frame_latency_update(chain, 1);
       wsi_queue_push(&chain->present_queue, image_index);
       return chain->status;
    } else {
@@ -1159,6 +1237,10 @@ x11_manage_fifo_queues(void *state)
             if (result < 0)
                goto fail;
          }
+
+         /* The frame is on screen now. */
+         if (chain->max_frame_latency)
+            x11_frame_latency_update(chain, -1);
       }
    }
 
@@ -1166,6 +1248,8 @@ fail:
    x11_swapchain_result(chain, result);
    if (chain->has_acquire_queue)
       wsi_queue_push(&chain->acquire_queue, UINT32_MAX);
+   if (chain->max_frame_latency)
+      x11_frame_latency_update(chain, INT_MIN);
 
    return NULL;
 }
@@ -1236,12 +1320,24 @@ x11_image_init(VkDevice device_h, struct x11_swapchain *chain,
                                              image->base.fds[0]);
    }
 
-   xcb_discard_reply(chain->conn, cookie.sequence);
-
-   /* XCB has now taken ownership of the FDs. */
+   /* XCB takes ownership of the FDs. */
    for (int i = 0; i < image->base.num_planes; i++)
       image->base.fds[i] = -1;
 
+   if (chain->prime_direct) {
+      /* The other GPU may not be able to import the image after all, and
+       * the caller falls back to blits if it can't.
+       */
+      xcb_generic_error_t *error = xcb_request_check(chain->conn, cookie);
+      if (error) {
+         free(error);
+         result = VK_ERROR_INITIALIZATION_FAILED;
+         goto fail_pixmap;
+      }
+   } else {
+      xcb_discard_reply(chain->conn, cookie.sequence);
+   }
+
    int fence_fd = xshmfence_alloc_shm();
    if (fence_fd < 0)
       goto fail_pixmap;
@@ -1368,6 +1464,58 @@ out:
    *num_tranches_in = 0;
 }
 
+static int
+x11_frame_latency_init(struct x11_swapchain *chain)
+{
+   pthread_condattr_t condattr;
+   int ret = pthread_condattr_init(&condattr);
+   if (ret)
+      return ret;
+
+   ret = pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+   if (ret)
+      goto out;
+
+   ret = pthread_cond_init(&chain->latency_cond, &condattr);
+   if (ret)
+      goto out;
+
+   ret = pthread_mutex_init(&chain->latency_mutex, NULL);
+   if (ret)
+      pthread_cond_destroy(&chain->latency_cond);
+
+out:
+   pthread_condattr_destroy(&condattr);
+   return ret;
+}
+
+static VkResult
+x11_swapchain_init_images(VkDevice device, struct x11_swapchain *chain,
+                          const VkSwapchainCreateInfoKHR *pCreateInfo,
+                          const VkAllocationCallbacks* pAllocator,
+                          const uint64_t *const *modifiers,
+                          const uint32_t *num_modifiers,
+                          int num_tranches)
+{
+   VkResult result = VK_SUCCESS;
+
+   uint32_t image = 0;
+   for (; image < chain->base.image_count; image++) {
+      result = x11_image_init(device, chain, pCreateInfo, pAllocator,
+                              modifiers, num_modifiers, num_tranches,
+                              &chain->images[image]);
+      if (result != VK_SUCCESS)
+         break;
+   }
+
+   if (result != VK_SUCCESS) {
+      for (uint32_t j = 0; j < image; j++)
+         x11_image_finish(chain, pAllocator, &chain->images[j]);
+   }
+
+   return result;
+}
+
 static VkResult
 x11_swapchain_destroy(struct wsi_swapchain *anv_chain,
                       const VkAllocationCallbacks *pAllocator)
@@ -1386,6 +1534,11 @@ x11_swapchain_destroy(struct wsi_swapchain *anv_chain,
       wsi_queue_destroy(&chain->present_queue);
    }
 
+   if (chain->max_frame_latency) {
+      pthread_cond_destroy(&chain->latency_cond);
+      pthread_mutex_destroy(&chain->latency_mutex);
+   }
+
    for (uint32_t i = 0; i < chain->base.image_count; i++)
       x11_image_finish(chain, pAllocator, &chain->images[i]);
 
@@ -1493,8 +1646,11 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    chain->last_present_msc = 0;
    chain->has_acquire_queue = false;
    chain->has_present_queue = false;
+   chain->max_frame_latency = 0;
+   chain->frames_in_flight = 0;
    chain->status = VK_SUCCESS;
    chain->has_dri3_modifiers = wsi_conn->has_dri3_modifiers;
+   chain->prime_direct = false;
 
    /* If we are reallocating from an old swapchain, then we inherit its
     * last completion mode, to ensure we don't get into reallocation
@@ -1547,16 +1703,34 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
                                  modifiers, num_modifiers, &num_tranches,
                                  pAllocator);
 
-   uint32_t image = 0;
-   for (; image < chain->base.image_count; image++) {
-      result = x11_image_init(device, chain, pCreateInfo, pAllocator,
-                              (const uint64_t *const *)modifiers,
-                              num_modifiers, num_tranches,
-                              &chain->images[image]);
-      if (result != VK_SUCCESS)
-         goto fail_init_images;
+   /* On hybrid setups, skip the per-present blit when the display GPU can
+    * take one of our modifiers as is.
+    */
+   if (chain->base.use_prime_blit && wsi_device->x11.prime_direct &&
+       num_tranches > 0 &&
+       wsi_has_common_modifier(wsi_device, pCreateInfo, num_tranches,
+                               num_modifiers,
+                               (const uint64_t *const *)modifiers)) {
+      chain->base.use_prime_blit = false;
+      chain->prime_direct = true;
    }
 
+   result = x11_swapchain_init_images(device, chain, pCreateInfo, pAllocator,
+                                      (const uint64_t *const *)modifiers,
+                                      num_modifiers, num_tranches);
+   if (result != VK_SUCCESS && chain->prime_direct) {
+      chain->base.use_prime_blit = true;
+      chain->prime_direct = false;
+      result = x11_swapchain_init_images(device, chain, pCreateInfo,
+                                         pAllocator,
+                                         (const uint64_t *const *)modifiers,
+                                         num_modifiers, num_tranches);
+   }
+   if (result != VK_SUCCESS)
+      goto fail_modifiers;
+
+   uint32_t image = chain->base.image_count;
+
    if (chain->base.present_mode == VK_PRESENT_MODE_FIFO_KHR ||
        chain->base.present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
       chain->has_present_queue = true;
@@ -1582,6 +1756,10 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
 
          for (unsigned i = 0; i < chain->base.image_count; i++)
             wsi_queue_push(&chain->acquire_queue, i);
+
+         if (wsi_device->x11.max_frame_latency &&
+             x11_frame_latency_init(chain) == 0)
+            chain->max_frame_latency = wsi_device->x11.max_frame_latency;
       }
 
       ret = pthread_create(&chain->queue_manager, NULL,
@@ -1590,6 +1768,10 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
          wsi_queue_destroy(&chain->present_queue);
          if (chain->has_acquire_queue)
             wsi_queue_destroy(&chain->acquire_queue);
+         if (chain->max_frame_latency) {
+            pthread_cond_destroy(&chain->latency_cond);
+            pthread_mutex_destroy(&chain->latency_mutex);
+         }
 
          goto fail_init_images;
       }
@@ -1614,6 +1796,7 @@ fail_init_images:
    for (uint32_t j = 0; j < image; j++)
       x11_image_finish(chain, pAllocator, &chain->images[j]);
 
+fail_modifiers:
    for (int i = 0; i < ARRAY_SIZE(modifiers); i++)
       vk_free(pAllocator, modifiers[i]);
 
@@ -1675,6 +1858,14 @@ wsi_x11_init_wsi(struct wsi_device *wsi_device,
          wsi_device->x11.ensure_minImageCount =
             driQueryOptionb(dri_options, "vk_x11_ensure_min_image_count");
       }
+      if (driCheckOption(dri_options, "vk_x11_max_frame_latency", DRI_INT)) {
+         wsi_device->x11.max_frame_latency =
+            driQueryOptioni(dri_options, "vk_x11_max_frame_latency");
+      }
+      if (driCheckOption(dri_options, "vk_x11_prime_direct", DRI_BOOL)) {
+         wsi_device->x11.prime_direct =
+            driQueryOptionb(dri_options, "vk_x11_prime_direct");
+      }
 
    }
 